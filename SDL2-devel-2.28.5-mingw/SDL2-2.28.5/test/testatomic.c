@@ -252,6 +252,11 @@ static void RunEpicTest()
 #define NUM_WRITERS       4
 #define EVENTS_PER_WRITER 1000000
 
+/* Thread counts swept by --fifo-benchmark, readers and writers each */
+#define MAX_READERS             8
+#define MAX_WRITERS             8
+#define BENCH_EVENTS_PER_WRITER 250000
+
 /* The number of entries must be a power of 2 */
 #define MAX_ENTRIES 256
 #define WRAP_MASK   (MAX_ENTRIES - 1)
@@ -335,6 +340,8 @@ static SDL_bool EnqueueEvent_LockFree(SDL_EventQueue *queue, const SDL_Event *ev
             if (SDL_AtomicCAS(&queue->enqueue_pos, (int)queue_pos, (int)(queue_pos + 1))) {
                 /* We own the object, fill it! */
                 entry->event = *event;
+                /* SDL_AtomicSet() only promises acquire semantics */
+                SDL_MemoryBarrierRelease();
                 SDL_AtomicSet(&entry->sequence, (int)(queue_pos + 1));
                 status = SDL_TRUE;
                 break;
@@ -382,6 +389,7 @@ static SDL_bool DequeueEvent_LockFree(SDL_EventQueue *queue, SDL_Event *event)
             if (SDL_AtomicCAS(&queue->dequeue_pos, (int)queue_pos, (int)(queue_pos + 1))) {
                 /* We own the object, fill it! */
                 *event = entry->event;
+                SDL_MemoryBarrierRelease();
                 SDL_AtomicSet(&entry->sequence, (int)(queue_pos + MAX_ENTRIES));
                 status = SDL_TRUE;
                 break;
@@ -474,18 +482,21 @@ typedef struct
     int index;
     char padding1[SDL_CACHELINE_SIZE - (sizeof(SDL_EventQueue *) + sizeof(int)) % SDL_CACHELINE_SIZE];
     int waits;
+    int events;
     SDL_bool lock_free;
-    char padding2[SDL_CACHELINE_SIZE - sizeof(int) - sizeof(SDL_bool)];
+    char padding2[SDL_CACHELINE_SIZE - 2 * sizeof(int) - sizeof(SDL_bool)];
     SDL_Thread *thread;
 } WriterData;
 
 typedef struct
 {
     SDL_EventQueue *queue;
-    int counters[NUM_WRITERS];
+    int counters[MAX_WRITERS];
+    int last_codes[MAX_WRITERS]; /* Last code seen from each writer, -1 before any */
+    int out_of_order;            /* Events older than one already read from the same writer */
     int waits;
     SDL_bool lock_free;
-    char padding[SDL_CACHELINE_SIZE - (sizeof(SDL_EventQueue *) + sizeof(int) * NUM_WRITERS + sizeof(int) + sizeof(SDL_bool)) % SDL_CACHELINE_SIZE];
+    char padding[SDL_CACHELINE_SIZE - (sizeof(SDL_EventQueue *) + sizeof(int) * MAX_WRITERS * 2 + sizeof(int) * 2 + sizeof(SDL_bool)) % SDL_CACHELINE_SIZE];
     SDL_Thread *thread;
 } ReaderData;
 
@@ -503,7 +514,7 @@ static int SDLCALL FIFO_Writer(void *_data)
     event.user.data2 = NULL;
 
     if (data->lock_free) {
-        for (i = 0; i < EVENTS_PER_WRITER; ++i) {
+        for (i = 0; i < data->events; ++i) {
             event.user.code = i;
             while (!EnqueueEvent_LockFree(queue, &event)) {
                 ++data->waits;
@@ -511,7 +522,7 @@ static int SDLCALL FIFO_Writer(void *_data)
             }
         }
     } else {
-        for (i = 0; i < EVENTS_PER_WRITER; ++i) {
+        for (i = 0; i < data->events; ++i) {
             event.user.code = i;
             while (!EnqueueEvent_Mutex(queue, &event)) {
                 ++data->waits;
@@ -522,6 +533,16 @@ static int SDLCALL FIFO_Writer(void *_data)
     return 0;
 }
 
+/* Each writer enqueues its codes in increasing order, so every reader must
+   see them increasing too, whatever it misses to the other readers */
+static void CheckEventOrder(ReaderData *data, int writer, int code)
+{
+    if (code <= data->last_codes[writer]) {
+        ++data->out_of_order;
+    }
+    data->last_codes[writer] = code;
+}
+
 static int SDLCALL FIFO_Reader(void *_data)
 {
     ReaderData *data = (ReaderData *)_data;
@@ -533,6 +554,7 @@ static int SDLCALL FIFO_Reader(void *_data)
             if (DequeueEvent_LockFree(queue, &event)) {
                 WriterData *writer = (WriterData *)event.user.data1;
                 ++data->counters[writer->index];
+                CheckEventOrder(data, writer->index, event.user.code);
             } else if (SDL_AtomicGet(&queue->active)) {
                 ++data->waits;
                 SDL_Delay(0);
@@ -546,6 +568,7 @@ static int SDLCALL FIFO_Reader(void *_data)
             if (DequeueEvent_Mutex(queue, &event)) {
                 WriterData *writer = (WriterData *)event.user.data1;
                 ++data->counters[writer->index];
+                CheckEventOrder(data, writer->index, event.user.code);
             } else if (SDL_AtomicGet(&queue->active)) {
                 ++data->waits;
                 SDL_Delay(0);
@@ -581,20 +604,26 @@ static int SDLCALL FIFO_Watcher(void *_data)
 }
 #endif /* TEST_SPINLOCK_FIFO */
 
-static void RunFIFOTest(SDL_bool lock_free)
+/* Returns the events per second moved through the queue, or a negative
+   number if the readers did not receive every event exactly once */
+static double RunFIFOTest(SDL_bool lock_free, int num_readers, int num_writers, int events_per_writer, SDL_bool verbose)
 {
     SDL_EventQueue queue;
     SDL_Thread *fifo_thread = NULL;
-    WriterData writerData[NUM_WRITERS];
-    ReaderData readerData[NUM_READERS];
-    Uint32 start, end;
+    WriterData writerData[MAX_WRITERS];
+    ReaderData readerData[MAX_READERS];
+    Uint64 start, end;
+    double seconds;
     int i, j;
     int grand_total;
+    int out_of_order;
     char textBuffer[1024];
     size_t len;
 
-    SDL_Log("\nFIFO test---------------------------------------\n\n");
-    SDL_Log("Mode: %s\n", lock_free ? "LockFree" : "Mutex");
+    if (verbose) {
+        SDL_Log("\nFIFO test---------------------------------------\n\n");
+        SDL_Log("Mode: %s\n", lock_free ? "LockFree" : "Mutex");
+    }
 
     SDL_memset(&queue, 0xff, sizeof(queue));
 
@@ -603,7 +632,7 @@ static void RunFIFOTest(SDL_bool lock_free)
         queue.mutex = SDL_CreateMutex();
     }
 
-    start = SDL_GetTicks();
+    start = SDL_GetPerformanceCounter();
 
 #ifdef TEST_SPINLOCK_FIFO
     /* Start a monitoring thread */
@@ -613,30 +642,38 @@ static void RunFIFOTest(SDL_bool lock_free)
 #endif
 
     /* Start the readers first */
-    SDL_Log("Starting %d readers\n", NUM_READERS);
+    if (verbose) {
+        SDL_Log("Starting %d readers\n", num_readers);
+    }
     SDL_zeroa(readerData);
-    for (i = 0; i < NUM_READERS; ++i) {
+    for (i = 0; i < num_readers; ++i) {
         char name[64];
         (void)SDL_snprintf(name, sizeof(name), "FIFOReader%d", i);
+        for (j = 0; j < MAX_WRITERS; ++j) {
+            readerData[i].last_codes[j] = -1;
+        }
         readerData[i].queue = &queue;
         readerData[i].lock_free = lock_free;
         readerData[i].thread = SDL_CreateThread(FIFO_Reader, name, &readerData[i]);
     }
 
     /* Start up the writers */
-    SDL_Log("Starting %d writers\n", NUM_WRITERS);
+    if (verbose) {
+        SDL_Log("Starting %d writers\n", num_writers);
+    }
     SDL_zeroa(writerData);
-    for (i = 0; i < NUM_WRITERS; ++i) {
+    for (i = 0; i < num_writers; ++i) {
         char name[64];
         (void)SDL_snprintf(name, sizeof(name), "FIFOWriter%d", i);
         writerData[i].queue = &queue;
         writerData[i].index = i;
+        writerData[i].events = events_per_writer;
         writerData[i].lock_free = lock_free;
         writerData[i].thread = SDL_CreateThread(FIFO_Writer, name, &writerData[i]);
     }
 
     /* Wait for the writers */
-    for (i = 0; i < NUM_WRITERS; ++i) {
+    for (i = 0; i < num_writers; ++i) {
         SDL_WaitThread(writerData[i].thread, NULL);
     }
 
@@ -644,11 +681,12 @@ static void RunFIFOTest(SDL_bool lock_free)
     SDL_AtomicSet(&queue.active, 0);
 
     /* Wait for the readers */
-    for (i = 0; i < NUM_READERS; ++i) {
+    for (i = 0; i < num_readers; ++i) {
         SDL_WaitThread(readerData[i].thread, NULL);
     }
 
-    end = SDL_GetTicks();
+    end = SDL_GetPerformanceCounter();
+    seconds = (double)(end - start) / SDL_GetPerformanceFrequency();
 
     /* Wait for the FIFO thread */
     if (fifo_thread) {
@@ -659,38 +697,85 @@ static void RunFIFOTest(SDL_bool lock_free)
         SDL_DestroyMutex(queue.mutex);
     }
 
-    SDL_Log("Finished in %f sec\n", (end - start) / 1000.f);
-
-    SDL_Log("\n");
-    for (i = 0; i < NUM_WRITERS; ++i) {
-        SDL_Log("Writer %d wrote %d events, had %d waits\n", i, EVENTS_PER_WRITER, writerData[i].waits);
+    grand_total = 0;
+    out_of_order = 0;
+    for (i = 0; i < num_readers; ++i) {
+        for (j = 0; j < num_writers; ++j) {
+            grand_total += readerData[i].counters[j];
+        }
+        out_of_order += readerData[i].out_of_order;
     }
-    SDL_Log("Writers wrote %d total events\n", NUM_WRITERS * EVENTS_PER_WRITER);
 
-    /* Print a breakdown of which readers read messages from which writer */
-    SDL_Log("\n");
-    grand_total = 0;
-    for (i = 0; i < NUM_READERS; ++i) {
-        int total = 0;
-        for (j = 0; j < NUM_WRITERS; ++j) {
-            total += readerData[i].counters[j];
+    if (verbose) {
+        SDL_Log("Finished in %f sec\n", seconds);
+
+        SDL_Log("\n");
+        for (i = 0; i < num_writers; ++i) {
+            SDL_Log("Writer %d wrote %d events, had %d waits\n", i, events_per_writer, writerData[i].waits);
         }
-        grand_total += total;
-        SDL_Log("Reader %d read %d events, had %d waits\n", i, total, readerData[i].waits);
-        (void)SDL_snprintf(textBuffer, sizeof(textBuffer), "  { ");
-        for (j = 0; j < NUM_WRITERS; ++j) {
-            if (j > 0) {
+        SDL_Log("Writers wrote %d total events\n", num_writers * events_per_writer);
+
+        /* Print a breakdown of which readers read messages from which writer */
+        SDL_Log("\n");
+        for (i = 0; i < num_readers; ++i) {
+            int total = 0;
+            for (j = 0; j < num_writers; ++j) {
+                total += readerData[i].counters[j];
+            }
+            SDL_Log("Reader %d read %d events, had %d waits\n", i, total, readerData[i].waits);
+            (void)SDL_snprintf(textBuffer, sizeof(textBuffer), "  { ");
+            for (j = 0; j < num_writers; ++j) {
+                if (j > 0) {
+                    len = SDL_strlen(textBuffer);
+                    (void)SDL_snprintf(textBuffer + len, sizeof(textBuffer) - len, ", ");
+                }
                 len = SDL_strlen(textBuffer);
-                (void)SDL_snprintf(textBuffer + len, sizeof(textBuffer) - len, ", ");
+                (void)SDL_snprintf(textBuffer + len, sizeof(textBuffer) - len, "%d", readerData[i].counters[j]);
             }
             len = SDL_strlen(textBuffer);
-            (void)SDL_snprintf(textBuffer + len, sizeof(textBuffer) - len, "%d", readerData[i].counters[j]);
+            (void)SDL_snprintf(textBuffer + len, sizeof(textBuffer) - len, " }\n");
+            SDL_Log("%s", textBuffer);
         }
-        len = SDL_strlen(textBuffer);
-        (void)SDL_snprintf(textBuffer + len, sizeof(textBuffer) - len, " }\n");
-        SDL_Log("%s", textBuffer);
+        SDL_Log("Readers read %d total events\n", grand_total);
+    }
+
+    if (grand_total != num_writers * events_per_writer) {
+        SDL_Log("ERROR: %s FIFO lost events: read %d of %d\n", lock_free ? "LockFree" : "Mutex",
+                grand_total, num_writers * events_per_writer);
+        return -1.0;
+    }
+    if (out_of_order != 0) {
+        SDL_Log("ERROR: %s FIFO reordered events: %d read after a later event from the same writer\n",
+                lock_free ? "LockFree" : "Mutex", out_of_order);
+        return -1.0;
     }
-    SDL_Log("Readers read %d total events\n", grand_total);
+    return seconds > 0.0 ? grand_total / seconds : 0.0;
+}
+
+/* Sweeps reader/writer thread counts through both queue implementations.
+   Returns 0 on success, 1 if any run lost or duplicated events. */
+static int RunFIFOBenchmark(void)
+{
+    static const int thread_counts[] = { 1, 2, 4, MAX_WRITERS };
+    int failures = 0;
+    int mode, i;
+
+    SDL_Log("\nFIFO benchmark----------------------------------\n\n");
+    SDL_Log("%-10s %8s %8s %16s %16s\n", "mode", "readers", "writers", "events/sec", "per writer");
+    for (mode = 0; mode < 2; ++mode) {
+        const SDL_bool lock_free = mode == 0 ? SDL_TRUE : SDL_FALSE;
+        for (i = 0; i < (int)SDL_arraysize(thread_counts); ++i) {
+            const int threads = thread_counts[i];
+            const double rate = RunFIFOTest(lock_free, threads, threads, BENCH_EVENTS_PER_WRITER, SDL_FALSE);
+            if (rate < 0.0) {
+                ++failures;
+                continue;
+            }
+            SDL_Log("%-10s %8d %8d %16.0f %16.0f\n", lock_free ? "LockFree" : "Mutex",
+                    threads, threads, rate, rate / threads);
+        }
+    }
+    return failures ? 1 : 0;
 }
 
 /* End FIFO test */
@@ -703,6 +788,10 @@ int main(int argc, char *argv[])
 
     RunBasicTest();
 
+    if (argc > 1 && SDL_strcmp(argv[1], "--fifo-benchmark") == 0) {
+        return RunFIFOBenchmark();
+    }
+
     if (SDL_getenv("SDL_TESTS_QUICK") != NULL) {
         SDL_Log("Not running slower tests");
         return 0;
@@ -711,9 +800,11 @@ int main(int argc, char *argv[])
     RunEpicTest();
 /* This test is really slow, so don't run it by default */
 #if 0
-    RunFIFOTest(SDL_FALSE);
+    RunFIFOTest(SDL_FALSE, NUM_READERS, NUM_WRITERS, EVENTS_PER_WRITER, SDL_TRUE);
 #endif
-    RunFIFOTest(SDL_TRUE);
+    if (RunFIFOTest(SDL_TRUE, NUM_READERS, NUM_WRITERS, EVENTS_PER_WRITER, SDL_TRUE) < 0.0) {
+        return 1;
+    }
     return 0;
 }
 
@@ -78,10 +78,17 @@ int main(int argc, char *argv[])
                     filter = SDL_strdup(argv[i + 1]);
                     consumed = 2;
                 }
+            } else if (SDL_strcasecmp(argv[i], "--list") == 0) {
+                /* One suite name per line, for runners that shard by suite */
+                int suite;
+                for (suite = 0; testSuites[suite] != NULL; suite++) {
+                    printf("%s\n", testSuites[suite]->name);
+                }
+                quit(0);
             }
         }
         if (consumed < 0) {
-            static const char *options[] = { "[--iterations #]", "[--execKey #]", "[--seed string]", "[--filter suite_name|test_name]", NULL };
+            static const char *options[] = { "[--iterations #]", "[--execKey #]", "[--seed string]", "[--filter suite_name|test_name]", "[--list]", NULL };
             SDLTest_CommonLogUsage(state, argv[0], options);
             quit(1);
         }
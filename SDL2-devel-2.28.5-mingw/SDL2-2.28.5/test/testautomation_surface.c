@@ -761,6 +761,228 @@ int surface_testOverflow(void *arg)
     return TEST_COMPLETED;
 }
 
+/**
+ * Helper that creates a 32-bit surface whose rows start either on a SIMD
+ * boundary (pitch padded to SDL_SIMDGetAlignment()) or deliberately 4 bytes
+ * past one. The caller releases the pixels with SDL_SIMDFree().
+ */
+static SDL_Surface *_createBenchSurface(int w, int h, Uint32 format, SDL_bool aligned, void **storage)
+{
+    size_t alignment = SDL_SIMDGetAlignment();
+    int pitch = (int)((w * 4 + alignment - 1) / alignment * alignment);
+    Uint8 *pixels;
+
+    if (!aligned) {
+        pitch += 4;
+    }
+    *storage = SDL_SIMDAlloc((size_t)pitch * h + alignment);
+    if (*storage == NULL) {
+        return NULL;
+    }
+    pixels = (Uint8 *)*storage + (aligned ? 0 : 4);
+    SDL_memset(*storage, 0x5a, (size_t)pitch * h + alignment);
+    return SDL_CreateRGBSurfaceWithFormatFrom(pixels, w, h, 32, pitch, format);
+}
+
+/**
+ * Benchmarks blits and pixel conversion on SIMD aligned vs. unaligned rows
+ */
+int surface_testAlignedBlitBenchmark(void *arg)
+{
+    const int w = 1021, h = 512, iterations = 20;
+    const size_t alignment = SDL_SIMDGetAlignment();
+    SDL_Surface *src[2], *dst[2];
+    void *srcStorage[2], *dstStorage[2];
+    Uint64 blitTicks[2], convertTicks[2];
+    int i, n, y, ret;
+
+    for (i = 0; i < 2; i++) {
+        SDL_bool aligned = (i == 0) ? SDL_TRUE : SDL_FALSE;
+        src[i] = _createBenchSurface(w, h, SDL_PIXELFORMAT_ARGB8888, aligned, &srcStorage[i]);
+        dst[i] = _createBenchSurface(w, h, SDL_PIXELFORMAT_ARGB8888, aligned, &dstStorage[i]);
+        SDLTest_AssertCheck(src[i] != NULL && dst[i] != NULL, "Verify benchmark surfaces are not NULL");
+        if (src[i] == NULL || dst[i] == NULL) {
+            return TEST_ABORTED;
+        }
+        SDL_SetSurfaceBlendMode(src[i], SDL_BLENDMODE_BLEND);
+    }
+    SDLTest_AssertCheck(src[0]->pitch % alignment == 0 && ((uintptr_t)src[0]->pixels % alignment) == 0,
+                        "Verify aligned rows start on a %d byte boundary", (int)alignment);
+
+    /* Same pseudo-random content in both cases */
+    for (y = 0; y < h; y++) {
+        Uint32 *row0 = (Uint32 *)((Uint8 *)src[0]->pixels + y * src[0]->pitch);
+        Uint32 *row1 = (Uint32 *)((Uint8 *)src[1]->pixels + y * src[1]->pitch);
+        for (n = 0; n < w; n++) {
+            row0[n] = row1[n] = (Uint32)(y * 2654435761u + n * 40503u);
+        }
+    }
+
+    for (i = 0; i < 2; i++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (n = 0; n < iterations; n++) {
+            ret = SDL_BlitSurface(src[i], NULL, dst[i], NULL);
+            SDLTest_AssertCheck(ret == 0, "Verify result from SDL_BlitSurface, expected: 0, got: %i", ret);
+        }
+        blitTicks[i] = SDL_GetPerformanceCounter() - start;
+
+        start = SDL_GetPerformanceCounter();
+        for (n = 0; n < iterations; n++) {
+            ret = SDL_ConvertPixels(w, h, SDL_PIXELFORMAT_ARGB8888, src[i]->pixels, src[i]->pitch,
+                                    SDL_PIXELFORMAT_ABGR8888, dst[i]->pixels, dst[i]->pitch);
+            SDLTest_AssertCheck(ret == 0, "Verify result from SDL_ConvertPixels, expected: 0, got: %i", ret);
+        }
+        convertTicks[i] = SDL_GetPerformanceCounter() - start;
+    }
+
+    /* Alignment must never change the result */
+    for (y = 0; y < h; y++) {
+        if (SDL_memcmp((Uint8 *)dst[0]->pixels + y * dst[0]->pitch, (Uint8 *)dst[1]->pixels + y * dst[1]->pitch, w * 4) != 0) {
+            break;
+        }
+    }
+    SDLTest_AssertCheck(y == h, "Verify aligned and unaligned results match, first mismatch at row %i of %i", y, h);
+
+    SDLTest_Log("Blend blit %dx%d: aligned %.3f ms, unaligned %.3f ms per call", w, h,
+                blitTicks[0] * 1000.0 / SDL_GetPerformanceFrequency() / iterations,
+                blitTicks[1] * 1000.0 / SDL_GetPerformanceFrequency() / iterations);
+    SDLTest_Log("ARGB8888->ABGR8888 conversion %dx%d: aligned %.3f ms, unaligned %.3f ms per call", w, h,
+                convertTicks[0] * 1000.0 / SDL_GetPerformanceFrequency() / iterations,
+                convertTicks[1] * 1000.0 / SDL_GetPerformanceFrequency() / iterations);
+
+    for (i = 0; i < 2; i++) {
+        SDL_FreeSurface(src[i]);
+        SDL_FreeSurface(dst[i]);
+        SDL_SIMDFree(srcStorage[i]);
+        SDL_SIMDFree(dstStorage[i]);
+    }
+
+    return TEST_COMPLETED;
+}
+
+/* Blits `rect` of src to (dx, dy) of dst the way a banded parallel blit
+   does: one SDL_BlitSurface per run of `band_rows` rows, between surfaces
+   that view only those rows and carry the source's blit state */
+static int _blitInBands(SDL_Surface *src, const SDL_Rect *rect, SDL_Surface *dst, int dx, int dy, int band_rows)
+{
+    SDL_BlendMode blend;
+    Uint8 r, g, b, a;
+    Uint32 key;
+    SDL_bool keyed = SDL_GetColorKey(src, &key) == 0 ? SDL_TRUE : SDL_FALSE;
+    int y;
+
+    SDL_GetSurfaceBlendMode(src, &blend);
+    SDL_GetSurfaceColorMod(src, &r, &g, &b);
+    SDL_GetSurfaceAlphaMod(src, &a);
+    for (y = 0; y < rect->h; y += band_rows) {
+        int rows = SDL_min(band_rows, rect->h - y);
+        SDL_Rect from, to;
+        SDL_Surface *srcBand = SDL_CreateRGBSurfaceWithFormatFrom((Uint8 *)src->pixels + (size_t)(rect->y + y) * src->pitch,
+                                                                  src->w, rows, src->format->BitsPerPixel, src->pitch, src->format->format);
+        SDL_Surface *dstBand = SDL_CreateRGBSurfaceWithFormatFrom((Uint8 *)dst->pixels + (size_t)(dy + y) * dst->pitch,
+                                                                  dst->w, rows, dst->format->BitsPerPixel, dst->pitch, dst->format->format);
+        int ret = -1;
+
+        if (srcBand != NULL && dstBand != NULL) {
+            SDL_SetSurfaceBlendMode(srcBand, blend);
+            SDL_SetSurfaceColorMod(srcBand, r, g, b);
+            SDL_SetSurfaceAlphaMod(srcBand, a);
+            if (keyed) {
+                SDL_SetColorKey(srcBand, SDL_TRUE, key);
+            }
+            from.x = rect->x;
+            from.y = 0;
+            from.w = rect->w;
+            from.h = rows;
+            to.x = dx;
+            to.y = 0;
+            ret = SDL_BlitSurface(srcBand, &from, dstBand, &to);
+        }
+        SDL_FreeSurface(srcBand);
+        SDL_FreeSurface(dstBand);
+        if (ret != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Checks that blitting in row bands, as parallelBlitSurface does, gives exactly
+ * the pixels of one SDL_BlitSurface for every blend mode, with modulation and
+ * colour key, onto destinations of several formats
+ */
+int surface_testBandedBlit(void *arg)
+{
+    const int w = 203, h = 97, band_rows = 7;
+    const SDL_BlendMode blendModes[] = {
+        SDL_BLENDMODE_NONE, SDL_BLENDMODE_BLEND, SDL_BLENDMODE_ADD, SDL_BLENDMODE_MOD, SDL_BLENDMODE_MUL
+    };
+    const Uint32 dstFormats[] = { SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_RGB888, SDL_PIXELFORMAT_RGB565 };
+    const SDL_Rect rect = { 5, 3, w - 11, h - 8 };
+    SDL_Surface *src = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+    int b, f, variant, x, y, ret;
+
+    SDLTest_AssertCheck(src != NULL, "Verify source surface is not NULL");
+    if (src == NULL) {
+        return TEST_ABORTED;
+    }
+    for (y = 0; y < h; y++) {
+        Uint32 *row = (Uint32 *)((Uint8 *)src->pixels + y * src->pitch);
+        for (x = 0; x < w; x++) {
+            /* Every eleventh pixel is the colour key */
+            row[x] = (x + y) % 11 == 0 ? 0xff00ff00 : (Uint32)(y * 2654435761u + x * 40503u);
+        }
+    }
+
+    for (f = 0; f < SDL_arraysize(dstFormats); f++) {
+        for (b = 0; b < SDL_arraysize(blendModes); b++) {
+            for (variant = 0; variant < 2; variant++) {
+                SDL_Surface *whole = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, dstFormats[f]);
+                SDL_Surface *banded = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, dstFormats[f]);
+                SDL_Rect to = { 4, 6, 0, 0 };
+                SDLTest_AssertCheck(whole != NULL && banded != NULL, "Verify destination surfaces are not NULL");
+                if (whole == NULL || banded == NULL) {
+                    SDL_FreeSurface(whole);
+                    SDL_FreeSurface(banded);
+                    SDL_FreeSurface(src);
+                    return TEST_ABORTED;
+                }
+                /* Same non-trivial background under both */
+                for (y = 0; y < h; y++) {
+                    SDL_memset((Uint8 *)whole->pixels + y * whole->pitch, y * 37, whole->pitch);
+                    SDL_memset((Uint8 *)banded->pixels + y * banded->pitch, y * 37, banded->pitch);
+                }
+
+                SDL_SetSurfaceBlendMode(src, blendModes[b]);
+                SDL_SetSurfaceColorMod(src, variant ? 200 : 255, variant ? 120 : 255, variant ? 60 : 255);
+                SDL_SetSurfaceAlphaMod(src, variant ? 150 : 255);
+                SDL_SetColorKey(src, variant ? SDL_TRUE : SDL_FALSE, 0xff00ff00);
+
+                ret = SDL_BlitSurface(src, &rect, whole, &to);
+                SDLTest_AssertCheck(ret == 0, "Verify result from SDL_BlitSurface, expected: 0, got: %i", ret);
+                ret = _blitInBands(src, &rect, banded, 4, 6, band_rows);
+                SDLTest_AssertCheck(ret == 0, "Verify result from the banded blit, expected: 0, got: %i", ret);
+
+                for (y = 0; y < h; y++) {
+                    if (SDL_memcmp((Uint8 *)whole->pixels + y * whole->pitch, (Uint8 *)banded->pixels + y * banded->pitch,
+                                   (size_t)w * whole->format->BytesPerPixel) != 0) {
+                        break;
+                    }
+                }
+                SDLTest_AssertCheck(y == h, "Verify banded blit matches one blit onto %s, blend mode %d%s, first mismatch at row %i of %i",
+                                    SDL_GetPixelFormatName(dstFormats[f]), (int)blendModes[b],
+                                    variant ? " with modulation and colour key" : "", y, h);
+                SDL_FreeSurface(whole);
+                SDL_FreeSurface(banded);
+            }
+        }
+    }
+
+    SDL_FreeSurface(src);
+    return TEST_COMPLETED;
+}
+
 /* ================= Test References ================== */
 
 /* Surface test cases */
@@ -819,11 +1041,20 @@ static const SDLTest_TestCaseReference surfaceTestOverflow = {
     surface_testOverflow, "surface_testOverflow", "Test overflow detection.", TEST_ENABLED
 };
 
+static const SDLTest_TestCaseReference surfaceTestAlignedBlitBenchmark = {
+    surface_testAlignedBlitBenchmark, "surface_testAlignedBlitBenchmark", "Benchmarks blits and conversion on SIMD aligned and unaligned rows.", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference surfaceTestBandedBlit = {
+    surface_testBandedBlit, "surface_testBandedBlit", "Tests that blitting in row bands matches one blit.", TEST_ENABLED
+};
+
 /* Sequence of Surface test cases */
 static const SDLTest_TestCaseReference *surfaceTests[] = {
     &surfaceTest1, &surfaceTest2, &surfaceTest3, &surfaceTest4, &surfaceTest5,
     &surfaceTest6, &surfaceTest7, &surfaceTest8, &surfaceTest9, &surfaceTest10,
-    &surfaceTest11, &surfaceTest12, &surfaceTestOverflow, NULL
+    &surfaceTest11, &surfaceTest12, &surfaceTestOverflow, &surfaceTestAlignedBlitBenchmark,
+    &surfaceTestBandedBlit, NULL
 };
 
 /* Surface test suite (global) */
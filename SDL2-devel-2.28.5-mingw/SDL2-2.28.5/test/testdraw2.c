@@ -35,6 +35,88 @@ static SDL_BlendMode blendMode = SDL_BLENDMODE_NONE;
 static Uint32 next_fps_check, frames;
 static const Uint32 fps_check_delay = 5000;
 
+/* State deduplication benchmark: --redundantstate re-sets the (unchanged)
+   blend mode and render target before every primitive, the way layered
+   drawing code tends to; --statecache filters every state call through a
+   cache of the values last set, so only real changes reach the renderer. */
+static SDL_bool redundant_state;
+static SDL_bool state_cache;
+
+typedef struct
+{
+    SDL_Renderer *renderer;
+    Uint8 r, g, b, a;
+    SDL_BlendMode blend;
+    SDL_Texture *target;
+} StateCache;
+
+static StateCache cache;
+static Uint32 state_calls, state_eliminated;
+
+static SDL_bool CacheFor(SDL_Renderer *renderer)
+{
+    state_calls++;
+    if (!state_cache) {
+        return SDL_FALSE;
+    }
+    if (cache.renderer != renderer) {
+        cache.renderer = renderer;
+        SDL_GetRenderDrawColor(renderer, &cache.r, &cache.g, &cache.b, &cache.a);
+        SDL_GetRenderDrawBlendMode(renderer, &cache.blend);
+        cache.target = SDL_GetRenderTarget(renderer);
+    }
+    return SDL_TRUE;
+}
+
+static void SetDrawColor(SDL_Renderer *renderer, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+{
+    if (CacheFor(renderer)) {
+        if (cache.r == r && cache.g == g && cache.b == b && cache.a == a) {
+            state_eliminated++;
+            return;
+        }
+        cache.r = r;
+        cache.g = g;
+        cache.b = b;
+        cache.a = a;
+    }
+    SDL_SetRenderDrawColor(renderer, r, g, b, a);
+}
+
+static void SetDrawBlendMode(SDL_Renderer *renderer, SDL_BlendMode mode)
+{
+    if (CacheFor(renderer)) {
+        if (cache.blend == mode) {
+            state_eliminated++;
+            return;
+        }
+        cache.blend = mode;
+    }
+    SDL_SetRenderDrawBlendMode(renderer, mode);
+}
+
+static void SetTarget(SDL_Renderer *renderer, SDL_Texture *target)
+{
+    if (CacheFor(renderer)) {
+        if (cache.target == target) {
+            state_eliminated++;
+            return;
+        }
+        cache.target = target;
+    }
+    SDL_SetRenderTarget(renderer, target);
+}
+
+/* Called before each primitive */
+static void SetPrimitiveState(SDL_Renderer *renderer)
+{
+    if (redundant_state) {
+        SetTarget(renderer, NULL);
+        SetDrawBlendMode(renderer, blendMode);
+    }
+    SetDrawColor(renderer, 255, (Uint8)current_color, (Uint8)current_color, (Uint8)current_alpha);
+}
+
 int done;
 
 void DrawPoints(SDL_Renderer *renderer)
@@ -70,8 +152,7 @@ void DrawPoints(SDL_Renderer *renderer)
                 cycle_direction = -cycle_direction;
             }
         }
-        SDL_SetRenderDrawColor(renderer, 255, (Uint8)current_color,
-                               (Uint8)current_color, (Uint8)current_alpha);
+        SetPrimitiveState(renderer);
 
         x = rand() % viewport.w;
         y = rand() % viewport.h;
@@ -112,8 +193,7 @@ void DrawLines(SDL_Renderer *renderer)
                 cycle_direction = -cycle_direction;
             }
         }
-        SDL_SetRenderDrawColor(renderer, 255, (Uint8)current_color,
-                               (Uint8)current_color, (Uint8)current_alpha);
+        SetPrimitiveState(renderer);
 
         if (i == 0) {
             SDL_RenderDrawLine(renderer, 0, 0, viewport.w - 1, viewport.h - 1);
@@ -163,8 +243,7 @@ void DrawRects(SDL_Renderer *renderer)
                 cycle_direction = -cycle_direction;
             }
         }
-        SDL_SetRenderDrawColor(renderer, 255, (Uint8)current_color,
-                               (Uint8)current_color, (Uint8)current_alpha);
+        SetPrimitiveState(renderer);
 
         rect.w = rand() % (viewport.h / 2);
         rect.h = rand() % (viewport.h / 2);
@@ -189,7 +268,7 @@ void loop()
         if (state->windows[i] == NULL) {
             continue;
         }
-        SDL_SetRenderDrawColor(renderer, 0xA0, 0xA0, 0xA0, 0xFF);
+        SetDrawColor(renderer, 0xA0, 0xA0, 0xA0, 0xFF);
         SDL_RenderClear(renderer);
 
         DrawRects(renderer);
@@ -210,8 +289,14 @@ void loop()
         const Uint32 then = next_fps_check - fps_check_delay;
         const double fps = ((double)frames * 1000) / (now - then);
         SDL_Log("%2.2f frames per second\n", fps);
+        if (frames > 0) {
+            SDL_Log("%u state calls per frame, %u eliminated by the cache\n",
+                    state_calls / frames, state_eliminated / frames);
+        }
         next_fps_check = now + fps_check_delay;
         frames = 0;
+        state_calls = 0;
+        state_eliminated = 0;
     }
 }
 
@@ -258,6 +343,12 @@ int main(int argc, char *argv[])
             } else if (SDL_strcasecmp(argv[i], "--cyclealpha") == 0) {
                 cycle_alpha = SDL_TRUE;
                 consumed = 1;
+            } else if (SDL_strcasecmp(argv[i], "--redundantstate") == 0) {
+                redundant_state = SDL_TRUE;
+                consumed = 1;
+            } else if (SDL_strcasecmp(argv[i], "--statecache") == 0) {
+                state_cache = SDL_TRUE;
+                consumed = 1;
             } else if (SDL_isdigit(*argv[i])) {
                 num_objects = SDL_atoi(argv[i]);
                 consumed = 1;
@@ -268,6 +359,8 @@ int main(int argc, char *argv[])
                 "[--blend none|blend|add|mod]",
                 "[--cyclecolor]",
                 "[--cyclealpha]",
+                "[--redundantstate]",
+                "[--statecache]",
                 "[num_objects]",
                 NULL
             };
@@ -31,6 +31,78 @@ widelen(char *data)
     return len;
 }
 
+/* Bytes in a converted string, its terminator included */
+static size_t
+convertedlen(const char *format, const char *data)
+{
+    size_t len = 0;
+    if (SDL_strstr(format, "16")) {
+        const Uint16 *p = (const Uint16 *)data;
+        while (*p++) {
+            ++len;
+        }
+        return (len + 1) * 2;
+    }
+    if (SDL_strstr(format, "32") || SDL_strstr(format, "UCS")) {
+        return (widelen((char *)data) + 1) * 4;
+    }
+    return SDL_strlen(data) + 1;
+}
+
+/* Throughput of SDL_iconv_string from UTF-8 to each format and back, over
+   the whole file repeated about a megabyte's worth */
+static int
+benchmark(const char *fname, const char **formats, int count)
+{
+    const int passes = 20;
+    size_t size = 0, total, len;
+    char *data = (char *)SDL_LoadFile(fname, &size);
+    char *text;
+    int i, pass;
+
+    if (data == NULL || size == 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to load %s: %s\n", fname, SDL_GetError());
+        SDL_free(data);
+        return 1;
+    }
+    total = size * (1024 * 1024 / size + 1);
+    text = (char *)SDL_malloc(total + 1);
+    if (text == NULL) {
+        SDL_free(data);
+        return 1;
+    }
+    for (len = 0; len < total; len += size) {
+        SDL_memcpy(text + len, data, size);
+    }
+    text[total] = '\0';
+    SDL_free(data);
+
+    SDL_Log("%-10s %12s %12s\n", "format", "to MB/s", "from MB/s");
+    for (i = 0; i < count; ++i) {
+        Uint64 toTicks = 0, fromTicks = 0, start;
+        for (pass = 0; pass < passes; ++pass) {
+            char *converted, *back;
+            start = SDL_GetPerformanceCounter();
+            converted = SDL_iconv_string(formats[i], "UTF-8", text, total + 1);
+            toTicks += SDL_GetPerformanceCounter() - start;
+            if (converted == NULL) {
+                break;
+            }
+            len = convertedlen(formats[i], converted);
+            start = SDL_GetPerformanceCounter();
+            back = SDL_iconv_string("UTF-8", formats[i], converted, len);
+            fromTicks += SDL_GetPerformanceCounter() - start;
+            SDL_free(converted);
+            SDL_free(back);
+        }
+        SDL_Log("%-10s %12.1f %12.1f\n", formats[i],
+                (double)total * passes / 1048576.0 / ((double)toTicks / SDL_GetPerformanceFrequency()),
+                (double)total * passes / 1048576.0 / ((double)fromTicks / SDL_GetPerformanceFrequency()));
+    }
+    SDL_free(text);
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     const char *formats[] = {
@@ -59,6 +131,15 @@ int main(int argc, char *argv[])
     /* Enable standard application logging */
     SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO);
 
+    /* testiconv --bench [utf8.txt] times the conversions instead */
+    if (argc > 1 && SDL_strcmp(argv[1], "--bench") == 0) {
+        int result;
+        fname = GetResourceFilename(argc > 2 ? argv[2] : NULL, "utf8.txt");
+        result = benchmark(fname, formats, (int)SDL_arraysize(formats));
+        SDL_free(fname);
+        return result;
+    }
+
     fname = GetResourceFilename(argc > 1 ? argv[1] : NULL, "utf8.txt");
     file = fopen(fname, "rb");
     if (file == NULL) {
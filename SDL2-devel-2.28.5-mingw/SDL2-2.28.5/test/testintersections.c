@@ -22,6 +22,11 @@
 
 #include "SDL_test_common.h"
 
+#if defined(__SSE2__) || defined(__x86_64__) || defined(_M_X64)
+#define HAVE_BATCH_SSE2 1
+#include <emmintrin.h>
+#endif
+
 #define SWAP(typ, a, b) \
     do {                \
         typ t = a;      \
@@ -208,6 +213,141 @@ DrawRectRectIntersections(SDL_Renderer *renderer)
     }
 }
 
+/* --benchmark: SDL_HasIntersection/SDL_PointInRect one pair per call
+   against a four-wide SSE2 batch that writes a bitmask, on the same data.
+   This builds against SDL alone, so it carries its own SSE2 batch; the
+   game's rect_batch kernels, AVX2 and NEON included, are checked against
+   SDL by project_templete's rectbench. */
+
+#define BENCH_PASSES 64
+
+static void
+BuildScalarMasks(const SDL_Rect *query, const SDL_Rect *rs, const SDL_Point *ps, int count,
+                 Uint32 *rect_mask, Uint32 *point_mask)
+{
+    int i;
+
+    SDL_memset(rect_mask, 0, ((count + 31) / 32) * sizeof(Uint32));
+    SDL_memset(point_mask, 0, ((count + 31) / 32) * sizeof(Uint32));
+    for (i = 0; i < count; ++i) {
+        if (SDL_HasIntersection(query, &rs[i])) {
+            rect_mask[i >> 5] |= 1u << (i & 31);
+        }
+        if (SDL_PointInRect(&ps[i], query)) {
+            point_mask[i >> 5] |= 1u << (i & 31);
+        }
+    }
+}
+
+#ifdef HAVE_BATCH_SSE2
+static void
+BuildBatchMasks(const SDL_Rect *query, const SDL_Rect *rs, const SDL_Point *ps, int count,
+                Uint32 *rect_mask, Uint32 *point_mask)
+{
+    const __m128i ax = _mm_set1_epi32(query->x), ay = _mm_set1_epi32(query->y);
+    const __m128i ar = _mm_set1_epi32(query->x + query->w), ab = _mm_set1_epi32(query->y + query->h);
+    const __m128i zero = _mm_setzero_si128();
+    int i;
+
+    SDL_memset(rect_mask, 0, ((count + 31) / 32) * sizeof(Uint32));
+    SDL_memset(point_mask, 0, ((count + 31) / 32) * sizeof(Uint32));
+    if (SDL_RectEmpty(query)) {
+        return;
+    }
+    for (i = 0; i + 4 <= count; i += 4) {
+        /* Rows of {x, y, w, h} to columns */
+        __m128i t0 = _mm_unpacklo_epi32(_mm_loadu_si128((const __m128i *)&rs[i]), _mm_loadu_si128((const __m128i *)&rs[i + 1]));
+        __m128i t1 = _mm_unpacklo_epi32(_mm_loadu_si128((const __m128i *)&rs[i + 2]), _mm_loadu_si128((const __m128i *)&rs[i + 3]));
+        __m128i t2 = _mm_unpackhi_epi32(_mm_loadu_si128((const __m128i *)&rs[i]), _mm_loadu_si128((const __m128i *)&rs[i + 1]));
+        __m128i t3 = _mm_unpackhi_epi32(_mm_loadu_si128((const __m128i *)&rs[i + 2]), _mm_loadu_si128((const __m128i *)&rs[i + 3]));
+        __m128i bx = _mm_unpacklo_epi64(t0, t1), by = _mm_unpackhi_epi64(t0, t1);
+        __m128i bw = _mm_unpacklo_epi64(t2, t3), bh = _mm_unpackhi_epi64(t2, t3);
+        __m128i br = _mm_add_epi32(bx, bw), bb = _mm_add_epi32(by, bh);
+        __m128i hit = _mm_and_si128(_mm_cmpgt_epi32(bw, zero), _mm_cmpgt_epi32(bh, zero));
+        __m128i p0 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&ps[i]), _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i p1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&ps[i + 2]), _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i px = _mm_unpacklo_epi64(p0, p1), py = _mm_unpackhi_epi64(p0, p1);
+        __m128i outside, inside;
+
+        hit = _mm_and_si128(hit, _mm_and_si128(_mm_cmpgt_epi32(ar, bx), _mm_cmpgt_epi32(br, ax)));
+        hit = _mm_and_si128(hit, _mm_and_si128(_mm_cmpgt_epi32(ab, by), _mm_cmpgt_epi32(bb, ay)));
+        rect_mask[i >> 5] |= (Uint32)_mm_movemask_ps(_mm_castsi128_ps(hit)) << (i & 31);
+
+        outside = _mm_or_si128(_mm_cmpgt_epi32(ax, px), _mm_cmpgt_epi32(ay, py));
+        inside = _mm_and_si128(_mm_cmpgt_epi32(ar, px), _mm_cmpgt_epi32(ab, py));
+        point_mask[i >> 5] |= (Uint32)_mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(outside, inside))) << (i & 31);
+    }
+    for (; i < count; ++i) {
+        if (SDL_HasIntersection(query, &rs[i])) {
+            rect_mask[i >> 5] |= 1u << (i & 31);
+        }
+        if (SDL_PointInRect(&ps[i], query)) {
+            point_mask[i >> 5] |= 1u << (i & 31);
+        }
+    }
+}
+#endif
+
+static int
+RunBenchmark(int count)
+{
+    int words = (count + 31) / 32;
+    SDL_Rect *rs = (SDL_Rect *)SDL_malloc(count * sizeof(SDL_Rect));
+    SDL_Point *ps = (SDL_Point *)SDL_malloc(count * sizeof(SDL_Point));
+    Uint32 *masks = (Uint32 *)SDL_malloc(4 * words * sizeof(Uint32));
+    SDL_Rect query = { 200, 150, 400, 300 };
+    Uint64 start, scalar_ticks, batch_ticks;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    int i, pass;
+
+    if (!rs || !ps || !masks) {
+        SDL_free(rs);
+        SDL_free(ps);
+        SDL_free(masks);
+        SDL_Log("Out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < count; ++i) {
+        rs[i].x = rand() % 800;
+        rs[i].y = rand() % 600;
+        rs[i].w = rand() % 64;
+        rs[i].h = rand() % 64;
+        ps[i].x = rand() % 800;
+        ps[i].y = rand() % 600;
+    }
+
+    start = SDL_GetPerformanceCounter();
+    for (pass = 0; pass < BENCH_PASSES; ++pass) {
+        query.x = 200 + pass;
+        BuildScalarMasks(&query, rs, ps, count, masks, masks + words);
+    }
+    scalar_ticks = SDL_GetPerformanceCounter() - start;
+    SDL_Log("scalar: %.2f ns per rect+point test\n", scalar_ticks * 1e9 / freq / ((double)count * BENCH_PASSES));
+
+#ifdef HAVE_BATCH_SSE2
+    start = SDL_GetPerformanceCounter();
+    for (pass = 0; pass < BENCH_PASSES; ++pass) {
+        query.x = 200 + pass;
+        BuildBatchMasks(&query, rs, ps, count, masks + 2 * words, masks + 3 * words);
+    }
+    batch_ticks = SDL_GetPerformanceCounter() - start;
+    SDL_Log("sse2 batch: %.2f ns per rect+point test, %.1fx\n",
+            batch_ticks * 1e9 / freq / ((double)count * BENCH_PASSES),
+            batch_ticks ? (double)scalar_ticks / batch_ticks : 0.0);
+    if (SDL_memcmp(masks, masks + 2 * words, 2 * words * sizeof(Uint32)) != 0) {
+        SDL_Log("Batch results differ from SDL_HasIntersection/SDL_PointInRect!\n");
+    }
+#else
+    (void)batch_ticks;
+    SDL_Log("No SSE2 on this target, batch variant skipped\n");
+#endif
+
+    SDL_free(rs);
+    SDL_free(ps);
+    SDL_free(masks);
+    return 0;
+}
+
 void loop()
 {
     int i;
@@ -279,6 +419,7 @@ void loop()
 int main(int argc, char *argv[])
 {
     int i;
+    int benchmark = 0;
     Uint32 then, now, frames;
 
     /* Enable standard application logging */
@@ -320,18 +461,28 @@ int main(int argc, char *argv[])
             } else if (SDL_strcasecmp(argv[i], "--cyclealpha") == 0) {
                 cycle_alpha = SDL_TRUE;
                 consumed = 1;
+            } else if (SDL_strcasecmp(argv[i], "--benchmark") == 0 && argv[i + 1] && SDL_isdigit(*argv[i + 1])) {
+                benchmark = SDL_atoi(argv[i + 1]);
+                consumed = 2;
             } else if (SDL_isdigit(*argv[i])) {
                 num_objects = SDL_atoi(argv[i]);
                 consumed = 1;
             }
         }
         if (consumed < 0) {
-            static const char *options[] = { "[--blend none|blend|add|mod]", "[--cyclecolor]", "[--cyclealpha]", NULL };
+            static const char *options[] = { "[--blend none|blend|add|mod]", "[--cyclecolor]", "[--cyclealpha]", "[--benchmark N]", NULL };
             SDLTest_CommonLogUsage(state, argv[0], options);
             return 1;
         }
         i += consumed;
     }
+    if (benchmark > 0) {
+        /* No window needed: time the rect tests and quit */
+        srand(1);
+        i = RunBenchmark(benchmark);
+        SDLTest_CommonQuit(state);
+        return i;
+    }
     if (!SDLTest_CommonInit(state)) {
         return 2;
     }
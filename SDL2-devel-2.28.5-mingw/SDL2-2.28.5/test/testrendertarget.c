@@ -37,6 +37,100 @@ typedef struct
 DrawState *drawstates;
 int done;
 SDL_bool test_composite = SDL_FALSE;
+SDL_bool use_pool = SDL_FALSE;
+
+/* Render targets kept between frames with --pool, so a frame's target is
+   reused instead of allocated; a target unused for MAX_IDLE_FRAMES frames
+   is freed. */
+#define MAX_POOLED_TARGETS 8
+#define MAX_IDLE_FRAMES    60
+
+typedef struct
+{
+    SDL_Texture *texture;
+    SDL_Renderer *renderer;
+    Uint32 format;
+    int w, h;
+    SDL_bool in_use;
+    int last_use;
+} PooledTarget;
+
+static PooledTarget pool[MAX_POOLED_TARGETS];
+static int pool_frame = 0;
+static int targets_created = 0;
+static int targets_reused = 0;
+
+static SDL_Texture *
+AcquireTarget(SDL_Renderer *renderer, Uint32 format, int w, int h)
+{
+    SDL_Texture *texture;
+    int i;
+
+    if (use_pool) {
+        for (i = 0; i < MAX_POOLED_TARGETS; ++i) {
+            PooledTarget *target = &pool[i];
+            if (target->texture && !target->in_use && target->renderer == renderer &&
+                target->format == format && target->w == w && target->h == h) {
+                SDL_SetTextureBlendMode(target->texture, SDL_BLENDMODE_NONE);
+                target->in_use = SDL_TRUE;
+                ++targets_reused;
+                return target->texture;
+            }
+        }
+    }
+
+    texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_TARGET, w, h);
+    if (texture == NULL) {
+        return NULL;
+    }
+    ++targets_created;
+    if (use_pool) {
+        for (i = 0; i < MAX_POOLED_TARGETS; ++i) {
+            PooledTarget *target = &pool[i];
+            if (!target->texture) {
+                target->texture = texture;
+                target->renderer = renderer;
+                target->format = format;
+                target->w = w;
+                target->h = h;
+                target->in_use = SDL_TRUE;
+                break;
+            }
+        }
+    }
+    return texture;
+}
+
+static void
+ReleaseTarget(SDL_Texture *texture)
+{
+    int i;
+
+    for (i = 0; i < MAX_POOLED_TARGETS; ++i) {
+        if (pool[i].texture == texture) {
+            pool[i].in_use = SDL_FALSE;
+            pool[i].last_use = pool_frame;
+            return;
+        }
+    }
+    /* Not pooled: no --pool, or the pool was full */
+    SDL_DestroyTexture(texture);
+}
+
+static void
+PoolFrameEnd(void)
+{
+    int i;
+
+    ++pool_frame;
+    for (i = 0; i < MAX_POOLED_TARGETS; ++i) {
+        PooledTarget *target = &pool[i];
+        if (target->texture && !target->in_use && pool_frame - target->last_use > MAX_IDLE_FRAMES) {
+            SDL_DestroyTexture(target->texture);
+            SDL_zerop(target);
+        }
+    }
+}
 
 /* Call this instead of exit(), so we can clean up SDL: atexit() is evil. */
 static void
@@ -82,7 +176,7 @@ DrawComposite(DrawState *s)
 
     SDL_RenderGetViewport(s->renderer, &viewport);
 
-    target = SDL_CreateTexture(s->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, viewport.w, viewport.h);
+    target = AcquireTarget(s->renderer, SDL_PIXELFORMAT_ARGB8888, viewport.w, viewport.h);
     SDL_SetTextureBlendMode(target, SDL_BLENDMODE_BLEND);
     SDL_SetRenderTarget(s->renderer, target);
 
@@ -122,7 +216,7 @@ DrawComposite(DrawState *s)
     SDL_SetRenderDrawBlendMode(s->renderer, SDL_BLENDMODE_NONE);
 
     SDL_RenderCopy(s->renderer, target, NULL, NULL);
-    SDL_DestroyTexture(target);
+    ReleaseTarget(target);
 
     /* Update the screen! */
     SDL_RenderPresent(s->renderer);
@@ -137,7 +231,7 @@ Draw(DrawState *s)
 
     SDL_RenderGetViewport(s->renderer, &viewport);
 
-    target = SDL_CreateTexture(s->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, viewport.w, viewport.h);
+    target = AcquireTarget(s->renderer, SDL_PIXELFORMAT_ARGB8888, viewport.w, viewport.h);
     if (target == NULL) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create render target texture: %s\n", SDL_GetError());
         return SDL_FALSE;
@@ -166,7 +260,7 @@ Draw(DrawState *s)
 
     SDL_SetRenderTarget(s->renderer, NULL);
     SDL_RenderCopy(s->renderer, target, NULL, NULL);
-    SDL_DestroyTexture(target);
+    ReleaseTarget(target);
 
     /* Update the screen! */
     SDL_RenderPresent(s->renderer);
@@ -196,6 +290,7 @@ void loop()
             }
         }
     }
+    PoolFrameEnd();
 #ifdef __EMSCRIPTEN__
     if (done) {
         emscripten_cancel_main_loop();
@@ -226,10 +321,13 @@ int main(int argc, char *argv[])
             if (SDL_strcasecmp(argv[i], "--composite") == 0) {
                 test_composite = SDL_TRUE;
                 consumed = 1;
+            } else if (SDL_strcasecmp(argv[i], "--pool") == 0) {
+                use_pool = SDL_TRUE;
+                consumed = 1;
             }
         }
         if (consumed < 0) {
-            static const char *options[] = { "[--composite]", NULL };
+            static const char *options[] = { "[--composite]", "[--pool]", NULL };
             SDLTest_CommonLogUsage(state, argv[0], options);
             quit(1);
         }
@@ -279,7 +377,13 @@ int main(int argc, char *argv[])
         double fps = ((double)frames * 1000) / (now - then);
         SDL_Log("%2.2f frames per second\n", fps);
     }
+    SDL_Log("%d render targets created, %d reused\n", targets_created, targets_reused);
 
+    for (i = 0; i < MAX_POOLED_TARGETS; ++i) {
+        if (pool[i].texture) {
+            SDL_DestroyTexture(pool[i].texture);
+        }
+    }
     SDL_stack_free(drawstates);
 
     quit(0);
@@ -46,6 +46,13 @@ static int use_rendergeometry = 0;
 /* -1: infinite random moves (default); >=0: enables N deterministic moves */
 static int iterations = -1;
 
+/* --benchmark: sweep sprite counts, submission paths and render drivers */
+static SDL_bool benchmark = SDL_FALSE;
+static int benchmark_frames = 60;
+static int benchmark_max_sprites = 1000000;
+static const Uint32 benchmark_time_limit = 3000;
+static SDL_bool benchmark_batching = SDL_TRUE;
+
 int done;
 
 /* Call this instead of exit(), so we can clean up SDL: atexit() is evil. */
@@ -426,6 +433,329 @@ void loop()
     }
 }
 
+typedef enum
+{
+    BENCH_RENDERCOPY,
+    BENCH_RENDERCOPYF,
+    BENCH_RENDERGEOMETRY,
+    BENCH_RENDERGEOMETRYRAW,
+    BENCH_NUM_PATHS
+} BenchPath;
+
+static const char *bench_path_names[BENCH_NUM_PATHS] = {
+    "RenderCopy", "RenderCopyF", "RenderGeometry", "RenderGeometryRaw"
+};
+
+typedef struct
+{
+    SDL_FRect *positions;
+    SDL_FPoint *velocities;
+    SDL_Vertex *verts;
+    float *xy;
+    float *uv;
+    SDL_Color *colors;
+    int *indices;
+} BenchBuffers;
+
+static void
+FreeBenchBuffers(BenchBuffers *buffers)
+{
+    SDL_free(buffers->positions);
+    SDL_free(buffers->velocities);
+    SDL_free(buffers->verts);
+    SDL_free(buffers->xy);
+    SDL_free(buffers->uv);
+    SDL_free(buffers->colors);
+    SDL_free(buffers->indices);
+    SDL_zerop(buffers);
+}
+
+static int
+AllocBenchBuffers(BenchBuffers *buffers, int count)
+{
+    int i;
+
+    SDL_zerop(buffers);
+    buffers->positions = (SDL_FRect *)SDL_malloc(count * sizeof(SDL_FRect));
+    buffers->velocities = (SDL_FPoint *)SDL_malloc(count * sizeof(SDL_FPoint));
+    buffers->verts = (SDL_Vertex *)SDL_malloc(count * 4 * sizeof(SDL_Vertex));
+    buffers->xy = (float *)SDL_malloc(count * 4 * 2 * sizeof(float));
+    buffers->uv = (float *)SDL_malloc(count * 4 * 2 * sizeof(float));
+    buffers->colors = (SDL_Color *)SDL_malloc(count * 4 * sizeof(SDL_Color));
+    buffers->indices = (int *)SDL_malloc(count * 6 * sizeof(int));
+    if (!buffers->positions || !buffers->velocities || !buffers->verts || !buffers->xy ||
+        !buffers->uv || !buffers->colors || !buffers->indices) {
+        FreeBenchBuffers(buffers);
+        return -1;
+    }
+
+    /* Quads share two vertices between their triangles:
+     *   0--1
+     *   | /|
+     *   |/ |
+     *   3--2
+     * The indices and texture coordinates never change, so fill them once.
+     */
+    for (i = 0; i < count; ++i) {
+        int *index = &buffers->indices[i * 6];
+        float *uv = &buffers->uv[i * 8];
+        const int base = i * 4;
+
+        index[0] = base + 0;
+        index[1] = base + 1;
+        index[2] = base + 2;
+        index[3] = base + 0;
+        index[4] = base + 2;
+        index[5] = base + 3;
+        uv[0] = 0.0f, uv[1] = 0.0f;
+        uv[2] = 1.0f, uv[3] = 0.0f;
+        uv[4] = 1.0f, uv[5] = 1.0f;
+        uv[6] = 0.0f, uv[7] = 1.0f;
+    }
+    return 0;
+}
+
+static void
+ResetBenchSprites(BenchBuffers *buffers, int count, int w, int h)
+{
+    int i;
+
+    /* Same seed for every driver and path so each run draws the same scene */
+    SDLTest_FuzzerInit(count);
+    for (i = 0; i < count; ++i) {
+        SDL_FRect *position = &buffers->positions[i];
+        SDL_FPoint *velocity = &buffers->velocities[i];
+
+        position->x = (float)SDLTest_RandomIntegerInRange(0, w - sprite_w);
+        position->y = (float)SDLTest_RandomIntegerInRange(0, h - sprite_h);
+        position->w = (float)sprite_w;
+        position->h = (float)sprite_h;
+        velocity->x = 0.0f;
+        velocity->y = 0.0f;
+        while (velocity->x == 0.0f && velocity->y == 0.0f) {
+            velocity->x = (float)SDLTest_RandomIntegerInRange(-MAX_SPEED, MAX_SPEED);
+            velocity->y = (float)SDLTest_RandomIntegerInRange(-MAX_SPEED, MAX_SPEED);
+        }
+    }
+}
+
+/* Moves and submits every sprite once, returns the number of draw calls */
+static int
+SubmitBenchFrame(SDL_Renderer *renderer, SDL_Texture *sprite, BenchPath path,
+                 BenchBuffers *buffers, int count, int w, int h)
+{
+    int i, calls = 0;
+    SDL_Color color = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+    for (i = 0; i < count; ++i) {
+        SDL_FRect *position = &buffers->positions[i];
+        SDL_FPoint *velocity = &buffers->velocities[i];
+
+        position->x += velocity->x;
+        if (position->x < 0.0f || position->x >= (float)(w - sprite_w)) {
+            velocity->x = -velocity->x;
+            position->x += velocity->x;
+        }
+        position->y += velocity->y;
+        if (position->y < 0.0f || position->y >= (float)(h - sprite_h)) {
+            velocity->y = -velocity->y;
+            position->y += velocity->y;
+        }
+    }
+
+    SDL_SetRenderDrawColor(renderer, 0xA0, 0xA0, 0xA0, 0xFF);
+    SDL_RenderClear(renderer);
+
+    switch (path) {
+    case BENCH_RENDERCOPY:
+        for (i = 0; i < count; ++i) {
+            const SDL_FRect *position = &buffers->positions[i];
+            SDL_Rect rect;
+
+            rect.x = (int)position->x;
+            rect.y = (int)position->y;
+            rect.w = sprite_w;
+            rect.h = sprite_h;
+            SDL_RenderCopy(renderer, sprite, NULL, &rect);
+        }
+        calls = count;
+        break;
+    case BENCH_RENDERCOPYF:
+        for (i = 0; i < count; ++i) {
+            SDL_RenderCopyF(renderer, sprite, NULL, &buffers->positions[i]);
+        }
+        calls = count;
+        break;
+    case BENCH_RENDERGEOMETRY:
+        for (i = 0; i < count; ++i) {
+            const SDL_FRect *position = &buffers->positions[i];
+            const float *uv = &buffers->uv[i * 8];
+            SDL_Vertex *verts = &buffers->verts[i * 4];
+
+            verts[0].position.x = position->x;
+            verts[0].position.y = position->y;
+            verts[1].position.x = position->x + position->w;
+            verts[1].position.y = position->y;
+            verts[2].position.x = position->x + position->w;
+            verts[2].position.y = position->y + position->h;
+            verts[3].position.x = position->x;
+            verts[3].position.y = position->y + position->h;
+            verts[0].color = verts[1].color = verts[2].color = verts[3].color = color;
+            verts[0].tex_coord.x = uv[0], verts[0].tex_coord.y = uv[1];
+            verts[1].tex_coord.x = uv[2], verts[1].tex_coord.y = uv[3];
+            verts[2].tex_coord.x = uv[4], verts[2].tex_coord.y = uv[5];
+            verts[3].tex_coord.x = uv[6], verts[3].tex_coord.y = uv[7];
+        }
+        SDL_RenderGeometry(renderer, sprite, buffers->verts, count * 4, buffers->indices, count * 6);
+        calls = 1;
+        break;
+    case BENCH_RENDERGEOMETRYRAW:
+        for (i = 0; i < count; ++i) {
+            const SDL_FRect *position = &buffers->positions[i];
+            float *xy = &buffers->xy[i * 8];
+            SDL_Color *colors = &buffers->colors[i * 4];
+
+            xy[0] = position->x, xy[1] = position->y;
+            xy[2] = position->x + position->w, xy[3] = position->y;
+            xy[4] = position->x + position->w, xy[5] = position->y + position->h;
+            xy[6] = position->x, xy[7] = position->y + position->h;
+            colors[0] = colors[1] = colors[2] = colors[3] = color;
+        }
+        SDL_RenderGeometryRaw(renderer, sprite,
+                              buffers->xy, 2 * sizeof(float),
+                              buffers->colors, sizeof(SDL_Color),
+                              buffers->uv, 2 * sizeof(float),
+                              count * 4, buffers->indices, count * 6, sizeof(int));
+        calls = 1;
+        break;
+    default:
+        break;
+    }
+    return calls + 1; /* the clear */
+}
+
+static void
+BenchmarkRenderer(int driver, const char *icon, BenchBuffers *buffers, SDL_bool *first)
+{
+    SDL_RendererInfo info;
+    SDL_Window *window;
+    SDL_Renderer *renderer;
+    SDL_Texture *sprite;
+    int w, h, count, path;
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+
+    if (SDL_GetRenderDriverInfo(driver, &info) < 0) {
+        return;
+    }
+    /* A fresh window per driver, since OpenGL and Direct3D can't share one */
+    window = SDL_CreateWindow("testsprite2 benchmark", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                              state->window_w, state->window_h, 0);
+    if (!window) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create window: %s\n", SDL_GetError());
+        return;
+    }
+    /* No SDL_RENDERER_PRESENTVSYNC: we want the submission cost, not the refresh rate */
+    renderer = SDL_CreateRenderer(window, driver, 0);
+    if (!renderer) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create %s renderer: %s\n", info.name, SDL_GetError());
+        SDL_DestroyWindow(window);
+        return;
+    }
+    sprite = LoadTexture(renderer, icon, SDL_TRUE, &sprite_w, &sprite_h);
+    if (!sprite) {
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        return;
+    }
+    SDL_SetTextureBlendMode(sprite, blendMode);
+    SDL_GetRendererOutputSize(renderer, &w, &h);
+
+    for (count = 1000; count <= benchmark_max_sprites; count *= 10) {
+        for (path = 0; path < BENCH_NUM_PATHS; ++path) {
+            Uint64 submit = 0, start, before, after;
+            Uint32 deadline;
+            int frame, calls = 0;
+            SDL_Event event;
+
+            ResetBenchSprites(buffers, count, w, h);
+
+            /* One untimed frame to upload the texture and grow the command queue */
+            SubmitBenchFrame(renderer, sprite, (BenchPath)path, buffers, count, w, h);
+            SDL_RenderPresent(renderer);
+
+            deadline = SDL_GetTicks() + benchmark_time_limit;
+            start = SDL_GetPerformanceCounter();
+            for (frame = 0; frame < benchmark_frames; ) {
+                while (SDL_PollEvent(&event)) {
+                    /* keep the window responsive */
+                }
+                before = SDL_GetPerformanceCounter();
+                calls = SubmitBenchFrame(renderer, sprite, (BenchPath)path, buffers, count, w, h);
+                after = SDL_GetPerformanceCounter();
+                submit += after - before;
+                SDL_RenderPresent(renderer);
+                ++frame;
+
+                /* Slow combinations (a million software RenderCopy calls) stop early */
+                if (SDL_TICKS_PASSED(SDL_GetTicks(), deadline)) {
+                    break;
+                }
+            }
+            {
+                const double seconds = (double)(SDL_GetPerformanceCounter() - start) / frequency;
+                const double cpu_ms = (double)submit * 1000.0 / frequency / frame;
+
+                printf("%s\n  {\"renderer\": \"%s\", \"path\": \"%s\", \"sprites\": %d, \"frames\": %d, "
+                       "\"fps\": %.2f, \"cpu_ms_per_frame\": %.3f, \"frame_ms\": %.3f, \"draw_calls\": %d, "
+                       "\"batching\": %s}",
+                       *first ? "" : ",", info.name, bench_path_names[path], count, frame,
+                       frame / seconds, cpu_ms, seconds * 1000.0 / frame, calls,
+                       benchmark_batching ? "true" : "false");
+                fflush(stdout);
+                *first = SDL_FALSE;
+            }
+        }
+    }
+
+    SDL_DestroyTexture(sprite);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+}
+
+/* Writes a JSON array with one object per driver, path and sprite count */
+static int
+RunBenchmark(const char *icon)
+{
+    BenchBuffers buffers;
+    SDL_bool first = SDL_TRUE;
+    int driver;
+
+    /* SDL turns batching off for a renderer picked by index, as every one is
+     * here, in case the app goes on to use the graphics API itself. That
+     * would measure Metal and Direct3D 12 a draw at a time while the same
+     * renderer created with index -1 batches, so ask for it explicitly.
+     * --benchmark-unbatched measures the unbatched behavior on purpose.
+     */
+    SDL_SetHint(SDL_HINT_RENDER_BATCHING, benchmark_batching ? "1" : "0");
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 2;
+    }
+    if (AllocBenchBuffers(&buffers, benchmark_max_sprites) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Out of memory!\n");
+        return 2;
+    }
+
+    printf("[");
+    for (driver = 0; driver < SDL_GetNumRenderDrivers(); ++driver) {
+        BenchmarkRenderer(driver, icon, &buffers, &first);
+    }
+    printf("\n]\n");
+
+    FreeBenchBuffers(&buffers);
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     int i;
@@ -474,6 +804,22 @@ int main(int argc, char *argv[])
                     }
                     consumed = 2;
                 }
+            } else if (SDL_strcasecmp(argv[i], "--benchmark") == 0) {
+                benchmark = SDL_TRUE;
+                consumed = 1;
+            } else if (SDL_strcasecmp(argv[i], "--benchmark-frames") == 0) {
+                if (argv[i + 1]) {
+                    benchmark_frames = SDL_max(1, SDL_atoi(argv[i + 1]));
+                    consumed = 2;
+                }
+            } else if (SDL_strcasecmp(argv[i], "--benchmark-max") == 0) {
+                if (argv[i + 1]) {
+                    benchmark_max_sprites = SDL_max(1000, SDL_atoi(argv[i + 1]));
+                    consumed = 2;
+                }
+            } else if (SDL_strcasecmp(argv[i], "--benchmark-unbatched") == 0) {
+                benchmark_batching = SDL_FALSE;
+                consumed = 1;
             } else if (SDL_strcasecmp(argv[i], "--cyclecolor") == 0) {
                 cycle_color = SDL_TRUE;
                 consumed = 1;
@@ -509,6 +855,7 @@ int main(int argc, char *argv[])
                 "[--cyclealpha]",
                 "[--iterations N]",
                 "[--use-rendergeometry mode1|mode2]",
+                "[--benchmark [--benchmark-frames N] [--benchmark-max N] [--benchmark-unbatched]]",
                 "[num_sprites]",
                 "[icon.bmp]",
                 NULL
@@ -518,6 +865,12 @@ int main(int argc, char *argv[])
         }
         i += consumed;
     }
+    if (benchmark) {
+        /* Drives its own windows, one per render driver */
+        const int rc = RunBenchmark(icon);
+        quit(rc);
+        return rc;
+    }
     if (!SDLTest_CommonInit(state)) {
         quit(2);
     }
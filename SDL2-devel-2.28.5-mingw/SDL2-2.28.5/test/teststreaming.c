@@ -59,11 +59,29 @@ SDL_Color MooseColors[84] = {
 
 Uint8 MooseFrames[MOOSEFRAMES_COUNT][MOOSEFRAME_SIZE];
 
+/* Streaming textures are written round-robin. With more than one, the
+ * texture being locked is never the one the GPU may still be reading: SDL
+ * has no fences, so a texture is only reused once (ring size - 1) newer
+ * frames have been presented after it was last drawn. */
+#define MAX_RING 8
+
 SDL_Renderer *renderer;
 int frame;
-SDL_Texture *MooseTexture;
+SDL_Texture *MooseTextures[MAX_RING];
+Sint64 SubmittedFrame[MAX_RING];
+int RingSize = 1;
+int RingCurrent = 0;
+Uint64 PresentedFrames = 0;
+int TextureW = MOOSEPIC_W;
+int TextureH = MOOSEPIC_H;
 SDL_bool done = SDL_FALSE;
 
+/* --benchmark: upload large frames without vsync and report throughput */
+int BenchmarkFrames = 0;
+Uint64 UploadedBytes = 0;
+Uint64 UploadTicks = 0;
+int SkippedUploads = 0;
+
 void quit(int rc)
 {
     SDL_Quit();
@@ -78,25 +96,47 @@ void UpdateTexture(SDL_Texture *texture)
     int row, col;
     void *pixels;
     int pitch;
+    Uint64 start = SDL_GetPerformanceCounter();
 
     if (SDL_LockTexture(texture, NULL, &pixels, &pitch) < 0) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't lock texture: %s\n", SDL_GetError());
         quit(5);
     }
-    src = MooseFrames[frame];
-    for (row = 0; row < MOOSEPIC_H; ++row) {
+    for (row = 0; row < TextureH; ++row) {
+        src = MooseFrames[frame] + (row * MOOSEPIC_H / TextureH) * MOOSEPIC_W;
         dst = (Uint32 *)((Uint8 *)pixels + row * pitch);
-        for (col = 0; col < MOOSEPIC_W; ++col) {
-            color = &MooseColors[*src++];
+        for (col = 0; col < TextureW; ++col) {
+            color = &MooseColors[src[col * MOOSEPIC_W / TextureW]];
             *dst++ = (0xFF000000 | (color->r << 16) | (color->g << 8) | color->b);
         }
     }
     SDL_UnlockTexture(texture);
+
+    UploadTicks += SDL_GetPerformanceCounter() - start;
+    UploadedBytes += (Uint64)TextureW * TextureH * 4;
+}
+
+/* Pick the next texture that no queued frame can still be reading, or -1 */
+int NextRingTexture(void)
+{
+    int i;
+
+    if (RingSize == 1) {
+        return 0;
+    }
+    for (i = 1; i <= RingSize; ++i) {
+        int slot = (RingCurrent + i) % RingSize;
+        if (slot != RingCurrent && (Sint64)PresentedFrames >= SubmittedFrame[slot] + RingSize - 1) {
+            return slot;
+        }
+    }
+    return -1;
 }
 
 void loop()
 {
     SDL_Event event;
+    int slot;
 
     while (SDL_PollEvent(&event)) {
         switch (event.type) {
@@ -112,11 +152,27 @@ void loop()
     }
 
     frame = (frame + 1) % MOOSEFRAMES_COUNT;
-    UpdateTexture(MooseTexture);
+    slot = NextRingTexture();
+    if (slot >= 0) {
+        UpdateTexture(MooseTextures[slot]);
+        RingCurrent = slot;
+    } else {
+        ++SkippedUploads;
+    }
 
     SDL_RenderClear(renderer);
-    SDL_RenderCopy(renderer, MooseTexture, NULL, NULL);
+    SDL_RenderCopy(renderer, MooseTextures[RingCurrent], NULL, NULL);
+    SubmittedFrame[RingCurrent] = (Sint64)PresentedFrames;
     SDL_RenderPresent(renderer);
+    ++PresentedFrames;
+
+    if (BenchmarkFrames > 0 && PresentedFrames >= (Uint64)BenchmarkFrames) {
+        double seconds = (double)UploadTicks / SDL_GetPerformanceFrequency();
+        SDL_Log("%dx%d, ring of %d: %" SDL_PRIu64 " frames, %.1f MB uploaded at %.1f MB/s, %d uploads skipped\n",
+                TextureW, TextureH, RingSize, PresentedFrames, UploadedBytes / (1024.0 * 1024.0),
+                seconds > 0.0 ? UploadedBytes / (1024.0 * 1024.0) / seconds : 0.0, SkippedUploads);
+        done = SDL_TRUE;
+    }
 
 #ifdef __EMSCRIPTEN__
     if (done) {
@@ -130,10 +186,24 @@ int main(int argc, char **argv)
     SDL_Window *window;
     SDL_RWops *handle;
     char *filename = NULL;
+    int i;
 
     /* Enable standard application logging */
     SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO);
 
+    for (i = 1; i < argc; ++i) {
+        if (SDL_strcmp(argv[i], "--ring") == 0 && i + 1 < argc) {
+            RingSize = SDL_clamp(SDL_atoi(argv[++i]), 1, MAX_RING);
+        } else if (SDL_strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) {
+            BenchmarkFrames = SDL_max(SDL_atoi(argv[++i]), 1);
+            TextureW = 1920;
+            TextureH = 1080;
+        } else {
+            SDL_Log("Usage: %s [--ring N] [--benchmark FRAMES]\n", argv[0]);
+            return 1;
+        }
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't initialize SDL: %s\n", SDL_GetError());
         return 1;
@@ -171,10 +241,13 @@ int main(int argc, char **argv)
         quit(4);
     }
 
-    MooseTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, MOOSEPIC_W, MOOSEPIC_H);
-    if (MooseTexture == NULL) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't set create texture: %s\n", SDL_GetError());
-        quit(5);
+    for (i = 0; i < RingSize; ++i) {
+        MooseTextures[i] = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, TextureW, TextureH);
+        if (MooseTextures[i] == NULL) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't set create texture: %s\n", SDL_GetError());
+            quit(5);
+        }
+        SubmittedFrame[i] = -MAX_RING; /* never drawn */
     }
 
     /* Loop, waiting for QUIT or the escape key */
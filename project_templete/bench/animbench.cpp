@@ -0,0 +1,150 @@
+// Description:
+// Sprite animation check and benchmark. Adds an animation laid out the way
+// IMG_LoadAnimation returns a GIF that repeats frames (A B A A B C, with
+// C the same size as A but different pixels) and checks the repeats point
+// at the first frame with their pixels, only the three distinct frames go
+// to the atlas builder and, after a build on a software renderer, the
+// repeats resolve to their source's rect. Then times
+// spriteAnimatorsAdvance over 100000 looping animators, as nanoseconds per
+// animator per frame.
+//
+// Build and run from project_templete/:
+//     make animbench && ./animbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <cstdio>
+#include <vector>
+
+#include "sprite_animation.h"
+
+namespace
+{
+     const int FRAME_SIZE = 16;
+     const int BENCH_ANIMATORS = 100000;
+     const int BENCH_FRAMES = 200;
+
+     SDL_Surface *solidFrame(Uint32 color, bool marked)
+     {
+          SDL_Surface *frame = SDL_CreateRGBSurfaceWithFormat(0, FRAME_SIZE, FRAME_SIZE, 32, SDL_PIXELFORMAT_RGBA32);
+          if (frame != nullptr)
+          {
+               SDL_FillRect(frame, NULL, color);
+               if (marked)
+               {
+                    // Same size and mostly the same colour, one texel off
+                    ((Uint32 *)frame->pixels)[FRAME_SIZE + 3] ^= 0xff;
+               }
+          }
+          return frame;
+     }
+
+     // A B A A B C, every repeat a surface of its own as in a decoded GIF
+     IMG_Animation *repeatingAnimation()
+     {
+          const int count = 6;
+          IMG_Animation *animation = (IMG_Animation *)SDL_calloc(1, sizeof(IMG_Animation));
+          animation->w = FRAME_SIZE;
+          animation->h = FRAME_SIZE;
+          animation->count = count;
+          animation->frames = (SDL_Surface **)SDL_calloc(count, sizeof(SDL_Surface *));
+          animation->delays = (int *)SDL_calloc(count, sizeof(int));
+          const Uint32 colors[count] = {0xff0000ff, 0xff00ff00, 0xff0000ff, 0xff0000ff, 0xff00ff00, 0xff0000ff};
+          for (int i = 0; i < count; i++)
+          {
+               animation->frames[i] = solidFrame(colors[i], i == count - 1);
+               animation->delays[i] = 50;
+          }
+          return animation;
+     }
+
+     bool check()
+     {
+          SpriteAnimationSet set;
+          AtlasBuilder builder;
+          atlasBuilderInit(builder, 256, 1);
+          if (!spriteAnimationAdd(set, builder, "coin", repeatingAnimation()))
+          {
+               std::printf("spriteAnimationAdd failed\n");
+               atlasBuilderDestroy(builder);
+               return false;
+          }
+          const int expected[] = {0, 1, 0, 0, 1, 5};
+          bool good = builder.surfaces.size() == 3 && set.frames.size() == SDL_arraysize(expected);
+          for (int i = 0; good && i < (int)SDL_arraysize(expected); i++)
+          {
+               good = set.frames[i].source == expected[i];
+          }
+          if (!good)
+          {
+               std::printf("repeated frames were not shared: %d frames queued\n", (int)builder.surfaces.size());
+               atlasBuilderDestroy(builder);
+               return false;
+          }
+
+          SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(0, 64, 64, 32, SDL_PIXELFORMAT_RGBA32);
+          SDL_Renderer *renderer = target != nullptr ? SDL_CreateSoftwareRenderer(target) : nullptr;
+          TextureAtlas atlas;
+          good = renderer != nullptr && atlasBuild(builder, renderer, atlas, nullptr) &&
+                 spriteAnimationResolve(set, atlas);
+          for (int i = 0; good && i < (int)SDL_arraysize(expected); i++)
+          {
+               const SDL_Rect &rect = set.frames[i].sprite.src;
+               const SDL_Rect &source = set.frames[expected[i]].sprite.src;
+               good = rect.x == source.x && rect.y == source.y && rect.w == FRAME_SIZE && rect.h == FRAME_SIZE;
+          }
+          good = good && !SDL_RectEquals(&set.frames[0].sprite.src, &set.frames[5].sprite.src);
+          if (!good)
+          {
+               std::printf("atlas build or resolve failed: %s\n", SDL_GetError());
+          }
+          if (renderer != nullptr)
+          {
+               atlasDestroy(atlas);
+               SDL_DestroyRenderer(renderer);
+          }
+          atlasBuilderDestroy(builder);
+          SDL_FreeSurface(target);
+          return good;
+     }
+
+     double nsPerAnimator()
+     {
+          SpriteAnimationSet set;
+          AtlasBuilder builder;
+          atlasBuilderInit(builder, 256, 1);
+          spriteAnimationAdd(set, builder, "coin", repeatingAnimation());
+          atlasBuilderDestroy(builder);
+          std::vector<SpriteAnimator> animators(BENCH_ANIMATORS, spriteAnimatorStart(set, 0));
+          for (int i = 0; i < BENCH_ANIMATORS; i++)
+          {
+               // Spread over the clip so frame changes do not line up
+               spriteAnimatorsAdvance(set, &animators[i], 1, (Uint32)(i % 300));
+          }
+          const Uint64 start = SDL_GetPerformanceCounter();
+          for (int frame = 0; frame < BENCH_FRAMES; frame++)
+          {
+               spriteAnimatorsAdvance(set, animators.data(), BENCH_ANIMATORS, 16);
+          }
+          const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+          return (double)ticks * 1e9 / SDL_GetPerformanceFrequency() / ((double)BENCH_ANIMATORS * BENCH_FRAMES);
+     }
+}
+
+int main(int, char *[])
+{
+     if (SDL_Init(SDL_INIT_VIDEO) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     if (!check())
+     {
+          SDL_Quit();
+          return 2;
+     }
+     std::printf("%-24s %10.2f ns\n", "spriteAnimatorsAdvance", nsPerAnimator());
+     SDL_Quit();
+     return 0;
+}
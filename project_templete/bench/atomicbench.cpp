@@ -0,0 +1,326 @@
+// Description:
+// atomic_ops coverage and timing, what SDL's test/testatomic.c RunEpicTest
+// does for SDL_atomic.h. First every primitive is checked single-threaded
+// for its return values, the 64-bit ones across the 32-bit boundary. Then
+// each is timed, in ns per operation, on one thread and with every CPU
+// hammering the same word, next to the SDL call it replaces; the
+// contended runs also check the final value, so a lost update fails.
+//
+// The double-width CAS gets an ABA stress test: threads push and pop
+// nodes of a shared tagged-pointer stack (a Treiber stack), so the same
+// node comes back to the top constantly. Without the tag the pops corrupt
+// the list; with it every node must still be there at the end.
+//
+// Build and run from project_templete/:
+//     make atomicbench && ./atomicbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <vector>
+
+#include "atomic_ops.h"
+
+namespace
+{
+     const int TIMED_OPERATIONS = 4000000;
+     const int STACK_NODES = 64;
+     const int STACK_ROUNDS = 200000;
+
+     int failures = 0;
+
+     void check(bool ok, const char *what)
+     {
+          if (!ok)
+          {
+               std::printf("FAILED: %s\n", what);
+               failures++;
+          }
+     }
+
+     void checkSingleThreaded()
+     {
+          SDL_atomic_t word;
+          atomicStore(&word, 5, ATOMIC_ORDER_RELEASE);
+          check(atomicLoad(&word, ATOMIC_ORDER_ACQUIRE) == 5, "store then load");
+          check(atomicFetchAdd(&word, 3, ATOMIC_ORDER_RELAXED) == 5, "fetch-add returns the old value");
+          check(atomicExchange(&word, 1, ATOMIC_ORDER_ACQ_REL) == 8, "exchange returns the old value");
+          int expected = 2;
+          check(!atomicCAS(&word, expected, 9, ATOMIC_ORDER_SEQ_CST) && expected == 1, "failed CAS reports current");
+          check(atomicCAS(&word, expected, 9, ATOMIC_ORDER_SEQ_CST) && SDL_AtomicGet(&word) == 9, "CAS swaps");
+
+          Atomic64 wide;
+          atomic64Store(&wide, 0xffffffffLL);
+          check(atomic64FetchAdd(&wide, 1) == 0xffffffffLL && atomic64Load(&wide) == 0x100000000LL,
+                "64-bit add carries past 32 bits");
+          check(atomic64Exchange(&wide, -1) == 0x100000000LL && atomic64Load(&wide) == -1, "64-bit exchange");
+          Sint64 wideExpected = 0;
+          check(!atomic64CAS(&wide, wideExpected, 7) && wideExpected == -1, "64-bit failed CAS reports current");
+          check(atomic64CAS(&wide, wideExpected, 0x123456789LL) && atomic64Load(&wide) == 0x123456789LL,
+                "64-bit CAS swaps");
+
+          int node = 0;
+          AtomicTagged tagged = {nullptr, 0};
+          atomicTaggedStore(&tagged, {&node, 41});
+          AtomicTagged seen = atomicTaggedLoad(&tagged);
+          check(seen.pointer == &node && seen.tag == 41, "tagged store then load");
+          AtomicTagged stale = {&node, 40};
+          check(!atomicTaggedCAS(&tagged, stale, {nullptr, 42}) && stale.tag == 41,
+                "tagged CAS fails on the tag alone");
+          check(atomicTaggedCAS(&tagged, stale, {nullptr, 42}) && atomicTaggedLoad(&tagged).tag == 42,
+                "tagged CAS swaps both words");
+     }
+
+     enum Primitive
+     {
+          SDL_ADD,
+          FETCH_ADD_RELAXED,
+          FETCH_ADD_SEQ_CST,
+          SDL_CAS_LOOP,
+          CAS_LOOP_ACQ_REL,
+          FETCH_ADD_64,
+          CAS_LOOP_64,
+          TAGGED_CAS_LOOP,
+          PRIMITIVE_COUNT
+     };
+
+     const char *PRIMITIVE_NAMES[PRIMITIVE_COUNT] = {"SDL_AtomicAdd",      "fetch-add relaxed", "fetch-add seq_cst",
+                                                     "SDL_AtomicCAS loop", "CAS loop acq_rel",  "64-bit fetch-add",
+                                                     "64-bit CAS loop",    "tagged CAS loop"};
+
+     struct Contended
+     {
+          Primitive primitive;
+          int operations;
+          SDL_atomic_t go;
+          SDL_atomic_t word;
+          char padding[SDL_CACHELINE_SIZE];
+          Atomic64 wide;
+          AtomicTagged tagged;
+     };
+
+     void runPrimitive(Contended &shared)
+     {
+          const int operations = shared.operations;
+          for (int i = 0; i < operations; i++)
+          {
+               switch (shared.primitive)
+               {
+               case SDL_ADD:
+                    SDL_AtomicAdd(&shared.word, 1);
+                    break;
+               case FETCH_ADD_RELAXED:
+                    atomicFetchAdd(&shared.word, 1, ATOMIC_ORDER_RELAXED);
+                    break;
+               case FETCH_ADD_SEQ_CST:
+                    atomicFetchAdd(&shared.word, 1, ATOMIC_ORDER_SEQ_CST);
+                    break;
+               case SDL_CAS_LOOP:
+               {
+                    int value = SDL_AtomicGet(&shared.word);
+                    while (!SDL_AtomicCAS(&shared.word, value, value + 1))
+                    {
+                         value = SDL_AtomicGet(&shared.word);
+                    }
+                    break;
+               }
+               case CAS_LOOP_ACQ_REL:
+               {
+                    int value = atomicLoad(&shared.word, ATOMIC_ORDER_RELAXED);
+                    while (!atomicCAS(&shared.word, value, value + 1, ATOMIC_ORDER_ACQ_REL))
+                    {
+                    }
+                    break;
+               }
+               case FETCH_ADD_64:
+                    atomic64FetchAdd(&shared.wide, 1);
+                    break;
+               case CAS_LOOP_64:
+               {
+                    Sint64 value = atomic64Load(&shared.wide, ATOMIC_ORDER_RELAXED);
+                    while (!atomic64CAS(&shared.wide, value, value + 1))
+                    {
+                    }
+                    break;
+               }
+               case TAGGED_CAS_LOOP:
+               {
+                    AtomicTagged value = atomicTaggedLoad(&shared.tagged);
+                    while (!atomicTaggedCAS(&shared.tagged, value, {value.pointer, value.tag + 1}))
+                    {
+                    }
+                    break;
+               }
+               case PRIMITIVE_COUNT:
+                    break;
+               }
+          }
+     }
+
+     int contendedThread(void *data)
+     {
+          Contended &shared = *(Contended *)data;
+          while (SDL_AtomicGet(&shared.go) == 0)
+          {
+          }
+          runPrimitive(shared);
+          return 0;
+     }
+
+     Sint64 finalValue(Contended &shared)
+     {
+          if (shared.primitive == FETCH_ADD_64 || shared.primitive == CAS_LOOP_64)
+          {
+               return atomic64Load(&shared.wide);
+          }
+          if (shared.primitive == TAGGED_CAS_LOOP)
+          {
+               return (Sint64)atomicTaggedLoad(&shared.tagged).tag;
+          }
+          return SDL_AtomicGet(&shared.word);
+     }
+
+     // ns per operation; *ok is whether no increment went missing
+     double timePrimitive(Primitive primitive, int threadCount, bool *ok)
+     {
+          Contended shared;
+          shared.primitive = primitive;
+          shared.operations = TIMED_OPERATIONS / threadCount;
+          SDL_AtomicSet(&shared.go, 0);
+          SDL_AtomicSet(&shared.word, 0);
+          atomic64Store(&shared.wide, 0);
+          atomicTaggedStore(&shared.tagged, {nullptr, 0});
+
+          std::vector<SDL_Thread *> threads(threadCount - 1);
+          for (SDL_Thread *&thread : threads)
+          {
+               thread = SDL_CreateThread(contendedThread, "atomicbench", &shared);
+          }
+          const Uint64 start = SDL_GetPerformanceCounter();
+          SDL_AtomicSet(&shared.go, 1);
+          runPrimitive(shared);
+          for (SDL_Thread *thread : threads)
+          {
+               SDL_WaitThread(thread, nullptr);
+          }
+          const double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+          *ok = finalValue(shared) == (Sint64)shared.operations * threadCount;
+          return seconds * 1e9 / ((double)shared.operations * threadCount);
+     }
+
+     // The ABA stress test's stack
+     struct StackNode
+     {
+          StackNode *next;
+     };
+
+     struct TaggedStack
+     {
+          AtomicTagged top;
+          SDL_atomic_t go;
+     };
+
+     void stackPush(TaggedStack &stack, StackNode *node)
+     {
+          AtomicTagged top = atomicTaggedLoad(&stack.top);
+          do
+          {
+               node->next = (StackNode *)top.pointer;
+          } while (!atomicTaggedCAS(&stack.top, top, {node, top.tag + 1}));
+     }
+
+     StackNode *stackPop(TaggedStack &stack)
+     {
+          AtomicTagged top = atomicTaggedLoad(&stack.top);
+          while (top.pointer != nullptr)
+          {
+               // `next` may be stale by now; the tag makes the CAS notice
+               StackNode *next = ((StackNode *)top.pointer)->next;
+               if (atomicTaggedCAS(&stack.top, top, {next, top.tag + 1}))
+               {
+                    return (StackNode *)top.pointer;
+               }
+          }
+          return nullptr;
+     }
+
+     int stackThread(void *data)
+     {
+          TaggedStack &stack = *(TaggedStack *)data;
+          while (SDL_AtomicGet(&stack.go) == 0)
+          {
+          }
+          for (int i = 0; i < STACK_ROUNDS; i++)
+          {
+               StackNode *node = stackPop(stack);
+               if (node != nullptr)
+               {
+                    stackPush(stack, node);
+               }
+          }
+          return 0;
+     }
+
+     void checkTaggedStack(int threadCount)
+     {
+          std::vector<StackNode> nodes(STACK_NODES);
+          TaggedStack stack;
+          atomicTaggedStore(&stack.top, {nullptr, 0});
+          SDL_AtomicSet(&stack.go, 0);
+          for (StackNode &node : nodes)
+          {
+               stackPush(stack, &node);
+          }
+
+          std::vector<SDL_Thread *> threads(threadCount);
+          for (SDL_Thread *&thread : threads)
+          {
+               thread = SDL_CreateThread(stackThread, "atomicbench", &stack);
+          }
+          SDL_AtomicSet(&stack.go, 1);
+          for (SDL_Thread *thread : threads)
+          {
+               SDL_WaitThread(thread, nullptr);
+          }
+
+          int count = 0;
+          for (StackNode *node = (StackNode *)atomicTaggedLoad(&stack.top).pointer; node && count <= STACK_NODES;
+               node = node->next)
+          {
+               count++;
+          }
+          check(count == STACK_NODES, "tagged stack kept every node");
+          std::printf("tagged stack: %d threads x %d pop/push, %d of %d nodes left\n", threadCount, STACK_ROUNDS,
+                      count, STACK_NODES);
+     }
+}
+
+int main(int, char *[])
+{
+     if (SDL_Init(SDL_INIT_TIMER) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     const int cpus = SDL_max(2, SDL_GetCPUCount());
+     checkSingleThreaded();
+
+     std::printf("%-20s | %10s %10s\n", "ns/op", "1 thread", "contended");
+     for (int primitive = 0; primitive < PRIMITIVE_COUNT; primitive++)
+     {
+          bool alone = false;
+          bool contended = false;
+          const double single = timePrimitive((Primitive)primitive, 1, &alone);
+          const double shared = timePrimitive((Primitive)primitive, cpus, &contended);
+          std::printf("%-20s | %10.2f %10.2f\n", PRIMITIVE_NAMES[primitive], single, shared);
+          check(alone && contended, PRIMITIVE_NAMES[primitive]);
+     }
+     std::printf("contended: %d threads on one word\n", cpus);
+
+     checkTaggedStack(cpus);
+
+     SDL_Quit();
+     std::printf(failures == 0 ? "all checks passed\n" : "%d checks FAILED\n", failures);
+     return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+// Description:
+// Blit kernel benchmark. Runs every blit_kernels row operation over a
+// 1080p frame with each kernel this CPU supports, checks the output
+// against the scalar kernel, and reports Mpixel/s with the speedup over
+// scalar. SDL_BlitSurface and SDL_FillRect on the same surfaces are
+// timed alongside for reference.
+//
+// Build and run from project_templete/:  make blitbench && ./blitbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "blit_kernels.h"
+
+namespace
+{
+     const int WIDTH = 1920;
+     const int HEIGHT = 1080;
+     const int ITERATIONS = 50;
+     const int PIXELS = WIDTH * HEIGHT;
+
+     enum Operation
+     {
+          OP_SWAP,
+          OP_FROM565,
+          OP_TO565,
+          OP_BLEND,
+          OP_FILL32,
+          OP_FILL16,
+          OP_COUNT
+     };
+
+     const char *OPERATION_NAMES[OP_COUNT] = {"argb->abgr", "565->argb", "argb->565", "blend", "fill32", "fill16"};
+
+     struct Buffers
+     {
+          std::vector<Uint32> src32, dst32, base32;
+          std::vector<Uint16> src16, dst16;
+     };
+
+     void runOperation(const BlitKernelTable &kernels, Operation op, Buffers &buffers)
+     {
+          switch (op)
+          {
+          case OP_SWAP:
+               kernels.swapRedBlue(buffers.src32.data(), buffers.dst32.data(), PIXELS);
+               break;
+          case OP_FROM565:
+               kernels.from565(buffers.src16.data(), buffers.dst32.data(), PIXELS, 16);
+               break;
+          case OP_TO565:
+               kernels.to565(buffers.src32.data(), buffers.dst16.data(), PIXELS, 16);
+               break;
+          case OP_BLEND:
+               kernels.blend(buffers.src32.data(), buffers.dst32.data(), PIXELS);
+               break;
+          case OP_FILL32:
+               kernels.fill32(buffers.dst32.data(), PIXELS, 0x80402010u);
+               break;
+          default:
+               kernels.fill16(buffers.dst16.data(), PIXELS, 0x8410);
+               break;
+          }
+     }
+
+     // One pass from the same starting destination, so blends compare
+     void runOnce(const BlitKernelTable &kernels, Operation op, Buffers &buffers)
+     {
+          buffers.dst32 = buffers.base32;
+          std::fill(buffers.dst16.begin(), buffers.dst16.end(), 0);
+          runOperation(kernels, op, buffers);
+     }
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     double megapixels(double seconds)
+     {
+          return (double)PIXELS * ITERATIONS / SDL_max(1e-9, seconds) / 1e6;
+     }
+
+     // SDL's own blitter on surfaces wrapping the same buffers
+     double timeSdl(Operation op, Buffers &buffers)
+     {
+          SDL_Surface *src32 = SDL_CreateRGBSurfaceWithFormatFrom(buffers.src32.data(), WIDTH, HEIGHT, 32, WIDTH * 4, SDL_PIXELFORMAT_ARGB8888);
+          SDL_Surface *src16 = SDL_CreateRGBSurfaceWithFormatFrom(buffers.src16.data(), WIDTH, HEIGHT, 16, WIDTH * 2, SDL_PIXELFORMAT_RGB565);
+          SDL_Surface *argb = SDL_CreateRGBSurfaceWithFormatFrom(buffers.dst32.data(), WIDTH, HEIGHT, 32, WIDTH * 4, SDL_PIXELFORMAT_ARGB8888);
+          SDL_Surface *abgr = SDL_CreateRGBSurfaceWithFormatFrom(buffers.dst32.data(), WIDTH, HEIGHT, 32, WIDTH * 4, SDL_PIXELFORMAT_ABGR8888);
+          SDL_Surface *dst16 = SDL_CreateRGBSurfaceWithFormatFrom(buffers.dst16.data(), WIDTH, HEIGHT, 16, WIDTH * 2, SDL_PIXELFORMAT_RGB565);
+          SDL_SetSurfaceBlendMode(src32, op == OP_BLEND ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+          SDL_SetSurfaceBlendMode(src16, SDL_BLENDMODE_NONE);
+
+          Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < ITERATIONS; i++)
+          {
+               switch (op)
+               {
+               case OP_SWAP:
+                    SDL_BlitSurface(src32, NULL, abgr, NULL);
+                    break;
+               case OP_FROM565:
+                    SDL_BlitSurface(src16, NULL, argb, NULL);
+                    break;
+               case OP_TO565:
+                    SDL_BlitSurface(src32, NULL, dst16, NULL);
+                    break;
+               case OP_BLEND:
+                    SDL_BlitSurface(src32, NULL, argb, NULL);
+                    break;
+               case OP_FILL32:
+                    SDL_FillRect(argb, NULL, 0x80402010u);
+                    break;
+               default:
+                    SDL_FillRect(dst16, NULL, 0x8410);
+                    break;
+               }
+          }
+          double seconds = secondsSince(start);
+
+          SDL_FreeSurface(dst16);
+          SDL_FreeSurface(abgr);
+          SDL_FreeSurface(argb);
+          SDL_FreeSurface(src16);
+          SDL_FreeSurface(src32);
+          return seconds;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     Buffers buffers;
+     buffers.src32.resize(PIXELS);
+     buffers.base32.resize(PIXELS);
+     buffers.src16.resize(PIXELS);
+     buffers.dst16.resize(PIXELS);
+     std::srand(1);
+     for (int i = 0; i < PIXELS; i++)
+     {
+          buffers.src32[i] = ((Uint32)std::rand() << 16) ^ (Uint32)std::rand();
+          buffers.base32[i] = ((Uint32)std::rand() << 16) ^ (Uint32)std::rand();
+          buffers.src16[i] = (Uint16)std::rand();
+     }
+
+     const BlitKernel kernels[] = {BLIT_KERNEL_SCALAR, BLIT_KERNEL_SSE2, BLIT_KERNEL_AVX2, BLIT_KERNEL_AVX512, BLIT_KERNEL_NEON};
+     std::printf("%dx%d, %d iterations, auto kernel: %s\n\n", WIDTH, HEIGHT, ITERATIONS,
+                 blitKernelName(blitSetKernel(BLIT_KERNEL_AUTO)));
+     std::printf("%-12s %-8s %10s %9s %10s\n", "operation", "kernel", "Mpixel/s", "speedup", "mismatches");
+
+     for (int op = 0; op < OP_COUNT; op++)
+     {
+          blitSetKernel(BLIT_KERNEL_SCALAR);
+          runOnce(blitKernels(), (Operation)op, buffers);
+          const std::vector<Uint32> expected32 = buffers.dst32;
+          const std::vector<Uint16> expected16 = buffers.dst16;
+
+          double scalarSeconds = 0.0;
+          for (BlitKernel kernel : kernels)
+          {
+               if (!blitKernelSupported(kernel))
+               {
+                    continue;
+               }
+               blitSetKernel(kernel);
+               const BlitKernelTable &table = blitKernels();
+               runOnce(table, (Operation)op, buffers);
+               int bad = 0;
+               for (int i = 0; i < PIXELS; i++)
+               {
+                    bad += buffers.dst32[i] != expected32[i];
+                    bad += buffers.dst16[i] != expected16[i];
+               }
+
+               Uint64 start = SDL_GetPerformanceCounter();
+               for (int i = 0; i < ITERATIONS; i++)
+               {
+                    runOperation(table, (Operation)op, buffers);
+               }
+               const double seconds = secondsSince(start);
+               if (kernel == BLIT_KERNEL_SCALAR)
+               {
+                    scalarSeconds = seconds;
+               }
+               std::printf("%-12s %-8s %10.0f %8.2fx %10d\n", OPERATION_NAMES[op], blitKernelName(kernel), megapixels(seconds),
+                           scalarSeconds / SDL_max(1e-9, seconds), bad);
+          }
+
+          const double sdlSeconds = timeSdl((Operation)op, buffers);
+          std::printf("%-12s %-8s %10.0f %8.2fx %10s\n\n", OPERATION_NAMES[op], "SDL", megapixels(sdlSeconds),
+                      scalarSeconds / SDL_max(1e-9, sdlSeconds), "-");
+     }
+
+     SDL_Quit();
+     return 0;
+}
@@ -0,0 +1,231 @@
+// Description:
+// Checksum benchmark: CRC-32, CRC-32C and MD5 through every checksum
+// kernel this CPU supports, against SDLTest_Crc32Calc and SDLTest_Md5 from
+// SDL2_test, as GB/s at 4 KB and at a 1080p RGBA frame. Known vectors are
+// checked first, then every kernel against the tables over random sizes,
+// alignments and split points, and SDLTest's CRC-32 against ours.
+//
+// Build and run from project_templete/:
+//     make checkbench && ./checkbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_test_crc32.h>
+#include <SDL2/SDL_test_md5.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "checksum.h"
+
+namespace
+{
+     const size_t SIZES[] = {4096, 1920 * 1080 * 4};
+     const double TARGET_BYTES = 2e9;
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     template <typename Op> double measure(size_t bytes, Op op)
+     {
+          const int repeats = (int)SDL_max(1.0, TARGET_BYTES / (double)bytes);
+          op();
+          const Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < repeats; i++)
+          {
+               op();
+          }
+          return (double)bytes * repeats / secondsSince(start) / 1e9;
+     }
+
+     void md5Of(const void *data, size_t size, Uint8 digest[16])
+     {
+          Md5 md5;
+          md5Init(md5);
+          md5Update(md5, data, size);
+          md5Final(md5, digest);
+     }
+
+     bool md5Is(const char *text, const char *hex)
+     {
+          Uint8 digest[16];
+          md5Of(text, std::strlen(text), digest);
+          char got[33];
+          for (int i = 0; i < 16; i++)
+          {
+               std::snprintf(got + i * 2, 3, "%02x", digest[i]);
+          }
+          if (std::strcmp(got, hex) != 0)
+          {
+               std::printf("md5(\"%s\") = %s, expected %s\n", text, got, hex);
+               return false;
+          }
+          return true;
+     }
+
+     bool verifyVectors()
+     {
+          bool ok = crc32Update(0, "123456789", 9) == 0xCBF43926u && crc32cUpdate(0, "123456789", 9) == 0xE3069283u &&
+                    crc32Update(0, "", 0) == 0 && crc32cUpdate(0, "", 0) == 0;
+          if (!ok)
+          {
+               std::printf("%s: CRC check values are wrong\n", checksumKernelName(checksumSetKernel(CHECKSUM_KERNEL_AUTO)));
+          }
+          // RFC 1321's test suite
+          ok = md5Is("", "d41d8cd98f00b204e9800998ecf8427e") && ok;
+          ok = md5Is("abc", "900150983cd24fb0d6963f7d28e17f72") && ok;
+          ok = md5Is("message digest", "f96b697d7cb7938d525a2f31aaf161d0") && ok;
+          ok = md5Is("12345678901234567890123456789012345678901234567890123456789012345678901234567890",
+                     "57edf4a22be3c955ac49da2e2107b67a") &&
+               ok;
+          return ok;
+     }
+
+     // Against the tables, from every offset, whole and split in two
+     bool verifyKernel(ChecksumKernel kernel, const std::vector<Uint8> &data)
+     {
+          Uint32 seed = 12345;
+          for (int trial = 0; trial < 2000; trial++)
+          {
+               seed = seed * 1664525u + 1013904223u;
+               const size_t offset = seed % 16;
+               const size_t size = trial % 100 == 0 ? (seed >> 8) % (data.size() - 16) : (seed >> 8) % 1100;
+               const size_t split = size == 0 ? 0 : (seed >> 4) % size;
+               const Uint8 *in = data.data() + offset;
+               checksumSetKernel(CHECKSUM_KERNEL_TABLE);
+               const Uint32 crc = crc32Update(0, in, size), crcc = crc32cUpdate(0, in, size);
+               checksumSetKernel(kernel);
+               const Uint32 whole = crc32Update(0, in, size), wholec = crc32cUpdate(0, in, size);
+               const Uint32 parts = crc32Update(crc32Update(0, in, split), in + split, size - split);
+               const Uint32 partsc = crc32cUpdate(crc32cUpdate(0, in, split), in + split, size - split);
+               if (whole != crc || parts != crc || wholec != crcc || partsc != crcc)
+               {
+                    std::printf("%s: %zu bytes at offset %zu (split at %zu) disagree with the tables\n",
+                                checksumKernelName(kernel), size, offset, split);
+                    return false;
+               }
+          }
+          return true;
+     }
+
+     bool verifyAgainstSdlTest(const std::vector<Uint8> &data)
+     {
+          SDLTest_Crc32Context context;
+          SDLTest_Crc32Init(&context);
+          CrcUint32 expected = 0;
+          SDLTest_Crc32Calc(&context, (CrcUint8 *)data.data(), 100000, &expected);
+          SDLTest_Crc32Done(&context);
+          if (crc32Update(0, data.data(), 100000) != expected)
+          {
+               std::printf("CRC-32 disagrees with SDLTest_Crc32Calc\n");
+               return false;
+          }
+
+          // Odd-sized pieces exercise md5Update's pending buffer
+          SDLTest_Md5Context sdlMd5;
+          SDLTest_Md5Init(&sdlMd5);
+          SDLTest_Md5Update(&sdlMd5, (unsigned char *)data.data(), 100000);
+          SDLTest_Md5Final(&sdlMd5);
+          Md5 md5;
+          md5Init(md5);
+          for (size_t done = 0, piece = 1; done < 100000; done += piece, piece = piece * 3 % 191 + 1)
+          {
+               md5Update(md5, data.data() + done, SDL_min(piece, 100000 - done));
+          }
+          Uint8 digest[16];
+          md5Final(md5, digest);
+          if (std::memcmp(digest, sdlMd5.digest, 16) != 0)
+          {
+               std::printf("MD5 disagrees with SDLTest_Md5\n");
+               return false;
+          }
+          return true;
+     }
+
+     void benchSdlTest(const std::vector<Uint8> &data)
+     {
+          for (const size_t bytes : SIZES)
+          {
+               SDLTest_Crc32Context context;
+               SDLTest_Crc32Init(&context);
+               CrcUint32 crc;
+               const double crcRate = measure(bytes, [&] {
+                    SDLTest_Crc32Calc(&context, (CrcUint8 *)data.data(), (CrcUint32)bytes, &crc);
+               });
+               SDLTest_Crc32Done(&context);
+               const double md5Rate = measure(bytes, [&] {
+                    SDLTest_Md5Context md5;
+                    SDLTest_Md5Init(&md5);
+                    SDLTest_Md5Update(&md5, (unsigned char *)data.data(), (unsigned int)bytes);
+                    SDLTest_Md5Final(&md5);
+               });
+               std::printf("%-14s %9zu %10.2f %10s %10.2f\n", "SDLTest", bytes, crcRate, "-", md5Rate);
+          }
+     }
+
+     void benchKernel(ChecksumKernel kernel, const std::vector<Uint8> &data)
+     {
+          volatile Uint32 sink = 0;
+          for (const size_t bytes : SIZES)
+          {
+               const double crcRate = measure(bytes, [&] { sink = sink + crc32Update(0, data.data(), bytes); });
+               const double crccRate = measure(bytes, [&] { sink = sink + crc32cUpdate(0, data.data(), bytes); });
+               const double md5Rate = measure(bytes, [&] {
+                    Uint8 digest[16];
+                    md5Of(data.data(), bytes, digest);
+                    sink = sink + digest[0];
+               });
+               std::printf("%-14s %9zu %10.2f %10.2f %10.2f\n", checksumKernelName(kernel), bytes, crcRate, crccRate,
+                           md5Rate);
+          }
+     }
+}
+
+int main(int, char *[])
+{
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     std::vector<Uint8> data(SIZES[1] + 64);
+     Uint32 seed = 1;
+     for (Uint8 &byte : data)
+     {
+          seed = seed * 1103515245u + 12345u;
+          byte = (Uint8)(seed >> 16);
+     }
+
+     int failures = 0;
+     checksumSetKernel(CHECKSUM_KERNEL_TABLE);
+     if (!verifyVectors() || !verifyAgainstSdlTest(data))
+     {
+          failures++;
+     }
+     std::printf("%-14s %9s %10s %10s %10s\n", "kernel", "bytes", "crc32 GB/s", "crc32c GB/s", "md5 GB/s");
+     benchSdlTest(data);
+     const ChecksumKernel kernels[] = {CHECKSUM_KERNEL_TABLE, CHECKSUM_KERNEL_X86, CHECKSUM_KERNEL_ARMV8};
+     for (const ChecksumKernel kernel : kernels)
+     {
+          if (!checksumKernelSupported(kernel))
+          {
+               continue;
+          }
+          if (!verifyKernel(kernel, data))
+          {
+               failures++;
+               continue;
+          }
+          checksumSetKernel(kernel);
+          if (!verifyVectors())
+          {
+               failures++;
+               continue;
+          }
+          benchKernel(kernel, data);
+     }
+     SDL_Quit();
+     return failures == 0 ? 0 : 2;
+}
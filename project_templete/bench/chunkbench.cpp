@@ -0,0 +1,179 @@
+// Description:
+// Sound loading benchmark for native_sound. SOUNDS one-second 22.05 kHz
+// mono WAVs are built in memory and loaded into a 48 kHz stereo mixer
+// three ways: Mix_LoadWAV_RW (SDL_AudioCVT), nativeLoadChunk() on the
+// calling thread, and nativeLoadChunk() split across one thread per core
+// as the asset loader's workers run it. The last lines compare the memory
+// the converted chunks take with NativeSounds kept at the file's rate.
+//
+// The mixer opens on SDL's dummy audio driver, so no device is needed.
+// Build and run from project_templete/:
+//     make chunkbench && ./chunkbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "native_sound.h"
+
+namespace
+{
+     const int SOUNDS = 64;
+     const int SOURCE_RATE = 22050;
+     const int DEVICE_RATE = 48000;
+
+     struct LoadSlice
+     {
+          const std::vector<std::vector<Uint8>> *files;
+          std::vector<Mix_Chunk *> *chunks;
+          int first, last;
+     };
+
+     void put32(std::vector<Uint8> &out, Uint32 value)
+     {
+          for (int i = 0; i < 4; i++)
+          {
+               out.push_back((Uint8)(value >> (i * 8)));
+          }
+     }
+
+     void put16(std::vector<Uint8> &out, Uint16 value)
+     {
+          out.push_back((Uint8)value);
+          out.push_back((Uint8)(value >> 8));
+     }
+
+     // A canonical 16-bit mono PCM WAV of a decaying tone
+     std::vector<Uint8> makeWav(float hz)
+     {
+          const Uint32 dataBytes = SOURCE_RATE * 2;
+          std::vector<Uint8> wav;
+          wav.insert(wav.end(), {'R', 'I', 'F', 'F'});
+          put32(wav, 36 + dataBytes);
+          wav.insert(wav.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+          put32(wav, 16);
+          put16(wav, 1);
+          put16(wav, 1);
+          put32(wav, SOURCE_RATE);
+          put32(wav, SOURCE_RATE * 2);
+          put16(wav, 2);
+          put16(wav, 16);
+          wav.insert(wav.end(), {'d', 'a', 't', 'a'});
+          put32(wav, dataBytes);
+          for (int i = 0; i < SOURCE_RATE; i++)
+          {
+               const float t = (float)i / SOURCE_RATE;
+               put16(wav, (Uint16)(Sint16)(12000.0f * std::exp(-3.0f * t) * std::sin(6.2831853f * hz * t)));
+          }
+          return wav;
+     }
+
+     SDL_RWops *openFile(const std::vector<Uint8> &file)
+     {
+          return SDL_RWFromConstMem(file.data(), (int)file.size());
+     }
+
+     int SDLCALL loadSlice(void *data)
+     {
+          LoadSlice &slice = *(LoadSlice *)data;
+          for (int i = slice.first; i < slice.last; i++)
+          {
+               (*slice.chunks)[i] = nativeLoadChunk(openFile((*slice.files)[i]), 1);
+          }
+          return 0;
+     }
+
+     void freeChunks(std::vector<Mix_Chunk *> &chunks)
+     {
+          for (size_t i = 0; i < chunks.size(); i++)
+          {
+               Mix_FreeChunk(chunks[i]);
+               chunks[i] = nullptr;
+          }
+     }
+
+     double msSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     SDL_SetHint(SDL_HINT_AUDIODRIVER, "dummy");
+     if (SDL_Init(SDL_INIT_AUDIO) != 0 || Mix_OpenAudio(DEVICE_RATE, AUDIO_S16SYS, 2, 1024) != 0)
+     {
+          std::fprintf(stderr, "Unable to open the mixer: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     std::vector<std::vector<Uint8>> files;
+     for (int i = 0; i < SOUNDS; i++)
+     {
+          files.push_back(makeWav(220.0f + 20.0f * i));
+     }
+     std::vector<Mix_Chunk *> chunks(SOUNDS, nullptr);
+
+     Uint64 start = SDL_GetPerformanceCounter();
+     for (int i = 0; i < SOUNDS; i++)
+     {
+          chunks[i] = Mix_LoadWAV_RW(openFile(files[i]), 1);
+     }
+     const double cvtMs = msSince(start);
+     size_t chunkBytes = 0;
+     for (int i = 0; i < SOUNDS; i++)
+     {
+          chunkBytes += chunks[i] != nullptr ? chunks[i]->alen : 0;
+     }
+     freeChunks(chunks);
+
+     start = SDL_GetPerformanceCounter();
+     for (int i = 0; i < SOUNDS; i++)
+     {
+          chunks[i] = nativeLoadChunk(openFile(files[i]), 1);
+     }
+     const double simdMs = msSince(start);
+     freeChunks(chunks);
+
+     const int threads = SDL_max(1, SDL_min(SDL_GetCPUCount(), SOUNDS));
+     std::vector<LoadSlice> slices(threads);
+     std::vector<SDL_Thread *> workers(threads, nullptr);
+     start = SDL_GetPerformanceCounter();
+     for (int t = 0; t < threads; t++)
+     {
+          slices[t] = {&files, &chunks, SOUNDS * t / threads, SOUNDS * (t + 1) / threads};
+          workers[t] = SDL_CreateThread(loadSlice, "chunkbench", &slices[t]);
+     }
+     for (int t = 0; t < threads; t++)
+     {
+          SDL_WaitThread(workers[t], NULL);
+     }
+     const double parallelMs = msSince(start);
+     freeChunks(chunks);
+
+     size_t nativeBytes = 0;
+     for (int i = 0; i < SOUNDS; i++)
+     {
+          NativeSound sound;
+          if (nativeSoundLoad(sound, openFile(files[i]), 1))
+          {
+               nativeBytes += sound.samples.size() * sizeof(Sint16);
+          }
+     }
+
+     std::printf("%d sounds, %d Hz mono into a %d Hz stereo mixer\n\n", SOUNDS, SOURCE_RATE, DEVICE_RATE);
+     std::printf("  Mix_LoadWAV_RW            %8.2f ms\n", cvtMs);
+     std::printf("  nativeLoadChunk           %8.2f ms\n", simdMs);
+     std::printf("  nativeLoadChunk x%-2d       %8.2f ms\n", threads, parallelMs);
+     std::printf("\n  device-rate chunks        %8.2f MB\n", chunkBytes / 1048576.0);
+     std::printf("  native-rate sounds        %8.2f MB\n", nativeBytes / 1048576.0);
+
+     Mix_CloseAudio();
+     SDL_Quit();
+     return 0;
+}
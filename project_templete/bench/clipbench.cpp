@@ -0,0 +1,209 @@
+// Description:
+// Clipped panels benchmark for render_queue. A UI of PANELS panels, each
+// with its own clip and ITEMS sprites and fills half spilling out of it,
+// is drawn two ways on the software renderer:
+// - "set clip": SDL_RenderSetClipRect per panel and a flush per panel,
+//   the way a clip change splits SDL's batch;
+// - "queue clip": renderQueuePushClip per panel and one flush for all.
+// Prints draw calls and milliseconds per frame (best of five runs of
+// FRAMES frames), and how many pixels the two frames differ in. The queue
+// reorders by texture and color within a flush, so where panels overlap the
+// single flush may layer them differently; elsewhere they match.
+//
+// Build and run from project_templete/:
+//     make clipbench && ./clipbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+
+#include "render_queue.h"
+
+namespace
+{
+     const int WIDTH = 1280, HEIGHT = 720;
+     const int PANELS = 200;
+     const int ITEMS = 24;
+     const int FRAMES = 20;
+     const int RUNS = 5;
+
+     struct Panel
+     {
+          SDL_Rect clip;
+          SDL_FRect items[ITEMS];
+          SDL_Color colors[ITEMS];
+     };
+
+     Uint32 nextRandom(Uint32 &state)
+     {
+          state ^= state << 13;
+          state ^= state >> 17;
+          state ^= state << 5;
+          return state;
+     }
+
+     void makePanels(Panel *panels)
+     {
+          Uint32 state = 0x9E3779B9u;
+          for (int p = 0; p < PANELS; p++)
+          {
+               Panel &panel = panels[p];
+               panel.clip = {(int)(nextRandom(state) % (WIDTH - 160)), (int)(nextRandom(state) % (HEIGHT - 120)), 160, 120};
+               for (int i = 0; i < ITEMS; i++)
+               {
+                    // Up to half a panel outside it on every side, like rows of a scrolled list
+                    panel.items[i] = {(float)(panel.clip.x - 80 + (int)(nextRandom(state) % 240)),
+                                      (float)(panel.clip.y - 60 + (int)(nextRandom(state) % 180)), 48.0f, 32.0f};
+                    const Uint8 shade = (Uint8)(64 + nextRandom(state) % 4 * 48);
+                    panel.colors[i] = {shade, (Uint8)(255 - shade), 128, 255};
+               }
+          }
+     }
+
+     // Even items are textured, odd ones filled
+     void queuePanel(RenderQueue &queue, SDL_Texture *texture, const Panel &panel)
+     {
+          for (int i = 0; i < ITEMS; i++)
+          {
+               if (i % 2 == 0)
+               {
+                    renderQueueCopyTinted(queue, texture, nullptr, panel.items[i], panel.colors[i]);
+               }
+               else
+               {
+                    renderQueueFillRect(queue, panel.items[i], panel.colors[i]);
+               }
+          }
+     }
+
+     void drawSetClip(SDL_Renderer *renderer, RenderQueue &queue, SDL_Texture *texture, const Panel *panels, int &calls)
+     {
+          calls = 0;
+          for (int p = 0; p < PANELS; p++)
+          {
+               SDL_RenderSetClipRect(renderer, &panels[p].clip);
+               queuePanel(queue, texture, panels[p]);
+               renderQueueFlush(queue, renderer);
+               calls += queue.drawCalls;
+          }
+          SDL_RenderSetClipRect(renderer, nullptr);
+     }
+
+     void drawQueueClip(SDL_Renderer *renderer, RenderQueue &queue, SDL_Texture *texture, const Panel *panels, int &calls)
+     {
+          for (int p = 0; p < PANELS; p++)
+          {
+               const SDL_Rect &c = panels[p].clip;
+               renderQueuePushClip(queue, SDL_FRect{(float)c.x, (float)c.y, (float)c.w, (float)c.h});
+               queuePanel(queue, texture, panels[p]);
+               renderQueuePopClip(queue);
+          }
+          renderQueueFlush(queue, renderer);
+          calls = queue.drawCalls;
+     }
+
+     typedef void (*DrawFunction)(SDL_Renderer *, RenderQueue &, SDL_Texture *, const Panel *, int &);
+
+     double timeDraw(DrawFunction draw, SDL_Renderer *renderer, RenderQueue &queue, SDL_Texture *texture,
+                     const Panel *panels, int &calls)
+     {
+          double best = 1e30;
+          for (int run = 0; run < RUNS; run++)
+          {
+               const Uint64 start = SDL_GetPerformanceCounter();
+               for (int frame = 0; frame < FRAMES; frame++)
+               {
+                    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+                    SDL_RenderClear(renderer);
+                    draw(renderer, queue, texture, panels, calls);
+                    SDL_RenderFlush(renderer);
+               }
+               const double ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+               best = SDL_min(best, ms / FRAMES);
+          }
+          return best;
+     }
+
+     // Pixels differing by more than one step per channel (rounding at
+     // the cut texture coordinates), out of the whole frame
+     int countDifferent(const SDL_Surface *a, const SDL_Surface *b)
+     {
+          int different = 0;
+          for (int y = 0; y < a->h; y++)
+          {
+               const Uint8 *pa = (const Uint8 *)a->pixels + (size_t)y * a->pitch;
+               const Uint8 *pb = (const Uint8 *)b->pixels + (size_t)y * b->pitch;
+               for (int x = 0; x < a->w * 4; x += 4)
+               {
+                    for (int c = 0; c < 4; c++)
+                    {
+                         if (SDL_abs(pa[x + c] - pb[x + c]) > 1)
+                         {
+                              different++;
+                              break;
+                         }
+                    }
+               }
+          }
+          return different;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(0) != 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     SDL_Surface *targets[2];
+     SDL_Renderer *renderers[2];
+     SDL_Texture *textures[2];
+     SDL_Surface *image = SDL_CreateRGBSurfaceWithFormat(0, 64, 64, 32, SDL_PIXELFORMAT_ARGB8888);
+     for (int y = 0; image != nullptr && y < 64; y++)
+     {
+          for (int x = 0; x < 64; x++)
+          {
+               ((Uint32 *)((Uint8 *)image->pixels + y * image->pitch))[x] = 0xFF000000u | (x * 4) << 16 | (y * 4) << 8 | 0x80;
+          }
+     }
+     for (int i = 0; i < 2; i++)
+     {
+          targets[i] = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+          renderers[i] = targets[i] != nullptr ? SDL_CreateSoftwareRenderer(targets[i]) : nullptr;
+          textures[i] = renderers[i] != nullptr && image != nullptr ? SDL_CreateTextureFromSurface(renderers[i], image) : nullptr;
+          if (textures[i] == nullptr)
+          {
+               std::fprintf(stderr, "Unable to create the software renderer: %s\n", SDL_GetError());
+               return 1;
+          }
+          SDL_SetTextureBlendMode(textures[i], SDL_BLENDMODE_BLEND);
+     }
+
+     static Panel panels[PANELS];
+     makePanels(panels);
+     RenderQueue queue;
+     renderQueueInit(queue, RENDER_BATCH_GEOMETRY, PANELS * ITEMS);
+
+     std::printf("%d panels of %d items, %dx%d software renderer\n", PANELS, ITEMS, WIDTH, HEIGHT);
+     int calls = 0;
+     const double setMs = timeDraw(drawSetClip, renderers[0], queue, textures[0], panels, calls);
+     std::printf("  set clip    %6d calls  %8.3f ms\n", calls, setMs);
+     const double queueMs = timeDraw(drawQueueClip, renderers[1], queue, textures[1], panels, calls);
+     std::printf("  queue clip  %6d calls  %8.3f ms\n", calls, queueMs);
+
+     const int different = countDifferent(targets[0], targets[1]);
+     std::printf("  %d of %d pixels differ beyond rounding (overlapping panels reorder)\n", different, WIDTH * HEIGHT);
+
+     for (int i = 0; i < 2; i++)
+     {
+          SDL_DestroyTexture(textures[i]);
+          SDL_DestroyRenderer(renderers[i]);
+          SDL_FreeSurface(targets[i]);
+     }
+     SDL_FreeSurface(image);
+     SDL_Quit();
+     return 0;
+}
@@ -0,0 +1,199 @@
+// Description:
+// Batched colour mapping benchmark. Maps a 1080p frame of colours with
+// colorMapArray (color_map.h) and reads it back with colorGetArray, with
+// each kernel this CPU supports, against per-pixel SDL_MapRGBA and
+// SDL_GetRGBA loops, for ARGB8888, RGB565 and an INDEX8 palette. Then
+// an INDEX8 surface is expanded onto ARGB8888 with paletteBlit and with
+// SDL_BlitSurface. Every result is checked against SDL's.
+//
+// Build and run from project_templete/:  make colorbench && ./colorbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "color_map.h"
+
+namespace
+{
+     const int WIDTH = 1920;
+     const int HEIGHT = 1080;
+     const int ITERATIONS = 20;
+     const int PIXELS = WIDTH * HEIGHT;
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     double megapixels(double seconds)
+     {
+          return (double)PIXELS * ITERATIONS / SDL_max(1e-9, seconds) / 1e6;
+     }
+
+     void runFormat(SDL_PixelFormat *format, const std::vector<SDL_Color> &colors)
+     {
+          const int bytes = format->BytesPerPixel;
+          std::vector<Uint8> expected((size_t)PIXELS * bytes), actual((size_t)PIXELS * bytes);
+          std::vector<SDL_Color> expectedColors(PIXELS), actualColors(PIXELS);
+          const char *name = SDL_GetPixelFormatName(format->format) + 16;
+
+          // Indexed mapping is a palette search per call; a tenth of the
+          // frame keeps the SDL loop bearable
+          const int count = format->palette != nullptr ? PIXELS / 10 : PIXELS;
+          Uint64 start = SDL_GetPerformanceCounter();
+          for (int n = 0; n < ITERATIONS; n++)
+          {
+               for (int i = 0; i < count; i++)
+               {
+                    const Uint32 pixel = SDL_MapRGBA(format, colors[i].r, colors[i].g, colors[i].b, colors[i].a);
+                    std::memcpy(&expected[(size_t)i * bytes], &pixel, bytes);
+               }
+          }
+          const double mapSdl = secondsSince(start) * PIXELS / count;
+          start = SDL_GetPerformanceCounter();
+          for (int n = 0; n < ITERATIONS; n++)
+          {
+               for (int i = 0; i < PIXELS; i++)
+               {
+                    Uint32 pixel = 0;
+                    std::memcpy(&pixel, &expected[(size_t)i * bytes], bytes);
+                    SDL_GetRGBA(pixel, format, &expectedColors[i].r, &expectedColors[i].g, &expectedColors[i].b,
+                                &expectedColors[i].a);
+               }
+          }
+          const double getSdl = secondsSince(start);
+          std::printf("%-10s %-8s %10.0f %10.0f\n", name, "SDL", megapixels(mapSdl), megapixels(getSdl));
+
+          const ColorKernel kernels[] = {COLOR_KERNEL_SCALAR, COLOR_KERNEL_SSE2};
+          for (ColorKernel kernel : kernels)
+          {
+               if (!colorKernelSupported(kernel))
+               {
+                    continue;
+               }
+               colorSetKernel(kernel);
+               ColorMap map;
+               if (!colorMapInit(map, format))
+               {
+                    std::fprintf(stderr, "colorMapInit failed: %s\n", SDL_GetError());
+                    return;
+               }
+               start = SDL_GetPerformanceCounter();
+               for (int n = 0; n < ITERATIONS; n++)
+               {
+                    colorMapArray(map, colors.data(), actual.data(), PIXELS);
+               }
+               const double mapSeconds = secondsSince(start);
+               start = SDL_GetPerformanceCounter();
+               for (int n = 0; n < ITERATIONS; n++)
+               {
+                    colorGetArray(map, expected.data(), actualColors.data(), PIXELS);
+               }
+               const double getSeconds = secondsSince(start);
+
+               int bad = 0;
+               for (int i = 0; i < count; i++)
+               {
+                    bad += std::memcmp(&expected[(size_t)i * bytes], &actual[(size_t)i * bytes], bytes) != 0;
+               }
+               for (int i = 0; i < PIXELS; i++)
+               {
+                    bad += std::memcmp(&expectedColors[i], &actualColors[i], sizeof(SDL_Color)) != 0;
+               }
+               std::printf("%-10s %-8s %10.0f %10.0f %10d\n", name, colorKernelName(kernel), megapixels(mapSeconds),
+                           megapixels(getSeconds), bad);
+          }
+     }
+
+     void runBlit(SDL_Palette *palette)
+     {
+          SDL_Surface *src = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 8, SDL_PIXELFORMAT_INDEX8);
+          SDL_Surface *expected = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+          SDL_Surface *actual = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+          SDL_SetSurfacePalette(src, palette);
+          for (int y = 0; y < HEIGHT; y++)
+          {
+               for (int x = 0; x < WIDTH; x++)
+               {
+                    ((Uint8 *)src->pixels)[y * src->pitch + x] = (Uint8)std::rand();
+               }
+          }
+
+          Uint64 start = SDL_GetPerformanceCounter();
+          for (int n = 0; n < ITERATIONS; n++)
+          {
+               SDL_BlitSurface(src, nullptr, expected, nullptr);
+          }
+          const double sdlSeconds = secondsSince(start);
+          start = SDL_GetPerformanceCounter();
+          for (int n = 0; n < ITERATIONS; n++)
+          {
+               paletteBlit(src, nullptr, actual, nullptr);
+          }
+          const double seconds = secondsSince(start);
+
+          int bad = 0;
+          for (int y = 0; y < HEIGHT; y++)
+          {
+               bad += std::memcmp((Uint8 *)expected->pixels + y * expected->pitch,
+                                  (Uint8 *)actual->pixels + y * actual->pitch, WIDTH * 4) != 0;
+          }
+          std::printf("\nINDEX8 -> ARGB8888 blit: SDL %.0f, table %.0f Mpixel/s (%.2fx), %d rows differ\n",
+                      megapixels(sdlSeconds), megapixels(seconds), sdlSeconds / SDL_max(1e-9, seconds), bad);
+          SDL_FreeSurface(actual);
+          SDL_FreeSurface(expected);
+          SDL_FreeSurface(src);
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     std::srand(1);
+     std::vector<SDL_Color> colors(PIXELS);
+     for (SDL_Color &color : colors)
+     {
+          color = SDL_Color{(Uint8)std::rand(), (Uint8)std::rand(), (Uint8)std::rand(), (Uint8)std::rand()};
+     }
+     // Palette effects map a few distinct colours many times over
+     std::vector<SDL_Color> effect(PIXELS);
+     for (SDL_Color &color : effect)
+     {
+          color = colors[std::rand() % 1024];
+     }
+     SDL_Palette *palette = SDL_AllocPalette(256);
+     for (int i = 0; i < 256; i++)
+     {
+          palette->colors[i] = colors[PIXELS - 1 - i];
+     }
+
+     std::printf("%dx%d, %d iterations, auto kernel: %s\n\n", WIDTH, HEIGHT, ITERATIONS,
+                 colorKernelName(colorSetKernel(COLOR_KERNEL_AUTO)));
+     std::printf("%-10s %-8s %10s %10s %10s\n", "format", "kernel", "map Mpx/s", "get Mpx/s", "mismatches");
+     SDL_PixelFormat *argb = SDL_AllocFormat(SDL_PIXELFORMAT_ARGB8888);
+     SDL_PixelFormat *rgb565 = SDL_AllocFormat(SDL_PIXELFORMAT_RGB565);
+     SDL_PixelFormat *index8 = SDL_AllocFormat(SDL_PIXELFORMAT_INDEX8);
+     SDL_SetPixelFormatPalette(index8, palette);
+     runFormat(argb, colors);
+     runFormat(rgb565, colors);
+     runFormat(index8, effect);
+     runBlit(palette);
+
+     SDL_FreeFormat(index8);
+     SDL_FreeFormat(rgb565);
+     SDL_FreeFormat(argb);
+     SDL_FreePalette(palette);
+     SDL_Quit();
+     return 0;
+}
@@ -0,0 +1,109 @@
+// Description:
+// Cursor switching benchmark. Simulates the pointer passing over a hover
+// target 2000 times, switching between a 32x32 colour cursor and the
+// default on each pass, three ways: creating the colour cursor from its
+// surface on every entry and freeing it on exit, as a naive hover effect
+// does; through a CursorCache, and through the cache's show called every
+// frame whether or not the cursor changed. Needs a desktop video driver;
+// the numbers are the OS cursor calls, which is what the cache saves.
+//
+// Build and run from project_templete/:  make cursorbench && ./cursorbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+
+#include "cursor_cache.h"
+
+namespace
+{
+     const int PASSES = 2000;
+     const int FRAMES_PER_PASS = 10; // Frames spent over and off the target
+
+     double usSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) * 1e6 / SDL_GetPerformanceFrequency();
+     }
+
+     SDL_Surface *makeCursorImage()
+     {
+          SDL_Surface *image = SDL_CreateRGBSurfaceWithFormat(0, 32, 32, 32, SDL_PIXELFORMAT_ARGB8888);
+          if (image == nullptr)
+          {
+               return nullptr;
+          }
+          for (int y = 0; y < 32; y++)
+          {
+               Uint32 *row = (Uint32 *)((Uint8 *)image->pixels + y * image->pitch);
+               for (int x = 0; x < 32; x++)
+               {
+                    // A filled arrow: opaque inside the triangle, clear outside
+                    row[x] = x <= y ? (x == 0 || x == y || y == 31 ? 0xFF000000 : 0xFFFFFFFF) : 0;
+               }
+          }
+          return image;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(SDL_INIT_VIDEO) != 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     SDL_Window *window = SDL_CreateWindow("cursorbench", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 320, 240, 0);
+     SDL_Surface *image = makeCursorImage();
+     if (window == nullptr || image == nullptr)
+     {
+          std::fprintf(stderr, "Unable to set up: %s\n", SDL_GetError());
+          SDL_Quit();
+          return 1;
+     }
+     std::printf("video driver: %s\n", SDL_GetCurrentVideoDriver());
+
+     // Create on entry, free on exit
+     Uint64 start = SDL_GetPerformanceCounter();
+     for (int pass = 0; pass < PASSES; pass++)
+     {
+          SDL_Cursor *cursor = SDL_CreateColorCursor(image, 0, 0);
+          SDL_SetCursor(cursor);
+          SDL_SetCursor(SDL_GetDefaultCursor());
+          SDL_FreeCursor(cursor);
+     }
+     const double naive = usSince(start);
+
+     CursorCache cache;
+     cursorCacheInit(cache);
+     start = SDL_GetPerformanceCounter();
+     for (int pass = 0; pass < PASSES; pass++)
+     {
+          cursorCacheShow(cache, cursorCacheImage(cache, image, 0, 0));
+          cursorCacheShow(cache, nullptr);
+     }
+     const double cached = usSince(start);
+
+     start = SDL_GetPerformanceCounter();
+     for (int pass = 0; pass < PASSES; pass++)
+     {
+          SDL_Cursor *cursor = cursorCacheImage(cache, image, 0, 0);
+          for (int frame = 0; frame < FRAMES_PER_PASS; frame++)
+          {
+               cursorCacheShow(cache, frame < FRAMES_PER_PASS / 2 ? cursor : nullptr);
+          }
+     }
+     const double everyFrame = usSince(start);
+
+     std::printf("create per hover     %8.2f us per pass\n", naive / PASSES);
+     std::printf("cached               %8.2f us per pass (%d cursors made, %d reused)\n", cached / PASSES,
+                 cache.created, cache.reused);
+     std::printf("cached, every frame  %8.2f us per pass of %d frames\n", everyFrame / PASSES, FRAMES_PER_PASS);
+
+     cursorCacheDestroy(cache);
+     SDL_FreeSurface(image);
+     SDL_DestroyWindow(window);
+     SDL_Quit();
+     return 0;
+}
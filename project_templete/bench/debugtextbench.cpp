@@ -0,0 +1,108 @@
+// Description:
+// Debug text benchmark for debug_text. A screen of LINES stat lines, COLUMNS
+// characters each, is drawn FRAMES times into a software renderer, first with
+// SDLTest_DrawString and then with debugTextDraw() and one debugTextFlush().
+// The submit column is the time spent in the draw calls themselves, which a
+// GPU renderer pays too. The raster column is SDL_RenderFlush, the software
+// rasterizer's share.
+//
+// Build and run from project_templete/:
+//     make debugtextbench && ./debugtextbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_test_font.h>
+#include <cstdio>
+
+#include "debug_text.h"
+
+namespace
+{
+     const int WIDTH = 1280;
+     const int HEIGHT = 720;
+     const int LINES = 48;
+     const int COLUMNS = 100;
+     const int FRAMES = 60;
+
+     double msSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(0) != 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+     SDL_Renderer *renderer = target != nullptr ? SDL_CreateSoftwareRenderer(target) : nullptr;
+     DebugText debug;
+     if (renderer == nullptr || !debugTextInit(debug, renderer, LINES * COLUMNS))
+     {
+          std::fprintf(stderr, "Unable to create the software renderer: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     // Stat lines that change every frame, like a real overlay's
+     char lines[LINES][COLUMNS + 1];
+     const SDL_Color green = {120, 255, 120, 255};
+     double submitMs[2] = {0.0, 0.0}, rasterMs[2] = {0.0, 0.0};
+     for (int frame = 0; frame < FRAMES; frame++)
+     {
+          for (int i = 0; i < LINES; i++)
+          {
+               int length = SDL_snprintf(lines[i], sizeof(lines[i]), "counter %02d  frame %4d  value %10.4f  ", i, frame,
+                                         frame * 0.37 + i * 1.618);
+               for (; length < COLUMNS; length++)
+               {
+                    lines[i][length] = (char)('a' + (frame + i + length) % 26);
+               }
+               lines[i][COLUMNS] = '\0';
+          }
+
+          for (int path = 0; path < 2; path++)
+          {
+               SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+               SDL_RenderClear(renderer);
+               SDL_SetRenderDrawColor(renderer, green.r, green.g, green.b, green.a);
+               Uint64 start = SDL_GetPerformanceCounter();
+               for (int i = 0; i < LINES; i++)
+               {
+                    if (path == 0)
+                    {
+                         SDLTest_DrawString(renderer, 4, 4 + i * FONT_LINE_HEIGHT, lines[i]);
+                    }
+                    else
+                    {
+                         debugTextDraw(debug, 4.0f, 4.0f + i * FONT_LINE_HEIGHT, lines[i], green);
+                    }
+               }
+               if (path == 1)
+               {
+                    debugTextFlush(debug);
+               }
+               submitMs[path] += msSince(start);
+
+               start = SDL_GetPerformanceCounter();
+               SDL_RenderFlush(renderer);
+               rasterMs[path] += msSince(start);
+          }
+     }
+
+     std::printf("%d characters per frame, %d frames\n\n", LINES * COLUMNS, FRAMES);
+     std::printf("  %-20s %10s %10s\n", "", "submit", "raster");
+     std::printf("  %-20s %7.3f ms %7.3f ms\n", "SDLTest_DrawString", submitMs[0] / FRAMES, rasterMs[0] / FRAMES);
+     std::printf("  %-20s %7.3f ms %7.3f ms\n", "debugTextDraw", submitMs[1] / FRAMES, rasterMs[1] / FRAMES);
+
+     debugTextDestroy(debug);
+     SDLTest_CleanupTextDrawing();
+     SDL_DestroyRenderer(renderer);
+     SDL_FreeSurface(target);
+     SDL_Quit();
+     return 0;
+}
@@ -0,0 +1,182 @@
+// Description:
+// Event watch dispatch benchmark: the cost per SDL_PushEvent of 1 to 32
+// watchers installed with SDL_AddEventWatch, each switching on the type
+// the way a UI or telemetry watch does, against the same watchers added
+// through eventWatchAdd() with type ranges. One watcher wants mouse
+// motion; the others want keys, controllers or window events, which is
+// where the type table saves their calls.
+//
+// The masked runs go with and without eventWatchSetTiming(). Also prints
+// the per-watcher call counts and times that eventWatchStats() collects,
+// and checks every watcher saw exactly the events it asked for.
+//
+// Build and run from project_templete/:
+//     make dispatchbench && ./dispatchbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+
+#include "event_watch.h"
+
+namespace
+{
+     const int EVENTS = 20000; // Per measurement; SDL's queue holds 65535
+     const int WATCHER_COUNTS[] = {1, 4, 16, 32};
+     const char *WATCHER_NAMES[] = {"motion", "keys", "controller", "window"};
+
+     struct Watcher
+     {
+          Uint32 first, last;
+          int seen;
+     };
+
+     Watcher watchers[32];
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     // What a type-switching SDL watch has to do on every event
+     int SDLCALL filteringWatch(void *userdata, SDL_Event *event)
+     {
+          Watcher &watcher = *(Watcher *)userdata;
+          if (event->type >= watcher.first && event->type <= watcher.last)
+          {
+               watcher.seen++;
+          }
+          return 1;
+     }
+
+     // Under eventWatchAdd() the table has done the check already
+     int SDLCALL countingWatch(void *userdata, SDL_Event *)
+     {
+          ((Watcher *)userdata)->seen++;
+          return 1;
+     }
+
+     void setUpWatchers(int count)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               Watcher &watcher = watchers[i];
+               switch (i % 4)
+               {
+               case 0:
+                    watcher.first = watcher.last = i == 0 ? SDL_MOUSEMOTION : SDL_MOUSEWHEEL;
+                    break;
+               case 1:
+                    watcher.first = SDL_KEYDOWN;
+                    watcher.last = SDL_KEYUP;
+                    break;
+               case 2:
+                    watcher.first = SDL_CONTROLLERAXISMOTION;
+                    watcher.last = SDL_CONTROLLERSENSORUPDATE;
+                    break;
+               default:
+                    watcher.first = watcher.last = SDL_WINDOWEVENT;
+                    break;
+               }
+               watcher.seen = 0;
+          }
+     }
+
+     // Push and discard EVENTS mouse motion events; ns per event
+     double pushMotion()
+     {
+          SDL_Event event;
+          SDL_zero(event);
+          event.type = SDL_MOUSEMOTION;
+          const Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < EVENTS; i++)
+          {
+               event.motion.x = i;
+               SDL_PushEvent(&event);
+          }
+          const double seconds = secondsSince(start);
+          SDL_FlushEvent(SDL_MOUSEMOTION);
+          return seconds * 1e9 / EVENTS;
+     }
+
+     bool seenRight(int count)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               if (watchers[i].seen != (i == 0 ? EVENTS : 0))
+               {
+                    return false;
+               }
+          }
+          return true;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(SDL_INIT_EVENTS) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     bool good = true;
+     std::printf("%-9s %14s %14s %14s\n", "watchers", "SDL ns/event", "masked", "masked untimed");
+     const double none = pushMotion();
+     std::printf("%-9d %14.1f %14.1f %14.1f\n", 0, none, none, none);
+     for (const int count : WATCHER_COUNTS)
+     {
+          setUpWatchers(count);
+          for (int i = 0; i < count; i++)
+          {
+               SDL_AddEventWatch(filteringWatch, &watchers[i]);
+          }
+          const double sdl = pushMotion();
+          good = seenRight(count) && good;
+          for (int i = 0; i < count; i++)
+          {
+               SDL_DelEventWatch(filteringWatch, &watchers[i]);
+          }
+
+          setUpWatchers(count);
+          for (int i = 0; i < count; i++)
+          {
+               const EventTypeRange range = {watchers[i].first, watchers[i].last};
+               eventWatchAdd(countingWatch, &watchers[i], WATCHER_NAMES[i % 4], &range, 1);
+          }
+          eventWatchSetTiming(false);
+          const double untimed = pushMotion();
+          good = seenRight(count) && good;
+          eventWatchSetTiming(true);
+          setUpWatchers(count);
+          eventWatchResetStats();
+          const double masked = pushMotion();
+          good = seenRight(count) && good;
+          std::printf("%-9d %14.1f %14.1f %14.1f\n", count, sdl, masked, untimed);
+
+          if (count == WATCHER_COUNTS[SDL_arraysize(WATCHER_COUNTS) - 1])
+          {
+               EventWatchStats stats[4];
+               Uint64 events = 0;
+               eventWatchStats(stats, 4, &events);
+               std::printf("\n%llu events dispatched; first watchers:\n", (unsigned long long)events);
+               for (const EventWatchStats &watch : stats)
+               {
+                    std::printf("  %-10s %8llu calls %10.1f us total %8.2f us worst\n", watch.name,
+                                (unsigned long long)watch.calls, watch.counter * 1e6 / SDL_GetPerformanceFrequency(),
+                                watch.maxCounter * 1e6 / SDL_GetPerformanceFrequency());
+               }
+          }
+          for (int i = 0; i < count; i++)
+          {
+               eventWatchDel(countingWatch, &watchers[i]);
+          }
+     }
+     if (!good)
+     {
+          std::printf("a watcher saw the wrong events\n");
+     }
+     SDL_Quit();
+     return good ? 0 : 2;
+}
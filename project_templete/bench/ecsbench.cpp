@@ -0,0 +1,157 @@
+// Description:
+// Entity iteration benchmark. Moves a million entities by their velocity,
+// stored three ways: an array of game-object structs that carry their
+// cold data (name, health, colour) next to the position, the way Player
+// and Block grew, and an EcsWorld (ecs.h) iterated per entity, per chunk,
+// and in parallel on the job system. Half the ECS entities carry an extra
+// component, so the query spans two archetypes. Reports nanoseconds per
+// entity per update.
+//
+// Build and run from project_templete/:  make ecsbench && ./ecsbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <vector>
+
+#include "ecs.h"
+
+namespace
+{
+     const int ENTITIES = 1000000;
+     const int UPDATES = 50;
+
+     struct Position
+     {
+          float x, y;
+     };
+
+     struct Velocity
+     {
+          float x, y;
+     };
+
+     struct Health
+     {
+          int hp, maxHp;
+     };
+
+     struct GameObject
+     {
+          SDL_FRect rect;
+          float vx, vy;
+          Health health;
+          SDL_Color color;
+          char name[32];
+     };
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     void report(const char *name, double seconds, float checksum)
+     {
+          std::printf("%-24s %8.3f ns/entity  (%g)\n", name, seconds * 1e9 / ((double)ENTITIES * UPDATES), checksum);
+     }
+
+     float worldChecksum(EcsWorld &world)
+     {
+          float sum = 0.0f;
+          ecsEach<Position>(world, [&](Position &p) { sum += p.y; });
+          return sum;
+     }
+}
+
+int main(int, char *[])
+{
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     JobSystem jobs;
+     if (!jobSystemInit(jobs, 0))
+     {
+          std::fprintf(stderr, "jobSystemInit failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     std::vector<GameObject> objects(ENTITIES);
+     EcsWorld world;
+     ecsWorldInit(world);
+     for (int i = 0; i < ENTITIES; i++)
+     {
+          GameObject &object = objects[i];
+          SDL_memset(&object, 0, sizeof(object));
+          object.rect = SDL_FRect{(float)(i % 1000), 0.0f, 30.0f, 30.0f};
+          object.vy = 1.0f + (float)(i % 7);
+
+          EcsEntity entity = (i & 1) ? ecsCreate<Position, Velocity, Health>(world)
+                                     : ecsCreate<Position, Velocity>(world);
+          *ecsGet<Position>(world, entity) = Position{object.rect.x, 0.0f};
+          *ecsGet<Velocity>(world, entity) = Velocity{0.0f, object.vy};
+     }
+
+     Uint64 start = SDL_GetPerformanceCounter();
+     for (int update = 0; update < UPDATES; update++)
+     {
+          for (GameObject &object : objects)
+          {
+               object.rect.x += object.vx;
+               object.rect.y += object.vy;
+          }
+     }
+     const double objectSeconds = secondsSince(start);
+     float objectSum = 0.0f;
+     for (const GameObject &object : objects)
+     {
+          objectSum += object.rect.y;
+     }
+
+     const auto move = [](Position &p, const Velocity &v) {
+          p.x += v.x;
+          p.y += v.y;
+     };
+     start = SDL_GetPerformanceCounter();
+     for (int update = 0; update < UPDATES; update++)
+     {
+          ecsEach<Position, Velocity>(world, move);
+     }
+     const double eachSeconds = secondsSince(start);
+     const float eachSum = worldChecksum(world);
+
+     start = SDL_GetPerformanceCounter();
+     for (int update = 0; update < UPDATES; update++)
+     {
+          ecsEachChunk<Position, Velocity>(world, [](int count, const EcsEntity *, Position *p, Velocity *v) {
+               for (int i = 0; i < count; i++)
+               {
+                    p[i].x += v[i].x;
+                    p[i].y += v[i].y;
+               }
+          });
+     }
+     const double chunkSeconds = secondsSince(start);
+     const float chunkSum = worldChecksum(world);
+
+     start = SDL_GetPerformanceCounter();
+     for (int update = 0; update < UPDATES; update++)
+     {
+          ecsEachParallel<Position, Velocity>(world, &jobs, move);
+     }
+     const double parallelSeconds = secondsSince(start);
+     const float parallelSum = worldChecksum(world);
+
+     std::printf("%d entities, %d updates, %d threads, %d archetypes\n\n", ENTITIES, UPDATES,
+                 jobSystemThreadCount(jobs), (int)world.archetypes.size());
+     report("game-object structs", objectSeconds, objectSum);
+     report("ecsEach", eachSeconds, eachSum);
+     report("ecsEachChunk", chunkSeconds, chunkSum);
+     report("ecsEachParallel", parallelSeconds, parallelSum);
+
+     ecsWorldDestroy(world);
+     jobSystemDestroy(jobs);
+     SDL_Quit();
+     return 0;
+}
@@ -0,0 +1,168 @@
+// Description:
+// $1 matching benchmark for gesture_recognizer. TEMPLATES random strokes
+// become templates, and STROKES noisy copies of them are matched two ways:
+// - "sdl": SDL_gesture.c's loop, one template at a time, with a sine and
+//   a cosine per point per search step (copied here, as SDL does not
+//   export it);
+// - "grouped": gestureMatch(), four templates per SSE2 pass.
+// Prints microseconds per stroke (best of five runs) and how many strokes
+// each found their own template for; the two should agree.
+//
+// Build and run from project_templete/:
+//     make gesturebench && ./gesturebench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <vector>
+
+#include "gesture_recognizer.h"
+
+namespace
+{
+     const int TEMPLATES = 256;
+     const int STROKES = 200;
+     const int RUNS = 5;
+     const int RAW_POINTS = 120;
+
+     Uint32 nextRandom(Uint32 &state)
+     {
+          state ^= state << 13;
+          state ^= state >> 17;
+          state ^= state << 5;
+          return state;
+     }
+
+     float unit(Uint32 &state)
+     {
+          return (float)(nextRandom(state) % 10000) / 10000.0f;
+     }
+
+     // A wandering stroke through a few random control points
+     void makeStroke(Uint32 seed, float noise, Uint32 &noiseState, std::vector<SDL_FPoint> &path)
+     {
+          Uint32 state = seed;
+          SDL_FPoint control[5];
+          for (SDL_FPoint &c : control)
+          {
+               c = {unit(state), unit(state)};
+          }
+          path.clear();
+          for (int i = 0; i < RAW_POINTS; i++)
+          {
+               const float t = (float)i / (RAW_POINTS - 1) * 4;
+               const int k = SDL_min((int)t, 3);
+               const float f = t - k;
+               path.push_back({control[k].x + (control[k + 1].x - control[k].x) * f + (unit(noiseState) - 0.5f) * noise,
+                               control[k].y + (control[k + 1].y - control[k].y) * f + (unit(noiseState) - 0.5f) * noise});
+          }
+     }
+
+     // --- SDL_gesture.c's matcher ---
+
+     float sdlDifference(const SDL_FPoint *points, const SDL_FPoint *templ, float ang)
+     {
+          float dist = 0;
+          for (int i = 0; i < GESTURE_POINTS; i++)
+          {
+               const float px = (float)(points[i].x * SDL_cos(ang) - points[i].y * SDL_sin(ang));
+               const float py = (float)(points[i].x * SDL_sin(ang) + points[i].y * SDL_cos(ang));
+               dist += (float)SDL_sqrt((px - templ[i].x) * (px - templ[i].x) + (py - templ[i].y) * (py - templ[i].y));
+          }
+          return dist / GESTURE_POINTS;
+     }
+
+     float sdlBestDifference(const SDL_FPoint *points, const SDL_FPoint *templ)
+     {
+          const double phi = 0.618033989;
+          double ta = -M_PI / 4, tb = M_PI / 4;
+          const double dt = M_PI / 90;
+          float x1 = (float)(phi * ta + (1 - phi) * tb);
+          float f1 = sdlDifference(points, templ, x1);
+          float x2 = (float)((1 - phi) * ta + phi * tb);
+          float f2 = sdlDifference(points, templ, x2);
+          while (SDL_fabs(ta - tb) > dt)
+          {
+               if (f1 < f2)
+               {
+                    tb = x2;
+                    x2 = x1;
+                    f2 = f1;
+                    x1 = (float)(phi * ta + (1 - phi) * tb);
+                    f1 = sdlDifference(points, templ, x1);
+               }
+               else
+               {
+                    ta = x1;
+                    x1 = x2;
+                    f1 = f2;
+                    x2 = (float)((1 - phi) * ta + phi * tb);
+                    f2 = sdlDifference(points, templ, x2);
+               }
+          }
+          return SDL_min(f1, f2);
+     }
+
+     int sdlMatch(const std::vector<SDL_FPoint> &templates, const SDL_FPoint *points)
+     {
+          int best = -1;
+          float bestDiff = 10000;
+          for (int i = 0; i < TEMPLATES; i++)
+          {
+               const float diff = sdlBestDifference(points, &templates[i * GESTURE_POINTS]);
+               if (diff < bestDiff)
+               {
+                    bestDiff = diff;
+                    best = i;
+               }
+          }
+          return best;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     GestureRecognizer recognizer = {};
+     recognizer.templateLock = SDL_CreateMutex();
+
+     std::vector<SDL_FPoint> path, templates(TEMPLATES * GESTURE_POINTS);
+     Uint32 noiseState = 0x2545F491u;
+     for (int i = 0; i < TEMPLATES; i++)
+     {
+          makeStroke(0x9E3779B9u + i * 7919u, 0.0f, noiseState, path);
+          gestureNormalize(path.data(), (int)path.size(), &templates[i * GESTURE_POINTS]);
+          gestureAddTemplate(recognizer, &templates[i * GESTURE_POINTS]);
+     }
+     std::vector<SDL_FPoint> strokes(STROKES * GESTURE_POINTS);
+     for (int i = 0; i < STROKES; i++)
+     {
+          makeStroke(0x9E3779B9u + (i % TEMPLATES) * 7919u, 0.01f, noiseState, path);
+          gestureNormalize(path.data(), (int)path.size(), &strokes[i * GESTURE_POINTS]);
+     }
+
+     std::printf("%d templates, %d strokes\n", TEMPLATES, STROKES);
+     for (int method = 0; method < 2; method++)
+     {
+          double best = 1e30;
+          int correct = 0;
+          for (int run = 0; run < RUNS; run++)
+          {
+               correct = 0;
+               const Uint64 start = SDL_GetPerformanceCounter();
+               for (int i = 0; i < STROKES; i++)
+               {
+                    const SDL_FPoint *points = &strokes[i * GESTURE_POINTS];
+                    const int found = method == 0 ? sdlMatch(templates, points) : gestureMatch(recognizer, points, nullptr);
+                    correct += found == i % TEMPLATES;
+               }
+               const double us = (double)(SDL_GetPerformanceCounter() - start) * 1e6 / SDL_GetPerformanceFrequency();
+               best = SDL_min(best, us / STROKES);
+          }
+          std::printf("  %-8s %9.1f us/stroke  %d/%d matched\n", method == 0 ? "sdl" : "grouped", best, correct, STROKES);
+     }
+
+     SDL_DestroyMutex(recognizer.templateLock);
+     return 0;
+}
@@ -0,0 +1,307 @@
+// Description:
+// gl_sprites against SDL_Renderer: the same moving 8x8 sprites, 1k to 1M
+// of them over four textures, drawn once through SDL_RenderGeometry (the
+// fastest of testsprite2's paths, here one call per texture) and once
+// through gl_sprites, vsync off, each for a few seconds. CPU time covers
+// building and submitting the frame; for gl_sprites that includes the
+// swap inside glSpritesEnd(). Writes the JSON array
+// testsprite2 --benchmark writes, with the same fields, so the two outputs
+// can be merged and read side by side; gl_sprites reports renderer
+// "gl_sprites" and path "MultiDrawIndirect" (or "DrawInstanced" on the
+// ES 3.0 fallback). The time gl_sprites took to get its shader program
+// ready goes to stderr; run twice to see it come from the program cache.
+//
+// Build and run from project_templete/:
+//     make glbench && ./glbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "gl_sprites.h"
+#include "program_cache.h"
+
+namespace
+{
+     const int WIDTH = 1280;
+     const int HEIGHT = 720;
+     const int SPRITE_SIZE = 8;
+     const int MAX_SPRITES = 1000000;
+     const Uint32 MS_PER_RUN = 3000;
+
+     struct Mover
+     {
+          float x, y, dx, dy;
+     };
+
+     struct Run
+     {
+          int frames;
+          Uint64 cpu; // Performance counter ticks spent building and submitting
+          Uint64 total;
+     };
+
+     void resetMovers(std::vector<Mover> &movers)
+     {
+          std::srand(1); // The same scene for both renderers
+          for (Mover &mover : movers)
+          {
+               mover.x = (float)(std::rand() % (WIDTH - SPRITE_SIZE));
+               mover.y = (float)(std::rand() % (HEIGHT - SPRITE_SIZE));
+               mover.dx = (float)(std::rand() % 200 - 100) / 60.0f;
+               mover.dy = (float)(std::rand() % 200 - 100) / 60.0f;
+          }
+     }
+
+     inline void move(Mover &mover)
+     {
+          mover.x += mover.dx;
+          mover.y += mover.dy;
+          mover.dx = mover.x < 0 || mover.x > WIDTH - SPRITE_SIZE ? -mover.dx : mover.dx;
+          mover.dy = mover.y < 0 || mover.y > HEIGHT - SPRITE_SIZE ? -mover.dy : mover.dy;
+     }
+
+     SDL_Surface *checkerSurface(int t)
+     {
+          SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, 16, 16, 32, SDL_PIXELFORMAT_RGBA32);
+          SDL_FillRect(surface, nullptr, SDL_MapRGBA(surface->format, 255, 255, 255, 255));
+          SDL_Rect square = {0, 0, 8, 8};
+          SDL_FillRect(surface, &square, SDL_MapRGBA(surface->format, 64 * t, 255 - 64 * t, 128, 255));
+          return surface;
+     }
+
+     bool pumpEvents()
+     {
+          SDL_Event event;
+          bool quit = false;
+          while (SDL_PollEvent(&event))
+          {
+               quit = quit || event.type == SDL_QUIT;
+          }
+          return !quit;
+     }
+
+     // SDL_RenderGeometry can take one texture per call, so the four
+     // textures are four calls of count / 4 sprites each
+     bool runRenderer(SDL_Renderer *renderer, SDL_Texture *textures[4], std::vector<Mover> &movers, int count,
+                      Run &run)
+     {
+          // Sprite i goes to group i & 3, so each group is contiguous
+          const int group = (count + 3) / 4;
+          std::vector<SDL_Vertex> vertices((size_t)group * 4 * 4);
+          std::vector<int> indices((size_t)group * 4 * 6);
+          for (int slot = 0; slot < group * 4; slot++)
+          {
+               int *index = &indices[(size_t)slot * 6];
+               index[0] = slot * 4, index[1] = slot * 4 + 1, index[2] = slot * 4 + 2;
+               index[3] = slot * 4, index[4] = slot * 4 + 2, index[5] = slot * 4 + 3;
+          }
+
+          run = {};
+          const Uint32 deadline = SDL_GetTicks() + MS_PER_RUN;
+          const Uint64 start = SDL_GetPerformanceCounter();
+          while (!SDL_TICKS_PASSED(SDL_GetTicks(), deadline))
+          {
+               if (!pumpEvents())
+               {
+                    return false;
+               }
+               const Uint64 cpuStart = SDL_GetPerformanceCounter();
+               for (int i = 0; i < count; i++)
+               {
+                    Mover &mover = movers[i];
+                    move(mover);
+                    const int slot = (i & 3) * group + i / 4;
+                    SDL_Vertex *quad = &vertices[(size_t)slot * 4];
+                    const float right = mover.x + SPRITE_SIZE, bottom = mover.y + SPRITE_SIZE;
+                    quad[0] = {{mover.x, mover.y}, {255, 255, 255, 255}, {0.0f, 0.0f}};
+                    quad[1] = {{right, mover.y}, {255, 255, 255, 255}, {1.0f, 0.0f}};
+                    quad[2] = {{right, bottom}, {255, 255, 255, 255}, {1.0f, 1.0f}};
+                    quad[3] = {{mover.x, bottom}, {255, 255, 255, 255}, {0.0f, 1.0f}};
+               }
+               SDL_SetRenderDrawColor(renderer, 33, 33, 33, 255);
+               SDL_RenderClear(renderer);
+               for (int t = 0; t < 4; t++)
+               {
+                    const int sprites = (count - t + 3) / 4;
+                    if (sprites > 0)
+                    {
+                         // Indices are relative to the vertices passed, hence group 0's
+                         SDL_RenderGeometry(renderer, textures[t], &vertices[(size_t)t * group * 4], sprites * 4,
+                                            indices.data(), sprites * 6);
+                    }
+               }
+               run.cpu += SDL_GetPerformanceCounter() - cpuStart;
+               SDL_RenderPresent(renderer);
+               run.frames++;
+          }
+          run.total = SDL_GetPerformanceCounter() - start;
+          return true;
+     }
+
+     bool runGlSprites(GlSprites &sprites, const Uint32 textures[4], std::vector<Mover> &movers, int count, Run &run,
+                       bool &failed)
+     {
+          run = {};
+          const Uint32 deadline = SDL_GetTicks() + MS_PER_RUN;
+          const Uint64 start = SDL_GetPerformanceCounter();
+          while (!SDL_TICKS_PASSED(SDL_GetTicks(), deadline))
+          {
+               if (!pumpEvents())
+               {
+                    return false;
+               }
+               GlSprite *out = glSpritesBegin(sprites);
+               if (out == nullptr)
+               {
+                    failed = true;
+                    return false;
+               }
+               const Uint64 cpuStart = SDL_GetPerformanceCounter();
+               for (int i = 0; i < count; i++)
+               {
+                    Mover &mover = movers[i];
+                    move(mover);
+                    GlSprite &sprite = out[i];
+                    sprite.x = mover.x;
+                    sprite.y = mover.y;
+                    sprite.width = (float)SPRITE_SIZE;
+                    sprite.height = (float)SPRITE_SIZE;
+                    sprite.u0 = 0;
+                    sprite.v0 = 0;
+                    sprite.u1 = 65535;
+                    sprite.v1 = 65535;
+                    sprite.color = {255, 255, 255, 255};
+                    sprite.texture = textures[i & 3];
+               }
+               const SDL_Color clear = {33, 33, 33, 255};
+               if (!glSpritesEnd(sprites, count, clear))
+               {
+                    failed = true;
+                    return false;
+               }
+               run.cpu += SDL_GetPerformanceCounter() - cpuStart;
+               run.frames++;
+          }
+          run.total = SDL_GetPerformanceCounter() - start;
+          return true;
+     }
+
+     void printRun(bool &first, const char *renderer, const char *path, int count, const Run &run, int drawCalls)
+     {
+          const double frequency = (double)SDL_GetPerformanceFrequency();
+          const double seconds = run.total / frequency;
+          const int frames = SDL_max(run.frames, 1);
+          std::printf("%s\n  {\"renderer\": \"%s\", \"path\": \"%s\", \"sprites\": %d, \"frames\": %d, "
+                      "\"fps\": %.2f, \"cpu_ms_per_frame\": %.3f, \"frame_ms\": %.3f, \"draw_calls\": %d}",
+                      first ? "" : ",", renderer, path, count, run.frames, run.frames / seconds,
+                      run.cpu * 1000.0 / frequency / frames, seconds * 1000.0 / frames, drawCalls);
+          std::fflush(stdout);
+          first = false;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(SDL_INIT_VIDEO) < 0)
+     {
+          std::printf("Unable to initialize SDL! SDL Error: %s\n", SDL_GetError());
+          return 1;
+     }
+     std::vector<Mover> movers(MAX_SPRITES);
+     bool first = true;
+     bool running = true;
+     bool failed = false;
+     std::printf("[");
+
+     // SDL_Renderer first, in a window of its own: a GL context can't be
+     // shared with the renderer's
+     SDL_Window *window = SDL_CreateWindow("glbench SDL_Renderer", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                           WIDTH, HEIGHT, 0);
+     SDL_Renderer *renderer = window != nullptr ? SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED) : nullptr;
+     if (renderer != nullptr)
+     {
+          SDL_RendererInfo info;
+          SDL_GetRendererInfo(renderer, &info);
+          SDL_Texture *textures[4];
+          for (int t = 0; t < 4; t++)
+          {
+               SDL_Surface *surface = checkerSurface(t);
+               textures[t] = SDL_CreateTextureFromSurface(renderer, surface);
+               SDL_FreeSurface(surface);
+          }
+          for (int count = 1000; running && count <= MAX_SPRITES; count *= 10)
+          {
+               Run run;
+               resetMovers(movers);
+               running = runRenderer(renderer, textures, movers, count, run);
+               printRun(first, info.name, "RenderGeometry", count, run, 4 + 1);
+          }
+          for (SDL_Texture *texture : textures)
+          {
+               SDL_DestroyTexture(texture);
+          }
+          SDL_DestroyRenderer(renderer);
+     }
+     else
+     {
+          std::fprintf(stderr, "Unable to create an SDL_Renderer! SDL Error: %s\n", SDL_GetError());
+     }
+     if (window != nullptr)
+     {
+          SDL_DestroyWindow(window);
+     }
+
+     window = SDL_CreateWindow("glbench gl_sprites", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIDTH, HEIGHT,
+                               SDL_WINDOW_OPENGL);
+     ProgramCache programs;
+     programCacheOpen(programs, "Catch", "glbench");
+     GlSprites sprites;
+     if (running && window != nullptr &&
+         glSpritesCreate(sprites, window, MAX_SPRITES, false, GL_SPRITES_DEFAULT_LAYER_SIZE, true, &programs))
+     {
+          std::fprintf(stderr, "gl_sprites program ready in %.2f ms (%s)\n", sprites.programMs,
+                       sprites.programCached ? "cached" : "compiled");
+          Uint32 textures[4];
+          for (int t = 0; t < 4 && !failed; t++)
+          {
+               SDL_Surface *surface = checkerSurface(t);
+               const int index = glSpritesAddTexture(sprites, surface);
+               SDL_FreeSurface(surface);
+               failed = index < 0;
+               textures[t] = (Uint32)index;
+          }
+          const char *path = sprites.persistent ? "MultiDrawIndirect" : "DrawInstanced";
+          for (int count = 1000; running && !failed && count <= MAX_SPRITES; count *= 10)
+          {
+               Run run;
+               resetMovers(movers);
+               running = runGlSprites(sprites, textures, movers, count, run, failed);
+               if (!failed)
+               {
+                    printRun(first, "gl_sprites", path, count, run, 1 + 1);
+               }
+          }
+          glSpritesDestroy(sprites);
+     }
+     else if (running)
+     {
+          failed = true;
+     }
+     std::printf("\n]\n");
+     if (failed)
+     {
+          std::fprintf(stderr, "Unable to run gl_sprites! SDL Error: %s\n", SDL_GetError());
+     }
+
+     if (window != nullptr)
+     {
+          SDL_DestroyWindow(window);
+     }
+     SDL_Quit();
+     return failed ? 2 : 0;
+}
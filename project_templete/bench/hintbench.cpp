@@ -0,0 +1,100 @@
+// Description:
+// Hint read benchmark: SDL_GetHintBoolean against hint_cache's
+// hintBoolean() by id, for a hint that was set, one only in the
+// environment and one nobody set, with 0 and 64 other hints in SDL's
+// list ahead of it. Also checks the cached value follows SDL_SetHint and
+// that hintCacheEndFrame() counts the lookups by name.
+//
+// Build and run from project_templete/:
+//     make hintbench && ./hintbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+
+#include "hint_cache.h"
+
+namespace
+{
+     const int READS = 1000000;
+     const int OTHER_HINTS = 64;
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     double sdlReads(const char *name)
+     {
+          int trues = 0;
+          const Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < READS; i++)
+          {
+               trues += SDL_GetHintBoolean(name, SDL_FALSE) ? 1 : 0;
+          }
+          const double ns = secondsSince(start) * 1e9 / READS;
+          return trues >= 0 ? ns : 0.0; // Keep the reads
+     }
+
+     double cachedReads(HintId id)
+     {
+          int trues = 0;
+          const Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < READS; i++)
+          {
+               trues += hintBoolean(id, false) ? 1 : 0;
+          }
+          const double ns = secondsSince(start) * 1e9 / READS;
+          return trues >= 0 ? ns : 0.0;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+#ifdef _WIN32
+     _putenv("HINTBENCH_FROM_ENV=1");
+#else
+     setenv("HINTBENCH_FROM_ENV", "1", 1);
+#endif
+     const char *names[] = {"HINTBENCH_SET", "HINTBENCH_FROM_ENV", "HINTBENCH_UNSET"};
+     const char *labels[] = {"set", "environment", "unset"};
+     SDL_SetHint(names[0], "1");
+     std::printf("%-12s %12s %14s %14s\n", "hint", "others", "SDL ns/read", "cached ns/read");
+     for (int others = 0; others <= OTHER_HINTS; others += OTHER_HINTS)
+     {
+          for (int i = 0; i < others; i++)
+          {
+               char name[32];
+               SDL_snprintf(name, sizeof(name), "HINTBENCH_OTHER_%d", i);
+               SDL_SetHint(name, "1");
+          }
+          for (int h = 0; h < 3; h++)
+          {
+               const HintId id = hintIntern(names[h]);
+               std::printf("%-12s %12d %14.1f %14.1f\n", labels[h], others, sdlReads(names[h]), cachedReads(id));
+          }
+     }
+
+     bool good = true;
+     hintCacheEndFrame();
+     const HintId set = hintIntern(names[0]);
+     SDL_SetHint(names[0], "false");
+     good = !hintBoolean(set, true) && hintChanges(set) == 1 && good;
+     SDL_SetHint(names[0], "42");
+     good = hintInt(set, 0) == 42 && hintBoolean(set, false) && good;
+     SDL_SetHint(names[0], "0x1f");
+     good = hintInt(set, 0) == (int)SDL_strtol("0x1f", nullptr, 0) && good;
+     SDL_SetHint(names[0], "010");
+     good = hintInt(set, 0) == (int)SDL_strtol("010", nullptr, 0) && hintBoolean(set, false) && good;
+     good = hintBoolean(hintIntern(names[1]), false) && !hintBoolean(hintIntern(names[2]), false) && good;
+     good = hintCacheEndFrame() == 3 && good;
+     if (!good)
+     {
+          std::printf("cached hints did not follow SDL's\n");
+     }
+     SDL_Quit();
+     return good ? 0 : 2;
+}
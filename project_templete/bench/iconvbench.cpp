@@ -0,0 +1,201 @@
+// Description:
+// String conversion benchmark, the throughput testiconv.c does not
+// measure. A localization-sized table (mostly ASCII keys and values with
+// some accented, CJK and emoji strings) converted UTF-8 -> UTF-16LE,
+// UTF-16LE -> UTF-8 and UTF-8 -> UTF-32LE, through SDL_iconv_string and
+// through utfConvertString with every utf_convert kernel this CPU supports,
+// printed as MB/s of input. Each kernel is checked first: round trips of
+// the table and of every character class at every offset around the
+// 16-byte lane, the table against SDL's own output, and malformed input
+// (overlong, truncated, surrogate, past U+10FFFF) that must be rejected.
+//
+// Build and run from project_templete/:
+//     make iconvbench && ./iconvbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "utf_convert.h"
+
+namespace
+{
+     const size_t TABLE_BYTES = 4 * 1024 * 1024;
+     const double TARGET_BYTES = 2e8; // Per measurement
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     std::string makeTable(size_t bytes)
+     {
+          static const char *const VALUES[] = {
+              "Start game", "Options", "Quit to desktop", "Press any key to continue",
+              "Caf\xC3\xA9 cr\xC3\xA8me br\xC3\xBBl\xC3\xA9\x65",       // Two-byte
+              "\xE8\xA8\xAD\xE5\xAE\x9A\xE3\x82\x92\xE4\xBF\x9D\xE5\xAD\x98", // Three-byte
+              "High score \xF0\x9F\x8F\x86",                                 // Four-byte
+              "Volume", "Resolution", "Fullscreen", "Controls"};
+          const size_t count = sizeof(VALUES) / sizeof(VALUES[0]);
+          std::string table;
+          table.reserve(bytes + 64);
+          for (size_t i = 0; table.size() < bytes; i++)
+          {
+               table += "menu.entry.";
+               table += std::to_string(i);
+               table += " = ";
+               table += VALUES[i % count];
+               table += "\n";
+          }
+          return table;
+     }
+
+     bool roundTrips(const UtfKernelTable &kernels, const std::string &text)
+     {
+          std::vector<Uint16> utf16(text.size() + 1);
+          std::vector<Uint32> utf32(text.size() + 1);
+          std::vector<char> back(text.size() * 3 + 1);
+          if (!kernels.validate(text.data(), text.size()))
+          {
+               return false;
+          }
+          const size_t units = kernels.utf8ToUtf16(text.data(), text.size(), utf16.data());
+          if (units == UTF_INVALID || kernels.utf16ToUtf8(utf16.data(), units, back.data()) != text.size() ||
+              std::memcmp(back.data(), text.data(), text.size()) != 0)
+          {
+               return false;
+          }
+          const size_t points = kernels.utf8ToUtf32(text.data(), text.size(), utf32.data());
+          return points != UTF_INVALID && kernels.utf32ToUtf8(utf32.data(), points, back.data()) == text.size() &&
+                 std::memcmp(back.data(), text.data(), text.size()) == 0;
+     }
+
+     bool verify(const UtfKernelTable &kernels, const std::string &table)
+     {
+          if (!roundTrips(kernels, table))
+          {
+               std::printf("table does not round trip\n");
+               return false;
+          }
+          // Each character class at every position around the lane
+          const char *const CHARACTERS[] = {"\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80"};
+          for (const char *character : CHARACTERS)
+          {
+               for (size_t at = 0; at < 40; at++)
+               {
+                    std::string text(48, 'a');
+                    text.insert(at, character);
+                    if (!roundTrips(kernels, text))
+                    {
+                         std::printf("%zu-byte character at %zu does not round trip\n", std::strlen(character), at);
+                         return false;
+                    }
+               }
+          }
+          const char *const MALFORMED[] = {"\xC0\xAF", "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80",
+                                           "\xE2\x82", "\x80",         "\xFF",         "\xC3\x28"};
+          for (const char *bad : MALFORMED)
+          {
+               std::string text(20, 'a');
+               text += bad;
+               std::vector<Uint16> utf16(text.size());
+               if (kernels.validate(text.data(), text.size()) ||
+                   kernels.utf8ToUtf16(text.data(), text.size(), utf16.data()) != UTF_INVALID)
+               {
+                    std::printf("malformed input accepted\n");
+                    return false;
+               }
+          }
+          const Uint16 unpaired[] = {'a', 0xD83D, 'b'};
+          char out[16];
+          if (kernels.utf16ToUtf8(unpaired, 3, out) != UTF_INVALID)
+          {
+               std::printf("unpaired surrogate accepted\n");
+               return false;
+          }
+
+          // Same bytes as SDL's own conversion
+          char *ours = utfConvertString("UTF-16LE", "UTF-8", table.data(), table.size());
+          char *theirs = SDL_iconv_string("UTF-16LE", "UTF-8", table.data(), table.size());
+          bool same = ours != nullptr && theirs != nullptr;
+          for (size_t i = 0; same; i += 2)
+          {
+               same = ours[i] == theirs[i] && ours[i + 1] == theirs[i + 1];
+               if (ours[i] == 0 && ours[i + 1] == 0)
+               {
+                    break; // Both ended here
+               }
+          }
+          SDL_free(ours);
+          SDL_free(theirs);
+          if (!same)
+          {
+               std::printf("UTF-16LE output differs from SDL_iconv_string\n");
+          }
+          return same;
+     }
+
+     // MB/s of input for one conversion repeated
+     double measure(const char *to, const char *from, const char *input, size_t bytes, bool sdl)
+     {
+          const int repeats = (int)SDL_max(1.0, TARGET_BYTES / (double)bytes);
+          const Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < repeats; i++)
+          {
+               char *out = sdl ? SDL_iconv_string(to, from, input, bytes) : utfConvertString(to, from, input, bytes);
+               SDL_free(out);
+          }
+          return (double)bytes * repeats / secondsSince(start) / 1e6;
+     }
+
+     void benchRow(const char *name, bool sdl, const std::string &table, const std::vector<char> &utf16)
+     {
+          const double toUtf16 = measure("UTF-16LE", "UTF-8", table.data(), table.size(), sdl);
+          const double fromUtf16 = measure("UTF-8", "UTF-16LE", utf16.data(), utf16.size(), sdl);
+          const double toUtf32 = measure("UTF-32LE", "UTF-8", table.data(), table.size(), sdl);
+          std::printf("%-8s %12.1f %12.1f %12.1f\n", name, toUtf16, fromUtf16, toUtf32);
+     }
+}
+
+int main(int, char *[])
+{
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     const std::string table = makeTable(TABLE_BYTES);
+
+     // The UTF-16 input, kept in a Uint16-aligned buffer
+     utfSetKernel(UTF_KERNEL_SCALAR);
+     std::vector<Uint16> units(table.size());
+     units.resize(utfKernels().utf8ToUtf16(table.data(), table.size(), units.data()));
+     std::vector<char> utf16(units.size() * 2);
+     std::memcpy(utf16.data(), units.data(), utf16.size());
+
+     std::printf("%zu bytes of UTF-8, %zu UTF-16 units\n", table.size(), units.size());
+     std::printf("%-8s %12s %12s %12s\n", "kernel", "8->16 MB/s", "16->8 MB/s", "8->32 MB/s");
+     benchRow("SDL", true, table, utf16);
+     const UtfKernel kernels[] = {UTF_KERNEL_SCALAR, UTF_KERNEL_SSE2};
+     int failures = 0;
+     for (const UtfKernel kernel : kernels)
+     {
+          if (!utfKernelSupported(kernel))
+          {
+               continue;
+          }
+          utfSetKernel(kernel);
+          if (!verify(utfKernels(), table))
+          {
+               std::printf("%s kernels are wrong, skipped\n", utfKernelName(kernel));
+               failures++;
+               continue;
+          }
+          benchRow(utfKernelName(kernel), false, table, utf16);
+     }
+     SDL_Quit();
+     return failures == 0 ? 0 : 2;
+}
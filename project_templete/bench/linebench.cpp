@@ -0,0 +1,182 @@
+// Description:
+// Line drawing benchmark for line_batch. SERIES graphs of POINTS points
+// each (SEGMENTS segments in all) are drawn three ways on the software
+// renderer:
+// - "draw line": one SDL_RenderDrawLineF per segment, like testdraw2;
+// - "draw lines": one SDL_RenderDrawLinesF per graph;
+// - "line batch": lineBatchPolyline per graph, 1.5 px wide and
+//   anti-aliased, and one lineBatchFlush for all of them.
+// For the batch, the tessellation is also timed on its own: that is the
+// CPU cost a GPU renderer pays, while the software renderer's time is
+// mostly its rasterizer filling the triangles. Prints milliseconds per
+// frame (best of five runs of FRAMES frames) and draw calls.
+//
+// Build and run from project_templete/:
+//     make linebench && ./linebench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <vector>
+
+#include "line_batch.h"
+
+namespace
+{
+     const int WIDTH = 1280, HEIGHT = 720;
+     const int SERIES = 100;
+     const int POINTS = 1001;
+     const int SEGMENTS = SERIES * (POINTS - 1);
+     const int FRAMES = 10;
+     const int RUNS = 5;
+     const SDL_Color COLOR = {120, 230, 120, 255};
+
+     Uint32 nextRandom(Uint32 &state)
+     {
+          state ^= state << 13;
+          state ^= state >> 17;
+          state ^= state << 5;
+          return state;
+     }
+
+     // Random walks across the width, one per series, like overlaid graphs
+     void makeSeries(std::vector<SDL_FPoint> &points)
+     {
+          Uint32 state = 0x9E3779B9u;
+          points.resize((size_t)SERIES * POINTS);
+          for (int s = 0; s < SERIES; s++)
+          {
+               float y = (float)(nextRandom(state) % HEIGHT);
+               for (int i = 0; i < POINTS; i++)
+               {
+                    y = SDL_clamp(y + (float)((int)(nextRandom(state) % 21) - 10), 0.0f, (float)(HEIGHT - 1));
+                    points[(size_t)s * POINTS + i] = {(float)i * (WIDTH - 1) / (POINTS - 1), y};
+               }
+          }
+     }
+
+     double msSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+     }
+
+     void clear(SDL_Renderer *renderer)
+     {
+          SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+          SDL_RenderClear(renderer);
+          SDL_SetRenderDrawColor(renderer, COLOR.r, COLOR.g, COLOR.b, COLOR.a);
+     }
+
+     double timeDrawLine(SDL_Renderer *renderer, const std::vector<SDL_FPoint> &points)
+     {
+          double best = 1e30;
+          for (int run = 0; run < RUNS; run++)
+          {
+               const Uint64 start = SDL_GetPerformanceCounter();
+               for (int frame = 0; frame < FRAMES; frame++)
+               {
+                    clear(renderer);
+                    for (int s = 0; s < SERIES; s++)
+                    {
+                         const SDL_FPoint *p = &points[(size_t)s * POINTS];
+                         for (int i = 0; i + 1 < POINTS; i++)
+                         {
+                              SDL_RenderDrawLineF(renderer, p[i].x, p[i].y, p[i + 1].x, p[i + 1].y);
+                         }
+                    }
+                    SDL_RenderFlush(renderer);
+               }
+               best = SDL_min(best, msSince(start) / FRAMES);
+          }
+          return best;
+     }
+
+     double timeDrawLines(SDL_Renderer *renderer, const std::vector<SDL_FPoint> &points)
+     {
+          double best = 1e30;
+          for (int run = 0; run < RUNS; run++)
+          {
+               const Uint64 start = SDL_GetPerformanceCounter();
+               for (int frame = 0; frame < FRAMES; frame++)
+               {
+                    clear(renderer);
+                    for (int s = 0; s < SERIES; s++)
+                    {
+                         SDL_RenderDrawLinesF(renderer, &points[(size_t)s * POINTS], POINTS);
+                    }
+                    SDL_RenderFlush(renderer);
+               }
+               best = SDL_min(best, msSince(start) / FRAMES);
+          }
+          return best;
+     }
+
+     void queueSeries(LineBatch &lines, const std::vector<SDL_FPoint> &points)
+     {
+          for (int s = 0; s < SERIES; s++)
+          {
+               lineBatchPolyline(lines, &points[(size_t)s * POINTS], POINTS, 1.5f, COLOR);
+          }
+     }
+
+     double timeLineBatch(SDL_Renderer *renderer, LineBatch &lines, const std::vector<SDL_FPoint> &points,
+                          double &tessellateMs)
+     {
+          double best = 1e30;
+          tessellateMs = 1e30;
+          for (int run = 0; run < RUNS; run++)
+          {
+               double queued = 0.0;
+               const Uint64 start = SDL_GetPerformanceCounter();
+               for (int frame = 0; frame < FRAMES; frame++)
+               {
+                    clear(renderer);
+                    const Uint64 queueStart = SDL_GetPerformanceCounter();
+                    queueSeries(lines, points);
+                    queued += msSince(queueStart);
+                    lineBatchFlush(lines, renderer);
+                    SDL_RenderFlush(renderer);
+               }
+               best = SDL_min(best, msSince(start) / FRAMES);
+               tessellateMs = SDL_min(tessellateMs, queued / FRAMES);
+          }
+          return best;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(0) != 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+     SDL_Renderer *renderer = target != nullptr ? SDL_CreateSoftwareRenderer(target) : nullptr;
+     if (renderer == nullptr)
+     {
+          std::fprintf(stderr, "Unable to create the software renderer: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     std::vector<SDL_FPoint> points;
+     makeSeries(points);
+     LineBatch lines;
+     lineBatchInit(lines, 1.0f, SEGMENTS);
+
+     std::printf("%d graphs of %d points, %d segments, %dx%d software renderer\n", SERIES, POINTS, SEGMENTS, WIDTH,
+                 HEIGHT);
+     std::printf("  draw line   %6d calls  %8.3f ms\n", SEGMENTS, timeDrawLine(renderer, points));
+     std::printf("  draw lines  %6d calls  %8.3f ms\n", SERIES, timeDrawLines(renderer, points));
+     double tessellateMs;
+     const double batchMs = timeLineBatch(renderer, lines, points, tessellateMs);
+     std::printf("  line batch  %6d calls  %8.3f ms (tessellation %.3f ms, %d vertices)\n", lines.drawCalls, batchMs,
+                 tessellateMs, SEGMENTS * 4 + SERIES * 4);
+
+     SDL_DestroyRenderer(renderer);
+     SDL_FreeSurface(target);
+     SDL_Quit();
+     return 0;
+}
@@ -0,0 +1,252 @@
+// Description:
+// Lock contention benchmark, the testlock.c question asked at 1 to 64
+// threads: how many critical sections per second SDL_mutex and fast_lock
+// get through when every thread hammers the same lock. Two workloads:
+//
+// - exclusive: each section bumps a shared counter, SDL_mutex against
+//   FastMutex.
+// - read-mostly: 95% of sections read a small shared table and 5% rewrite
+//   it, SDL_mutex against RWLock, where the readers may run in parallel.
+//
+// Each case runs for a fixed time and reports the total sections per
+// second over all threads. The shared data is checked afterwards, so a
+// lock that lets two writers in fails loudly rather than looking fast.
+//
+// Build and run from project_templete/:
+//     make lockbench && ./lockbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <vector>
+
+#include "fast_lock.h"
+
+namespace
+{
+     const int THREAD_COUNTS[] = {1, 2, 4, 8, 16, 32, 64};
+     const Uint32 RUN_MS = 300;
+     const int TABLE_SIZE = 16;
+
+     enum LockKind
+     {
+          LOCK_SDL_MUTEX,
+          LOCK_FAST_MUTEX,
+          LOCK_RW
+     };
+
+     struct Shared
+     {
+          LockKind kind;
+          bool readMostly;
+          SDL_mutex *mutex;
+          FastMutex fast;
+          RWLock rw;
+          SDL_atomic_t running;
+          SDL_atomic_t started;
+          long counter;
+          long table[TABLE_SIZE]; // Every entry equal outside a write
+          bool torn;
+     };
+
+     struct Worker
+     {
+          Shared *shared;
+          Uint32 seed;
+          long operations;
+          long writes;
+     };
+
+     void lockExclusive(Shared &shared)
+     {
+          if (shared.kind == LOCK_SDL_MUTEX)
+          {
+               SDL_LockMutex(shared.mutex);
+          }
+          else if (shared.kind == LOCK_FAST_MUTEX)
+          {
+               fastMutexLock(shared.fast);
+          }
+          else
+          {
+               rwLockWriteLock(shared.rw);
+          }
+     }
+
+     void unlockExclusive(Shared &shared)
+     {
+          if (shared.kind == LOCK_SDL_MUTEX)
+          {
+               SDL_UnlockMutex(shared.mutex);
+          }
+          else if (shared.kind == LOCK_FAST_MUTEX)
+          {
+               fastMutexUnlock(shared.fast);
+          }
+          else
+          {
+               rwLockWriteUnlock(shared.rw);
+          }
+     }
+
+     // The mutexes have no shared mode, so readers lock exclusively
+     void lockShared(Shared &shared)
+     {
+          if (shared.kind == LOCK_RW)
+          {
+               rwLockReadLock(shared.rw);
+          }
+          else
+          {
+               lockExclusive(shared);
+          }
+     }
+
+     void unlockShared(Shared &shared)
+     {
+          if (shared.kind == LOCK_RW)
+          {
+               rwLockReadUnlock(shared.rw);
+          }
+          else
+          {
+               unlockExclusive(shared);
+          }
+     }
+
+     int runWorker(void *data)
+     {
+          Worker &worker = *(Worker *)data;
+          Shared &shared = *worker.shared;
+          SDL_AtomicAdd(&shared.started, 1);
+          while (SDL_AtomicGet(&shared.running) == 0)
+          {
+               SDL_Delay(0);
+          }
+          while (SDL_AtomicGet(&shared.running) == 1)
+          {
+               worker.seed = worker.seed * 1664525u + 1013904223u;
+               if (shared.readMostly && (worker.seed >> 16) % 100 >= 5)
+               {
+                    lockShared(shared);
+                    const long first = shared.table[0];
+                    for (int i = 1; i < TABLE_SIZE; i++)
+                    {
+                         if (shared.table[i] != first)
+                         {
+                              shared.torn = true;
+                         }
+                    }
+                    unlockShared(shared);
+               }
+               else
+               {
+                    lockExclusive(shared);
+                    shared.counter++;
+                    if (shared.readMostly)
+                    {
+                         for (int i = 0; i < TABLE_SIZE; i++)
+                         {
+                              shared.table[i]++;
+                         }
+                    }
+                    unlockExclusive(shared);
+                    worker.writes++;
+               }
+               worker.operations++;
+          }
+          return 0;
+     }
+
+     // Sections per second over all threads, or -1 when the check failed
+     double runCase(LockKind kind, bool readMostly, int threadCount)
+     {
+          Shared shared;
+          shared.kind = kind;
+          shared.readMostly = readMostly;
+          shared.mutex = SDL_CreateMutex();
+          fastMutexInit(shared.fast);
+          rwLockInit(shared.rw);
+          SDL_AtomicSet(&shared.running, 0);
+          SDL_AtomicSet(&shared.started, 0);
+          shared.counter = 0;
+          for (long &entry : shared.table)
+          {
+               entry = 0;
+          }
+          shared.torn = false;
+
+          std::vector<Worker> workers(threadCount);
+          std::vector<SDL_Thread *> threads(threadCount);
+          for (int i = 0; i < threadCount; i++)
+          {
+               workers[i] = {&shared, 2463534242u + (Uint32)i * 7919u, 0, 0};
+               threads[i] = SDL_CreateThread(runWorker, "lockbench", &workers[i]);
+          }
+          while (SDL_AtomicGet(&shared.started) < threadCount)
+          {
+               SDL_Delay(1);
+          }
+
+          const Uint64 start = SDL_GetPerformanceCounter();
+          SDL_AtomicSet(&shared.running, 1);
+          SDL_Delay(RUN_MS);
+          SDL_AtomicSet(&shared.running, 2);
+          long operations = 0;
+          long writes = 0;
+          for (int i = 0; i < threadCount; i++)
+          {
+               SDL_WaitThread(threads[i], nullptr);
+               operations += workers[i].operations;
+               writes += workers[i].writes;
+          }
+          const double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+          SDL_DestroyMutex(shared.mutex);
+
+          if (shared.counter != writes || shared.torn)
+          {
+               return -1.0;
+          }
+          return operations / seconds;
+     }
+
+     void printRate(double rate)
+     {
+          if (rate < 0.0)
+          {
+               std::printf(" %12s", "FAILED");
+          }
+          else
+          {
+               std::printf(" %12.2f", rate / 1e6);
+          }
+     }
+}
+
+int main(int, char *[])
+{
+     if (SDL_Init(SDL_INIT_TIMER) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     std::printf("%d CPUs, address wait %s\n", SDL_GetCPUCount(), fastLockHasAddressWait() ? "yes" : "no (yield)");
+     std::printf("%8s | %12s %12s | %12s %12s\n", "", "exclusive", "", "95% read", "");
+     std::printf("%8s | %12s %12s | %12s %12s\n", "threads", "SDL_mutex", "FastMutex", "SDL_mutex", "RWLock");
+     std::printf("%8s | %25s | %25s\n", "", "M sections/s", "M sections/s");
+     for (const int threads : THREAD_COUNTS)
+     {
+          std::printf("%8d |", threads);
+          printRate(runCase(LOCK_SDL_MUTEX, false, threads));
+          printRate(runCase(LOCK_FAST_MUTEX, false, threads));
+          std::printf(" |");
+          printRate(runCase(LOCK_SDL_MUTEX, true, threads));
+          printRate(runCase(LOCK_RW, true, threads));
+          std::printf("\n");
+          std::fflush(stdout);
+     }
+
+     SDL_Quit();
+     return 0;
+}
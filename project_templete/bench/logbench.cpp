@@ -0,0 +1,132 @@
+// Description:
+// Log call benchmark: what a call to SDL_Log costs the calling thread
+// with an output function that takes about 20 us a line (a slow console),
+// written directly, through the ring as text, and through the ring as an
+// asyncLog() record. Also checks every line arrives once, in order and
+// formatted as printf would, and that the rate limit reports what it held
+// back.
+//
+// Build and run from project_templete/:
+//     make logbench && ./logbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstring>
+
+#include "async_log.h"
+
+namespace
+{
+     const int LINES = 2000;
+     const Uint64 OUTPUT_NS = 20000;
+
+     int received = 0;
+     int outOfOrder = 0;
+     int warnings = 0;
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     void SDLCALL slowOutput(void *, int, SDL_LogPriority priority, const char *message)
+     {
+          const Uint64 start = SDL_GetPerformanceCounter();
+          while (secondsSince(start) * 1e9 < OUTPUT_NS)
+          {
+          }
+          if (priority == SDL_LOG_PRIORITY_WARN)
+          {
+               warnings++;
+               return;
+          }
+          int line = -1;
+          if (std::sscanf(message, "line %d", &line) != 1 || line != received)
+          {
+               outOfOrder++;
+          }
+          received++;
+     }
+
+     double run(int mode)
+     {
+          received = 0;
+          const Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < LINES; i++)
+          {
+               if (mode == 2)
+               {
+                    asyncLogInfo(SDL_LOG_CATEGORY_APPLICATION, "line %d of %s, %.2f", i, "logbench", i * 0.5);
+               }
+               else
+               {
+                    SDL_Log("line %d of %s, %.2f", i, "logbench", i * 0.5);
+               }
+          }
+          const double ns = secondsSince(start) * 1e9 / LINES;
+          asyncLogFlush();
+          return ns;
+     }
+
+     bool formats(const char *expected, const char *format, const LogArg *args, int count)
+     {
+          char text[128];
+          asyncLogFormat(text, sizeof(text), format, args, count);
+          if (std::strcmp(text, expected) != 0)
+          {
+               std::printf("formatted \"%s\", expected \"%s\"\n", text, expected);
+               return false;
+          }
+          return true;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     SDL_LogSetOutputFunction(slowOutput, nullptr);
+     bool good = true;
+
+     const double direct = run(0);
+     good = received == LINES && outOfOrder == 0 && good;
+     if (!asyncLogStart(1 << 20))
+     {
+          std::printf("Unable to start the log thread! SDL Error: %s\n", SDL_GetError());
+          return 1;
+     }
+     const double text = run(1);
+     good = received == LINES && outOfOrder == 0 && good;
+     const double structured = run(2);
+     good = received == LINES && outOfOrder == 0 && good;
+     std::printf("%-12s %10s\n", "path", "ns/call");
+     std::printf("%-12s %10.0f\n", "direct", direct);
+     std::printf("%-12s %10.0f\n", "ring text", text);
+     std::printf("%-12s %10.0f\n", "ring record", structured);
+
+     const LogArg args[] = {logArg(-7), logArg(255u), logArg(3.25), logArg("abc"), logArg((const char *)nullptr)};
+     good = formats("-7 ff 3.250 abc (null) 100%", "%d %llx %.3f %s %s 100%%", args, 5) && good;
+     const LogArg widths[] = {logArg(5), logArg(-7), logArg("abc")};
+     good = formats("[   -7] [abc  ] <missing>", "[%*d] [%-5s] %d", widths, 3) && good;
+     good = formats("<mismatch>", "%s", args, 1) && good;
+     const LogArg negatives[] = {logArg(-1), logArg(-1), logArg(-2), logArgUint(0xFFFFFFFFu), logArg(300)};
+     good = formats("ffffffff 4294967295 fe -1 44", "%x %u %hhx %d %hhu", negatives, 5) && good;
+
+     asyncLogSetRateLimit(SDL_LOG_CATEGORY_APPLICATION, 10);
+     warnings = 0;
+     received = 0;
+     for (int i = 0; i < 100; i++)
+     {
+          asyncLogInfo(SDL_LOG_CATEGORY_APPLICATION, "line %d", i);
+     }
+     asyncLogFlush();
+     asyncLogStop();
+     good = received == 10 && warnings >= 1 && good;
+     if (!good)
+     {
+          std::printf("log lines were lost, reordered or misformatted\n");
+     }
+     SDL_Quit();
+     return good ? 0 : 2;
+}
@@ -0,0 +1,143 @@
+// Description:
+// Text measurement benchmark. Measures a synthetic log (timestamps, levels,
+// paths and numbers, with some accented and CJK lines mixed in) once with
+// TTF_SizeUTF8 and TTF_MeasureUTF8, and once with text_measure's tables,
+// and reports lines per second for each. Every result is compared with
+// SDL_ttf's, and mismatching lines are counted and the first few printed.
+//
+// Build and run from project_templete/:
+//     make measurebench && ./measurebench.exe font.ttf [point size]
+// Try both a monospaced font (the multiply path) and a proportional one.
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "text_measure.h"
+
+namespace
+{
+     const int LINES = 20000;
+     const int FIT_WIDTH = 400;
+     const int SHOWN_MISMATCHES = 5;
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     std::vector<std::string> makeLog()
+     {
+          const char *levels[] = {"INFO ", "WARN ", "ERROR", "DEBUG"};
+          const char *messages[] = {"loaded texture assets/ui/panel_%d.png",
+                                    "frame %d took longer than budget",
+                                    "socket closed by peer (code %d)",
+                                    "Überprüfung der Datei %d fehlgeschlagen",
+                                    "読み込み中 %d 件のファイル",
+                                    "player_%d joined the lobby"};
+          std::vector<std::string> lines;
+          srand(1234);
+          for (int i = 0; i < LINES; i++)
+          {
+               char message[128];
+               SDL_snprintf(message, sizeof(message), messages[rand() % SDL_arraysize(messages)], rand() % 100000);
+               char line[192];
+               SDL_snprintf(line, sizeof(line), "12:%02d:%02d.%03d [%s] %s", (i / 60000) % 60, (i / 1000) % 60, i % 1000,
+                            levels[rand() % SDL_arraysize(levels)], message);
+               lines.push_back(line);
+          }
+          return lines;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     if (argc < 2)
+     {
+          std::fprintf(stderr, "usage: measurebench font.ttf [point size]\n");
+          return 1;
+     }
+     if (SDL_Init(0) < 0 || TTF_Init() < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     const int pointSize = argc > 2 ? SDL_atoi(argv[2]) : 16;
+     TTF_Font *font = TTF_OpenFont(argv[1], pointSize);
+     if (font == nullptr)
+     {
+          std::fprintf(stderr, "Unable to open %s: %s\n", argv[1], TTF_GetError());
+          return 1;
+     }
+     const std::vector<std::string> lines = makeLog();
+
+     Uint64 start = SDL_GetPerformanceCounter();
+     TextMeasure measure;
+     textMeasureInit(measure, font);
+     const double initSeconds = secondsSince(start);
+     std::printf("%s at %d pt: %s, %s\n", argv[1], pointSize, measure.fixedAdvance > 0 ? "fixed width" : "proportional",
+                 measure.kerning ? "kerned" : "not kerned");
+     std::printf("table setup %.2f ms, %d lines\n\n", initSeconds * 1000.0, LINES);
+
+     std::vector<int> slowWidths(LINES), slowExtents(LINES), slowCounts(LINES);
+     start = SDL_GetPerformanceCounter();
+     for (int i = 0; i < LINES; i++)
+     {
+          int h;
+          TTF_SizeUTF8(font, lines[i].c_str(), &slowWidths[i], &h);
+     }
+     const double slowSize = secondsSince(start);
+     start = SDL_GetPerformanceCounter();
+     for (int i = 0; i < LINES; i++)
+     {
+          TTF_MeasureUTF8(font, lines[i].c_str(), FIT_WIDTH, &slowExtents[i], &slowCounts[i]);
+     }
+     const double slowFit = secondsSince(start);
+
+     // The first pass also fills the non-ASCII table; time the steady state
+     std::vector<int> fastWidths(LINES), fastExtents(LINES), fastCounts(LINES);
+     for (int i = 0; i < LINES; i++)
+     {
+          textMeasureSize(measure, lines[i].c_str(), &fastWidths[i], nullptr);
+     }
+     start = SDL_GetPerformanceCounter();
+     for (int i = 0; i < LINES; i++)
+     {
+          textMeasureSize(measure, lines[i].c_str(), &fastWidths[i], nullptr);
+     }
+     const double fastSize = secondsSince(start);
+     start = SDL_GetPerformanceCounter();
+     for (int i = 0; i < LINES; i++)
+     {
+          textMeasureFit(measure, lines[i].c_str(), FIT_WIDTH, &fastExtents[i], &fastCounts[i]);
+     }
+     const double fastFit = secondsSince(start);
+
+     std::printf("%-22s %14s %14s %8s\n", "", "TTF lines/s", "table lines/s", "speedup");
+     std::printf("%-22s %14.0f %14.0f %7.1fx\n", "size", LINES / slowSize, LINES / fastSize, slowSize / fastSize);
+     std::printf("%-22s %14.0f %14.0f %7.1fx\n", "measure (400 px)", LINES / slowFit, LINES / fastFit, slowFit / fastFit);
+
+     int mismatches = 0;
+     for (int i = 0; i < LINES; i++)
+     {
+          if (slowWidths[i] != fastWidths[i] || slowExtents[i] != fastExtents[i] || slowCounts[i] != fastCounts[i])
+          {
+               if (mismatches < SHOWN_MISMATCHES)
+               {
+                    std::printf("mismatch: \"%s\" size %d/%d, fit %d,%d/%d,%d\n", lines[i].c_str(), slowWidths[i],
+                                fastWidths[i], slowExtents[i], slowCounts[i], fastExtents[i], fastCounts[i]);
+               }
+               mismatches++;
+          }
+     }
+     std::printf("\n%d of %d lines differ from SDL_ttf, %d glyph loads\n", mismatches, LINES, measure.glyphLoads);
+
+     TTF_CloseFont(font);
+     TTF_Quit();
+     SDL_Quit();
+     return mismatches == 0 ? 0 : 2;
+}
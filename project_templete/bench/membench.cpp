@@ -0,0 +1,147 @@
+// Description:
+// Memory kernel benchmark, the throughput numbers testautomation_stdlib.c
+// does not measure. Copies, 32-bit fills and string lengths at 64 B, 4 KB
+// and 4 MB, through SDL_memcpy / SDL_memset4 / SDL_strlen and every
+// mem_kernels kernel this CPU supports, printed as GB/s. Each kernel's
+// output is checked against the C library's first, at misaligned offsets
+// and odd sizes around every threshold.
+//
+// Build and run from project_templete/:
+//     make membench && ./membench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "mem_kernels.h"
+
+namespace
+{
+     const size_t SIZES[] = {64, 4096, 4 * 1024 * 1024};
+     const double TARGET_BYTES = 2e9; // Per measurement, so small sizes repeat enough
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     bool verify(const MemKernelTable &kernels)
+     {
+          std::vector<Uint8> src(MEM_STREAMING_BYTES * 2 + 256), dst(src.size()), expected(src.size());
+          for (size_t i = 0; i < src.size(); i++)
+          {
+               src[i] = (Uint8)(i * 131 + 7);
+          }
+          const size_t sizes[] = {0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128, 129, 1000, 4096,
+                                  MEM_STREAMING_BYTES - 1, MEM_STREAMING_BYTES, MEM_STREAMING_BYTES + 77};
+          for (const size_t size : sizes)
+          {
+               for (size_t offset = 0; offset < 8; offset += 3)
+               {
+                    std::memset(dst.data(), 0xCD, dst.size());
+                    std::memset(expected.data(), 0xCD, expected.size());
+                    kernels.copy(dst.data() + offset, src.data() + 5, size);
+                    std::memcpy(expected.data() + offset, src.data() + 5, size);
+                    if (dst != expected)
+                    {
+                         std::printf("copy of %zu bytes at offset %zu is wrong\n", size, offset);
+                         return false;
+                    }
+                    const size_t words = size / 4;
+                    kernels.fill32(dst.data() + offset * 4, 0x11223344u, words);
+                    SDL_memset4(expected.data() + offset * 4, 0x11223344u, words);
+                    if (dst != expected)
+                    {
+                         std::printf("fill of %zu words at offset %zu is wrong\n", words, offset * 4);
+                         return false;
+                    }
+               }
+          }
+          std::vector<char> text(5000, 'x');
+          for (size_t start = 0; start < 40; start++)
+          {
+               for (size_t length = 0; length < 100; length += 7)
+               {
+                    text[start + length] = '\0';
+                    const size_t got = kernels.length(text.data() + start);
+                    text[start + length] = 'x';
+                    if (got != length)
+                    {
+                         std::printf("length %zu at offset %zu measured %zu\n", length, start, got);
+                         return false;
+                    }
+               }
+          }
+          return true;
+     }
+
+     // GB/s of `op` repeated over `bytes`-sized buffers
+     template <typename Op> double measure(size_t bytes, Op op)
+     {
+          const int repeats = (int)SDL_max(1.0, TARGET_BYTES / (double)bytes);
+          op(); // Warm caches and pages
+          const Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < repeats; i++)
+          {
+               op();
+          }
+          return (double)bytes * repeats / secondsSince(start) / 1e9;
+     }
+
+     void benchRow(const char *name, const MemKernelTable *kernels)
+     {
+          for (const size_t bytes : SIZES)
+          {
+               std::vector<Uint8> src(bytes, 1), dst(bytes);
+               std::vector<char> text(bytes, 'a');
+               text[bytes - 1] = '\0';
+               volatile size_t sink = 0;
+               double copy, fill, length;
+               if (kernels == nullptr)
+               {
+                    copy = measure(bytes, [&] { SDL_memcpy(dst.data(), src.data(), bytes); });
+                    fill = measure(bytes, [&] { SDL_memset4(dst.data(), 0xFF00FF00u, bytes / 4); });
+                    length = measure(bytes, [&] { sink = sink + SDL_strlen(text.data()); });
+               }
+               else
+               {
+                    copy = measure(bytes, [&] { kernels->copy(dst.data(), src.data(), bytes); });
+                    fill = measure(bytes, [&] { kernels->fill32(dst.data(), 0xFF00FF00u, bytes / 4); });
+                    length = measure(bytes, [&] { sink = sink + kernels->length(text.data()); });
+               }
+               std::printf("%-8s %9zu %10.2f %10.2f %10.2f\n", name, bytes, copy, fill, length);
+          }
+     }
+}
+
+int main(int, char *[])
+{
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     std::printf("%-8s %9s %10s %10s %10s\n", "kernel", "bytes", "copy GB/s", "fill GB/s", "strlen GB/s");
+     benchRow("SDL", nullptr);
+     const MemKernel kernels[] = {MEM_KERNEL_LIBC, MEM_KERNEL_SSE2, MEM_KERNEL_AVX2, MEM_KERNEL_NEON};
+     int failures = 0;
+     for (const MemKernel kernel : kernels)
+     {
+          if (!memKernelSupported(kernel))
+          {
+               continue;
+          }
+          memSetKernel(kernel);
+          if (!verify(memKernels()))
+          {
+               std::printf("%s kernels are wrong, skipped\n", memKernelName(kernel));
+               failures++;
+               continue;
+          }
+          benchRow(memKernelName(kernel), &memKernels());
+     }
+     SDL_Quit();
+     return failures == 0 ? 0 : 2;
+}
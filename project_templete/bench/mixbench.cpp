@@ -0,0 +1,119 @@
+// Description:
+// Voice mixer microbenchmark. Mixes looping noise voices into 2048-frame
+// 44.1 kHz stereo buffers with every kernel this CPU supports, checks each
+// kernel against the scalar reference and reports how many voices fit in
+// one buffer period (the audio thread's hard deadline) and in a quarter of
+// it (a comfortable steady-state budget).
+//
+// Build and run from project_templete/:  make mixbench && ./mixbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "voice_mixer.h"
+
+namespace
+{
+     const int BUFFER_FRAMES = 2048;
+     const int SAMPLE_RATE = 44100;
+     const int BENCH_VOICES = 256;
+     const int ITERATIONS = 200;
+
+     // Render `iterations` buffers and return the average seconds per buffer
+     double timeRender(VoiceMixer &mixer, std::vector<Sint16> &out, int iterations)
+     {
+          Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < iterations; i++)
+          {
+               std::fill(out.begin(), out.end(), (Sint16)0);
+               voiceMixerRender(mixer, out.data(), BUFFER_FRAMES);
+          }
+          Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+          return (double)elapsed / SDL_GetPerformanceFrequency() / iterations;
+     }
+
+     void startVoices(VoiceMixer &mixer, const Mix_Chunk &chunk)
+     {
+          for (int i = 0; i < (int)mixer.voices.size(); i++)
+          {
+               // Quiet, spread-out voices so the sum stays in range
+               int voice = voiceMixerPlay(mixer, &chunk, -1, (Uint8)(255 - i % 256), (Uint8)(i % 256));
+               voiceMixerVolume(mixer, voice, 8);
+          }
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     // One second of stereo noise, slightly off the buffer size so voices
+     // wrap at different points within a buffer
+     std::vector<Sint16> noise((SAMPLE_RATE + 37) * 2);
+     std::srand(1);
+     for (Sint16 &sample : noise)
+     {
+          sample = (Sint16)(std::rand() % 65536 - 32768);
+     }
+     Mix_Chunk chunk;
+     chunk.allocated = 0;
+     chunk.abuf = (Uint8 *)noise.data();
+     chunk.alen = (Uint32)(noise.size() * sizeof(Sint16));
+     chunk.volume = MIX_MAX_VOLUME;
+
+     const double period = (double)BUFFER_FRAMES / SAMPLE_RATE;
+     std::printf("buffer: %d frames @ %d Hz = %.1f ms, %d voices\n\n", BUFFER_FRAMES, SAMPLE_RATE, period * 1000.0,
+                 BENCH_VOICES);
+     std::printf("%-8s %12s %12s %14s %14s %10s\n", "kernel", "ms/buffer", "us/voice", "voices@100%", "voices@25%",
+                 "max err");
+
+     std::vector<Sint16> reference(BUFFER_FRAMES * 2);
+     {
+          VoiceMixer scalar;
+          voiceMixerInit(scalar, BENCH_VOICES, VOICE_KERNEL_SCALAR);
+          startVoices(scalar, chunk);
+          voiceMixerRender(scalar, reference.data(), BUFFER_FRAMES);
+     }
+
+     const VoiceMixerKernel kernels[] = {VOICE_KERNEL_SCALAR, VOICE_KERNEL_SSE2, VOICE_KERNEL_AVX2,
+                                         VOICE_KERNEL_NEON};
+     for (VoiceMixerKernel kernel : kernels)
+     {
+          if (!voiceMixerKernelSupported(kernel))
+          {
+               continue;
+          }
+          VoiceMixer mixer;
+          voiceMixerInit(mixer, BENCH_VOICES, kernel);
+          startVoices(mixer, chunk);
+
+          // First buffer from the same start position as the reference
+          std::vector<Sint16> out(BUFFER_FRAMES * 2, 0);
+          voiceMixerRender(mixer, out.data(), BUFFER_FRAMES);
+          int maxError = 0;
+          for (size_t i = 0; i < out.size(); i++)
+          {
+               maxError = SDL_max(maxError, SDL_abs(out[i] - reference[i]));
+          }
+
+          timeRender(mixer, out, ITERATIONS / 10); // Warm up
+          double seconds = timeRender(mixer, out, ITERATIONS);
+          double perVoice = seconds / BENCH_VOICES;
+          std::printf("%-8s %12.3f %12.1f %14d %14d %10d\n", voiceMixerKernelName(kernel), seconds * 1000.0,
+                      perVoice * 1e6, (int)(period / perVoice),
+                      (int)(period * 0.25 / perVoice), maxError);
+     }
+
+     SDL_Quit();
+     return 0;
+}
@@ -0,0 +1,480 @@
+#include "perf_harness.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cpu_topology.h"
+
+namespace
+{
+     // Two-sided 95% normal quantile; past a few samples Student's t is close
+     const double CONFIDENCE_Z = 1.96;
+
+     struct CaseResult
+     {
+          double medianNs;
+          double meanNs;
+          double halfWidthNs; // 95% confidence interval of the mean
+          int samples;
+          Sint64 iterations;  // Per sample
+          bool converged;
+     };
+
+     // One line of the JSON report
+     struct ReportCase
+     {
+          std::string name;
+          const char *description;
+          CaseResult result;
+          double gigabytesPerSecond; // 0 for none
+          double baselineNs;         // 0 for none
+          const char *verdict;       // "slower", "faster", "same" or "new"
+     };
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     double timeCall(const PerfCaseReference &perfCase, void *arg, int iterations)
+     {
+          const Uint64 start = SDL_GetPerformanceCounter();
+          perfCase.run(arg, iterations);
+          return secondsSince(start);
+     }
+
+     CaseResult measure(const PerfCaseReference &perfCase, void *arg, const PerfOptions &options)
+     {
+          const Uint64 warmupStart = SDL_GetPerformanceCounter();
+          int iterations = 1;
+          double seconds = timeCall(perfCase, arg, iterations);
+          while (secondsSince(warmupStart) * 1000.0 < options.warmupMs)
+          {
+               seconds = timeCall(perfCase, arg, iterations);
+          }
+
+          // Calibrate; the doubling stops short of int overflow
+          while (seconds * 1000.0 < options.sampleMs && iterations < (1 << 29))
+          {
+               iterations *= 2;
+               seconds = timeCall(perfCase, arg, iterations);
+          }
+
+          std::vector<double> samples;
+          double sum = 0.0, sumSquares = 0.0, halfWidth = 0.0;
+          bool converged = false;
+          const Uint64 start = SDL_GetPerformanceCounter();
+          while ((int)samples.size() < options.maxSamples)
+          {
+               const double ns = timeCall(perfCase, arg, iterations) * 1e9 / iterations;
+               samples.push_back(ns);
+               sum += ns;
+               sumSquares += ns * ns;
+               const int n = (int)samples.size();
+               if (n >= 2)
+               {
+                    const double mean = sum / n;
+                    const double variance = SDL_max(0.0, (sumSquares - n * mean * mean) / (n - 1));
+                    halfWidth = CONFIDENCE_Z * std::sqrt(variance / n);
+                    if (n >= options.minSamples && halfWidth <= options.precision * mean)
+                    {
+                         converged = true;
+                         break;
+                    }
+               }
+               if (n >= options.minSamples && secondsSince(start) * 1000.0 > options.budgetMs)
+               {
+                    break;
+               }
+          }
+
+          CaseResult result;
+          result.samples = (int)samples.size();
+          result.meanNs = sum / result.samples;
+          result.halfWidthNs = halfWidth;
+          std::sort(samples.begin(), samples.end());
+          result.medianNs = samples[samples.size() / 2];
+          result.iterations = iterations;
+          result.converged = converged;
+          return result;
+     }
+
+     std::map<std::string, double> loadBaseline(const char *path)
+     {
+          std::map<std::string, double> baseline;
+          std::FILE *file = path != nullptr ? std::fopen(path, "r") : nullptr;
+          if (file == nullptr)
+          {
+               if (path != nullptr)
+               {
+                    std::printf("no baseline at %s, nothing to compare\n", path);
+               }
+               return baseline;
+          }
+          char name[256];
+          double ns;
+          while (std::fscanf(file, "%255s %lf", name, &ns) == 2)
+          {
+               baseline[name] = ns;
+          }
+          std::fclose(file);
+          return baseline;
+     }
+
+     bool matches(const PerfOptions &options, const std::string &name)
+     {
+          return options.filter == nullptr || name.find(options.filter) != std::string::npos;
+     }
+
+     int casesToRun(const PerfSuiteReference &suite, const PerfOptions &options)
+     {
+          int count = 0;
+          for (int c = 0; suite.cases[c] != nullptr; c++)
+          {
+               const PerfCaseReference &perfCase = *suite.cases[c];
+               count += perfCase.enabled && matches(options, std::string(suite.name) + "/" + perfCase.name) ? 1 : 0;
+          }
+          return count;
+     }
+
+     // Which shard runs suite `s`: the one whose slice of the case count
+     // the suite's first case falls in, so no suite is split
+     int shardOf(const PerfSuiteReference *suites[], int s, const PerfOptions &options)
+     {
+          int before = 0, total = 0;
+          for (int i = 0; suites[i] != nullptr; i++)
+          {
+               const int count = casesToRun(*suites[i], options);
+               before += i < s ? count : 0;
+               total += count;
+          }
+          return total == 0 ? 0 : (int)((Sint64)before * options.shardCount / total);
+     }
+
+     // FNV-1a, chained
+     Uint64 hashText(Uint64 hash, const char *text)
+     {
+          for (; *text != '\0'; text++)
+          {
+               hash = (hash ^ (Uint8)*text) * 0x100000001b3ull;
+          }
+          return hash;
+     }
+
+     // Names and descriptions are plain text, but a quote must not break the file
+     std::string jsonText(const char *text)
+     {
+          std::string escaped = "\"";
+          for (; text != nullptr && *text != '\0'; text++)
+          {
+               if (*text == '"' || *text == '\\')
+               {
+                    escaped += '\\';
+               }
+               if ((Uint8)*text >= 0x20)
+               {
+                    escaped += *text;
+               }
+          }
+          return escaped + "\"";
+     }
+
+     void writeMachine(std::FILE *out)
+     {
+          SDL_version linked;
+          SDL_GetVersion(&linked);
+          const CpuTopology &topology = cpuTopology();
+          std::fprintf(out, "  \"machine\": {\n");
+          std::fprintf(out, "    \"platform\": %s,\n", jsonText(SDL_GetPlatform()).c_str());
+          std::fprintf(out, "    \"sdl\": \"%d.%d.%d\",\n", linked.major, linked.minor, linked.patch);
+          std::fprintf(out, "    \"ram_mb\": %d,\n", SDL_GetSystemRAM());
+          std::fprintf(out, "    \"logical_cpus\": %d,\n", topology.logicalCount);
+          std::fprintf(out, "    \"physical_cores\": %d,\n", topology.physicalCount);
+          std::fprintf(out, "    \"hybrid\": %s,\n", topology.hybrid ? "true" : "false");
+          std::fprintf(out, "    \"performance_cores\": %d,\n", topology.performanceCores);
+          std::fprintf(out, "    \"efficiency_cores\": %d,\n", topology.efficiencyCores);
+          std::fprintf(out, "    \"numa_nodes\": %d,\n", topology.nodeCount);
+          std::fprintf(out, "    \"cache_line_bytes\": %d,\n", topology.cacheLineBytes);
+          std::fprintf(out, "    \"l1d_bytes\": %d,\n", topology.l1DataBytes);
+          std::fprintf(out, "    \"l2_bytes\": %d,\n", topology.l2Bytes);
+          std::fprintf(out, "    \"l3_bytes\": %d,\n", topology.l3Bytes);
+          std::fprintf(out, "    \"features\": [");
+          const struct
+          {
+               const char *name;
+               SDL_bool present;
+          } features[] = {{"sse2", SDL_HasSSE2()},     {"sse41", SDL_HasSSE41()}, {"avx", SDL_HasAVX()},
+                          {"avx2", SDL_HasAVX2()},     {"avx512f", SDL_HasAVX512F()}, {"neon", SDL_HasNEON()},
+                          {"altivec", SDL_HasAltiVec()}};
+          bool first = true;
+          for (const auto &feature : features)
+          {
+               if (feature.present)
+               {
+                    std::fprintf(out, "%s\"%s\"", first ? "" : ", ", feature.name);
+                    first = false;
+               }
+          }
+          std::fprintf(out, "]\n  },\n");
+     }
+
+     bool writeReport(const char *path, const PerfOptions &options, const std::vector<ReportCase> &report,
+                      int regressions, int improvements, int failures)
+     {
+          std::FILE *out = std::fopen(path, "w");
+          if (out == nullptr)
+          {
+               return false;
+          }
+          std::fprintf(out, "{\n");
+          writeMachine(out);
+          std::fprintf(out, "  \"seed\": %s,\n", options.seed != nullptr ? jsonText(options.seed).c_str() : "null");
+          std::fprintf(out, "  \"shard\": \"%d/%d\",\n", options.shard, options.shardCount);
+          std::fprintf(out, "  \"baseline\": %s,\n",
+                       options.baselinePath != nullptr ? jsonText(options.baselinePath).c_str() : "null");
+          std::fprintf(out, "  \"precision\": %.4f,\n", options.precision);
+          std::fprintf(out, "  \"tolerance\": %.4f,\n", options.tolerance);
+          std::fprintf(out, "  \"cases\": [");
+          for (size_t i = 0; i < report.size(); i++)
+          {
+               const ReportCase &row = report[i];
+               std::fprintf(out, "%s\n    {\"name\": %s, \"description\": %s, ", i == 0 ? "" : ",",
+                            jsonText(row.name.c_str()).c_str(), jsonText(row.description).c_str());
+               std::fprintf(out, "\"median_ns\": %.4f, \"mean_ns\": %.4f, \"ci95_ns\": %.4f, ", row.result.medianNs,
+                            row.result.meanNs, row.result.halfWidthNs);
+               std::fprintf(out, "\"samples\": %d, \"iterations\": %lld, \"converged\": %s, ", row.result.samples,
+                            (long long)row.result.iterations, row.result.converged ? "true" : "false");
+               if (row.gigabytesPerSecond > 0.0)
+               {
+                    std::fprintf(out, "\"gb_per_s\": %.4f, ", row.gigabytesPerSecond);
+               }
+               else
+               {
+                    std::fprintf(out, "\"gb_per_s\": null, ");
+               }
+               if (row.baselineNs > 0.0)
+               {
+                    std::fprintf(out, "\"baseline_ns\": %.4f, \"change\": %.4f, ", row.baselineNs,
+                                 row.result.medianNs / row.baselineNs - 1.0);
+               }
+               else
+               {
+                    std::fprintf(out, "\"baseline_ns\": null, \"change\": null, ");
+               }
+               std::fprintf(out, "\"verdict\": \"%s\"}", row.verdict);
+          }
+          std::fprintf(out, "\n  ],\n");
+          std::fprintf(out, "  \"regressions\": %d,\n  \"improvements\": %d,\n  \"failed_setups\": %d,\n", regressions,
+                       improvements, failures);
+          std::fprintf(out, "  \"ok\": %s\n}\n", regressions + failures == 0 ? "true" : "false");
+          return std::fclose(out) == 0;
+     }
+
+     Uint64 randomState = 1;
+
+     void seedRandom(const PerfOptions &options, const char *suite)
+     {
+          Uint64 hash = hashText(0xcbf29ce484222325ull, options.seed != nullptr ? options.seed : "");
+          hash = hashText(hash ^ '/', suite);
+          randomState = hash != 0 ? hash : 1;
+     }
+}
+
+PerfOptions perfDefaultOptions()
+{
+     PerfOptions options;
+     options.warmupMs = 100;
+     options.sampleMs = 2.0;
+     options.minSamples = 10;
+     options.maxSamples = 200;
+     options.precision = 0.01;
+     options.budgetMs = 2000;
+     options.tolerance = 0.10;
+     options.filter = nullptr;
+     options.baselinePath = nullptr;
+     options.savePath = nullptr;
+     options.shard = 0;
+     options.shardCount = 1;
+     options.seed = nullptr;
+     options.jsonPath = nullptr;
+     return options;
+}
+
+bool perfParseArguments(PerfOptions &options, int argc, char *argv[])
+{
+     for (int i = 1; i < argc; i++)
+     {
+          const bool hasValue = i + 1 < argc;
+          if (std::strcmp(argv[i], "--quick") == 0)
+          {
+               options.warmupMs = 20;
+               options.sampleMs = 0.5;
+               options.minSamples = 5;
+               options.maxSamples = 30;
+               options.precision = 0.05;
+               options.budgetMs = 250;
+          }
+          else if (std::strcmp(argv[i], "--filter") == 0 && hasValue)
+          {
+               options.filter = argv[++i];
+          }
+          else if (std::strcmp(argv[i], "--baseline") == 0 && hasValue)
+          {
+               options.baselinePath = argv[++i];
+          }
+          else if (std::strcmp(argv[i], "--save-baseline") == 0 && hasValue)
+          {
+               options.savePath = argv[++i];
+          }
+          else if (std::strcmp(argv[i], "--tolerance") == 0 && hasValue)
+          {
+               options.tolerance = std::atof(argv[++i]) / 100.0;
+          }
+          else if (std::strcmp(argv[i], "--shard") == 0 && hasValue &&
+                   std::sscanf(argv[i + 1], "%d/%d", &options.shard, &options.shardCount) == 2 &&
+                   options.shardCount > 0 && options.shard >= 0 && options.shard < options.shardCount)
+          {
+               i++;
+          }
+          else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+          {
+               options.seed = argv[++i];
+          }
+          else if (std::strcmp(argv[i], "--json") == 0 && hasValue)
+          {
+               options.jsonPath = argv[++i];
+          }
+          else
+          {
+               std::fprintf(stderr, "usage: %s [--quick] [--filter NAME] [--baseline PATH] [--save-baseline PATH] "
+                                    "[--tolerance PERCENT] [--shard K/N] [--seed TEXT] [--json PATH]\n", argv[0]);
+               return false;
+          }
+     }
+     return true;
+}
+
+int perfRunSuites(const PerfSuiteReference *suites[], const PerfOptions &options)
+{
+     const std::map<std::string, double> baseline = loadBaseline(options.baselinePath);
+     std::FILE *save = options.savePath != nullptr ? std::fopen(options.savePath, "w") : nullptr;
+     if (options.savePath != nullptr && save == nullptr)
+     {
+          std::fprintf(stderr, "cannot write %s\n", options.savePath);
+     }
+
+     int failures = 0, regressions = 0, improvements = 0, cases = 0;
+     std::vector<ReportCase> report;
+     if (options.seed != nullptr || options.shardCount > 1)
+     {
+          std::printf("seed %s, shard %d/%d\n", options.seed != nullptr ? options.seed : "-", options.shard,
+                      options.shardCount);
+     }
+     std::printf("%-36s %12s %10s %8s %8s %10s\n", "suite/case", "median ns", "+-95% ns", "samples", "GB/s",
+                 "vs base");
+     for (int s = 0; suites[s] != nullptr; s++)
+     {
+          const PerfSuiteReference &suite = *suites[s];
+          if (options.shardCount > 1 && shardOf(suites, s, options) != options.shard)
+          {
+               continue;
+          }
+          for (int c = 0; suite.cases[c] != nullptr; c++)
+          {
+               const PerfCaseReference &perfCase = *suite.cases[c];
+               const std::string name = std::string(suite.name) + "/" + perfCase.name;
+               if (!perfCase.enabled || !matches(options, name))
+               {
+                    continue;
+               }
+
+               seedRandom(options, suite.name);
+               void *arg = suite.setUp != nullptr ? suite.setUp() : nullptr;
+               if (suite.setUp != nullptr && arg == nullptr)
+               {
+                    std::printf("%-36s set-up failed: %s\n", name.c_str(), SDL_GetError());
+                    failures++;
+                    continue;
+               }
+               const CaseResult result = measure(perfCase, arg, options);
+               if (suite.tearDown != nullptr)
+               {
+                    suite.tearDown(arg);
+               }
+               cases++;
+
+               ReportCase row = {name, perfCase.description, result, 0.0, 0.0, "new"};
+               char rate[16] = "-";
+               if (perfCase.bytesPerIteration > 0)
+               {
+                    row.gigabytesPerSecond = perfCase.bytesPerIteration / result.medianNs;
+                    SDL_snprintf(rate, sizeof(rate), "%.2f", row.gigabytesPerSecond);
+               }
+               char versus[32] = "-";
+               const auto stored = baseline.find(name);
+               if (stored != baseline.end() && stored->second > 0.0)
+               {
+                    const double change = result.medianNs / stored->second - 1.0;
+                    const bool slower = change > options.tolerance;
+                    const bool faster = change < -options.tolerance;
+                    SDL_snprintf(versus, sizeof(versus), "%+.1f%%%s", change * 100.0,
+                                 slower ? " SLOWER" : faster ? " faster" : "");
+                    regressions += slower ? 1 : 0;
+                    improvements += faster ? 1 : 0;
+                    row.baselineNs = stored->second;
+                    row.verdict = slower ? "slower" : faster ? "faster" : "same";
+               }
+               report.push_back(row);
+               std::printf("%-36s %12.2f %10.2f %7d%s %8s %10s\n", name.c_str(), result.medianNs, result.halfWidthNs,
+                           result.samples, result.converged ? " " : "*", rate, versus);
+               std::fflush(stdout);
+               if (save != nullptr)
+               {
+                    std::fprintf(save, "%s %.4f\n", name.c_str(), result.medianNs);
+               }
+          }
+     }
+     if (save != nullptr)
+     {
+          std::fclose(save);
+     }
+
+     std::printf("%d cases, * = stopped before the interval reached %.0f%%", cases, options.precision * 100.0);
+     if (!baseline.empty())
+     {
+          std::printf("; %d slower and %d faster than the baseline by over %.0f%%", regressions, improvements,
+                      options.tolerance * 100.0);
+     }
+     std::printf("\n");
+     if (options.jsonPath != nullptr && !writeReport(options.jsonPath, options, report, regressions, improvements, failures))
+     {
+          std::fprintf(stderr, "cannot write %s\n", options.jsonPath);
+          failures++;
+     }
+     return regressions + failures;
+}
+
+Uint32 perfRandom()
+{
+     // xorshift64*
+     randomState ^= randomState >> 12;
+     randomState ^= randomState << 25;
+     randomState ^= randomState >> 27;
+     return (Uint32)((randomState * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+void perfKeep(const void *value)
+{
+#if defined(__GNUC__)
+     __asm__ __volatile__("" : : "r"(value) : "memory");
+#else
+     static const void *volatile sink;
+     sink = value;
+#endif
+}
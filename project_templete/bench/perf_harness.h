@@ -0,0 +1,98 @@
+// Description:
+// Benchmark test cases in the shape of SDL_test_harness.h. SDLTest
+// suites hold correctness cases that pass or fail once; a PerfCase
+// instead runs its body `iterations` times per call and the harness
+// decides how often to call it:
+//
+// - warm-up: the case runs untimed for PerfOptions::warmupMs first, so
+//   caches, branch predictors and lazily built tables settle;
+// - calibration: iterations per sample double until one sample takes
+//   PerfOptions::sampleMs, which keeps timer resolution out of it;
+// - statistical stopping: samples repeat until the 95% confidence
+//   interval of their mean is within PerfOptions::precision of it, or
+//   maxSamples or the time budget runs out;
+// - baselines: each case's median is compared with the one stored for
+//   it, and one that got slower by more than PerfOptions::tolerance is
+//   reported as a regression, which fails the run.
+//
+// Suites are registered the way SDLTest_TestSuiteReference does it:
+// null-terminated arrays of references, with optional set-up and
+// tear-down around each case. Baseline files are plain text, one
+// "suite/case median_ns" pair per line, written by --save-baseline.
+// Baselines only compare runs on the same machine and build.
+//
+// --json PATH also writes the run as one JSON report: the machine (SDL
+// version, platform, CPU features and cpu_topology.h's cores and caches),
+// then each case's statistics next to its baseline median and verdict,
+// for dashboards that track runs over time and across machines.
+//
+// For parallel runs (bench/perfshard.cpp), --shard K/N runs the K-th of N
+// contiguous slices of the suites, cut so each holds about as many cases;
+// concatenating the shards' output in order gives the serial run's order.
+// --seed TEXT seeds perfRandom(), which every suite's set-up draws its
+// input from. The state is reset from the seed and the suite's name before
+// each set-up, so a case sees the same data whichever shard runs it.
+// =============================================================================
+
+#ifndef PERF_HARNESS_H
+#define PERF_HARNESS_H
+
+#include <SDL2/SDL.h>
+
+// Run the measured body `iterations` times. `arg` comes from the suite's
+// set-up; a case with nothing to set up gets nullptr
+typedef void (*PerfCaseFunction)(void *arg, int iterations);
+
+struct PerfCaseReference
+{
+     PerfCaseFunction run;
+     const char *name;
+     const char *description;
+     Uint64 bytesPerIteration; // For a GB/s column, 0 for none
+     bool enabled;
+};
+
+struct PerfSuiteReference
+{
+     const char *name;
+     void *(*setUp)();          // May be nullptr; returns the cases' arg
+     const PerfCaseReference **cases; // Null-terminated
+     void (*tearDown)(void *arg); // May be nullptr
+};
+
+struct PerfOptions
+{
+     Uint32 warmupMs;
+     double sampleMs;
+     int minSamples;
+     int maxSamples;
+     double precision; // Relative CI half-width to stop at, 0.02 = 2%
+     Uint32 budgetMs;  // Per case
+     double tolerance; // Slowdown against the baseline that counts, 0.1 = 10%
+     const char *filter;       // Substring of "suite/case" to run, nullptr for all
+     const char *baselinePath; // Compared against, nullptr for none
+     const char *savePath;     // Medians written here, nullptr for none
+     int shard;                // Of shardCount, from 0
+     int shardCount;
+     const char *seed;         // Text hashed into perfRandom()'s state, nullptr for a fixed one
+     const char *jsonPath;     // Report written here, nullptr for none
+};
+
+PerfOptions perfDefaultOptions();
+
+// --quick, --filter NAME, --baseline PATH, --save-baseline PATH,
+// --tolerance PERCENT, --shard K/N, --seed TEXT and --json PATH. Returns
+// false on an unknown or malformed argument
+bool perfParseArguments(PerfOptions &options, int argc, char *argv[]);
+
+// Run every enabled, matching case. Returns the number of regressions
+// against the baseline plus failed set-ups, so 0 means the run passed
+int perfRunSuites(const PerfSuiteReference *suites[], const PerfOptions &options);
+
+// Deterministic pseudo-random numbers for set-up code, see --seed above
+Uint32 perfRandom();
+
+// Keep a result alive so the optimizer cannot drop the work behind it
+void perfKeep(const void *value);
+
+#endif // PERF_HARNESS_H
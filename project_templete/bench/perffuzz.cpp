@@ -0,0 +1,948 @@
+// Description:
+// Performance fuzzing: SDL_test_fuzzer's random values used to search for
+// inputs that make a decoder, text wrapper or sort slow or memory hungry,
+// where testautomation only asks whether they crash. For each target a
+// population of ordinary random inputs sets what "typical" costs, in time
+// and in peak memory per unit of work (bytes and pixels, text bytes, or
+// n log2 n comparisons). Then the search hill-climbs: it mutates the worst
+// input found so far with changes that lean pathological, and keeps the
+// result when it is worse per unit. The targets:
+//
+// - png: IMG_Load_RW on PNGs whose chunks are rewritten (IDAT split into
+//   tiny chunks, floods of ancillary and empty chunks, huge declared
+//   sizes, interlacing, corrupt or trailing data), CRCs kept valid so the
+//   decoder gets past them;
+// - wrap: TTF_RenderUTF8_Blended_Wrapped on long text with no spaces,
+//   dense newlines, mixed multi-byte characters and narrow wrap widths;
+// - layout: the same text through text_layout.h, the game's own wrapper;
+// - qsort: SDL_qsort on sorted, reversed, organ-pipe and few-unique runs,
+//   and on McIlroy's adversary, which builds the input that drives this
+//   particular quicksort to its worst case while it sorts.
+//
+// A target fails when its worst input costs more than --ratio times the
+// typical one per unit, when one call takes over --budget-ms, or when it
+// needs over --memory-mb. Allocations are tagged with memory_tags.h, and
+// the image and TTF tags are capped at --memory-mb so a declared 16k x 16k
+// image fails to allocate instead of taking the machine down; a refused
+// allocation is a failure too. Failing inputs are saved as
+// perffuzz-<target>.bin for --replay. The fuzzer is seeded from --seed, or
+// SDLTest_GenerateRunSeed's, so a reported run can be repeated exactly.
+// The exit status is the number of failing targets.
+//
+// Build and run from project_templete/:
+//     make perffuzz && ./perffuzz.exe --quick
+//     ./perffuzz.exe --target png --seed ABCD1234 --rounds 2000
+//     ./perffuzz.exe --replay png perffuzz-png.bin
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_test_fuzzer.h>
+#include <SDL2/SDL_test_harness.h>
+#include <SDL2/SDL_ttf.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "checksum.h"
+#include "glyph_cache.h"
+#include "memory_tags.h"
+#include "png_encode.h"
+#include "text_layout.h"
+
+namespace
+{
+     const int REPEATS = 3;                // Fastest of, against timer noise
+     const size_t MAX_PNG_BYTES = 4 << 20;
+     const size_t MAX_TEXT_BYTES = 256 << 10;
+     const int MAX_SORT_KEYS = 200000;
+     const int MIN_SORT_KEYS = 20000;
+
+     struct Options
+     {
+          std::string seed;
+          const char *target; // nullptr for all
+          const char *fontPath;
+          int population;
+          int rounds;
+          double ratio;
+          double budgetMs;
+          size_t memoryBytes;
+          const char *replayTarget;
+          const char *replayPath;
+     };
+
+     // An input is bytes plus one number: the wrap width for text
+     struct FuzzInput
+     {
+          std::vector<Uint8> bytes;
+          int parameter;
+     };
+
+     struct FuzzCost
+     {
+          double seconds; // Fastest of REPEATS
+          double units;   // Work the input asks for, see each target
+          size_t peakBytes;
+          bool refused;   // An allocation hit the memory cap
+
+          double timePerUnit() const
+          {
+               return seconds * 1e9 / SDL_max(units, 1.0);
+          }
+
+          double bytesPerUnit() const
+          {
+               return peakBytes / SDL_max(units, 1.0);
+          }
+     };
+
+     struct FuzzTarget
+     {
+          const char *name;
+          MemoryTag tag;   // Where its allocations are charged
+          bool capped;     // The tag gets the --memory-mb budget
+          bool needsFont;
+          void (*generate)(FuzzInput &input);
+          void (*mutate)(FuzzInput &input);
+          double (*run)(const FuzzInput &input); // Returns the units of work
+     };
+
+     // Shared by the text targets
+     TTF_Font *font = nullptr;
+     SDL_Surface *layoutTarget = nullptr;
+     SDL_Renderer *layoutRenderer = nullptr;
+     GlyphCache glyphCache;
+     int glyphFont = -1;
+
+     int randomIn(int low, int high)
+     {
+          return SDLTest_RandomIntegerInRange(low, high);
+     }
+
+     // png: inputs are whole files, mutated chunk by chunk
+     struct PngChunk
+     {
+          char type[5];
+          std::vector<Uint8> data;
+     };
+
+     const Uint8 PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+     Uint32 readBE32(const Uint8 *p)
+     {
+          return (Uint32)p[0] << 24 | (Uint32)p[1] << 16 | (Uint32)p[2] << 8 | p[3];
+     }
+
+     void writeBE32(std::vector<Uint8> &out, Uint32 value)
+     {
+          const Uint8 bytes[4] = {(Uint8)(value >> 24), (Uint8)(value >> 16), (Uint8)(value >> 8), (Uint8)value};
+          out.insert(out.end(), bytes, bytes + 4);
+     }
+
+     // Chunks until IEND or the data runs out; IEND itself is dropped
+     std::vector<PngChunk> pngSplit(const std::vector<Uint8> &file)
+     {
+          std::vector<PngChunk> chunks;
+          size_t at = sizeof(PNG_SIGNATURE);
+          while (at + 12 <= file.size())
+          {
+               const Uint32 length = readBE32(&file[at]);
+               if (length > file.size() - at - 12)
+               {
+                    break;
+               }
+               PngChunk chunk;
+               SDL_memcpy(chunk.type, &file[at + 4], 4);
+               chunk.type[4] = '\0';
+               if (SDL_strcmp(chunk.type, "IEND") == 0)
+               {
+                    break;
+               }
+               chunk.data.assign(file.begin() + at + 8, file.begin() + at + 8 + length);
+               chunks.push_back(chunk);
+               at += 12 + length;
+          }
+          return chunks;
+     }
+
+     // With a valid CRC for each chunk and IEND at the end
+     void pngJoin(const std::vector<PngChunk> &chunks, std::vector<Uint8> &file)
+     {
+          file.assign(PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE));
+          for (const PngChunk &chunk : chunks)
+          {
+               writeBE32(file, (Uint32)chunk.data.size());
+               file.insert(file.end(), chunk.type, chunk.type + 4);
+               file.insert(file.end(), chunk.data.begin(), chunk.data.end());
+               Uint32 crc = crc32Update(0, chunk.type, 4);
+               writeBE32(file, crc32Update(crc, chunk.data.data(), chunk.data.size()));
+          }
+          writeBE32(file, 0);
+          file.insert(file.end(), {'I', 'E', 'N', 'D'});
+          writeBE32(file, crc32Update(0, "IEND", 4));
+     }
+
+     size_t pngSize(const std::vector<PngChunk> &chunks)
+     {
+          size_t size = sizeof(PNG_SIGNATURE) + 12;
+          for (const PngChunk &chunk : chunks)
+          {
+               size += 12 + chunk.data.size();
+          }
+          return size;
+     }
+
+     int findChunk(const std::vector<PngChunk> &chunks, const char *type)
+     {
+          for (size_t i = 0; i < chunks.size(); i++)
+          {
+               if (SDL_strcmp(chunks[i].type, type) == 0)
+               {
+                    return (int)i;
+               }
+          }
+          return -1;
+     }
+
+     PngChunk makeChunk(const char *type, const std::vector<Uint8> &data)
+     {
+          PngChunk chunk;
+          SDL_memcpy(chunk.type, type, 5);
+          chunk.data = data;
+          return chunk;
+     }
+
+     // Noise over gradients, so the population spans compressible and not
+     void pngGenerate(FuzzInput &input)
+     {
+          const int w = randomIn(64, 256), h = randomIn(64, 256);
+          const int channels = randomIn(0, 1) ? 4 : 3;
+          const int noise = randomIn(0, 255);
+          std::vector<Uint8> pixels((size_t)w * h * channels);
+          for (int y = 0; y < h; y++)
+          {
+               for (int x = 0; x < w * channels; x++)
+               {
+                    pixels[(size_t)y * w * channels + x] = (Uint8)(x + y + (SDLTest_RandomUint8() & noise));
+               }
+          }
+          input.parameter = 0;
+          if (!pngEncode(pixels.data(), w * channels, w, h, channels, PNG_DEFAULT_LEVEL, nullptr, input.bytes))
+          {
+               input.bytes.clear();
+          }
+     }
+
+     void pngMutate(FuzzInput &input)
+     {
+          std::vector<PngChunk> chunks = pngSplit(input.bytes);
+          const int header = findChunk(chunks, "IHDR");
+          const int data = findChunk(chunks, "IDAT");
+          if (header < 0 || chunks[header].data.size() != 13 || data < 0)
+          {
+               return;
+          }
+          std::vector<Uint8> &ihdr = chunks[header].data;
+          switch (randomIn(0, 7))
+          {
+          case 0: // Every IDAT cut into chunks of a few bytes
+          {
+               std::vector<Uint8> stream;
+               std::vector<PngChunk> kept;
+               for (PngChunk &chunk : chunks)
+               {
+                    if (SDL_strcmp(chunk.type, "IDAT") == 0)
+                    {
+                         stream.insert(stream.end(), chunk.data.begin(), chunk.data.end());
+                    }
+                    else
+                    {
+                         kept.push_back(chunk);
+                    }
+               }
+               const size_t piece = (size_t)randomIn(1, 16);
+               for (size_t at = 0; at < stream.size(); at += piece)
+               {
+                    const size_t end = SDL_min(at + piece, stream.size());
+                    kept.push_back(makeChunk("IDAT", std::vector<Uint8>(stream.begin() + at, stream.begin() + end)));
+               }
+               chunks = kept;
+               break;
+          }
+          case 1: // A flood of text chunks before the data
+          {
+               const int count = randomIn(100, 2000);
+               for (int i = 0; i < count; i++)
+               {
+                    char *text = SDLTest_RandomAsciiStringOfSize(randomIn(1, 64));
+                    std::vector<Uint8> body = {'C', 'o', 'm', 'm', 'e', 'n', 't', 0};
+                    if (text != nullptr)
+                    {
+                         body.insert(body.end(), text, text + SDL_strlen(text));
+                         SDL_free(text);
+                    }
+                    chunks.insert(chunks.begin() + header + 1, makeChunk("tEXt", body));
+               }
+               break;
+          }
+          case 2: // Empty IDATs between the real ones
+          {
+               const int count = randomIn(100, 5000);
+               chunks.insert(chunks.begin() + data, count, makeChunk("IDAT", std::vector<Uint8>()));
+               break;
+          }
+          case 3: // A declared size far past the data
+          {
+               const Uint32 w = SDLTest_RandomUint32BoundaryValue(1, 16384, SDL_TRUE);
+               const Uint32 h = SDLTest_RandomUint32BoundaryValue(1, 16384, SDL_TRUE);
+               const std::vector<Uint8> size = {(Uint8)(w >> 24), (Uint8)(w >> 16), (Uint8)(w >> 8), (Uint8)w,
+                                                (Uint8)(h >> 24), (Uint8)(h >> 16), (Uint8)(h >> 8), (Uint8)h};
+               std::copy(size.begin(), size.end(), ihdr.begin());
+               break;
+          }
+          case 4: // Adam7 interlacing
+               ihdr[12] = 1;
+               break;
+          case 5: // 16 bits per channel, so the data no longer matches
+               ihdr[8] = 16;
+               break;
+          case 6: // The compressed stream again after itself
+          {
+               const PngChunk again = chunks[data];
+               chunks.insert(chunks.begin() + data + 1, again);
+               break;
+          }
+          default: // Flipped bytes in the compressed stream
+          {
+               std::vector<Uint8> &bytes = chunks[data].data;
+               const int flips = randomIn(1, 8);
+               for (int i = 0; i < flips && !bytes.empty(); i++)
+               {
+                    bytes[randomIn(0, (int)bytes.size() - 1)] ^= (Uint8)randomIn(1, 255);
+               }
+               break;
+          }
+          }
+          if (pngSize(chunks) <= MAX_PNG_BYTES)
+          {
+               pngJoin(chunks, input.bytes);
+          }
+     }
+
+     // Units: file bytes plus decoded pixels, so big valid images aren't slow
+     double pngRun(const FuzzInput &input)
+     {
+          SDL_Surface *surface = IMG_Load_RW(SDL_RWFromConstMem(input.bytes.data(), (int)input.bytes.size()), 1);
+          double units = (double)input.bytes.size();
+          if (surface != nullptr)
+          {
+               units += (double)surface->w * surface->h;
+               SDL_FreeSurface(surface);
+          }
+          return units;
+     }
+
+     // wrap and layout: UTF-8 text and a wrap width in pixels
+     void appendText(std::vector<Uint8> &bytes, const char *text)
+     {
+          bytes.insert(bytes.end(), text, text + SDL_strlen(text));
+     }
+
+     void textGenerate(FuzzInput &input)
+     {
+          input.bytes.clear();
+          const size_t size = (size_t)randomIn(2048, 8192);
+          while (input.bytes.size() < size)
+          {
+               const int length = randomIn(1, 12);
+               for (int i = 0; i < length; i++)
+               {
+                    input.bytes.push_back((Uint8)randomIn('a', 'z'));
+               }
+               input.bytes.push_back(randomIn(0, 15) == 0 ? '\n' : ' ');
+          }
+          input.parameter = randomIn(200, 800);
+     }
+
+     void textMutate(FuzzInput &input)
+     {
+          std::vector<Uint8> &bytes = input.bytes;
+          if (bytes.empty())
+          {
+               textGenerate(input);
+          }
+          const size_t start = (size_t)randomIn(0, (int)bytes.size() - 1);
+          const size_t length = (size_t)randomIn(1, (int)bytes.size());
+          const size_t end = SDL_min(bytes.size(), start + length);
+          switch (randomIn(0, 5))
+          {
+          case 0: // One long word: nowhere to break
+               std::replace(bytes.begin() + start, bytes.begin() + end, (Uint8)' ', (Uint8)'m');
+               std::replace(bytes.begin() + start, bytes.begin() + end, (Uint8)'\n', (Uint8)'m');
+               break;
+          case 1: // A line break every few characters
+          {
+               const size_t every = (size_t)randomIn(1, 8);
+               for (size_t i = start; i < end; i += every)
+               {
+                    bytes[i] = '\n';
+               }
+               break;
+          }
+          case 2: // Twice as long
+               if (bytes.size() * 2 <= MAX_TEXT_BYTES)
+               {
+                    bytes.insert(bytes.end(), bytes.begin(), bytes.end());
+               }
+               break;
+          case 3: // A narrow or extreme wrap width
+               input.parameter = SDLTest_RandomSint32BoundaryValue(1, 2000, SDL_TRUE);
+               break;
+          case 4: // Multi-byte characters, costlier to decode and measure
+          {
+               static const char *const WIDE[] = {"\xC3\xA9", "\xE4\xB8\xAD", "\xF0\x9F\x98\x80", "\xE2\x80\x8B"};
+               std::vector<Uint8> wide;
+               const int count = randomIn(16, 512);
+               for (int i = 0; i < count; i++)
+               {
+                    appendText(wide, WIDE[randomIn(0, 3)]);
+               }
+               if (bytes.size() + wide.size() <= MAX_TEXT_BYTES)
+               {
+                    bytes.insert(bytes.begin() + start, wide.begin(), wide.end());
+               }
+               break;
+          }
+          default: // Only spaces: a break candidate at every character
+               std::fill(bytes.begin() + start, bytes.begin() + end, (Uint8)' ');
+               break;
+          }
+     }
+
+     std::string textOf(const FuzzInput &input)
+     {
+          return std::string(input.bytes.begin(), input.bytes.end());
+     }
+
+     double wrapRun(const FuzzInput &input)
+     {
+          const std::string text = textOf(input);
+          const SDL_Color white = {255, 255, 255, 255};
+          const Uint32 wrap = (Uint32)SDL_max(input.parameter, 1);
+          SDL_Surface *surface = TTF_RenderUTF8_Blended_Wrapped(font, text.c_str(), white, wrap);
+          SDL_FreeSurface(surface);
+          return (double)SDL_max(text.size(), (size_t)1);
+     }
+
+     double layoutRun(const FuzzInput &input)
+     {
+          const std::string text = textOf(input);
+          TextLayout layout; // Fresh, so no paragraph is reused from the last run
+          textLayoutInit(layout, &glyphCache, glyphFont, SDL_max(input.parameter, 1));
+          textLayoutSetText(layout, text.c_str());
+          return (double)SDL_max(text.size(), (size_t)1);
+     }
+
+     // qsort: the bytes are Uint32 keys
+     int SDLCALL compareKeys(const void *a, const void *b)
+     {
+          const Uint32 x = *(const Uint32 *)a, y = *(const Uint32 *)b;
+          return x < y ? -1 : x > y ? 1 : 0;
+     }
+
+     // McIlroy, "A Killer Adversary for Quicksort" (1999): values start as
+     // "gas", and the adversary freezes one just often enough to answer
+     // every comparison consistently; the frozen order is the worst input
+     std::vector<int> adversaryValues;
+     int adversaryGas, adversarySolid, adversaryCandidate;
+
+     int SDLCALL adversaryCompare(const void *a, const void *b)
+     {
+          const int x = *(const int *)a, y = *(const int *)b;
+          if (adversaryValues[x] == adversaryGas && adversaryValues[y] == adversaryGas)
+          {
+               adversaryValues[x == adversaryCandidate ? x : y] = adversarySolid++;
+          }
+          if (adversaryValues[x] == adversaryGas)
+          {
+               adversaryCandidate = x;
+          }
+          else if (adversaryValues[y] == adversaryGas)
+          {
+               adversaryCandidate = y;
+          }
+          return adversaryValues[x] - adversaryValues[y];
+     }
+
+     std::vector<Uint32> adversaryInput(int count)
+     {
+          adversaryValues.assign(count, count - 1);
+          adversaryGas = count - 1;
+          adversarySolid = 0;
+          adversaryCandidate = 0;
+          std::vector<int> order(count);
+          for (int i = 0; i < count; i++)
+          {
+               order[i] = i;
+          }
+          SDL_qsort(order.data(), order.size(), sizeof(int), adversaryCompare);
+          return std::vector<Uint32>(adversaryValues.begin(), adversaryValues.end());
+     }
+
+     std::vector<Uint32> keysOf(const FuzzInput &input)
+     {
+          std::vector<Uint32> keys(input.bytes.size() / sizeof(Uint32));
+          SDL_memcpy(keys.data(), input.bytes.data(), keys.size() * sizeof(Uint32));
+          return keys;
+     }
+
+     void setKeys(FuzzInput &input, const std::vector<Uint32> &keys)
+     {
+          input.bytes.resize(keys.size() * sizeof(Uint32));
+          SDL_memcpy(input.bytes.data(), keys.data(), input.bytes.size());
+     }
+
+     void sortGenerate(FuzzInput &input)
+     {
+          std::vector<Uint32> keys(randomIn(MIN_SORT_KEYS, MAX_SORT_KEYS / 2));
+          for (Uint32 &key : keys)
+          {
+               key = SDLTest_RandomUint32();
+          }
+          setKeys(input, keys);
+          input.parameter = 0;
+     }
+
+     void sortMutate(FuzzInput &input)
+     {
+          std::vector<Uint32> keys = keysOf(input);
+          if (keys.size() < (size_t)MIN_SORT_KEYS)
+          {
+               return;
+          }
+          const size_t start = (size_t)randomIn(0, (int)keys.size() - 1);
+          const size_t length = (size_t)randomIn(1, (int)keys.size());
+          const size_t end = SDL_min(keys.size(), start + length);
+          switch (randomIn(0, 5))
+          {
+          case 0: // An ascending run
+               std::sort(keys.begin() + start, keys.begin() + end);
+               break;
+          case 1: // A descending run
+               std::sort(keys.begin() + start, keys.begin() + end, [](Uint32 a, Uint32 b) { return a > b; });
+               break;
+          case 2: // A few distinct values
+          {
+               const Uint32 distinct = (Uint32)randomIn(1, 4);
+               for (size_t i = start; i < end; i++)
+               {
+                    keys[i] %= distinct;
+               }
+               break;
+          }
+          case 3: // Organ pipe: up, then back down
+          {
+               std::sort(keys.begin(), keys.end());
+               std::sort(keys.begin() + keys.size() / 2, keys.end(), [](Uint32 a, Uint32 b) { return a > b; });
+               break;
+          }
+          case 4: // The adversary's input for this size
+               keys = adversaryInput((int)keys.size());
+               break;
+          default: // A few swaps, to walk around a bad input
+          {
+               const int swaps = randomIn(1, 64);
+               for (int i = 0; i < swaps; i++)
+               {
+                    std::swap(keys[randomIn(0, (int)keys.size() - 1)], keys[randomIn(0, (int)keys.size() - 1)]);
+               }
+               break;
+          }
+          }
+          setKeys(input, keys);
+     }
+
+     double sortRun(const FuzzInput &input)
+     {
+          std::vector<Uint32> keys = keysOf(input);
+          SDL_qsort(keys.data(), keys.size(), sizeof(Uint32), compareKeys);
+          const double n = (double)SDL_max(keys.size(), (size_t)2);
+          return n * std::log2(n);
+     }
+
+     const FuzzTarget TARGETS[] = {
+          {"png", MEMORY_TAG_IMAGE, true, false, pngGenerate, pngMutate, pngRun},
+          {"wrap", MEMORY_TAG_TTF, true, true, textGenerate, textMutate, wrapRun},
+          {"layout", MEMORY_TAG_TTF, true, true, textGenerate, textMutate, layoutRun},
+          {"qsort", MEMORY_TAG_GENERAL, false, false, sortGenerate, sortMutate, sortRun},
+     };
+
+     FuzzCost measure(const FuzzTarget &target, const FuzzInput &input, const Options &options)
+     {
+          FuzzCost cost = {0.0, 0.0, 0, false};
+          for (int r = 0; r < REPEATS; r++)
+          {
+               const MemoryTagStats before = memoryTagGetStats(target.tag);
+               memoryTagResetPeak(target.tag);
+               const Uint64 start = SDL_GetPerformanceCounter();
+               double units;
+               {
+                    MemoryTagScope tag(target.tag);
+                    units = target.run(input);
+               }
+               const double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+               const MemoryTagStats after = memoryTagGetStats(target.tag);
+               if (r == 0 || seconds < cost.seconds)
+               {
+                    cost.seconds = seconds;
+               }
+               cost.units = units;
+               const size_t peak = after.peakBytes > before.bytes ? after.peakBytes - before.bytes : 0;
+               cost.peakBytes = SDL_max(cost.peakBytes, peak);
+               cost.refused = cost.refused || after.failures > before.failures;
+               if (seconds * 1000.0 > options.budgetMs)
+               {
+                    break; // Already over; repeating only takes longer
+               }
+          }
+          return cost;
+     }
+
+     // FNV-1a of the run seed and the target, for SDLTest_FuzzerInit
+     Uint64 fuzzerKey(const std::string &seed, const char *target)
+     {
+          Uint64 hash = 0xcbf29ce484222325ull;
+          for (const char *text : {seed.c_str(), "/", target})
+          {
+               for (; *text != '\0'; text++)
+               {
+                    hash = (hash ^ (Uint8)*text) * 0x100000001b3ull;
+               }
+          }
+          return hash;
+     }
+
+     bool saveInput(const char *path, const FuzzInput &input)
+     {
+          SDL_RWops *out = SDL_RWFromFile(path, "wb");
+          if (out == nullptr)
+          {
+               return false;
+          }
+          const bool written = SDL_WriteLE32(out, (Uint32)input.parameter) == 1 &&
+                               SDL_RWwrite(out, input.bytes.data(), 1, input.bytes.size()) == input.bytes.size();
+          return SDL_RWclose(out) == 0 && written;
+     }
+
+     bool loadInput(const char *path, FuzzInput &input)
+     {
+          size_t size = 0;
+          Uint8 *data = (Uint8 *)SDL_LoadFile(path, &size);
+          if (data == nullptr || size < 4)
+          {
+               SDL_free(data);
+               return false;
+          }
+          input.parameter = (int)SDL_SwapLE32(*(const Uint32 *)data);
+          input.bytes.assign(data + 4, data + size);
+          SDL_free(data);
+          return true;
+     }
+
+     // `typicalTime` and `typicalBytes` are the population's medians per unit
+     const char *verdictOf(double typicalTime, double typicalBytes, const FuzzCost &slowest,
+                           const FuzzCost &hungriest, double worstMs, const Options &options)
+     {
+          if (hungriest.refused || hungriest.peakBytes > options.memoryBytes)
+          {
+               return "OVER MEMORY";
+          }
+          if (worstMs > options.budgetMs)
+          {
+               return "OVER TIME";
+          }
+          if (slowest.timePerUnit() > options.ratio * typicalTime)
+          {
+               return "SLOW INPUT";
+          }
+          if (typicalBytes > 0.0 && hungriest.bytesPerUnit() > options.ratio * typicalBytes &&
+              hungriest.peakBytes > (1u << 20))
+          {
+               return "HUNGRY INPUT"; // Ignored under a megabyte, where ratios are noise
+          }
+          return "ok";
+     }
+
+     // Returns true when the target passed
+     bool fuzzTarget(const FuzzTarget &target, const Options &options)
+     {
+          SDLTest_FuzzerInit(fuzzerKey(options.seed, target.name));
+
+          std::vector<double> times, bytes;
+          FuzzInput slowest, hungriest;
+          FuzzCost slowestCost = {0.0, 0.0, 0, false}, hungriestCost = slowestCost;
+          double worstMs = 0.0;
+          for (int i = 0; i < options.population; i++)
+          {
+               FuzzInput input;
+               target.generate(input);
+               const FuzzCost cost = measure(target, input, options);
+               times.push_back(cost.timePerUnit());
+               bytes.push_back(cost.bytesPerUnit());
+               worstMs = SDL_max(worstMs, cost.seconds * 1000.0);
+               if (i == 0 || cost.timePerUnit() > slowestCost.timePerUnit())
+               {
+                    slowest = input;
+                    slowestCost = cost;
+               }
+               if (i == 0 || cost.bytesPerUnit() > hungriestCost.bytesPerUnit())
+               {
+                    hungriest = input;
+                    hungriestCost = cost;
+               }
+          }
+          std::sort(times.begin(), times.end());
+          std::sort(bytes.begin(), bytes.end());
+          const double typicalTime = times[times.size() / 2];
+          const double typicalBytes = bytes[bytes.size() / 2];
+
+          // Climb from whichever champion this round picks
+          int kept = 0;
+          for (int round = 0; round < options.rounds; round++)
+          {
+               const bool forMemory = (round & 1) != 0;
+               FuzzInput candidate = forMemory ? hungriest : slowest;
+               const int mutations = randomIn(1, 3);
+               for (int m = 0; m < mutations; m++)
+               {
+                    target.mutate(candidate);
+               }
+               const FuzzCost cost = measure(target, candidate, options);
+               worstMs = SDL_max(worstMs, cost.seconds * 1000.0);
+               if (cost.timePerUnit() > slowestCost.timePerUnit())
+               {
+                    slowest = candidate;
+                    slowestCost = cost;
+                    kept++;
+               }
+               if (cost.refused || cost.bytesPerUnit() > hungriestCost.bytesPerUnit())
+               {
+                    hungriest = candidate;
+                    hungriestCost = cost;
+                    kept++;
+               }
+               if (cost.refused || cost.seconds * 1000.0 > options.budgetMs)
+               {
+                    break; // Found one; the report says which
+               }
+          }
+
+          const char *verdict = verdictOf(typicalTime, typicalBytes, slowestCost, hungriestCost, worstMs, options);
+          const bool passed = SDL_strcmp(verdict, "ok") == 0;
+          std::printf("%-8s %10.2f %10.2f %7.1fx %10.2f %10.0f %6d  %s\n", target.name, typicalTime,
+                      slowestCost.timePerUnit(), slowestCost.timePerUnit() / SDL_max(typicalTime, 1e-9),
+                      worstMs, hungriestCost.peakBytes / 1024.0, kept, verdict);
+          if (!passed)
+          {
+               const bool memory = SDL_strstr(verdict, "MEMORY") != nullptr || SDL_strstr(verdict, "HUNGRY") != nullptr;
+               const FuzzInput &culprit = memory ? hungriest : slowest;
+               const std::string path = std::string("perffuzz-") + target.name + ".bin";
+               if (saveInput(path.c_str(), culprit))
+               {
+                    std::printf("         saved %s (%zu bytes, parameter %d)\n", path.c_str(), culprit.bytes.size(),
+                                culprit.parameter);
+               }
+               else
+               {
+                    std::printf("         cannot write %s: %s\n", path.c_str(), SDL_GetError());
+               }
+          }
+          std::fflush(stdout);
+          return passed;
+     }
+
+     bool parseArguments(Options &options, int argc, char *argv[])
+     {
+          for (int i = 1; i < argc; i++)
+          {
+               const bool hasValue = i + 1 < argc;
+               if (std::strcmp(argv[i], "--quick") == 0)
+               {
+                    options.population = 8;
+                    options.rounds = 60;
+               }
+               else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+               {
+                    options.seed = argv[++i];
+               }
+               else if (std::strcmp(argv[i], "--target") == 0 && hasValue)
+               {
+                    options.target = argv[++i];
+               }
+               else if (std::strcmp(argv[i], "--font") == 0 && hasValue)
+               {
+                    options.fontPath = argv[++i];
+               }
+               else if (std::strcmp(argv[i], "--population") == 0 && hasValue)
+               {
+                    options.population = std::atoi(argv[++i]);
+                    options.population = SDL_max(1, options.population);
+               }
+               else if (std::strcmp(argv[i], "--rounds") == 0 && hasValue)
+               {
+                    options.rounds = std::atoi(argv[++i]);
+                    options.rounds = SDL_max(0, options.rounds);
+               }
+               else if (std::strcmp(argv[i], "--ratio") == 0 && hasValue)
+               {
+                    options.ratio = std::atof(argv[++i]);
+               }
+               else if (std::strcmp(argv[i], "--budget-ms") == 0 && hasValue)
+               {
+                    options.budgetMs = std::atof(argv[++i]);
+               }
+               else if (std::strcmp(argv[i], "--memory-mb") == 0 && hasValue)
+               {
+                    options.memoryBytes = (size_t)std::atoi(argv[++i]) << 20;
+               }
+               else if (std::strcmp(argv[i], "--replay") == 0 && i + 2 < argc)
+               {
+                    options.replayTarget = argv[++i];
+                    options.replayPath = argv[++i];
+               }
+               else
+               {
+                    std::fprintf(stderr, "usage: %s [--quick] [--seed TEXT] [--target NAME] [--font PATH] "
+                                         "[--population N] [--rounds N] [--ratio X] [--budget-ms MS] "
+                                         "[--memory-mb MB] [--replay TARGET PATH]\n", argv[0]);
+                    return false;
+               }
+          }
+          return true;
+     }
+
+     bool openText(const Options &options)
+     {
+          font = TTF_OpenFont(options.fontPath, 16);
+          layoutTarget = SDL_CreateRGBSurfaceWithFormat(0, 64, 64, 32, SDL_PIXELFORMAT_ARGB8888);
+          layoutRenderer = layoutTarget != nullptr ? SDL_CreateSoftwareRenderer(layoutTarget) : nullptr;
+          if (font == nullptr || layoutRenderer == nullptr)
+          {
+               return false;
+          }
+          glyphCacheInit(glyphCache, layoutRenderer, 512, 4);
+          glyphFont = glyphCacheAddFont(glyphCache, font);
+          return glyphFont >= 0;
+     }
+
+     void closeText()
+     {
+          if (glyphFont >= 0)
+          {
+               glyphCacheDestroy(glyphCache);
+          }
+          SDL_DestroyRenderer(layoutRenderer);
+          SDL_FreeSurface(layoutTarget);
+          TTF_CloseFont(font);
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     // Before anything allocates through SDL, so every block is tagged
+     memoryTagsInstall();
+
+     Options options;
+     options.target = nullptr;
+     options.fontPath = "sans.ttf";
+     options.population = 16;
+     options.rounds = 300;
+     options.ratio = 10.0;
+     options.budgetMs = 250.0;
+     options.memoryBytes = (size_t)256 << 20;
+     options.replayTarget = nullptr;
+     options.replayPath = nullptr;
+     if (!parseArguments(options, argc, argv))
+     {
+          return 100;
+     }
+     if (SDL_Init(0) < 0 || IMG_Init(IMG_INIT_PNG) == 0 || TTF_Init() < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 100;
+     }
+     if (options.seed.empty())
+     {
+          char *generated = SDLTest_GenerateRunSeed(16);
+          if (generated == nullptr)
+          {
+               std::fprintf(stderr, "Unable to generate a run seed! SDL Error: %s\n", SDL_GetError());
+               return 100;
+          }
+          options.seed = generated;
+          SDL_free(generated);
+     }
+     const bool hasText = openText(options);
+     for (const FuzzTarget &target : TARGETS)
+     {
+          if (target.capped)
+          {
+               memoryTagSetBudget(target.tag, options.memoryBytes);
+          }
+     }
+
+     int failures = 0;
+     if (options.replayTarget != nullptr)
+     {
+          FuzzInput input;
+          const FuzzTarget *target = nullptr;
+          for (const FuzzTarget &candidate : TARGETS)
+          {
+               target = SDL_strcmp(candidate.name, options.replayTarget) == 0 ? &candidate : target;
+          }
+          if (target == nullptr || (target->needsFont && !hasText) || !loadInput(options.replayPath, input))
+          {
+               std::fprintf(stderr, "cannot replay %s on %s\n", options.replayPath, options.replayTarget);
+               failures = 100;
+          }
+          else
+          {
+               const FuzzCost cost = measure(*target, input, options);
+               std::printf("%s %s: %.3f ms, %.0f units, %.2f ns/unit, peak %.0f KB%s\n", target->name,
+                           options.replayPath, cost.seconds * 1000.0, cost.units, cost.timePerUnit(),
+                           cost.peakBytes / 1024.0, cost.refused ? ", allocation refused" : "");
+          }
+     }
+     else
+     {
+          std::printf("seed %s, %d inputs + %d rounds per target, budget %.0f ms, %.0fx typical, %zu MB\n",
+                      options.seed.c_str(), options.population, options.rounds, options.budgetMs, options.ratio,
+                      options.memoryBytes >> 20);
+          std::printf("%-8s %10s %10s %8s %10s %10s %6s  %s\n", "target", "typ ns/u", "worst ns/u", "ratio",
+                      "worst ms", "peak KB", "kept", "verdict");
+          for (const FuzzTarget &target : TARGETS)
+          {
+               if (options.target != nullptr && SDL_strcmp(options.target, target.name) != 0)
+               {
+                    continue;
+               }
+               if (target.needsFont && !hasText)
+               {
+                    std::printf("%-8s skipped: no font at %s\n", target.name, options.fontPath);
+                    continue;
+               }
+               failures += fuzzTarget(target, options) ? 0 : 1;
+          }
+     }
+
+     closeText();
+     TTF_Quit();
+     IMG_Quit();
+     SDL_Quit();
+     return failures;
+}
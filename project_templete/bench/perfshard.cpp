@@ -0,0 +1,362 @@
+// Description:
+// Parallel runner for perfsuite.exe, or any perf_harness program. The
+// harness runs its suites one after another in a single process, like
+// testautomation_main.c; this starts `--jobs` copies with --shard K/N,
+// each writing its own log, and merges the logs in shard order once they
+// have all exited. That is the serial run's order, with one table header.
+//
+// Every shard gets the same --seed, from SDLTest_GenerateRunSeed unless
+// one is given, and the merged log starts with it; passing it back with
+// --seed reruns with the same inputs. --save-baseline PATH becomes one
+// file per shard, concatenated into PATH at the end. Everything else is
+// passed to the shards unchanged.
+//
+// Shards share the machine, so their numbers are only comparable with
+// baselines saved at the same --jobs. Keep it at or below the physical
+// core count; the default is one shard per physical core.
+//
+// --testautomation PATH runs SDL's testautomation the same way, one
+// process per suite: the suites come from its --list, each runs as
+// --filter SUITE with the shared --seed, at most `--jobs` at a time, and
+// the logs are merged in suite order. testautomation derives every test's
+// seed from the run seed and the suite and test names, so a suite gets the
+// same inputs here as in the serial run. The exit status is the number of
+// suites that failed, or 100 when the suites could not be listed.
+//
+// Build and run from project_templete/:
+//     make perfshard perfsuite && ./perfshard.exe --jobs 4 -- --quick
+//     ./perfshard.exe --testautomation path/to/testautomation.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_test_harness.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+#include "cpu_topology.h"
+
+namespace
+{
+     struct Shard
+     {
+          std::string command;
+          std::string logPath;
+          std::string baselinePath; // Empty when not saving one
+          int status;
+     };
+
+     std::string quoted(const std::string &text)
+     {
+          return "\"" + text + "\"";
+     }
+
+     int runCommand(const std::string &command)
+     {
+#ifdef _WIN32
+          // cmd.exe strips one pair of quotes around the whole line
+          return std::system(quoted(command).c_str());
+#else
+          const int status = std::system(command.c_str());
+          return status == -1 ? -1 : WIFEXITED(status) ? WEXITSTATUS(status) : 128;
+#endif
+     }
+
+     // Workers take the next shard until none are left, so there may be
+     // more shards than jobs
+     struct ShardQueue
+     {
+          std::vector<Shard> *shards;
+          SDL_atomic_t next;
+     };
+
+     int shardThread(void *data)
+     {
+          ShardQueue &queue = *(ShardQueue *)data;
+          for (;;)
+          {
+               const int k = SDL_AtomicAdd(&queue.next, 1);
+               if (k >= (int)queue.shards->size())
+               {
+                    return 0;
+               }
+               Shard &shard = (*queue.shards)[k];
+               shard.status = runCommand(shard.command);
+          }
+     }
+
+     // Run every shard on up to `jobs` threads and wait for them all
+     void runShards(std::vector<Shard> &shards, int jobs)
+     {
+          ShardQueue queue = {&shards, {0}};
+          std::vector<SDL_Thread *> threads(SDL_min(jobs, (int)shards.size()));
+          for (size_t t = 0; t < threads.size(); t++)
+          {
+               threads[t] = SDL_CreateThread(shardThread, "perfshard", &queue);
+               if (threads[t] == nullptr)
+               {
+                    std::fprintf(stderr, "Unable to start a shard thread! SDL Error: %s\n", SDL_GetError());
+               }
+          }
+          for (SDL_Thread *thread : threads)
+          {
+               if (thread != nullptr)
+               {
+                    SDL_WaitThread(thread, nullptr);
+               }
+          }
+          // With no thread at all, run them here rather than not at all
+          shardThread(&queue);
+     }
+
+     // Appends the log's lines to `merged`, the table header only for the
+     // first shard, and keeps the summary line aside
+     bool mergeLog(const Shard &shard, bool first, std::string &merged, std::string &summaries)
+     {
+          std::FILE *file = std::fopen(shard.logPath.c_str(), "r");
+          if (file == nullptr)
+          {
+               return false;
+          }
+          char line[1024];
+          while (std::fgets(line, sizeof(line), file) != nullptr)
+          {
+               if (std::strncmp(line, "seed ", 5) == 0)
+               {
+                    continue;
+               }
+               if (std::strncmp(line, "suite/case", 10) == 0 && !first)
+               {
+                    continue;
+               }
+               if (std::strstr(line, " cases, * = ") != nullptr)
+               {
+                    summaries += line;
+                    continue;
+               }
+               merged += line;
+          }
+          std::fclose(file);
+          return true;
+     }
+
+     bool appendFile(const std::string &path, std::FILE *out)
+     {
+          std::FILE *file = std::fopen(path.c_str(), "rb");
+          if (file == nullptr)
+          {
+               return false;
+          }
+          char buffer[4096];
+          size_t read;
+          while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+          {
+               std::fwrite(buffer, 1, read, out);
+          }
+          std::fclose(file);
+          return true;
+     }
+
+     std::vector<std::string> readLines(const std::string &path)
+     {
+          std::vector<std::string> lines;
+          std::FILE *file = std::fopen(path.c_str(), "r");
+          if (file == nullptr)
+          {
+               return lines;
+          }
+          char line[256];
+          while (std::fgets(line, sizeof(line), file) != nullptr)
+          {
+               line[std::strcspn(line, "\r\n")] = '\0';
+               if (line[0] != '\0')
+               {
+                    lines.push_back(line);
+               }
+          }
+          std::fclose(file);
+          return lines;
+     }
+
+     // One testautomation process per suite, merged in --list order
+     int runTestAutomation(const std::string &program, int jobs, const std::string &seed, const std::string &passed)
+     {
+          const std::string listPath = "testshard-list.txt";
+          runCommand(quoted(program) + " --list > " + quoted(listPath));
+          const std::vector<std::string> suites = readLines(listPath);
+          std::remove(listPath.c_str());
+          if (suites.empty())
+          {
+               std::fprintf(stderr, "%s --list printed no suites\n", program.c_str());
+               return 100;
+          }
+
+          std::vector<Shard> shards(suites.size());
+          for (size_t k = 0; k < suites.size(); k++)
+          {
+               Shard &shard = shards[k];
+               shard.logPath = "testshard-" + std::to_string(k) + ".log";
+               shard.command = quoted(program) + " --filter " + quoted(suites[k]) + " --seed " + quoted(seed) +
+                               passed + " > " + quoted(shard.logPath) + " 2>&1";
+               shard.status = -1;
+          }
+          const Uint64 start = SDL_GetPerformanceCounter();
+          runShards(shards, jobs);
+          const double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+          std::printf("seed %s, %d suites on %d jobs\n", seed.c_str(), (int)suites.size(), jobs);
+          int failed = 0;
+          for (size_t k = 0; k < shards.size(); k++)
+          {
+               std::fflush(stdout);
+               if (!appendFile(shards[k].logPath, stdout))
+               {
+                    std::printf("suite %s: no log at %s\n", suites[k].c_str(), shards[k].logPath.c_str());
+               }
+               std::remove(shards[k].logPath.c_str());
+               failed += shards[k].status != 0 ? 1 : 0;
+          }
+          for (size_t k = 0; k < shards.size(); k++)
+          {
+               std::printf("suite %s: exit %d\n", suites[k].c_str(), shards[k].status);
+          }
+          std::printf("%d of %d suites failed, %.1f s wall\n", failed, (int)suites.size(), seconds);
+          return SDL_min(failed, 99);
+     }
+}
+
+int main(int argc, char *argv[])
+{
+#ifdef _WIN32
+     std::string program = "perfsuite.exe";
+#else
+     std::string program = "./perfsuite.exe";
+#endif
+     int jobs = cpuTopology().physicalCount;
+     std::string seed, savePath, passed;
+     bool testAutomation = false;
+     for (int i = 1; i < argc; i++)
+     {
+          const bool hasValue = i + 1 < argc;
+          if (std::strcmp(argv[i], "--jobs") == 0 && hasValue)
+          {
+               jobs = std::atoi(argv[++i]);
+          }
+          else if (std::strcmp(argv[i], "--program") == 0 && hasValue)
+          {
+               program = argv[++i];
+          }
+          else if (std::strcmp(argv[i], "--testautomation") == 0 && hasValue)
+          {
+               program = argv[++i];
+               testAutomation = true;
+          }
+          else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+          {
+               seed = argv[++i];
+          }
+          else if (std::strcmp(argv[i], "--save-baseline") == 0 && hasValue)
+          {
+               savePath = argv[++i];
+          }
+          else if (std::strcmp(argv[i], "--") == 0)
+          {
+               continue;
+          }
+          else if (std::strcmp(argv[i], "--shard") == 0 || std::strcmp(argv[i], "--filter") == 0)
+          {
+               std::fprintf(stderr, "usage: %s [--jobs N] [--program PATH | --testautomation PATH] [--seed TEXT] "
+                                    "[--save-baseline PATH] [--] [harness arguments]\n", argv[0]);
+               return 2;
+          }
+          else
+          {
+               passed += " " + quoted(argv[i]);
+          }
+     }
+     jobs = SDL_clamp(jobs, 1, 64);
+     if (seed.empty())
+     {
+          char *generated = SDLTest_GenerateRunSeed(16);
+          if (generated == nullptr)
+          {
+               std::fprintf(stderr, "Unable to generate a run seed! SDL Error: %s\n", SDL_GetError());
+               return 2;
+          }
+          seed = generated;
+          SDL_free(generated);
+     }
+     if (testAutomation)
+     {
+          return runTestAutomation(program, jobs, seed, passed);
+     }
+
+     std::vector<Shard> shards(jobs);
+     const Uint64 start = SDL_GetPerformanceCounter();
+     for (int k = 0; k < jobs; k++)
+     {
+          Shard &shard = shards[k];
+          shard.logPath = "perfshard-" + std::to_string(k) + ".log";
+          shard.command = quoted(program) + " --shard " + std::to_string(k) + "/" + std::to_string(jobs) +
+                          " --seed " + quoted(seed) + passed;
+          if (!savePath.empty())
+          {
+               shard.baselinePath = savePath + "." + std::to_string(k);
+               shard.command += " --save-baseline " + quoted(shard.baselinePath);
+          }
+          shard.command += " > " + quoted(shard.logPath) + " 2>&1";
+          shard.status = -1;
+     }
+     runShards(shards, jobs);
+     const double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+     std::string merged, summaries;
+     int failures = 0, regressions = 0;
+     for (int k = 0; k < jobs; k++)
+     {
+          if (!mergeLog(shards[k], k == 0, merged, summaries))
+          {
+               merged += "shard " + std::to_string(k) + ": no log at " + shards[k].logPath + "\n";
+          }
+          if (shards[k].status < 0 || shards[k].status >= 100)
+          {
+               failures++; // Did not start, crashed or rejected its arguments
+          }
+          else
+          {
+               regressions += shards[k].status;
+          }
+     }
+     std::printf("seed %s, %d shards\n%s", seed.c_str(), jobs, merged.c_str());
+     for (int k = 0; k < jobs; k++)
+     {
+          std::printf("shard %d: exit %d\n", k, shards[k].status);
+     }
+     std::printf("%s%.1f s wall, %d failed shards\n", summaries.c_str(), seconds, failures);
+
+     if (!savePath.empty())
+     {
+          std::FILE *out = std::fopen(savePath.c_str(), "wb");
+          if (out == nullptr)
+          {
+               std::fprintf(stderr, "cannot write %s\n", savePath.c_str());
+               failures++;
+          }
+          else
+          {
+               for (const Shard &shard : shards)
+               {
+                    failures += appendFile(shard.baselinePath, out) ? 0 : 1;
+                    std::remove(shard.baselinePath.c_str());
+               }
+               std::fclose(out);
+          }
+     }
+     return failures > 0 ? 100 : SDL_min(regressions, 99);
+}
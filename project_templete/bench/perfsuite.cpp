@@ -0,0 +1,426 @@
+// Description:
+// Microbenchmarks for the SDL calls the game leans on, grouped like SDL's
+// testautomation_* suites (surface, pixels, rect, render, audio, rwops,
+// stdlib) and run through perf_harness, so a change of SDL version,
+// compiler or flags that slows one of them shows up as a regression
+// against a stored baseline:
+//
+//     ./perfsuite.exe --save-baseline perf_baseline.txt    (reference run)
+//     ./perfsuite.exe --baseline perf_baseline.txt         (later runs)
+//
+// Input surfaces and buffers come from perfRandom(), so --seed picks them
+// and perfshard.exe can spread the suites over processes without
+// changing what any case measures.
+//
+// The exit status is the number of regressions. Everything runs on
+// surfaces and SDL's software renderer, so no window or GPU is needed.
+//
+// Build and run from project_templete/:
+//     make perfsuite && ./perfsuite.exe --quick
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <vector>
+
+#include "perf_harness.h"
+
+namespace
+{
+     const int WIDTH = 512;
+     const int HEIGHT = 512;
+     const Uint64 FRAME_BYTES = (Uint64)WIDTH * HEIGHT * 4;
+     const int AUDIO_FRAMES = 4096;
+     const int BUFFER_BYTES = 64 * 1024;
+
+     // Surface, pixels and render cases share two ARGB surfaces
+     struct Surfaces
+     {
+          SDL_Surface *src;
+          SDL_Surface *dst;
+          SDL_Renderer *renderer; // Software, drawing into dst
+     };
+
+     void *surfacesSetUp()
+     {
+          Surfaces *surfaces = new Surfaces;
+          surfaces->src = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+          surfaces->dst = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+          surfaces->renderer = surfaces->dst != nullptr ? SDL_CreateSoftwareRenderer(surfaces->dst) : nullptr;
+          if (surfaces->src == nullptr || surfaces->dst == nullptr || surfaces->renderer == nullptr)
+          {
+               SDL_FreeSurface(surfaces->src);
+               SDL_FreeSurface(surfaces->dst);
+               delete surfaces;
+               return nullptr;
+          }
+          Uint32 *pixels = (Uint32 *)surfaces->src->pixels;
+          for (int i = 0; i < WIDTH * HEIGHT; i++)
+          {
+               pixels[i] = perfRandom();
+          }
+          return surfaces;
+     }
+
+     void surfacesTearDown(void *arg)
+     {
+          Surfaces *surfaces = (Surfaces *)arg;
+          SDL_DestroyRenderer(surfaces->renderer);
+          SDL_FreeSurface(surfaces->src);
+          SDL_FreeSurface(surfaces->dst);
+          delete surfaces;
+     }
+
+     // surface
+     void blitCopy(void *arg, int iterations)
+     {
+          Surfaces &surfaces = *(Surfaces *)arg;
+          SDL_SetSurfaceBlendMode(surfaces.src, SDL_BLENDMODE_NONE);
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_BlitSurface(surfaces.src, nullptr, surfaces.dst, nullptr);
+          }
+     }
+
+     void blitBlend(void *arg, int iterations)
+     {
+          Surfaces &surfaces = *(Surfaces *)arg;
+          SDL_SetSurfaceBlendMode(surfaces.src, SDL_BLENDMODE_BLEND);
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_BlitSurface(surfaces.src, nullptr, surfaces.dst, nullptr);
+          }
+     }
+
+     void blitScaled(void *arg, int iterations)
+     {
+          Surfaces &surfaces = *(Surfaces *)arg;
+          SDL_SetSurfaceBlendMode(surfaces.src, SDL_BLENDMODE_NONE);
+          SDL_Rect from = {0, 0, WIDTH / 2, HEIGHT / 2};
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_BlitScaled(surfaces.src, &from, surfaces.dst, nullptr);
+          }
+     }
+
+     void fillRect(void *arg, int iterations)
+     {
+          Surfaces &surfaces = *(Surfaces *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_FillRect(surfaces.dst, nullptr, 0xff204080u + (Uint32)i);
+          }
+     }
+
+     // pixels
+     void convertSwizzle(void *arg, int iterations)
+     {
+          Surfaces &surfaces = *(Surfaces *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_ConvertPixels(WIDTH, HEIGHT, SDL_PIXELFORMAT_ARGB8888, surfaces.src->pixels, surfaces.src->pitch,
+                                 SDL_PIXELFORMAT_ABGR8888, surfaces.dst->pixels, surfaces.dst->pitch);
+          }
+     }
+
+     void convertTo565(void *arg, int iterations)
+     {
+          Surfaces &surfaces = *(Surfaces *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_ConvertPixels(WIDTH, HEIGHT, SDL_PIXELFORMAT_ARGB8888, surfaces.src->pixels, surfaces.src->pitch,
+                                 SDL_PIXELFORMAT_RGB565, surfaces.dst->pixels, surfaces.dst->pitch);
+          }
+     }
+
+     void mapRGBA(void *arg, int iterations)
+     {
+          Surfaces &surfaces = *(Surfaces *)arg;
+          Uint32 sum = 0;
+          for (int i = 0; i < iterations; i++)
+          {
+               sum += SDL_MapRGBA(surfaces.dst->format, (Uint8)i, (Uint8)(i >> 3), (Uint8)(i >> 5), 255);
+          }
+          perfKeep(&sum);
+     }
+
+     // render
+     void renderFillRects(void *arg, int iterations)
+     {
+          Surfaces &surfaces = *(Surfaces *)arg;
+          SDL_Rect rects[64];
+          for (int r = 0; r < 64; r++)
+          {
+               rects[r] = {(r * 37) % (WIDTH - 32), (r * 91) % (HEIGHT - 32), 32, 32};
+          }
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_SetRenderDrawColor(surfaces.renderer, (Uint8)i, 128, 64, 255);
+               SDL_RenderFillRects(surfaces.renderer, rects, 64);
+               SDL_RenderFlush(surfaces.renderer);
+          }
+     }
+
+     void renderGeometry(void *arg, int iterations)
+     {
+          Surfaces &surfaces = *(Surfaces *)arg;
+          SDL_Vertex vertices[3 * 32];
+          for (int t = 0; t < 32; t++)
+          {
+               const float x = (float)((t * 53) % (WIDTH - 64)), y = (float)((t * 29) % (HEIGHT - 64));
+               vertices[t * 3 + 0] = {{x, y}, {255, 0, 0, 255}, {0, 0}};
+               vertices[t * 3 + 1] = {{x + 64, y}, {0, 255, 0, 255}, {1, 0}};
+               vertices[t * 3 + 2] = {{x, y + 64}, {0, 0, 255, 255}, {0, 1}};
+          }
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_RenderGeometry(surfaces.renderer, nullptr, vertices, 3 * 32, nullptr, 0);
+               SDL_RenderFlush(surfaces.renderer);
+          }
+     }
+
+     // rect
+     void intersectRects(void *, int iterations)
+     {
+          int hits = 0;
+          for (int i = 0; i < iterations; i++)
+          {
+               const SDL_Rect a = {i & 255, (i >> 2) & 255, 64, 48};
+               const SDL_Rect b = {128, 96, 80, 80};
+               SDL_Rect out;
+               hits += SDL_IntersectRect(&a, &b, &out) ? 1 : 0;
+          }
+          perfKeep(&hits);
+     }
+
+     void enclosePoints(void *, int iterations)
+     {
+          SDL_Point points[256];
+          for (int p = 0; p < 256; p++)
+          {
+               points[p] = {(p * 73) % 1000, (p * 151) % 1000};
+          }
+          SDL_Rect out = {0, 0, 0, 0};
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_EnclosePoints(points, 256, nullptr, &out);
+          }
+          perfKeep(&out);
+     }
+
+     // audio
+     struct AudioBuffers
+     {
+          SDL_AudioCVT toFloat;
+          SDL_AudioCVT resample;
+          std::vector<Uint8> buffer;
+          std::vector<Uint8> source;
+     };
+
+     void *audioSetUp()
+     {
+          AudioBuffers *audio = new AudioBuffers;
+          if (SDL_BuildAudioCVT(&audio->toFloat, AUDIO_S16SYS, 2, 48000, AUDIO_F32SYS, 2, 48000) < 0 ||
+              SDL_BuildAudioCVT(&audio->resample, AUDIO_S16SYS, 2, 44100, AUDIO_S16SYS, 2, 48000) < 0)
+          {
+               delete audio;
+               return nullptr;
+          }
+          audio->source.resize(AUDIO_FRAMES * 4);
+          for (size_t i = 0; i < audio->source.size(); i++)
+          {
+               audio->source[i] = (Uint8)perfRandom();
+          }
+          audio->buffer.resize(audio->source.size() * SDL_max(audio->toFloat.len_mult, audio->resample.len_mult) + 64);
+          return audio;
+     }
+
+     void audioTearDown(void *arg)
+     {
+          delete (AudioBuffers *)arg;
+     }
+
+     void runCVT(SDL_AudioCVT &cvt, AudioBuffers &audio, int iterations)
+     {
+          cvt.buf = audio.buffer.data();
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_memcpy(cvt.buf, audio.source.data(), audio.source.size());
+               cvt.len = (int)audio.source.size();
+               SDL_ConvertAudio(&cvt);
+          }
+     }
+
+     void audioToFloat(void *arg, int iterations)
+     {
+          AudioBuffers &audio = *(AudioBuffers *)arg;
+          runCVT(audio.toFloat, audio, iterations);
+     }
+
+     void audioResample(void *arg, int iterations)
+     {
+          AudioBuffers &audio = *(AudioBuffers *)arg;
+          runCVT(audio.resample, audio, iterations);
+     }
+
+     // rwops and stdlib share two plain buffers
+     struct Buffers
+     {
+          std::vector<Uint8> src;
+          std::vector<Uint8> dst;
+          std::vector<char> text;
+     };
+
+     void *buffersSetUp()
+     {
+          Buffers *buffers = new Buffers{std::vector<Uint8>(BUFFER_BYTES), std::vector<Uint8>(BUFFER_BYTES),
+                                         std::vector<char>(BUFFER_BYTES, 'x')};
+          buffers->text.back() = '\0';
+          for (Uint8 &byte : buffers->src)
+          {
+               byte = (Uint8)perfRandom();
+          }
+          return buffers;
+     }
+
+     void buffersTearDown(void *arg)
+     {
+          delete (Buffers *)arg;
+     }
+
+     void rwopsReadChunks(void *arg, int iterations)
+     {
+          Buffers &buffers = *(Buffers *)arg;
+          SDL_RWops *rw = SDL_RWFromConstMem(buffers.src.data(), BUFFER_BYTES);
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_RWseek(rw, 0, RW_SEEK_SET);
+               while (SDL_RWread(rw, buffers.dst.data(), 1, 4096) == 4096)
+               {
+               }
+          }
+          SDL_RWclose(rw);
+     }
+
+     void rwopsReadValues(void *arg, int iterations)
+     {
+          Buffers &buffers = *(Buffers *)arg;
+          SDL_RWops *rw = SDL_RWFromConstMem(buffers.src.data(), BUFFER_BYTES);
+          Uint32 sum = 0;
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_RWseek(rw, 0, RW_SEEK_SET);
+               for (int v = 0; v < 1024; v++)
+               {
+                    sum += SDL_ReadLE32(rw);
+               }
+          }
+          SDL_RWclose(rw);
+          perfKeep(&sum);
+     }
+
+     void stdlibMemcpy(void *arg, int iterations)
+     {
+          Buffers &buffers = *(Buffers *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_memcpy(buffers.dst.data(), buffers.src.data(), BUFFER_BYTES);
+               perfKeep(buffers.dst.data());
+          }
+     }
+
+     void stdlibMemset4(void *arg, int iterations)
+     {
+          Buffers &buffers = *(Buffers *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_memset4(buffers.dst.data(), 0x01020304u + (Uint32)i, BUFFER_BYTES / 4);
+               perfKeep(buffers.dst.data());
+          }
+     }
+
+     void stdlibStrlen(void *arg, int iterations)
+     {
+          Buffers &buffers = *(Buffers *)arg;
+          size_t total = 0;
+          for (int i = 0; i < iterations; i++)
+          {
+               total += SDL_strlen(buffers.text.data());
+               perfKeep(buffers.text.data());
+          }
+          perfKeep(&total);
+     }
+
+     void stdlibSnprintf(void *, int iterations)
+     {
+          char line[64];
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_snprintf(line, sizeof(line), "score %d x %.2f", i, i * 0.5);
+               perfKeep(line);
+          }
+     }
+
+     const PerfCaseReference blitCopyCase = {blitCopy, "blit_copy", "SDL_BlitSurface, no blending", FRAME_BYTES, true};
+     const PerfCaseReference blitBlendCase = {blitBlend, "blit_blend", "SDL_BlitSurface, alpha blended", FRAME_BYTES, true};
+     const PerfCaseReference blitScaledCase = {blitScaled, "blit_scaled", "SDL_BlitScaled, 2x up", FRAME_BYTES, true};
+     const PerfCaseReference fillRectCase = {fillRect, "fill_rect", "SDL_FillRect, whole surface", FRAME_BYTES, true};
+     const PerfCaseReference *surfaceCases[] = {&blitCopyCase, &blitBlendCase, &blitScaledCase, &fillRectCase, nullptr};
+
+     const PerfCaseReference swizzleCase = {convertSwizzle, "convert_argb_abgr", "SDL_ConvertPixels swizzle", FRAME_BYTES, true};
+     const PerfCaseReference to565Case = {convertTo565, "convert_argb_565", "SDL_ConvertPixels to RGB565", FRAME_BYTES, true};
+     const PerfCaseReference mapCase = {mapRGBA, "map_rgba", "SDL_MapRGBA", 0, true};
+     const PerfCaseReference *pixelsCases[] = {&swizzleCase, &to565Case, &mapCase, nullptr};
+
+     const PerfCaseReference fillRectsCase = {renderFillRects, "fill_rects", "64 32x32 rects, software renderer", 0, true};
+     const PerfCaseReference geometryCase = {renderGeometry, "geometry", "32 coloured triangles", 0, true};
+     const PerfCaseReference *renderCases[] = {&fillRectsCase, &geometryCase, nullptr};
+
+     const PerfCaseReference intersectCase = {intersectRects, "intersect", "SDL_IntersectRect", 0, true};
+     const PerfCaseReference encloseCase = {enclosePoints, "enclose_points", "SDL_EnclosePoints, 256 points", 0, true};
+     const PerfCaseReference *rectCases[] = {&intersectCase, &encloseCase, nullptr};
+
+     const PerfCaseReference toFloatCase = {audioToFloat, "s16_to_f32", "SDL_ConvertAudio, 4096 stereo frames",
+                                            AUDIO_FRAMES * 4, true};
+     const PerfCaseReference resampleCase = {audioResample, "resample_44k_48k", "SDL_ConvertAudio, 4096 stereo frames",
+                                             AUDIO_FRAMES * 4, true};
+     const PerfCaseReference *audioCases[] = {&toFloatCase, &resampleCase, nullptr};
+
+     const PerfCaseReference chunksCase = {rwopsReadChunks, "read_4k_chunks", "SDL_RWread from memory", BUFFER_BYTES, true};
+     const PerfCaseReference valuesCase = {rwopsReadValues, "read_le32", "SDL_ReadLE32 x 1024", 4096, true};
+     const PerfCaseReference *rwopsCases[] = {&chunksCase, &valuesCase, nullptr};
+
+     const PerfCaseReference memcpyCase = {stdlibMemcpy, "memcpy_64k", "SDL_memcpy", BUFFER_BYTES, true};
+     const PerfCaseReference memset4Case = {stdlibMemset4, "memset4_64k", "SDL_memset4", BUFFER_BYTES, true};
+     const PerfCaseReference strlenCase = {stdlibStrlen, "strlen_64k", "SDL_strlen", BUFFER_BYTES, true};
+     const PerfCaseReference snprintfCase = {stdlibSnprintf, "snprintf", "SDL_snprintf, int and float", 0, true};
+     const PerfCaseReference *stdlibCases[] = {&memcpyCase, &memset4Case, &strlenCase, &snprintfCase, nullptr};
+
+     const PerfSuiteReference surfaceSuite = {"surface", surfacesSetUp, surfaceCases, surfacesTearDown};
+     const PerfSuiteReference pixelsSuite = {"pixels", surfacesSetUp, pixelsCases, surfacesTearDown};
+     const PerfSuiteReference renderSuite = {"render", surfacesSetUp, renderCases, surfacesTearDown};
+     const PerfSuiteReference rectSuite = {"rect", nullptr, rectCases, nullptr};
+     const PerfSuiteReference audioSuite = {"audio", audioSetUp, audioCases, audioTearDown};
+     const PerfSuiteReference rwopsSuite = {"rwops", buffersSetUp, rwopsCases, buffersTearDown};
+     const PerfSuiteReference stdlibSuite = {"stdlib", buffersSetUp, stdlibCases, buffersTearDown};
+
+     const PerfSuiteReference *suites[] = {&surfaceSuite, &pixelsSuite, &renderSuite, &rectSuite,
+                                           &audioSuite,   &rwopsSuite,  &stdlibSuite, nullptr};
+}
+
+int main(int argc, char *argv[])
+{
+     PerfOptions options = perfDefaultOptions();
+     if (!perfParseArguments(options, argc, argv))
+     {
+          return 2;
+     }
+     if (SDL_Init(SDL_INIT_TIMER) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 2;
+     }
+     const int regressions = perfRunSuites(suites, options);
+     SDL_Quit();
+     return SDL_min(regressions, 100);
+}
@@ -0,0 +1,140 @@
+// Description:
+// Compile-time pixel format benchmark. Converts a 1080p frame between
+// common SDL_PIXELFORMAT_* pairs with pixelConvertRect (pixel_format.h)
+// and with SDL_ConvertPixels, counts pixels where the two disagree, and
+// reports Mpixel/s for each. A per-pixel SDL_MapRGBA loop, the usual way
+// a tool writes pixels of a format it only knows at run time, is timed
+// against PixelFormat<F>::pack.
+//
+// Build and run from project_templete/:  make pixelbench && ./pixelbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "pixel_format.h"
+
+namespace
+{
+     const int WIDTH = 1920;
+     const int HEIGHT = 1080;
+     const int ITERATIONS = 50;
+     const int PIXELS = WIDTH * HEIGHT;
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     double megapixels(double seconds)
+     {
+          return (double)PIXELS * ITERATIONS / SDL_max(1e-9, seconds) / 1e6;
+     }
+
+     template <Uint32 From, Uint32 To>
+     void runPair(const std::vector<Uint8> &source)
+     {
+          typedef PixelFormat<From> S;
+          typedef PixelFormat<To> D;
+          const int srcPitch = WIDTH * S::bytesPerPixel, dstPitch = WIDTH * D::bytesPerPixel;
+          std::vector<Uint8> expected((size_t)dstPitch * HEIGHT), actual((size_t)dstPitch * HEIGHT);
+
+          SDL_ConvertPixels(WIDTH, HEIGHT, From, source.data(), srcPitch, To, expected.data(), dstPitch);
+          pixelConvertRect<From, To>(WIDTH, HEIGHT, source.data(), srcPitch, actual.data(), dstPitch);
+          int bad = 0;
+          for (int i = 0; i < PIXELS; i++)
+          {
+               bad += D::load(&expected[(size_t)i * D::bytesPerPixel]) != D::load(&actual[(size_t)i * D::bytesPerPixel]);
+          }
+
+          Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < ITERATIONS; i++)
+          {
+               SDL_ConvertPixels(WIDTH, HEIGHT, From, source.data(), srcPitch, To, expected.data(), dstPitch);
+          }
+          const double sdlSeconds = secondsSince(start);
+          start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < ITERATIONS; i++)
+          {
+               pixelConvertRect<From, To>(WIDTH, HEIGHT, source.data(), srcPitch, actual.data(), dstPitch);
+          }
+          const double seconds = secondsSince(start);
+
+          char pair[64];
+          SDL_snprintf(pair, sizeof(pair), "%s->%s", SDL_GetPixelFormatName(From) + 16, SDL_GetPixelFormatName(To) + 16);
+          std::printf("%-24s %10.0f %10.0f %8.2fx %10d\n", pair, megapixels(sdlSeconds), megapixels(seconds),
+                      sdlSeconds / SDL_max(1e-9, seconds), bad);
+     }
+
+     void runPack(const std::vector<Uint8> &source)
+     {
+          typedef PixelFormat<SDL_PIXELFORMAT_RGB565> P;
+          std::vector<Uint16> expected(PIXELS), actual(PIXELS);
+          SDL_PixelFormat *format = SDL_AllocFormat(SDL_PIXELFORMAT_RGB565);
+
+          Uint64 start = SDL_GetPerformanceCounter();
+          for (int n = 0; n < ITERATIONS; n++)
+          {
+               for (int i = 0; i < PIXELS; i++)
+               {
+                    const Uint8 *c = &source[(size_t)i * 4];
+                    expected[i] = (Uint16)SDL_MapRGBA(format, c[0], c[1], c[2], c[3]);
+               }
+          }
+          const double sdlSeconds = secondsSince(start);
+          start = SDL_GetPerformanceCounter();
+          for (int n = 0; n < ITERATIONS; n++)
+          {
+               for (int i = 0; i < PIXELS; i++)
+               {
+                    const Uint8 *c = &source[(size_t)i * 4];
+                    actual[i] = (Uint16)P::pack(c[0], c[1], c[2], c[3]);
+               }
+          }
+          const double seconds = secondsSince(start);
+          SDL_FreeFormat(format);
+
+          int bad = 0;
+          for (int i = 0; i < PIXELS; i++)
+          {
+               bad += expected[i] != actual[i];
+          }
+          std::printf("%-24s %10.0f %10.0f %8.2fx %10d\n", "MapRGBA RGB565", megapixels(sdlSeconds), megapixels(seconds),
+                      sdlSeconds / SDL_max(1e-9, seconds), bad);
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     std::vector<Uint8> source((size_t)PIXELS * 4);
+     std::srand(1);
+     for (Uint8 &byte : source)
+     {
+          byte = (Uint8)std::rand();
+     }
+
+     std::printf("%dx%d, %d iterations\n\n", WIDTH, HEIGHT, ITERATIONS);
+     std::printf("%-24s %10s %10s %9s %10s\n", "conversion", "SDL Mpx/s", "Mpixel/s", "speedup", "mismatches");
+     runPair<SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_ABGR8888>(source);
+     runPair<SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_RGBA8888>(source);
+     runPair<SDL_PIXELFORMAT_ABGR8888, SDL_PIXELFORMAT_RGB565>(source);
+     runPair<SDL_PIXELFORMAT_RGB565, SDL_PIXELFORMAT_ARGB8888>(source);
+     runPair<SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_ARGB4444>(source);
+     runPair<SDL_PIXELFORMAT_ARGB1555, SDL_PIXELFORMAT_ABGR8888>(source);
+     runPair<SDL_PIXELFORMAT_RGB24, SDL_PIXELFORMAT_ARGB8888>(source);
+     runPair<SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_BGR24>(source);
+     runPack(source);
+
+     SDL_Quit();
+     return 0;
+}
@@ -0,0 +1,152 @@
+// Description:
+// Random number benchmark. Fills ten million floats in [0, 1) and ints in
+// [0, 770) with rand() (the C library's, as main.cpp used), one
+// randomStreamFloat()/randomStreamRange() call at a time, and with the
+// randomStreamFloats()/randomStreamInts() batches. It also times four
+// threads drawing at once: from one shared rand(), then from their own
+// streams. Reports nanoseconds per number.
+//
+// Build and run from project_templete/:  make randombench && ./randombench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "random_stream.h"
+
+namespace
+{
+     const int COUNT = 10000000;
+     const int THREADS = 4;
+     const int RANGE = 770; // SCREEN_WIDTH - BLOCK_SIZE
+
+     struct DrawJob
+     {
+          RandomStream stream;
+          bool shared; // rand() instead of the stream
+          double sum;
+     };
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     void report(const char *name, double seconds, int count, double checksum)
+     {
+          std::printf("%-28s %7.3f ns/number  (%g)\n", name, seconds * 1e9 / count, checksum);
+     }
+
+     double sumOf(const std::vector<float> &values)
+     {
+          double sum = 0.0;
+          for (float value : values)
+          {
+               sum += value;
+          }
+          return sum;
+     }
+
+     int SDLCALL drawNumbers(void *data)
+     {
+          DrawJob &job = *(DrawJob *)data;
+          double sum = 0.0;
+          for (int i = 0; i < COUNT / THREADS; i++)
+          {
+               sum += job.shared ? rand() % RANGE : randomStreamRange(job.stream, RANGE);
+          }
+          job.sum = sum;
+          return 0;
+     }
+
+     void runThreads(const char *name, bool shared)
+     {
+          DrawJob jobs[THREADS];
+          SDL_Thread *threads[THREADS];
+          const Uint64 start = SDL_GetPerformanceCounter();
+          for (int t = 0; t < THREADS; t++)
+          {
+               randomStreamInit(jobs[t].stream, 1, t);
+               jobs[t].shared = shared;
+               threads[t] = SDL_CreateThread(drawNumbers, "randombench", &jobs[t]);
+          }
+          double sum = 0.0;
+          for (int t = 0; t < THREADS; t++)
+          {
+               SDL_WaitThread(threads[t], nullptr);
+               sum += jobs[t].sum;
+          }
+          report(name, secondsSince(start), COUNT, sum);
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     std::vector<float> floats(COUNT);
+     std::vector<int> ints(COUNT);
+     RandomStream stream;
+     randomStreamInit(stream, 1);
+     srand(1);
+
+     Uint64 start = SDL_GetPerformanceCounter();
+     for (int i = 0; i < COUNT; i++)
+     {
+          floats[i] = rand() * (1.0f / ((float)RAND_MAX + 1.0f));
+     }
+     report("rand() floats", secondsSince(start), COUNT, sumOf(floats));
+
+     start = SDL_GetPerformanceCounter();
+     for (int i = 0; i < COUNT; i++)
+     {
+          floats[i] = randomStreamFloat(stream);
+     }
+     report("randomStreamFloat", secondsSince(start), COUNT, sumOf(floats));
+
+     start = SDL_GetPerformanceCounter();
+     randomStreamFloats(stream, floats.data(), floats.size(), 0.0f, 1.0f);
+     report("randomStreamFloats", secondsSince(start), COUNT, sumOf(floats));
+
+     double sum = 0.0;
+     start = SDL_GetPerformanceCounter();
+     for (int i = 0; i < COUNT; i++)
+     {
+          ints[i] = rand() % RANGE;
+     }
+     const double randInts = secondsSince(start);
+     for (int value : ints)
+     {
+          sum += value;
+     }
+     report("rand() % range", randInts, COUNT, sum);
+
+     sum = 0.0;
+     start = SDL_GetPerformanceCounter();
+     for (int i = 0; i < COUNT; i++)
+     {
+          ints[i] = randomStreamRange(stream, RANGE);
+     }
+     const double streamInts = secondsSince(start);
+     for (int value : ints)
+     {
+          sum += value;
+     }
+     report("randomStreamRange", streamInts, COUNT, sum);
+
+     sum = 0.0;
+     start = SDL_GetPerformanceCounter();
+     randomStreamInts(stream, ints.data(), ints.size(), RANGE);
+     const double batchInts = secondsSince(start);
+     for (int value : ints)
+     {
+          sum += value;
+     }
+     report("randomStreamInts", batchInts, COUNT, sum);
+
+     runThreads("4 threads, shared rand()", true);
+     runThreads("4 threads, own streams", false);
+     return 0;
+}
@@ -0,0 +1,196 @@
+// Description:
+// Software rasterizer benchmark. Draws a 1080p frame of textured, tinted,
+// rotated sprites through SDL's own software renderer (SDL_RenderGeometry
+// on SDL_CreateSoftwareRenderer) and through soft_raster with every kernel
+// this CPU supports, on one thread and on the job system. Each soft_raster
+// frame is checked against the scalar kernel pixel for pixel, and the
+// report shows milliseconds per frame next to the 60 FPS budget.
+//
+// Build and run from project_templete/:  make rasterbench && ./rasterbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "job_system.h"
+#include "soft_raster.h"
+
+namespace
+{
+     const int WIDTH = 1920;
+     const int HEIGHT = 1080;
+     const int SPRITES = 4000;
+     const int SPRITE_SIZE = 32;
+     const int ITERATIONS = 20;
+
+     // Two triangles per sprite, as quad_batch would submit them
+     void buildSprites(std::vector<SDL_Vertex> &vertices, std::vector<int> &indices)
+     {
+          std::srand(1);
+          for (int i = 0; i < SPRITES; i++)
+          {
+               const float cx = (float)(std::rand() % WIDTH);
+               const float cy = (float)(std::rand() % HEIGHT);
+               const float angle = (float)(std::rand() % 628) / 100.0f;
+               const float half = SPRITE_SIZE * 0.5f;
+               const float c = std::cos(angle) * half;
+               const float s = std::sin(angle) * half;
+               const SDL_Color tint = {(Uint8)(128 + std::rand() % 128), (Uint8)(128 + std::rand() % 128),
+                                       (Uint8)(128 + std::rand() % 128), (Uint8)(160 + std::rand() % 96)};
+               const float corners[4][4] = {{-1, -1, 0, 0}, {1, -1, 1, 0}, {1, 1, 1, 1}, {-1, 1, 0, 1}};
+               const int base = (int)vertices.size();
+               for (const auto &corner : corners)
+               {
+                    SDL_Vertex vertex;
+                    vertex.position = SDL_FPoint{cx + corner[0] * c - corner[1] * s, cy + corner[0] * s + corner[1] * c};
+                    vertex.color = tint;
+                    vertex.tex_coord = SDL_FPoint{corner[2], corner[3]};
+                    vertices.push_back(vertex);
+               }
+               const int quad[6] = {0, 1, 2, 0, 2, 3};
+               for (int index : quad)
+               {
+                    indices.push_back(base + index);
+               }
+          }
+     }
+
+     SDL_Surface *makeSpriteSurface()
+     {
+          SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, SPRITE_SIZE, SPRITE_SIZE, 32, SDL_PIXELFORMAT_ARGB8888);
+          Uint32 *pixels = (Uint32 *)surface->pixels;
+          for (int y = 0; y < SPRITE_SIZE; y++)
+          {
+               for (int x = 0; x < SPRITE_SIZE; x++)
+               {
+                    // A soft disc, so blending has partial alpha to work on
+                    const float dx = x + 0.5f - SPRITE_SIZE * 0.5f;
+                    const float dy = y + 0.5f - SPRITE_SIZE * 0.5f;
+                    const float edge = 1.0f - std::sqrt(dx * dx + dy * dy) / (SPRITE_SIZE * 0.5f);
+                    const Uint32 alpha = (Uint32)(SDL_max(0.0f, SDL_min(1.0f, edge * 3.0f)) * 255.0f);
+                    pixels[y * (surface->pitch / 4) + x] = (alpha << 24) | ((Uint32)(x * 8) << 16) | ((Uint32)(y * 8) << 8) | 0xC0;
+               }
+          }
+          return surface;
+     }
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     double timeSdl(SDL_Surface *target, SDL_Surface *sprite, const std::vector<SDL_Vertex> &vertices,
+                    const std::vector<int> &indices)
+     {
+          SDL_Renderer *renderer = SDL_CreateSoftwareRenderer(target);
+          SDL_Texture *texture = renderer != nullptr ? SDL_CreateTextureFromSurface(renderer, sprite) : nullptr;
+          if (texture == nullptr)
+          {
+               std::fprintf(stderr, "Software renderer unavailable: %s\n", SDL_GetError());
+               SDL_DestroyRenderer(renderer);
+               return 0.0;
+          }
+          SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+          Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < ITERATIONS; i++)
+          {
+               SDL_SetRenderDrawColor(renderer, 20, 30, 40, 255);
+               SDL_RenderClear(renderer);
+               SDL_RenderGeometry(renderer, texture, vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size());
+               SDL_RenderFlush(renderer);
+          }
+          double seconds = secondsSince(start) / ITERATIONS;
+          SDL_DestroyTexture(texture);
+          SDL_DestroyRenderer(renderer);
+          return seconds;
+     }
+
+     double timeSoft(SoftRaster &raster, SDL_Surface *target, SDL_Surface *sprite, const std::vector<SDL_Vertex> &vertices,
+                     const std::vector<int> &indices, int iterations)
+     {
+          Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_FillRect(target, NULL, SDL_MapRGB(target->format, 20, 30, 40));
+               softRasterBegin(raster, target);
+               softRasterGeometry(raster, sprite, vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size());
+               softRasterFlush(raster);
+          }
+          return secondsSince(start) / iterations;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     JobSystem jobs;
+     if (!jobSystemInit(jobs, 0))
+     {
+          std::fprintf(stderr, "Job system failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     std::vector<SDL_Vertex> vertices;
+     std::vector<int> indices;
+     buildSprites(vertices, indices);
+     SDL_Surface *sprite = makeSpriteSurface();
+     SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_RGB888);
+     SDL_Surface *reference = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_RGB888);
+
+     std::printf("%dx%d, %d sprites of %dx%d, %d threads, budget %.1f ms\n\n", WIDTH, HEIGHT, SPRITES, SPRITE_SIZE,
+                 SPRITE_SIZE, jobSystemThreadCount(jobs), 1000.0 / 60.0);
+     std::printf("%-16s %10s %10s %12s\n", "path", "ms/frame", "fps", "bad pixels");
+     const double sdlSeconds = timeSdl(target, sprite, vertices, indices);
+     std::printf("%-16s %10.2f %10.1f %12s\n", "SDL software", sdlSeconds * 1000.0, 1.0 / SDL_max(1e-9, sdlSeconds), "-");
+
+     {
+          SoftRaster scalar;
+          softRasterInit(scalar, nullptr, SOFT_RASTER_SCALAR);
+          timeSoft(scalar, reference, sprite, vertices, indices, 1);
+     }
+
+     const SoftRasterKernel kernels[] = {SOFT_RASTER_SCALAR, SOFT_RASTER_SSE2};
+     for (SoftRasterKernel kernel : kernels)
+     {
+          if (!softRasterKernelSupported(kernel))
+          {
+               continue;
+          }
+          for (int threaded = 0; threaded < 2; threaded++)
+          {
+               SoftRaster raster;
+               softRasterInit(raster, threaded ? &jobs : nullptr, kernel);
+               timeSoft(raster, target, sprite, vertices, indices, 1);
+               int bad = 0;
+               for (int y = 0; y < HEIGHT; y++)
+               {
+                    const Uint32 *a = (const Uint32 *)((const Uint8 *)target->pixels + y * target->pitch);
+                    const Uint32 *b = (const Uint32 *)((const Uint8 *)reference->pixels + y * reference->pitch);
+                    for (int x = 0; x < WIDTH; x++)
+                    {
+                         bad += a[x] != b[x];
+                    }
+               }
+               double seconds = timeSoft(raster, target, sprite, vertices, indices, ITERATIONS);
+               char name[32];
+               SDL_snprintf(name, sizeof(name), "%s%s", softRasterKernelName(kernel), threaded ? " x jobs" : "");
+               std::printf("%-16s %10.2f %10.1f %12d\n", name, seconds * 1000.0, 1.0 / seconds, bad);
+          }
+     }
+
+     SDL_FreeSurface(reference);
+     SDL_FreeSurface(target);
+     SDL_FreeSurface(sprite);
+     jobSystemDestroy(jobs);
+     SDL_Quit();
+     return 0;
+}
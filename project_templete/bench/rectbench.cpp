@@ -0,0 +1,166 @@
+// Description:
+// Batch rect test benchmark: rectBatchIntersects and rectBatchContainsPoints
+// through every kernel this CPU supports, against one SDL_HasIntersection or
+// SDL_PointInRect call per pair, as nanoseconds per test. Every kernel is
+// first checked bit for bit against the SDL functions over random rects and
+// points, with empty rects, negative sizes, shared edges and counts that
+// leave a partial last word mixed in.
+//
+// Build and run from project_templete/:
+//     make rectbench && ./rectbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <vector>
+
+#include "rect_batch.h"
+
+namespace
+{
+     const int BENCH_COUNT = 4096;
+     const int BENCH_PASSES = 2000;
+
+     Uint32 seed = 1;
+
+     int randomIn(int low, int high)
+     {
+          seed = seed * 1103515245u + 12345u;
+          return low + (int)((seed >> 8) % (Uint32)(high - low + 1));
+     }
+
+     // Small coordinates so edges, corners and empty rects coincide often
+     SDL_Rect randomRect()
+     {
+          return {randomIn(-8, 8), randomIn(-8, 8), randomIn(-2, 6), randomIn(-2, 6)};
+     }
+
+     bool bitSet(const std::vector<Uint32> &mask, int i)
+     {
+          return (mask[i / 32] >> (i % 32) & 1) != 0;
+     }
+
+     bool verifyKernel(RectBatchKernel kernel)
+     {
+          rectBatchSetKernel(kernel);
+          for (int round = 0; round < 2000; round++)
+          {
+               const int count = randomIn(0, 100);
+               const SDL_Rect query = randomRect();
+               std::vector<SDL_Rect> rects(count);
+               std::vector<SDL_Point> points(count);
+               for (int i = 0; i < count; i++)
+               {
+                    rects[i] = randomRect();
+                    points[i] = {randomIn(-10, 16), randomIn(-10, 16)};
+               }
+               // Filled with ones so a word the kernel forgets shows up
+               std::vector<Uint32> rectMask((count + 31) / 32 + 1, ~0u);
+               std::vector<Uint32> pointMask((count + 31) / 32 + 1, ~0u);
+               rectBatchIntersects(query, rects.data(), count, rectMask.data());
+               rectBatchContainsPoints(query, points.data(), count, pointMask.data());
+               for (int i = 0; i < count; i++)
+               {
+                    const bool rectExpected = SDL_HasIntersection(&query, &rects[i]) == SDL_TRUE;
+                    const bool pointExpected = SDL_PointInRect(&points[i], &query) == SDL_TRUE;
+                    if (bitSet(rectMask, i) != rectExpected || bitSet(pointMask, i) != pointExpected)
+                    {
+                         std::printf("%s: element %d of %d differs from SDL for {%d, %d, %d, %d}\n",
+                                     rectBatchKernelName(kernel), i, count, query.x, query.y, query.w, query.h);
+                         return false;
+                    }
+               }
+               // Bits past the count must be written, and written as zero
+               for (int i = count; i < (count + 31) / 32 * 32; i++)
+               {
+                    if (bitSet(rectMask, i) || bitSet(pointMask, i))
+                    {
+                         std::printf("%s: padding bit %d of %d left set\n", rectBatchKernelName(kernel), i, count);
+                         return false;
+                    }
+               }
+          }
+          return true;
+     }
+
+     double nsPerTest(Uint64 ticks)
+     {
+          return (double)ticks * 1e9 / SDL_GetPerformanceFrequency() / ((double)BENCH_COUNT * BENCH_PASSES);
+     }
+}
+
+int main(int, char *[])
+{
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     // Screen-sized data for timing: about a third of the rects overlap
+     std::vector<SDL_Rect> rects(BENCH_COUNT);
+     std::vector<SDL_Point> points(BENCH_COUNT);
+     for (int i = 0; i < BENCH_COUNT; i++)
+     {
+          rects[i] = {randomIn(0, 1900), randomIn(0, 1060), randomIn(1, 64), randomIn(1, 64)};
+          points[i] = {randomIn(0, 1920), randomIn(0, 1080)};
+     }
+     const SDL_Rect query = {640, 360, 640, 360};
+     std::vector<Uint32> mask((BENCH_COUNT + 31) / 32);
+
+     Uint64 start = SDL_GetPerformanceCounter();
+     int hits = 0;
+     for (int pass = 0; pass < BENCH_PASSES; pass++)
+     {
+          for (int i = 0; i < BENCH_COUNT; i++)
+          {
+               hits += SDL_HasIntersection(&query, &rects[i]);
+          }
+     }
+     const double sdlRects = nsPerTest(SDL_GetPerformanceCounter() - start);
+     start = SDL_GetPerformanceCounter();
+     for (int pass = 0; pass < BENCH_PASSES; pass++)
+     {
+          for (int i = 0; i < BENCH_COUNT; i++)
+          {
+               hits += SDL_PointInRect(&points[i], &query);
+          }
+     }
+     const double sdlPoints = nsPerTest(SDL_GetPerformanceCounter() - start);
+     std::printf("%-8s %12s %12s\n", "kernel", "rects ns", "points ns");
+     std::printf("%-8s %12.2f %12.2f\n", "sdl", sdlRects, sdlPoints);
+
+     int failures = 0;
+     const RectBatchKernel kernels[] = {RECT_KERNEL_SCALAR, RECT_KERNEL_SSE2, RECT_KERNEL_AVX2, RECT_KERNEL_NEON};
+     for (const RectBatchKernel kernel : kernels)
+     {
+          if (!rectBatchKernelSupported(kernel))
+          {
+               continue;
+          }
+          if (!verifyKernel(kernel))
+          {
+               failures++;
+               continue;
+          }
+          start = SDL_GetPerformanceCounter();
+          for (int pass = 0; pass < BENCH_PASSES; pass++)
+          {
+               rectBatchIntersects(query, rects.data(), BENCH_COUNT, mask.data());
+               hits += (int)(mask[pass % mask.size()] & 1);
+          }
+          const double batchRects = nsPerTest(SDL_GetPerformanceCounter() - start);
+          start = SDL_GetPerformanceCounter();
+          for (int pass = 0; pass < BENCH_PASSES; pass++)
+          {
+               rectBatchContainsPoints(query, points.data(), BENCH_COUNT, mask.data());
+               hits += (int)(mask[pass % mask.size()] & 1);
+          }
+          const double batchPoints = nsPerTest(SDL_GetPerformanceCounter() - start);
+          std::printf("%-8s %12.2f %12.2f\n", rectBatchKernelName(kernel), batchRects, batchPoints);
+     }
+     // Keeps the scalar loops from being optimized away
+     std::printf("(%d hits)\n", hits);
+     SDL_Quit();
+     return failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,181 @@
+// Description:
+// Rollback snapshot benchmark. Runs the game's simulation state (the block
+// pool of MAX_BLOCKS, its spatial grid and a struct of game variables,
+// registered with a SnapshotRing the way main.cpp does) with a block
+// spawned every few ticks, and measures what netplay rollback costs: a
+// snapshot after each tick, the size of its delta, restoring the state of
+// 8 ticks back, and a full correction, which is that restore plus the 8
+// ticks simulated again. The re-simulated state is checked to equal what
+// the first run reached. Reports microseconds per operation.
+//
+// Build and run from project_templete/:  make rollbackbench && ./rollbackbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <vector>
+
+#include "block_pool.h"
+#include "snapshot_ring.h"
+#include "spatial_grid.h"
+
+namespace
+{
+     const int MAX_BLOCKS = 4096;
+     const int BLOCK_SIZE = 30;
+     const int SCREEN_WIDTH = 800;
+     const int SCREEN_HEIGHT = 600;
+     const int WARMUP_TICKS = 600; // Fills the screen with blocks
+     const int ROUNDS = 2000;
+     const int ROLLBACK_TICKS = 8;
+
+     struct BenchSimulation
+     {
+          Uint32 tick;
+          Uint32 random;
+          int ticksUntilSpawn;
+          int landed;
+     };
+
+     struct BenchWorld
+     {
+          BenchSimulation sim;
+          BlockPool blocks;
+          SpatialGrid grid;
+          std::vector<int> hits;
+     };
+
+     double usSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) * 1e6 / SDL_GetPerformanceFrequency();
+     }
+
+     // The game's tick without the paddle: blocks rain every 3 ticks and at
+     // speeds that keep a few hundred on screen
+     void benchTick(BenchWorld &world)
+     {
+          BenchSimulation &sim = world.sim;
+          if (--sim.ticksUntilSpawn <= 0)
+          {
+               sim.random = sim.random * 1664525u + 1013904223u;
+               const float x = (float)((sim.random >> 8) % (SCREEN_WIDTH - BLOCK_SIZE));
+               blockPoolSpawn(world.blocks, x, 0.0f, 2.0f + (float)(sim.random >> 29));
+               sim.ticksUntilSpawn = 3;
+          }
+          blockPoolIntegrate(world.blocks);
+          for (int i = 0; i < world.blocks.highWater; i++)
+          {
+               if (world.blocks.alive[i])
+               {
+                    SDL_FRect bounds = {world.blocks.x[i], world.blocks.y[i], (float)BLOCK_SIZE, (float)BLOCK_SIZE};
+                    spatialGridUpdate(world.grid, i, bounds);
+               }
+          }
+          const SDL_FRect belowScreen = {0.0f, (float)(SCREEN_HEIGHT + BLOCK_SIZE), (float)SCREEN_WIDTH,
+                                         (float)SCREEN_HEIGHT};
+          world.hits.clear();
+          spatialGridQueryRect(world.grid, belowScreen, world.hits);
+          for (int id : world.hits)
+          {
+               sim.landed++;
+               spatialGridRemove(world.grid, id);
+               blockPoolDespawn(world.blocks, id);
+          }
+          sim.tick++;
+     }
+
+     // Everything the snapshot covers, copied out for comparison
+     std::vector<Uint8> benchState(const SnapshotRing &ring)
+     {
+          std::vector<Uint8> state;
+          for (const SnapshotSpan &span : ring.spans)
+          {
+               const Uint8 *bytes = (const Uint8 *)span.data;
+               state.insert(state.end(), bytes, bytes + span.size);
+          }
+          return state;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+
+     BenchWorld world;
+     SDL_zero(world.sim);
+     world.sim.random = 1;
+     world.sim.ticksUntilSpawn = 1;
+     blockPoolInit(world.blocks, MAX_BLOCKS);
+     const SDL_FRect playfield = {0.0f, 0.0f, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT};
+     spatialGridInit(world.grid, playfield, 64.0f, MAX_BLOCKS);
+     world.hits.reserve(MAX_BLOCKS);
+
+     SnapshotRing ring;
+     snapshotRingInit(ring, 16);
+     snapshotRingAddValue(ring, world.sim);
+     snapshotRingAddValue(ring, world.blocks.liveCount);
+     snapshotRingAddValue(ring, world.blocks.highWater);
+     snapshotRingAddValue(ring, world.blocks.freeCount);
+     snapshotRingAddVector(ring, world.blocks.x);
+     snapshotRingAddVector(ring, world.blocks.y);
+     snapshotRingAddVector(ring, world.blocks.prevY);
+     snapshotRingAddVector(ring, world.blocks.vy);
+     snapshotRingAddVector(ring, world.blocks.alive);
+     snapshotRingAddVector(ring, world.blocks.freeList);
+     snapshotRingAddValue(ring, world.grid.maxExtent);
+     snapshotRingAddVector(ring, world.grid.cellHead);
+     snapshotRingAddVector(ring, world.grid.bounds);
+     snapshotRingAddVector(ring, world.grid.cellOf);
+     snapshotRingAddVector(ring, world.grid.next);
+     snapshotRingAddVector(ring, world.grid.prev);
+
+     for (int i = 0; i < WARMUP_TICKS; i++)
+     {
+          benchTick(world);
+          snapshotRingSave(ring, world.sim.tick);
+     }
+
+     double tickUs = 0.0, saveUs = 0.0, restoreUs = 0.0, correctionUs = 0.0;
+     size_t deltaBytes = 0;
+     int mismatches = 0;
+     for (int round = 0; round < ROUNDS; round++)
+     {
+          Uint64 start = SDL_GetPerformanceCounter();
+          benchTick(world);
+          tickUs += usSince(start);
+          start = SDL_GetPerformanceCounter();
+          snapshotRingSave(ring, world.sim.tick);
+          saveUs += usSince(start);
+          deltaBytes += ring.lastDeltaBytes;
+
+          // Every 8th tick a correction: back 8 ticks and forward again
+          if (round % ROLLBACK_TICKS != 0)
+          {
+               continue;
+          }
+          const std::vector<Uint8> reached = benchState(ring);
+          const Uint32 now = world.sim.tick;
+          start = SDL_GetPerformanceCounter();
+          snapshotRingRestore(ring, now - ROLLBACK_TICKS);
+          restoreUs += usSince(start);
+          while (world.sim.tick != now)
+          {
+               benchTick(world);
+               snapshotRingSave(ring, world.sim.tick);
+          }
+          correctionUs += usSince(start);
+          mismatches += benchState(ring) != reached ? 1 : 0;
+     }
+
+     const int corrections = (ROUNDS + ROLLBACK_TICKS - 1) / ROLLBACK_TICKS;
+     std::printf("state                %8zu bytes, %d live blocks\n", ring.stateWords * sizeof(Uint64),
+                 world.blocks.liveCount);
+     std::printf("tick                 %8.2f us\n", tickUs / ROUNDS);
+     std::printf("snapshot             %8.2f us, delta %zu bytes\n", saveUs / ROUNDS, deltaBytes / ROUNDS);
+     std::printf("restore %d back       %8.2f us\n", ROLLBACK_TICKS, restoreUs / corrections);
+     std::printf("correction %d ticks   %8.2f us (restore, %d ticks and snapshots)\n", ROLLBACK_TICKS,
+                 correctionUs / corrections, ROLLBACK_TICKS);
+     std::printf("re-simulated states that differ: %d of %d\n", mismatches, corrections);
+     return mismatches == 0 ? 0 : 1;
+}
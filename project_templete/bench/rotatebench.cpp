@@ -0,0 +1,148 @@
+// Description:
+// Rotated sprite benchmark for render_queue. SPRITES sprites, each turning
+// at its own rate and a quarter of them flipped, are drawn two ways on the
+// software renderer, the case testrendercopyex shows:
+// - "copy ex": one SDL_RenderCopyExF per sprite;
+// - "queue ex": renderQueueCopyEx per sprite and one flush for all.
+// Prints draw calls and milliseconds per frame (best of five runs of
+// FRAMES frames). The two sample the texture differently (SDL's software
+// rotozoom against its triangle rasterizer), so the pictures match in
+// shape, not to the pixel.
+//
+// Build and run from project_templete/:
+//     make rotatebench && ./rotatebench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+
+#include "render_queue.h"
+
+namespace
+{
+     const int WIDTH = 1280, HEIGHT = 720;
+     const int SPRITES = 4000;
+     const int FRAMES = 10;
+     const int RUNS = 5;
+
+     struct Sprite
+     {
+          SDL_FRect dst;
+          double angle, spin; // Degrees, and degrees per frame
+          SDL_RendererFlip flip;
+     };
+
+     Uint32 nextRandom(Uint32 &state)
+     {
+          state ^= state << 13;
+          state ^= state >> 17;
+          state ^= state << 5;
+          return state;
+     }
+
+     void makeSprites(Sprite *sprites)
+     {
+          Uint32 state = 0x9E3779B9u;
+          for (int i = 0; i < SPRITES; i++)
+          {
+               Sprite &s = sprites[i];
+               s.dst = {(float)(nextRandom(state) % (WIDTH - 32)), (float)(nextRandom(state) % (HEIGHT - 32)), 32.0f, 32.0f};
+               s.angle = nextRandom(state) % 360;
+               s.spin = (double)(nextRandom(state) % 100) / 10.0 - 5.0;
+               s.flip = i % 4 == 0 ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE;
+          }
+     }
+
+     void drawCopyEx(SDL_Renderer *renderer, RenderQueue &queue, SDL_Texture *texture, const Sprite *sprites, int frame,
+                     int &calls)
+     {
+          (void)queue;
+          for (int i = 0; i < SPRITES; i++)
+          {
+               const Sprite &s = sprites[i];
+               SDL_RenderCopyExF(renderer, texture, nullptr, &s.dst, s.angle + s.spin * frame, nullptr, s.flip);
+          }
+          calls = SPRITES;
+     }
+
+     void drawQueueEx(SDL_Renderer *renderer, RenderQueue &queue, SDL_Texture *texture, const Sprite *sprites, int frame,
+                      int &calls)
+     {
+          for (int i = 0; i < SPRITES; i++)
+          {
+               const Sprite &s = sprites[i];
+               renderQueueCopyEx(queue, texture, nullptr, s.dst, s.angle + s.spin * frame, nullptr, s.flip);
+          }
+          renderQueueFlush(queue, renderer);
+          calls = queue.drawCalls;
+     }
+
+     typedef void (*DrawFunction)(SDL_Renderer *, RenderQueue &, SDL_Texture *, const Sprite *, int, int &);
+
+     double timeDraw(DrawFunction draw, SDL_Renderer *renderer, RenderQueue &queue, SDL_Texture *texture,
+                     const Sprite *sprites, int &calls)
+     {
+          double best = 1e30;
+          for (int run = 0; run < RUNS; run++)
+          {
+               const Uint64 start = SDL_GetPerformanceCounter();
+               for (int frame = 0; frame < FRAMES; frame++)
+               {
+                    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+                    SDL_RenderClear(renderer);
+                    draw(renderer, queue, texture, sprites, frame, calls);
+                    SDL_RenderFlush(renderer);
+               }
+               const double ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+               best = SDL_min(best, ms / FRAMES);
+          }
+          return best;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(0) != 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+     SDL_Renderer *renderer = target != nullptr ? SDL_CreateSoftwareRenderer(target) : nullptr;
+     SDL_Surface *image = SDL_CreateRGBSurfaceWithFormat(0, 32, 32, 32, SDL_PIXELFORMAT_ARGB8888);
+     for (int y = 0; image != nullptr && y < 32; y++)
+     {
+          for (int x = 0; x < 32; x++)
+          {
+               ((Uint32 *)((Uint8 *)image->pixels + y * image->pitch))[x] = 0xFF000000u | (x * 8) << 16 | (y * 8) << 8 | 0x80;
+          }
+     }
+     SDL_Texture *texture = renderer != nullptr && image != nullptr ? SDL_CreateTextureFromSurface(renderer, image) : nullptr;
+     if (texture == nullptr)
+     {
+          std::fprintf(stderr, "Unable to create the software renderer: %s\n", SDL_GetError());
+          return 1;
+     }
+     SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+     static Sprite sprites[SPRITES];
+     makeSprites(sprites);
+     RenderQueue queue;
+     renderQueueInit(queue, RENDER_BATCH_GEOMETRY, SPRITES);
+
+     std::printf("%d rotating sprites, %dx%d software renderer\n", SPRITES, WIDTH, HEIGHT);
+     int calls = 0;
+     const double exMs = timeDraw(drawCopyEx, renderer, queue, texture, sprites, calls);
+     std::printf("  copy ex   %6d calls  %8.3f ms\n", calls, exMs);
+     const double queueMs = timeDraw(drawQueueEx, renderer, queue, texture, sprites, calls);
+     std::printf("  queue ex  %6d calls  %8.3f ms\n", calls, queueMs);
+
+     SDL_DestroyTexture(texture);
+     SDL_FreeSurface(image);
+     SDL_DestroyRenderer(renderer);
+     SDL_FreeSurface(target);
+     SDL_Quit();
+     return 0;
+}
@@ -0,0 +1,194 @@
+// Description:
+// Force feedback benchmark for force_feedback. PADS virtual joysticks
+// count the output reports SDL hands them while ten simulated seconds of
+// gameplay feedback play at 60 FPS: an engine rumble that wanders and
+// jitters every frame, an impact burst now and then, and trigger rumble
+// following a brake input. The same feedback is sent once with a direct
+// SDL_JoystickRumble call per frame and once through forceFeedbackFlush().
+// The table shows the reports per second for each pad and the most
+// reports sent in any one frame.
+//
+// Build and run from project_templete/:
+//     make rumblebench && ./rumblebench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "force_feedback.h"
+
+namespace
+{
+     const int PADS = 4;
+     const int FRAMES = 600;
+     const Uint32 FRAME_MS = 16;
+
+     struct PadCounter
+     {
+          int reports;
+     };
+
+     int SDLCALL countRumble(void *userdata, Uint16 low, Uint16 high)
+     {
+          (void)low;
+          (void)high;
+          ((PadCounter *)userdata)->reports++;
+          return 0;
+     }
+
+     int SDLCALL countTriggers(void *userdata, Uint16 left, Uint16 right)
+     {
+          (void)left;
+          (void)right;
+          ((PadCounter *)userdata)->reports++;
+          return 0;
+     }
+
+     Uint16 toMotor(float level)
+     {
+          return (Uint16)(SDL_clamp(level, 0.0f, 1.0f) * 65535.0f);
+     }
+
+     // What pad `pad` should feel on `frame`: engine, impacts and brake
+     void feedbackAt(int pad, int frame, Uint32 &noise, Uint16 &low, Uint16 &high, Uint16 &trigger)
+     {
+          noise = noise * 1664525u + 1013904223u;
+          const float t = frame * (FRAME_MS / 1000.0f);
+          const float jitter = ((noise >> 8) & 0xFFFF) / 65535.0f * 0.02f;
+          const float engine = 0.3f + 0.2f * std::sin(t * 0.7f + pad) + jitter;
+          const bool impact = (frame + pad * 23) % 90 < 6;
+          low = toMotor(impact ? 1.0f : engine);
+          high = toMotor(impact ? 0.8f : engine * 0.5f);
+          const float brake = std::sin(t * 0.4f + pad * 1.3f);
+          trigger = toMotor(brake > 0.5f ? (brake - 0.5f) * 2.0f + jitter : 0.0f);
+     }
+
+     void report(const char *name, const std::vector<PadCounter> &pads, int requests, int peak)
+     {
+          std::printf("  %-22s", name);
+          for (int i = 0; i < PADS; i++)
+          {
+               std::printf(" %7.1f", pads[i].reports / (FRAMES * FRAME_MS / 1000.0));
+          }
+          std::printf("   %5d %9d\n", peak, requests);
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(SDL_INIT_JOYSTICK) != 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     std::vector<PadCounter> counters(PADS, PadCounter{0});
+     std::vector<SDL_Joystick *> joysticks;
+     for (int i = 0; i < PADS; i++)
+     {
+          SDL_VirtualJoystickDesc desc;
+          SDL_zero(desc);
+          desc.version = SDL_VIRTUAL_JOYSTICK_DESC_VERSION;
+          desc.type = SDL_JOYSTICK_TYPE_GAMECONTROLLER;
+          desc.naxes = 6;
+          desc.nbuttons = 15;
+          desc.name = "rumblebench pad";
+          desc.userdata = &counters[i];
+          desc.Rumble = countRumble;
+          desc.RumbleTriggers = countTriggers;
+          const int index = SDL_JoystickAttachVirtualEx(&desc);
+          SDL_Joystick *joystick = index >= 0 ? SDL_JoystickOpen(index) : nullptr;
+          if (joystick == nullptr)
+          {
+               std::fprintf(stderr, "Unable to attach a virtual joystick: %s\n", SDL_GetError());
+               return 1;
+          }
+          joysticks.push_back(joystick);
+     }
+
+     std::printf("%d pads, %d frames at 60 FPS; reports per second for each pad\n\n", PADS, FRAMES);
+     std::printf("  %-22s", "");
+     for (int i = 0; i < PADS; i++)
+     {
+          std::printf("   pad %d", i);
+     }
+     std::printf("   %5s %9s\n", "peak", "requests");
+
+     // Every frame straight to SDL, which only skips exact repeats
+     Uint32 noise = 1;
+     int peak = 0, requests = 0;
+     for (int frame = 0; frame < FRAMES; frame++)
+     {
+          int before = 0, after = 0;
+          for (int i = 0; i < PADS; i++)
+          {
+               before += counters[i].reports;
+          }
+          for (int i = 0; i < PADS; i++)
+          {
+               Uint16 low, high, trigger;
+               feedbackAt(i, frame, noise, low, high, trigger);
+               SDL_JoystickRumble(joysticks[i], low, high, 500);
+               SDL_JoystickRumbleTriggers(joysticks[i], trigger, trigger, 500);
+               requests += 2;
+          }
+          for (int i = 0; i < PADS; i++)
+          {
+               after += counters[i].reports;
+          }
+          peak = SDL_max(peak, after - before);
+     }
+     report("direct", counters, requests, peak);
+     for (int i = 0; i < PADS; i++)
+     {
+          SDL_JoystickRumble(joysticks[i], 0, 0, 0);
+          SDL_JoystickRumbleTriggers(joysticks[i], 0, 0, 0);
+          counters[i].reports = 0;
+     }
+
+     ForceFeedback feedback;
+     forceFeedbackInit(feedback, forceFeedbackDefaultConfig());
+     std::vector<int> devices;
+     for (int i = 0; i < PADS; i++)
+     {
+          devices.push_back(forceFeedbackAdd(feedback, joysticks[i]));
+     }
+     noise = 1;
+     peak = 0;
+     Uint32 now = SDL_GetTicks();
+     for (int frame = 0; frame < FRAMES; frame++, now += FRAME_MS)
+     {
+          int before = 0, after = 0;
+          for (int i = 0; i < PADS; i++)
+          {
+               before += counters[i].reports;
+          }
+          for (int i = 0; i < PADS; i++)
+          {
+               Uint16 low, high, trigger;
+               feedbackAt(i, frame, noise, low, high, trigger);
+               forceFeedbackRumble(feedback, devices[i], low, high);
+               forceFeedbackRumbleTriggers(feedback, devices[i], trigger, trigger);
+          }
+          forceFeedbackFlush(feedback, now);
+          for (int i = 0; i < PADS; i++)
+          {
+               after += counters[i].reports;
+          }
+          peak = SDL_max(peak, after - before);
+     }
+     report("forceFeedbackFlush", counters, feedback.stats.requests, peak);
+     std::printf("\n  %d calls into SDL, %d device flushes deferred\n", feedback.stats.writes, feedback.stats.deferred);
+
+     forceFeedbackDestroy(feedback);
+     for (size_t i = 0; i < joysticks.size(); i++)
+     {
+          SDL_JoystickClose(joysticks[i]);
+     }
+     SDL_Quit();
+     return 0;
+}
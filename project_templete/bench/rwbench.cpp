@@ -0,0 +1,203 @@
+// Description:
+// File stream benchmark, the throughput half testfile.c leaves out:
+// SDL_RWFromFile against bufferedRWFromFile and mappedRWFromFile on a
+// 16 MB temporary file,
+// for sequential reads of 4, 16, 64 and 4096 bytes, a chunk walk that
+// reads an 8-byte header and seeks past each chunk body like PNG and RIFF
+// parsers do, and 16-byte writes (not for the read-only mapping), plus
+// the cost of opening and closing the file. Every read is checked against the data
+// written, so a buffering bug fails the run instead of looking fast.
+//
+// Build and run from project_templete/:
+//     make rwbench && ./rwbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "buffered_rw.h"
+#include "mapped_file.h"
+
+namespace
+{
+     const char *const PATH = "rwbench.tmp";
+     const size_t FILE_BYTES = 16 * 1024 * 1024;
+     const size_t READ_SIZES[] = {4, 16, 64, 4096};
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     enum StreamKind
+     {
+          STREAM_SDL,
+          STREAM_BUFFERED,
+          STREAM_MAPPED
+     };
+
+     SDL_RWops *openFile(StreamKind kind, const char *mode)
+     {
+          switch (kind)
+          {
+          case STREAM_BUFFERED:
+               return bufferedRWFromFile(PATH, mode);
+          case STREAM_MAPPED:
+               return mappedRWFromFile(PATH);
+          default:
+               return SDL_RWFromFile(PATH, mode);
+          }
+     }
+
+     // MB/s reading the whole file `size` bytes at a time; -1 on a mismatch
+     double sequentialRead(StreamKind kind, size_t size, const std::vector<Uint8> &data)
+     {
+          SDL_RWops *rw = openFile(kind, "rb");
+          if (rw == nullptr)
+          {
+               return -1.0;
+          }
+          std::vector<Uint8> chunk(size);
+          size_t offset = 0;
+          bool ok = true;
+          const Uint64 start = SDL_GetPerformanceCounter();
+          while (SDL_RWread(rw, chunk.data(), 1, size) == size)
+          {
+               ok = ok && std::memcmp(chunk.data(), &data[offset], size) == 0;
+               offset += size;
+          }
+          const double seconds = secondsSince(start);
+          SDL_RWclose(rw);
+          return ok && offset == FILE_BYTES ? FILE_BYTES / seconds / 1e6 : -1.0;
+     }
+
+     // Chunks per second: read a header, seek over the body, as a parser
+     // looking for one chunk type does
+     double chunkWalk(StreamKind kind, const std::vector<Uint8> &data)
+     {
+          SDL_RWops *rw = openFile(kind, "rb");
+          if (rw == nullptr)
+          {
+               return -1.0;
+          }
+          Uint8 header[8];
+          size_t offset = 0, chunks = 0;
+          bool ok = true;
+          const Uint64 start = SDL_GetPerformanceCounter();
+          while (SDL_RWread(rw, header, sizeof(header), 1) == 1)
+          {
+               ok = ok && std::memcmp(header, &data[offset], sizeof(header)) == 0;
+               const size_t body = header[0] % 200; // Bodies of 0 to 199 bytes
+               offset += sizeof(header) + body;
+               if (offset + sizeof(header) > FILE_BYTES || SDL_RWseek(rw, (Sint64)body, RW_SEEK_CUR) != (Sint64)offset)
+               {
+                    break;
+               }
+               chunks++;
+          }
+          const double seconds = secondsSince(start);
+          SDL_RWclose(rw);
+          return ok ? chunks / seconds : -1.0;
+     }
+
+     // MB/s writing the file 16 bytes at a time, checked by reading it back
+     double smallWrites(StreamKind kind, const std::vector<Uint8> &data)
+     {
+          SDL_RWops *rw = openFile(kind, "wb");
+          if (rw == nullptr)
+          {
+               return -1.0;
+          }
+          const Uint64 start = SDL_GetPerformanceCounter();
+          for (size_t offset = 0; offset < FILE_BYTES; offset += 16)
+          {
+               SDL_RWwrite(rw, &data[offset], 1, 16);
+          }
+          const bool closed = SDL_RWclose(rw) == 0;
+          const double seconds = secondsSince(start);
+          return closed && sequentialRead(STREAM_SDL, 4096, data) > 0.0 ? FILE_BYTES / seconds / 1e6 : -1.0;
+     }
+
+     // Opens and closes per second
+     double openClose(StreamKind kind)
+     {
+          const int count = 2000;
+          const Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < count; i++)
+          {
+               SDL_RWops *rw = openFile(kind, "rb");
+               if (rw == nullptr)
+               {
+                    return -1.0;
+               }
+               Uint8 magic[4];
+               SDL_RWread(rw, magic, 1, sizeof(magic));
+               SDL_RWclose(rw);
+          }
+          return count / secondsSince(start);
+     }
+
+     // Without `hasMapped` the mapped column shows a dash
+     void printRow(const char *name, const char *unit, double plain, double buffered, double mapped, bool hasMapped,
+                   int &failures)
+     {
+          if (plain < 0.0 || buffered < 0.0 || (hasMapped && mapped < 0.0))
+          {
+               std::printf("%-20s wrong data\n", name);
+               failures++;
+               return;
+          }
+          char mappedText[16] = "-";
+          if (hasMapped)
+          {
+               SDL_snprintf(mappedText, sizeof(mappedText), "%.1f", mapped);
+          }
+          std::printf("%-20s %12.1f %12.1f %12s  %s\n", name, plain, buffered, mappedText, unit);
+     }
+}
+
+int main(int, char *[])
+{
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     std::vector<Uint8> data(FILE_BYTES);
+     Uint32 seed = 7;
+     for (Uint8 &byte : data)
+     {
+          seed = seed * 1103515245u + 12345u;
+          byte = (Uint8)(seed >> 16);
+     }
+     SDL_RWops *out = SDL_RWFromFile(PATH, "wb");
+     if (out == nullptr || SDL_RWwrite(out, data.data(), 1, data.size()) != data.size() || SDL_RWclose(out) != 0)
+     {
+          std::fprintf(stderr, "Unable to write %s! SDL Error: %s\n", PATH, SDL_GetError());
+          return 1;
+     }
+
+     int failures = 0;
+     std::printf("%-20s %12s %12s %12s\n", "pattern", "SDL_RWops", "buffered", "mapped");
+     for (const size_t size : READ_SIZES)
+     {
+          char name[32];
+          SDL_snprintf(name, sizeof(name), "read %zu B", size);
+          // Once untimed so both start from a warm page cache
+          sequentialRead(STREAM_SDL, 4096, data);
+          printRow(name, "MB/s", sequentialRead(STREAM_SDL, size, data), sequentialRead(STREAM_BUFFERED, size, data),
+                   sequentialRead(STREAM_MAPPED, size, data), true, failures);
+     }
+     printRow("chunk walk", "chunks/s", chunkWalk(STREAM_SDL, data), chunkWalk(STREAM_BUFFERED, data),
+              chunkWalk(STREAM_MAPPED, data), true, failures);
+     printRow("open+close", "per s", openClose(STREAM_SDL), openClose(STREAM_BUFFERED), openClose(STREAM_MAPPED), true,
+              failures);
+     printRow("write 16 B", "MB/s", smallWrites(STREAM_SDL, data), smallWrites(STREAM_BUFFERED, data), -1.0, false,
+              failures);
+
+     std::remove(PATH);
+     SDL_Quit();
+     return failures == 0 ? 0 : 2;
+}
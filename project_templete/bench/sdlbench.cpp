@@ -0,0 +1,800 @@
+// Description:
+// The performance dashboard: one perf_harness run over every area the
+// separate benchmarks cover, against one stored baseline. It times the
+// paths the game ships, the kernels this CPU picks by default, only. The
+// per-kernel tables, validation and thread sweeps stay in the individual
+// benches:
+//
+// - sprites: the render queue flushing 100, 1000 and 10000 sprites into
+//   the software renderer (testsprite2's count sweep), and sweepRects()
+//   over 4096 blocks (sweepbench);
+// - blit: blit_kernels rows and blitSurfaceFast() at 1080p (blitbench);
+// - yuv: NV12 and YUY2 both ways at 1080p (yuvbench);
+// - audio: 64 voices mixed into one 2048-frame buffer, 44.1 -> 48 kHz
+//   resampling and s16 -> f32 conversion (mixbench, resamplebench);
+// - rwops: 16-byte reads through SDL_RWFromFile and bufferedRWFromFile
+//   (rwbench);
+// - threads and contention: atomic_ops and fast_lock next to SDL's, alone
+//   and with a worker per remaining core on the same lock (atomicbench,
+//   lockbench);
+// - sort: SDL_qsort and radix_sort on 100k random keys (sortbench);
+// - glyphs: a HUD line through the glyph cache, warm and after a clear,
+//   with sans.ttf (skipped when it is missing).
+//
+//     ./sdlbench.exe --save-baseline sdlbench_baseline.txt            (reference run)
+//     ./sdlbench.exe --baseline sdlbench_baseline.txt --json sdlbench.json
+//
+// The JSON report carries the machine's SDL version, CPU features, cores
+// and caches with every case's median, confidence interval, baseline and
+// verdict. The exit status is the number of regressions, as perfsuite's.
+//
+// Build and run from project_templete/:
+//     make sdlbench && ./sdlbench.exe --quick
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <SDL2/SDL_ttf.h>
+#include <cstdio>
+#include <vector>
+
+#include "perf_harness.h"
+
+#include "atomic_ops.h"
+#include "audio_resample.h"
+#include "blit_kernels.h"
+#include "buffered_rw.h"
+#include "cpu_topology.h"
+#include "fast_lock.h"
+#include "glyph_cache.h"
+#include "radix_sort.h"
+#include "render_queue.h"
+#include "swept_collision.h"
+#include "voice_mixer.h"
+#include "yuv_convert.h"
+
+namespace
+{
+     const int FRAME_W = 1920;
+     const int FRAME_H = 1080;
+     const Uint64 FRAME_PIXELS = (Uint64)FRAME_W * FRAME_H;
+     const int SCREEN_W = 1280;
+     const int SCREEN_H = 720;
+     const int MAX_SPRITES = 10000;
+     const int SWEEP_BLOCKS = 4096;
+     const int MIX_VOICES = 64;
+     const int MIX_FRAMES = 2048;
+     const int RESAMPLE_FRAMES = 1024;
+     const int SORT_KEYS = 100000;
+     const int RW_BYTES = 1 << 20;
+     const char *const RW_PATH = "sdlbench.tmp";
+     const char *const FONT_PATH = "sans.ttf";
+
+     // sprites: the game's render path on a surface, no window needed
+     struct Sprites
+     {
+          SDL_Surface *target;
+          SDL_Renderer *renderer;
+          SDL_Texture *texture;
+          RenderQueue queue;
+          std::vector<SDL_FRect> rects;
+
+          std::vector<float> x0, y0, x1, y1; // sweepRects() input
+          std::vector<int> hits;
+     };
+
+     void *spritesSetUp()
+     {
+          Sprites *sprites = new Sprites;
+          sprites->target = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_W, SCREEN_H, 32, SDL_PIXELFORMAT_ARGB8888);
+          sprites->renderer = sprites->target != nullptr ? SDL_CreateSoftwareRenderer(sprites->target) : nullptr;
+          SDL_Surface *image = SDL_CreateRGBSurfaceWithFormat(0, 32, 32, 32, SDL_PIXELFORMAT_ARGB8888);
+          sprites->texture = sprites->renderer != nullptr && image != nullptr
+                                  ? SDL_CreateTextureFromSurface(sprites->renderer, image)
+                                  : nullptr;
+          if (image != nullptr)
+          {
+               Uint32 *pixels = (Uint32 *)image->pixels;
+               for (int i = 0; i < 32 * 32; i++)
+               {
+                    pixels[i] = perfRandom() | 0x80000000u;
+               }
+               SDL_UpdateTexture(sprites->texture, nullptr, image->pixels, image->pitch);
+               SDL_FreeSurface(image);
+          }
+          if (sprites->texture == nullptr)
+          {
+               SDL_DestroyRenderer(sprites->renderer);
+               SDL_FreeSurface(sprites->target);
+               delete sprites;
+               return nullptr;
+          }
+          SDL_SetTextureBlendMode(sprites->texture, SDL_BLENDMODE_BLEND);
+          renderQueueInit(sprites->queue, RENDER_BATCH_GEOMETRY, MAX_SPRITES);
+          for (int i = 0; i < MAX_SPRITES; i++)
+          {
+               sprites->rects.push_back({(float)(perfRandom() % (SCREEN_W - 32)), (float)(perfRandom() % (SCREEN_H - 32)),
+                                         32.0f, 32.0f});
+          }
+          for (int i = 0; i < SWEEP_BLOCKS; i++)
+          {
+               const float x = (float)(perfRandom() % SCREEN_W);
+               const float y = (float)(perfRandom() % SCREEN_H);
+               sprites->x0.push_back(x);
+               sprites->y0.push_back(y);
+               sprites->x1.push_back(x);
+               sprites->y1.push_back(y + 2.0f + (float)(perfRandom() % 80));
+          }
+          sprites->hits.resize(SWEEP_BLOCKS);
+          return sprites;
+     }
+
+     void spritesTearDown(void *arg)
+     {
+          Sprites *sprites = (Sprites *)arg;
+          SDL_DestroyTexture(sprites->texture);
+          SDL_DestroyRenderer(sprites->renderer);
+          SDL_FreeSurface(sprites->target);
+          delete sprites;
+     }
+
+     void drawSprites(Sprites &sprites, int count, int iterations)
+     {
+          for (int i = 0; i < iterations; i++)
+          {
+               for (int s = 0; s < count; s++)
+               {
+                    renderQueueCopy(sprites.queue, sprites.texture, nullptr, sprites.rects[s]);
+               }
+               renderQueueFlush(sprites.queue, sprites.renderer);
+          }
+     }
+
+     void sprites100(void *arg, int iterations)
+     {
+          drawSprites(*(Sprites *)arg, 100, iterations);
+     }
+
+     void sprites1000(void *arg, int iterations)
+     {
+          drawSprites(*(Sprites *)arg, 1000, iterations);
+     }
+
+     void sprites10000(void *arg, int iterations)
+     {
+          drawSprites(*(Sprites *)arg, 10000, iterations);
+     }
+
+     void sweepBlocks(void *arg, int iterations)
+     {
+          Sprites &sprites = *(Sprites *)arg;
+          const SDL_FRect from = {100.0f, SCREEN_H - 30.0f, 100.0f, 20.0f};
+          const SDL_FRect to = {700.0f, SCREEN_H - 30.0f, 100.0f, 20.0f};
+          for (int i = 0; i < iterations; i++)
+          {
+               const int hits = sweepRects(sprites.x0.data(), sprites.y0.data(), sprites.x1.data(), sprites.y1.data(),
+                                           nullptr, SWEEP_BLOCKS, 32.0f, 32.0f, from, to, sprites.hits.data());
+               perfKeep(&hits);
+          }
+     }
+
+     // blit and yuv share 1080p frames
+     struct Frames
+     {
+          SDL_Surface *src;
+          SDL_Surface *dst;
+          std::vector<Uint16> rgb565;
+          std::vector<Uint8> rgb24;
+          std::vector<Uint8> nv12;
+          std::vector<Uint8> yuy2;
+     };
+
+     void *framesSetUp()
+     {
+          Frames *frames = new Frames;
+          frames->src = SDL_CreateRGBSurfaceWithFormat(0, FRAME_W, FRAME_H, 32, SDL_PIXELFORMAT_ARGB8888);
+          frames->dst = SDL_CreateRGBSurfaceWithFormat(0, FRAME_W, FRAME_H, 32, SDL_PIXELFORMAT_ARGB8888);
+          if (frames->src == nullptr || frames->dst == nullptr)
+          {
+               SDL_FreeSurface(frames->src);
+               SDL_FreeSurface(frames->dst);
+               delete frames;
+               return nullptr;
+          }
+          Uint32 *pixels = (Uint32 *)frames->src->pixels;
+          for (Uint64 i = 0; i < FRAME_PIXELS; i++)
+          {
+               pixels[i] = perfRandom();
+          }
+          frames->rgb565.resize(FRAME_PIXELS);
+          frames->rgb24.resize(FRAME_PIXELS * 3);
+          for (Uint8 &byte : frames->rgb24)
+          {
+               byte = (Uint8)perfRandom();
+          }
+          frames->nv12.resize(yuvImageSize(SDL_PIXELFORMAT_NV12, FRAME_W, FRAME_H));
+          frames->yuy2.resize(yuvImageSize(SDL_PIXELFORMAT_YUY2, FRAME_W, FRAME_H));
+          yuvFromRgb(YUV_KERNEL_AUTO, SDL_PIXELFORMAT_NV12, frames->rgb24.data(), FRAME_W * 3, frames->nv12.data(),
+                     FRAME_W, FRAME_H, SDL_YUV_CONVERSION_BT709);
+          yuvFromRgb(YUV_KERNEL_AUTO, SDL_PIXELFORMAT_YUY2, frames->rgb24.data(), FRAME_W * 3, frames->yuy2.data(),
+                     FRAME_W, FRAME_H, SDL_YUV_CONVERSION_BT709);
+          return frames;
+     }
+
+     void framesTearDown(void *arg)
+     {
+          Frames *frames = (Frames *)arg;
+          SDL_FreeSurface(frames->src);
+          SDL_FreeSurface(frames->dst);
+          delete frames;
+     }
+
+     // Row kernels run per row, the way blitSurfaceFast() calls them
+     void blitSwapRedBlue(void *arg, int iterations)
+     {
+          Frames &frames = *(Frames *)arg;
+          const BlitKernelTable &kernels = blitKernels();
+          for (int i = 0; i < iterations; i++)
+          {
+               for (int y = 0; y < FRAME_H; y++)
+               {
+                    kernels.swapRedBlue((const Uint32 *)frames.src->pixels + (size_t)y * FRAME_W,
+                                        (Uint32 *)frames.dst->pixels + (size_t)y * FRAME_W, FRAME_W);
+               }
+          }
+     }
+
+     void blitTo565(void *arg, int iterations)
+     {
+          Frames &frames = *(Frames *)arg;
+          const BlitKernelTable &kernels = blitKernels();
+          for (int i = 0; i < iterations; i++)
+          {
+               for (int y = 0; y < FRAME_H; y++)
+               {
+                    kernels.to565((const Uint32 *)frames.src->pixels + (size_t)y * FRAME_W,
+                                  frames.rgb565.data() + (size_t)y * FRAME_W, FRAME_W, 16);
+               }
+          }
+     }
+
+     void blitBlend(void *arg, int iterations)
+     {
+          Frames &frames = *(Frames *)arg;
+          const BlitKernelTable &kernels = blitKernels();
+          for (int i = 0; i < iterations; i++)
+          {
+               for (int y = 0; y < FRAME_H; y++)
+               {
+                    kernels.blend((const Uint32 *)frames.src->pixels + (size_t)y * FRAME_W,
+                                  (Uint32 *)frames.dst->pixels + (size_t)y * FRAME_W, FRAME_W);
+               }
+          }
+     }
+
+     void blitSurface(void *arg, int iterations)
+     {
+          Frames &frames = *(Frames *)arg;
+          SDL_SetSurfaceBlendMode(frames.src, SDL_BLENDMODE_NONE);
+          for (int i = 0; i < iterations; i++)
+          {
+               blitSurfaceFast(frames.src, nullptr, frames.dst, nullptr);
+          }
+     }
+
+     void blitFill(void *arg, int iterations)
+     {
+          Frames &frames = *(Frames *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               blitFillRect(frames.dst, nullptr, (Uint32)i);
+          }
+     }
+
+     void yuvToNv12(void *arg, int iterations)
+     {
+          Frames &frames = *(Frames *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               yuvFromRgb(YUV_KERNEL_AUTO, SDL_PIXELFORMAT_NV12, frames.rgb24.data(), FRAME_W * 3, frames.nv12.data(),
+                          FRAME_W, FRAME_H, SDL_YUV_CONVERSION_BT709);
+          }
+     }
+
+     void yuvFromNv12(void *arg, int iterations)
+     {
+          Frames &frames = *(Frames *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               yuvToRgb(YUV_KERNEL_AUTO, SDL_PIXELFORMAT_NV12, frames.nv12.data(), FRAME_W, FRAME_H,
+                        frames.rgb24.data(), FRAME_W * 3, SDL_YUV_CONVERSION_BT709);
+          }
+     }
+
+     void yuvToYuy2(void *arg, int iterations)
+     {
+          Frames &frames = *(Frames *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               yuvFromRgb(YUV_KERNEL_AUTO, SDL_PIXELFORMAT_YUY2, frames.rgb24.data(), FRAME_W * 3, frames.yuy2.data(),
+                          FRAME_W, FRAME_H, SDL_YUV_CONVERSION_BT709);
+          }
+     }
+
+     void yuvFromYuy2(void *arg, int iterations)
+     {
+          Frames &frames = *(Frames *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               yuvToRgb(YUV_KERNEL_AUTO, SDL_PIXELFORMAT_YUY2, frames.yuy2.data(), FRAME_W, FRAME_H,
+                        frames.rgb24.data(), FRAME_W * 3, SDL_YUV_CONVERSION_BT709);
+          }
+     }
+
+     // audio: looping noise voices, as mixbench plays them
+     struct Audio
+     {
+          std::vector<Sint16> noise;
+          Mix_Chunk chunk;
+          VoiceMixer mixer;
+          std::vector<Sint16> out;
+          AudioResampler resampler;
+          std::vector<float> in, resampled;
+     };
+
+     void *audioSetUp()
+     {
+          Audio *audio = new Audio;
+          audio->noise.resize((44100 + 37) * 2);
+          for (Sint16 &sample : audio->noise)
+          {
+               sample = (Sint16)perfRandom();
+          }
+          audio->chunk.allocated = 0;
+          audio->chunk.abuf = (Uint8 *)audio->noise.data();
+          audio->chunk.alen = (Uint32)(audio->noise.size() * sizeof(Sint16));
+          audio->chunk.volume = MIX_MAX_VOLUME;
+          voiceMixerInit(audio->mixer, MIX_VOICES);
+          for (int i = 0; i < MIX_VOICES; i++)
+          {
+               const int voice = voiceMixerPlay(audio->mixer, &audio->chunk, -1, (Uint8)(255 - i * 4), (Uint8)(i * 4));
+               voiceMixerVolume(audio->mixer, voice, 8);
+          }
+          audio->out.resize(MIX_FRAMES * 2);
+          if (!audioResamplerInit(audio->resampler, 2, 44100, 48000))
+          {
+               delete audio;
+               return nullptr;
+          }
+          audio->in.resize(RESAMPLE_FRAMES * 2);
+          audioConvertS16ToF32(audio->noise.data(), audio->in.data(), (int)audio->in.size());
+          audio->resampled.resize((size_t)audioResamplerMaxOutput(audio->resampler, RESAMPLE_FRAMES) * 2);
+          return audio;
+     }
+
+     void audioTearDown(void *arg)
+     {
+          delete (Audio *)arg;
+     }
+
+     void audioMix(void *arg, int iterations)
+     {
+          Audio &audio = *(Audio *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               voiceMixerRender(audio.mixer, audio.out.data(), MIX_FRAMES);
+          }
+     }
+
+     void audioResample(void *arg, int iterations)
+     {
+          Audio &audio = *(Audio *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               const int frames = audioResamplerProcess(audio.resampler, audio.in.data(), RESAMPLE_FRAMES,
+                                                        audio.resampled.data(), (int)audio.resampled.size() / 2);
+               perfKeep(&frames);
+          }
+     }
+
+     void audioToFloat(void *arg, int iterations)
+     {
+          Audio &audio = *(Audio *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               audioConvertS16ToF32(audio.noise.data(), audio.in.data(), (int)audio.in.size());
+          }
+          perfKeep(audio.in.data());
+     }
+
+     // rwops: one temporary file, read through in 16-byte steps
+     void *rwopsSetUp()
+     {
+          SDL_RWops *out = SDL_RWFromFile(RW_PATH, "wb");
+          if (out == nullptr)
+          {
+               return nullptr;
+          }
+          std::vector<Uint8> data(RW_BYTES);
+          for (Uint8 &byte : data)
+          {
+               byte = (Uint8)perfRandom();
+          }
+          const bool written = SDL_RWwrite(out, data.data(), 1, data.size()) == data.size();
+          if (SDL_RWclose(out) != 0 || !written)
+          {
+               std::remove(RW_PATH);
+               return nullptr;
+          }
+          return (void *)RW_PATH;
+     }
+
+     void rwopsTearDown(void *)
+     {
+          std::remove(RW_PATH);
+     }
+
+     void readThrough(SDL_RWops *file)
+     {
+          if (file == nullptr)
+          {
+               return;
+          }
+          Uint8 chunk[16];
+          Uint32 sum = 0;
+          while (SDL_RWread(file, chunk, 1, sizeof(chunk)) == sizeof(chunk))
+          {
+               sum += chunk[0];
+          }
+          perfKeep(&sum);
+          SDL_RWclose(file);
+     }
+
+     void rwopsPlainRead(void *arg, int iterations)
+     {
+          for (int i = 0; i < iterations; i++)
+          {
+               readThrough(SDL_RWFromFile((const char *)arg, "rb"));
+          }
+     }
+
+     void rwopsBufferedRead(void *arg, int iterations)
+     {
+          for (int i = 0; i < iterations; i++)
+          {
+               readThrough(bufferedRWFromFile((const char *)arg, "rb"));
+          }
+     }
+
+     // threads: uncontended, one operation per iteration
+     struct Locks
+     {
+          SDL_atomic_t counter;
+          FastMutex fast;
+          SDL_mutex *mutex;
+          int shared;
+
+          // contention only
+          SDL_atomic_t stop;
+          std::vector<SDL_Thread *> workers;
+     };
+
+     void *locksSetUp()
+     {
+          Locks *locks = new Locks;
+          SDL_AtomicSet(&locks->counter, 0);
+          fastMutexInit(locks->fast);
+          locks->mutex = SDL_CreateMutex();
+          locks->shared = 0;
+          SDL_AtomicSet(&locks->stop, 0);
+          if (locks->mutex == nullptr)
+          {
+               delete locks;
+               return nullptr;
+          }
+          return locks;
+     }
+
+     void locksTearDown(void *arg)
+     {
+          Locks *locks = (Locks *)arg;
+          SDL_AtomicSet(&locks->stop, 1);
+          for (SDL_Thread *worker : locks->workers)
+          {
+               SDL_WaitThread(worker, nullptr);
+          }
+          SDL_DestroyMutex(locks->mutex);
+          delete locks;
+     }
+
+     int SDLCALL lockWorker(void *data)
+     {
+          Locks &locks = *(Locks *)data;
+          while (!SDL_AtomicGet(&locks.stop))
+          {
+               fastMutexLock(locks.fast);
+               locks.shared++;
+               fastMutexUnlock(locks.fast);
+          }
+          return 0;
+     }
+
+     // A worker per core past the caller's, all on locks->fast
+     void *contentionSetUp()
+     {
+          Locks *locks = (Locks *)locksSetUp();
+          if (locks == nullptr)
+          {
+               return nullptr;
+          }
+          const int workers = SDL_max(1, cpuTopologyWorkerCount(cpuTopology()));
+          for (int i = 0; i < workers; i++)
+          {
+               SDL_Thread *worker = SDL_CreateThread(lockWorker, "sdlbench", locks);
+               if (worker != nullptr)
+               {
+                    locks->workers.push_back(worker);
+               }
+          }
+          return locks;
+     }
+
+     void atomicAdd(void *arg, int iterations)
+     {
+          Locks &locks = *(Locks *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               atomicFetchAdd(&locks.counter, 1, ATOMIC_ORDER_RELAXED);
+          }
+     }
+
+     void sdlAtomicAdd(void *arg, int iterations)
+     {
+          Locks &locks = *(Locks *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_AtomicAdd(&locks.counter, 1);
+          }
+     }
+
+     void fastMutexSection(void *arg, int iterations)
+     {
+          Locks &locks = *(Locks *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               fastMutexLock(locks.fast);
+               locks.shared++;
+               fastMutexUnlock(locks.fast);
+          }
+     }
+
+     void sdlMutexSection(void *arg, int iterations)
+     {
+          Locks &locks = *(Locks *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               SDL_LockMutex(locks.mutex);
+               locks.shared++;
+               SDL_UnlockMutex(locks.mutex);
+          }
+     }
+
+     // sort: every iteration sorts a fresh copy of the same keys
+     struct Keys
+     {
+          std::vector<Uint32> input, keys, scratch;
+     };
+
+     void *keysSetUp()
+     {
+          Keys *keys = new Keys;
+          keys->input.resize(SORT_KEYS);
+          for (Uint32 &key : keys->input)
+          {
+               key = perfRandom();
+          }
+          keys->keys.resize(SORT_KEYS);
+          keys->scratch.resize(SORT_KEYS);
+          return keys;
+     }
+
+     void keysTearDown(void *arg)
+     {
+          delete (Keys *)arg;
+     }
+
+     int SDLCALL compareKeys(const void *a, const void *b)
+     {
+          const Uint32 x = *(const Uint32 *)a, y = *(const Uint32 *)b;
+          return x < y ? -1 : x > y ? 1 : 0;
+     }
+
+     void sortQsort(void *arg, int iterations)
+     {
+          Keys &keys = *(Keys *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               keys.keys = keys.input;
+               SDL_qsort(keys.keys.data(), keys.keys.size(), sizeof(Uint32), compareKeys);
+          }
+          perfKeep(keys.keys.data());
+     }
+
+     void sortRadix(void *arg, int iterations)
+     {
+          Keys &keys = *(Keys *)arg;
+          for (int i = 0; i < iterations; i++)
+          {
+               keys.keys = keys.input;
+               radixSortU32(keys.keys.data(), keys.keys.size(), keys.scratch.data());
+          }
+          perfKeep(keys.keys.data());
+     }
+
+     // glyphs: the HUD's line through the cache the game draws text with
+     struct Glyphs
+     {
+          SDL_Surface *target;
+          SDL_Renderer *renderer;
+          TTF_Font *font;
+          GlyphCache cache;
+          int fontId;
+          RenderQueue queue;
+     };
+
+     const char *const HUD_TEXT = "Caught: 1234   Missed: 2/5   FPS 144.0   frame 6.94 ms";
+
+     void *glyphsSetUp()
+     {
+          Glyphs *glyphs = new Glyphs;
+          glyphs->target = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_W, SCREEN_H, 32, SDL_PIXELFORMAT_ARGB8888);
+          glyphs->renderer = glyphs->target != nullptr ? SDL_CreateSoftwareRenderer(glyphs->target) : nullptr;
+          glyphs->font = TTF_OpenFont(FONT_PATH, 20);
+          if (glyphs->renderer == nullptr || glyphs->font == nullptr)
+          {
+               TTF_CloseFont(glyphs->font);
+               SDL_DestroyRenderer(glyphs->renderer);
+               SDL_FreeSurface(glyphs->target);
+               delete glyphs;
+               return nullptr;
+          }
+          glyphCacheInit(glyphs->cache, glyphs->renderer, 512, 4);
+          glyphs->fontId = glyphCacheAddFont(glyphs->cache, glyphs->font);
+          renderQueueInit(glyphs->queue, RENDER_BATCH_GEOMETRY, 256);
+          return glyphs;
+     }
+
+     void glyphsTearDown(void *arg)
+     {
+          Glyphs *glyphs = (Glyphs *)arg;
+          glyphCacheDestroy(glyphs->cache);
+          TTF_CloseFont(glyphs->font);
+          SDL_DestroyRenderer(glyphs->renderer);
+          SDL_FreeSurface(glyphs->target);
+          delete glyphs;
+     }
+
+     void glyphsWarm(void *arg, int iterations)
+     {
+          Glyphs &glyphs = *(Glyphs *)arg;
+          const SDL_Color white = {255, 255, 255, 255};
+          for (int i = 0; i < iterations; i++)
+          {
+               glyphCacheDrawText(glyphs.cache, glyphs.queue, glyphs.fontId, HUD_TEXT, 8.0f, 8.0f, white);
+               renderQueueClear(glyphs.queue);
+          }
+     }
+
+     void glyphsCold(void *arg, int iterations)
+     {
+          Glyphs &glyphs = *(Glyphs *)arg;
+          const SDL_Color white = {255, 255, 255, 255};
+          for (int i = 0; i < iterations; i++)
+          {
+               glyphCacheClear(glyphs.cache);
+               glyphCacheDrawText(glyphs.cache, glyphs.queue, glyphs.fontId, HUD_TEXT, 8.0f, 8.0f, white);
+               renderQueueClear(glyphs.queue);
+          }
+     }
+
+     const PerfCaseReference sprites100Case = {sprites100, "queue_100", "100 sprites, render queue, software", 0, true};
+     const PerfCaseReference sprites1000Case = {sprites1000, "queue_1000", "1000 sprites, render queue, software", 0, true};
+     const PerfCaseReference sprites10000Case = {sprites10000, "queue_10000", "10000 sprites, render queue, software",
+                                                 0, true};
+     const PerfCaseReference sweepCase = {sweepBlocks, "sweep_4096", "sweepRects, 4096 falling blocks", 0, true};
+     const PerfCaseReference *spritesCases[] = {&sprites100Case, &sprites1000Case, &sprites10000Case, &sweepCase,
+                                                nullptr};
+
+     const PerfCaseReference swapCase = {blitSwapRedBlue, "swap_red_blue", "blit_kernels rows, 1080p", FRAME_PIXELS * 8,
+                                         true};
+     const PerfCaseReference to565Case = {blitTo565, "to_565", "blit_kernels rows, 1080p", FRAME_PIXELS * 6, true};
+     const PerfCaseReference blendCase = {blitBlend, "blend", "blit_kernels rows, 1080p", FRAME_PIXELS * 8, true};
+     const PerfCaseReference surfaceCase = {blitSurface, "surface_copy", "blitSurfaceFast, 1080p", FRAME_PIXELS * 8,
+                                            true};
+     const PerfCaseReference fillCase = {blitFill, "fill", "blitFillRect, 1080p", FRAME_PIXELS * 4, true};
+     const PerfCaseReference *blitCases[] = {&swapCase, &to565Case, &blendCase, &surfaceCase, &fillCase, nullptr};
+
+     const PerfCaseReference toNv12Case = {yuvToNv12, "rgb_to_nv12", "yuvFromRgb, 1080p BT.709", FRAME_PIXELS * 3, true};
+     const PerfCaseReference fromNv12Case = {yuvFromNv12, "nv12_to_rgb", "yuvToRgb, 1080p BT.709", FRAME_PIXELS * 3,
+                                             true};
+     const PerfCaseReference toYuy2Case = {yuvToYuy2, "rgb_to_yuy2", "yuvFromRgb, 1080p BT.709", FRAME_PIXELS * 3, true};
+     const PerfCaseReference fromYuy2Case = {yuvFromYuy2, "yuy2_to_rgb", "yuvToRgb, 1080p BT.709", FRAME_PIXELS * 3,
+                                             true};
+     const PerfCaseReference *yuvCases[] = {&toNv12Case, &fromNv12Case, &toYuy2Case, &fromYuy2Case, nullptr};
+
+     const PerfCaseReference mixCase = {audioMix, "mix_64_voices", "voiceMixerRender, 2048 stereo frames", 0, true};
+     const PerfCaseReference resampleCase = {audioResample, "resample_44k_48k", "audioResamplerProcess, 1024 frames",
+                                             RESAMPLE_FRAMES * 2 * sizeof(float), true};
+     const PerfCaseReference toFloatCase = {audioToFloat, "s16_to_f32", "audioConvertS16ToF32, 1024 frames",
+                                            RESAMPLE_FRAMES * 2 * sizeof(Sint16), true};
+     const PerfCaseReference *audioCases[] = {&mixCase, &resampleCase, &toFloatCase, nullptr};
+
+     const PerfCaseReference plainReadCase = {rwopsPlainRead, "plain_read_16", "SDL_RWFromFile, 16-byte reads of 1 MB",
+                                              RW_BYTES, true};
+     const PerfCaseReference bufferedReadCase = {rwopsBufferedRead, "buffered_read_16",
+                                                 "bufferedRWFromFile, 16-byte reads of 1 MB", RW_BYTES, true};
+     const PerfCaseReference *rwopsCases[] = {&plainReadCase, &bufferedReadCase, nullptr};
+
+     const PerfCaseReference atomicCase = {atomicAdd, "atomic_add", "atomicFetchAdd, relaxed", 0, true};
+     const PerfCaseReference sdlAtomicCase = {sdlAtomicAdd, "sdl_atomic_add", "SDL_AtomicAdd", 0, true};
+     const PerfCaseReference fastMutexCase = {fastMutexSection, "fast_mutex", "FastMutex section, uncontended", 0, true};
+     const PerfCaseReference sdlMutexCase = {sdlMutexSection, "sdl_mutex", "SDL_mutex section, uncontended", 0, true};
+     const PerfCaseReference *threadsCases[] = {&atomicCase, &sdlAtomicCase, &fastMutexCase, &sdlMutexCase, nullptr};
+
+     const PerfCaseReference contendedCase = {fastMutexSection, "fast_mutex", "FastMutex section, a worker per core",
+                                              0, true};
+     const PerfCaseReference *contentionCases[] = {&contendedCase, nullptr};
+
+     const PerfCaseReference qsortCase = {sortQsort, "qsort_100k", "SDL_qsort, 100k random u32", SORT_KEYS * 4, true};
+     const PerfCaseReference radixCase = {sortRadix, "radix_100k", "radixSortU32, 100k random u32", SORT_KEYS * 4, true};
+     const PerfCaseReference *sortCases[] = {&qsortCase, &radixCase, nullptr};
+
+     // Enabled in main() when the font opens
+     PerfCaseReference glyphsWarmCase = {glyphsWarm, "hud_warm", "glyphCacheDrawText, cached", 0, false};
+     PerfCaseReference glyphsColdCase = {glyphsCold, "hud_cold", "glyphCacheDrawText after glyphCacheClear", 0, false};
+     const PerfCaseReference *glyphsCases[] = {&glyphsWarmCase, &glyphsColdCase, nullptr};
+
+     const PerfSuiteReference spritesSuite = {"sprites", spritesSetUp, spritesCases, spritesTearDown};
+     const PerfSuiteReference blitSuite = {"blit", framesSetUp, blitCases, framesTearDown};
+     const PerfSuiteReference yuvSuite = {"yuv", framesSetUp, yuvCases, framesTearDown};
+     const PerfSuiteReference audioSuite = {"audio", audioSetUp, audioCases, audioTearDown};
+     const PerfSuiteReference rwopsSuite = {"rwops", rwopsSetUp, rwopsCases, rwopsTearDown};
+     const PerfSuiteReference threadsSuite = {"threads", locksSetUp, threadsCases, locksTearDown};
+     const PerfSuiteReference contentionSuite = {"contention", contentionSetUp, contentionCases, locksTearDown};
+     const PerfSuiteReference sortSuite = {"sort", keysSetUp, sortCases, keysTearDown};
+     const PerfSuiteReference glyphsSuite = {"glyphs", glyphsSetUp, glyphsCases, glyphsTearDown};
+
+     const PerfSuiteReference *suites[] = {&spritesSuite, &blitSuite,       &yuvSuite,  &audioSuite,  &rwopsSuite,
+                                           &threadsSuite, &contentionSuite, &sortSuite, &glyphsSuite, nullptr};
+}
+
+int main(int argc, char *argv[])
+{
+     PerfOptions options = perfDefaultOptions();
+     if (!perfParseArguments(options, argc, argv))
+     {
+          return 2;
+     }
+     if (SDL_Init(SDL_INIT_TIMER) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 2;
+     }
+     if (TTF_Init() == 0)
+     {
+          TTF_Font *font = TTF_OpenFont(FONT_PATH, 20);
+          glyphsWarmCase.enabled = glyphsColdCase.enabled = font != nullptr;
+          TTF_CloseFont(font);
+     }
+     if (!glyphsWarmCase.enabled)
+     {
+          std::printf("no %s, skipping glyphs\n", FONT_PATH);
+     }
+     const int regressions = perfRunSuites(suites, options);
+     if (TTF_WasInit())
+     {
+          TTF_Quit();
+     }
+     SDL_Quit();
+     return SDL_min(regressions, 100);
+}
@@ -0,0 +1,105 @@
+// Description:
+// Spatial audio microbenchmark. Runs ten seconds of 48 kHz noise through
+// one source at a time, once with HRTF convolution and once panned, with
+// every kernel this CPU supports, plus a source that changes direction
+// every block so the crossfade path is timed too. "sources/core" is how
+// many such sources one core could render in real time; the HRTF column
+// is the figure to size maxHrtfSources against.
+//
+// Build and run from project_templete/:  make spatialbench && ./spatialbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "spatial_audio.h"
+
+namespace
+{
+     const int RATE = 48000;
+     const int SECONDS = 10;
+     const int CALLBACK_FRAMES = 512;
+
+     enum BenchMode
+     {
+          BENCH_PANNED,
+          BENCH_HRTF,
+          BENCH_HRTF_MOVING
+     };
+
+     // Mixes `pcm` through source 0 callback by callback; returns the seconds taken
+     double runSource(SpatialAudio &engine, const std::vector<Sint16> &pcm, BenchMode mode)
+     {
+          std::vector<Sint16> block(CALLBACK_FRAMES * 2);
+          SpatialSource &source = engine.sources[0];
+          const int directions = engine.hrtf->azimuths * engine.hrtf->elevations;
+          const int frames = (int)pcm.size() / 2;
+          int direction = 0;
+          Uint64 start = SDL_GetPerformanceCounter();
+          for (int offset = 0; offset + CALLBACK_FRAMES <= frames; offset += CALLBACK_FRAMES)
+          {
+               if (mode == BENCH_HRTF_MOVING)
+               {
+                    direction = (direction + 1) % directions;
+               }
+               source.target = SpatialParams{mode != BENCH_PANNED, direction, 0.7f, 0.7f};
+               SDL_memcpy(block.data(), &pcm[offset * 2], block.size() * sizeof(Sint16));
+               spatialAudioProcess(engine, 0, block.data(), CALLBACK_FRAMES);
+          }
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     Uint64 start = SDL_GetPerformanceCounter();
+     HrtfSet hrtf;
+     if (!hrtfSetBuildSpherical(hrtf, RATE))
+     {
+          std::fprintf(stderr, "HRTF build failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     std::printf("spherical HRTF: %d directions, %d partitions, built in %.1f ms\n\n",
+                 hrtf.azimuths * hrtf.elevations, hrtf.partitions,
+                 (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+
+     std::vector<Sint16> pcm(RATE * SECONDS * 2);
+     std::srand(1);
+     for (Sint16 &sample : pcm)
+     {
+          sample = (Sint16)(std::rand() % 16384 - 8192);
+     }
+
+     std::printf("%-8s %-8s %10s %14s\n", "mode", "kernel", "ms", "sources/core");
+     const char *modeNames[] = {"panned", "hrtf", "moving"};
+     const SpatialKernel kernels[] = {SPATIAL_KERNEL_SCALAR, SPATIAL_KERNEL_SSE2, SPATIAL_KERNEL_NEON};
+     for (int mode = BENCH_PANNED; mode <= BENCH_HRTF_MOVING; mode++)
+     {
+          for (SpatialKernel kernel : kernels)
+          {
+               if (!spatialKernelSupported(kernel))
+               {
+                    continue;
+               }
+               SpatialAudio engine;
+               spatialAudioInit(engine, hrtf, 0, 1, 1, kernel);
+               runSource(engine, pcm, (BenchMode)mode); // Warm up
+               const double seconds = runSource(engine, pcm, (BenchMode)mode);
+               std::printf("%-8s %-8s %10.2f %14.0f\n", modeNames[mode], spatialKernelName(kernel), seconds * 1000.0,
+                           SECONDS / seconds);
+          }
+     }
+
+     SDL_Quit();
+     return 0;
+}
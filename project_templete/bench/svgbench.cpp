@@ -0,0 +1,123 @@
+// Description:
+// SVG icon raster benchmark. Rasterizes a document at the sizes a UI asks
+// for (16 to 64 points at 100%, 125%, 150% and 200% display scale) with
+// one IMG_LoadSizedSVG_RW call per size, the way the icons load today,
+// then through an SvgRasterCache (svg_raster.h): cold on the job system,
+// warm from memory, and from the disk cache a fresh cache would start
+// with on the next launch. Reports milliseconds for the whole set.
+//
+// With no argument a built-in icon is used.
+//
+// Build and run from project_templete/:  make svgbench && ./svgbench.exe [icon.svg]
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <cstdio>
+#include <vector>
+
+#include "svg_raster.h"
+
+namespace
+{
+     const char *const ICON =
+         "<svg xmlns='http://www.w3.org/2000/svg' viewBox='0 0 24 24'>"
+         "<circle cx='12' cy='12' r='10' fill='none' stroke='#224' stroke-width='2'/>"
+         "<path d='M12 6v6l4 2' fill='none' stroke='#c33' stroke-width='2' stroke-linecap='round'/>"
+         "<path d='M4 4 L8 8 M20 4 L16 8 M4 20 L8 16 M20 20 L16 16' stroke='#888' stroke-width='1'/>"
+         "<rect x='10' y='18' width='4' height='3' rx='1' fill='#4a4'/>"
+         "</svg>";
+
+     const int POINTS[] = {16, 20, 24, 32, 48, 64};
+     const float SCALES[] = {1.0f, 1.25f, 1.5f, 2.0f};
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     double timeBatch(SvgRasterCache &cache, JobSystem &jobs, std::vector<SvgRasterRequest> requests)
+     {
+          const Uint64 start = SDL_GetPerformanceCounter();
+          svgRasterizeBatch(cache, jobs, requests.data(), (int)requests.size());
+          const double seconds = secondsSince(start);
+          for (const SvgRasterRequest &request : requests)
+          {
+               if (request.surface == nullptr)
+               {
+                    std::fprintf(stderr, "Raster at %d failed: %s\n", request.width, SDL_GetError());
+               }
+          }
+          return seconds;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     SvgDocument document;
+     svgDocumentFromMemory(document, "built-in icon", ICON, SDL_strlen(ICON));
+     if (argc > 1 && !svgDocumentLoad(document, nullptr, argv[1]))
+     {
+          std::fprintf(stderr, "Unable to read %s: %s\n", argv[1], SDL_GetError());
+          return 1;
+     }
+     JobSystem jobs;
+     AssetCache disk;
+     if (!jobSystemInit(jobs, 0))
+     {
+          std::fprintf(stderr, "jobSystemInit failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     // The bench's own cache directory, emptied at exit so every run starts cold
+     assetCacheOpen(disk, "catch", "svgbench", 1);
+
+     std::vector<SvgRasterRequest> requests;
+     for (float scale : SCALES)
+     {
+          for (int points : POINTS)
+          {
+               const int pixels = (int)(points * scale + 0.5f);
+               requests.push_back(SvgRasterRequest{&document, pixels, pixels, nullptr});
+          }
+     }
+
+     Uint64 start = SDL_GetPerformanceCounter();
+     for (const SvgRasterRequest &request : requests)
+     {
+          SDL_RWops *rw = argc > 1 ? SDL_RWFromFile(argv[1], "rb") : SDL_RWFromConstMem(ICON, (int)SDL_strlen(ICON));
+          if (rw != nullptr)
+          {
+               SDL_FreeSurface(IMG_LoadSizedSVG_RW(rw, request.width, request.height));
+               SDL_RWclose(rw);
+          }
+     }
+     const double sdlSeconds = secondsSince(start);
+
+     SvgRasterCache cache, restarted;
+     svgRasterCacheInit(cache, &disk);
+     const double coldSeconds = timeBatch(cache, jobs, requests);
+     const double warmSeconds = timeBatch(cache, jobs, requests);
+     svgRasterCacheInit(restarted, &disk);
+     const double diskSeconds = timeBatch(restarted, jobs, requests);
+
+     std::printf("%s, %d sizes, %d threads, disk cache %s\n\n", document.name.c_str(), (int)requests.size(),
+                 jobSystemThreadCount(jobs), disk.directory.empty() ? "off" : "on");
+     std::printf("%-28s %10.2f ms\n", "IMG_LoadSizedSVG_RW per size", sdlSeconds * 1000);
+     std::printf("%-28s %10.2f ms  %.2fx\n", "cache, cold, parallel", coldSeconds * 1000,
+                 sdlSeconds / SDL_max(1e-9, coldSeconds));
+     std::printf("%-28s %10.2f ms\n", "cache, warm", warmSeconds * 1000);
+     std::printf("%-28s %10.2f ms  %d from disk\n", "cache, next launch", diskSeconds * 1000, restarted.diskHits);
+
+     svgRasterCacheDestroy(restarted);
+     svgRasterCacheDestroy(cache);
+     disk.budgetBytes = 0;
+     assetCacheTrim(disk);
+     jobSystemDestroy(jobs);
+     SDL_Quit();
+     return 0;
+}
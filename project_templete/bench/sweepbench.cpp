@@ -0,0 +1,134 @@
+// Description:
+// Paddle collision benchmark. 4096 blocks fall past a moving paddle at
+// speeds from a few pixels to several paddle heights per tick, and each
+// tick is tested three ways: SDL_HasIntersectionF() on the rects at the end
+// of the tick, the way the game used to, the same with 8 substeps, and
+// one sweepRects() pass (swept_collision.h). Reports nanoseconds per block
+// and how many of the blocks that crossed the paddle each one caught.
+//
+// Build and run from project_templete/:  make sweepbench && ./sweepbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <vector>
+
+#include "swept_collision.h"
+
+namespace
+{
+     const int BLOCKS = 4096;
+     const int TICKS = 2000;
+     const int SUBSTEPS = 8;
+     const float SIZE = 30.0f;
+     const SDL_FRect PADDLE = {300.0f, 400.0f, 100.0f, 20.0f};
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     struct Scene
+     {
+          std::vector<float> x, y0, y1;
+          std::vector<SDL_FRect> from, to; // The paddle over each tick
+     };
+
+     // The same falling blocks and zig-zagging paddle for every method
+     Scene makeScene()
+     {
+          Scene scene;
+          Uint32 seed = 12345;
+          for (int i = 0; i < BLOCKS; i++)
+          {
+               seed = seed * 1664525u + 1013904223u;
+               scene.x.push_back((float)(seed % 700));
+               seed = seed * 1664525u + 1013904223u;
+               const float speed = 2.0f + (float)(seed % 120);
+               seed = seed * 1664525u + 1013904223u;
+               const float y = PADDLE.y - 200.0f + (float)(seed % 400);
+               scene.y0.push_back(y);
+               scene.y1.push_back(y + speed);
+          }
+          for (int t = 0; t < TICKS; t++)
+          {
+               SDL_FRect from = PADDLE, to = PADDLE;
+               from.x = (float)((t * 37) % 600);
+               to.x = from.x + ((t & 1) ? 40.0f : -40.0f);
+               scene.from.push_back(from);
+               scene.to.push_back(to);
+          }
+          return scene;
+     }
+
+     SDL_FRect lerpRect(const SDL_FRect &a, const SDL_FRect &b, float t)
+     {
+          return SDL_FRect{a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, b.w, b.h};
+     }
+
+     // Catches with `substeps` discrete tests spread over the tick
+     long long runDiscrete(const Scene &scene, int substeps)
+     {
+          long long caught = 0;
+          for (int t = 0; t < TICKS; t++)
+          {
+               for (int i = 0; i < BLOCKS; i++)
+               {
+                    for (int s = 1; s <= substeps; s++)
+                    {
+                         const float f = (float)s / substeps;
+                         const SDL_FRect paddle = lerpRect(scene.from[t], scene.to[t], f);
+                         const SDL_FRect block = {scene.x[i], scene.y0[i] + (scene.y1[i] - scene.y0[i]) * f, SIZE, SIZE};
+                         if (SDL_HasIntersectionF(&block, &paddle))
+                         {
+                              caught++;
+                              break;
+                         }
+                    }
+               }
+          }
+          return caught;
+     }
+
+     long long runSwept(const Scene &scene)
+     {
+          std::vector<int> hits(BLOCKS);
+          long long caught = 0;
+          for (int t = 0; t < TICKS; t++)
+          {
+               caught += sweepRects(scene.x.data(), scene.y0.data(), scene.x.data(), scene.y1.data(), nullptr, BLOCKS,
+                                    SIZE, SIZE, scene.from[t], scene.to[t], hits.data());
+          }
+          return caught;
+     }
+
+     void report(const char *name, double seconds, long long caught, long long reference)
+     {
+          std::printf("%-24s %8.2f ns/block  %8lld caught  %5.1f%%\n", name, seconds * 1e9 / ((double)BLOCKS * TICKS),
+                      caught, 100.0 * caught / SDL_max(1LL, reference));
+     }
+}
+
+int main(int, char *[])
+{
+     const Scene scene = makeScene();
+
+     Uint64 start = SDL_GetPerformanceCounter();
+     const long long discrete = runDiscrete(scene, 1);
+     const double discreteSeconds = secondsSince(start);
+
+     start = SDL_GetPerformanceCounter();
+     const long long substepped = runDiscrete(scene, SUBSTEPS);
+     const double substepSeconds = secondsSince(start);
+
+     start = SDL_GetPerformanceCounter();
+     const long long swept = runSwept(scene);
+     const double sweptSeconds = secondsSince(start);
+
+     // The sweep is exact, so it is what the others are measured against
+     std::printf("%d blocks, %d ticks, %.0f px paddle, %.0f px blocks\n\n", BLOCKS, TICKS, PADDLE.h, SIZE);
+     report("end of tick", discreteSeconds, discrete, swept);
+     report("8 substeps", substepSeconds, substepped, swept);
+     report("sweepRects", sweptSeconds, swept, swept);
+     return 0;
+}
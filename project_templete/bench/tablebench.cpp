@@ -0,0 +1,232 @@
+// Description:
+// Level load benchmark for table_file. A level of 10 000, 100 000 and
+// 1 000 000 entities is written twice: as text, one "x y vy kind name"
+// line per entity (the cheapest text a loader could parse, far simpler
+// than JSON), and as a table file. Then each is loaded the way the game
+// would. Text is read, parsed with strtof/strtol and copied into records.
+// The table file is opened in place, with and without TABLE_FILE_VERIFY.
+// The use column walks every record once after the load, so the mapped
+// pages are touched too. Both loads are checked to give the same sum.
+// First, a file holding only strings (no data tables, so its string
+// table starts at data offset 0) is written, reopened and read back.
+//
+// Build and run from project_templete/:
+//     make tablebench && ./tablebench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "table_file.h"
+
+namespace
+{
+     const char *const TEXT_PATH = "tablebench.txt";
+     const char *const TABLE_PATH = "tablebench.ctbl";
+     const Uint32 LEVEL_KIND = TABLE_FOURCC('L', 'V', 'L', 'B');
+     const Uint32 LEVEL_SCHEMA = 1;
+     const Uint32 LEVEL_ENTITIES = TABLE_FOURCC('E', 'N', 'T', 'S');
+     const int SIZES[] = {10000, 100000, 1000000};
+
+     struct LevelEntity
+     {
+          float x, y, vy;
+          Uint32 kind;
+          Uint32 name; // Offset into the string table
+     };
+
+     double msSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+     }
+
+     double useAll(const LevelEntity *entities, size_t count)
+     {
+          double sum = 0.0;
+          for (size_t i = 0; i < count; i++)
+          {
+               sum += entities[i].x + entities[i].y * 0.5 + entities[i].vy + entities[i].kind;
+          }
+          return sum;
+     }
+
+     bool writeLevel(int count)
+     {
+          std::string text;
+          TableFileWriter writer;
+          tableFileWriterInit(writer, LEVEL_KIND, LEVEL_SCHEMA);
+          std::vector<LevelEntity> entities((size_t)count);
+          Uint32 random = 1;
+          char line[128], name[32];
+          for (int i = 0; i < count; i++)
+          {
+               random = random * 1664525u + 1013904223u;
+               LevelEntity &entity = entities[(size_t)i];
+               entity.x = (float)(random % 800) + 0.25f;
+               entity.y = (float)(random / 800 % 60000) * 0.5f;
+               entity.vy = 1.0f + (float)(random >> 28);
+               entity.kind = random >> 30;
+               SDL_snprintf(name, sizeof(name), "block%d", i);
+               entity.name = tableFileWriterString(writer, name);
+               SDL_snprintf(line, sizeof(line), "%g %g %g %u %s\n", entity.x, entity.y, entity.vy, entity.kind, name);
+               text += line;
+          }
+          tableFileWriterAdd(writer, LEVEL_ENTITIES, entities.data(), entities.size());
+
+          SDL_RWops *rw = SDL_RWFromFile(TEXT_PATH, "wb");
+          const bool wrote = rw != nullptr && SDL_RWwrite(rw, text.data(), 1, text.size()) == text.size();
+          if (rw != nullptr)
+          {
+               SDL_RWclose(rw);
+          }
+          return wrote && tableFileWriterSave(writer, TABLE_PATH);
+     }
+
+     // A save with text but no records, read back through the string table
+     bool checkStringsOnly()
+     {
+          const char *const texts[] = {"first", "", "third, after an empty one"};
+          TableFileWriter writer;
+          tableFileWriterInit(writer, LEVEL_KIND, LEVEL_SCHEMA);
+          Uint32 offsets[SDL_arraysize(texts)];
+          for (size_t i = 0; i < SDL_arraysize(texts); i++)
+          {
+               offsets[i] = tableFileWriterString(writer, texts[i]);
+          }
+          if (!tableFileWriterSave(writer, TABLE_PATH))
+          {
+               std::fprintf(stderr, "Unable to write the strings-only file: %s\n", SDL_GetError());
+               return false;
+          }
+          TableFile file;
+          bool match = tableFileOpen(file, TABLE_PATH, LEVEL_KIND, LEVEL_SCHEMA, TABLE_FILE_VERIFY);
+          for (size_t i = 0; match && i < SDL_arraysize(texts); i++)
+          {
+               match = SDL_strcmp(tableFileString(file, offsets[i]), texts[i]) == 0;
+          }
+          if (!match)
+          {
+               std::fprintf(stderr, "Strings-only file did not read back: %s\n", SDL_GetError());
+          }
+          tableFileClose(file);
+          std::remove(TABLE_PATH);
+          return match;
+     }
+
+     // What a text loader does: read it all, parse each line into a record
+     bool loadText(std::vector<LevelEntity> &entities, std::vector<std::string> &names)
+     {
+          size_t size = 0;
+          char *text = (char *)SDL_LoadFile(TEXT_PATH, &size);
+          if (text == nullptr)
+          {
+               return false;
+          }
+          entities.clear();
+          names.clear();
+          char *cursor = text;
+          while (*cursor != '\0')
+          {
+               LevelEntity entity;
+               entity.x = std::strtof(cursor, &cursor);
+               entity.y = std::strtof(cursor, &cursor);
+               entity.vy = std::strtof(cursor, &cursor);
+               entity.kind = (Uint32)std::strtol(cursor, &cursor, 10);
+               while (*cursor == ' ')
+               {
+                    cursor++;
+               }
+               char *end = cursor;
+               while (*end != '\n' && *end != '\0')
+               {
+                    end++;
+               }
+               entity.name = (Uint32)names.size();
+               names.emplace_back(cursor, end);
+               entities.push_back(entity);
+               cursor = *end == '\n' ? end + 1 : end;
+          }
+          SDL_free(text);
+          return true;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(0) != 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     if (!checkStringsOnly())
+     {
+          SDL_Quit();
+          return 1;
+     }
+     std::printf("  %-10s %-16s %10s %10s %10s\n", "entities", "format", "file", "load", "use");
+     int status = 0;
+     for (int count : SIZES)
+     {
+          if (!writeLevel(count))
+          {
+               std::fprintf(stderr, "Unable to write the level: %s\n", SDL_GetError());
+               status = 1;
+               break;
+          }
+          Sint64 textBytes = 0, tableBytes = 0;
+          SDL_RWops *probe = SDL_RWFromFile(TEXT_PATH, "rb");
+          textBytes = probe != nullptr ? SDL_RWsize(probe) : 0;
+          if (probe != nullptr)
+          {
+               SDL_RWclose(probe);
+          }
+          probe = SDL_RWFromFile(TABLE_PATH, "rb");
+          tableBytes = probe != nullptr ? SDL_RWsize(probe) : 0;
+          if (probe != nullptr)
+          {
+               SDL_RWclose(probe);
+          }
+
+          std::vector<LevelEntity> entities;
+          std::vector<std::string> names;
+          Uint64 start = SDL_GetPerformanceCounter();
+          const bool parsed = loadText(entities, names);
+          const double textLoad = msSince(start);
+          start = SDL_GetPerformanceCounter();
+          const double textSum = useAll(entities.data(), entities.size());
+          const double textUse = msSince(start);
+          std::printf("  %-10d %-16s %7.1f MB %7.3f ms %7.3f ms\n", count, "text", textBytes / 1048576.0, textLoad,
+                      textUse);
+
+          for (int verify = 0; verify < 2 && parsed; verify++)
+          {
+               TableFile level;
+               start = SDL_GetPerformanceCounter();
+               const bool opened =
+                   tableFileOpen(level, TABLE_PATH, LEVEL_KIND, LEVEL_SCHEMA, verify ? TABLE_FILE_VERIFY : 0);
+               const double tableLoad = msSince(start);
+               Uint32 records = 0;
+               const LevelEntity *mapped = opened ? tableFileGet<LevelEntity>(level, LEVEL_ENTITIES, records) : nullptr;
+               start = SDL_GetPerformanceCounter();
+               const double tableSum = mapped != nullptr ? useAll(mapped, records) : -1.0;
+               const double tableUse = msSince(start);
+               const bool match = records == entities.size() && tableSum == textSum &&
+                                  SDL_strcmp(tableFileString(level, mapped[records - 1].name), names.back().c_str()) == 0;
+               std::printf("  %-10s %-16s %7.1f MB %7.3f ms %7.3f ms%s\n", "", verify ? "table, verified" : "table",
+                           tableBytes / 1048576.0, tableLoad, tableUse, match ? "" : "  MISMATCH");
+               status |= match ? 0 : 1;
+               tableFileClose(level);
+          }
+     }
+
+     std::remove(TEXT_PATH);
+     std::remove(TABLE_PATH);
+     SDL_Quit();
+     return status;
+}
@@ -0,0 +1,372 @@
+// Description:
+// Threading backend benchmark, what SDL's testthread.c, testsem.c,
+// testlock.c and torturethread.c check by eye, measured and printed as one
+// JSON object so runs can be diffed and tracked per platform:
+//
+// - thread_create_join: create an empty SDL_Thread and wait for it.
+// - sem_ping_pong: two threads passing a token through two semaphores;
+//   each sample is half a round trip, one post-to-wake handoff.
+// - cond_wakeup: a thread blocked in SDL_CondWait is signalled; each
+//   sample is the time from SDL_CondSignal to the waiter running.
+// - mutex_throughput: 1 to 16 threads on one SDL_mutex, FastMutex and
+//   SDL_SpinLock, in lock/unlock pairs per second across all threads.
+//
+// Latencies are in microseconds, as the median and 99th percentile of
+// every sample. Each test also checks its own result (the token arrived,
+// the counter is exact); the exit status is 1 when any check failed, so a
+// build script can fail on a broken backend as well as on a slow one.
+// `--quick` cuts the sample counts for smoke runs.
+//
+// Build and run from project_templete/:
+//     make threadbench && ./threadbench.exe > threadbench.json
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "fast_lock.h"
+
+namespace
+{
+     const int MUTEX_THREADS[] = {1, 2, 4, 8, 16};
+
+     int samplesPerTest = 2000;
+     Uint32 mutexRunMs = 200;
+     bool allPassed = true;
+     bool firstField = true;
+
+     double ticksToUs(Uint64 ticks)
+     {
+          return (double)ticks * 1e6 / (double)SDL_GetPerformanceFrequency();
+     }
+
+     void field(const char *format, ...) SDL_PRINTF_VARARG_FUNC(1);
+
+     // One "name": value member of the top-level object
+     void field(const char *format, ...)
+     {
+          std::printf(firstField ? "\n  " : ",\n  ");
+          firstField = false;
+          va_list args;
+          va_start(args, format);
+          std::vprintf(format, args);
+          va_end(args);
+     }
+
+     void latencyField(const char *name, std::vector<double> &us, bool ok)
+     {
+          allPassed = allPassed && ok && !us.empty();
+          if (us.empty())
+          {
+               field("\"%s\": {\"ok\": false}", name);
+               return;
+          }
+          std::sort(us.begin(), us.end());
+          const double median = us[us.size() / 2];
+          const double p99 = us[SDL_min(us.size() - 1, us.size() * 99 / 100)];
+          field("\"%s\": {\"ok\": %s, \"samples\": %d, \"median_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f}",
+                name, ok ? "true" : "false", (int)us.size(), median, p99, us.back());
+     }
+
+     // Thread creation
+     int SDLCALL emptyThread(void *)
+     {
+          return 7;
+     }
+
+     void benchCreateJoin()
+     {
+          std::vector<double> us;
+          bool ok = true;
+          for (int i = 0; i < samplesPerTest / 4; i++)
+          {
+               const Uint64 start = SDL_GetPerformanceCounter();
+               SDL_Thread *thread = SDL_CreateThread(emptyThread, "threadbench", nullptr);
+               int status = 0;
+               SDL_WaitThread(thread, &status);
+               us.push_back(ticksToUs(SDL_GetPerformanceCounter() - start));
+               ok = ok && thread != nullptr && status == 7;
+          }
+          latencyField("thread_create_join", us, ok);
+     }
+
+     // Semaphore ping-pong
+     struct PingPong
+     {
+          SDL_sem *ping;
+          SDL_sem *pong;
+          int rounds;
+          SDL_atomic_t quit; // Set before the last ping when a round timed out
+     };
+
+     int SDLCALL pongThread(void *data)
+     {
+          PingPong &game = *(PingPong *)data;
+          for (int i = 0; i < game.rounds; i++)
+          {
+               SDL_SemWait(game.ping);
+               if (SDL_AtomicGet(&game.quit))
+               {
+                    break;
+               }
+               SDL_SemPost(game.pong);
+          }
+          return 0;
+     }
+
+     void benchSemPingPong()
+     {
+          PingPong game = {SDL_CreateSemaphore(0), SDL_CreateSemaphore(0), samplesPerTest, {0}};
+          SDL_AtomicSet(&game.quit, 0);
+          SDL_Thread *thread = SDL_CreateThread(pongThread, "threadbench", &game);
+          std::vector<double> us;
+          bool ok = game.ping != nullptr && game.pong != nullptr && thread != nullptr;
+          for (int i = 0; ok && i < game.rounds; i++)
+          {
+               const Uint64 start = SDL_GetPerformanceCounter();
+               SDL_SemPost(game.ping);
+               ok = SDL_SemWaitTimeout(game.pong, 1000) == 0;
+               us.push_back(ticksToUs(SDL_GetPerformanceCounter() - start) / 2.0);
+          }
+          if (!ok && thread != nullptr)
+          {
+               // The pong thread still expects rounds; one more ping lets it see the flag
+               SDL_AtomicSet(&game.quit, 1);
+               SDL_SemPost(game.ping);
+          }
+          SDL_WaitThread(thread, nullptr);
+          ok = ok && SDL_SemValue(game.ping) == 0 && SDL_SemValue(game.pong) == 0;
+          SDL_DestroySemaphore(game.ping);
+          SDL_DestroySemaphore(game.pong);
+          latencyField("sem_ping_pong", us, ok);
+     }
+
+     // Condition variable wakeup
+     struct Wakeup
+     {
+          SDL_mutex *lock;
+          SDL_cond *cond;
+          SDL_sem *ready; // The waiter is about to wait
+          int generation;  // Bumped per signal, under lock
+          bool quit;       // A round timed out, under lock
+          Uint64 signalled;
+          std::vector<double> us;
+          int rounds;
+     };
+
+     int SDLCALL waiterThread(void *data)
+     {
+          Wakeup &wake = *(Wakeup *)data;
+          SDL_LockMutex(wake.lock);
+          for (int i = 0; i < wake.rounds; i++)
+          {
+               const int seen = wake.generation;
+               SDL_SemPost(wake.ready);
+               while (wake.generation == seen && !wake.quit)
+               {
+                    SDL_CondWait(wake.cond, wake.lock);
+               }
+               if (wake.quit)
+               {
+                    break;
+               }
+               wake.us.push_back(ticksToUs(SDL_GetPerformanceCounter() - wake.signalled));
+          }
+          SDL_UnlockMutex(wake.lock);
+          return 0;
+     }
+
+     void benchCondWakeup()
+     {
+          Wakeup wake;
+          wake.lock = SDL_CreateMutex();
+          wake.cond = SDL_CreateCond();
+          wake.ready = SDL_CreateSemaphore(0);
+          wake.generation = 0;
+          wake.signalled = 0;
+          wake.quit = false;
+          wake.rounds = samplesPerTest;
+          wake.us.reserve(wake.rounds);
+          SDL_Thread *thread = SDL_CreateThread(waiterThread, "threadbench", &wake);
+          bool ok = thread != nullptr;
+          for (int i = 0; ok && i < wake.rounds; i++)
+          {
+               ok = SDL_SemWaitTimeout(wake.ready, 1000) == 0;
+               // The waiter released the lock only inside SDL_CondWait.
+               // After a timeout it may still be on its way there, so it
+               // is told to stop rather than left waiting for rounds
+               SDL_LockMutex(wake.lock);
+               if (ok)
+               {
+                    wake.generation++;
+                    wake.signalled = SDL_GetPerformanceCounter();
+               }
+               else
+               {
+                    wake.quit = true;
+               }
+               SDL_CondSignal(wake.cond);
+               SDL_UnlockMutex(wake.lock);
+          }
+          SDL_WaitThread(thread, nullptr);
+          ok = ok && (int)wake.us.size() == wake.rounds;
+          SDL_DestroySemaphore(wake.ready);
+          SDL_DestroyCond(wake.cond);
+          SDL_DestroyMutex(wake.lock);
+          latencyField("cond_wakeup", wake.us, ok);
+     }
+
+     // Mutex throughput
+     enum MutexKind
+     {
+          MUTEX_SDL,
+          MUTEX_FAST,
+          MUTEX_SPIN
+     };
+
+     const char *MUTEX_NAMES[] = {"SDL_mutex", "FastMutex", "SDL_SpinLock"};
+
+     struct Contention
+     {
+          MutexKind kind;
+          SDL_mutex *mutex;
+          FastMutex fast;
+          SDL_SpinLock spin;
+          SDL_atomic_t running;
+          long counter;
+     };
+
+     struct Contender
+     {
+          Contention *shared;
+          long pairs;
+     };
+
+     int SDLCALL contenderThread(void *data)
+     {
+          Contender &contender = *(Contender *)data;
+          Contention &shared = *contender.shared;
+          while (SDL_AtomicGet(&shared.running) == 0)
+          {
+               SDL_Delay(0);
+          }
+          while (SDL_AtomicGet(&shared.running) == 1)
+          {
+               if (shared.kind == MUTEX_SDL)
+               {
+                    SDL_LockMutex(shared.mutex);
+                    shared.counter++;
+                    SDL_UnlockMutex(shared.mutex);
+               }
+               else if (shared.kind == MUTEX_FAST)
+               {
+                    fastMutexLock(shared.fast);
+                    shared.counter++;
+                    fastMutexUnlock(shared.fast);
+               }
+               else
+               {
+                    SDL_AtomicLock(&shared.spin);
+                    shared.counter++;
+                    SDL_AtomicUnlock(&shared.spin);
+               }
+               contender.pairs++;
+          }
+          return 0;
+     }
+
+     // Pairs per second, or -1 when the counter lost an increment
+     double mutexThroughput(MutexKind kind, int threadCount)
+     {
+          Contention shared;
+          shared.kind = kind;
+          shared.mutex = SDL_CreateMutex();
+          fastMutexInit(shared.fast);
+          shared.spin = 0;
+          SDL_AtomicSet(&shared.running, 0);
+          shared.counter = 0;
+
+          std::vector<Contender> contenders(threadCount, Contender{&shared, 0});
+          std::vector<SDL_Thread *> threads(threadCount);
+          for (int i = 0; i < threadCount; i++)
+          {
+               threads[i] = SDL_CreateThread(contenderThread, "threadbench", &contenders[i]);
+          }
+          const Uint64 start = SDL_GetPerformanceCounter();
+          SDL_AtomicSet(&shared.running, 1);
+          SDL_Delay(mutexRunMs);
+          SDL_AtomicSet(&shared.running, 2);
+          long pairs = 0;
+          for (int i = 0; i < threadCount; i++)
+          {
+               SDL_WaitThread(threads[i], nullptr);
+               pairs += contenders[i].pairs;
+          }
+          const double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+          SDL_DestroyMutex(shared.mutex);
+          return shared.counter == pairs && pairs > 0 ? pairs / seconds : -1.0;
+     }
+
+     void benchMutexThroughput()
+     {
+          std::printf(firstField ? "\n  " : ",\n  ");
+          firstField = false;
+          std::printf("\"mutex_throughput\": {");
+          for (int kind = MUTEX_SDL; kind <= MUTEX_SPIN; kind++)
+          {
+               std::printf("%s\n    \"%s\": {", kind == MUTEX_SDL ? "" : ",", MUTEX_NAMES[kind]);
+               for (size_t i = 0; i < SDL_arraysize(MUTEX_THREADS); i++)
+               {
+                    const double rate = mutexThroughput((MutexKind)kind, MUTEX_THREADS[i]);
+                    allPassed = allPassed && rate > 0.0;
+                    if (rate > 0.0)
+                    {
+                         std::printf("%s\"%d\": %.0f", i == 0 ? "" : ", ", MUTEX_THREADS[i], rate);
+                    }
+                    else
+                    {
+                         std::printf("%s\"%d\": null", i == 0 ? "" : ", ", MUTEX_THREADS[i]);
+                    }
+               }
+               std::printf("}");
+          }
+          std::printf("\n  }");
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     for (int i = 1; i < argc; i++)
+     {
+          if (std::strcmp(argv[i], "--quick") == 0)
+          {
+               samplesPerTest = 200;
+               mutexRunMs = 50;
+          }
+     }
+     if (SDL_Init(SDL_INIT_TIMER) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     SDL_version linked;
+     SDL_GetVersion(&linked);
+     std::printf("{");
+     field("\"platform\": \"%s\"", SDL_GetPlatform());
+     field("\"sdl\": \"%d.%d.%d\"", linked.major, linked.minor, linked.patch);
+     field("\"cpus\": %d", SDL_GetCPUCount());
+     benchCreateJoin();
+     benchSemPingPong();
+     benchCondWakeup();
+     benchMutexThroughput();
+     field("\"ok\": %s", allPassed ? "true" : "false");
+     std::printf("\n}\n");
+
+     SDL_Quit();
+     return allPassed ? 0 : 1;
+}
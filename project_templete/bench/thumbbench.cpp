@@ -0,0 +1,99 @@
+// Description:
+// JPEG thumbnail benchmark. Makes a thumbnail of the given JPEG the usual
+// way, IMG_Load_RW at full size then SDL_BlitScaled down, and with
+// jpegLoadScaled (jpeg_scaled.h) decoding at a DCT scaling factor first,
+// and reports milliseconds per thumbnail and the size of the surface each
+// decoded into. Run where turbojpeg.dll can be found, or the second
+// column falls back to SDL_image and only measures the same path twice.
+//
+// Build and run from project_templete/:
+//     make thumbbench && ./thumbbench.exe photo.jpg [thumbnail size]
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <cstdio>
+#include <cstdlib>
+
+#include "jpeg_scaled.h"
+#include "mapped_file.h"
+
+namespace
+{
+     const int ITERATIONS = 10;
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     // Fit `surface` within size x size, keeping its aspect
+     SDL_Surface *thumbnail(SDL_Surface *surface, int size)
+     {
+          const int longest = SDL_max(surface->w, surface->h);
+          SDL_Rect rect = {0, 0, SDL_max(1, surface->w * size / longest), SDL_max(1, surface->h * size / longest)};
+          SDL_Surface *thumb = SDL_CreateRGBSurfaceWithFormat(0, rect.w, rect.h, 32, SDL_PIXELFORMAT_ARGB8888);
+          SDL_BlitScaled(surface, nullptr, thumb, &rect);
+          return thumb;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     if (argc < 2)
+     {
+          std::fprintf(stderr, "usage: %s photo.jpg [thumbnail size]\n", argv[0]);
+          return 1;
+     }
+     const int size = argc > 2 ? SDL_max(1, std::atoi(argv[2])) : 256;
+     if (SDL_Init(0) < 0 || IMG_Init(IMG_INIT_JPG) == 0)
+     {
+          std::fprintf(stderr, "Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     std::printf("turbojpeg: %s\n", jpegTurboAvailable() ? "loaded" : SDL_GetError());
+
+     int fullW = 0, fullH = 0, scaledW = 0, scaledH = 0;
+     Uint64 start = SDL_GetPerformanceCounter();
+     for (int i = 0; i < ITERATIONS; i++)
+     {
+          SDL_Surface *surface = IMG_Load_RW(mappedRWFromFile(argv[1]), 1);
+          if (surface == nullptr)
+          {
+               std::fprintf(stderr, "IMG_Load_RW failed: %s\n", SDL_GetError());
+               return 1;
+          }
+          fullW = surface->w;
+          fullH = surface->h;
+          SDL_FreeSurface(thumbnail(surface, size));
+          SDL_FreeSurface(surface);
+     }
+     const double fullSeconds = secondsSince(start);
+
+     JpegScaledInfo info = {};
+     start = SDL_GetPerformanceCounter();
+     for (int i = 0; i < ITERATIONS; i++)
+     {
+          SDL_Surface *surface = jpegLoadScaled(mappedRWFromFile(argv[1]), 1, size, size, &info);
+          if (surface == nullptr)
+          {
+               std::fprintf(stderr, "jpegLoadScaled failed: %s\n", SDL_GetError());
+               return 1;
+          }
+          scaledW = surface->w;
+          scaledH = surface->h;
+          SDL_FreeSurface(thumbnail(surface, size));
+          SDL_FreeSurface(surface);
+     }
+     const double scaledSeconds = secondsSince(start);
+
+     std::printf("%-22s %10s %14s\n", "path", "ms/thumb", "decoded");
+     std::printf("%-22s %10.2f %7dx%-6d\n", "IMG_Load + BlitScaled", fullSeconds * 1000 / ITERATIONS, fullW, fullH);
+     std::printf("%-22s %10.2f %7dx%-6d %d/%d%s\n", "jpegLoadScaled", scaledSeconds * 1000 / ITERATIONS, scaledW,
+                 scaledH, info.scaleNum, info.scaleDenom, info.turbo ? "" : " (SDL_image)");
+     std::printf("speedup %.2fx\n", fullSeconds / SDL_max(1e-9, scaledSeconds));
+
+     IMG_Quit();
+     SDL_Quit();
+     return 0;
+}
@@ -0,0 +1,141 @@
+// Description:
+// Timer scaling benchmark, the testtimer.c question asked at gameplay
+// sizes: how SDL_AddTimer and timer_wheel cope with 10 to 100000
+// concurrent timers. For each count it times adding and cancelling the
+// timers, per timer. Firing is measured for real on SDL's timer thread, as
+// how late the last of the timers spread over 200 ms ran, and for the wheel
+// as the cost per timer of advancing over the same 200 ticks.
+//
+// Build and run from project_templete/:
+//     make timerbench && ./timerbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <vector>
+
+#include "timer_wheel.h"
+
+namespace
+{
+     const int COUNTS[] = {10, 100, 1000, 10000, 100000};
+     const Uint32 SPREAD_MS = 200;
+
+     SDL_atomic_t sdlFired;
+     long wheelFired;
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     Uint32 countFire(Uint32, void *)
+     {
+          SDL_AtomicAdd(&sdlFired, 1);
+          return 0;
+     }
+
+     void countWheelFires(const TimerFire *, int count, void *)
+     {
+          wheelFired += count;
+     }
+
+     // Delays spread evenly in random order, the same for both timers
+     std::vector<Uint32> makeDelays(int count, Uint32 base)
+     {
+          std::vector<Uint32> delays(count);
+          Uint32 state = 12345;
+          for (int i = 0; i < count; i++)
+          {
+               state = state * 1664525u + 1013904223u;
+               delays[i] = base + (state >> 8) % SPREAD_MS;
+          }
+          return delays;
+     }
+
+     double perTimerUs(double seconds, int count)
+     {
+          return seconds * 1e6 / count;
+     }
+}
+
+int main(int, char *[])
+{
+     if (SDL_Init(SDL_INIT_TIMER) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     std::printf("%8s | %10s %10s %10s | %10s %10s %10s\n", "timers", "SDL add", "SDL remove", "last late",
+                 "wheel add", "cancel", "fire");
+     std::printf("%8s | %10s %10s %10s | %10s %10s %10s\n", "", "us/timer", "us/timer", "ms",
+                 "us/timer", "us/timer", "us/timer");
+     for (const int count : COUNTS)
+     {
+          // SDL: add far enough out that nothing fires, then remove
+          std::vector<Uint32> delays = makeDelays(count, 60000);
+          std::vector<SDL_TimerID> sdlIds(count);
+          Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < count; i++)
+          {
+               sdlIds[i] = SDL_AddTimer(delays[i], countFire, nullptr);
+          }
+          const double sdlAdd = secondsSince(start);
+          start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < count; i++)
+          {
+               SDL_RemoveTimer(sdlIds[i]);
+          }
+          const double sdlRemove = secondsSince(start);
+
+          // SDL firing for real; the timer thread's work is the wall time
+          // past the last deadline
+          delays = makeDelays(count, 1);
+          SDL_AtomicSet(&sdlFired, 0);
+          const Uint64 fireStart = SDL_GetTicks64();
+          for (int i = 0; i < count; i++)
+          {
+               SDL_AddTimer(delays[i], countFire, nullptr);
+          }
+          while (SDL_AtomicGet(&sdlFired) < count)
+          {
+               SDL_Delay(1);
+          }
+          const double lastLate = (double)(SDL_GetTicks64() - fireStart) - SPREAD_MS;
+
+          TimerWheel wheel;
+          timerWheelInit(wheel, 0, count);
+          std::vector<TimerWheelId> wheelIds(count);
+          start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < count; i++)
+          {
+               wheelIds[i] = timerWheelAdd(wheel, delays[i], countWheelFires, nullptr);
+          }
+          const double wheelAdd = secondsSince(start);
+          start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < count; i++)
+          {
+               timerWheelCancel(wheel, wheelIds[i]);
+          }
+          const double wheelCancel = secondsSince(start);
+          for (int i = 0; i < count; i++)
+          {
+               timerWheelAdd(wheel, delays[i], countWheelFires, nullptr);
+          }
+          wheelFired = 0;
+          start = SDL_GetPerformanceCounter();
+          for (Uint64 tick = 0; tick <= SPREAD_MS + 1; tick++)
+          {
+               timerWheelAdvance(wheel, tick);
+          }
+          const double wheelFire = secondsSince(start);
+
+          std::printf("%8d | %10.3f %10.3f %10.1f | %10.3f %10.3f %10.3f%s\n", count,
+                      perTimerUs(sdlAdd, count), perTimerUs(sdlRemove, count), lastLate, perTimerUs(wheelAdd, count), perTimerUs(wheelCancel, count),
+                      perTimerUs(wheelFire, count), wheelFired == count ? "" : " (missed fires)");
+     }
+
+     SDL_Quit();
+     return 0;
+}
@@ -0,0 +1,147 @@
+// Description:
+// Vulkan sprite benchmark: frames per second and CPU time per frame for
+// 10k, 100k and 250k moving sprites over four textures, vsync off. The
+// CPU time covers writing the instances and vulkanSpritesEnd(); the rest
+// of the frame is the GPU, or waiting for a frame in flight to retire.
+//
+// Needs the Vulkan SDK (VULKAN_SDK in the Makefile). Build and run from
+// project_templete/:
+//     make vulkanbench && ./vulkanbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "vulkan_sprites.h"
+
+namespace
+{
+     const int WIDTH = 1280;
+     const int HEIGHT = 720;
+     const int SPRITE_COUNTS[] = {10000, 100000, 250000};
+     const double SECONDS_PER_COUNT = 3.0;
+
+     struct Mover
+     {
+          float x, y, dx, dy;
+     };
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(SDL_INIT_VIDEO) < 0)
+     {
+          std::printf("Unable to initialize SDL! SDL Error: %s\n", SDL_GetError());
+          return 1;
+     }
+     SDL_Window *window = SDL_CreateWindow("vulkanbench", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIDTH, HEIGHT,
+                                           SDL_WINDOW_VULKAN);
+     VulkanSprites sprites;
+     if (window == nullptr || !vulkanSpritesCreate(sprites, window, SPRITE_COUNTS[2], false))
+     {
+          std::printf("Unable to start the Vulkan sprite renderer! SDL Error: %s\n", SDL_GetError());
+          SDL_Quit();
+          return 1;
+     }
+
+     // Four small checkered textures, so the draw really switches textures
+     Uint32 textures[4];
+     for (int t = 0; t < 4; t++)
+     {
+          SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, 16, 16, 32, SDL_PIXELFORMAT_RGBA32);
+          SDL_FillRect(surface, nullptr, SDL_MapRGBA(surface->format, 255, 255, 255, 255));
+          SDL_Rect square = {0, 0, 8, 8};
+          SDL_FillRect(surface, &square, SDL_MapRGBA(surface->format, 64 * t, 255 - 64 * t, 128, 255));
+          const int index = vulkanSpritesAddTexture(sprites, surface, false);
+          SDL_FreeSurface(surface);
+          if (index < 0)
+          {
+               std::printf("Unable to upload a texture! SDL Error: %s\n", SDL_GetError());
+               vulkanSpritesDestroy(sprites);
+               SDL_Quit();
+               return 1;
+          }
+          textures[t] = (Uint32)index;
+     }
+
+     std::vector<Mover> movers(SPRITE_COUNTS[2]);
+     for (size_t i = 0; i < movers.size(); i++)
+     {
+          movers[i].x = (float)(std::rand() % WIDTH);
+          movers[i].y = (float)(std::rand() % HEIGHT);
+          movers[i].dx = (float)(std::rand() % 200 - 100) / 60.0f;
+          movers[i].dy = (float)(std::rand() % 200 - 100) / 60.0f;
+     }
+
+     std::printf("%10s %10s %14s\n", "sprites", "fps", "cpu ms/frame");
+     bool running = true;
+     bool failed = false;
+     for (int count : SPRITE_COUNTS)
+     {
+          int frames = 0;
+          double cpuSeconds = 0.0;
+          const Uint64 start = SDL_GetPerformanceCounter();
+          while (running && !failed && secondsSince(start) < SECONDS_PER_COUNT)
+          {
+               SDL_Event event;
+               while (SDL_PollEvent(&event))
+               {
+                    running = running && event.type != SDL_QUIT;
+               }
+               VulkanSprite *out = vulkanSpritesBegin(sprites);
+               if (out == nullptr)
+               {
+                    failed = true;
+                    break;
+               }
+               const Uint64 cpuStart = SDL_GetPerformanceCounter();
+               for (int i = 0; i < count; i++)
+               {
+                    Mover &mover = movers[i];
+                    mover.x += mover.dx;
+                    mover.y += mover.dy;
+                    mover.dx = mover.x < 0 || mover.x > WIDTH ? -mover.dx : mover.dx;
+                    mover.dy = mover.y < 0 || mover.y > HEIGHT ? -mover.dy : mover.dy;
+                    VulkanSprite &sprite = out[i];
+                    sprite.x = mover.x;
+                    sprite.y = mover.y;
+                    sprite.width = 8.0f;
+                    sprite.height = 8.0f;
+                    sprite.u0 = 0;
+                    sprite.v0 = 0;
+                    sprite.u1 = 65535;
+                    sprite.v1 = 65535;
+                    sprite.color = {255, 255, 255, 255};
+                    sprite.texture = textures[i & 3];
+               }
+               const SDL_Color clear = {33, 33, 33, 255};
+               if (!vulkanSpritesEnd(sprites, count, clear))
+               {
+                    failed = true;
+                    break;
+               }
+               cpuSeconds += secondsSince(cpuStart);
+               frames++;
+          }
+          const double elapsed = secondsSince(start);
+          std::printf("%10d %10.1f %14.3f\n", count, frames / elapsed, frames > 0 ? cpuSeconds * 1e3 / frames : 0.0);
+     }
+     if (failed)
+     {
+          std::printf("Unable to draw a frame! SDL Error: %s\n", SDL_GetError());
+     }
+
+     vulkanSpritesDestroy(sprites);
+     SDL_DestroyWindow(window);
+     SDL_Quit();
+     return failed ? 2 : 0;
+}
@@ -0,0 +1,235 @@
+// Description:
+// Directory listing and file-watch benchmark. Builds a tree of 32
+// directories with 128 files each, then reports what a polling rescan
+// costs (a recursive dirList per second, as CPU milliseconds per second
+// of game time) and, for the native watcher, the delay from a change to
+// its SDL event, FILE_WATCH_SETTLE_MS included.
+//
+// The changes are the ones an artist's tools make: overwriting a file in
+// place, adding one, saving through a temporary file renamed over the old
+// one, and deleting one. Each must come out as exactly one event on the
+// right path, and the temporary file as none.
+//
+// Build and run from project_templete/:
+//     make watchbench && ./watchbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "file_watch.h"
+
+namespace
+{
+     const char *ROOT = "watchbench.tmp";
+     const int DIRECTORIES = 32;
+     const int FILES_PER_DIRECTORY = 128;
+     const int LIST_RUNS = 20;
+
+     double secondsSince(Uint64 start)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+     }
+
+     void makeDirectory(const std::string &path)
+     {
+#ifdef _WIN32
+          _mkdir(path.c_str());
+#else
+          mkdir(path.c_str(), 0755);
+#endif
+     }
+
+     void removeDirectory(const std::string &path)
+     {
+#ifdef _WIN32
+          _rmdir(path.c_str());
+#else
+          rmdir(path.c_str());
+#endif
+     }
+
+     bool writeFile(const std::string &path, const char *text)
+     {
+          SDL_RWops *out = SDL_RWFromFile(path.c_str(), "wb");
+          return out != nullptr && SDL_RWwrite(out, text, 1, SDL_strlen(text)) == SDL_strlen(text) &&
+                 SDL_RWclose(out) == 0;
+     }
+
+     std::string fileName(int directory, int file)
+     {
+          char name[64];
+          SDL_snprintf(name, sizeof(name), "d%02d/f%03d.png", directory, file);
+          return name;
+     }
+
+     // Wait for the watch's next event; -1 ms when none comes within 2 s
+     double awaitEvent(FileWatch &watch, Uint64 start, FileChange &change, std::string &path)
+     {
+          const Uint32 type = fileWatchEventType();
+          while (secondsSince(start) < 2.0)
+          {
+               SDL_PumpEvents();
+               SDL_Event event;
+               if (SDL_PeepEvents(&event, 1, SDL_GETEVENT, type, type) == 1)
+               {
+                    const double ms = secondsSince(start) * 1000.0;
+                    change = (FileChange)event.user.code;
+                    path = (const char *)event.user.data1;
+                    fileWatchEventFree(event);
+                    if (event.user.data2 == &watch)
+                    {
+                         return ms;
+                    }
+               }
+               SDL_Delay(1);
+          }
+          return -1.0;
+     }
+
+     const char *changeName(FileChange change)
+     {
+          switch (change)
+          {
+          case FILE_ADDED:
+               return "added";
+          case FILE_REMOVED:
+               return "removed";
+          case FILE_MODIFIED:
+               return "modified";
+          case FILE_OVERFLOW:
+               return "overflow";
+          }
+          return "?";
+     }
+
+     // Make one change and check the event it produces; false on a wrong,
+     // missing or extra event
+     bool expectEvent(FileWatch &watch, const char *label, void (*act)(), FileChange want, FileChange alsoFine,
+                      const std::string &wantPath)
+     {
+          const Uint64 start = SDL_GetPerformanceCounter();
+          act();
+          FileChange change;
+          std::string path;
+          const double ms = awaitEvent(watch, start, change, path);
+          bool good = ms >= 0.0 && (change == want || change == alsoFine) && path == wantPath;
+          std::printf("%-14s %-9s %-16s %8.1f ms\n", label, ms < 0.0 ? "none" : changeName(change), path.c_str(), ms);
+          // Nothing else may follow once the burst has settled
+          const double extra = awaitEvent(watch, SDL_GetPerformanceCounter(), change, path);
+          if (extra >= 0.0 && extra < 3.0 * FILE_WATCH_SETTLE_MS)
+          {
+               std::printf("%-14s extra event: %s %s\n", "", changeName(change), path.c_str());
+               good = false;
+          }
+          return good;
+     }
+
+     void overwriteFile()
+     {
+          writeFile(std::string(ROOT) + "/" + fileName(3, 7), "changed contents");
+     }
+
+     void addFile()
+     {
+          writeFile(std::string(ROOT) + "/" + fileName(5, 999), "new");
+     }
+
+     void saveThroughTemporary()
+     {
+          const std::string target = std::string(ROOT) + "/" + fileName(9, 1);
+          const std::string temporary = target + ".tmp";
+          writeFile(temporary, "saved safely");
+          std::remove(target.c_str()); // rename() will not replace on Windows
+          std::rename(temporary.c_str(), target.c_str());
+     }
+
+     void deleteFile()
+     {
+          std::remove((std::string(ROOT) + "/" + fileName(12, 40)).c_str());
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(SDL_INIT_EVENTS) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     makeDirectory(ROOT);
+     for (int d = 0; d < DIRECTORIES; d++)
+     {
+          char name[16];
+          SDL_snprintf(name, sizeof(name), "/d%02d", d);
+          makeDirectory(ROOT + std::string(name));
+          for (int f = 0; f < FILES_PER_DIRECTORY; f++)
+          {
+               if (!writeFile(std::string(ROOT) + "/" + fileName(d, f), "pixels"))
+               {
+                    std::fprintf(stderr, "Unable to write the test tree! SDL Error: %s\n", SDL_GetError());
+                    return 1;
+               }
+          }
+     }
+
+     std::vector<DirEntry> entries;
+     const Uint64 listStart = SDL_GetPerformanceCounter();
+     for (int i = 0; i < LIST_RUNS; i++)
+     {
+          entries.clear();
+          dirList(ROOT, entries, true);
+     }
+     const double listSeconds = secondsSince(listStart) / LIST_RUNS;
+     std::printf("dirList: %zu entries in %.2f ms (%.0f entries/s); a rescan per %d ms costs %.2f ms/s\n",
+                 entries.size(), listSeconds * 1000.0, entries.size() / listSeconds, FILE_WATCH_POLL_MS,
+                 listSeconds * 1000.0 * 1000.0 / FILE_WATCH_POLL_MS);
+     bool good = entries.size() == (size_t)(DIRECTORIES * (FILES_PER_DIRECTORY + 1));
+
+     FileWatch watch;
+     if (!fileWatchStart(watch, ROOT, true))
+     {
+          std::fprintf(stderr, "Unable to watch %s! SDL Error: %s\n", ROOT, SDL_GetError());
+          return 1;
+     }
+     std::printf("watch backend %s, settle %d ms\n", fileWatchBackendName(watch.backend), FILE_WATCH_SETTLE_MS);
+     std::printf("%-14s %-9s %-16s %11s\n", "change", "event", "path", "latency");
+     good = expectEvent(watch, "overwrite", overwriteFile, FILE_MODIFIED, FILE_MODIFIED, fileName(3, 7)) && good;
+     good = expectEvent(watch, "add", addFile, FILE_ADDED, FILE_ADDED, fileName(5, 999)) && good;
+     good = expectEvent(watch, "temp + rename", saveThroughTemporary, FILE_MODIFIED, FILE_ADDED, fileName(9, 1)) && good;
+     good = expectEvent(watch, "delete", deleteFile, FILE_REMOVED, FILE_REMOVED, fileName(12, 40)) && good;
+     fileWatchStop(watch);
+
+     entries.clear();
+     dirList(ROOT, entries, true);
+     for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+     {
+          const std::string path = std::string(ROOT) + "/" + it->name;
+          if (it->directory)
+          {
+               removeDirectory(path);
+          }
+          else
+          {
+               std::remove(path.c_str());
+          }
+     }
+     removeDirectory(ROOT);
+     if (!good)
+     {
+          std::printf("file watching reported wrong events\n");
+     }
+     SDL_Quit();
+     return good ? 0 : 2;
+}
@@ -0,0 +1,177 @@
+// Description:
+// Y4M writer check and benchmark. Writes a capture whose second half is at
+// twice the first frame's size, as after a window resize, and checks the
+// header carries the measured rate, every FRAME is the header's size and
+// the resized frames were sampled to it rather than written as they came.
+// Then times encoding a 720p frame as is and scaled to 360p into a sink
+// that discards the bytes, as milliseconds per frame.
+//
+// Build and run from project_templete/:
+//     make y4mbench && ./y4mbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "video_capture.h"
+
+namespace
+{
+     const char *CHECK_PATH = "y4mbench.y4m";
+     const int BENCH_FRAMES = 200;
+
+     // An IYUV frame whose every sample says where it came from
+     struct TestFrame
+     {
+          std::vector<Uint8> data;
+          VideoEncodeFrame frame;
+     };
+
+     Uint8 sampleAt(int plane, int x, int y)
+     {
+          return (Uint8)(x * 7 + y * 13 + plane * 85);
+     }
+
+     void makeFrame(TestFrame &test, int width, int height)
+     {
+          const int chromaW = (width + 1) / 2, chromaH = (height + 1) / 2;
+          test.data.resize((size_t)width * height + (size_t)chromaW * chromaH * 2);
+          Uint8 *planes[3] = {test.data.data(), test.data.data() + (size_t)width * height, nullptr};
+          planes[2] = planes[1] + (size_t)chromaW * chromaH;
+          for (int plane = 0; plane < 3; plane++)
+          {
+               const int w = plane == 0 ? width : chromaW, h = plane == 0 ? height : chromaH;
+               for (int y = 0; y < h; y++)
+               {
+                    for (int x = 0; x < w; x++)
+                    {
+                         planes[plane][(size_t)y * w + x] = sampleAt(plane, x, y);
+                    }
+               }
+          }
+          test.frame = VideoEncodeFrame{SDL_PIXELFORMAT_IYUV, width, height, {planes[0], planes[1], planes[2]},
+                                        {width, chromaW, chromaW}, test.data.size(), 0, 0};
+     }
+
+     // `test` sampled to width x height, nearest source sample per plane
+     std::vector<Uint8> sampledTo(const TestFrame &test, int width, int height)
+     {
+          std::vector<Uint8> out;
+          for (int plane = 0; plane < 3; plane++)
+          {
+               const int srcW = plane == 0 ? test.frame.width : (test.frame.width + 1) / 2;
+               const int srcH = plane == 0 ? test.frame.height : (test.frame.height + 1) / 2;
+               const int w = plane == 0 ? width : (width + 1) / 2, h = plane == 0 ? height : (height + 1) / 2;
+               for (int y = 0; y < h; y++)
+               {
+                    for (int x = 0; x < w; x++)
+                    {
+                         out.push_back(sampleAt(plane, x * srcW / w, y * srcH / h));
+                    }
+               }
+          }
+          return out;
+     }
+
+     size_t discardWrite(SDL_RWops *, const void *, size_t, size_t count)
+     {
+          return count;
+     }
+
+     int discardClose(SDL_RWops *context)
+     {
+          SDL_FreeRW(context);
+          return 0;
+     }
+
+     bool check()
+     {
+          VideoY4m y4m;
+          if (!videoY4mOpen(y4m, CHECK_PATH, 59.94))
+          {
+               std::printf("open failed: %s\n", SDL_GetError());
+               return false;
+          }
+          const VideoEncoder encoder = videoY4mEncoder(y4m);
+          TestFrame small, large;
+          makeFrame(small, 33, 17);
+          makeFrame(large, 66, 34);
+          bool good = true;
+          for (int i = 0; i < 4; i++)
+          {
+               good = encoder.encode(encoder.userdata, i < 2 ? small.frame : large.frame) && good;
+          }
+          const int rescaled = y4m.rescaled;
+          encoder.finish(encoder.userdata);
+
+          size_t size = 0;
+          char *file = (char *)SDL_LoadFile(CHECK_PATH, &size);
+          std::remove(CHECK_PATH);
+          const char *header = "YUV4MPEG2 W33 H17 F59940:1000 Ip A1:1 C420jpeg\n";
+          const size_t headerLength = std::strlen(header);
+          const size_t frameBytes = 6 + small.data.size();
+          if (!good || file == nullptr || size != headerLength + frameBytes * 4 || std::memcmp(file, header, headerLength) != 0)
+          {
+               std::printf("y4m: %zu bytes, expected a 33x17 59.94 Hz header and 4 frames of %zu\n", size, frameBytes);
+               SDL_free(file);
+               return false;
+          }
+          const std::vector<Uint8> sampled = sampledTo(large, 33, 17);
+          for (int i = 0; i < 4 && good; i++)
+          {
+               const Uint8 *frame = (const Uint8 *)file + headerLength + frameBytes * i;
+               const Uint8 *expected = i < 2 ? small.data.data() : sampled.data();
+               good = std::memcmp(frame, "FRAME\n", 6) == 0 && std::memcmp(frame + 6, expected, small.data.size()) == 0;
+          }
+          SDL_free(file);
+          if (!good || rescaled != 2)
+          {
+               std::printf("y4m: resized frames were not sampled to 33x17 (%d rescaled)\n", rescaled);
+               return false;
+          }
+          return true;
+     }
+
+     double msPerFrame(const TestFrame &first, const TestFrame &timed)
+     {
+          VideoY4m y4m = {};
+          y4m.fpsNumerator = 60;
+          y4m.fpsDenominator = 1;
+          y4m.file = SDL_AllocRW();
+          y4m.file->write = discardWrite;
+          y4m.file->close = discardClose;
+          const VideoEncoder encoder = videoY4mEncoder(y4m);
+          encoder.encode(encoder.userdata, first.frame);
+          const Uint64 start = SDL_GetPerformanceCounter();
+          for (int i = 0; i < BENCH_FRAMES; i++)
+          {
+               encoder.encode(encoder.userdata, timed.frame);
+          }
+          const double ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency() / BENCH_FRAMES;
+          encoder.finish(encoder.userdata);
+          return ms;
+     }
+}
+
+int main(int, char *[])
+{
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+     if (!check())
+     {
+          SDL_Quit();
+          return 2;
+     }
+     TestFrame small, large;
+     makeFrame(small, 640, 360);
+     makeFrame(large, 1280, 720);
+     std::printf("%-12s %10.3f ms\n", "as is", msPerFrame(large, large));
+     std::printf("%-12s %10.3f ms\n", "720p to 360p", msPerFrame(small, large));
+     SDL_Quit();
+     return 0;
+}
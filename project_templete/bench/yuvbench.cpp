@@ -0,0 +1,241 @@
+// Description:
+// YUV conversion benchmark and validator. First checks every kernel this
+// CPU supports against SDL's test/testyuv_cvt.c reference, bit for bit,
+// over an image holding all 2^24 RGB colors, for every YUV format and
+// conversion mode. It also checks that the YUV -> RGB kernels agree with
+// the scalar path and stay within testyuv.c's tolerance of
+// SDL_ConvertPixels. Then it reports throughput at 1080p and 4K in both
+// directions next to the reference.
+//
+// Build and run from project_templete/:  make yuvbench && ./yuvbench.exe
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "testyuv_cvt.h"
+#include "yuv_convert.h"
+
+namespace
+{
+     const int ITERATIONS = 10;
+
+     const Uint32 FORMATS[] = {SDL_PIXELFORMAT_YV12, SDL_PIXELFORMAT_IYUV, SDL_PIXELFORMAT_NV12, SDL_PIXELFORMAT_NV21,
+                               SDL_PIXELFORMAT_YUY2, SDL_PIXELFORMAT_UYVY, SDL_PIXELFORMAT_YVYU};
+     const SDL_YUV_CONVERSION_MODE MODES[] = {SDL_YUV_CONVERSION_JPEG, SDL_YUV_CONVERSION_BT601,
+                                              SDL_YUV_CONVERSION_BT709, SDL_YUV_CONVERSION_AUTOMATIC};
+     const YuvKernel KERNELS[] = {YUV_KERNEL_SCALAR, YUV_KERNEL_SSE41, YUV_KERNEL_AVX2, YUV_KERNEL_NEON};
+
+     const char *modeName(SDL_YUV_CONVERSION_MODE mode)
+     {
+          switch (mode)
+          {
+          case SDL_YUV_CONVERSION_JPEG:
+               return "JPEG";
+          case SDL_YUV_CONVERSION_BT601:
+               return "BT601";
+          case SDL_YUV_CONVERSION_BT709:
+               return "BT709";
+          default:
+               return "AUTO";
+          }
+     }
+
+     // The reference takes the resolved mode, as testyuv.c passes it
+     void referenceFromRgb(Uint32 format, std::vector<Uint8> &rgb, int pitch, Uint8 *yuv, int width, int height,
+                           SDL_YUV_CONVERSION_MODE mode)
+     {
+          if (mode == SDL_YUV_CONVERSION_AUTOMATIC)
+          {
+               mode = SDL_GetYUVConversionModeForResolution(width, height);
+          }
+          ConvertRGBtoYUV(format, rgb.data(), pitch, yuv, width, height, mode, 0, 100);
+     }
+
+     // Every 24-bit color exactly once, with a ragged pitch
+     void allColors(std::vector<Uint8> &rgb, int &width, int &height, int &pitch)
+     {
+          width = height = 4096;
+          pitch = width * 3 + 5;
+          rgb.assign((size_t)pitch * height, 0);
+          for (int y = 0; y < height; y++)
+          {
+               for (int x = 0; x < width; x++)
+               {
+                    Uint32 color = (Uint32)(y * width + x);
+                    Uint8 *p = &rgb[(size_t)y * pitch + 3 * x];
+                    p[0] = (Uint8)color, p[1] = (Uint8)(color >> 8), p[2] = (Uint8)(color >> 16);
+               }
+          }
+     }
+
+     // testyuv.c's check: squared RGB distance per pixel at most 20
+     bool closeToSdl(Uint32 format, const Uint8 *yuv, int width, int height, const std::vector<Uint8> &ours,
+                     SDL_YUV_CONVERSION_MODE mode)
+     {
+          std::vector<Uint8> theirs(ours.size());
+          SDL_SetYUVConversionMode(mode);
+          int result = SDL_ConvertPixels(width, height, format, yuv, yuvPitch(format, width), SDL_PIXELFORMAT_RGB24,
+                                         theirs.data(), width * 3);
+          SDL_SetYUVConversionMode(SDL_YUV_CONVERSION_AUTOMATIC);
+          if (result != 0)
+          {
+               return false;
+          }
+          for (size_t i = 0; i < ours.size(); i += 3)
+          {
+               int dr = ours[i] - theirs[i], dg = ours[i + 1] - theirs[i + 1], db = ours[i + 2] - theirs[i + 2];
+               if (dr * dr + dg * dg + db * db > 20)
+               {
+                    return false;
+               }
+          }
+          return true;
+     }
+
+     double millisecondsSince(Uint64 start, int iterations)
+     {
+          return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency() / iterations;
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     (void)argc;
+     (void)argv;
+     if (SDL_Init(0) < 0)
+     {
+          std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+          return 1;
+     }
+
+     // --- Validation ---
+     int width, height, pitch;
+     std::vector<Uint8> rgb;
+     allColors(rgb, width, height, pitch);
+     int failures = 0;
+     std::printf("validating %dx%d (all 2^24 colors)\n", width, height);
+     for (SDL_YUV_CONVERSION_MODE mode : MODES)
+     {
+          for (Uint32 format : FORMATS)
+          {
+               size_t size = yuvImageSize(format, width, height);
+               std::vector<Uint8> expected(size), actual(size);
+               referenceFromRgb(format, rgb, pitch, expected.data(), width, height, mode);
+               std::vector<Uint8> scalarRgb((size_t)width * height * 3), kernelRgb(scalarRgb.size());
+               yuvToRgb(YUV_KERNEL_SCALAR, format, expected.data(), width, height, scalarRgb.data(), width * 3, mode);
+
+               for (YuvKernel kernel : KERNELS)
+               {
+                    if (!yuvKernelSupported(kernel))
+                    {
+                         continue;
+                    }
+                    yuvFromRgb(kernel, format, rgb.data(), pitch, actual.data(), width, height, mode);
+                    bool forwardExact = actual == expected;
+                    yuvToRgb(kernel, format, expected.data(), width, height, kernelRgb.data(), width * 3, mode);
+                    bool inverseExact = kernelRgb == scalarRgb;
+                    if (!forwardExact || !inverseExact)
+                    {
+                         std::printf("  FAIL %-5s %-22s %-7s rgb->yuv %s, yuv->rgb %s\n", modeName(mode),
+                                     SDL_GetPixelFormatName(format), yuvKernelName(kernel),
+                                     forwardExact ? "exact" : "differs", inverseExact ? "exact" : "differs");
+                         failures++;
+                    }
+               }
+          }
+     }
+
+     // YUV -> RGB against SDL on flat 2x2 blocks, where chroma subsampling
+     // loses nothing (the same pattern idea as testyuv.c)
+     {
+          const int size = 256;
+          std::vector<Uint8> blocks((size_t)size * size * 3), ours(blocks.size());
+          for (int y = 0; y < size; y++)
+          {
+               for (int x = 0; x < size; x++)
+               {
+                    Uint32 color = (Uint32)((y / 2) * (size / 2) + x / 2) * 2654435761u;
+                    Uint8 *p = &blocks[((size_t)y * size + x) * 3];
+                    p[0] = (Uint8)color, p[1] = (Uint8)(color >> 8), p[2] = (Uint8)(color >> 16);
+               }
+          }
+          const SDL_YUV_CONVERSION_MODE exactModes[] = {SDL_YUV_CONVERSION_JPEG, SDL_YUV_CONVERSION_BT601,
+                                                        SDL_YUV_CONVERSION_BT709};
+          for (SDL_YUV_CONVERSION_MODE mode : exactModes)
+          {
+               for (Uint32 format : FORMATS)
+               {
+                    std::vector<Uint8> yuv(yuvImageSize(format, size, size));
+                    yuvFromRgb(YUV_KERNEL_AUTO, format, blocks.data(), size * 3, yuv.data(), size, size, mode);
+                    yuvToRgb(YUV_KERNEL_AUTO, format, yuv.data(), size, size, ours.data(), size * 3, mode);
+                    if (!closeToSdl(format, yuv.data(), size, size, ours, mode))
+                    {
+                         std::printf("  FAIL %-5s %-22s yuv->rgb differs from SDL_ConvertPixels\n", modeName(mode),
+                                     SDL_GetPixelFormatName(format));
+                         failures++;
+                    }
+               }
+          }
+     }
+     std::printf("%s\n\n", failures == 0 ? "all kernels bit-exact" : "VALIDATION FAILED");
+
+     // --- Throughput (NV12 and YUY2, BT.709) ---
+     const int sizes[][2] = {{1920, 1080}, {3840, 2160}};
+     const Uint32 timedFormats[] = {SDL_PIXELFORMAT_NV12, SDL_PIXELFORMAT_YUY2};
+     std::printf("%-10s %-22s %-9s %12s %12s %12s\n", "size", "format", "kernel", "to yuv ms", "Mpix/s",
+                 "to rgb ms");
+     for (const int *dims : sizes)
+     {
+          int w = dims[0], h = dims[1];
+          std::vector<Uint8> frame((size_t)w * h * 3);
+          std::srand(1);
+          for (Uint8 &byte : frame)
+          {
+               byte = (Uint8)std::rand();
+          }
+          char sizeName[16];
+          SDL_snprintf(sizeName, sizeof(sizeName), "%dx%d", w, h);
+
+          for (Uint32 format : timedFormats)
+          {
+               std::vector<Uint8> yuv(yuvImageSize(format, w, h));
+               std::vector<Uint8> back(frame.size());
+
+               Uint64 start = SDL_GetPerformanceCounter();
+               referenceFromRgb(format, frame, w * 3, yuv.data(), w, h, SDL_YUV_CONVERSION_BT709);
+               double referenceMs = millisecondsSince(start, 1);
+               std::printf("%-10s %-22s %-9s %12.2f %12.0f %12s\n", sizeName, SDL_GetPixelFormatName(format),
+                           "reference", referenceMs, w * h / referenceMs / 1000.0, "-");
+
+               for (YuvKernel kernel : KERNELS)
+               {
+                    if (!yuvKernelSupported(kernel))
+                    {
+                         continue;
+                    }
+                    yuvFromRgb(kernel, format, frame.data(), w * 3, yuv.data(), w, h, SDL_YUV_CONVERSION_BT709);
+                    start = SDL_GetPerformanceCounter();
+                    for (int i = 0; i < ITERATIONS; i++)
+                    {
+                         yuvFromRgb(kernel, format, frame.data(), w * 3, yuv.data(), w, h, SDL_YUV_CONVERSION_BT709);
+                    }
+                    double forwardMs = millisecondsSince(start, ITERATIONS);
+                    start = SDL_GetPerformanceCounter();
+                    for (int i = 0; i < ITERATIONS; i++)
+                    {
+                         yuvToRgb(kernel, format, yuv.data(), w, h, back.data(), w * 3, SDL_YUV_CONVERSION_BT709);
+                    }
+                    double inverseMs = millisecondsSince(start, ITERATIONS);
+                    std::printf("%-10s %-22s %-9s %12.2f %12.0f %12.2f\n", sizeName, SDL_GetPixelFormatName(format),
+                                yuvKernelName(kernel), forwardMs, w * h / forwardMs / 1000.0, inverseMs);
+               }
+          }
+     }
+
+     SDL_Quit();
+     return failures == 0 ? 0 : 1;
+}
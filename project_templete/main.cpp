@@ -7,28 +7,131 @@
 // How to Compile:
 // Make sure you have the SDL2, SDL2_image, and SDL2_mixer development
 // libraries installed.
-// g++ main.cpp -o game -lSDL2 -lSDL2_image -lSDL2_mixer
+// g++ -Isrc main.cpp src/*.cpp -o game -lSDL2 -lSDL2_image -lSDL2_mixer
 //
 // How to Run:
 // Place the following files in the same directory as the executable:
 // - "play_button.png"
 // - "game_over.png"
 // - "background_music.mp3" (or other supported audio format)
+// - "menu_background.gif" (optional, animated menu backdrop)
+// - "menu_background.dds" (optional, still menu backdrop used without the GIF)
+// - "ambience.wav" (optional, a long loop streamed under the gameplay)
+// - "controllers.gcdb" (optional, controller mappings compiled from
+//   gamecontrollerdb.txt by tools/mkmapdb)
+// The first run bakes the HUD glyphs into "hud.glyphs" in the working
+// directory; later runs load them from it instead of rasterizing.
 //
 // Controls:
 // - Mouse Click on Play Button: Start the game
 // - Mouse Movement: Move paddle left and right
 // - Left/Right Arrow Keys: Move paddle left and right
+// - Game Controller Left Stick or D-Pad: Move paddle left and right
 // - Escape Key or Window Close: Quit the game
+// - F3: Toggle the frame-time overlay and graph
+// - F4: Write frame_times.csv and frame_trace.json to the working directory
+// - F5: Save screenshot.png and screenshot_thumb.png in the background (set
+//   the environment variable CATCH_PARALLEL_PIXELS=1 to scale on all cores)
+// - F6: Toggle the game event log (catches, misses and recent messages)
+// - F7: Start or stop capturing every frame to capture_NNNNN.qoi
+// - F8: Start or stop recording video to capture.y4m
+// - F9: Rewind the game 8 ticks from its snapshot history, the rollback a
+//   netplay correction makes. The ticks played again make no sounds,
+//   sparks or log counts; those already happened the first time
+// - CATCH_LOW_LATENCY_AUDIO=1 opens the audio device with the smallest
+//   buffer that plays without underruns, for tight input-to-sound timing
+// - CATCH_AUDIO_BUDGET_LOG=1 logs every mix callback that misses its
+//   deadline, with the time each stage took; totals print on exit
+// - CATCH_IDLE_WAIT=0 keeps the loop ticking on static screens instead
+//   of sleeping until the next input event
+// - CATCH_VRR=1 on a variable refresh rate display presents without vsync
+//   and paces frames just under the display's maximum rate
+// - CATCH_VOICE_CAPTURE=1 runs the voice chat capture pipeline on the
+//   default microphone and prints its latency and dropouts on exit
+// - CATCH_LOGICAL_SCALE=integer scales the game by whole numbers only,
+//   with nearest sampling, in a window of any size
+// - CATCH_POWER_PROFILE=full or save pins the power profile; unset, the
+//   game drops to 30 FPS, fewer sparks, voices and job threads on battery
+//   or when the CPU runs hot or throttled
+// - CATCH_INPUT_THREAD=1 polls controllers at 1 kHz on their own thread
+//   and shows in the F3 overlay how old input is when it is simulated
+//
+// Render benchmarks:
+// - CATCH_RECORD_RENDER=session.crnd records every render command
+// - "game --replay session.crnd" replays it on each render driver and
+//   prints the frame timings as JSON
 // =============================================================================
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h> // Include for PNG loading
 #include <SDL2/SDL_mixer.h> // Include for audio
+#include <SDL2/SDL_ttf.h>   // Include for text
 #include <iostream>
 #include <vector>
-#include <cstdlib> // For rand() and srand()
-#include <ctime>   // For time()
+#include <ctime> // For time()
+
+#include "animation_stream.h"
+#include "asset_cache.h"
+#include "audio_budget.h"
+#include "audio_device.h"
+#include "asset_loader.h"
+#include "asset_pack.h"
+#include "async_log.h"
+#include "block_pool.h"
+#include "controller_hotplug.h"
+#include "cursor_cache.h"
+#include "dds_image.h"
+#include "debug_text.h"
+#include "dirty_regions.h"
+#include "dsp_graph.h"
+#include "entity_cull.h"
+#include "event_batch.h"
+#include "frame_arena.h"
+#include "frame_pacer.h"
+#include "frame_readback.h"
+#include "game_log.h"
+#include "glyph_bake.h"
+#include "glyph_cache.h"
+#include "gpu_timer.h"
+#include "hint_cache.h"
+#include "image_writer.h"
+#include "input_log.h"
+#include "input_thread.h"
+#include "job_system.h"
+#include "late_latch.h"
+#include "line_batch.h"
+#include "logical_view.h"
+#include "memory_tags.h"
+#include "music_stream.h"
+#include "parallel_pixels.h"
+#include "particle_system.h"
+#include "power_governor.h"
+#include "profiler.h"
+#include "profiler_overlay.h"
+#include "random_stream.h"
+#include "render_queue.h"
+#include "render_record.h"
+#include "render_replay.h"
+#include "sdf_text.h"
+#include "snapshot_ring.h"
+#include "sound_cache.h"
+#include "spatial_grid.h"
+#include "startup_trace.h"
+#include "streamed_sound.h"
+#include "surface_pool.h"
+#include "swept_collision.h"
+#include "symbol_table.h"
+#include "synth_voice.h"
+#include "text_layout.h"
+#include "texture_atlas.h"
+#include "texture_restore.h"
+#include "timer_wheel.h"
+#include "utf_convert.h"
+#include "video_capture.h"
+#include "voice_capture.h"
+#include "voice_manager.h"
+#include "voice_mixer.h"
+#include "window_resize.h"
 
 // --- Configuration Constants ---
 const int SCREEN_WIDTH = 800;
@@ -36,137 +139,743 @@ const int SCREEN_HEIGHT = 600;
 const int PADDLE_WIDTH = 100;
 const int PADDLE_HEIGHT = 20;
 const int BLOCK_SIZE = 30;
-const int PADDLE_SPEED = 10;
-const int BLOCK_SPEED = 5;
+const int PADDLE_SPEED = 10; // Pixels per simulation tick
+const int BLOCK_SPEED = 5;   // Pixels per simulation tick
 const int MAX_MISTAKES = 5;
+const int MAX_BLOCKS = 4096;           // Capacity of the block pool
+const int MAX_SPARKS = 8192;           // Capacity of the catch spark emitter
+const int SPARKS_PER_CATCH = 48;
+const int SPAWN_INTERVAL_TICKS = 45;   // A new block starts falling this often
+const float GRID_CELL_SIZE = 64.0f;    // Broadphase cell edge in pixels
+const int ATLAS_PAGE_SIZE = 2048;      // Edge of each texture atlas page
+const Uint32 ASSET_PIPELINE_VERSION = 1; // Bump when the atlas build changes its output
+const size_t FRAME_ARENA_BYTES = 1024 * 1024; // Scratch per frame before it spills to the heap
+const int AMBIENCE_CHANNEL = 16;       // First mixer channel after the voice manager's
+const int ROLLBACK_FRAMES = 16;        // Ticks of snapshot history
+const int ROLLBACK_TICKS = 8;          // How far F9 rewinds
+const int STICK_DEAD_ZONE = 8000;      // Of 32767; a resting stick drifts below this
+
+// --- Timing Constants ---
+// The simulation always advances in fixed steps of TICK_SECONDS, no matter
+// how fast frames are rendered. Rendering interpolates between the last two
+// simulation states so motion stays smooth on 60/144/240 Hz displays.
+const int TICKS_PER_SECOND = 60;
+const double TICK_SECONDS = 1.0 / TICKS_PER_SECOND;
+const int MAX_TICKS_PER_FRAME = 5;     // Caps catch-up work after a slow frame
+const double MAX_FRAME_SECONDS = 0.25; // Ignore longer stalls (debugger, window drag)
 
 // --- Game State Enum ---
 // To manage different states of the game
 enum GameState
 {
+     LOADING,
      MENU,
      PLAYING,
      GAME_OVER
 };
 
+// Render queue layers, drawn bottom to top; draws within one batch freely
+enum DrawLayer
+{
+     LAYER_BACKGROUND,
+     LAYER_WORLD,
+     LAYER_HUD,
+     LAYER_OVERLAY
+};
+
 // --- Game Structures ---
 
 // Represents the player's paddle
 struct Player
 {
-     SDL_Rect rect; // Position and dimensions
+     SDL_Rect rect;     // Position and dimensions
+     SDL_Rect prevRect; // Position at the previous simulation tick
+};
+
+// Everything a tick reads and writes besides the block pool and its grid,
+// kept in one struct so a rollback snapshot copies it in one go
+struct Simulation
+{
+     GameState state;
+     int mistakes;
+     int caught;
+     int ticksUntilSpawn;
+     Uint32 tick;   // Ticks played, the rollback history's frame number
+     RandomStream random; // Spawn positions; rand()'s state couldn't be snapshotted
+     Player player;
+};
+
+
+// Progress shown on the loading screen
+struct LoadingProgress
+{
+     int completed;
+     int total;
+};
+
+// The mixer device, opened on a startup thread while the window and
+// renderer are created
+struct AudioOpenJob
+{
+     AudioDevice *device;
+     AudioLatencyMode mode;
+     std::string error; // SDL's error is per thread, so it is kept here
 };
 
-// Represents a single falling block
-struct Block
+// Game controller input as the paddle reads it, rebuilt from controller
+// events so an input recording replays it like the keys
+struct PadInput
 {
-     SDL_Rect rect; // Position and dimensions
+     float stickX;     // Left stick past the dead zone, -1..1
+     bool left, right; // D-pad held
 };
 
 // --- Helper Function ---
 
-// Function to load a texture from a file
-SDL_Texture *loadTexture(const std::string &path, SDL_Renderer *renderer)
+void padInputHandleEvent(PadInput &pad, const SDL_Event &event)
 {
-     SDL_Texture *newTexture = nullptr;
-     SDL_Surface *loadedSurface = IMG_Load(path.c_str());
-     if (loadedSurface == nullptr)
+     if (event.type == SDL_CONTROLLERAXISMOTION && event.caxis.axis == SDL_CONTROLLER_AXIS_LEFTX)
      {
-          std::cerr << "Unable to load image " << path << "! SDL_image Error: " << IMG_GetError() << std::endl;
+          const int value = SDL_abs((int)event.caxis.value) < STICK_DEAD_ZONE ? 0 : event.caxis.value;
+          pad.stickX = SDL_clamp(value / 32767.0f, -1.0f, 1.0f);
      }
-     else
+     else if (event.type == SDL_CONTROLLERBUTTONDOWN || event.type == SDL_CONTROLLERBUTTONUP)
+     {
+          const bool down = event.type == SDL_CONTROLLERBUTTONDOWN;
+          if (event.cbutton.button == SDL_CONTROLLER_BUTTON_DPAD_LEFT)
+          {
+               pad.left = down;
+          }
+          if (event.cbutton.button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT)
+          {
+               pad.right = down;
+          }
+     }
+}
+
+// Our references to the controllers the hotplug thread has opened; the
+// thread keeps its own, so SDL keeps sending their events while we hold them
+void controllerNoticeHandle(SDL_Event &event, std::vector<SDL_GameController *> &controllers, PadInput &pad)
+{
+     const ControllerNotice *notice = (const ControllerNotice *)event.user.data1;
+     if (event.user.code == CONTROLLER_READY && notice->controller != nullptr)
+     {
+          std::cout << "Controller ready: " << notice->capabilities.name << std::endl;
+          controllers.push_back(notice->controller);
+     }
+     else if (event.user.code == CONTROLLER_GONE)
      {
-          newTexture = SDL_CreateTextureFromSurface(renderer, loadedSurface);
-          if (newTexture == nullptr)
+          for (size_t i = 0; i < controllers.size(); i++)
           {
-               std::cerr << "Unable to create texture from " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+               if (SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controllers[i])) == notice->id)
+               {
+                    SDL_GameControllerClose(controllers[i]);
+                    controllers.erase(controllers.begin() + i);
+                    break;
+               }
           }
-          SDL_FreeSurface(loadedSurface);
+          pad = PadInput{0.0f, false, false}; // Its last stick and buttons no longer hold
      }
-     return newTexture;
+     controllerHotplugEventFree(event);
+}
+
+// Asset loader progress callback, called on the main thread
+void onLoadProgress(int completed, int total, void *userdata)
+{
+     LoadingProgress *progress = (LoadingProgress *)userdata;
+     progress->completed = completed;
+     progress->total = total;
+}
+
+// Startup task: open the mixer device
+bool openAudioDevice(void *data)
+{
+     AudioOpenJob *job = (AudioOpenJob *)data;
+     memoryTagSet(MEMORY_TAG_AUDIO);
+     if (!audioDeviceOpen(*job->device, job->mode))
+     {
+          job->error = Mix_GetError();
+          return false;
+     }
+     return true;
+}
+
+// Register the simulation state with the rollback history. The sparks are
+// left out: they only decorate, and rolling them back would flicker
+void addSimulationSnapshot(SnapshotRing &ring, Simulation &sim, BlockPool &blocks, SpatialGrid &grid)
+{
+     snapshotRingAddValue(ring, sim);
+     snapshotRingAddValue(ring, blocks.liveCount);
+     snapshotRingAddValue(ring, blocks.highWater);
+     snapshotRingAddValue(ring, blocks.freeCount);
+     snapshotRingAddVector(ring, blocks.x);
+     snapshotRingAddVector(ring, blocks.y);
+     snapshotRingAddVector(ring, blocks.prevY);
+     snapshotRingAddVector(ring, blocks.vy);
+     snapshotRingAddVector(ring, blocks.alive);
+     snapshotRingAddVector(ring, blocks.freeList);
+     // Broadphase state too: rebuilding it would file blocks in a different
+     // order and take the simulation down a different path
+     snapshotRingAddValue(ring, grid.maxExtent);
+     snapshotRingAddVector(ring, grid.cellHead);
+     snapshotRingAddVector(ring, grid.bounds);
+     snapshotRingAddVector(ring, grid.cellOf);
+     snapshotRingAddVector(ring, grid.next);
+     snapshotRingAddVector(ring, grid.prev);
+}
+
+// Blend between the previous and current tick positions for rendering
+SDL_FRect interpolateRect(const SDL_Rect &prev, const SDL_Rect &current, float alpha)
+{
+     SDL_FRect result;
+     result.x = prev.x + (current.x - prev.x) * alpha;
+     result.y = prev.y + (current.y - prev.y) * alpha;
+     result.w = (float)current.w;
+     result.h = (float)current.h;
+     return result;
+}
+
+// Blocks drawn by one render recording chunk
+struct BlockDrawJob
+{
+     const BlockPool *blocks;
+     float alpha;
+};
+
+// Queue the live blocks in pool slots [begin, end), skipping any off screen
+void recordBlocks(void *data, RenderQueue &part, int begin, int end)
+{
+     const BlockDrawJob &job = *(const BlockDrawJob *)data;
+     const BlockPool &blocks = *job.blocks;
+     const SDL_Color blockColor = {255, 220, 50, 255};
+     const SDL_FRect screen = {0.0f, 0.0f, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT};
+
+     // Cull on the span a block covers between ticks, so the interpolated
+     // position is inside whatever passes
+     const int WINDOW = 256;
+     int visible[WINDOW];
+     for (int first = begin; first < end; first += WINDOW)
+     {
+          int count = cullRects(&blocks.x[first], &blocks.prevY[first], &blocks.alive[first],
+                                SDL_min(WINDOW, end - first), (float)BLOCK_SIZE, (float)(BLOCK_SIZE + BLOCK_SPEED),
+                                screen, visible);
+          for (int k = 0; k < count; k++)
+          {
+               int i = first + visible[k];
+               float y = blocks.prevY[i] + (blocks.y[i] - blocks.prevY[i]) * job.alpha;
+               SDL_FRect blockDrawRect = {blocks.x[i], y, (float)BLOCK_SIZE, (float)BLOCK_SIZE};
+               renderQueueFillRect(part, blockDrawRect, blockColor);
+          }
+     }
+}
+
+// Fill `samples` with a short decaying sine in the mixer's stereo S16
+// format and wrap it in a chunk that borrows the buffer
+Mix_Chunk makeTone(std::vector<Sint16> &samples, float pitch, float seconds)
+{
+     int freq = 44100;
+     Mix_QuerySpec(&freq, NULL, NULL);
+     int frames = (int)(freq * seconds);
+     samples.resize(frames * 2);
+     for (int i = 0; i < frames; i++)
+     {
+          float t = (float)i / freq;
+          float envelope = 1.0f - (float)i / frames;
+          Sint16 value = (Sint16)(SDL_sinf(2.0f * (float)M_PI * pitch * t) * envelope * 12000.0f);
+          samples[2 * i] = value;
+          samples[2 * i + 1] = value;
+     }
+
+     Mix_Chunk chunk;
+     chunk.allocated = 0;
+     chunk.abuf = (Uint8 *)samples.data();
+     chunk.alen = (Uint32)(samples.size() * sizeof(Sint16));
+     chunk.volume = MIX_MAX_VOLUME;
+     return chunk;
+}
+
+// Voice capture sink until voice chat has an encoder: keeps the peak
+// microphone level, so the pipeline can be exercised end to end
+bool meterVoice(void *userdata, const Sint16 *samples, int frames, int channels)
+{
+     SDL_atomic_t &peak = *(SDL_atomic_t *)userdata;
+     int level = SDL_AtomicGet(&peak);
+     for (int i = 0; i < frames * channels; i++)
+     {
+          level = SDL_max(level, SDL_abs((int)samples[i]));
+     }
+     SDL_AtomicSet(&peak, level);
+     return true;
+}
+
+// Postmix client of the audio budget, so voice mixing is timed too
+void renderVoices(void *userdata, Uint8 *stream, int len)
+{
+     voiceMixerRender(*(VoiceMixer *)userdata, (Sint16 *)stream, len / 4);
+}
+
+// Where read back frames go: tag 0 is an F5 screenshot, saved with a
+// quarter-size thumbnail; tag N > 0 is frame N of an F7 capture, saved as
+// QOI, which encodes fast enough to keep up. Encoding and disk writes
+// happen on the writer's thread. Frames come from `surfaces` and go back
+// to it once written.
+struct CaptureSink
+{
+     JobSystem *jobs;
+     SurfacePool *surfaces;
+     ImageWriter *writer;
+};
+
+void saveReadbackFrame(void *userdata, SDL_Surface *frame, int tag)
+{
+     CaptureSink &sink = *(CaptureSink *)userdata;
+     if (tag > 0)
+     {
+          char path[64];
+          SDL_snprintf(path, sizeof(path), "capture_%05d.qoi", tag);
+          imageWriterSave(*sink.writer, frame, path, IMAGE_FILE_QOI);
+          return;
+     }
+
+     // The PNG encoder converts to RGB24 itself, off this thread
+     SDL_Surface *thumbnail = surfacePoolAcquire(*sink.surfaces, SDL_max(frame->w / 4, 1), SDL_max(frame->h / 4, 1),
+                                                 SDL_PIXELFORMAT_RGB888, false);
+     if (thumbnail == nullptr || parallelBlitScaled(sink.jobs, frame, NULL, thumbnail, NULL) != 0)
+     {
+          std::cerr << "Unable to save screenshot! SDL Error: " << SDL_GetError() << std::endl;
+          surfacePoolRelease(*sink.surfaces, thumbnail);
+          surfacePoolRelease(*sink.surfaces, frame);
+          return;
+     }
+     imageWriterSave(*sink.writer, frame, "screenshot.png", IMAGE_FILE_PNG);
+     imageWriterSave(*sink.writer, thumbnail, "screenshot_thumb.png", IMAGE_FILE_PNG);
+}
+
+// Loop timers carry the flag they raise as their param
+void raiseTimerFlags(const TimerFire *fires, int count, void *)
+{
+     for (int i = 0; i < count; i++)
+     {
+          *(bool *)fires[i].param = true;
+     }
+}
+
+// The rate frames reach a video capture at: the measured present rate once
+// there is one, which under a frame cap or a slow GPU is not the display's
+double measuredPresentHz(const FramePacer &pacer)
+{
+     const FramePacerStats stats = framePacerGetStats(pacer);
+     if (stats.presents > 0 && stats.averageIntervalMs > 0.0)
+     {
+          return 1000.0 / stats.averageIntervalMs;
+     }
+     return stats.targetMs > 0.0 ? 1000.0 / stats.targetMs : 60.0;
+}
+
+// The power governor's profile, applied to everything it limits
+void applyPowerSettings(const PowerSettings &settings, FramePacer &pacer, VoiceManager &voices, JobSystem *jobs,
+                        int &sparksPerCatch)
+{
+     framePacerSetCap(pacer, settings.frameCapHz);
+     voiceManagerSetLimit(voices, settings.voices);
+     if (jobs != nullptr)
+     {
+          jobSystemSetActiveThreads(*jobs, settings.threads);
+     }
+     sparksPerCatch = SDL_max((int)(SPARKS_PER_CATCH * settings.particleScale), 1);
 }
 
 int main(int argc, char *args[])
 {
      // --- 1. Initialization ---
+     // Before anything calls SDL_malloc, so every block carries its tag
+     if (!memoryTagsInstall())
+     {
+          std::cerr << "Memory tags are unavailable! SDL_Error: " << SDL_GetError() << std::endl;
+     }
+     const Uint64 launchCounter = SDL_GetPerformanceCounter();
 
-     // Initialize SDL video and audio subsystems
-     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
+     // --bench N plays N frames on its own without a display, for CI runners
+     int benchFrames = 0;
+     for (int i = 1; i + 1 < argc; i++)
      {
-          std::cerr << "Could not initialize SDL! SDL_Error: " << SDL_GetError() << std::endl;
-          return 1;
+          if (SDL_strcmp(args[i], "--bench") == 0)
+          {
+               benchFrames = SDL_max(SDL_atoi(args[i + 1]), 1);
+          }
+     }
+     // In the browser the bench draws to the page's canvas, unpaced
+#if !defined(__EMSCRIPTEN__)
+     if (benchFrames > 0)
+     {
+          SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+          SDL_SetHint(SDL_HINT_AUDIODRIVER, "dummy");
+     }
+#endif
+
+     // Initialize SDL video and audio subsystems, timing each for
+     // STARTUP_TRACE_HINT
+     StartupTrace startupTrace;
+     startupTraceInit(startupTrace, launchCounter);
+     memoryTagSet(MEMORY_TAG_VIDEO);
+     if (startupInit(startupTrace, SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
+     {
+          // Builds without the offscreen driver still have the dummy one
+          if (benchFrames == 0 || !SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy") ||
+              startupInit(startupTrace, SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
+          {
+               std::cerr << "Could not initialize SDL! SDL_Error: " << SDL_GetError() << std::endl;
+               startupTraceDestroy(startupTrace);
+               return 1;
+          }
      }
+     memoryTagSet(MEMORY_TAG_GENERAL);
 
-     // Initialize SDL_image for PNG loading
-     int imgFlags = IMG_INIT_PNG;
-     if (!(IMG_Init(imgFlags) & imgFlags))
+     // Replaying a recording needs nothing but the renderers
+     if (argc >= 3 && SDL_strcmp(args[1], "--replay") == 0)
      {
-          std::cerr << "SDL_image could not initialize! SDL_image Error: " << IMG_GetError() << std::endl;
+          bool replayed = renderReplayBenchmark(args[2]);
+          startupTraceDestroy(startupTrace);
           SDL_Quit();
-          return 1;
+          return replayed ? 0 : 1;
      }
 
-     // Initialize SDL_mixer for audio playback
-     if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
+     // A recorded input session replays headless and unpaced, as a benchmark;
+     // otherwise the session is recorded when the hint names a file
+     InputLog inputLog;
+     Uint32 seed = benchFrames > 0 ? 1 : (Uint32)time(0);
+     const char *inputReplayPath = nullptr;
+     for (int i = 1; i + 1 < argc; i++)
      {
-          std::cerr << "SDL_mixer could not initialize! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          if (SDL_strcmp(args[i], "--replay-input") == 0)
+          {
+               inputReplayPath = args[i + 1];
+          }
+     }
+     const char *inputRecordPath = SDL_GetHint(INPUT_RECORD_HINT);
+     if (inputReplayPath != nullptr)
+     {
+          if (!inputLogReplay(inputLog, inputReplayPath))
+          {
+               SDL_Quit();
+               return 1;
+          }
+     }
+     else if (inputRecordPath == nullptr || inputRecordPath[0] == '\0' ||
+              !inputLogRecord(inputLog, inputRecordPath, seed))
+     {
+          inputLogInit(inputLog, seed);
+     }
+     const bool benchmarkReplay = inputLog.mode == INPUT_LOG_REPLAYING;
+     const bool headless = benchmarkReplay || benchFrames > 0;
+
+     // SDL_image and SDL_mixer codecs are loaded by the asset loader on
+     // first use, off the startup path
+
+     // Initialize SDL_mixer for audio playback. Nothing else touches the
+     // mixer until the assets load, so the device opens (and low latency
+     // mode probes it) on its own thread while the window and renderer are
+     // created
+     AudioDevice audioDevice;
+     AudioOpenJob audioOpenJob = {&audioDevice, audioDeviceHintedMode(), std::string()};
+     audioDevicePrepare(audioOpenJob.mode);
+     StartupTask audioOpenTask;
+     startupTaskStart(startupTrace, audioOpenTask, "open audio device", openAudioDevice, &audioOpenJob);
+
+     // Initialize SDL_ttf for text rendering
+     memoryTagSet(MEMORY_TAG_TTF);
+     const Uint64 ttfStart = SDL_GetPerformanceCounter();
+     if (TTF_Init() < 0)
+     {
+          std::cerr << "SDL_ttf could not initialize! SDL_ttf Error: " << TTF_GetError() << std::endl;
+          startupTaskFinish(audioOpenTask);
+          startupTraceDestroy(startupTrace);
+          Mix_Quit();
           IMG_Quit();
           SDL_Quit();
           return 1;
      }
 
+     startupTraceStep(startupTrace, "TTF_Init", nullptr, ttfStart);
+
      // Create a window
+     memoryTagSet(MEMORY_TAG_VIDEO);
+     const Uint64 windowStart = SDL_GetPerformanceCounter();
      SDL_Window *window = SDL_CreateWindow(
          "Catch the Block",
          SDL_WINDOWPOS_UNDEFINED,
          SDL_WINDOWPOS_UNDEFINED,
          SCREEN_WIDTH,
          SCREEN_HEIGHT,
-         SDL_WINDOW_SHOWN);
+         headless ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
      if (window == nullptr)
      {
           std::cerr << "Window could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+          startupTaskFinish(audioOpenTask);
+          startupTraceDestroy(startupTrace);
+          TTF_Quit();
           Mix_Quit();
           IMG_Quit();
           SDL_Quit();
           return 1;
      }
 
-     // Create a renderer for drawing
-     SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+     startupTraceStep(startupTrace, "create window", nullptr, windowStart);
+
+     // Create a renderer for drawing, paced by vsync unless headless or on
+     // a VRR display. The offscreen and dummy drivers may only offer the
+     // software renderer
+     Uint32 rendererFlags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC;
+     if (SDL_GetHintBoolean(VRR_PACING_HINT, SDL_FALSE))
+     {
+          rendererFlags = SDL_RENDERER_ACCELERATED;
+     }
+     if (benchFrames > 0)
+     {
+          rendererFlags = 0;
+     }
+     else if (benchmarkReplay)
+     {
+          rendererFlags = SDL_RENDERER_ACCELERATED;
+     }
+     // SDL turns batching off when SDL_RENDER_DRIVER names a backend (say
+     // metal or direct3d12), in case the app then uses that API directly.
+     // Only gpu_timer does here, and it flushes first, so keep batching on;
+     // an SDL_RENDER_BATCHING set by the user still wins
+     SDL_SetHintWithPriority(SDL_HINT_RENDER_BATCHING, "1", SDL_HINT_DEFAULT);
+     memoryTagSet(MEMORY_TAG_RENDER);
+     const Uint64 rendererStart = SDL_GetPerformanceCounter();
+     SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, rendererFlags);
      if (renderer == nullptr)
      {
           std::cerr << "Renderer could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+          startupTaskFinish(audioOpenTask);
+          startupTraceDestroy(startupTrace);
           SDL_DestroyWindow(window);
+          TTF_Quit();
           Mix_Quit();
           IMG_Quit();
           SDL_Quit();
           return 1;
      }
+     memoryTagSet(MEMORY_TAG_GENERAL);
+     SDL_RendererInfo createdInfo;
+     startupTraceStep(startupTrace, "create renderer",
+                      SDL_GetRendererInfo(renderer, &createdInfo) == 0 ? createdInfo.name : nullptr, rendererStart);
+     // The game keeps drawing in SCREEN_WIDTH x SCREEN_HEIGHT units whatever
+     // the window's size or density; the renderer's viewport and scale fit
+     // it (and the mouse) to the window. Before any texture is created, for
+     // integer scaling's nearest sampling
+     LogicalView logicalView;
+     if (!logicalViewInit(logicalView, window, renderer, SCREEN_WIDTH, SCREEN_HEIGHT))
+     {
+          std::cerr << "Unable to map the mouse to the logical view! SDL Error: " << SDL_GetError() << std::endl;
+     }
 
-     // Seed the random number generator
-     srand(time(0));
+     // Started before anything is uploaded, so the replay has every texture
+     const char *recordPath = SDL_GetHint(RENDER_RECORD_HINT);
+     if (recordPath != nullptr && recordPath[0] != '\0')
+     {
+          renderRecordStart(renderer, recordPath);
+     }
+
+     // Chunks and music decode to the device's format, so the device has to
+     // be open before the asset loader starts
+     if (!startupTaskFinish(audioOpenTask))
+     {
+          std::cerr << "SDL_mixer could not initialize! SDL_mixer Error: " << audioOpenJob.error << std::endl;
+          startupTraceDestroy(startupTrace);
+          renderRecordStop();
+          SDL_DestroyRenderer(renderer);
+          SDL_DestroyWindow(window);
+          TTF_Quit();
+          Mix_Quit();
+          IMG_Quit();
+          SDL_Quit();
+          return 1;
+     }
 
      // --- 2. Game Asset and Variable Setup ---
 
-     // Game state variable, start in the menu
-     GameState currentState = MENU;
-     int mistakes = 0;
+     // Game state, starting on the loading screen. The RNG is seeded from the
+     // input log, so a replay reuses the recorded seed
+     Simulation sim;
+     sim.state = LOADING;
+     sim.mistakes = 0;
+     sim.caught = 0;
+     sim.tick = 0;
+     randomStreamInit(sim.random, inputLog.seed);
+     int exitCode = 0;
+
+     // Decode menu and game over images and the music on worker threads;
+     // the game loop collects the results and packs the images into a shared
+     // texture atlas once everything has arrived
+     LoadingProgress loadingProgress = {0, 0};
 
-     // Load menu and game over textures
-     SDL_Texture *playButtonTexture = loadTexture("play_button.png", renderer);
-     SDL_Texture *gameOverTexture = loadTexture("game_over.png", renderer);
+     // Assets come from the memory-mapped assets.pak when it is present,
+     // loose files otherwise (and for anything the pack lacks)
+     AssetPack assetPack = {};
+     SDL_RWops *packProbe = SDL_RWFromFile("assets.pak", "rb");
+     bool hasAssetPack = false;
+     if (packProbe != nullptr)
+     {
+          SDL_RWclose(packProbe);
+          hasAssetPack = assetPackOpen(assetPack, "assets.pak");
+     }
+     const AssetPack *pack = hasAssetPack ? &assetPack : nullptr;
 
-     if (playButtonTexture == nullptr || gameOverTexture == nullptr)
+     // Codecs the last launch decoded with are loaded ahead of the requests
+     // that need them; the first launch only expects PNG
+     SymbolUsage startupUsage;
+     symbolUsageOpen(startupUsage, "Catch", "Catch");
+
+     AssetLoader assetLoader;
+     if (!assetLoaderStart(assetLoader, 0))
      {
-          std::cerr << "Failed to load one or more textures. Make sure they are in the correct directory." << std::endl;
+          std::cerr << "Could not start asset loader threads! SDL_Error: " << SDL_GetError() << std::endl;
+          assetLoaderStop(assetLoader);
+          symbolUsageClose(startupUsage);
+          startupTraceDestroy(startupTrace);
+          assetPackClose(assetPack);
+          renderRecordStop();
           SDL_DestroyRenderer(renderer);
           SDL_DestroyWindow(window);
+          TTF_Quit();
           Mix_Quit();
           IMG_Quit();
           SDL_Quit();
           return 1;
      }
+     assetLoaderSetPack(assetLoader, pack);
+     assetLoaderSetUsage(assetLoader, &startupUsage);
+     int prewarmImageCodecs = IMG_INIT_PNG, prewarmMixCodecs = 0;
+     if (startupUsage.hasRecord)
+     {
+          assetLoaderRecordedCodecs(startupUsage, prewarmImageCodecs, prewarmMixCodecs);
+     }
+     if (prewarmImageCodecs != 0 || prewarmMixCodecs != 0)
+     {
+          assetLoaderPrewarm(assetLoader, prewarmImageCodecs, prewarmMixCodecs);
+     }
+     assetLoaderSetProgressCallback(assetLoader, onLoadProgress, &loadingProgress);
+
+     // A warm start takes the finished atlas from the asset cache and skips
+     // decoding and packing the images altogether
+     AssetCache assetCache;
+     assetCacheOpen(assetCache, "Catch", "Catch", ASSET_PIPELINE_VERSION);
+     Uint64 atlasKey = 0;
+     const bool hasAtlasKey = assetCacheKey(assetCache, "atlas " + std::to_string(ATLAS_PAGE_SIZE) + " 1", pack,
+                                            {"play_button.png", "game_over.png"}, atlasKey);
+     TextureAtlas atlas;
+     const bool atlasCached = hasAtlasKey && assetCacheLoadAtlas(assetCache, renderer, atlasKey, atlas);
+     if (!atlasCached)
+     {
+          assetLoaderQueue(assetLoader, ASSET_IMAGE, "play_button", "play_button.png");
+          assetLoaderQueue(assetLoader, ASSET_IMAGE, "game_over", "game_over.png");
+     }
+     assetLoaderQueue(assetLoader, ASSET_MUSIC, "background_music", "background_music.mp3");
+     loadingProgress.total = assetLoader.queuedCount;
+
+     std::vector<AssetResult> loadedAssets;
+     bool assetsFailed = false;
+
+     AtlasBuilder atlasBuilder;
+     atlasBuilderInit(atlasBuilder, ATLAS_PAGE_SIZE, 1);
+     const AtlasSprite *playButtonSprite = nullptr;
+     const AtlasSprite *gameOverSprite = nullptr;
+     Mix_Music *backgroundMusic = nullptr;
+
+     // An uncompressed background_music.wav, when present, is streamed from
+     // its own decoder thread; otherwise the MP3 plays through Mix_PlayMusic
+     MusicStream musicStream;
+     bool hasMusicStream = musicStreamInit(musicStream, musicStreamDefaultConfig());
+
+     // Sound effects go through the vectorized voice mixer
+     VoiceMixer voiceMixer;
+     voiceMixerInit(voiceMixer, 64);
+     bool hasVoiceMixer = voiceMixerAttach(voiceMixer);
+
+     // Times every mix callback against its deadline; attached before the
+     // master graph so the graph counts as post effects
+     AudioBudget audioBudget;
+     audioBudgetInit(audioBudget, audioDevice.chunkSize, audioDevice.frequency, 0.5,
+                     SDL_GetHintBoolean(AUDIO_BUDGET_LOG_HINT, SDL_FALSE));
+     bool hasAudioBudget = audioBudgetAttach(audioBudget);
+     if (hasAudioBudget)
+     {
+          if (hasVoiceMixer)
+          {
+               audioBudgetSetPostMix(audioBudget, renderVoices, &voiceMixer);
+          }
+          musicStream.budget = &audioBudget;
+     }
+     std::vector<Sint16> catchSamples;
+
+     VoiceCapture voiceCapture;
+     SDL_atomic_t voicePeak;
+     SDL_AtomicSet(&voicePeak, 0);
+     bool hasVoiceCapture = SDL_GetHintBoolean(VOICE_CAPTURE_HINT, SDL_FALSE) &&
+                            voiceCaptureStart(voiceCapture, voiceCaptureDefaultConfig(), meterVoice, &voicePeak);
+     Mix_Chunk catchSound = makeTone(catchSamples, 880.0f, 0.08f);
+
+     // Sounds listed in sounds.manifest are decoded once up front; a
+     // catch.wav among them replaces the generated blip
+     SoundCache soundCache;
+     soundCacheInit(soundCache, 8 * 1024 * 1024);
+     SDL_RWops *soundManifest = SDL_RWFromFile("sounds.manifest", "rb");
+     if (soundManifest != nullptr)
+     {
+          SDL_RWclose(soundManifest);
+          soundCachePreload(soundCache, "sounds.manifest");
+     }
+     const Mix_Chunk *catchChunk = soundCacheFindPinned(soundCache, "catch.wav");
+     if (catchChunk == nullptr)
+     {
+          catchChunk = &catchSound;
+     }
+
+     // A long ambience loop streams from the pack instead of sitting
+     // decoded in memory for the whole session
+     StreamedSound ambience;
+     bool hasAmbience = false;
+     SDL_RWops *ambienceProbe = assetOpen(pack, "ambience.wav");
+     if (ambienceProbe != nullptr)
+     {
+          SDL_RWclose(ambienceProbe);
+          hasAmbience = streamedSoundOpen(ambience, pack, "ambience.wav");
+     }
+     if (hasAmbience && Mix_AllocateChannels(-1) <= AMBIENCE_CHANNEL)
+     {
+          Mix_AllocateChannels(AMBIENCE_CHANNEL + 1);
+     }
+
+     // Misses play on prioritized mixer channels so they are never lost
+     VoiceManager voiceManager;
+     voiceManagerInit(voiceManager, 0, 16, 4);
+     // The miss sound is synthesized on the channel the voice manager picks
+     SynthBank synth;
+     const bool hasSynth = synthBankInit(synth, 8);
+     SynthPatch missPatch = synthPatchDefaults();
+     missPatch.waveform = SYNTH_TRIANGLE;
+     missPatch.frequency = 220.0f;
+     missPatch.glide = -1.5f;
+     missPatch.decay = 0.25f;
+     missPatch.gain = 0.4f;
+
+     // Final-mix mastering: a gentle presence boost that may be dropped on
+     // slow machines, then a compressor to keep stacked sounds from clipping
+     int mixRate = 44100;
+     Mix_QuerySpec(&mixRate, NULL, NULL);
+     DspBiquad masterEq;
+     dspBiquadPeaking(masterEq, (float)mixRate, 3000.0f, 0.8f, 2.0f);
+     DspCompressor masterCompressor;
+     dspCompressorInit(masterCompressor, -6.0f, 4.0f, 5.0f, 120.0f);
+     DspGraph masterGraph;
+     dspGraphInit(masterGraph);
+     dspGraphAdd(masterGraph, DspNode{"presence", dspBiquadProcess, &masterEq, 0, true});
+     dspGraphAdd(masterGraph, DspNode{"compressor", dspCompressorProcess, &masterCompressor, 0, false});
+     dspGraphSetBudget(masterGraph, 500);
+     dspGraphAttach(masterGraph, MIX_CHANNEL_POST);
 
      // Define the play button's position and size
      SDL_Rect playButtonRect;
@@ -175,45 +884,419 @@ int main(int argc, char *args[])
      playButtonRect.x = (SCREEN_WIDTH - playButtonRect.w) / 2;
      playButtonRect.y = (SCREEN_HEIGHT - playButtonRect.h) / 2;
 
-     // Load background music
-     Mix_Music *backgroundMusic = Mix_LoadMUS("background_music.mp3");
-     if (backgroundMusic == nullptr)
+     // OS cursors, made once: a hand over the play button, none while the
+     // paddle follows the mouse. Never drawn in the frame, so the pointer
+     // doesn't lag a frame behind or wake the dirty regions
+     CursorCache cursors;
+     cursorCacheInit(cursors);
+     SDL_Cursor *handCursor = headless ? nullptr : cursorCacheSystem(cursors, SDL_SYSTEM_CURSOR_HAND);
+     bool overPlayButton = false;
+
+     // The paddle is drawn at the pointer sampled just before the flush,
+     // not where the last tick left it, while the mouse is steering it
+     LateLatch paddleLatch;
+     lateLatchInit(paddleLatch, window, &logicalView);
+     bool paddleFollowsMouse = false;
+
+     // Create the player's paddle
+     sim.player.rect.w = PADDLE_WIDTH;
+     sim.player.rect.h = PADDLE_HEIGHT;
+     sim.player.rect.x = (SCREEN_WIDTH - PADDLE_WIDTH) / 2;
+     sim.player.rect.y = SCREEN_HEIGHT - PADDLE_HEIGHT - 10;
+     sim.player.prevRect = sim.player.rect;
+
+     // Falling blocks live in a preallocated pool; start with one in play
+     BlockPool blocks;
+     blockPoolInit(blocks, MAX_BLOCKS);
+     blockPoolSpawn(blocks, (float)randomStreamRange(sim.random, SCREEN_WIDTH - BLOCK_SIZE), 0.0f, (float)BLOCK_SPEED);
+     sim.ticksUntilSpawn = SPAWN_INTERVAL_TICKS;
+
+     // Sparks thrown up where a block lands on the paddle
+     ParticleEmitter sparks;
+     particleEmitterInit(sparks, particleEmitterDefaults(), MAX_SPARKS);
+
+     // Broadphase over the playfield; block pool indices double as grid ids
+     const SDL_FRect playfield = {0.0f, 0.0f, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT};
+     SpatialGrid blockGrid;
+     spatialGridInit(blockGrid, playfield, GRID_CELL_SIZE, MAX_BLOCKS);
+     std::vector<int> hits;
+     hits.reserve(MAX_BLOCKS);
+     std::vector<float> catchTimes; // Time of impact within the tick for each caught block
+     catchTimes.reserve(MAX_BLOCKS);
+
+     // Snapshot after every tick, for netplay rollback and F9
+     SnapshotRing rollback;
+     snapshotRingInit(rollback, ROLLBACK_FRAMES);
+     addSimulationSnapshot(rollback, sim, blocks, blockGrid);
+     // Ticks below this are played again after a rollback, side effects off
+     Uint32 replayUntil = 0;
+
+     // Everything on screen is queued and submitted in a few batched calls
+     RenderQueue renderQueue;
+     renderQueueInit(renderQueue, RENDER_BATCH_GEOMETRY, MAX_BLOCKS + 16);
+     // Per-frame scratch (flush vertices, for now), recycled after each present
+     FrameArena frameArena;
+     if (frameArenaInit(frameArena, FRAME_ARENA_BYTES))
      {
-          std::cerr << "Failed to load background music! SDL_mixer Error: " << Mix_GetError() << std::endl;
-          SDL_DestroyTexture(playButtonTexture);
-          SDL_DestroyTexture(gameOverTexture);
-          SDL_DestroyRenderer(renderer);
-          SDL_DestroyWindow(window);
-          Mix_Quit();
-          IMG_Quit();
-          SDL_Quit();
-          return 1;
+          renderQueue.arena = &frameArena;
      }
+     std::vector<RenderQueue> blockParts; // Per-chunk queues for parallel recording
 
-     // Create the player's paddle
-     Player player;
-     player.rect.w = PADDLE_WIDTH;
-     player.rect.h = PADDLE_HEIGHT;
-     player.rect.x = (SCREEN_WIDTH - PADDLE_WIDTH) / 2;
-     player.rect.y = SCREEN_HEIGHT - PADDLE_HEIGHT - 10;
-
-     // Create the first falling block
-     Block block;
-     block.rect.w = BLOCK_SIZE;
-     block.rect.h = BLOCK_SIZE;
-     block.rect.x = rand() % (SCREEN_WIDTH - BLOCK_SIZE);
-     block.rect.y = 0;
+     // Without vsync nothing blocks in SDL_RenderPresent, so the loop yields
+     // the CPU itself while it waits for the next tick
+     SDL_RendererInfo rendererInfo;
+     bool hasVsync = SDL_GetRendererInfo(renderer, &rendererInfo) == 0 &&
+                     (rendererInfo.flags & SDL_RENDERER_PRESENTVSYNC);
+
+     // Static screens (menu, game over) only redraw what changed and are not
+     // presented at all while nothing does
+     DirtyRegions screenRegions;
+     dirtyRegionsInit(screenRegions, renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+     // A drag of the window border is applied once a frame, and while it
+     // holds up the loop the last frame is shown again at the new size
+     WindowResize windowResize;
+     windowResizeInit(windowResize, window, renderer,
+                      [](void *regions) { dirtyRegionsPresentRetained(*(DirtyRegions *)regions); }, &screenRegions);
+     GameState drawnState = sim.state;
+     SDL_Texture *drawnBackground = nullptr;
+     int drawnTitleSize = 0;
+     SDL_Rect drawnTitleRect = {0, 0, 0, 0};
+
+     // HUD and overlay text is drawn from a shared glyph atlas; text is
+     // optional, so a missing font only disables it
+     GlyphCache glyphCache;
+     glyphCacheInit(glyphCache, renderer, 512, 4);
+     glyphCacheSetQueue(glyphCache, &renderQueue);
+     int hudFontId = -1;
+     int debugFontId = -1;
+     std::vector<Uint32> hudCodepoints; // The score line, decoded when it changes
+     int hudCaught = -1, hudMistakes = -1;
+     memoryTagSet(MEMORY_TAG_TTF);
+     TTF_Font *hudFont = TTF_OpenFontRW(assetOpen(pack, "sans.ttf"), 1, 20);
+     TTF_Font *debugFont = TTF_OpenFontRW(assetOpen(pack, "sans.ttf"), 1, 14);
+     memoryTagSet(MEMORY_TAG_GENERAL);
+     if (hudFont == nullptr || debugFont == nullptr)
+     {
+          std::cerr << "Unable to open sans.ttf! SDL_ttf Error: " << TTF_GetError() << std::endl;
+     }
+     else
+     {
+          hudFontId = glyphCacheAddFont(glyphCache, hudFont);
+          debugFontId = glyphCacheAddFont(glyphCache, debugFont);
+     }
+     // Without the font the score still shows, in SDL_test's 8x8 characters
+     DebugText fallbackText;
+     const bool hasFallbackText = hudFontId < 0 && debugTextInit(fallbackText, renderer, 64);
+
+     // HUD glyphs load prebaked from hud.glyphs; the first run bakes them on
+     // a worker thread, from a font instance of its own, and saves the file
+     GlyphBake hudBake;
+     TTF_Font *hudBakeFont = nullptr;
+     Uint64 hudBakeStamp = 0;
+     if (hudFontId >= 0)
+     {
+          SDL_RWops *fontFile = assetOpen(pack, "sans.ttf");
+          if (fontFile != nullptr)
+          {
+               hudBakeStamp = ((Uint64)SDL_RWsize(fontFile) << 8) | 20; // File size and point size
+               SDL_RWclose(fontFile);
+          }
+          if (glyphBakeLoad(hudBake, "hud.glyphs", hudBakeStamp) && glyphBakeApply(hudBake, glyphCache, hudFontId))
+          {
+               glyphBakeDestroy(hudBake);
+          }
+          else
+          {
+               glyphBakeDestroy(hudBake);
+               std::vector<Uint32> hudGlyphs;
+               glyphSetAddRange(hudGlyphs, 0x20, 0x7E);
+               glyphSetAddRange(hudGlyphs, 0xA0, 0xFF);
+               memoryTagSet(MEMORY_TAG_TTF);
+               hudBakeFont = TTF_OpenFontRW(assetOpen(pack, "sans.ttf"), 1, 20);
+               memoryTagSet(MEMORY_TAG_GENERAL);
+               if (hudBakeFont == nullptr || !glyphBakeStart(hudBake, hudBakeFont, hudGlyphs, 512))
+               {
+                    glyphBakeDestroy(hudBake);
+                    if (hudBakeFont != nullptr)
+                    {
+                         TTF_CloseFont(hudBakeFont);
+                         hudBakeFont = nullptr;
+                    }
+               }
+          }
+     }
+
+     // The menu title scales freely from one distance field rasterization
+     SdfFace titleFace;
+     bool hasTitleFace = sdfFaceOpen(titleFace, "sans.ttf", 48, &glyphCache);
+
+     // Menu instructions are wrapped once and replayed every frame
+     TextLayout helpLayout;
+     if (hudFontId >= 0)
+     {
+          textLayoutInit(helpLayout, &glyphCache, hudFontId, 420);
+          textLayoutSetText(helpLayout, "Move the paddle with the mouse or the arrow keys and catch the falling "
+                                        "blocks. Five misses end the game.\n"
+                                        "F3 toggles the frame-time overlay, F4 saves a frame-time capture, "
+                                        "F5 saves a screenshot, F6 toggles the event log, F7 captures frames.");
+     }
+
+     // Optional animated menu backdrop, decoded a few frames ahead of playback
+     AnimationStream menuBackground;
+     bool hasMenuBackground = false;
+     SDL_RWops *backgroundProbe = SDL_RWFromFile("menu_background.gif", "rb");
+     if (backgroundProbe != nullptr)
+     {
+          SDL_RWclose(backgroundProbe);
+          hasMenuBackground = animationStreamOpen(menuBackground, renderer, "menu_background.gif", 4, true);
+     }
+     // Otherwise a still DDS backdrop; uncompressed layouts the renderer
+     // accepts upload straight from the file with no decode
+     SDL_Texture *menuStill = nullptr;
+     SDL_RWops *stillFile = hasMenuBackground ? nullptr : assetOpen(pack, "menu_background.dds");
+     if (stillFile != nullptr)
+     {
+          menuStill = ddsLoadTexture(renderer, stillFile, 1);
+          if (menuStill == nullptr)
+          {
+               std::cerr << "Unable to load menu_background.dds! SDL Error: " << SDL_GetError() << std::endl;
+          }
+     }
+
+     // One worker pool for every subsystem that splits work into jobs,
+     // such as screenshot conversion and scaling (F5)
+     JobSystem jobs;
+     bool hasJobs = jobSystemInit(jobs, 0);
+     // A lost device (SDL_RENDER_DEVICE_RESET) brings the atlas back from
+     // the asset cache or a compressed copy instead of the PNGs
+     TextureRestore textureRestore;
+     textureRestoreInit(textureRestore, renderer, hasJobs ? &jobs : nullptr);
+     const TextureRestoreRemap remapAtlas = [](void *atlas, SDL_Texture *from, SDL_Texture *to)
+     { atlasReplaceTexture(*(TextureAtlas *)atlas, from, to); };
+     for (size_t i = 0; atlasCached && i < atlas.pages.size(); i++)
+     {
+          textureRestoreRetainFile(textureRestore, atlas.pages[i], assetCacheAtlasPagePath(assetCache, atlasKey, (int)i),
+                                   atlasKey, remapAtlas, &atlas);
+     }
+     // Recycles screenshot surfaces, so repeated captures reuse their buffers
+     SurfacePool surfacePool;
+     surfacePoolInit(surfacePool);
+     ImageWriter imageWriter;
+     if (!imageWriterStart(imageWriter, hasJobs ? &jobs : nullptr, &surfacePool))
+     {
+          std::cerr << "Could not start the image writer! SDL_Error: " << SDL_GetError() << std::endl;
+     }
+     bool screenshotRequested = false;
+     // Screenshots and F7 captures are read back a frame or two later
+     // instead of stalling the GPU
+     FrameReadback frameReadback;
+     frameReadbackInit(frameReadback, renderer, surfacePool);
+     CaptureSink captureSink = {hasJobs ? &jobs : nullptr, &surfacePool, &imageWriter};
+     int captureFrame = 0; // Frames captured so far while F7 capture runs, 0 when off
+     // F8 records video to capture.y4m: readback, YUV conversion on the
+     // jobs and the file writes all stay off the frame
+     VideoY4m videoFile;
+     VideoCapture videoCapture;
+     bool recordingVideo = false;
+
+     // Frame-time profiler and its on-screen readout (F3)
+     Profiler profiler;
+     profilerInit(profiler);
+     ProfilerOverlay profilerOverlay;
+     profilerOverlayInit(profilerOverlay, &glyphCache, debugFontId);
+     LineBatch overlayLines; // The overlay's frame-time graph, over the queue
+     lineBatchInit(overlayLines, 1.0f, PROFILER_GRAPH_FRAMES + 2);
+     GpuTimer gpuTimer;
+     gpuTimerInit(gpuTimer, renderer);
+     int gpuRenderRegion = gpuTimerAddRegion(gpuTimer, "render");
+
+     // Vsync paces animated frames, or the pacer's own deadlines at the
+     // display's refresh rate without it; static screens sleep until input
+     FramePacer framePacer;
+     framePacerInit(framePacer, window, hasVsync);
+
+     // Runs lighter on battery and when the CPU is hot or throttled. The
+     // benchmark always runs the full profile, so runs compare
+     PowerGovernor powerGovernor;
+     powerGovernorInit(powerGovernor, powerGovernorDefaultConfig());
+     int sparksPerCatch = SPARKS_PER_CATCH;
+     if (!headless)
+     {
+          applyPowerSettings(powerGovernorSettings(powerGovernor), framePacer, voiceManager, hasJobs ? &jobs : nullptr,
+                             sparksPerCatch);
+          std::cout << "Power profile: " << powerProfileName(powerGovernor.profile) << " ("
+                    << powerReasonName(powerGovernor.reason) << ")" << std::endl;
+     }
+
+     // SDL_Log output is written by its own thread from here on, so a slow
+     // console does not stall the frame that logged
+     if (!asyncLogStart())
+     {
+          std::cerr << "Could not start the log thread! SDL_Error: " << SDL_GetError() << std::endl;
+     }
+
+     // Catches and misses are counted and logged as one line a second
+     GameLog gameLog;
+     gameLogInit(gameLog, &glyphCache, debugFontId);
+     const int caughtEvent = gameLogAddEvent(gameLog, "caught");
+     const int missedEvent = gameLogAddEvent(gameLog, "missed");
+
+     // Periodic loop work is due off one wheel in milliseconds rather than
+     // each task reading the clock every frame. Both timers share a callback
+     // that only raises a flag, so the work itself runs at a fixed point in
+     // the frame
+     TimerWheel loopTimers;
+     timerWheelInit(loopTimers, SDL_GetTicks64(), 16);
+     bool logSummaryDue = false;
+     bool powerPollDue = false;
+     timerWheelAdd(loopTimers, gameLog.summaryMs, raiseTimerFlags, nullptr, &logSummaryDue, gameLog.summaryMs);
+     if (!headless)
+     {
+          timerWheelAdd(loopTimers, powerGovernor.config.pollMs, raiseTimerFlags, nullptr, &powerPollDue,
+                        powerGovernor.config.pollMs);
+     }
 
      // --- 3. Game Loop ---
 
      bool isRunning = true;
-     SDL_Event event;
+     EventBatch inputEvents;
+     eventBatchInit(inputEvents, 256);
+     if (SDL_GetHintBoolean(MOTION_COALESCE_HINT, SDL_FALSE))
+     {
+          eventBatchSetMotionFilter(inputEvents, true);
+     }
+     InputThread inputThread;
+     const bool hasInputThread = SDL_GetHintBoolean(INPUT_THREAD_HINT, SDL_FALSE) && inputThreadStart(inputThread);
+     TimedInputEvent timedInput[64];
+
+     // Game controllers come up on a thread of their own (controller_hotplug.h).
+     // The input thread, when running, already updates joysticks at 1 kHz,
+     // so the hotplug thread then only has to notice arrivals
+     MappingDb controllerMappings = {};
+     SDL_RWops *mappingProbe = headless ? nullptr : SDL_RWFromFile("controllers.gcdb", "rb");
+     const bool hasMappings = mappingProbe != nullptr && SDL_RWclose(mappingProbe) == 0 &&
+                              mappingDbOpen(controllerMappings, "controllers.gcdb");
+     ControllerHotplug controllerHotplug;
+     const bool hasControllers =
+         !headless && controllerHotplugStart(controllerHotplug, "Catch", "Catch", hasInputThread ? 20 : 250,
+                                             hasMappings ? &controllerMappings : nullptr);
+     std::vector<SDL_GameController *> controllers;
+     PadInput padInput = {0.0f, false, false};
+
+     const double counterFrequency = (double)SDL_GetPerformanceFrequency();
+     Uint64 previousCounter = SDL_GetPerformanceCounter();
+     const Uint64 startCounter = previousCounter;
+     int benchFramesRun = 0;   // Frames played so far by --bench
+     Uint64 loadedCounter = 0; // When the loading screen ended
+     bool firstFramePresented = false;
+     double accumulator = 0.0;
 
      while (isRunning)
      {
+          // --- Frame Timing ---
+          Uint64 currentCounter = SDL_GetPerformanceCounter();
+          double frameSeconds = (currentCounter - previousCounter) / counterFrequency;
+          previousCounter = currentCounter;
+          if (frameSeconds > MAX_FRAME_SECONDS)
+          {
+               frameSeconds = MAX_FRAME_SECONDS;
+          }
+          accumulator += frameSeconds;
+
+          profilerBeginFrame(profiler);
+          profilerBeginPhase(profiler, PROFILE_INPUT);
+
+          // --- Asset Loading ---
+          if (sim.state == LOADING)
+          {
+               loadedAssets.clear();
+               assetLoaderCollect(assetLoader, loadedAssets);
+               for (AssetResult &result : loadedAssets)
+               {
+                    if (!result.error.empty())
+                    {
+                         std::cerr << "Unable to load " << result.path << "! Error: " << result.error << std::endl;
+                         assetsFailed = true;
+                    }
+                    else if (result.type == ASSET_IMAGE)
+                    {
+                         assetsFailed = !atlasBuilderAddSurface(atlasBuilder, result.name, result.surface) || assetsFailed;
+                    }
+                    else if (result.type == ASSET_MUSIC)
+                    {
+                         backgroundMusic = result.music;
+                    }
+               }
+
+               if (assetLoaderDone(assetLoader))
+               {
+                    assetLoaderStop(assetLoader);
+                    symbolUsageSave(startupUsage);
+
+                    // Texture upload has to happen here, on the render thread
+                    std::vector<SDL_Surface *> atlasPages;
+                    if (!assetsFailed && !atlasCached && atlasBuild(atlasBuilder, renderer, atlas, &atlasPages))
+                    {
+                         if (hasAtlasKey)
+                         {
+                              assetCacheStoreAtlas(assetCache, atlasKey, atlas, atlasPages);
+                              assetCacheTrim(assetCache);
+                         }
+                         // The cache holds the pages cropped, so keep a copy
+                         // of the pages as uploaded
+                         for (size_t i = 0; i < atlasPages.size(); i++)
+                         {
+                              textureRestoreRetainPixels(textureRestore, atlas.pages[i], atlasPages[i], remapAtlas, &atlas);
+                         }
+                    }
+                    for (SDL_Surface *page : atlasPages)
+                    {
+                         SDL_FreeSurface(page);
+                    }
+                    if (!assetsFailed)
+                    {
+                         playButtonSprite = atlasFind(atlas, "play_button");
+                         gameOverSprite = atlasFind(atlas, "game_over");
+                    }
+                    if (assetsFailed || playButtonSprite == nullptr || gameOverSprite == nullptr)
+                    {
+                         std::cerr << "Failed to load one or more assets. Make sure they are in the correct directory." << std::endl;
+                         exitCode = 1;
+                         isRunning = false;
+                    }
+                    else
+                    {
+                         loadedCounter = SDL_GetPerformanceCounter();
+                         startupTraceMark(startupTrace, "assets loaded");
+                         startupTraceReport(startupTrace);
+                         // A benchmark has nobody to press play
+                         sim.state = benchFrames > 0 ? PLAYING : MENU;
+                    }
+               }
+          }
+
           // --- Event Handling ---
-          while (SDL_PollEvent(&event) != 0)
+          windowResizeUpdate(windowResize);
+          // Only the latest mouse position matters to the paddle
+          eventBatchDrain(inputEvents);
+          eventBatchCoalesceMotion(inputEvents);
+          if (!inputLogEvents(inputLog, inputEvents, sim.state != LOADING))
+          {
+               isRunning = false; // The replay is over
+          }
+          for (int i = 0; i < inputEvents.count; i++)
           {
+               const SDL_Event &event = inputEvents.events[i];
+               if (hasControllers && event.type == controllerHotplugEventType())
+               {
+                    controllerNoticeHandle(inputEvents.events[i], controllers, padInput);
+                    continue;
+               }
+               padInputHandleEvent(padInput, event);
+               dirtyRegionsHandleEvent(screenRegions, event);
+               textureRestoreHandleEvent(textureRestore, event);
+               framePacerHandleEvent(framePacer, event);
                if (event.type == SDL_QUIT)
                {
                     isRunning = false;
@@ -224,131 +1307,800 @@ int main(int argc, char *args[])
                     {
                          isRunning = false;
                     }
+                    if (event.key.keysym.sym == SDLK_F3)
+                    {
+                         profilerOverlay.visible = !profilerOverlay.visible;
+                         dirtyRegionsInvalidateAll(screenRegions);
+                    }
+                    if (event.key.keysym.sym == SDLK_F6)
+                    {
+                         gameLog.visible = !gameLog.visible;
+                         dirtyRegionsInvalidateAll(screenRegions);
+                    }
+                    if (event.key.keysym.sym == SDLK_F4)
+                    {
+                         profilerWriteCsv(profiler, "frame_times.csv");
+                         profilerWriteChromeTrace(profiler, "frame_trace.json");
+                    }
+                    if (event.key.keysym.sym == SDLK_F7)
+                    {
+                         captureFrame = captureFrame > 0 ? 0 : 1;
+                         std::cout << (captureFrame > 0 ? "Capturing frames to capture_NNNNN.qoi" : "Capture stopped")
+                                   << std::endl;
+                    }
+                    if (event.key.keysym.sym == SDLK_F8)
+                    {
+                         if (recordingVideo)
+                         {
+                              videoCaptureStop(videoCapture);
+                              std::cout << "Video capture stopped: " << videoCapture.encoded << " frames, "
+                                        << videoCapture.dropped << " dropped, " << videoFile.rescaled << " rescaled"
+                                        << std::endl;
+                              recordingVideo = false;
+                         }
+                         else if (videoY4mOpen(videoFile, "capture.y4m", measuredPresentHz(framePacer)) &&
+                                  videoCaptureStart(videoCapture, frameReadback, surfacePool, hasJobs ? &jobs : nullptr,
+                                                    videoY4mEncoder(videoFile)))
+                         {
+                              recordingVideo = true;
+                         }
+                         else
+                         {
+                              std::cerr << "Unable to record capture.y4m! SDL Error: " << SDL_GetError() << std::endl;
+                              if (videoFile.file != nullptr)
+                              {
+                                   SDL_RWclose(videoFile.file);
+                              }
+                         }
+                    }
+                    if (event.key.keysym.sym == SDLK_F9 && sim.state == PLAYING)
+                    {
+                         // What a netplay correction does before simulating forward again
+                         const Uint64 start = SDL_GetPerformanceCounter();
+                         const Uint32 rolledFrom = sim.tick;
+                         const Uint32 target = sim.tick - ROLLBACK_TICKS;
+                         if (snapshotRingRestore(rollback, target))
+                         {
+                              replayUntil = SDL_max(replayUntil, rolledFrom);
+                              const double us = (double)(SDL_GetPerformanceCounter() - start) * 1e6 /
+                                                SDL_GetPerformanceFrequency();
+                              gameLogLine(gameLog, "Rolled back %d ticks in %.0f us", ROLLBACK_TICKS, us);
+                         }
+                    }
+                    if (event.key.keysym.sym == SDLK_F5)
+                    {
+                         // The capture reads back a drawn frame
+                         screenshotRequested = true;
+                         dirtyRegionsInvalidateAll(screenRegions);
+                    }
                }
                // Handle mouse clicks for the menu
                if (event.type == SDL_MOUSEBUTTONDOWN)
                {
-                    if (currentState == MENU)
+                    if (sim.state == MENU)
                     {
-                         int mouseX, mouseY;
-                         SDL_GetMouseState(&mouseX, &mouseY);
-                         SDL_Point mousePoint = {mouseX, mouseY};
+                         // The event's own position, so a replayed click lands where it did
+                         SDL_Point mousePoint = {event.button.x, event.button.y};
                          if (SDL_PointInRect(&mousePoint, &playButtonRect))
                          {
-                              currentState = PLAYING;
+                              sim.state = PLAYING;
+                              particleEmitterClear(sparks);
                               // Start music when game starts
-                              Mix_PlayMusic(backgroundMusic, -1);
+                              MusicDecoder decoder;
+                              if (!hasMusicStream ||
+                                  !musicDecoderOpenWav(decoder, "background_music.wav", musicStreamSpec(musicStream)) ||
+                                  !musicStreamPlay(musicStream, decoder, true))
+                              {
+                                   Mix_PlayMusic(backgroundMusic, -1);
+                              }
+                              if (hasAmbience)
+                              {
+                                   streamedSoundFadeIn(ambience, AMBIENCE_CHANNEL, -1, 1000);
+                              }
                          }
                     }
                }
                // Handle mouse movement for the paddle
                if (event.type == SDL_MOUSEMOTION)
                {
-                    if (currentState == PLAYING)
+                    SDL_Point mousePoint = {event.motion.x, event.motion.y};
+                    overPlayButton = sim.state == MENU && SDL_PointInRect(&mousePoint, &playButtonRect);
+                    if (sim.state == PLAYING)
                     {
-                         player.rect.x = event.motion.x - (player.rect.w / 2);
+                         sim.player.rect.x = event.motion.x - (sim.player.rect.w / 2);
+                         paddleFollowsMouse = true;
                     }
                }
           }
+          if (!headless)
+          {
+               cursorCacheShow(cursors, overPlayButton && sim.state == MENU ? handCursor : nullptr, sim.state != PLAYING);
+          }
 
-          // --- KEYBOARD INPUT ---
-          const Uint8 *currentKeyStates = SDL_GetKeyboardState(NULL);
-          if (currentState == PLAYING)
+          // The timestamped copies only measure latency: how long the
+          // oldest input this frame simulates has been waiting
+          if (hasInputThread)
           {
-               if (currentKeyStates[SDL_SCANCODE_LEFT])
-               {
-                    player.rect.x -= PADDLE_SPEED;
-               }
-               if (currentKeyStates[SDL_SCANCODE_RIGHT])
+               Uint64 oldest = 0;
+               int drained;
+               while ((drained = inputThreadDrain(inputThread, timedInput, SDL_arraysize(timedInput))) > 0)
                {
-                    player.rect.x += PADDLE_SPEED;
+                    oldest = oldest != 0 ? oldest : timedInput[0].counter;
                }
+               const Uint64 age = oldest != 0 ? SDL_GetPerformanceCounter() - oldest : 0;
+               profilerSetCounter(profiler, PROFILE_INPUT_AGE_US, (Sint64)(age * 1000000.0 / counterFrequency));
           }
 
-          // --- Game Logic (Only runs if we are in the PLAYING state) ---
-          if (currentState == PLAYING)
+          profilerEndPhase(profiler, PROFILE_INPUT);
+
+          // --- Simulation Ticks ---
+          profilerBeginPhase(profiler, PROFILE_UPDATE);
+          int ticks = 0;
+          while (accumulator >= TICK_SECONDS && ticks < MAX_TICKS_PER_FRAME)
           {
-               // Keep paddle within screen bounds
-               if (player.rect.x < 0)
-               {
-                    player.rect.x = 0;
-               }
-               if (player.rect.x > SCREEN_WIDTH - player.rect.w)
-               {
-                    player.rect.x = SCREEN_WIDTH - player.rect.w;
-               }
+               accumulator -= TICK_SECONDS;
+               ticks++;
+          }
+
+          // An overloaded machine drops the backlog instead of spiralling:
+          // the game slows down for a moment rather than freezing
+          if (ticks == MAX_TICKS_PER_FRAME && accumulator >= TICK_SECONDS)
+          {
+               accumulator = 0.0;
+          }
+
+          // Fraction of the way from the previous tick to the next one
+          float alpha = (float)(accumulator / TICK_SECONDS);
+
+          // A benchmark runs unpaced, so it steps one tick per frame to play
+          // the same game at any speed
+          if (benchFrames > 0)
+          {
+               ticks = 1;
+               alpha = 0.0f;
+               accumulator = 0.0;
+          }
 
-               // Move the block down
-               block.rect.y += BLOCK_SPEED;
+          // Recorded, or replaced by the recording when replaying
+          inputLogTicks(inputLog, ticks, alpha);
+
+          for (int tick = 0; tick < ticks; tick++)
+          {
+               sim.player.prevRect = sim.player.rect;
 
-               // Check for collision between paddle and block
-               if (SDL_HasIntersection(&player.rect, &block.rect))
+               // --- KEYBOARD INPUT ---
+               const Uint8 *currentKeyStates = inputLogKeyboardState(inputLog);
+               if (sim.state == PLAYING)
                {
-                    std::cout << "Caught it!" << std::endl;
-                    block.rect.y = 0;
-                    block.rect.x = rand() % (SCREEN_WIDTH - BLOCK_SIZE);
+                    if (currentKeyStates[SDL_SCANCODE_LEFT])
+                    {
+                         sim.player.rect.x -= PADDLE_SPEED;
+                         paddleFollowsMouse = false;
+                    }
+                    if (currentKeyStates[SDL_SCANCODE_RIGHT])
+                    {
+                         sim.player.rect.x += PADDLE_SPEED;
+                         paddleFollowsMouse = false;
+                    }
+                    // Full deflection moves as fast as the keys
+                    const float pad = padInput.stickX + (padInput.right ? 1.0f : 0.0f) - (padInput.left ? 1.0f : 0.0f);
+                    if (pad != 0.0f)
+                    {
+                         sim.player.rect.x += (int)SDL_lroundf(SDL_clamp(pad, -1.0f, 1.0f) * PADDLE_SPEED);
+                         paddleFollowsMouse = false;
+                    }
                }
 
-               // Check if block missed the paddle and hit the bottom
-               if (block.rect.y > SCREEN_HEIGHT)
+               // --- Game Logic (Only runs if we are in the PLAYING state) ---
+               if (sim.state == PLAYING)
                {
-                    mistakes++;
-                    std::cout << "Missed! Mistakes: " << mistakes << std::endl;
-                    block.rect.y = 0;
-                    block.rect.x = rand() % (SCREEN_WIDTH - BLOCK_SIZE);
+                    // A tick played again after F9 changes the state only
+                    const bool replaying = sim.tick < replayUntil;
+
+                    // A benchmark keeps playing by parking the paddle under the lowest block
+                    if (benchFrames > 0)
+                    {
+                         int lowest = -1;
+                         for (int i = 0; i < blocks.highWater; i++)
+                         {
+                              if (blocks.alive[i] && (lowest < 0 || blocks.y[i] > blocks.y[lowest]))
+                              {
+                                   lowest = i;
+                              }
+                         }
+                         if (lowest >= 0)
+                         {
+                              sim.player.rect.x = (int)blocks.x[lowest] + BLOCK_SIZE / 2 - sim.player.rect.w / 2;
+                         }
+                    }
+
+                    // Keep paddle within screen bounds
+                    if (sim.player.rect.x < 0)
+                    {
+                         sim.player.rect.x = 0;
+                    }
+                    if (sim.player.rect.x > SCREEN_WIDTH - sim.player.rect.w)
+                    {
+                         sim.player.rect.x = SCREEN_WIDTH - sim.player.rect.w;
+                    }
+
+                    // Drop a new block in at a fixed cadence
+                    if (--sim.ticksUntilSpawn <= 0)
+                    {
+                         blockPoolSpawn(blocks, (float)randomStreamRange(sim.random, SCREEN_WIDTH - BLOCK_SIZE), 0.0f,
+                                        (float)BLOCK_SPEED);
+                         sim.ticksUntilSpawn = SPAWN_INTERVAL_TICKS;
+                    }
+
+                    // Move every block down and refile the ones that changed cell
+                    blockPoolIntegrate(blocks);
+                    for (int i = 0; i < blocks.highWater; i++)
+                    {
+                         if (blocks.alive[i])
+                         {
+                              SDL_FRect bounds = {blocks.x[i], blocks.y[i], (float)BLOCK_SIZE, (float)BLOCK_SIZE};
+                              spatialGridUpdate(blockGrid, i, bounds);
+                         }
+                    }
 
-                    if (mistakes >= MAX_MISTAKES)
+                    // Sweep every block against the paddle over the tick, so a block
+                    // falling further than the paddle is thick still counts
+                    SDL_FRect paddleFrom = {(float)sim.player.prevRect.x, (float)sim.player.prevRect.y,
+                                            (float)sim.player.prevRect.w, (float)sim.player.prevRect.h};
+                    SDL_FRect paddleBounds = {(float)sim.player.rect.x, (float)sim.player.rect.y,
+                                              (float)sim.player.rect.w, (float)sim.player.rect.h};
+                    hits.resize(blocks.highWater);
+                    catchTimes.resize(blocks.highWater);
+                    hits.resize(sweepRects(blocks.x.data(), blocks.prevY.data(), blocks.x.data(), blocks.y.data(),
+                                           blocks.alive.data(), blocks.highWater, (float)BLOCK_SIZE, (float)BLOCK_SIZE,
+                                           paddleFrom, paddleBounds, hits.data(), catchTimes.data()));
+                    for (size_t h = 0; h < hits.size(); h++)
                     {
-                         std::cout << "GAME OVER!" << std::endl;
-                         currentState = GAME_OVER;
-                         Mix_HaltMusic(); // Stop the music on game over
+                         const int id = hits[h];
+                         sim.caught++;
+                         const float sparkX = blocks.x[id] + BLOCK_SIZE / 2.0f;
+                         spatialGridRemove(blockGrid, id);
+                         blockPoolDespawn(blocks, id);
+                         if (replaying)
+                         {
+                              continue;
+                         }
+                         gameLogCount(gameLog, caughtEvent);
+                         if (hasVoiceMixer)
+                         {
+                              // Pan the blip toward the side of the screen it happened on,
+                              // where the paddle was at the moment of impact
+                              float impactX = paddleFrom.x + (paddleBounds.x - paddleFrom.x) * catchTimes[h];
+                              int right = (int)(impactX + paddleBounds.w / 2) * 255 / SCREEN_WIDTH;
+                              right = SDL_clamp(right, 0, 255);
+                              voiceMixerPlay(voiceMixer, catchChunk, 0, (Uint8)(255 - right), (Uint8)right);
+                         }
+                         particleEmitterBurst(sparks, sparkX, paddleBounds.y, sparksPerCatch);
                     }
+                    particleEmitterUpdate(sparks, (float)TICK_SECONDS);
+
+                    // Check for blocks that missed the paddle and fell off the bottom:
+                    // a block overlaps this strip once its top edge passes SCREEN_HEIGHT
+                    SDL_FRect belowScreen = {0.0f, (float)(SCREEN_HEIGHT + BLOCK_SIZE), (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT};
+                    hits.clear();
+                    spatialGridQueryRect(blockGrid, belowScreen, hits);
+                    for (int id : hits)
+                    {
+                         sim.mistakes++;
+                         if (!replaying)
+                         {
+                              gameLogCount(gameLog, missedEvent);
+                         }
+                         if (hasSynth && !replaying)
+                         {
+                              SoundRequest missRequest = soundRequestDefaults(&synth.carrier);
+                              missRequest.priority = VOICE_PRIORITY_LEVELS - 1;
+                              missRequest.loops = -1; // Until the synth voice ends
+                              int missChannel = voiceManagerPlay(voiceManager, missRequest);
+                              if (missChannel >= 0 && synthAttach(synth, missPatch, missChannel) < 0)
+                              {
+                                   Mix_HaltChannel(missChannel);
+                              }
+                         }
+                         spatialGridRemove(blockGrid, id);
+                         blockPoolDespawn(blocks, id);
+
+                         if (sim.mistakes >= MAX_MISTAKES)
+                         {
+                              gameLogLine(gameLog, "GAME OVER! Caught %d, missed %d", sim.caught, sim.mistakes);
+                              sim.state = GAME_OVER;
+                              // Sparks stop with the game, not in mid-air for the next one
+                              particleEmitterClear(sparks);
+                              // Stop the music on game over
+                              musicStreamStop(musicStream);
+                              Mix_HaltMusic();
+                              if (hasAmbience)
+                              {
+                                   Mix_FadeOutChannel(AMBIENCE_CHANNEL, 500);
+                              }
+                              break;
+                         }
+                    }
+
+                    sim.tick++;
+                    snapshotRingSave(rollback, sim.tick);
                }
           }
 
+          profilerEndPhase(profiler, PROFILE_UPDATE);
+
           // --- Rendering ---
-          SDL_SetRenderDrawColor(renderer, 33, 33, 33, 255);
-          SDL_RenderClear(renderer);
+          profilerBeginPhase(profiler, PROFILE_RENDER);
+          // Renderer work that jobs handed back to the main thread
+          jobSystemRunMainThreadJobs(jobs);
+          // Textures shown again after a device reset change the screen
+          if (textureRestoreUpdate(textureRestore) > 0)
+          {
+               dirtyRegionsInvalidateAll(screenRegions);
+          }
 
-          switch (currentState)
+          // Drawing below only queues; what changed decides what is submitted
+          if (sim.state != drawnState)
+          {
+               dirtyRegionsInvalidateAll(screenRegions);
+               drawnState = sim.state;
+          }
+          if (sim.state == LOADING || sim.state == PLAYING || profilerOverlay.visible || gameLog.visible)
+          {
+               dirtyRegionsInvalidateAll(screenRegions);
+          }
+
+          switch (sim.state)
+          {
+          case LOADING:
           {
+               // Progress bar in the middle of the screen
+               const SDL_Color trackColor = {60, 60, 60, 255};
+               const SDL_Color fillColor = {100, 180, 255, 255};
+               SDL_FRect track = {SCREEN_WIDTH / 2.0f - 200.0f, SCREEN_HEIGHT / 2.0f - 10.0f, 400.0f, 20.0f};
+               SDL_FRect fill = track;
+               fill.w = loadingProgress.total > 0 ? track.w * loadingProgress.completed / loadingProgress.total : 0.0f;
+               renderQueueSetLayer(renderQueue, LAYER_HUD);
+               renderQueueFillRect(renderQueue, track, trackColor);
+               renderQueueSetLayer(renderQueue, LAYER_HUD, 1);
+               renderQueueFillRect(renderQueue, fill, fillColor);
+               break;
+          }
           case MENU:
-               SDL_RenderCopy(renderer, playButtonTexture, NULL, &playButtonRect);
+          {
+               if (hasMenuBackground)
+               {
+                    animationStreamUpdate(menuBackground, (float)(frameSeconds * 1000.0));
+                    SDL_Texture *backgroundTexture = animationStreamTexture(menuBackground);
+                    if (backgroundTexture != drawnBackground)
+                    {
+                         // Each upload lands in the next texture of the ring
+                         dirtyRegionsInvalidateAll(screenRegions);
+                         drawnBackground = backgroundTexture;
+                    }
+                    if (backgroundTexture != nullptr)
+                    {
+                         SDL_FRect backgroundRect = {0.0f, 0.0f, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT};
+                         renderQueueSetLayer(renderQueue, LAYER_BACKGROUND);
+                         renderQueueCopy(renderQueue, backgroundTexture, nullptr, backgroundRect);
+                    }
+               }
+               else if (menuStill != nullptr)
+               {
+                    SDL_FRect backgroundRect = {0.0f, 0.0f, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT};
+                    renderQueueSetLayer(renderQueue, LAYER_BACKGROUND);
+                    renderQueueCopy(renderQueue, menuStill, nullptr, backgroundRect);
+               }
+
+               SDL_FRect buttonDrawRect = {(float)playButtonRect.x, (float)playButtonRect.y,
+                                           (float)playButtonRect.w, (float)playButtonRect.h};
+               renderQueueSetLayer(renderQueue, LAYER_HUD);
+               renderQueueCopy(renderQueue, playButtonSprite->texture, &playButtonSprite->src, buttonDrawRect);
+               textureRestoreTouch(textureRestore, playButtonSprite->texture);
+
+               if (hasTitleFace)
+               {
+                    const char *title = "Catch the Block";
+                    const SDL_Color titleColor = {255, 220, 50, 255};
+                    int titleSize = 56 + (int)(8.0f * SDL_sinf(SDL_GetTicks() * 0.003f));
+                    int titleWidth = 0, titleHeight = 0;
+                    sdfFaceMeasure(titleFace, title, titleSize, &titleWidth, &titleHeight);
+                    sdfFaceDrawText(titleFace, renderQueue, title, (SCREEN_WIDTH - titleWidth) / 2.0f,
+                                    playButtonRect.y - 40.0f - titleHeight, titleSize, titleColor);
+                    if (titleSize != drawnTitleSize)
+                    {
+                         // The pulse only touches the title's old and new bounds
+                         SDL_Rect titleRect = {(SCREEN_WIDTH - titleWidth) / 2 - 1, playButtonRect.y - 41 - titleHeight,
+                                               titleWidth + 2, titleHeight + 2};
+                         dirtyRegionsInvalidate(screenRegions, drawnTitleRect);
+                         dirtyRegionsInvalidate(screenRegions, titleRect);
+                         drawnTitleRect = titleRect;
+                         drawnTitleSize = titleSize;
+                    }
+               }
+               if (hudFontId >= 0)
+               {
+                    const SDL_Color helpColor = {200, 200, 200, 255};
+                    textLayoutDraw(helpLayout, renderQueue, (SCREEN_WIDTH - helpLayout.width) / 2.0f,
+                                   playButtonRect.y + playButtonRect.h + 30.0f, helpColor, nullptr);
+               }
                break;
+          }
           case PLAYING:
-               SDL_SetRenderDrawColor(renderer, 100, 180, 255, 255);
-               SDL_RenderFillRect(renderer, &player.rect);
+          {
+               const SDL_Color paddleColor = {100, 180, 255, 255};
 
-               SDL_SetRenderDrawColor(renderer, 255, 220, 50, 255);
-               SDL_RenderFillRect(renderer, &block.rect);
-               break;
+               renderQueueSetLayer(renderQueue, LAYER_WORLD);
+               paddleLatch.enabled = paddleFollowsMouse && !headless;
+               lateLatchBegin(paddleLatch, renderQueue);
+               renderQueueFillRect(renderQueue, interpolateRect(sim.player.prevRect, sim.player.rect, alpha), paddleColor);
+               const SDL_FRect paddleBounds = {0.0f, 0.0f, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT};
+               lateLatchEnd(paddleLatch, renderQueue, -sim.player.rect.w / 2.0f, 0.0f, paddleBounds, LATE_LATCH_X);
 
+               // Crowded fields are recorded across the job system, merged in slot order
+               BlockDrawJob blockDraw = {&blocks, alpha};
+               renderQueueRecordParallel(renderQueue, hasJobs ? &jobs : nullptr, blockParts, blocks.highWater,
+                                         recordBlocks, &blockDraw);
+
+               if (hudFontId >= 0)
+               {
+                    // Formatted and decoded only when the score changes
+                    if (sim.caught != hudCaught || sim.mistakes != hudMistakes)
+                    {
+                         char hudText[64];
+                         SDL_snprintf(hudText, sizeof(hudText), "Caught: %d   Missed: %d/%d", sim.caught, sim.mistakes,
+                                      MAX_MISTAKES);
+                         utfDecode(hudText, hudCodepoints);
+                         hudCaught = sim.caught;
+                         hudMistakes = sim.mistakes;
+                    }
+                    int hudWidth;
+                    glyphCacheMeasureCodepoints(glyphCache, hudFontId, hudCodepoints.data(), hudCodepoints.size(), &hudWidth,
+                                                NULL);
+                    const SDL_Color hudColor = {230, 230, 230, 255};
+                    renderQueueSetLayer(renderQueue, LAYER_HUD);
+                    glyphCacheDrawCodepoints(glyphCache, renderQueue, hudFontId, hudCodepoints.data(), hudCodepoints.size(),
+                                             SCREEN_WIDTH - hudWidth - 12.0f, 8.0f, hudColor);
+               }
+               else if (hasFallbackText)
+               {
+                    // Queued here, drawn over the world after the flush
+                    char hudText[64];
+                    const int length = SDL_snprintf(hudText, sizeof(hudText), "Caught: %d   Missed: %d/%d", sim.caught,
+                                                    sim.mistakes, MAX_MISTAKES);
+                    debugTextDraw(fallbackText, SCREEN_WIDTH - length * FONT_CHARACTER_SIZE * 2.0f - 12.0f, 8.0f, hudText,
+                                  SDL_Color{230, 230, 230, 255}, 2.0f);
+               }
+               break;
+          }
           case GAME_OVER:
-               SDL_RenderCopy(renderer, gameOverTexture, NULL, NULL);
+          {
+               SDL_FRect screenRect = {0.0f, 0.0f, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT};
+               renderQueueSetLayer(renderQueue, LAYER_HUD);
+               renderQueueCopy(renderQueue, gameOverSprite->texture, &gameOverSprite->src, screenRect);
+               textureRestoreTouch(textureRestore, gameOverSprite->texture);
                break;
           }
+          }
 
-          SDL_RenderPresent(renderer);
-          SDL_Delay(16);
+          renderQueueSetLayer(renderQueue, LAYER_OVERLAY);
+          profilerOverlayDraw(profilerOverlay, profiler, renderQueue, 8.0f, 8.0f, &overlayLines);
+          timerWheelAdvance(loopTimers, SDL_GetTicks64());
+          if (logSummaryDue)
+          {
+               logSummaryDue = false;
+               gameLogFlush(gameLog);
+          }
+          gameLogDraw(gameLog, renderQueue, 8.0f, SCREEN_HEIGHT - 8.0f);
+          const SDL_Color clearColor = {33, 33, 33, 255};
+          if (captureFrame > 0 || recordingVideo)
+          {
+               dirtyRegionsInvalidateAll(screenRegions); // A capture wants every frame
+          }
+          // Read backs take the canvas, at the same size every frame
+          screenRegions.retain = screenshotRequested || captureFrame > 0 || recordingVideo;
+          bool presenting = dirtyRegionsBegin(screenRegions, clearColor);
+          if (presenting)
+          {
+               gpuTimerBegin(gpuTimer, gpuRenderRegion);
+               if (sim.state == PLAYING)
+               {
+                    // Behind the queued world: sparks rise from under the paddle
+                    particleEmitterDraw(sparks, renderer, renderQueue.arena);
+               }
+               lateLatchApply(paddleLatch, renderQueue); // The freshest pointer, as late as drawing allows
+               renderQueueFlush(renderQueue, renderer);
+               lineBatchFlush(overlayLines, renderer);
+               if (hasFallbackText)
+               {
+                    debugTextFlush(fallbackText);
+               }
+               if (screenshotRequested)
+               {
+                    if (!frameReadbackRequest(frameReadback, saveReadbackFrame, &captureSink))
+                    {
+                         std::cerr << "Unable to save screenshot! SDL Error: " << SDL_GetError() << std::endl;
+                    }
+                    screenshotRequested = false;
+               }
+               if (captureFrame > 0)
+               {
+                    frameReadbackRequest(frameReadback, saveReadbackFrame, &captureSink, captureFrame++);
+               }
+               if (recordingVideo)
+               {
+                    videoCaptureFrame(videoCapture);
+               }
+               dirtyRegionsEnd(screenRegions);
+               gpuTimerEnd(gpuTimer, gpuRenderRegion);
+          }
+          else
+          {
+               renderQueueClear(renderQueue);
+               lineBatchClear(overlayLines);
+               lateLatchClear(paddleLatch);
+               debugTextClear(fallbackText);
+          }
+          profilerEndPhase(profiler, PROFILE_RENDER);
+
+          profilerBeginPhase(profiler, PROFILE_PRESENT);
+          if (presenting)
+          {
+               renderRecordPresent(renderer);
+               framePacerPresented(framePacer);
+               if (!firstFramePresented)
+               {
+                    startupTraceMark(startupTrace, "first frame");
+                    firstFramePresented = true;
+               }
+               gpuTimerFrameEnd(gpuTimer);
+          }
+          frameReadbackCollect(frameReadback);
+          profilerEndPhase(profiler, PROFILE_PRESENT);
+          frameArenaEndFrame(frameArena);
+
+          // Renderer work of the frame just presented, for the overlay and F4
+          RenderStats renderStats = presenting ? renderRecordStats() : RenderStats{};
+          profilerSetCounter(profiler, PROFILE_DRAW_CALLS, renderStats.drawCalls);
+          profilerSetCounter(profiler, PROFILE_VERTICES, renderStats.vertices);
+          profilerSetCounter(profiler, PROFILE_TEXTURE_BINDS, renderStats.textureBinds);
+          profilerSetCounter(profiler, PROFILE_STATE_CHANGES, renderStats.stateCalls - renderStats.stateEliminated);
+          profilerSetCounter(profiler, PROFILE_UPLOAD_BYTES, renderStats.uploadBytes);
+          // GPU results lag a few frames, so report the smoothed value every frame
+          profilerSetCounter(profiler, PROFILE_GPU_MICROSECONDS,
+                             (Sint64)(gpuTimer.regions[gpuRenderRegion].averageMs * 1000.0));
+          const MemoryFrameStats frameMemory = memoryTagsEndFrame();
+          profilerSetCounter(profiler, PROFILE_ALLOCATIONS, frameMemory.allocations);
+          profilerSetCounter(profiler, PROFILE_ALLOCATED_BYTES, (Sint64)frameMemory.bytes);
+          profilerSetCounter(profiler, PROFILE_AUDIO_UNDERRUNS, audioDeviceUpdate(audioDevice));
+          profilerSetCounter(profiler, PROFILE_HINT_LOOKUPS, hintCacheEndFrame());
+          if (hasAmbience)
+          {
+               streamedSoundUpdate(ambience);
+          }
+          synthBankUpdate(synth);
+          audioBudgetUpdate(audioBudget);
+          if (powerPollDue)
+          {
+               powerPollDue = false;
+               if (powerGovernorUpdate(powerGovernor, SDL_GetTicks()))
+               {
+                    applyPowerSettings(powerGovernorSettings(powerGovernor), framePacer, voiceManager,
+                                       hasJobs ? &jobs : nullptr, sparksPerCatch);
+                    gameLogLine(gameLog, "Power profile: %s (%s)", powerProfileName(powerGovernor.profile),
+                                powerReasonName(powerGovernor.reason));
+               }
+          }
+          if (hudBakeFont != nullptr && glyphBakeDone(hudBake))
+          {
+               if (glyphBakeWait(hudBake) && glyphBakeApply(hudBake, glyphCache, hudFontId) &&
+                   !glyphBakeSave(hudBake, "hud.glyphs", hudBakeStamp))
+               {
+                    std::cerr << "Unable to save hud.glyphs! SDL Error: " << SDL_GetError() << std::endl;
+               }
+               glyphBakeDestroy(hudBake);
+               TTF_CloseFont(hudBakeFont);
+               hudBakeFont = nullptr;
+          }
+
+          // Give the CPU back when nothing else is pacing the loop. A screen
+          // that is not changing on its own blocks until the next event, and
+          // the time spent blocked is kept out of the simulation.
+          if (!headless)
+          {
+               const bool animating = sim.state == LOADING || sim.state == PLAYING || profilerOverlay.visible ||
+                                      gameLog.visible || (sim.state == MENU && (hasTitleFace || hasMenuBackground));
+               double elapsedSeconds = (SDL_GetPerformanceCounter() - previousCounter) / counterFrequency;
+               previousCounter += framePacerEndFrame(framePacer, presenting, animating,
+                                                     TICK_SECONDS - accumulator - elapsedSeconds);
+          }
+          else
+          {
+               framePacerYield();
+          }
+
+          profilerEndFrame(profiler);
+
+          if (benchFrames > 0 && sim.state != LOADING && ++benchFramesRun >= benchFrames)
+          {
+               isRunning = false;
+          }
+     }
+
+     if (headless)
+     {
+          // One line for scripts comparing builds on the same recording or bench run
+          ProfileStats stats;
+          profilerComputeStats(profiler, PROFILER_HISTORY, stats);
+          char summary[256];
+          SDL_snprintf(summary, sizeof(summary),
+                       "{\"frames\": %d, \"seconds\": %.3f, \"startup_ms\": %.1f, \"p50_ms\": %.3f, "
+                       "\"p99_ms\": %.3f, \"max_ms\": %.3f}",
+                       benchmarkReplay ? inputLog.frames : benchFramesRun,
+                       (SDL_GetPerformanceCounter() - startCounter) / counterFrequency,
+                       loadedCounter != 0 ? (loadedCounter - launchCounter) * 1000.0 / counterFrequency : 0.0,
+                       stats.p50, stats.p99, stats.max);
+          std::cout << summary << std::endl;
+     }
+
+     const FramePacerStats paceStats = framePacerGetStats(framePacer);
+     if (!headless && paceStats.presents > 0)
+     {
+          std::cout << "Frame pacing: " << paceStats.refreshHz << " Hz display, " << paceStats.targetMs
+                    << " ms target, " << paceStats.averageIntervalMs << " ms average, " << paceStats.jitterMs
+                    << " ms jitter, " << paceStats.latePresents << "/" << paceStats.presents << " late"
+                    << std::endl;
+     }
+     if (framePacer.idleFrames > 0)
+     {
+          std::cout << "Idle waits: " << framePacer.idleFrames << " frames, "
+                    << framePacer.idleTicks / counterFrequency << " s asleep" << std::endl;
      }
 
      // --- 4. Cleanup ---
+     inputLogClose(inputLog);
+     eventBatchSetMotionFilter(inputEvents, false);
+     if (hasInputThread)
+     {
+          inputThreadStop(inputThread);
+     }
+     for (SDL_GameController *controller : controllers)
+     {
+          SDL_GameControllerClose(controller);
+     }
+     if (hasControllers)
+     {
+          controllerHotplugStop(controllerHotplug);
+     }
+     if (hasMappings)
+     {
+          mappingDbClose(controllerMappings);
+     }
+     if (recordingVideo)
+     {
+          videoCaptureStop(videoCapture);
+     }
+     frameReadbackDestroy(frameReadback); // Hands the last readbacks to the writer
+     imageWriterStop(imageWriter); // Uses the job system for PNG strips
+     surfacePoolDestroy(surfacePool);
+     textureRestoreDestroy(textureRestore); // Waits for its decode jobs
+     jobSystemDestroy(jobs);
+     frameArenaDestroy(frameArena);
+     windowResizeQuit(windowResize);
+     logicalViewQuit(logicalView);
+     dirtyRegionsDestroy(screenRegions);
+     if (hasMenuBackground)
+     {
+          animationStreamClose(menuBackground);
+     }
+     if (menuStill != nullptr)
+     {
+          SDL_DestroyTexture(menuStill);
+     }
+     if (hasTitleFace)
+     {
+          sdfFaceClose(titleFace);
+     }
+     if (hudBakeFont != nullptr)
+     {
+          glyphBakeDestroy(hudBake);
+          TTF_CloseFont(hudBakeFont);
+     }
+     if (hasFallbackText)
+     {
+          debugTextDestroy(fallbackText);
+     }
+     glyphCacheDestroy(glyphCache);
+     if (hudFont != nullptr)
+     {
+          TTF_CloseFont(hudFont);
+     }
+     if (debugFont != nullptr)
+     {
+          TTF_CloseFont(debugFont);
+     }
+     if (hasVoiceCapture)
+     {
+          voiceCaptureStop(voiceCapture);
+          VoiceCaptureStats voiceStats = voiceCaptureGetStats(voiceCapture);
+          char summary[256];
+          SDL_snprintf(summary, sizeof(summary),
+                       "Voice capture: %d packets, device %.1f ms, queue %.1f ms (max %.1f), sink %.2f ms (max %.2f), "
+                       "%d overruns (%d frames), %d late, %d failed, peak %d",
+                       voiceStats.packets, voiceStats.deviceMs, voiceStats.queueAverageMs, voiceStats.queueMaxMs,
+                       voiceStats.sinkAverageMs, voiceStats.sinkMaxMs, voiceStats.overruns, voiceStats.droppedFrames,
+                       voiceStats.latePackets, voiceStats.sinkFailures, SDL_AtomicGet(&voicePeak));
+          std::cout << summary << std::endl;
+     }
+     if (hasAudioBudget)
+     {
+          AudioBudgetStats budgetStats = audioBudgetGetStats(audioBudget);
+          char summary[256];
+          SDL_snprintf(summary, sizeof(summary),
+                       "Audio callbacks: %d, %.3f ms average of %.2f ms (max %.3f), %d heavy, %d missed",
+                       budgetStats.callbacks, budgetStats.stages[AUDIO_STAGE_TOTAL].averageMs, budgetStats.deadlineMs,
+                       budgetStats.stages[AUDIO_STAGE_TOTAL].maxMs, budgetStats.heavyCallbacks,
+                       budgetStats.deadlineMisses);
+          std::cout << summary << std::endl;
+          musicStream.budget = nullptr;
+          audioBudgetDetach(audioBudget);
+     }
+     voiceManagerHaltAll(voiceManager);
+     synthBankDestroy(synth);
+     dspGraphDetach(masterGraph);
+     voiceMixerDetach(voiceMixer);
+     soundCacheDestroy(soundCache);
+     if (hasAmbience)
+     {
+          StreamedSoundStats ambienceStats = streamedSoundGetStats(ambience);
+          if (ambienceStats.underruns > 0)
+          {
+               std::cout << "Ambience stream underran " << ambienceStats.underruns << " times" << std::endl;
+          }
+          streamedSoundClose(ambience);
+     }
+     if (hasMusicStream)
+     {
+          MusicStreamStats musicStats = musicStreamGetStats(musicStream);
+          if (musicStats.underruns > 0)
+          {
+               std::cout << "Music stream underran " << musicStats.underruns << " times" << std::endl;
+          }
+          musicStreamDestroy(musicStream);
+     }
+     assetLoaderStop(assetLoader);
+     symbolUsageClose(startupUsage);
+     startupTraceDestroy(startupTrace);
+     atlasBuilderDestroy(atlasBuilder);
+
      Mix_FreeMusic(backgroundMusic);
      backgroundMusic = nullptr;
+     assetPackClose(assetPack); // Music and fonts stream from the mapping
 
-     SDL_DestroyTexture(playButtonTexture);
-     SDL_DestroyTexture(gameOverTexture);
-     playButtonTexture = nullptr;
-     gameOverTexture = nullptr;
+     atlasDestroy(atlas);
+     playButtonSprite = nullptr;
+     gameOverSprite = nullptr;
 
+     gpuTimerDestroy(gpuTimer);
+     renderRecordStop();
+     cursorCacheDestroy(cursors);
      SDL_DestroyRenderer(renderer);
      SDL_DestroyWindow(window);
      renderer = nullptr;
      window = nullptr;
 
+     gameLogFlush(gameLog);
+     asyncLogStop();
+     TTF_Quit();
+     audioDeviceClose(audioDevice);
      Mix_Quit();
      IMG_Quit();
      SDL_Quit();
+     // What is still allocated after shutdown is a leak
+     if (SDL_GetHintBoolean(MEMORY_TRACK_HINT, SDL_FALSE))
+     {
+          memoryTagsReport();
+     }
 
-     return 0;
+     return exitCode;
 }
@@ -0,0 +1,61 @@
+#include "aligned_surface.h"
+
+int alignedSurfacePitch(int width, Uint32 format)
+{
+     int alignment = (int)SDL_SIMDGetAlignment();
+     int pitch = width * SDL_BYTESPERPIXEL(format);
+     return (pitch + alignment - 1) / alignment * alignment;
+}
+
+SDL_Surface *alignedSurfaceCreate(int width, int height, Uint32 format)
+{
+     if (width <= 0 || height <= 0 || SDL_ISPIXELFORMAT_FOURCC(format) || SDL_BITSPERPIXEL(format) < 8)
+     {
+          SDL_SetError("Unsupported aligned surface");
+          return nullptr;
+     }
+     int pitch = alignedSurfacePitch(width, format);
+     void *pixels = SDL_SIMDAlloc((size_t)pitch * height);
+     if (pixels == nullptr)
+     {
+          SDL_OutOfMemory();
+          return nullptr;
+     }
+     SDL_memset(pixels, 0, (size_t)pitch * height);
+
+     SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormatFrom(pixels, width, height, SDL_BITSPERPIXEL(format), pitch,
+                                                               format);
+     if (surface == nullptr)
+     {
+          SDL_SIMDFree(pixels);
+          return nullptr;
+     }
+     // Hand the pixels to the surface: SDL_FreeSurface releases SIMD aligned
+     // storage with SDL_SIMDFree, exactly as for surfaces SDL allocates itself
+     surface->flags &= ~SDL_PREALLOC;
+     surface->flags |= SDL_SIMD_ALIGNED;
+     return surface;
+}
+
+SDL_Surface *alignedSurfaceConvert(SDL_Surface *surface, Uint32 format)
+{
+     SDL_Surface *converted = alignedSurfaceCreate(surface->w, surface->h, format);
+     if (converted == nullptr)
+     {
+          return nullptr;
+     }
+     if (SDL_LockSurface(surface) != 0)
+     {
+          SDL_FreeSurface(converted);
+          return nullptr;
+     }
+     int result = SDL_ConvertPixels(surface->w, surface->h, surface->format->format, surface->pixels, surface->pitch,
+                                    format, converted->pixels, converted->pitch);
+     SDL_UnlockSurface(surface);
+     if (result != 0)
+     {
+          SDL_FreeSurface(converted);
+          return nullptr;
+     }
+     return converted;
+}
@@ -0,0 +1,24 @@
+// Description:
+// Surfaces whose pixel rows all start on a SIMD boundary. SDL already
+// allocates pixels with SDL_SIMDAlloc, but pads the pitch only to 4 bytes,
+// so every row after the first can start misaligned and SDL's SSE/AVX/NEON
+// blitters fall back to unaligned loads. Here the pitch is rounded up to
+// SDL_SIMDGetAlignment() as well. The result is an ordinary SDL_Surface
+// that SDL_FreeSurface releases.
+// =============================================================================
+
+#ifndef ALIGNED_SURFACE_H
+#define ALIGNED_SURFACE_H
+
+#include <SDL2/SDL.h>
+
+// Pitch in bytes for `width` pixels of `format`, rounded up to the SIMD alignment
+int alignedSurfacePitch(int width, Uint32 format);
+
+// Like SDL_CreateRGBSurfaceWithFormat, but with every row SIMD aligned
+SDL_Surface *alignedSurfaceCreate(int width, int height, Uint32 format);
+
+// Like SDL_ConvertSurfaceFormat, converting into an aligned surface
+SDL_Surface *alignedSurfaceConvert(SDL_Surface *surface, Uint32 format);
+
+#endif // ALIGNED_SURFACE_H
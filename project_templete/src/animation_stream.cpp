@@ -0,0 +1,305 @@
+#include "animation_stream.h"
+
+#include <iostream>
+
+#include "aligned_surface.h"
+#include "render_record.h"
+
+namespace
+{
+     // Open whichever decoder suits the file; runs on the worker
+     bool openDecoder(AnimationStream &stream, int &width, int &height)
+     {
+          SDL_RWops *rw = SDL_RWFromFile(stream.path.c_str(), "rb");
+          if (rw == nullptr)
+          {
+               return false;
+          }
+          char magic[3] = {0, 0, 0};
+          SDL_RWread(rw, magic, 1, 3);
+          SDL_RWseek(rw, 0, RW_SEEK_SET);
+          stream.isGif = magic[0] == 'G' && magic[1] == 'I' && magic[2] == 'F';
+          if (stream.isGif)
+          {
+               if (!gifDecoderOpen(stream.gif, rw))
+               {
+                    return false;
+               }
+               width = stream.gif.width;
+               height = stream.gif.height;
+               return true;
+          }
+          stream.whole = IMG_LoadAnimation_RW(rw, 1);
+          if (stream.whole == nullptr || stream.whole->count == 0)
+          {
+               return false;
+          }
+          stream.wholeNext = 0;
+          width = stream.whole->w;
+          height = stream.whole->h;
+          return true;
+     }
+
+     // Decode one frame into `surface`: 1 on success, 0 at the end, -1 on error
+     int decodeFrame(AnimationStream &stream, SDL_Surface *surface, int &delayMs)
+     {
+          if (stream.isGif)
+          {
+               int result = gifDecoderNext(stream.gif, surface->pixels, surface->pitch, &delayMs);
+               if (result == 0 && stream.loop && stream.gif.frameIndex > 0 && gifDecoderRewind(stream.gif))
+               {
+                    result = gifDecoderNext(stream.gif, surface->pixels, surface->pitch, &delayMs);
+               }
+               return result;
+          }
+
+          if (stream.wholeNext >= stream.whole->count)
+          {
+               if (!stream.loop)
+               {
+                    return 0;
+               }
+               stream.wholeNext = 0;
+          }
+          int index = stream.wholeNext++;
+          delayMs = SDL_max(stream.whole->delays[index], 10);
+          return SDL_BlitSurface(stream.whole->frames[index], NULL, surface, NULL) == 0 ? 1 : -1;
+     }
+
+     int SDLCALL workerMain(void *data)
+     {
+          AnimationStream &stream = *(AnimationStream *)data;
+          int width = 0, height = 0;
+          bool opened = openDecoder(stream, width, height);
+
+          SDL_LockMutex(stream.lock);
+          if (!opened)
+          {
+               stream.error = SDL_GetError();
+               stream.finished = true;
+          }
+          stream.width = width;
+          stream.height = height;
+
+          while (!stream.quitting && !stream.finished)
+          {
+               if ((int)stream.ready.size() >= stream.window)
+               {
+                    SDL_CondWait(stream.wake, stream.lock);
+                    continue;
+               }
+
+               SDL_Surface *surface = nullptr;
+               if (!stream.spare.empty())
+               {
+                    surface = stream.spare.back();
+                    stream.spare.pop_back();
+               }
+               SDL_UnlockMutex(stream.lock);
+
+               if (surface == nullptr)
+               {
+                    surface = alignedSurfaceCreate(width, height, SDL_PIXELFORMAT_ARGB8888);
+               }
+               int delayMs = 0;
+               int result = surface != nullptr ? decodeFrame(stream, surface, delayMs) : -1;
+
+               SDL_LockMutex(stream.lock);
+               if (result == 1)
+               {
+                    stream.ready.push_back({surface, delayMs});
+               }
+               else
+               {
+                    if (result < 0)
+                    {
+                         stream.error = SDL_GetError();
+                    }
+                    if (surface != nullptr)
+                    {
+                         stream.spare.push_back(surface);
+                    }
+                    stream.finished = true;
+               }
+          }
+          SDL_UnlockMutex(stream.lock);
+          return 0;
+     }
+}
+
+bool animationStreamOpen(AnimationStream &stream, SDL_Renderer *renderer, const std::string &path, int window,
+                         bool loop)
+{
+     stream.renderer = renderer;
+     stream.hasTextures = false;
+     stream.path = path;
+     stream.window = SDL_max(window, 1);
+     stream.loop = loop;
+     stream.isGif = false;
+     stream.gif.rw = nullptr;
+     stream.whole = nullptr;
+     stream.wholeNext = 0;
+     stream.width = 0;
+     stream.height = 0;
+     stream.quitting = false;
+     stream.finished = false;
+     stream.shown = {nullptr, 0};
+     stream.elapsedMs = 0.0f;
+     stream.lateFrames = 0;
+
+     stream.lock = SDL_CreateMutex();
+     stream.wake = SDL_CreateCond();
+     stream.worker = nullptr;
+     if (stream.lock != nullptr && stream.wake != nullptr)
+     {
+          stream.worker = SDL_CreateThread(workerMain, "AnimationDecode", &stream);
+     }
+     if (stream.worker == nullptr)
+     {
+          std::cerr << "Unable to start animation decoder! SDL Error: " << SDL_GetError() << std::endl;
+          animationStreamClose(stream);
+          return false;
+     }
+     return true;
+}
+
+void animationStreamUpdate(AnimationStream &stream, float elapsedMs)
+{
+     if (stream.lock == nullptr)
+     {
+          return;
+     }
+     if (stream.hasTextures)
+     {
+          textureRingFrameEnd(stream.textures);
+     }
+     stream.elapsedMs += elapsedMs;
+     if (stream.shown.surface != nullptr && stream.elapsedMs < stream.shown.delayMs)
+     {
+          return;
+     }
+
+     SDL_LockMutex(stream.lock);
+     if (stream.ready.empty())
+     {
+          if (stream.shown.surface != nullptr && !stream.finished)
+          {
+               stream.lateFrames++;
+          }
+          SDL_UnlockMutex(stream.lock);
+          return;
+     }
+     // The worker only appends, so the front frame stays put while we copy it
+     AnimationFrame next = stream.ready.front();
+     int width = stream.width, height = stream.height;
+     if (stream.error.size() > 0)
+     {
+          std::cerr << "Animation " << stream.path << ": " << stream.error << std::endl;
+          stream.error.clear();
+     }
+     SDL_UnlockMutex(stream.lock);
+
+     if (!stream.hasTextures)
+     {
+          stream.hasTextures = textureRingInit(stream.textures, stream.renderer, SDL_PIXELFORMAT_ARGB8888, width,
+                                               height);
+          if (!stream.hasTextures)
+          {
+               return;
+          }
+          for (SDL_Texture *texture : stream.textures.textures)
+          {
+               renderRecordSetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+          }
+     }
+
+     // Every slot still in flight: keep the old frame up and retry next frame
+     void *pixels;
+     int pitch;
+     if (!textureRingLock(stream.textures, &pixels, &pitch))
+     {
+          return;
+     }
+     for (int y = 0; y < height; y++)
+     {
+          SDL_memcpy((Uint8 *)pixels + y * pitch, (const Uint8 *)next.surface->pixels + y * next.surface->pitch,
+                     width * 4);
+     }
+     textureRingUnlock(stream.textures);
+
+     SDL_LockMutex(stream.lock);
+     stream.ready.pop_front();
+     if (stream.shown.surface != nullptr)
+     {
+          stream.spare.push_back(stream.shown.surface);
+     }
+     SDL_CondSignal(stream.wake);
+     SDL_UnlockMutex(stream.lock);
+
+     // Drop whole frame periods missed while hidden instead of fast-forwarding
+     if (stream.shown.surface != nullptr)
+     {
+          stream.elapsedMs = SDL_min(stream.elapsedMs - stream.shown.delayMs, (float)next.delayMs);
+     }
+     else
+     {
+          stream.elapsedMs = 0.0f;
+     }
+     stream.shown = next;
+}
+
+SDL_Texture *animationStreamTexture(AnimationStream &stream)
+{
+     return stream.shown.surface != nullptr && stream.hasTextures ? textureRingCurrent(stream.textures) : nullptr;
+}
+
+bool animationStreamFinished(AnimationStream &stream)
+{
+     if (stream.lock == nullptr)
+     {
+          return true;
+     }
+     SDL_LockMutex(stream.lock);
+     bool finished = stream.finished && stream.ready.empty();
+     SDL_UnlockMutex(stream.lock);
+     return finished && stream.elapsedMs >= stream.shown.delayMs;
+}
+
+void animationStreamClose(AnimationStream &stream)
+{
+     if (stream.worker != nullptr)
+     {
+          SDL_LockMutex(stream.lock);
+          stream.quitting = true;
+          SDL_CondSignal(stream.wake);
+          SDL_UnlockMutex(stream.lock);
+          SDL_WaitThread(stream.worker, NULL);
+          stream.worker = nullptr;
+     }
+
+     for (AnimationFrame &frame : stream.ready)
+     {
+          SDL_FreeSurface(frame.surface);
+     }
+     stream.ready.clear();
+     for (SDL_Surface *surface : stream.spare)
+     {
+          SDL_FreeSurface(surface);
+     }
+     stream.spare.clear();
+     SDL_FreeSurface(stream.shown.surface);
+     stream.shown.surface = nullptr;
+
+     gifDecoderClose(stream.gif);
+     IMG_FreeAnimation(stream.whole);
+     stream.whole = nullptr;
+     if (stream.hasTextures)
+     {
+          textureRingDestroy(stream.textures);
+          stream.hasTextures = false;
+     }
+     SDL_DestroyCond(stream.wake);
+     SDL_DestroyMutex(stream.lock);
+     stream.wake = nullptr;
+     stream.lock = nullptr;
+}
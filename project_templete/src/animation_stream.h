@@ -0,0 +1,81 @@
+// Description:
+// Animated images played through a small ring of streaming textures (see
+// texture_ring.h). Frames are decoded ahead on a worker thread into a small
+// bounded window; the main thread only uploads the frame that is due, so
+// opening or playing a large animation never stalls rendering and memory
+// holds `window` frames rather than the whole animation.
+//
+// GIFs are decoded incrementally (see gif_decoder.h). Other formats
+// IMG_LoadAnimation understands (e.g. animated WebP) cannot be decoded a
+// frame at a time through SDL_image, so they are decoded whole on the
+// worker and then fed through the same window.
+// =============================================================================
+
+#ifndef ANIMATION_STREAM_H
+#define ANIMATION_STREAM_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "gif_decoder.h"
+#include "texture_ring.h"
+
+struct AnimationFrame
+{
+     SDL_Surface *surface; // ARGB8888, width x height
+     int delayMs;
+};
+
+struct AnimationStream
+{
+     SDL_Renderer *renderer;
+     TextureRing textures; // Created once the size is known
+     bool hasTextures;
+     std::string path;
+     int window;
+     bool loop;
+
+     // Worker-side decoder state
+     bool isGif;
+     GifDecoder gif;
+     IMG_Animation *whole;
+     int wholeNext;
+
+     SDL_Thread *worker;
+     SDL_mutex *lock;
+     SDL_cond *wake; // Signalled when a frame is consumed or on shutdown
+
+     // Guarded by lock
+     int width, height; // 0 until the worker has read the header
+     std::deque<AnimationFrame> ready;
+     std::vector<SDL_Surface *> spare; // Recycled frame surfaces
+     bool quitting;
+     bool finished;
+     std::string error;
+
+     // Main thread
+     AnimationFrame shown;
+     float elapsedMs;
+     int lateFrames; // Times a frame was due but not decoded yet
+};
+
+// Start decoding `path` ahead by up to `window` frames
+bool animationStreamOpen(AnimationStream &stream, SDL_Renderer *renderer, const std::string &path, int window,
+                         bool loop);
+
+// Advance playback and upload the current frame when it changes. Call once
+// per presented frame: it also advances the texture ring's reuse check.
+void animationStreamUpdate(AnimationStream &stream, float elapsedMs);
+
+// Texture to draw this frame; nullptr until the first frame has been uploaded
+SDL_Texture *animationStreamTexture(AnimationStream &stream);
+
+// True once a non-looping animation has shown its last frame
+bool animationStreamFinished(AnimationStream &stream);
+
+void animationStreamClose(AnimationStream &stream);
+
+#endif // ANIMATION_STREAM_H
@@ -0,0 +1,275 @@
+#include "asset_cache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#include "file_commit.h"
+#include "texture_cache.h"
+
+namespace
+{
+     const Sint64 DEFAULT_BUDGET_BYTES = 256ll * 1024 * 1024;
+
+     // FNV-1a, continued from `hash`
+     Uint64 fnvAppend(Uint64 hash, const void *data, size_t size)
+     {
+          const Uint8 *bytes = (const Uint8 *)data;
+          for (size_t i = 0; i < size; i++)
+          {
+               hash = (hash ^ bytes[i]) * 1099511628211ull;
+          }
+          return hash;
+     }
+
+     std::string entryPath(const AssetCache &cache, Uint64 key, const char *suffix)
+     {
+          char name[64];
+          SDL_snprintf(name, sizeof(name), "%016llx%s", (unsigned long long)key, suffix);
+          return cache.directory + name;
+     }
+
+     std::string pagePath(const AssetCache &cache, Uint64 key, int page)
+     {
+          char suffix[32];
+          SDL_snprintf(suffix, sizeof(suffix), "-%d.tex", page);
+          return entryPath(cache, key, suffix);
+     }
+
+     // Mark an entry as recently used for assetCacheTrim()
+     void touchFile(const std::string &path)
+     {
+          std::error_code error;
+          std::filesystem::last_write_time(std::filesystem::u8path(path), std::filesystem::file_time_type::clock::now(), error);
+     }
+}
+
+bool assetCacheOpen(AssetCache &cache, const char *org, const char *app, Uint32 pipelineVersion)
+{
+     cache.directory.clear();
+     cache.pipelineVersion = pipelineVersion;
+     cache.budgetBytes = DEFAULT_BUDGET_BYTES;
+     cache.hits = 0;
+     cache.misses = 0;
+     if (!SDL_GetHintBoolean(ASSET_CACHE_HINT, SDL_TRUE))
+     {
+          return false;
+     }
+
+     char *pref = SDL_GetPrefPath(org, app);
+     if (pref == nullptr)
+     {
+          std::cerr << "Asset cache disabled, no preference path! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     std::string base = pref;
+     SDL_free(pref);
+     const char separator = base.empty() ? '/' : base.back(); // SDL_GetPrefPath ends in the platform's separator
+     std::string directory = base + "cache" + separator;
+
+     std::error_code error;
+     std::filesystem::create_directories(std::filesystem::u8path(directory), error);
+     if (error)
+     {
+          std::cerr << "Asset cache disabled, unable to create " << directory << ": " << error.message() << std::endl;
+          return false;
+     }
+     cache.directory = directory;
+     return true;
+}
+
+bool assetCacheKey(const AssetCache &cache, const std::string &step, const AssetPack *pack,
+                   const std::vector<std::string> &sources, Uint64 &key)
+{
+     Uint64 hash = 14695981039346656037ull;
+     hash = fnvAppend(hash, &cache.pipelineVersion, sizeof(cache.pipelineVersion));
+     hash = fnvAppend(hash, step.c_str(), step.size() + 1);
+
+     std::vector<Uint8> chunk(64 * 1024);
+     for (const std::string &source : sources)
+     {
+          SDL_RWops *rw = assetOpen(pack, source);
+          if (rw == nullptr)
+          {
+               return false;
+          }
+          hash = fnvAppend(hash, source.c_str(), source.size() + 1);
+          Uint64 total = 0;
+          size_t got;
+          while ((got = SDL_RWread(rw, chunk.data(), 1, chunk.size())) > 0)
+          {
+               hash = fnvAppend(hash, chunk.data(), got);
+               total += got;
+          }
+          SDL_RWclose(rw);
+          hash = fnvAppend(hash, &total, sizeof(total)); // Keeps "ab"+"c" apart from "a"+"bc"
+     }
+     key = hash;
+     return true;
+}
+
+bool assetCacheLoadAtlas(AssetCache &cache, SDL_Renderer *renderer, Uint64 key, TextureAtlas &atlas)
+{
+     if (cache.directory.empty())
+     {
+          cache.misses++;
+          return false;
+     }
+     const std::string indexPath = entryPath(cache, key, ".atlas");
+     size_t size = 0;
+     char *text = (char *)SDL_LoadFile(indexPath.c_str(), &size);
+     if (text == nullptr)
+     {
+          cache.misses++;
+          return false;
+     }
+
+     // "pages N", then one "name page x y w h" line per sprite
+     TextureAtlas loaded;
+     int pageCount = 0;
+     int consumed = 0;
+     bool ok = SDL_sscanf(text, "pages %d%n", &pageCount, &consumed) == 1 && pageCount > 0 && pageCount <= 64;
+     for (int i = 0; ok && i < pageCount; i++)
+     {
+          SDL_Texture *texture = textureCacheLoadTexture(renderer, pagePath(cache, key, i).c_str(), key);
+          ok = texture != nullptr;
+          if (ok)
+          {
+               loaded.pages.push_back(texture);
+               touchFile(pagePath(cache, key, i));
+          }
+     }
+     const char *line = text + consumed;
+     while (ok && line < text + size)
+     {
+          const char *lineEnd = SDL_strchr(line, '\n');
+          if (lineEnd == nullptr)
+          {
+               lineEnd = text + size;
+          }
+          char name[256];
+          int page;
+          SDL_Rect src;
+          std::string current(line, lineEnd);
+          if (SDL_sscanf(current.c_str(), "%255s %d %d %d %d %d", name, &page, &src.x, &src.y, &src.w, &src.h) == 6)
+          {
+               ok = page >= 0 && page < pageCount;
+               if (ok)
+               {
+                    loaded.spriteIndex[name] = (int)loaded.sprites.size();
+                    loaded.sprites.push_back(AtlasSprite{loaded.pages[page], src});
+               }
+          }
+          line = lineEnd + 1;
+     }
+     SDL_free(text);
+
+     if (!ok)
+     {
+          atlasDestroy(loaded);
+          cache.misses++;
+          return false;
+     }
+     touchFile(indexPath);
+     atlas = std::move(loaded);
+     cache.hits++;
+     return true;
+}
+
+std::string assetCacheAtlasPagePath(const AssetCache &cache, Uint64 key, int page)
+{
+     return cache.directory.empty() ? std::string() : pagePath(cache, key, page);
+}
+
+bool assetCacheStoreAtlas(AssetCache &cache, Uint64 key, const TextureAtlas &atlas, const std::vector<SDL_Surface *> &pages)
+{
+     if (cache.directory.empty() || pages.size() != atlas.pages.size())
+     {
+          return false;
+     }
+
+     for (size_t i = 0; i < pages.size(); i++)
+     {
+          // Only the part of the page the packer reached, plus a texel of the
+          // empty border so linear filtering at the edges is unchanged
+          SDL_Surface *page = pages[i];
+          int right = 1;
+          int bottom = 1;
+          for (const AtlasSprite &sprite : atlas.sprites)
+          {
+               if (sprite.texture == atlas.pages[i])
+               {
+                    right = SDL_max(right, sprite.src.x + sprite.src.w + 1);
+                    bottom = SDL_max(bottom, sprite.src.y + sprite.src.h + 1);
+               }
+          }
+          SDL_Surface *used = SDL_CreateRGBSurfaceWithFormatFrom(page->pixels, SDL_min(right, page->w), SDL_min(bottom, page->h),
+                                                                 page->format->BitsPerPixel, page->pitch, page->format->format);
+          if (used == nullptr)
+          {
+               return false;
+          }
+          // Entries are committed (file_commit.h), so a crash mid-write
+          // never leaves a truncated file under a real key
+          const std::string path = pagePath(cache, key, (int)i);
+          const std::string written = path + ".tmp";
+          bool saved = fileCommit(written, path, textureCacheSave(written.c_str(), used, 0, key));
+          SDL_FreeSurface(used);
+          if (!saved)
+          {
+               std::cerr << "Unable to write asset cache page " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+               return false;
+          }
+     }
+
+     // The index goes last: once it exists, every page it names is complete
+     std::string text = "pages " + std::to_string(pages.size()) + "\n";
+     for (const auto &entry : atlas.spriteIndex)
+     {
+          const AtlasSprite &sprite = atlas.sprites[entry.second];
+          size_t page = std::find(atlas.pages.begin(), atlas.pages.end(), sprite.texture) - atlas.pages.begin();
+          if (page == atlas.pages.size())
+          {
+               continue; // A sheet loaded on top of the built pages, not ours to cache
+          }
+          text += entry.first + " " + std::to_string(page) + " " + std::to_string(sprite.src.x) + " " +
+                  std::to_string(sprite.src.y) + " " + std::to_string(sprite.src.w) + " " + std::to_string(sprite.src.h) + "\n";
+     }
+     return fileReplace(entryPath(cache, key, ".atlas"), text.data(), text.size());
+}
+
+void assetCacheTrim(AssetCache &cache)
+{
+     if (cache.directory.empty())
+     {
+          return;
+     }
+     struct CachedFile
+     {
+          std::filesystem::file_time_type time;
+          Sint64 size;
+          std::filesystem::path path;
+     };
+     std::vector<CachedFile> files;
+     Sint64 total = 0;
+     std::error_code error;
+     for (const auto &entry : std::filesystem::directory_iterator(std::filesystem::u8path(cache.directory), error))
+     {
+          if (entry.is_regular_file(error))
+          {
+               CachedFile file = {entry.last_write_time(error), (Sint64)entry.file_size(error), entry.path()};
+               total += file.size;
+               files.push_back(file);
+          }
+     }
+
+     // Least recently used first; a partly trimmed entry just misses next time
+     std::sort(files.begin(), files.end(), [](const CachedFile &a, const CachedFile &b) { return a.time < b.time; });
+     for (size_t i = 0; i < files.size() && total > cache.budgetBytes; i++)
+     {
+          if (std::filesystem::remove(files[i].path, error))
+          {
+               total -= files[i].size;
+          }
+     }
+}
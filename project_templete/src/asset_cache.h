@@ -0,0 +1,65 @@
+// Description:
+// Content-addressed cache of processed assets under SDL_GetPrefPath. Work
+// that every launch would otherwise repeat (decoding images, converting
+// formats, packing atlases) is stored once under a key made from the bytes
+// of its source files, the name and parameters of the step that produced
+// it, and a pipeline version. A warm start finds the finished result by
+// key and skips the pipeline; editing a source file or bumping the version
+// changes the key, so stale entries are never read, only trimmed away.
+//
+// Each entry is a texture_cache file (the pixels) and, for atlases, a
+// text index of the sprites on every page. The key doubles as the stamp
+// inside the pixel files, so a file renamed or half-overwritten by hand
+// fails to load instead of showing the wrong image.
+//
+// Setting ASSET_CACHE_HINT to "0" turns the cache off.
+// =============================================================================
+
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+#include "texture_atlas.h"
+
+#define ASSET_CACHE_HINT "CATCH_ASSET_CACHE"
+
+struct AssetCache
+{
+     std::string directory;  // Ends in a separator, empty when disabled
+     Uint32 pipelineVersion; // Bump when any cached step changes its output
+     Sint64 budgetBytes;     // assetCacheTrim() keeps the directory under this
+     int hits;
+     int misses;
+};
+
+// Use <pref path>/cache/ for `org` and `app`; returns false (and leaves the
+// cache disabled, every lookup a miss) if it cannot be created
+bool assetCacheOpen(AssetCache &cache, const char *org, const char *app, Uint32 pipelineVersion);
+
+// Key for the output of `step` (name and parameters, e.g. "atlas 2048 1")
+// from `sources`, read through `pack` when it has them; false if a source
+// is unreadable
+bool assetCacheKey(const AssetCache &cache, const std::string &step, const AssetPack *pack,
+                   const std::vector<std::string> &sources, Uint64 &key);
+
+// Rebuild an atlas stored under `key` into `atlas`; false on a miss
+bool assetCacheLoadAtlas(AssetCache &cache, SDL_Renderer *renderer, Uint64 key, TextureAtlas &atlas);
+
+// The texture_cache file holding page `page` of the atlas under `key`,
+// stamped with the key; empty when the cache is disabled. A loaded atlas
+// can be restored from it after a device reset (see texture_restore.h)
+std::string assetCacheAtlasPagePath(const AssetCache &cache, Uint64 key, int page);
+
+// Store a freshly built atlas; `pages` are the page surfaces in the order
+// of atlas.pages (see atlasBuild's keepPages). Pages are cropped to the
+// sprites on them.
+bool assetCacheStoreAtlas(AssetCache &cache, Uint64 key, const TextureAtlas &atlas, const std::vector<SDL_Surface *> &pages);
+
+// Delete the oldest entries until the directory fits in budgetBytes
+void assetCacheTrim(AssetCache &cache);
+
+#endif // ASSET_CACHE_H
@@ -0,0 +1,454 @@
+#include "asset_loader.h"
+
+#include <SDL2/SDL_image.h>
+
+#include "aligned_surface.h"
+#include "dds_image.h"
+#include "memory_tags.h"
+#include "premultiply.h"
+#include "thread_affinity.h"
+
+namespace
+{
+     // Lower-cased extension of `path`, without the dot
+     std::string extensionOf(const std::string &path)
+     {
+          size_t dot = path.find_last_of('.');
+          std::string extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+          for (char &c : extension)
+          {
+               c = (char)SDL_tolower((unsigned char)c);
+          }
+          return extension;
+     }
+
+     // The codec a file needs; 0 for formats SDL_image/SDL_mixer always have
+     int imageCodecFor(const std::string &path)
+     {
+          const std::string extension = extensionOf(path);
+          if (extension == "png")
+          {
+               return IMG_INIT_PNG;
+          }
+          if (extension == "jpg" || extension == "jpeg")
+          {
+               return IMG_INIT_JPG;
+          }
+          if (extension == "tif" || extension == "tiff")
+          {
+               return IMG_INIT_TIF;
+          }
+          if (extension == "webp")
+          {
+               return IMG_INIT_WEBP;
+          }
+          if (extension == "jxl")
+          {
+               return IMG_INIT_JXL;
+          }
+          if (extension == "avif")
+          {
+               return IMG_INIT_AVIF;
+          }
+          return 0;
+     }
+
+     int mixCodecFor(const std::string &path)
+     {
+          const std::string extension = extensionOf(path);
+          if (extension == "ogg")
+          {
+               return MIX_INIT_OGG;
+          }
+          if (extension == "mp3")
+          {
+               return MIX_INIT_MP3;
+          }
+          if (extension == "flac")
+          {
+               return MIX_INIT_FLAC;
+          }
+          if (extension == "opus")
+          {
+               return MIX_INIT_OPUS;
+          }
+          if (extension == "mid" || extension == "midi")
+          {
+               return MIX_INIT_MID;
+          }
+          if (extension == "mod" || extension == "xm" || extension == "s3m" || extension == "it")
+          {
+               return MIX_INIT_MOD;
+          }
+          return 0;
+     }
+
+     struct CodecTag
+     {
+          int flag;
+          const char *tag;
+     };
+
+     const CodecTag IMAGE_CODEC_TAGS[] = {{IMG_INIT_JPG, "image:jpg"},   {IMG_INIT_PNG, "image:png"},
+                                          {IMG_INIT_TIF, "image:tif"},   {IMG_INIT_WEBP, "image:webp"},
+                                          {IMG_INIT_JXL, "image:jxl"},   {IMG_INIT_AVIF, "image:avif"}};
+     const CodecTag MIX_CODEC_TAGS[] = {{MIX_INIT_FLAC, "mix:flac"}, {MIX_INIT_MOD, "mix:mod"},
+                                        {MIX_INIT_MP3, "mix:mp3"},   {MIX_INIT_OGG, "mix:ogg"},
+                                        {MIX_INIT_MID, "mix:mid"},   {MIX_INIT_OPUS, "mix:opus"}};
+
+     void noteCodecs(SymbolUsage *usage, const CodecTag *tags, int count, int flags)
+     {
+          for (int i = 0; usage != nullptr && i < count; i++)
+          {
+               if ((flags & tags[i].flag) != 0)
+               {
+                    symbolUsageNote(*usage, tags[i].tag);
+               }
+          }
+     }
+
+     int recordedCodecs(const SymbolUsage &usage, const CodecTag *tags, int count)
+     {
+          int flags = 0;
+          for (int i = 0; i < count; i++)
+          {
+               flags |= symbolUsageNeeded(usage, tags[i].tag) ? tags[i].flag : 0;
+          }
+          return flags;
+     }
+
+     // Initialize whichever of the codecs are still missing. A codec that
+     // fails to load is retried next time; the decode reports the error.
+     // Once the codecs are in, every worker only takes the lock shared
+     void initCodecs(AssetLoader &loader, int imageCodecs, int mixCodecs)
+     {
+          rwLockReadLock(loader.codecLock);
+          const bool loaded = (imageCodecs & ~loader.imageCodecs) == 0 && (mixCodecs & ~loader.mixCodecs) == 0;
+          rwLockReadUnlock(loader.codecLock);
+          if (loaded)
+          {
+               return;
+          }
+
+          rwLockWriteLock(loader.codecLock);
+          if ((imageCodecs & ~loader.imageCodecs) != 0)
+          {
+               loader.imageCodecs |= IMG_Init(imageCodecs & ~loader.imageCodecs);
+          }
+          if ((mixCodecs & ~loader.mixCodecs) != 0)
+          {
+               loader.mixCodecs |= Mix_Init(mixCodecs & ~loader.mixCodecs);
+          }
+          rwLockWriteUnlock(loader.codecLock);
+     }
+
+     struct PrewarmRequest
+     {
+          AssetLoader *loader;
+          int imageCodecs;
+          int mixCodecs;
+     };
+
+     int SDLCALL prewarmThreadMain(void *data)
+     {
+          PrewarmRequest *request = (PrewarmRequest *)data;
+          initCodecs(*request->loader, request->imageCodecs, request->mixCodecs);
+          delete request;
+          return 0;
+     }
+
+     void premultiplyResult(AssetResult &result)
+     {
+          SDL_Surface *surface = result.surface;
+          if (surface->format->BytesPerPixel != 4 || surface->format->Amask == 0)
+          {
+               if (!SDL_ISPIXELFORMAT_ALPHA(surface->format->format) && !SDL_ISPIXELFORMAT_INDEXED(surface->format->format))
+               {
+                    return; // Opaque, premultiplying would change nothing
+               }
+               surface = alignedSurfaceConvert(surface, SDL_PIXELFORMAT_ARGB8888);
+               if (surface == nullptr)
+               {
+                    return; // Left straight, result.premultiplied says so
+               }
+               SDL_FreeSurface(result.surface);
+               result.surface = surface;
+          }
+          result.premultiplied = premultiplySurface(surface);
+     }
+
+     AssetResult decode(AssetLoader &loader, const AssetRequest &request)
+     {
+          AssetResult result;
+          result.type = request.type;
+          result.name = request.name;
+          result.path = request.path;
+          result.surface = nullptr;
+          result.chunk = nullptr;
+          result.music = nullptr;
+          result.sound = nullptr;
+          result.premultiplied = false;
+
+          // Noted here rather than in initCodecs, so a prewarmed codec that
+          // nothing decodes drops out of the record
+          if (request.type == ASSET_IMAGE)
+          {
+               const int codec = imageCodecFor(request.path);
+               noteCodecs(loader.usage, IMAGE_CODEC_TAGS, SDL_arraysize(IMAGE_CODEC_TAGS), codec);
+               initCodecs(loader, codec, 0);
+          }
+          else
+          {
+               const int codec = mixCodecFor(request.path);
+               noteCodecs(loader.usage, MIX_CODEC_TAGS, SDL_arraysize(MIX_CODEC_TAGS), codec);
+               initCodecs(loader, 0, codec);
+          }
+
+          SDL_LockMutex(loader.lock);
+          const bool premultiply = loader.premultiplyImages;
+          SDL_UnlockMutex(loader.lock);
+
+          SDL_RWops *rw = assetOpen(loader.pack, request.path);
+          if (rw == nullptr)
+          {
+               result.error = SDL_GetError();
+               return result;
+          }
+
+          // Every loader below takes ownership of rw
+          MemoryTagScope tag(request.type == ASSET_IMAGE ? MEMORY_TAG_IMAGE : MEMORY_TAG_MIXER);
+          switch (request.type)
+          {
+          case ASSET_IMAGE:
+               result.surface = imageLoadSurface(rw, 1);
+               if (result.surface == nullptr)
+               {
+                    result.error = IMG_GetError();
+               }
+               else if (premultiply)
+               {
+                    premultiplyResult(result);
+               }
+               break;
+          case ASSET_CHUNK:
+               // Converted here with the SIMD resampler rather than SDL_AudioCVT
+               result.chunk = nativeLoadChunk(rw, 1);
+               if (result.chunk == nullptr)
+               {
+                    result.error = Mix_GetError();
+               }
+               break;
+          case ASSET_SOUND:
+               result.sound = new NativeSound();
+               if (!nativeSoundLoad(*result.sound, rw, 1))
+               {
+                    result.error = SDL_GetError();
+                    delete result.sound;
+                    result.sound = nullptr;
+               }
+               break;
+          case ASSET_MUSIC:
+               result.music = Mix_LoadMUS_RW(rw, 1);
+               if (result.music == nullptr)
+               {
+                    result.error = Mix_GetError();
+               }
+               break;
+          }
+          return result;
+     }
+
+     void freeResult(AssetResult &result)
+     {
+          SDL_FreeSurface(result.surface);
+          Mix_FreeChunk(result.chunk);
+          Mix_FreeMusic(result.music);
+          delete result.sound;
+          result.surface = nullptr;
+          result.chunk = nullptr;
+          result.music = nullptr;
+          result.sound = nullptr;
+     }
+
+     int SDLCALL loaderThreadMain(void *data)
+     {
+          AssetLoader *loader = (AssetLoader *)data;
+
+          SDL_LockMutex(loader->lock);
+          for (;;)
+          {
+               while (loader->pending.empty() && !loader->quitting)
+               {
+                    SDL_CondWait(loader->wake, loader->lock);
+               }
+               if (loader->quitting)
+               {
+                    break;
+               }
+               AssetRequest request = loader->pending.front();
+               loader->pending.pop_front();
+
+               // Decode without holding the lock so workers run in parallel
+               SDL_UnlockMutex(loader->lock);
+               AssetResult result = decode(*loader, request);
+               SDL_LockMutex(loader->lock);
+
+               loader->finished.push_back(result);
+          }
+          SDL_UnlockMutex(loader->lock);
+          return 0;
+     }
+}
+
+bool assetLoaderStart(AssetLoader &loader, int workerCount)
+{
+     loader.lock = SDL_CreateMutex();
+     loader.wake = SDL_CreateCond();
+     loader.quitting = false;
+     loader.queuedCount = 0;
+     loader.collectedCount = 0;
+     loader.progress = nullptr;
+     loader.progressUserdata = nullptr;
+     loader.pack = nullptr;
+     loader.premultiplyImages = false;
+     rwLockInit(loader.codecLock);
+     loader.imageCodecs = 0;
+     loader.mixCodecs = 0;
+     loader.prewarm = nullptr;
+     loader.usage = nullptr;
+     if (loader.lock == nullptr || loader.wake == nullptr)
+     {
+          return false;
+     }
+
+     if (workerCount <= 0)
+     {
+          // Leave one core for the main thread
+          workerCount = SDL_max(1, SDL_min(SDL_GetCPUCount() - 1, 8));
+     }
+     // Loading can wait for the frame: EcoQoS and efficiency cores on Windows
+     ThreadOptions options = threadDefaultOptions();
+     options.task = THREAD_TASK_BACKGROUND;
+     for (int i = 0; i < workerCount; i++)
+     {
+          SDL_Thread *thread = threadCreate(loaderThreadMain, "AssetLoader", &loader, options);
+          if (thread == nullptr)
+          {
+               break;
+          }
+          loader.workers.push_back(thread);
+     }
+     return !loader.workers.empty();
+}
+
+void assetLoaderPrewarm(AssetLoader &loader, int imageCodecs, int mixCodecs)
+{
+     if (loader.prewarm != nullptr)
+     {
+          SDL_WaitThread(loader.prewarm, NULL);
+     }
+     PrewarmRequest *request = new PrewarmRequest{&loader, imageCodecs, mixCodecs};
+     loader.prewarm = SDL_CreateThread(prewarmThreadMain, "CodecPrewarm", request);
+     if (loader.prewarm == nullptr)
+     {
+          delete request; // The workers still load codecs on first use
+     }
+}
+
+void assetLoaderSetUsage(AssetLoader &loader, SymbolUsage *usage)
+{
+     loader.usage = usage;
+}
+
+void assetLoaderRecordedCodecs(const SymbolUsage &usage, int &imageCodecs, int &mixCodecs)
+{
+     imageCodecs = recordedCodecs(usage, IMAGE_CODEC_TAGS, SDL_arraysize(IMAGE_CODEC_TAGS));
+     mixCodecs = recordedCodecs(usage, MIX_CODEC_TAGS, SDL_arraysize(MIX_CODEC_TAGS));
+}
+
+void assetLoaderSetProgressCallback(AssetLoader &loader, AssetProgressCallback callback, void *userdata)
+{
+     loader.progress = callback;
+     loader.progressUserdata = userdata;
+}
+
+void assetLoaderSetPack(AssetLoader &loader, const AssetPack *pack)
+{
+     SDL_LockMutex(loader.lock);
+     loader.pack = pack;
+     SDL_UnlockMutex(loader.lock);
+}
+
+void assetLoaderSetPremultiply(AssetLoader &loader, bool premultiply)
+{
+     SDL_LockMutex(loader.lock);
+     loader.premultiplyImages = premultiply;
+     SDL_UnlockMutex(loader.lock);
+}
+
+void assetLoaderQueue(AssetLoader &loader, AssetType type, const std::string &name, const std::string &path)
+{
+     AssetRequest request = {type, name, path};
+     SDL_LockMutex(loader.lock);
+     loader.pending.push_back(request);
+     SDL_CondSignal(loader.wake);
+     SDL_UnlockMutex(loader.lock);
+     loader.queuedCount++;
+}
+
+int assetLoaderCollect(AssetLoader &loader, std::vector<AssetResult> &results)
+{
+     SDL_LockMutex(loader.lock);
+     int count = (int)loader.finished.size();
+     for (AssetResult &result : loader.finished)
+     {
+          results.push_back(result);
+     }
+     loader.finished.clear();
+     SDL_UnlockMutex(loader.lock);
+
+     loader.collectedCount += count;
+     if (count > 0 && loader.progress != nullptr)
+     {
+          loader.progress(loader.collectedCount, loader.queuedCount, loader.progressUserdata);
+     }
+     return count;
+}
+
+bool assetLoaderDone(const AssetLoader &loader)
+{
+     return loader.collectedCount == loader.queuedCount;
+}
+
+void assetLoaderStop(AssetLoader &loader)
+{
+     if (loader.lock != nullptr)
+     {
+          SDL_LockMutex(loader.lock);
+          loader.quitting = true;
+          SDL_CondBroadcast(loader.wake);
+          SDL_UnlockMutex(loader.lock);
+     }
+     for (SDL_Thread *thread : loader.workers)
+     {
+          SDL_WaitThread(thread, NULL);
+     }
+     loader.workers.clear();
+     if (loader.prewarm != nullptr)
+     {
+          SDL_WaitThread(loader.prewarm, NULL);
+          loader.prewarm = nullptr;
+     }
+
+     for (AssetResult &result : loader.finished)
+     {
+          freeResult(result);
+     }
+     loader.finished.clear();
+     loader.pending.clear();
+
+     SDL_DestroyCond(loader.wake);
+     SDL_DestroyMutex(loader.lock);
+     loader.wake = nullptr;
+     loader.lock = nullptr;
+}
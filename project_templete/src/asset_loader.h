@@ -0,0 +1,124 @@
+// Description:
+// Asynchronous asset loader. Requests are decoded in parallel on a pool of
+// worker threads (IMG_Load_RW into staging surfaces, nativeLoadChunk and
+// Mix_LoadMUS_RW for audio). The main thread collects finished results with
+// assetLoaderCollect() once per frame and does the renderer work itself, since
+// SDL_CreateTextureFromSurface must run on the thread that owns the renderer.
+// A progress callback fires from assetLoaderCollect() to drive a loading screen.
+//
+// Codecs (IMG_Init, Mix_Init flags) are initialized lazily, the first time a
+// request of a matching file extension is decoded, and serialized across the
+// workers since neither init is thread-safe. assetLoaderPrewarm() loads some
+// ahead of time on a background thread instead. Given a SymbolUsage, the
+// loader notes each codec a request needed ("image:png", "mix:ogg"), and
+// assetLoaderRecordedCodecs() turns the last launch's record back into
+// flags to prewarm, so startup loads the codecs it uses and no others.
+// =============================================================================
+
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+#include "fast_lock.h"
+#include "native_sound.h"
+#include "symbol_table.h"
+
+enum AssetType
+{
+     ASSET_IMAGE, // Decoded to an SDL_Surface, ready for texture upload
+     ASSET_CHUNK, // Decoded and resampled to a Mix_Chunk in the mixer's format
+     ASSET_MUSIC, // Opened as Mix_Music
+     ASSET_SOUND  // Decoded to a NativeSound at the file's own rate
+};
+
+struct AssetRequest
+{
+     AssetType type;
+     std::string name;
+     std::string path;
+};
+
+// A finished request; exactly one of the pointers is set on success and the
+// receiver owns it
+struct AssetResult
+{
+     AssetType type;
+     std::string name;
+     std::string path;
+     SDL_Surface *surface;
+     Mix_Chunk *chunk;
+     Mix_Music *music;
+     NativeSound *sound; // Free with delete
+     bool premultiplied; // Surface colour is multiplied by alpha
+     std::string error;  // Empty on success
+};
+
+// Called on the collecting thread as results come in
+typedef void (*AssetProgressCallback)(int completed, int total, void *userdata);
+
+struct AssetLoader
+{
+     std::vector<SDL_Thread *> workers;
+     SDL_mutex *lock;
+     SDL_cond *wake; // Signalled when requests are queued or on shutdown
+
+     // Guarded by lock
+     std::deque<AssetRequest> pending;
+     std::vector<AssetResult> finished;
+     bool quitting;
+
+     // Main-thread bookkeeping
+     int queuedCount;
+     int collectedCount;
+     AssetProgressCallback progress;
+     void *progressUserdata;
+
+     const AssetPack *pack;  // Searched before the filesystem, may be nullptr
+     bool premultiplyImages; // Premultiply decoded images on the workers
+
+     RWLock codecLock;
+     int imageCodecs;      // IMG_INIT_* flags initialized so far, guarded by codecLock
+     int mixCodecs;        // MIX_INIT_* flags initialized so far, guarded by codecLock
+     SDL_Thread *prewarm; // Joined by assetLoaderStop
+     SymbolUsage *usage;  // Codec use is noted here, may be nullptr
+};
+
+// Spawn `workerCount` threads; 0 picks one per spare CPU core
+bool assetLoaderStart(AssetLoader &loader, int workerCount);
+
+// Initialize the given IMG_INIT_* and MIX_INIT_* codecs on a background thread
+void assetLoaderPrewarm(AssetLoader &loader, int imageCodecs, int mixCodecs);
+
+// Note the codecs requests need in `usage` from now on; call before queueing
+void assetLoaderSetUsage(AssetLoader &loader, SymbolUsage *usage);
+
+// The IMG_INIT_* and MIX_INIT_* codecs the last launch noted in `usage`
+void assetLoaderRecordedCodecs(const SymbolUsage &usage, int &imageCodecs, int &mixCodecs);
+
+void assetLoaderSetProgressCallback(AssetLoader &loader, AssetProgressCallback callback, void *userdata);
+
+// Serve requests from `pack` when it has the file; call before queueing
+void assetLoaderSetPack(AssetLoader &loader, const AssetPack *pack);
+
+// Premultiply alpha of images decoded from now on (converting formats
+// without alpha to ARGB8888); draw them with premultipliedBlendMode()
+void assetLoaderSetPremultiply(AssetLoader &loader, bool premultiply);
+
+void assetLoaderQueue(AssetLoader &loader, AssetType type, const std::string &name, const std::string &path);
+
+// Move every finished result into `results`, returns how many were added
+int assetLoaderCollect(AssetLoader &loader, std::vector<AssetResult> &results);
+
+// True once every queued request has been collected
+bool assetLoaderDone(const AssetLoader &loader);
+
+// Join the workers and free anything loaded but never collected
+void assetLoaderStop(AssetLoader &loader);
+
+#endif // ASSET_LOADER_H
@@ -0,0 +1,498 @@
+#include "asset_pack.h"
+
+#include "lz4_block.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+     const Uint32 PACK_VERSION = 1;
+     const int HEADER_BYTES = 32;
+     const int ENTRY_BYTES = 32;
+     const int DATA_ALIGN = 16;
+
+     // Packs from Windows tools may use backslashes or "./" prefixes
+     std::string normalize(const std::string &path)
+     {
+          std::string result = path;
+          std::replace(result.begin(), result.end(), '\\', '/');
+          while (result.compare(0, 2, "./") == 0)
+          {
+               result.erase(0, 2);
+          }
+          return result;
+     }
+
+     Uint64 hashPath(const std::string &path)
+     {
+          Uint64 hash = 14695981039346656037ull;
+          for (unsigned char c : path)
+          {
+               hash = (hash ^ c) * 1099511628211ull;
+          }
+          return hash;
+     }
+
+     Uint16 readLE16(const Uint8 *p)
+     {
+          Uint16 value;
+          std::memcpy(&value, p, sizeof(value));
+          return SDL_SwapLE16(value);
+     }
+
+     Uint32 readLE32(const Uint8 *p)
+     {
+          Uint32 value;
+          std::memcpy(&value, p, sizeof(value));
+          return SDL_SwapLE32(value);
+     }
+
+     Uint64 readLE64(const Uint8 *p)
+     {
+          Uint64 value;
+          std::memcpy(&value, p, sizeof(value));
+          return SDL_SwapLE64(value);
+     }
+
+     void writeLE16(std::vector<Uint8> &out, Uint16 value)
+     {
+          value = SDL_SwapLE16(value);
+          const Uint8 *p = (const Uint8 *)&value;
+          out.insert(out.end(), p, p + sizeof(value));
+     }
+
+     void writeLE32(std::vector<Uint8> &out, Uint32 value)
+     {
+          value = SDL_SwapLE32(value);
+          const Uint8 *p = (const Uint8 *)&value;
+          out.insert(out.end(), p, p + sizeof(value));
+     }
+
+     void writeLE64(std::vector<Uint8> &out, Uint64 value)
+     {
+          value = SDL_SwapLE64(value);
+          const Uint8 *p = (const Uint8 *)&value;
+          out.insert(out.end(), p, p + sizeof(value));
+     }
+
+     const AssetPackEntry *find(const AssetPack &pack, const std::string &path)
+     {
+          if (pack.base == nullptr)
+          {
+               return nullptr;
+          }
+          std::string name = normalize(path);
+          Uint64 hash = hashPath(name);
+          auto it = std::lower_bound(pack.entries.begin(), pack.entries.end(), hash,
+                                     [](const AssetPackEntry &entry, Uint64 key) { return entry.hash < key; });
+          // Walk the (almost always single) run of equal hashes
+          for (; it != pack.entries.end() && it->hash == hash; ++it)
+          {
+               if (it->nameLength == name.size() && std::memcmp(pack.names + it->nameOffset, name.data(), name.size()) == 0)
+               {
+                    return &*it;
+               }
+          }
+          return nullptr;
+     }
+
+     // --- Block-compressed stream ---
+
+     struct BlockStream
+     {
+          const Uint8 *entry; // Start of the stored entry in the mapping
+          Uint32 size;        // Decompressed size
+          Uint32 storedSize;
+          Uint32 blockSize;
+          Uint32 blockCount;
+          Sint64 position;
+          Sint64 cachedBlock; // Index decoded into `block`, -1 for none
+          std::vector<Uint8> block;
+     };
+
+     Uint32 blockStart(const BlockStream &stream, Uint32 index)
+     {
+          return readLE32(stream.entry + 8 + 4 * index);
+     }
+
+     bool loadBlock(BlockStream &stream, Uint32 index)
+     {
+          if (stream.cachedBlock == index)
+          {
+               return true;
+          }
+          Uint32 start = blockStart(stream, index);
+          Uint32 end = blockStart(stream, index + 1);
+          Uint32 rawSize = SDL_min(stream.blockSize, stream.size - index * stream.blockSize);
+          if (start > end || end > stream.storedSize)
+          {
+               return false;
+          }
+          const Uint8 *data = stream.entry + start;
+          if (end - start == rawSize)
+          {
+               std::memcpy(stream.block.data(), data, rawSize);
+          }
+          else if (!lz4BlockDecompress(data, (int)(end - start), stream.block.data(), (int)rawSize))
+          {
+               return false;
+          }
+          stream.cachedBlock = index;
+          return true;
+     }
+
+     Sint64 SDLCALL blockStreamSize(SDL_RWops *context)
+     {
+          return ((BlockStream *)context->hidden.unknown.data1)->size;
+     }
+
+     Sint64 SDLCALL blockStreamSeek(SDL_RWops *context, Sint64 offset, int whence)
+     {
+          BlockStream &stream = *(BlockStream *)context->hidden.unknown.data1;
+          Sint64 base = whence == RW_SEEK_SET ? 0 : whence == RW_SEEK_CUR ? stream.position : stream.size;
+          Sint64 target = base + offset;
+          if (target < 0 || target > stream.size)
+          {
+               return SDL_SetError("Seek out of range in packed file");
+          }
+          // Nothing is decoded until the next read
+          stream.position = target;
+          return target;
+     }
+
+     size_t SDLCALL blockStreamRead(SDL_RWops *context, void *ptr, size_t size, size_t maxnum)
+     {
+          BlockStream &stream = *(BlockStream *)context->hidden.unknown.data1;
+          if (size == 0)
+          {
+               return 0;
+          }
+          size_t wanted = SDL_min(size * maxnum, (size_t)(stream.size - stream.position));
+          wanted -= wanted % size;
+          Uint8 *out = (Uint8 *)ptr;
+          size_t done = 0;
+          while (done < wanted)
+          {
+               Uint32 index = (Uint32)(stream.position / stream.blockSize);
+               if (!loadBlock(stream, index))
+               {
+                    SDL_SetError("Corrupt block in packed file");
+                    break;
+               }
+               Uint32 within = (Uint32)(stream.position - (Sint64)index * stream.blockSize);
+               Uint32 rawSize = SDL_min(stream.blockSize, stream.size - index * stream.blockSize);
+               size_t run = SDL_min(wanted - done, (size_t)(rawSize - within));
+               std::memcpy(out + done, stream.block.data() + within, run);
+               done += run;
+               stream.position += run;
+          }
+          return done / size;
+     }
+
+     size_t SDLCALL blockStreamWrite(SDL_RWops *context, const void *ptr, size_t size, size_t num)
+     {
+          (void)context;
+          (void)ptr;
+          (void)size;
+          (void)num;
+          SDL_SetError("Packed files are read-only");
+          return 0;
+     }
+
+     int SDLCALL blockStreamClose(SDL_RWops *context)
+     {
+          delete (BlockStream *)context->hidden.unknown.data1;
+          SDL_FreeRW(context);
+          return 0;
+     }
+
+     SDL_RWops *openBlockStream(const AssetPack &pack, const AssetPackEntry &entry)
+     {
+          const Uint8 *data = pack.base + entry.offset;
+          if (entry.storedSize < 8)
+          {
+               SDL_SetError("Truncated packed file");
+               return nullptr;
+          }
+          Uint32 blockSize = readLE32(data);
+          Uint32 blockCount = readLE32(data + 4);
+          if (blockSize == 0 || (Uint64)blockCount * blockSize < entry.size ||
+              8 + 4 * ((Uint64)blockCount + 1) > entry.storedSize)
+          {
+               SDL_SetError("Corrupt seek table in packed file");
+               return nullptr;
+          }
+
+          SDL_RWops *rw = SDL_AllocRW();
+          if (rw == nullptr)
+          {
+               return nullptr;
+          }
+          BlockStream *stream = new BlockStream;
+          stream->entry = data;
+          stream->size = entry.size;
+          stream->storedSize = entry.storedSize;
+          stream->blockSize = blockSize;
+          stream->blockCount = blockCount;
+          stream->position = 0;
+          stream->cachedBlock = -1;
+          stream->block.resize(blockSize);
+
+          rw->size = blockStreamSize;
+          rw->seek = blockStreamSeek;
+          rw->read = blockStreamRead;
+          rw->write = blockStreamWrite;
+          rw->close = blockStreamClose;
+          rw->type = SDL_RWOPS_UNKNOWN;
+          rw->hidden.unknown.data1 = stream;
+          return rw;
+     }
+
+     // Split into LZ4 blocks behind a seek table; false if not worth it
+     bool compressBlocks(const Uint8 *data, size_t size, std::vector<Uint8> &out)
+     {
+          Uint32 blockCount = (Uint32)((size + ASSET_PACK_BLOCK_SIZE - 1) / ASSET_PACK_BLOCK_SIZE);
+          std::vector<Uint32> starts;
+          std::vector<Uint8> blocks;
+          std::vector<Uint8> scratch(lz4BlockBound(ASSET_PACK_BLOCK_SIZE));
+          Uint32 tableBytes = 8 + 4 * (blockCount + 1);
+          for (Uint32 i = 0; i < blockCount; i++)
+          {
+               const Uint8 *raw = data + (size_t)i * ASSET_PACK_BLOCK_SIZE;
+               int rawSize = (int)SDL_min((size_t)ASSET_PACK_BLOCK_SIZE, size - (size_t)i * ASSET_PACK_BLOCK_SIZE);
+               int packed = lz4BlockCompress(raw, rawSize, scratch.data(), (int)scratch.size());
+               starts.push_back(tableBytes + (Uint32)blocks.size());
+               if (packed > 0 && packed < rawSize)
+               {
+                    blocks.insert(blocks.end(), scratch.begin(), scratch.begin() + packed);
+               }
+               else
+               {
+                    // Incompressible: stored raw, recognised by its length
+                    blocks.insert(blocks.end(), raw, raw + rawSize);
+               }
+          }
+          starts.push_back(tableBytes + (Uint32)blocks.size());
+
+          if (tableBytes + blocks.size() > size - size / 8)
+          {
+               return false;
+          }
+          out.clear();
+          writeLE32(out, ASSET_PACK_BLOCK_SIZE);
+          writeLE32(out, blockCount);
+          for (Uint32 start : starts)
+          {
+               writeLE32(out, start);
+          }
+          out.insert(out.end(), blocks.begin(), blocks.end());
+          return true;
+     }
+}
+
+bool assetPackOpen(AssetPack &pack, const char *path)
+{
+     pack.base = nullptr;
+     pack.size = 0;
+     pack.entries.clear();
+     pack.names = nullptr;
+     if (!mappedFileOpen(pack.mapping, path))
+     {
+          std::cerr << "Unable to map asset pack " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     pack.base = pack.mapping.base;
+     pack.size = pack.mapping.size;
+
+     const Uint8 *header = pack.base;
+     Uint32 count = pack.size >= (size_t)HEADER_BYTES ? readLE32(header + 8) : 0;
+     Uint64 indexOffset = pack.size >= (size_t)HEADER_BYTES ? readLE64(header + 16) : 0;
+     Uint64 namesOffset = pack.size >= (size_t)HEADER_BYTES ? readLE64(header + 24) : 0;
+     bool valid = pack.size >= (size_t)HEADER_BYTES && std::memcmp(header, "APAK", 4) == 0 &&
+                  readLE32(header + 4) == PACK_VERSION && indexOffset <= pack.size &&
+                  (Uint64)count * ENTRY_BYTES <= pack.size - indexOffset && namesOffset <= pack.size;
+
+     // Copy the index out so lookups don't depend on its alignment and each
+     // entry is bounds-checked once here rather than on every open
+     for (Uint32 i = 0; valid && i < count; i++)
+     {
+          const Uint8 *p = pack.base + indexOffset + (Uint64)i * ENTRY_BYTES;
+          AssetPackEntry entry;
+          entry.hash = readLE64(p);
+          entry.offset = readLE64(p + 8);
+          entry.size = readLE32(p + 16);
+          entry.storedSize = readLE32(p + 20);
+          entry.nameOffset = readLE32(p + 24);
+          entry.nameLength = readLE16(p + 28);
+          entry.compression = readLE16(p + 30);
+          // Compare against the room left rather than summing, so a crafted
+          // 64-bit offset can't wrap past the end of the mapping. A raw entry
+          // is read straight from the mapping, so it must store every byte.
+          valid = entry.offset <= pack.size && entry.storedSize <= pack.size - entry.offset &&
+                  (entry.compression != ASSET_PACK_RAW || entry.size == entry.storedSize) &&
+                  (Uint64)entry.nameOffset + entry.nameLength <= pack.size - namesOffset &&
+                  (pack.entries.empty() || pack.entries.back().hash <= entry.hash);
+          pack.entries.push_back(entry);
+     }
+     if (!valid)
+     {
+          std::cerr << path << " is not a valid asset pack" << std::endl;
+          assetPackClose(pack);
+          return false;
+     }
+     pack.names = (const char *)pack.base + namesOffset;
+     return true;
+}
+
+void assetPackClose(AssetPack &pack)
+{
+     mappedFileClose(pack.mapping);
+     pack.base = nullptr;
+     pack.size = 0;
+     pack.entries.clear();
+     pack.names = nullptr;
+}
+
+bool assetPackContains(const AssetPack &pack, const std::string &path)
+{
+     return find(pack, path) != nullptr;
+}
+
+SDL_RWops *assetPackOpenFile(const AssetPack &pack, const std::string &path)
+{
+     const AssetPackEntry *entry = find(pack, path);
+     if (entry == nullptr)
+     {
+          return nullptr;
+     }
+     switch (entry->compression)
+     {
+     case ASSET_PACK_RAW:
+          // A const memory stream reads directly from the mapped pages
+          return SDL_RWFromConstMem(pack.base + entry->offset, (int)entry->size);
+     case ASSET_PACK_LZ4_BLOCKS:
+          return openBlockStream(pack, *entry);
+     default:
+          SDL_SetError("%s: unsupported pack compression %d", path.c_str(), entry->compression);
+          return nullptr;
+     }
+}
+
+SDL_RWops *assetOpen(const AssetPack *pack, const std::string &path)
+{
+     if (pack != nullptr)
+     {
+          SDL_RWops *rw = assetPackOpenFile(*pack, path);
+          if (rw != nullptr)
+          {
+               return rw;
+          }
+     }
+     return mappedRWFromFile(path.c_str());
+}
+
+bool assetPackWrite(const char *outPath, const std::vector<std::string> &files, bool compress)
+{
+     struct Pending
+     {
+          std::string name;
+          Uint8 *data;
+          size_t size;
+          std::vector<Uint8> packed; // Stored form when compressed
+          AssetPackEntry entry;
+     };
+     std::vector<Pending> pending;
+     bool ok = true;
+     for (const std::string &file : files)
+     {
+          Pending item;
+          item.name = normalize(file);
+          item.data = (Uint8 *)SDL_LoadFile(file.c_str(), &item.size);
+          if (item.data == nullptr || item.name.size() > 0xFFFF || item.size > 0xFFFFFFFFu)
+          {
+               std::cerr << "Unable to pack " << file << "! SDL Error: " << SDL_GetError() << std::endl;
+               SDL_free(item.data);
+               ok = false;
+               continue;
+          }
+          item.entry.hash = hashPath(item.name);
+          item.entry.compression = ASSET_PACK_RAW;
+          if (compress && compressBlocks(item.data, item.size, item.packed))
+          {
+               item.entry.compression = ASSET_PACK_LZ4_BLOCKS;
+          }
+          pending.push_back(std::move(item));
+     }
+
+     std::sort(pending.begin(), pending.end(),
+               [](const Pending &a, const Pending &b) { return a.entry.hash < b.entry.hash; });
+
+     // Lay out names, then data, after the header and index
+     Uint64 indexOffset = HEADER_BYTES;
+     Uint64 namesOffset = indexOffset + pending.size() * ENTRY_BYTES;
+     std::vector<Uint8> names;
+     for (Pending &item : pending)
+     {
+          item.entry.nameOffset = (Uint32)names.size();
+          item.entry.nameLength = (Uint16)item.name.size();
+          names.insert(names.end(), item.name.begin(), item.name.end());
+     }
+     Uint64 cursor = namesOffset + names.size();
+     for (Pending &item : pending)
+     {
+          cursor = (cursor + DATA_ALIGN - 1) / DATA_ALIGN * DATA_ALIGN;
+          item.entry.offset = cursor;
+          item.entry.size = (Uint32)item.size;
+          item.entry.storedSize = (Uint32)(item.packed.empty() ? item.size : item.packed.size());
+          cursor += item.entry.storedSize;
+     }
+
+     std::vector<Uint8> head;
+     head.insert(head.end(), {'A', 'P', 'A', 'K'});
+     writeLE32(head, PACK_VERSION);
+     writeLE32(head, (Uint32)pending.size());
+     writeLE32(head, 0);
+     writeLE64(head, indexOffset);
+     writeLE64(head, namesOffset);
+     for (const Pending &item : pending)
+     {
+          writeLE64(head, item.entry.hash);
+          writeLE64(head, item.entry.offset);
+          writeLE32(head, item.entry.size);
+          writeLE32(head, item.entry.storedSize);
+          writeLE32(head, item.entry.nameOffset);
+          writeLE16(head, item.entry.nameLength);
+          writeLE16(head, item.entry.compression);
+     }
+     head.insert(head.end(), names.begin(), names.end());
+
+     SDL_RWops *out = SDL_RWFromFile(outPath, "wb");
+     if (out == nullptr)
+     {
+          std::cerr << "Unable to write " << outPath << "! SDL Error: " << SDL_GetError() << std::endl;
+          ok = false;
+     }
+     else
+     {
+          ok = SDL_RWwrite(out, head.data(), 1, head.size()) == head.size() && ok;
+          Uint64 written = head.size();
+          const Uint8 zeros[DATA_ALIGN] = {0};
+          for (const Pending &item : pending)
+          {
+               SDL_RWwrite(out, zeros, 1, (size_t)(item.entry.offset - written));
+               const Uint8 *stored = item.packed.empty() ? item.data : item.packed.data();
+               ok = SDL_RWwrite(out, stored, 1, item.entry.storedSize) == item.entry.storedSize && ok;
+               written = item.entry.offset + item.entry.storedSize;
+          }
+          SDL_RWclose(out);
+     }
+
+     for (Pending &item : pending)
+     {
+          SDL_free(item.data);
+     }
+     return ok;
+}
@@ -0,0 +1,84 @@
+// Description:
+// Read-only archive of game assets, memory-mapped at startup. The pack is
+// one file: a header, an index of entries sorted by path hash, the path
+// strings and the file contents. Opening an entry returns an SDL_RWops
+// that reads straight from the mapping, so IMG_Load_RW, TTF_OpenFontRW,
+// Mix_LoadWAV_RW and Mix_LoadMUS_RW work on packed assets without another
+// open() per file or an intermediate copy.
+//
+// Layout (all integers little-endian):
+//     header  "APAK", version, entryCount, reserved, indexOffset (64),
+//             namesOffset (64)
+//     index   entryCount x {hash (64), offset (64), size, storedSize,
+//             nameOffset, nameLength (16), compression (16)}
+//     names   path bytes, not terminated
+//     data    entry contents, each aligned to 16 bytes
+//
+// Entries are stored raw (compression 0) or as independent LZ4 blocks
+// (compression 1) behind a seek table:
+//     blockSize, blockCount, (blockCount + 1) x block start
+// relative to the entry. A block whose stored length equals its raw length
+// is kept uncompressed. Seeking a compressed stream is free; a read decodes
+// only the block it lands in, so Mix_SetMusicPosition and streaming decoders
+// touch as little data as with a raw entry.
+// =============================================================================
+
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+struct AssetPackEntry
+{
+     Uint64 hash;
+     Uint64 offset;
+     Uint32 size;
+     Uint32 storedSize;
+     Uint32 nameOffset;
+     Uint16 nameLength;
+     Uint16 compression;
+};
+
+enum AssetPackCompression
+{
+     ASSET_PACK_RAW = 0,
+     ASSET_PACK_LZ4_BLOCKS = 1
+};
+
+const int ASSET_PACK_BLOCK_SIZE = 64 * 1024;
+
+struct AssetPack
+{
+     const Uint8 *base; // Start of the mapping, nullptr when closed
+     size_t size;
+     std::vector<AssetPackEntry> entries; // Sorted by hash
+     const char *names;
+
+     MappedFile mapping; // base and size above are its own
+};
+
+bool assetPackOpen(AssetPack &pack, const char *path);
+void assetPackClose(AssetPack &pack);
+
+bool assetPackContains(const AssetPack &pack, const std::string &path);
+
+// Read-only stream over a packed file, nullptr if the pack lacks it. Safe
+// to call from several threads at once; each stream has its own block
+// cache.
+SDL_RWops *assetPackOpenFile(const AssetPack &pack, const std::string &path);
+
+// Open `path` from the pack when it has it, from disk otherwise, mapped
+// (mapped_file.h) so decoders' small reads stay cheap. `pack` may be
+// nullptr.
+SDL_RWops *assetOpen(const AssetPack *pack, const std::string &path);
+
+// Build a pack from files on disk, stored under the paths as given. With
+// `compress`, entries that shrink by at least an eighth are stored as LZ4
+// blocks; already-compressed formats (PNG, MP3, OGG) usually stay raw.
+bool assetPackWrite(const char *outPath, const std::vector<std::string> &files, bool compress = false);
+
+#endif // ASSET_PACK_H
@@ -0,0 +1,601 @@
+#include "async_io.h"
+
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#undef BLOCK_SIZE // From <linux/fs.h>; unity builds use the name
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define ASYNC_IO_HAS_URING 1
+#endif
+#endif
+
+// Outside the anonymous namespace, as AsyncIOState (declared in the
+// header) holds them
+struct AsyncRequest
+{
+#if defined(_WIN32)
+     OVERLAPPED overlapped; // First, so the port's OVERLAPPED * is the request
+#elif defined(ASYNC_IO_HAS_URING)
+     iovec vector;
+#endif
+     AsyncFile *file;
+     Uint64 offset;
+     void *buffer;
+     Uint32 size;
+     AsyncReadCallback callback;
+     void *userdata;
+     Sint64 result;
+     int error; // errno or GetLastError() when result is -1
+     int nextFree;
+};
+
+#if defined(ASYNC_IO_HAS_URING)
+struct AsyncUring
+{
+     int fd;
+     void *sqRing;
+     size_t sqRingBytes;
+     void *cqRing;
+     size_t cqRingBytes;
+     io_uring_sqe *sqes;
+     size_t sqeBytes;
+     unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+     unsigned *cqHead, *cqTail, *cqMask;
+     io_uring_cqe *cqes;
+     unsigned unsubmitted; // Entries queued since the last io_uring_enter
+};
+#endif
+
+namespace
+{
+     const int ASYNC_IO_WORKERS = 4; // Threads backend; reads each one blocks on
+
+#if defined(ASYNC_IO_HAS_URING)
+     bool uringSetup(AsyncUring &ring, unsigned entries)
+     {
+          io_uring_params params;
+          std::memset(&params, 0, sizeof(params));
+          ring.fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+          if (ring.fd < 0)
+          {
+               return false;
+          }
+          ring.sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+          ring.cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+          const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+          if (single)
+          {
+               ring.sqRingBytes = ring.cqRingBytes = SDL_max(ring.sqRingBytes, ring.cqRingBytes);
+          }
+          ring.sqRing = mmap(nullptr, ring.sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd,
+                             IORING_OFF_SQ_RING);
+          ring.cqRing = single ? ring.sqRing
+                               : mmap(nullptr, ring.cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                      ring.fd, IORING_OFF_CQ_RING);
+          ring.sqeBytes = params.sq_entries * sizeof(io_uring_sqe);
+          ring.sqes = (io_uring_sqe *)mmap(nullptr, ring.sqeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                           ring.fd, IORING_OFF_SQES);
+          if (ring.sqRing == MAP_FAILED || ring.cqRing == MAP_FAILED || ring.sqes == MAP_FAILED)
+          {
+               if (ring.sqes != MAP_FAILED)
+               {
+                    munmap(ring.sqes, ring.sqeBytes);
+               }
+               if (!single && ring.cqRing != MAP_FAILED)
+               {
+                    munmap(ring.cqRing, ring.cqRingBytes);
+               }
+               if (ring.sqRing != MAP_FAILED)
+               {
+                    munmap(ring.sqRing, ring.sqRingBytes);
+               }
+               close(ring.fd);
+               return false;
+          }
+          Uint8 *sq = (Uint8 *)ring.sqRing;
+          Uint8 *cq = (Uint8 *)ring.cqRing;
+          ring.sqHead = (unsigned *)(sq + params.sq_off.head);
+          ring.sqTail = (unsigned *)(sq + params.sq_off.tail);
+          ring.sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+          ring.sqArray = (unsigned *)(sq + params.sq_off.array);
+          ring.cqHead = (unsigned *)(cq + params.cq_off.head);
+          ring.cqTail = (unsigned *)(cq + params.cq_off.tail);
+          ring.cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+          ring.cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+          ring.unsubmitted = 0;
+          return true;
+     }
+
+     void uringDestroy(AsyncUring &ring)
+     {
+          munmap(ring.sqes, ring.sqeBytes);
+          if (ring.cqRing != ring.sqRing)
+          {
+               munmap(ring.cqRing, ring.cqRingBytes);
+          }
+          munmap(ring.sqRing, ring.sqRingBytes);
+          close(ring.fd);
+     }
+
+     // Submit what is queued and, with `waitFor`, block for that many completions
+     bool uringEnter(AsyncUring &ring, unsigned waitFor)
+     {
+          for (;;)
+          {
+               const long submitted = syscall(__NR_io_uring_enter, ring.fd, ring.unsubmitted, waitFor,
+                                              waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+               if (submitted >= 0)
+               {
+                    ring.unsubmitted -= (unsigned)submitted;
+                    return true;
+               }
+               if (errno != EINTR)
+               {
+                    return false;
+               }
+          }
+     }
+#endif
+}
+
+struct AsyncIOState
+{
+     std::vector<AsyncRequest> requests;
+     int freeHead; // Free list through AsyncRequest::nextFree, -1 when full
+     std::vector<int> finishedEarly; // Failed at submission; reported by the next poll
+#if defined(_WIN32)
+     HANDLE port;
+#else
+#if defined(ASYNC_IO_HAS_URING)
+     AsyncUring ring;
+#endif
+     SDL_mutex *lock;
+     SDL_cond *queued;   // Workers wait on it for work
+     SDL_cond *finished; // The poller waits on it for completions
+     std::deque<int> work;      // Guarded by lock
+     std::vector<int> complete; // Guarded by lock
+     std::vector<SDL_Thread *> workers;
+     bool quitting; // Guarded by lock
+#endif
+};
+
+namespace
+{
+     int takeRequest(AsyncIOState &state)
+     {
+          const int index = state.freeHead;
+          if (index >= 0)
+          {
+               state.freeHead = state.requests[index].nextFree;
+          }
+          return index;
+     }
+
+     // Frees the slot before the callback, which may submit into it again
+     void completeRequest(AsyncIO &io, int index)
+     {
+          AsyncRequest &request = io.state->requests[index];
+          const AsyncReadCallback callback = request.callback;
+          void *userdata = request.userdata;
+          void *buffer = request.buffer;
+          const Sint64 result = request.result;
+          const int error = request.error;
+          request.nextFree = io.state->freeHead;
+          io.state->freeHead = index;
+          io.inFlight--;
+          if (result < 0)
+          {
+#if defined(_WIN32)
+               SDL_SetError("Read failed (error %d)", error);
+#else
+               SDL_SetError("Read failed: %s", std::strerror(error));
+#endif
+          }
+          callback(userdata, buffer, result);
+     }
+
+#if !defined(_WIN32)
+     int asyncWorkerMain(void *data)
+     {
+          AsyncIOState &state = *(AsyncIOState *)data;
+          SDL_LockMutex(state.lock);
+          for (;;)
+          {
+               while (state.work.empty() && !state.quitting)
+               {
+                    SDL_CondWait(state.queued, state.lock);
+               }
+               if (state.work.empty())
+               {
+                    break;
+               }
+               const int index = state.work.front();
+               state.work.pop_front();
+               SDL_UnlockMutex(state.lock);
+
+               AsyncRequest &request = state.requests[index];
+               Uint32 done = 0;
+               request.result = 0;
+               while (done < request.size)
+               {
+                    const ssize_t got = pread((int)request.file->handle, (Uint8 *)request.buffer + done,
+                                              request.size - done, (off_t)(request.offset + done));
+                    if (got < 0 && errno == EINTR)
+                    {
+                         continue;
+                    }
+                    if (got < 0)
+                    {
+                         request.error = errno;
+                         request.result = -1;
+                         break;
+                    }
+                    if (got == 0)
+                    {
+                         break; // End of file
+                    }
+                    done += (Uint32)got;
+               }
+               if (request.result == 0)
+               {
+                    request.result = done;
+               }
+
+               SDL_LockMutex(state.lock);
+               state.complete.push_back(index);
+               SDL_CondSignal(state.finished);
+          }
+          SDL_UnlockMutex(state.lock);
+          return 0;
+     }
+
+     bool startWorkers(AsyncIOState &state)
+     {
+          state.lock = SDL_CreateMutex();
+          state.queued = SDL_CreateCond();
+          state.finished = SDL_CreateCond();
+          state.quitting = false;
+          if (state.lock == nullptr || state.queued == nullptr || state.finished == nullptr)
+          {
+               return false;
+          }
+          for (int i = 0; i < ASYNC_IO_WORKERS; i++)
+          {
+               SDL_Thread *thread = SDL_CreateThread(asyncWorkerMain, "async_io", &state);
+               if (thread == nullptr)
+               {
+                    return !state.workers.empty();
+               }
+               state.workers.push_back(thread);
+          }
+          return true;
+     }
+
+     void stopWorkers(AsyncIOState &state)
+     {
+          if (state.lock != nullptr)
+          {
+               SDL_LockMutex(state.lock);
+               state.quitting = true;
+               SDL_CondBroadcast(state.queued);
+               SDL_UnlockMutex(state.lock);
+          }
+          for (SDL_Thread *thread : state.workers)
+          {
+               SDL_WaitThread(thread, nullptr);
+          }
+          state.workers.clear();
+          SDL_DestroyCond(state.finished);
+          SDL_DestroyCond(state.queued);
+          SDL_DestroyMutex(state.lock);
+          state.lock = nullptr;
+     }
+#endif
+}
+
+bool asyncIOInit(AsyncIO &io, int depth)
+{
+     io.depth = SDL_max(depth, 1);
+     io.inFlight = 0;
+     io.state = new AsyncIOState;
+     AsyncIOState &state = *io.state;
+     state.requests.resize(io.depth);
+     for (int i = 0; i < io.depth; i++)
+     {
+          state.requests[i].nextFree = i + 1 < io.depth ? i + 1 : -1;
+     }
+     state.freeHead = 0;
+
+#if defined(_WIN32)
+     io.backend = ASYNC_IO_IOCP;
+     state.port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+     if (state.port == nullptr)
+     {
+          SDL_SetError("CreateIoCompletionPort failed (error %lu)", GetLastError());
+          delete io.state;
+          io.state = nullptr;
+          return false;
+     }
+     return true;
+#else
+     state.lock = nullptr;
+#if defined(ASYNC_IO_HAS_URING)
+     if (uringSetup(state.ring, (unsigned)io.depth))
+     {
+          io.backend = ASYNC_IO_URING;
+          return true;
+     }
+#endif
+     io.backend = ASYNC_IO_THREADS;
+     if (!startWorkers(state))
+     {
+          stopWorkers(state);
+          delete io.state;
+          io.state = nullptr;
+          return false;
+     }
+     return true;
+#endif
+}
+
+void asyncIOQuit(AsyncIO &io)
+{
+     if (io.state == nullptr)
+     {
+          return;
+     }
+     while (io.inFlight > 0)
+     {
+          asyncIOPoll(io, true);
+     }
+#if defined(_WIN32)
+     CloseHandle(io.state->port);
+#else
+#if defined(ASYNC_IO_HAS_URING)
+     if (io.backend == ASYNC_IO_URING)
+     {
+          uringDestroy(io.state->ring);
+     }
+#endif
+     if (io.backend == ASYNC_IO_THREADS)
+     {
+          stopWorkers(*io.state);
+     }
+#endif
+     delete io.state;
+     io.state = nullptr;
+}
+
+const char *asyncIOBackendName(AsyncIOBackend backend)
+{
+     switch (backend)
+     {
+     case ASYNC_IO_IOCP:
+          return "iocp";
+     case ASYNC_IO_URING:
+          return "io_uring";
+     default:
+          return "threads";
+     }
+}
+
+bool asyncFileOpen(AsyncIO &io, AsyncFile &file, const char *path)
+{
+     file.handle = -1;
+     file.size = -1;
+#if defined(_WIN32)
+     const int length = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+     std::vector<wchar_t> widePath(SDL_max(length, 1));
+     MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath.data(), length);
+     HANDLE handle = CreateFileW(widePath.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                 FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+     if (handle == INVALID_HANDLE_VALUE)
+     {
+          SDL_SetError("Couldn't open %s (error %lu)", path, GetLastError());
+          return false;
+     }
+     LARGE_INTEGER size;
+     if (!GetFileSizeEx(handle, &size) || CreateIoCompletionPort(handle, io.state->port, 0, 0) == nullptr)
+     {
+          SDL_SetError("Couldn't queue reads of %s (error %lu)", path, GetLastError());
+          CloseHandle(handle);
+          return false;
+     }
+     file.handle = (intptr_t)handle;
+     file.size = size.QuadPart;
+#else
+     (void)io;
+     const int fd = open(path, O_RDONLY | O_CLOEXEC);
+     struct stat info;
+     if (fd < 0 || fstat(fd, &info) != 0)
+     {
+          SDL_SetError("Couldn't open %s: %s", path, std::strerror(errno));
+          if (fd >= 0)
+          {
+               close(fd);
+          }
+          return false;
+     }
+     file.handle = fd;
+     file.size = info.st_size;
+#endif
+     return true;
+}
+
+void asyncFileClose(AsyncFile &file)
+{
+     if (file.handle == -1)
+     {
+          return;
+     }
+#if defined(_WIN32)
+     CloseHandle((HANDLE)file.handle);
+#else
+     close((int)file.handle);
+#endif
+     file.handle = -1;
+}
+
+bool asyncRead(AsyncIO &io, AsyncFile &file, Uint64 offset, void *buffer, Uint32 size, AsyncReadCallback callback,
+               void *userdata)
+{
+     AsyncIOState &state = *io.state;
+     const int index = takeRequest(state);
+     if (index < 0)
+     {
+          SDL_SetError("%d reads already in flight", io.depth);
+          return false;
+     }
+     AsyncRequest &request = state.requests[index];
+     request.file = &file;
+     request.offset = offset;
+     request.buffer = buffer;
+     request.size = size;
+     request.callback = callback;
+     request.userdata = userdata;
+     request.result = 0;
+     request.error = 0;
+     io.inFlight++;
+
+#if defined(_WIN32)
+     std::memset(&request.overlapped, 0, sizeof(request.overlapped));
+     request.overlapped.Offset = (DWORD)offset;
+     request.overlapped.OffsetHigh = (DWORD)(offset >> 32);
+     // Completion is reported through the port even when ReadFile finishes
+     // at once; only a failure to start comes back here
+     if (!ReadFile((HANDLE)file.handle, buffer, size, nullptr, &request.overlapped) &&
+         GetLastError() != ERROR_IO_PENDING)
+     {
+          const DWORD error = GetLastError();
+          request.result = error == ERROR_HANDLE_EOF ? 0 : -1;
+          request.error = (int)error;
+          state.finishedEarly.push_back(index);
+     }
+#else
+#if defined(ASYNC_IO_HAS_URING)
+     if (io.backend == ASYNC_IO_URING)
+     {
+          AsyncUring &ring = state.ring;
+          request.vector.iov_base = buffer;
+          request.vector.iov_len = size;
+          // Only this thread writes the tail; the kernel reads it after the release
+          const unsigned tail = *ring.sqTail;
+          const unsigned slot = tail & *ring.sqMask;
+          io_uring_sqe &sqe = ring.sqes[slot];
+          std::memset(&sqe, 0, sizeof(sqe));
+          sqe.opcode = IORING_OP_READV;
+          sqe.fd = (int)file.handle;
+          sqe.addr = (Uint64)(uintptr_t)&request.vector;
+          sqe.len = 1;
+          sqe.off = offset;
+          sqe.user_data = (Uint64)index;
+          ring.sqArray[slot] = slot;
+          __atomic_store_n(ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+          ring.unsubmitted++;
+          return true;
+     }
+#endif
+     SDL_LockMutex(state.lock);
+     state.work.push_back(index);
+     SDL_CondSignal(state.queued);
+     SDL_UnlockMutex(state.lock);
+#endif
+     return true;
+}
+
+int asyncIOPoll(AsyncIO &io, bool wait)
+{
+     AsyncIOState &state = *io.state;
+     int ran = 0;
+     if (!state.finishedEarly.empty())
+     {
+          std::vector<int> early;
+          early.swap(state.finishedEarly);
+          for (const int index : early)
+          {
+               completeRequest(io, index);
+               ran++;
+          }
+          wait = false;
+     }
+
+#if defined(_WIN32)
+     OVERLAPPED_ENTRY entries[64];
+     ULONG count = 0;
+     const bool waiting = wait && io.inFlight > 0;
+     if (GetQueuedCompletionStatusEx(state.port, entries, SDL_arraysize(entries), &count, waiting ? INFINITE : 0, FALSE))
+     {
+          for (ULONG i = 0; i < count; i++)
+          {
+               AsyncRequest *request = (AsyncRequest *)entries[i].lpOverlapped;
+               DWORD bytes = 0;
+               if (GetOverlappedResult((HANDLE)request->file->handle, &request->overlapped, &bytes, FALSE))
+               {
+                    request->result = bytes;
+               }
+               else
+               {
+                    const DWORD error = GetLastError();
+                    request->result = error == ERROR_HANDLE_EOF ? 0 : -1;
+                    request->error = (int)error;
+               }
+               completeRequest(io, (int)(request - state.requests.data()));
+               ran++;
+          }
+     }
+#else
+#if defined(ASYNC_IO_HAS_URING)
+     if (io.backend == ASYNC_IO_URING)
+     {
+          AsyncUring &ring = state.ring;
+          const bool waiting = wait && io.inFlight > 0 &&
+                               __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE) == *ring.cqHead;
+          if (ring.unsubmitted > 0 || waiting)
+          {
+               uringEnter(ring, waiting ? 1 : 0);
+          }
+          unsigned head = *ring.cqHead;
+          while (head != __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE))
+          {
+               const io_uring_cqe &cqe = ring.cqes[head & *ring.cqMask];
+               const int index = (int)cqe.user_data;
+               AsyncRequest &request = state.requests[index];
+               request.result = cqe.res >= 0 ? cqe.res : -1;
+               request.error = cqe.res >= 0 ? 0 : -cqe.res;
+               head++;
+               __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+               completeRequest(io, index);
+               ran++;
+          }
+          return ran;
+     }
+#endif
+     std::vector<int> finished;
+     SDL_LockMutex(state.lock);
+     while (wait && state.complete.empty() && io.inFlight > 0)
+     {
+          SDL_CondWait(state.finished, state.lock);
+     }
+     finished.swap(state.complete);
+     SDL_UnlockMutex(state.lock);
+     for (const int index : finished)
+     {
+          completeRequest(io, index);
+          ran++;
+     }
+#endif
+     return ran;
+}
@@ -0,0 +1,79 @@
+// Description:
+// Asynchronous file reads. SDL_RWread blocks the calling thread until the
+// data is in memory, so keeping N reads in flight means N threads. Here a
+// read is submitted as (file, offset, size, buffer, callback) and returns
+// at once; asyncIOPoll() later runs the callbacks of the reads that have
+// finished, on the thread that polls. One thread can so keep `depth` reads
+// queued at the disk, which is what NVMe drives need to reach their
+// throughput and what lets a streaming system fetch dozens of tiles or
+// audio chunks at a time.
+//
+// Backends, picked by asyncIOInit():
+// - Windows: overlapped ReadFile on an I/O completion port;
+// - Linux: io_uring, set up through the raw system calls;
+// - elsewhere, or where io_uring is unavailable (before Linux 5.1, or
+//   blocked by a container's seccomp policy): pread on a few worker
+//   threads, so the interface stays the same.
+//
+// An AsyncIO belongs to one thread: submit, poll and close from it only.
+// Callbacks may submit further reads. Buffers must stay valid until their
+// callback has run.
+// =============================================================================
+
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <SDL2/SDL.h>
+
+enum AsyncIOBackend
+{
+     ASYNC_IO_IOCP,
+     ASYNC_IO_URING,
+     ASYNC_IO_THREADS
+};
+
+// `result` is the bytes read, short only at the end of the file, or -1
+// with SDL_GetError() saying why
+typedef void (*AsyncReadCallback)(void *userdata, void *buffer, Sint64 result);
+
+struct AsyncFile
+{
+     intptr_t handle; // HANDLE on Windows, a file descriptor elsewhere; -1 when closed
+     Sint64 size;
+};
+
+struct AsyncIOState;
+
+struct AsyncIO
+{
+     AsyncIOBackend backend;
+     int depth;    // Reads that may be in flight at once
+     int inFlight; // Submitted, callback not yet run
+     AsyncIOState *state;
+};
+
+// Returns false with SDL's error set when no backend could start
+bool asyncIOInit(AsyncIO &io, int depth = 64);
+
+// Waits for the reads in flight, running their callbacks, then frees the
+// queue
+void asyncIOQuit(AsyncIO &io);
+
+const char *asyncIOBackendName(AsyncIOBackend backend);
+
+// Open `path` (UTF-8) for reading through `io`
+bool asyncFileOpen(AsyncIO &io, AsyncFile &file, const char *path);
+
+// No reads on the file may still be in flight
+void asyncFileClose(AsyncFile &file);
+
+// Queue a read of `size` bytes at `offset` into `buffer`. Returns false
+// when `depth` reads are already in flight; poll and try again
+bool asyncRead(AsyncIO &io, AsyncFile &file, Uint64 offset, void *buffer, Uint32 size, AsyncReadCallback callback,
+               void *userdata);
+
+// Run the callbacks of finished reads and return how many ran. With `wait`
+// it blocks until at least one finishes, unless none are in flight
+int asyncIOPoll(AsyncIO &io, bool wait);
+
+#endif // ASYNC_IO_H
@@ -0,0 +1,586 @@
+#include "async_log.h"
+
+#include <cstring>
+#include <vector>
+
+#include "atomic_ops.h"
+
+namespace
+{
+     const int LOG_CATEGORIES = 32;
+     const size_t MAX_STRING_BYTES = 1024;
+     const Uint32 FLUSH_INTERVAL_MS = 10;
+
+     // Record kinds; 0 in `state` means still being written
+     const int RECORD_TEXT = 1;       // Message text, NUL-terminated
+     const int RECORD_STRUCTURED = 2; // RecordArg[argCount], strings after their argument
+     const int RECORD_PADDING = 3;    // Fills the end of the ring; only state and bytes are valid
+
+     // Every record is a multiple of 8 bytes and starts on 8
+     struct RecordHeader
+     {
+          SDL_atomic_t state;
+          Uint32 bytes; // Whole record, header included
+          Uint16 category;
+          Uint8 priority;
+          Uint8 argCount;
+          Uint32 reserved;
+          const char *format; // Structured records
+     };
+
+     struct RecordArg
+     {
+          Uint32 type;
+          Uint32 length; // Strings: bytes that follow, NUL included, before rounding to 8
+          union
+          {
+               Sint64 i;
+               Uint64 u;
+               double d;
+               const void *p;
+          };
+     };
+
+     struct CategoryLimit
+     {
+          SDL_atomic_t perSecond;
+          SDL_atomic_t second; // The second `count` belongs to
+          SDL_atomic_t count;
+          SDL_atomic_t suppressed;
+     };
+
+     struct LogRing
+     {
+          std::vector<Uint64> storage; // Uint64 for the alignment
+          Uint8 *base;
+          Uint32 size;
+          Uint32 mask;
+
+          // Producers share head, the log thread alone moves tail
+          SDL_atomic_t head;
+          char headPadding[SDL_CACHELINE_SIZE - sizeof(SDL_atomic_t)];
+          SDL_atomic_t tail;
+          char tailPadding[SDL_CACHELINE_SIZE - sizeof(SDL_atomic_t)];
+
+          SDL_atomic_t running;
+          SDL_atomic_t quitting;
+          SDL_atomic_t wakePending;
+          SDL_atomic_t dropped;
+          SDL_Thread *thread;
+          SDL_sem *wake;
+          SDL_LogOutputFunction chained;
+          void *chainedUserdata;
+          CategoryLimit limits[LOG_CATEGORIES];
+     };
+
+     LogRing logRing;
+
+     Uint32 roundUp8(size_t bytes)
+     {
+          return (Uint32)((bytes + 7) & ~(size_t)7);
+     }
+
+     CategoryLimit &limitOf(int category)
+     {
+          return logRing.limits[SDL_clamp(category, 0, LOG_CATEGORIES - 1)];
+     }
+
+     // Counts the record against its category's limit
+     bool withinLimit(int category)
+     {
+          CategoryLimit &limit = limitOf(category);
+          const int perSecond = SDL_AtomicGet(&limit.perSecond);
+          if (perSecond <= 0)
+          {
+               return true;
+          }
+          const int second = (int)(SDL_GetTicks() / 1000);
+          int seen = SDL_AtomicGet(&limit.second);
+          if (seen != second && atomicCAS(&limit.second, seen, second, ATOMIC_ORDER_RELAXED))
+          {
+               SDL_AtomicSet(&limit.count, 0);
+          }
+          if (SDL_AtomicAdd(&limit.count, 1) < perSecond)
+          {
+               return true;
+          }
+          SDL_AtomicIncRef(&limit.suppressed);
+          return false;
+     }
+
+     // Claim `bytes` contiguous bytes of the ring, padding out its end when
+     // the record would straddle it. nullptr when the ring is full
+     RecordHeader *reserveRecord(Uint32 bytes)
+     {
+          LogRing &ring = logRing;
+          int head = atomicLoad(&ring.head, ATOMIC_ORDER_RELAXED);
+          for (;;)
+          {
+               const Uint32 at = (Uint32)head & ring.mask;
+               const Uint32 padding = at + bytes > ring.size ? ring.size - at : 0;
+               const Uint32 tail = (Uint32)atomicLoad(&ring.tail, ATOMIC_ORDER_ACQUIRE);
+               if ((Uint32)head + padding + bytes - tail > ring.size)
+               {
+                    SDL_AtomicIncRef(&ring.dropped);
+                    return nullptr;
+               }
+               if (atomicCAS(&ring.head, head, (int)((Uint32)head + padding + bytes), ATOMIC_ORDER_RELAXED))
+               {
+                    if (padding > 0)
+                    {
+                         RecordHeader *fill = (RecordHeader *)(ring.base + at);
+                         fill->bytes = padding;
+                         atomicStore(&fill->state, RECORD_PADDING, ATOMIC_ORDER_RELEASE);
+                    }
+                    // Past half full, do not wait for the flush interval
+                    if ((Uint32)head + padding + bytes - tail > ring.size / 2 &&
+                        atomicExchange(&ring.wakePending, 1, ATOMIC_ORDER_RELAXED) == 0)
+                    {
+                         SDL_SemPost(ring.wake);
+                    }
+                    return (RecordHeader *)(ring.base + (((Uint32)head + padding) & ring.mask));
+               }
+          }
+     }
+
+     void commitRecord(RecordHeader *record, int kind)
+     {
+          atomicStore(&record->state, kind, ATOMIC_ORDER_RELEASE);
+     }
+
+     void SDLCALL logHook(void *, int category, SDL_LogPriority priority, const char *message)
+     {
+          if (!withinLimit(category))
+          {
+               return;
+          }
+          const size_t length = SDL_strlen(message) + 1;
+          const Uint32 bytes = roundUp8(sizeof(RecordHeader) + length);
+          if (bytes > logRing.size / 4)
+          {
+               SDL_AtomicIncRef(&logRing.dropped);
+               return;
+          }
+          RecordHeader *record = reserveRecord(bytes);
+          if (record == nullptr)
+          {
+               return;
+          }
+          record->bytes = bytes;
+          record->category = (Uint16)category;
+          record->priority = (Uint8)priority;
+          record->argCount = 0;
+          record->format = nullptr;
+          SDL_memcpy(record + 1, message, length);
+          commitRecord(record, RECORD_TEXT);
+     }
+
+     void output(int category, SDL_LogPriority priority, const char *message)
+     {
+          // A function installed after ours gets the ring's records too
+          SDL_LogOutputFunction function;
+          void *userdata;
+          SDL_LogGetOutputFunction(&function, &userdata);
+          if (function == logHook)
+          {
+               function = logRing.chained;
+               userdata = logRing.chainedUserdata;
+          }
+          if (function != nullptr)
+          {
+               function(userdata, category, priority, message);
+          }
+     }
+
+     void writeStructured(const RecordHeader &record)
+     {
+          LogArg args[256];
+          const Uint8 *at = (const Uint8 *)(&record + 1);
+          for (int i = 0; i < record.argCount; i++)
+          {
+               const RecordArg &stored = *(const RecordArg *)at;
+               at += sizeof(RecordArg);
+               args[i].type = (LogArgType)stored.type;
+               args[i].u = stored.u;
+               if (stored.type == LOG_ARG_STRING)
+               {
+                    args[i].s = stored.length > 0 ? (const char *)at : nullptr;
+                    at += roundUp8(stored.length);
+               }
+          }
+          char text[SDL_MAX_LOG_MESSAGE];
+          asyncLogFormat(text, sizeof(text), record.format, args, record.argCount);
+          output(record.category, (SDL_LogPriority)record.priority, text);
+     }
+
+     // Write out every committed record, oldest first
+     void drainRing()
+     {
+          LogRing &ring = logRing;
+          Uint32 tail = (Uint32)atomicLoad(&ring.tail, ATOMIC_ORDER_RELAXED);
+          const Uint32 head = (Uint32)atomicLoad(&ring.head, ATOMIC_ORDER_ACQUIRE);
+          while (tail != head)
+          {
+               Uint8 *at = ring.base + (tail & ring.mask);
+               RecordHeader &record = *(RecordHeader *)at;
+               const int kind = atomicLoad(&record.state, ATOMIC_ORDER_ACQUIRE);
+               if (kind == 0)
+               {
+                    break; // Reserved, still being written
+               }
+               const Uint32 bytes = record.bytes;
+               if (kind == RECORD_TEXT)
+               {
+                    output(record.category, (SDL_LogPriority)record.priority, (const char *)(&record + 1));
+               }
+               else if (kind == RECORD_STRUCTURED)
+               {
+                    writeStructured(record);
+               }
+               // Cleared, so the next lap's headers, wherever they land, start out unwritten
+               SDL_memset(at, 0, bytes);
+               tail += bytes;
+               atomicStore(&ring.tail, (int)tail, ATOMIC_ORDER_RELEASE);
+          }
+     }
+
+     void reportLosses()
+     {
+          LogRing &ring = logRing;
+          char text[128];
+          for (int category = 0; category < LOG_CATEGORIES; category++)
+          {
+               const int suppressed = SDL_AtomicSet(&ring.limits[category].suppressed, 0);
+               if (suppressed > 0)
+               {
+                    SDL_snprintf(text, sizeof(text), "%d messages over the rate limit suppressed", suppressed);
+                    output(category, SDL_LOG_PRIORITY_WARN, text);
+               }
+          }
+          const int dropped = SDL_AtomicSet(&ring.dropped, 0);
+          if (dropped > 0)
+          {
+               SDL_snprintf(text, sizeof(text), "%d log messages dropped, the log ring was full", dropped);
+               output(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, text);
+          }
+     }
+
+     int SDLCALL logThreadMain(void *)
+     {
+          LogRing &ring = logRing;
+          for (;;)
+          {
+               const bool quitting = SDL_AtomicGet(&ring.quitting) != 0;
+               drainRing();
+               reportLosses();
+               if (quitting)
+               {
+                    break;
+               }
+               SDL_SemWaitTimeout(ring.wake, FLUSH_INTERVAL_MS);
+               SDL_AtomicSet(&ring.wakePending, 0);
+          }
+          return 0;
+     }
+
+     // Append to `text` as snprintf would, keeping it terminated
+     void appendFormatted(char *text, size_t size, size_t &used, const char *spec, const LogArg *arg)
+     {
+          if (used + 1 >= size)
+          {
+               return;
+          }
+          int written;
+          if (arg == nullptr)
+          {
+               written = SDL_snprintf(text + used, size - used, "%s", spec);
+          }
+          else if (arg->type == LOG_ARG_DOUBLE)
+          {
+               written = SDL_snprintf(text + used, size - used, spec, arg->d);
+          }
+          else if (arg->type == LOG_ARG_STRING)
+          {
+               written = SDL_snprintf(text + used, size - used, spec, arg->s != nullptr ? arg->s : "(null)");
+          }
+          else if (arg->type == LOG_ARG_POINTER)
+          {
+               written = SDL_snprintf(text + used, size - used, spec, arg->p);
+          }
+          else
+          {
+               written = SDL_snprintf(text + used, size - used, spec, arg->i);
+          }
+          used = SDL_min(used + (size_t)SDL_max(written, 0), size - 1);
+     }
+}
+
+int asyncLogFormat(char *text, size_t size, const char *format, const LogArg *args, int count)
+{
+     if (size == 0)
+     {
+          return 0;
+     }
+     size_t used = 0;
+     int next = 0;
+     text[0] = '\0';
+     const char *at = format;
+     while (*at != '\0')
+     {
+          if (*at != '%' || at[1] == '%')
+          {
+               if (used + 1 < size)
+               {
+                    text[used++] = *at;
+                    text[used] = '\0';
+               }
+               at += *at == '%' ? 2 : 1;
+               continue;
+          }
+          // %[flags][width][.precision][length]conversion, the length
+          // dropped and put back to match what was recorded
+          char spec[48];
+          size_t length = 0;
+          spec[length++] = '%';
+          const char *p = at + 1;
+          while (*p != '\0' && std::strchr("-+ #0123456789.*", *p) != nullptr && length < sizeof(spec) - 8)
+          {
+               if (*p == '*')
+               {
+                    const int star = next < count ? (int)args[next++].i : 0;
+                    length += SDL_snprintf(spec + length, sizeof(spec) - 8 - length, "%d", star);
+                    length = SDL_min(length, sizeof(spec) - 8);
+               }
+               else
+               {
+                    spec[length++] = *p;
+               }
+               p++;
+          }
+          // The bits the length names, to convert the 64-bit value the way
+          // printf would have converted the narrower argument
+          int bits = 32;
+          const char *lengthStart = p;
+          while (*p != '\0' && std::strchr("hljztLqI", *p) != nullptr)
+          {
+               const bool sized = p[0] == 'I' && ((p[1] == '6' && p[2] == '4') || (p[1] == '3' && p[2] == '2'));
+               switch (*p)
+               {
+               case 'h':
+                    bits = p > lengthStart ? 8 : 16;
+                    break;
+               case 'l':
+                    bits = p > lengthStart ? 64 : (int)sizeof(long) * 8;
+                    break;
+               case 'z':
+               case 't':
+                    bits = (int)sizeof(size_t) * 8;
+                    break;
+               case 'I':
+                    bits = sized ? (p[1] == '6' ? 64 : 32) : (int)sizeof(size_t) * 8;
+                    break;
+               default: // j, L, q
+                    bits = 64;
+                    break;
+               }
+               p += sized ? 3 : 1;
+          }
+          const char conversion = *p;
+          if (conversion == '\0')
+          {
+               break;
+          }
+          at = p + 1;
+          const LogArg *arg = next < count ? &args[next++] : nullptr;
+          const bool integer = std::strchr("diuoxXc", conversion) != nullptr;
+          const bool real = std::strchr("fFeEgGaA", conversion) != nullptr;
+          const bool wellTyped = arg != nullptr &&
+                                 ((integer && (arg->type == LOG_ARG_INT || arg->type == LOG_ARG_UINT)) ||
+                                  (real && arg->type == LOG_ARG_DOUBLE) ||
+                                  (conversion == 's' && arg->type == LOG_ARG_STRING) ||
+                                  (conversion == 'p' && arg->type == LOG_ARG_POINTER));
+          if (!wellTyped)
+          {
+               appendFormatted(text, size, used, arg == nullptr ? "<missing>" : "<mismatch>", nullptr);
+               continue;
+          }
+          if (conversion == 'c')
+          {
+               spec[length++] = 'c';
+               spec[length] = '\0';
+               char single[8];
+               SDL_snprintf(single, sizeof(single), spec, (int)arg->i);
+               appendFormatted(text, size, used, single, nullptr);
+               continue;
+          }
+          LogArg converted = *arg;
+          if (integer)
+          {
+               spec[length++] = 'l';
+               spec[length++] = 'l';
+               // So -1 logged for %x reads ffffffff, and 0xFFFFFFFF for %d reads -1
+               if (bits < 64)
+               {
+                    const Uint64 mask = ((Uint64)1 << bits) - 1;
+                    const Uint64 value = converted.u & mask;
+                    const bool isSigned = conversion == 'd' || conversion == 'i';
+                    const bool negative = isSigned && (value >> (bits - 1)) != 0;
+                    converted.u = negative ? value | ~mask : value;
+               }
+          }
+          spec[length++] = conversion;
+          spec[length] = '\0';
+          appendFormatted(text, size, used, spec, &converted);
+     }
+     return (int)used;
+}
+
+bool asyncLogStart(int ringBytes)
+{
+     LogRing &ring = logRing;
+     if (SDL_AtomicGet(&ring.running))
+     {
+          return true;
+     }
+     Uint32 size = 4096;
+     while (size < (Uint32)SDL_max(ringBytes, 0) && size < (1u << 30))
+     {
+          size <<= 1;
+     }
+     ring.storage.assign(size / sizeof(Uint64), 0);
+     ring.base = (Uint8 *)ring.storage.data();
+     ring.size = size;
+     ring.mask = size - 1;
+     SDL_AtomicSet(&ring.head, 0);
+     SDL_AtomicSet(&ring.tail, 0);
+     SDL_AtomicSet(&ring.quitting, 0);
+     SDL_AtomicSet(&ring.wakePending, 0);
+     SDL_AtomicSet(&ring.dropped, 0);
+     ring.wake = SDL_CreateSemaphore(0);
+     ring.thread = ring.wake != nullptr ? SDL_CreateThread(logThreadMain, "async_log", nullptr) : nullptr;
+     if (ring.thread == nullptr)
+     {
+          if (ring.wake != nullptr)
+          {
+               SDL_DestroySemaphore(ring.wake);
+               ring.wake = nullptr;
+          }
+          ring.storage.clear();
+          return false;
+     }
+     SDL_LogGetOutputFunction(&ring.chained, &ring.chainedUserdata);
+     SDL_LogSetOutputFunction(logHook, nullptr);
+     SDL_AtomicSet(&ring.running, 1);
+     return true;
+}
+
+void asyncLogStop()
+{
+     LogRing &ring = logRing;
+     if (!SDL_AtomicGet(&ring.running))
+     {
+          return;
+     }
+     // The thread drains once more on its way out
+     SDL_AtomicSet(&ring.quitting, 1);
+     SDL_SemPost(ring.wake);
+     SDL_WaitThread(ring.thread, nullptr);
+     ring.thread = nullptr;
+     SDL_LogOutputFunction function;
+     void *userdata;
+     SDL_LogGetOutputFunction(&function, &userdata);
+     if (function == logHook)
+     {
+          SDL_LogSetOutputFunction(ring.chained, ring.chainedUserdata);
+     }
+     SDL_AtomicSet(&ring.running, 0);
+     // Whatever this thread logged while the log thread was finishing
+     drainRing();
+     reportLosses();
+     SDL_DestroySemaphore(ring.wake);
+     ring.wake = nullptr;
+     ring.storage.clear();
+     ring.storage.shrink_to_fit();
+     ring.base = nullptr;
+}
+
+void asyncLogFlush()
+{
+     LogRing &ring = logRing;
+     if (!SDL_AtomicGet(&ring.running))
+     {
+          return;
+     }
+     const Uint32 target = (Uint32)atomicLoad(&ring.head, ATOMIC_ORDER_ACQUIRE);
+     while ((Sint32)(target - (Uint32)atomicLoad(&ring.tail, ATOMIC_ORDER_ACQUIRE)) > 0)
+     {
+          SDL_SemPost(ring.wake);
+          SDL_Delay(1);
+     }
+}
+
+void asyncLogSetRateLimit(int category, int perSecond)
+{
+     SDL_AtomicSet(&limitOf(category).perSecond, SDL_max(perSecond, 0));
+}
+
+void asyncLogWrite(int category, SDL_LogPriority priority, const char *format, const LogArg *args, int count)
+{
+     if (priority < SDL_LogGetPriority(category))
+     {
+          return;
+     }
+     if (!SDL_AtomicGet(&logRing.running))
+     {
+          char text[SDL_MAX_LOG_MESSAGE];
+          asyncLogFormat(text, sizeof(text), format, args, count);
+          SDL_LogMessage(category, priority, "%s", text);
+          return;
+     }
+     if (!withinLimit(category))
+     {
+          return;
+     }
+     count = SDL_clamp(count, 0, 255);
+     size_t bytes = sizeof(RecordHeader) + count * sizeof(RecordArg);
+     for (int i = 0; i < count; i++)
+     {
+          if (args[i].type == LOG_ARG_STRING && args[i].s != nullptr)
+          {
+               bytes += roundUp8(SDL_min(SDL_strlen(args[i].s), MAX_STRING_BYTES - 1) + 1);
+          }
+     }
+     if (bytes > logRing.size / 4)
+     {
+          SDL_AtomicIncRef(&logRing.dropped);
+          return;
+     }
+     RecordHeader *record = reserveRecord((Uint32)bytes);
+     if (record == nullptr)
+     {
+          return;
+     }
+     record->bytes = (Uint32)bytes;
+     record->category = (Uint16)category;
+     record->priority = (Uint8)priority;
+     record->argCount = (Uint8)count;
+     record->format = format;
+     Uint8 *at = (Uint8 *)(record + 1);
+     for (int i = 0; i < count; i++)
+     {
+          RecordArg &stored = *(RecordArg *)at;
+          at += sizeof(RecordArg);
+          stored.type = args[i].type;
+          stored.length = 0;
+          stored.u = args[i].u;
+          if (args[i].type == LOG_ARG_STRING && args[i].s != nullptr)
+          {
+               const size_t length = SDL_min(SDL_strlen(args[i].s), MAX_STRING_BYTES - 1);
+               SDL_memcpy(at, args[i].s, length);
+               at[length] = '\0';
+               stored.length = (Uint32)(length + 1);
+               at += roundUp8(length + 1);
+          }
+     }
+     commitRecord(record, RECORD_STRUCTURED);
+}
@@ -0,0 +1,166 @@
+// Description:
+// Logging off the calling thread. SDL_Log formats the message and hands
+// it to the output function, which writes it to the console (and the
+// debugger on Windows) before SDL_Log returns; a console that scrolls
+// slowly stalls the frame that logged. While asyncLogStart() is in
+// effect:
+//
+// - SDL_Log and SDL_LogMessage still format in the caller, but only copy
+//   the text into a lock-free ring; the output function runs later, on
+//   the log thread.
+// - asyncLog() does not format at all: it stores the format pointer and
+//   the raw arguments (integers, doubles, pointers, copied strings) as a
+//   binary record, and the log thread formats them with the same printf
+//   conventions. The format must be a string literal, or otherwise
+//   outlive the record.
+//
+// Records reach whatever SDL_LogSetOutputFunction installed: the function
+// from before asyncLogStart(), or one set afterwards, which then gets the
+// ring's records too. It is called only from the log thread, in the order
+// the records were reserved. SDL_LogSetPriority() filters both paths.
+//
+// A full ring drops records instead of blocking, and asyncLogSetRateLimit()
+// caps a category's records per second; both losses are reported as one
+// warning per category when the log thread next flushes. Stop the threads
+// that log before asyncLogStop().
+// =============================================================================
+
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <SDL2/SDL.h>
+
+#define ASYNC_LOG_DEFAULT_RING (256 * 1024)
+
+enum LogArgType
+{
+     LOG_ARG_INT,
+     LOG_ARG_UINT,
+     LOG_ARG_DOUBLE,
+     LOG_ARG_STRING,
+     LOG_ARG_POINTER
+};
+
+struct LogArg
+{
+     LogArgType type;
+     union
+     {
+          Sint64 i;
+          Uint64 u;
+          double d;
+          const char *s; // Copied into the record, up to 1 KB
+          const void *p;
+     };
+};
+
+// Arguments by type, so that asyncLog() records each one the way printf
+// would read it; anything else (std::string, structs) does not compile
+inline LogArg logArgInt(Sint64 value)
+{
+     LogArg arg;
+     arg.type = LOG_ARG_INT;
+     arg.i = value;
+     return arg;
+}
+
+inline LogArg logArgUint(Uint64 value)
+{
+     LogArg arg;
+     arg.type = LOG_ARG_UINT;
+     arg.u = value;
+     return arg;
+}
+
+inline LogArg logArg(int value)
+{
+     return logArgInt(value);
+}
+
+inline LogArg logArg(long value)
+{
+     return logArgInt(value);
+}
+
+inline LogArg logArg(long long value)
+{
+     return logArgInt(value);
+}
+
+inline LogArg logArg(unsigned value)
+{
+     return logArgUint(value);
+}
+
+inline LogArg logArg(unsigned long value)
+{
+     return logArgUint(value);
+}
+
+inline LogArg logArg(unsigned long long value)
+{
+     return logArgUint(value);
+}
+
+inline LogArg logArg(double value)
+{
+     LogArg arg;
+     arg.type = LOG_ARG_DOUBLE;
+     arg.d = value;
+     return arg;
+}
+
+inline LogArg logArg(const char *value)
+{
+     LogArg arg;
+     arg.type = LOG_ARG_STRING;
+     arg.s = value;
+     return arg;
+}
+
+template <typename T>
+inline LogArg logArg(const T *value)
+{
+     LogArg arg;
+     arg.type = LOG_ARG_POINTER;
+     arg.p = value;
+     return arg;
+}
+
+// Start the log thread and route SDL's log output through a ring of
+// `ringBytes` (rounded up to a power of two). Returns false with SDL's
+// error set
+bool asyncLogStart(int ringBytes = ASYNC_LOG_DEFAULT_RING);
+
+// Write out what is queued, put back the output function that was there
+// before (unless something replaced ours since) and end the thread
+void asyncLogStop();
+
+// Wait until everything logged so far has been written
+void asyncLogFlush();
+
+// At most `perSecond` records a second for `category`; 0 for no limit.
+// Categories from 31 up share one limit
+void asyncLogSetRateLimit(int category, int perSecond);
+
+// The record behind asyncLog(). Without the log thread it formats and
+// calls SDL_LogMessage at once
+void asyncLogWrite(int category, SDL_LogPriority priority, const char *format, const LogArg *args, int count);
+
+// Format `format` with `args` as printf would; the log thread's formatter
+int asyncLogFormat(char *text, size_t size, const char *format, const LogArg *args, int count);
+
+template <typename... Args>
+void asyncLog(int category, SDL_LogPriority priority, const char *format, const Args &...args)
+{
+     const LogArg packed[] = {logArg(args)..., logArg(0)};
+     asyncLogWrite(category, priority, format, packed, (int)sizeof...(Args));
+}
+
+template <typename... Args>
+void asyncLogInfo(int category, const char *format, const Args &...args)
+{
+     asyncLog(category, SDL_LOG_PRIORITY_INFO, format, args...);
+}
+
+#endif // ASYNC_LOG_H
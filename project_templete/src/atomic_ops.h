@@ -0,0 +1,281 @@
+// Description:
+// The atomics SDL_atomic.h leaves out. SDL has 32-bit add, get, set and
+// CAS plus a pointer CAS, all sequentially consistent. Lock-free code here
+// also needs:
+//
+// - Memory orders. A queue slot published with a release store and read
+//   with an acquire load needs no full fence, which on ARM and in the
+//   compiler's freedom to reorder is real cost. The AtomicOrder variants
+//   work on the existing SDL_atomic_t, so they mix with SDL's own calls.
+// - 64-bit counters (Atomic64), for byte totals past 2 GB and counter
+//   stamps that must not wrap. On 32-bit x86 these are cmpxchg8b based.
+// - Double-width CAS (AtomicTagged): a pointer and a tag swapped together,
+//   cmpxchg16b on x86-64. Bumping the tag on every change stops the ABA
+//   problem, where a CAS succeeds because a node was freed and reused at
+//   the same address between the load and the swap.
+//
+// These are inline, unlike the rest of src/, because an atomic behind a
+// function call loses most of what it was chosen for. Everything here is
+// wait-free except atomicTaggedLoad and the CAS loops callers build.
+// =============================================================================
+
+#ifndef ATOMIC_OPS_H
+#define ATOMIC_OPS_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#if !defined(_M_X64) && !defined(_M_IX86)
+#error "atomic_ops.h supports MSVC on x86 and x64 only"
+#endif
+#include <intrin.h>
+#endif
+
+enum AtomicOrder
+{
+     ATOMIC_ORDER_RELAXED, // Atomic, no ordering of other memory
+     ATOMIC_ORDER_ACQUIRE, // Later accesses stay after a load
+     ATOMIC_ORDER_RELEASE, // Earlier accesses stay before a store
+     ATOMIC_ORDER_ACQ_REL, // Both, for read-modify-writes
+     ATOMIC_ORDER_SEQ_CST  // One total order, what SDL_Atomic* gives
+};
+
+struct alignas(8) Atomic64
+{
+     Sint64 value;
+};
+
+// A pointer and a counter updated as one unit
+struct alignas(2 * sizeof(void *)) AtomicTagged
+{
+     void *pointer;
+     uintptr_t tag;
+};
+
+#if defined(__GNUC__) || defined(__clang__)
+
+// Orders a CAS failure may use: never stronger than success, never release
+#define ATOMIC_OPS_BUILTIN(order)                                                          \
+     ((order) == ATOMIC_ORDER_RELAXED ? __ATOMIC_RELAXED                                   \
+      : (order) == ATOMIC_ORDER_ACQUIRE ? __ATOMIC_ACQUIRE                                 \
+      : (order) == ATOMIC_ORDER_RELEASE ? __ATOMIC_RELEASE                                 \
+      : (order) == ATOMIC_ORDER_ACQ_REL ? __ATOMIC_ACQ_REL                                 \
+                                        : __ATOMIC_SEQ_CST)
+#define ATOMIC_OPS_FAILURE(order)                                                          \
+     ((order) == ATOMIC_ORDER_RELAXED || (order) == ATOMIC_ORDER_RELEASE ? __ATOMIC_RELAXED \
+      : (order) == ATOMIC_ORDER_SEQ_CST                                 ? __ATOMIC_SEQ_CST \
+                                                                        : __ATOMIC_ACQUIRE)
+
+// 32-bit, on SDL's type
+inline int atomicLoad(SDL_atomic_t *a, AtomicOrder order)
+{
+     return __atomic_load_n(&a->value, ATOMIC_OPS_BUILTIN(order));
+}
+
+inline void atomicStore(SDL_atomic_t *a, int v, AtomicOrder order)
+{
+     __atomic_store_n(&a->value, v, ATOMIC_OPS_BUILTIN(order));
+}
+
+// Returns the value before the add
+inline int atomicFetchAdd(SDL_atomic_t *a, int v, AtomicOrder order)
+{
+     return __atomic_fetch_add(&a->value, v, ATOMIC_OPS_BUILTIN(order));
+}
+
+inline int atomicExchange(SDL_atomic_t *a, int v, AtomicOrder order)
+{
+     return __atomic_exchange_n(&a->value, v, ATOMIC_OPS_BUILTIN(order));
+}
+
+// On failure `expected` receives the current value, ready for a retry
+inline bool atomicCAS(SDL_atomic_t *a, int &expected, int desired, AtomicOrder order)
+{
+     return __atomic_compare_exchange_n(&a->value, &expected, desired, false, ATOMIC_OPS_BUILTIN(order),
+                                        ATOMIC_OPS_FAILURE(order));
+}
+
+// 64-bit
+inline Sint64 atomic64Load(Atomic64 *a, AtomicOrder order = ATOMIC_ORDER_SEQ_CST)
+{
+     return __atomic_load_n(&a->value, ATOMIC_OPS_BUILTIN(order));
+}
+
+inline void atomic64Store(Atomic64 *a, Sint64 v, AtomicOrder order = ATOMIC_ORDER_SEQ_CST)
+{
+     __atomic_store_n(&a->value, v, ATOMIC_OPS_BUILTIN(order));
+}
+
+inline Sint64 atomic64FetchAdd(Atomic64 *a, Sint64 v, AtomicOrder order = ATOMIC_ORDER_SEQ_CST)
+{
+     return __atomic_fetch_add(&a->value, v, ATOMIC_OPS_BUILTIN(order));
+}
+
+inline Sint64 atomic64Exchange(Atomic64 *a, Sint64 v, AtomicOrder order = ATOMIC_ORDER_SEQ_CST)
+{
+     return __atomic_exchange_n(&a->value, v, ATOMIC_OPS_BUILTIN(order));
+}
+
+inline bool atomic64CAS(Atomic64 *a, Sint64 &expected, Sint64 desired, AtomicOrder order = ATOMIC_ORDER_SEQ_CST)
+{
+     return __atomic_compare_exchange_n(&a->value, &expected, desired, false, ATOMIC_OPS_BUILTIN(order),
+                                        ATOMIC_OPS_FAILURE(order));
+}
+
+// Double width; always sequentially consistent, as the instructions are
+inline bool atomicTaggedCAS(AtomicTagged *a, AtomicTagged &expected, AtomicTagged desired)
+{
+#if defined(__x86_64__)
+     bool swapped;
+     __asm__ __volatile__("lock cmpxchg16b %1\n\tsetz %0"
+                          : "=q"(swapped), "+m"(*a), "+a"(expected.pointer), "+d"(expected.tag)
+                          : "b"(desired.pointer), "c"(desired.tag)
+                          : "memory", "cc");
+     return swapped;
+#elif UINTPTR_MAX == 0xffffffffu
+     Uint64 current, replacement;
+     SDL_memcpy(&current, &expected, sizeof(current));
+     SDL_memcpy(&replacement, &desired, sizeof(replacement));
+     const bool swapped = __atomic_compare_exchange_n((Uint64 *)a, &current, replacement, false, __ATOMIC_SEQ_CST,
+                                                      __ATOMIC_SEQ_CST);
+     SDL_memcpy(&expected, &current, sizeof(current));
+     return swapped;
+#else
+     unsigned __int128 current, replacement;
+     SDL_memcpy(&current, &expected, sizeof(current));
+     SDL_memcpy(&replacement, &desired, sizeof(replacement));
+     const bool swapped = __atomic_compare_exchange_n((unsigned __int128 *)a, &current, replacement, false,
+                                                      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+     SDL_memcpy(&expected, &current, sizeof(current));
+     return swapped;
+#endif
+}
+
+#undef ATOMIC_OPS_BUILTIN
+#undef ATOMIC_OPS_FAILURE
+
+#else // MSVC: every interlocked call is a full barrier, and x86 loads acquire
+
+inline int atomicLoad(SDL_atomic_t *a, AtomicOrder)
+{
+     const int v = *(volatile int *)&a->value;
+     _ReadWriteBarrier();
+     return v;
+}
+
+inline void atomicStore(SDL_atomic_t *a, int v, AtomicOrder order)
+{
+     if (order == ATOMIC_ORDER_SEQ_CST)
+     {
+          _InterlockedExchange((volatile long *)&a->value, v);
+          return;
+     }
+     _ReadWriteBarrier();
+     *(volatile int *)&a->value = v;
+}
+
+inline int atomicFetchAdd(SDL_atomic_t *a, int v, AtomicOrder)
+{
+     return _InterlockedExchangeAdd((volatile long *)&a->value, v);
+}
+
+inline int atomicExchange(SDL_atomic_t *a, int v, AtomicOrder)
+{
+     return _InterlockedExchange((volatile long *)&a->value, v);
+}
+
+inline bool atomicCAS(SDL_atomic_t *a, int &expected, int desired, AtomicOrder)
+{
+     const int previous = _InterlockedCompareExchange((volatile long *)&a->value, desired, expected);
+     const bool swapped = previous == expected;
+     expected = previous;
+     return swapped;
+}
+
+inline bool atomic64CAS(Atomic64 *a, Sint64 &expected, Sint64 desired, AtomicOrder = ATOMIC_ORDER_SEQ_CST)
+{
+     const Sint64 previous = _InterlockedCompareExchange64((volatile __int64 *)&a->value, desired, expected);
+     const bool swapped = previous == expected;
+     expected = previous;
+     return swapped;
+}
+
+inline Sint64 atomic64Load(Atomic64 *a, AtomicOrder = ATOMIC_ORDER_SEQ_CST)
+{
+#if defined(_M_X64)
+     const Sint64 v = *(volatile Sint64 *)&a->value;
+     _ReadWriteBarrier();
+     return v;
+#else
+     return _InterlockedCompareExchange64((volatile __int64 *)&a->value, 0, 0);
+#endif
+}
+
+inline Sint64 atomic64Exchange(Atomic64 *a, Sint64 v, AtomicOrder = ATOMIC_ORDER_SEQ_CST)
+{
+#if defined(_M_X64)
+     return _InterlockedExchange64((volatile __int64 *)&a->value, v);
+#else
+     Sint64 expected = atomic64Load(a);
+     while (!atomic64CAS(a, expected, v))
+     {
+     }
+     return expected;
+#endif
+}
+
+inline void atomic64Store(Atomic64 *a, Sint64 v, AtomicOrder = ATOMIC_ORDER_SEQ_CST)
+{
+     atomic64Exchange(a, v);
+}
+
+inline Sint64 atomic64FetchAdd(Atomic64 *a, Sint64 v, AtomicOrder = ATOMIC_ORDER_SEQ_CST)
+{
+#if defined(_M_X64)
+     return _InterlockedExchangeAdd64((volatile __int64 *)&a->value, v);
+#else
+     Sint64 expected = atomic64Load(a);
+     while (!atomic64CAS(a, expected, expected + v))
+     {
+     }
+     return expected;
+#endif
+}
+
+inline bool atomicTaggedCAS(AtomicTagged *a, AtomicTagged &expected, AtomicTagged desired)
+{
+#if defined(_M_X64)
+     return _InterlockedCompareExchange128((volatile __int64 *)a, (__int64)desired.tag, (__int64)desired.pointer,
+                                           (__int64 *)&expected) != 0;
+#else
+     Sint64 current, replacement;
+     SDL_memcpy(&current, &expected, sizeof(current));
+     SDL_memcpy(&replacement, &desired, sizeof(replacement));
+     const Sint64 previous = _InterlockedCompareExchange64((volatile __int64 *)a, replacement, current);
+     SDL_memcpy(&expected, &previous, sizeof(previous));
+     return previous == current;
+#endif
+}
+
+#endif
+
+// A consistent snapshot of both words. Reading them one by one could mix
+// two versions; a CAS that replaces the value with itself cannot
+inline AtomicTagged atomicTaggedLoad(AtomicTagged *a)
+{
+     AtomicTagged snapshot = {nullptr, 0};
+     atomicTaggedCAS(a, snapshot, snapshot);
+     return snapshot;
+}
+
+// Store by swapping until the value seen is the one replaced
+inline void atomicTaggedStore(AtomicTagged *a, AtomicTagged desired)
+{
+     AtomicTagged expected = {nullptr, 0};
+     while (!atomicTaggedCAS(a, expected, desired))
+     {
+     }
+}
+
+#endif // ATOMIC_OPS_H
@@ -0,0 +1,277 @@
+#include "audio_budget.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <time.h>
+#endif
+
+namespace
+{
+     // Thread cycles are converted once this much time has been sampled
+     const double CALIBRATION_SECONDS = 0.25;
+
+     const char *STAGE_NAMES[AUDIO_STAGE_COUNT] = {"music", "channels", "post effects", "postmix", "total"};
+
+     int bucketFor(Uint64 ticks)
+     {
+          const Uint64 micros = ticks * 1000000 / SDL_GetPerformanceFrequency();
+          int bucket = 0;
+          while (bucket < AUDIO_BUDGET_BUCKETS - 1 && micros >= (Uint64)16 << bucket)
+          {
+               bucket++;
+          }
+          return bucket;
+     }
+
+     double budgetTicksToMs(Uint64 ticks)
+     {
+          return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+     }
+
+     // CPU time the audio thread has used, in performance counter ticks.
+     // Windows counts the thread's cycles, which run at the TSC's rate; the
+     // rate is measured against the performance counter over the first
+     // callbacks, and 0 is returned until it is known. 0 too where there is
+     // no per-thread clock.
+     Uint64 threadCpuTicks(AudioBudget &budget)
+     {
+#if defined(_WIN32)
+          ULONG64 cycles = 0;
+          if (!QueryThreadCycleTime(GetCurrentThread(), &cycles))
+          {
+               return 0;
+          }
+          if (budget.ticksPerCycle == 0.0)
+          {
+               const Uint64 tsc = __rdtsc();
+               const Uint64 now = SDL_GetPerformanceCounter();
+               if (budget.calibrationTicks == 0)
+               {
+                    budget.calibrationCycles = tsc;
+                    budget.calibrationTicks = now;
+                    return 0;
+               }
+               if (now - budget.calibrationTicks < CALIBRATION_SECONDS * SDL_GetPerformanceFrequency() ||
+                   tsc <= budget.calibrationCycles)
+               {
+                    return 0;
+               }
+               budget.ticksPerCycle = (double)(now - budget.calibrationTicks) / (double)(tsc - budget.calibrationCycles);
+          }
+          return (Uint64)(cycles * budget.ticksPerCycle);
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+          (void)budget;
+          timespec now;
+          if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0)
+          {
+               return 0;
+          }
+          const Uint64 ns = (Uint64)now.tv_sec * 1000000000u + (Uint64)now.tv_nsec;
+          return (Uint64)(ns * (SDL_GetPerformanceFrequency() / 1e9));
+#else
+          (void)budget;
+          return 0;
+#endif
+     }
+
+     // Starts the POST_EFFECTS stage; effects registered before the budget
+     // run ahead of it and count as channel mixing
+     void postEffectsProbe(int, void *, int, void *udata)
+     {
+          AudioBudget &budget = *(AudioBudget *)udata;
+          budget.postEffectsStart = SDL_GetPerformanceCounter();
+     }
+
+     // Last in the callback: forward to the client, then close the books
+     void budgetPostMix(void *udata, Uint8 *stream, int len)
+     {
+          AudioBudget &budget = *(AudioBudget *)udata;
+          const Uint64 postMixStart = SDL_GetPerformanceCounter();
+          if (budget.postMix != nullptr)
+          {
+               budget.postMix(budget.postMixArg, stream, len);
+          }
+          const Uint64 end = SDL_GetPerformanceCounter();
+          const Uint64 cpu = threadCpuTicks(budget);
+          const Uint64 lastCpu = budget.lastCpuTicks;
+          budget.lastCpuTicks = cpu;
+
+          // A probe that did not fire leaves its stage at zero
+          Uint64 stages[AUDIO_STAGE_COUNT] = {};
+          const bool music = budget.musicStart != 0 && budget.musicEnd >= budget.musicStart;
+          const Uint64 postEffects = budget.postEffectsStart != 0 ? budget.postEffectsStart : postMixStart;
+          stages[AUDIO_STAGE_MUSIC] = music ? budget.musicEnd - budget.musicStart : 0;
+          stages[AUDIO_STAGE_POST_EFFECTS] = postMixStart - postEffects;
+          stages[AUDIO_STAGE_POSTMIX] = end - postMixStart;
+          const Uint64 probed = stages[AUDIO_STAGE_MUSIC] + stages[AUDIO_STAGE_POST_EFFECTS] + stages[AUDIO_STAGE_POSTMIX];
+          const Uint64 earliest = music ? budget.musicStart : postEffects;
+          budget.musicStart = 0;
+          budget.musicEnd = 0;
+          budget.postEffectsStart = 0;
+          if (cpu != 0 && lastCpu == 0)
+          {
+               return; // The first CPU sample only sets the baseline
+          }
+          // Wall-timed probes can include preemption the CPU clock skips,
+          // so the total never drops below their sum
+          stages[AUDIO_STAGE_TOTAL] = cpu != 0 ? SDL_max(cpu - lastCpu, probed) : end - earliest;
+          stages[AUDIO_STAGE_CHANNELS] = stages[AUDIO_STAGE_TOTAL] - SDL_min(probed, stages[AUDIO_STAGE_TOTAL]);
+
+          SDL_AtomicLock(&budget.lock);
+          budget.callbacks++;
+          for (int stage = 0; stage < AUDIO_STAGE_COUNT; stage++)
+          {
+               budget.stageTicks[stage] += stages[stage];
+               budget.stageMaxTicks[stage] = SDL_max(budget.stageMaxTicks[stage], stages[stage]);
+               budget.histogram[stage][bucketFor(stages[stage])]++;
+          }
+          const Uint64 total = stages[AUDIO_STAGE_TOTAL];
+          if (total > budget.deadlineTicks)
+          {
+               budget.deadlineMisses++;
+               SDL_memcpy(budget.lastMissTicks, stages, sizeof(stages));
+          }
+          if (total > (Uint64)(budget.deadlineTicks * budget.warnFraction))
+          {
+               budget.heavyCallbacks++;
+          }
+          SDL_AtomicUnlock(&budget.lock);
+     }
+}
+
+void audioBudgetInit(AudioBudget &budget, int periodFrames, int frequency, double warnFraction, bool log)
+{
+     budget.deadlineMs = frequency > 0 ? periodFrames * 1000.0 / frequency : 0.0;
+     budget.deadlineTicks = frequency > 0 ? SDL_GetPerformanceFrequency() * periodFrames / frequency : 0;
+     budget.warnFraction = warnFraction;
+     budget.log = log;
+     budget.attached = false;
+     budget.postMix = nullptr;
+     budget.postMixArg = nullptr;
+     budget.musicStart = 0;
+     budget.musicEnd = 0;
+     budget.postEffectsStart = 0;
+     budget.lastCpuTicks = 0;
+     budget.calibrationCycles = 0;
+     budget.calibrationTicks = 0;
+     budget.ticksPerCycle = 0.0;
+     budget.lock = 0;
+     budget.callbacks = 0;
+     budget.heavyCallbacks = 0;
+     budget.deadlineMisses = 0;
+     SDL_zeroa(budget.stageTicks);
+     SDL_zeroa(budget.stageMaxTicks);
+     SDL_zeroa(budget.histogram);
+     SDL_zeroa(budget.lastMissTicks);
+     budget.loggedMisses = 0;
+}
+
+bool audioBudgetAttach(AudioBudget &budget)
+{
+     int freq, channels;
+     Uint16 format;
+     if (Mix_QuerySpec(&freq, &format, &channels) == 0)
+     {
+          std::cerr << "Audio budget needs an open mixer! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          return false;
+     }
+
+     if (Mix_RegisterEffect(MIX_CHANNEL_POST, postEffectsProbe, NULL, &budget) == 0)
+     {
+          std::cerr << "Unable to attach the audio budget! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          return false;
+     }
+     Mix_SetPostMix(budgetPostMix, &budget);
+     budget.attached = true;
+     return true;
+}
+
+void audioBudgetSetPostMix(AudioBudget &budget, void (*postMix)(void *udata, Uint8 *stream, int len), void *udata)
+{
+     // Unhooking waits for the callback to leave, so it never sees a
+     // half-swapped pair; set this up before sound starts
+     if (budget.attached)
+     {
+          Mix_SetPostMix(NULL, NULL);
+     }
+     budget.postMix = postMix;
+     budget.postMixArg = udata;
+     if (budget.attached)
+     {
+          Mix_SetPostMix(budgetPostMix, &budget);
+     }
+}
+
+void audioBudgetMusicBegin(AudioBudget &budget)
+{
+     budget.musicStart = SDL_GetPerformanceCounter();
+}
+
+void audioBudgetMusicEnd(AudioBudget &budget)
+{
+     budget.musicEnd = SDL_GetPerformanceCounter();
+}
+
+void audioBudgetUpdate(AudioBudget &budget)
+{
+     if (!budget.attached || !budget.log)
+     {
+          return;
+     }
+     SDL_AtomicLock(&budget.lock);
+     const int misses = budget.deadlineMisses;
+     Uint64 last[AUDIO_STAGE_COUNT];
+     SDL_memcpy(last, budget.lastMissTicks, sizeof(last));
+     SDL_AtomicUnlock(&budget.lock);
+     if (misses > budget.loggedMisses)
+     {
+          SDL_Log("Audio callback missed its %.2f ms deadline (%d so far): %.2f ms, music %.2f, channels %.2f, "
+                  "post effects %.2f, postmix %.2f",
+                  budget.deadlineMs, misses, budgetTicksToMs(last[AUDIO_STAGE_TOTAL]), budgetTicksToMs(last[AUDIO_STAGE_MUSIC]),
+                  budgetTicksToMs(last[AUDIO_STAGE_CHANNELS]), budgetTicksToMs(last[AUDIO_STAGE_POST_EFFECTS]),
+                  budgetTicksToMs(last[AUDIO_STAGE_POSTMIX]));
+          budget.loggedMisses = misses;
+     }
+}
+
+AudioBudgetStats audioBudgetGetStats(AudioBudget &budget)
+{
+     AudioBudgetStats stats;
+     stats.deadlineMs = budget.deadlineMs;
+     SDL_AtomicLock(&budget.lock);
+     stats.callbacks = budget.callbacks;
+     stats.heavyCallbacks = budget.heavyCallbacks;
+     stats.deadlineMisses = budget.deadlineMisses;
+     for (int stage = 0; stage < AUDIO_STAGE_COUNT; stage++)
+     {
+          AudioStageStats &out = stats.stages[stage];
+          out.averageMs = budget.callbacks > 0 ? budgetTicksToMs(budget.stageTicks[stage]) / budget.callbacks : 0.0;
+          out.maxMs = budgetTicksToMs(budget.stageMaxTicks[stage]);
+          SDL_memcpy(out.histogram, budget.histogram[stage], sizeof(out.histogram));
+     }
+     SDL_AtomicUnlock(&budget.lock);
+     return stats;
+}
+
+const char *audioBudgetStageName(AudioStage stage)
+{
+     return stage >= 0 && stage < AUDIO_STAGE_COUNT ? STAGE_NAMES[stage] : "unknown";
+}
+
+void audioBudgetDetach(AudioBudget &budget)
+{
+     if (!budget.attached)
+     {
+          return;
+     }
+     // Each call takes the audio lock, so the callback is out of the
+     // probes once they return
+     Mix_SetPostMix(NULL, NULL);
+     Mix_UnregisterEffect(MIX_CHANNEL_POST, postEffectsProbe);
+     budget.attached = false;
+}
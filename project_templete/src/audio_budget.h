@@ -0,0 +1,125 @@
+// Description:
+// Audio thread CPU budget. Times every SDL_mixer callback against its
+// deadline, the time one buffer takes to play, and splits it into stages:
+// - MUSIC: a hooked music stream's callback (see musicStreamInit)
+// - CHANNELS: the rest of the callback: Mix_PlayMusic decoding, mixing
+//   every channel with its own effects, and SDL's own work on the thread
+// - POST_EFFECTS: the MIX_CHANNEL_POST effects registered after attaching
+// - POSTMIX: the Mix_SetPostMix callback, chained through here
+//
+// SDL_mixer has no callback-start hook, and the postmix is the one callback
+// it always runs last. The budget owns that slot, forwards it to one
+// client, and takes the callback's cost as the audio thread's CPU time
+// since the previous postmix: it keeps no mixer channel and needs no probe
+// to run first. MUSIC, POST_EFFECTS and POSTMIX are timed by their own
+// probes; CHANNELS is what remains. Where the platform has no precise
+// per-thread clock the total falls back to the wall time from the
+// earliest probe, which leaves channel mixing out.
+//
+// Stage times go into log2 histograms; callbacks that overrun the deadline
+// are counted as misses, and those over `warnFraction` of it as heavy, so
+// overloads show up before a miss is heard. With logging on, every miss
+// is reported through SDL_Log from audioBudgetUpdate().
+// =============================================================================
+
+#ifndef AUDIO_BUDGET_H
+#define AUDIO_BUDGET_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+
+#define AUDIO_BUDGET_LOG_HINT "CATCH_AUDIO_BUDGET_LOG"
+
+enum AudioStage
+{
+     AUDIO_STAGE_MUSIC,
+     AUDIO_STAGE_CHANNELS,
+     AUDIO_STAGE_POST_EFFECTS,
+     AUDIO_STAGE_POSTMIX,
+     AUDIO_STAGE_TOTAL, // First probe to the end of the postmix
+     AUDIO_STAGE_COUNT
+};
+
+// Bucket 0 holds times under 16 us, bucket i under 16 << i us; the last
+// one takes everything from 16 ms up
+const int AUDIO_BUDGET_BUCKETS = 12;
+
+struct AudioStageStats
+{
+     double averageMs;
+     double maxMs;
+     int histogram[AUDIO_BUDGET_BUCKETS];
+};
+
+struct AudioBudgetStats
+{
+     double deadlineMs; // One buffer period
+     int callbacks;
+     int heavyCallbacks;
+     int deadlineMisses;
+     AudioStageStats stages[AUDIO_STAGE_COUNT];
+};
+
+struct AudioBudget
+{
+     double deadlineMs;
+     Uint64 deadlineTicks;
+     double warnFraction;
+     bool log;
+
+     bool attached;
+
+     // Chained postmix client
+     void (*postMix)(void *udata, Uint8 *stream, int len);
+     void *postMixArg;
+
+     // Audio thread: this callback's probe times
+     Uint64 musicStart;
+     Uint64 musicEnd;
+     Uint64 postEffectsStart;
+     Uint64 lastCpuTicks; // Thread CPU time at the previous postmix, 0 before the first
+
+     // Audio thread: thread cycles to performance counter ticks, measured
+     // over the first callbacks where the thread clock counts cycles
+     Uint64 calibrationCycles;
+     Uint64 calibrationTicks;
+     double ticksPerCycle;
+
+     // Accumulated by the audio thread, read under `lock`
+     SDL_SpinLock lock;
+     int callbacks;
+     int heavyCallbacks;
+     int deadlineMisses;
+     Uint64 stageTicks[AUDIO_STAGE_COUNT];
+     Uint64 stageMaxTicks[AUDIO_STAGE_COUNT];
+     int histogram[AUDIO_STAGE_COUNT][AUDIO_BUDGET_BUCKETS];
+     Uint64 lastMissTicks[AUDIO_STAGE_COUNT];
+
+     int loggedMisses; // Game thread
+};
+
+// `periodFrames` at `frequency` is the deadline each callback must meet
+void audioBudgetInit(AudioBudget &budget, int periodFrames, int frequency, double warnFraction = 0.5,
+                     bool log = false);
+
+// Start the probes and take over the postmix slot
+bool audioBudgetAttach(AudioBudget &budget);
+
+// Run `postMix` from the budget's postmix callback, timed as POSTMIX
+void audioBudgetSetPostMix(AudioBudget &budget, void (*postMix)(void *udata, Uint8 *stream, int len), void *udata);
+
+// Called by a music hook as it starts and ends, on the audio thread
+void audioBudgetMusicBegin(AudioBudget &budget);
+void audioBudgetMusicEnd(AudioBudget &budget);
+
+// Log new misses; call once per frame
+void audioBudgetUpdate(AudioBudget &budget);
+
+AudioBudgetStats audioBudgetGetStats(AudioBudget &budget);
+
+const char *audioBudgetStageName(AudioStage stage);
+
+// Remove the probes and give up the postmix slot
+void audioBudgetDetach(AudioBudget &budget);
+
+#endif // AUDIO_BUDGET_H
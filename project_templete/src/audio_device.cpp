@@ -0,0 +1,147 @@
+#include "audio_device.h"
+
+#include <iostream>
+
+namespace
+{
+     const int DEFAULT_FREQUENCY = 44100;
+     const int DEFAULT_CHUNK_SIZE = 2048;
+
+     // Low-latency sizes in the order they are tried
+     const int LOW_LATENCY_CHUNKS[] = {128, 256, 512, 1024};
+     const int PROBE_MS = 250;     // Silent run per size
+     const int PROBE_UNDERRUNS = 1; // More than this and the size is too small
+
+     void timingEffect(int, void *, int, void *udata)
+     {
+          AudioDevice &device = *(AudioDevice *)udata;
+          const Uint64 now = SDL_GetPerformanceCounter();
+          if (device.lastCallback != 0 && now - device.lastCallback > 2 * device.periodTicks)
+          {
+               SDL_AtomicAdd(&device.underruns, 1);
+          }
+          device.lastCallback = now;
+          SDL_AtomicAdd(&device.callbacks, 1);
+     }
+
+     void resetCounters(AudioDevice &device)
+     {
+          device.lastCallback = 0;
+          SDL_AtomicSet(&device.callbacks, 0);
+          SDL_AtomicSet(&device.underruns, 0);
+          device.reportedUnderruns = 0;
+     }
+
+     // Take the spec SDL_mixer ended up with and start timing callbacks
+     void startMonitor(AudioDevice &device)
+     {
+          Mix_QuerySpec(&device.frequency, &device.format, &device.channels);
+          device.periodTicks = SDL_GetPerformanceFrequency() * device.chunkSize / device.frequency;
+          resetCounters(device);
+          device.monitored = Mix_RegisterEffect(MIX_CHANNEL_POST, timingEffect, NULL, &device) != 0;
+     }
+
+     void stopMonitor(AudioDevice &device)
+     {
+          if (device.monitored)
+          {
+               Mix_UnregisterEffect(MIX_CHANNEL_POST, timingEffect);
+               device.monitored = false;
+          }
+     }
+
+     // The rate the default output runs at, so SDL does not resample
+     int nativeFrequency()
+     {
+          SDL_AudioSpec spec;
+          if (SDL_GetDefaultAudioInfo(NULL, &spec, 0) == 0 && spec.freq > 0)
+          {
+               return spec.freq;
+          }
+          return 48000;
+     }
+
+     bool openLowLatency(AudioDevice &device)
+     {
+          const int frequency = nativeFrequency();
+          const int sizes = (int)SDL_arraysize(LOW_LATENCY_CHUNKS);
+          for (int i = 0; i < sizes; i++)
+          {
+               device.chunkSize = LOW_LATENCY_CHUNKS[i];
+               if (Mix_OpenAudioDevice(frequency, MIX_DEFAULT_FORMAT, 2, device.chunkSize, NULL,
+                                       SDL_AUDIO_ALLOW_FREQUENCY_CHANGE) < 0)
+               {
+                    continue;
+               }
+               startMonitor(device);
+               SDL_Delay(PROBE_MS);
+               const int underruns = SDL_AtomicGet(&device.underruns);
+               if (device.monitored && SDL_AtomicGet(&device.callbacks) > 0 &&
+                   (underruns <= PROBE_UNDERRUNS || i == sizes - 1))
+               {
+                    resetCounters(device);
+                    return true;
+               }
+               stopMonitor(device);
+               Mix_CloseAudio();
+          }
+          return false;
+     }
+}
+
+AudioLatencyMode audioDeviceHintedMode()
+{
+     return SDL_GetHintBoolean(AUDIO_LATENCY_HINT, SDL_FALSE) ? AUDIO_LATENCY_LOW : AUDIO_LATENCY_DEFAULT;
+}
+
+void audioDevicePrepare(AudioLatencyMode mode)
+{
+     if (mode == AUDIO_LATENCY_LOW)
+     {
+          // Lets PulseAudio and PipeWire schedule the stream as a game
+          SDL_SetHintWithPriority(SDL_HINT_AUDIO_DEVICE_STREAM_ROLE, "game", SDL_HINT_DEFAULT);
+     }
+}
+
+bool audioDeviceOpen(AudioDevice &device, AudioLatencyMode mode)
+{
+     device.mode = mode;
+     device.monitored = false;
+     if (mode == AUDIO_LATENCY_LOW)
+     {
+          if (openLowLatency(device))
+          {
+               return true;
+          }
+          std::cerr << "Low-latency audio unavailable, using the default buffer! SDL_mixer Error: " << Mix_GetError()
+                    << std::endl;
+          device.mode = AUDIO_LATENCY_DEFAULT;
+     }
+
+     device.chunkSize = DEFAULT_CHUNK_SIZE;
+     if (Mix_OpenAudio(DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, 2, DEFAULT_CHUNK_SIZE) < 0)
+     {
+          return false;
+     }
+     startMonitor(device);
+     return true;
+}
+
+double audioDeviceLatencyMs(const AudioDevice &device)
+{
+     return device.frequency > 0 ? device.chunkSize * 1000.0 / device.frequency : 0.0;
+}
+
+int audioDeviceUpdate(AudioDevice &device)
+{
+     const int underruns = SDL_AtomicGet(&device.underruns);
+     const int fresh = underruns - device.reportedUnderruns;
+     device.reportedUnderruns = underruns;
+     return fresh;
+}
+
+void audioDeviceClose(AudioDevice &device)
+{
+     stopMonitor(device);
+     Mix_CloseAudio();
+}
@@ -0,0 +1,73 @@
+// Description:
+// Opens SDL_mixer's device and watches it for underruns. The default mode
+// is the classic Mix_OpenAudio(44100, S16, stereo, 2048), about 46 ms of
+// buffering. Low-latency mode, for rhythm play, opens through
+// Mix_OpenAudioDevice at the device's native rate (so nothing resamples
+// on the way out) with the smallest buffer that holds up: starting at 128
+// frames it runs the device silent for a moment before anything is
+// loaded, and steps up to the next size while callbacks arrive late.
+//
+// SDL 2 picks the low-latency path of each backend from the buffer size
+// (IAudioClient3 shared-mode periods on WASAPI, the IO buffer size on
+// CoreAudio, low-latency performance mode on AAudio); exclusive WASAPI is
+// not available through SDL 2. The device stays S16 stereo, which the
+// voice mixer requires.
+//
+// An effect on MIX_CHANNEL_POST timestamps every mix callback; a gap of
+// more than two buffer periods means the device ran dry. Underruns are
+// counted for the whole session and reported to the profiler each frame.
+// =============================================================================
+
+#ifndef AUDIO_DEVICE_H
+#define AUDIO_DEVICE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+
+#define AUDIO_LATENCY_HINT "CATCH_LOW_LATENCY_AUDIO"
+
+enum AudioLatencyMode
+{
+     AUDIO_LATENCY_DEFAULT,
+     AUDIO_LATENCY_LOW
+};
+
+struct AudioDevice
+{
+     AudioLatencyMode mode;
+     int frequency;
+     Uint16 format;
+     int channels;
+     int chunkSize; // Frames per mix callback
+
+     // Written by the audio thread
+     Uint64 lastCallback;
+     Uint64 periodTicks; // One buffer in performance counter ticks
+     SDL_atomic_t callbacks;
+     SDL_atomic_t underruns;
+
+     int reportedUnderruns; // Underruns already returned by audioDeviceUpdate
+     bool monitored;
+};
+
+// The mode asked for with AUDIO_LATENCY_HINT ("1" for low latency)
+AudioLatencyMode audioDeviceHintedMode();
+
+// Set the hints the open reads for `mode`. SDL_SetHint is not meant for
+// other threads while the main thread reads hints, so call this on the
+// main thread before audioDeviceOpen() starts on a startup task
+void audioDevicePrepare(AudioLatencyMode mode);
+
+// Open the mixer in `mode`. Must run before any chunk or music is loaded,
+// since low-latency probing closes and reopens the device.
+bool audioDeviceOpen(AudioDevice &device, AudioLatencyMode mode);
+
+// Output latency of the mix buffer alone, before the OS adds its own
+double audioDeviceLatencyMs(const AudioDevice &device);
+
+// Underruns since the previous call; call once per frame
+int audioDeviceUpdate(AudioDevice &device);
+
+void audioDeviceClose(AudioDevice &device);
+
+#endif // AUDIO_DEVICE_H
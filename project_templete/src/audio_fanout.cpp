@@ -0,0 +1,396 @@
+#include "audio_fanout.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "thread_affinity.h"
+
+namespace
+{
+     const int DEVICE_SAMPLES = 512;
+     const double FILL_SMOOTHING = 0.05; // Per block
+
+     int ringUsed(const AudioFanoutOutput &output)
+     {
+          // Unsigned so the positions may wrap around
+          return (int)((unsigned)SDL_AtomicGet((SDL_atomic_t *)&output.writePos) -
+                       (unsigned)SDL_AtomicGet((SDL_atomic_t *)&output.readPos));
+     }
+
+     int targetFrames(const AudioFanout &engine, const AudioFanoutOutput &output)
+     {
+          return output.spec.freq * engine.targetMs / 1000;
+     }
+
+     // Device callback: copies out of the ring and never mixes
+     void play(void *userdata, Uint8 *out, int len)
+     {
+          AudioFanoutOutput &output = *(AudioFanoutOutput *)userdata;
+          int readPos = SDL_AtomicGet(&output.readPos);
+          int available = ringUsed(output);
+          SDL_MemoryBarrierAcquire();
+
+          int bytes = SDL_min(available, len);
+          bytes -= bytes % output.frameBytes;
+          int offset = readPos & output.ringMask;
+          int first = SDL_min(bytes, (int)output.ring.size() - offset);
+          std::memcpy(out, &output.ring[offset], first);
+          std::memcpy(out + first, &output.ring[0], bytes - first);
+          std::memset(out + bytes, output.spec.silence, len - bytes);
+
+          SDL_MemoryBarrierRelease();
+          SDL_AtomicAdd(&output.readPos, bytes);
+          SDL_SemPost(output.engine->wake);
+
+          // Shortfalls before anything was mixed are just startup
+          if (bytes < len && SDL_AtomicGet(&output.writePos) != 0)
+          {
+               SDL_AtomicIncRef(&output.underruns);
+          }
+     }
+
+     void writeRing(AudioFanoutOutput &output, const Uint8 *data, int bytes)
+     {
+          int writePos = SDL_AtomicGet(&output.writePos);
+          int space = (int)output.ring.size() - ringUsed(output);
+          if (bytes > space)
+          {
+               output.overflows++;
+               bytes = space - space % output.frameBytes;
+          }
+          int offset = writePos & output.ringMask;
+          int first = SDL_min(bytes, (int)output.ring.size() - offset);
+          std::memcpy(&output.ring[offset], data, first);
+          std::memcpy(&output.ring[0], data + first, bytes - first);
+          SDL_MemoryBarrierRelease();
+          SDL_AtomicSet(&output.writePos, (int)((unsigned)writePos + (unsigned)bytes));
+     }
+
+     // Drop or repeat the block's last frame to hold a free-running
+     // device at the target fill. Returns the corrected frame count.
+     int correctDrift(AudioFanout &engine, AudioFanoutOutput &output, Uint8 *data, int frames, bool pacer)
+     {
+          const int fill = ringUsed(output) / output.frameBytes;
+          output.fillAverage += (fill - output.fillAverage) * FILL_SMOOTHING;
+          if (pacer || frames < 2)
+          {
+               return frames;
+          }
+          // Fill swings by a callback buffer as the device drains, so only
+          // correct outside that band
+          const double tolerance = output.spec.samples * 0.5 + 1.0;
+          const int target = targetFrames(engine, output);
+          if (output.fillAverage > target + tolerance)
+          {
+               output.droppedFrames++;
+               output.fillAverage -= 1.0;
+               return frames - 1;
+          }
+          if (output.fillAverage < target - tolerance)
+          {
+               std::memcpy(data + frames * output.frameBytes, data + (frames - 1) * output.frameBytes,
+                           output.frameBytes);
+               output.duplicatedFrames++;
+               output.fillAverage += 1.0;
+               return frames + 1;
+          }
+          return frames;
+     }
+
+     void mixBlock(AudioFanout &engine, const AudioFanoutOutput *pacer)
+     {
+          std::fill(engine.block.begin(), engine.block.end(), 0.0f);
+          engine.mix(engine.mixData, engine.block.data(), engine.blockFrames);
+          const int blockBytes = (int)(engine.block.size() * sizeof(float));
+
+          for (AudioFanoutOutput &output : engine.outputs)
+          {
+               if (SDL_AudioStreamPut(output.convert, engine.block.data(), blockBytes) < 0)
+               {
+                    continue;
+               }
+               // Room for one repeated frame after the converted audio
+               const int available = SDL_AudioStreamAvailable(output.convert);
+               if ((int)engine.converted.size() < available + output.frameBytes)
+               {
+                    engine.converted.resize(available + output.frameBytes);
+               }
+               const int got = SDL_AudioStreamGet(output.convert, engine.converted.data(), available);
+               if (got <= 0)
+               {
+                    continue;
+               }
+               if (output.isSink)
+               {
+                    output.sink(output.sinkData, engine.converted.data(), got);
+                    continue;
+               }
+               SDL_AtomicLock(&engine.statsLock);
+               const int frames = correctDrift(engine, output, engine.converted.data(), got / output.frameBytes,
+                                               &output == pacer);
+               writeRing(output, engine.converted.data(), frames * output.frameBytes);
+               SDL_AtomicUnlock(&engine.statsLock);
+          }
+     }
+
+     int engineThread(void *data)
+     {
+          AudioFanout &engine = *(AudioFanout *)data;
+          const AudioFanoutOutput *pacer = nullptr;
+          for (const AudioFanoutOutput &output : engine.outputs)
+          {
+               if (!output.isSink)
+               {
+                    pacer = &output;
+                    break;
+               }
+          }
+
+          const Uint64 frequency = SDL_GetPerformanceFrequency();
+          const Uint64 start = SDL_GetPerformanceCounter();
+          Sint64 mixedFrames = 0;
+          while (!SDL_AtomicGet(&engine.quitting))
+          {
+               bool due;
+               if (pacer != nullptr)
+               {
+                    due = ringUsed(*pacer) / pacer->frameBytes < targetFrames(engine, *pacer);
+               }
+               else
+               {
+                    // Sinks only: keep the target's worth ahead of real time
+                    const Sint64 elapsed = (Sint64)((SDL_GetPerformanceCounter() - start) * engine.rate / frequency);
+                    due = mixedFrames < elapsed + engine.rate * engine.targetMs / 1000;
+               }
+               if (!due)
+               {
+                    SDL_SemWaitTimeout(engine.wake, pacer != nullptr ? 10 : 2);
+                    continue;
+               }
+               mixBlock(engine, pacer);
+               mixedFrames += engine.blockFrames;
+          }
+          return 0;
+     }
+
+     void closeOutputs(AudioFanout &engine)
+     {
+          for (AudioFanoutOutput &output : engine.outputs)
+          {
+               // Closing waits for the callback, so it no longer reads the ring
+               if (output.device != 0)
+               {
+                    SDL_CloseAudioDevice(output.device);
+                    output.device = 0;
+               }
+          }
+     }
+
+     void freeStreams(AudioFanout &engine)
+     {
+          for (AudioFanoutOutput &output : engine.outputs)
+          {
+               if (output.convert != nullptr)
+               {
+                    SDL_FreeAudioStream(output.convert);
+                    output.convert = nullptr;
+               }
+          }
+     }
+
+     bool openOutput(AudioFanout &engine, AudioFanoutOutput &output)
+     {
+          output.engine = &engine;
+          if (!output.isSink)
+          {
+               // The device's own format and rate; the stream converts to it
+               SDL_AudioSpec desired;
+               SDL_zero(desired);
+               desired.freq = engine.rate;
+               desired.format = AUDIO_F32SYS;
+               desired.channels = 2;
+               desired.samples = DEVICE_SAMPLES;
+               desired.callback = play;
+               desired.userdata = &output;
+               output.device = SDL_OpenAudioDevice(output.deviceName, 0, &desired, &output.spec,
+                                                   SDL_AUDIO_ALLOW_ANY_CHANGE);
+               if (output.device == 0)
+               {
+                    std::cerr << "Unable to open audio output " << (output.deviceName ? output.deviceName : "(default)")
+                              << "! SDL Error: " << SDL_GetError() << std::endl;
+                    return false;
+               }
+          }
+          output.frameBytes = SDL_AUDIO_BITSIZE(output.spec.format) / 8 * output.spec.channels;
+          output.convert = SDL_NewAudioStream(AUDIO_F32SYS, 2, engine.rate, output.spec.format, output.spec.channels,
+                                              output.spec.freq);
+          if (output.convert == nullptr)
+          {
+               std::cerr << "Unable to create output converter! SDL Error: " << SDL_GetError() << std::endl;
+               return false;
+          }
+
+          // Round the ring up to a power of two so positions can be masked;
+          // four times the target leaves room for a late device
+          const int blockOut = (int)((Sint64)engine.blockFrames * output.spec.freq / engine.rate) + 2;
+          int bytes = (4 * targetFrames(engine, output) + 2 * blockOut) * output.frameBytes;
+          int size = 1;
+          while (size < bytes)
+          {
+               size <<= 1;
+          }
+          output.ring.assign(output.isSink ? 0 : size, 0);
+          output.ringMask = size - 1;
+          SDL_AtomicSet(&output.readPos, 0);
+          SDL_AtomicSet(&output.writePos, 0);
+          SDL_AtomicSet(&output.underruns, 0);
+          output.fillAverage = targetFrames(engine, output);
+          output.overflows = 0;
+          output.droppedFrames = 0;
+          output.duplicatedFrames = 0;
+          return true;
+     }
+
+     AudioFanoutOutput newOutput()
+     {
+          AudioFanoutOutput output;
+          output.engine = nullptr;
+          output.deviceName = nullptr;
+          output.isSink = false;
+          output.sink = nullptr;
+          output.sinkData = nullptr;
+          output.device = 0;
+          SDL_zero(output.spec);
+          output.frameBytes = 0;
+          output.convert = nullptr;
+          output.ringMask = 0;
+          return output;
+     }
+}
+
+void audioFanoutInit(AudioFanout &engine, int rate, AudioFanoutMixFunc mix, void *mixData, int blockFrames,
+                     int targetMs)
+{
+     engine.rate = rate;
+     engine.blockFrames = blockFrames;
+     engine.targetMs = targetMs;
+     engine.mix = mix;
+     engine.mixData = mixData;
+     engine.outputs.clear();
+     engine.block.assign((size_t)blockFrames * 2, 0.0f);
+     engine.converted.clear();
+     engine.thread = nullptr;
+     engine.wake = nullptr;
+     SDL_AtomicSet(&engine.quitting, 0);
+     engine.statsLock = 0;
+     engine.running = false;
+}
+
+int audioFanoutAddDevice(AudioFanout &engine, const char *deviceName)
+{
+     if (engine.running)
+     {
+          return -1;
+     }
+     AudioFanoutOutput output = newOutput();
+     output.deviceName = deviceName;
+     engine.outputs.push_back(output);
+     return (int)engine.outputs.size() - 1;
+}
+
+int audioFanoutAddSink(AudioFanout &engine, const SDL_AudioSpec &format, AudioFanoutSinkFunc sink, void *userdata)
+{
+     if (engine.running || sink == nullptr)
+     {
+          return -1;
+     }
+     AudioFanoutOutput output = newOutput();
+     output.isSink = true;
+     output.sink = sink;
+     output.sinkData = userdata;
+     output.spec = format;
+     engine.outputs.push_back(output);
+     return (int)engine.outputs.size() - 1;
+}
+
+bool audioFanoutStart(AudioFanout &engine)
+{
+     if (engine.running || engine.outputs.empty())
+     {
+          return false;
+     }
+     bool opened = true;
+     for (AudioFanoutOutput &output : engine.outputs)
+     {
+          opened = opened && openOutput(engine, output);
+     }
+     SDL_AtomicSet(&engine.quitting, 0);
+     engine.wake = opened ? SDL_CreateSemaphore(0) : nullptr;
+     if (engine.wake != nullptr)
+     {
+          // Mixes on a deadline; MMCSS "Pro Audio" keeps it on time under load
+          ThreadOptions options = threadDefaultOptions();
+          options.task = THREAD_TASK_PRO_AUDIO;
+          engine.thread = threadCreate(engineThread, "audio fanout", &engine, options);
+     }
+     if (engine.thread == nullptr)
+     {
+          if (opened)
+          {
+               std::cerr << "Unable to start audio fanout thread! SDL Error: " << SDL_GetError() << std::endl;
+          }
+          closeOutputs(engine);
+          freeStreams(engine);
+          if (engine.wake != nullptr)
+          {
+               SDL_DestroySemaphore(engine.wake);
+               engine.wake = nullptr;
+          }
+          return false;
+     }
+     for (AudioFanoutOutput &output : engine.outputs)
+     {
+          if (output.device != 0)
+          {
+               SDL_PauseAudioDevice(output.device, 0);
+          }
+     }
+     engine.running = true;
+     return true;
+}
+
+void audioFanoutStop(AudioFanout &engine)
+{
+     if (!engine.running)
+     {
+          return;
+     }
+     closeOutputs(engine);
+     SDL_AtomicSet(&engine.quitting, 1);
+     SDL_SemPost(engine.wake);
+     SDL_WaitThread(engine.thread, NULL);
+     engine.thread = nullptr;
+     SDL_DestroySemaphore(engine.wake);
+     engine.wake = nullptr;
+     freeStreams(engine);
+     engine.running = false;
+}
+
+AudioFanoutStats audioFanoutGetStats(const AudioFanout &engine, int output)
+{
+     AudioFanoutStats stats = {0, 0, 0, 0, 0.0};
+     if (output < 0 || output >= (int)engine.outputs.size())
+     {
+          return stats;
+     }
+     const AudioFanoutOutput &out = engine.outputs[output];
+     stats.underruns = SDL_AtomicGet((SDL_atomic_t *)&out.underruns);
+     SDL_AtomicLock((SDL_SpinLock *)&engine.statsLock);
+     stats.overflows = out.overflows;
+     stats.droppedFrames = out.droppedFrames;
+     stats.duplicatedFrames = out.duplicatedFrames;
+     stats.fillMs = out.spec.freq > 0 ? out.fillAverage * 1000.0 / out.spec.freq : 0.0;
+     SDL_AtomicUnlock((SDL_SpinLock *)&engine.statsLock);
+     return stats;
+}
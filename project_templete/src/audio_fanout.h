@@ -0,0 +1,99 @@
+// Description:
+// Mixes one audio scene once and plays it on several outputs at the same
+// time: audio devices (speakers, headphones) and sinks such as a stream
+// capture encoder. An engine thread renders stereo float blocks at the
+// engine rate, converts each block per output with SDL_AudioStream (rate,
+// format and channel count of that device), and hands it over through a
+// lock-free ring per device, so device callbacks only copy.
+//
+// The first device paces the engine: a block is mixed whenever its ring
+// falls below the target fill. Other devices run on their own clocks and
+// drift; each one's smoothed fill level is compared with the target and
+// a frame is dropped or repeated per block (at most about 1000 ppm at the
+// default block size) to pull it back. Sinks take every block as it is
+// mixed. Without a device the engine paces itself on the wall clock.
+// =============================================================================
+
+#ifndef AUDIO_FANOUT_H
+#define AUDIO_FANOUT_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+// Mix `frames` interleaved stereo float frames into `out`, which is zeroed
+typedef void (*AudioFanoutMixFunc)(void *userdata, float *out, int frames);
+
+// Take converted audio for a sink output, on the engine thread
+typedef void (*AudioFanoutSinkFunc)(void *userdata, const Uint8 *data, int bytes);
+
+struct AudioFanoutStats
+{
+     int underruns;        // Device callbacks that found the ring short
+     int overflows;        // Blocks that did not fit in the ring
+     int droppedFrames;    // Drift corrections, device slower than the engine
+     int duplicatedFrames; // Drift corrections, device faster
+     double fillMs;        // Smoothed ring fill
+};
+
+struct AudioFanout;
+
+struct AudioFanoutOutput
+{
+     AudioFanout *engine;
+     const char *deviceName; // Device outputs; nullptr for the default device
+     bool isSink;
+     AudioFanoutSinkFunc sink;
+     void *sinkData;
+
+     SDL_AudioDeviceID device;
+     SDL_AudioSpec spec; // Obtained from the device, or given for a sink
+     int frameBytes;
+     SDL_AudioStream *convert;
+
+     // Ring buffer: positions count bytes monotonically and are masked
+     std::vector<Uint8> ring;
+     int ringMask;
+     SDL_atomic_t readPos;
+     SDL_atomic_t writePos;
+     SDL_atomic_t underruns;
+
+     double fillAverage; // In frames, engine thread only
+     int overflows;
+     int droppedFrames;
+     int duplicatedFrames;
+};
+
+struct AudioFanout
+{
+     int rate;
+     int blockFrames;
+     int targetMs; // Ring fill each device is held at
+     AudioFanoutMixFunc mix;
+     void *mixData;
+
+     std::vector<AudioFanoutOutput> outputs; // Fixed once started
+     std::vector<float> block;
+     std::vector<Uint8> converted;
+
+     SDL_Thread *thread;
+     SDL_sem *wake; // Posted by device callbacks as they drain
+     SDL_atomic_t quitting;
+     SDL_SpinLock statsLock;
+     bool running;
+};
+
+void audioFanoutInit(AudioFanout &engine, int rate, AudioFanoutMixFunc mix, void *mixData, int blockFrames = 1024,
+                     int targetMs = 40);
+
+// Outputs are added before audioFanoutStart(); each returns its index
+int audioFanoutAddDevice(AudioFanout &engine, const char *deviceName);
+int audioFanoutAddSink(AudioFanout &engine, const SDL_AudioSpec &format, AudioFanoutSinkFunc sink, void *userdata);
+
+// Open every device and start mixing. False if an output could not be
+// set up; nothing is left running then.
+bool audioFanoutStart(AudioFanout &engine);
+void audioFanoutStop(AudioFanout &engine);
+
+AudioFanoutStats audioFanoutGetStats(const AudioFanout &engine, int output);
+
+#endif // AUDIO_FANOUT_H
@@ -0,0 +1,460 @@
+#include "audio_resample.h"
+
+#include <cmath>
+
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define AUDIO_RESAMPLE_X86 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AUDIO_RESAMPLE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+     struct QualityLevel
+     {
+          int taps;
+          int phases;
+          double cutoff; // Passband edge as a fraction of the lower Nyquist
+          double beta;   // Kaiser window shape
+     };
+
+     const QualityLevel QUALITY_LEVELS[] = {
+         {8, 64, 0.85, 5.0},    // AUDIO_RESAMPLE_FAST
+         {16, 256, 0.90, 7.0},  // AUDIO_RESAMPLE_MEDIUM
+         {32, 1024, 0.94, 9.0}, // AUDIO_RESAMPLE_HIGH
+     };
+
+     const double PI = 3.14159265358979323846;
+
+     // --- Scalar kernels ---
+
+     float dotScalar(const float *a, const float *b, int count)
+     {
+          // Four partial sums, as the vector kernels do, so results match closely
+          float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+          for (int i = 0; i < count; i += 4)
+          {
+               for (int j = 0; j < 4; j++)
+               {
+                    sum[j] += a[i + j] * b[i + j];
+               }
+          }
+          return (sum[0] + sum[2]) + (sum[1] + sum[3]);
+     }
+
+     void s16ToF32Scalar(const Sint16 *in, float *out, int samples)
+     {
+          for (int i = 0; i < samples; i++)
+          {
+               out[i] = in[i] * (1.0f / 32768.0f);
+          }
+     }
+
+     void f32ToS16Scalar(const float *in, Sint16 *out, int samples)
+     {
+          for (int i = 0; i < samples; i++)
+          {
+               // The inverse of the 1/32768 scale, so int16 round-trips exactly
+               const float scaled = SDL_clamp(in[i], -1.0f, 1.0f) * 32768.0f;
+               const int rounded = (int)(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+               out[i] = (Sint16)SDL_clamp(rounded, -32768, 32767);
+          }
+     }
+
+#ifdef AUDIO_RESAMPLE_X86
+     // --- SSE2 ---
+
+     float dotSse2(const float *a, const float *b, int count)
+     {
+          __m128 sum0 = _mm_setzero_ps();
+          __m128 sum1 = _mm_setzero_ps();
+          for (int i = 0; i < count; i += 8)
+          {
+               sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+               sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+          }
+          __m128 sum = _mm_add_ps(sum0, sum1);
+          sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+          sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+          return _mm_cvtss_f32(sum);
+     }
+
+     void s16ToF32Sse2(const Sint16 *in, float *out, int samples)
+     {
+          const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+          int i = 0;
+          for (; i + 8 <= samples; i += 8)
+          {
+               __m128i pcm = _mm_loadu_si128((const __m128i *)(in + i));
+               // Sign-extend by unpacking into the high half and shifting down
+               __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(pcm, pcm), 16));
+               __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(pcm, pcm), 16));
+               _mm_storeu_ps(out + i, _mm_mul_ps(lo, scale));
+               _mm_storeu_ps(out + i + 4, _mm_mul_ps(hi, scale));
+          }
+          s16ToF32Scalar(in + i, out + i, samples - i);
+     }
+
+     void f32ToS16Sse2(const float *in, Sint16 *out, int samples)
+     {
+          const __m128 scale = _mm_set1_ps(32768.0f);
+          const __m128 low = _mm_set1_ps(-1.0f);
+          const __m128 high = _mm_set1_ps(1.0f);
+          int i = 0;
+          for (; i + 8 <= samples; i += 8)
+          {
+               __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), low), high);
+               __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), low), high);
+               // cvtps rounds to nearest, packs saturates
+               __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(a, scale));
+               __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(b, scale));
+               _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(lo, hi));
+          }
+          f32ToS16Scalar(in + i, out + i, samples - i);
+     }
+#endif
+
+#ifdef AUDIO_RESAMPLE_NEON
+     // --- NEON ---
+
+     float dotNeon(const float *a, const float *b, int count)
+     {
+          float32x4_t sum0 = vdupq_n_f32(0.0f);
+          float32x4_t sum1 = vdupq_n_f32(0.0f);
+          for (int i = 0; i < count; i += 8)
+          {
+               sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+               sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+          }
+          float32x4_t sum = vaddq_f32(sum0, sum1);
+          float32x2_t pair = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+          return vget_lane_f32(vpadd_f32(pair, pair), 0);
+     }
+
+     void s16ToF32Neon(const Sint16 *in, float *out, int samples)
+     {
+          int i = 0;
+          for (; i + 8 <= samples; i += 8)
+          {
+               int16x8_t pcm = vld1q_s16(in + i);
+               vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(pcm))), 1.0f / 32768.0f));
+               vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(pcm))), 1.0f / 32768.0f));
+          }
+          s16ToF32Scalar(in + i, out + i, samples - i);
+     }
+
+     void f32ToS16Neon(const float *in, Sint16 *out, int samples)
+     {
+          const float32x4_t low = vdupq_n_f32(-1.0f);
+          const float32x4_t high = vdupq_n_f32(1.0f);
+          int i = 0;
+          for (; i + 8 <= samples; i += 8)
+          {
+               float32x4_t a = vminq_f32(vmaxq_f32(vld1q_f32(in + i), low), high);
+               float32x4_t b = vminq_f32(vmaxq_f32(vld1q_f32(in + i + 4), low), high);
+               // Add half away from zero, then truncate, as the scalar path rounds
+               a = vmulq_n_f32(a, 32768.0f);
+               b = vmulq_n_f32(b, 32768.0f);
+               a = vaddq_f32(a, vbslq_f32(vcltq_f32(a, vdupq_n_f32(0.0f)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f)));
+               b = vaddq_f32(b, vbslq_f32(vcltq_f32(b, vdupq_n_f32(0.0f)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f)));
+               int16x4_t lo = vqmovn_s32(vcvtq_s32_f32(a));
+               int16x4_t hi = vqmovn_s32(vcvtq_s32_f32(b));
+               vst1q_s16(out + i, vcombine_s16(lo, hi));
+          }
+          f32ToS16Scalar(in + i, out + i, samples - i);
+     }
+#endif
+
+     AudioResampleKernel bestKernel()
+     {
+          const AudioResampleKernel preferred[] = {AUDIO_RESAMPLE_KERNEL_NEON, AUDIO_RESAMPLE_KERNEL_SSE2};
+          for (AudioResampleKernel candidate : preferred)
+          {
+               if (audioResampleKernelSupported(candidate))
+               {
+                    return candidate;
+               }
+          }
+          return AUDIO_RESAMPLE_KERNEL_SCALAR;
+     }
+
+     // Conversions are stateless, so they pick their kernel once for everyone
+     struct ConvertKernels
+     {
+          void (*s16ToF32)(const Sint16 *in, float *out, int samples);
+          void (*f32ToS16)(const float *in, Sint16 *out, int samples);
+     };
+
+     const ConvertKernels &convertKernels()
+     {
+          static const ConvertKernels kernels = []()
+          {
+               ConvertKernels chosen = {s16ToF32Scalar, f32ToS16Scalar};
+               const AudioResampleKernel kernel = bestKernel();
+#ifdef AUDIO_RESAMPLE_X86
+               if (kernel == AUDIO_RESAMPLE_KERNEL_SSE2)
+               {
+                    chosen = {s16ToF32Sse2, f32ToS16Sse2};
+               }
+#endif
+#ifdef AUDIO_RESAMPLE_NEON
+               if (kernel == AUDIO_RESAMPLE_KERNEL_NEON)
+               {
+                    chosen = {s16ToF32Neon, f32ToS16Neon};
+               }
+#endif
+               (void)kernel;
+               return chosen;
+          }();
+          return kernels;
+     }
+
+     int greatestCommonDivisor(int a, int b)
+     {
+          while (b != 0)
+          {
+               const int rest = a % b;
+               a = b;
+               b = rest;
+          }
+          return a;
+     }
+
+     // Zeroth-order modified Bessel function, for the Kaiser window
+     double besselI0(double x)
+     {
+          double sum = 1.0, term = 1.0;
+          for (int k = 1; k < 32; k++)
+          {
+               term *= (x / (2.0 * k)) * (x / (2.0 * k));
+               sum += term;
+          }
+          return sum;
+     }
+
+     // Kaiser-windowed sinc for each phase, normalized to unity gain
+     void buildFilters(AudioResampler &resampler, const QualityLevel &level)
+     {
+          const int half = resampler.taps / 2;
+          // Downsampling moves the cutoff below the output's Nyquist
+          const double cutoff =
+              level.cutoff * SDL_min(1.0, (double)resampler.upFactor / resampler.downFactor);
+          const double windowNorm = besselI0(level.beta);
+          resampler.filters.assign((size_t)resampler.phases * resampler.taps, 0.0f);
+          for (int p = 0; p < resampler.phases; p++)
+          {
+               float *filter = &resampler.filters[(size_t)p * resampler.taps];
+               const double frac = (double)p / resampler.phases;
+               double sum = 0.0;
+               for (int k = 0; k < resampler.taps; k++)
+               {
+                    const double d = k - (half - 1) - frac; // Distance from the output instant
+                    const double x = d / half;
+                    const double window = x * x < 1.0 ? besselI0(level.beta * std::sqrt(1.0 - x * x)) / windowNorm : 0.0;
+                    const double t = PI * cutoff * d;
+                    const double sinc = d == 0.0 ? 1.0 : std::sin(t) / t;
+                    filter[k] = (float)(sinc * window);
+                    sum += filter[k];
+               }
+               for (int k = 0; k < resampler.taps; k++)
+               {
+                    filter[k] = (float)(filter[k] / sum);
+               }
+          }
+     }
+
+     // Drop history the next output no longer reaches
+     void compactHistory(AudioResampler &resampler)
+     {
+          const int drop = SDL_min(resampler.position - (resampler.taps / 2 - 1), resampler.historyFrames);
+          if (drop <= 0)
+          {
+               return;
+          }
+          const int keep = resampler.historyFrames - drop;
+          for (int c = 0; c < resampler.channels; c++)
+          {
+               float *samples = resampler.history[c].data();
+               SDL_memmove(samples, samples + drop, keep * sizeof(float));
+          }
+          resampler.historyFrames = keep;
+          resampler.position -= drop;
+     }
+
+     void appendHistory(AudioResampler &resampler, const float *in, int frames)
+     {
+          const int channels = resampler.channels;
+          const int needed = resampler.historyFrames + frames;
+          for (int c = 0; c < channels; c++)
+          {
+               std::vector<float> &history = resampler.history[c];
+               if ((int)history.size() < needed)
+               {
+                    history.resize(needed);
+               }
+               float *dst = history.data() + resampler.historyFrames;
+               if (in == nullptr)
+               {
+                    SDL_memset(dst, 0, frames * sizeof(float));
+                    continue;
+               }
+               for (int i = 0; i < frames; i++)
+               {
+                    dst[i] = in[i * channels + c];
+               }
+          }
+          resampler.historyFrames = needed;
+     }
+}
+
+bool audioResampleKernelSupported(AudioResampleKernel kernel)
+{
+     switch (kernel)
+     {
+     case AUDIO_RESAMPLE_KERNEL_AUTO:
+     case AUDIO_RESAMPLE_KERNEL_SCALAR:
+          return true;
+#ifdef AUDIO_RESAMPLE_X86
+     case AUDIO_RESAMPLE_KERNEL_SSE2:
+          return cpuHasSse2();
+#endif
+#ifdef AUDIO_RESAMPLE_NEON
+     case AUDIO_RESAMPLE_KERNEL_NEON:
+          return SDL_HasNEON() == SDL_TRUE;
+#endif
+     default:
+          return false;
+     }
+}
+
+const char *audioResampleKernelName(AudioResampleKernel kernel)
+{
+     switch (kernel)
+     {
+     case AUDIO_RESAMPLE_KERNEL_SCALAR:
+          return "scalar";
+     case AUDIO_RESAMPLE_KERNEL_SSE2:
+          return "sse2";
+     case AUDIO_RESAMPLE_KERNEL_NEON:
+          return "neon";
+     default:
+          return "auto";
+     }
+}
+
+void audioConvertS16ToF32(const Sint16 *in, float *out, int samples)
+{
+     convertKernels().s16ToF32(in, out, samples);
+}
+
+void audioConvertF32ToS16(const float *in, Sint16 *out, int samples)
+{
+     convertKernels().f32ToS16(in, out, samples);
+}
+
+bool audioResamplerInit(AudioResampler &resampler, int channels, int inRate, int outRate,
+                        AudioResampleQuality quality, AudioResampleKernel kernel)
+{
+     if (channels < 1 || channels > AUDIO_RESAMPLE_MAX_CHANNELS || inRate <= 0 || outRate <= 0)
+     {
+          SDL_SetError("Unsupported resampler layout");
+          return false;
+     }
+     const QualityLevel &level = QUALITY_LEVELS[SDL_clamp((int)quality, 0, (int)SDL_arraysize(QUALITY_LEVELS) - 1)];
+     const int divisor = greatestCommonDivisor(inRate, outRate);
+     resampler.channels = channels;
+     resampler.inRate = inRate;
+     resampler.outRate = outRate;
+     resampler.upFactor = outRate / divisor;
+     resampler.downFactor = inRate / divisor;
+     resampler.taps = level.taps;
+     resampler.phases = SDL_min(level.phases, resampler.upFactor);
+     buildFilters(resampler, level);
+
+     if (kernel == AUDIO_RESAMPLE_KERNEL_AUTO)
+     {
+          kernel = bestKernel();
+     }
+     else if (!audioResampleKernelSupported(kernel))
+     {
+          kernel = AUDIO_RESAMPLE_KERNEL_SCALAR;
+     }
+     resampler.kernel = kernel;
+     resampler.dot = dotScalar;
+#ifdef AUDIO_RESAMPLE_X86
+     if (kernel == AUDIO_RESAMPLE_KERNEL_SSE2)
+     {
+          resampler.dot = dotSse2;
+     }
+#endif
+#ifdef AUDIO_RESAMPLE_NEON
+     if (kernel == AUDIO_RESAMPLE_KERNEL_NEON)
+     {
+          resampler.dot = dotNeon;
+     }
+#endif
+
+     audioResamplerReset(resampler);
+     return true;
+}
+
+int audioResamplerMaxOutput(const AudioResampler &resampler, int inFrames)
+{
+     const Sint64 frames = (Sint64)(resampler.historyFrames - resampler.position + inFrames) * resampler.upFactor;
+     return (int)SDL_max(frames / resampler.downFactor + 1, (Sint64)0);
+}
+
+int audioResamplerProcess(AudioResampler &resampler, const float *in, int inFrames, float *out, int maxOutFrames)
+{
+     if (inFrames > 0)
+     {
+          appendHistory(resampler, in, inFrames);
+     }
+
+     const int channels = resampler.channels;
+     const int taps = resampler.taps;
+     const int half = taps / 2;
+     int produced = 0;
+     while (produced < maxOutFrames && resampler.position + half < resampler.historyFrames)
+     {
+          // Exact rational phase, scaled to the table when it has fewer
+          const int tablePhase = (int)((Sint64)resampler.phase * resampler.phases / resampler.upFactor);
+          const float *filter = &resampler.filters[(size_t)tablePhase * taps];
+          const int start = resampler.position - (half - 1);
+          for (int c = 0; c < channels; c++)
+          {
+               out[produced * channels + c] = resampler.dot(filter, resampler.history[c].data() + start, taps);
+          }
+          produced++;
+
+          resampler.phase += resampler.downFactor;
+          resampler.position += resampler.phase / resampler.upFactor;
+          resampler.phase %= resampler.upFactor;
+     }
+     compactHistory(resampler);
+     return produced;
+}
+
+int audioResamplerFlush(AudioResampler &resampler, float *out, int maxOutFrames)
+{
+     appendHistory(resampler, nullptr, resampler.taps / 2);
+     const int produced = audioResamplerProcess(resampler, nullptr, 0, out, maxOutFrames);
+     audioResamplerReset(resampler);
+     return produced;
+}
+
+void audioResamplerReset(AudioResampler &resampler)
+{
+     // Half a filter of silence so the first output is centered on the
+     // first input sample
+     resampler.historyFrames = 0;
+     resampler.position = resampler.taps / 2 - 1;
+     resampler.phase = 0;
+     appendHistory(resampler, nullptr, resampler.taps / 2 - 1);
+}
@@ -0,0 +1,97 @@
+// Description:
+// Sample format conversion and sample rate conversion for streams this
+// game decodes itself. SDL_AudioStream converts one sample at a time and
+// its resampler costs a lot with several streams open; here int16/float32
+// conversion runs in SSE2 or NEON blocks, and resampling is a polyphase
+// windowed-sinc filter whose taps are dotted with SIMD.
+//
+// The rate ratio is reduced to L/M and each output sample picks one of
+// the precomputed filter phases; when L exceeds the quality level's phase
+// count the nearest lower phase is used. Samples are de-interleaved into
+// per-channel history so the taps are contiguous for the dot product.
+//
+// Quality levels trade taps (and so transition band and stop-band
+// rejection) for speed:
+// - FAST: 8 taps, 64 phases, for effects and previews
+// - MEDIUM: 16 taps, 256 phases, the default for music
+// - HIGH: 32 taps, 1024 phases
+// =============================================================================
+
+#ifndef AUDIO_RESAMPLE_H
+#define AUDIO_RESAMPLE_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+const int AUDIO_RESAMPLE_MAX_CHANNELS = 8;
+
+enum AudioResampleQuality
+{
+     AUDIO_RESAMPLE_FAST,
+     AUDIO_RESAMPLE_MEDIUM,
+     AUDIO_RESAMPLE_HIGH
+};
+
+enum AudioResampleKernel
+{
+     AUDIO_RESAMPLE_KERNEL_AUTO,
+     AUDIO_RESAMPLE_KERNEL_SCALAR,
+     AUDIO_RESAMPLE_KERNEL_SSE2,
+     AUDIO_RESAMPLE_KERNEL_NEON
+};
+
+// Dot product of `count` floats, `count` a multiple of 8
+typedef float (*AudioDotFunc)(const float *a, const float *b, int count);
+
+struct AudioResampler
+{
+     int channels;
+     int inRate;
+     int outRate;
+     int upFactor;   // L: output samples per `downFactor` input samples
+     int downFactor; // M
+
+     int taps;
+     int phases;
+     std::vector<float> filters; // phases * taps
+
+     // Per-channel input not yet consumed, starting half a filter before
+     // the next output's center sample
+     std::vector<float> history[AUDIO_RESAMPLE_MAX_CHANNELS];
+     int historyFrames;
+     int position; // Center sample of the next output within the history
+     int phase;    // 0..L-1, fractional part of the position in 1/L steps
+
+     AudioResampleKernel kernel;
+     AudioDotFunc dot;
+};
+
+// Whether this build and the running CPU can use `kernel`
+bool audioResampleKernelSupported(AudioResampleKernel kernel);
+const char *audioResampleKernelName(AudioResampleKernel kernel);
+
+// Interleaved sample conversion, any sample count. Float samples outside
+// [-1, 1] saturate.
+void audioConvertS16ToF32(const Sint16 *in, float *out, int samples);
+void audioConvertF32ToS16(const float *in, Sint16 *out, int samples);
+
+bool audioResamplerInit(AudioResampler &resampler, int channels, int inRate, int outRate,
+                        AudioResampleQuality quality = AUDIO_RESAMPLE_MEDIUM,
+                        AudioResampleKernel kernel = AUDIO_RESAMPLE_KERNEL_AUTO);
+
+// Most frames the next audioResamplerProcess() of `inFrames` can produce
+int audioResamplerMaxOutput(const AudioResampler &resampler, int inFrames);
+
+// Take `inFrames` interleaved float frames and write up to `maxOutFrames`
+// interleaved frames to `out`. Input that cannot be used yet is kept for
+// the next call. Returns the frames written.
+int audioResamplerProcess(AudioResampler &resampler, const float *in, int inFrames, float *out, int maxOutFrames);
+
+// Push the filter's delay out after the last input; the resampler starts
+// over afterwards
+int audioResamplerFlush(AudioResampler &resampler, float *out, int maxOutFrames);
+
+// Forget buffered input, as after a seek
+void audioResamplerReset(AudioResampler &resampler);
+
+#endif // AUDIO_RESAMPLE_H
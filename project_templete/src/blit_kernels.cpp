@@ -0,0 +1,791 @@
+#include "blit_kernels.h"
+
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define BLIT_KERNELS_X86 1
+#include <emmintrin.h>
+// No AVX in WASM SIMD; the web build stops at the SSE2 kernels
+#if defined(__GNUC__) && !defined(__EMSCRIPTEN__)
+#define BLIT_KERNELS_AVX 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BLIT_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+     // --- Scalar kernels ---
+     // Blending works on two channels per 32-bit word, 0x00RR00BB and
+     // 0x00AA00GG: every product is at most 255 * 255, so the halves never
+     // carry into each other. The alpha half blends 255 against the
+     // destination alpha, which gives a + dstA * (255 - a) / 255.
+
+     inline Uint32 div255Pairs(Uint32 t)
+     {
+          t += 0x00800080u;
+          return ((t + ((t >> 8) & 0x00FF00FFu)) >> 8) & 0x00FF00FFu;
+     }
+
+     inline Uint32 blendPixel(Uint32 s, Uint32 d)
+     {
+          const Uint32 a = s >> 24;
+          const Uint32 ia = 255 - a;
+          const Uint32 rb = (s & 0x00FF00FFu) * a + (d & 0x00FF00FFu) * ia;
+          const Uint32 ga = (((s >> 8) & 0xFFu) | 0x00FF0000u) * a + ((d >> 8) & 0x00FF00FFu) * ia;
+          return div255Pairs(rb) | (div255Pairs(ga) << 8);
+     }
+
+     inline Uint32 swapPixel(Uint32 p)
+     {
+          return (p & 0xFF00FF00u) | ((p >> 16) & 0xFFu) | ((p & 0xFFu) << 16);
+     }
+
+     inline Uint32 from565Pixel(Uint16 p, int redShift)
+     {
+          const Uint32 r = (p >> 11) & 31, g = (p >> 5) & 63, b = p & 31;
+          return 0xFF000000u | (((r << 3) | (r >> 2)) << redShift) | (((g << 2) | (g >> 4)) << 8) |
+                 (((b << 3) | (b >> 2)) << (16 - redShift));
+     }
+
+     inline Uint16 to565Pixel(Uint32 p, int redShift)
+     {
+          const Uint32 r = (p >> redShift) & 0xFF, g = (p >> 8) & 0xFF, b = (p >> (16 - redShift)) & 0xFF;
+          return (Uint16)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+     }
+
+     void swapScalar(const Uint32 *src, Uint32 *dst, int count)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               dst[i] = swapPixel(src[i]);
+          }
+     }
+
+     void from565Scalar(const Uint16 *src, Uint32 *dst, int count, int redShift)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               dst[i] = from565Pixel(src[i], redShift);
+          }
+     }
+
+     void to565Scalar(const Uint32 *src, Uint16 *dst, int count, int redShift)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               dst[i] = to565Pixel(src[i], redShift);
+          }
+     }
+
+     void blendScalar(const Uint32 *src, Uint32 *dst, int count)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               dst[i] = blendPixel(src[i], dst[i]);
+          }
+     }
+
+     void fill32Scalar(Uint32 *dst, int count, Uint32 color)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               dst[i] = color;
+          }
+     }
+
+     void fill16Scalar(Uint16 *dst, int count, Uint16 color)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               dst[i] = color;
+          }
+     }
+
+     const BlitKernelTable SCALAR_TABLE = {swapScalar, from565Scalar, to565Scalar, blendScalar, fill32Scalar, fill16Scalar};
+
+#ifdef BLIT_KERNELS_X86
+     // --- SSE2: 4 pixels per step ---
+
+     void swapSse2(const Uint32 *src, Uint32 *dst, int count)
+     {
+          const __m128i keep = _mm_set1_epi32((int)0xFF00FF00u);
+          const __m128i low = _mm_set1_epi32(0xFF);
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               __m128i p = _mm_loadu_si128((const __m128i *)(src + i));
+               __m128i out = _mm_or_si128(_mm_and_si128(p, keep),
+                                          _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), low), _mm_slli_epi32(_mm_and_si128(p, low), 16)));
+               _mm_storeu_si128((__m128i *)(dst + i), out);
+          }
+          swapScalar(src + i, dst + i, count - i);
+     }
+
+     inline __m128i from565Sse2(__m128i p, __m128i redCount, __m128i blueCount)
+     {
+          const __m128i five = _mm_set1_epi32(31), six = _mm_set1_epi32(63);
+          __m128i r = _mm_and_si128(_mm_srli_epi32(p, 11), five);
+          __m128i g = _mm_and_si128(_mm_srli_epi32(p, 5), six);
+          __m128i b = _mm_and_si128(p, five);
+          r = _mm_or_si128(_mm_slli_epi32(r, 3), _mm_srli_epi32(r, 2));
+          g = _mm_or_si128(_mm_slli_epi32(g, 2), _mm_srli_epi32(g, 4));
+          b = _mm_or_si128(_mm_slli_epi32(b, 3), _mm_srli_epi32(b, 2));
+          return _mm_or_si128(_mm_or_si128(_mm_set1_epi32((int)0xFF000000u), _mm_sll_epi32(r, redCount)),
+                              _mm_or_si128(_mm_slli_epi32(g, 8), _mm_sll_epi32(b, blueCount)));
+     }
+
+     void from565Sse2(const Uint16 *src, Uint32 *dst, int count, int redShift)
+     {
+          const __m128i redCount = _mm_cvtsi32_si128(redShift), blueCount = _mm_cvtsi32_si128(16 - redShift);
+          const __m128i zero = _mm_setzero_si128();
+          int i = 0;
+          for (; i + 8 <= count; i += 8)
+          {
+               __m128i p = _mm_loadu_si128((const __m128i *)(src + i));
+               _mm_storeu_si128((__m128i *)(dst + i), from565Sse2(_mm_unpacklo_epi16(p, zero), redCount, blueCount));
+               _mm_storeu_si128((__m128i *)(dst + i + 4), from565Sse2(_mm_unpackhi_epi16(p, zero), redCount, blueCount));
+          }
+          from565Scalar(src + i, dst + i, count - i, redShift);
+     }
+
+     inline __m128i to565Sse2(__m128i p, __m128i redCount, __m128i blueCount)
+     {
+          const __m128i byte = _mm_set1_epi32(0xFF);
+          __m128i r = _mm_srli_epi32(_mm_and_si128(_mm_srl_epi32(p, redCount), byte), 3);
+          __m128i g = _mm_srli_epi32(_mm_and_si128(_mm_srli_epi32(p, 8), byte), 2);
+          __m128i b = _mm_srli_epi32(_mm_and_si128(_mm_srl_epi32(p, blueCount), byte), 3);
+          __m128i out = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 11), _mm_slli_epi32(g, 5)), b);
+          // packs_epi32 saturates signed; bias around it so 0xFFFF survives
+          return _mm_sub_epi32(out, _mm_set1_epi32(0x8000));
+     }
+
+     void to565Sse2(const Uint32 *src, Uint16 *dst, int count, int redShift)
+     {
+          const __m128i redCount = _mm_cvtsi32_si128(redShift), blueCount = _mm_cvtsi32_si128(16 - redShift);
+          const __m128i bias = _mm_set1_epi16((short)0x8000);
+          int i = 0;
+          for (; i + 8 <= count; i += 8)
+          {
+               __m128i lo = to565Sse2(_mm_loadu_si128((const __m128i *)(src + i)), redCount, blueCount);
+               __m128i hi = to565Sse2(_mm_loadu_si128((const __m128i *)(src + i + 4)), redCount, blueCount);
+               _mm_storeu_si128((__m128i *)(dst + i), _mm_add_epi16(_mm_packs_epi32(lo, hi), bias));
+          }
+          to565Scalar(src + i, dst + i, count - i, redShift);
+     }
+
+     inline __m128i div255PairsSse2(__m128i t)
+     {
+          t = _mm_add_epi16(t, _mm_set1_epi16(0x80));
+          return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+     }
+
+     void blendSse2(const Uint32 *src, Uint32 *dst, int count)
+     {
+          const __m128i pairs = _mm_set1_epi32(0x00FF00FF);
+          const __m128i alphaOne = _mm_set1_epi32(0x00FF0000);
+          const __m128i low = _mm_set1_epi32(0xFF);
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+               __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+               __m128i a = _mm_srli_epi32(s, 24);
+               a = _mm_or_si128(a, _mm_slli_epi32(a, 16)); // In both 16-bit halves
+               __m128i ia = _mm_xor_si128(a, pairs);
+               __m128i rb = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(s, pairs), a), _mm_mullo_epi16(_mm_and_si128(d, pairs), ia));
+               __m128i ga = _mm_add_epi16(_mm_mullo_epi16(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(s, 8), low), alphaOne), a),
+                                          _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(d, 8), pairs), ia));
+               _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(div255PairsSse2(rb), _mm_slli_epi32(div255PairsSse2(ga), 8)));
+          }
+          blendScalar(src + i, dst + i, count - i);
+     }
+
+     void fill32Sse2(Uint32 *dst, int count, Uint32 color)
+     {
+          const __m128i value = _mm_set1_epi32((int)color);
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               _mm_storeu_si128((__m128i *)(dst + i), value);
+          }
+          fill32Scalar(dst + i, count - i, color);
+     }
+
+     void fill16Sse2(Uint16 *dst, int count, Uint16 color)
+     {
+          const __m128i value = _mm_set1_epi16((short)color);
+          int i = 0;
+          for (; i + 8 <= count; i += 8)
+          {
+               _mm_storeu_si128((__m128i *)(dst + i), value);
+          }
+          fill16Scalar(dst + i, count - i, color);
+     }
+
+     const BlitKernelTable SSE2_TABLE = {swapSse2, from565Sse2, to565Sse2, blendSse2, fill32Sse2, fill16Sse2};
+#endif
+
+#ifdef BLIT_KERNELS_AVX
+     // --- AVX2: 8 pixels per step, compiled for AVX2 regardless of -m flags ---
+
+     __attribute__((target("avx2"))) void swapAvx2(const Uint32 *src, Uint32 *dst, int count)
+     {
+          const __m256i keep = _mm256_set1_epi32((int)0xFF00FF00u);
+          const __m256i low = _mm256_set1_epi32(0xFF);
+          int i = 0;
+          for (; i + 8 <= count; i += 8)
+          {
+               __m256i p = _mm256_loadu_si256((const __m256i *)(src + i));
+               __m256i out = _mm256_or_si256(_mm256_and_si256(p, keep),
+                                             _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(p, 16), low),
+                                                             _mm256_slli_epi32(_mm256_and_si256(p, low), 16)));
+               _mm256_storeu_si256((__m256i *)(dst + i), out);
+          }
+          swapScalar(src + i, dst + i, count - i);
+     }
+
+     __attribute__((target("avx2"))) void from565Avx2(const Uint16 *src, Uint32 *dst, int count, int redShift)
+     {
+          const __m128i redCount = _mm_cvtsi32_si128(redShift), blueCount = _mm_cvtsi32_si128(16 - redShift);
+          const __m256i five = _mm256_set1_epi32(31), six = _mm256_set1_epi32(63);
+          int i = 0;
+          for (; i + 8 <= count; i += 8)
+          {
+               __m256i p = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+               __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 11), five);
+               __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 5), six);
+               __m256i b = _mm256_and_si256(p, five);
+               r = _mm256_or_si256(_mm256_slli_epi32(r, 3), _mm256_srli_epi32(r, 2));
+               g = _mm256_or_si256(_mm256_slli_epi32(g, 2), _mm256_srli_epi32(g, 4));
+               b = _mm256_or_si256(_mm256_slli_epi32(b, 3), _mm256_srli_epi32(b, 2));
+               __m256i out = _mm256_or_si256(_mm256_or_si256(_mm256_set1_epi32((int)0xFF000000u), _mm256_sll_epi32(r, redCount)),
+                                             _mm256_or_si256(_mm256_slli_epi32(g, 8), _mm256_sll_epi32(b, blueCount)));
+               _mm256_storeu_si256((__m256i *)(dst + i), out);
+          }
+          from565Scalar(src + i, dst + i, count - i, redShift);
+     }
+
+     __attribute__((target("avx2"))) void to565Avx2(const Uint32 *src, Uint16 *dst, int count, int redShift)
+     {
+          const __m128i redCount = _mm_cvtsi32_si128(redShift), blueCount = _mm_cvtsi32_si128(16 - redShift);
+          const __m256i byte = _mm256_set1_epi32(0xFF);
+          int i = 0;
+          for (; i + 8 <= count; i += 8)
+          {
+               __m256i p = _mm256_loadu_si256((const __m256i *)(src + i));
+               __m256i r = _mm256_srli_epi32(_mm256_and_si256(_mm256_srl_epi32(p, redCount), byte), 3);
+               __m256i g = _mm256_srli_epi32(_mm256_and_si256(_mm256_srli_epi32(p, 8), byte), 2);
+               __m256i b = _mm256_srli_epi32(_mm256_and_si256(_mm256_srl_epi32(p, blueCount), byte), 3);
+               __m256i out = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(r, 11), _mm256_slli_epi32(g, 5)), b);
+               // packus works per 128-bit lane; the permute puts the halves back in order
+               out = _mm256_permute4x64_epi64(_mm256_packus_epi32(out, out), _MM_SHUFFLE(3, 1, 2, 0));
+               _mm_storeu_si128((__m128i *)(dst + i), _mm256_castsi256_si128(out));
+          }
+          to565Scalar(src + i, dst + i, count - i, redShift);
+     }
+
+     __attribute__((target("avx2"))) inline __m256i div255PairsAvx2(__m256i t)
+     {
+          t = _mm256_add_epi16(t, _mm256_set1_epi16(0x80));
+          return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+     }
+
+     __attribute__((target("avx2"))) void blendAvx2(const Uint32 *src, Uint32 *dst, int count)
+     {
+          const __m256i pairs = _mm256_set1_epi32(0x00FF00FF);
+          const __m256i alphaOne = _mm256_set1_epi32(0x00FF0000);
+          const __m256i low = _mm256_set1_epi32(0xFF);
+          int i = 0;
+          for (; i + 8 <= count; i += 8)
+          {
+               __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+               __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+               __m256i a = _mm256_srli_epi32(s, 24);
+               a = _mm256_or_si256(a, _mm256_slli_epi32(a, 16));
+               __m256i ia = _mm256_xor_si256(a, pairs);
+               __m256i rb = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_and_si256(s, pairs), a),
+                                             _mm256_mullo_epi16(_mm256_and_si256(d, pairs), ia));
+               __m256i ga = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(s, 8), low), alphaOne), a),
+                                             _mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi32(d, 8), pairs), ia));
+               _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(div255PairsAvx2(rb), _mm256_slli_epi32(div255PairsAvx2(ga), 8)));
+          }
+          blendScalar(src + i, dst + i, count - i);
+     }
+
+     __attribute__((target("avx2"))) void fill32Avx2(Uint32 *dst, int count, Uint32 color)
+     {
+          const __m256i value = _mm256_set1_epi32((int)color);
+          int i = 0;
+          for (; i + 8 <= count; i += 8)
+          {
+               _mm256_storeu_si256((__m256i *)(dst + i), value);
+          }
+          fill32Scalar(dst + i, count - i, color);
+     }
+
+     __attribute__((target("avx2"))) void fill16Avx2(Uint16 *dst, int count, Uint16 color)
+     {
+          const __m256i value = _mm256_set1_epi16((short)color);
+          int i = 0;
+          for (; i + 16 <= count; i += 16)
+          {
+               _mm256_storeu_si256((__m256i *)(dst + i), value);
+          }
+          fill16Scalar(dst + i, count - i, color);
+     }
+
+     const BlitKernelTable AVX2_TABLE = {swapAvx2, from565Avx2, to565Avx2, blendAvx2, fill32Avx2, fill16Avx2};
+
+     // --- AVX-512F: 16 pixels per step ---
+     // Foundation only (what SDL_HasAVX512F reports), so there are no 16-bit
+     // lane operations: blending multiplies the channel pairs as 32-bit
+     // words, the same arithmetic as the scalar kernel. 16-bit rows and the
+     // 565 conversions use the AVX2 kernels.
+
+     __attribute__((target("avx512f"))) void swapAvx512(const Uint32 *src, Uint32 *dst, int count)
+     {
+          const __m512i keep = _mm512_set1_epi32((int)0xFF00FF00u);
+          const __m512i low = _mm512_set1_epi32(0xFF);
+          int i = 0;
+          for (; i + 16 <= count; i += 16)
+          {
+               __m512i p = _mm512_loadu_si512((const void *)(src + i));
+               __m512i out = _mm512_or_si512(_mm512_and_si512(p, keep),
+                                             _mm512_or_si512(_mm512_and_si512(_mm512_srli_epi32(p, 16), low),
+                                                             _mm512_slli_epi32(_mm512_and_si512(p, low), 16)));
+               _mm512_storeu_si512((void *)(dst + i), out);
+          }
+          swapScalar(src + i, dst + i, count - i);
+     }
+
+     __attribute__((target("avx512f"))) inline __m512i div255PairsAvx512(__m512i t)
+     {
+          const __m512i pairs = _mm512_set1_epi32(0x00FF00FF);
+          t = _mm512_add_epi32(t, _mm512_set1_epi32(0x00800080));
+          return _mm512_and_si512(_mm512_srli_epi32(_mm512_add_epi32(t, _mm512_and_si512(_mm512_srli_epi32(t, 8), pairs)), 8), pairs);
+     }
+
+     __attribute__((target("avx512f"))) void blendAvx512(const Uint32 *src, Uint32 *dst, int count)
+     {
+          const __m512i pairs = _mm512_set1_epi32(0x00FF00FF);
+          const __m512i alphaOne = _mm512_set1_epi32(0x00FF0000);
+          const __m512i low = _mm512_set1_epi32(0xFF);
+          int i = 0;
+          for (; i + 16 <= count; i += 16)
+          {
+               __m512i s = _mm512_loadu_si512((const void *)(src + i));
+               __m512i d = _mm512_loadu_si512((const void *)(dst + i));
+               __m512i a = _mm512_srli_epi32(s, 24);
+               __m512i ia = _mm512_xor_si512(a, low);
+               __m512i rb = _mm512_add_epi32(_mm512_mullo_epi32(_mm512_and_si512(s, pairs), a),
+                                             _mm512_mullo_epi32(_mm512_and_si512(d, pairs), ia));
+               __m512i ga = _mm512_add_epi32(_mm512_mullo_epi32(_mm512_or_si512(_mm512_and_si512(_mm512_srli_epi32(s, 8), low), alphaOne), a),
+                                             _mm512_mullo_epi32(_mm512_and_si512(_mm512_srli_epi32(d, 8), pairs), ia));
+               _mm512_storeu_si512((void *)(dst + i), _mm512_or_si512(div255PairsAvx512(rb), _mm512_slli_epi32(div255PairsAvx512(ga), 8)));
+          }
+          blendScalar(src + i, dst + i, count - i);
+     }
+
+     __attribute__((target("avx512f"))) void fill32Avx512(Uint32 *dst, int count, Uint32 color)
+     {
+          const __m512i value = _mm512_set1_epi32((int)color);
+          int i = 0;
+          for (; i + 16 <= count; i += 16)
+          {
+               _mm512_storeu_si512((void *)(dst + i), value);
+          }
+          fill32Scalar(dst + i, count - i, color);
+     }
+
+     const BlitKernelTable AVX512_TABLE = {swapAvx512, from565Avx2, to565Avx2, blendAvx512, fill32Avx512, fill16Avx2};
+#endif
+
+#ifdef BLIT_KERNELS_NEON
+     // --- NEON: 4 pixels per step ---
+
+     void swapNeon(const Uint32 *src, Uint32 *dst, int count)
+     {
+          const uint32x4_t keep = vdupq_n_u32(0xFF00FF00u);
+          const uint32x4_t low = vdupq_n_u32(0xFF);
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               uint32x4_t p = vld1q_u32(src + i);
+               uint32x4_t out = vorrq_u32(vandq_u32(p, keep), vorrq_u32(vandq_u32(vshrq_n_u32(p, 16), low), vshlq_n_u32(vandq_u32(p, low), 16)));
+               vst1q_u32(dst + i, out);
+          }
+          swapScalar(src + i, dst + i, count - i);
+     }
+
+     void from565Neon(const Uint16 *src, Uint32 *dst, int count, int redShift)
+     {
+          const int32x4_t redCount = vdupq_n_s32(redShift), blueCount = vdupq_n_s32(16 - redShift);
+          const uint32x4_t five = vdupq_n_u32(31), six = vdupq_n_u32(63);
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               uint32x4_t p = vmovl_u16(vld1_u16(src + i));
+               uint32x4_t r = vandq_u32(vshrq_n_u32(p, 11), five);
+               uint32x4_t g = vandq_u32(vshrq_n_u32(p, 5), six);
+               uint32x4_t b = vandq_u32(p, five);
+               r = vorrq_u32(vshlq_n_u32(r, 3), vshrq_n_u32(r, 2));
+               g = vorrq_u32(vshlq_n_u32(g, 2), vshrq_n_u32(g, 4));
+               b = vorrq_u32(vshlq_n_u32(b, 3), vshrq_n_u32(b, 2));
+               uint32x4_t out = vorrq_u32(vorrq_u32(vdupq_n_u32(0xFF000000u), vshlq_u32(r, redCount)),
+                                          vorrq_u32(vshlq_n_u32(g, 8), vshlq_u32(b, blueCount)));
+               vst1q_u32(dst + i, out);
+          }
+          from565Scalar(src + i, dst + i, count - i, redShift);
+     }
+
+     void to565Neon(const Uint32 *src, Uint16 *dst, int count, int redShift)
+     {
+          // Negative counts shift right
+          const int32x4_t redCount = vdupq_n_s32(-redShift), blueCount = vdupq_n_s32(redShift - 16);
+          const uint32x4_t byte = vdupq_n_u32(0xFF);
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               uint32x4_t p = vld1q_u32(src + i);
+               uint32x4_t r = vshrq_n_u32(vandq_u32(vshlq_u32(p, redCount), byte), 3);
+               uint32x4_t g = vshrq_n_u32(vandq_u32(vshrq_n_u32(p, 8), byte), 2);
+               uint32x4_t b = vshrq_n_u32(vandq_u32(vshlq_u32(p, blueCount), byte), 3);
+               uint32x4_t out = vorrq_u32(vorrq_u32(vshlq_n_u32(r, 11), vshlq_n_u32(g, 5)), b);
+               vst1_u16(dst + i, vmovn_u32(out));
+          }
+          to565Scalar(src + i, dst + i, count - i, redShift);
+     }
+
+     inline uint32x4_t div255PairsNeon(uint32x4_t t)
+     {
+          const uint32x4_t pairs = vdupq_n_u32(0x00FF00FF);
+          t = vaddq_u32(t, vdupq_n_u32(0x00800080));
+          return vandq_u32(vshrq_n_u32(vaddq_u32(t, vandq_u32(vshrq_n_u32(t, 8), pairs)), 8), pairs);
+     }
+
+     void blendNeon(const Uint32 *src, Uint32 *dst, int count)
+     {
+          const uint32x4_t pairs = vdupq_n_u32(0x00FF00FF);
+          const uint32x4_t alphaOne = vdupq_n_u32(0x00FF0000);
+          const uint32x4_t low = vdupq_n_u32(0xFF);
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               uint32x4_t s = vld1q_u32(src + i);
+               uint32x4_t d = vld1q_u32(dst + i);
+               uint32x4_t a = vshrq_n_u32(s, 24);
+               uint32x4_t ia = veorq_u32(a, low);
+               uint32x4_t rb = vaddq_u32(vmulq_u32(vandq_u32(s, pairs), a), vmulq_u32(vandq_u32(d, pairs), ia));
+               uint32x4_t ga = vaddq_u32(vmulq_u32(vorrq_u32(vandq_u32(vshrq_n_u32(s, 8), low), alphaOne), a),
+                                         vmulq_u32(vandq_u32(vshrq_n_u32(d, 8), pairs), ia));
+               vst1q_u32(dst + i, vorrq_u32(div255PairsNeon(rb), vshlq_n_u32(div255PairsNeon(ga), 8)));
+          }
+          blendScalar(src + i, dst + i, count - i);
+     }
+
+     void fill32Neon(Uint32 *dst, int count, Uint32 color)
+     {
+          const uint32x4_t value = vdupq_n_u32(color);
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               vst1q_u32(dst + i, value);
+          }
+          fill32Scalar(dst + i, count - i, color);
+     }
+
+     void fill16Neon(Uint16 *dst, int count, Uint16 color)
+     {
+          const uint16x8_t value = vdupq_n_u16(color);
+          int i = 0;
+          for (; i + 8 <= count; i += 8)
+          {
+               vst1q_u16(dst + i, value);
+          }
+          fill16Scalar(dst + i, count - i, color);
+     }
+
+     const BlitKernelTable NEON_TABLE = {swapNeon, from565Neon, to565Neon, blendNeon, fill32Neon, fill16Neon};
+#endif
+
+     BlitKernel activeKernel = BLIT_KERNEL_AUTO;
+     const BlitKernelTable *activeTable = &SCALAR_TABLE;
+
+     // Surfaces the kernels can read or write directly: red at bit 16 or 0,
+     // green at 8, alpha (if any) at 24
+     bool redShiftOf(Uint32 format, int &redShift)
+     {
+          switch (format)
+          {
+          case SDL_PIXELFORMAT_ARGB8888:
+               redShift = 16;
+               return true;
+          case SDL_PIXELFORMAT_ABGR8888:
+               redShift = 0;
+               return true;
+          default:
+               return false;
+          }
+     }
+
+     // Nothing but the pixels and the blend mode affects the blit
+     bool plainSource(SDL_Surface *src, SDL_BlendMode &blend)
+     {
+          Uint8 r, g, b, a;
+          SDL_GetSurfaceBlendMode(src, &blend);
+          SDL_GetSurfaceColorMod(src, &r, &g, &b);
+          SDL_GetSurfaceAlphaMod(src, &a);
+          return (r & g & b & a) == 255 && !SDL_HasColorKey(src) && !(src->flags & SDL_RLEACCEL);
+     }
+
+     Uint8 *pixelAt(SDL_Surface *surface, int x, int y)
+     {
+          return (Uint8 *)surface->pixels + (size_t)y * surface->pitch + (size_t)x * surface->format->BytesPerPixel;
+     }
+}
+
+bool blitKernelSupported(BlitKernel kernel)
+{
+     switch (kernel)
+     {
+     case BLIT_KERNEL_AUTO:
+     case BLIT_KERNEL_SCALAR:
+          return true;
+#ifdef BLIT_KERNELS_X86
+     case BLIT_KERNEL_SSE2:
+          return cpuHasSse2();
+#endif
+#ifdef BLIT_KERNELS_AVX
+     case BLIT_KERNEL_AVX2:
+          return SDL_HasAVX2() == SDL_TRUE;
+     case BLIT_KERNEL_AVX512:
+          return SDL_HasAVX512F() == SDL_TRUE && SDL_HasAVX2() == SDL_TRUE;
+#endif
+#ifdef BLIT_KERNELS_NEON
+     case BLIT_KERNEL_NEON:
+          return SDL_HasNEON() == SDL_TRUE;
+#endif
+     default:
+          return false;
+     }
+}
+
+const char *blitKernelName(BlitKernel kernel)
+{
+     switch (kernel)
+     {
+     case BLIT_KERNEL_SCALAR:
+          return "scalar";
+     case BLIT_KERNEL_SSE2:
+          return "sse2";
+     case BLIT_KERNEL_AVX2:
+          return "avx2";
+     case BLIT_KERNEL_AVX512:
+          return "avx512";
+     case BLIT_KERNEL_NEON:
+          return "neon";
+     default:
+          return "auto";
+     }
+}
+
+BlitKernel blitSetKernel(BlitKernel kernel)
+{
+     if (kernel == BLIT_KERNEL_AUTO)
+     {
+          const BlitKernel preferred[] = {BLIT_KERNEL_AVX512, BLIT_KERNEL_AVX2, BLIT_KERNEL_NEON, BLIT_KERNEL_SSE2};
+          kernel = BLIT_KERNEL_SCALAR;
+          for (BlitKernel candidate : preferred)
+          {
+               if (blitKernelSupported(candidate))
+               {
+                    kernel = candidate;
+                    break;
+               }
+          }
+     }
+     else if (!blitKernelSupported(kernel))
+     {
+          kernel = BLIT_KERNEL_SCALAR;
+     }
+
+     activeKernel = kernel;
+     activeTable = &SCALAR_TABLE;
+#ifdef BLIT_KERNELS_X86
+     if (kernel == BLIT_KERNEL_SSE2)
+     {
+          activeTable = &SSE2_TABLE;
+     }
+#endif
+#ifdef BLIT_KERNELS_AVX
+     if (kernel == BLIT_KERNEL_AVX2)
+     {
+          activeTable = &AVX2_TABLE;
+     }
+     if (kernel == BLIT_KERNEL_AVX512)
+     {
+          activeTable = &AVX512_TABLE;
+     }
+#endif
+#ifdef BLIT_KERNELS_NEON
+     if (kernel == BLIT_KERNEL_NEON)
+     {
+          activeTable = &NEON_TABLE;
+     }
+#endif
+     return kernel;
+}
+
+const BlitKernelTable &blitKernels()
+{
+     if (activeKernel == BLIT_KERNEL_AUTO)
+     {
+          blitSetKernel(BLIT_KERNEL_AUTO);
+     }
+     return *activeTable;
+}
+
+bool blitClipRects(const SDL_Surface *src, const SDL_Rect *srcrect, const SDL_Surface *dst,
+                   const SDL_Rect *dstrect, SDL_Rect &from, SDL_Rect &to)
+{
+     // The same steps as SDL_UpperBlit, so the covered area matches SDL's
+     from = srcrect != nullptr ? *srcrect : SDL_Rect{0, 0, src->w, src->h};
+     to = SDL_Rect{dstrect != nullptr ? dstrect->x : 0, dstrect != nullptr ? dstrect->y : 0, 0, 0};
+     if (from.x < 0)
+     {
+          from.w += from.x;
+          to.x -= from.x;
+          from.x = 0;
+     }
+     if (from.y < 0)
+     {
+          from.h += from.y;
+          to.y -= from.y;
+          from.y = 0;
+     }
+     from.w = SDL_min(from.w, src->w - from.x);
+     from.h = SDL_min(from.h, src->h - from.y);
+     const SDL_Rect &clip = dst->clip_rect;
+     if (clip.x > to.x)
+     {
+          from.w -= clip.x - to.x;
+          from.x += clip.x - to.x;
+          to.x = clip.x;
+     }
+     if (clip.y > to.y)
+     {
+          from.h -= clip.y - to.y;
+          from.y += clip.y - to.y;
+          to.y = clip.y;
+     }
+     from.w -= SDL_max(0, to.x + from.w - clip.x - clip.w);
+     from.h -= SDL_max(0, to.y + from.h - clip.y - clip.h);
+     to.w = SDL_max(0, from.w);
+     to.h = SDL_max(0, from.h);
+     return from.w > 0 && from.h > 0;
+}
+
+int blitSurfaceFast(SDL_Surface *src, const SDL_Rect *srcrect, SDL_Surface *dst, SDL_Rect *dstrect)
+{
+     SDL_BlendMode blend;
+     if (src == nullptr || dst == nullptr || SDL_MUSTLOCK(src) || SDL_MUSTLOCK(dst) || !plainSource(src, blend))
+     {
+          return SDL_BlitSurface(src, srcrect, dst, dstrect);
+     }
+
+     const Uint32 srcFormat = src->format->format;
+     const Uint32 dstFormat = dst->format->format;
+     int srcRed = 0, dstRed = 0;
+     const bool src8888 = redShiftOf(srcFormat, srcRed);
+     const bool dst8888 = redShiftOf(dstFormat, dstRed);
+     const bool src565 = srcFormat == SDL_PIXELFORMAT_RGB565;
+     const bool dst565 = dstFormat == SDL_PIXELFORMAT_RGB565;
+
+     // Which kernel row operation this blit is, if any
+     enum { NONE, SWAP, FROM565, TO565, BLEND } operation = NONE;
+     if (blend == SDL_BLENDMODE_NONE && src8888 && dst8888 && srcRed != dstRed)
+     {
+          operation = SWAP;
+     }
+     else if (blend == SDL_BLENDMODE_NONE && src565 && dst8888)
+     {
+          operation = FROM565;
+     }
+     else if (blend == SDL_BLENDMODE_NONE && src8888 && dst565)
+     {
+          operation = TO565;
+     }
+     else if (blend == SDL_BLENDMODE_BLEND && src8888 && srcFormat == dstFormat)
+     {
+          operation = BLEND;
+     }
+     if (operation == NONE)
+     {
+          return SDL_BlitSurface(src, srcrect, dst, dstrect);
+     }
+
+     SDL_Rect from, to;
+     const bool visible = blitClipRects(src, srcrect, dst, dstrect, from, to);
+     if (dstrect != nullptr)
+     {
+          *dstrect = to;
+     }
+     if (!visible)
+     {
+          return 0;
+     }
+     const BlitKernelTable &kernels = blitKernels();
+     const int redShift = src8888 ? srcRed : dstRed;
+     for (int y = 0; y < from.h; y++)
+     {
+          const Uint8 *in = pixelAt(src, from.x, from.y + y);
+          Uint8 *out = pixelAt(dst, to.x, to.y + y);
+          switch (operation)
+          {
+          case SWAP:
+               kernels.swapRedBlue((const Uint32 *)in, (Uint32 *)out, from.w);
+               break;
+          case FROM565:
+               kernels.from565((const Uint16 *)in, (Uint32 *)out, from.w, redShift);
+               break;
+          case TO565:
+               kernels.to565((const Uint32 *)in, (Uint16 *)out, from.w, redShift);
+               break;
+          default:
+               kernels.blend((const Uint32 *)in, (Uint32 *)out, from.w);
+               break;
+          }
+     }
+     return 0;
+}
+
+int blitFillRect(SDL_Surface *dst, const SDL_Rect *rect, Uint32 color)
+{
+     if (dst == nullptr || SDL_MUSTLOCK(dst) || (dst->format->BytesPerPixel != 4 && dst->format->BytesPerPixel != 2))
+     {
+          return SDL_FillRect(dst, rect, color);
+     }
+     SDL_Rect area = dst->clip_rect;
+     if (rect != nullptr && !SDL_IntersectRect(rect, &dst->clip_rect, &area))
+     {
+          return 0;
+     }
+     const BlitKernelTable &kernels = blitKernels();
+     for (int y = area.y; y < area.y + area.h; y++)
+     {
+          if (dst->format->BytesPerPixel == 4)
+          {
+               kernels.fill32((Uint32 *)pixelAt(dst, area.x, y), area.w, color);
+          }
+          else
+          {
+               kernels.fill16((Uint16 *)pixelAt(dst, area.x, y), area.w, (Uint16)color);
+          }
+     }
+     return 0;
+}
@@ -0,0 +1,69 @@
+// Description:
+// Runtime-dispatched row kernels for the common 32- and 16-bit blits:
+// swapping ARGB8888 and ABGR8888, converting to and from RGB565,
+// alpha-blending and filling. Each operation has scalar, SSE2, AVX2,
+// AVX-512 (F only) and NEON versions. The fastest one this CPU supports
+// (as SDL_cpuinfo.h reports it) is chosen on first use, or set with
+// blitSetKernel() for benchmarks.
+//
+// Every kernel uses the same integer arithmetic, so all of them produce
+// identical pixels. Blending is SDL_BLENDMODE_BLEND with exact rounding:
+// dstRGB = (srcRGB * a + dstRGB * (255 - a)) / 255 and
+// dstA = a + dstA * (255 - a) / 255. SDL's own blitters shift by 8
+// instead of dividing by 255, so results can differ from SDL_BlitSurface
+// by one step per channel. RGB565 expands by bit replication and narrows
+// by truncation, as SDL does.
+//
+// blitSurfaceFast() and blitFillRect() take whole surfaces, use a kernel
+// when the formats and surface state allow one, and call SDL otherwise.
+// =============================================================================
+
+#ifndef BLIT_KERNELS_H
+#define BLIT_KERNELS_H
+
+#include <SDL2/SDL.h>
+
+enum BlitKernel
+{
+     BLIT_KERNEL_AUTO,
+     BLIT_KERNEL_SCALAR,
+     BLIT_KERNEL_SSE2,
+     BLIT_KERNEL_AVX2,
+     BLIT_KERNEL_AVX512,
+     BLIT_KERNEL_NEON
+};
+
+// One row of `count` pixels each, in and out may not overlap.
+// `redShift` is 16 for ARGB8888 and 0 for ABGR8888.
+struct BlitKernelTable
+{
+     void (*swapRedBlue)(const Uint32 *src, Uint32 *dst, int count);
+     void (*from565)(const Uint16 *src, Uint32 *dst, int count, int redShift);
+     void (*to565)(const Uint32 *src, Uint16 *dst, int count, int redShift);
+     void (*blend)(const Uint32 *src, Uint32 *dst, int count); // Alpha in the top byte of both
+     void (*fill32)(Uint32 *dst, int count, Uint32 color);
+     void (*fill16)(Uint16 *dst, int count, Uint16 color);
+};
+
+bool blitKernelSupported(BlitKernel kernel);
+const char *blitKernelName(BlitKernel kernel);
+
+// Force a kernel; unsupported ones fall back to scalar. Returns the kernel
+// now in use.
+BlitKernel blitSetKernel(BlitKernel kernel);
+
+// The kernels in use
+const BlitKernelTable &blitKernels();
+
+// Clip like SDL_BlitSurface: `from` and `to` get the source and destination
+// rects actually covered (same size). False when nothing is drawn.
+bool blitClipRects(const SDL_Surface *src, const SDL_Rect *srcrect, const SDL_Surface *dst,
+                   const SDL_Rect *dstrect, SDL_Rect &from, SDL_Rect &to);
+
+// Same contract as SDL_BlitSurface
+int blitSurfaceFast(SDL_Surface *src, const SDL_Rect *srcrect, SDL_Surface *dst, SDL_Rect *dstrect);
+
+// Same contract as SDL_FillRect
+int blitFillRect(SDL_Surface *dst, const SDL_Rect *rect, Uint32 color);
+
+#endif // BLIT_KERNELS_H
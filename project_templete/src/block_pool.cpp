@@ -0,0 +1,100 @@
+#include "block_pool.h"
+
+void blockPoolInit(BlockPool &pool, int capacity)
+{
+     pool.capacity = capacity;
+     pool.x.assign(capacity, 0.0f);
+     pool.y.assign(capacity, 0.0f);
+     pool.prevY.assign(capacity, 0.0f);
+     pool.vy.assign(capacity, 0.0f);
+     pool.alive.assign(capacity, 0);
+     pool.freeList.assign(capacity, 0);
+     pool.freeCount = 0;
+     pool.liveCount = 0;
+     pool.highWater = 0;
+}
+
+void blockPoolClear(BlockPool &pool)
+{
+     SDL_memset(pool.alive.data(), 0, pool.alive.size());
+     pool.freeCount = 0;
+     pool.liveCount = 0;
+     pool.highWater = 0;
+}
+
+int blockPoolSpawn(BlockPool &pool, float x, float y, float vy)
+{
+     int index;
+     if (pool.freeCount > 0)
+     {
+          index = pool.freeList[--pool.freeCount];
+     }
+     else if (pool.highWater < pool.capacity)
+     {
+          index = pool.highWater++;
+     }
+     else
+     {
+          return -1;
+     }
+
+     pool.x[index] = x;
+     pool.y[index] = y;
+     pool.prevY[index] = y;
+     pool.vy[index] = vy;
+     pool.alive[index] = 1;
+     pool.liveCount++;
+     return index;
+}
+
+void blockPoolDespawn(BlockPool &pool, int index)
+{
+     if (index < 0 || index >= pool.highWater || !pool.alive[index])
+     {
+          return;
+     }
+     pool.alive[index] = 0;
+     pool.liveCount--;
+
+     // Shrink the iteration range when the top slot goes away, so an emptied
+     // pool costs nothing to walk
+     if (index == pool.highWater - 1)
+     {
+          pool.highWater--;
+          while (pool.highWater > 0 && !pool.alive[pool.highWater - 1])
+          {
+               pool.highWater--;
+          }
+          // Slots at or above the new high-water mark are handed out from
+          // highWater again, so drop them from the free list
+          int keep = 0;
+          for (int i = 0; i < pool.freeCount; i++)
+          {
+               if (pool.freeList[i] < pool.highWater)
+               {
+                    pool.freeList[keep++] = pool.freeList[i];
+               }
+          }
+          pool.freeCount = keep;
+     }
+     else
+     {
+          pool.freeList[pool.freeCount++] = index;
+     }
+}
+
+void blockPoolIntegrate(BlockPool &pool)
+{
+     const int n = pool.highWater;
+     float *y = pool.y.data();
+     float *prevY = pool.prevY.data();
+     const float *vy = pool.vy.data();
+
+     // Dead slots are updated too: it keeps the loop branch-free and their
+     // contents are overwritten on the next spawn anyway
+     for (int i = 0; i < n; i++)
+     {
+          prevY[i] = y[i];
+          y[i] += vy[i];
+     }
+}
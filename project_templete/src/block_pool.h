@@ -0,0 +1,52 @@
+// Description:
+// Fixed-capacity pool of falling blocks stored as struct-of-arrays. All
+// storage is allocated once by blockPoolInit(); spawning and despawning only
+// push and pop indices on a free list, so the game loop never allocates.
+// Every array keeps its size from then on, free list included, so a
+// rollback snapshot can copy the pool as a handful of fixed spans.
+//
+// Iterate live blocks with:
+//     for (int i = 0; i < pool.highWater; i++)
+//          if (pool.alive[i]) { ... }
+// =============================================================================
+
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct BlockPool
+{
+     int capacity;  // Maximum number of simultaneously live blocks
+     int liveCount; // Number of live blocks
+     int highWater; // One past the highest live index; despawning the top block lowers it
+     int freeCount; // Entries in use at the front of freeList
+
+     // Per-block data, indexed by handle
+     std::vector<float> x;     // Left edge
+     std::vector<float> y;     // Top edge
+     std::vector<float> prevY; // Top edge at the previous simulation tick
+     std::vector<float> vy;    // Fall speed in pixels per tick
+     std::vector<Uint8> alive; // 1 while the slot holds a live block
+
+     std::vector<int> freeList; // Stack of released slots below highWater, `capacity` long
+};
+
+// Allocate storage for up to `capacity` blocks
+void blockPoolInit(BlockPool &pool, int capacity);
+
+// Despawn every block without releasing storage
+void blockPoolClear(BlockPool &pool);
+
+// Returns the new block's index, or -1 if the pool is full
+int blockPoolSpawn(BlockPool &pool, float x, float y, float vy);
+
+// Release a live block's slot for reuse
+void blockPoolDespawn(BlockPool &pool, int index);
+
+// Store the current positions as the previous tick's and advance every
+// live block by its velocity
+void blockPoolIntegrate(BlockPool &pool);
+
+#endif // BLOCK_POOL_H
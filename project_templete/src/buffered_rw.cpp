@@ -0,0 +1,287 @@
+#include "buffered_rw.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+     struct BufferedStream
+     {
+          SDL_RWops *inner;
+          bool ownsInner;
+          bool seekable;      // `inner` reported a position
+          std::vector<Uint8> buffer;
+          Sint64 position;    // Where the caller is
+          Sint64 innerPosition; // Where `inner` is, -1 when unknown
+          bool innerWriting;  // Direction of the last transfer on `inner`
+          Sint64 windowStart; // File offset of buffer[0] for reads
+          size_t windowFill;  // Bytes of it valid, 0 for no read window
+          Sint64 writeStart;  // File offset of buffer[0] for writes
+          size_t pendingWrite; // Bytes of it not yet written
+          size_t readahead;   // Next refill size
+     };
+
+     BufferedStream *streamOf(SDL_RWops *context)
+     {
+          return (BufferedStream *)context->hidden.unknown.data1;
+     }
+
+     // Also between a read and a write, which stdio requires even in place.
+     // A stream that cannot seek (a pipe) only goes forward in one direction,
+     // so there the transfer must continue where the last one ended
+     bool seekInner(BufferedStream &stream, Sint64 offset, bool writing)
+     {
+          const bool turning = stream.innerWriting != writing;
+          stream.innerWriting = writing;
+          if (!stream.seekable)
+          {
+               if (stream.innerPosition != offset)
+               {
+                    SDL_SetError("Stream is not seekable");
+                    return false;
+               }
+               return true;
+          }
+          if (stream.innerPosition == offset && !turning)
+          {
+               return true;
+          }
+          stream.innerPosition = SDL_RWseek(stream.inner, offset, RW_SEEK_SET);
+          return stream.innerPosition == offset;
+     }
+
+     bool flushWrites(BufferedStream &stream)
+     {
+          if (stream.pendingWrite == 0)
+          {
+               return true;
+          }
+          const size_t pending = stream.pendingWrite;
+          stream.pendingWrite = 0;
+          if (!seekInner(stream, stream.writeStart, true))
+          {
+               return false;
+          }
+          const size_t written = SDL_RWwrite(stream.inner, stream.buffer.data(), 1, pending);
+          stream.innerPosition += (Sint64)written;
+          return written == pending;
+     }
+
+     Sint64 SDLCALL bufferedSize(SDL_RWops *context)
+     {
+          BufferedStream &stream = *streamOf(context);
+          if (!flushWrites(stream))
+          {
+               return -1;
+          }
+          return SDL_RWsize(stream.inner);
+     }
+
+     Sint64 SDLCALL bufferedSeek(SDL_RWops *context, Sint64 offset, int whence)
+     {
+          BufferedStream &stream = *streamOf(context);
+          Sint64 target;
+          switch (whence)
+          {
+          case RW_SEEK_SET:
+               target = offset;
+               break;
+          case RW_SEEK_CUR:
+               target = stream.position + offset;
+               break;
+          case RW_SEEK_END:
+          {
+               const Sint64 size = bufferedSize(context);
+               if (size < 0)
+               {
+                    return -1;
+               }
+               target = size + offset;
+               break;
+          }
+          default:
+               return SDL_SetError("Unknown value for 'whence'");
+          }
+          if (target < 0)
+          {
+               return SDL_SetError("Seek before the start of the stream");
+          }
+          // Without a seekable stream, only the buffered read window can be revisited
+          const Sint64 windowEnd = stream.windowStart + (Sint64)stream.windowFill;
+          if (!stream.seekable && target != stream.position &&
+              (stream.windowFill == 0 || target < stream.windowStart || target > windowEnd))
+          {
+               return SDL_SetError("Stream is not seekable");
+          }
+          // Pending writes stay one contiguous run, so a seek away ends it
+          if (target != stream.position && !flushWrites(stream))
+          {
+               return -1;
+          }
+          stream.position = target;
+          return target;
+     }
+
+     size_t SDLCALL bufferedRead(SDL_RWops *context, void *ptr, size_t size, size_t maxnum)
+     {
+          BufferedStream &stream = *streamOf(context);
+          if (size == 0 || maxnum == 0 || !flushWrites(stream))
+          {
+               return 0;
+          }
+          Uint8 *out = (Uint8 *)ptr;
+          size_t remaining = size * maxnum;
+          size_t done = 0;
+          while (remaining > 0)
+          {
+               const Sint64 windowEnd = stream.windowStart + (Sint64)stream.windowFill;
+               if (stream.position >= stream.windowStart && stream.position < windowEnd)
+               {
+                    const size_t offset = (size_t)(stream.position - stream.windowStart);
+                    const size_t take = SDL_min(remaining, stream.windowFill - offset);
+                    std::memcpy(out + done, stream.buffer.data() + offset, take);
+                    stream.position += (Sint64)take;
+                    done += take;
+                    remaining -= take;
+                    continue;
+               }
+
+               // A refill right where the last window ended is a sequential
+               // read; anything else starts the readahead over
+               const bool sequential = stream.windowFill > 0 && stream.position == windowEnd;
+               stream.readahead = sequential ? SDL_min(stream.readahead * 2, stream.buffer.size())
+                                             : SDL_min(BUFFERED_RW_MIN_READAHEAD, stream.buffer.size());
+               if (!seekInner(stream, stream.position, false))
+               {
+                    break;
+               }
+               if (remaining >= stream.buffer.size())
+               {
+                    // Copying through the buffer would only add a memcpy
+                    const size_t read = SDL_RWread(stream.inner, out + done, 1, remaining);
+                    stream.innerPosition += (Sint64)read;
+                    stream.position += (Sint64)read;
+                    done += read;
+                    remaining -= read;
+                    stream.windowFill = 0;
+                    break;
+               }
+               const size_t request = SDL_max(stream.readahead, remaining);
+               stream.windowStart = stream.position;
+               stream.windowFill = SDL_RWread(stream.inner, stream.buffer.data(), 1, request);
+               stream.innerPosition += (Sint64)stream.windowFill;
+               if (stream.windowFill == 0)
+               {
+                    break;
+               }
+          }
+          return done / size;
+     }
+
+     size_t SDLCALL bufferedWrite(SDL_RWops *context, const void *ptr, size_t size, size_t num)
+     {
+          BufferedStream &stream = *streamOf(context);
+          const size_t total = size * num;
+          if (total == 0)
+          {
+               return 0;
+          }
+          // The writes may overwrite what the read window holds
+          stream.windowFill = 0;
+          if (stream.pendingWrite > 0 &&
+              (stream.pendingWrite + total > stream.buffer.size() ||
+               stream.writeStart + (Sint64)stream.pendingWrite != stream.position))
+          {
+               if (!flushWrites(stream))
+               {
+                    return 0;
+               }
+          }
+          if (total >= stream.buffer.size())
+          {
+               if (!seekInner(stream, stream.position, true))
+               {
+                    return 0;
+               }
+               const size_t written = SDL_RWwrite(stream.inner, ptr, 1, total);
+               stream.innerPosition += (Sint64)written;
+               stream.position += (Sint64)written;
+               return written / size;
+          }
+          if (stream.pendingWrite == 0)
+          {
+               stream.writeStart = stream.position;
+          }
+          std::memcpy(stream.buffer.data() + stream.pendingWrite, ptr, total);
+          stream.pendingWrite += total;
+          stream.position += (Sint64)total;
+          return num;
+     }
+
+     int SDLCALL bufferedClose(SDL_RWops *context)
+     {
+          BufferedStream *stream = streamOf(context);
+          int status = flushWrites(*stream) ? 0 : -1;
+          if (stream->ownsInner && SDL_RWclose(stream->inner) != 0)
+          {
+               status = -1;
+          }
+          delete stream;
+          SDL_FreeRW(context);
+          return status;
+     }
+}
+
+SDL_RWops *bufferedRWFromFile(const char *file, const char *mode, size_t blockBytes)
+{
+     SDL_RWops *inner = SDL_RWFromFile(file, mode);
+     if (inner == nullptr)
+     {
+          return nullptr;
+     }
+     return bufferedRWWrap(inner, 1, blockBytes);
+}
+
+SDL_RWops *bufferedRWWrap(SDL_RWops *inner, int freeInner, size_t blockBytes)
+{
+     if (inner == nullptr)
+     {
+          SDL_InvalidParamError("inner");
+          return nullptr;
+     }
+     SDL_RWops *rw = SDL_AllocRW();
+     if (rw == nullptr)
+     {
+          if (freeInner)
+          {
+               SDL_RWclose(inner);
+          }
+          return nullptr;
+     }
+     BufferedStream *stream = new BufferedStream;
+     stream->inner = inner;
+     stream->ownsInner = freeInner != 0;
+     stream->buffer.resize(SDL_max(blockBytes, BUFFERED_RW_MIN_READAHEAD));
+     stream->position = SDL_RWtell(inner);
+     stream->seekable = stream->position >= 0;
+     if (!stream->seekable)
+     {
+          stream->position = 0; // Positions count from here; reads and writes still work in order
+     }
+     stream->innerPosition = stream->position;
+     stream->innerWriting = false;
+     stream->windowStart = 0;
+     stream->windowFill = 0;
+     stream->writeStart = 0;
+     stream->pendingWrite = 0;
+     stream->readahead = BUFFERED_RW_MIN_READAHEAD;
+
+     rw->size = bufferedSize;
+     rw->seek = bufferedSeek;
+     rw->read = bufferedRead;
+     rw->write = bufferedWrite;
+     rw->close = bufferedClose;
+     rw->type = SDL_RWOPS_UNKNOWN;
+     rw->hidden.unknown.data1 = stream;
+     return rw;
+}
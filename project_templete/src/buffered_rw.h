@@ -0,0 +1,40 @@
+// Description:
+// Buffered SDL_RWops over a file or another stream. SDL_RWFromFile hands
+// every SDL_RWread to stdio or a Win32 handle, and the decoders behind
+// IMG_Load_RW, Mix_LoadMUS_RW and TTF_OpenFontRW parse chunk headers 4 to
+// 64 bytes at a time, so loading one file is thousands of calls through
+// the C runtime or into the kernel. This wraps the stream in a block
+// buffer:
+//
+// - reads are served from the buffer; refills read ahead by 4 KB at first
+//   and double on every sequential refill up to `blockBytes`, dropping
+//   back to 4 KB after a seek outside the buffer, so scanning a file gets
+//   big reads and hopping around a seek table does not drag in data it
+//   skips;
+// - seeks inside the buffered block move a position and touch nothing;
+// - reads of a block or more go straight into the caller's memory;
+// - writes gather in the same buffer and go out as one write when it
+//   fills, or on a seek, read, size query or close.
+//
+// The result behaves like the stream it wraps, SDL_RWtell included, and
+// is closed with SDL_RWclose as usual. Over a stream that cannot seek, the
+// wrapper never seeks it either: reads and writes go on in order, and a
+// seek only succeeds inside the buffered read window.
+// =============================================================================
+
+#ifndef BUFFERED_RW_H
+#define BUFFERED_RW_H
+
+#include <SDL2/SDL.h>
+
+const size_t BUFFERED_RW_MIN_READAHEAD = 4 * 1024;
+const size_t BUFFERED_RW_DEFAULT_BLOCK = 128 * 1024;
+
+// SDL_RWFromFile, buffered. Returns nullptr with SDL's error set on failure
+SDL_RWops *bufferedRWFromFile(const char *file, const char *mode, size_t blockBytes = BUFFERED_RW_DEFAULT_BLOCK);
+
+// Buffer an open stream; `freeInner` non-zero closes it with the wrapper.
+// On failure `inner` is still closed if `freeInner` says so
+SDL_RWops *bufferedRWWrap(SDL_RWops *inner, int freeInner, size_t blockBytes = BUFFERED_RW_DEFAULT_BLOCK);
+
+#endif // BUFFERED_RW_H
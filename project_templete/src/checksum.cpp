@@ -0,0 +1,556 @@
+#include "checksum.h"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)) && defined(__GNUC__) && !defined(__EMSCRIPTEN__)
+#define CHECKSUM_X86 1
+#include <cpuid.h>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define CHECKSUM_ARMV8 1
+#include <arm_acle.h>
+#endif
+
+namespace
+{
+     // --- Slicing-by-8 tables ---
+     // table[k][b] is the CRC of byte b followed by k zero bytes, so eight
+     // lookups advance the CRC over eight bytes at once.
+
+     struct CrcTables
+     {
+          Uint32 table[8][256];
+
+          explicit CrcTables(Uint32 polynomial)
+          {
+               for (Uint32 n = 0; n < 256; n++)
+               {
+                    Uint32 c = n;
+                    for (int k = 0; k < 8; k++)
+                    {
+                         c = (c & 1) ? polynomial ^ (c >> 1) : c >> 1;
+                    }
+                    table[0][n] = c;
+               }
+               for (Uint32 n = 0; n < 256; n++)
+               {
+                    for (int k = 1; k < 8; k++)
+                    {
+                         table[k][n] = table[0][table[k - 1][n] & 0xFF] ^ (table[k - 1][n] >> 8);
+                    }
+               }
+          }
+     };
+
+     const CrcTables &crc32Tables()
+     {
+          static const CrcTables tables(0xEDB88320u);
+          return tables;
+     }
+
+     const CrcTables &crc32cTables()
+     {
+          static const CrcTables tables(0x82F63B78u);
+          return tables;
+     }
+
+     // Works on the inverted CRC, the state every kernel below passes around
+     Uint32 crcSlice8(const CrcTables &tables, Uint32 crc, const Uint8 *in, size_t size)
+     {
+          const Uint32(*t)[256] = tables.table;
+          while (size > 0 && ((uintptr_t)in & 7) != 0)
+          {
+               crc = t[0][(crc ^ *in++) & 0xFF] ^ (crc >> 8);
+               size--;
+          }
+          while (size >= 8)
+          {
+               Uint32 low, high;
+               std::memcpy(&low, in, 4);
+               std::memcpy(&high, in + 4, 4);
+               low = SDL_SwapLE32(low) ^ crc;
+               high = SDL_SwapLE32(high);
+               crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+                     t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+               in += 8;
+               size -= 8;
+          }
+          while (size-- > 0)
+          {
+               crc = t[0][(crc ^ *in++) & 0xFF] ^ (crc >> 8);
+          }
+          return crc;
+     }
+
+     Uint32 crc32Table(Uint32 crc, const void *data, size_t size)
+     {
+          return ~crcSlice8(crc32Tables(), ~crc, (const Uint8 *)data, size);
+     }
+
+     Uint32 crc32cTable(Uint32 crc, const void *data, size_t size)
+     {
+          return ~crcSlice8(crc32cTables(), ~crc, (const Uint8 *)data, size);
+     }
+
+     const ChecksumKernelTable CHECKSUM_TABLE_TABLE = {crc32Table, crc32cTable};
+
+#ifdef CHECKSUM_X86
+     // --- x86: carry-less multiply folding for CRC-32, SSE4.2 for CRC-32C ---
+     // Four 128-bit lanes are folded forward 64 bytes per step, then into
+     // one lane and Barrett-reduced, as in Intel's "Fast CRC Computation
+     // Using PCLMULQDQ" with the constants for the reflected polynomial.
+
+     alignas(16) const Uint64 CHECKSUM_FOLD_64[2] = {0x0154442bd4ull, 0x01c6e41596ull};
+     alignas(16) const Uint64 CHECKSUM_FOLD_16[2] = {0x01751997d0ull, 0x00ccaa009eull};
+     alignas(16) const Uint64 CHECKSUM_FOLD_8[2] = {0x0163cd6124ull, 0};
+     alignas(16) const Uint64 CHECKSUM_BARRETT[2] = {0x01db710641ull, 0x01f7011641ull};
+
+     __attribute__((target("pclmul,sse4.1"))) Uint32 crcFold(const Uint8 *in, size_t size, Uint32 crc)
+     {
+          __m128i x1 = _mm_loadu_si128((const __m128i *)(in + 0x00));
+          __m128i x2 = _mm_loadu_si128((const __m128i *)(in + 0x10));
+          __m128i x3 = _mm_loadu_si128((const __m128i *)(in + 0x20));
+          __m128i x4 = _mm_loadu_si128((const __m128i *)(in + 0x30));
+          x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+          __m128i k = _mm_load_si128((const __m128i *)CHECKSUM_FOLD_64);
+          in += 64;
+          size -= 64;
+          while (size >= 64)
+          {
+               const __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+               const __m128i x6 = _mm_clmulepi64_si128(x2, k, 0x00);
+               const __m128i x7 = _mm_clmulepi64_si128(x3, k, 0x00);
+               const __m128i x8 = _mm_clmulepi64_si128(x4, k, 0x00);
+               x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+               x2 = _mm_clmulepi64_si128(x2, k, 0x11);
+               x3 = _mm_clmulepi64_si128(x3, k, 0x11);
+               x4 = _mm_clmulepi64_si128(x4, k, 0x11);
+               x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(in + 0x00)));
+               x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(in + 0x10)));
+               x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(in + 0x20)));
+               x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(in + 0x30)));
+               in += 64;
+               size -= 64;
+          }
+
+          // Four lanes into one, then any remaining 16-byte blocks
+          k = _mm_load_si128((const __m128i *)CHECKSUM_FOLD_16);
+          __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+          x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k, 0x11), x2), x5);
+          x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+          x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k, 0x11), x3), x5);
+          x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+          x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k, 0x11), x4), x5);
+          while (size >= 16)
+          {
+               x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+               x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k, 0x11),
+                                                _mm_loadu_si128((const __m128i *)in)),
+                                  x5);
+               in += 16;
+               size -= 16;
+          }
+
+          // 128 bits to 64, then Barrett reduction to 32
+          const __m128i low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+          x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+          x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+          k = _mm_loadl_epi64((const __m128i *)CHECKSUM_FOLD_8);
+          x2 = _mm_srli_si128(x1, 4);
+          x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, low32), k, 0x00), x2);
+          k = _mm_load_si128((const __m128i *)CHECKSUM_BARRETT);
+          x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, low32), k, 0x10);
+          x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, low32), k, 0x00);
+          return (Uint32)_mm_extract_epi32(_mm_xor_si128(x1, x2), 1);
+     }
+
+     Uint32 crc32X86(Uint32 crc, const void *data, size_t size)
+     {
+          const Uint8 *in = (const Uint8 *)data;
+          crc = ~crc;
+          if (size >= 64)
+          {
+               const size_t folded = size & ~(size_t)15;
+               crc = crcFold(in, folded, crc);
+               in += folded;
+               size -= folded;
+          }
+          return ~crcSlice8(crc32Tables(), crc, in, size);
+     }
+
+     __attribute__((target("sse4.2"))) Uint32 crc32cX86(Uint32 crc, const void *data, size_t size)
+     {
+          const Uint8 *in = (const Uint8 *)data;
+          crc = ~crc;
+          while (size > 0 && ((uintptr_t)in & 7) != 0)
+          {
+               crc = _mm_crc32_u8(crc, *in++);
+               size--;
+          }
+#if defined(__x86_64__)
+          Uint64 wide = crc;
+          for (; size >= 8; in += 8, size -= 8)
+          {
+               Uint64 word;
+               std::memcpy(&word, in, 8);
+               wide = _mm_crc32_u64(wide, word);
+          }
+          crc = (Uint32)wide;
+#endif
+          for (; size >= 4; in += 4, size -= 4)
+          {
+               Uint32 word;
+               std::memcpy(&word, in, 4);
+               crc = _mm_crc32_u32(crc, word);
+          }
+          while (size-- > 0)
+          {
+               crc = _mm_crc32_u8(crc, *in++);
+          }
+          return ~crc;
+     }
+
+     const ChecksumKernelTable CHECKSUM_X86_TABLE = {crc32X86, crc32cX86};
+
+     bool checksumHasX86()
+     {
+          unsigned eax, ebx, ecx, edx;
+          // PCLMULQDQ, SSE4.1 and SSE4.2
+          return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1u << 1)) && (ecx & (1u << 19)) &&
+                 (ecx & (1u << 20));
+     }
+#endif
+
+#ifdef CHECKSUM_ARMV8
+     // --- ARMv8: one instruction per 8 bytes for either polynomial ---
+
+     Uint32 crc32Armv8(Uint32 crc, const void *data, size_t size)
+     {
+          const Uint8 *in = (const Uint8 *)data;
+          crc = ~crc;
+          for (; size >= 8; in += 8, size -= 8)
+          {
+               Uint64 word;
+               std::memcpy(&word, in, 8);
+               crc = __crc32d(crc, word);
+          }
+          while (size-- > 0)
+          {
+               crc = __crc32b(crc, *in++);
+          }
+          return ~crc;
+     }
+
+     Uint32 crc32cArmv8(Uint32 crc, const void *data, size_t size)
+     {
+          const Uint8 *in = (const Uint8 *)data;
+          crc = ~crc;
+          for (; size >= 8; in += 8, size -= 8)
+          {
+               Uint64 word;
+               std::memcpy(&word, in, 8);
+               crc = __crc32cd(crc, word);
+          }
+          while (size-- > 0)
+          {
+               crc = __crc32cb(crc, *in++);
+          }
+          return ~crc;
+     }
+
+     const ChecksumKernelTable CHECKSUM_ARMV8_TABLE = {crc32Armv8, crc32cArmv8};
+#endif
+
+     ChecksumKernel activeChecksumKernel = CHECKSUM_KERNEL_AUTO;
+     const ChecksumKernelTable *activeChecksumTable = &CHECKSUM_TABLE_TABLE;
+
+     // --- MD5 ---
+
+     const Uint32 MD5_SINES[64] = {
+          0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+          0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+          0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+          0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+          0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+          0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+          0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+          0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+     inline Uint32 rotl(Uint32 x, int n)
+     {
+          return (x << n) | (x >> (32 - n));
+     }
+
+// One step of each round, fully unrolled below; `i` is the step number
+#define MD5_STEP(f, a, b, c, d, word, shift, i) a = b + rotl(a + f(b, c, d) + (word) + MD5_SINES[i], shift)
+#define MD5_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+
+     void md5Blocks(Uint32 state[4], const Uint8 *in, size_t blocks)
+     {
+          for (; blocks > 0; blocks--, in += 64)
+          {
+               Uint32 w[16];
+               std::memcpy(w, in, 64);
+               for (Uint32 &word : w)
+               {
+                    word = SDL_SwapLE32(word);
+               }
+               Uint32 a = state[0], b = state[1], c = state[2], d = state[3];
+
+               MD5_STEP(MD5_F, a, b, c, d, w[0], 7, 0);
+               MD5_STEP(MD5_F, d, a, b, c, w[1], 12, 1);
+               MD5_STEP(MD5_F, c, d, a, b, w[2], 17, 2);
+               MD5_STEP(MD5_F, b, c, d, a, w[3], 22, 3);
+               MD5_STEP(MD5_F, a, b, c, d, w[4], 7, 4);
+               MD5_STEP(MD5_F, d, a, b, c, w[5], 12, 5);
+               MD5_STEP(MD5_F, c, d, a, b, w[6], 17, 6);
+               MD5_STEP(MD5_F, b, c, d, a, w[7], 22, 7);
+               MD5_STEP(MD5_F, a, b, c, d, w[8], 7, 8);
+               MD5_STEP(MD5_F, d, a, b, c, w[9], 12, 9);
+               MD5_STEP(MD5_F, c, d, a, b, w[10], 17, 10);
+               MD5_STEP(MD5_F, b, c, d, a, w[11], 22, 11);
+               MD5_STEP(MD5_F, a, b, c, d, w[12], 7, 12);
+               MD5_STEP(MD5_F, d, a, b, c, w[13], 12, 13);
+               MD5_STEP(MD5_F, c, d, a, b, w[14], 17, 14);
+               MD5_STEP(MD5_F, b, c, d, a, w[15], 22, 15);
+
+               MD5_STEP(MD5_G, a, b, c, d, w[1], 5, 16);
+               MD5_STEP(MD5_G, d, a, b, c, w[6], 9, 17);
+               MD5_STEP(MD5_G, c, d, a, b, w[11], 14, 18);
+               MD5_STEP(MD5_G, b, c, d, a, w[0], 20, 19);
+               MD5_STEP(MD5_G, a, b, c, d, w[5], 5, 20);
+               MD5_STEP(MD5_G, d, a, b, c, w[10], 9, 21);
+               MD5_STEP(MD5_G, c, d, a, b, w[15], 14, 22);
+               MD5_STEP(MD5_G, b, c, d, a, w[4], 20, 23);
+               MD5_STEP(MD5_G, a, b, c, d, w[9], 5, 24);
+               MD5_STEP(MD5_G, d, a, b, c, w[14], 9, 25);
+               MD5_STEP(MD5_G, c, d, a, b, w[3], 14, 26);
+               MD5_STEP(MD5_G, b, c, d, a, w[8], 20, 27);
+               MD5_STEP(MD5_G, a, b, c, d, w[13], 5, 28);
+               MD5_STEP(MD5_G, d, a, b, c, w[2], 9, 29);
+               MD5_STEP(MD5_G, c, d, a, b, w[7], 14, 30);
+               MD5_STEP(MD5_G, b, c, d, a, w[12], 20, 31);
+
+               MD5_STEP(MD5_H, a, b, c, d, w[5], 4, 32);
+               MD5_STEP(MD5_H, d, a, b, c, w[8], 11, 33);
+               MD5_STEP(MD5_H, c, d, a, b, w[11], 16, 34);
+               MD5_STEP(MD5_H, b, c, d, a, w[14], 23, 35);
+               MD5_STEP(MD5_H, a, b, c, d, w[1], 4, 36);
+               MD5_STEP(MD5_H, d, a, b, c, w[4], 11, 37);
+               MD5_STEP(MD5_H, c, d, a, b, w[7], 16, 38);
+               MD5_STEP(MD5_H, b, c, d, a, w[10], 23, 39);
+               MD5_STEP(MD5_H, a, b, c, d, w[13], 4, 40);
+               MD5_STEP(MD5_H, d, a, b, c, w[0], 11, 41);
+               MD5_STEP(MD5_H, c, d, a, b, w[3], 16, 42);
+               MD5_STEP(MD5_H, b, c, d, a, w[6], 23, 43);
+               MD5_STEP(MD5_H, a, b, c, d, w[9], 4, 44);
+               MD5_STEP(MD5_H, d, a, b, c, w[12], 11, 45);
+               MD5_STEP(MD5_H, c, d, a, b, w[15], 16, 46);
+               MD5_STEP(MD5_H, b, c, d, a, w[2], 23, 47);
+
+               MD5_STEP(MD5_I, a, b, c, d, w[0], 6, 48);
+               MD5_STEP(MD5_I, d, a, b, c, w[7], 10, 49);
+               MD5_STEP(MD5_I, c, d, a, b, w[14], 15, 50);
+               MD5_STEP(MD5_I, b, c, d, a, w[5], 21, 51);
+               MD5_STEP(MD5_I, a, b, c, d, w[12], 6, 52);
+               MD5_STEP(MD5_I, d, a, b, c, w[3], 10, 53);
+               MD5_STEP(MD5_I, c, d, a, b, w[10], 15, 54);
+               MD5_STEP(MD5_I, b, c, d, a, w[1], 21, 55);
+               MD5_STEP(MD5_I, a, b, c, d, w[8], 6, 56);
+               MD5_STEP(MD5_I, d, a, b, c, w[15], 10, 57);
+               MD5_STEP(MD5_I, c, d, a, b, w[6], 15, 58);
+               MD5_STEP(MD5_I, b, c, d, a, w[13], 21, 59);
+               MD5_STEP(MD5_I, a, b, c, d, w[4], 6, 60);
+               MD5_STEP(MD5_I, d, a, b, c, w[11], 10, 61);
+               MD5_STEP(MD5_I, c, d, a, b, w[2], 15, 62);
+               MD5_STEP(MD5_I, b, c, d, a, w[9], 21, 63);
+
+               state[0] += a;
+               state[1] += b;
+               state[2] += c;
+               state[3] += d;
+          }
+     }
+
+#undef MD5_STEP
+#undef MD5_F
+#undef MD5_G
+#undef MD5_H
+#undef MD5_I
+}
+
+bool checksumKernelSupported(ChecksumKernel kernel)
+{
+     switch (kernel)
+     {
+     case CHECKSUM_KERNEL_AUTO:
+     case CHECKSUM_KERNEL_TABLE:
+          return true;
+#ifdef CHECKSUM_X86
+     case CHECKSUM_KERNEL_X86:
+          return checksumHasX86();
+#endif
+#ifdef CHECKSUM_ARMV8
+     case CHECKSUM_KERNEL_ARMV8:
+          return true; // The compiler was told the target has them
+#endif
+     default:
+          return false;
+     }
+}
+
+const char *checksumKernelName(ChecksumKernel kernel)
+{
+     switch (kernel)
+     {
+     case CHECKSUM_KERNEL_TABLE:
+          return "table";
+     case CHECKSUM_KERNEL_X86:
+          return "pclmul+sse4.2";
+     case CHECKSUM_KERNEL_ARMV8:
+          return "armv8-crc";
+     default:
+          return "auto";
+     }
+}
+
+ChecksumKernel checksumSetKernel(ChecksumKernel kernel)
+{
+     if (kernel == CHECKSUM_KERNEL_AUTO)
+     {
+          const ChecksumKernel preferred[] = {CHECKSUM_KERNEL_X86, CHECKSUM_KERNEL_ARMV8};
+          kernel = CHECKSUM_KERNEL_TABLE;
+          for (ChecksumKernel candidate : preferred)
+          {
+               if (checksumKernelSupported(candidate))
+               {
+                    kernel = candidate;
+                    break;
+               }
+          }
+     }
+     else if (!checksumKernelSupported(kernel))
+     {
+          kernel = CHECKSUM_KERNEL_TABLE;
+     }
+
+     activeChecksumKernel = kernel;
+     activeChecksumTable = &CHECKSUM_TABLE_TABLE;
+#ifdef CHECKSUM_X86
+     if (kernel == CHECKSUM_KERNEL_X86)
+     {
+          activeChecksumTable = &CHECKSUM_X86_TABLE;
+     }
+#endif
+#ifdef CHECKSUM_ARMV8
+     if (kernel == CHECKSUM_KERNEL_ARMV8)
+     {
+          activeChecksumTable = &CHECKSUM_ARMV8_TABLE;
+     }
+#endif
+     return kernel;
+}
+
+const ChecksumKernelTable &checksumKernels()
+{
+     if (activeChecksumKernel == CHECKSUM_KERNEL_AUTO)
+     {
+          checksumSetKernel(CHECKSUM_KERNEL_AUTO);
+     }
+     return *activeChecksumTable;
+}
+
+Uint32 crc32Update(Uint32 crc, const void *data, size_t size)
+{
+     return checksumKernels().crc32(crc, data, size);
+}
+
+Uint32 crc32cUpdate(Uint32 crc, const void *data, size_t size)
+{
+     return checksumKernels().crc32c(crc, data, size);
+}
+
+Uint32 checksumSurface(SDL_Surface *surface)
+{
+     if (surface == nullptr || SDL_LockSurface(surface) != 0)
+     {
+          return 0;
+     }
+     const size_t rowBytes = (size_t)surface->w * surface->format->BytesPerPixel;
+     const Uint8 *row = (const Uint8 *)surface->pixels;
+     Uint32 crc = 0;
+     if (rowBytes == (size_t)surface->pitch)
+     {
+          crc = crc32cUpdate(0, row, rowBytes * surface->h);
+     }
+     else
+     {
+          for (int y = 0; y < surface->h; y++, row += surface->pitch)
+          {
+               crc = crc32cUpdate(crc, row, rowBytes);
+          }
+     }
+     SDL_UnlockSurface(surface);
+     return crc;
+}
+
+void md5Init(Md5 &md5)
+{
+     md5.state[0] = 0x67452301;
+     md5.state[1] = 0xefcdab89;
+     md5.state[2] = 0x98badcfe;
+     md5.state[3] = 0x10325476;
+     md5.length = 0;
+}
+
+void md5Update(Md5 &md5, const void *data, size_t size)
+{
+     const Uint8 *in = (const Uint8 *)data;
+     size_t used = (size_t)(md5.length & 63);
+     md5.length += size;
+     if (used > 0)
+     {
+          const size_t take = SDL_min(size, 64 - used);
+          std::memcpy(md5.pending + used, in, take);
+          in += take;
+          size -= take;
+          if (used + take < 64)
+          {
+               return;
+          }
+          md5Blocks(md5.state, md5.pending, 1);
+     }
+     // Whole blocks straight from the caller's buffer
+     md5Blocks(md5.state, in, size / 64);
+     in += size & ~(size_t)63;
+     std::memcpy(md5.pending, in, size & 63);
+}
+
+void md5Final(Md5 &md5, Uint8 digest[16])
+{
+     const Uint64 bits = md5.length * 8;
+     Uint8 padding[72] = {0x80};
+     const size_t used = (size_t)(md5.length & 63);
+     const size_t pad = used < 56 ? 56 - used : 120 - used;
+     md5Update(md5, padding, pad);
+     Uint8 lengthBytes[8];
+     for (int i = 0; i < 8; i++)
+     {
+          lengthBytes[i] = (Uint8)(bits >> (8 * i));
+     }
+     md5Update(md5, lengthBytes, 8);
+     for (int i = 0; i < 4; i++)
+     {
+          const Uint32 word = md5.state[i];
+          digest[i * 4 + 0] = (Uint8)word;
+          digest[i * 4 + 1] = (Uint8)(word >> 8);
+          digest[i * 4 + 2] = (Uint8)(word >> 16);
+          digest[i * 4 + 3] = (Uint8)(word >> 24);
+     }
+}
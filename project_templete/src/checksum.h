@@ -0,0 +1,72 @@
+// Description:
+// Checksums for comparing frames and files: CRC-32, CRC-32C and MD5, all
+// incremental. SDLTest_Crc32Calc and SDLTest_Md5 work a byte at a time
+// and take whole buffers only; a 4K readback then costs tens of
+// milliseconds to hash, which adds up over many golden-image checks.
+//
+// - crc32Update: the zlib/PNG CRC-32 (polynomial 0xEDB88320), what PNG
+//   chunks and .zip files carry. Folded 64 bytes at a time with carry-less
+//   multiplies (PCLMULQDQ) on x86, the ARMv8 CRC instructions where the
+//   compiler targets them, slicing-by-8 tables otherwise.
+// - crc32cUpdate: CRC-32C (Castagnoli, 0x82F63B78), which SSE4.2 and ARMv8
+//   compute in one instruction per 8 bytes. Use it when the value only
+//   has to match itself, such as comparing a frame against a golden one.
+// - Md5: RFC 1321, for digests shared with other tools. MD5 is serial by
+//   design, so this one is only the straightforward unrolled form, a few
+//   times faster than SDLTest's.
+//
+// CRCs start from 0 and chain: crc32Update(crc32Update(0, a), b) equals
+// the CRC of a followed by b. Kernels are picked on first use like
+// mem_kernels.h's, or forced with checksumSetKernel() for benchmarks.
+// =============================================================================
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <SDL2/SDL.h>
+
+enum ChecksumKernel
+{
+     CHECKSUM_KERNEL_AUTO,
+     CHECKSUM_KERNEL_TABLE, // Slicing-by-8
+     CHECKSUM_KERNEL_X86,   // PCLMULQDQ for CRC-32, SSE4.2 for CRC-32C
+     CHECKSUM_KERNEL_ARMV8  // CRC32 and CRC32C instructions
+};
+
+struct ChecksumKernelTable
+{
+     Uint32 (*crc32)(Uint32 crc, const void *data, size_t size);
+     Uint32 (*crc32c)(Uint32 crc, const void *data, size_t size);
+};
+
+bool checksumKernelSupported(ChecksumKernel kernel);
+const char *checksumKernelName(ChecksumKernel kernel);
+
+// Force a kernel; unsupported ones fall back to the tables. Returns the
+// kernel now in use.
+ChecksumKernel checksumSetKernel(ChecksumKernel kernel);
+
+// The kernels in use
+const ChecksumKernelTable &checksumKernels();
+
+Uint32 crc32Update(Uint32 crc, const void *data, size_t size);
+Uint32 crc32cUpdate(Uint32 crc, const void *data, size_t size);
+
+// CRC-32C of a surface's pixels, row by row so pitch padding is left out;
+// two surfaces with the same format and pixels give the same value
+Uint32 checksumSurface(SDL_Surface *surface);
+
+struct Md5
+{
+     Uint32 state[4];
+     Uint64 length; // Bytes so far
+     Uint8 pending[64];
+};
+
+void md5Init(Md5 &md5);
+void md5Update(Md5 &md5, const void *data, size_t size);
+
+// The 16-byte digest; `md5` must be initialized again before reuse
+void md5Final(Md5 &md5, Uint8 digest[16]);
+
+#endif // CHECKSUM_H
@@ -0,0 +1,526 @@
+#include "color_map.h"
+
+#include <cstring>
+
+#include "blit_kernels.h"
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define COLOR_MAP_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+     ColorKernel activeColorKernel = COLOR_KERNEL_AUTO;
+     const ColorKernelTable *activeColorTable = nullptr;
+
+     ColorChannel channelOf(Uint32 mask, Uint8 shift)
+     {
+          ColorChannel channel;
+          channel.mask = mask;
+          channel.shift = mask != 0 ? shift : 0;
+          channel.bits = 0;
+          for (Uint32 bits = mask >> channel.shift; bits & 1; bits >>= 1)
+          {
+               channel.bits++;
+          }
+          return channel;
+     }
+
+     // SDL's expand tables: the value's bits repeated down to 8
+     inline Uint8 widen(Uint32 value, int bits)
+     {
+          Uint32 wide = value;
+          int filled = bits;
+          while (filled < 8)
+          {
+               wide = (wide << bits) | value;
+               filled += bits;
+          }
+          return (Uint8)(wide >> (filled - 8));
+     }
+
+     inline Uint32 mapDirect(const ColorMap &map, const SDL_Color &color)
+     {
+          const Uint8 values[4] = {color.r, color.g, color.b, color.a};
+          Uint32 pixel = 0;
+          for (int i = 0; i < 4; i++)
+          {
+               const ColorChannel &channel = map.channels[i];
+               if (channel.bits != 0)
+               {
+                    pixel |= (Uint32)(values[i] >> (8 - channel.bits)) << channel.shift;
+               }
+          }
+          return pixel;
+     }
+
+     inline SDL_Color getDirect(const ColorMap &map, Uint32 pixel)
+     {
+          Uint8 values[4] = {0, 0, 0, 255};
+          for (int i = 0; i < 4; i++)
+          {
+               const ColorChannel &channel = map.channels[i];
+               if (channel.bits != 0)
+               {
+                    values[i] = widen((pixel & channel.mask) >> channel.shift, channel.bits);
+               }
+          }
+          return SDL_Color{values[0], values[1], values[2], values[3]};
+     }
+
+     inline Uint32 load24(const Uint8 *p)
+     {
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+          return ((Uint32)p[0] << 16) | ((Uint32)p[1] << 8) | p[2];
+#else
+          return p[0] | ((Uint32)p[1] << 8) | ((Uint32)p[2] << 16);
+#endif
+     }
+
+     inline void store24(Uint8 *p, Uint32 pixel)
+     {
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+          p[0] = (Uint8)(pixel >> 16);
+          p[1] = (Uint8)(pixel >> 8);
+          p[2] = (Uint8)pixel;
+#else
+          p[0] = (Uint8)pixel;
+          p[1] = (Uint8)(pixel >> 8);
+          p[2] = (Uint8)(pixel >> 16);
+#endif
+     }
+
+     // --- Scalar kernels ---
+
+     void map32Scalar(const ColorMap &map, const SDL_Color *colors, Uint32 *pixels, int count)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               pixels[i] = mapDirect(map, colors[i]);
+          }
+     }
+
+     void map16Scalar(const ColorMap &map, const SDL_Color *colors, Uint16 *pixels, int count)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               pixels[i] = (Uint16)mapDirect(map, colors[i]);
+          }
+     }
+
+     void get32Scalar(const ColorMap &map, const Uint32 *pixels, SDL_Color *colors, int count)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               colors[i] = getDirect(map, pixels[i]);
+          }
+     }
+
+     void get16Scalar(const ColorMap &map, const Uint16 *pixels, SDL_Color *colors, int count)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               colors[i] = getDirect(map, pixels[i]);
+          }
+     }
+
+     const ColorKernelTable COLOR_SCALAR_TABLE = {map32Scalar, map16Scalar, get32Scalar, get16Scalar};
+
+#ifdef COLOR_MAP_X86
+     // --- SSE2: 4 pixels per step. Every lane shares the format's shifts,
+     // so each channel is a pair of whole-register shifts ---
+
+     // Red, green, blue and alpha of 4 colours in 32-bit lanes
+     inline __m128i packColors(const ColorMap &map, __m128i c)
+     {
+          const __m128i byteMask = _mm_set1_epi32(0xFF);
+          const __m128i values[4] = {_mm_and_si128(c, byteMask), _mm_and_si128(_mm_srli_epi32(c, 8), byteMask),
+                                     _mm_and_si128(_mm_srli_epi32(c, 16), byteMask), _mm_srli_epi32(c, 24)};
+          __m128i pixels = _mm_setzero_si128();
+          for (int i = 0; i < 4; i++)
+          {
+               const ColorChannel &channel = map.channels[i];
+               if (channel.bits != 0)
+               {
+                    const __m128i narrowed = _mm_srl_epi32(values[i], _mm_cvtsi32_si128(8 - channel.bits));
+                    pixels = _mm_or_si128(pixels, _mm_sll_epi32(narrowed, _mm_cvtsi32_si128(channel.shift)));
+               }
+          }
+          return pixels;
+     }
+
+     inline __m128i unpackPixels(const ColorMap &map, __m128i p)
+     {
+          __m128i colors = map.channels[3].bits == 0 ? _mm_set1_epi32((int)0xFF000000u) : _mm_setzero_si128();
+          for (int i = 0; i < 4; i++)
+          {
+               const ColorChannel &channel = map.channels[i];
+               if (channel.bits == 0)
+               {
+                    continue;
+               }
+               const __m128i bits = _mm_cvtsi32_si128(channel.bits);
+               const __m128i value =
+                   _mm_srl_epi32(_mm_and_si128(p, _mm_set1_epi32((int)channel.mask)), _mm_cvtsi32_si128(channel.shift));
+               __m128i wide = value;
+               int filled = channel.bits;
+               while (filled < 8)
+               {
+                    wide = _mm_or_si128(_mm_sll_epi32(wide, bits), value);
+                    filled += channel.bits;
+               }
+               wide = _mm_srl_epi32(wide, _mm_cvtsi32_si128(filled - 8));
+               colors = _mm_or_si128(colors, _mm_sll_epi32(wide, _mm_cvtsi32_si128(8 * i)));
+          }
+          return colors;
+     }
+
+     void map32Sse2(const ColorMap &map, const SDL_Color *colors, Uint32 *pixels, int count)
+     {
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               const __m128i c = _mm_loadu_si128((const __m128i *)(colors + i));
+               _mm_storeu_si128((__m128i *)(pixels + i), packColors(map, c));
+          }
+          map32Scalar(map, colors + i, pixels + i, count - i);
+     }
+
+     void map16Sse2(const ColorMap &map, const SDL_Color *colors, Uint16 *pixels, int count)
+     {
+          // packs_epi32 saturates signed, so values are biased into its
+          // range and back
+          const __m128i bias32 = _mm_set1_epi32(0x8000);
+          const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+          int i = 0;
+          for (; i + 8 <= count; i += 8)
+          {
+               const __m128i lo = packColors(map, _mm_loadu_si128((const __m128i *)(colors + i)));
+               const __m128i hi = packColors(map, _mm_loadu_si128((const __m128i *)(colors + i + 4)));
+               const __m128i packed = _mm_packs_epi32(_mm_sub_epi32(lo, bias32), _mm_sub_epi32(hi, bias32));
+               _mm_storeu_si128((__m128i *)(pixels + i), _mm_add_epi16(packed, bias16));
+          }
+          map16Scalar(map, colors + i, pixels + i, count - i);
+     }
+
+     void get32Sse2(const ColorMap &map, const Uint32 *pixels, SDL_Color *colors, int count)
+     {
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               const __m128i p = _mm_loadu_si128((const __m128i *)(pixels + i));
+               _mm_storeu_si128((__m128i *)(colors + i), unpackPixels(map, p));
+          }
+          get32Scalar(map, pixels + i, colors + i, count - i);
+     }
+
+     void get16Sse2(const ColorMap &map, const Uint16 *pixels, SDL_Color *colors, int count)
+     {
+          const __m128i zero = _mm_setzero_si128();
+          int i = 0;
+          for (; i + 8 <= count; i += 8)
+          {
+               const __m128i p = _mm_loadu_si128((const __m128i *)(pixels + i));
+               _mm_storeu_si128((__m128i *)(colors + i), unpackPixels(map, _mm_unpacklo_epi16(p, zero)));
+               _mm_storeu_si128((__m128i *)(colors + i + 4), unpackPixels(map, _mm_unpackhi_epi16(p, zero)));
+          }
+          get16Scalar(map, pixels + i, colors + i, count - i);
+     }
+
+     const ColorKernelTable COLOR_SSE2_TABLE = {map32Sse2, map16Sse2, get32Sse2, get16Sse2};
+#endif
+
+     // --- INDEX8 ---
+
+     void refreshPalette(ColorMap &map)
+     {
+          const SDL_Palette *palette = map.format->palette;
+          if (palette == map.palette && (palette == nullptr || palette->version == map.paletteVersion))
+          {
+               return;
+          }
+          map.palette = palette;
+          map.paletteVersion = palette != nullptr ? palette->version : 0;
+          map.colorCount = palette != nullptr ? SDL_min(palette->ncolors, 256) : 0;
+          if (map.colorCount > 0)
+          {
+               std::memcpy(map.colors, palette->colors, sizeof(SDL_Color) * map.colorCount);
+          }
+          std::memset(map.cacheKeys, 0, sizeof(map.cacheKeys));
+     }
+
+     // SDL_FindColor: the first entry at the smallest squared distance
+     Uint8 nearestColor(const ColorMap &map, const SDL_Color &color)
+     {
+          Uint32 smallest = ~0u;
+          Uint8 index = 0;
+          for (int i = 0; i < map.colorCount; i++)
+          {
+               const int rd = map.colors[i].r - color.r, gd = map.colors[i].g - color.g, bd = map.colors[i].b - color.b,
+                         ad = map.colors[i].a - color.a;
+               const Uint32 distance = (Uint32)(rd * rd + gd * gd + bd * bd + ad * ad);
+               if (distance < smallest)
+               {
+                    index = (Uint8)i;
+                    if (distance == 0)
+                    {
+                         break;
+                    }
+                    smallest = distance;
+               }
+          }
+          return index;
+     }
+
+     void mapIndexed(ColorMap &map, const SDL_Color *colors, Uint8 *pixels, int count)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               const Uint32 rgba = colors[i].r | ((Uint32)colors[i].g << 8) | ((Uint32)colors[i].b << 16) |
+                                   ((Uint32)colors[i].a << 24);
+               const Uint64 key = rgba | (1ull << 32);
+               const Uint32 slot = ((rgba * 2654435761u) >> 16) & (COLOR_MAP_CACHE - 1);
+               if (map.cacheKeys[slot] != key)
+               {
+                    map.cacheKeys[slot] = key;
+                    map.cacheIndices[slot] = nearestColor(map, colors[i]);
+               }
+               pixels[i] = map.cacheIndices[slot];
+          }
+     }
+
+     void getIndexed(const ColorMap &map, const Uint8 *pixels, SDL_Color *colors, int count)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               colors[i] = pixels[i] < map.colorCount ? map.colors[pixels[i]] : SDL_Color{0, 0, 0, 0};
+          }
+     }
+
+     bool plainPaletteSource(SDL_Surface *src)
+     {
+          SDL_BlendMode blend;
+          Uint8 r, g, b, a;
+          SDL_GetSurfaceBlendMode(src, &blend);
+          SDL_GetSurfaceColorMod(src, &r, &g, &b);
+          SDL_GetSurfaceAlphaMod(src, &a);
+          return blend == SDL_BLENDMODE_NONE && (r & g & b & a) == 255 && !SDL_HasColorKey(src) &&
+                 !(src->flags & SDL_RLEACCEL);
+     }
+}
+
+bool colorKernelSupported(ColorKernel kernel)
+{
+     switch (kernel)
+     {
+     case COLOR_KERNEL_AUTO:
+     case COLOR_KERNEL_SCALAR:
+          return true;
+#ifdef COLOR_MAP_X86
+     case COLOR_KERNEL_SSE2:
+          return cpuHasSse2();
+#endif
+     default:
+          return false;
+     }
+}
+
+const char *colorKernelName(ColorKernel kernel)
+{
+     switch (kernel)
+     {
+     case COLOR_KERNEL_SCALAR:
+          return "scalar";
+     case COLOR_KERNEL_SSE2:
+          return "sse2";
+     default:
+          return "auto";
+     }
+}
+
+ColorKernel colorSetKernel(ColorKernel kernel)
+{
+     if (kernel == COLOR_KERNEL_AUTO)
+     {
+          kernel = colorKernelSupported(COLOR_KERNEL_SSE2) ? COLOR_KERNEL_SSE2 : COLOR_KERNEL_SCALAR;
+     }
+     else if (!colorKernelSupported(kernel))
+     {
+          kernel = COLOR_KERNEL_SCALAR;
+     }
+
+     activeColorKernel = kernel;
+     activeColorTable = &COLOR_SCALAR_TABLE;
+#ifdef COLOR_MAP_X86
+     if (kernel == COLOR_KERNEL_SSE2)
+     {
+          activeColorTable = &COLOR_SSE2_TABLE;
+     }
+#endif
+     return kernel;
+}
+
+const ColorKernelTable &colorKernels()
+{
+     if (activeColorKernel == COLOR_KERNEL_AUTO)
+     {
+          colorSetKernel(COLOR_KERNEL_AUTO);
+     }
+     return *activeColorTable;
+}
+
+bool colorMapInit(ColorMap &map, const SDL_PixelFormat *format)
+{
+     map.format = format;
+     map.bytesPerPixel = format->BytesPerPixel;
+     map.indexed = SDL_ISPIXELFORMAT_INDEXED(format->format);
+     map.palette = nullptr;
+     map.paletteVersion = 0;
+     map.colorCount = 0;
+     if (SDL_ISPIXELFORMAT_FOURCC(format->format) || (map.indexed && format->format != SDL_PIXELFORMAT_INDEX8))
+     {
+          SDL_SetError("Unsupported pixel format %s", SDL_GetPixelFormatName(format->format));
+          return false;
+     }
+     if (map.indexed)
+     {
+          std::memset(map.channels, 0, sizeof(map.channels));
+          map.palette = (const SDL_Palette *)&map; // Never a palette; forces the first refresh
+          refreshPalette(map);
+          return true;
+     }
+
+     map.channels[0] = channelOf(format->Rmask, format->Rshift);
+     map.channels[1] = channelOf(format->Gmask, format->Gshift);
+     map.channels[2] = channelOf(format->Bmask, format->Bshift);
+     map.channels[3] = channelOf(format->Amask, format->Ashift);
+     for (const ColorChannel &channel : map.channels)
+     {
+          if (channel.bits > 8)
+          {
+               SDL_SetError("%s has channels wider than 8 bits", SDL_GetPixelFormatName(format->format));
+               return false;
+          }
+     }
+     return true;
+}
+
+void colorMapArray(ColorMap &map, const SDL_Color *colors, void *pixels, int count)
+{
+     if (map.indexed)
+     {
+          refreshPalette(map);
+          mapIndexed(map, colors, (Uint8 *)pixels, count);
+          return;
+     }
+     switch (map.bytesPerPixel)
+     {
+     case 4:
+          colorKernels().map32(map, colors, (Uint32 *)pixels, count);
+          break;
+     case 2:
+          colorKernels().map16(map, colors, (Uint16 *)pixels, count);
+          break;
+     case 3:
+          for (int i = 0; i < count; i++)
+          {
+               store24((Uint8 *)pixels + 3 * i, mapDirect(map, colors[i]));
+          }
+          break;
+     default:
+          for (int i = 0; i < count; i++)
+          {
+               ((Uint8 *)pixels)[i] = (Uint8)mapDirect(map, colors[i]);
+          }
+          break;
+     }
+}
+
+void colorGetArray(ColorMap &map, const void *pixels, SDL_Color *colors, int count)
+{
+     if (map.indexed)
+     {
+          refreshPalette(map);
+          getIndexed(map, (const Uint8 *)pixels, colors, count);
+          return;
+     }
+     switch (map.bytesPerPixel)
+     {
+     case 4:
+          colorKernels().get32(map, (const Uint32 *)pixels, colors, count);
+          break;
+     case 2:
+          colorKernels().get16(map, (const Uint16 *)pixels, colors, count);
+          break;
+     case 3:
+          for (int i = 0; i < count; i++)
+          {
+               colors[i] = getDirect(map, load24((const Uint8 *)pixels + 3 * i));
+          }
+          break;
+     default:
+          for (int i = 0; i < count; i++)
+          {
+               colors[i] = getDirect(map, ((const Uint8 *)pixels)[i]);
+          }
+          break;
+     }
+}
+
+void paletteExpandRow(const Uint8 *src, Uint32 *dst, int count, const Uint32 *table)
+{
+     int i = 0;
+     for (; i + 4 <= count; i += 4)
+     {
+          const Uint32 a = table[src[i]], b = table[src[i + 1]], c = table[src[i + 2]], d = table[src[i + 3]];
+          dst[i] = a;
+          dst[i + 1] = b;
+          dst[i + 2] = c;
+          dst[i + 3] = d;
+     }
+     for (; i < count; i++)
+     {
+          dst[i] = table[src[i]];
+     }
+}
+
+int paletteBlit(SDL_Surface *src, const SDL_Rect *srcrect, SDL_Surface *dst, SDL_Rect *dstrect)
+{
+     if (src == nullptr || dst == nullptr || src->format->format != SDL_PIXELFORMAT_INDEX8 ||
+         src->format->palette == nullptr || dst->format->BytesPerPixel != 4 ||
+         SDL_ISPIXELFORMAT_INDEXED(dst->format->format) || SDL_MUSTLOCK(src) || SDL_MUSTLOCK(dst) ||
+         !plainPaletteSource(src))
+     {
+          return SDL_BlitSurface(src, srcrect, dst, dstrect);
+     }
+
+     // Indices past the palette's end come out as 0
+     ColorMap map;
+     if (!colorMapInit(map, dst->format))
+     {
+          return SDL_BlitSurface(src, srcrect, dst, dstrect);
+     }
+     const SDL_Palette *palette = src->format->palette;
+     Uint32 table[256] = {};
+     colorMapArray(map, palette->colors, table, SDL_min(palette->ncolors, 256));
+
+     SDL_Rect from, to;
+     const bool visible = blitClipRects(src, srcrect, dst, dstrect, from, to);
+     if (dstrect != nullptr)
+     {
+          *dstrect = to;
+     }
+     if (!visible)
+     {
+          return 0;
+     }
+     for (int y = 0; y < from.h; y++)
+     {
+          const Uint8 *in = (const Uint8 *)src->pixels + (size_t)(from.y + y) * src->pitch + from.x;
+          Uint32 *out = (Uint32 *)((Uint8 *)dst->pixels + (size_t)(to.y + y) * dst->pitch) + to.x;
+          paletteExpandRow(in, out, from.w, table);
+     }
+     return 0;
+}
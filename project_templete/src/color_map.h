@@ -0,0 +1,100 @@
+// Description:
+// SDL_MapRGBA and SDL_GetRGBA over arrays. The SDL calls convert one
+// colour per call, reading the format's masks and losses each time, and
+// for an 8-bit palettized format SDL_MapRGBA searches all 256 palette
+// entries for the nearest colour on every call. Palette effects and
+// colorization that touch millions of pixels a frame pay that per pixel.
+//
+// A ColorMap takes the format apart once. For direct-colour formats the
+// array calls run SSE2 kernels (4 or 8 pixels per step, 16- and 32-bit
+// formats; 8- and 24-bit ones go scalar); the kernel is chosen on first
+// use, or set with colorSetKernel() for benchmarks. For INDEX8 the map
+// keeps the palette's colours for reading pixels back, and a cache of
+// nearest-colour results for mapping, so each distinct colour is searched
+// for once; both are rebuilt when the palette's version changes.
+//
+// Results are SDL's exactly: channels narrow by truncation and widen by
+// bit replication, formats without alpha read as opaque, and the nearest
+// palette colour is the first at the smallest squared RGBA distance.
+// Formats with channels wider than 8 bits (ARGB2101010) are refused.
+//
+// paletteBlit() is SDL_BlitSurface for an INDEX8 source onto a 32-bit
+// surface, through a 256-entry table of destination pixels built from the
+// palette, for the blits SDL would copy without blending or a colour key.
+// =============================================================================
+
+#ifndef COLOR_MAP_H
+#define COLOR_MAP_H
+
+#include <SDL2/SDL.h>
+
+#define COLOR_MAP_CACHE 4096 // Nearest-colour results kept, a power of two
+
+enum ColorKernel
+{
+     COLOR_KERNEL_AUTO,
+     COLOR_KERNEL_SCALAR,
+     COLOR_KERNEL_SSE2
+};
+
+struct ColorChannel
+{
+     Uint32 mask;
+     int shift;
+     int bits; // 0 when the format lacks the channel
+};
+
+struct ColorMap
+{
+     const SDL_PixelFormat *format;
+     int bytesPerPixel;
+     bool indexed;
+     ColorChannel channels[4]; // Red, green, blue, alpha
+
+     // INDEX8: the palette as last seen, and RGBA -> index results for it
+     const SDL_Palette *palette;
+     Uint32 paletteVersion;
+     int colorCount;
+     SDL_Color colors[256];
+     Uint64 cacheKeys[COLOR_MAP_CACHE]; // RGBA | 1 << 32, 0 when empty
+     Uint8 cacheIndices[COLOR_MAP_CACHE];
+};
+
+struct ColorKernelTable
+{
+     void (*map32)(const ColorMap &map, const SDL_Color *colors, Uint32 *pixels, int count);
+     void (*map16)(const ColorMap &map, const SDL_Color *colors, Uint16 *pixels, int count);
+     void (*get32)(const ColorMap &map, const Uint32 *pixels, SDL_Color *colors, int count);
+     void (*get16)(const ColorMap &map, const Uint16 *pixels, SDL_Color *colors, int count);
+};
+
+bool colorKernelSupported(ColorKernel kernel);
+const char *colorKernelName(ColorKernel kernel);
+
+// Force a kernel; unsupported ones fall back to scalar. Returns the kernel
+// now in use.
+ColorKernel colorSetKernel(ColorKernel kernel);
+
+// The kernels in use
+const ColorKernelTable &colorKernels();
+
+// Take `format` apart. It must outlive the map. False with SDL's error set
+// for FOURCC formats, indexed formats other than INDEX8 and channels wider
+// than 8 bits
+bool colorMapInit(ColorMap &map, const SDL_PixelFormat *format);
+
+// SDL_MapRGBA of `count` colours, into pixels of the format's size
+void colorMapArray(ColorMap &map, const SDL_Color *colors, void *pixels, int count);
+
+// SDL_GetRGBA of `count` pixels
+void colorGetArray(ColorMap &map, const void *pixels, SDL_Color *colors, int count);
+
+// Expand one row of palette indices through `table`
+void paletteExpandRow(const Uint8 *src, Uint32 *dst, int count, const Uint32 *table);
+
+// Same contract as SDL_BlitSurface. Takes the table path for an INDEX8
+// source onto a 32-bit destination with no blending, colour key or
+// modulation, and calls SDL otherwise
+int paletteBlit(SDL_Surface *src, const SDL_Rect *srcrect, SDL_Surface *dst, SDL_Rect *dstrect);
+
+#endif // COLOR_MAP_H
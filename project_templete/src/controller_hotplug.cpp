@@ -0,0 +1,469 @@
+#include "controller_hotplug.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#include "thread_affinity.h"
+
+namespace
+{
+     const char *const CACHE_FILE = "controllers.txt";
+     const Sint64 MAX_CACHE_BYTES = 256 * 1024;
+
+     enum CapabilityFlag
+     {
+          HAS_RUMBLE = 1,
+          HAS_TRIGGER_RUMBLE = 2,
+          HAS_LED = 4,
+          HAS_GYRO = 8,
+          HAS_ACCELEROMETER = 16
+     };
+
+     struct Arrival
+     {
+          SDL_JoystickID id;
+          SDL_JoystickGUID guid;
+     };
+
+     bool sameGuid(const SDL_JoystickGUID &a, const SDL_JoystickGUID &b)
+     {
+          return SDL_memcmp(a.data, b.data, sizeof(a.data)) == 0;
+     }
+
+     bool sameCapabilities(const ControllerCapabilities &a, const ControllerCapabilities &b)
+     {
+          return sameGuid(a.guid, b.guid) && a.name == b.name && a.type == b.type && a.vendor == b.vendor &&
+                 a.product == b.product && a.rumble == b.rumble && a.triggerRumble == b.triggerRumble &&
+                 a.led == b.led && a.gyro == b.gyro && a.accelerometer == b.accelerometer &&
+                 a.touchpads == b.touchpads;
+     }
+
+     // One device per line: GUID, vendor, product, type, flags, touchpads
+     // and name, tab-separated; lines that do not parse are dropped
+     bool parseCacheLine(const std::string &line, ControllerCapabilities &capabilities)
+     {
+          std::vector<std::string> fields;
+          size_t start = 0;
+          while (fields.size() < 6)
+          {
+               const size_t tab = line.find('\t', start);
+               if (tab == std::string::npos)
+               {
+                    return false;
+               }
+               fields.push_back(line.substr(start, tab - start));
+               start = tab + 1;
+          }
+          if (fields[0].size() != 32)
+          {
+               return false;
+          }
+          capabilities.guid = SDL_JoystickGetGUIDFromString(fields[0].c_str());
+          capabilities.vendor = (Uint16)SDL_strtoul(fields[1].c_str(), nullptr, 16);
+          capabilities.product = (Uint16)SDL_strtoul(fields[2].c_str(), nullptr, 16);
+          capabilities.type = (SDL_GameControllerType)SDL_atoi(fields[3].c_str());
+          const int flags = SDL_atoi(fields[4].c_str());
+          capabilities.rumble = (flags & HAS_RUMBLE) != 0;
+          capabilities.triggerRumble = (flags & HAS_TRIGGER_RUMBLE) != 0;
+          capabilities.led = (flags & HAS_LED) != 0;
+          capabilities.gyro = (flags & HAS_GYRO) != 0;
+          capabilities.accelerometer = (flags & HAS_ACCELEROMETER) != 0;
+          capabilities.touchpads = SDL_atoi(fields[5].c_str());
+          capabilities.name = line.substr(start);
+          return true;
+     }
+
+     void readCache(ControllerHotplug &hotplug)
+     {
+          SDL_RWops *rw = SDL_RWFromFile(hotplug.cachePath.c_str(), "rb");
+          if (rw == nullptr)
+          {
+               return; // First run
+          }
+          const Sint64 size = SDL_RWsize(rw);
+          std::string text;
+          if (size > 0 && size <= MAX_CACHE_BYTES)
+          {
+               text.resize((size_t)size);
+               text.resize(SDL_RWread(rw, &text[0], 1, text.size()));
+          }
+          SDL_RWclose(rw);
+
+          size_t start = 0;
+          while (start < text.size())
+          {
+               size_t end = text.find('\n', start);
+               end = end == std::string::npos ? text.size() : end;
+               std::string line = text.substr(start, end - start);
+               if (!line.empty() && line.back() == '\r')
+               {
+                    line.pop_back();
+               }
+               ControllerCapabilities capabilities;
+               if (parseCacheLine(line, capabilities))
+               {
+                    hotplug.known.push_back(capabilities);
+               }
+               start = end + 1;
+          }
+     }
+
+     bool writeCache(const ControllerHotplug &hotplug)
+     {
+          std::string text;
+          char guid[33];
+          char fields[128];
+          for (const ControllerCapabilities &capabilities : hotplug.known)
+          {
+               const int flags = (capabilities.rumble ? HAS_RUMBLE : 0) |
+                                 (capabilities.triggerRumble ? HAS_TRIGGER_RUMBLE : 0) |
+                                 (capabilities.led ? HAS_LED : 0) | (capabilities.gyro ? HAS_GYRO : 0) |
+                                 (capabilities.accelerometer ? HAS_ACCELEROMETER : 0);
+               SDL_JoystickGetGUIDString(capabilities.guid, guid, sizeof(guid));
+               SDL_snprintf(fields, sizeof(fields), "%s\t%04x\t%04x\t%d\t%d\t%d\t", guid, capabilities.vendor,
+                            capabilities.product, (int)capabilities.type, flags, capabilities.touchpads);
+               text += fields;
+               text += capabilities.name;
+               text += '\n';
+          }
+
+          SDL_RWops *rw = SDL_RWFromFile(hotplug.cachePath.c_str(), "wb");
+          if (rw == nullptr)
+          {
+               return false;
+          }
+          const bool written = text.empty() || SDL_RWwrite(rw, text.data(), 1, text.size()) == text.size();
+          SDL_RWclose(rw);
+          return written;
+     }
+
+     ControllerCapabilities capabilitiesOf(SDL_GameController *controller)
+     {
+          ControllerCapabilities capabilities;
+          const char *name = SDL_GameControllerName(controller);
+          capabilities.guid = SDL_JoystickGetGUID(SDL_GameControllerGetJoystick(controller));
+          capabilities.name = name != nullptr ? name : "";
+          // Tabs and line breaks would split the cache line
+          std::replace_if(capabilities.name.begin(), capabilities.name.end(),
+                          [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+          capabilities.type = SDL_GameControllerGetType(controller);
+          capabilities.vendor = SDL_GameControllerGetVendor(controller);
+          capabilities.product = SDL_GameControllerGetProduct(controller);
+          capabilities.rumble = SDL_GameControllerHasRumble(controller) == SDL_TRUE;
+          capabilities.triggerRumble = SDL_GameControllerHasRumbleTriggers(controller) == SDL_TRUE;
+          capabilities.led = SDL_GameControllerHasLED(controller) == SDL_TRUE;
+          capabilities.gyro = SDL_GameControllerHasSensor(controller, SDL_SENSOR_GYRO) == SDL_TRUE;
+          capabilities.accelerometer = SDL_GameControllerHasSensor(controller, SDL_SENSOR_ACCEL) == SDL_TRUE;
+          capabilities.touchpads = SDL_GameControllerGetNumTouchpads(controller);
+          return capabilities;
+     }
+
+     // Takes the notice; if it cannot be queued the receiver's reference
+     // is closed with it
+     void post(ControllerHotplug &hotplug, ControllerHotplugChange change, ControllerNotice *notice)
+     {
+          const Uint32 type = controllerHotplugEventType();
+          SDL_Event event;
+          SDL_zero(event);
+          event.type = type;
+          event.user.code = change;
+          event.user.data1 = notice;
+          event.user.data2 = &hotplug;
+          if (type == (Uint32)-1 || SDL_PushEvent(&event) <= 0)
+          {
+               if (notice->controller != nullptr)
+               {
+                    SDL_GameControllerClose(notice->controller);
+               }
+               delete notice;
+          }
+     }
+
+     // The device index of `id`, -1 once it is gone; under SDL_LockJoysticks
+     int deviceIndexOf(SDL_JoystickID id)
+     {
+          const int count = SDL_NumJoysticks();
+          for (int i = 0; i < count; i++)
+          {
+               if (SDL_JoystickGetDeviceInstanceID(i) == id)
+               {
+                    return i;
+               }
+          }
+          return -1;
+     }
+
+     void forgetDetached(std::vector<SDL_JoystickID> &ids)
+     {
+          ids.erase(std::remove_if(ids.begin(), ids.end(), [](SDL_JoystickID id) { return deviceIndexOf(id) < 0; }),
+                    ids.end());
+     }
+
+     void openArrival(ControllerHotplug &hotplug, const Arrival &arrival)
+     {
+          ControllerNotice *notice = new ControllerNotice();
+          notice->id = arrival.id;
+          notice->controller = nullptr;
+          if (controllerHotplugKnown(hotplug, arrival.guid, notice->capabilities))
+          {
+               post(hotplug, CONTROLLER_KNOWN, notice);
+               notice = new ControllerNotice();
+               notice->id = arrival.id;
+               notice->controller = nullptr;
+          }
+
+          // The slow part: HIDAPI devices are opened and queried here. The
+          // index is looked up again, as devices before it may have gone
+          // since it was detected. A second open of the same device only
+          // counts a reference, which becomes the receiver's
+          SDL_LockJoysticks();
+          const int index = deviceIndexOf(arrival.id);
+          SDL_GameController *controller = index >= 0 ? SDL_GameControllerOpen(index) : nullptr;
+          if (controller != nullptr)
+          {
+               notice->controller = SDL_GameControllerOpen(index);
+          }
+          SDL_UnlockJoysticks();
+          if (controller == nullptr)
+          {
+               if (index >= 0)
+               {
+                    std::cerr << "Unable to open game controller " << arrival.id << "! SDL Error: " << SDL_GetError()
+                              << std::endl;
+               }
+               delete notice;
+               return;
+          }
+
+          ControllerHotplugDevice device;
+          device.id = arrival.id;
+          device.controller = controller;
+          hotplug.devices.push_back(device);
+
+          notice->capabilities = capabilitiesOf(controller);
+          SDL_LockMutex(hotplug.lock);
+          auto cached = std::find_if(hotplug.known.begin(), hotplug.known.end(),
+                                     [&](const ControllerCapabilities &known) {
+                                          return sameGuid(known.guid, notice->capabilities.guid);
+                                     });
+          if (cached == hotplug.known.end())
+          {
+               hotplug.known.push_back(notice->capabilities);
+               hotplug.cacheChanged = true;
+          }
+          else if (!sameCapabilities(*cached, notice->capabilities))
+          {
+               *cached = notice->capabilities;
+               hotplug.cacheChanged = true;
+          }
+          SDL_UnlockMutex(hotplug.lock);
+          post(hotplug, CONTROLLER_READY, notice);
+     }
+
+#ifdef _WIN32
+     // Backends that make a window on the initializing thread (HIDAPI's
+     // device detection) get its messages here
+     void pumpThreadMessages()
+     {
+          MSG msg;
+          while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
+          {
+               TranslateMessage(&msg);
+               DispatchMessageW(&msg);
+          }
+     }
+#endif
+
+     int SDLCALL hotplugThreadMain(void *data)
+     {
+          ControllerHotplug &hotplug = *(ControllerHotplug *)data;
+          hotplug.initialized = SDL_InitSubSystem(SDL_INIT_GAMECONTROLLER) == 0;
+          if (!hotplug.initialized)
+          {
+               std::cerr << "Unable to initialize game controllers! SDL Error: " << SDL_GetError() << std::endl;
+          }
+
+          // Devices whose open failed; not retried until they are replugged
+          std::vector<SDL_JoystickID> failed;
+          // Joysticks whose GUID has been looked up in hotplug.mappings
+          std::vector<SDL_JoystickID> looked;
+          std::vector<Arrival> arrivals;
+          const Uint32 interval = (Uint32)SDL_max(1, 1000 / hotplug.pollHz);
+          while (hotplug.initialized && !SDL_AtomicGet(&hotplug.quitting))
+          {
+#ifdef _WIN32
+               pumpThreadMessages();
+#endif
+               // Detection runs in here now that SDL_PumpEvents leaves it alone
+               arrivals.clear();
+               SDL_LockJoysticks();
+               SDL_JoystickUpdate();
+               const int count = SDL_NumJoysticks();
+               for (int i = 0; i < count; i++)
+               {
+                    const SDL_JoystickID id = SDL_JoystickGetDeviceInstanceID(i);
+                    const bool tracked =
+                        std::any_of(hotplug.devices.begin(), hotplug.devices.end(),
+                                    [&](const ControllerHotplugDevice &device) { return device.id == id; });
+                    if (!tracked && hotplug.mappings != nullptr &&
+                        std::find(looked.begin(), looked.end(), id) == looked.end())
+                    {
+                         mappingDbApply(*hotplug.mappings, SDL_JoystickGetDeviceGUID(i));
+                         looked.push_back(id);
+                    }
+                    if (!tracked && SDL_IsGameController(i) &&
+                        std::find(failed.begin(), failed.end(), id) == failed.end())
+                    {
+                         arrivals.push_back({id, SDL_JoystickGetDeviceGUID(i)});
+                    }
+               }
+               forgetDetached(failed);
+               forgetDetached(looked);
+               SDL_UnlockJoysticks();
+
+               for (size_t i = 0; i < hotplug.devices.size();)
+               {
+                    ControllerHotplugDevice &device = hotplug.devices[i];
+                    if (SDL_GameControllerGetAttached(device.controller))
+                    {
+                         i++;
+                         continue;
+                    }
+                    ControllerNotice *notice = new ControllerNotice();
+                    notice->id = device.id;
+                    notice->controller = nullptr;
+                    SDL_GameControllerClose(device.controller);
+                    hotplug.devices.erase(hotplug.devices.begin() + i);
+                    post(hotplug, CONTROLLER_GONE, notice);
+               }
+
+               for (const Arrival &arrival : arrivals)
+               {
+                    const size_t before = hotplug.devices.size();
+                    openArrival(hotplug, arrival);
+                    if (hotplug.devices.size() == before)
+                    {
+                         failed.push_back(arrival.id);
+                    }
+               }
+
+               if (!SDL_AtomicGet(&hotplug.enumerated))
+               {
+                    ControllerNotice *notice = new ControllerNotice();
+                    notice->id = -1;
+                    notice->controller = nullptr;
+                    post(hotplug, CONTROLLER_ENUMERATED, notice);
+                    SDL_AtomicSet(&hotplug.enumerated, 1);
+               }
+               SDL_Delay(interval);
+          }
+
+          for (const ControllerHotplugDevice &device : hotplug.devices)
+          {
+               SDL_GameControllerClose(device.controller);
+          }
+          hotplug.devices.clear();
+          if (hotplug.initialized)
+          {
+               SDL_QuitSubSystem(SDL_INIT_GAMECONTROLLER);
+          }
+          return 0;
+     }
+}
+
+Uint32 controllerHotplugEventType()
+{
+     static const Uint32 type = SDL_RegisterEvents(1);
+     return type;
+}
+
+bool controllerHotplugStart(ControllerHotplug &hotplug, const char *org, const char *app, int pollHz,
+                            const MappingDb *mappings)
+{
+     hotplug.thread = nullptr;
+     SDL_AtomicSet(&hotplug.quitting, 0);
+     SDL_AtomicSet(&hotplug.enumerated, 0);
+     hotplug.pollHz = SDL_max(1, pollHz);
+     hotplug.mappings = mappings;
+     hotplug.initialized = false;
+     hotplug.lock = SDL_CreateMutex();
+     hotplug.known.clear();
+     hotplug.cacheChanged = false;
+     hotplug.devices.clear();
+
+     hotplug.cachePath.clear();
+     char *pref = SDL_GetPrefPath(org, app);
+     if (pref != nullptr)
+     {
+          hotplug.cachePath = std::string(pref) + CACHE_FILE;
+          SDL_free(pref);
+          readCache(hotplug);
+     }
+     else
+     {
+          std::cerr << "Controller cache disabled, no preference path! SDL Error: " << SDL_GetError() << std::endl;
+     }
+
+     SDL_SetHint(SDL_HINT_AUTO_UPDATE_JOYSTICKS, "0");
+     SDL_SetHint(SDL_HINT_JOYSTICK_THREAD, "1");
+     controllerHotplugEventType();
+
+     // Mostly waiting on devices; it should never hold up a frame
+     ThreadOptions options = threadDefaultOptions();
+     options.task = THREAD_TASK_BACKGROUND;
+     hotplug.thread = threadCreate(hotplugThreadMain, "ControllerHotplug", &hotplug, options);
+     if (hotplug.thread == nullptr)
+     {
+          std::cerr << "Unable to start the controller thread! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     return true;
+}
+
+bool controllerHotplugKnown(ControllerHotplug &hotplug, SDL_JoystickGUID guid, ControllerCapabilities &capabilities)
+{
+     SDL_LockMutex(hotplug.lock);
+     auto cached = std::find_if(hotplug.known.begin(), hotplug.known.end(),
+                                [&](const ControllerCapabilities &known) { return sameGuid(known.guid, guid); });
+     const bool found = cached != hotplug.known.end();
+     if (found)
+     {
+          capabilities = *cached;
+     }
+     SDL_UnlockMutex(hotplug.lock);
+     return found;
+}
+
+void controllerHotplugEventFree(SDL_Event &event)
+{
+     if (event.type == controllerHotplugEventType() && event.type != (Uint32)-1)
+     {
+          delete (ControllerNotice *)event.user.data1;
+          event.user.data1 = nullptr;
+     }
+}
+
+void controllerHotplugStop(ControllerHotplug &hotplug)
+{
+     if (hotplug.thread != nullptr)
+     {
+          SDL_AtomicSet(&hotplug.quitting, 1);
+          SDL_WaitThread(hotplug.thread, nullptr);
+          hotplug.thread = nullptr;
+     }
+     if (hotplug.lock != nullptr)
+     {
+          if (hotplug.cacheChanged && !hotplug.cachePath.empty() && !writeCache(hotplug))
+          {
+               std::cerr << "Unable to write " << hotplug.cachePath << "! SDL Error: " << SDL_GetError() << std::endl;
+          }
+          SDL_DestroyMutex(hotplug.lock);
+          hotplug.lock = nullptr;
+     }
+     hotplug.known.clear();
+}
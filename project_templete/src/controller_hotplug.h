@@ -0,0 +1,119 @@
+// Description:
+// Game controllers brought up off the main thread. SDL_InitSubSystem(
+// SDL_INIT_GAMECONTROLLER) enumerates every joystick backend before it
+// returns, and HIDAPI opens each USB HID device to ask what it is, so on a
+// machine with many devices startup waits hundreds of milliseconds for it.
+// A hotplug after that costs the same inside whichever SDL_PumpEvents runs
+// detection, and SDL_GameControllerOpen of a HIDAPI device holds the
+// joystick lock while it talks to the device.
+//
+// A ControllerHotplug gives all of that to a thread of its own. It inits
+// the subsystem there, then updates joysticks at `pollHz`, which runs
+// detection on that thread too, and opens each game controller as it
+// appears, giving SDL its mapping from a MappingDb (mapping_db.h) first
+// when there is one. Events of the type controllerHotplugEventType() say
+// how far a device has come:
+// - CONTROLLER_KNOWN as soon as it is detected, when an earlier run has
+//   seen the same GUID: its capabilities come from the cache kept under
+//   SDL_GetPrefPath, so the UI can show the right glyphs before the open
+//   finishes;
+// - CONTROLLER_READY once it is open, with its real capabilities;
+// - CONTROLLER_GONE when it is unplugged;
+// - CONTROLLER_ENUMERATED once, after the devices present at start.
+// SDL's own SDL_CONTROLLERDEVICEADDED and SDL_CONTROLLERDEVICEREMOVED
+// still arrive, at detection; code that opens controllers should wait for
+// CONTROLLER_READY instead.
+//
+// Starting sets SDL_HINT_AUTO_UPDATE_JOYSTICKS to "0", so the main
+// thread's SDL_PumpEvents no longer runs detection or waits on the lock,
+// and SDL_HINT_JOYSTICK_THREAD to "1", so on Windows the raw input and
+// device notification windows belong to a thread SDL keeps pumping. Start
+// after SDL_Init, and init or quit no other subsystem while it starts or
+// stops: SDL counts subsystem references without a lock.
+//
+// The event is an SDL_UserEvent: `code` is the ControllerHotplugChange,
+// `data1` a ControllerNotice and `data2` the ControllerHotplug. Release the
+// notice with controllerHotplugEventFree() once handled.
+// =============================================================================
+
+#ifndef CONTROLLER_HOTPLUG_H
+#define CONTROLLER_HOTPLUG_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#include "mapping_db.h"
+
+enum ControllerHotplugChange
+{
+     CONTROLLER_KNOWN,
+     CONTROLLER_READY,
+     CONTROLLER_GONE,
+     CONTROLLER_ENUMERATED
+};
+
+struct ControllerCapabilities
+{
+     SDL_JoystickGUID guid;
+     std::string name;
+     SDL_GameControllerType type;
+     Uint16 vendor;
+     Uint16 product;
+     bool rumble;
+     bool triggerRumble;
+     bool led;
+     bool gyro;
+     bool accelerometer;
+     int touchpads;
+};
+
+struct ControllerNotice
+{
+     SDL_JoystickID id;                   // -1 for CONTROLLER_ENUMERATED
+     ControllerCapabilities capabilities; // Unset for CONTROLLER_GONE and CONTROLLER_ENUMERATED
+     // CONTROLLER_READY only: a reference of the receiver's own, to keep
+     // or SDL_GameControllerClose (before controllerHotplugStop)
+     SDL_GameController *controller;
+};
+
+struct ControllerHotplugDevice
+{
+     SDL_JoystickID id;
+     SDL_GameController *controller; // The thread's reference
+};
+
+struct ControllerHotplug
+{
+     SDL_Thread *thread;
+     SDL_atomic_t quitting;
+     SDL_atomic_t enumerated; // Set once the devices present at start are reported
+     int pollHz;
+     const MappingDb *mappings; // Looked up as joysticks attach, may be nullptr
+     bool initialized;          // The thread brought the subsystem up
+
+     std::string cachePath; // Empty when there is no preference path
+     SDL_mutex *lock;
+     std::vector<ControllerCapabilities> known; // Cache, guarded by lock
+     bool cacheChanged;                         // Guarded by lock
+
+     std::vector<ControllerHotplugDevice> devices; // The thread's own
+};
+
+Uint32 controllerHotplugEventType();
+
+// Read the capability cache for `org` and `app` and start the thread.
+// Each joystick's GUID is looked up in `mappings` as it attaches; keep it
+// open until controllerHotplugStop()
+bool controllerHotplugStart(ControllerHotplug &hotplug, const char *org, const char *app, int pollHz = 250,
+                            const MappingDb *mappings = nullptr);
+
+// The cached capabilities of `guid`, false if no run has opened it
+bool controllerHotplugKnown(ControllerHotplug &hotplug, SDL_JoystickGUID guid, ControllerCapabilities &capabilities);
+
+void controllerHotplugEventFree(SDL_Event &event);
+
+// Close the thread's controllers, quit the subsystem and write the cache
+void controllerHotplugStop(ControllerHotplug &hotplug);
+
+#endif // CONTROLLER_HOTPLUG_H
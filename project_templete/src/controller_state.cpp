@@ -0,0 +1,111 @@
+#include "controller_state.h"
+
+namespace
+{
+     const int FRESH_BIT = 4; // Set in `shared` while the frame there is unread
+
+     void readSensor(SDL_GameController *controller, SDL_SensorType type, float *data, bool &has, Uint64 &timestamp)
+     {
+          has = SDL_GameControllerIsSensorEnabled(controller, type) &&
+                SDL_GameControllerGetSensorDataWithTimestamp(controller, type, &timestamp, data, 3) == 0;
+          if (!has)
+          {
+               data[0] = data[1] = data[2] = 0.0f;
+          }
+     }
+
+     void captureUnlocked(ControllerSnapshot &snapshot, SDL_GameController *controller)
+     {
+          SDL_zero(snapshot);
+          snapshot.id = -1;
+          if (controller == nullptr || !SDL_GameControllerGetAttached(controller))
+          {
+               return;
+          }
+          snapshot.id = SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controller));
+          snapshot.attached = true;
+          for (int axis = 0; axis < SDL_CONTROLLER_AXIS_MAX; axis++)
+          {
+               snapshot.axes[axis] = SDL_GameControllerGetAxis(controller, (SDL_GameControllerAxis)axis);
+          }
+          for (int button = 0; button < SDL_CONTROLLER_BUTTON_MAX; button++)
+          {
+               if (SDL_GameControllerGetButton(controller, (SDL_GameControllerButton)button))
+               {
+                    snapshot.buttons |= 1u << button;
+               }
+          }
+          if (SDL_GameControllerGetNumTouchpads(controller) > 0)
+          {
+               snapshot.fingerCount = SDL_min(SDL_GameControllerGetNumTouchpadFingers(controller, 0),
+                                              MAX_TOUCHPAD_FINGERS);
+               for (int i = 0; i < snapshot.fingerCount; i++)
+               {
+                    TouchpadFinger &finger = snapshot.fingers[i];
+                    Uint8 state = 0;
+                    SDL_GameControllerGetTouchpadFinger(controller, 0, i, &state, &finger.x, &finger.y,
+                                                        &finger.pressure);
+                    finger.down = state != 0;
+               }
+          }
+          Uint64 gyroTimestamp = 0, accelTimestamp = 0;
+          readSensor(controller, SDL_SENSOR_GYRO, snapshot.gyro, snapshot.hasGyro, gyroTimestamp);
+          readSensor(controller, SDL_SENSOR_ACCEL, snapshot.accel, snapshot.hasAccel, accelTimestamp);
+          snapshot.sensorTimestampUs = SDL_max(gyroTimestamp, accelTimestamp);
+     }
+}
+
+void controllerCapture(ControllerSnapshot &snapshot, SDL_GameController *controller)
+{
+     SDL_LockJoysticks();
+     captureUnlocked(snapshot, controller);
+     SDL_UnlockJoysticks();
+}
+
+void controllerCaptureAll(ControllerFrame &frame, SDL_GameController *const *controllers, int count)
+{
+     frame.count = SDL_min(count, MAX_CONTROLLERS);
+     SDL_LockJoysticks();
+     for (int i = 0; i < frame.count; i++)
+     {
+          captureUnlocked(frame.pads[i], controllers[i]);
+     }
+     SDL_UnlockJoysticks();
+     frame.captureCounter = SDL_GetPerformanceCounter();
+}
+
+void controllerStateInit(ControllerStateBuffer &buffer)
+{
+     SDL_zero(buffer.frames);
+     for (ControllerFrame &frame : buffer.frames)
+     {
+          for (ControllerSnapshot &pad : frame.pads)
+          {
+               pad.id = -1;
+          }
+     }
+     buffer.writeIndex = 0;
+     SDL_AtomicSet(&buffer.shared, 1);
+     buffer.readIndex = 2;
+     buffer.sequence = 0;
+}
+
+void controllerStatePublish(ControllerStateBuffer &buffer, SDL_GameController *const *controllers, int count)
+{
+     ControllerFrame &frame = buffer.frames[buffer.writeIndex];
+     controllerCaptureAll(frame, controllers, count);
+     frame.sequence = ++buffer.sequence;
+     // Our frame becomes the shared one; whatever was shared (read or not) is ours to overwrite
+     const int previous = SDL_AtomicSet(&buffer.shared, buffer.writeIndex | FRESH_BIT);
+     buffer.writeIndex = previous & (FRESH_BIT - 1);
+}
+
+const ControllerFrame &controllerStateLatest(ControllerStateBuffer &buffer)
+{
+     if (SDL_AtomicGet(&buffer.shared) & FRESH_BIT)
+     {
+          const int previous = SDL_AtomicSet(&buffer.shared, buffer.readIndex);
+          buffer.readIndex = previous & (FRESH_BIT - 1);
+     }
+     return buffer.frames[buffer.readIndex];
+}
@@ -0,0 +1,82 @@
+// Description:
+// Whole-controller snapshots. Reading one controller through the public
+// API is about thirty calls (SDL_GameControllerGetAxis, GetButton,
+// GetTouchpadFinger, GetSensorData), each taking and releasing the
+// joystick lock, and nothing stops the state changing between them, so a
+// stick's X and Y can come from different updates. controllerCapture()
+// takes the lock once and copies everything into a ControllerSnapshot, so
+// the snapshot is one consistent update and the inner calls find the
+// (recursive) lock already held.
+//
+// A ControllerStateBuffer hands snapshots of up to MAX_CONTROLLERS pads
+// from an input thread to the game thread without either ever waiting on
+// the other. It is a triple buffer: the writer fills its own frame and
+// publishes it by swapping indices with one atomic exchange; the reader
+// swaps the newest published frame with its own the same way. Neither
+// side touches the other's frame, so an input thread polling at 1 kHz and
+// a game thread reading at 60 Hz never block, and the reader always gets
+// the latest complete frame. One writer and one reader per buffer.
+// =============================================================================
+
+#ifndef CONTROLLER_STATE_H
+#define CONTROLLER_STATE_H
+
+#include <SDL2/SDL.h>
+
+const int MAX_CONTROLLERS = 8;
+const int MAX_TOUCHPAD_FINGERS = 4; // Of the first touchpad, which is all pads have today
+
+struct TouchpadFinger
+{
+     bool down;
+     float x, y; // 0..1 across the touchpad
+     float pressure;
+};
+
+struct ControllerSnapshot
+{
+     SDL_JoystickID id; // -1 when the slot is empty
+     bool attached;
+     Sint16 axes[SDL_CONTROLLER_AXIS_MAX];
+     Uint32 buttons; // Bit SDL_GameControllerButton set while held
+     int fingerCount;
+     TouchpadFinger fingers[MAX_TOUCHPAD_FINGERS];
+     bool hasGyro, hasAccel; // Sensor enabled with SDL_GameControllerSetSensorEnabled
+     float gyro[3];          // Radians per second
+     float accel[3];         // Metres per second squared
+     Uint64 sensorTimestampUs;
+};
+
+struct ControllerFrame
+{
+     ControllerSnapshot pads[MAX_CONTROLLERS];
+     int count;
+     Uint64 captureCounter; // SDL_GetPerformanceCounter() at capture
+     Uint32 sequence;       // Increments with every published frame
+};
+
+struct ControllerStateBuffer
+{
+     ControllerFrame frames[3];
+     SDL_atomic_t shared; // Index of the frame between writer and reader, plus a fresh bit
+     int writeIndex;      // Owned by the writer
+     int readIndex;       // Owned by the reader
+     Uint32 sequence;
+};
+
+// Copy the whole state of `controller` under one joystick lock
+void controllerCapture(ControllerSnapshot &snapshot, SDL_GameController *controller);
+
+// `count` controllers at once, under the same lock, so they agree in time
+void controllerCaptureAll(ControllerFrame &frame, SDL_GameController *const *controllers, int count);
+
+void controllerStateInit(ControllerStateBuffer &buffer);
+
+// Writer: capture `controllers` and publish them as the newest frame
+void controllerStatePublish(ControllerStateBuffer &buffer, SDL_GameController *const *controllers, int count);
+
+// Reader: the newest published frame, or the previous one again when
+// nothing new was published. Valid until the next call
+const ControllerFrame &controllerStateLatest(ControllerStateBuffer &buffer);
+
+#endif // CONTROLLER_STATE_H
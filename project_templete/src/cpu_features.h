@@ -0,0 +1,26 @@
+// Description:
+// The SSE2 check the SIMD modules dispatch on. Everywhere but the web
+// build this is SDL_HasSSE2(). Emscripten compiles SSE2 intrinsics to WASM
+// SIMD under -msimd128 -msse2 (see `make web`), so __SSE2__ being defined
+// there means the vector kernels run. SDL has no cpuid to ask in a browser,
+// though, and would report false.
+//
+// Header-only, like atomic_ops.h: callers check it once when they pick a
+// kernel.
+// =============================================================================
+
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#include <SDL2/SDL.h>
+
+inline bool cpuHasSse2()
+{
+#if defined(__EMSCRIPTEN__)
+     return true;
+#else
+     return SDL_HasSSE2() == SDL_TRUE;
+#endif
+}
+
+#endif // CPU_FEATURES_H
@@ -0,0 +1,384 @@
+#include "cpu_topology.h"
+
+#include <cstdio>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace
+{
+     Uint64 allCpus(int count)
+     {
+          return count >= 64 ? ~(Uint64)0 : ((Uint64)1 << count) - 1;
+     }
+
+     int countBits(Uint64 mask)
+     {
+          int count = 0;
+          for (; mask != 0; mask &= mask - 1)
+          {
+               count++;
+          }
+          return count;
+     }
+
+     // What every platform can say
+     void setDefaults(CpuTopology &topology, int logicalCount)
+     {
+          topology.logicalCount = SDL_clamp(logicalCount, 1, 64);
+          topology.physicalCount = topology.logicalCount;
+          topology.hybrid = false;
+          topology.performanceCores = topology.logicalCount;
+          topology.efficiencyCores = 0;
+          topology.performanceMask = allCpus(topology.logicalCount);
+          topology.efficiencyMask = 0;
+          topology.cacheLineBytes = SDL_GetCPUCacheLineSize();
+          topology.l1DataBytes = 0;
+          topology.l2Bytes = 0;
+          topology.l3Bytes = 0;
+          topology.nodeCount = 1;
+          topology.nodeMasks[0] = topology.performanceMask;
+          for (int node = 1; node < CPU_TOPOLOGY_MAX_NODES; node++)
+          {
+               topology.nodeMasks[node] = 0;
+          }
+     }
+
+#if defined(_WIN32)
+     struct CacheEntry
+     {
+          int level;
+          int bytes;
+          Uint64 mask;
+     };
+
+     // One RelationAll walk: cores with their efficiency class, caches
+     // and NUMA nodes. A higher efficiency class is a faster core
+     CpuTopology queryTopology()
+     {
+          SYSTEM_INFO system;
+          GetSystemInfo(&system);
+          CpuTopology topology;
+          setDefaults(topology, (int)system.dwNumberOfProcessors);
+
+          DWORD length = 0;
+          GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+          std::vector<Uint8> buffer(length);
+          if (length == 0 ||
+              !GetLogicalProcessorInformationEx(RelationAll, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)buffer.data(), &length))
+          {
+               return topology;
+          }
+
+          Uint64 classMasks[256] = {};
+          int classCores[256] = {};
+          int lowest = 255, highest = 0, physical = 0, nodes = 0;
+          Uint64 nodeMasks[CPU_TOPOLOGY_MAX_NODES] = {};
+          std::vector<CacheEntry> caches;
+          for (DWORD offset = 0; offset < length;)
+          {
+               const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *entry =
+                    (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)(buffer.data() + offset);
+               offset += entry->Size;
+               if (entry->Relationship == RelationProcessorCore)
+               {
+                    if (entry->Processor.GroupCount == 0 || entry->Processor.GroupMask[0].Group != 0)
+                    {
+                         continue;
+                    }
+                    // EfficiencyClass follows Flags; older headers call it Reserved[0]
+                    const int efficiencyClass = ((const BYTE *)&entry->Processor)[1];
+                    classMasks[efficiencyClass] |= (Uint64)entry->Processor.GroupMask[0].Mask;
+                    classCores[efficiencyClass]++;
+                    lowest = SDL_min(lowest, efficiencyClass);
+                    highest = SDL_max(highest, efficiencyClass);
+                    physical++;
+               }
+               else if (entry->Relationship == RelationCache)
+               {
+                    if (entry->Cache.GroupMask.Group == 0 &&
+                        (entry->Cache.Type == CacheData || entry->Cache.Type == CacheUnified))
+                    {
+                         caches.push_back({entry->Cache.Level, (int)entry->Cache.CacheSize,
+                                           (Uint64)entry->Cache.GroupMask.Mask});
+                         topology.cacheLineBytes = entry->Cache.LineSize;
+                    }
+               }
+               else if (entry->Relationship == RelationNumaNode)
+               {
+                    if (entry->NumaNode.GroupMask.Group == 0 && entry->NumaNode.NodeNumber < (DWORD)CPU_TOPOLOGY_MAX_NODES)
+                    {
+                         nodeMasks[entry->NumaNode.NodeNumber] = (Uint64)entry->NumaNode.GroupMask.Mask;
+                         nodes = SDL_max(nodes, (int)entry->NumaNode.NodeNumber + 1);
+                    }
+               }
+          }
+
+          if (physical > 0)
+          {
+               topology.physicalCount = physical;
+               topology.performanceCores = physical;
+          }
+          if (highest > lowest)
+          {
+               topology.hybrid = true;
+               topology.performanceMask = classMasks[highest];
+               topology.efficiencyMask = allCpus(topology.logicalCount) & ~classMasks[highest];
+               topology.performanceCores = classCores[highest];
+               topology.efficiencyCores = physical - classCores[highest];
+          }
+          // E-core clusters share a larger L2, so only count what P-cores see
+          for (const CacheEntry &cache : caches)
+          {
+               if ((cache.mask & topology.performanceMask) == 0)
+               {
+                    continue;
+               }
+               int &bytes = cache.level == 1 ? topology.l1DataBytes
+                            : cache.level == 2 ? topology.l2Bytes
+                                               : topology.l3Bytes;
+               bytes = SDL_max(bytes, cache.bytes);
+          }
+          if (nodes > 0)
+          {
+               topology.nodeCount = nodes;
+               for (int node = 0; node < nodes; node++)
+               {
+                    topology.nodeMasks[node] = nodeMasks[node];
+               }
+          }
+          return topology;
+     }
+#elif defined(__linux__)
+     // A sysfs CPU list such as "0-7,16"; 0 when the file is missing
+     Uint64 readCpuList(const char *path)
+     {
+          std::FILE *file = std::fopen(path, "r");
+          if (file == nullptr)
+          {
+               return 0;
+          }
+          Uint64 mask = 0;
+          int first, last;
+          char separator;
+          while (std::fscanf(file, "%d", &first) == 1)
+          {
+               last = first;
+               if (std::fscanf(file, "%c", &separator) == 1 && separator == '-')
+               {
+                    if (std::fscanf(file, "%d", &last) != 1)
+                    {
+                         break;
+                    }
+                    std::fscanf(file, "%c", &separator);
+               }
+               for (int cpu = SDL_max(first, 0); cpu <= SDL_min(last, 63); cpu++)
+               {
+                    mask |= (Uint64)1 << cpu;
+               }
+          }
+          std::fclose(file);
+          return mask;
+     }
+
+     // The file's first word; `fallback` when it is missing
+     int readInt(const char *path, int fallback)
+     {
+          std::FILE *file = std::fopen(path, "r");
+          int value = fallback;
+          if (file != nullptr)
+          {
+               if (std::fscanf(file, "%d", &value) != 1)
+               {
+                    value = fallback;
+               }
+               std::fclose(file);
+          }
+          return value;
+     }
+
+     // Cache sizes read back as "48K" or "30M"
+     int readSize(const char *path)
+     {
+          std::FILE *file = std::fopen(path, "r");
+          int value = 0;
+          char unit = 0;
+          if (file != nullptr)
+          {
+               if (std::fscanf(file, "%d%c", &value, &unit) < 1)
+               {
+                    value = 0;
+               }
+               std::fclose(file);
+          }
+          return unit == 'K' ? value * 1024 : unit == 'M' ? value * 1024 * 1024 : value;
+     }
+
+     void readCaches(CpuTopology &topology, int cpu)
+     {
+          char path[128];
+          for (int index = 0; index < 8; index++)
+          {
+               SDL_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index);
+               const int level = readInt(path, 0);
+               if (level == 0)
+               {
+                    break;
+               }
+               SDL_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpu, index);
+               std::FILE *file = std::fopen(path, "r");
+               char type[32] = "";
+               if (file != nullptr)
+               {
+                    if (std::fscanf(file, "%31s", type) != 1)
+                    {
+                         type[0] = 0;
+                    }
+                    std::fclose(file);
+               }
+               if (SDL_strcmp(type, "Instruction") == 0)
+               {
+                    continue;
+               }
+               SDL_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/size", cpu, index);
+               const int bytes = readSize(path);
+               SDL_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/coherency_line_size",
+                            cpu, index);
+               topology.cacheLineBytes = readInt(path, topology.cacheLineBytes);
+               int &slot = level == 1 ? topology.l1DataBytes : level == 2 ? topology.l2Bytes : topology.l3Bytes;
+               slot = SDL_max(slot, bytes);
+          }
+     }
+
+     CpuTopology queryTopology()
+     {
+          CpuTopology topology;
+          setDefaults(topology, (int)sysconf(_SC_NPROCESSORS_ONLN));
+          char path[128];
+
+          // A core is counted at the lowest-numbered of its SMT siblings
+          Uint64 coreLeaders = 0;
+          for (int cpu = 0; cpu < topology.logicalCount; cpu++)
+          {
+               SDL_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+               const Uint64 siblings = readCpuList(path);
+               if (siblings == 0 || (siblings & ((Uint64)1 << cpu)) == 0 || (siblings & (((Uint64)1 << cpu) - 1)) == 0)
+               {
+                    coreLeaders |= (Uint64)1 << cpu;
+               }
+          }
+          topology.physicalCount = countBits(coreLeaders);
+          topology.performanceCores = topology.physicalCount;
+
+          // Intel hybrid parts expose one PMU per core type; on ARM
+          // cpu_capacity is 1024 for the fastest cores
+          Uint64 big = readCpuList("/sys/devices/cpu_core/cpus");
+          Uint64 little = readCpuList("/sys/devices/cpu_atom/cpus");
+          if (big == 0 || little == 0)
+          {
+               big = little = 0;
+               int capacities[64];
+               int highest = 0, lowest = SDL_MAX_SINT32;
+               for (int cpu = 0; cpu < topology.logicalCount; cpu++)
+               {
+                    SDL_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpu_capacity", cpu);
+                    capacities[cpu] = readInt(path, 0);
+                    highest = SDL_max(highest, capacities[cpu]);
+                    lowest = SDL_min(lowest, capacities[cpu]);
+               }
+               if (lowest > 0 && highest > lowest)
+               {
+                    for (int cpu = 0; cpu < topology.logicalCount; cpu++)
+                    {
+                         (capacities[cpu] == highest ? big : little) |= (Uint64)1 << cpu;
+                    }
+               }
+          }
+          if (big != 0 && little != 0)
+          {
+               topology.hybrid = true;
+               topology.performanceMask = big;
+               topology.efficiencyMask = little;
+               topology.performanceCores = countBits(coreLeaders & big);
+               topology.efficiencyCores = countBits(coreLeaders & little);
+          }
+
+          int firstFast = 0;
+          while (firstFast < 63 && (topology.performanceMask & ((Uint64)1 << firstFast)) == 0)
+          {
+               firstFast++;
+          }
+          readCaches(topology, firstFast);
+
+          int nodes = 0;
+          for (int node = 0; node < CPU_TOPOLOGY_MAX_NODES; node++)
+          {
+               SDL_snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+               const Uint64 mask = readCpuList(path);
+               topology.nodeMasks[node] = mask;
+               nodes = mask != 0 ? node + 1 : nodes;
+          }
+          if (nodes == 0)
+          {
+               topology.nodeMasks[0] = allCpus(topology.logicalCount);
+          }
+          topology.nodeCount = SDL_max(nodes, 1);
+          return topology;
+     }
+#else
+     CpuTopology queryTopology()
+     {
+          CpuTopology topology;
+          setDefaults(topology, SDL_GetCPUCount());
+          return topology;
+     }
+#endif
+}
+
+const CpuTopology &cpuTopology()
+{
+     static const CpuTopology topology = queryTopology();
+     return topology;
+}
+
+int cpuTopologyNodeOf(const CpuTopology &topology, int cpu)
+{
+     for (int node = 0; node < topology.nodeCount && cpu >= 0 && cpu < 64; node++)
+     {
+          if (topology.nodeMasks[node] & ((Uint64)1 << cpu))
+          {
+               return node;
+          }
+     }
+     return 0;
+}
+
+int cpuTopologyWorkerCount(const CpuTopology &topology)
+{
+     return SDL_max(1, topology.physicalCount - 1);
+}
+
+void cpuTopologyLog(const CpuTopology &topology)
+{
+     SDL_Log("CPU: %d logical, %d physical cores", topology.logicalCount, topology.physicalCount);
+     if (topology.hybrid)
+     {
+          SDL_Log("CPU: hybrid, %d performance cores (mask %llx), %d efficiency cores (mask %llx)",
+                  topology.performanceCores, (unsigned long long)topology.performanceMask, topology.efficiencyCores,
+                  (unsigned long long)topology.efficiencyMask);
+     }
+     SDL_Log("CPU caches: L1d %d KB, L2 %d KB, L3 %d KB, %d-byte lines", topology.l1DataBytes / 1024,
+             topology.l2Bytes / 1024, topology.l3Bytes / 1024, topology.cacheLineBytes);
+     if (topology.nodeCount > 1)
+     {
+          for (int node = 0; node < topology.nodeCount; node++)
+          {
+               SDL_Log("CPU: NUMA node %d has mask %llx", node, (unsigned long long)topology.nodeMasks[node]);
+          }
+     }
+}
@@ -0,0 +1,60 @@
+// Description:
+// What SDL_cpuinfo.h leaves out when sizing work to the machine.
+// SDL_GetCPUCount counts logical CPUs, so an 8-core SMT part reads as 16
+// and a hybrid one gives no hint that half its cores are slower; here the
+// same query also returns:
+//
+// - physical cores, apart from their SMT siblings, which is what a pool of
+//   cache-hungry workers should be sized to;
+// - performance and efficiency cores on hybrid CPUs (Intel P-cores and
+//   E-cores, ARM big.LITTLE), as counts and logical CPU masks;
+// - L1 data, L2 and L3 sizes as a performance core sees them, for tile,
+//   band and chunk sizes that stay in cache;
+// - NUMA nodes and the CPUs in each, for the rare workstation with more
+//   than one.
+//
+// The data comes from GetLogicalProcessorInformationEx on Windows and
+// from sysfs on Linux; elsewhere only the SDL counts are filled in and
+// the rest is 0. It is read once, on first use. Masks cover the first 64
+// logical CPUs (Windows processor group 0).
+// =============================================================================
+
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <SDL2/SDL.h>
+
+const int CPU_TOPOLOGY_MAX_NODES = 8;
+
+struct CpuTopology
+{
+     int logicalCount;     // Hardware threads
+     int physicalCount;    // Cores, below logicalCount with SMT
+     bool hybrid;          // Both core types present
+     int performanceCores; // Physical; every core unless hybrid
+     int efficiencyCores;
+     Uint64 performanceMask; // Bit n set for logical CPU n
+     Uint64 efficiencyMask;  // 0 unless hybrid
+
+     int cacheLineBytes;
+     int l1DataBytes; // Per core
+     int l2Bytes;     // Per core, or per cluster where cores share it
+     int l3Bytes;     // Last level, shared; 0 if there is none
+
+     int nodeCount; // NUMA nodes, at least 1
+     Uint64 nodeMasks[CPU_TOPOLOGY_MAX_NODES];
+};
+
+const CpuTopology &cpuTopology();
+
+// The NUMA node logical CPU `cpu` belongs to, 0 when unknown
+int cpuTopologyNodeOf(const CpuTopology &topology, int cpu);
+
+// Worker threads for CPU-bound jobs next to the calling thread: one per
+// physical core, less the caller's
+int cpuTopologyWorkerCount(const CpuTopology &topology);
+
+// One line per fact, through SDL_Log
+void cpuTopologyLog(const CpuTopology &topology);
+
+#endif // CPU_TOPOLOGY_H
@@ -0,0 +1,131 @@
+#include "cursor_cache.h"
+
+#include "checksum.h"
+
+namespace
+{
+     // Row by row, so pitch padding doesn't split equal images. False with
+     // SDL's error set when the surface (RLE, say) can't be locked
+     bool cursorImagePixels(SDL_Surface *image, std::vector<Uint8> &pixels)
+     {
+          if (SDL_MUSTLOCK(image) && SDL_LockSurface(image) != 0)
+          {
+               return false;
+          }
+          const size_t rowBytes = (size_t)image->w * image->format->BytesPerPixel;
+          pixels.resize(rowBytes * image->h);
+          for (int y = 0; y < image->h; y++)
+          {
+               SDL_memcpy(pixels.data() + rowBytes * y, (const Uint8 *)image->pixels + (size_t)y * image->pitch, rowBytes);
+          }
+          if (SDL_MUSTLOCK(image))
+          {
+               SDL_UnlockSurface(image);
+          }
+          return true;
+     }
+
+     CursorCacheEntry *cursorFind(CursorCache &cache, const CursorCacheEntry &key)
+     {
+          for (CursorCacheEntry &entry : cache.entries)
+          {
+               if (entry.system == key.system && entry.hash == key.hash && entry.w == key.w && entry.h == key.h &&
+                   entry.format == key.format && entry.hotX == key.hotX && entry.hotY == key.hotY &&
+                   entry.pixels == key.pixels)
+               {
+                    return &entry;
+               }
+          }
+          return nullptr;
+     }
+}
+
+void cursorCacheInit(CursorCache &cache)
+{
+     cache.entries.clear();
+     cache.shown = nullptr;
+     cache.visible = SDL_ShowCursor(SDL_QUERY) == SDL_ENABLE;
+     cache.created = 0;
+     cache.reused = 0;
+}
+
+SDL_Cursor *cursorCacheImage(CursorCache &cache, SDL_Surface *image, int hotX, int hotY)
+{
+     if (image == nullptr)
+     {
+          SDL_SetError("Cursor image is NULL");
+          return nullptr;
+     }
+     CursorCacheEntry key = {-1, 0, image->w, image->h, image->format->format, hotX, hotY, nullptr, {}};
+     if (!cursorImagePixels(image, key.pixels))
+     {
+          return nullptr;
+     }
+     key.hash = crc32cUpdate(0, key.pixels.data(), key.pixels.size());
+     if (CursorCacheEntry *entry = cursorFind(cache, key))
+     {
+          cache.reused++;
+          return entry->cursor;
+     }
+     key.cursor = SDL_CreateColorCursor(image, hotX, hotY);
+     if (key.cursor == nullptr)
+     {
+          return nullptr;
+     }
+     cache.entries.push_back(std::move(key));
+     cache.created++;
+     return cache.entries.back().cursor;
+}
+
+SDL_Cursor *cursorCacheSystem(CursorCache &cache, SDL_SystemCursor id)
+{
+     CursorCacheEntry key = {(int)id, 0, 0, 0, 0, 0, 0, nullptr, {}};
+     if (CursorCacheEntry *entry = cursorFind(cache, key))
+     {
+          cache.reused++;
+          return entry->cursor;
+     }
+     key.cursor = SDL_CreateSystemCursor(id);
+     if (key.cursor == nullptr)
+     {
+          return nullptr;
+     }
+     cache.entries.push_back(key);
+     cache.created++;
+     return key.cursor;
+}
+
+void cursorCacheShow(CursorCache &cache, SDL_Cursor *cursor, bool visible)
+{
+     if (visible != cache.visible)
+     {
+          SDL_ShowCursor(visible ? SDL_ENABLE : SDL_DISABLE);
+          cache.visible = visible;
+     }
+     if (!visible || cursor == cache.shown)
+     {
+          return;
+     }
+     SDL_Cursor *target = cursor != nullptr ? cursor : SDL_GetDefaultCursor();
+     if (target != nullptr)
+     {
+          SDL_SetCursor(target);
+     }
+     cache.shown = cursor;
+}
+
+void cursorCacheDestroy(CursorCache &cache)
+{
+     // SDL falls back to its default when the current cursor is freed
+     for (CursorCacheEntry &entry : cache.entries)
+     {
+          SDL_FreeCursor(entry.cursor);
+     }
+     cache.entries.clear();
+     cache.shown = nullptr;
+     if (!cache.visible)
+     {
+          SDL_ShowCursor(SDL_ENABLE);
+          cache.visible = true;
+     }
+}
@@ -0,0 +1,79 @@
+// Description:
+// Mouse cursors created once and switched for free. SDL_CreateColorCursor()
+// converts the image and builds an OS cursor object (an HCURSOR, an
+// NSCursor, an X or Wayland cursor buffer) every time it is called; a
+// hover effect that creates its cursor on entry and frees it on exit
+// pays that cost, and leaks it if it forgets, for every pass of the
+// mouse. The cache keys each cursor by its image's pixels, size and
+// format and by its hotspot, so the same picture is turned into a cursor
+// once per session whatever surface it arrives in. Lookups go by a CRC of
+// the pixels and compare the pixels themselves on a match, so two images
+// that collide still get cursors of their own. System cursors are cached
+// by id.
+//
+// cursorCacheShow() only calls SDL_SetCursor() or SDL_ShowCursor() when
+// the wanted cursor differs from the one on screen. SDL 2.26 and later
+// (2.28.5 here) return early from SDL_SetCursor() for the current cursor
+// already; what the check still saves is SDL_ShowCursor() and the
+// SDL_GetDefaultCursor() lookup every frame, and the re-send older SDLs
+// make to the OS.
+//
+// Cursors from here are always the OS's: SDL composites them on a
+// hardware overlay plane at the pointer's latest position, independently
+// of the game's frames. Drawing a cursor sprite in the frame instead puts
+// it one frame or more behind the mouse and means redrawing whatever it
+// passed over, which on the static screens is the whole dirty-region
+// path woken for nothing. The hotspot keeps the OS cursor pointing where
+// its picture does.
+//
+//     CursorCache cursors;
+//     cursorCacheInit(cursors);
+//     SDL_Cursor *hand = cursorCacheSystem(cursors, SDL_SYSTEM_CURSOR_HAND);
+//     ...each frame
+//     cursorCacheShow(cursors, overButton ? hand : nullptr);
+// =============================================================================
+
+#ifndef CURSOR_CACHE_H
+#define CURSOR_CACHE_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct CursorCacheEntry
+{
+     int system; // SDL_SystemCursor, -1 for an image cursor
+     Uint32 hash; // CRC-32C of the image's pixels
+     int w, h;
+     Uint32 format;
+     int hotX, hotY;
+     SDL_Cursor *cursor;
+     std::vector<Uint8> pixels; // The image's rows without padding, compared on a hash match
+};
+
+struct CursorCache
+{
+     std::vector<CursorCacheEntry> entries;
+     SDL_Cursor *shown; // What cursorCacheShow() last set, nullptr for the default
+     bool visible;
+     int created; // OS cursors made, for the stats
+     int reused;  // Lookups answered from the cache
+};
+
+void cursorCacheInit(CursorCache &cache);
+
+// A colour cursor for `image`, made on the first request for these pixels
+// and hotspot. nullptr with SDL's error set if SDL can't make it, or
+// can't lock `image` to read it
+SDL_Cursor *cursorCacheImage(CursorCache &cache, SDL_Surface *image, int hotX, int hotY);
+
+// SDL's system cursor `id`, made once
+SDL_Cursor *cursorCacheSystem(CursorCache &cache, SDL_SystemCursor id);
+
+// Show `cursor`, SDL's default with nullptr, or hide the pointer with
+// `visible` false. Does nothing when that is already what is on screen
+void cursorCacheShow(CursorCache &cache, SDL_Cursor *cursor, bool visible = true);
+
+// Free every cursor and go back to SDL's default
+void cursorCacheDestroy(CursorCache &cache);
+
+#endif // CURSOR_CACHE_H
@@ -0,0 +1,633 @@
+#include "dds_image.h"
+
+#include <SDL2/SDL_image.h>
+#include <cstring>
+#include <vector>
+
+#include "aligned_surface.h"
+#include "mapped_file.h"
+#include "render_record.h"
+
+namespace
+{
+     const Uint32 DDPF_ALPHAPIXELS = 0x1;
+     const Uint32 DDPF_FOURCC = 0x4;
+     const Uint32 DDPF_RGB = 0x40;
+
+     // DXGI_FORMAT values used in DX10 extended headers
+     const Uint32 DXGI_BC1_UNORM = 71;
+     const Uint32 DXGI_BC2_UNORM = 74;
+     const Uint32 DXGI_BC3_UNORM = 77;
+     const Uint32 DXGI_B5G6R5_UNORM = 85;
+     const Uint32 DXGI_B8G8R8A8_UNORM = 87;
+
+     enum DdsEncoding
+     {
+          DDS_UNSUPPORTED,
+          DDS_BC1,
+          DDS_BC2,
+          DDS_BC3,
+          DDS_UNCOMPRESSED
+     };
+
+     struct DdsInfo
+     {
+          int width, height;
+          DdsEncoding encoding;
+          Uint32 pixelFormat; // SDL format of uncompressed data
+          int pitch;          // Of uncompressed data in the file
+     };
+
+     Uint32 fourCC(const char *code)
+     {
+          return SDL_FOURCC(code[0], code[1], code[2], code[3]);
+     }
+
+     // Read the header and leave the stream at the top mip level
+     bool readHeader(SDL_RWops *rw, DdsInfo &info)
+     {
+          Uint8 header[128];
+          if (SDL_RWread(rw, header, 1, sizeof(header)) != sizeof(header) || std::memcmp(header, "DDS ", 4) != 0)
+          {
+               SDL_SetError("Not a DDS file");
+               return false;
+          }
+          auto field = [&](int offset) {
+               Uint32 value;
+               std::memcpy(&value, header + offset, 4);
+               return SDL_SwapLE32(value);
+          };
+          info.height = (int)field(12);
+          info.width = (int)field(16);
+          Uint32 pfFlags = field(80);
+          Uint32 code = field(84);
+          Uint32 bits = field(88);
+          Uint32 rMask = field(92), gMask = field(96), bMask = field(100), aMask = field(104);
+          info.encoding = DDS_UNSUPPORTED;
+          info.pixelFormat = SDL_PIXELFORMAT_UNKNOWN;
+
+          if (pfFlags & DDPF_FOURCC)
+          {
+               Uint32 dxgi = 0;
+               if (code == fourCC("DX10"))
+               {
+                    Sint32 extension[5];
+                    if (SDL_RWread(rw, extension, 4, 5) != 5)
+                    {
+                         SDL_SetError("Truncated DX10 header");
+                         return false;
+                    }
+                    dxgi = SDL_SwapLE32((Uint32)extension[0]);
+               }
+               if (code == fourCC("DXT1") || dxgi == DXGI_BC1_UNORM)
+               {
+                    info.encoding = DDS_BC1;
+               }
+               else if (code == fourCC("DXT3") || dxgi == DXGI_BC2_UNORM)
+               {
+                    info.encoding = DDS_BC2;
+               }
+               else if (code == fourCC("DXT5") || dxgi == DXGI_BC3_UNORM)
+               {
+                    info.encoding = DDS_BC3;
+               }
+               else if (dxgi == DXGI_B8G8R8A8_UNORM)
+               {
+                    info.encoding = DDS_UNCOMPRESSED;
+                    info.pixelFormat = SDL_PIXELFORMAT_ARGB8888;
+               }
+               else if (dxgi == DXGI_B5G6R5_UNORM)
+               {
+                    info.encoding = DDS_UNCOMPRESSED;
+                    info.pixelFormat = SDL_PIXELFORMAT_RGB565;
+               }
+          }
+          else if (pfFlags & DDPF_RGB)
+          {
+               info.encoding = DDS_UNCOMPRESSED;
+               info.pixelFormat = SDL_MasksToPixelFormatEnum((int)bits, rMask, gMask, bMask,
+                                                             (pfFlags & DDPF_ALPHAPIXELS) ? aMask : 0);
+          }
+
+          if (info.encoding == DDS_UNSUPPORTED ||
+              (info.encoding == DDS_UNCOMPRESSED && info.pixelFormat == SDL_PIXELFORMAT_UNKNOWN))
+          {
+               SDL_SetError("Unsupported DDS pixel format");
+               return false;
+          }
+          if (info.width <= 0 || info.height <= 0 || info.width > 16384 || info.height > 16384)
+          {
+               SDL_SetError("Invalid DDS size %dx%d", info.width, info.height);
+               return false;
+          }
+          info.pitch = info.width * SDL_BYTESPERPIXEL(info.pixelFormat);
+          return true;
+     }
+
+     Uint32 expand565(Uint16 c)
+     {
+          Uint32 r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+          r = (r << 3) | (r >> 2);
+          g = (g << 2) | (g >> 4);
+          b = (b << 3) | (b >> 2);
+          return 0xFF000000 | (r << 16) | (g << 8) | b;
+     }
+
+     Uint32 mix(Uint32 a, Uint32 b, int wa, int wb, int div)
+     {
+          Uint32 out = 0xFF000000;
+          for (int shift = 0; shift < 24; shift += 8)
+          {
+               Uint32 ca = (a >> shift) & 0xFF, cb = (b >> shift) & 0xFF;
+               out |= ((ca * wa + cb * wb) / div) << shift;
+          }
+          return out;
+     }
+
+     // Color half of every BCn block; fourColor forces the opaque 4-color
+     // mode that BC2/BC3 always use
+     void decodeColor(const Uint8 *block, Uint32 *out, int stride, bool fourColor)
+     {
+          Uint16 c0 = (Uint16)(block[0] | (block[1] << 8));
+          Uint16 c1 = (Uint16)(block[2] | (block[3] << 8));
+          Uint32 palette[4];
+          palette[0] = expand565(c0);
+          palette[1] = expand565(c1);
+          if (c0 > c1 || fourColor)
+          {
+               palette[2] = mix(palette[0], palette[1], 2, 1, 3);
+               palette[3] = mix(palette[0], palette[1], 1, 2, 3);
+          }
+          else
+          {
+               palette[2] = mix(palette[0], palette[1], 1, 1, 2);
+               palette[3] = 0x00000000; // Transparent black
+          }
+          Uint32 indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((Uint32)block[7] << 24);
+          for (int i = 0; i < 16; i++)
+          {
+               out[(i / 4) * stride + i % 4] = palette[(indices >> (2 * i)) & 3];
+          }
+     }
+
+     void applyExplicitAlpha(const Uint8 *block, Uint32 *out, int stride)
+     {
+          for (int i = 0; i < 16; i++)
+          {
+               Uint32 alpha = (block[i / 2] >> ((i & 1) * 4)) & 0xF;
+               Uint32 &pixel = out[(i / 4) * stride + i % 4];
+               pixel = (pixel & 0x00FFFFFF) | ((alpha * 17) << 24);
+          }
+     }
+
+     void applyInterpolatedAlpha(const Uint8 *block, Uint32 *out, int stride)
+     {
+          Uint32 a[8];
+          a[0] = block[0];
+          a[1] = block[1];
+          if (a[0] > a[1])
+          {
+               for (int i = 1; i < 7; i++)
+               {
+                    a[i + 1] = ((7 - i) * a[0] + i * a[1]) / 7;
+               }
+          }
+          else
+          {
+               for (int i = 1; i < 5; i++)
+               {
+                    a[i + 1] = ((5 - i) * a[0] + i * a[1]) / 5;
+               }
+               a[6] = 0;
+               a[7] = 255;
+          }
+          Uint64 bits = 0;
+          for (int i = 0; i < 6; i++)
+          {
+               bits |= (Uint64)block[2 + i] << (8 * i);
+          }
+          for (int i = 0; i < 16; i++)
+          {
+               Uint32 &pixel = out[(i / 4) * stride + i % 4];
+               pixel = (pixel & 0x00FFFFFF) | (a[(bits >> (3 * i)) & 7] << 24);
+          }
+     }
+
+     int blockBytesOf(DdsEncoding encoding)
+     {
+          return encoding == DDS_BC1 ? 8 : 16;
+     }
+
+     // Decode `count` consecutive blocks into a 4-row strip `stride` pixels wide
+     void decodeBlockRun(DdsEncoding encoding, const Uint8 *block, int count, Uint32 *strip, int stride)
+     {
+          const int blockBytes = blockBytesOf(encoding);
+          for (int bx = 0; bx < count; bx++, block += blockBytes)
+          {
+               Uint32 *out = &strip[bx * 4];
+               switch (encoding)
+               {
+               case DDS_BC1:
+                    decodeColor(block, out, stride, false);
+                    break;
+               case DDS_BC2:
+                    decodeColor(block + 8, out, stride, true);
+                    applyExplicitAlpha(block, out, stride);
+                    break;
+               default:
+                    decodeColor(block + 8, out, stride, true);
+                    applyInterpolatedAlpha(block, out, stride);
+                    break;
+               }
+          }
+     }
+
+     // Decode one row of blocks at a time into a strip padded to whole
+     // blocks, then crop and convert it into the destination rows
+     bool decodeBlocksInto(SDL_RWops *rw, const DdsInfo &info, void *pixels, int pitch, Uint32 format)
+     {
+          int blocksWide = (info.width + 3) / 4;
+          int blocksHigh = (info.height + 3) / 4;
+          int blockBytes = blockBytesOf(info.encoding);
+          int paddedWidth = blocksWide * 4;
+          std::vector<Uint8> data((size_t)blocksWide * blockBytes);
+          std::vector<Uint32> strip((size_t)paddedWidth * 4);
+          for (int by = 0; by < blocksHigh; by++)
+          {
+               if (SDL_RWread(rw, data.data(), 1, data.size()) != data.size())
+               {
+                    SDL_SetError("Truncated DDS data");
+                    return false;
+               }
+               decodeBlockRun(info.encoding, data.data(), blocksWide, strip.data(), paddedWidth);
+
+               int rows = SDL_min(4, info.height - by * 4);
+               Uint8 *dst = (Uint8 *)pixels + (size_t)by * 4 * pitch;
+               if (SDL_ConvertPixels(info.width, rows, SDL_PIXELFORMAT_ARGB8888, strip.data(), paddedWidth * 4, format,
+                                     dst, pitch) != 0)
+               {
+                    return false;
+               }
+          }
+          return true;
+     }
+
+     // Rows straight from the file when the layouts match, else converted
+     bool readUncompressedInto(SDL_RWops *rw, const DdsInfo &info, void *pixels, int pitch, Uint32 format)
+     {
+          const bool direct = format == info.pixelFormat;
+          std::vector<Uint8> row(direct ? 0 : info.pitch);
+          for (int y = 0; y < info.height; y++)
+          {
+               Uint8 *dst = (Uint8 *)pixels + (size_t)y * pitch;
+               Uint8 *src = direct ? dst : row.data();
+               if (SDL_RWread(rw, src, 1, info.pitch) != (size_t)info.pitch)
+               {
+                    SDL_SetError("Truncated DDS data");
+                    return false;
+               }
+               if (!direct && SDL_ConvertPixels(info.width, 1, info.pixelFormat, src, info.pitch, format, dst, pitch) != 0)
+               {
+                    return false;
+               }
+          }
+          return true;
+     }
+
+     SDL_Surface *decodeBlocks(SDL_RWops *rw, const DdsInfo &info)
+     {
+          SDL_Surface *surface = alignedSurfaceCreate(info.width, info.height, SDL_PIXELFORMAT_ARGB8888);
+          if (surface != nullptr && !decodeBlocksInto(rw, info, surface->pixels, surface->pitch, SDL_PIXELFORMAT_ARGB8888))
+          {
+               SDL_FreeSurface(surface);
+               return nullptr;
+          }
+          return surface;
+     }
+
+     SDL_Surface *readUncompressed(SDL_RWops *rw, const DdsInfo &info)
+     {
+          SDL_Surface *surface = alignedSurfaceCreate(info.width, info.height, info.pixelFormat);
+          if (surface != nullptr && !readUncompressedInto(rw, info, surface->pixels, surface->pitch, info.pixelFormat))
+          {
+               SDL_FreeSurface(surface);
+               return nullptr;
+          }
+          return surface;
+     }
+
+     // Copy a decoded surface into caller memory; indexed surfaces need a
+     // blit since SDL_ConvertPixels has no palette to go by
+     bool copySurfaceInto(SDL_Surface *surface, void *pixels, int pitch, Uint32 format)
+     {
+          if (!SDL_ISPIXELFORMAT_INDEXED(surface->format->format))
+          {
+               return SDL_ConvertPixels(surface->w, surface->h, surface->format->format, surface->pixels, surface->pitch,
+                                        format, pixels, pitch) == 0;
+          }
+          SDL_Surface *target = SDL_CreateRGBSurfaceWithFormatFrom(pixels, surface->w, surface->h,
+                                                                   SDL_BITSPERPIXEL(format), pitch, format);
+          if (target == nullptr)
+          {
+               return false;
+          }
+          SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+          bool copied = SDL_BlitSurface(surface, NULL, target, NULL) == 0;
+          SDL_FreeSurface(target);
+          return copied;
+     }
+
+     bool rendererSupports(SDL_Renderer *renderer, Uint32 format)
+     {
+          SDL_RendererInfo info;
+          if (SDL_GetRendererInfo(renderer, &info) != 0)
+          {
+               return false;
+          }
+          for (Uint32 i = 0; i < info.num_texture_formats; i++)
+          {
+               if (info.texture_formats[i] == format)
+               {
+                    return true;
+               }
+          }
+          return false;
+     }
+}
+
+bool ddsIsDds(SDL_RWops *rw)
+{
+     Sint64 start = SDL_RWtell(rw);
+     char magic[4];
+     bool dds = SDL_RWread(rw, magic, 1, 4) == 4 && std::memcmp(magic, "DDS ", 4) == 0;
+     SDL_RWseek(rw, start, RW_SEEK_SET);
+     return dds;
+}
+
+SDL_Surface *ddsLoadSurface(SDL_RWops *rw, int freesrc)
+{
+     DdsInfo info;
+     SDL_Surface *surface = nullptr;
+     if (readHeader(rw, info))
+     {
+          surface = info.encoding == DDS_UNCOMPRESSED ? readUncompressed(rw, info) : decodeBlocks(rw, info);
+     }
+     if (freesrc)
+     {
+          SDL_RWclose(rw);
+     }
+     return surface;
+}
+
+SDL_Texture *ddsLoadTexture(SDL_Renderer *renderer, SDL_RWops *rw, int freesrc)
+{
+     Sint64 start = SDL_RWtell(rw);
+     DdsInfo info;
+     SDL_Texture *texture = nullptr;
+     if (readHeader(rw, info) && info.encoding == DDS_UNCOMPRESSED && rendererSupports(renderer, info.pixelFormat))
+     {
+          // Upload the file's own layout with no conversion, straight from
+          // the mapping when the stream has one
+          const size_t bytes = (size_t)info.pitch * info.height;
+          size_t available = 0;
+          const Uint8 *mapped = mappedRWData(rw, &available);
+          std::vector<Uint8> copy;
+          const Uint8 *pixels = mapped != nullptr && available >= bytes ? mapped : nullptr;
+          if (pixels == nullptr)
+          {
+               copy.resize(bytes);
+               pixels = SDL_RWread(rw, copy.data(), 1, bytes) == bytes ? copy.data() : nullptr;
+          }
+          if (pixels != nullptr)
+          {
+               texture = SDL_CreateTexture(renderer, info.pixelFormat, SDL_TEXTUREACCESS_STATIC, info.width,
+                                           info.height);
+               if (texture != nullptr)
+               {
+                    renderRecordSetTextureBlendMode(texture, SDL_ISPIXELFORMAT_ALPHA(info.pixelFormat) ? SDL_BLENDMODE_BLEND
+                                                                                             : SDL_BLENDMODE_NONE);
+                    renderRecordUpdateTexture(texture, NULL, pixels, info.pitch);
+               }
+          }
+          if (freesrc)
+          {
+               SDL_RWclose(rw);
+          }
+          return texture;
+     }
+
+     // Everything else goes through a surface
+     SDL_RWseek(rw, start, RW_SEEK_SET);
+     SDL_Surface *surface = ddsLoadSurface(rw, freesrc);
+     if (surface != nullptr)
+     {
+          texture = renderRecordCreateTextureFromSurface(renderer, surface);
+          SDL_FreeSurface(surface);
+     }
+     return texture;
+}
+
+bool imageDecodeInto(SDL_RWops *rw, int freesrc, void *pixels, int pitch, Uint32 format, int width, int height)
+{
+     if (rw == nullptr)
+     {
+          SDL_InvalidParamError("rw");
+          return false;
+     }
+
+     bool decoded = false;
+     if (ddsIsDds(rw))
+     {
+          DdsInfo info;
+          if (readHeader(rw, info))
+          {
+               if (info.width != width || info.height != height)
+               {
+                    SDL_SetError("Image is %dx%d, not %dx%d", info.width, info.height, width, height);
+               }
+               else if (info.encoding == DDS_UNCOMPRESSED)
+               {
+                    decoded = readUncompressedInto(rw, info, pixels, pitch, format);
+               }
+               else if (info.encoding != DDS_UNSUPPORTED)
+               {
+                    decoded = decodeBlocksInto(rw, info, pixels, pitch, format);
+               }
+               else
+               {
+                    SDL_SetError("Unsupported DDS pixel format");
+               }
+          }
+          if (freesrc)
+          {
+               SDL_RWclose(rw);
+          }
+          return decoded;
+     }
+
+     // SDL_image always decodes into a surface of its own; convert once from there
+     SDL_Surface *surface = IMG_Load_RW(rw, freesrc);
+     if (surface == nullptr)
+     {
+          return false;
+     }
+     if (surface->w != width || surface->h != height)
+     {
+          SDL_SetError("Image is %dx%d, not %dx%d", surface->w, surface->h, width, height);
+     }
+     else
+     {
+          decoded = copySurfaceInto(surface, pixels, pitch, format);
+     }
+     SDL_FreeSurface(surface);
+     return decoded;
+}
+
+bool imageDecodeIntoTexture(SDL_Texture *texture, SDL_RWops *rw, int freesrc)
+{
+     Uint32 format;
+     int access = SDL_TEXTUREACCESS_STATIC;
+     int width, height;
+     void *pixels = nullptr;
+     int pitch = 0;
+     bool locked = false;
+     if (SDL_QueryTexture(texture, &format, &access, &width, &height) == 0)
+     {
+          if (access != SDL_TEXTUREACCESS_STREAMING)
+          {
+               SDL_SetError("Texture is not streaming");
+          }
+          else
+          {
+               locked = renderRecordLockTexture(texture, NULL, &pixels, &pitch) == 0;
+          }
+     }
+     if (!locked)
+     {
+          if (freesrc && rw != nullptr)
+          {
+               SDL_RWclose(rw);
+          }
+          return false;
+     }
+     bool decoded = imageDecodeInto(rw, freesrc, pixels, pitch, format, width, height);
+     renderRecordUnlockTexture(texture);
+     return decoded;
+}
+
+bool ddsRegionOpen(DdsRegionReader &reader, SDL_RWops *rw, int freesrc)
+{
+     reader.rw = nullptr;
+     reader.freesrc = false;
+     DdsInfo info;
+     if (rw == nullptr || !readHeader(rw, info))
+     {
+          if (rw != nullptr && freesrc)
+          {
+               SDL_RWclose(rw);
+          }
+          return false;
+     }
+     reader.rw = rw;
+     reader.freesrc = freesrc != 0;
+     reader.width = info.width;
+     reader.height = info.height;
+     reader.encoding = (int)info.encoding;
+     reader.pixelFormat = info.pixelFormat;
+     reader.pitch = info.pitch;
+     reader.dataStart = SDL_RWtell(rw);
+     reader.fileFormat = info.encoding == DDS_UNCOMPRESSED ? info.pixelFormat : (Uint32)SDL_PIXELFORMAT_ARGB8888;
+     reader.row.clear();
+     reader.strip.clear();
+     return reader.dataStart >= 0;
+}
+
+bool ddsRegionDecode(DdsRegionReader &reader, const SDL_Rect &rect, void *pixels, int pitch, Uint32 format)
+{
+     const SDL_Rect bounds = {0, 0, reader.width, reader.height};
+     SDL_Rect clipped;
+     if (reader.rw == nullptr || !SDL_IntersectRect(&rect, &bounds, &clipped) || !SDL_RectEquals(&clipped, &rect))
+     {
+          SDL_SetError("Region is outside the %dx%d image", reader.width, reader.height);
+          return false;
+     }
+
+     const DdsEncoding encoding = (DdsEncoding)reader.encoding;
+     if (encoding == DDS_UNCOMPRESSED)
+     {
+          // Each row of the region is one contiguous run in the file
+          const int bytesPerPixel = SDL_BYTESPERPIXEL(reader.pixelFormat);
+          const size_t runBytes = (size_t)rect.w * bytesPerPixel;
+          reader.row.resize(runBytes);
+          for (int y = 0; y < rect.h; y++)
+          {
+               const Sint64 offset = reader.dataStart + (Sint64)(rect.y + y) * reader.pitch + (Sint64)rect.x * bytesPerPixel;
+               if (SDL_RWseek(reader.rw, offset, RW_SEEK_SET) < 0 ||
+                   SDL_RWread(reader.rw, reader.row.data(), 1, runBytes) != runBytes)
+               {
+                    SDL_SetError("Truncated DDS data");
+                    return false;
+               }
+               if (SDL_ConvertPixels(rect.w, 1, reader.pixelFormat, reader.row.data(), (int)runBytes, format,
+                                     (Uint8 *)pixels + (size_t)y * pitch, pitch) != 0)
+               {
+                    return false;
+               }
+          }
+          return true;
+     }
+
+     // Block formats: read the blocks covering each 4-row band of the region
+     const int blocksWide = (reader.width + 3) / 4;
+     const int blockBytes = blockBytesOf(encoding);
+     const int firstBlock = rect.x / 4;
+     const int lastBlock = (rect.x + rect.w - 1) / 4;
+     const int runBlocks = lastBlock - firstBlock + 1;
+     const int stride = runBlocks * 4;
+     reader.row.resize((size_t)runBlocks * blockBytes);
+     reader.strip.resize((size_t)stride * 4);
+     for (int by = rect.y / 4; by <= (rect.y + rect.h - 1) / 4; by++)
+     {
+          const Sint64 offset = reader.dataStart + ((Sint64)by * blocksWide + firstBlock) * blockBytes;
+          if (SDL_RWseek(reader.rw, offset, RW_SEEK_SET) < 0 ||
+              SDL_RWread(reader.rw, reader.row.data(), 1, reader.row.size()) != reader.row.size())
+          {
+               SDL_SetError("Truncated DDS data");
+               return false;
+          }
+          decodeBlockRun(encoding, reader.row.data(), runBlocks, reader.strip.data(), stride);
+
+          // The band's rows that fall inside the region, cropped on the left
+          const int top = SDL_max(by * 4, rect.y);
+          const int bottom = SDL_min(by * 4 + 4, rect.y + rect.h);
+          const Uint32 *src = &reader.strip[(size_t)(top - by * 4) * stride + (rect.x - firstBlock * 4)];
+          Uint8 *dst = (Uint8 *)pixels + (size_t)(top - rect.y) * pitch;
+          if (SDL_ConvertPixels(rect.w, bottom - top, SDL_PIXELFORMAT_ARGB8888, src, stride * 4, format, dst, pitch) != 0)
+          {
+               return false;
+          }
+     }
+     return true;
+}
+
+void ddsRegionClose(DdsRegionReader &reader)
+{
+     if (reader.rw != nullptr && reader.freesrc)
+     {
+          SDL_RWclose(reader.rw);
+     }
+     reader.rw = nullptr;
+     reader.row.clear();
+     reader.row.shrink_to_fit();
+     reader.strip.clear();
+     reader.strip.shrink_to_fit();
+}
+
+SDL_Surface *imageLoadSurface(SDL_RWops *rw, int freesrc)
+{
+     if (rw != nullptr && ddsIsDds(rw))
+     {
+          return ddsLoadSurface(rw, freesrc);
+     }
+     return IMG_Load_RW(rw, freesrc);
+}
@@ -0,0 +1,70 @@
+// Description:
+// DDS texture loading that skips SDL_image's decoders. Block-compressed
+// images (BC1/BC2/BC3, legacy DXT1/3/5 or DX10 headers) decode with a
+// fixed-rate 4x4 block decoder, far cheaper than inflating a PNG.
+// Uncompressed DDS data is taken as-is in its own pixel layout; when the
+// renderer supports that layout (e.g. RGB565 or ARGB4444) the texture is
+// uploaded straight from the file bytes, using half the VRAM of RGBA8.
+//
+// SDL_Renderer has no API for GPU block-compressed textures, so BCn data is
+// expanded on the CPU before upload rather than sent to the GPU as-is.
+// =============================================================================
+
+#ifndef DDS_IMAGE_H
+#define DDS_IMAGE_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+// True if the stream starts with a DDS signature; the position is restored
+bool ddsIsDds(SDL_RWops *rw);
+
+// Decode the top mip level; nullptr with SDL_GetError() set on failure
+SDL_Surface *ddsLoadSurface(SDL_RWops *rw, int freesrc);
+
+// Create a texture, uploading uncompressed data directly when the renderer
+// accepts its pixel format
+SDL_Texture *ddsLoadTexture(SDL_Renderer *renderer, SDL_RWops *rw, int freesrc);
+
+// DDS through ddsLoadSurface, anything else through IMG_Load_RW
+SDL_Surface *imageLoadSurface(SDL_RWops *rw, int freesrc);
+
+// Decode straight into caller memory (a pooled staging buffer, a locked
+// texture) laid out as `format` with `pitch` bytes per row. The image must be
+// width x height; see imageProbe() to learn that first. DDS decodes with no
+// intermediate image at all; other formats still go through SDL_image's own
+// surface, converted into `pixels` once.
+bool imageDecodeInto(SDL_RWops *rw, int freesrc, void *pixels, int pitch, Uint32 format, int width, int height);
+
+// imageDecodeInto() the locked pixels of a streaming texture of the image's size
+bool imageDecodeIntoTexture(SDL_Texture *texture, SDL_RWops *rw, int freesrc);
+
+// Region decoding for very large DDS images, e.g. tiles of a virtual
+// texture: any rect decodes by seeking straight to the rows or 4x4 block
+// bands it covers, so memory stays at one band of the region no matter how
+// big the image is. Only DDS has this; SDL_image's PNG/JPEG/TIFF decoders
+// can only produce whole images.
+struct DdsRegionReader
+{
+     SDL_RWops *rw;
+     bool freesrc;
+     int width, height;
+     Uint32 fileFormat;  // Layout regions decode from: the file's, or ARGB8888 for BCn
+     int encoding;       // Internal
+     Uint32 pixelFormat; // Of uncompressed data
+     int pitch;          // Of uncompressed data
+     Sint64 dataStart;   // Top mip level
+
+     std::vector<Uint8> row;    // Scratch: one run of file data
+     std::vector<Uint32> strip; // Scratch: one decoded block band
+};
+
+// Read the header; the stream must stay seekable while the reader is open
+bool ddsRegionOpen(DdsRegionReader &reader, SDL_RWops *rw, int freesrc);
+
+// Decode `rect` (inside the image) into `pixels`, laid out as `format`
+bool ddsRegionDecode(DdsRegionReader &reader, const SDL_Rect &rect, void *pixels, int pitch, Uint32 format);
+
+void ddsRegionClose(DdsRegionReader &reader);
+
+#endif // DDS_IMAGE_H
@@ -0,0 +1,183 @@
+#include "debug_text.h"
+
+#include <iostream>
+
+#include "render_record.h"
+
+namespace
+{
+     const int DEBUG_ATLAS_COLUMNS = 16;
+     const int DEBUG_ATLAS_SIZE = DEBUG_ATLAS_COLUMNS * FONT_CHARACTER_SIZE;
+
+     // Latin-1 from UTF-8; anything past U+00FF, and malformed bytes, is '?'
+     Uint32 debugNextCharacter(const char *&string)
+     {
+          const Uint8 lead = (Uint8)*string++;
+          if (lead < 0x80)
+          {
+               return lead;
+          }
+          int continuation = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+          Uint32 codepoint = lead & (0x3F >> continuation);
+          for (; continuation > 0 && ((Uint8)*string & 0xC0) == 0x80; continuation--)
+          {
+               codepoint = (codepoint << 6) | ((Uint8)*string++ & 0x3F);
+          }
+          return continuation == 0 && codepoint <= 0xFF && lead >= 0xC0 ? codepoint : '?';
+     }
+
+     void debugGrow(DebugText &text, int glyphs)
+     {
+          const size_t vertices = (size_t)(text.vertexCount + glyphs * 4);
+          const size_t indices = (size_t)(text.indexCount + glyphs * 6);
+          if (text.vertices.size() < vertices)
+          {
+               text.vertices.resize(SDL_max(vertices, text.vertices.size() * 2));
+          }
+          if (text.indices.size() < indices)
+          {
+               text.indices.resize(SDL_max(indices, text.indices.size() * 2));
+          }
+     }
+
+     void debugQuad(DebugText &text, float x, float y, float size, Uint32 character, SDL_Color color)
+     {
+          const float cell = 1.0f / DEBUG_ATLAS_COLUMNS;
+          const float u = (character % DEBUG_ATLAS_COLUMNS) * cell;
+          const float v = (character / DEBUG_ATLAS_COLUMNS) * cell;
+          SDL_Vertex *quad = &text.vertices[text.vertexCount];
+          quad[0] = {{x, y}, color, {u, v}};
+          quad[1] = {{x + size, y}, color, {u + cell, v}};
+          quad[2] = {{x + size, y + size}, color, {u + cell, v + cell}};
+          quad[3] = {{x, y + size}, color, {u, v + cell}};
+
+          int *index = &text.indices[text.indexCount];
+          const int base = text.vertexCount;
+          index[0] = base;
+          index[1] = base + 1;
+          index[2] = base + 2;
+          index[3] = base;
+          index[4] = base + 2;
+          index[5] = base + 3;
+          text.vertexCount += 4;
+          text.indexCount += 6;
+          text.glyphs++;
+     }
+}
+
+bool debugTextInit(DebugText &text, SDL_Renderer *renderer, int reserveGlyphs)
+{
+     text.renderer = renderer;
+     text.atlas = nullptr;
+     text.vertexCount = 0;
+     text.indexCount = 0;
+     text.glyphs = 0;
+     text.drawCalls = 0;
+     text.vertices.resize((size_t)reserveGlyphs * 4);
+     text.indices.resize((size_t)reserveGlyphs * 6);
+#if defined(__EMSCRIPTEN__)
+     std::cerr << "Debug font unavailable: SDL2_test is not in the browser build" << std::endl;
+     return false;
+#else
+
+     SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, DEBUG_ATLAS_SIZE, DEBUG_ATLAS_SIZE, 32, SDL_PIXELFORMAT_ARGB8888);
+     SDL_Renderer *software = surface != nullptr ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+     if (software == nullptr)
+     {
+          std::cerr << "Unable to create debug font renderer! SDL Error: " << SDL_GetError() << std::endl;
+          SDL_FreeSurface(surface);
+          return false;
+     }
+     SDL_FillRect(surface, nullptr, 0);
+     SDL_SetRenderDrawColor(software, 255, 255, 255, 255);
+     for (Uint32 character = 1; character < 256; character++)
+     {
+          SDLTest_DrawCharacter(software, (int)(character % DEBUG_ATLAS_COLUMNS) * FONT_CHARACTER_SIZE,
+                                (int)(character / DEBUG_ATLAS_COLUMNS) * FONT_CHARACTER_SIZE, character);
+     }
+     SDL_RenderFlush(software);
+     // SDL_test caches its character textures per renderer; they go before
+     // the renderer, which would otherwise free them under SDL_test
+     SDLTest_CleanupTextDrawing();
+     SDL_DestroyRenderer(software);
+
+     text.atlas = renderRecordCreateTextureFromSurface(renderer, surface);
+     SDL_FreeSurface(surface);
+     if (text.atlas == nullptr)
+     {
+          std::cerr << "Unable to create debug font texture! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     renderRecordSetTextureBlendMode(text.atlas, SDL_BLENDMODE_BLEND);
+     SDL_SetTextureScaleMode(text.atlas, SDL_ScaleModeNearest);
+     return true;
+#endif
+}
+
+void debugTextDraw(DebugText &text, float x, float y, const char *string, SDL_Color color, float scale)
+{
+     if (text.atlas == nullptr || string == nullptr)
+     {
+          return;
+     }
+     debugGrow(text, (int)SDL_strlen(string));
+
+     const float size = FONT_CHARACTER_SIZE * scale;
+     float penX = x;
+     while (*string != '\0')
+     {
+          const Uint32 character = debugNextCharacter(string);
+          if (character == '\n')
+          {
+               penX = x;
+               y += FONT_LINE_HEIGHT * scale;
+               continue;
+          }
+          if (character != ' ')
+          {
+               debugQuad(text, penX, y, size, character, color);
+          }
+          penX += size;
+     }
+}
+
+void debugTextPrintf(DebugText &text, float x, float y, SDL_Color color, const char *format, ...)
+{
+     char buffer[1024];
+     va_list args;
+     va_start(args, format);
+     SDL_vsnprintf(buffer, sizeof(buffer), format, args);
+     va_end(args);
+     debugTextDraw(text, x, y, buffer, color);
+}
+
+void debugTextFlush(DebugText &text)
+{
+     text.drawCalls = 0;
+     if (text.indexCount > 0)
+     {
+          renderRecordGeometry(text.renderer, text.atlas, text.vertices.data(), text.vertexCount, text.indices.data(),
+                               text.indexCount);
+          text.drawCalls = 1;
+     }
+     debugTextClear(text);
+}
+
+void debugTextClear(DebugText &text)
+{
+     text.vertexCount = 0;
+     text.indexCount = 0;
+     text.glyphs = 0;
+}
+
+void debugTextDestroy(DebugText &text)
+{
+     if (text.atlas != nullptr)
+     {
+          renderRecordDestroyTexture(text.atlas);
+          text.atlas = nullptr;
+     }
+     text.vertices.clear();
+     text.indices.clear();
+     debugTextClear(text);
+}
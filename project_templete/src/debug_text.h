@@ -0,0 +1,70 @@
+// Description:
+// SDL_test's 8x8 debug font drawn from an atlas in one batch. Each
+// SDLTest_DrawString character is a separate SDL_RenderCopy from a texture
+// made for that character, so a screen of stats for a benchmark is
+// hundreds of draw calls. That overhead shows up in the very timings the
+// overlay is printing.
+//
+// debugTextInit() renders the 256 characters once with SDLTest_DrawCharacter
+// into a 128x128 surface on a software renderer (SDL_test keeps its font
+// data private) and uploads that as one white texture. Strings then become
+// tinted quads collected into arrays, and debugTextFlush() draws all of
+// them with one SDL_RenderGeometry call. Glyphs are
+// FONT_CHARACTER_SIZE square and lines FONT_LINE_HEIGHT apart, as with
+// SDLTest_DrawString, and scale sharply by whole multiples.
+//
+//     DebugText debug;
+//     debugTextInit(debug, renderer);
+//     debugTextPrintf(debug, 8, 8, white, "%.2f ms", frameMs);
+//     debugTextFlush(debug);
+// =============================================================================
+
+#ifndef DEBUG_TEXT_H
+#define DEBUG_TEXT_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#if defined(__EMSCRIPTEN__)
+// SDL2_test is not in emscripten's SDL2 port; debugTextInit() fails there
+#define FONT_CHARACTER_SIZE 8
+#define FONT_LINE_HEIGHT (FONT_CHARACTER_SIZE + 2)
+#else
+#include <SDL2/SDL_test_font.h>
+#endif
+
+struct DebugText
+{
+     SDL_Renderer *renderer;
+     SDL_Texture *atlas; // 16x16 characters, white on transparent
+
+     // Only ever grown, so a new frame writes over last frame's arrays
+     std::vector<SDL_Vertex> vertices;
+     std::vector<int> indices;
+     int vertexCount, indexCount; // In use
+     int glyphs;                  // Queued since the last flush
+     int drawCalls;               // SDL_RenderGeometry calls made by the last flush
+};
+
+// Build the atlas for `renderer`; false with a message on stderr if it
+// can't, as always in the browser. Calls SDLTest_CleanupTextDrawing(), so SDLTest_DrawString recreates
+// its own character textures the next time it is used.
+bool debugTextInit(DebugText &text, SDL_Renderer *renderer, int reserveGlyphs = 0);
+
+// Queue `string` with its top left at (x, y); '\n' starts a new line.
+// Characters outside Latin-1 draw as '?'.
+void debugTextDraw(DebugText &text, float x, float y, const char *string, SDL_Color color, float scale = 1.0f);
+
+// debugTextDraw() of a formatted string, up to 1023 bytes
+void debugTextPrintf(DebugText &text, float x, float y, SDL_Color color, SDL_PRINTF_FORMAT_STRING const char *format, ...)
+     SDL_PRINTF_VARARG_FUNC(5);
+
+// Draw everything queued in one call and empty the batch
+void debugTextFlush(DebugText &text);
+
+// Drop what is queued without drawing it
+void debugTextClear(DebugText &text);
+
+void debugTextDestroy(DebugText &text);
+
+#endif // DEBUG_TEXT_H
@@ -0,0 +1,212 @@
+#include "dirty_regions.h"
+
+#include <iostream>
+
+#include "render_record.h"
+#include "window_resize.h"
+
+namespace
+{
+     void createCanvas(DirtyRegions &regions)
+     {
+          SDL_RendererInfo info;
+          if (SDL_GetRendererInfo(regions.renderer, &info) < 0 || !(info.flags & SDL_RENDERER_TARGETTEXTURE))
+          {
+               return;
+          }
+          regions.canvas = SDL_CreateTexture(regions.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                             regions.width, regions.height);
+          if (regions.canvas == nullptr)
+          {
+               std::cerr << "Dirty regions canvas could not be created, redrawing full frames! SDL_Error: "
+                         << SDL_GetError() << std::endl;
+               return;
+          }
+          // The copy to the back buffer replaces pixels, it never blends
+          renderRecordSetTextureBlendMode(regions.canvas, SDL_BLENDMODE_NONE);
+     }
+
+     // A window resized away from the canvas's aspect shows bars around
+     // it, and the back buffer under them is undefined, so clear first
+     void presentCanvas(DirtyRegions &regions)
+     {
+          renderRecordSetDrawColor(regions.renderer, 0, 0, 0, 255);
+          renderRecordClear(regions.renderer);
+          renderRecordCopy(regions.renderer, regions.canvas, nullptr, nullptr);
+     }
+}
+
+bool dirtyRegionsInit(DirtyRegions &regions, SDL_Renderer *renderer, int width, int height)
+{
+     regions.renderer = renderer;
+     regions.canvas = nullptr;
+     regions.width = width;
+     regions.height = height;
+     regions.enabled = SDL_GetHintBoolean(DIRTY_REGIONS_HINT, SDL_TRUE);
+     regions.retain = false;
+     regions.rects.clear();
+     regions.full = true;
+     regions.redraw = {0, 0, width, height};
+     regions.direct = false;
+     regions.lastFull = false;
+     regions.canvasCurrent = false;
+     regions.framesDrawn = 0;
+     regions.framesSkipped = 0;
+     regions.framesDirect = 0;
+     if (regions.enabled)
+     {
+          createCanvas(regions);
+     }
+     return regions.canvas != nullptr;
+}
+
+void dirtyRegionsInvalidate(DirtyRegions &regions, const SDL_Rect &rect)
+{
+     if (!regions.full && rect.w > 0 && rect.h > 0)
+     {
+          regions.rects.push_back(rect);
+     }
+}
+
+void dirtyRegionsInvalidateAll(DirtyRegions &regions)
+{
+     regions.full = true;
+     regions.rects.clear();
+}
+
+void dirtyRegionsHandleEvent(DirtyRegions &regions, const SDL_Event &event)
+{
+     if (event.type == SDL_WINDOWEVENT)
+     {
+          switch (event.window.event)
+          {
+          case SDL_WINDOWEVENT_SHOWN:
+          case SDL_WINDOWEVENT_EXPOSED:
+          case SDL_WINDOWEVENT_RESTORED:
+               dirtyRegionsInvalidateAll(regions);
+               break;
+          default:
+               break;
+          }
+     }
+     else if (event.type == windowResizeEventType() && event.type != (Uint32)-1)
+     {
+          // A drag's many size changes and any render resets, once a frame
+          const Uint32 flags = (Uint32)event.user.code;
+          if (flags & WINDOW_RESIZE_TEXTURES)
+          {
+               // Every texture is gone, the canvas included
+               renderRecordInvalidateState();
+               if (regions.canvas != nullptr)
+               {
+                    renderRecordDestroyTexture(regions.canvas);
+                    regions.canvas = nullptr;
+                    createCanvas(regions);
+               }
+               regions.canvasCurrent = false;
+          }
+          else if (flags & WINDOW_RESIZE_TARGETS)
+          {
+               renderRecordInvalidateState();
+               regions.canvasCurrent = false;
+          }
+          dirtyRegionsInvalidateAll(regions);
+     }
+}
+
+bool dirtyRegionsBegin(DirtyRegions &regions, SDL_Color clearColor)
+{
+     if (regions.enabled && !regions.full && regions.rects.empty())
+     {
+          regions.framesSkipped++;
+          return false;
+     }
+
+     // Straight to the back buffer only when everything changed twice in a
+     // row; a partial change after direct frames redraws the stale canvas
+     regions.direct = regions.canvas != nullptr && regions.full && regions.lastFull && !regions.retain;
+     if (!regions.canvasCurrent)
+     {
+          regions.full = true;
+     }
+
+     // One clip rect per frame: multiple rects redraw their bounding box,
+     // which is still far less than the screen when one thing moves
+     const SDL_Rect screen = {0, 0, regions.width, regions.height};
+     regions.redraw = screen;
+     if (!regions.full && regions.canvas != nullptr)
+     {
+          SDL_Rect bounds = regions.rects[0];
+          for (size_t i = 1; i < regions.rects.size(); i++)
+          {
+               SDL_UnionRect(&bounds, &regions.rects[i], &bounds);
+          }
+          if (!SDL_IntersectRect(&bounds, &screen, &regions.redraw))
+          {
+               // Everything invalidated was off screen
+               regions.rects.clear();
+               regions.framesSkipped++;
+               return false;
+          }
+     }
+
+     renderRecordSetDrawColor(regions.renderer, clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+     if (regions.canvas == nullptr || regions.direct)
+     {
+          renderRecordClear(regions.renderer); // The letterbox bars too
+     }
+     else
+     {
+          // SDL_RenderClear ignores the clip rect, a fill does not need one
+          renderRecordSetTarget(regions.renderer, regions.canvas);
+          SDL_BlendMode blendMode;
+          SDL_GetRenderDrawBlendMode(regions.renderer, &blendMode);
+          renderRecordSetDrawBlendMode(regions.renderer, SDL_BLENDMODE_NONE);
+          renderRecordFillRect(regions.renderer, &regions.redraw);
+          renderRecordSetDrawBlendMode(regions.renderer, blendMode);
+          renderRecordSetClipRect(regions.renderer, &regions.redraw);
+     }
+     return true;
+}
+
+void dirtyRegionsEnd(DirtyRegions &regions)
+{
+     if (regions.direct)
+     {
+          regions.canvasCurrent = false;
+          regions.framesDirect++;
+     }
+     else if (regions.canvas != nullptr)
+     {
+          renderRecordSetClipRect(regions.renderer, nullptr);
+          renderRecordSetTarget(regions.renderer, nullptr);
+          presentCanvas(regions);
+          regions.canvasCurrent = true;
+     }
+     regions.lastFull = regions.full;
+     regions.direct = false;
+     regions.rects.clear();
+     regions.full = false;
+     regions.framesDrawn++;
+}
+
+bool dirtyRegionsPresentRetained(DirtyRegions &regions)
+{
+     if (regions.canvas == nullptr || !regions.canvasCurrent)
+     {
+          return false;
+     }
+     presentCanvas(regions);
+     renderRecordPresent(regions.renderer);
+     return true;
+}
+
+void dirtyRegionsDestroy(DirtyRegions &regions)
+{
+     if (regions.canvas != nullptr)
+     {
+          renderRecordDestroyTexture(regions.canvas);
+          regions.canvas = nullptr;
+     }
+     regions.rects.clear();
+}
@@ -0,0 +1,87 @@
+// Description:
+// Retained-mode redraw for mostly static screens. The scene is drawn into a
+// persistent render-target canvas instead of the back buffer, whose
+// contents are undefined after SDL_RenderPresent. Each frame the caller
+// reports what changed (dirtyRegionsInvalidate); dirtyRegionsBegin() clips
+// the canvas to the bounding box of those rects, so only that area is
+// cleared and redrawn, and dirtyRegionsEnd() copies the canvas to the back
+// buffer for presenting. A frame with nothing invalidated is not drawn or
+// presented at all, which is what keeps an idle menu off the GPU.
+//
+// When the whole frame is redrawn again and again (gameplay, where
+// everything moves), the canvas is only an extra full-screen copy per
+// frame, so from the second full redraw in a row the frame is drawn
+// straight to the back buffer and the canvas is left stale. The next
+// partial frame then redraws everything into the canvas once, and its
+// retained copy is current again. Set `retain` while frames are read back
+// (screenshots, captures): those read the canvas, not the back buffer at
+// window size, so every frame must be drawn to it.
+//
+// Without target texture support every presented frame is a full redraw,
+// but unchanged frames are still skipped. DIRTY_REGIONS_HINT set to "0"
+// draws and presents every frame, as before.
+//
+// The canvas stays at the size given to dirtyRegionsInit(); the window's
+// logical transform (logical_view.h) scales the copy to the window, so a
+// resize costs a copy, not a new canvas. Resizes and render resets arrive
+// through window_resize's once-a-frame event, which main must keep
+// pushing with windowResizeUpdate().
+// =============================================================================
+
+#ifndef DIRTY_REGIONS_H
+#define DIRTY_REGIONS_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+// Set to "0" (SDL_SetHint or the environment) to always redraw everything
+#define DIRTY_REGIONS_HINT "CATCH_DIRTY_REGIONS"
+
+struct DirtyRegions
+{
+     SDL_Renderer *renderer;
+     SDL_Texture *canvas; // Retained frame; nullptr means full redraws
+     int width, height;
+     bool enabled;
+     bool retain; // Set by the caller: no direct frames while true
+
+     std::vector<SDL_Rect> rects; // Invalidated since the last presented frame
+     bool full;
+     SDL_Rect redraw;    // Area being redrawn between Begin and End
+     bool direct;        // This frame draws to the back buffer, not the canvas
+     bool lastFull;      // The last presented frame was a full redraw
+     bool canvasCurrent; // The canvas holds the last presented frame
+
+     int framesDrawn;
+     int framesSkipped;
+     int framesDirect; // Drawn without the canvas
+};
+
+bool dirtyRegionsInit(DirtyRegions &regions, SDL_Renderer *renderer, int width, int height);
+
+void dirtyRegionsInvalidate(DirtyRegions &regions, const SDL_Rect &rect);
+void dirtyRegionsInvalidateAll(DirtyRegions &regions);
+
+// Window exposure and windowResizeEventType() events (resizes, render
+// target or device resets) lose what is on screen; feed every event
+// through here
+void dirtyRegionsHandleEvent(DirtyRegions &regions, const SDL_Event &event);
+
+// Returns false when nothing changed: draw nothing and skip the present.
+// Otherwise the invalidated area is filled with `clearColor` and clipped,
+// and the frame's drawing goes to the canvas (or, for a direct frame, the
+// back buffer) until dirtyRegionsEnd().
+bool dirtyRegionsBegin(DirtyRegions &regions, SDL_Color clearColor);
+
+// Put the canvas on the back buffer; SDL_RenderPresent comes next
+void dirtyRegionsEnd(DirtyRegions &regions);
+
+// Copy the last complete frame to the back buffer again and present it,
+// with no drawing; for a window being resized while the main loop can't
+// run (see window_resize.h). False without a canvas holding the last
+// finished frame, as after direct frames
+bool dirtyRegionsPresentRetained(DirtyRegions &regions);
+
+void dirtyRegionsDestroy(DirtyRegions &regions);
+
+#endif // DIRTY_REGIONS_H
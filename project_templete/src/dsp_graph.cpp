@@ -0,0 +1,430 @@
+#include "dsp_graph.h"
+
+#include <SDL2/SDL_mixer.h>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+     const int BLOCK_FRAMES = 4096;
+     const int DETACHED = -2;
+
+     void downmix(float *samples, int frames)
+     {
+          for (int i = 0; i < frames; i++)
+          {
+               samples[i] = 0.5f * (samples[2 * i] + samples[2 * i + 1]);
+          }
+     }
+
+     void upmix(float *samples, int frames)
+     {
+          // Back to front so nothing is overwritten before it is read
+          for (int i = frames - 1; i >= 0; i--)
+          {
+               samples[2 * i + 1] = samples[i];
+               samples[2 * i] = samples[i];
+          }
+     }
+
+     void runPlan(DspGraph &graph, float *samples, int frames)
+     {
+          const double nsPerTick = 1e9 / (double)SDL_GetPerformanceFrequency();
+          for (const DspStep &step : graph.plan)
+          {
+               switch (step.type)
+               {
+               case DSP_STEP_DOWNMIX:
+                    downmix(samples, frames);
+                    break;
+               case DSP_STEP_UPMIX:
+                    upmix(samples, frames);
+                    break;
+               case DSP_STEP_NODE:
+               {
+                    DspNodeTiming &timing = graph.timing[step.node];
+                    if (SDL_AtomicGet(&timing.bypassed))
+                    {
+                         break;
+                    }
+                    const DspNode &node = graph.nodes[step.node];
+                    Uint64 start = SDL_GetPerformanceCounter();
+                    node.process(node.state, samples, frames, step.channels, graph.rate);
+                    int ns = (int)((SDL_GetPerformanceCounter() - start) * nsPerTick);
+                    int average = SDL_AtomicGet(&timing.averageNs);
+                    SDL_AtomicSet(&timing.averageNs, average + (ns - average) / 8);
+                    break;
+               }
+               }
+          }
+     }
+
+     // Bypass the last optional node while over budget; bring nodes back,
+     // most recently bypassed first, once there is clear headroom
+     void holdBudget(DspGraph &graph)
+     {
+          int total = 0;
+          for (size_t i = 0; i < graph.nodes.size(); i++)
+          {
+               if (!SDL_AtomicGet(&graph.timing[i].bypassed))
+               {
+                    total += SDL_AtomicGet(&graph.timing[i].averageNs);
+               }
+          }
+          SDL_AtomicSet(&graph.totalNs, total);
+          if (graph.budgetNs <= 0)
+          {
+               return;
+          }
+
+          if (total > graph.budgetNs)
+          {
+               for (int i = (int)graph.nodes.size() - 1; i >= 0; i--)
+               {
+                    if (graph.nodes[i].optional && !SDL_AtomicGet(&graph.timing[i].bypassed))
+                    {
+                         SDL_AtomicSet(&graph.timing[i].bypassed, 1);
+                         return;
+                    }
+               }
+          }
+          else
+          {
+               for (size_t i = 0; i < graph.nodes.size(); i++)
+               {
+                    int cost = SDL_AtomicGet(&graph.timing[i].averageNs);
+                    if (SDL_AtomicGet(&graph.timing[i].bypassed) && total + cost < graph.budgetNs * 4 / 5)
+                    {
+                         SDL_AtomicSet(&graph.timing[i].bypassed, 0);
+                         return;
+                    }
+               }
+          }
+     }
+
+     void effect(int channel, void *stream, int len, void *userdata)
+     {
+          (void)channel;
+          DspGraph &graph = *(DspGraph *)userdata;
+          int frameSamples = graph.channels;
+
+          if (graph.format == AUDIO_F32SYS && graph.widest == graph.channels)
+          {
+               // Already float and never wider than the device: process the
+               // mixer's buffer directly
+               runPlan(graph, (float *)stream, len / (int)sizeof(float) / frameSamples);
+          }
+          else if (graph.format == AUDIO_F32SYS)
+          {
+               // A mono device feeding a stereo node: upmixing doubles the
+               // samples, so it has to happen in the block, not the stream
+               float *pcm = (float *)stream;
+               int frames = len / (int)sizeof(float) / frameSamples;
+               for (int done = 0; done < frames;)
+               {
+                    int block = SDL_min(frames - done, BLOCK_FRAMES);
+                    int count = block * frameSamples;
+                    float *span = pcm + done * frameSamples;
+                    float *samples = graph.block.data();
+                    SDL_memcpy(samples, span, count * sizeof(float));
+                    runPlan(graph, samples, block);
+                    SDL_memcpy(span, samples, count * sizeof(float));
+                    done += block;
+               }
+          }
+          else
+          {
+               Sint16 *pcm = (Sint16 *)stream;
+               int frames = len / (int)sizeof(Sint16) / frameSamples;
+               for (int done = 0; done < frames;)
+               {
+                    int block = SDL_min(frames - done, BLOCK_FRAMES);
+                    int count = block * frameSamples;
+                    Sint16 *span = pcm + done * frameSamples;
+                    float *samples = graph.block.data();
+                    for (int i = 0; i < count; i++)
+                    {
+                         samples[i] = span[i] * (1.0f / 32768.0f);
+                    }
+                    runPlan(graph, samples, block);
+                    for (int i = 0; i < count; i++)
+                    {
+                         float value = SDL_clamp(samples[i], -1.0f, 1.0f) * 32767.0f;
+                         span[i] = (Sint16)value;
+                    }
+                    done += block;
+               }
+          }
+          holdBudget(graph);
+     }
+
+     void effectDone(int channel, void *userdata)
+     {
+          (void)channel;
+          (void)userdata;
+     }
+
+     float dbToGain(float db)
+     {
+          return std::pow(10.0f, db / 20.0f);
+     }
+}
+
+void dspGraphInit(DspGraph &graph)
+{
+     graph.nodes.clear();
+     graph.plan.clear();
+     graph.timing.clear();
+     graph.block.clear();
+     graph.rate = 0;
+     graph.channels = 0;
+     graph.widest = 0;
+     graph.format = 0;
+     graph.mixerChannel = DETACHED;
+     graph.budgetNs = 0;
+     SDL_AtomicSet(&graph.totalNs, 0);
+}
+
+int dspGraphAdd(DspGraph &graph, const DspNode &node)
+{
+     if (graph.mixerChannel != DETACHED)
+     {
+          return -1;
+     }
+     graph.nodes.push_back(node);
+     return (int)graph.nodes.size() - 1;
+}
+
+void dspGraphSetBudget(DspGraph &graph, int microseconds)
+{
+     graph.budgetNs = microseconds * 1000;
+}
+
+bool dspGraphAttach(DspGraph &graph, int channel)
+{
+     int rate, channels;
+     Uint16 format;
+     if (Mix_QuerySpec(&rate, &format, &channels) == 0)
+     {
+          std::cerr << "DSP graph needs an open mixer! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          return false;
+     }
+     if ((format != AUDIO_S16SYS && format != AUDIO_F32SYS) || (channels != 1 && channels != 2))
+     {
+          std::cerr << "DSP graph needs a mono or stereo S16/F32 device" << std::endl;
+          return false;
+     }
+     graph.rate = rate;
+     graph.channels = channels;
+     graph.format = format;
+
+     // Resolve layouts once: convert only where a node needs something else
+     graph.plan.clear();
+     int layout = channels;
+     graph.widest = channels;
+     for (int i = 0; i < (int)graph.nodes.size(); i++)
+     {
+          int wanted = graph.nodes[i].channels;
+          if (wanted != 0 && wanted != layout)
+          {
+               graph.plan.push_back({wanted == 1 ? DSP_STEP_DOWNMIX : DSP_STEP_UPMIX, -1, wanted});
+               layout = wanted;
+               graph.widest = SDL_max(graph.widest, wanted);
+          }
+          graph.plan.push_back({DSP_STEP_NODE, i, layout});
+     }
+     if (layout != channels)
+     {
+          graph.plan.push_back({channels == 1 ? DSP_STEP_DOWNMIX : DSP_STEP_UPMIX, -1, channels});
+     }
+
+     graph.timing = std::vector<DspNodeTiming>(graph.nodes.size());
+     for (DspNodeTiming &timing : graph.timing)
+     {
+          SDL_AtomicSet(&timing.averageNs, 0);
+          SDL_AtomicSet(&timing.bypassed, 0);
+     }
+     // Upmixing writes two samples per frame, so a mono device with a stereo
+     // node still needs the stereo block
+     graph.block.assign(BLOCK_FRAMES * graph.widest, 0.0f);
+
+     if (Mix_RegisterEffect(channel, effect, effectDone, &graph) == 0)
+     {
+          std::cerr << "Unable to register DSP graph! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          return false;
+     }
+     graph.mixerChannel = channel;
+     return true;
+}
+
+void dspGraphDetach(DspGraph &graph)
+{
+     if (graph.mixerChannel != DETACHED)
+     {
+          Mix_UnregisterEffect(graph.mixerChannel, effect);
+          graph.mixerChannel = DETACHED;
+     }
+}
+
+double dspGraphNodeMicros(const DspGraph &graph, int node)
+{
+     if (node < 0 || node >= (int)graph.timing.size())
+     {
+          return 0.0;
+     }
+     return SDL_AtomicGet((SDL_atomic_t *)&graph.timing[node].averageNs) / 1000.0;
+}
+
+bool dspGraphNodeBypassed(const DspGraph &graph, int node)
+{
+     return node >= 0 && node < (int)graph.timing.size() &&
+            SDL_AtomicGet((SDL_atomic_t *)&graph.timing[node].bypassed) != 0;
+}
+
+// --- Biquad ---
+
+namespace
+{
+     void biquadSet(DspBiquad &filter, float b0, float b1, float b2, float a0, float a1, float a2)
+     {
+          filter.b0 = b0 / a0;
+          filter.b1 = b1 / a0;
+          filter.b2 = b2 / a0;
+          filter.a1 = a1 / a0;
+          filter.a2 = a2 / a0;
+          filter.z1[0] = filter.z1[1] = 0.0f;
+          filter.z2[0] = filter.z2[1] = 0.0f;
+     }
+}
+
+void dspBiquadLowpass(DspBiquad &filter, float rate, float cutoff, float q)
+{
+     float w0 = 2.0f * (float)M_PI * cutoff / rate;
+     float alpha = std::sin(w0) / (2.0f * q);
+     float cosw = std::cos(w0);
+     biquadSet(filter, (1.0f - cosw) / 2.0f, 1.0f - cosw, (1.0f - cosw) / 2.0f, 1.0f + alpha, -2.0f * cosw,
+               1.0f - alpha);
+}
+
+void dspBiquadPeaking(DspBiquad &filter, float rate, float center, float q, float gainDb)
+{
+     float a = std::pow(10.0f, gainDb / 40.0f);
+     float w0 = 2.0f * (float)M_PI * center / rate;
+     float alpha = std::sin(w0) / (2.0f * q);
+     float cosw = std::cos(w0);
+     biquadSet(filter, 1.0f + alpha * a, -2.0f * cosw, 1.0f - alpha * a, 1.0f + alpha / a, -2.0f * cosw,
+               1.0f - alpha / a);
+}
+
+void dspBiquadProcess(void *state, float *samples, int frames, int channels, int rate)
+{
+     (void)rate;
+     DspBiquad &f = *(DspBiquad *)state;
+     for (int c = 0; c < channels && c < 2; c++)
+     {
+          // Transposed direct form II
+          float z1 = f.z1[c], z2 = f.z2[c];
+          for (int i = 0; i < frames; i++)
+          {
+               float &x = samples[i * channels + c];
+               float y = f.b0 * x + z1;
+               z1 = f.b1 * x - f.a1 * y + z2;
+               z2 = f.b2 * x - f.a2 * y;
+               x = y;
+          }
+          f.z1[c] = z1;
+          f.z2[c] = z2;
+     }
+}
+
+// --- Compressor ---
+
+void dspCompressorInit(DspCompressor &compressor, float thresholdDb, float ratio, float attackMs, float releaseMs)
+{
+     compressor.thresholdDb = thresholdDb;
+     compressor.ratio = ratio;
+     compressor.attackMs = attackMs;
+     compressor.releaseMs = releaseMs;
+     compressor.envelope = 0.0f;
+}
+
+void dspCompressorProcess(void *state, float *samples, int frames, int channels, int rate)
+{
+     DspCompressor &comp = *(DspCompressor *)state;
+     float attack = std::exp(-1000.0f / (comp.attackMs * rate));
+     float release = std::exp(-1000.0f / (comp.releaseMs * rate));
+     float threshold = dbToGain(comp.thresholdDb);
+     float slope = 1.0f - 1.0f / comp.ratio;
+
+     for (int i = 0; i < frames; i++)
+     {
+          // Peak detector over all channels of the frame, linked gain
+          float peak = 0.0f;
+          for (int c = 0; c < channels; c++)
+          {
+               peak = SDL_max(peak, std::fabs(samples[i * channels + c]));
+          }
+          float coefficient = peak > comp.envelope ? attack : release;
+          comp.envelope = peak + coefficient * (comp.envelope - peak);
+
+          if (comp.envelope > threshold)
+          {
+               // gain = (env / threshold)^-(1 - 1/ratio)
+               float gain = std::pow(comp.envelope / threshold, -slope);
+               for (int c = 0; c < channels; c++)
+               {
+                    samples[i * channels + c] *= gain;
+               }
+          }
+     }
+}
+
+// --- Reverb ---
+
+void dspReverbInit(DspReverb &reverb, int rate, float roomSize, float wet)
+{
+     // Classic Schroeder delay lengths at 44.1 kHz, scaled to the rate
+     const int combSamples[4] = {1557, 1617, 1491, 1422};
+     const int allpassSamples[2] = {225, 556};
+     for (int i = 0; i < 4; i++)
+     {
+          reverb.comb[i].assign(SDL_max(1, combSamples[i] * rate / 44100), 0.0f);
+          reverb.combPos[i] = 0;
+     }
+     for (int i = 0; i < 2; i++)
+     {
+          reverb.allpass[i].assign(SDL_max(1, allpassSamples[i] * rate / 44100), 0.0f);
+          reverb.allpassPos[i] = 0;
+     }
+     reverb.feedback = SDL_clamp(roomSize, 0.0f, 0.95f);
+     reverb.wet = SDL_clamp(wet, 0.0f, 1.0f);
+}
+
+void dspReverbProcess(void *state, float *samples, int frames, int channels, int rate)
+{
+     (void)rate;
+     DspReverb &r = *(DspReverb *)state;
+     for (int i = 0; i < frames; i++)
+     {
+          float &x = samples[i * channels];
+          float sum = 0.0f;
+          for (int c = 0; c < 4; c++)
+          {
+               std::vector<float> &line = r.comb[c];
+               float delayed = line[r.combPos[c]];
+               line[r.combPos[c]] = x + delayed * r.feedback;
+               r.combPos[c] = (r.combPos[c] + 1) % (int)line.size();
+               sum += delayed;
+          }
+          float y = sum * 0.25f;
+          for (int a = 0; a < 2; a++)
+          {
+               std::vector<float> &line = r.allpass[a];
+               float delayed = line[r.allpassPos[a]];
+               line[r.allpassPos[a]] = y + delayed * 0.5f;
+               y = delayed - y * 0.5f;
+               r.allpassPos[a] = (r.allpassPos[a] + 1) % (int)line.size();
+          }
+          x = x * (1.0f - r.wet) + y * r.wet;
+     }
+}
@@ -0,0 +1,123 @@
+// Description:
+// Effect chain for SDL_mixer that runs as one Mix_RegisterEffect callback.
+// Registering reverb, EQ and compression as separate effects makes each one
+// convert the stream on its own; a DspGraph converts the buffer to float32
+// once (not at all on a float device), runs every node in place, and
+// converts back once.
+//
+// Nodes declare the channel layout they need. dspGraphAttach() resolves the
+// chain into a fixed plan with the downmix/upmix steps inserted only where
+// the layout actually changes. Each node is timed; nodes marked optional
+// are bypassed, last first, while the chain runs over its time budget.
+// =============================================================================
+
+#ifndef DSP_GRAPH_H
+#define DSP_GRAPH_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+// Process `frames` interleaved frames of `channels` channels in place
+typedef void (*DspProcessFunc)(void *state, float *samples, int frames, int channels, int rate);
+
+struct DspNode
+{
+     const char *name;
+     DspProcessFunc process;
+     void *state;       // Owned by the caller
+     int channels;      // Required layout: 1 or 2, 0 for whatever comes in
+     bool optional;     // May be bypassed to hold the budget
+};
+
+enum DspStepType
+{
+     DSP_STEP_NODE,
+     DSP_STEP_DOWNMIX, // Stereo to mono
+     DSP_STEP_UPMIX    // Mono to stereo
+};
+
+struct DspStep
+{
+     DspStepType type;
+     int node;     // For DSP_STEP_NODE
+     int channels; // Layout the step runs at
+};
+
+struct DspNodeTiming
+{
+     SDL_atomic_t averageNs; // Exponential moving average per callback
+     SDL_atomic_t bypassed;
+};
+
+struct DspGraph
+{
+     std::vector<DspNode> nodes;
+     std::vector<DspStep> plan;
+     std::vector<DspNodeTiming> timing;
+     std::vector<float> block; // Scratch for BLOCK_FRAMES frames at the widest layout
+
+     int rate;
+     int channels;       // Device layout
+     int widest;         // Most channels any step of the plan runs at
+     Uint16 format;      // AUDIO_S16SYS or AUDIO_F32SYS
+     int mixerChannel;   // Registered on, or -2 when detached
+     int budgetNs;       // 0 for no budget
+     SDL_atomic_t totalNs;
+};
+
+void dspGraphInit(DspGraph &graph);
+
+// Returns the node index; the chain runs in insertion order
+int dspGraphAdd(DspGraph &graph, const DspNode &node);
+
+// Per-callback time the whole chain should stay under
+void dspGraphSetBudget(DspGraph &graph, int microseconds);
+
+// Compile the plan for the open mixer's format and register on `channel`
+// (MIX_CHANNEL_POST for the final mix). Nodes cannot be added while attached.
+bool dspGraphAttach(DspGraph &graph, int channel);
+void dspGraphDetach(DspGraph &graph);
+
+// Average cost of a node per callback in microseconds
+double dspGraphNodeMicros(const DspGraph &graph, int node);
+bool dspGraphNodeBypassed(const DspGraph &graph, int node);
+
+// --- Built-in nodes ---
+
+struct DspBiquad
+{
+     float b0, b1, b2, a1, a2;
+     float z1[2], z2[2];
+};
+
+// RBJ cookbook filters
+void dspBiquadLowpass(DspBiquad &filter, float rate, float cutoff, float q);
+void dspBiquadPeaking(DspBiquad &filter, float rate, float center, float q, float gainDb);
+void dspBiquadProcess(void *state, float *samples, int frames, int channels, int rate);
+
+struct DspCompressor
+{
+     float thresholdDb;
+     float ratio;
+     float attackMs, releaseMs;
+     float envelope;
+};
+
+void dspCompressorInit(DspCompressor &compressor, float thresholdDb, float ratio, float attackMs, float releaseMs);
+void dspCompressorProcess(void *state, float *samples, int frames, int channels, int rate);
+
+// Small Schroeder reverb (four combs, two allpasses), mono in and out
+struct DspReverb
+{
+     std::vector<float> comb[4];
+     std::vector<float> allpass[2];
+     int combPos[4];
+     int allpassPos[2];
+     float feedback;
+     float wet;
+};
+
+void dspReverbInit(DspReverb &reverb, int rate, float roomSize, float wet);
+void dspReverbProcess(void *state, float *samples, int frames, int channels, int rate);
+
+#endif // DSP_GRAPH_H
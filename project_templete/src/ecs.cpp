@@ -0,0 +1,348 @@
+#include "ecs.h"
+
+#include <cstring>
+
+namespace
+{
+     // Component types are per program, not per world
+     SDL_SpinLock registryLock = 0;
+     EcsComponentInfo registry[ECS_MAX_COMPONENTS];
+     int registryCount = 0;
+
+     size_t ecsAlignUp(size_t offset, size_t align)
+     {
+          return (offset + align - 1) & ~(align - 1);
+     }
+
+     EcsArchetype *ecsNewArchetype(EcsMask mask)
+     {
+          EcsArchetype *archetype = new EcsArchetype();
+          archetype->mask = mask;
+          archetype->tail = 0;
+          size_t rowBytes = sizeof(EcsEntity), padding = 0;
+          for (int i = 0; i < ECS_MAX_COMPONENTS; i++)
+          {
+               if (mask & (EcsMask(1) << i))
+               {
+                    archetype->components.push_back(i);
+                    rowBytes += registry[i].size;
+                    padding += registry[i].align;
+               }
+          }
+          const size_t room = ECS_CHUNK_BYTES > padding ? ECS_CHUNK_BYTES - padding : 0;
+          archetype->capacity = SDL_max(1, (int)(room / rowBytes));
+
+          // The entity array first, then one array per component
+          size_t offset = (size_t)archetype->capacity * sizeof(EcsEntity);
+          archetype->entityOffset = 0;
+          for (int component : archetype->components)
+          {
+               offset = ecsAlignUp(offset, registry[component].align);
+               archetype->offsets[component] = offset;
+               offset += (size_t)archetype->capacity * registry[component].size;
+          }
+          return archetype;
+     }
+
+     // Made on first use
+     int ecsFindArchetype(EcsWorld &world, EcsMask mask)
+     {
+          auto found = world.archetypeIndex.find(mask);
+          if (found != world.archetypeIndex.end())
+          {
+               return found->second;
+          }
+          const int index = (int)world.archetypes.size();
+          world.archetypes.push_back(ecsNewArchetype(mask));
+          world.archetypeIndex[mask] = index;
+          return index;
+     }
+
+     size_t ecsChunkBytes(const EcsArchetype &archetype)
+     {
+          size_t bytes = (size_t)archetype.capacity * sizeof(EcsEntity);
+          for (int component : archetype.components)
+          {
+               bytes = ecsAlignUp(bytes, registry[component].align) +
+                       (size_t)archetype.capacity * registry[component].size;
+          }
+          return SDL_max(bytes, (size_t)ECS_CHUNK_BYTES);
+     }
+
+     // Room for one more entity in the tail chunk; false if a new chunk
+     // was needed and could not be allocated
+     bool ecsReserveRow(EcsArchetype &archetype)
+     {
+          if (!archetype.chunks.empty() && archetype.chunks[archetype.tail].count < archetype.capacity)
+          {
+               return true;
+          }
+          const int next = archetype.chunks.empty() ? 0 : archetype.tail + 1;
+          if (next == (int)archetype.chunks.size())
+          {
+               Uint8 *memory = (Uint8 *)SDL_SIMDAlloc(ecsChunkBytes(archetype));
+               if (memory == nullptr)
+               {
+                    SDL_OutOfMemory();
+                    return false;
+               }
+               archetype.chunks.push_back(EcsChunk{memory, 0});
+          }
+          archetype.tail = next;
+          return true;
+     }
+
+     // Append the entity to the tail chunk, components left for the caller
+     void ecsPlace(EcsWorld &world, int archetypeIndex, EcsEntity entity)
+     {
+          EcsArchetype &archetype = *world.archetypes[archetypeIndex];
+          EcsChunk &chunk = archetype.chunks[archetype.tail];
+          const int row = chunk.count++;
+          ((EcsEntity *)(chunk.memory + archetype.entityOffset))[row] = entity;
+
+          EcsRecord &record = world.records[entity.index];
+          record.archetype = archetypeIndex;
+          record.chunk = archetype.tail;
+          record.row = row;
+     }
+
+     void ecsZeroRow(EcsArchetype &archetype, EcsChunk &chunk, int row, EcsMask keep)
+     {
+          for (int component : archetype.components)
+          {
+               if (!(keep & (EcsMask(1) << component)))
+               {
+                    const size_t size = registry[component].size;
+                    std::memset(chunk.memory + archetype.offsets[component] + row * size, 0, size);
+               }
+          }
+     }
+
+     // Fill the hole at (chunk, row) with the archetype's last entity, so
+     // the chunks stay packed
+     void ecsRemoveRow(EcsWorld &world, EcsArchetype &archetype, int chunkIndex, int row)
+     {
+          EcsChunk &last = archetype.chunks[archetype.tail];
+          const int lastRow = last.count - 1;
+          if (chunkIndex != archetype.tail || row != lastRow)
+          {
+               EcsChunk &chunk = archetype.chunks[chunkIndex];
+               EcsEntity *entities = (EcsEntity *)(chunk.memory + archetype.entityOffset);
+               const EcsEntity moved = ((EcsEntity *)(last.memory + archetype.entityOffset))[lastRow];
+               entities[row] = moved;
+               for (int component : archetype.components)
+               {
+                    const size_t size = registry[component].size, offset = archetype.offsets[component];
+                    std::memcpy(chunk.memory + offset + row * size, last.memory + offset + lastRow * size, size);
+               }
+               world.records[moved.index].chunk = chunkIndex;
+               world.records[moved.index].row = row;
+          }
+          last.count--;
+          if (last.count == 0 && archetype.tail > 0)
+          {
+               archetype.tail--;
+          }
+     }
+
+     EcsRecord *ecsRecord(EcsWorld &world, EcsEntity entity)
+     {
+          if (entity.index >= world.records.size())
+          {
+               return nullptr;
+          }
+          EcsRecord &record = world.records[entity.index];
+          return record.archetype >= 0 && record.generation == entity.generation ? &record : nullptr;
+     }
+}
+
+int ecsRegisterComponent(size_t size, size_t align)
+{
+     SDL_AtomicLock(&registryLock);
+     const int id = registryCount < ECS_MAX_COMPONENTS ? registryCount++ : -1;
+     if (id >= 0)
+     {
+          registry[id] = EcsComponentInfo{size, align};
+     }
+     SDL_AtomicUnlock(&registryLock);
+     if (id < 0)
+     {
+          SDL_SetError("More than %d ECS component types", ECS_MAX_COMPONENTS);
+     }
+     return id;
+}
+
+EcsComponentInfo ecsComponentInfo(int component)
+{
+     SDL_AtomicLock(&registryLock);
+     const EcsComponentInfo info = component >= 0 && component < registryCount ? registry[component]
+                                                                                : EcsComponentInfo{0, 0};
+     SDL_AtomicUnlock(&registryLock);
+     return info;
+}
+
+void ecsWorldInit(EcsWorld &world)
+{
+     world.archetypes.clear();
+     world.archetypeIndex.clear();
+     world.records.clear();
+     world.freeList.clear();
+     world.liveCount = 0;
+}
+
+void ecsWorldDestroy(EcsWorld &world)
+{
+     for (EcsArchetype *archetype : world.archetypes)
+     {
+          for (EcsChunk &chunk : archetype->chunks)
+          {
+               SDL_SIMDFree(chunk.memory);
+          }
+          delete archetype;
+     }
+     ecsWorldInit(world);
+}
+
+EcsEntity ecsCreate(EcsWorld &world, EcsMask mask)
+{
+     const int archetypeIndex = ecsFindArchetype(world, mask);
+     EcsArchetype &archetype = *world.archetypes[archetypeIndex];
+     if (!ecsReserveRow(archetype))
+     {
+          return EcsEntity{0, 0};
+     }
+
+     EcsEntity entity;
+     if (!world.freeList.empty())
+     {
+          entity.index = world.freeList.back();
+          world.freeList.pop_back();
+     }
+     else
+     {
+          entity.index = (Uint32)world.records.size();
+          world.records.push_back(EcsRecord{-1, 0, 0, 1});
+     }
+     entity.generation = world.records[entity.index].generation;
+     ecsPlace(world, archetypeIndex, entity);
+     const EcsRecord &record = world.records[entity.index];
+     ecsZeroRow(archetype, archetype.chunks[record.chunk], record.row, 0);
+     world.liveCount++;
+     return entity;
+}
+
+bool ecsAlive(const EcsWorld &world, EcsEntity entity)
+{
+     return entity.index < world.records.size() && world.records[entity.index].archetype >= 0 &&
+            world.records[entity.index].generation == entity.generation;
+}
+
+void ecsDestroy(EcsWorld &world, EcsEntity entity)
+{
+     EcsRecord *record = ecsRecord(world, entity);
+     if (record == nullptr)
+     {
+          return;
+     }
+     ecsRemoveRow(world, *world.archetypes[record->archetype], record->chunk, record->row);
+     record->archetype = -1;
+     // A stale handle never matches again; 0 is skipped on wrap-around
+     record->generation = record->generation + 1 == 0 ? 1 : record->generation + 1;
+     world.freeList.push_back(entity.index);
+     world.liveCount--;
+}
+
+EcsMask ecsMaskOf(const EcsWorld &world, EcsEntity entity)
+{
+     return ecsAlive(world, entity) ? world.archetypes[world.records[entity.index].archetype]->mask : 0;
+}
+
+bool ecsSetMask(EcsWorld &world, EcsEntity entity, EcsMask mask)
+{
+     EcsRecord *record = ecsRecord(world, entity);
+     if (record == nullptr)
+     {
+          return false;
+     }
+     const int fromIndex = record->archetype;
+     if (world.archetypes[fromIndex]->mask == mask)
+     {
+          return true;
+     }
+     const int toIndex = ecsFindArchetype(world, mask);
+     EcsArchetype &from = *world.archetypes[fromIndex];
+     EcsArchetype &to = *world.archetypes[toIndex];
+     if (!ecsReserveRow(to))
+     {
+          return false;
+     }
+
+     const int fromChunk = record->chunk, fromRow = record->row;
+     ecsPlace(world, toIndex, entity);
+     EcsChunk &source = from.chunks[fromChunk];
+     EcsChunk &target = to.chunks[record->chunk];
+     const EcsMask shared = from.mask & mask;
+     for (int component : to.components)
+     {
+          if (shared & (EcsMask(1) << component))
+          {
+               const size_t size = registry[component].size;
+               std::memcpy(target.memory + to.offsets[component] + record->row * size,
+                           source.memory + from.offsets[component] + fromRow * size, size);
+          }
+     }
+     ecsZeroRow(to, target, record->row, shared);
+     ecsRemoveRow(world, from, fromChunk, fromRow);
+     return true;
+}
+
+void *ecsGet(EcsWorld &world, EcsEntity entity, int component)
+{
+     EcsRecord *record = ecsRecord(world, entity);
+     if (record == nullptr || component < 0 || component >= ECS_MAX_COMPONENTS)
+     {
+          return nullptr;
+     }
+     EcsArchetype &archetype = *world.archetypes[record->archetype];
+     if (!(archetype.mask & (EcsMask(1) << component)))
+     {
+          return nullptr;
+     }
+     return archetype.chunks[record->chunk].memory + archetype.offsets[component] +
+            record->row * registry[component].size;
+}
+
+int ecsCount(const EcsWorld &world, EcsMask mask)
+{
+     int count = 0;
+     for (const EcsArchetype *archetype : world.archetypes)
+     {
+          if ((archetype->mask & mask) == mask)
+          {
+               for (const EcsChunk &chunk : archetype->chunks)
+               {
+                    count += chunk.count;
+               }
+          }
+     }
+     return count;
+}
+
+bool ecsFindChunk(EcsWorld &world, EcsMask mask, int index, EcsArchetype *&archetype, EcsChunk *&chunk)
+{
+     for (EcsArchetype *candidate : world.archetypes)
+     {
+          if ((candidate->mask & mask) != mask)
+          {
+               continue;
+          }
+          if (index < (int)candidate->chunks.size())
+          {
+               archetype = candidate;
+               chunk = &candidate->chunks[index];
+               return true;
+          }
+          index -= (int)candidate->chunks.size();
+     }
+     return false;
+}
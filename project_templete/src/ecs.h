@@ -0,0 +1,287 @@
+// Description:
+// Archetype entity-component store. Entities with the same set of
+// components share an archetype, and an archetype keeps its entities in
+// 16 KB chunks, each holding one contiguous array per component, so a
+// system that touches positions and velocities streams through exactly
+// those two arrays. Components are plain structs registered on first use
+// by type; queries name their components as template arguments, and the
+// loop over a chunk is instantiated for them, so it compiles down to the
+// same indexing as a hand-written struct-of-arrays pool like BlockPool.
+//
+//     struct Position { float x, y; };
+//     struct Velocity { float x, y; };
+//
+//     EcsWorld world;
+//     ecsWorldInit(world);
+//     EcsEntity e = ecsCreate<Position, Velocity>(world);
+//     ecsGet<Velocity>(world, e)->y = 4.0f;
+//     ecsEachParallel<Position, Velocity>(world, jobs, [](Position &p, Velocity &v) {
+//          p.x += v.x;
+//          p.y += v.y;
+//     });
+//
+// Creating, destroying, adding or removing components is a structural
+// change: it moves entities between chunks and must not happen while a
+// query is iterating. Collect the entities in the loop (ecsEachChunk()
+// passes them) and change them afterwards. Entity handles stay valid
+// across moves; pointers from ecsGet() do not.
+// =============================================================================
+
+#ifndef ECS_H
+#define ECS_H
+
+#include <SDL2/SDL.h>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "job_system.h"
+
+const int ECS_MAX_COMPONENTS = 64;
+const int ECS_CHUNK_BYTES = 16 * 1024;
+
+// Bit i set for component id i
+typedef Uint64 EcsMask;
+
+// Generation 0 is never handed out, so EcsEntity{} is the null entity
+struct EcsEntity
+{
+     Uint32 index;
+     Uint32 generation;
+};
+
+struct EcsChunk
+{
+     Uint8 *memory; // ECS_CHUNK_BYTES, or one entity's worth if that is more
+     int count;
+};
+
+struct EcsArchetype
+{
+     EcsMask mask;
+     int capacity;                       // Entities per chunk
+     size_t entityOffset;                // Of the EcsEntity array in a chunk
+     size_t offsets[ECS_MAX_COMPONENTS]; // Of each component's array; only for bits in mask
+     std::vector<int> components;        // Ids in mask, ascending
+     std::vector<EcsChunk> chunks;       // Full before `tail`, empty after it (kept for reuse)
+     int tail;                           // The chunk the next entity goes into
+};
+
+// Where an entity lives; indexed by EcsEntity::index
+struct EcsRecord
+{
+     int archetype; // -1 while the slot is free
+     int chunk;
+     int row;
+     Uint32 generation;
+};
+
+struct EcsWorld
+{
+     std::vector<EcsArchetype *> archetypes;
+     std::unordered_map<EcsMask, int> archetypeIndex; // Mask to index in archetypes
+     std::vector<EcsRecord> records;
+     std::vector<Uint32> freeList; // Released record slots
+     int liveCount;
+};
+
+struct EcsComponentInfo
+{
+     size_t size;
+     size_t align;
+};
+
+// Give a component type its id; ecsComponent<T>() calls this once per type.
+// Returns -1 (and sets the SDL error) past ECS_MAX_COMPONENTS.
+int ecsRegisterComponent(size_t size, size_t align);
+
+EcsComponentInfo ecsComponentInfo(int component);
+
+template <typename T>
+int ecsComponent()
+{
+     static_assert(std::is_trivially_copyable<T>::value, "Components are moved with memcpy");
+     static_assert(alignof(T) <= 16, "Chunk memory is 16-byte aligned");
+     static const int id = ecsRegisterComponent(sizeof(T), alignof(T));
+     SDL_assert_release(id >= 0);
+     return id;
+}
+
+template <typename... Ts>
+EcsMask ecsMask()
+{
+     const EcsMask bits[] = {0, (EcsMask(1) << ecsComponent<Ts>())...};
+     EcsMask mask = 0;
+     for (EcsMask bit : bits)
+     {
+          mask |= bit;
+     }
+     return mask;
+}
+
+void ecsWorldInit(EcsWorld &world);
+
+// Frees every chunk; all entities and handles become invalid
+void ecsWorldDestroy(EcsWorld &world);
+
+// A new entity with the components in `mask`, zero-filled; the null entity
+// if memory runs out
+EcsEntity ecsCreate(EcsWorld &world, EcsMask mask);
+
+template <typename... Ts>
+EcsEntity ecsCreate(EcsWorld &world)
+{
+     return ecsCreate(world, ecsMask<Ts...>());
+}
+
+bool ecsAlive(const EcsWorld &world, EcsEntity entity);
+
+// Does nothing for an entity that is not alive
+void ecsDestroy(EcsWorld &world, EcsEntity entity);
+
+// 0 for an entity that is not alive
+EcsMask ecsMaskOf(const EcsWorld &world, EcsEntity entity);
+
+// Move the entity to the archetype for `mask`: components in both keep
+// their values, new ones are zero-filled. False if it is not alive or
+// memory runs out, leaving it where it was.
+bool ecsSetMask(EcsWorld &world, EcsEntity entity, EcsMask mask);
+
+// The component's storage, or nullptr if the entity is not alive or does
+// not have it. Valid until the next structural change.
+void *ecsGet(EcsWorld &world, EcsEntity entity, int component);
+
+template <typename T>
+T *ecsGet(EcsWorld &world, EcsEntity entity)
+{
+     return (T *)ecsGet(world, entity, ecsComponent<T>());
+}
+
+template <typename T>
+bool ecsAdd(EcsWorld &world, EcsEntity entity, const T &value)
+{
+     if (!ecsSetMask(world, entity, ecsMaskOf(world, entity) | ecsMask<T>()))
+     {
+          return false;
+     }
+     *ecsGet<T>(world, entity) = value;
+     return true;
+}
+
+template <typename T>
+bool ecsRemove(EcsWorld &world, EcsEntity entity)
+{
+     return ecsSetMask(world, entity, ecsMaskOf(world, entity) & ~ecsMask<T>());
+}
+
+// Entities in every archetype that has all of `mask`
+int ecsCount(const EcsWorld &world, EcsMask mask);
+
+template <typename T>
+T *ecsChunkArray(const EcsArchetype &archetype, const EcsChunk &chunk)
+{
+     return (T *)(chunk.memory + archetype.offsets[ecsComponent<T>()]);
+}
+
+inline const EcsEntity *ecsChunkEntities(const EcsArchetype &archetype, const EcsChunk &chunk)
+{
+     return (const EcsEntity *)(chunk.memory + archetype.entityOffset);
+}
+
+template <typename F, typename... Ts>
+void ecsRunRows(int count, F &fn, Ts *...arrays)
+{
+     for (int i = 0; i < count; i++)
+     {
+          fn(arrays[i]...);
+     }
+}
+
+// fn(count, entities, Ts *...) once per chunk holding all of Ts, for
+// loops that want the arrays themselves
+template <typename... Ts, typename F>
+void ecsEachChunk(EcsWorld &world, F &&fn)
+{
+     const EcsMask mask = ecsMask<Ts...>();
+     for (EcsArchetype *archetype : world.archetypes)
+     {
+          if ((archetype->mask & mask) != mask)
+          {
+               continue;
+          }
+          for (EcsChunk &chunk : archetype->chunks)
+          {
+               fn(chunk.count, ecsChunkEntities(*archetype, chunk), ecsChunkArray<Ts>(*archetype, chunk)...);
+          }
+     }
+}
+
+// fn(Ts &...) for every entity with all of Ts
+template <typename... Ts, typename F>
+void ecsEach(EcsWorld &world, F &&fn)
+{
+     const EcsMask mask = ecsMask<Ts...>();
+     for (EcsArchetype *archetype : world.archetypes)
+     {
+          if ((archetype->mask & mask) != mask)
+          {
+               continue;
+          }
+          for (EcsChunk &chunk : archetype->chunks)
+          {
+               ecsRunRows(chunk.count, fn, ecsChunkArray<Ts>(*archetype, chunk)...);
+          }
+     }
+}
+
+// The `index`th chunk, counting through the archetypes that have all of
+// `mask`; what a parallel query's job index maps to
+bool ecsFindChunk(EcsWorld &world, EcsMask mask, int index, EcsArchetype *&archetype, EcsChunk *&chunk);
+
+template <typename F, typename... Ts>
+struct EcsParallelQuery
+{
+     EcsWorld *world;
+     EcsMask mask;
+     F *fn;
+
+     static void run(void *data, int index)
+     {
+          EcsParallelQuery &query = *(EcsParallelQuery *)data;
+          EcsArchetype *archetype;
+          EcsChunk *chunk;
+          if (ecsFindChunk(*query.world, query.mask, index, archetype, chunk))
+          {
+               ecsRunRows(chunk->count, *query.fn, ecsChunkArray<Ts>(*archetype, *chunk)...);
+          }
+     }
+};
+
+// ecsEach() with one job per chunk on `jobs`, waiting for all of them; fn
+// runs on several threads at once and must only write the entity it is
+// given. `jobs` may be nullptr to run on the calling thread.
+template <typename... Ts, typename F>
+void ecsEachParallel(EcsWorld &world, JobSystem *jobs, F &&fn)
+{
+     const EcsMask mask = ecsMask<Ts...>();
+     int chunks = 0;
+     for (EcsArchetype *archetype : world.archetypes)
+     {
+          if ((archetype->mask & mask) == mask)
+          {
+               chunks += (int)archetype->chunks.size();
+          }
+     }
+     if (jobs == nullptr || chunks < 2 || jobSystemThreadCount(*jobs) < 2)
+     {
+          ecsEach<Ts...>(world, fn);
+          return;
+     }
+     typedef typename std::remove_reference<F>::type Function;
+     EcsParallelQuery<Function, Ts...> query = {&world, mask, &fn};
+     JobCounter counter = {};
+     jobSystemSubmitRange(*jobs, EcsParallelQuery<Function, Ts...>::run, &query, chunks, &counter);
+     jobSystemWait(*jobs, counter);
+}
+
+#endif // ECS_H
@@ -0,0 +1,96 @@
+#include "entity_cull.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define ENTITY_CULL_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ENTITY_CULL_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+     // Four lanes in, visible indices out; branch-free so random visibility
+     // does not mispredict. Never writes past index first + 3.
+     int emit(int *visible, int n, int first, unsigned mask)
+     {
+          visible[n] = first;
+          n += mask & 1;
+          visible[n] = first + 1;
+          n += (mask >> 1) & 1;
+          visible[n] = first + 2;
+          n += (mask >> 2) & 1;
+          visible[n] = first + 3;
+          n += (mask >> 3) & 1;
+          return n;
+     }
+
+     unsigned aliveMask(const Uint8 *alive, int i)
+     {
+          if (alive == nullptr)
+          {
+               return 0xF;
+          }
+          return (alive[i] != 0) | (alive[i + 1] != 0) << 1 | (alive[i + 2] != 0) << 2 | (alive[i + 3] != 0) << 3;
+     }
+}
+
+int cullRects(const float *x, const float *y, const Uint8 *alive, int count, float width, float height,
+              const SDL_FRect &view, int *visible)
+{
+     if (count <= 0 || width <= 0.0f || height <= 0.0f || SDL_FRectEmpty(&view))
+     {
+          return 0;
+     }
+
+     // SDL_IntersectFRect: the overlap's far edge must lie past its near edge
+     const float viewRight = view.x + view.w;
+     const float viewBottom = view.y + view.h;
+     int n = 0;
+     int i = 0;
+
+#if defined(ENTITY_CULL_SSE2)
+     const __m128 vx = _mm_set1_ps(view.x), vy = _mm_set1_ps(view.y);
+     const __m128 vr = _mm_set1_ps(viewRight), vb = _mm_set1_ps(viewBottom);
+     const __m128 w = _mm_set1_ps(width), h = _mm_set1_ps(height);
+     for (; i + 4 <= count; i += 4)
+     {
+          const __m128 left = _mm_loadu_ps(x + i);
+          const __m128 top = _mm_loadu_ps(y + i);
+          const __m128 inX = _mm_cmpgt_ps(_mm_min_ps(_mm_add_ps(left, w), vr), _mm_max_ps(left, vx));
+          const __m128 inY = _mm_cmpgt_ps(_mm_min_ps(_mm_add_ps(top, h), vb), _mm_max_ps(top, vy));
+          unsigned mask = (unsigned)_mm_movemask_ps(_mm_and_ps(inX, inY)) & aliveMask(alive, i);
+          n = emit(visible, n, i, mask);
+     }
+#elif defined(ENTITY_CULL_NEON)
+     const float32x4_t vx = vdupq_n_f32(view.x), vy = vdupq_n_f32(view.y);
+     const float32x4_t vr = vdupq_n_f32(viewRight), vb = vdupq_n_f32(viewBottom);
+     const float32x4_t w = vdupq_n_f32(width), h = vdupq_n_f32(height);
+     for (; i + 4 <= count; i += 4)
+     {
+          const float32x4_t left = vld1q_f32(x + i);
+          const float32x4_t top = vld1q_f32(y + i);
+          const uint32x4_t inX = vcgtq_f32(vminq_f32(vaddq_f32(left, w), vr), vmaxq_f32(left, vx));
+          const uint32x4_t inY = vcgtq_f32(vminq_f32(vaddq_f32(top, h), vb), vmaxq_f32(top, vy));
+          const uint32x4_t in = vandq_u32(inX, inY);
+          unsigned mask = (vgetq_lane_u32(in, 0) & 1) | (vgetq_lane_u32(in, 1) & 2) | (vgetq_lane_u32(in, 2) & 4) |
+                          (vgetq_lane_u32(in, 3) & 8);
+          n = emit(visible, n, i, mask & aliveMask(alive, i));
+     }
+#endif
+
+     for (; i < count; i++)
+     {
+          if (alive != nullptr && !alive[i])
+          {
+               continue;
+          }
+          const float right = x[i] + width;
+          const float bottom = y[i] + height;
+          if (SDL_min(right, viewRight) > SDL_max(x[i], view.x) && SDL_min(bottom, viewBottom) > SDL_max(y[i], view.y))
+          {
+               visible[n++] = i;
+          }
+     }
+     return n;
+}
@@ -0,0 +1,25 @@
+// Description:
+// Visibility culling over struct-of-arrays entity pools. cullRects() tests
+// every entity's bounds against the camera rect and writes the indices of
+// the visible ones into a compact list, so drawing code loops over what is
+// on screen instead of over the whole pool and never looks at the rest.
+//
+// The test is exactly SDL_HasIntersectionF(): empty rects never intersect,
+// and rects that only share an edge do not count. It runs four entities per
+// step with SSE2 on x86-64 or NEON on ARM (both baseline there, so there is
+// no runtime dispatch), scalar elsewhere and for the tail.
+// =============================================================================
+
+#ifndef ENTITY_CULL_H
+#define ENTITY_CULL_H
+
+#include <SDL2/SDL.h>
+
+// Entity i spans (x[i], y[i], width, height). `alive` may be nullptr; when
+// given, only entries with a non-zero byte are considered. Writes the
+// visible indices, ascending, to `visible` (room for `count`) and returns
+// how many there are.
+int cullRects(const float *x, const float *y, const Uint8 *alive, int count, float width, float height,
+              const SDL_FRect &view, int *visible);
+
+#endif // ENTITY_CULL_H
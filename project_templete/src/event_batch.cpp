@@ -0,0 +1,450 @@
+#include "event_batch.h"
+
+namespace
+{
+     // SDL's own queue holds at most this many events
+     const int MAX_BATCH_CAPACITY = 65535;
+
+     // Set while the filter queues its own coalesced event, which then
+     // passes straight through the nested filter call
+     thread_local bool queueingPending = false;
+
+     bool sameSource(const SDL_MouseMotionEvent &a, const SDL_MouseMotionEvent &b)
+     {
+          return a.windowID == b.windowID && a.which == b.which;
+     }
+
+     void queueEvent(const SDL_Event &event)
+     {
+          SDL_Event copy = event;
+          queueingPending = true;
+          SDL_PushEvent(&copy);
+          queueingPending = false;
+     }
+
+     // Queue the pending motion, if any, ahead of whatever arrives next.
+     // The push re-enters the filter, so it happens outside the lock.
+     void queuePending(EventBatch &batch)
+     {
+          SDL_AtomicLock(&batch.lock);
+          bool has = batch.hasPending;
+          SDL_Event event = batch.pending;
+          batch.hasPending = false;
+          SDL_AtomicUnlock(&batch.lock);
+
+          if (has)
+          {
+               queueEvent(event);
+          }
+     }
+
+     void recordSensor(EventBatch &batch, const SDL_Event &event)
+     {
+          SensorSample sample;
+          SDL_zero(sample);
+          if (event.type == SDL_SENSORUPDATE)
+          {
+               sample.timestampUs = event.sensor.timestamp_us;
+               sample.which = event.sensor.which;
+               sample.type = SDL_SensorGetType(SDL_SensorFromInstanceID(event.sensor.which));
+               SDL_memcpy(sample.data, event.sensor.data, sizeof(event.sensor.data));
+          }
+          else
+          {
+               sample.timestampUs = event.csensor.timestamp_us;
+               sample.which = event.csensor.which;
+               sample.type = event.csensor.sensor;
+               sample.controller = true;
+               SDL_memcpy(sample.data, event.csensor.data, sizeof(event.csensor.data));
+          }
+          if (sample.timestampUs == 0)
+          {
+               sample.timestampUs = (Uint64)event.common.timestamp * 1000;
+          }
+
+          SDL_AtomicLock(&batch.lock);
+          if ((int)batch.sensorHistory.size() >= MAX_SENSOR_HISTORY)
+          {
+               batch.sensorHistory.erase(batch.sensorHistory.begin(),
+                                         batch.sensorHistory.begin() + MAX_SENSOR_HISTORY / 2);
+          }
+          batch.sensorHistory.push_back(sample);
+          SDL_AtomicUnlock(&batch.lock);
+     }
+
+     void recordTouch(EventBatch &batch, const SDL_Event &event)
+     {
+          const SDL_TouchFingerEvent &finger = event.tfinger;
+          SDL_AtomicLock(&batch.lock);
+          std::vector<TouchFinger> &live = batch.touchLive;
+          size_t i = 0;
+          // A finger that lifted and went down again before the drain is a new one
+          while (i < live.size() &&
+                 (live[i].touchId != finger.touchId || live[i].fingerId != finger.fingerId || live[i].released))
+          {
+               i++;
+          }
+          if (i == live.size())
+          {
+               if (event.type == SDL_FINGERUP)
+               {
+                    SDL_AtomicUnlock(&batch.lock);
+                    return; // Went down before tracking started
+               }
+               TouchFinger added;
+               SDL_zero(added);
+               added.touchId = finger.touchId;
+               added.fingerId = finger.fingerId;
+               added.pressed = event.type == SDL_FINGERDOWN;
+               added.frameX = added.pressed ? finger.x : finger.x - finger.dx;
+               added.frameY = added.pressed ? finger.y : finger.y - finger.dy;
+               live.push_back(added);
+          }
+
+          TouchFinger &f = live[i];
+          f.windowID = finger.windowID;
+          f.x = finger.x;
+          f.y = finger.y;
+          f.pressure = finger.pressure;
+          if (event.type == SDL_FINGERMOTION)
+          {
+               f.dx += finger.dx;
+               f.dy += finger.dy;
+               f.motionCount++;
+          }
+          else if (event.type == SDL_FINGERUP)
+          {
+               f.released = true;
+          }
+          SDL_AtomicUnlock(&batch.lock);
+     }
+
+     // Called under the lock: publish the table as this drain's snapshot
+     // and start the next frame from it
+     void snapshotTouches(EventBatch &batch)
+     {
+          const Uint64 now = SDL_GetPerformanceCounter();
+          const float seconds = batch.touchDrainCounter != 0
+                                     ? (float)((double)(now - batch.touchDrainCounter) / SDL_GetPerformanceFrequency())
+                                     : 0.0f;
+          batch.touchDrainCounter = now;
+          batch.touchFingers.assign(batch.touchLive.begin(), batch.touchLive.end());
+          for (TouchFinger &f : batch.touchFingers)
+          {
+               f.vx = seconds > 0.0f ? (f.x - f.frameX) / seconds : 0.0f;
+               f.vy = seconds > 0.0f ? (f.y - f.frameY) / seconds : 0.0f;
+          }
+
+          size_t kept = 0;
+          for (const TouchFinger &f : batch.touchLive)
+          {
+               if (f.released)
+               {
+                    continue;
+               }
+               TouchFinger &next = batch.touchLive[kept++];
+               next = f;
+               next.dx = next.dy = 0.0f;
+               next.motionCount = 0;
+               next.pressed = false;
+               next.frameX = next.x;
+               next.frameY = next.y;
+          }
+          batch.touchLive.resize(kept);
+     }
+
+     int SDLCALL batchFilter(void *userdata, SDL_Event *event)
+     {
+          EventBatch &batch = *(EventBatch *)userdata;
+          if (queueingPending)
+          {
+               // Our coalesced event; its samples already passed the chained filter
+               SDL_AtomicLock(&batch.lock);
+               batch.motionQueued++;
+               SDL_AtomicUnlock(&batch.lock);
+               return 1;
+          }
+          if (batch.chainedFilter != nullptr && !batch.chainedFilter(batch.chainedUserdata, event))
+          {
+               return 0;
+          }
+          if (batch.batchingSensors && (event->type == SDL_SENSORUPDATE || event->type == SDL_CONTROLLERSENSORUPDATE))
+          {
+               recordSensor(batch, *event);
+               if (batch.droppingSensorEvents)
+               {
+                    return 0;
+               }
+          }
+          if (batch.trackingTouch && event->type >= SDL_FINGERDOWN && event->type <= SDL_FINGERMOTION)
+          {
+               recordTouch(batch, *event);
+          }
+          if (event->type != SDL_MOUSEMOTION || !batch.coalescing)
+          {
+               queuePending(batch);
+               return 1;
+          }
+
+          const SDL_MouseMotionEvent &motion = event->motion;
+          MotionSample sample = {motion.timestamp, motion.windowID, motion.which, motion.state,
+                                 motion.x, motion.y, motion.xrel, motion.yrel};
+          SDL_Event flush;
+          bool hasFlush = false;
+
+          SDL_AtomicLock(&batch.lock);
+          if ((int)batch.history.size() >= MAX_MOTION_HISTORY)
+          {
+               batch.history.erase(batch.history.begin(), batch.history.begin() + MAX_MOTION_HISTORY / 2);
+          }
+          batch.history.push_back(sample);
+          batch.motionReceived++;
+
+          if (batch.hasPending && sameSource(batch.pending.motion, motion))
+          {
+               // Latest position and buttons, summed deltas
+               Sint32 xrel = batch.pending.motion.xrel + motion.xrel;
+               Sint32 yrel = batch.pending.motion.yrel + motion.yrel;
+               batch.pending = *event;
+               batch.pending.motion.xrel = xrel;
+               batch.pending.motion.yrel = yrel;
+          }
+          else
+          {
+               // Another window or mouse: the older motion goes first
+               flush = batch.pending;
+               hasFlush = batch.hasPending;
+               batch.pending = *event;
+               batch.hasPending = true;
+          }
+          SDL_AtomicUnlock(&batch.lock);
+
+          if (hasFlush)
+          {
+               queueEvent(flush);
+          }
+          return 0;
+     }
+
+     // One filter serves motion coalescing, sensor batching and touch tracking
+     void installFilter(EventBatch &batch)
+     {
+          const bool install = batch.coalescing || batch.batchingSensors || batch.trackingTouch;
+          if (install == batch.filtering)
+          {
+               return;
+          }
+          if (install)
+          {
+               if (!SDL_GetEventFilter(&batch.chainedFilter, &batch.chainedUserdata))
+               {
+                    batch.chainedFilter = nullptr;
+                    batch.chainedUserdata = nullptr;
+               }
+               SDL_SetEventFilter(batchFilter, &batch);
+          }
+          else
+          {
+               SDL_SetEventFilter(batch.chainedFilter, batch.chainedUserdata);
+               queuePending(batch);
+          }
+          batch.filtering = install;
+     }
+}
+
+void eventBatchInit(EventBatch &batch, int capacity)
+{
+     batch.events.resize(SDL_max(capacity, 16));
+     batch.count = 0;
+     batch.filtering = false;
+     batch.coalescing = false;
+     batch.chainedFilter = nullptr;
+     batch.chainedUserdata = nullptr;
+     batch.lock = 0;
+     batch.hasPending = false;
+     batch.motionReceived = 0;
+     batch.motionQueued = 0;
+     batch.batchingSensors = false;
+     batch.droppingSensorEvents = false;
+     batch.trackingTouch = false;
+     batch.droppingTouchMotion = false;
+     batch.touchDrainCounter = 0;
+}
+
+int eventBatchDrain(EventBatch &batch, Uint32 minType, Uint32 maxType)
+{
+     batch.count = 0;
+     SDL_PumpEvents();
+     if (batch.filtering)
+     {
+          queuePending(batch);
+          SDL_AtomicLock(&batch.lock);
+          batch.samples.swap(batch.history);
+          batch.history.clear();
+          batch.sensorSamples.swap(batch.sensorHistory);
+          batch.sensorHistory.clear();
+          if (batch.trackingTouch)
+          {
+               snapshotTouches(batch);
+          }
+          const bool dropTouchMotion = batch.droppingTouchMotion;
+          SDL_AtomicUnlock(&batch.lock);
+          // Every one queued is in the table already, and watches have seen it
+          if (dropTouchMotion)
+          {
+               SDL_FlushEvent(SDL_FINGERMOTION);
+          }
+     }
+     for (;;)
+     {
+          int space = (int)batch.events.size() - batch.count;
+          int got = SDL_PeepEvents(&batch.events[batch.count], space, SDL_GETEVENT, minType, maxType);
+          if (got < 0)
+          {
+               break;
+          }
+          batch.count += got;
+          if (got < space || (int)batch.events.size() >= MAX_BATCH_CAPACITY)
+          {
+               break;
+          }
+          // Came back full, so there may be more: grow and keep draining
+          batch.events.resize(SDL_min(batch.events.size() * 2, (size_t)MAX_BATCH_CAPACITY));
+     }
+     return batch.count;
+}
+
+void eventBatchCoalesceMotion(EventBatch &batch)
+{
+     // Walk backwards so the newest motion per (window, mouse) is the one
+     // kept; older ones add their deltas to it and are dropped
+     struct Kept
+     {
+          Uint32 windowID;
+          Uint32 which;
+          int index;
+     };
+     Kept kept[8];
+     int keptCount = 0;
+     bool dropped = false;
+
+     for (int i = batch.count - 1; i >= 0; i--)
+     {
+          const SDL_Event &event = batch.events[i];
+          if (event.type != SDL_MOUSEMOTION)
+          {
+               continue;
+          }
+          int k = 0;
+          while (k < keptCount && (kept[k].windowID != event.motion.windowID || kept[k].which != event.motion.which))
+          {
+               k++;
+          }
+          if (k == keptCount)
+          {
+               if (keptCount < (int)SDL_arraysize(kept))
+               {
+                    kept[keptCount++] = {event.motion.windowID, event.motion.which, i};
+               }
+               continue;
+          }
+
+          SDL_MouseMotionEvent &newest = batch.events[kept[k].index].motion;
+          newest.xrel += event.motion.xrel;
+          newest.yrel += event.motion.yrel;
+          // SDL_FIRSTEVENT is never a real event type, so it marks the hole
+          batch.events[i].type = SDL_FIRSTEVENT;
+          dropped = true;
+     }
+     if (!dropped)
+     {
+          return;
+     }
+
+     int out = 0;
+     for (int i = 0; i < batch.count; i++)
+     {
+          if (batch.events[i].type != SDL_FIRSTEVENT)
+          {
+               batch.events[out++] = batch.events[i];
+          }
+     }
+     batch.count = out;
+}
+
+const SDL_Event *eventBatchNext(const EventBatch &batch, int &cursor, Uint32 minType, Uint32 maxType)
+{
+     while (cursor < batch.count)
+     {
+          const SDL_Event &event = batch.events[cursor++];
+          if (event.type >= minType && event.type <= maxType)
+          {
+               return &event;
+          }
+     }
+     return nullptr;
+}
+
+void eventBatchSetMotionFilter(EventBatch &batch, bool enable)
+{
+     if (enable == batch.coalescing)
+     {
+          return;
+     }
+     if (enable)
+     {
+          batch.motionReceived = 0;
+          batch.motionQueued = 0;
+     }
+     SDL_AtomicLock(&batch.lock);
+     batch.coalescing = enable;
+     SDL_AtomicUnlock(&batch.lock);
+     if (!enable)
+     {
+          queuePending(batch);
+     }
+     installFilter(batch);
+}
+
+const std::vector<MotionSample> &eventBatchMotionHistory(const EventBatch &batch)
+{
+     return batch.samples;
+}
+
+void eventBatchSetSensorBatching(EventBatch &batch, bool enable, bool dropEvents)
+{
+     SDL_AtomicLock(&batch.lock);
+     batch.batchingSensors = enable;
+     batch.droppingSensorEvents = enable && dropEvents;
+     if (!enable)
+     {
+          batch.sensorHistory.clear();
+     }
+     SDL_AtomicUnlock(&batch.lock);
+     installFilter(batch);
+}
+
+const std::vector<SensorSample> &eventBatchSensorSamples(const EventBatch &batch)
+{
+     return batch.sensorSamples;
+}
+
+void eventBatchSetTouchTracking(EventBatch &batch, bool enable, bool dropMotion)
+{
+     SDL_AtomicLock(&batch.lock);
+     batch.trackingTouch = enable;
+     batch.droppingTouchMotion = enable && dropMotion;
+     if (!enable)
+     {
+          batch.touchLive.clear();
+          batch.touchFingers.clear();
+          batch.touchDrainCounter = 0;
+     }
+     SDL_AtomicUnlock(&batch.lock);
+     installFilter(batch);
+}
+
+const std::vector<TouchFinger> &eventBatchTouches(const EventBatch &batch)
+{
+     return batch.touchFingers;
+}
@@ -0,0 +1,173 @@
+// Description:
+// Batched event draining. SDL_PollEvent pumps the OS message queue, takes
+// SDL's event lock and copies one SDL_Event per call; eventBatchDrain()
+// pumps once and moves the whole backlog into a reusable array with
+// SDL_PeepEvents, one lock acquisition per array fill. The array grows when
+// a fill comes back full, so a flood is drained in the same frame.
+//
+// eventBatchCoalesceMotion() folds a high-polling-rate mouse's motion
+// events into one per mouse and window, summing the relative motion, and
+// eventBatchNext() walks a type-filtered view (keys only, motion only, ...)
+// without copying.
+//
+// With MOTION_COALESCE_HINT set, eventBatchSetMotionFilter() goes further
+// and coalesces before events reach SDL's queue: an event filter absorbs
+// each SDL_MOUSEMOTION into one pending event and queues it only when a
+// different event (or motion from another window or mouse) arrives, or at
+// the next drain. Consecutive motion therefore costs one queue slot, order
+// against clicks and keys is kept, and every raw sample is still recorded
+// for eventBatchMotionHistory().
+//
+// Gyroscopes and accelerometers report at the device rate, often 200 to
+// 1000 Hz, as one SDL_SENSORUPDATE or SDL_CONTROLLERSENSORUPDATE event per
+// sample. eventBatchSetSensorBatching() records every sample in the same
+// filter, with the hardware's microsecond timestamp, and
+// eventBatchSensorSamples() returns all of them since the last drain as
+// one array, so motion controls integrate a frame's samples in one pass.
+// Asked to, the filter also drops the per-sample events, which then no
+// longer fill SDL's queue or cost a copy each in eventBatchDrain().
+//
+// Ten fingers on a 240 Hz touch screen send some 2400 SDL_FINGERMOTION
+// events a second. eventBatchSetTouchTracking() keeps a table of the
+// fingers down in the same filter, and each drain turns it into a
+// snapshot: every finger down during the frame, with its latest position,
+// the distance it moved and its velocity since the previous drain, and
+// whether it went down or lifted in between. Gameplay reads
+// eventBatchTouches() in one pass. Asked to, each drain also flushes the
+// motion events from SDL's queue (SDL_FINGERDOWN and SDL_FINGERUP stay),
+// so they cost no copy and never reach input recording. They are dropped
+// there rather than in the filter because SDL runs event watches only for
+// what the filter lets through, and a gesture watch needs every sample.
+// =============================================================================
+
+#ifndef EVENT_BATCH_H
+#define EVENT_BATCH_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+// Set to "1" (SDL_SetHint or the environment) to coalesce at the source
+#define MOTION_COALESCE_HINT "CATCH_COALESCE_MOUSE_MOTION"
+
+// One raw SDL_MOUSEMOTION as delivered by the platform
+struct MotionSample
+{
+     Uint32 timestamp;
+     Uint32 windowID;
+     Uint32 which;
+     Uint32 state;
+     Sint32 x, y;
+     Sint32 xrel, yrel;
+};
+
+// One reading from a sensor or a game controller's sensor
+struct SensorSample
+{
+     Uint64 timestampUs; // The hardware's, or the event's milliseconds * 1000
+     Sint32 which;       // Sensor instance id, or joystick instance id
+     Sint32 type;        // SDL_SensorType
+     bool controller;    // From SDL_CONTROLLERSENSORUPDATE
+     float data[6];      // Controllers fill three values
+};
+
+// One finger in a drain's touch snapshot
+struct TouchFinger
+{
+     SDL_TouchID touchId;
+     SDL_FingerID fingerId;
+     Uint32 windowID;
+     float x, y;           // Latest position, 0..1 across the window
+     float pressure;
+     float dx, dy;         // Moved since the previous drain
+     float vx, vy;         // Per second, over the time since the previous drain
+     int motionCount;      // Motion events folded in since the previous drain
+     bool pressed;         // Went down since the previous drain
+     bool released;        // Lifted since; gone from the next snapshot
+     float frameX, frameY; // Where it was at the previous drain
+};
+
+struct EventBatch
+{
+     std::vector<SDL_Event> events; // Capacity; only [0, count) is valid
+     int count;
+
+     // Source coalescing, see eventBatchSetMotionFilter()
+     bool filtering;  // Our event filter is installed
+     bool coalescing; // It coalesces mouse motion
+     SDL_EventFilter chainedFilter; // Filter that was installed before ours
+     void *chainedUserdata;
+     SDL_SpinLock lock; // Guards pending and history: filters run on any pushing thread
+     bool hasPending;
+     SDL_Event pending;
+     std::vector<MotionSample> history; // Recorded since the last drain
+     std::vector<MotionSample> samples; // Previous drain's history, read by the game
+     int motionReceived; // Raw motion events seen by the filter since it was installed
+     int motionQueued;   // Coalesced events it let into SDL's queue
+
+     // Sensor batching, see eventBatchSetSensorBatching(); guarded by lock
+     bool batchingSensors;
+     bool droppingSensorEvents;
+     std::vector<SensorSample> sensorHistory; // Recorded since the last drain
+     std::vector<SensorSample> sensorSamples; // Previous drain's history
+
+     // Touch tracking, see eventBatchSetTouchTracking(); guarded by lock
+     bool trackingTouch;
+     bool droppingTouchMotion;
+     std::vector<TouchFinger> touchLive;    // Updated by the filter
+     std::vector<TouchFinger> touchFingers; // Snapshot at the last drain
+     Uint64 touchDrainCounter;              // SDL_GetPerformanceCounter() then
+};
+
+// Raw samples kept per frame; older ones are dropped if nobody drains
+const int MAX_MOTION_HISTORY = 8192;
+const int MAX_SENSOR_HISTORY = 8192;
+
+// Common views for eventBatchNext()
+const Uint32 EVENT_VIEW_KEYS_MIN = SDL_KEYDOWN;
+const Uint32 EVENT_VIEW_KEYS_MAX = SDL_KEYUP;
+const Uint32 EVENT_VIEW_MOUSE_MIN = SDL_MOUSEMOTION;
+const Uint32 EVENT_VIEW_MOUSE_MAX = SDL_MOUSEWHEEL;
+
+void eventBatchInit(EventBatch &batch, int capacity);
+
+// Pump once and replace the batch with every queued event whose type is in
+// [minType, maxType], in arrival order. Returns the event count. With the
+// motion filter on, pending motion is queued first and the raw history
+// recorded since the last drain moves to `samples`; sensor samples move
+// the same way.
+int eventBatchDrain(EventBatch &batch, Uint32 minType = SDL_FIRSTEVENT, Uint32 maxType = SDL_LASTEVENT);
+
+// Keep only the last SDL_MOUSEMOTION per (window, mouse), carrying the
+// summed xrel/yrel; everything else keeps its order
+void eventBatchCoalesceMotion(EventBatch &batch);
+
+// Advance `cursor` (start at 0) to the next event in [minType, maxType];
+// returns nullptr at the end
+const SDL_Event *eventBatchNext(const EventBatch &batch, int &cursor, Uint32 minType, Uint32 maxType);
+
+// Install (or remove) the source-coalescing event filter; the filter that
+// was there before keeps running ahead of ours. SDL_SetEventFilter drops
+// events already queued, so install it at startup. One batch at a time.
+void eventBatchSetMotionFilter(EventBatch &batch, bool enable);
+
+// Every motion sample delivered before the last drain, oldest first
+const std::vector<MotionSample> &eventBatchMotionHistory(const EventBatch &batch);
+
+// Record every sensor sample for eventBatchSensorSamples(), and with
+// `dropEvents` keep the sensor update events out of SDL's queue. Shares
+// the motion filter's event filter, with the same caveats
+void eventBatchSetSensorBatching(EventBatch &batch, bool enable, bool dropEvents = false);
+
+// Every sensor sample delivered before the last drain, oldest first
+const std::vector<SensorSample> &eventBatchSensorSamples(const EventBatch &batch);
+
+// Track fingers for eventBatchTouches(), and with `dropMotion` flush
+// SDL_FINGERMOTION from SDL's queue at each drain. Shares the motion filter's event
+// filter, with the same caveats
+void eventBatchSetTouchTracking(EventBatch &batch, bool enable, bool dropMotion = false);
+
+// Every finger down at some point before the last drain, in the order
+// they went down
+const std::vector<TouchFinger> &eventBatchTouches(const EventBatch &batch);
+
+#endif // EVENT_BATCH_H
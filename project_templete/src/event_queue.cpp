@@ -0,0 +1,101 @@
+#include "event_queue.h"
+
+#include "atomic_ops.h"
+
+void eventQueueInit(EventQueue &queue, int capacity)
+{
+     Uint32 size = 1;
+     while (size < (Uint32)SDL_max(capacity, 2))
+     {
+          size <<= 1;
+     }
+     queue.entries.resize(size);
+     queue.mask = size - 1;
+     for (Uint32 i = 0; i < size; i++)
+     {
+          SDL_AtomicSet(&queue.entries[i].sequence, (int)i);
+     }
+     SDL_AtomicSet(&queue.enqueuePos, 0);
+     SDL_AtomicSet(&queue.dequeuePos, 0);
+     SDL_AtomicSet(&queue.dropped, 0);
+}
+
+bool eventQueuePost(EventQueue &queue, const SDL_Event &event)
+{
+     // The slot's sequence carries the ordering: acquire it before touching
+     // the slot, release it after; the position itself only needs the CAS
+     Uint32 position = (Uint32)atomicLoad(&queue.enqueuePos, ATOMIC_ORDER_RELAXED);
+     for (;;)
+     {
+          EventQueueEntry &entry = queue.entries[position & queue.mask];
+          int delta = (int)((Uint32)atomicLoad(&entry.sequence, ATOMIC_ORDER_ACQUIRE) - position);
+          if (delta == 0)
+          {
+               // The slot is free for this lap; claim it
+               int expected = (int)position;
+               if (atomicCAS(&queue.enqueuePos, expected, (int)(position + 1), ATOMIC_ORDER_RELAXED))
+               {
+                    entry.event = event;
+                    entry.counter = SDL_GetPerformanceCounter();
+                    atomicStore(&entry.sequence, (int)(position + 1), ATOMIC_ORDER_RELEASE);
+                    return true;
+               }
+               position = (Uint32)expected;
+          }
+          else if (delta < 0)
+          {
+               // Still holds last lap's event: full
+               SDL_AtomicIncRef(&queue.dropped);
+               return false;
+          }
+          else
+          {
+               // Another producer got here first
+               position = (Uint32)atomicLoad(&queue.enqueuePos, ATOMIC_ORDER_RELAXED);
+          }
+     }
+}
+
+bool eventQueuePoll(EventQueue &queue, SDL_Event *event, Uint64 *counter)
+{
+     Uint32 position = (Uint32)atomicLoad(&queue.dequeuePos, ATOMIC_ORDER_RELAXED);
+     for (;;)
+     {
+          EventQueueEntry &entry = queue.entries[position & queue.mask];
+          int delta = (int)((Uint32)atomicLoad(&entry.sequence, ATOMIC_ORDER_ACQUIRE) - (position + 1));
+          if (delta == 0)
+          {
+               int expected = (int)position;
+               if (atomicCAS(&queue.dequeuePos, expected, (int)(position + 1), ATOMIC_ORDER_RELAXED))
+               {
+                    *event = entry.event;
+                    if (counter)
+                    {
+                         *counter = entry.counter;
+                    }
+                    atomicStore(&entry.sequence, (int)(position + queue.mask + 1), ATOMIC_ORDER_RELEASE);
+                    return true;
+               }
+               position = (Uint32)expected;
+          }
+          else if (delta < 0)
+          {
+               // Not filled yet: empty
+               return false;
+          }
+          else
+          {
+               position = (Uint32)atomicLoad(&queue.dequeuePos, ATOMIC_ORDER_RELAXED);
+          }
+     }
+}
+
+int eventQueuePeep(EventQueue &queue, SDL_Event *events, int count)
+{
+     int stored = 0;
+     while (stored < count && eventQueuePoll(queue, &events[stored]))
+     {
+          stored++;
+     }
+     return stored;
+}
@@ -0,0 +1,58 @@
+// Description:
+// Bounded lock-free multi-producer multi-consumer SDL_Event queue, the
+// sequence-numbered ring prototyped in SDL's test/testatomic.c
+// (EnqueueEvent_LockFree / DequeueEvent_LockFree). Worker threads post
+// events here instead of calling SDL_PushEvent, which takes SDL's global
+// event mutex on every call; the main loop drains it next to
+// SDL_PollEvent. Each slot carries a sequence number that tells producers
+// and consumers whether it is free or filled, so a push or pop is one CAS
+// on the shared position plus one store to the slot.
+//
+// Posting fails instead of blocking when the queue is full; callers retry
+// or drop the event. Every entry is stamped with SDL_GetPerformanceCounter()
+// as it is posted, for consumers that need finer time than the event's
+// millisecond timestamp.
+// =============================================================================
+
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct EventQueueEntry
+{
+     SDL_atomic_t sequence;
+     Uint64 counter; // SDL_GetPerformanceCounter() when posted
+     SDL_Event event;
+};
+
+struct EventQueue
+{
+     std::vector<EventQueueEntry> entries;
+     Uint32 mask; // entries.size() - 1
+
+     // Producers and consumers each hammer one position; keep them apart
+     SDL_atomic_t enqueuePos;
+     char enqueuePadding[SDL_CACHELINE_SIZE - sizeof(SDL_atomic_t)];
+     SDL_atomic_t dequeuePos;
+     char dequeuePadding[SDL_CACHELINE_SIZE - sizeof(SDL_atomic_t)];
+
+     SDL_atomic_t dropped; // Events rejected by eventQueuePost while full
+};
+
+// `capacity` is rounded up to a power of two
+void eventQueueInit(EventQueue &queue, int capacity);
+
+// Any thread. Returns false (and counts a drop) when the queue is full.
+bool eventQueuePost(EventQueue &queue, const SDL_Event &event);
+
+// Any thread. Returns false when the queue is empty. `counter` receives
+// the post's performance counter
+bool eventQueuePoll(EventQueue &queue, SDL_Event *event, Uint64 *counter = nullptr);
+
+// Dequeue up to `count` events, like SDL_PeepEvents(SDL_GETEVENT);
+// returns how many were stored
+int eventQueuePeep(EventQueue &queue, SDL_Event *events, int count);
+
+#endif // EVENT_QUEUE_H
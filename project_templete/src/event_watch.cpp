@@ -0,0 +1,266 @@
+#include "event_watch.h"
+
+#include <vector>
+
+namespace
+{
+     const int TYPE_PAGES = 256; // Event types are 16 bits; SDL groups them by the high byte
+
+     struct WatchEntry
+     {
+          SDL_EventFilter callback;
+          void *userdata;
+          const char *name;
+          std::vector<EventTypeRange> ranges;
+          bool removed; // Deleted during a dispatch; dropped once it ends
+          EventWatchStats stats;
+     };
+
+     struct WatchHub
+     {
+          SDL_mutex *lock; // Recursive, so callbacks may push events and edit watches
+          bool installed;  // Guarded by watchHubCreate
+          int dispatching; // Nesting depth of dispatchWatches on the locked thread
+          bool hasRemoved;
+          bool timing;
+          std::vector<WatchEntry> entries;
+          Uint64 events;
+
+          // Bit i: entries[i] wants every type of the page, or only some of
+          // them and needs its ranges checked
+          Uint64 wholePage[TYPE_PAGES];
+          Uint64 partPage[TYPE_PAGES];
+     };
+
+     WatchHub watchHub = {nullptr, false, 0, false, true, {}, 0, {}, {}};
+     SDL_SpinLock watchHubCreate = 0;
+
+     void rebuildPages(WatchHub &hub)
+     {
+          SDL_zeroa(hub.wholePage);
+          SDL_zeroa(hub.partPage);
+          for (size_t i = 0; i < hub.entries.size(); i++)
+          {
+               const Uint64 bit = (Uint64)1 << i;
+               for (const EventTypeRange &range : hub.entries[i].ranges)
+               {
+                    const Uint32 last = SDL_min(range.last, (Uint32)SDL_LASTEVENT);
+                    for (Uint32 page = range.first >> 8; range.first <= last && page <= last >> 8; page++)
+                    {
+                         const bool whole = range.first <= page << 8 && last >= (page << 8 | 0xFF);
+                         if (whole)
+                         {
+                              hub.wholePage[page] |= bit;
+                         }
+                         else
+                         {
+                              hub.partPage[page] |= bit;
+                         }
+                    }
+               }
+          }
+          // A page wanted whole through one range needs no range check
+          for (int page = 0; page < TYPE_PAGES; page++)
+          {
+               hub.partPage[page] &= ~hub.wholePage[page];
+          }
+     }
+
+     void dropRemoved(WatchHub &hub)
+     {
+          size_t kept = 0;
+          for (size_t i = 0; i < hub.entries.size(); i++)
+          {
+               if (!hub.entries[i].removed)
+               {
+                    if (kept != i)
+                    {
+                         hub.entries[kept] = hub.entries[i];
+                    }
+                    kept++;
+               }
+          }
+          hub.entries.resize(kept);
+          hub.hasRemoved = false;
+          rebuildPages(hub);
+     }
+
+     bool watchWants(const WatchEntry &entry, Uint32 type)
+     {
+          for (const EventTypeRange &range : entry.ranges)
+          {
+               if (type >= range.first && type <= range.last)
+               {
+                    return true;
+               }
+          }
+          return false;
+     }
+
+     int SDLCALL dispatchWatches(void *, SDL_Event *event)
+     {
+          WatchHub &hub = watchHub;
+          SDL_LockMutex(hub.lock);
+          hub.events++;
+          const Uint32 type = event->type;
+          const Uint32 page = (type >> 8) & (TYPE_PAGES - 1);
+          const Uint64 part = hub.partPage[page];
+          Uint64 candidates = hub.wholePage[page] | part;
+          hub.dispatching++;
+          while (candidates != 0)
+          {
+               const int index = __builtin_ctzll(candidates);
+               const Uint64 bit = (Uint64)1 << index;
+               candidates &= candidates - 1;
+               // The list only grows at the end while dispatching, so index stays put
+               WatchEntry &entry = hub.entries[index];
+               if (entry.removed || ((part & bit) != 0 && !watchWants(entry, type)))
+               {
+                    continue;
+               }
+               if (!hub.timing)
+               {
+                    entry.stats.calls++;
+                    entry.callback(entry.userdata, event);
+                    continue;
+               }
+               const Uint64 start = SDL_GetPerformanceCounter();
+               entry.callback(entry.userdata, event);
+               const Uint64 spent = SDL_GetPerformanceCounter() - start;
+               // The callback may have added watches and moved the list
+               WatchEntry &after = hub.entries[index];
+               after.stats.calls++;
+               after.stats.counter += spent;
+               after.stats.maxCounter = SDL_max(after.stats.maxCounter, spent);
+          }
+          hub.dispatching--;
+          if (hub.dispatching == 0 && hub.hasRemoved)
+          {
+               dropRemoved(hub);
+          }
+          SDL_UnlockMutex(hub.lock);
+          return 1;
+     }
+}
+
+bool eventWatchAdd(SDL_EventFilter callback, void *userdata, const char *name, const EventTypeRange *ranges,
+                   int rangeCount)
+{
+     WatchHub &hub = watchHub;
+     // SDL holds its watch lock while dispatching, which takes ours: never
+     // call into SDL's watch list with ours held
+     SDL_AtomicLock(&watchHubCreate);
+     if (hub.lock == nullptr)
+     {
+          hub.lock = SDL_CreateMutex();
+     }
+     if (hub.lock != nullptr && !hub.installed)
+     {
+          SDL_AddEventWatch(dispatchWatches, nullptr);
+          hub.installed = true;
+     }
+     SDL_AtomicUnlock(&watchHubCreate);
+     if (hub.lock == nullptr)
+     {
+          return false;
+     }
+
+     SDL_LockMutex(hub.lock);
+     if (hub.entries.size() >= EVENT_WATCH_MAX)
+     {
+          SDL_UnlockMutex(hub.lock);
+          SDL_SetError("Too many event watches (%d)", EVENT_WATCH_MAX);
+          return false;
+     }
+     WatchEntry entry;
+     entry.callback = callback;
+     entry.userdata = userdata;
+     entry.name = name;
+     entry.ranges.assign(ranges, ranges + SDL_max(rangeCount, 0));
+     entry.removed = false;
+     SDL_zero(entry.stats);
+     entry.stats.name = name;
+     hub.entries.push_back(entry);
+     rebuildPages(hub);
+     SDL_UnlockMutex(hub.lock);
+     return true;
+}
+
+void eventWatchDel(SDL_EventFilter callback, void *userdata)
+{
+     WatchHub &hub = watchHub;
+     if (hub.lock == nullptr)
+     {
+          return;
+     }
+     SDL_LockMutex(hub.lock);
+     for (WatchEntry &entry : hub.entries)
+     {
+          if (entry.callback == callback && entry.userdata == userdata && !entry.removed)
+          {
+               entry.removed = true;
+               hub.hasRemoved = true;
+               break;
+          }
+     }
+     if (hub.dispatching == 0 && hub.hasRemoved)
+     {
+          dropRemoved(hub);
+     }
+     SDL_UnlockMutex(hub.lock);
+}
+
+int eventWatchStats(EventWatchStats *stats, int count, Uint64 *events)
+{
+     WatchHub &hub = watchHub;
+     if (hub.lock == nullptr)
+     {
+          if (events != nullptr)
+          {
+               *events = 0;
+          }
+          return 0;
+     }
+     SDL_LockMutex(hub.lock);
+     int watches = 0;
+     for (const WatchEntry &entry : hub.entries)
+     {
+          if (!entry.removed)
+          {
+               if (watches < count)
+               {
+                    stats[watches] = entry.stats;
+               }
+               watches++;
+          }
+     }
+     if (events != nullptr)
+     {
+          *events = hub.events;
+     }
+     SDL_UnlockMutex(hub.lock);
+     return watches;
+}
+
+void eventWatchResetStats()
+{
+     WatchHub &hub = watchHub;
+     if (hub.lock == nullptr)
+     {
+          return;
+     }
+     SDL_LockMutex(hub.lock);
+     for (WatchEntry &entry : hub.entries)
+     {
+          entry.stats.calls = 0;
+          entry.stats.counter = 0;
+          entry.stats.maxCounter = 0;
+     }
+     hub.events = 0;
+     SDL_UnlockMutex(hub.lock);
+}
+
+void eventWatchSetTiming(bool enable)
+{
+     watchHub.timing = enable;
+}
@@ -0,0 +1,68 @@
+// Description:
+// Event watches that name the event types they want. SDL calls every
+// SDL_AddEventWatch callback for every event pushed, so a UI watch, a
+// telemetry watch and an input recorder each pay a call (and usually a
+// switch that returns at once) for each of a 1 kHz mouse's motion events.
+// eventWatchAdd() takes the callback with a list of type ranges instead;
+// one SDL watch serves them all and finds the interested ones through a
+// table indexed by the type's high byte (SDL's event categories: window,
+// key, mouse, ...), so a watcher that does not want an event costs
+// nothing for it.
+//
+// Every callback is timed with SDL_GetPerformanceCounter(), and
+// eventWatchStats() returns calls, total and worst time per watcher, to
+// find the watch that stalls whichever thread pushes the events; the two
+// counter reads cost more than a trivial callback, so shipping builds can
+// switch them off with eventWatchSetTiming(). Callbacks
+// run on that thread, as with SDL, in the order they were added; they may
+// push events and add or remove watches, themselves included. SDL_Quit
+// drops the shared watch with SDL's own, so a program that restarts SDL
+// cannot keep its watches across the restart.
+// =============================================================================
+
+#ifndef EVENT_WATCH_H
+#define EVENT_WATCH_H
+
+#include <SDL2/SDL.h>
+
+#define EVENT_WATCH_MAX 64
+
+// Event types first through last, inclusive
+struct EventTypeRange
+{
+     Uint32 first;
+     Uint32 last;
+};
+
+// Every event type, as SDL_AddEventWatch would
+const EventTypeRange EVENT_TYPES_ALL = {SDL_FIRSTEVENT, SDL_LASTEVENT};
+
+struct EventWatchStats
+{
+     const char *name;
+     Uint64 calls;
+     Uint64 counter;    // Performance counter ticks spent in the callback
+     Uint64 maxCounter; // Longest single call
+};
+
+// Call `callback` for every pushed event whose type lies in one of the
+// ranges; its return value is ignored, as SDL's is. `name` labels the
+// statistics and must outlive the watch. Returns false with SDL's error
+// set when EVENT_WATCH_MAX watches exist
+bool eventWatchAdd(SDL_EventFilter callback, void *userdata, const char *name, const EventTypeRange *ranges,
+                   int rangeCount);
+
+// Remove the watch added with this callback and userdata
+void eventWatchDel(SDL_EventFilter callback, void *userdata);
+
+// Copy up to `count` watches' statistics, in the order they were added,
+// and return how many watches there are. `events` receives the number of
+// events dispatched, watched or not
+int eventWatchStats(EventWatchStats *stats, int count, Uint64 *events = nullptr);
+
+void eventWatchResetStats();
+
+// Time the callbacks (the default), or only count their calls
+void eventWatchSetTiming(bool enable);
+
+#endif // EVENT_WATCH_H
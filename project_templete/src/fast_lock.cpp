@@ -0,0 +1,252 @@
+#include "fast_lock.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FAST_LOCK_PAUSE() _mm_pause()
+#elif defined(__aarch64__)
+#define FAST_LOCK_PAUSE() __asm__ __volatile__("yield")
+#else
+#define FAST_LOCK_PAUSE() ((void)0)
+#endif
+
+namespace
+{
+     // A critical section of a few hundred cycles finishes within this
+     const int SPIN_LIMIT = 100;
+
+     const int WRITER_BIT = 1 << 29;
+     const int SLEEPERS_BIT = 1 << 30;
+     const int READER_MASK = WRITER_BIT - 1;
+
+#if defined(_WIN32)
+     typedef BOOL(WINAPI *WaitOnAddressFunction)(volatile VOID *, PVOID, SIZE_T, DWORD);
+     typedef VOID(WINAPI *WakeByAddressFunction)(PVOID);
+
+     struct AddressWait
+     {
+          WaitOnAddressFunction wait;
+          WakeByAddressFunction wakeOne;
+          WakeByAddressFunction wakeAll;
+     };
+
+     // Windows 8 and later; kernelbase exports the API set
+     const AddressWait &addressWait()
+     {
+          static const AddressWait functions = []
+          {
+               AddressWait found = {nullptr, nullptr, nullptr};
+               HMODULE module = GetModuleHandleW(L"api-ms-win-core-synch-l1-2-0.dll");
+               if (module == nullptr)
+               {
+                    module = LoadLibraryW(L"api-ms-win-core-synch-l1-2-0.dll");
+               }
+               if (module != nullptr)
+               {
+                    found.wait = (WaitOnAddressFunction)(void *)GetProcAddress(module, "WaitOnAddress");
+                    found.wakeOne = (WakeByAddressFunction)(void *)GetProcAddress(module, "WakeByAddressSingle");
+                    found.wakeAll = (WakeByAddressFunction)(void *)GetProcAddress(module, "WakeByAddressAll");
+               }
+               if (found.wait == nullptr || found.wakeOne == nullptr || found.wakeAll == nullptr)
+               {
+                    found = {nullptr, nullptr, nullptr};
+               }
+               return found;
+          }();
+          return functions;
+     }
+#endif
+
+     // Sleep while `word` still holds `expected`; may return early
+     void waitWhile(SDL_atomic_t &word, int expected)
+     {
+#if defined(_WIN32)
+          if (addressWait().wait != nullptr)
+          {
+               addressWait().wait(&word.value, &expected, sizeof(int), INFINITE);
+               return;
+          }
+#elif defined(__linux__)
+          syscall(SYS_futex, &word.value, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+          return;
+#endif
+          (void)word;
+          (void)expected;
+          SDL_Delay(0);
+     }
+
+     void wake(SDL_atomic_t &word, bool all)
+     {
+#if defined(_WIN32)
+          if (addressWait().wait != nullptr)
+          {
+               (all ? addressWait().wakeAll : addressWait().wakeOne)(&word.value);
+          }
+#elif defined(__linux__)
+          syscall(SYS_futex, &word.value, FUTEX_WAKE_PRIVATE, all ? SDL_MAX_SINT32 : 1, nullptr, nullptr, 0);
+#else
+          (void)word;
+          (void)all;
+#endif
+     }
+
+     bool tryRead(RWLock &lock, int state)
+     {
+          return (state & WRITER_BIT) == 0 && SDL_AtomicGet(&lock.writersWaiting) == 0 &&
+                 SDL_AtomicCAS(&lock.state, state, state + 1);
+     }
+
+     bool tryWrite(RWLock &lock, int state)
+     {
+          return (state & (WRITER_BIT | READER_MASK)) == 0 && SDL_AtomicCAS(&lock.state, state, state | WRITER_BIT);
+     }
+
+     // Mark the word as having sleepers and sleep on it, unless it changed
+     void sleepOn(RWLock &lock, int state)
+     {
+          if ((state & SLEEPERS_BIT) != 0 || SDL_AtomicCAS(&lock.state, state, state | SLEEPERS_BIT))
+          {
+               waitWhile(lock.state, state | SLEEPERS_BIT);
+          }
+     }
+}
+
+void fastMutexInit(FastMutex &mutex)
+{
+     SDL_AtomicSet(&mutex.state, 0);
+}
+
+bool fastMutexTryLock(FastMutex &mutex)
+{
+     return SDL_AtomicCAS(&mutex.state, 0, 1);
+}
+
+void fastMutexLock(FastMutex &mutex)
+{
+     if (SDL_AtomicCAS(&mutex.state, 0, 1))
+     {
+          return;
+     }
+     for (int spin = 0; spin < SPIN_LIMIT; spin++)
+     {
+          FAST_LOCK_PAUSE();
+          if (SDL_AtomicGet(&mutex.state) == 0 && SDL_AtomicCAS(&mutex.state, 0, 1))
+          {
+               return;
+          }
+     }
+     // Taking it as 2 makes the eventual unlock wake the next sleeper
+     while (SDL_AtomicSet(&mutex.state, 2) != 0)
+     {
+          waitWhile(mutex.state, 2);
+     }
+}
+
+void fastMutexUnlock(FastMutex &mutex)
+{
+     // SDL_AtomicSet is __sync_lock_test_and_set on GCC and Clang, only an
+     // acquire barrier; without this, stores from inside the lock could
+     // become visible after the next owner takes it
+     SDL_MemoryBarrierRelease();
+     if (SDL_AtomicSet(&mutex.state, 0) == 2)
+     {
+          wake(mutex.state, false);
+     }
+}
+
+void rwLockInit(RWLock &lock)
+{
+     SDL_AtomicSet(&lock.state, 0);
+     SDL_AtomicSet(&lock.writersWaiting, 0);
+}
+
+bool rwLockTryReadLock(RWLock &lock)
+{
+     return tryRead(lock, SDL_AtomicGet(&lock.state));
+}
+
+void rwLockReadLock(RWLock &lock)
+{
+     int spin = 0;
+     for (;;)
+     {
+          const int state = SDL_AtomicGet(&lock.state);
+          if (tryRead(lock, state))
+          {
+               return;
+          }
+          if (spin++ < SPIN_LIMIT)
+          {
+               FAST_LOCK_PAUSE();
+               continue;
+          }
+          sleepOn(lock, state);
+     }
+}
+
+void rwLockReadUnlock(RWLock &lock)
+{
+     const int previous = SDL_AtomicAdd(&lock.state, -1);
+     if ((previous & READER_MASK) == 1 && (previous & SLEEPERS_BIT) != 0)
+     {
+          // The last reader out wakes the sleepers, if nobody else did first
+          if (SDL_AtomicCAS(&lock.state, previous - 1, (previous - 1) & ~SLEEPERS_BIT))
+          {
+               wake(lock.state, true);
+          }
+     }
+}
+
+bool rwLockTryWriteLock(RWLock &lock)
+{
+     return tryWrite(lock, SDL_AtomicGet(&lock.state));
+}
+
+void rwLockWriteLock(RWLock &lock)
+{
+     SDL_AtomicIncRef(&lock.writersWaiting);
+     int spin = 0;
+     for (;;)
+     {
+          const int state = SDL_AtomicGet(&lock.state);
+          if (tryWrite(lock, state))
+          {
+               SDL_AtomicAdd(&lock.writersWaiting, -1);
+               return;
+          }
+          if (spin++ < SPIN_LIMIT)
+          {
+               FAST_LOCK_PAUSE();
+               continue;
+          }
+          sleepOn(lock, state);
+     }
+}
+
+void rwLockWriteUnlock(RWLock &lock)
+{
+     SDL_MemoryBarrierRelease(); // As in fastMutexUnlock()
+     if (SDL_AtomicSet(&lock.state, 0) & SLEEPERS_BIT)
+     {
+          wake(lock.state, true);
+     }
+}
+
+bool fastLockHasAddressWait()
+{
+#if defined(_WIN32)
+     return addressWait().wait != nullptr;
+#elif defined(__linux__)
+     return true;
+#else
+     return false;
+#endif
+}
@@ -0,0 +1,54 @@
+// Description:
+// Two locks SDL 2 does not have. Both keep their whole state in one
+// atomic word and handle the uncontended case with a single CAS in user
+// space. They spin briefly when the holder is likely to finish soon, and
+// only then sleep in the kernel on the word itself: futex on Linux,
+// WaitOnAddress on Windows 8 and later, looked up at runtime so older
+// Windows still runs.
+//
+// - FastMutex: Drepper's three-state mutex (unlocked, locked, locked with
+//   sleepers). Unlocking calls into the kernel only when someone sleeps.
+// - RWLock: shared readers or one exclusive writer, for read-mostly data.
+//   Readers only touch the shared word, so they run in parallel instead of
+//   queueing on a mutex. Writers take priority: once one is waiting, new
+//   readers hold back, so a stream of readers cannot starve it.
+//
+// Neither is recursive, and a writer may not also take the lock shared.
+// Where no address wait exists (other platforms, Windows 7) sleepers
+// yield in a loop instead, which is correct but burns CPU under heavy
+// contention.
+// =============================================================================
+
+#ifndef FAST_LOCK_H
+#define FAST_LOCK_H
+
+#include <SDL2/SDL.h>
+
+struct FastMutex
+{
+     SDL_atomic_t state; // 0 unlocked, 1 locked, 2 locked with sleepers
+};
+
+struct RWLock
+{
+     SDL_atomic_t state;          // Reader count, writer bit and sleepers bit
+     SDL_atomic_t writersWaiting; // Writers queued for the lock
+};
+
+void fastMutexInit(FastMutex &mutex);
+void fastMutexLock(FastMutex &mutex);
+bool fastMutexTryLock(FastMutex &mutex);
+void fastMutexUnlock(FastMutex &mutex);
+
+void rwLockInit(RWLock &lock);
+void rwLockReadLock(RWLock &lock);
+bool rwLockTryReadLock(RWLock &lock);
+void rwLockReadUnlock(RWLock &lock);
+void rwLockWriteLock(RWLock &lock);
+bool rwLockTryWriteLock(RWLock &lock);
+void rwLockWriteUnlock(RWLock &lock);
+
+// Whether sleepers wait on the address (futex, WaitOnAddress) or yield
+bool fastLockHasAddressWait();
+
+#endif // FAST_LOCK_H
@@ -0,0 +1,35 @@
+#include "file_commit.h"
+
+#include <filesystem>
+
+bool fileCommit(const std::string &written, const std::string &path, bool complete)
+{
+     std::error_code error;
+     if (!complete)
+     {
+          // The writer's own error says what went wrong
+          std::filesystem::remove(std::filesystem::u8path(written), error);
+          return false;
+     }
+     std::filesystem::rename(std::filesystem::u8path(written), std::filesystem::u8path(path), error);
+     if (error)
+     {
+          SDL_SetError("Unable to replace %s: %s", path.c_str(), error.message().c_str());
+          std::filesystem::remove(std::filesystem::u8path(written), error);
+          return false;
+     }
+     return true;
+}
+
+bool fileReplace(const std::string &path, const void *data, size_t size)
+{
+     const std::string written = path + ".tmp";
+     SDL_RWops *rw = SDL_RWFromFile(written.c_str(), "wb");
+     if (rw == nullptr)
+     {
+          return false;
+     }
+     bool complete = size == 0 || SDL_RWwrite(rw, data, 1, size) == size;
+     complete = SDL_RWclose(rw) == 0 && complete;
+     return fileCommit(written, path, complete);
+}
@@ -0,0 +1,29 @@
+// Description:
+// Whole-file replacement through a temporary file. Caches and records are
+// written under a temporary name beside the real one and renamed into
+// place once the write is complete, so a crash mid-write leaves the old
+// file (or none) and never a truncated one, and a reader never sees a
+// half-written file under the real name.
+//
+// fileReplace() does the whole thing for a buffer already in memory.
+// Writers that stream into the temporary file themselves (texture_cache,
+// several SDL_RWwrite calls) finish with fileCommit(), which renames it
+// into place when the write went through and removes it either way it
+// fails. Paths are UTF-8, as SDL's are.
+// =============================================================================
+
+#ifndef FILE_COMMIT_H
+#define FILE_COMMIT_H
+
+#include <SDL2/SDL.h>
+#include <string>
+
+// Rename `written` over `path` when `complete`; otherwise, or if the
+// rename fails, remove `written`. False on failure, with SDL's error set
+// by the rename or left as the failed write set it
+bool fileCommit(const std::string &written, const std::string &path, bool complete = true);
+
+// Write `size` bytes to "<path>.tmp" and commit them over `path`
+bool fileReplace(const std::string &path, const void *data, size_t size);
+
+#endif // FILE_COMMIT_H
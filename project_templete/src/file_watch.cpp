@@ -0,0 +1,717 @@
+#include "file_watch.h"
+
+#include <cstring>
+#include <map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unordered_map>
+#endif
+#endif
+
+struct FileWatchState
+{
+     // A path's changes since it was last reported
+     struct Pending
+     {
+          bool existedBefore;
+          bool existsNow;
+          Uint64 lastTicks;
+     };
+
+     FileWatch *owner;
+     std::string root; // Without a trailing separator
+     bool recursive;
+     SDL_Thread *thread;
+     std::map<std::string, Pending> pending;
+
+     // Polling backend
+     SDL_sem *stopSignal;
+     std::map<std::string, DirEntry> snapshot;
+
+#ifdef _WIN32
+     HANDLE directory;
+     HANDLE stopEvent;
+     std::vector<DWORD> notifyBuffer; // DWORD-aligned, as ReadDirectoryChangesW requires
+#elif defined(__linux__)
+     int inotifyFd;
+     int stopFd;
+     std::unordered_map<int, std::string> directories; // Watch descriptor -> prefix ("" or "dir/")
+#endif
+};
+
+namespace
+{
+#ifdef _WIN32
+     std::wstring watchWide(const std::string &text)
+     {
+          const int length = MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), nullptr, 0);
+          std::wstring wide(length, L'\0');
+          MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), &wide[0], length);
+          return wide;
+     }
+
+     std::string watchUtf8(const wchar_t *text, int length)
+     {
+          const int size = WideCharToMultiByte(CP_UTF8, 0, text, length, nullptr, 0, nullptr, nullptr);
+          std::string utf8(size, '\0');
+          WideCharToMultiByte(CP_UTF8, 0, text, length, &utf8[0], size, nullptr, nullptr);
+          for (char &c : utf8)
+          {
+               if (c == '\\')
+               {
+                    c = '/';
+               }
+          }
+          return utf8;
+     }
+
+     bool listDirectory(const std::wstring &path, const std::string &prefix, std::vector<DirEntry> &entries,
+                        bool recursive)
+     {
+          // Basic info skips the 8.3 short names; large fetch asks for more entries per system call
+          WIN32_FIND_DATAW data;
+          HANDLE find = FindFirstFileExW((path + L"\\*").c_str(), FindExInfoBasic, &data, FindExSearchNameMatch,
+                                         NULL, FIND_FIRST_EX_LARGE_FETCH);
+          if (find == INVALID_HANDLE_VALUE)
+          {
+               return GetLastError() == ERROR_FILE_NOT_FOUND; // Empty, not even "." (a drive root)
+          }
+          do
+          {
+               const wchar_t *name = data.cFileName;
+               if (name[0] == L'.' && (name[1] == L'\0' || (name[1] == L'.' && name[2] == L'\0')))
+               {
+                    continue;
+               }
+               DirEntry entry;
+               entry.name = prefix + watchUtf8(name, (int)wcslen(name));
+               entry.directory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+               entry.size = entry.directory ? 0 : ((Uint64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+               // FILETIME counts 100 ns steps from 1601
+               const Uint64 filetime = ((Uint64)data.ftLastWriteTime.dwHighDateTime << 32) |
+                                       data.ftLastWriteTime.dwLowDateTime;
+               entry.modified = ((Sint64)filetime - 116444736000000000LL) * 100;
+               entries.push_back(entry);
+               if (entry.directory && recursive && !(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+               {
+                    listDirectory(path + L"\\" + name, entries.back().name + "/", entries, recursive);
+               }
+          } while (FindNextFileW(find, &data));
+          FindClose(find);
+          return true;
+     }
+#else
+     // Takes ownership of `fd`
+     bool listDirectory(int fd, const std::string &prefix, std::vector<DirEntry> &entries, bool recursive)
+     {
+          DIR *dir = fdopendir(fd);
+          if (dir == nullptr)
+          {
+               close(fd);
+               return false;
+          }
+          while (const dirent *found = readdir(dir))
+          {
+               const char *name = found->d_name;
+               if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+               {
+                    continue;
+               }
+               // Relative to the open directory: no path walk per entry
+               struct stat info;
+               if (fstatat(dirfd(dir), name, &info, 0) != 0)
+               {
+                    continue; // Removed meanwhile, or a dangling link
+               }
+               DirEntry entry;
+               entry.name = prefix + name;
+               entry.directory = S_ISDIR(info.st_mode);
+               entry.size = S_ISREG(info.st_mode) ? (Uint64)info.st_size : 0;
+#ifdef __APPLE__
+               entry.modified = (Sint64)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+               entry.modified = (Sint64)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+               entries.push_back(entry);
+               if (entry.directory && recursive)
+               {
+                    // O_NOFOLLOW keeps a link to a parent from looping
+                    const int child = openat(dirfd(dir), name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                    if (child >= 0)
+                    {
+                         listDirectory(child, entries.back().name + "/", entries, recursive);
+                    }
+               }
+          }
+          closedir(dir);
+          return true;
+     }
+#endif
+
+     void pushChange(FileWatchState &state, FileChange change, const std::string &path)
+     {
+          SDL_Event event;
+          SDL_zero(event);
+          event.type = fileWatchEventType();
+          event.user.code = change;
+          event.user.data1 = SDL_strdup(path.c_str());
+          event.user.data2 = state.owner;
+          if (SDL_PushEvent(&event) <= 0)
+          {
+               SDL_free(event.user.data1); // Filtered out, or the queue is full
+          }
+     }
+
+     // Fold a change into the path's pending state
+     void noteChange(FileWatchState &state, FileChange change, const std::string &path)
+     {
+          auto found = state.pending.find(path);
+          if (found == state.pending.end())
+          {
+               FileWatchState::Pending fresh;
+               fresh.existedBefore = change != FILE_ADDED;
+               found = state.pending.emplace(path, fresh).first;
+          }
+          found->second.existsNow = change != FILE_REMOVED;
+          found->second.lastTicks = SDL_GetTicks64();
+     }
+
+     // Report the paths that have settled; returns the milliseconds until
+     // the next one will, or -1 when nothing is pending
+     int flushSettled(FileWatchState &state)
+     {
+          const Uint64 now = SDL_GetTicks64();
+          Uint64 next = ~(Uint64)0;
+          for (auto it = state.pending.begin(); it != state.pending.end();)
+          {
+               const FileWatchState::Pending &change = it->second;
+               const Uint64 due = change.lastTicks + FILE_WATCH_SETTLE_MS;
+               if (due > now)
+               {
+                    next = SDL_min(next, due);
+                    ++it;
+                    continue;
+               }
+               // Came and went within the burst: a temporary file
+               if (change.existedBefore || change.existsNow)
+               {
+                    pushChange(state,
+                               !change.existedBefore ? FILE_ADDED : !change.existsNow ? FILE_REMOVED : FILE_MODIFIED,
+                               it->first);
+               }
+               it = state.pending.erase(it);
+          }
+          return next == ~(Uint64)0 ? -1 : (int)(next - now);
+     }
+
+     void takeSnapshot(FileWatchState &state, std::map<std::string, DirEntry> &snapshot)
+     {
+          std::vector<DirEntry> entries;
+          dirList(state.root.c_str(), entries, state.recursive); // A missing directory lists as empty
+          for (DirEntry &entry : entries)
+          {
+               snapshot.emplace(entry.name, entry);
+          }
+     }
+
+     int SDLCALL watchPollingMain(void *data)
+     {
+          FileWatchState &state = *(FileWatchState *)data;
+          Uint64 nextScan = SDL_GetTicks64() + FILE_WATCH_POLL_MS;
+          for (;;)
+          {
+               const Uint64 now = SDL_GetTicks64();
+               int wait = nextScan > now ? (int)(nextScan - now) : 0;
+               const int settle = flushSettled(state);
+               if (settle >= 0)
+               {
+                    wait = SDL_min(wait, settle);
+               }
+               if (SDL_SemWaitTimeout(state.stopSignal, (Uint32)wait) == 0)
+               {
+                    break;
+               }
+               if (SDL_GetTicks64() < nextScan)
+               {
+                    continue;
+               }
+               nextScan = SDL_GetTicks64() + FILE_WATCH_POLL_MS;
+
+               // Both maps are sorted by name: walk them side by side
+               std::map<std::string, DirEntry> current;
+               takeSnapshot(state, current);
+               auto before = state.snapshot.begin();
+               auto after = current.begin();
+               while (before != state.snapshot.end() || after != current.end())
+               {
+                    if (after == current.end() || (before != state.snapshot.end() && before->first < after->first))
+                    {
+                         noteChange(state, FILE_REMOVED, before->first);
+                         ++before;
+                    }
+                    else if (before == state.snapshot.end() || after->first < before->first)
+                    {
+                         noteChange(state, FILE_ADDED, after->first);
+                         ++after;
+                    }
+                    else
+                    {
+                         const DirEntry &was = before->second, &is = after->second;
+                         if (!is.directory && (was.size != is.size || was.modified != is.modified))
+                         {
+                              noteChange(state, FILE_MODIFIED, is.name);
+                         }
+                         ++before;
+                         ++after;
+                    }
+               }
+               state.snapshot.swap(current);
+          }
+          return 0;
+     }
+
+#ifdef _WIN32
+     bool watchNativeOpen(FileWatchState &state)
+     {
+          state.directory = CreateFileW(watchWide(state.root).c_str(), FILE_LIST_DIRECTORY,
+                                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                                        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+          if (state.directory == INVALID_HANDLE_VALUE)
+          {
+               return false;
+          }
+          state.stopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+          state.notifyBuffer.resize(16384); // 64 KB, the most a network share will fill
+          return true;
+     }
+
+     void watchNativeSignal(FileWatchState &state)
+     {
+          SetEvent(state.stopEvent);
+     }
+
+     void watchNativeClose(FileWatchState &state)
+     {
+          CloseHandle(state.stopEvent);
+          CloseHandle(state.directory);
+     }
+
+     void noteNotifications(FileWatchState &state)
+     {
+          const Uint8 *at = (const Uint8 *)state.notifyBuffer.data();
+          for (;;)
+          {
+               const FILE_NOTIFY_INFORMATION &info = *(const FILE_NOTIFY_INFORMATION *)at;
+               const std::string path = watchUtf8(info.FileName, (int)(info.FileNameLength / sizeof(WCHAR)));
+               switch (info.Action)
+               {
+               case FILE_ACTION_ADDED:
+               case FILE_ACTION_RENAMED_NEW_NAME:
+                    noteChange(state, FILE_ADDED, path);
+                    break;
+               case FILE_ACTION_REMOVED:
+               case FILE_ACTION_RENAMED_OLD_NAME:
+                    noteChange(state, FILE_REMOVED, path);
+                    break;
+               default:
+               {
+                    // Directories report this too when their contents change,
+                    // which the entries inside already did; the poller and
+                    // inotify only report files
+                    const DWORD attributes = GetFileAttributesW(watchWide(state.root + "/" + path).c_str());
+                    if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+                    {
+                         noteChange(state, FILE_MODIFIED, path);
+                    }
+                    break;
+               }
+               }
+               if (info.NextEntryOffset == 0)
+               {
+                    break;
+               }
+               at += info.NextEntryOffset;
+          }
+     }
+
+     int SDLCALL watchNativeMain(void *data)
+     {
+          FileWatchState &state = *(FileWatchState *)data;
+          OVERLAPPED overlapped = {};
+          overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+          const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE;
+          bool stopping = false;
+          while (!stopping)
+          {
+               // Changes between two calls are buffered by the handle, not lost
+               if (!ReadDirectoryChangesW(state.directory, state.notifyBuffer.data(),
+                                          (DWORD)(state.notifyBuffer.size() * sizeof(DWORD)), state.recursive, filter,
+                                          NULL, &overlapped, NULL))
+               {
+                    break; // The directory went away
+               }
+               for (;;)
+               {
+                    const int settle = flushSettled(state);
+                    HANDLE handles[2] = {overlapped.hEvent, state.stopEvent};
+                    const DWORD woke = WaitForMultipleObjects(2, handles, FALSE, settle < 0 ? INFINITE : (DWORD)settle);
+                    if (woke == WAIT_TIMEOUT)
+                    {
+                         continue;
+                    }
+                    DWORD bytes = 0;
+                    if (woke != WAIT_OBJECT_0)
+                    {
+                         // The buffer must not be freed under a pending read
+                         CancelIoEx(state.directory, &overlapped);
+                         GetOverlappedResult(state.directory, &overlapped, &bytes, TRUE);
+                         stopping = true;
+                         break;
+                    }
+                    if (!GetOverlappedResult(state.directory, &overlapped, &bytes, FALSE))
+                    {
+                         stopping = true;
+                         break;
+                    }
+                    if (bytes == 0)
+                    {
+                         pushChange(state, FILE_OVERFLOW, "");
+                    }
+                    else
+                    {
+                         noteNotifications(state);
+                    }
+                    break;
+               }
+          }
+          CloseHandle(overlapped.hEvent);
+          return 0;
+     }
+#elif defined(__linux__)
+     const Uint32 INOTIFY_MASK = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR |
+                                 IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+     // Watch the directory at `prefix` ("" or "dir/") and, when recursive,
+     // the ones below it. `reportFiles` notes what is already inside, for
+     // directories that were filled before their watch existed
+     bool watchTree(FileWatchState &state, const std::string &prefix, bool reportFiles)
+     {
+          const std::string path = state.root + "/" + prefix;
+          const int wd = inotify_add_watch(state.inotifyFd, path.c_str(), INOTIFY_MASK);
+          if (wd < 0)
+          {
+               SDL_SetError("Couldn't watch %s: %s", path.c_str(), strerror(errno));
+               return false;
+          }
+          state.directories[wd] = prefix;
+          if (!state.recursive && !reportFiles)
+          {
+               return true;
+          }
+          std::vector<DirEntry> entries;
+          dirList(path.c_str(), entries, false);
+          bool watched = true;
+          for (const DirEntry &entry : entries)
+          {
+               if (reportFiles)
+               {
+                    noteChange(state, FILE_ADDED, prefix + entry.name);
+               }
+               if (entry.directory && state.recursive)
+               {
+                    watched = watchTree(state, prefix + entry.name + "/", reportFiles) && watched;
+               }
+          }
+          return watched;
+     }
+
+     // A directory moved away keeps its watches, under a name that is no
+     // longer true
+     void unwatchTree(FileWatchState &state, const std::string &prefix)
+     {
+          for (auto it = state.directories.begin(); it != state.directories.end();)
+          {
+               if (it->second.compare(0, prefix.size(), prefix) == 0)
+               {
+                    inotify_rm_watch(state.inotifyFd, it->first);
+                    it = state.directories.erase(it);
+               }
+               else
+               {
+                    ++it;
+               }
+          }
+     }
+
+     bool watchNativeOpen(FileWatchState &state)
+     {
+          state.inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+          if (state.inotifyFd < 0)
+          {
+               return false;
+          }
+          state.stopFd = eventfd(0, EFD_CLOEXEC);
+          // Past fs.inotify.max_user_watches only polling sees the whole tree
+          if (state.stopFd < 0 || !watchTree(state, "", false))
+          {
+               if (state.stopFd >= 0)
+               {
+                    close(state.stopFd);
+               }
+               close(state.inotifyFd);
+               state.directories.clear();
+               return false;
+          }
+          return true;
+     }
+
+     void watchNativeSignal(FileWatchState &state)
+     {
+          const Uint64 one = 1;
+          ssize_t written = write(state.stopFd, &one, sizeof(one));
+          (void)written;
+     }
+
+     void watchNativeClose(FileWatchState &state)
+     {
+          close(state.stopFd);
+          close(state.inotifyFd);
+     }
+
+     void noteInotify(FileWatchState &state, const inotify_event &event)
+     {
+          if (event.mask & IN_Q_OVERFLOW)
+          {
+               pushChange(state, FILE_OVERFLOW, "");
+               return;
+          }
+          if (event.mask & IN_IGNORED)
+          {
+               state.directories.erase(event.wd);
+               return;
+          }
+          auto found = state.directories.find(event.wd);
+          if (found == state.directories.end() || event.len == 0)
+          {
+               return;
+          }
+          const std::string path = found->second + event.name;
+          const bool directory = (event.mask & IN_ISDIR) != 0;
+          if (event.mask & (IN_CREATE | IN_MOVED_TO))
+          {
+               noteChange(state, FILE_ADDED, path);
+               if (directory && state.recursive)
+               {
+                    watchTree(state, path + "/", true);
+               }
+          }
+          else if (event.mask & (IN_DELETE | IN_MOVED_FROM))
+          {
+               noteChange(state, FILE_REMOVED, path);
+               if (directory && (event.mask & IN_MOVED_FROM))
+               {
+                    unwatchTree(state, path + "/");
+               }
+          }
+          else if (event.mask & IN_CLOSE_WRITE)
+          {
+               // Once the writer is done, rather than on every write
+               noteChange(state, FILE_MODIFIED, path);
+          }
+     }
+
+     int SDLCALL watchNativeMain(void *data)
+     {
+          FileWatchState &state = *(FileWatchState *)data;
+          alignas(inotify_event) char buffer[16384];
+          pollfd fds[2] = {{state.inotifyFd, POLLIN, 0}, {state.stopFd, POLLIN, 0}};
+          for (;;)
+          {
+               const int woke = poll(fds, 2, flushSettled(state));
+               if (woke < 0 && errno != EINTR)
+               {
+                    break;
+               }
+               if (fds[1].revents != 0)
+               {
+                    break;
+               }
+               if (woke <= 0 || !(fds[0].revents & POLLIN))
+               {
+                    continue;
+               }
+               ssize_t bytes;
+               while ((bytes = read(state.inotifyFd, buffer, sizeof(buffer))) > 0)
+               {
+                    for (ssize_t at = 0; at < bytes;)
+                    {
+                         const inotify_event &event = *(const inotify_event *)&buffer[at];
+                         noteInotify(state, event);
+                         at += sizeof(inotify_event) + event.len;
+                    }
+               }
+          }
+          return 0;
+     }
+#else
+     bool watchNativeOpen(FileWatchState &)
+     {
+          return false;
+     }
+
+     void watchNativeSignal(FileWatchState &)
+     {
+     }
+
+     void watchNativeClose(FileWatchState &)
+     {
+     }
+
+     int SDLCALL watchNativeMain(void *)
+     {
+          return 0;
+     }
+#endif
+}
+
+bool dirList(const char *path, std::vector<DirEntry> &entries, bool recursive)
+{
+#ifdef _WIN32
+     const std::wstring widePath = watchWide(path);
+     if (GetFileAttributesW(widePath.c_str()) == INVALID_FILE_ATTRIBUTES ||
+         !listDirectory(widePath, "", entries, recursive))
+     {
+          SDL_SetError("Couldn't list %s (error %lu)", path, GetLastError());
+          return false;
+     }
+#else
+     const int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+     if (fd < 0 || !listDirectory(fd, "", entries, recursive))
+     {
+          SDL_SetError("Couldn't list %s: %s", path, strerror(errno));
+          return false;
+     }
+#endif
+     return true;
+}
+
+Uint32 fileWatchEventType()
+{
+     static const Uint32 type = SDL_RegisterEvents(1);
+     return type;
+}
+
+bool fileWatchStart(FileWatch &watch, const char *directory, bool recursive)
+{
+     watch.state = nullptr;
+     if (fileWatchEventType() == (Uint32)-1)
+     {
+          SDL_SetError("No SDL event types left for file watching");
+          return false;
+     }
+     FileWatchState *state = new FileWatchState;
+     state->owner = &watch;
+     state->root = directory;
+     while (state->root.size() > 1 && (state->root.back() == '/' || state->root.back() == '\\'))
+     {
+          state->root.pop_back();
+     }
+     state->recursive = recursive;
+     state->thread = nullptr;
+     state->stopSignal = nullptr;
+
+     watch.backend = watchNativeOpen(*state) ? FILE_WATCH_NATIVE : FILE_WATCH_POLLING;
+     if (watch.backend == FILE_WATCH_POLLING)
+     {
+          std::vector<DirEntry> entries;
+          if (!dirList(state->root.c_str(), entries, false))
+          {
+               delete state;
+               return false;
+          }
+          takeSnapshot(*state, state->snapshot);
+          state->stopSignal = SDL_CreateSemaphore(0);
+     }
+     if (watch.backend == FILE_WATCH_NATIVE || state->stopSignal != nullptr)
+     {
+          state->thread = SDL_CreateThread(watch.backend == FILE_WATCH_NATIVE ? watchNativeMain : watchPollingMain,
+                                           "file_watch", state);
+     }
+     if (state->thread == nullptr)
+     {
+          if (watch.backend == FILE_WATCH_NATIVE)
+          {
+               watchNativeClose(*state);
+          }
+          else if (state->stopSignal != nullptr)
+          {
+               SDL_DestroySemaphore(state->stopSignal);
+          }
+          delete state;
+          return false;
+     }
+     watch.state = state;
+     return true;
+}
+
+void fileWatchStop(FileWatch &watch)
+{
+     FileWatchState *state = watch.state;
+     if (state == nullptr)
+     {
+          return;
+     }
+     if (watch.backend == FILE_WATCH_NATIVE)
+     {
+          watchNativeSignal(*state);
+          SDL_WaitThread(state->thread, nullptr);
+          watchNativeClose(*state);
+     }
+     else
+     {
+          SDL_SemPost(state->stopSignal);
+          SDL_WaitThread(state->thread, nullptr);
+          SDL_DestroySemaphore(state->stopSignal);
+     }
+     delete state;
+     watch.state = nullptr;
+}
+
+const char *fileWatchBackendName(FileWatchBackend backend)
+{
+     switch (backend)
+     {
+     case FILE_WATCH_NATIVE:
+#ifdef _WIN32
+          return "ReadDirectoryChangesW";
+#elif defined(__linux__)
+          return "inotify";
+#else
+          return "native";
+#endif
+     case FILE_WATCH_POLLING:
+          return "polling";
+     }
+     return "unknown";
+}
+
+void fileWatchEventFree(SDL_Event &event)
+{
+     if (event.type == fileWatchEventType() && event.type != (Uint32)-1)
+     {
+          SDL_free(event.user.data1);
+          event.user.data1 = nullptr;
+     }
+}
@@ -0,0 +1,96 @@
+// Description:
+// Directory listing and file-change notification, for hot-reloading assets
+// while the game runs. dirList() returns names, sizes and modification
+// times in one pass: FindFirstFileEx hands them over with the names on
+// Windows, and elsewhere each entry is stat'ed relative to its open
+// directory, so no path is resolved twice.
+//
+// A FileWatch reports changes under a directory as SDL events of the type
+// fileWatchEventType(), pushed from a thread of its own that sleeps in the
+// kernel until something happens:
+// - Windows: ReadDirectoryChangesW, overlapped, one call for the whole tree;
+// - Linux: inotify, one watch per directory, new directories picked up as
+//   they are created;
+// - elsewhere, or where the native watch cannot start (inotify's watch
+//   limit): a rescan with dirList() every FILE_WATCH_POLL_MS. macOS lands
+//   here too, as FSEvents would need the CoreServices framework.
+//
+// Editors save a file in bursts (truncate, several writes, or a temporary
+// file renamed over the old one), so changes to a path are held until it
+// has been quiet for FILE_WATCH_SETTLE_MS and then reported once. A save's
+// temporary file never shows, and a removal followed by an addition comes
+// out as one FILE_MODIFIED. A file renamed over another may still arrive
+// as FILE_ADDED (inotify reports only the arrival), so reloaders treat
+// FILE_ADDED and FILE_MODIFIED alike.
+//
+// The event is an SDL_UserEvent: `code` is the FileChange, `data1` the
+// path relative to the watched directory ('/'-separated, UTF-8) and
+// `data2` the FileWatch. The path is allocated with SDL_malloc; release it
+// with fileWatchEventFree() once handled.
+// =============================================================================
+
+#ifndef FILE_WATCH_H
+#define FILE_WATCH_H
+
+#include <SDL2/SDL.h>
+
+#include <string>
+#include <vector>
+
+#define FILE_WATCH_SETTLE_MS 100
+#define FILE_WATCH_POLL_MS 1000
+
+struct DirEntry
+{
+     std::string name; // Relative to the listed directory, '/'-separated
+     bool directory;
+     Uint64 size;
+     Sint64 modified; // Nanoseconds since 1970
+};
+
+// Append the entries of `path`, without "." and "..", in no particular
+// order. Recursive listings descend into subdirectories but not through
+// symbolic links or junctions. Returns false with SDL's error set when
+// `path` cannot be opened; unreadable subdirectories are skipped
+bool dirList(const char *path, std::vector<DirEntry> &entries, bool recursive = false);
+
+enum FileChange
+{
+     FILE_ADDED,
+     FILE_REMOVED,
+     FILE_MODIFIED,
+     FILE_OVERFLOW // Changes were lost (path ""); rescan what matters
+};
+
+enum FileWatchBackend
+{
+     FILE_WATCH_NATIVE,
+     FILE_WATCH_POLLING
+};
+
+struct FileWatchState;
+
+struct FileWatch
+{
+     FileWatchBackend backend;
+     FileWatchState *state;
+};
+
+// Registers the event type on first use; (Uint32)-1 when SDL has none left
+Uint32 fileWatchEventType();
+
+// Watch `directory` and, with `recursive`, everything below it. The
+// FileWatch must stay at its address until fileWatchStop(), as events
+// point at it. Returns false with SDL's error set
+bool fileWatchStart(FileWatch &watch, const char *directory, bool recursive = true);
+
+// Stops the thread. Events already queued stay queued, still pointing at
+// the FileWatch, so drain them first or compare data2 to a live watch
+void fileWatchStop(FileWatch &watch);
+
+const char *fileWatchBackendName(FileWatchBackend backend);
+
+// Release the path of a file-watch event; other events are left alone
+void fileWatchEventFree(SDL_Event &event);
+
+#endif // FILE_WATCH_H
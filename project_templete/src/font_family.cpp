@@ -0,0 +1,152 @@
+#include "font_family.h"
+
+namespace
+{
+     const Uint32 FAMILY_CODEPOINTS = 0x110000;
+     const int FAMILY_BLOCK_BITS = 8;
+     const int FAMILY_BLOCK_SIZE = 1 << FAMILY_BLOCK_BITS;
+     const int FAMILY_MAX_FONTS = 254;
+
+     // First font in fallback order that has the glyph; 0 is the primary
+     int firstProvider(const FontFamily &family, Uint32 codepoint)
+     {
+          for (size_t i = 0; i < family.fontIds.size(); i++)
+          {
+               if (TTF_GlyphIsProvided32(family.cache->fonts[family.fontIds[i]].font, codepoint))
+               {
+                    return (int)i;
+               }
+          }
+          return 0;
+     }
+
+     // Position of the codepoint's font in fontIds, through the table
+     int resolveSlot(FontFamily &family, Uint32 codepoint)
+     {
+          if (codepoint >= FAMILY_CODEPOINTS || family.fontIds.size() < 2)
+          {
+               return 0;
+          }
+          Uint16 &block = family.blocks[codepoint >> FAMILY_BLOCK_BITS];
+          if (block == 0)
+          {
+               family.pages.resize(family.pages.size() + FAMILY_BLOCK_SIZE, 0);
+               block = (Uint16)(family.pages.size() / FAMILY_BLOCK_SIZE);
+          }
+          Uint8 &entry = family.pages[(size_t)(block - 1) * FAMILY_BLOCK_SIZE + (codepoint & (FAMILY_BLOCK_SIZE - 1))];
+          if (entry == 0)
+          {
+               entry = (Uint8)(firstProvider(family, codepoint) + 1);
+               family.resolutions++;
+          }
+          return entry - 1;
+     }
+}
+
+void fontFamilyInit(FontFamily &family, GlyphCache *cache)
+{
+     family.cache = cache;
+     family.fontIds.clear();
+     family.baselineShift.clear();
+     family.lineSkip = 0;
+     family.blocks.assign(FAMILY_CODEPOINTS >> FAMILY_BLOCK_BITS, 0);
+     family.pages.clear();
+     family.resolutions = 0;
+}
+
+bool fontFamilyAdd(FontFamily &family, int fontId)
+{
+     if ((int)family.fontIds.size() >= FAMILY_MAX_FONTS)
+     {
+          SDL_SetError("Font family is full");
+          return false;
+     }
+     TTF_Font *font = family.cache->fonts[fontId].font;
+     family.fontIds.push_back(fontId);
+     const int primaryAscent = TTF_FontAscent(family.cache->fonts[family.fontIds[0]].font);
+     family.baselineShift.push_back(primaryAscent - TTF_FontAscent(font));
+     family.lineSkip = SDL_max(family.lineSkip, family.cache->fonts[fontId].lineSkip);
+
+     // Codepoints no earlier font had may now resolve to this one
+     SDL_memset(family.blocks.data(), 0, family.blocks.size() * sizeof(Uint16));
+     family.pages.clear();
+     return true;
+}
+
+int fontFamilyResolve(FontFamily &family, Uint32 codepoint)
+{
+     return family.fontIds[resolveSlot(family, codepoint)];
+}
+
+void fontFamilyMeasure(FontFamily &family, const char *text, int *w, int *h)
+{
+     int width = 0, lineWidth = 0, lines = 1;
+     Uint32 previous = 0;
+     int previousSlot = -1;
+
+     while (*text)
+     {
+          Uint32 codepoint = glyphCacheDecodeUtf8(text);
+          if (codepoint == '\n')
+          {
+               width = SDL_max(width, lineWidth);
+               lineWidth = 0;
+               previous = 0;
+               lines++;
+               continue;
+          }
+          const int slot = resolveSlot(family, codepoint);
+          const int fontId = family.fontIds[slot];
+          const CachedGlyph *glyph = glyphCacheGet(*family.cache, fontId, codepoint);
+          if (previous != 0 && slot == previousSlot)
+          {
+               lineWidth += TTF_GetFontKerningSizeGlyphs32(family.cache->fonts[fontId].font, previous, codepoint);
+          }
+          lineWidth += glyph->advance;
+          previous = codepoint;
+          previousSlot = slot;
+     }
+     if (w)
+     {
+          *w = SDL_max(width, lineWidth);
+     }
+     if (h)
+     {
+          *h = lines * family.lineSkip;
+     }
+}
+
+void fontFamilyDrawText(FontFamily &family, RenderQueue &queue, const char *text, float x, float y, SDL_Color color)
+{
+     float penX = x, penY = y;
+     Uint32 previous = 0;
+     int previousSlot = -1;
+
+     while (*text)
+     {
+          Uint32 codepoint = glyphCacheDecodeUtf8(text);
+          if (codepoint == '\n')
+          {
+               penX = x;
+               penY += family.lineSkip;
+               previous = 0;
+               continue;
+          }
+          const int slot = resolveSlot(family, codepoint);
+          const int fontId = family.fontIds[slot];
+          if (previous != 0 && slot == previousSlot)
+          {
+               penX += TTF_GetFontKerningSizeGlyphs32(family.cache->fonts[fontId].font, previous, codepoint);
+          }
+          float drawX;
+          const CachedGlyph *glyph = glyphCacheGetAt(*family.cache, fontId, codepoint, penX, &drawX);
+          if (glyph->page >= 0)
+          {
+               SDL_FRect dst = {drawX, penY + family.baselineShift[slot], (float)glyph->src.w, (float)glyph->src.h};
+               renderQueueCopyTinted(queue, family.cache->pages[glyph->page], &glyph->src, dst, color);
+          }
+          penX += glyph->advance;
+          previous = codepoint;
+          previousSlot = slot;
+     }
+}
@@ -0,0 +1,58 @@
+// Description:
+// Font fallback for mixed-script text drawn through the glyph cache. A
+// FontFamily is an ordered list of fonts; each codepoint is drawn with the
+// first font that provides it. Asking TTF_GlyphIsProvided32 of every font
+// for every glyph on every draw adds up, so the answer is resolved once per
+// codepoint and kept in a two-level table: a block index covering Unicode
+// in 256-codepoint blocks, and one 256-byte page per block that has been
+// used, holding the winning font. Pages are allocated on first use, so
+// even a family that draws Latin and all of CJK Unified Ideographs needs
+// about 30 KB. After the first draw, finding a glyph's font is one table
+// lookup.
+//
+// Fonts of different sizes and designs are aligned on a common baseline,
+// and kerning is only applied between glyphs of the same font.
+// =============================================================================
+
+#ifndef FONT_FAMILY_H
+#define FONT_FAMILY_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "glyph_cache.h"
+#include "render_queue.h"
+
+struct FontFamily
+{
+     GlyphCache *cache;
+     std::vector<int> fontIds; // Glyph cache ids in fallback order, the primary first
+     std::vector<int> baselineShift; // Added to y so each font meets the primary's baseline
+     int lineSkip;                   // Tallest line of any font in the family
+
+     // Level one: per 256-codepoint block, 0 if unused or 1 + the page
+     // number. Level two: per codepoint, 0 until resolved, else 1 + the
+     // font's position in fontIds.
+     std::vector<Uint16> blocks;
+     std::vector<Uint8> pages;
+
+     int resolutions; // Codepoints resolved so far, a table-miss counter
+};
+
+void fontFamilyInit(FontFamily &family, GlyphCache *cache);
+
+// Append a glyph cache font to the fallback order; false past 254 fonts.
+// Adding a font forgets earlier resolutions.
+bool fontFamilyAdd(FontFamily &family, int fontId);
+
+// The glyph cache font that draws `codepoint`: the first that provides it,
+// or the primary font (for its missing-glyph box) when none does
+int fontFamilyResolve(FontFamily &family, Uint32 codepoint);
+
+// Width of the widest line and total height of UTF-8 text
+void fontFamilyMeasure(FontFamily &family, const char *text, int *w, int *h);
+
+// Queue UTF-8 text with its top-left corner at (x, y); '\n' starts a new line
+void fontFamilyDrawText(FontFamily &family, RenderQueue &queue, const char *text, float x, float y, SDL_Color color);
+
+#endif // FONT_FAMILY_H
@@ -0,0 +1,237 @@
+#include "font_pool.h"
+
+#include <iostream>
+
+#include "memory_tags.h"
+
+namespace
+{
+     void applyFaceSettings(const FontPool &pool, TTF_Font *font)
+     {
+          TTF_SetFontStyle(font, pool.style);
+          TTF_SetFontDirection(font, pool.direction);
+          if (!pool.script.empty())
+          {
+               TTF_SetFontScriptName(font, pool.script.c_str());
+          }
+     }
+
+     // Faces share one FT_Library, so only one is created at a time
+     TTF_Font *openFace(FontPool &pool)
+     {
+          SDL_LockMutex(pool.openLock);
+          TTF_Font *font;
+          {
+               MemoryTagScope tag(MEMORY_TAG_TTF);
+               font = TTF_OpenFontRW(SDL_RWFromConstMem(pool.bytes.data(), (int)pool.bytes.size()), 1, pool.pointSize);
+          }
+          if (font == nullptr)
+          {
+               std::cerr << "Unable to open a pooled font face! SDL_ttf Error: " << TTF_GetError() << std::endl;
+          }
+          else
+          {
+               applyFaceSettings(pool, font);
+          }
+          SDL_UnlockMutex(pool.openLock);
+          return font;
+     }
+
+     struct RenderBatch
+     {
+          FontPool *pool;
+          const std::vector<std::string> *texts;
+          SDL_Color color;
+          std::vector<SDL_Surface *> *surfaces;
+          SDL_atomic_t failures;
+     };
+
+     void renderBatchJob(void *data, int index)
+     {
+          RenderBatch &batch = *(RenderBatch *)data;
+          SDL_Surface *surface = nullptr;
+          TTF_Font *font = fontPoolAcquire(*batch.pool);
+          if (font != nullptr)
+          {
+               MemoryTagScope tag(MEMORY_TAG_TTF);
+               surface = TTF_RenderUTF8_Blended(font, (*batch.texts)[index].c_str(), batch.color);
+               fontPoolRelease(*batch.pool, font);
+          }
+          (*batch.surfaces)[index] = surface; // Each job writes only its own slot
+          if (surface == nullptr)
+          {
+               SDL_AtomicAdd(&batch.failures, 1);
+          }
+     }
+}
+
+bool fontPoolOpen(FontPool &pool, SDL_RWops *file, int pointSize, JobSystem *jobs)
+{
+     pool.bytes.clear();
+     pool.pointSize = pointSize;
+     pool.style = TTF_STYLE_NORMAL;
+     pool.direction = TTF_DIRECTION_LTR;
+     pool.script.clear();
+     pool.jobs = jobs;
+     pool.faces.assign(jobs != nullptr ? jobs->workers.size() : 0, nullptr);
+     pool.shared = nullptr;
+     pool.openLock = SDL_CreateMutex();
+     pool.sharedLock = SDL_CreateMutex();
+     if (file == nullptr || pool.openLock == nullptr || pool.sharedLock == nullptr)
+     {
+          if (file != nullptr)
+          {
+               SDL_RWclose(file);
+          }
+          fontPoolClose(pool);
+          return false;
+     }
+
+     const Sint64 size = SDL_RWsize(file);
+     if (size > 0 && size <= SDL_MAX_SINT32)
+     {
+          pool.bytes.resize((size_t)size);
+          if (SDL_RWread(file, pool.bytes.data(), 1, pool.bytes.size()) != pool.bytes.size())
+          {
+               pool.bytes.clear();
+          }
+     }
+     SDL_RWclose(file);
+     if (pool.bytes.empty())
+     {
+          std::cerr << "Unable to read the pooled font file! SDL Error: " << SDL_GetError() << std::endl;
+          fontPoolClose(pool);
+          return false;
+     }
+
+     // Open the calling thread's face now so a bad file fails here
+     TTF_Font *font = fontPoolAcquire(pool);
+     if (font == nullptr)
+     {
+          fontPoolClose(pool);
+          return false;
+     }
+     fontPoolRelease(pool, font);
+     return true;
+}
+
+TTF_Font *fontPoolAcquire(FontPool &pool)
+{
+     const int worker = pool.jobs != nullptr ? jobSystemCurrentWorker(*pool.jobs) : -1;
+     if (worker >= 0 && worker < (int)pool.faces.size())
+     {
+          // Only this worker's thread ever touches its slot
+          if (pool.faces[worker] == nullptr)
+          {
+               pool.faces[worker] = openFace(pool);
+          }
+          return pool.faces[worker];
+     }
+
+     SDL_LockMutex(pool.sharedLock);
+     if (pool.shared == nullptr)
+     {
+          pool.shared = openFace(pool);
+     }
+     if (pool.shared == nullptr)
+     {
+          SDL_UnlockMutex(pool.sharedLock);
+     }
+     return pool.shared;
+}
+
+void fontPoolRelease(FontPool &pool, TTF_Font *font)
+{
+     if (font != nullptr && font == pool.shared)
+     {
+          SDL_UnlockMutex(pool.sharedLock);
+     }
+}
+
+void fontPoolSetStyle(FontPool &pool, int style)
+{
+     pool.style = style;
+     for (TTF_Font *font : pool.faces)
+     {
+          if (font != nullptr)
+          {
+               TTF_SetFontStyle(font, style);
+          }
+     }
+     if (pool.shared != nullptr)
+     {
+          TTF_SetFontStyle(pool.shared, style);
+     }
+}
+
+void fontPoolSetShaping(FontPool &pool, TTF_Direction direction, const char *script)
+{
+     pool.direction = direction;
+     pool.script = script != nullptr ? script : "";
+     for (TTF_Font *font : pool.faces)
+     {
+          if (font != nullptr)
+          {
+               applyFaceSettings(pool, font);
+          }
+     }
+     if (pool.shared != nullptr)
+     {
+          applyFaceSettings(pool, pool.shared);
+     }
+}
+
+bool fontPoolRenderBatch(FontPool &pool, const std::vector<std::string> &texts, SDL_Color color,
+                         std::vector<SDL_Surface *> &surfaces)
+{
+     surfaces.assign(texts.size(), nullptr);
+     RenderBatch batch;
+     batch.pool = &pool;
+     batch.texts = &texts;
+     batch.color = color;
+     batch.surfaces = &surfaces;
+     SDL_AtomicSet(&batch.failures, 0);
+
+     if (pool.jobs != nullptr)
+     {
+          JobCounter counter = {};
+          jobSystemSubmitRange(*pool.jobs, renderBatchJob, &batch, (int)texts.size(), &counter);
+          jobSystemWait(*pool.jobs, counter);
+     }
+     else
+     {
+          for (int i = 0; i < (int)texts.size(); i++)
+          {
+               renderBatchJob(&batch, i);
+          }
+     }
+     return SDL_AtomicGet(&batch.failures) == 0;
+}
+
+void fontPoolClose(FontPool &pool)
+{
+     for (TTF_Font *font : pool.faces)
+     {
+          if (font != nullptr)
+          {
+               TTF_CloseFont(font);
+          }
+     }
+     pool.faces.clear();
+     if (pool.shared != nullptr)
+     {
+          TTF_CloseFont(pool.shared);
+          pool.shared = nullptr;
+     }
+     if (pool.openLock != nullptr)
+     {
+          SDL_DestroyMutex(pool.openLock);
+          pool.openLock = nullptr;
+     }
+     if (pool.sharedLock != nullptr)
+     {
+          SDL_DestroyMutex(pool.sharedLock);
+          pool.sharedLock = nullptr;
+     }
+     pool.bytes.clear();
+}
@@ -0,0 +1,75 @@
+// Description:
+// Font handles that can rasterize text on every job worker at once. A
+// TTF_Font is not thread-safe: it carries its FreeType face, glyph cache
+// and HarfBuzz font, all mutated on every render. FreeType itself allows
+// parallel rendering as long as each thread has its own FT_Face and faces
+// are created and destroyed one at a time, so a FontPool keeps the font
+// file in memory once and opens a private TTF_Font from it for each job
+// worker the first time that worker asks for one.
+//
+// Thread safety:
+// - fontPoolAcquire()/fontPoolRelease() may be called from any thread.
+//   Job workers get their own face and never wait; threads outside the
+//   pool share one extra face behind a mutex.
+// - Face creation is serialized on a mutex, since SDL_ttf opens every face
+//   on one FT_Library.
+// - fontPoolSetStyle() and fontPoolSetShaping() change every face and may
+//   only be called while no other thread holds one.
+//
+// fontPoolRenderBatch() spreads TTF_RenderUTF8_Blended over the job system,
+// which is how batch text baking (localized strings, prebaked labels)
+// scales with the number of cores.
+// =============================================================================
+
+#ifndef FONT_POOL_H
+#define FONT_POOL_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <string>
+#include <vector>
+
+#include "job_system.h"
+
+struct FontPool
+{
+     std::vector<Uint8> bytes; // The font file, shared read-only by every face
+     int pointSize;
+     int style;
+     TTF_Direction direction;
+     std::string script; // Empty leaves SDL_ttf's default
+
+     JobSystem *jobs;                // nullptr: every thread uses the shared face
+     std::vector<TTF_Font *> faces;  // By job worker index, opened on first use
+     SDL_mutex *openLock;            // Serializes face creation and destruction
+
+     TTF_Font *shared; // For threads outside the job pool
+     SDL_mutex *sharedLock;
+};
+
+// Read the font file from `file` (closed either way) and prepare a face
+// slot for each worker of `jobs`, which may be nullptr
+bool fontPoolOpen(FontPool &pool, SDL_RWops *file, int pointSize, JobSystem *jobs);
+
+// A face for the calling thread, nullptr if it could not be opened. Give
+// it back with fontPoolRelease() on the same thread.
+TTF_Font *fontPoolAcquire(FontPool &pool);
+void fontPoolRelease(FontPool &pool, TTF_Font *font);
+
+// TTF_SetFontStyle() on every face, now and when later faces open
+void fontPoolSetStyle(FontPool &pool, int style);
+
+// TTF_SetFontDirection() and TTF_SetFontScriptName() on every face;
+// `script` may be nullptr to keep the default
+void fontPoolSetShaping(FontPool &pool, TTF_Direction direction, const char *script);
+
+// Render every string with TTF_RenderUTF8_Blended across the job workers
+// and wait for them. `surfaces` gets one entry per string, nullptr where
+// rendering failed; the caller frees them. False if any string failed.
+bool fontPoolRenderBatch(FontPool &pool, const std::vector<std::string> &texts, SDL_Color color,
+                         std::vector<SDL_Surface *> &surfaces);
+
+// Close every face; no thread may still hold one
+void fontPoolClose(FontPool &pool);
+
+#endif // FONT_POOL_H
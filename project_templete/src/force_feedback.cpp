@@ -0,0 +1,372 @@
+#include "force_feedback.h"
+
+#include <cstring>
+
+namespace
+{
+     ForceFeedbackDevice *ffDevice(ForceFeedback &feedback, int device)
+     {
+          if (device < 0 || device >= (int)feedback.devices.size() || feedback.devices[device].joystick == nullptr)
+          {
+               return nullptr;
+          }
+          return &feedback.devices[device];
+     }
+
+     ForceFeedbackEffect *ffEffect(ForceFeedback &feedback, int device, int slot)
+     {
+          ForceFeedbackDevice *dev = ffDevice(feedback, device);
+          if (dev == nullptr || slot < 0 || slot >= (int)dev->effects.size())
+          {
+               return nullptr;
+          }
+          return &dev->effects[slot];
+     }
+
+     // Starting and stopping are always worth a write, drift only past the
+     // threshold
+     bool ffMoved(Uint16 wanted, Uint16 sent, Uint16 threshold)
+     {
+          if (wanted == sent)
+          {
+               return false;
+          }
+          return wanted == 0 || sent == 0 || SDL_abs((int)wanted - (int)sent) >= threshold;
+     }
+
+     bool ffMotorsDue(const ForceFeedback &feedback, const Uint16 wanted[2], const Uint16 sent[2], Uint32 sentAt,
+                      Uint32 now)
+     {
+          if (ffMoved(wanted[0], sent[0], feedback.config.threshold) ||
+              ffMoved(wanted[1], sent[1], feedback.config.threshold))
+          {
+               return true;
+          }
+          // Renew the lease while the motors are held on
+          return (sent[0] != 0 || sent[1] != 0) && now - sentAt >= feedback.config.leaseMs / 2;
+     }
+
+     bool ffMotorsStopping(const Uint16 wanted[2], const Uint16 sent[2])
+     {
+          return (wanted[0] == 0 && sent[0] != 0) || (wanted[1] == 0 && sent[1] != 0);
+     }
+
+     bool ffEffectDue(const ForceFeedbackEffect &effect)
+     {
+          if (effect.failed)
+          {
+               return false;
+          }
+          return effect.id < 0 || effect.runPending || effect.stopPending ||
+                 std::memcmp(&effect.wanted, &effect.sent, sizeof(SDL_HapticEffect)) != 0;
+     }
+
+     // Whether the device has anything to send, and whether it is a stop that
+     // shouldn't wait
+     bool ffPending(const ForceFeedback &feedback, const ForceFeedbackDevice &dev, Uint32 now, bool &urgent)
+     {
+          urgent = ffMotorsStopping(dev.rumble, dev.sentRumble) || ffMotorsStopping(dev.triggers, dev.sentTriggers);
+          bool pending = urgent || ffMotorsDue(feedback, dev.rumble, dev.sentRumble, dev.rumbleSentAt, now) ||
+                         ffMotorsDue(feedback, dev.triggers, dev.sentTriggers, dev.triggersSentAt, now);
+          if (dev.ledSet && (!dev.ledSent || std::memcmp(dev.led, dev.sentLed, sizeof(dev.led)) != 0))
+          {
+               pending = true;
+          }
+          for (size_t i = 0; i < dev.effects.size(); i++)
+          {
+               if (ffEffectDue(dev.effects[i]))
+               {
+                    pending = true;
+                    urgent = urgent || dev.effects[i].stopPending;
+               }
+          }
+          return pending;
+     }
+
+     // Everything the device has waiting, in one go; returns the writes made
+     int ffWriteDevice(ForceFeedback &feedback, ForceFeedbackDevice &dev, Uint32 now)
+     {
+          int writes = 0;
+          if (ffMotorsDue(feedback, dev.rumble, dev.sentRumble, dev.rumbleSentAt, now))
+          {
+               const bool on = dev.rumble[0] != 0 || dev.rumble[1] != 0;
+               SDL_JoystickRumble(dev.joystick, dev.rumble[0], dev.rumble[1], on ? feedback.config.leaseMs : 0);
+               dev.sentRumble[0] = dev.rumble[0];
+               dev.sentRumble[1] = dev.rumble[1];
+               dev.rumbleSentAt = now;
+               writes++;
+          }
+          if (ffMotorsDue(feedback, dev.triggers, dev.sentTriggers, dev.triggersSentAt, now))
+          {
+               const bool on = dev.triggers[0] != 0 || dev.triggers[1] != 0;
+               SDL_JoystickRumbleTriggers(dev.joystick, dev.triggers[0], dev.triggers[1], on ? feedback.config.leaseMs : 0);
+               dev.sentTriggers[0] = dev.triggers[0];
+               dev.sentTriggers[1] = dev.triggers[1];
+               dev.triggersSentAt = now;
+               writes++;
+          }
+          if (dev.ledSet && (!dev.ledSent || std::memcmp(dev.led, dev.sentLed, sizeof(dev.led)) != 0))
+          {
+               SDL_JoystickSetLED(dev.joystick, dev.led[0], dev.led[1], dev.led[2]);
+               std::memcpy(dev.sentLed, dev.led, sizeof(dev.led));
+               dev.ledSent = true;
+               writes++;
+          }
+
+          for (size_t i = 0; i < dev.effects.size(); i++)
+          {
+               ForceFeedbackEffect &effect = dev.effects[i];
+               if (!ffEffectDue(effect))
+               {
+                    continue;
+               }
+               if (effect.id < 0)
+               {
+                    effect.id = SDL_HapticNewEffect(dev.haptic, &effect.wanted);
+                    writes++;
+                    if (effect.id < 0)
+                    {
+                         effect.failed = true;
+                         continue;
+                    }
+                    effect.sent = effect.wanted;
+               }
+               else if (std::memcmp(&effect.wanted, &effect.sent, sizeof(SDL_HapticEffect)) != 0)
+               {
+                    // Kept as wanted on failure so the next write retries
+                    if (SDL_HapticUpdateEffect(dev.haptic, effect.id, &effect.wanted) == 0)
+                    {
+                         effect.sent = effect.wanted;
+                    }
+                    writes++;
+               }
+               if (effect.stopPending)
+               {
+                    SDL_HapticStopEffect(dev.haptic, effect.id);
+                    effect.stopPending = false;
+                    writes++;
+               }
+               if (effect.runPending)
+               {
+                    SDL_HapticRunEffect(dev.haptic, effect.id, effect.iterations);
+                    effect.runPending = false;
+                    writes++;
+               }
+          }
+
+          if (writes > 0)
+          {
+               dev.lastWrite = now;
+               dev.written = true;
+          }
+          return writes;
+     }
+}
+
+ForceFeedbackConfig forceFeedbackDefaultConfig()
+{
+     ForceFeedbackConfig config;
+     config.threshold = 0x0400;
+     config.minIntervalMs = 16;
+     config.devicesPerFlush = 2;
+     config.leaseMs = 500;
+     return config;
+}
+
+void forceFeedbackInit(ForceFeedback &feedback, const ForceFeedbackConfig &config)
+{
+     feedback.config = config;
+     feedback.devices.clear();
+     feedback.nextDevice = 0;
+     feedback.stats = ForceFeedbackStats();
+}
+
+int forceFeedbackAdd(ForceFeedback &feedback, SDL_Joystick *joystick)
+{
+     if (joystick == nullptr)
+     {
+          SDL_SetError("No joystick to add");
+          return -1;
+     }
+     size_t slot = 0;
+     while (slot < feedback.devices.size() && feedback.devices[slot].joystick != nullptr)
+     {
+          slot++;
+     }
+     if (slot == feedback.devices.size())
+     {
+          feedback.devices.push_back(ForceFeedbackDevice());
+     }
+
+     ForceFeedbackDevice &dev = feedback.devices[slot];
+     dev = ForceFeedbackDevice();
+     dev.joystick = joystick;
+     dev.haptic = SDL_JoystickIsHaptic(joystick) == SDL_TRUE ? SDL_HapticOpenFromJoystick(joystick) : nullptr;
+     return (int)slot;
+}
+
+void forceFeedbackRemove(ForceFeedback &feedback, int device)
+{
+     ForceFeedbackDevice *dev = ffDevice(feedback, device);
+     if (dev == nullptr)
+     {
+          return;
+     }
+     // Stops go out at once, whatever the interval
+     if (dev->sentRumble[0] != 0 || dev->sentRumble[1] != 0)
+     {
+          SDL_JoystickRumble(dev->joystick, 0, 0, 0);
+     }
+     if (dev->sentTriggers[0] != 0 || dev->sentTriggers[1] != 0)
+     {
+          SDL_JoystickRumbleTriggers(dev->joystick, 0, 0, 0);
+     }
+     if (dev->haptic != nullptr)
+     {
+          for (size_t i = 0; i < dev->effects.size(); i++)
+          {
+               if (dev->effects[i].id >= 0)
+               {
+                    SDL_HapticDestroyEffect(dev->haptic, dev->effects[i].id);
+               }
+          }
+          SDL_HapticClose(dev->haptic);
+     }
+     *dev = ForceFeedbackDevice();
+     dev->joystick = nullptr;
+}
+
+void forceFeedbackRumble(ForceFeedback &feedback, int device, Uint16 low, Uint16 high)
+{
+     ForceFeedbackDevice *dev = ffDevice(feedback, device);
+     if (dev != nullptr)
+     {
+          dev->rumble[0] = low;
+          dev->rumble[1] = high;
+          feedback.stats.requests++;
+     }
+}
+
+void forceFeedbackRumbleTriggers(ForceFeedback &feedback, int device, Uint16 left, Uint16 right)
+{
+     ForceFeedbackDevice *dev = ffDevice(feedback, device);
+     if (dev != nullptr)
+     {
+          dev->triggers[0] = left;
+          dev->triggers[1] = right;
+          feedback.stats.requests++;
+     }
+}
+
+void forceFeedbackSetLed(ForceFeedback &feedback, int device, Uint8 red, Uint8 green, Uint8 blue)
+{
+     ForceFeedbackDevice *dev = ffDevice(feedback, device);
+     if (dev != nullptr)
+     {
+          dev->led[0] = red;
+          dev->led[1] = green;
+          dev->led[2] = blue;
+          dev->ledSet = true;
+          feedback.stats.requests++;
+     }
+}
+
+int forceFeedbackAddEffect(ForceFeedback &feedback, int device, const SDL_HapticEffect &effect)
+{
+     ForceFeedbackDevice *dev = ffDevice(feedback, device);
+     if (dev == nullptr || dev->haptic == nullptr)
+     {
+          SDL_SetError("Device %d has no haptic interface", device);
+          return -1;
+     }
+     if (SDL_HapticEffectSupported(dev->haptic, const_cast<SDL_HapticEffect *>(&effect)) != SDL_TRUE)
+     {
+          SDL_SetError("Device %d doesn't support haptic effect type %d", device, (int)effect.type);
+          return -1;
+     }
+     ForceFeedbackEffect slot;
+     slot.wanted = effect;
+     SDL_zero(slot.sent);
+     slot.id = -1;
+     slot.failed = false;
+     slot.runPending = false;
+     slot.stopPending = false;
+     slot.iterations = 1;
+     dev->effects.push_back(slot);
+     feedback.stats.requests++;
+     return (int)dev->effects.size() - 1;
+}
+
+void forceFeedbackUpdateEffect(ForceFeedback &feedback, int device, int slot, const SDL_HapticEffect &effect)
+{
+     ForceFeedbackEffect *target = ffEffect(feedback, device, slot);
+     if (target != nullptr)
+     {
+          target->wanted = effect;
+          feedback.stats.requests++;
+     }
+}
+
+void forceFeedbackRunEffect(ForceFeedback &feedback, int device, int slot, Uint32 iterations)
+{
+     ForceFeedbackEffect *target = ffEffect(feedback, device, slot);
+     if (target != nullptr)
+     {
+          target->runPending = true;
+          target->stopPending = false;
+          target->iterations = iterations;
+          feedback.stats.requests++;
+     }
+}
+
+void forceFeedbackStopEffect(ForceFeedback &feedback, int device, int slot)
+{
+     ForceFeedbackEffect *target = ffEffect(feedback, device, slot);
+     if (target != nullptr)
+     {
+          target->stopPending = true;
+          target->runPending = false;
+          feedback.stats.requests++;
+     }
+}
+
+void forceFeedbackFlush(ForceFeedback &feedback, Uint32 now)
+{
+     const int count = (int)feedback.devices.size();
+     int budget = feedback.config.devicesPerFlush > 0 ? feedback.config.devicesPerFlush : count;
+     int firstSkipped = -1;
+     for (int k = 0; k < count; k++)
+     {
+          const int index = (feedback.nextDevice + k) % count;
+          ForceFeedbackDevice &dev = feedback.devices[index];
+          bool urgent = false;
+          if (dev.joystick == nullptr || !ffPending(feedback, dev, now, urgent))
+          {
+               continue;
+          }
+          const bool waiting = dev.written && now - dev.lastWrite < feedback.config.minIntervalMs;
+          if (!urgent && (waiting || budget <= 0))
+          {
+               // Out of budget goes first next time; still waiting doesn't need to
+               if (firstSkipped < 0 && !waiting)
+               {
+                    firstSkipped = index;
+               }
+               feedback.stats.deferred++;
+               continue;
+          }
+          feedback.stats.writes += ffWriteDevice(feedback, dev, now);
+          budget--;
+     }
+     feedback.nextDevice = firstSkipped >= 0 ? firstSkipped : (count > 0 ? (feedback.nextDevice + 1) % count : 0);
+}
+
+void forceFeedbackDestroy(ForceFeedback &feedback)
+{
+     for (size_t i = 0; i < feedback.devices.size(); i++)
+     {
+          forceFeedbackRemove(feedback, (int)i);
+     }
+     feedback.devices.clear();
+     feedback.nextDevice = 0;
+}
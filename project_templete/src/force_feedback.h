@@ -0,0 +1,118 @@
+// Description:
+// Force feedback that writes to the device only when it has something new
+// to say. SDL_JoystickRumble, SDL_JoystickRumbleTriggers and
+// SDL_HapticUpdateEffect each go straight to the device as a USB or
+// Bluetooth output report. SDL skips a rumble whose motor values are
+// exactly the ones already sent, but feedback that follows gameplay moves
+// a little every frame. So updating it per frame on four pads sends
+// hundreds of reports a second. Those fill the link and delay the input
+// reports coming back on it.
+//
+// The game sets what each device should feel as often as it likes, and
+// forceFeedbackFlush() decides once per frame what is worth sending:
+// - A motor change smaller than `threshold` waits until the drift adds up.
+//   Starting or stopping a motor is always sent.
+// - All of one device's changes go out together, at most once every
+//   `minIntervalMs`; later values replace ones not yet sent. Stops skip
+//   the wait.
+// - At most `devicesPerFlush` devices are written per flush, round robin,
+//   so four pads don't all write in the same frame.
+// - A haptic effect is uploaded again only when its parameters differ from
+//   the last upload. Build effects from SDL_zero so padding compares equal.
+// Rumble is sent with a `leaseMs` duration and renewed while it is held,
+// so a stalled game doesn't leave the motors running.
+//
+// Main thread only. Devices are SDL_Joysticks; pass a game controller's
+// through SDL_GameControllerGetJoystick.
+// =============================================================================
+
+#ifndef FORCE_FEEDBACK_H
+#define FORCE_FEEDBACK_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct ForceFeedbackConfig
+{
+     Uint16 threshold;       // Smallest motor change sent, out of 0xFFFF
+     Uint32 minIntervalMs;   // Between writes to one device
+     int devicesPerFlush;    // 0 for no limit
+     Uint32 leaseMs;         // Rumble duration, renewed at half of it while held
+};
+
+struct ForceFeedbackEffect
+{
+     SDL_HapticEffect wanted;
+     SDL_HapticEffect sent;
+     int id; // SDL_HapticNewEffect's, -1 until uploaded
+     bool failed;
+     bool runPending;
+     bool stopPending;
+     Uint32 iterations;
+};
+
+struct ForceFeedbackDevice
+{
+     SDL_Joystick *joystick; // nullptr for a free slot
+     SDL_Haptic *haptic;     // nullptr when the device has no haptic interface
+
+     Uint16 rumble[2], sentRumble[2];     // Low and high frequency motors
+     Uint16 triggers[2], sentTriggers[2]; // Left and right
+     Uint32 rumbleSentAt, triggersSentAt;
+     Uint8 led[3], sentLed[3];
+     bool ledSet, ledSent;
+     std::vector<ForceFeedbackEffect> effects;
+
+     Uint32 lastWrite;
+     bool written; // lastWrite is valid
+};
+
+struct ForceFeedbackStats
+{
+     int requests;    // Calls that set something
+     int writes;      // Calls into SDL that reach the device
+     int deferred;    // Devices with changes left for a later flush
+};
+
+struct ForceFeedback
+{
+     ForceFeedbackConfig config;
+     std::vector<ForceFeedbackDevice> devices;
+     int nextDevice; // Where the next flush starts its round
+     ForceFeedbackStats stats;
+};
+
+ForceFeedbackConfig forceFeedbackDefaultConfig();
+
+void forceFeedbackInit(ForceFeedback &feedback, const ForceFeedbackConfig &config);
+
+// Returns the device's index, opening its haptic interface when it has one.
+// The joystick stays the caller's; remove it before closing it.
+int forceFeedbackAdd(ForceFeedback &feedback, SDL_Joystick *joystick);
+
+// Stop the device's motors and effects and forget it
+void forceFeedbackRemove(ForceFeedback &feedback, int device);
+
+// What the motors should do until set again, 0..0xFFFF each
+void forceFeedbackRumble(ForceFeedback &feedback, int device, Uint16 low, Uint16 high);
+void forceFeedbackRumbleTriggers(ForceFeedback &feedback, int device, Uint16 left, Uint16 right);
+void forceFeedbackSetLed(ForceFeedback &feedback, int device, Uint8 red, Uint8 green, Uint8 blue);
+
+// A haptic effect uploaded at the next flush. Returns its slot, -1 when the
+// device has no haptic interface or doesn't support the effect.
+int forceFeedbackAddEffect(ForceFeedback &feedback, int device, const SDL_HapticEffect &effect);
+
+// New parameters for an effect, sent only if they differ from the last ones
+void forceFeedbackUpdateEffect(ForceFeedback &feedback, int device, int slot, const SDL_HapticEffect &effect);
+
+// Start (or restart) and stop an effect at the next write to the device
+void forceFeedbackRunEffect(ForceFeedback &feedback, int device, int slot, Uint32 iterations = 1);
+void forceFeedbackStopEffect(ForceFeedback &feedback, int device, int slot);
+
+// Send what changed; call once per frame with SDL_GetTicks()
+void forceFeedbackFlush(ForceFeedback &feedback, Uint32 now);
+
+// Stop every device and close the haptic interfaces
+void forceFeedbackDestroy(ForceFeedback &feedback);
+
+#endif // FORCE_FEEDBACK_H
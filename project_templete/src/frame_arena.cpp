@@ -0,0 +1,117 @@
+#include "frame_arena.h"
+
+namespace
+{
+     size_t roundUp(size_t bytes, size_t multiple)
+     {
+          return (bytes + multiple - 1) / multiple * multiple;
+     }
+
+     // Requests past this go straight to the heap and are not counted
+     // towards growing the blocks
+     const size_t LARGEST_ARENA_REQUEST = 256 * 1024 * 1024;
+}
+
+bool frameArenaInit(FrameArena &arena, size_t bytesPerFrame)
+{
+     arena.current = 0;
+     SDL_AtomicSet(&arena.used, 0);
+     arena.spillLock = 0;
+     arena.peakBytes = 0;
+     arena.spilledFrames = 0;
+     bool allocated = true;
+     for (int i = 0; i < FRAME_ARENA_FRAMES; i++)
+     {
+          arena.capacity[i] = roundUp(SDL_max(bytesPerFrame, (size_t)64), 64);
+          arena.blocks[i] = (Uint8 *)SDL_SIMDAlloc(arena.capacity[i]);
+          if (arena.blocks[i] == nullptr)
+          {
+               arena.capacity[i] = 0;
+               allocated = false;
+          }
+          arena.spill[i].clear();
+     }
+     if (!allocated)
+     {
+          SDL_OutOfMemory();
+     }
+     return allocated;
+}
+
+void *frameArenaAlloc(FrameArena &arena, size_t bytes)
+{
+     const size_t size = roundUp(SDL_max(bytes, (size_t)1), 16);
+     if (size <= LARGEST_ARENA_REQUEST)
+     {
+          const size_t offset = (size_t)SDL_AtomicAdd(&arena.used, (int)size);
+          if (offset + size <= arena.capacity[arena.current])
+          {
+               return arena.blocks[arena.current] + offset;
+          }
+     }
+
+     // The frame outgrew its block: borrow from the heap until the block
+     // comes round again, bigger
+     void *memory = SDL_SIMDAlloc(size);
+     if (memory == nullptr)
+     {
+          SDL_OutOfMemory();
+          return nullptr;
+     }
+     SDL_AtomicLock(&arena.spillLock);
+     arena.spill[arena.current].push_back(memory);
+     SDL_AtomicUnlock(&arena.spillLock);
+     return memory;
+}
+
+size_t frameArenaUsed(const FrameArena &arena)
+{
+     return (size_t)SDL_AtomicGet(const_cast<SDL_atomic_t *>(&arena.used));
+}
+
+void frameArenaEndFrame(FrameArena &arena)
+{
+     const size_t demand = frameArenaUsed(arena);
+     arena.peakBytes = SDL_max(arena.peakBytes, demand);
+     if (demand > arena.capacity[arena.current])
+     {
+          arena.spilledFrames++;
+     }
+
+     // The next block's memory was handed out two frames ago, so nothing
+     // may read it any more
+     const int next = (arena.current + 1) % FRAME_ARENA_FRAMES;
+     for (void *memory : arena.spill[next])
+     {
+          SDL_SIMDFree(memory);
+     }
+     arena.spill[next].clear();
+     if (demand > arena.capacity[next])
+     {
+          const size_t grown = roundUp(demand + demand / 4, 64);
+          Uint8 *block = (Uint8 *)SDL_SIMDAlloc(grown);
+          if (block != nullptr)
+          {
+               SDL_SIMDFree(arena.blocks[next]);
+               arena.blocks[next] = block;
+               arena.capacity[next] = grown;
+          }
+     }
+     arena.current = next;
+     SDL_AtomicSet(&arena.used, 0);
+}
+
+void frameArenaDestroy(FrameArena &arena)
+{
+     for (int i = 0; i < FRAME_ARENA_FRAMES; i++)
+     {
+          for (void *memory : arena.spill[i])
+          {
+               SDL_SIMDFree(memory);
+          }
+          arena.spill[i].clear();
+          SDL_SIMDFree(arena.blocks[i]);
+          arena.blocks[i] = nullptr;
+          arena.capacity[i] = 0;
+     }
+}
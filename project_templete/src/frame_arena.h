@@ -0,0 +1,63 @@
+// Description:
+// Linear per-frame scratch memory for the game loop: vertex arrays,
+// visible lists, layout scratch and anything else rebuilt every frame.
+// Allocation bumps an atomic offset, so jobs on any thread can allocate
+// without a lock, and nothing is freed individually; the whole frame is
+// recycled at once by frameArenaEndFrame() right after SDL_RenderPresent.
+//
+// Two blocks alternate, so memory handed out in frame N stays valid until
+// the end of frame N + 1 for whatever still reads it (streaming uploads,
+// a renderer batch that has not been flushed). A frame that outgrows its
+// block spills to the heap and the block is regrown to fit before it is
+// reused, so steady-state frames make no heap allocations at all.
+//
+// Memory is uninitialized, 16-byte aligned and only suitable for
+// trivially destructible data.
+// =============================================================================
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+const int FRAME_ARENA_FRAMES = 2;
+
+struct FrameArena
+{
+     Uint8 *blocks[FRAME_ARENA_FRAMES];
+     size_t capacity[FRAME_ARENA_FRAMES];
+     int current; // Block the running frame allocates from
+     SDL_atomic_t used; // Bytes asked of the current block, may exceed its capacity
+
+     // Heap spill per block, freed when the block comes round again
+     SDL_SpinLock spillLock;
+     std::vector<void *> spill[FRAME_ARENA_FRAMES];
+
+     size_t peakBytes;  // Largest frame so far
+     int spilledFrames; // Frames that outgrew their block
+};
+
+bool frameArenaInit(FrameArena &arena, size_t bytesPerFrame);
+
+// `bytes` of scratch valid until the end of the next frame. nullptr only
+// when the heap is out of memory too.
+void *frameArenaAlloc(FrameArena &arena, size_t bytes);
+
+template <typename T>
+T *frameArenaAllocArray(FrameArena &arena, size_t count)
+{
+     static_assert(alignof(T) <= 16, "Frame arena memory is 16-byte aligned");
+     return (T *)frameArenaAlloc(arena, count * sizeof(T));
+}
+
+// Bytes allocated in the running frame so far
+size_t frameArenaUsed(const FrameArena &arena);
+
+// Close the frame: the block used two frames ago (grown if that frame
+// spilled) becomes current and its memory is reused
+void frameArenaEndFrame(FrameArena &arena);
+
+void frameArenaDestroy(FrameArena &arena);
+
+#endif // FRAME_ARENA_H
@@ -0,0 +1,211 @@
+#include "frame_pacer.h"
+
+#include "precise_sleep.h"
+
+#if defined(__EMSCRIPTEN__)
+#include <emscripten.h>
+
+// The page's vblank: the canvas is shown when the callback runs
+EM_ASYNC_JS(void, framePacerWebAnimationFrame, (), {
+     await new Promise(function(resolve) { requestAnimationFrame(resolve); });
+});
+
+// One trip through the event loop. setTimeout(0) is clamped to 4 ms once
+// nested; a posted message is not
+EM_ASYNC_JS(void, framePacerWebYield, (), {
+     await new Promise(function(resolve) {
+          var channel = new MessageChannel();
+          channel.port1.onmessage = function() { resolve(); };
+          channel.port2.postMessage(0);
+     });
+});
+#endif
+
+namespace
+{
+     // Stay this far under a VRR display's maximum so presents never reach
+     // the rate where the driver falls back to waiting for vsync
+     const int VRR_MARGIN_HZ = 3;
+
+     bool framePacerCapped(const FramePacer &pacer)
+     {
+          return pacer.capHz > 0 && pacer.capHz < (pacer.refreshHz > 0 ? pacer.refreshHz : 60);
+     }
+
+     void updateRefresh(FramePacer &pacer)
+     {
+          SDL_DisplayMode mode;
+          const int display = pacer.window != nullptr ? SDL_GetWindowDisplayIndex(pacer.window) : 0;
+          pacer.refreshHz = 0;
+          if (display >= 0 && SDL_GetCurrentDisplayMode(display, &mode) == 0)
+          {
+               pacer.refreshHz = mode.refresh_rate;
+          }
+          int targetHz = pacer.refreshHz > 0 ? pacer.refreshHz : 60;
+          if (pacer.vrr)
+          {
+               targetHz = SDL_max(30, targetHz - VRR_MARGIN_HZ);
+          }
+          const Uint64 frequency = SDL_GetPerformanceFrequency();
+          pacer.intervalTicks = frequency / (Uint64)targetHz;
+          pacer.vsyncLead = 0;
+          if (framePacerCapped(pacer))
+          {
+               if (pacer.vsync && !pacer.vrr)
+               {
+                    // Every refreshes-th vblank; the present waits out the last refresh
+                    const int refreshes = (targetHz + pacer.capHz - 1) / pacer.capHz;
+                    pacer.vsyncLead = pacer.intervalTicks - pacer.intervalTicks / 4;
+                    pacer.intervalTicks *= (Uint64)refreshes;
+               }
+               else
+               {
+                    pacer.intervalTicks = frequency / (Uint64)pacer.capHz;
+               }
+          }
+          pacer.deadline = 0;
+     }
+}
+
+void framePacerInit(FramePacer &pacer, SDL_Window *window, bool vsync, int idleTimeoutMs)
+{
+     pacer.window = window;
+     pacer.vsync = vsync;
+     pacer.vrr = SDL_GetHintBoolean(VRR_PACING_HINT, SDL_FALSE);
+     pacer.idleWait = SDL_GetHintBoolean(IDLE_WAIT_HINT, SDL_TRUE);
+     pacer.idleTimeoutMs = SDL_max(1, idleTimeoutMs);
+     pacer.pace = FRAME_PACE_TIMED;
+     pacer.lastPresent = 0;
+     pacer.intervalTotal = 0;
+     pacer.deviationTotal = 0;
+     pacer.intervals = 0;
+     pacer.latePresents = 0;
+     pacer.idleFrames = 0;
+     pacer.idleTicks = 0;
+     pacer.capHz = 0;
+     updateRefresh(pacer);
+}
+
+void framePacerSetCap(FramePacer &pacer, int hz)
+{
+     if (SDL_max(hz, 0) != pacer.capHz)
+     {
+          pacer.capHz = SDL_max(hz, 0);
+          updateRefresh(pacer);
+     }
+}
+
+void framePacerHandleEvent(FramePacer &pacer, const SDL_Event &event)
+{
+     if (event.type == SDL_WINDOWEVENT && pacer.window != nullptr &&
+         event.window.windowID == SDL_GetWindowID(pacer.window) &&
+         (event.window.event == SDL_WINDOWEVENT_DISPLAY_CHANGED || event.window.event == SDL_WINDOWEVENT_MOVED))
+     {
+          updateRefresh(pacer);
+     }
+}
+
+void framePacerPresented(FramePacer &pacer)
+{
+     const Uint64 now = SDL_GetPerformanceCounter();
+     // An idle wait is not a late frame, so intervals restart after one
+     if (pacer.lastPresent != 0 && pacer.pace != FRAME_PACE_IDLE)
+     {
+          const Uint64 interval = now - pacer.lastPresent;
+          pacer.intervalTotal += interval;
+          pacer.intervals++;
+          const Uint64 average = pacer.intervalTotal / (Uint64)pacer.intervals;
+          pacer.deviationTotal += interval > average ? interval - average : average - interval;
+          if (interval > pacer.intervalTicks + pacer.intervalTicks / 2)
+          {
+               pacer.latePresents++;
+          }
+     }
+     pacer.lastPresent = now;
+}
+
+Uint64 framePacerEndFrame(FramePacer &pacer, bool presented, bool animating, double untilNextTick)
+{
+     if (!presented && !animating && pacer.idleWait)
+     {
+          // Returns as soon as anything is queued; the event stays for the next drain
+          pacer.pace = FRAME_PACE_IDLE;
+          const Uint64 start = SDL_GetPerformanceCounter();
+          SDL_WaitEventTimeout(NULL, pacer.idleTimeoutMs);
+          const Uint64 blocked = SDL_GetPerformanceCounter() - start;
+          pacer.idleFrames++;
+          pacer.idleTicks += blocked;
+          pacer.deadline = 0;
+          return blocked;
+     }
+
+     if (presented && pacer.vsync && !pacer.vrr && pacer.vsyncLead == 0)
+     {
+          pacer.pace = FRAME_PACE_VSYNC;
+          pacer.deadline = 0;
+#if defined(__EMSCRIPTEN__)
+          framePacerWebAnimationFrame();
+#endif
+          return 0;
+     }
+
+     pacer.pace = FRAME_PACE_TIMED;
+     if (!presented)
+     {
+          // A skipped present does not wait for vsync, so sleep until the next tick
+          if (untilNextTick > 0.001)
+          {
+               preciseSleep(untilNextTick);
+          }
+          pacer.deadline = 0;
+          return 0;
+     }
+
+     // Advance by whole intervals; a frame that ran past its deadline by
+     // more than an interval resyncs instead of bursting to catch up
+     const Uint64 now = SDL_GetPerformanceCounter();
+     pacer.deadline = pacer.deadline == 0 ? now + pacer.intervalTicks - pacer.vsyncLead
+                                          : pacer.deadline + pacer.intervalTicks;
+     if (pacer.deadline + pacer.intervalTicks < now)
+     {
+          pacer.deadline = now;
+     }
+     preciseSleepUntil(pacer.deadline);
+     return 0;
+}
+
+void framePacerYield()
+{
+#if defined(__EMSCRIPTEN__)
+     framePacerWebYield();
+#endif
+}
+
+FramePacerStats framePacerGetStats(const FramePacer &pacer)
+{
+     const double msPerTick = 1000.0 / (double)SDL_GetPerformanceFrequency();
+     FramePacerStats stats;
+     stats.refreshHz = pacer.refreshHz;
+     stats.targetMs = (double)pacer.intervalTicks * msPerTick;
+     stats.presents = pacer.intervals;
+     stats.averageIntervalMs = pacer.intervals > 0 ? (double)pacer.intervalTotal * msPerTick / pacer.intervals : 0.0;
+     stats.jitterMs = pacer.intervals > 0 ? (double)pacer.deviationTotal * msPerTick / pacer.intervals : 0.0;
+     stats.latePresents = pacer.latePresents;
+     stats.idleFrames = pacer.idleFrames;
+     stats.idleSeconds = (double)pacer.idleTicks / (double)SDL_GetPerformanceFrequency();
+     return stats;
+}
+
+const char *framePaceName(FramePace pace)
+{
+     switch (pace)
+     {
+     case FRAME_PACE_VSYNC:
+          return "vsync";
+     case FRAME_PACE_TIMED:
+          return "timed";
+     case FRAME_PACE_IDLE:
+          return "idle";
+     }
+     return "unknown";
+}
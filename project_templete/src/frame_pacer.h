@@ -0,0 +1,128 @@
+// Description:
+// Frame pacing that keeps frame intervals even and lets the CPU sleep on
+// static screens. Each frame ends in one of three modes, picked from what
+// the frame did:
+//
+// - FRAME_PACE_VSYNC: the frame was presented on a vsynced fixed-rate
+//   display, so SDL_RenderPresent already waited for the vblank.
+// - FRAME_PACE_TIMED: the loop is paced here, to a deadline one refresh
+//   interval after the previous one. The refresh rate comes from
+//   SDL_GetCurrentDisplayMode for the window's display and is looked up
+//   again when the window moves to another display. Deadlines advance by
+//   whole intervals instead of "now + 16 ms", so one slow frame does not
+//   shift every later one, and the wait is a preciseSleepUntil(), which
+//   hits the deadline where SDL_Delay would round to the system timer.
+// - FRAME_PACE_IDLE: nothing changed on screen and nothing will change on
+//   its own, so block in SDL_WaitEventTimeout until input, a window event
+//   or a timer arrives. The loop stops waking sixty times a second, which
+//   is what keeps a laptop's CPU in its low-power states on a menu.
+//
+// Variable refresh rate displays (FreeSync, G-Sync, Adaptive-Sync) refresh
+// when a frame is presented, so vsync there adds a queued frame of latency
+// whenever the game reaches the maximum rate. SDL 2 cannot detect VRR, so
+// VRR_PACING_HINT opts in: frames are then paced in TIMED mode slightly
+// below the display's maximum rate, and presents never wait.
+//
+// framePacerPresented() records the real interval between presents, so
+// the average, the jitter and the frames that missed their interval can
+// be reported. The idle wait has a timeout so that per-frame polling
+// (streaming, background jobs, logging) still runs a few times a second;
+// IDLE_WAIT_HINT set to "0" never idles.
+//
+// framePacerSetCap() limits the rate below the display's, for power
+// saving. With vsync the capped interval is a whole number of refreshes,
+// and the wait ends just after the vblank before the one the frame is
+// meant for, so the present still lands on a vblank.
+//
+// In the browser (`make web`) SDL_RenderPresent never blocks; the canvas
+// is only composited once control returns to the page. VSYNC frames there
+// wait for the next requestAnimationFrame instead, and the other waits
+// yield through SDL_Delay, both by way of -sASYNCIFY. Loops that never
+// call framePacerEndFrame(), like the headless benchmark, call
+// framePacerYield() once a frame so the page keeps running.
+// =============================================================================
+
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <SDL2/SDL.h>
+
+// Set to "0" (SDL_SetHint or the environment) to never block on events
+#define IDLE_WAIT_HINT "CATCH_IDLE_WAIT"
+
+// Set to "1" on a variable refresh rate display
+#define VRR_PACING_HINT "CATCH_VRR"
+
+enum FramePace
+{
+     FRAME_PACE_VSYNC,
+     FRAME_PACE_TIMED,
+     FRAME_PACE_IDLE
+};
+
+struct FramePacerStats
+{
+     int refreshHz;           // Of the window's display, 0 if unknown
+     double targetMs;         // Interval paced to
+     double averageIntervalMs; // Between presents
+     double jitterMs;          // Mean absolute deviation from the average
+     int presents;
+     int latePresents; // More than half an interval late
+     int idleFrames;
+     double idleSeconds;
+};
+
+struct FramePacer
+{
+     SDL_Window *window;
+     bool vsync;
+     bool vrr;          // From VRR_PACING_HINT
+     bool idleWait;     // From IDLE_WAIT_HINT
+     int idleTimeoutMs; // Longest single idle wait
+     FramePace pace;    // How the last frame ended
+
+     int refreshHz;
+     int capHz;            // 0 for the display's rate
+     Uint64 intervalTicks; // Target time between frames
+     Uint64 vsyncLead;     // Capped with vsync: how early the wait ends for the present's own wait
+     Uint64 deadline;      // When the current frame may end, 0 to resync
+
+     // Present feedback, in counter ticks
+     Uint64 lastPresent;
+     Uint64 intervalTotal;
+     Uint64 deviationTotal;
+     int intervals;
+     int latePresents;
+
+     int idleFrames;   // Frames that ended in an idle wait
+     Uint64 idleTicks; // Counter ticks spent blocked in them
+};
+
+// `window` is where frames are shown; its display decides the refresh rate
+void framePacerInit(FramePacer &pacer, SDL_Window *window, bool vsync, int idleTimeoutMs = 250);
+
+// Look the refresh rate up again when the window changes display
+void framePacerHandleEvent(FramePacer &pacer, const SDL_Event &event);
+
+// Pace to at most `hz` frames a second, 0 for the display's full rate
+void framePacerSetCap(FramePacer &pacer, int hz);
+
+// Call right after SDL_RenderPresent
+void framePacerPresented(FramePacer &pacer);
+
+// End the frame. `presented` is whether it reached the screen, `animating`
+// whether the next frame would differ without any input, and
+// `untilNextTick` the seconds left before the next simulation step.
+// Returns the counter ticks spent blocked waiting for events, which the
+// caller should leave out of its frame time so the wait is not simulated.
+Uint64 framePacerEndFrame(FramePacer &pacer, bool presented, bool animating, double untilNextTick);
+
+// Let the browser run its event loop without waiting for a frame; does
+// nothing outside the web build
+void framePacerYield();
+
+FramePacerStats framePacerGetStats(const FramePacer &pacer);
+
+const char *framePaceName(FramePace pace);
+
+#endif // FRAME_PACER_H
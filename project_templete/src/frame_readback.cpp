@@ -0,0 +1,310 @@
+#include "frame_readback.h"
+
+#include <SDL2/SDL_opengl.h>
+
+#include "mem_kernels.h"
+
+namespace
+{
+     typedef void(APIENTRY *ReadbackReadPixelsProc)(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format,
+                                                    GLenum type, void *pixels);
+     typedef void(APIENTRY *ReadbackPixelStoreiProc)(GLenum name, GLint param);
+
+     struct ReadbackGl
+     {
+          ReadbackReadPixelsProc readPixels;
+          ReadbackPixelStoreiProc pixelStorei;
+          PFNGLGENBUFFERSPROC genBuffers;
+          PFNGLDELETEBUFFERSPROC deleteBuffers;
+          PFNGLBINDBUFFERPROC bindBuffer;
+          PFNGLBUFFERDATAPROC bufferData;
+          PFNGLMAPBUFFERRANGEPROC mapBufferRange;
+          PFNGLUNMAPBUFFERPROC unmapBuffer;
+          PFNGLFENCESYNCPROC fenceSync;
+          PFNGLCLIENTWAITSYNCPROC clientWaitSync;
+          PFNGLDELETESYNCPROC deleteSync;
+     };
+     ReadbackGl readbackGl;
+
+     bool loadReadbackGl(SDL_Renderer *renderer)
+     {
+          SDL_RendererInfo info;
+          if (SDL_GetRendererInfo(renderer, &info) != 0 || SDL_strcmp(info.name, "opengl") != 0 ||
+              SDL_GL_GetCurrentContext() == nullptr || !SDL_GL_ExtensionSupported("GL_ARB_pixel_buffer_object") ||
+              !SDL_GL_ExtensionSupported("GL_ARB_map_buffer_range") || !SDL_GL_ExtensionSupported("GL_ARB_sync"))
+          {
+               return false;
+          }
+          ReadbackGl &gl = readbackGl;
+          gl.readPixels = (ReadbackReadPixelsProc)SDL_GL_GetProcAddress("glReadPixels");
+          gl.pixelStorei = (ReadbackPixelStoreiProc)SDL_GL_GetProcAddress("glPixelStorei");
+          gl.genBuffers = (PFNGLGENBUFFERSPROC)SDL_GL_GetProcAddress("glGenBuffers");
+          gl.deleteBuffers = (PFNGLDELETEBUFFERSPROC)SDL_GL_GetProcAddress("glDeleteBuffers");
+          gl.bindBuffer = (PFNGLBINDBUFFERPROC)SDL_GL_GetProcAddress("glBindBuffer");
+          gl.bufferData = (PFNGLBUFFERDATAPROC)SDL_GL_GetProcAddress("glBufferData");
+          gl.mapBufferRange = (PFNGLMAPBUFFERRANGEPROC)SDL_GL_GetProcAddress("glMapBufferRange");
+          gl.unmapBuffer = (PFNGLUNMAPBUFFERPROC)SDL_GL_GetProcAddress("glUnmapBuffer");
+          gl.fenceSync = (PFNGLFENCESYNCPROC)SDL_GL_GetProcAddress("glFenceSync");
+          gl.clientWaitSync = (PFNGLCLIENTWAITSYNCPROC)SDL_GL_GetProcAddress("glClientWaitSync");
+          gl.deleteSync = (PFNGLDELETESYNCPROC)SDL_GL_GetProcAddress("glDeleteSync");
+          return gl.readPixels != nullptr && gl.pixelStorei != nullptr && gl.genBuffers != nullptr &&
+                 gl.deleteBuffers != nullptr && gl.bindBuffer != nullptr && gl.bufferData != nullptr &&
+                 gl.mapBufferRange != nullptr && gl.unmapBuffer != nullptr && gl.fenceSync != nullptr &&
+                 gl.clientWaitSync != nullptr && gl.deleteSync != nullptr;
+     }
+
+     // Size of what a request reads: the target, else the whole window
+     bool readSize(SDL_Renderer *renderer, int &width, int &height, bool &flipped)
+     {
+          SDL_Texture *target = SDL_GetRenderTarget(renderer);
+          flipped = target == nullptr;
+          return target != nullptr ? SDL_QueryTexture(target, nullptr, nullptr, &width, &height) == 0
+                                   : SDL_GetRendererOutputSize(renderer, &width, &height) == 0;
+     }
+
+     // Copy the mapped rows of a finished slot out and hand them over
+     void deliver(FrameReadback &readback, FrameReadbackSlot &slot)
+     {
+          ReadbackGl &gl = readbackGl;
+          gl.deleteSync((GLsync)slot.fence);
+          slot.fence = nullptr;
+
+          const int rowBytes = slot.width * 4;
+          SDL_Surface *frame = surfacePoolAcquire(*readback.surfaces, slot.width, slot.height, SDL_PIXELFORMAT_RGB888,
+                                                  false);
+          gl.bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+          const Uint8 *mapped =
+              frame != nullptr
+                  ? (const Uint8 *)gl.mapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)rowBytes * slot.height,
+                                                     GL_MAP_READ_BIT)
+                  : nullptr;
+          if (mapped != nullptr)
+          {
+               // One copy when the rows line up, large enough to stream past
+               // the cache on its way to the writer thread
+               if (!slot.flipped && frame->pitch == rowBytes)
+               {
+                    memKernels().copy(frame->pixels, mapped, (size_t)rowBytes * slot.height);
+               }
+               else
+               {
+                    for (int y = 0; y < slot.height; y++)
+                    {
+                         const int row = slot.flipped ? slot.height - 1 - y : y;
+                         memKernels().copy((Uint8 *)frame->pixels + (size_t)y * frame->pitch,
+                                           mapped + (size_t)row * rowBytes, rowBytes);
+                    }
+               }
+               gl.unmapBuffer(GL_PIXEL_PACK_BUFFER);
+          }
+          gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+          if (mapped == nullptr)
+          {
+               surfacePoolRelease(*readback.surfaces, frame);
+               readback.failed++;
+               return;
+          }
+          readback.completed++;
+          slot.done(slot.userdata, frame, slot.tag);
+     }
+
+     // The slot in flight with the oldest request, or nullptr
+     FrameReadbackSlot *oldestInFlight(FrameReadback &readback)
+     {
+          FrameReadbackSlot *oldest = nullptr;
+          for (FrameReadbackSlot &slot : readback.slots)
+          {
+               if (slot.fence != nullptr && (oldest == nullptr || slot.sequence < oldest->sequence))
+               {
+                    oldest = &slot;
+               }
+          }
+          return oldest;
+     }
+
+     bool requestSync(FrameReadback &readback, FrameReadbackDone done, void *userdata, int tag)
+     {
+          int width, height;
+          bool flipped;
+          if (!readSize(readback.renderer, width, height, flipped))
+          {
+               return false;
+          }
+          SDL_Surface *frame = surfacePoolAcquire(*readback.surfaces, width, height, SDL_PIXELFORMAT_RGB888, false);
+
+          // SDL_RenderReadPixels reads the viewport, which under a logical
+          // size is the letterboxed area, not the output measured above.
+          // Lifted for the read, the whole window comes back, bars and all,
+          // as it does from the asynchronous path
+          int logicalWidth = 0, logicalHeight = 0;
+          if (flipped)
+          {
+               SDL_RenderGetLogicalSize(readback.renderer, &logicalWidth, &logicalHeight);
+          }
+          const bool logical = logicalWidth > 0 && logicalHeight > 0;
+          if (logical)
+          {
+               SDL_RenderSetLogicalSize(readback.renderer, 0, 0);
+          }
+          const bool read = frame != nullptr && SDL_RenderReadPixels(readback.renderer, NULL, SDL_PIXELFORMAT_RGB888,
+                                                                     frame->pixels, frame->pitch) == 0;
+          if (logical)
+          {
+               SDL_RenderSetLogicalSize(readback.renderer, logicalWidth, logicalHeight);
+          }
+          if (!read)
+          {
+               surfacePoolRelease(*readback.surfaces, frame);
+               readback.failed++;
+               return false;
+          }
+          readback.sequence++;
+          readback.completed++;
+          done(userdata, frame, tag);
+          return true;
+     }
+}
+
+bool frameReadbackInit(FrameReadback &readback, SDL_Renderer *renderer, SurfacePool &surfaces)
+{
+     readback.renderer = renderer;
+     readback.surfaces = &surfaces;
+     readback.async = loadReadbackGl(renderer);
+     for (FrameReadbackSlot &slot : readback.slots)
+     {
+          slot = FrameReadbackSlot{};
+     }
+     readback.sequence = 0;
+     readback.completed = 0;
+     readback.stalls = 0;
+     readback.failed = 0;
+     return readback.async;
+}
+
+bool frameReadbackRequest(FrameReadback &readback, FrameReadbackDone done, void *userdata, int tag)
+{
+     if (!readback.async)
+     {
+          return requestSync(readback, done, userdata, tag);
+     }
+
+     FrameReadbackSlot *slot = nullptr;
+     for (FrameReadbackSlot &candidate : readback.slots)
+     {
+          if (candidate.fence == nullptr)
+          {
+               slot = &candidate;
+               break;
+          }
+     }
+     if (slot == nullptr)
+     {
+          // Requests outran the GPU; finishing the oldest keeps the order
+          slot = oldestInFlight(readback);
+          readbackGl.clientWaitSync((GLsync)slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+          deliver(readback, *slot);
+          readback.stalls++;
+     }
+
+     int width, height;
+     bool flipped;
+     if (!readSize(readback.renderer, width, height, flipped))
+     {
+          return false;
+     }
+     ReadbackGl &gl = readbackGl;
+     const size_t bytes = (size_t)width * height * 4;
+     if (slot->buffer == 0)
+     {
+          gl.genBuffers(1, &slot->buffer);
+     }
+
+     // What SDL has batched must reach GL before the read
+     SDL_RenderFlush(readback.renderer);
+     gl.bindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+     if (slot->capacity != bytes)
+     {
+          gl.bufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)bytes, nullptr, GL_STREAM_READ);
+          slot->capacity = bytes;
+     }
+     // SDL's own readback leaves its row length behind
+     gl.pixelStorei(GL_PACK_ROW_LENGTH, 0);
+     gl.pixelStorei(GL_PACK_ALIGNMENT, 4);
+     gl.readPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
+     gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+     slot->fence = gl.fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+     if (slot->fence == nullptr)
+     {
+          SDL_SetError("glFenceSync failed");
+          readback.failed++;
+          return false;
+     }
+     slot->width = width;
+     slot->height = height;
+     slot->flipped = flipped;
+     slot->sequence = readback.sequence++;
+     slot->done = done;
+     slot->userdata = userdata;
+     slot->tag = tag;
+     return true;
+}
+
+int frameReadbackCollect(FrameReadback &readback)
+{
+     int delivered = 0;
+     while (readback.async)
+     {
+          // In request order: a later readback never overtakes an earlier one
+          FrameReadbackSlot *slot = oldestInFlight(readback);
+          if (slot == nullptr)
+          {
+               break;
+          }
+          const GLenum status = readbackGl.clientWaitSync((GLsync)slot->fence, 0, 0);
+          if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+          {
+               break;
+          }
+          deliver(readback, *slot);
+          delivered++;
+     }
+     return delivered;
+}
+
+int frameReadbackPending(const FrameReadback &readback)
+{
+     int pending = 0;
+     for (const FrameReadbackSlot &slot : readback.slots)
+     {
+          pending += slot.fence != nullptr ? 1 : 0;
+     }
+     return pending;
+}
+
+void frameReadbackFinish(FrameReadback &readback)
+{
+     while (FrameReadbackSlot *slot = readback.async ? oldestInFlight(readback) : nullptr)
+     {
+          readbackGl.clientWaitSync((GLsync)slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+          deliver(readback, *slot);
+     }
+}
+
+void frameReadbackDestroy(FrameReadback &readback)
+{
+     if (!readback.async)
+     {
+          return;
+     }
+     frameReadbackFinish(readback);
+     for (FrameReadbackSlot &slot : readback.slots)
+     {
+          if (slot.buffer != 0)
+          {
+               readbackGl.deleteBuffers(1, &slot.buffer);
+               slot.buffer = 0;
+          }
+     }
+     readback.async = false;
+}
@@ -0,0 +1,86 @@
+// Description:
+// Reading finished frames back without stalling. SDL_RenderReadPixels waits
+// for the GPU to finish everything queued before it and then copies the
+// pixels, so a capture every frame serializes CPU and GPU and roughly
+// halves the frame rate.
+//
+// On the OpenGL renderer a request instead starts a glReadPixels into one
+// of FRAME_READBACK_SLOTS pixel pack buffers and puts a fence after it; the
+// copy runs on the GPU in order with the frame's drawing. Once per frame,
+// frameReadbackCollect() checks the fences without waiting and hands each
+// finished frame to its callback, usually one or two frames later. Only
+// when every slot is still in flight does a request wait, for the oldest,
+// and that is counted in `stalls`.
+//
+// As with gpu_timer, SDL 2 only exposes a native context for the OpenGL
+// renderer (GL_ARB_pixel_buffer_object, GL_ARB_map_buffer_range and
+// GL_ARB_sync; core in GL 3.2). On other renderers a request falls back to
+// SDL_RenderReadPixels and the callback runs straight away.
+//
+// A request reads the current render target, or the whole window when
+// there is none, and must come after drawing and before
+// SDL_RenderPresent. Frames arrive as SDL_PIXELFORMAT_RGB888 surfaces from
+// the surface pool, top row first; the callback owns them.
+// =============================================================================
+
+#ifndef FRAME_READBACK_H
+#define FRAME_READBACK_H
+
+#include <SDL2/SDL.h>
+
+#include "surface_pool.h"
+
+const int FRAME_READBACK_SLOTS = 4; // Readbacks in flight at once
+
+// `frame` is the read back image; `tag` is the tag the request was given
+typedef void (*FrameReadbackDone)(void *userdata, SDL_Surface *frame, int tag);
+
+struct FrameReadbackSlot
+{
+     Uint32 buffer; // GL pixel pack buffer, 0 until first used
+     size_t capacity;
+     void *fence; // GLsync, nullptr while the slot is free
+     int width, height;
+     bool flipped; // Read from the window, so bottom row first
+     Uint64 sequence;
+     FrameReadbackDone done;
+     void *userdata;
+     int tag;
+};
+
+struct FrameReadback
+{
+     SDL_Renderer *renderer;
+     SurfacePool *surfaces;
+     bool async; // Pixel pack buffers in use; false means synchronous reads
+     FrameReadbackSlot slots[FRAME_READBACK_SLOTS];
+     Uint64 sequence; // Requests made
+
+     int completed;
+     int stalls; // Requests that had to wait for a slot
+     int failed;
+};
+
+// Returns whether readbacks are asynchronous on `renderer`; either way the
+// readback is usable. `surfaces` must outlive it
+bool frameReadbackInit(FrameReadback &readback, SDL_Renderer *renderer, SurfacePool &surfaces);
+
+// Start reading the current target; `done` runs from a later
+// frameReadbackCollect() (or before this returns, when synchronous). False
+// with SDL's error set if the read could not be started
+bool frameReadbackRequest(FrameReadback &readback, FrameReadbackDone done, void *userdata, int tag = 0);
+
+// Once per frame: deliver every readback the GPU has finished. Returns how
+// many were delivered
+int frameReadbackCollect(FrameReadback &readback);
+
+// Readbacks still in flight
+int frameReadbackPending(const FrameReadback &readback);
+
+// Wait for and deliver every readback in flight
+void frameReadbackFinish(FrameReadback &readback);
+
+// Waits for and delivers the readbacks in flight, then frees the buffers
+void frameReadbackDestroy(FrameReadback &readback);
+
+#endif // FRAME_READBACK_H
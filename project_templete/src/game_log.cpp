@@ -0,0 +1,150 @@
+#include "game_log.h"
+
+#include "utf_convert.h"
+
+namespace
+{
+     const Uint64 LINE_VISIBLE_MS = 5000;
+
+     void writeSummary(GameLog &log)
+     {
+          char summary[GAME_LOG_MAX_EVENTS * 40];
+          size_t used = 0;
+          summary[0] = '\0';
+          for (int i = 0; i < log.eventCount; i++)
+          {
+               GameLogEvent &event = log.events[i];
+               if (event.count == event.reported)
+               {
+                    continue;
+               }
+               const int written = SDL_snprintf(summary + used, sizeof(summary) - used, "%s%s +%u (%u)",
+                                                used > 0 ? ", " : "", event.name, event.count - event.reported,
+                                                event.count);
+               used = SDL_min(used + (size_t)SDL_max(written, 0), sizeof(summary) - 1);
+               event.reported = event.count;
+          }
+          if (used > 0)
+          {
+               asyncLog(log.category, SDL_LOG_PRIORITY_INFO, "%s", (const char *)summary);
+          }
+     }
+
+     void rebuildText(GameLog &log, Uint64 now)
+     {
+          size_t used = 0;
+          log.text[0] = '\0';
+          log.textExpires = ~(Uint64)0;
+          for (int i = 0; i < log.eventCount; i++)
+          {
+               const int written = SDL_snprintf(log.text + used, sizeof(log.text) - used, "%s%s %u",
+                                                i > 0 ? "  " : "", log.events[i].name, log.events[i].count);
+               used = SDL_min(used + (size_t)SDL_max(written, 0), sizeof(log.text) - 1);
+          }
+          for (int i = 0; i < GAME_LOG_LINES; i++)
+          {
+               const int line = (log.nextLine + i) % GAME_LOG_LINES;
+               if (log.lines[line][0] != '\0' && now - log.lineTicks[line] < LINE_VISIBLE_MS)
+               {
+                    const int written = SDL_snprintf(log.text + used, sizeof(log.text) - used, "%s%s",
+                                                     used > 0 ? "\n" : "", log.lines[line]);
+                    used = SDL_min(used + (size_t)SDL_max(written, 0), sizeof(log.text) - 1);
+                    log.textExpires = SDL_min(log.textExpires, log.lineTicks[line] + LINE_VISIBLE_MS);
+               }
+          }
+          utfDecode(log.text, log.codepoints);
+          log.textStale = false;
+     }
+}
+
+void gameLogInit(GameLog &log, GlyphCache *glyphs, int fontId, int category, Uint32 summaryMs)
+{
+     log.category = category;
+     log.summaryMs = summaryMs;
+     log.lastSummary = SDL_GetTicks64();
+     log.eventCount = 0;
+     for (int i = 0; i < GAME_LOG_LINES; i++)
+     {
+          log.lines[i][0] = '\0';
+          log.lineTicks[i] = 0;
+     }
+     log.nextLine = 0;
+     log.glyphs = glyphs;
+     log.fontId = fontId;
+     log.text[0] = '\0';
+     log.textExpires = 0;
+     log.textStale = true;
+     log.visible = false;
+}
+
+int gameLogAddEvent(GameLog &log, const char *name)
+{
+     if (log.eventCount >= GAME_LOG_MAX_EVENTS)
+     {
+          return -1;
+     }
+     GameLogEvent &event = log.events[log.eventCount];
+     event.name = name;
+     event.count = 0;
+     event.reported = 0;
+     log.textStale = true;
+     return log.eventCount++;
+}
+
+void gameLogUpdate(GameLog &log)
+{
+     const Uint64 now = SDL_GetTicks64();
+     if (now - log.lastSummary >= log.summaryMs)
+     {
+          log.lastSummary = now;
+          writeSummary(log);
+     }
+}
+
+void gameLogFlush(GameLog &log)
+{
+     log.lastSummary = SDL_GetTicks64();
+     writeSummary(log);
+}
+
+void gameLogWrite(GameLog &log, SDL_LogPriority priority, const char *format, const LogArg *args, int count)
+{
+     gameLogFlush(log);
+     asyncLogWrite(log.category, priority, format, args, count);
+
+     // Rare enough to format here as well, for the overlay
+     char *line = log.lines[log.nextLine];
+     asyncLogFormat(line, GAME_LOG_LINE_BYTES, format, args, count);
+     log.lineTicks[log.nextLine] = SDL_GetTicks64();
+     log.nextLine = (log.nextLine + 1) % GAME_LOG_LINES;
+     log.textStale = true;
+}
+
+void gameLogDraw(GameLog &log, RenderQueue &queue, float x, float bottom)
+{
+     if (!log.visible || log.glyphs == nullptr || log.fontId < 0)
+     {
+          return;
+     }
+
+     // A message that just aged out drops off the overlay too
+     const Uint64 now = SDL_GetTicks64();
+     if (log.textStale || now >= log.textExpires)
+     {
+          rebuildText(log, now);
+     }
+     if (log.text[0] == '\0')
+     {
+          return;
+     }
+
+     int w, h;
+     glyphCacheMeasureCodepoints(*log.glyphs, log.fontId, log.codepoints.data(), log.codepoints.size(), &w, &h);
+
+     const SDL_Color shade = {0, 0, 0, 160};
+     const SDL_Color white = {255, 255, 255, 255};
+     const float y = bottom - h;
+     SDL_FRect background = {x - 4.0f, y - 2.0f, w + 8.0f, h + 4.0f};
+     renderQueueFillRect(queue, background, shade);
+     glyphCacheDrawCodepoints(*log.glyphs, queue, log.fontId, log.codepoints.data(), log.codepoints.size(), x, y, white);
+}
@@ -0,0 +1,97 @@
+// Description:
+// Gameplay event log. Frequent events (a catch, a miss) only bump a
+// counter; once per summary interval the counts that moved go out as a
+// single async_log line, "caught +3 (41), missed +1 (2)", so a burst of
+// events costs the game thread nothing but increments. Rare messages
+// (game over) go out at once through asyncLog(), formatted by the log
+// thread. The counters and the last few messages can also be drawn from
+// the glyph cache, like the profiler overlay.
+// =============================================================================
+
+#ifndef GAME_LOG_H
+#define GAME_LOG_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "async_log.h"
+#include "glyph_cache.h"
+#include "render_queue.h"
+
+#define GAME_LOG_MAX_EVENTS 16
+#define GAME_LOG_LINES 4
+#define GAME_LOG_LINE_BYTES 96
+
+struct GameLogEvent
+{
+     const char *name; // Not copied; a string literal
+     Uint32 count;
+     Uint32 reported; // `count` at the last summary
+};
+
+struct GameLog
+{
+     int category;
+     Uint32 summaryMs;
+     Uint64 lastSummary; // SDL_GetTicks64() of the last summary
+     GameLogEvent events[GAME_LOG_MAX_EVENTS];
+     int eventCount;
+
+     // The most recent messages for the overlay, oldest overwritten
+     char lines[GAME_LOG_LINES][GAME_LOG_LINE_BYTES];
+     Uint64 lineTicks[GAME_LOG_LINES];
+     int nextLine;
+
+     GlyphCache *glyphs;
+     int fontId;
+     char text[GAME_LOG_MAX_EVENTS * 24 + GAME_LOG_LINES * (GAME_LOG_LINE_BYTES + 1)];
+     std::vector<Uint32> codepoints; // `text` decoded when it is rebuilt, for each draw
+     Uint64 textExpires; // When the oldest message shown ages out
+     bool textStale;
+     bool visible;
+};
+
+void gameLogInit(GameLog &log, GlyphCache *glyphs, int fontId, int category = SDL_LOG_CATEGORY_APPLICATION,
+                 Uint32 summaryMs = 1000);
+
+// Register a counted event; -1 once GAME_LOG_MAX_EVENTS are in use
+int gameLogAddEvent(GameLog &log, const char *name);
+
+inline void gameLogCount(GameLog &log, int event, Uint32 times = 1)
+{
+     if (event >= 0 && event < log.eventCount)
+     {
+          log.events[event].count += times;
+          log.textStale = true;
+     }
+}
+
+inline Uint32 gameLogTotal(const GameLog &log, int event)
+{
+     return event >= 0 && event < log.eventCount ? log.events[event].count : 0;
+}
+
+// Once a frame: writes the summary when the interval has passed and a
+// count moved since the last one. A loop that schedules the summary on a
+// timer calls gameLogFlush() when it fires instead
+void gameLogUpdate(GameLog &log);
+
+// Write the summary now if a count moved, whatever the interval
+void gameLogFlush(GameLog &log);
+
+// The message behind gameLogLine(): flushes pending counts first, so the
+// console reads in the order things happened
+void gameLogWrite(GameLog &log, SDL_LogPriority priority, const char *format, const LogArg *args, int count);
+
+template <typename... Args>
+void gameLogLine(GameLog &log, const char *format, const Args &...args)
+{
+     const LogArg packed[] = {logArg(args)..., logArg(0)};
+     gameLogWrite(log, SDL_LOG_PRIORITY_INFO, format, packed, (int)sizeof...(Args));
+}
+
+// Queue the counters and the messages of the last few seconds with their
+// bottom-left corner at (x, bottom)
+void gameLogDraw(GameLog &log, RenderQueue &queue, float x, float bottom);
+
+#endif // GAME_LOG_H
@@ -0,0 +1,556 @@
+#include "gesture_recognizer.h"
+
+#include "event_watch.h"
+
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define GESTURE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+     const float GESTURE_SIZE = 256.0f; // Normalized strokes span this, as SDL's DOLLARSIZE
+     const float PHI = 0.618033989f;
+     const float SEARCH_HALF_RANGE = (float)M_PI / 4;
+     const float SEARCH_STEP = (float)M_PI / 90;
+
+     const EventTypeRange WATCHED_GESTURE_EVENTS[] = {{SDL_FINGERDOWN, SDL_FINGERMOTION}};
+
+     // Mean distance from the stroke, rotated by angle[k], to template k of
+     // the group, for all four templates at once
+     void groupDistance(const GestureTemplateGroup &group, const float *px, const float *py, const float *angle,
+                        float *distance)
+     {
+          float c[GESTURE_GROUP_TEMPLATES], s[GESTURE_GROUP_TEMPLATES];
+          for (int k = 0; k < GESTURE_GROUP_TEMPLATES; k++)
+          {
+               c[k] = SDL_cosf(angle[k]);
+               s[k] = SDL_sinf(angle[k]);
+          }
+#if defined(GESTURE_SSE2)
+          const __m128 cosines = _mm_loadu_ps(c), sines = _mm_loadu_ps(s);
+          __m128 sum = _mm_setzero_ps();
+          for (int i = 0; i < GESTURE_POINTS; i++)
+          {
+               const __m128 x = _mm_set1_ps(px[i]), y = _mm_set1_ps(py[i]);
+               const __m128 dx = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(x, cosines), _mm_mul_ps(y, sines)),
+                                            _mm_loadu_ps(group.x[i]));
+               const __m128 dy = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(x, sines), _mm_mul_ps(y, cosines)),
+                                            _mm_loadu_ps(group.y[i]));
+               sum = _mm_add_ps(sum, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))));
+          }
+          _mm_storeu_ps(distance, _mm_mul_ps(sum, _mm_set1_ps(1.0f / GESTURE_POINTS)));
+#else
+          float sum[GESTURE_GROUP_TEMPLATES] = {};
+          for (int i = 0; i < GESTURE_POINTS; i++)
+          {
+               for (int k = 0; k < GESTURE_GROUP_TEMPLATES; k++)
+               {
+                    const float dx = px[i] * c[k] - py[i] * s[k] - group.x[i][k];
+                    const float dy = px[i] * s[k] + py[i] * c[k] - group.y[i][k];
+                    sum[k] += SDL_sqrtf(dx * dx + dy * dy);
+               }
+          }
+          for (int k = 0; k < GESTURE_GROUP_TEMPLATES; k++)
+          {
+               distance[k] = sum[k] / GESTURE_POINTS;
+          }
+#endif
+     }
+
+     // SDL's golden-section search over the rotation, one lane per template.
+     // Every step narrows every lane's range by PHI, so the lanes take the
+     // same number of steps and share each groupDistance() call
+     void groupBestDistance(const GestureTemplateGroup &group, const float *px, const float *py, float *best)
+     {
+          float ta[GESTURE_GROUP_TEMPLATES], tb[GESTURE_GROUP_TEMPLATES];
+          float x1[GESTURE_GROUP_TEMPLATES], x2[GESTURE_GROUP_TEMPLATES];
+          float f1[GESTURE_GROUP_TEMPLATES], f2[GESTURE_GROUP_TEMPLATES];
+          for (int k = 0; k < GESTURE_GROUP_TEMPLATES; k++)
+          {
+               ta[k] = -SEARCH_HALF_RANGE;
+               tb[k] = SEARCH_HALF_RANGE;
+               x1[k] = PHI * ta[k] + (1 - PHI) * tb[k];
+               x2[k] = (1 - PHI) * ta[k] + PHI * tb[k];
+          }
+          groupDistance(group, px, py, x1, f1);
+          groupDistance(group, px, py, x2, f2);
+
+          for (float range = 2 * SEARCH_HALF_RANGE; range > SEARCH_STEP; range *= PHI)
+          {
+               bool lower[GESTURE_GROUP_TEMPLATES];
+               float probe[GESTURE_GROUP_TEMPLATES], fp[GESTURE_GROUP_TEMPLATES];
+               for (int k = 0; k < GESTURE_GROUP_TEMPLATES; k++)
+               {
+                    lower[k] = f1[k] < f2[k];
+                    if (lower[k])
+                    {
+                         tb[k] = x2[k];
+                         x2[k] = x1[k];
+                         f2[k] = f1[k];
+                         probe[k] = PHI * ta[k] + (1 - PHI) * tb[k];
+                    }
+                    else
+                    {
+                         ta[k] = x1[k];
+                         x1[k] = x2[k];
+                         f1[k] = f2[k];
+                         probe[k] = (1 - PHI) * ta[k] + PHI * tb[k];
+                    }
+               }
+               groupDistance(group, px, py, probe, fp);
+               for (int k = 0; k < GESTURE_GROUP_TEMPLATES; k++)
+               {
+                    if (lower[k])
+                    {
+                         x1[k] = probe[k];
+                         f1[k] = fp[k];
+                    }
+                    else
+                    {
+                         x2[k] = probe[k];
+                         f2[k] = fp[k];
+                    }
+               }
+          }
+          for (int k = 0; k < GESTURE_GROUP_TEMPLATES; k++)
+          {
+               best[k] = SDL_min(f1[k], f2[k]);
+          }
+     }
+
+     Sint64 hashPoints(const SDL_FPoint *points)
+     {
+          Uint32 hash = 5381;
+          for (int i = 0; i < GESTURE_POINTS; i++)
+          {
+               hash = (hash << 5) + hash + (Uint32)(Sint32)points[i].x;
+               hash = (hash << 5) + hash + (Uint32)(Sint32)points[i].y;
+          }
+          return hash;
+     }
+
+     void pushResult(Uint32 type, const GestureStroke &stroke, Sint64 gestureId, float error)
+     {
+          SDL_Event event;
+          SDL_zero(event);
+          event.dgesture.type = type;
+          event.dgesture.touchId = stroke.touchId;
+          event.dgesture.gestureId = gestureId;
+          event.dgesture.numFingers = (Uint32)stroke.fingers;
+          event.dgesture.error = error;
+          event.dgesture.x = stroke.x;
+          event.dgesture.y = stroke.y;
+          SDL_PushEvent(&event);
+     }
+
+     void processStroke(GestureRecognizer &recognizer, const GestureStroke &stroke)
+     {
+          SDL_FPoint points[GESTURE_POINTS];
+          const bool normalized = gestureNormalize(stroke.path.data(), (int)stroke.path.size(), points);
+          if (stroke.record)
+          {
+               pushResult(SDL_DOLLARRECORD, stroke, normalized ? gestureAddTemplate(recognizer, points) : -1, 0.0f);
+               return;
+          }
+          if (!normalized)
+          {
+               return;
+          }
+
+          const Uint64 start = SDL_GetPerformanceCounter();
+          SDL_LockMutex(recognizer.templateLock);
+          float error = 0.0f;
+          const int best = gestureMatch(recognizer, points, &error);
+          const Sint64 gestureId = best >= 0 ? recognizer.ids[best] : -1;
+          SDL_UnlockMutex(recognizer.templateLock);
+          SDL_AtomicSet(&recognizer.matchUsec,
+                        (int)((SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency()));
+          if (best >= 0)
+          {
+               SDL_AtomicAdd(&recognizer.matched, 1);
+               pushResult(SDL_DOLLARGESTURE, stroke, gestureId, error);
+          }
+     }
+
+     int SDLCALL gestureWorkerMain(void *data)
+     {
+          GestureRecognizer &recognizer = *(GestureRecognizer *)data;
+          SDL_LockMutex(recognizer.lock);
+          for (;;)
+          {
+               while (!recognizer.quitting && recognizer.pending.empty())
+               {
+                    SDL_CondWait(recognizer.wake, recognizer.lock);
+               }
+               if (recognizer.quitting)
+               {
+                    break;
+               }
+               GestureStroke stroke = std::move(recognizer.pending.front());
+               recognizer.pending.pop_front();
+               SDL_UnlockMutex(recognizer.lock);
+               processStroke(recognizer, stroke);
+               SDL_LockMutex(recognizer.lock);
+          }
+          SDL_UnlockMutex(recognizer.lock);
+          return 0;
+     }
+
+     GestureTouch &findTouch(GestureRecognizer &recognizer, SDL_TouchID touchId)
+     {
+          for (GestureTouch &touch : recognizer.touches)
+          {
+               if (touch.touchId == touchId)
+               {
+                    return touch;
+               }
+          }
+          recognizer.touches.push_back(GestureTouch());
+          GestureTouch &touch = recognizer.touches.back();
+          touch.touchId = touchId;
+          touch.fingersDown = 0;
+          return touch;
+     }
+
+     SDL_FPoint fingerCentroid(const GestureTouch &touch)
+     {
+          SDL_FPoint centroid = {0.0f, 0.0f};
+          for (const SDL_FPoint &p : touch.positions)
+          {
+               centroid.x += p.x;
+               centroid.y += p.y;
+          }
+          const float count = (float)SDL_max((int)touch.positions.size(), 1);
+          return {centroid.x / count, centroid.y / count};
+     }
+
+     void appendCentroid(GestureTouch &touch)
+     {
+          if (touch.stroke.path.size() < GESTURE_MAX_PATH)
+          {
+               touch.stroke.path.push_back(fingerCentroid(touch));
+          }
+     }
+
+     int SDLCALL gestureWatch(void *userdata, SDL_Event *event)
+     {
+          GestureRecognizer &recognizer = *(GestureRecognizer *)userdata;
+          const SDL_TouchFingerEvent &finger = event->tfinger;
+          GestureTouch &touch = findTouch(recognizer, finger.touchId);
+          size_t index = 0;
+          while (index < touch.fingers.size() && touch.fingers[index] != finger.fingerId)
+          {
+               index++;
+          }
+
+          switch (event->type)
+          {
+          case SDL_FINGERDOWN:
+               if (touch.fingersDown == 0)
+               {
+                    touch.stroke.touchId = touch.touchId;
+                    touch.stroke.fingers = 0;
+                    touch.stroke.record = recognizer.recording &&
+                                          (recognizer.recordTouch == -1 || recognizer.recordTouch == touch.touchId);
+                    if (touch.stroke.record)
+                    {
+                         recognizer.recording = false;
+                    }
+                    touch.stroke.path.clear();
+                    touch.fingers.clear();
+                    touch.positions.clear();
+                    index = 0;
+               }
+               if (index == touch.fingers.size())
+               {
+                    touch.fingers.push_back(finger.fingerId);
+                    touch.positions.push_back({finger.x, finger.y});
+                    touch.fingersDown++;
+                    touch.stroke.fingers = SDL_max(touch.stroke.fingers, touch.fingersDown);
+               }
+               appendCentroid(touch);
+               break;
+          case SDL_FINGERMOTION:
+               if (index < touch.fingers.size())
+               {
+                    touch.positions[index] = {finger.x, finger.y};
+                    appendCentroid(touch);
+               }
+               break;
+          case SDL_FINGERUP:
+               if (index < touch.fingers.size())
+               {
+                    touch.positions[index] = {finger.x, finger.y};
+                    const SDL_FPoint centroid = fingerCentroid(touch);
+                    touch.fingers.erase(touch.fingers.begin() + index);
+                    touch.positions.erase(touch.positions.begin() + index);
+                    if (--touch.fingersDown == 0)
+                    {
+                         touch.stroke.x = centroid.x;
+                         touch.stroke.y = centroid.y;
+                         SDL_LockMutex(recognizer.lock);
+                         recognizer.pending.push_back(std::move(touch.stroke));
+                         SDL_CondSignal(recognizer.wake);
+                         SDL_UnlockMutex(recognizer.lock);
+                         touch.stroke.path.clear();
+                    }
+               }
+               break;
+          default:
+               break;
+          }
+          return 1;
+     }
+}
+
+bool gestureRecognizerInit(GestureRecognizer &recognizer)
+{
+     recognizer.worker = nullptr;
+     recognizer.watching = false;
+     recognizer.groups.clear();
+     recognizer.ids.clear();
+     recognizer.templateCount = 0;
+     recognizer.pending.clear();
+     recognizer.quitting = false;
+     recognizer.touches.clear();
+     recognizer.recording = false;
+     recognizer.recordTouch = -1;
+     SDL_AtomicSet(&recognizer.matched, 0);
+     SDL_AtomicSet(&recognizer.matchUsec, 0);
+
+     recognizer.templateLock = SDL_CreateMutex();
+     recognizer.lock = SDL_CreateMutex();
+     recognizer.wake = SDL_CreateCond();
+     if (recognizer.templateLock != nullptr && recognizer.lock != nullptr && recognizer.wake != nullptr)
+     {
+          recognizer.worker = SDL_CreateThread(gestureWorkerMain, "GestureMatch", &recognizer);
+     }
+     if (recognizer.worker != nullptr)
+     {
+          recognizer.watching = eventWatchAdd(gestureWatch, &recognizer, "gesture", WATCHED_GESTURE_EVENTS,
+                                              SDL_arraysize(WATCHED_GESTURE_EVENTS));
+     }
+     if (!recognizer.watching)
+     {
+          gestureRecognizerQuit(recognizer);
+          return false;
+     }
+     return true;
+}
+
+void gestureRecord(GestureRecognizer &recognizer, SDL_TouchID touchId)
+{
+     recognizer.recording = true;
+     recognizer.recordTouch = touchId;
+}
+
+int gestureLoadTemplates(GestureRecognizer &recognizer, SDL_RWops *src)
+{
+     if (src == nullptr)
+     {
+          SDL_SetError("gesture_recognizer: no template source");
+          return -1;
+     }
+     int loaded = 0;
+     SDL_FPoint points[GESTURE_POINTS];
+     while (SDL_RWread(src, points, sizeof(points[0]), GESTURE_POINTS) == GESTURE_POINTS)
+     {
+#if SDL_BYTEORDER != SDL_LIL_ENDIAN
+          for (SDL_FPoint &p : points)
+          {
+               p.x = SDL_SwapFloatLE(p.x);
+               p.y = SDL_SwapFloatLE(p.y);
+          }
+#endif
+          gestureAddTemplate(recognizer, points);
+          loaded++;
+     }
+     return loaded;
+}
+
+int gestureSaveTemplates(GestureRecognizer &recognizer, SDL_RWops *dst)
+{
+     if (dst == nullptr)
+     {
+          SDL_SetError("gesture_recognizer: no template destination");
+          return -1;
+     }
+     SDL_LockMutex(recognizer.templateLock);
+     int saved = 0;
+     for (; saved < recognizer.templateCount; saved++)
+     {
+          const GestureTemplateGroup &group = recognizer.groups[saved / GESTURE_GROUP_TEMPLATES];
+          const int lane = saved % GESTURE_GROUP_TEMPLATES;
+          SDL_FPoint points[GESTURE_POINTS];
+          for (int i = 0; i < GESTURE_POINTS; i++)
+          {
+               points[i] = {SDL_SwapFloatLE(group.x[i][lane]), SDL_SwapFloatLE(group.y[i][lane])};
+          }
+          if (SDL_RWwrite(dst, points, sizeof(points[0]), GESTURE_POINTS) != GESTURE_POINTS)
+          {
+               saved = -1;
+               break;
+          }
+     }
+     SDL_UnlockMutex(recognizer.templateLock);
+     return saved;
+}
+
+bool gestureNormalize(const SDL_FPoint *path, int count, SDL_FPoint *points)
+{
+     float length = 0.0f;
+     for (int i = 1; i < count; i++)
+     {
+          const float dx = path[i].x - path[i - 1].x, dy = path[i].y - path[i - 1].y;
+          length += SDL_sqrtf(dx * dx + dy * dy);
+     }
+     if (count < 2 || length <= 0.0f)
+     {
+          return false;
+     }
+
+     // Resample at equal distances along the stroke; the first sample is
+     // the first point, and the last point closes it off
+     const float interval = length / (GESTURE_POINTS - 1);
+     float carried = interval;
+     int n = 0;
+     for (int i = 1; i < count && n < GESTURE_POINTS - 1; i++)
+     {
+          const float dx = path[i].x - path[i - 1].x, dy = path[i].y - path[i - 1].y;
+          const float d = SDL_sqrtf(dx * dx + dy * dy);
+          while (carried + d > interval && n < GESTURE_POINTS - 1)
+          {
+               const float t = (interval - carried) / d;
+               points[n++] = {path[i - 1].x + t * dx, path[i - 1].y + t * dy};
+               carried -= interval;
+          }
+          carried += d;
+     }
+     if (n < GESTURE_POINTS - 1)
+     {
+          return false;
+     }
+     points[GESTURE_POINTS - 1] = path[count - 1];
+
+     SDL_FPoint centroid = {0.0f, 0.0f};
+     for (int i = 0; i < GESTURE_POINTS; i++)
+     {
+          centroid.x += points[i].x;
+          centroid.y += points[i].y;
+     }
+     centroid.x /= GESTURE_POINTS;
+     centroid.y /= GESTURE_POINTS;
+
+     // Turn the first point to the left of the centroid, then scale the
+     // bounding box to GESTURE_SIZE around it
+     const float angle = SDL_atan2f(centroid.y - points[0].y, centroid.x - points[0].x);
+     const float c = SDL_cosf(angle), s = SDL_sinf(angle);
+     float xmin = centroid.x, xmax = centroid.x, ymin = centroid.y, ymax = centroid.y;
+     for (int i = 0; i < GESTURE_POINTS; i++)
+     {
+          const float px = points[i].x - centroid.x, py = points[i].y - centroid.y;
+          points[i] = {px * c - py * s + centroid.x, px * s + py * c + centroid.y};
+          xmin = SDL_min(xmin, points[i].x);
+          xmax = SDL_max(xmax, points[i].x);
+          ymin = SDL_min(ymin, points[i].y);
+          ymax = SDL_max(ymax, points[i].y);
+     }
+     const float sx = GESTURE_SIZE / SDL_max(xmax - xmin, 1e-6f), sy = GESTURE_SIZE / SDL_max(ymax - ymin, 1e-6f);
+     for (int i = 0; i < GESTURE_POINTS; i++)
+     {
+          points[i] = {(points[i].x - centroid.x) * sx, (points[i].y - centroid.y) * sy};
+     }
+     return true;
+}
+
+Sint64 gestureAddTemplate(GestureRecognizer &recognizer, const SDL_FPoint *points)
+{
+     const Sint64 gestureId = hashPoints(points);
+     SDL_LockMutex(recognizer.templateLock);
+     const int lane = recognizer.templateCount % GESTURE_GROUP_TEMPLATES;
+     if (lane == 0)
+     {
+          recognizer.groups.push_back(GestureTemplateGroup());
+          SDL_zero(recognizer.groups.back());
+     }
+     GestureTemplateGroup &group = recognizer.groups.back();
+     for (int i = 0; i < GESTURE_POINTS; i++)
+     {
+          group.x[i][lane] = points[i].x;
+          group.y[i][lane] = points[i].y;
+     }
+     recognizer.ids.push_back(gestureId);
+     recognizer.templateCount++;
+     SDL_UnlockMutex(recognizer.templateLock);
+     return gestureId;
+}
+
+int gestureMatch(const GestureRecognizer &recognizer, const SDL_FPoint *points, float *error)
+{
+     float px[GESTURE_POINTS], py[GESTURE_POINTS];
+     for (int i = 0; i < GESTURE_POINTS; i++)
+     {
+          px[i] = points[i].x;
+          py[i] = points[i].y;
+     }
+
+     int best = -1;
+     float bestDistance = 0.0f;
+     for (size_t g = 0; g < recognizer.groups.size(); g++)
+     {
+          float distance[GESTURE_GROUP_TEMPLATES];
+          groupBestDistance(recognizer.groups[g], px, py, distance);
+          // The last group's unused lanes hold zeros and are never picked
+          for (int k = 0; k < GESTURE_GROUP_TEMPLATES; k++)
+          {
+               const int index = (int)g * GESTURE_GROUP_TEMPLATES + k;
+               if (index < recognizer.templateCount && (best < 0 || distance[k] < bestDistance))
+               {
+                    best = index;
+                    bestDistance = distance[k];
+               }
+          }
+     }
+     if (error != nullptr)
+     {
+          *error = bestDistance;
+     }
+     return best;
+}
+
+void gestureRecognizerQuit(GestureRecognizer &recognizer)
+{
+     if (recognizer.watching)
+     {
+          eventWatchDel(gestureWatch, &recognizer);
+          recognizer.watching = false;
+     }
+     if (recognizer.worker != nullptr)
+     {
+          SDL_LockMutex(recognizer.lock);
+          recognizer.quitting = true;
+          SDL_CondSignal(recognizer.wake);
+          SDL_UnlockMutex(recognizer.lock);
+          SDL_WaitThread(recognizer.worker, nullptr);
+          recognizer.worker = nullptr;
+     }
+     if (recognizer.wake != nullptr)
+     {
+          SDL_DestroyCond(recognizer.wake);
+          recognizer.wake = nullptr;
+     }
+     if (recognizer.lock != nullptr)
+     {
+          SDL_DestroyMutex(recognizer.lock);
+          recognizer.lock = nullptr;
+     }
+     if (recognizer.templateLock != nullptr)
+     {
+          SDL_DestroyMutex(recognizer.templateLock);
+          recognizer.templateLock = nullptr;
+     }
+     recognizer.pending.clear();
+}
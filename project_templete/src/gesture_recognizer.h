@@ -0,0 +1,117 @@
+// Description:
+// $1 gesture recognition off the event thread. SDL_gesture.h matches a
+// finished stroke against every loaded template inside SDL_PumpEvents: a
+// golden-section search over the rotation for each template, with a sine
+// and a cosine per point per step, so a few hundred templates cost
+// milliseconds on every touch-up. A GestureRecognizer does the same
+// matching, differently arranged:
+// - templates are compiled once into groups of four, point by point
+//   (x[i] of four templates side by side), so one SSE2 pass scores four
+//   templates at four angles; the search takes the same number of steps
+//   for every template, so the four stay in lock step;
+// - the rotation is applied with one sine and cosine per step, not per
+//   point;
+// - strokes are resampled, normalized and matched on a thread of its own.
+//
+// An event watch collects each touch device's stroke (the centroid of its
+// fingers, as SDL's gesture code does) and hands it over when the last
+// finger lifts. Results come back from the worker as SDL_DOLLARGESTURE and
+// SDL_DOLLARRECORD events, the same events SDL would send, so existing
+// handlers keep working; `gestureId` is a hash of the template's points.
+// Do not load templates into SDL as well, or both recognize every stroke.
+//
+// Template files are SDL's own (SDL_SaveDollarTemplate): GESTURE_POINTS
+// normalized points per template, so either side reads the other's.
+// =============================================================================
+
+#ifndef GESTURE_RECOGNIZER_H
+#define GESTURE_RECOGNIZER_H
+
+#include <SDL2/SDL.h>
+
+#include <deque>
+#include <vector>
+
+#define GESTURE_POINTS 64       // Points per normalized stroke, as in SDL
+#define GESTURE_MAX_PATH 1024   // Points kept per stroke; later ones are dropped
+#define GESTURE_GROUP_TEMPLATES 4
+
+// Four templates, interleaved point by point
+struct GestureTemplateGroup
+{
+     float x[GESTURE_POINTS][GESTURE_GROUP_TEMPLATES];
+     float y[GESTURE_POINTS][GESTURE_GROUP_TEMPLATES];
+};
+
+struct GestureStroke
+{
+     SDL_TouchID touchId;
+     int fingers;  // Most fingers down at once
+     float x, y;   // Centroid when the last finger lifted
+     bool record;  // Becomes a template instead of being matched
+     std::vector<SDL_FPoint> path;
+};
+
+// One touch device's stroke in progress; main thread only
+struct GestureTouch
+{
+     SDL_TouchID touchId;
+     int fingersDown;
+     std::vector<SDL_FingerID> fingers;
+     std::vector<SDL_FPoint> positions; // By finger, as last seen
+     GestureStroke stroke;
+};
+
+struct GestureRecognizer
+{
+     SDL_Thread *worker;
+     bool watching;
+
+     SDL_mutex *templateLock; // Held by the worker while it matches
+     std::vector<GestureTemplateGroup> groups;
+     std::vector<Sint64> ids; // By template
+     int templateCount;
+
+     SDL_mutex *lock;
+     SDL_cond *wake;
+     std::deque<GestureStroke> pending; // Guarded by lock
+     bool quitting;                     // Guarded by lock
+
+     // Main thread
+     std::vector<GestureTouch> touches;
+     bool recording;
+     SDL_TouchID recordTouch; // Device whose next stroke is recorded, -1 for any
+
+     SDL_atomic_t matched;   // Strokes matched so far
+     SDL_atomic_t matchUsec; // Worker time on the last match
+};
+
+// Start the worker and the event watch. False with SDL's error set
+bool gestureRecognizerInit(GestureRecognizer &recognizer);
+
+// Record the next stroke on `touchId` (-1: on any device) as a template;
+// reported as SDL_DOLLARRECORD, gestureId -1 when the stroke was too short
+void gestureRecord(GestureRecognizer &recognizer, SDL_TouchID touchId);
+
+// Add templates from an SDL template file; returns how many, -1 with
+// SDL's error set. Blocks at most for a match in progress
+int gestureLoadTemplates(GestureRecognizer &recognizer, SDL_RWops *src);
+
+// Write every template in SDL's format; returns how many, -1 on error
+int gestureSaveTemplates(GestureRecognizer &recognizer, SDL_RWops *dst);
+
+// Resample and normalize a raw stroke into GESTURE_POINTS points the way
+// SDL does; false when it is too short to tell anything from
+bool gestureNormalize(const SDL_FPoint *path, int count, SDL_FPoint *points);
+
+// Add one normalized stroke as a template; returns its gestureId
+Sint64 gestureAddTemplate(GestureRecognizer &recognizer, const SDL_FPoint *points);
+
+// Best template for a normalized stroke, on the calling thread: its index,
+// or -1 without templates; `error` is the mean point distance SDL reports.
+// Callers other than the worker hold templateLock
+int gestureMatch(const GestureRecognizer &recognizer, const SDL_FPoint *points, float *error);
+
+void gestureRecognizerQuit(GestureRecognizer &recognizer);
+
+#endif // GESTURE_RECOGNIZER_H
@@ -0,0 +1,431 @@
+#include "gif_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+     const int MAX_CODES = 4096;
+     // Largest screen or frame accepted, 256 MB as ARGB8888; the 16-bit
+     // sizes in the file allow 65535 x 65535
+     const size_t MAX_GIF_PIXELS = (size_t)8192 * 8192;
+
+     enum Disposal
+     {
+          DISPOSE_NONE = 0,
+          DISPOSE_KEEP = 1,
+          DISPOSE_BACKGROUND = 2,
+          DISPOSE_PREVIOUS = 3
+     };
+
+     bool readPalette(SDL_RWops *rw, int entries, std::vector<Uint32> &palette)
+     {
+          std::vector<Uint8> rgb(entries * 3);
+          if (SDL_RWread(rw, rgb.data(), 3, entries) != (size_t)entries)
+          {
+               return false;
+          }
+          palette.resize(entries);
+          for (int i = 0; i < entries; i++)
+          {
+               palette[i] = 0xFF000000 | (rgb[3 * i] << 16) | (rgb[3 * i + 1] << 8) | rgb[3 * i + 2];
+          }
+          return true;
+     }
+
+     bool skipSubBlocks(SDL_RWops *rw)
+     {
+          Uint8 size;
+          while (SDL_RWread(rw, &size, 1, 1) == 1)
+          {
+               if (size == 0)
+               {
+                    return true;
+               }
+               if (SDL_RWseek(rw, size, RW_SEEK_CUR) < 0)
+               {
+                    return false;
+               }
+          }
+          return false;
+     }
+
+     // Bit reader over the image's chain of data sub-blocks
+     struct CodeReader
+     {
+          SDL_RWops *rw;
+          Uint8 block[255];
+          int blockSize, blockPos;
+          Uint32 bits;
+          int bitCount;
+          bool ended;
+
+          int read(int size)
+          {
+               while (bitCount < size)
+               {
+                    if (blockPos == blockSize)
+                    {
+                         Uint8 next;
+                         if (ended || SDL_RWread(rw, &next, 1, 1) != 1 || next == 0 ||
+                             SDL_RWread(rw, block, 1, next) != next)
+                         {
+                              ended = true;
+                              return -1;
+                         }
+                         blockSize = next;
+                         blockPos = 0;
+                    }
+                    bits |= (Uint32)block[blockPos++] << bitCount;
+                    bitCount += 8;
+               }
+               int code = (int)(bits & ((1u << size) - 1));
+               bits >>= size;
+               bitCount -= size;
+               return code;
+          }
+     };
+
+     // LZW-decode one image into palette indices
+     bool decodeIndices(SDL_RWops *rw, size_t pixelCount, std::vector<Uint8> &indices)
+     {
+          Uint8 minCodeSize;
+          if (SDL_RWread(rw, &minCodeSize, 1, 1) != 1 || minCodeSize < 1 || minCodeSize > 11)
+          {
+               return false;
+          }
+
+          static thread_local Uint16 prefix[MAX_CODES];
+          static thread_local Uint8 suffix[MAX_CODES];
+          static thread_local Uint8 first[MAX_CODES];
+          static thread_local Uint8 stack[MAX_CODES + 1];
+
+          const int clear = 1 << minCodeSize;
+          const int end = clear + 1;
+          for (int i = 0; i < clear; i++)
+          {
+               suffix[i] = (Uint8)i;
+               first[i] = (Uint8)i;
+          }
+          int codeSize = minCodeSize + 1;
+          int next = clear + 2;
+          int previous = -1;
+
+          CodeReader reader = {rw, {0}, 0, 0, 0, 0, false};
+          indices.assign(pixelCount, 0);
+          size_t written = 0;
+
+          while (written < pixelCount)
+          {
+               int code = reader.read(codeSize);
+               if (code < 0 || code == end)
+               {
+                    break;
+               }
+               if (code == clear)
+               {
+                    codeSize = minCodeSize + 1;
+                    next = clear + 2;
+                    previous = -1;
+                    continue;
+               }
+
+               if (previous < 0)
+               {
+                    if (code >= clear)
+                    {
+                         return false;
+                    }
+                    indices[written++] = (Uint8)code;
+                    previous = code;
+                    continue;
+               }
+
+               // Unwind the string for `code` onto the stack; the one code not
+               // yet in the table is previous + its own first byte
+               int depth = 0;
+               int walk = code;
+               if (code == next)
+               {
+                    stack[depth++] = first[previous];
+                    walk = previous;
+               }
+               else if (code > next)
+               {
+                    return false;
+               }
+               while (walk >= clear)
+               {
+                    stack[depth++] = suffix[walk];
+                    walk = prefix[walk];
+               }
+               stack[depth++] = (Uint8)walk;
+
+               if (next < MAX_CODES)
+               {
+                    prefix[next] = (Uint16)previous;
+                    suffix[next] = (Uint8)walk;
+                    first[next] = first[previous];
+                    next++;
+                    if (next == (1 << codeSize) && codeSize < 12)
+                    {
+                         codeSize++;
+                    }
+               }
+
+               while (depth > 0 && written < pixelCount)
+               {
+                    indices[written++] = stack[--depth];
+               }
+               previous = code;
+          }
+
+          // Step over whatever is left of the data, including the terminator
+          if (!reader.ended)
+          {
+               skipSubBlocks(rw);
+          }
+          return true;
+     }
+
+     // Rows of an interlaced image arrive in four passes
+     int interlacedRow(int row, int height)
+     {
+          const int start[4] = {0, 4, 2, 1};
+          const int step[4] = {8, 8, 4, 2};
+          for (int pass = 0; pass < 4; pass++)
+          {
+               int rows = (height - start[pass] + step[pass] - 1) / step[pass];
+               if (row < rows)
+               {
+                    return start[pass] + row * step[pass];
+               }
+               row -= rows;
+          }
+          return row;
+     }
+
+     void fillRect(GifDecoder &decoder, const SDL_Rect &rect, Uint32 color)
+     {
+          for (int y = rect.y; y < rect.y + rect.h; y++)
+          {
+               std::fill(&decoder.canvas[(size_t)y * decoder.width + rect.x],
+                         &decoder.canvas[(size_t)y * decoder.width + rect.x + rect.w], color);
+          }
+     }
+}
+
+bool gifDecoderOpen(GifDecoder &decoder, SDL_RWops *rw)
+{
+     decoder.rw = rw;
+     Uint8 header[13];
+     if (rw == nullptr || SDL_RWread(rw, header, 1, 13) != 13 ||
+         (std::memcmp(header, "GIF87a", 6) != 0 && std::memcmp(header, "GIF89a", 6) != 0))
+     {
+          SDL_SetError("Not a GIF file");
+          gifDecoderClose(decoder);
+          return false;
+     }
+     decoder.width = header[6] | (header[7] << 8);
+     decoder.height = header[8] | (header[9] << 8);
+     decoder.loopCount = 1;
+     decoder.globalPalette.clear();
+     if ((header[10] & 0x80) && !readPalette(rw, 2 << (header[10] & 7), decoder.globalPalette))
+     {
+          SDL_SetError("Truncated GIF palette");
+          gifDecoderClose(decoder);
+          return false;
+     }
+     if (decoder.width == 0 || decoder.height == 0 || (size_t)decoder.width * decoder.height > MAX_GIF_PIXELS)
+     {
+          SDL_SetError("Invalid GIF size %dx%d", decoder.width, decoder.height);
+          gifDecoderClose(decoder);
+          return false;
+     }
+     decoder.firstBlock = SDL_RWtell(rw);
+     return gifDecoderRewind(decoder);
+}
+
+int gifDecoderNext(GifDecoder &decoder, void *pixels, int pitch, int *delayMs)
+{
+     SDL_RWops *rw = decoder.rw;
+     int disposal = DISPOSE_NONE;
+     int transparent = -1;
+     int delay = 0;
+
+     for (;;)
+     {
+          Uint8 introducer;
+          if (SDL_RWread(rw, &introducer, 1, 1) != 1 || introducer == 0x3B)
+          {
+               return 0; // Trailer, or a truncated file treated as one
+          }
+
+          if (introducer == 0x21)
+          {
+               Uint8 label;
+               if (SDL_RWread(rw, &label, 1, 1) != 1)
+               {
+                    return -1;
+               }
+               Uint8 block[256];
+               Uint8 size;
+               if (SDL_RWread(rw, &size, 1, 1) != 1 || SDL_RWread(rw, block, 1, size) != size)
+               {
+                    return -1;
+               }
+               if (size == 0)
+               {
+                    continue; // An empty extension; that was its terminator
+               }
+               if (label == 0xF9 && size >= 4)
+               {
+                    disposal = (block[0] >> 2) & 7;
+                    transparent = (block[0] & 1) ? block[3] : -1;
+                    delay = (block[1] | (block[2] << 8)) * 10;
+               }
+               else if (label == 0xFF && size == 11 && std::memcmp(block, "NETSCAPE2.0", 11) == 0)
+               {
+                    Uint8 dataSize;
+                    if (SDL_RWread(rw, &dataSize, 1, 1) != 1)
+                    {
+                         return -1;
+                    }
+                    if (dataSize == 0)
+                    {
+                         continue; // That was the terminator
+                    }
+                    if (SDL_RWread(rw, block, 1, dataSize) != dataSize)
+                    {
+                         return -1;
+                    }
+                    if (dataSize >= 3 && block[0] == 1)
+                    {
+                         decoder.loopCount = block[1] | (block[2] << 8);
+                    }
+               }
+               if (!skipSubBlocks(rw))
+               {
+                    return -1;
+               }
+               continue;
+          }
+
+          if (introducer != 0x2C)
+          {
+               SDL_SetError("Corrupt GIF block 0x%02x", introducer);
+               return -1;
+          }
+
+          Uint8 descriptor[9];
+          if (SDL_RWread(rw, descriptor, 1, 9) != 9)
+          {
+               return -1;
+          }
+          SDL_Rect rect = {descriptor[0] | (descriptor[1] << 8), descriptor[2] | (descriptor[3] << 8),
+                           descriptor[4] | (descriptor[5] << 8), descriptor[6] | (descriptor[7] << 8)};
+          bool interlaced = (descriptor[8] & 0x40) != 0;
+          std::vector<Uint32> localPalette;
+          if ((descriptor[8] & 0x80) && !readPalette(rw, 2 << (descriptor[8] & 7), localPalette))
+          {
+               return -1;
+          }
+          const std::vector<Uint32> &palette = localPalette.empty() ? decoder.globalPalette : localPalette;
+
+          const size_t pixelCount = (size_t)rect.w * rect.h;
+          if (pixelCount > MAX_GIF_PIXELS)
+          {
+               SDL_SetError("GIF frame too large (%dx%d)", rect.w, rect.h);
+               return -1;
+          }
+          std::vector<Uint8> indices;
+          if (!decodeIndices(rw, pixelCount, indices))
+          {
+               SDL_SetError("Corrupt GIF image data");
+               return -1;
+          }
+
+          // Undo the previous frame as its disposal method asks
+          if (decoder.lastDisposal == DISPOSE_BACKGROUND)
+          {
+               fillRect(decoder, decoder.lastRect, 0);
+          }
+          else if (decoder.lastDisposal == DISPOSE_PREVIOUS)
+          {
+               decoder.canvas = decoder.restore;
+          }
+          if (disposal == DISPOSE_PREVIOUS)
+          {
+               decoder.restore = decoder.canvas;
+          }
+
+          // Clip to the logical screen; some encoders overhang it
+          SDL_Rect screen = {0, 0, decoder.width, decoder.height};
+          SDL_Rect visible;
+          if (SDL_IntersectRect(&rect, &screen, &visible))
+          {
+               for (int row = 0; row < rect.h; row++)
+               {
+                    int y = rect.y + (interlaced ? interlacedRow(row, rect.h) : row);
+                    if (y < visible.y || y >= visible.y + visible.h)
+                    {
+                         continue;
+                    }
+                    const Uint8 *source = &indices[(size_t)row * rect.w];
+                    Uint32 *target = &decoder.canvas[(size_t)y * decoder.width];
+                    for (int x = visible.x; x < visible.x + visible.w; x++)
+                    {
+                         int index = source[x - rect.x];
+                         if (index != transparent && index < (int)palette.size())
+                         {
+                              target[x] = palette[index];
+                         }
+                    }
+               }
+          }
+          else
+          {
+               visible = {0, 0, 0, 0};
+          }
+          decoder.lastRect = visible;
+          decoder.lastDisposal = disposal;
+
+          for (int y = 0; y < decoder.height; y++)
+          {
+               std::memcpy((Uint8 *)pixels + (size_t)y * pitch, &decoder.canvas[(size_t)y * decoder.width],
+                           decoder.width * sizeof(Uint32));
+          }
+          if (delayMs)
+          {
+               // Match browsers: near-zero delays play at 10 fps
+               *delayMs = delay < 20 ? 100 : delay;
+          }
+          decoder.frameIndex++;
+          return 1;
+     }
+}
+
+bool gifDecoderRewind(GifDecoder &decoder)
+{
+     if (SDL_RWseek(decoder.rw, decoder.firstBlock, RW_SEEK_SET) < 0)
+     {
+          return false;
+     }
+     decoder.canvas.assign((size_t)decoder.width * decoder.height, 0);
+     decoder.restore.clear();
+     decoder.lastRect = {0, 0, 0, 0};
+     decoder.lastDisposal = DISPOSE_NONE;
+     decoder.frameIndex = 0;
+     return true;
+}
+
+void gifDecoderClose(GifDecoder &decoder)
+{
+     if (decoder.rw != nullptr)
+     {
+          SDL_RWclose(decoder.rw);
+          decoder.rw = nullptr;
+     }
+     decoder.canvas.clear();
+     decoder.restore.clear();
+}
@@ -0,0 +1,44 @@
+// Description:
+// Incremental GIF decoder. Unlike IMG_LoadAnimation, which decodes every
+// frame before returning, frames are decoded one at a time on request and
+// composited onto a persistent canvas (honouring transparency and the
+// GIF89a disposal methods), so memory stays at one canvas regardless of
+// the animation's length.
+// =============================================================================
+
+#ifndef GIF_DECODER_H
+#define GIF_DECODER_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct GifDecoder
+{
+     SDL_RWops *rw;
+     int width, height;
+     int loopCount; // From the NETSCAPE2.0 extension; 0 loops forever
+     std::vector<Uint32> globalPalette;
+
+     std::vector<Uint32> canvas;   // ARGB8888, the composited image
+     std::vector<Uint32> restore;  // Canvas saved for "restore to previous"
+     SDL_Rect lastRect;            // Previous frame's rect and its disposal
+     int lastDisposal;
+
+     Sint64 firstBlock; // Stream offset of the first block after the header
+     int frameIndex;    // Frames decoded since the last rewind
+};
+
+// Takes ownership of `rw`, also on failure
+bool gifDecoderOpen(GifDecoder &decoder, SDL_RWops *rw);
+
+// Decode the next frame into `pixels` (height rows of width ARGB8888 pixels,
+// `pitch` bytes apart). Returns 1 for a frame, 0 at the end of the stream
+// and -1 on error.
+int gifDecoderNext(GifDecoder &decoder, void *pixels, int pitch, int *delayMs);
+
+// Start again from the first frame
+bool gifDecoderRewind(GifDecoder &decoder);
+
+void gifDecoderClose(GifDecoder &decoder);
+
+#endif // GIF_DECODER_H
@@ -0,0 +1,674 @@
+#include "gl_sprites.h"
+
+#include <SDL2/SDL_opengl.h>
+#include <cstddef>
+#include <vector>
+
+#include "program_cache.h"
+
+// GL 1.1 entry points have no PFN typedefs in the headers; everything is
+// loaded through SDL_GL_GetProcAddress so nothing links against opengl32
+typedef void(APIENTRYP GlSpritesClearProc)(GLbitfield mask);
+typedef void(APIENTRYP GlSpritesClearColorProc)(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+typedef void(APIENTRYP GlSpritesViewportProc)(GLint x, GLint y, GLsizei width, GLsizei height);
+typedef void(APIENTRYP GlSpritesEnableProc)(GLenum cap);
+typedef void(APIENTRYP GlSpritesPixelStoreiProc)(GLenum name, GLint param);
+typedef void(APIENTRYP GlSpritesGenTexturesProc)(GLsizei n, GLuint *textures);
+typedef void(APIENTRYP GlSpritesDeleteTexturesProc)(GLsizei n, const GLuint *textures);
+typedef void(APIENTRYP GlSpritesBindTextureProc)(GLenum target, GLuint texture);
+typedef void(APIENTRYP GlSpritesTexParameteriProc)(GLenum target, GLenum name, GLint param);
+typedef void(APIENTRYP GlSpritesGetIntegervProc)(GLenum name, GLint *data);
+typedef const GLubyte *(APIENTRYP GlSpritesGetStringProc)(GLenum name);
+
+// Entry points both paths need, then the two only the 4.4 path does
+#define GL_SPRITES_FUNCTIONS(X)                                                                \
+     X(GlSpritesClearProc, clear, "glClear")                                                   \
+     X(GlSpritesClearColorProc, clearColor, "glClearColor")                                    \
+     X(GlSpritesViewportProc, viewport, "glViewport")                                          \
+     X(GlSpritesEnableProc, enable, "glEnable")                                                \
+     X(GlSpritesPixelStoreiProc, pixelStorei, "glPixelStorei")                                 \
+     X(GlSpritesGenTexturesProc, genTextures, "glGenTextures")                                 \
+     X(GlSpritesDeleteTexturesProc, deleteTextures, "glDeleteTextures")                        \
+     X(GlSpritesBindTextureProc, bindTexture, "glBindTexture")                                 \
+     X(GlSpritesTexParameteriProc, texParameteri, "glTexParameteri")                           \
+     X(GlSpritesGetIntegervProc, getIntegerv, "glGetIntegerv")                                 \
+     X(GlSpritesGetStringProc, getString, "glGetString")                                       \
+     X(PFNGLBLENDFUNCSEPARATEPROC, blendFuncSeparate, "glBlendFuncSeparate")                   \
+     X(PFNGLTEXSTORAGE3DPROC, texStorage3D, "glTexStorage3D")                                  \
+     X(PFNGLTEXSUBIMAGE3DPROC, texSubImage3D, "glTexSubImage3D")                               \
+     X(PFNGLCREATESHADERPROC, createShader, "glCreateShader")                                  \
+     X(PFNGLSHADERSOURCEPROC, shaderSource, "glShaderSource")                                  \
+     X(PFNGLCOMPILESHADERPROC, compileShader, "glCompileShader")                               \
+     X(PFNGLGETSHADERIVPROC, getShaderiv, "glGetShaderiv")                                     \
+     X(PFNGLGETSHADERINFOLOGPROC, getShaderInfoLog, "glGetShaderInfoLog")                      \
+     X(PFNGLDELETESHADERPROC, deleteShader, "glDeleteShader")                                  \
+     X(PFNGLCREATEPROGRAMPROC, createProgram, "glCreateProgram")                               \
+     X(PFNGLATTACHSHADERPROC, attachShader, "glAttachShader")                                  \
+     X(PFNGLLINKPROGRAMPROC, linkProgram, "glLinkProgram")                                     \
+     X(PFNGLGETPROGRAMIVPROC, getProgramiv, "glGetProgramiv")                                  \
+     X(PFNGLGETPROGRAMINFOLOGPROC, getProgramInfoLog, "glGetProgramInfoLog")                   \
+     X(PFNGLPROGRAMPARAMETERIPROC, programParameteri, "glProgramParameteri")                   \
+     X(PFNGLGETPROGRAMBINARYPROC, getProgramBinary, "glGetProgramBinary")                      \
+     X(PFNGLPROGRAMBINARYPROC, programBinary, "glProgramBinary")                               \
+     X(PFNGLDELETEPROGRAMPROC, deleteProgram, "glDeleteProgram")                               \
+     X(PFNGLUSEPROGRAMPROC, useProgram, "glUseProgram")                                        \
+     X(PFNGLGETUNIFORMLOCATIONPROC, getUniformLocation, "glGetUniformLocation")                \
+     X(PFNGLUNIFORM1IPROC, uniform1i, "glUniform1i")                                           \
+     X(PFNGLUNIFORM2FPROC, uniform2f, "glUniform2f")                                           \
+     X(PFNGLUNIFORM4FVPROC, uniform4fv, "glUniform4fv")                                        \
+     X(PFNGLGENVERTEXARRAYSPROC, genVertexArrays, "glGenVertexArrays")                         \
+     X(PFNGLDELETEVERTEXARRAYSPROC, deleteVertexArrays, "glDeleteVertexArrays")                \
+     X(PFNGLBINDVERTEXARRAYPROC, bindVertexArray, "glBindVertexArray")                         \
+     X(PFNGLENABLEVERTEXATTRIBARRAYPROC, enableVertexAttribArray, "glEnableVertexAttribArray") \
+     X(PFNGLVERTEXATTRIBPOINTERPROC, vertexAttribPointer, "glVertexAttribPointer")             \
+     X(PFNGLVERTEXATTRIBIPOINTERPROC, vertexAttribIPointer, "glVertexAttribIPointer")          \
+     X(PFNGLVERTEXATTRIBDIVISORPROC, vertexAttribDivisor, "glVertexAttribDivisor")             \
+     X(PFNGLGENBUFFERSPROC, genBuffers, "glGenBuffers")                                        \
+     X(PFNGLDELETEBUFFERSPROC, deleteBuffers, "glDeleteBuffers")                               \
+     X(PFNGLBINDBUFFERPROC, bindBuffer, "glBindBuffer")                                        \
+     X(PFNGLBUFFERDATAPROC, bufferData, "glBufferData")                                        \
+     X(PFNGLMAPBUFFERRANGEPROC, mapBufferRange, "glMapBufferRange")                            \
+     X(PFNGLUNMAPBUFFERPROC, unmapBuffer, "glUnmapBuffer")                                     \
+     X(PFNGLDRAWARRAYSINSTANCEDPROC, drawArraysInstanced, "glDrawArraysInstanced")             \
+     X(PFNGLFENCESYNCPROC, fenceSync, "glFenceSync")                                           \
+     X(PFNGLCLIENTWAITSYNCPROC, clientWaitSync, "glClientWaitSync")                            \
+     X(PFNGLDELETESYNCPROC, deleteSync, "glDeleteSync")
+
+#define GL_SPRITES_PERSISTENT_FUNCTIONS(X)                                                     \
+     X(PFNGLBUFFERSTORAGEPROC, bufferStorage, "glBufferStorage")                               \
+     X(PFNGLMULTIDRAWARRAYSINDIRECTPROC, multiDrawArraysIndirect, "glMultiDrawArraysIndirect")
+
+struct GlSpritesFunctions
+{
+#define GL_SPRITES_DECLARE(type, name, symbol) type name;
+     GL_SPRITES_FUNCTIONS(GL_SPRITES_DECLARE)
+     GL_SPRITES_PERSISTENT_FUNCTIONS(GL_SPRITES_DECLARE)
+#undef GL_SPRITES_DECLARE
+};
+
+// The fields of glMultiDrawArraysIndirect's commands
+struct GlSpritesDrawCommand
+{
+     GLuint vertexCount;
+     GLuint instanceCount;
+     GLuint firstVertex;
+     GLuint baseInstance;
+};
+
+struct GlSpritesState
+{
+     SDL_Window *window;
+     SDL_GLContext context;
+     GlSpritesFunctions gl;
+
+     GLuint program;
+     GLint viewScale;
+     GLuint vertexArray;
+     GLuint buffer;          // GL_SPRITES_FRAMES_IN_FLIGHT instance sections, then as many commands
+     Uint8 *mapped;          // The whole buffer on the persistent path, mapped for its lifetime
+     GlSprite *frameSprites; // This frame's section on the ES path, mapped by glSpritesBegin()
+     GLsync fences[GL_SPRITES_FRAMES_IN_FLIGHT]; // Signaled when the GPU is done with a section
+     int frame;
+
+     GLuint textures; // The GL_TEXTURE_2D_ARRAY
+     GLint layerScales;
+     // Size of each texture over the layer size, x and y, two layers to a vec4
+     float scales[GL_SPRITES_MAX_TEXTURES * 2];
+};
+
+namespace
+{
+     const char *GL_SPRITES_CORE_HEADER = "#version 440 core\n";
+     const char *GL_SPRITES_ES_HEADER = "#version 300 es\n"
+                                        "precision highp float;\n"
+                                        "precision mediump sampler2DArray;\n";
+
+     // The same shader as src/shaders/vulkan_sprite.vert, but GL's clip space
+     // has y up and the layer holds the texture in its top-left corner
+     const char *GL_SPRITES_VERTEX_SHADER = R"(
+layout(location = 0) in vec4 inRect;  // x, y, width, height in pixels
+layout(location = 1) in vec4 inUv;    // u0, v0, u1, v1
+layout(location = 2) in vec4 inColor; // Tint
+layout(location = 3) in uint inTexture;
+
+uniform vec2 viewScale; // 2 / width, -2 / height
+uniform vec4 layerScales[GL_SPRITES_LAYER_PAIRS];
+
+out vec2 outUv;
+out vec4 outColor;
+flat out uint outTexture;
+
+void main()
+{
+     vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+     vec2 position = inRect.xy + corner * inRect.zw;
+     gl_Position = vec4(position * viewScale + vec2(-1.0, 1.0), 0.0, 1.0);
+     vec4 pair = layerScales[int(inTexture >> 1u)];
+     outUv = mix(inUv.xy, inUv.zw, corner) * ((inTexture & 1u) != 0u ? pair.zw : pair.xy);
+     outColor = inColor;
+     outTexture = inTexture;
+}
+)";
+
+     const char *GL_SPRITES_FRAGMENT_SHADER = R"(
+uniform sampler2DArray textures;
+
+in vec2 outUv;
+in vec4 outColor;
+flat in uint outTexture;
+
+layout(location = 0) out vec4 fragment;
+
+void main()
+{
+     fragment = texture(textures, vec3(outUv, float(outTexture))) * outColor;
+}
+)";
+
+     bool loadGlSprites(GlSpritesFunctions &gl, bool persistent)
+     {
+          bool ok = true;
+#define GL_SPRITES_LOAD(type, name, symbol)         \
+     gl.name = (type)SDL_GL_GetProcAddress(symbol); \
+     ok = ok && gl.name != nullptr;
+          GL_SPRITES_FUNCTIONS(GL_SPRITES_LOAD)
+          if (persistent)
+          {
+               GL_SPRITES_PERSISTENT_FUNCTIONS(GL_SPRITES_LOAD)
+          }
+#undef GL_SPRITES_LOAD
+          if (!ok)
+          {
+               SDL_SetError("The GL driver is missing entry points gl_sprites needs");
+          }
+          return ok;
+     }
+
+     // A 4.4 core context if the driver has one, otherwise ES 3.0
+     SDL_GLContext createSpritesContext(SDL_Window *window, bool &persistent)
+     {
+          SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+          SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+          SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 4);
+          SDL_GLContext context = SDL_GL_CreateContext(window);
+          persistent = context != nullptr;
+          if (context == nullptr)
+          {
+               SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
+               SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+               SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+               context = SDL_GL_CreateContext(window);
+          }
+          return context;
+     }
+
+     GLuint compileSpritesShader(GlSpritesFunctions &gl, GLenum type, const char *header, const char *defines,
+                                 const char *source)
+     {
+          const char *sources[] = {header, defines, source};
+          GLuint shader = gl.createShader(type);
+          gl.shaderSource(shader, 3, sources, nullptr);
+          gl.compileShader(shader);
+          GLint compiled = GL_FALSE;
+          gl.getShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+          if (!compiled)
+          {
+               char log[512] = "";
+               gl.getShaderInfoLog(shader, sizeof(log), nullptr, log);
+               SDL_SetError("Could not compile the gl_sprites %s shader: %s",
+                            type == GL_VERTEX_SHADER ? "vertex" : "fragment", log);
+               gl.deleteShader(shader);
+               return 0;
+          }
+          return shader;
+     }
+
+     GLuint linkSpritesProgram(GlSpritesFunctions &gl, const char *header, const char *defines, bool retrievable)
+     {
+          GLuint vertex = compileSpritesShader(gl, GL_VERTEX_SHADER, header, defines, GL_SPRITES_VERTEX_SHADER);
+          GLuint fragment =
+              vertex != 0 ? compileSpritesShader(gl, GL_FRAGMENT_SHADER, header, defines, GL_SPRITES_FRAGMENT_SHADER)
+                          : 0;
+          if (fragment == 0)
+          {
+               if (vertex != 0)
+               {
+                    gl.deleteShader(vertex);
+               }
+               return 0;
+          }
+
+          GLuint program = gl.createProgram();
+          if (retrievable)
+          {
+               gl.programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+          }
+          gl.attachShader(program, vertex);
+          gl.attachShader(program, fragment);
+          gl.linkProgram(program);
+          gl.deleteShader(vertex);
+          gl.deleteShader(fragment);
+          GLint linked = GL_FALSE;
+          gl.getProgramiv(program, GL_LINK_STATUS, &linked);
+          if (!linked)
+          {
+               char log[512] = "";
+               gl.getProgramInfoLog(program, sizeof(log), nullptr, log);
+               SDL_SetError("Could not link the gl_sprites program: %s", log);
+               gl.deleteProgram(program);
+               return 0;
+          }
+          return program;
+     }
+
+     // The program from `cache` when it holds one this driver accepts,
+     // otherwise compiled, linked and stored there for the next launch
+     bool createSpritesProgram(GlSpritesState &state, bool persistent, ProgramCache *cache, bool &cached)
+     {
+          GlSpritesFunctions &gl = state.gl;
+          const char *header = persistent ? GL_SPRITES_CORE_HEADER : GL_SPRITES_ES_HEADER;
+          char defines[64];
+          SDL_snprintf(defines, sizeof(defines), "#define GL_SPRITES_LAYER_PAIRS %d\n", GL_SPRITES_MAX_TEXTURES / 2);
+
+          // Drivers that can't save programs report no binary formats
+          GLint formats = 0;
+          gl.getIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+          cache = formats > 0 ? cache : nullptr;
+          const char *name = persistent ? "gl_sprites-core" : "gl_sprites-es";
+          const char *stampParts[] = {header,
+                                      defines,
+                                      GL_SPRITES_VERTEX_SHADER,
+                                      GL_SPRITES_FRAGMENT_SHADER,
+                                      (const char *)gl.getString(GL_VENDOR),
+                                      (const char *)gl.getString(GL_RENDERER),
+                                      (const char *)gl.getString(GL_VERSION)};
+          const Uint64 stamp = programCacheStamp(stampParts, SDL_arraysize(stampParts));
+
+          cached = false;
+          Uint32 format = 0;
+          std::vector<Uint8> binary;
+          if (cache != nullptr && programCacheLoad(*cache, name, stamp, format, binary))
+          {
+               // The driver may still refuse it, e.g. after an update that kept
+               // its version string; then it is rebuilt and overwritten below
+               state.program = gl.createProgram();
+               gl.programBinary(state.program, format, binary.data(), (GLsizei)binary.size());
+               GLint linked = GL_FALSE;
+               gl.getProgramiv(state.program, GL_LINK_STATUS, &linked);
+               cached = linked == GL_TRUE;
+               if (!cached)
+               {
+                    gl.deleteProgram(state.program);
+                    state.program = 0;
+               }
+          }
+          if (!cached)
+          {
+               state.program = linkSpritesProgram(gl, header, defines, cache != nullptr);
+               if (state.program == 0)
+               {
+                    return false;
+               }
+               GLint length = 0;
+               gl.getProgramiv(state.program, GL_PROGRAM_BINARY_LENGTH, &length);
+               if (cache != nullptr && length > 0)
+               {
+                    GLenum binaryFormat = 0;
+                    binary.resize((size_t)length);
+                    gl.getProgramBinary(state.program, length, &length, &binaryFormat, binary.data());
+                    programCacheStore(*cache, name, stamp, binaryFormat, binary.data(), (size_t)length);
+               }
+          }
+
+          gl.useProgram(state.program);
+          gl.uniform1i(gl.getUniformLocation(state.program, "textures"), 0);
+          state.viewScale = gl.getUniformLocation(state.program, "viewScale");
+          state.layerScales = gl.getUniformLocation(state.program, "layerScales");
+          return true;
+     }
+
+     // Point the instance attributes at `offset` into the ring; the
+     // persistent path does this once and picks sections with baseInstance
+     void pointSpriteAttributes(GlSpritesFunctions &gl, size_t offset)
+     {
+          const GLsizei stride = sizeof(GlSprite);
+          gl.vertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (const void *)(offset + offsetof(GlSprite, x)));
+          gl.vertexAttribPointer(1, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (const void *)(offset + offsetof(GlSprite, u0)));
+          gl.vertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (const void *)(offset + offsetof(GlSprite, color)));
+          gl.vertexAttribIPointer(3, 1, GL_UNSIGNED_INT, stride, (const void *)(offset + offsetof(GlSprite, texture)));
+     }
+
+     bool createSpritesBuffer(GlSpritesState &state, int maxSprites, bool persistent)
+     {
+          GlSpritesFunctions &gl = state.gl;
+          const size_t sectionBytes = (size_t)maxSprites * sizeof(GlSprite);
+          const size_t bytes = (sectionBytes + sizeof(GlSpritesDrawCommand)) * GL_SPRITES_FRAMES_IN_FLIGHT;
+
+          gl.genVertexArrays(1, &state.vertexArray);
+          gl.bindVertexArray(state.vertexArray);
+          gl.genBuffers(1, &state.buffer);
+          gl.bindBuffer(GL_ARRAY_BUFFER, state.buffer);
+          if (persistent)
+          {
+               // Coherent, so writes through the mapping need no flush before the draw
+               const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+               gl.bufferStorage(GL_ARRAY_BUFFER, (GLsizeiptr)bytes, nullptr, flags);
+               state.mapped = (Uint8 *)gl.mapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, flags);
+               if (state.mapped == nullptr)
+               {
+                    SDL_SetError("Could not map the gl_sprites instance buffer");
+                    return false;
+               }
+               gl.bindBuffer(GL_DRAW_INDIRECT_BUFFER, state.buffer);
+          }
+          else
+          {
+               gl.bufferData(GL_ARRAY_BUFFER, (GLsizeiptr)bytes, nullptr, GL_STREAM_DRAW);
+          }
+          for (GLuint attribute = 0; attribute < 4; attribute++)
+          {
+               gl.enableVertexAttribArray(attribute);
+               gl.vertexAttribDivisor(attribute, 1);
+          }
+          pointSpriteAttributes(gl, 0);
+          return true;
+     }
+
+     bool createSpritesTextures(GlSpritesState &state, int layerSize, bool linearFilter)
+     {
+          GlSpritesFunctions &gl = state.gl;
+          const GLint filter = linearFilter ? GL_LINEAR : GL_NEAREST;
+          gl.genTextures(1, &state.textures);
+          gl.bindTexture(GL_TEXTURE_2D_ARRAY, state.textures);
+          gl.texStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, layerSize, layerSize, GL_SPRITES_MAX_TEXTURES);
+          gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, filter);
+          gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter);
+          gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+          gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+          gl.pixelStorei(GL_UNPACK_ALIGNMENT, 4);
+          return true;
+     }
+
+     // Copy `w` x `h` RGBA pixels into `layer`, repeating the last column and
+     // row once where the layer has room, so linear filtering at the
+     // texture's right and bottom edges doesn't blend in the rest of the layer
+     void uploadSpritesLayer(GlSpritesState &state, int layerSize, int layer, const Uint8 *pixels, int w, int h,
+                             int pitch)
+     {
+          const int paddedW = SDL_min(w + 1, layerSize);
+          const int paddedH = SDL_min(h + 1, layerSize);
+          std::vector<Uint32> padded((size_t)paddedW * paddedH);
+          for (int y = 0; y < paddedH; y++)
+          {
+               const Uint32 *row = (const Uint32 *)(pixels + (size_t)SDL_min(y, h - 1) * pitch);
+               for (int x = 0; x < paddedW; x++)
+               {
+                    padded[(size_t)y * paddedW + x] = row[SDL_min(x, w - 1)];
+               }
+          }
+          state.gl.bindTexture(GL_TEXTURE_2D_ARRAY, state.textures);
+          state.gl.texSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, paddedW, paddedH, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                                 padded.data());
+
+          state.scales[layer * 2] = (float)w / layerSize;
+          state.scales[layer * 2 + 1] = (float)h / layerSize;
+          state.gl.useProgram(state.program);
+          state.gl.uniform4fv(state.layerScales, GL_SPRITES_MAX_TEXTURES / 2, state.scales);
+     }
+
+     void makeSpritesCurrent(GlSpritesState &state)
+     {
+          if (SDL_GL_GetCurrentContext() != state.context)
+          {
+               SDL_GL_MakeCurrent(state.window, state.context);
+          }
+     }
+
+     void destroySpritesState(GlSpritesState *state)
+     {
+          if (state->context != nullptr)
+          {
+               makeSpritesCurrent(*state);
+               GlSpritesFunctions &gl = state->gl;
+               for (GLsync &fence : state->fences)
+               {
+                    if (fence != nullptr)
+                    {
+                         gl.deleteSync(fence);
+                    }
+               }
+               if (state->buffer != 0)
+               {
+                    if (state->mapped != nullptr || state->frameSprites != nullptr)
+                    {
+                         gl.bindBuffer(GL_ARRAY_BUFFER, state->buffer);
+                         gl.unmapBuffer(GL_ARRAY_BUFFER);
+                    }
+                    gl.deleteBuffers(1, &state->buffer);
+               }
+               if (state->vertexArray != 0)
+               {
+                    gl.deleteVertexArrays(1, &state->vertexArray);
+               }
+               if (state->textures != 0)
+               {
+                    gl.deleteTextures(1, &state->textures);
+               }
+               if (state->program != 0)
+               {
+                    gl.deleteProgram(state->program);
+               }
+               SDL_GL_DeleteContext(state->context);
+          }
+          delete state;
+     }
+}
+
+bool glSpritesCreate(GlSprites &sprites, SDL_Window *window, int maxSprites, bool vsync, int layerSize,
+                     bool linearFilter, ProgramCache *programCache)
+{
+     sprites = {};
+     if ((SDL_GetWindowFlags(window) & SDL_WINDOW_OPENGL) == 0)
+     {
+          SDL_SetError("gl_sprites needs a window created with SDL_WINDOW_OPENGL");
+          return false;
+     }
+
+     GlSpritesState *state = new GlSpritesState();
+     state->window = window;
+     bool persistent = false;
+     state->context = createSpritesContext(window, persistent);
+     if (state->context == nullptr)
+     {
+          destroySpritesState(state);
+          return false;
+     }
+     SDL_GL_SetSwapInterval(vsync ? 1 : 0);
+
+     maxSprites = SDL_max(maxSprites, 1);
+     layerSize = SDL_max(layerSize, 2);
+     bool ok = loadGlSprites(state->gl, persistent);
+     const Uint64 programStart = SDL_GetPerformanceCounter();
+     bool programCached = false;
+     ok = ok && createSpritesProgram(*state, persistent, programCache, programCached);
+     const double programMs =
+         (double)(SDL_GetPerformanceCounter() - programStart) * 1000.0 / SDL_GetPerformanceFrequency();
+     ok = ok && createSpritesBuffer(*state, maxSprites, persistent) &&
+               createSpritesTextures(*state, layerSize, linearFilter);
+     if (!ok)
+     {
+          destroySpritesState(state);
+          return false;
+     }
+     state->gl.enable(GL_BLEND);
+     state->gl.blendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+     // Texture 0 is solid white
+     const Uint32 white = 0xFFFFFFFFu;
+     uploadSpritesLayer(*state, layerSize, 0, (const Uint8 *)&white, 1, 1, 4);
+
+     sprites.state = state;
+     SDL_GL_GetDrawableSize(window, &sprites.width, &sprites.height);
+     sprites.maxSprites = maxSprites;
+     sprites.layerSize = layerSize;
+     sprites.textureCount = 1;
+     sprites.persistent = persistent;
+     sprites.programMs = programMs;
+     sprites.programCached = programCached;
+     return true;
+}
+
+void glSpritesDestroy(GlSprites &sprites)
+{
+     if (sprites.state != nullptr)
+     {
+          destroySpritesState(sprites.state);
+     }
+     sprites = {};
+}
+
+int glSpritesAddTexture(GlSprites &sprites, SDL_Surface *surface)
+{
+     GlSpritesState *state = sprites.state;
+     if (state == nullptr || surface == nullptr)
+     {
+          SDL_SetError("glSpritesAddTexture needs a renderer and a surface");
+          return -1;
+     }
+     if (sprites.textureCount >= GL_SPRITES_MAX_TEXTURES)
+     {
+          SDL_SetError("All %d GL sprite textures are in use", GL_SPRITES_MAX_TEXTURES);
+          return -1;
+     }
+     if (surface->w > sprites.layerSize || surface->h > sprites.layerSize)
+     {
+          SDL_SetError("A %dx%d texture is larger than the %d pixel sprite layers", surface->w, surface->h,
+                       sprites.layerSize);
+          return -1;
+     }
+     // R8G8B8A8 in memory order, whatever the host's byte order
+     SDL_Surface *rgba = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+     if (rgba == nullptr)
+     {
+          return -1;
+     }
+
+     // No wait for frames in flight: GL orders the upload after their draws
+     makeSpritesCurrent(*state);
+     const int index = sprites.textureCount++;
+     SDL_LockSurface(rgba);
+     uploadSpritesLayer(*state, sprites.layerSize, index, (const Uint8 *)rgba->pixels, rgba->w, rgba->h, rgba->pitch);
+     SDL_UnlockSurface(rgba);
+     SDL_FreeSurface(rgba);
+     return index;
+}
+
+GlSprite *glSpritesBegin(GlSprites &sprites)
+{
+     GlSpritesState *state = sprites.state;
+     if (state == nullptr)
+     {
+          SDL_SetError("glSpritesBegin without a renderer");
+          return nullptr;
+     }
+     makeSpritesCurrent(*state);
+     GlSpritesFunctions &gl = state->gl;
+
+     GLsync &fence = state->fences[state->frame];
+     if (fence != nullptr)
+     {
+          // Flush on the first wait only, so the fence is sure to be submitted
+          GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+          GLenum result;
+          while ((result = gl.clientWaitSync(fence, flags, 1000000000)) == GL_TIMEOUT_EXPIRED)
+          {
+               flags = 0;
+          }
+          gl.deleteSync(fence);
+          fence = nullptr;
+          if (result == GL_WAIT_FAILED)
+          {
+               SDL_SetError("glClientWaitSync failed on a gl_sprites frame");
+               return nullptr;
+          }
+     }
+
+     const size_t offset = (size_t)state->frame * sprites.maxSprites * sizeof(GlSprite);
+     if (sprites.persistent)
+     {
+          return (GlSprite *)(state->mapped + offset);
+     }
+     // The fence already kept us off the GPU's sections, so the driver
+     // needn't synchronize the mapping
+     gl.bindBuffer(GL_ARRAY_BUFFER, state->buffer);
+     state->frameSprites = (GlSprite *)gl.mapBufferRange(
+         GL_ARRAY_BUFFER, (GLintptr)offset, (GLsizeiptr)(sprites.maxSprites * sizeof(GlSprite)),
+         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+     if (state->frameSprites == nullptr)
+     {
+          SDL_SetError("Could not map the gl_sprites instance buffer");
+     }
+     return state->frameSprites;
+}
+
+bool glSpritesEnd(GlSprites &sprites, int count, SDL_Color clear)
+{
+     GlSpritesState *state = sprites.state;
+     if (state == nullptr)
+     {
+          SDL_SetError("glSpritesEnd without a renderer");
+          return false;
+     }
+     makeSpritesCurrent(*state);
+     GlSpritesFunctions &gl = state->gl;
+     count = SDL_clamp(count, 0, sprites.maxSprites);
+
+     const size_t sectionBytes = (size_t)sprites.maxSprites * sizeof(GlSprite);
+     if (!sprites.persistent && state->frameSprites != nullptr)
+     {
+          gl.bindBuffer(GL_ARRAY_BUFFER, state->buffer);
+          // GL_FALSE means the contents were lost (a mode switch); skip them
+          if (!gl.unmapBuffer(GL_ARRAY_BUFFER))
+          {
+               count = 0;
+          }
+          state->frameSprites = nullptr;
+     }
+
+     SDL_GL_GetDrawableSize(state->window, &sprites.width, &sprites.height);
+     gl.viewport(0, 0, sprites.width, sprites.height);
+     gl.clearColor(clear.r / 255.0f, clear.g / 255.0f, clear.b / 255.0f, clear.a / 255.0f);
+     gl.clear(GL_COLOR_BUFFER_BIT);
+
+     if (count > 0 && sprites.width > 0 && sprites.height > 0)
+     {
+          gl.useProgram(state->program);
+          gl.uniform2f(state->viewScale, 2.0f / sprites.width, -2.0f / sprites.height);
+          gl.bindVertexArray(state->vertexArray);
+          gl.bindTexture(GL_TEXTURE_2D_ARRAY, state->textures);
+          if (sprites.persistent)
+          {
+               const size_t commandOffset =
+                   sectionBytes * GL_SPRITES_FRAMES_IN_FLIGHT + state->frame * sizeof(GlSpritesDrawCommand);
+               GlSpritesDrawCommand &command = *(GlSpritesDrawCommand *)(state->mapped + commandOffset);
+               command.vertexCount = 4;
+               command.instanceCount = (GLuint)count;
+               command.firstVertex = 0;
+               command.baseInstance = (GLuint)(state->frame * sprites.maxSprites);
+               gl.multiDrawArraysIndirect(GL_TRIANGLE_STRIP, (const void *)commandOffset, 1, 0);
+          }
+          else
+          {
+               // ES 3.0 has no baseInstance; move the attributes instead
+               gl.bindBuffer(GL_ARRAY_BUFFER, state->buffer);
+               pointSpriteAttributes(gl, sectionBytes * state->frame);
+               gl.drawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+          }
+     }
+     state->fences[state->frame] = gl.fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+     SDL_GL_SwapWindow(state->window);
+     state->frame = (state->frame + 1) % GL_SPRITES_FRAMES_IN_FLIGHT;
+     sprites.framesPresented++;
+     return true;
+}
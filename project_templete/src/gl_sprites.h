@@ -0,0 +1,86 @@
+// Description:
+// Sprite renderer on a core-profile OpenGL 4.4 context of its own, the
+// OpenGL counterpart of vulkan_sprites for drivers with no Vulkan. Each
+// sprite is one 32-byte instance written straight into a persistently
+// mapped ring buffer (ARB_buffer_storage); the vertex shader expands it
+// into a quad from gl_VertexID and every texture is a layer of one
+// GL_TEXTURE_2D_ARRAY, so a frame of any size is a single
+// glMultiDrawArraysIndirect call whose command also lives in the ring.
+//
+// GL_SPRITES_FRAMES_IN_FLIGHT sections of the ring are in use at once,
+// each guarded by a fence, so the CPU fills frame N+1 while the GPU draws
+// frame N; glSpritesBegin() only waits when it gets that far ahead.
+//
+// Where 4.4 is not available it falls back to OpenGL ES 3.0, which has
+// neither buffer storage nor indirect draws: the section is mapped
+// unsynchronized each frame (still fenced) and drawn with one
+// glDrawArraysInstanced. GlSprites::persistent tells the two apart.
+//
+// With a ProgramCache the linked shader program is saved after the first
+// launch and loaded back with glProgramBinary, skipping the compile.
+//
+// Textures are no larger than the layer size given at creation, and the
+// array's filter is the same for all of them. One renderer at a time; the
+// window must be created with SDL_WINDOW_OPENGL and not have an
+// SDL_Renderer.
+// =============================================================================
+
+#ifndef GL_SPRITES_H
+#define GL_SPRITES_H
+
+#include <SDL2/SDL.h>
+
+#define GL_SPRITES_FRAMES_IN_FLIGHT 3
+#define GL_SPRITES_MAX_TEXTURES 64 // Layers in the texture array
+#define GL_SPRITES_DEFAULT_LAYER_SIZE 256
+
+// One sprite as the GPU reads it; the same layout as VulkanSprite
+struct GlSprite
+{
+     float x, y; // Top-left corner in drawable pixels
+     float width, height;
+     Uint16 u0, v0, u1, v1; // Texture rect, 0..65535 across the texture
+     SDL_Color color;       // Tint, multiplied with the texture
+     Uint32 texture;        // From glSpritesAddTexture(); 0 is solid white
+};
+
+struct GlSpritesState;
+struct ProgramCache;
+
+struct GlSprites
+{
+     GlSpritesState *state;
+     int width, height; // Drawable size at the last glSpritesEnd()
+     int maxSprites;
+     int layerSize;
+     int textureCount;   // Including the white texture 0
+     bool persistent;    // GL 4.4 with a persistent mapping, not the ES 3.0 path
+     double programMs;   // Getting the shader program ready, compiled or cached
+     bool programCached; // Loaded from the ProgramCache rather than compiled
+     Uint64 framesPresented;
+};
+
+// Create a GL context on `window` with room for `maxSprites` per frame and
+// textures up to `layerSize` pixels square. Sets the context attributes
+// itself; the context is left current. `programCache` may be null
+bool glSpritesCreate(GlSprites &sprites, SDL_Window *window, int maxSprites, bool vsync = true,
+                     int layerSize = GL_SPRITES_DEFAULT_LAYER_SIZE, bool linearFilter = true,
+                     ProgramCache *programCache = nullptr);
+
+void glSpritesDestroy(GlSprites &sprites);
+
+// Upload `surface` into the next layer and give it that texture index; -1
+// with SDL's error set when it is larger than the layer size or all
+// GL_SPRITES_MAX_TEXTURES are taken
+int glSpritesAddTexture(GlSprites &sprites, SDL_Surface *surface);
+
+// The instance buffer for the next frame, room for maxSprites. Waits only
+// if the GPU is still drawing from it, GL_SPRITES_FRAMES_IN_FLIGHT frames
+// back. nullptr on error
+GlSprite *glSpritesBegin(GlSprites &sprites);
+
+// Draw the first `count` sprites written since glSpritesBegin(), in order,
+// over `clear`, and swap
+bool glSpritesEnd(GlSprites &sprites, int count, SDL_Color clear);
+
+#endif // GL_SPRITES_H
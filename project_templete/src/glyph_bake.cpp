@@ -0,0 +1,430 @@
+#include "glyph_bake.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "lz4_block.h"
+#include "memory_tags.h"
+
+namespace
+{
+     const Uint32 BAKE_MAGIC = 0x594C4743; // "CGLY" read in native byte order, a swapped file fails
+     const Uint32 BAKE_VERSION = 1;
+     const int BAKE_PADDING = 1;
+     const int BAKE_MAX_PAGE_SIZE = 8192;
+     const Uint32 BAKE_MAX_PAGES = 64;
+
+     struct BakeHeader
+     {
+          Uint32 magic;
+          Uint32 version;
+          Uint64 sourceStamp;
+          Uint32 familyHash;
+          Sint32 style;
+          Sint32 height;
+          Sint32 ascent;
+          Sint32 pageSize;
+          Uint32 pageCount;
+          Uint32 glyphCount;
+          Uint32 reserved;
+     };
+
+     struct BakeRecord
+     {
+          Uint32 codepoint;
+          Sint32 page;
+          Sint32 x, y, w, h;
+          Sint32 advance;
+     };
+
+     Uint32 fnvString(Uint32 hash, const char *text)
+     {
+          for (; text != nullptr && *text; text++)
+          {
+               hash = (hash ^ (Uint8)*text) * 16777619u;
+          }
+          return hash * 16777619u; // The terminator keeps "ab"+"c" apart from "a"+"bc"
+     }
+
+     GlyphBakeFace describeFace(TTF_Font *font)
+     {
+          GlyphBakeFace face;
+          face.familyHash = fnvString(fnvString(2166136261u, TTF_FontFaceFamilyName(font)), TTF_FontFaceStyleName(font));
+          face.style = TTF_GetFontStyle(font);
+          face.height = TTF_FontHeight(font);
+          face.ascent = TTF_FontAscent(font);
+          return face;
+     }
+
+     bool sameFace(const GlyphBakeFace &a, const GlyphBakeFace &b)
+     {
+          return a.familyHash == b.familyHash && a.style == b.style && a.height == b.height && a.ascent == b.ascent;
+     }
+
+     SDL_Surface *createBakePage(int size)
+     {
+          // New surfaces are zeroed, so padding stays transparent
+          SDL_Surface *page = SDL_CreateRGBSurfaceWithFormat(0, size, size, 32, SDL_PIXELFORMAT_ARGB8888);
+          if (page == nullptr)
+          {
+               std::cerr << "Unable to create glyph bake page! SDL Error: " << SDL_GetError() << std::endl;
+          }
+          return page;
+     }
+
+     // Shelf packing over the CPU pages, the same layout the cache uses
+     bool placeBaked(GlyphBake &bake, int w, int h, int &page, SDL_Point &at)
+     {
+          if (w + BAKE_PADDING > bake.pageSize || h + BAKE_PADDING > bake.pageSize)
+          {
+               return false;
+          }
+          if (!bake.pages.empty() && bake.shelfX + w + BAKE_PADDING > bake.pageSize)
+          {
+               bake.shelfX = 0;
+               bake.shelfY += bake.shelfHeight + BAKE_PADDING;
+               bake.shelfHeight = 0;
+          }
+          if (bake.pages.empty() || bake.shelfY + h + BAKE_PADDING > bake.pageSize)
+          {
+               SDL_Surface *surface = createBakePage(bake.pageSize);
+               if (surface == nullptr)
+               {
+                    bake.failed = true;
+                    return false;
+               }
+               bake.pages.push_back(surface);
+               bake.shelfX = 0;
+               bake.shelfY = 0;
+               bake.shelfHeight = 0;
+          }
+
+          page = (int)bake.pages.size() - 1;
+          at.x = bake.shelfX;
+          at.y = bake.shelfY;
+          bake.shelfX += w + BAKE_PADDING;
+          bake.shelfHeight = SDL_max(bake.shelfHeight, h);
+          return true;
+     }
+
+     // Same steps as the cache's own rasterizer, into a CPU page
+     CachedGlyph bakeGlyph(GlyphBake &bake, Uint32 codepoint)
+     {
+          CachedGlyph glyph;
+          glyph.page = -1;
+          glyph.src = {0, 0, 0, 0};
+          glyph.advance = 0;
+
+          int minx, maxx, miny, maxy;
+          if (TTF_GlyphMetrics32(bake.font, codepoint, &minx, &maxx, &miny, &maxy, &glyph.advance) < 0)
+          {
+               return glyph;
+          }
+
+          const SDL_Color white = {255, 255, 255, 255};
+          SDL_Surface *surface;
+          {
+               MemoryTagScope tag(MEMORY_TAG_TTF);
+               surface = TTF_RenderGlyph32_Blended(bake.font, codepoint, white);
+          }
+          if (surface == nullptr)
+          {
+               return glyph;
+          }
+          if (surface->format->format != SDL_PIXELFORMAT_ARGB8888)
+          {
+               SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+               SDL_FreeSurface(surface);
+               surface = converted;
+               if (surface == nullptr)
+               {
+                    return glyph;
+               }
+          }
+
+          SDL_Point at;
+          if (surface->w > 0 && surface->h > 0 && placeBaked(bake, surface->w, surface->h, glyph.page, at))
+          {
+               // Straight copies: blitting would blend the glyph onto the page
+               SDL_Surface *page = bake.pages[glyph.page];
+               glyph.src = {at.x, at.y, surface->w, surface->h};
+               for (int y = 0; y < surface->h; y++)
+               {
+                    std::memcpy((Uint8 *)page->pixels + (at.y + y) * page->pitch + at.x * 4,
+                                (const Uint8 *)surface->pixels + y * surface->pitch, surface->w * 4);
+               }
+          }
+          SDL_FreeSurface(surface);
+          return glyph;
+     }
+
+     int bakeThreadMain(void *data)
+     {
+          GlyphBake &bake = *(GlyphBake *)data;
+          for (Uint32 codepoint : bake.codepoints)
+          {
+               if (bake.failed)
+               {
+                    break;
+               }
+               BakedGlyph entry;
+               entry.codepoint = codepoint;
+               entry.glyph = bakeGlyph(bake, codepoint);
+               bake.glyphs.push_back(entry);
+               SDL_AtomicAdd(&bake.completed, 1);
+          }
+          SDL_AtomicSet(&bake.finished, 1);
+          return 0;
+     }
+
+     void resetBake(GlyphBake &bake)
+     {
+          bake.font = nullptr;
+          bake.pageSize = 0;
+          bake.codepoints.clear();
+          bake.pages.clear();
+          bake.glyphs.clear();
+          bake.shelfX = 0;
+          bake.shelfY = 0;
+          bake.shelfHeight = 0;
+          bake.thread = nullptr;
+          SDL_AtomicSet(&bake.completed, 0);
+          SDL_AtomicSet(&bake.finished, 0);
+          bake.failed = false;
+     }
+
+     void freeBakePages(GlyphBake &bake)
+     {
+          for (SDL_Surface *page : bake.pages)
+          {
+               SDL_FreeSurface(page);
+          }
+          bake.pages.clear();
+     }
+}
+
+void glyphSetAddText(std::vector<Uint32> &set, const char *text)
+{
+     while (*text)
+     {
+          Uint32 codepoint = glyphCacheDecodeUtf8(text);
+          if (codepoint != '\n')
+          {
+               set.push_back(codepoint);
+          }
+     }
+}
+
+void glyphSetAddRange(std::vector<Uint32> &set, Uint32 first, Uint32 last)
+{
+     last = SDL_min(last, (Uint32)0x10FFFF); // Also keeps the loop from wrapping
+     for (Uint32 codepoint = first; codepoint <= last; codepoint++)
+     {
+          set.push_back(codepoint);
+     }
+}
+
+bool glyphBakeStart(GlyphBake &bake, TTF_Font *font, const std::vector<Uint32> &codepoints, int pageSize)
+{
+     resetBake(bake);
+     bake.font = font;
+     bake.face = describeFace(font);
+     bake.pageSize = SDL_clamp(pageSize, 64, BAKE_MAX_PAGE_SIZE);
+     bake.codepoints = codepoints;
+     std::sort(bake.codepoints.begin(), bake.codepoints.end());
+     bake.codepoints.erase(std::unique(bake.codepoints.begin(), bake.codepoints.end()), bake.codepoints.end());
+     bake.glyphs.reserve(bake.codepoints.size());
+
+     bake.thread = SDL_CreateThread(bakeThreadMain, "GlyphBake", &bake);
+     if (bake.thread == nullptr)
+     {
+          std::cerr << "Unable to start the glyph bake thread! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     return true;
+}
+
+bool glyphBakeDone(const GlyphBake &bake)
+{
+     return SDL_AtomicGet(const_cast<SDL_atomic_t *>(&bake.finished)) != 0;
+}
+
+int glyphBakeProgress(const GlyphBake &bake, int *total)
+{
+     if (total)
+     {
+          *total = (int)bake.codepoints.size();
+     }
+     return SDL_AtomicGet(const_cast<SDL_atomic_t *>(&bake.completed));
+}
+
+bool glyphBakeWait(GlyphBake &bake)
+{
+     if (bake.thread != nullptr)
+     {
+          SDL_WaitThread(bake.thread, NULL);
+          bake.thread = nullptr;
+     }
+     bake.font = nullptr;
+     return !bake.failed;
+}
+
+bool glyphBakeSave(const GlyphBake &bake, const char *path, Uint64 sourceStamp)
+{
+     if (bake.thread != nullptr || bake.failed)
+     {
+          SDL_SetError("Glyph bake is not finished");
+          return false;
+     }
+     BakeHeader header;
+     std::memset(&header, 0, sizeof(header));
+     header.magic = BAKE_MAGIC;
+     header.version = BAKE_VERSION;
+     header.sourceStamp = sourceStamp;
+     header.familyHash = bake.face.familyHash;
+     header.style = bake.face.style;
+     header.height = bake.face.height;
+     header.ascent = bake.face.ascent;
+     header.pageSize = bake.pageSize;
+     header.pageCount = (Uint32)bake.pages.size();
+     header.glyphCount = (Uint32)bake.glyphs.size();
+
+     std::vector<BakeRecord> records(bake.glyphs.size());
+     for (size_t i = 0; i < bake.glyphs.size(); i++)
+     {
+          const CachedGlyph &glyph = bake.glyphs[i].glyph;
+          records[i] = {bake.glyphs[i].codepoint, glyph.page, glyph.src.x, glyph.src.y, glyph.src.w, glyph.src.h,
+                        glyph.advance};
+     }
+
+     SDL_RWops *rw = SDL_RWFromFile(path, "wb");
+     if (rw == nullptr)
+     {
+          return false;
+     }
+     bool complete = SDL_RWwrite(rw, &header, sizeof(header), 1) == 1 &&
+                     (records.empty() || SDL_RWwrite(rw, records.data(), sizeof(BakeRecord), records.size()) == records.size());
+
+     // Pages are mostly empty space, so each is stored as one LZ4 block
+     const int pageBytes = bake.pageSize * bake.pageSize * 4;
+     std::vector<Uint8> packed(lz4BlockBound(pageBytes));
+     for (size_t i = 0; i < bake.pages.size() && complete; i++)
+     {
+          SDL_Surface *page = bake.pages[i];
+          SDL_assert(page->pitch == bake.pageSize * 4);
+          const Uint32 size = (Uint32)lz4BlockCompress((const Uint8 *)page->pixels, pageBytes, packed.data(), (int)packed.size());
+          complete = size > 0 && SDL_RWwrite(rw, &size, sizeof(size), 1) == 1 &&
+                     SDL_RWwrite(rw, packed.data(), 1, size) == size;
+     }
+     return SDL_RWclose(rw) == 0 && complete;
+}
+
+bool glyphBakeLoad(GlyphBake &bake, const char *path, Uint64 sourceStamp)
+{
+     resetBake(bake);
+     SDL_AtomicSet(&bake.finished, 1);
+     SDL_RWops *rw = SDL_RWFromFile(path, "rb");
+     if (rw == nullptr)
+     {
+          return false;
+     }
+     BakeHeader header;
+     bool complete = SDL_RWread(rw, &header, sizeof(header), 1) == 1 && header.magic == BAKE_MAGIC &&
+                     header.version == BAKE_VERSION && header.sourceStamp == sourceStamp && header.pageSize > 0 &&
+                     header.pageSize <= BAKE_MAX_PAGE_SIZE && header.pageCount <= BAKE_MAX_PAGES;
+
+     std::vector<BakeRecord> records;
+     if (complete)
+     {
+          records.resize(header.glyphCount);
+          complete = records.empty() || SDL_RWread(rw, records.data(), sizeof(BakeRecord), records.size()) == records.size();
+     }
+     for (size_t i = 0; i < records.size() && complete; i++)
+     {
+          const BakeRecord &record = records[i];
+          complete = record.page == -1 ||
+                     (record.page >= 0 && (Uint32)record.page < header.pageCount && record.x >= 0 && record.y >= 0 &&
+                      record.w > 0 && record.h > 0 && record.x + record.w <= header.pageSize &&
+                      record.y + record.h <= header.pageSize);
+     }
+
+     const int pageBytes = header.pageSize * header.pageSize * 4;
+     std::vector<Uint8> packed;
+     for (Uint32 i = 0; i < header.pageCount && complete; i++)
+     {
+          Uint32 size = 0;
+          complete = SDL_RWread(rw, &size, sizeof(size), 1) == 1 && size > 0 && size <= (Uint32)lz4BlockBound(pageBytes);
+          if (complete)
+          {
+               packed.resize(size);
+               complete = SDL_RWread(rw, packed.data(), 1, size) == size;
+          }
+          SDL_Surface *page = complete ? createBakePage(header.pageSize) : nullptr;
+          if (page == nullptr)
+          {
+               complete = false;
+               break;
+          }
+          bake.pages.push_back(page);
+          complete = lz4BlockDecompress(packed.data(), (int)size, (Uint8 *)page->pixels, pageBytes);
+     }
+     SDL_RWclose(rw);
+     if (!complete)
+     {
+          freeBakePages(bake);
+          return false;
+     }
+
+     bake.face = {header.familyHash, header.style, header.height, header.ascent};
+     bake.pageSize = header.pageSize;
+     bake.glyphs.resize(records.size());
+     for (size_t i = 0; i < records.size(); i++)
+     {
+          const BakeRecord &record = records[i];
+          bake.glyphs[i].codepoint = record.codepoint;
+          bake.glyphs[i].glyph.page = record.page;
+          bake.glyphs[i].glyph.src = {record.x, record.y, record.w, record.h};
+          bake.glyphs[i].glyph.advance = record.advance;
+     }
+     SDL_AtomicSet(&bake.completed, (int)bake.glyphs.size());
+     return true;
+}
+
+bool glyphBakeApply(const GlyphBake &bake, GlyphCache &cache, int fontId)
+{
+     TTF_Font *font = cache.fonts[fontId].font;
+     if (bake.thread != nullptr || bake.failed || !sameFace(bake.face, describeFace(font)))
+     {
+          SDL_SetError("Glyph bake does not match the font");
+          return false;
+     }
+     int firstPage = -1;
+     for (SDL_Surface *page : bake.pages)
+     {
+          const int index = glyphCacheAddBakedPage(cache, page);
+          if (index < 0)
+          {
+               return false;
+          }
+          firstPage = firstPage < 0 ? index : firstPage;
+     }
+     for (const BakedGlyph &baked : bake.glyphs)
+     {
+          CachedGlyph glyph = baked.glyph;
+          if (glyph.page >= 0)
+          {
+               glyph.page += firstPage;
+          }
+          glyphCacheAddBakedGlyph(cache, fontId, bake.face.style, baked.codepoint, glyph);
+     }
+     return true;
+}
+
+void glyphBakeDestroy(GlyphBake &bake)
+{
+     glyphBakeWait(bake);
+     freeBakePages(bake);
+     bake.glyphs.clear();
+     bake.codepoints.clear();
+}
@@ -0,0 +1,107 @@
+// Description:
+// Prebaked glyph atlases for the glyph cache. Even with a cache, the first
+// frame that shows a large script (CJK, say) stalls while FreeType
+// rasterizes every new glyph. A GlyphBake rasterizes a whole glyph set,
+// taken from strings or Unicode ranges, into CPU atlas pages on a worker
+// thread, and can save the pages and metrics to disk. Later launches load
+// the file with a few reads and an LZ4 decode, and glyphBakeApply() hands
+// it to the cache as pinned pages; only codepoints outside the set are
+// still rasterized through the TTF_Font.
+//
+// SDL_ttf shares one FreeType library between fonts. Rendering glyphs from
+// separate faces on separate threads is safe, but one face is not, so the
+// worker needs a TTF_Font of its own: open the same file at the same size
+// again and leave it alone until glyphBakeWait() returns.
+//
+//     GlyphBake bake;
+//     if (glyphBakeLoad(bake, "hud.glyphs", stamp))
+//     {
+//          glyphBakeApply(bake, cache, fontId);
+//          glyphBakeDestroy(bake);
+//     }
+//     else
+//     {
+//          glyphBakeStart(bake, bakeFont, codepoints); // then poll glyphBakeDone()
+//     }
+//
+// The file stores the font's family, style, height and ascent alongside
+// the caller's stamp, and glyphBakeApply() refuses a bake made from a
+// different face or size. Like texture_cache, the file is written in native
+// byte order for the machine that made it.
+// =============================================================================
+
+#ifndef GLYPH_BAKE_H
+#define GLYPH_BAKE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <vector>
+
+#include "glyph_cache.h"
+
+struct BakedGlyph
+{
+     Uint32 codepoint;
+     CachedGlyph glyph; // Page indices count within the bake
+};
+
+// What the glyphs were rasterized from; a bake only applies to a font that
+// matches it
+struct GlyphBakeFace
+{
+     Uint32 familyHash; // Family and style names
+     int style;         // TTF_GetFontStyle()
+     int height;
+     int ascent;
+};
+
+struct GlyphBake
+{
+     TTF_Font *font; // Borrowed by the worker until glyphBakeWait()
+     GlyphBakeFace face;
+     int pageSize;
+     std::vector<Uint32> codepoints;
+
+     std::vector<SDL_Surface *> pages; // ARGB8888, white on alpha
+     std::vector<BakedGlyph> glyphs;
+     int shelfX, shelfY, shelfHeight;
+
+     SDL_Thread *thread;
+     SDL_atomic_t completed; // Codepoints handled so far
+     SDL_atomic_t finished;
+     bool failed;
+};
+
+// Add the codepoints of UTF-8 `text`, or the range [first, last], to a
+// glyph set; glyphBakeStart() drops duplicates
+void glyphSetAddText(std::vector<Uint32> &set, const char *text);
+void glyphSetAddRange(std::vector<Uint32> &set, Uint32 first, Uint32 last);
+
+// Start rasterizing `codepoints` from `font` into pageSize x pageSize pages
+// on a worker thread
+bool glyphBakeStart(GlyphBake &bake, TTF_Font *font, const std::vector<Uint32> &codepoints, int pageSize = 1024);
+
+// True once the worker has finished; never blocks
+bool glyphBakeDone(const GlyphBake &bake);
+
+// Codepoints rasterized so far, and how many there are in total
+int glyphBakeProgress(const GlyphBake &bake, int *total);
+
+// Join the worker; false if it failed. The font is free again afterwards.
+bool glyphBakeWait(GlyphBake &bake);
+
+// Write a finished bake; `sourceStamp` describes the font file and is
+// checked again by glyphBakeLoad()
+bool glyphBakeSave(const GlyphBake &bake, const char *path, Uint64 sourceStamp);
+
+// Read a saved bake; false if the file is missing, damaged or stale
+bool glyphBakeLoad(GlyphBake &bake, const char *path, Uint64 sourceStamp);
+
+// Upload the pages into `cache` and register the glyphs under `fontId`;
+// false without changing the cache if the font is not the baked face
+bool glyphBakeApply(const GlyphBake &bake, GlyphCache &cache, int fontId);
+
+// Join the worker if it is still running and free the pages
+void glyphBakeDestroy(GlyphBake &bake);
+
+#endif // GLYPH_BAKE_H
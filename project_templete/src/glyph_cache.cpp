@@ -0,0 +1,684 @@
+#include "glyph_cache.h"
+
+#include <cmath>
+#include <iostream>
+
+#include "memory_tags.h"
+#include "render_record.h"
+#include "utf_convert.h"
+
+namespace
+{
+     const int GLYPH_PADDING = 1;
+     const int GLYPH_MAX_SUBPIXEL = 4;
+
+     const int GLYPH_BUCKETS = 64;
+
+     // Codepoints stop at 21 bits, so bits 24-25 hold the subpixel variant
+     // and bits 26-31 the font's size bucket
+     Uint64 glyphKey(int fontId, int style, Uint32 codepoint, int variant = 0, int bucket = 0)
+     {
+          return ((Uint64)fontId << 40) | ((Uint64)(style & 0xFF) << 32) | ((Uint64)(bucket & (GLYPH_BUCKETS - 1)) << 26) |
+                 ((Uint64)variant << 24) | codepoint;
+     }
+
+     // Move the glyph `fraction` of a pixel right by linear interpolation,
+     // into a surface one column wider. Glyphs are rendered white, so only
+     // coverage is interpolated; blending colour with the transparent black
+     // around the glyph would darken its edges.
+     SDL_Surface *shiftGlyph(SDL_Surface *surface, float fraction)
+     {
+          SDL_Surface *shifted = SDL_CreateRGBSurfaceWithFormat(0, surface->w + 1, surface->h, 32, SDL_PIXELFORMAT_ARGB8888);
+          if (shifted == nullptr)
+          {
+               return nullptr;
+          }
+          const int right = (int)(fraction * 256.0f + 0.5f);
+          const int left = 256 - right;
+          for (int y = 0; y < surface->h; y++)
+          {
+               const Uint32 *src = (const Uint32 *)((const Uint8 *)surface->pixels + y * surface->pitch);
+               Uint32 *dst = (Uint32 *)((Uint8 *)shifted->pixels + y * shifted->pitch);
+               for (int x = 0; x <= surface->w; x++)
+               {
+                    const int here = x < surface->w ? (int)(src[x] >> 24) : 0;
+                    const int before = x > 0 ? (int)(src[x - 1] >> 24) : 0;
+                    const Uint32 alpha = (Uint32)((here * left + before * right + 128) >> 8);
+                    dst[x] = alpha << 24 | 0x00FFFFFF;
+               }
+          }
+          return shifted;
+     }
+
+     SDL_Texture *createPage(GlyphCache &cache)
+     {
+          SDL_Texture *page = SDL_CreateTexture(cache.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+                                                cache.pageSize, cache.pageSize);
+          if (page == nullptr)
+          {
+               std::cerr << "Unable to create glyph page! SDL Error: " << SDL_GetError() << std::endl;
+               return nullptr;
+          }
+          renderRecordSetTextureBlendMode(page, SDL_BLENDMODE_BLEND);
+
+          // Start from fully transparent texels so padding never shows
+          std::vector<Uint32> clear(cache.pageSize * cache.pageSize, 0);
+          renderRecordUpdateTexture(page, NULL, clear.data(), cache.pageSize * 4);
+          return page;
+     }
+
+     // Reserve a w x h slot, opening a new shelf or page as needed. Only
+     // dynamic pages, the ones after the baked pages, are packed into.
+     bool allocate(GlyphCache &cache, int w, int h, int &page, SDL_Point &at)
+     {
+          if (w + GLYPH_PADDING > cache.pageSize || h + GLYPH_PADDING > cache.pageSize)
+          {
+               return false;
+          }
+          const int dynamicPages = (int)cache.pages.size() - cache.bakedPageCount;
+          if (dynamicPages > 0 && cache.shelfX + w + GLYPH_PADDING > cache.pageSize)
+          {
+               cache.shelfX = 0;
+               cache.shelfY += cache.shelfHeight + GLYPH_PADDING;
+               cache.shelfHeight = 0;
+          }
+          if (dynamicPages == 0 || cache.shelfY + h + GLYPH_PADDING > cache.pageSize)
+          {
+               if (dynamicPages >= cache.maxPages)
+               {
+                    // Out of room: start over on the existing pages
+                    glyphCacheClear(cache);
+                    if ((int)cache.pages.size() == cache.bakedPageCount)
+                    {
+                         return false; // Its fresh page could not be made
+                    }
+               }
+               else
+               {
+                    SDL_Texture *texture = createPage(cache);
+                    if (texture == nullptr)
+                    {
+                         return false;
+                    }
+                    cache.pages.push_back(texture);
+               }
+               cache.shelfX = 0;
+               cache.shelfY = 0;
+               cache.shelfHeight = 0;
+          }
+
+          page = (int)cache.pages.size() - 1;
+          at.x = cache.shelfX;
+          at.y = cache.shelfY;
+          cache.shelfX += w + GLYPH_PADDING;
+          cache.shelfHeight = SDL_max(cache.shelfHeight, h);
+          return true;
+     }
+
+     // Copy the pixels of an ARGB8888 surface into a newly allocated slot
+     void upload(GlyphCache &cache, SDL_Surface *surface, CachedGlyph &glyph)
+     {
+          SDL_Point at;
+          if (surface->w > 0 && surface->h > 0 && allocate(cache, surface->w, surface->h, glyph.page, at))
+          {
+               glyph.src = {at.x, at.y, surface->w, surface->h};
+               renderRecordUpdateTexture(cache.pages[glyph.page], &glyph.src, surface->pixels, surface->pitch);
+          }
+     }
+
+     CachedGlyph rasterize(GlyphCache &cache, TTF_Font *font, Uint32 codepoint, int variant)
+     {
+          CachedGlyph glyph;
+          glyph.page = -1;
+          glyph.src = {0, 0, 0, 0};
+          glyph.advance = 0;
+
+          int minx, maxx, miny, maxy;
+          if (TTF_GlyphMetrics32(font, codepoint, &minx, &maxx, &miny, &maxy, &glyph.advance) < 0)
+          {
+               return glyph;
+          }
+
+          const SDL_Color white = {255, 255, 255, 255};
+          SDL_Surface *surface;
+          {
+               MemoryTagScope tag(MEMORY_TAG_TTF);
+               surface = TTF_RenderGlyph32_Blended(font, codepoint, white);
+          }
+          if (surface == nullptr)
+          {
+               return glyph;
+          }
+          if (surface->format->format != SDL_PIXELFORMAT_ARGB8888)
+          {
+               SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+               SDL_FreeSurface(surface);
+               surface = converted;
+               if (surface == nullptr)
+               {
+                    return glyph;
+               }
+          }
+          if (variant > 0)
+          {
+               SDL_Surface *shifted = shiftGlyph(surface, (float)variant / cache.subpixelVariants);
+               SDL_FreeSurface(surface);
+               surface = shifted;
+               if (surface == nullptr)
+               {
+                    return glyph;
+               }
+          }
+
+          upload(cache, surface, glyph);
+          SDL_FreeSurface(surface);
+          cache.rasterizedCount++;
+          return glyph;
+     }
+
+     // While a font changes size, remember what is drawn that the next
+     // bucket does not have yet, so glyphCacheUpdate() does those first
+     void noteDrawn(GlyphCache &cache, GlyphCacheFont &font, int fontId, int style, Uint32 codepoint, int variant)
+     {
+          const Uint64 next = glyphKey(fontId, style, codepoint, variant, font.nextBucket);
+          if (cache.glyphs.find(next) != cache.glyphs.end())
+          {
+               return;
+          }
+          font.missedThisFrame++;
+          if (font.queued.insert(next).second)
+          {
+               font.visible.push_back(next);
+          }
+     }
+
+     void dropBucket(GlyphCache &cache, int fontId, int bucket)
+     {
+          for (auto it = cache.glyphs.begin(); it != cache.glyphs.end();)
+          {
+               const Uint64 key = it->first;
+               if ((key & GLYPH_KEY_EXTERNAL) == 0 && (int)(key >> 40) == fontId &&
+                   (int)((key >> 26) & (GLYPH_BUCKETS - 1)) == bucket)
+               {
+                    it = cache.glyphs.erase(it);
+               }
+               else
+               {
+                    ++it;
+               }
+          }
+     }
+
+     // The font's handle is at its current size here; the caller has
+     // switched it to the size `keys` belong to
+     int rasterizeKeys(GlyphCache &cache, TTF_Font *font, std::vector<Uint64> &keys, int budget)
+     {
+          const int style = TTF_GetFontStyle(font);
+          int done = 0;
+          size_t i = 0;
+          for (; i < keys.size() && done < budget; i++)
+          {
+               const Uint64 key = keys[i];
+               if (cache.glyphs.find(key) != cache.glyphs.end())
+               {
+                    continue;
+               }
+               const int keyStyle = (int)((key >> 32) & 0xFF);
+               if (keyStyle != TTF_GetFontStyle(font))
+               {
+                    TTF_SetFontStyle(font, keyStyle);
+               }
+               cache.glyphs[key] = rasterize(cache, font, (Uint32)(key & 0x1FFFFF), (int)((key >> 24) & 3));
+               done++;
+          }
+          keys.erase(keys.begin(), keys.begin() + i);
+          if (TTF_GetFontStyle(font) != style)
+          {
+               TTF_SetFontStyle(font, style);
+          }
+          return done;
+     }
+
+     void finishRescale(GlyphCache &cache, int fontId)
+     {
+          GlyphCacheFont &font = cache.fonts[fontId];
+          TTF_SetFontSizeDPI(font.font, font.nextPtsize, font.nextHdpi, font.nextVdpi);
+          dropBucket(cache, fontId, font.bucket);
+          font.ptsize = font.nextPtsize;
+          font.hdpi = font.nextHdpi;
+          font.vdpi = font.nextVdpi;
+          font.bucket = font.nextBucket;
+          font.lineSkip = TTF_FontLineSkip(font.font);
+          font.rescaling = false;
+          font.visible.clear();
+          font.queued.clear();
+     }
+}
+
+void glyphCacheInit(GlyphCache &cache, SDL_Renderer *renderer, int pageSize, int maxPages)
+{
+     cache.renderer = renderer;
+     cache.pageSize = pageSize;
+     cache.maxPages = SDL_max(1, maxPages);
+     cache.pages.clear();
+     cache.bakedPageCount = 0;
+     cache.shelfX = 0;
+     cache.shelfY = 0;
+     cache.shelfHeight = 0;
+     cache.fonts.clear();
+     cache.glyphs.clear();
+     cache.bakedGlyphs.clear();
+     cache.subpixelVariants = 1;
+     cache.rasterizedCount = 0;
+     cache.queue = nullptr;
+}
+
+void glyphCacheSetQueue(GlyphCache &cache, RenderQueue *queue)
+{
+     cache.queue = queue;
+}
+
+int glyphCacheAddFont(GlyphCache &cache, TTF_Font *font, int ptsize, unsigned hdpi, unsigned vdpi)
+{
+     GlyphCacheFont entry;
+     entry.font = font;
+     entry.lineSkip = TTF_FontLineSkip(font);
+     entry.ptsize = ptsize;
+     entry.hdpi = hdpi;
+     entry.vdpi = vdpi;
+     entry.bucket = 0;
+     entry.rescaling = false;
+     entry.nextPtsize = ptsize;
+     entry.nextHdpi = hdpi;
+     entry.nextVdpi = vdpi;
+     entry.nextBucket = 0;
+     entry.missedThisFrame = 0;
+     cache.fonts.push_back(entry);
+     return (int)cache.fonts.size() - 1;
+}
+
+void glyphCacheSetFontSizeDPI(GlyphCache &cache, int fontId, int ptsize, unsigned hdpi, unsigned vdpi)
+{
+     GlyphCacheFont &font = cache.fonts[fontId];
+     const bool current = ptsize == font.ptsize && hdpi == font.hdpi && vdpi == font.vdpi;
+     if (current && !font.rescaling)
+     {
+          return;
+     }
+     if (font.rescaling)
+     {
+          // The half-built bucket is for a size nobody wants any more
+          dropBucket(cache, fontId, font.nextBucket);
+          font.visible.clear();
+          font.queued.clear();
+          font.rescaling = false;
+     }
+     font.background.clear();
+     if (current)
+     {
+          return; // Back to the size it still draws at
+     }
+     font.nextPtsize = ptsize;
+     font.nextHdpi = hdpi;
+     font.nextVdpi = vdpi;
+     font.nextBucket = (font.bucket + 1) & (GLYPH_BUCKETS - 1);
+     if (font.ptsize == 0)
+     {
+          // No size to go back to between frames
+          finishRescale(cache, fontId);
+          return;
+     }
+
+     // Everything the old bucket holds, for after the visible glyphs
+     for (const auto &entry : cache.glyphs)
+     {
+          const Uint64 key = entry.first;
+          if ((key & GLYPH_KEY_EXTERNAL) == 0 && (int)(key >> 40) == fontId &&
+              (int)((key >> 26) & (GLYPH_BUCKETS - 1)) == font.bucket)
+          {
+               const Uint64 next = (key & ~((Uint64)(GLYPH_BUCKETS - 1) << 26)) | ((Uint64)font.nextBucket << 26);
+               font.background.push_back(next);
+          }
+     }
+     font.rescaling = true;
+     font.missedThisFrame = -1; // No frame drawn yet, so nothing is known to be ready
+}
+
+int glyphCacheUpdate(GlyphCache &cache, int budget)
+{
+     int rasterized = 0;
+     for (int fontId = 0; fontId < (int)cache.fonts.size(); fontId++)
+     {
+          GlyphCacheFont &font = cache.fonts[fontId];
+          if (font.rescaling && font.missedThisFrame == 0)
+          {
+               // Last frame drew nothing the new bucket lacks: switch now
+               finishRescale(cache, fontId);
+          }
+          if ((!font.rescaling && font.background.empty()) || rasterized >= budget)
+          {
+               font.missedThisFrame = 0;
+               continue;
+          }
+
+          // Rasterize at the new size, then put the font back for this frame's drawing
+          if (font.rescaling)
+          {
+               TTF_SetFontSizeDPI(font.font, font.nextPtsize, font.nextHdpi, font.nextVdpi);
+          }
+          rasterized += rasterizeKeys(cache, font.font, font.visible, budget - rasterized);
+          rasterized += rasterizeKeys(cache, font.font, font.background, budget - rasterized);
+          if (font.rescaling)
+          {
+               TTF_SetFontSizeDPI(font.font, font.ptsize, font.hdpi, font.vdpi);
+          }
+          font.missedThisFrame = 0;
+     }
+     return rasterized;
+}
+
+const CachedGlyph *glyphCacheGet(GlyphCache &cache, int fontId, Uint32 codepoint)
+{
+     GlyphCacheFont &entry = cache.fonts[fontId];
+     TTF_Font *font = entry.font;
+     const int style = TTF_GetFontStyle(font);
+     Uint64 key = glyphKey(fontId, style, codepoint, 0, entry.bucket);
+     if (entry.rescaling)
+     {
+          noteDrawn(cache, entry, fontId, style, codepoint, 0);
+     }
+
+     auto it = cache.glyphs.find(key);
+     if (it != cache.glyphs.end())
+     {
+          return &it->second;
+     }
+     auto baked = cache.bakedGlyphs.find(key);
+     if (baked != cache.bakedGlyphs.end())
+     {
+          return &baked->second;
+     }
+     CachedGlyph glyph = rasterize(cache, font, codepoint, 0);
+     return &(cache.glyphs[key] = glyph);
+}
+
+void glyphCacheSetSubpixel(GlyphCache &cache, int variants)
+{
+     cache.subpixelVariants = SDL_clamp(variants, 1, GLYPH_MAX_SUBPIXEL);
+}
+
+const CachedGlyph *glyphCacheGetAt(GlyphCache &cache, int fontId, Uint32 codepoint, float x, float *drawX)
+{
+     if (cache.subpixelVariants <= 1)
+     {
+          *drawX = x;
+          return glyphCacheGet(cache, fontId, codepoint);
+     }
+
+     // Nearest variant; rounding up past the last one moves to the next pixel
+     float pixel = std::floor(x);
+     int variant = (int)((x - pixel) * cache.subpixelVariants + 0.5f);
+     if (variant == cache.subpixelVariants)
+     {
+          pixel += 1.0f;
+          variant = 0;
+     }
+     *drawX = pixel;
+     if (variant == 0)
+     {
+          return glyphCacheGet(cache, fontId, codepoint);
+     }
+
+     GlyphCacheFont &entry = cache.fonts[fontId];
+     TTF_Font *font = entry.font;
+     const int style = TTF_GetFontStyle(font);
+     Uint64 key = glyphKey(fontId, style, codepoint, variant, entry.bucket);
+     if (entry.rescaling)
+     {
+          noteDrawn(cache, entry, fontId, style, codepoint, variant);
+     }
+     auto it = cache.glyphs.find(key);
+     if (it != cache.glyphs.end())
+     {
+          return &it->second;
+     }
+     CachedGlyph glyph = rasterize(cache, font, codepoint, variant);
+     return &(cache.glyphs[key] = glyph);
+}
+
+const CachedGlyph *glyphCacheFind(const GlyphCache &cache, Uint64 key)
+{
+     auto it = cache.glyphs.find(key);
+     return it == cache.glyphs.end() ? nullptr : &it->second;
+}
+
+const CachedGlyph *glyphCacheInsert(GlyphCache &cache, Uint64 key, SDL_Surface *surface, int advance)
+{
+     CachedGlyph glyph;
+     glyph.page = -1;
+     glyph.src = {0, 0, 0, 0};
+     glyph.advance = advance;
+     upload(cache, surface, glyph);
+     return &(cache.glyphs[key] = glyph);
+}
+
+int glyphCacheAddBakedPage(GlyphCache &cache, SDL_Surface *surface)
+{
+     if (surface->format->format != SDL_PIXELFORMAT_ARGB8888)
+     {
+          SDL_SetError("Baked glyph pages must be ARGB8888");
+          return -1;
+     }
+     SDL_Texture *texture = SDL_CreateTexture(cache.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+                                              surface->w, surface->h);
+     if (texture == nullptr)
+     {
+          std::cerr << "Unable to create baked glyph page! SDL Error: " << SDL_GetError() << std::endl;
+          return -1;
+     }
+     renderRecordSetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+     renderRecordUpdateTexture(texture, NULL, surface->pixels, surface->pitch);
+
+     // Baked pages stay ahead of the dynamic ones, which shift up by one
+     const int page = cache.bakedPageCount;
+     cache.pages.insert(cache.pages.begin() + page, texture);
+     cache.bakedPageCount++;
+     for (auto &entry : cache.glyphs)
+     {
+          if (entry.second.page >= page)
+          {
+               entry.second.page++;
+          }
+     }
+     return page;
+}
+
+void glyphCacheAddBakedGlyph(GlyphCache &cache, int fontId, int style, Uint32 codepoint, const CachedGlyph &glyph)
+{
+     cache.bakedGlyphs[glyphKey(fontId, style, codepoint, 0, cache.fonts[fontId].bucket)] = glyph;
+}
+
+void glyphCacheMeasure(GlyphCache &cache, int fontId, const char *text, int *w, int *h)
+{
+     utfDecode(text, cache.decoded);
+     glyphCacheMeasureCodepoints(cache, fontId, cache.decoded.data(), cache.decoded.size(), w, h);
+}
+
+void glyphCacheDrawText(GlyphCache &cache, RenderQueue &queue, int fontId, const char *text,
+                        float x, float y, SDL_Color color)
+{
+     utfDecode(text, cache.decoded);
+     glyphCacheDrawCodepoints(cache, queue, fontId, cache.decoded.data(), cache.decoded.size(), x, y, color);
+}
+
+void glyphCacheMeasureCodepoints(GlyphCache &cache, int fontId, const Uint32 *codepoints, size_t count, int *w, int *h)
+{
+     TTF_Font *font = cache.fonts[fontId].font;
+     int lineSkip = cache.fonts[fontId].lineSkip;
+     int width = 0, lineWidth = 0, lines = 1;
+     Uint32 previous = 0;
+
+     for (size_t i = 0; i < count; i++)
+     {
+          const Uint32 codepoint = codepoints[i];
+          if (codepoint == '\n')
+          {
+               width = SDL_max(width, lineWidth);
+               lineWidth = 0;
+               previous = 0;
+               lines++;
+               continue;
+          }
+          const CachedGlyph *glyph = glyphCacheGet(cache, fontId, codepoint);
+          if (previous != 0)
+          {
+               lineWidth += TTF_GetFontKerningSizeGlyphs32(font, previous, codepoint);
+          }
+          lineWidth += glyph->advance;
+          previous = codepoint;
+     }
+     if (w)
+     {
+          *w = SDL_max(width, lineWidth);
+     }
+     if (h)
+     {
+          *h = lines * lineSkip;
+     }
+}
+
+void glyphCacheDrawCodepoints(GlyphCache &cache, RenderQueue &queue, int fontId, const Uint32 *codepoints,
+                              size_t count, float x, float y, SDL_Color color)
+{
+     TTF_Font *font = cache.fonts[fontId].font;
+     int lineSkip = cache.fonts[fontId].lineSkip;
+     float penX = x, penY = y;
+     Uint32 previous = 0;
+
+     for (size_t i = 0; i < count; i++)
+     {
+          const Uint32 codepoint = codepoints[i];
+          if (codepoint == '\n')
+          {
+               penX = x;
+               penY += lineSkip;
+               previous = 0;
+               continue;
+          }
+          if (previous != 0)
+          {
+               penX += TTF_GetFontKerningSizeGlyphs32(font, previous, codepoint);
+          }
+          float drawX;
+          const CachedGlyph *glyph = glyphCacheGetAt(cache, fontId, codepoint, penX, &drawX);
+          if (glyph->page >= 0)
+          {
+               SDL_FRect dst = {drawX, penY, (float)glyph->src.w, (float)glyph->src.h};
+               renderQueueCopyTinted(queue, cache.pages[glyph->page], &glyph->src, dst, color);
+          }
+          penX += glyph->advance;
+          previous = codepoint;
+     }
+}
+
+void glyphCacheClear(GlyphCache &cache)
+{
+     cache.glyphs.clear();
+
+     // Keep only the first dynamic page; extra pages are recreated on demand.
+     // Text queued this frame may still draw from them, so the queue holds
+     // them until its flush, and the kept page is swapped for a fresh one
+     // rather than overwritten under those draws
+     const size_t keep = cache.bakedPageCount + 1;
+     const bool drawing = cache.queue != nullptr && !cache.queue->items.empty();
+     for (size_t i = keep; i < cache.pages.size(); i++)
+     {
+          glyphCacheRetireTexture(cache, cache.pages[i]);
+     }
+     if (cache.pages.size() > keep)
+     {
+          cache.pages.resize(keep);
+     }
+     if (drawing && cache.pages.size() == keep)
+     {
+          glyphCacheRetireTexture(cache, cache.pages[keep - 1]);
+          cache.pages[keep - 1] = createPage(cache);
+          if (cache.pages[keep - 1] == nullptr)
+          {
+               cache.pages.pop_back();
+          }
+     }
+     cache.shelfX = 0;
+     cache.shelfY = 0;
+     cache.shelfHeight = 0;
+}
+
+void glyphCacheRetireTexture(GlyphCache &cache, SDL_Texture *texture)
+{
+     if (cache.queue != nullptr)
+     {
+          renderQueueDestroyTexture(*cache.queue, texture);
+     }
+     else
+     {
+          renderRecordDestroyTexture(texture);
+     }
+}
+
+void glyphCacheDestroy(GlyphCache &cache)
+{
+     for (SDL_Texture *page : cache.pages)
+     {
+          renderRecordDestroyTexture(page);
+     }
+     cache.pages.clear();
+     cache.bakedPageCount = 0;
+     cache.glyphs.clear();
+     cache.bakedGlyphs.clear();
+     cache.fonts.clear();
+}
+
+Uint32 glyphCacheDecodeUtf8(const char *&text)
+{
+     const Uint8 *s = (const Uint8 *)text;
+     Uint32 c = s[0];
+     int length;
+     if (c < 0x80)
+     {
+          text += 1;
+          return c;
+     }
+     else if ((c & 0xE0) == 0xC0)
+     {
+          length = 2;
+          c &= 0x1F;
+     }
+     else if ((c & 0xF0) == 0xE0)
+     {
+          length = 3;
+          c &= 0x0F;
+     }
+     else if ((c & 0xF8) == 0xF0)
+     {
+          length = 4;
+          c &= 0x07;
+     }
+     else
+     {
+          text += 1;
+          return 0xFFFD;
+     }
+
+     for (int i = 1; i < length; i++)
+     {
+          if ((s[i] & 0xC0) != 0x80)
+          {
+               // Truncated sequence: consume only what was valid
+               text += i;
+               return 0xFFFD;
+          }
+          c = (c << 6) | (s[i] & 0x3F);
+     }
+     text += length;
+     return c;
+}
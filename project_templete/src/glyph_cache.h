@@ -0,0 +1,179 @@
+// Description:
+// Glyph atlas cache for SDL_ttf. Each glyph is rasterized once with
+// TTF_RenderGlyph32_Blended into a shared texture page and remembered by
+// (font, style, codepoint). Strings are then laid out with
+// TTF_GlyphMetrics32 / TTF_GetFontKerningSizeGlyphs32 and queued as textured
+// quads, so a whole HUD draws in one SDL_RenderGeometry batch and changing
+// text costs no rasterization or texture creation.
+//
+// Glyphs are cached white and tinted per vertex, so one entry serves every
+// text color. With subpixel positioning on, each glyph also gets up to four
+// variants shifted right by fractions of a pixel, so text that moves by
+// less than a pixel per frame glides instead of snapping between pixels,
+// without rasterizing again once the variants are cached.
+//
+// Pages baked ahead of time (see glyph_bake.h) are added as pinned pages:
+// their glyphs are found before anything is rasterized, and neither shelf
+// packing nor glyphCacheClear() ever touches them.
+//
+// A DPI change (moving to another monitor) would re-rasterize every glyph
+// on screen in the next frame. glyphCacheSetFontSizeDPI() instead opens a
+// new bucket for the font's glyphs at the new size, and glyphCacheUpdate()
+// fills it a budget of glyphs per frame: glyphs that were drawn last frame
+// first, then the rest of the old bucket. Text keeps drawing from the old
+// glyphs, old metrics and kerning included, until a whole frame has drawn
+// nothing the new bucket lacks; then the font switches over in one frame
+// and the old bucket is dropped.
+//
+// A full cache starts over in the middle of a frame, while text queued
+// earlier in it still draws from the pages. Give the cache the queue it
+// draws through (glyphCacheSetQueue) and those pages are destroyed only
+// after that queue's flush, with a fresh page taking over.
+// =============================================================================
+
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "render_queue.h"
+
+struct CachedGlyph
+{
+     int page;     // Index into GlyphCache::pages, -1 for glyphs with no pixels
+     SDL_Rect src; // Texel rect on the page
+     int advance;  // Horizontal pen advance in pixels
+};
+
+// Glyphs rasterized per glyphCacheUpdate() while a font changes size
+const int GLYPH_RESCALE_BUDGET = 24;
+
+struct GlyphCacheFont
+{
+     TTF_Font *font;
+     int lineSkip;
+     int ptsize; // 0 when unknown; sizes then change all at once
+     unsigned hdpi, vdpi;
+     int bucket; // Part of every glyph key; changes with the size
+
+     // A size change in progress, see glyphCacheSetFontSizeDPI()
+     bool rescaling;
+     int nextPtsize;
+     unsigned nextHdpi, nextVdpi;
+     int nextBucket;
+     std::vector<Uint64> visible;    // Next-bucket keys drawn but missing, rasterized first
+     std::vector<Uint64> background; // Next-bucket keys for the rest of the old glyphs
+     std::unordered_set<Uint64> queued;
+     int missedThisFrame; // Glyphs drawn since the last update the next bucket lacked
+};
+
+struct GlyphCache
+{
+     SDL_Renderer *renderer;
+     int pageSize;
+     int maxPages; // Dynamic pages, not counting baked ones
+     std::vector<SDL_Texture *> pages; // Baked pages first, then dynamic ones
+     int bakedPageCount;
+
+     // Shelf packing state for the newest page
+     int shelfX, shelfY, shelfHeight;
+
+     std::vector<GlyphCacheFont> fonts;
+     std::unordered_map<Uint64, CachedGlyph> glyphs;
+     std::unordered_map<Uint64, CachedGlyph> bakedGlyphs; // Kept across glyphCacheClear()
+
+     int subpixelVariants; // Horizontal positions per glyph, 1 when off
+
+     int rasterizedCount; // Glyphs rasterized since creation, a cache-miss counter
+
+     std::vector<Uint32> decoded; // Scratch for the UTF-8 entry points
+
+     RenderQueue *queue; // Draws from the pages, nullptr if unknown; see glyphCacheSetQueue()
+};
+
+void glyphCacheInit(GlyphCache &cache, SDL_Renderer *renderer, int pageSize, int maxPages);
+
+// The queue the pages are drawn through. Pages dropped while it holds
+// items then wait for its next flush or clear, see renderQueueDestroyTexture()
+void glyphCacheSetQueue(GlyphCache &cache, RenderQueue *queue);
+
+// Destroy a texture drawn alongside the pages, such as a run too big for
+// them, the same way: after the queue's next flush if it holds items
+void glyphCacheRetireTexture(GlyphCache &cache, SDL_Texture *texture);
+
+// Register a font; the returned id is used for drawing. The cache does not
+// take ownership of the font. Give the size it was opened at (and its DPI,
+// 0 for TTF's default) for glyphCacheSetFontSizeDPI() to change it gradually
+int glyphCacheAddFont(GlyphCache &cache, TTF_Font *font, int ptsize = 0, unsigned hdpi = 0, unsigned vdpi = 0);
+
+// Move a font to another size or DPI, as TTF_SetFontSizeDPI does, but
+// without the spike: the cache keeps drawing the old glyphs while
+// glyphCacheUpdate() rasterizes the new ones. A font added without its
+// size changes at once. Another change while one is in progress replaces it
+void glyphCacheSetFontSizeDPI(GlyphCache &cache, int fontId, int ptsize, unsigned hdpi, unsigned vdpi);
+
+// Once per frame, before drawing: rasterize up to `budget` glyphs for
+// size changes in progress, and finish the ones that are ready. Returns
+// the glyphs rasterized
+int glyphCacheUpdate(GlyphCache &cache, int budget = GLYPH_RESCALE_BUDGET);
+
+// Look up a glyph, rasterizing it on a miss
+const CachedGlyph *glyphCacheGet(GlyphCache &cache, int fontId, Uint32 codepoint);
+
+// Horizontal subpixel positions kept per glyph, from 1 (off, the default)
+// to 4. Glyphs are then drawn at whole pixels from the variant pre-shifted
+// by the nearest fraction of a pixel.
+void glyphCacheSetSubpixel(GlyphCache &cache, int variants);
+
+// The glyph to draw with its pen at `x`, and in `drawX` the x to draw it
+// at: `x` itself with subpixel positioning off, else a whole pixel
+const CachedGlyph *glyphCacheGetAt(GlyphCache &cache, int fontId, Uint32 codepoint, float x, float *drawX);
+
+// Keys with this bit set are free for callers that prepare their own glyph
+// images (see glyphCacheInsert); the cache never generates them itself
+const Uint64 GLYPH_KEY_EXTERNAL = (Uint64)1 << 63;
+
+// Look up an entry stored with glyphCacheInsert(), nullptr if absent
+const CachedGlyph *glyphCacheFind(const GlyphCache &cache, Uint64 key);
+
+// Upload a prepared white-on-alpha surface as a glyph under a caller key;
+// the surface is not freed
+const CachedGlyph *glyphCacheInsert(GlyphCache &cache, Uint64 key, SDL_Surface *surface, int advance);
+
+// Upload a finished ARGB8888 white-on-alpha atlas page as a pinned page;
+// returns its page index, or -1 on failure. Glyphs already on dynamic
+// pages move up one page index.
+int glyphCacheAddBakedPage(GlyphCache &cache, SDL_Surface *surface);
+
+// Register a glyph whose pixels are on a baked page (page -1 for a glyph
+// with no pixels), as if glyphCacheGet() had rasterized it in `style`
+void glyphCacheAddBakedGlyph(GlyphCache &cache, int fontId, int style, Uint32 codepoint, const CachedGlyph &glyph);
+
+// Width of the widest line and total height of UTF-8 text
+void glyphCacheMeasure(GlyphCache &cache, int fontId, const char *text, int *w, int *h);
+
+// Queue UTF-8 text with its top-left corner at (x, y); '\n' starts a new line
+void glyphCacheDrawText(GlyphCache &cache, RenderQueue &queue, int fontId, const char *text,
+                        float x, float y, SDL_Color color);
+
+// The same for text already decoded (see utfDecode), so callers that keep
+// their strings as codepoints decode them once rather than on every call
+void glyphCacheMeasureCodepoints(GlyphCache &cache, int fontId, const Uint32 *codepoints, size_t count, int *w, int *h);
+void glyphCacheDrawCodepoints(GlyphCache &cache, RenderQueue &queue, int fontId, const Uint32 *codepoints,
+                              size_t count, float x, float y, SDL_Color color);
+
+// Forget every rasterized glyph but keep the page textures for reuse;
+// baked glyphs stay. Pages the queue still draws from are replaced, not reused
+void glyphCacheClear(GlyphCache &cache);
+
+void glyphCacheDestroy(GlyphCache &cache);
+
+// Decode one UTF-8 sequence and advance `text`; invalid bytes become U+FFFD.
+// utfDecode() does the same for a whole string
+Uint32 glyphCacheDecodeUtf8(const char *&text);
+
+#endif // GLYPH_CACHE_H
@@ -0,0 +1,159 @@
+#include "gpu_timer.h"
+
+#include <SDL2/SDL_opengl.h>
+
+namespace
+{
+     // Smoothing of averageMs; about the last twenty frames
+     const double AVERAGE_WEIGHT = 0.05;
+
+     struct GlQueries
+     {
+          PFNGLGENQUERIESPROC genQueries;
+          PFNGLDELETEQUERIESPROC deleteQueries;
+          PFNGLQUERYCOUNTERPROC queryCounter;
+          PFNGLGETQUERYOBJECTIVPROC getQueryObjectiv;
+          PFNGLGETQUERYOBJECTUI64VPROC getQueryObjectui64v;
+     };
+     GlQueries gl;
+
+     bool loadGl(SDL_Renderer *renderer)
+     {
+          SDL_RendererInfo info;
+          if (SDL_GetRendererInfo(renderer, &info) != 0 || SDL_strcmp(info.name, "opengl") != 0 ||
+              SDL_GL_GetCurrentContext() == nullptr || !SDL_GL_ExtensionSupported("GL_ARB_timer_query"))
+          {
+               return false;
+          }
+          gl.genQueries = (PFNGLGENQUERIESPROC)SDL_GL_GetProcAddress("glGenQueries");
+          gl.deleteQueries = (PFNGLDELETEQUERIESPROC)SDL_GL_GetProcAddress("glDeleteQueries");
+          gl.queryCounter = (PFNGLQUERYCOUNTERPROC)SDL_GL_GetProcAddress("glQueryCounter");
+          gl.getQueryObjectiv = (PFNGLGETQUERYOBJECTIVPROC)SDL_GL_GetProcAddress("glGetQueryObjectiv");
+          gl.getQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VPROC)SDL_GL_GetProcAddress("glGetQueryObjectui64v");
+          return gl.genQueries != nullptr && gl.deleteQueries != nullptr && gl.queryCounter != nullptr &&
+                 gl.getQueryObjectiv != nullptr && gl.getQueryObjectui64v != nullptr;
+     }
+
+     // Read the slot's result if the driver has it; never waits
+     void collect(GpuTimerRegion &region, int slot)
+     {
+          if (!region.issued[slot])
+          {
+               return;
+          }
+          region.issued[slot] = false;
+
+          GLint available = 0;
+          gl.getQueryObjectiv(region.queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+          if (!available)
+          {
+               region.dropped++;
+               return;
+          }
+          GLuint64 begin = 0, end = 0;
+          gl.getQueryObjectui64v(region.queries[slot][0], GL_QUERY_RESULT, &begin);
+          gl.getQueryObjectui64v(region.queries[slot][1], GL_QUERY_RESULT, &end);
+          double ms = end > begin ? (end - begin) / 1000000.0 : 0.0;
+          region.averageMs = region.lastMs < 0.0 ? ms : region.averageMs + (ms - region.averageMs) * AVERAGE_WEIGHT;
+          region.lastMs = ms;
+     }
+}
+
+bool gpuTimerInit(GpuTimer &timer, SDL_Renderer *renderer)
+{
+     timer.renderer = renderer;
+     timer.supported = loadGl(renderer);
+     timer.enabled = true;
+     timer.regionCount = 0;
+     timer.open = -1;
+     timer.frame = 0;
+     return timer.supported;
+}
+
+int gpuTimerAddRegion(GpuTimer &timer, const char *name)
+{
+     if (timer.regionCount == GPU_TIMER_MAX_REGIONS)
+     {
+          return -1;
+     }
+     int index = timer.regionCount++;
+     GpuTimerRegion &region = timer.regions[index];
+     region.name = name;
+     region.lastMs = -1.0;
+     region.averageMs = 0.0;
+     region.dropped = 0;
+     for (int slot = 0; slot < GPU_TIMER_LATENCY; slot++)
+     {
+          region.queries[slot][0] = 0;
+          region.queries[slot][1] = 0;
+          region.issued[slot] = false;
+     }
+     if (timer.supported)
+     {
+          gl.genQueries(2 * GPU_TIMER_LATENCY, &region.queries[0][0]);
+     }
+     return index;
+}
+
+void gpuTimerBegin(GpuTimer &timer, int region)
+{
+     if (!timer.supported || !timer.enabled || region < 0 || timer.open >= 0)
+     {
+          return;
+     }
+     // Whatever SDL batched before the region executes before the stamp
+     SDL_RenderFlush(timer.renderer);
+     int slot = timer.frame % GPU_TIMER_LATENCY;
+     gl.queryCounter(timer.regions[region].queries[slot][0], GL_TIMESTAMP);
+     timer.open = region;
+}
+
+void gpuTimerEnd(GpuTimer &timer, int region)
+{
+     if (timer.open != region || region < 0)
+     {
+          return;
+     }
+     SDL_RenderFlush(timer.renderer);
+     int slot = timer.frame % GPU_TIMER_LATENCY;
+     gl.queryCounter(timer.regions[region].queries[slot][1], GL_TIMESTAMP);
+     timer.regions[region].issued[slot] = true;
+     timer.open = -1;
+}
+
+void gpuTimerFrameEnd(GpuTimer &timer)
+{
+     if (!timer.supported)
+     {
+          return;
+     }
+     // The slot about to be reused was issued GPU_TIMER_LATENCY - 1 frames ago
+     timer.frame++;
+     int slot = timer.frame % GPU_TIMER_LATENCY;
+     for (int i = 0; i < timer.regionCount; i++)
+     {
+          collect(timer.regions[i], slot);
+     }
+}
+
+double gpuTimerResultMs(const GpuTimer &timer, int region)
+{
+     if (region < 0 || region >= timer.regionCount)
+     {
+          return -1.0;
+     }
+     return timer.regions[region].lastMs;
+}
+
+void gpuTimerDestroy(GpuTimer &timer)
+{
+     if (timer.supported)
+     {
+          for (int i = 0; i < timer.regionCount; i++)
+          {
+               gl.deleteQueries(2 * GPU_TIMER_LATENCY, &timer.regions[i].queries[0][0]);
+          }
+     }
+     timer.regionCount = 0;
+     timer.supported = false;
+}
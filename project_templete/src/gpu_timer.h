@@ -0,0 +1,65 @@
+// Description:
+// GPU time per render region, measured with timestamp queries. CPU timers
+// only see how long it took to hand commands to the driver; a timestamp
+// written at the start and end of a region shows how long the GPU spent
+// executing it. Each region begins and ends with SDL_RenderFlush() so the
+// commands SDL has batched land between the two timestamps.
+//
+// Results are read back GPU_TIMER_LATENCY frames later, and only once the
+// driver reports them available, so timing never stalls the pipeline. A
+// query that is still pending when its slot comes round again is counted
+// as dropped.
+//
+// SDL 2 exposes a native context for the OpenGL renderer only, so that is
+// the one backend measured (GL_ARB_timer_query, core in GL 3.3). On other
+// renderers gpuTimerInit() returns false and every call is a no-op.
+// =============================================================================
+
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <SDL2/SDL.h>
+
+const int GPU_TIMER_MAX_REGIONS = 8;
+const int GPU_TIMER_LATENCY = 4; // Frames of queries in flight per region
+
+struct GpuTimerRegion
+{
+     const char *name;
+     Uint32 queries[GPU_TIMER_LATENCY][2]; // Begin and end timestamp per frame slot
+     bool issued[GPU_TIMER_LATENCY];
+     double lastMs;    // Newest completed measurement, -1 before the first
+     double averageMs; // Exponential moving average
+     int dropped;
+};
+
+struct GpuTimer
+{
+     SDL_Renderer *renderer;
+     bool supported;
+     bool enabled; // Regions are skipped while false; pending results still arrive
+     int regionCount;
+     GpuTimerRegion regions[GPU_TIMER_MAX_REGIONS];
+     int open; // Region between begin and end, or -1
+     int frame;
+};
+
+// Returns false when the renderer has no timestamp queries
+bool gpuTimerInit(GpuTimer &timer, SDL_Renderer *renderer);
+
+// Returns the region index, or -1 when full. `name` must outlive the timer.
+int gpuTimerAddRegion(GpuTimer &timer, const char *name);
+
+// Regions do not nest; begin and end them within one frame
+void gpuTimerBegin(GpuTimer &timer, int region);
+void gpuTimerEnd(GpuTimer &timer, int region);
+
+// Call once per presented frame: collects finished results
+void gpuTimerFrameEnd(GpuTimer &timer);
+
+// Newest GPU time of `region` in milliseconds, or -1 if none yet
+double gpuTimerResultMs(const GpuTimer &timer, int region);
+
+void gpuTimerDestroy(GpuTimer &timer);
+
+#endif // GPU_TIMER_H
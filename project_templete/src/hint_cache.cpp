@@ -0,0 +1,113 @@
+#include "hint_cache.h"
+
+#include <string>
+
+namespace
+{
+     const int HINT_UNSET = -1;
+
+     struct HintEntry
+     {
+          std::string name;
+          std::string value;
+          bool hasValue;
+          SDL_atomic_t boolean; // 0 or 1, HINT_UNSET when unset or empty
+          SDL_atomic_t integer;
+          SDL_atomic_t hasInteger;
+          SDL_atomic_t changes;
+     };
+
+     HintEntry hintEntries[HINT_CACHE_MAX];
+     SDL_atomic_t hintCount;
+     SDL_atomic_t hintLookups;
+     SDL_SpinLock hintInternLock = 0;
+
+     void SDLCALL hintChanged(void *userdata, const char *, const char *, const char *newValue)
+     {
+          HintEntry &entry = hintEntries[(intptr_t)userdata];
+          entry.hasValue = newValue != nullptr;
+          entry.value = newValue != nullptr ? newValue : "";
+          const bool empty = newValue == nullptr || *newValue == '\0';
+          const bool isFalse = !empty && (SDL_strcmp(newValue, "0") == 0 || SDL_strcasecmp(newValue, "false") == 0);
+          SDL_AtomicSet(&entry.boolean, empty ? HINT_UNSET : isFalse ? 0 : 1);
+          // Base 0, so "0x10" is 16 and "010" is 8, as SDL_strtol reads them
+          SDL_AtomicSet(&entry.integer, empty ? 0 : (int)SDL_strtol(newValue, nullptr, 0));
+          SDL_AtomicSet(&entry.hasInteger, empty ? 0 : 1);
+          SDL_AtomicIncRef(&entry.changes);
+     }
+
+     const HintEntry *entryOf(HintId id)
+     {
+          return id >= 0 && id < SDL_AtomicGet(&hintCount) ? &hintEntries[id] : nullptr;
+     }
+}
+
+HintId hintIntern(const char *name)
+{
+     SDL_AtomicIncRef(&hintLookups);
+     SDL_AtomicLock(&hintInternLock);
+     const int count = SDL_AtomicGet(&hintCount);
+     for (int i = 0; i < count; i++)
+     {
+          if (hintEntries[i].name == name)
+          {
+               SDL_AtomicUnlock(&hintInternLock);
+               return i;
+          }
+     }
+     if (count >= HINT_CACHE_MAX)
+     {
+          SDL_AtomicUnlock(&hintInternLock);
+          return -1;
+     }
+     HintEntry &entry = hintEntries[count];
+     entry.name = name;
+     entry.hasValue = false;
+     SDL_AtomicSet(&entry.boolean, HINT_UNSET);
+     SDL_AtomicSet(&entry.hasInteger, 0);
+     // Calls back at once with the current value, environment included
+     SDL_AddHintCallback(name, hintChanged, (void *)(intptr_t)count);
+     SDL_AtomicSet(&entry.changes, 0);
+     SDL_AtomicSet(&hintCount, count + 1);
+     SDL_AtomicUnlock(&hintInternLock);
+     return count;
+}
+
+bool hintBoolean(HintId id, bool defaultValue)
+{
+     const HintEntry *entry = entryOf(id);
+     const int value = entry != nullptr ? SDL_AtomicGet(const_cast<SDL_atomic_t *>(&entry->boolean)) : HINT_UNSET;
+     return value == HINT_UNSET ? defaultValue : value != 0;
+}
+
+int hintInt(HintId id, int defaultValue)
+{
+     const HintEntry *entry = entryOf(id);
+     if (entry == nullptr || !SDL_AtomicGet(const_cast<SDL_atomic_t *>(&entry->hasInteger)))
+     {
+          return defaultValue;
+     }
+     return SDL_AtomicGet(const_cast<SDL_atomic_t *>(&entry->integer));
+}
+
+const char *hintString(HintId id)
+{
+     const HintEntry *entry = entryOf(id);
+     return entry != nullptr && entry->hasValue ? entry->value.c_str() : nullptr;
+}
+
+Uint32 hintChanges(HintId id)
+{
+     const HintEntry *entry = entryOf(id);
+     return entry != nullptr ? (Uint32)SDL_AtomicGet(const_cast<SDL_atomic_t *>(&entry->changes)) : 0;
+}
+
+bool hintGetBoolean(const char *name, bool defaultValue)
+{
+     return hintBoolean(hintIntern(name), defaultValue);
+}
+
+int hintCacheEndFrame()
+{
+     return SDL_AtomicSet(&hintLookups, 0);
+}
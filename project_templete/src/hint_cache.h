@@ -0,0 +1,60 @@
+// Description:
+// Hints read without a string lookup. SDL_GetHint and SDL_GetHintBoolean
+// take SDL's hint list, walk it comparing names and, for a hint nobody
+// set, fall back to getenv(), each time they are called, which adds up in
+// code that checks a hint per frame, per blit or per event.
+//
+// hintIntern() does that lookup once: it gives the hint a small integer
+// id and registers an SDL_AddHintCallback that keeps a parsed copy of the
+// value current. hintBoolean(), hintInt() and hintString() then read the
+// copy by id, boolean and integer values from any thread. Keep the id in
+// a function-local static next to its use:
+//
+//     static const HintId parallelHint = hintIntern(PARALLEL_PIXELS_HINT);
+//     if (hintBoolean(parallelHint, false)) ...
+//
+// Every lookup by name (interning, and the by-name convenience calls) is
+// counted; hintCacheEndFrame() returns the frame's count for the profiler,
+// so a by-name read that crept into a hot path shows up in the overlay.
+// SDL_Quit clears SDL's hint callbacks along with the hints, after which
+// the copies keep their last values.
+// =============================================================================
+
+#ifndef HINT_CACHE_H
+#define HINT_CACHE_H
+
+#include <SDL2/SDL.h>
+
+#define HINT_CACHE_MAX 128
+
+typedef int HintId; // -1 for none
+
+// The id of `name`, the same for every call with the same name. -1 when
+// HINT_CACHE_MAX hints are interned already, which every accessor treats
+// as an unset hint
+HintId hintIntern(const char *name);
+
+// SDL_GetHintBoolean's parsing: unset or empty gives `defaultValue`, "0"
+// and "false" (any case) give false, anything else true
+bool hintBoolean(HintId id, bool defaultValue);
+
+// SDL_strtol of the value with the base detected from its prefix ("0x"
+// hex, a leading '0' octal), or `defaultValue` when unset or empty
+int hintInt(HintId id, int defaultValue);
+
+// The value, or nullptr when unset. Like SDL_GetHint's result it is only
+// valid until the hint changes, so read it on the thread that sets hints
+const char *hintString(HintId id);
+
+// Changes seen since interning, to know when something derived from the
+// hint needs recomputing
+Uint32 hintChanges(HintId id);
+
+// Look up by name: hintIntern() and the accessor in one call. A string
+// lookup, counted like SDL_GetHintBoolean would be; for startup code
+bool hintGetBoolean(const char *name, bool defaultValue);
+
+// Lookups by name since the previous call
+int hintCacheEndFrame();
+
+#endif // HINT_CACHE_H
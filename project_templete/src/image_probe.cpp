@@ -0,0 +1,499 @@
+#include "image_probe.h"
+
+#include <cstring>
+
+#include "buffered_rw.h"
+
+namespace
+{
+     bool readBytes(SDL_RWops *rw, void *data, size_t size)
+     {
+          return SDL_RWread(rw, data, 1, size) == size;
+     }
+
+     bool skipBytes(SDL_RWops *rw, Sint64 size)
+     {
+          return SDL_RWseek(rw, size, RW_SEEK_CUR) >= 0;
+     }
+
+     Uint32 be32(const Uint8 *p)
+     {
+          return (Uint32)p[0] << 24 | (Uint32)p[1] << 16 | (Uint32)p[2] << 8 | p[3];
+     }
+
+     Uint16 be16(const Uint8 *p)
+     {
+          return (Uint16)(p[0] << 8 | p[1]);
+     }
+
+     Uint32 le32(const Uint8 *p)
+     {
+          return (Uint32)p[3] << 24 | (Uint32)p[2] << 16 | (Uint32)p[1] << 8 | p[0];
+     }
+
+     Uint32 le24(const Uint8 *p)
+     {
+          return (Uint32)p[2] << 16 | (Uint32)p[1] << 8 | p[0];
+     }
+
+     Uint16 le16(const Uint8 *p)
+     {
+          return (Uint16)(p[1] << 8 | p[0]);
+     }
+
+     // Chunks up to the first IDAT: IHDR, then tRNS and APNG's acTL if present
+     bool probePng(SDL_RWops *rw, ImageInfo &info)
+     {
+          Uint8 ihdr[8 + 13 + 4];
+          if (!readBytes(rw, ihdr, sizeof(ihdr)) || be32(ihdr) != 13 || std::memcmp(ihdr + 4, "IHDR", 4) != 0)
+          {
+               return false;
+          }
+          info.width = (int)be32(ihdr + 8);
+          info.height = (int)be32(ihdr + 12);
+          info.bitDepth = ihdr[16];
+          const Uint8 colorType = ihdr[17];
+          static const int channelsByType[7] = {1, 0, 3, 3, 2, 0, 4};
+          if (colorType > 6 || channelsByType[colorType] == 0)
+          {
+               return false;
+          }
+          info.channels = channelsByType[colorType];
+
+          for (;;)
+          {
+               Uint8 chunk[8];
+               if (!readBytes(rw, chunk, sizeof(chunk)))
+               {
+                    return true; // No image data, but the header was fine
+               }
+               const Uint32 length = be32(chunk);
+               if (std::memcmp(chunk + 4, "IDAT", 4) == 0 || std::memcmp(chunk + 4, "IEND", 4) == 0)
+               {
+                    return true;
+               }
+               if (std::memcmp(chunk + 4, "acTL", 4) == 0 && length >= 4)
+               {
+                    Uint8 frames[4];
+                    if (!readBytes(rw, frames, sizeof(frames)))
+                    {
+                         return false;
+                    }
+                    info.frames = SDL_max((int)be32(frames), 1);
+                    if (!skipBytes(rw, (Sint64)length)) // Rest of the chunk and its CRC
+                    {
+                         return false;
+                    }
+                    continue;
+               }
+               if (std::memcmp(chunk + 4, "tRNS", 4) == 0)
+               {
+                    // Palette or color-key transparency decodes with an alpha channel
+                    info.channels = info.channels == 1 ? 2 : SDL_max(info.channels, 4);
+               }
+               if (!skipBytes(rw, (Sint64)length + 4)) // Data and CRC
+               {
+                    return false;
+               }
+          }
+     }
+
+     // Markers up to the first start-of-frame
+     bool probeJpeg(SDL_RWops *rw, ImageInfo &info)
+     {
+          for (;;)
+          {
+               Uint8 marker[2];
+               if (!readBytes(rw, marker, sizeof(marker)) || marker[0] != 0xFF)
+               {
+                    return false;
+               }
+               if (marker[1] == 0xFF)
+               {
+                    SDL_RWseek(rw, -1, RW_SEEK_CUR); // Fill byte
+                    continue;
+               }
+               if (marker[1] == 0x01 || (marker[1] >= 0xD0 && marker[1] <= 0xD8))
+               {
+                    continue; // Markers without a length
+               }
+               Uint8 length[2];
+               if (!readBytes(rw, length, sizeof(length)) || be16(length) < 2)
+               {
+                    return false;
+               }
+               const bool startOfFrame =
+                   marker[1] >= 0xC0 && marker[1] <= 0xCF && marker[1] != 0xC4 && marker[1] != 0xC8 && marker[1] != 0xCC;
+               if (startOfFrame)
+               {
+                    Uint8 frame[6];
+                    if (!readBytes(rw, frame, sizeof(frame)))
+                    {
+                         return false;
+                    }
+                    info.bitDepth = frame[0];
+                    info.height = be16(frame + 1);
+                    info.width = be16(frame + 3);
+                    info.channels = frame[5] >= 3 ? 3 : 1; // CMYK/YCCK still decode to color
+                    return true;
+               }
+               if (!skipBytes(rw, be16(length) - 2))
+               {
+                    return false;
+               }
+          }
+     }
+
+     // Skip a run of data sub-blocks, ending at the zero-length terminator
+     bool skipGifSubBlocks(SDL_RWops *rw)
+     {
+          for (;;)
+          {
+               Uint8 size;
+               if (!readBytes(rw, &size, 1))
+               {
+                    return false;
+               }
+               if (size == 0)
+               {
+                    return true;
+               }
+               if (!skipBytes(rw, size))
+               {
+                    return false;
+               }
+          }
+     }
+
+     // Logical screen, then every block to count frames, skipping LZW data
+     bool probeGif(SDL_RWops *rw, ImageInfo &info)
+     {
+          Uint8 screen[7];
+          if (!readBytes(rw, screen, sizeof(screen)))
+          {
+               return false;
+          }
+          info.width = le16(screen);
+          info.height = le16(screen + 2);
+          info.channels = 3;
+          info.bitDepth = (screen[4] & 0x07) + 1;
+          info.frames = 0;
+          if ((screen[4] & 0x80) && !skipBytes(rw, 3 << ((screen[4] & 0x07) + 1)))
+          {
+               return false;
+          }
+
+          for (;;)
+          {
+               Uint8 block;
+               if (!readBytes(rw, &block, 1) || block == 0x3B)
+               {
+                    break; // Trailer, or a truncated file: report the frames so far
+               }
+               if (block == 0x2C)
+               {
+                    Uint8 descriptor[9];
+                    if (!readBytes(rw, descriptor, sizeof(descriptor)))
+                    {
+                         break;
+                    }
+                    if ((descriptor[8] & 0x80) && !skipBytes(rw, 3 << ((descriptor[8] & 0x07) + 1)))
+                    {
+                         break;
+                    }
+                    info.bitDepth = SDL_max(info.bitDepth, (descriptor[8] & 0x80) ? (descriptor[8] & 0x07) + 1 : 0);
+                    if (!skipBytes(rw, 1) || !skipGifSubBlocks(rw)) // LZW minimum code size, then the data
+                    {
+                         break;
+                    }
+                    info.frames++;
+               }
+               else if (block == 0x21)
+               {
+                    Uint8 label;
+                    if (!readBytes(rw, &label, 1))
+                    {
+                         break;
+                    }
+                    if (label == 0xF9)
+                    {
+                         // Graphic control extension: size, flags, delay, index
+                         Uint8 control[6];
+                         if (!readBytes(rw, control, sizeof(control)))
+                         {
+                              break;
+                         }
+                         if (control[1] & 0x01)
+                         {
+                              info.channels = 4;
+                         }
+                         if (control[5] != 0 && !skipGifSubBlocks(rw))
+                         {
+                              break;
+                         }
+                    }
+                    else if (!skipGifSubBlocks(rw))
+                    {
+                         break;
+                    }
+               }
+               else
+               {
+                    break;
+               }
+          }
+          info.frames = SDL_max(info.frames, 1);
+          return info.width > 0 && info.height > 0;
+     }
+
+     bool probeBmp(SDL_RWops *rw, ImageInfo &info)
+     {
+          Uint8 header[12 + 16]; // Rest of the file header, then the info header up to its bit count
+          if (!readBytes(rw, header, sizeof(header)))
+          {
+               return false;
+          }
+          const Uint32 infoSize = le32(header + 12);
+          int bitsPerPixel;
+          if (infoSize == 12)
+          {
+               // BITMAPCOREHEADER
+               info.width = le16(header + 16);
+               info.height = le16(header + 18);
+               bitsPerPixel = le16(header + 22);
+          }
+          else if (infoSize >= 40)
+          {
+               info.width = (int)le32(header + 16);
+               info.height = SDL_abs((int)le32(header + 20)); // Negative for top-down rows
+               bitsPerPixel = le16(header + 26);
+          }
+          else
+          {
+               return false;
+          }
+          info.channels = bitsPerPixel == 32 ? 4 : 3;
+          info.bitDepth = bitsPerPixel <= 8 ? bitsPerPixel : (bitsPerPixel == 16 ? 5 : 8);
+          return bitsPerPixel > 0;
+     }
+
+     bool probeQoi(SDL_RWops *rw, ImageInfo &info)
+     {
+          Uint8 header[10];
+          if (!readBytes(rw, header, sizeof(header)) || (header[8] != 3 && header[8] != 4))
+          {
+               return false;
+          }
+          info.width = (int)be32(header);
+          info.height = (int)be32(header + 4);
+          info.channels = header[8];
+          info.bitDepth = 8;
+          return true;
+     }
+
+     // The first chunk says which bitstream; extended files are walked for ANMF
+     bool probeWebp(SDL_RWops *rw, ImageInfo &info)
+     {
+          Uint8 chunk[8 + 10];
+          if (!readBytes(rw, chunk, sizeof(chunk)))
+          {
+               return false;
+          }
+          const Uint8 *data = chunk + 8;
+          info.bitDepth = 8;
+          if (std::memcmp(chunk, "VP8 ", 4) == 0)
+          {
+               // Frame tag, start code, then 14-bit dimensions with scale bits
+               if (data[3] != 0x9D || data[4] != 0x01 || data[5] != 0x2A)
+               {
+                    return false;
+               }
+               info.width = le16(data + 6) & 0x3FFF;
+               info.height = le16(data + 8) & 0x3FFF;
+               info.channels = 3;
+               return true;
+          }
+          if (std::memcmp(chunk, "VP8L", 4) == 0)
+          {
+               if (data[0] != 0x2F)
+               {
+                    return false;
+               }
+               const Uint32 bits = le32(data + 1);
+               info.width = (int)(bits & 0x3FFF) + 1;
+               info.height = (int)((bits >> 14) & 0x3FFF) + 1;
+               info.channels = (bits >> 28) & 1 ? 4 : 3;
+               return true;
+          }
+          if (std::memcmp(chunk, "VP8X", 4) != 0)
+          {
+               return false;
+          }
+          info.width = (int)le24(data + 4) + 1;
+          info.height = (int)le24(data + 7) + 1;
+          info.channels = (data[0] & 0x10) ? 4 : 3;
+          if (!(data[0] & 0x02))
+          {
+               return true;
+          }
+
+          // Animated: count the frame chunks, stepping over their payloads
+          info.frames = 0;
+          Uint32 size = le32(chunk + 4);
+          Sint64 next = (Sint64)size + (size & 1) - 10;
+          while (skipBytes(rw, next) && readBytes(rw, chunk, 8))
+          {
+               if (std::memcmp(chunk, "ANMF", 4) == 0)
+               {
+                    info.frames++;
+               }
+               size = le32(chunk + 4);
+               next = (Sint64)size + (size & 1);
+          }
+          info.frames = SDL_max(info.frames, 1);
+          return true;
+     }
+
+     bool probeDds(SDL_RWops *rw, ImageInfo &info)
+     {
+          Uint8 header[124];
+          if (!readBytes(rw, header, sizeof(header)) || le32(header) != 124)
+          {
+               return false;
+          }
+          info.height = (int)le32(header + 8);
+          info.width = (int)le32(header + 12);
+
+          // DDS_PIXELFORMAT starts at 72: size, flags, fourCC, bit count, masks
+          const Uint32 flags = le32(header + 76);
+          const Uint32 bitCount = le32(header + 84);
+          if (flags & 0x4)
+          {
+               // Block-compressed; expanded to RGBA8 on load
+               info.channels = 4;
+               info.bitDepth = 8;
+          }
+          else if (flags & 0x20000)
+          {
+               info.channels = (flags & 0x1) ? 2 : 1; // Luminance (+ alpha)
+               info.bitDepth = (int)bitCount / info.channels;
+          }
+          else
+          {
+               info.channels = (flags & 0x1) ? 4 : 3;
+               info.bitDepth = bitCount >= 24 ? 8 : (int)bitCount / info.channels;
+          }
+          return true;
+     }
+}
+
+bool imageProbe(SDL_RWops *rw, ImageInfo &info)
+{
+     info.format = IMAGE_FORMAT_UNKNOWN;
+     info.width = 0;
+     info.height = 0;
+     info.channels = 0;
+     info.bitDepth = 0;
+     info.frames = 1;
+     if (rw == nullptr)
+     {
+          SDL_InvalidParamError("rw");
+          return false;
+     }
+
+     const Sint64 start = SDL_RWtell(rw);
+     Uint8 magic[12];
+     const size_t magicSize = SDL_RWread(rw, magic, 1, sizeof(magic));
+     bool probed = false;
+     if (magicSize >= 8 && std::memcmp(magic, "\x89PNG\r\n\x1A\n", 8) == 0)
+     {
+          info.format = IMAGE_FORMAT_PNG;
+          SDL_RWseek(rw, start + 8, RW_SEEK_SET);
+          probed = probePng(rw, info);
+     }
+     else if (magicSize >= 3 && magic[0] == 0xFF && magic[1] == 0xD8 && magic[2] == 0xFF)
+     {
+          info.format = IMAGE_FORMAT_JPEG;
+          SDL_RWseek(rw, start + 2, RW_SEEK_SET);
+          probed = probeJpeg(rw, info);
+     }
+     else if (magicSize >= 6 && (std::memcmp(magic, "GIF87a", 6) == 0 || std::memcmp(magic, "GIF89a", 6) == 0))
+     {
+          info.format = IMAGE_FORMAT_GIF;
+          SDL_RWseek(rw, start + 6, RW_SEEK_SET);
+          probed = probeGif(rw, info);
+     }
+     else if (magicSize >= 2 && magic[0] == 'B' && magic[1] == 'M')
+     {
+          info.format = IMAGE_FORMAT_BMP;
+          SDL_RWseek(rw, start + 2, RW_SEEK_SET);
+          probed = probeBmp(rw, info);
+     }
+     else if (magicSize >= 4 && std::memcmp(magic, "qoif", 4) == 0)
+     {
+          info.format = IMAGE_FORMAT_QOI;
+          SDL_RWseek(rw, start + 4, RW_SEEK_SET);
+          probed = probeQoi(rw, info);
+     }
+     else if (magicSize >= 12 && std::memcmp(magic, "RIFF", 4) == 0 && std::memcmp(magic + 8, "WEBP", 4) == 0)
+     {
+          info.format = IMAGE_FORMAT_WEBP;
+          probed = probeWebp(rw, info);
+     }
+     else if (magicSize >= 4 && std::memcmp(magic, "DDS ", 4) == 0)
+     {
+          info.format = IMAGE_FORMAT_DDS;
+          SDL_RWseek(rw, start + 4, RW_SEEK_SET);
+          probed = probeDds(rw, info);
+     }
+     SDL_RWseek(rw, start, RW_SEEK_SET);
+
+     if (info.format == IMAGE_FORMAT_UNKNOWN)
+     {
+          SDL_SetError("Unrecognized image format");
+          return false;
+     }
+     if (!probed || info.width <= 0 || info.height <= 0)
+     {
+          SDL_SetError("Truncated or corrupt %s header", imageFormatName(info.format));
+          return false;
+     }
+     return true;
+}
+
+bool imageProbeFile(const char *path, ImageInfo &info)
+{
+     SDL_RWops *rw = bufferedRWFromFile(path, "rb", BUFFERED_RW_MIN_READAHEAD);
+     if (rw == nullptr)
+     {
+          info.format = IMAGE_FORMAT_UNKNOWN;
+          return false;
+     }
+     bool probed = imageProbe(rw, info);
+     SDL_RWclose(rw);
+     return probed;
+}
+
+const char *imageFormatName(ImageFormat format)
+{
+     switch (format)
+     {
+     case IMAGE_FORMAT_PNG:
+          return "PNG";
+     case IMAGE_FORMAT_JPEG:
+          return "JPEG";
+     case IMAGE_FORMAT_GIF:
+          return "GIF";
+     case IMAGE_FORMAT_BMP:
+          return "BMP";
+     case IMAGE_FORMAT_QOI:
+          return "QOI";
+     case IMAGE_FORMAT_WEBP:
+          return "WebP";
+     case IMAGE_FORMAT_DDS:
+          return "DDS";
+     case IMAGE_FORMAT_UNKNOWN:
+          break;
+     }
+     return "unknown";
+}
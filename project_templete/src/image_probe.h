@@ -0,0 +1,48 @@
+// Description:
+// Header-only image probing: the format, size, channel count, bit depth and
+// frame count of an image file, read from its headers without decoding any
+// pixels. Meant for planning atlas layouts and memory budgets before anything
+// is loaded; typically a few hundred bytes are read (GIF and animated WebP
+// walk their block/chunk lists to count frames, skipping the data itself).
+//
+// Formats: PNG (and APNG), JPEG, GIF, BMP, QOI, WebP (lossy, lossless and
+// extended) and DDS. For DDS the channel count is what ddsLoadSurface()
+// produces rather than what the block encoding stores.
+// =============================================================================
+
+#ifndef IMAGE_PROBE_H
+#define IMAGE_PROBE_H
+
+#include <SDL2/SDL.h>
+
+enum ImageFormat
+{
+     IMAGE_FORMAT_UNKNOWN,
+     IMAGE_FORMAT_PNG,
+     IMAGE_FORMAT_JPEG,
+     IMAGE_FORMAT_GIF,
+     IMAGE_FORMAT_BMP,
+     IMAGE_FORMAT_QOI,
+     IMAGE_FORMAT_WEBP,
+     IMAGE_FORMAT_DDS
+};
+
+struct ImageInfo
+{
+     ImageFormat format;
+     int width;
+     int height;
+     int channels; // 1 gray, 2 gray + alpha, 3 color, 4 color + alpha
+     int bitDepth; // Bits per sample, or per palette index for indexed images
+     int frames;   // 1 unless animated
+};
+
+// Probe the image at the stream's position, which is restored afterwards.
+// False with SDL_GetError() set for unknown or truncated headers
+bool imageProbe(SDL_RWops *rw, ImageInfo &info);
+
+bool imageProbeFile(const char *path, ImageInfo &info);
+
+const char *imageFormatName(ImageFormat format);
+
+#endif // IMAGE_PROBE_H
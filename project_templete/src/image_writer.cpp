@@ -0,0 +1,175 @@
+#include "image_writer.h"
+
+#include <SDL2/SDL_image.h>
+#include <iostream>
+#include <vector>
+
+#include "png_encode.h"
+#include "qoi_encode.h"
+
+namespace
+{
+     bool writeEncoded(const std::string &path, const std::vector<Uint8> &encoded)
+     {
+          SDL_RWops *rw = SDL_RWFromFile(path.c_str(), "wb");
+          if (rw == nullptr)
+          {
+               return false;
+          }
+          bool complete = SDL_RWwrite(rw, encoded.data(), 1, encoded.size()) == encoded.size();
+          return SDL_RWclose(rw) == 0 && complete;
+     }
+
+     bool writeImage(const ImageWriter &writer, const ImageWriteRequest &request)
+     {
+          std::vector<Uint8> encoded;
+          switch (request.type)
+          {
+          case IMAGE_FILE_PNG:
+               return pngEncodeSurface(request.surface, writer.pngLevel, writer.jobs, encoded) && writeEncoded(request.path, encoded);
+          case IMAGE_FILE_QOI:
+               return qoiEncodeSurface(request.surface, encoded) && writeEncoded(request.path, encoded);
+          case IMAGE_FILE_JPEG:
+               return IMG_SaveJPG(request.surface, request.path.c_str(), writer.jpegQuality) == 0;
+          case IMAGE_FILE_BMP:
+               return SDL_SaveBMP(request.surface, request.path.c_str()) == 0;
+          }
+          return false;
+     }
+
+     void releaseSurface(const ImageWriter &writer, SDL_Surface *surface)
+     {
+          if (writer.surfaces != nullptr)
+          {
+               surfacePoolRelease(*writer.surfaces, surface);
+          }
+          else
+          {
+               SDL_FreeSurface(surface);
+          }
+     }
+
+     int SDLCALL writerThreadMain(void *data)
+     {
+          ImageWriter *writer = (ImageWriter *)data;
+
+          SDL_LockMutex(writer->lock);
+          for (;;)
+          {
+               while (writer->queue.empty() && !writer->quitting)
+               {
+                    SDL_CondWait(writer->wake, writer->lock);
+               }
+               if (writer->queue.empty())
+               {
+                    break; // Quitting, and everything queued is written
+               }
+               ImageWriteRequest request = writer->queue.front();
+               writer->queue.pop_front();
+               writer->writing = true;
+
+               SDL_UnlockMutex(writer->lock);
+               bool saved = writeImage(*writer, request);
+               if (!saved)
+               {
+                    std::cerr << "Unable to save " << request.path << "! SDL Error: " << SDL_GetError() << std::endl;
+               }
+               releaseSurface(*writer, request.surface);
+               SDL_LockMutex(writer->lock);
+
+               writer->writing = false;
+               if (saved)
+               {
+                    writer->written++;
+               }
+               else
+               {
+                    writer->failed++;
+               }
+          }
+          SDL_UnlockMutex(writer->lock);
+          return 0;
+     }
+}
+
+bool imageWriterStart(ImageWriter &writer, JobSystem *jobs, SurfacePool *surfaces)
+{
+     writer.jobs = jobs;
+     writer.surfaces = surfaces;
+     writer.pngLevel = PNG_DEFAULT_LEVEL;
+     writer.jpegQuality = 90;
+     writer.maxQueued = 8;
+     writer.writing = false;
+     writer.quitting = false;
+     writer.written = 0;
+     writer.failed = 0;
+     writer.thread = nullptr;
+     writer.lock = SDL_CreateMutex();
+     writer.wake = SDL_CreateCond();
+     if (writer.lock == nullptr || writer.wake == nullptr)
+     {
+          return false;
+     }
+     writer.thread = SDL_CreateThread(writerThreadMain, "ImageWriter", &writer);
+     return writer.thread != nullptr;
+}
+
+bool imageWriterSave(ImageWriter &writer, SDL_Surface *surface, const std::string &path, ImageFileType type)
+{
+     if (surface == nullptr)
+     {
+          return false;
+     }
+     bool queued = false;
+     if (writer.thread != nullptr)
+     {
+          SDL_LockMutex(writer.lock);
+          if ((int)writer.queue.size() < writer.maxQueued)
+          {
+               writer.queue.push_back(ImageWriteRequest{surface, path, type});
+               SDL_CondSignal(writer.wake);
+               queued = true;
+          }
+          SDL_UnlockMutex(writer.lock);
+     }
+     if (!queued)
+     {
+          std::cerr << "Image writer is busy, dropped " << path << std::endl;
+          releaseSurface(writer, surface);
+     }
+     return queued;
+}
+
+int imageWriterPending(ImageWriter &writer)
+{
+     if (writer.lock == nullptr)
+     {
+          return 0;
+     }
+     SDL_LockMutex(writer.lock);
+     int pending = (int)writer.queue.size() + (writer.writing ? 1 : 0);
+     SDL_UnlockMutex(writer.lock);
+     return pending;
+}
+
+void imageWriterStop(ImageWriter &writer)
+{
+     if (writer.thread != nullptr)
+     {
+          SDL_LockMutex(writer.lock);
+          writer.quitting = true;
+          SDL_CondBroadcast(writer.wake);
+          SDL_UnlockMutex(writer.lock);
+          SDL_WaitThread(writer.thread, NULL);
+          writer.thread = nullptr;
+     }
+     for (ImageWriteRequest &request : writer.queue)
+     {
+          releaseSurface(writer, request.surface);
+     }
+     writer.queue.clear();
+     SDL_DestroyCond(writer.wake);
+     SDL_DestroyMutex(writer.lock);
+     writer.wake = nullptr;
+     writer.lock = nullptr;
+}
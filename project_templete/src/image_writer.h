@@ -0,0 +1,72 @@
+// Description:
+// Asynchronous image saving for screenshots and capture tooling. Saving
+// hands a surface to a background thread that encodes and writes it, so
+// the frame that asked only pays for getting the pixels into a surface.
+// PNGs go through png_encode (strips compressed in parallel on the job
+// system when one is given, level set per writer); QOI through qoi_encode
+// when encode speed matters more than size; JPEG uses IMG_SaveJPG and BMP
+// SDL_SaveBMP, all on the writer thread.
+//
+// The queue is bounded: a save that would exceed it is dropped with a
+// message instead of piling up memory behind a slow disk.
+// =============================================================================
+
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <SDL2/SDL.h>
+#include <deque>
+#include <string>
+
+#include "job_system.h"
+#include "surface_pool.h"
+
+enum ImageFileType
+{
+     IMAGE_FILE_PNG,
+     IMAGE_FILE_QOI,
+     IMAGE_FILE_JPEG,
+     IMAGE_FILE_BMP
+};
+
+struct ImageWriteRequest
+{
+     SDL_Surface *surface; // Owned by the request
+     std::string path;
+     ImageFileType type;
+};
+
+struct ImageWriter
+{
+     SDL_Thread *thread;
+     SDL_mutex *lock;
+     SDL_cond *wake;
+     JobSystem *jobs;       // For parallel PNG strips, may be nullptr
+     SurfacePool *surfaces; // Where written surfaces go back, may be nullptr
+
+     int pngLevel;    // 0-9, PNG_DEFAULT_LEVEL by default
+     int jpegQuality; // 0-100
+     int maxQueued;
+
+     // Guarded by lock
+     std::deque<ImageWriteRequest> queue;
+     bool writing;
+     bool quitting;
+     int written;
+     int failed;
+};
+
+// `jobs` and `surfaces` must outlive the writer
+bool imageWriterStart(ImageWriter &writer, JobSystem *jobs, SurfacePool *surfaces = nullptr);
+
+// Queue `surface` to be written to `path`; the writer takes ownership, also
+// when the save is dropped. Returns false if it was dropped.
+bool imageWriterSave(ImageWriter &writer, SDL_Surface *surface, const std::string &path, ImageFileType type);
+
+// Saves queued or in progress
+int imageWriterPending(ImageWriter &writer);
+
+// Finish every queued save, then stop the thread
+void imageWriterStop(ImageWriter &writer);
+
+#endif // IMAGE_WRITER_H
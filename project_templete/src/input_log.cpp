@@ -0,0 +1,209 @@
+#include "input_log.h"
+
+#include <iostream>
+
+namespace
+{
+     // Events that come from the player, as opposed to the window system
+     bool isInputEvent(Uint32 type)
+     {
+          return type == SDL_KEYDOWN || type == SDL_KEYUP || type == SDL_TEXTEDITING || type == SDL_TEXTINPUT ||
+                 (type >= SDL_MOUSEMOTION && type <= SDL_MOUSEWHEEL) ||
+                 (type >= SDL_CONTROLLERAXISMOTION && type <= SDL_CONTROLLERBUTTONUP);
+     }
+
+     // Drop the batch's input events, keeping the rest in order
+     void removeInput(EventBatch &events)
+     {
+          int kept = 0;
+          for (int i = 0; i < events.count; i++)
+          {
+               if (!isInputEvent(events.events[i].type))
+               {
+                    events.events[kept++] = events.events[i];
+               }
+          }
+          events.count = kept;
+     }
+
+     bool readFrame(InputLog &log, EventBatch &events)
+     {
+          const size_t frameHeader = 3 * sizeof(Uint32);
+          if (log.data.size() - log.at < frameHeader)
+          {
+               return false;
+          }
+          Uint32 ticks, count;
+          SDL_memcpy(&ticks, &log.data[log.at], sizeof(ticks));
+          SDL_memcpy(&log.replayAlpha, &log.data[log.at + 4], sizeof(log.replayAlpha));
+          SDL_memcpy(&count, &log.data[log.at + 8], sizeof(count));
+          if ((log.data.size() - log.at - frameHeader) / sizeof(SDL_Event) < count)
+          {
+               std::cerr << "Input recording is truncated after " << log.frames << " frames" << std::endl;
+               return false;
+          }
+          log.at += frameHeader;
+          log.replayTicks = (int)ticks;
+          log.frames++;
+
+          removeInput(events);
+          if ((int)events.events.size() < events.count + (int)count)
+          {
+               events.events.resize(events.count + count);
+          }
+          for (Uint32 i = 0; i < count; i++)
+          {
+               SDL_Event &event = events.events[events.count++];
+               SDL_memcpy(&event, &log.data[log.at], sizeof(event));
+               log.at += sizeof(SDL_Event);
+               if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) &&
+                   event.key.keysym.scancode < SDL_NUM_SCANCODES)
+               {
+                    log.keys[event.key.keysym.scancode] = event.type == SDL_KEYDOWN;
+               }
+          }
+          return true;
+     }
+}
+
+void inputLogInit(InputLog &log, Uint32 seed)
+{
+     log.mode = INPUT_LOG_LIVE;
+     log.seed = seed;
+     log.frames = 0;
+     log.frameLogged = false;
+     log.out = nullptr;
+     log.recorded.clear();
+     log.data.clear();
+     log.at = 0;
+     log.replayTicks = 0;
+     log.replayAlpha = 0.0f;
+     SDL_zero(log.keys);
+}
+
+bool inputLogRecord(InputLog &log, const char *path, Uint32 seed)
+{
+     inputLogInit(log, seed);
+     log.out = SDL_RWFromFile(path, "wb");
+     if (log.out == nullptr)
+     {
+          std::cerr << "Unable to record input to " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     InputLogHeader header = {INPUT_LOG_MAGIC, INPUT_LOG_VERSION, seed, (Uint32)sizeof(SDL_Event)};
+     if (SDL_RWwrite(log.out, &header, sizeof(header), 1) != 1)
+     {
+          std::cerr << "Unable to record input to " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+          SDL_RWclose(log.out);
+          log.out = nullptr;
+          return false;
+     }
+     log.mode = INPUT_LOG_RECORDING;
+     return true;
+}
+
+bool inputLogReplay(InputLog &log, const char *path)
+{
+     inputLogInit(log, 0);
+     size_t size = 0;
+     void *file = SDL_LoadFile(path, &size);
+     if (file == nullptr)
+     {
+          std::cerr << "Unable to load input recording " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     log.data.assign((const Uint8 *)file, (const Uint8 *)file + size);
+     SDL_free(file);
+
+     InputLogHeader header;
+     if (size < sizeof(header))
+     {
+          std::cerr << path << " is not an input recording" << std::endl;
+          return false;
+     }
+     SDL_memcpy(&header, log.data.data(), sizeof(header));
+     if (header.magic != INPUT_LOG_MAGIC || header.version != INPUT_LOG_VERSION ||
+         header.eventSize != sizeof(SDL_Event))
+     {
+          std::cerr << path << " is not a version " << INPUT_LOG_VERSION << " input recording of this build"
+                    << std::endl;
+          return false;
+     }
+     log.seed = header.seed;
+     log.at = sizeof(header);
+     log.mode = INPUT_LOG_REPLAYING;
+     return true;
+}
+
+bool inputLogEvents(InputLog &log, EventBatch &events, bool logged)
+{
+     log.frameLogged = logged;
+     if (log.mode == INPUT_LOG_RECORDING && logged)
+     {
+          log.recorded.clear();
+          for (int i = 0; i < events.count; i++)
+          {
+               if (isInputEvent(events.events[i].type))
+               {
+                    log.recorded.push_back(events.events[i]);
+               }
+          }
+     }
+     else if (log.mode == INPUT_LOG_REPLAYING)
+     {
+          if (!logged)
+          {
+               removeInput(events);
+          }
+          else if (!readFrame(log, events))
+          {
+               removeInput(events);
+               log.replayTicks = 0;
+               log.replayAlpha = 0.0f;
+               return false;
+          }
+     }
+     return true;
+}
+
+void inputLogTicks(InputLog &log, int &ticks, float &alpha)
+{
+     if (!log.frameLogged)
+     {
+          return;
+     }
+     if (log.mode == INPUT_LOG_RECORDING)
+     {
+          Uint32 header[3] = {(Uint32)ticks, 0, (Uint32)log.recorded.size()};
+          SDL_memcpy(&header[1], &alpha, sizeof(alpha));
+          if (SDL_RWwrite(log.out, header, sizeof(header), 1) != 1 ||
+              (!log.recorded.empty() &&
+               SDL_RWwrite(log.out, log.recorded.data(), sizeof(SDL_Event), log.recorded.size()) != log.recorded.size()))
+          {
+               std::cerr << "Input recording stopped! SDL Error: " << SDL_GetError() << std::endl;
+               inputLogClose(log);
+               return;
+          }
+          log.frames++;
+     }
+     else if (log.mode == INPUT_LOG_REPLAYING)
+     {
+          ticks = log.replayTicks;
+          alpha = log.replayAlpha;
+     }
+}
+
+const Uint8 *inputLogKeyboardState(const InputLog &log)
+{
+     return log.mode == INPUT_LOG_REPLAYING ? log.keys : SDL_GetKeyboardState(NULL);
+}
+
+void inputLogClose(InputLog &log)
+{
+     if (log.out != nullptr)
+     {
+          SDL_RWclose(log.out);
+          log.out = nullptr;
+     }
+     log.mode = INPUT_LOG_LIVE;
+}
@@ -0,0 +1,94 @@
+// Description:
+// Input recording and deterministic replay for repeatable benchmark runs.
+// A recording holds the RNG seed and, per frame, the input events the game
+// saw (keys, text, mouse, controller sticks and buttons), how many
+// simulation ticks ran and the render interpolation fraction. Replaying it
+// feeds the same events and tick counts back, so the simulation, and with
+// it the work every frame does, is the same run after run regardless of
+// how fast the machine is.
+//
+// Frames are logged only once the game has left the loading screen: asset
+// loading finishes at a machine-dependent frame, and nothing before it
+// reads input or the RNG. Keys still held from before that point are not
+// part of the recording.
+//
+// While replaying, live input events are dropped (window and render events
+// still get through), and inputLogKeyboardState() returns the key state
+// rebuilt from the recorded key events instead of SDL_GetKeyboardState().
+//
+// Stream layout (native, same build only): an InputLogHeader, then per
+// frame Uint32 ticks, float alpha, Uint32 event count and the SDL_Events.
+// =============================================================================
+
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "event_batch.h"
+
+// Set to a file path (SDL_SetHint or the environment) to record the session
+#define INPUT_RECORD_HINT "CATCH_RECORD_INPUT"
+
+const Uint32 INPUT_LOG_MAGIC = 0x504E4943; // "CINP"
+const Uint32 INPUT_LOG_VERSION = 1;
+
+struct InputLogHeader
+{
+     Uint32 magic;
+     Uint32 version;
+     Uint32 seed;
+     Uint32 eventSize; // sizeof(SDL_Event) of the recording build
+};
+
+enum InputLogMode
+{
+     INPUT_LOG_LIVE,
+     INPUT_LOG_RECORDING,
+     INPUT_LOG_REPLAYING
+};
+
+struct InputLog
+{
+     InputLogMode mode;
+     Uint32 seed;
+     int frames;       // Frames recorded or replayed so far
+     bool frameLogged; // The current frame is recorded or replayed
+
+     SDL_RWops *out;                  // While recording
+     std::vector<SDL_Event> recorded; // Input events of the frame being recorded
+
+     std::vector<Uint8> data; // While replaying: the whole recording
+     size_t at;               // Next frame in data
+     int replayTicks;
+     float replayAlpha;
+     Uint8 keys[SDL_NUM_SCANCODES]; // Key state rebuilt from the replayed events
+};
+
+// Live input with the given seed; nothing is recorded
+void inputLogInit(InputLog &log, Uint32 seed);
+
+// Record every logged frame to `path`, starting with `seed`
+bool inputLogRecord(InputLog &log, const char *path, Uint32 seed);
+
+// Load a recording; log.seed is the seed it was made with
+bool inputLogReplay(InputLog &log, const char *path);
+
+// Call after draining events, with `logged` false while loading. Recording
+// keeps the batch's input events for this frame; replaying swaps them for
+// the next recorded frame's (or just drops them when not logged). Returns
+// false once a replay has run out of frames; that frame runs no ticks.
+bool inputLogEvents(InputLog &log, EventBatch &events, bool logged);
+
+// Call once the frame's tick count and interpolation fraction are known.
+// Recording writes the frame; replaying overrides both with the recording.
+void inputLogTicks(InputLog &log, int &ticks, float &alpha);
+
+// SDL_GetKeyboardState(), or the replayed key state
+const Uint8 *inputLogKeyboardState(const InputLog &log);
+
+// Finish writing a recording
+void inputLogClose(InputLog &log);
+
+#endif // INPUT_LOG_H
@@ -0,0 +1,102 @@
+#include "input_thread.h"
+
+#include <iostream>
+
+#include "event_watch.h"
+#include "precise_sleep.h"
+#include "thread_affinity.h"
+
+namespace
+{
+     // Keyboard through touch and gestures, plus standalone sensors
+     const EventTypeRange WATCHED_INPUT[] = {{SDL_KEYDOWN, SDL_CLIPBOARDUPDATE - 1}, {SDL_SENSORUPDATE, SDL_SENSORUPDATE}};
+
+     int SDLCALL inputWatch(void *userdata, SDL_Event *event)
+     {
+          InputThread &input = *(InputThread *)userdata;
+          eventQueuePost(input.queue, *event);
+          return 1;
+     }
+
+     int SDLCALL inputThreadMain(void *data)
+     {
+          InputThread &input = *(InputThread *)data;
+          const Uint64 interval = SDL_GetPerformanceFrequency() / (Uint64)input.pollHz;
+          Uint64 deadline = SDL_GetPerformanceCounter();
+          while (!SDL_AtomicGet(&input.quitting))
+          {
+               // Pushes its events from this thread, through the watch
+               SDL_LockJoysticks();
+               SDL_JoystickUpdate();
+               SDL_UnlockJoysticks();
+               SDL_AtomicIncRef(&input.polls);
+
+               deadline += interval;
+               const Uint64 now = SDL_GetPerformanceCounter();
+               if (deadline < now)
+               {
+                    deadline = now; // Fell behind; do not burst
+               }
+               preciseSleepUntil(deadline);
+          }
+          return 0;
+     }
+}
+
+bool inputThreadStart(InputThread &input, int pollHz, int capacity)
+{
+     eventQueueInit(input.queue, capacity);
+     input.thread = nullptr;
+     SDL_AtomicSet(&input.quitting, 0);
+     SDL_AtomicSet(&input.polls, 0);
+     input.pollHz = SDL_max(1, pollHz);
+     input.watching = eventWatchAdd(inputWatch, &input, "input thread", WATCHED_INPUT, SDL_arraysize(WATCHED_INPUT));
+     if (!input.watching)
+     {
+          std::cerr << "Unable to watch input events! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+
+     // Short bursts of work, so it can preempt rendering cheaply: MMCSS
+     // "Games" on Windows, a high priority elsewhere
+     ThreadOptions options = threadDefaultOptions();
+     options.task = THREAD_TASK_GAMES;
+     input.thread = threadCreate(inputThreadMain, "InputPoll", &input, options);
+     if (input.thread == nullptr)
+     {
+          std::cerr << "Unable to start the input thread! SDL Error: " << SDL_GetError() << std::endl;
+          inputThreadStop(input);
+          return false;
+     }
+     return true;
+}
+
+int inputThreadDrain(InputThread &input, TimedInputEvent *events, int count)
+{
+     int stored = 0;
+     while (stored < count && eventQueuePoll(input.queue, &events[stored].event, &events[stored].counter))
+     {
+          stored++;
+     }
+     return stored;
+}
+
+int inputThreadDropped(InputThread &input)
+{
+     return SDL_AtomicGet(&input.queue.dropped);
+}
+
+void inputThreadStop(InputThread &input)
+{
+     if (input.thread != nullptr)
+     {
+          SDL_AtomicSet(&input.quitting, 1);
+          SDL_WaitThread(input.thread, nullptr);
+          input.thread = nullptr;
+     }
+     if (input.watching)
+     {
+          eventWatchDel(inputWatch, &input);
+          input.watching = false;
+     }
+}
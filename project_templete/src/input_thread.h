@@ -0,0 +1,62 @@
+// Description:
+// Input sampled off the main loop's schedule. Events normally reach the
+// game only when the loop pumps, so a 20 ms render leaves them 20 ms stale
+// and their millisecond timestamps say little about when they happened.
+// An InputThread adds two things:
+//
+// - A thread that updates joysticks and game controllers (and their
+//   sensors) at `pollHz`, 1 kHz by default, under SDL_LockJoysticks.
+//   These are polled devices (XInput, HIDAPI, evdev), so their state
+//   no longer waits for the main loop's SDL_PumpEvents.
+// - An event watch that copies every input event, from whichever thread
+//   pushed it, into a lock-free EventQueue stamped with
+//   SDL_GetPerformanceCounter(). Gameplay drains it right before
+//   simulating and sees exactly when each input arrived.
+//
+// Keyboard, mouse and touch arrive as window messages, which SDL can only
+// pump on the thread that created the window, so for those the copy is
+// stamped when the main thread pumps. Calling SDL_PumpEvents() just before
+// simulation, after rendering, gets them as fresh as SDL allows.
+// The events still reach SDL's queue as usual; the copy is a second,
+// timestamped view of them.
+// =============================================================================
+
+#ifndef INPUT_THREAD_H
+#define INPUT_THREAD_H
+
+#include <SDL2/SDL.h>
+
+#include "event_queue.h"
+
+// Set to "1" (SDL_SetHint or the environment) to start the input thread
+#define INPUT_THREAD_HINT "CATCH_INPUT_THREAD"
+
+struct TimedInputEvent
+{
+     Uint64 counter; // SDL_GetPerformanceCounter() when SDL queued it
+     SDL_Event event;
+};
+
+struct InputThread
+{
+     EventQueue queue;
+     SDL_Thread *thread;
+     SDL_atomic_t quitting;
+     int pollHz;
+     SDL_atomic_t polls; // Device updates by the thread so far
+     bool watching;
+};
+
+// Install the event watch and start the polling thread. On failure
+// nothing is left installed, and inputThreadStop() is still safe
+bool inputThreadStart(InputThread &input, int pollHz = 1000, int capacity = 4096);
+
+// Move up to `count` queued input events, oldest first, into `events`
+int inputThreadDrain(InputThread &input, TimedInputEvent *events, int count);
+
+// Input queued and then dropped because nobody drained it
+int inputThreadDropped(InputThread &input);
+
+void inputThreadStop(InputThread &input);
+
+#endif // INPUT_THREAD_H
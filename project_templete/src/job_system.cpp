@@ -0,0 +1,420 @@
+#include "job_system.h"
+
+#include "cpu_topology.h"
+
+namespace
+{
+     const int DEQUE_MASK = JOB_DEQUE_CAPACITY - 1;
+
+     // Waiting runs other jobs, which may wait in turn. Past this depth a
+     // waiter only runs its own children, so the stack stays bounded (SDL
+     // threads get 1 MB on Windows).
+     const int MAX_HELP_DEPTH = 8;
+
+     thread_local JobWorker *currentWorker = nullptr;
+     thread_local int helpDepth = 0;
+
+     // Deque positions only ever grow and are compared by difference, so
+     // they are free to wrap around
+     int advance(int position, int by)
+     {
+          return (int)((Uint32)position + (Uint32)by);
+     }
+
+     int distance(int from, int to)
+     {
+          return (int)((Uint32)to - (Uint32)from);
+     }
+
+     // Owner only
+     bool dequePush(JobDeque &deque, const Job &job)
+     {
+          int bottom = SDL_AtomicGet(&deque.bottom);
+          int top = SDL_AtomicGet(&deque.top);
+          if (distance(top, bottom) >= JOB_DEQUE_CAPACITY)
+          {
+               return false;
+          }
+          deque.slots[bottom & DEQUE_MASK] = job;
+          SDL_MemoryBarrierRelease();
+          SDL_AtomicSet(&deque.bottom, advance(bottom, 1));
+          return true;
+     }
+
+     // Owner only. The decrement is a full barrier, so a thief that read the
+     // old bottom has either already claimed the last job or will see it gone.
+     bool dequePop(JobDeque &deque, Job &job)
+     {
+          int bottom = advance(SDL_AtomicAdd(&deque.bottom, -1), -1);
+          int top = SDL_AtomicGet(&deque.top);
+          int size = distance(top, bottom);
+          if (size < 0)
+          {
+               SDL_AtomicSet(&deque.bottom, top);
+               return false;
+          }
+          job = deque.slots[bottom & DEQUE_MASK];
+          if (size > 0)
+          {
+               return true;
+          }
+
+          // Last job: race the thieves for it
+          bool won = SDL_AtomicCAS(&deque.top, top, advance(top, 1));
+          SDL_AtomicSet(&deque.bottom, advance(top, 1));
+          return won;
+     }
+
+     // Any thread. The slot is copied before the CAS; if the owner has wrapped
+     // around and refilled it meanwhile, top has moved and the copy is dropped.
+     bool dequeSteal(JobDeque &deque, Job &job)
+     {
+          int top = SDL_AtomicGet(&deque.top);
+          SDL_MemoryBarrierAcquire();
+          int bottom = SDL_AtomicGet(&deque.bottom);
+          if (distance(top, bottom) <= 0)
+          {
+               return false;
+          }
+          job = deque.slots[top & DEQUE_MASK];
+          return SDL_AtomicCAS(&deque.top, top, advance(top, 1));
+     }
+
+     void runJob(const Job &job)
+     {
+          job.function(job.data, job.index);
+          if (job.counter != nullptr)
+          {
+               // Full barrier: the job's writes are visible once the counter drops
+               SDL_AtomicAdd(&job.counter->pending, -1);
+          }
+     }
+
+     bool popQueue(JobSystem &system, std::deque<Job> &queue, Job &job)
+     {
+          SDL_LockMutex(system.lock);
+          bool found = !queue.empty();
+          if (found)
+          {
+               job = queue.front();
+               queue.pop_front();
+          }
+          SDL_UnlockMutex(system.lock);
+          return found;
+     }
+
+     bool popInjected(JobSystem &system, Job &job)
+     {
+          if (SDL_AtomicGet(&system.injectedCount) == 0 || !popQueue(system, system.injected, job))
+          {
+               return false;
+          }
+          SDL_AtomicAdd(&system.injectedCount, -1);
+          return true;
+     }
+
+     // Own deque first, then work from outside the pool, then a steal sweep
+     // starting at a random victim
+     bool findJob(JobSystem &system, JobWorker &self, Job &job)
+     {
+          if (dequePop(self.deque, job) || popInjected(system, job))
+          {
+               return true;
+          }
+          const int count = (int)system.workers.size();
+          self.random ^= self.random << 13;
+          self.random ^= self.random >> 17;
+          self.random ^= self.random << 5;
+          const int start = (int)(self.random % (Uint32)count);
+          for (int i = 0; i < count; i++)
+          {
+               JobWorker &victim = *system.workers[(start + i) % count];
+               if (&victim != &self && dequeSteal(victim.deque, job))
+               {
+                    return true;
+               }
+          }
+          return false;
+     }
+
+     // sleepers is read with a full barrier after the job was published, and
+     // a worker re-checks for work after announcing that it sleeps, so a
+     // wakeup is never lost; an extra post only costs a spurious wakeup
+     void wakeOne(JobSystem &system)
+     {
+          if (SDL_AtomicAdd(&system.sleepers, 0) > 0)
+          {
+               SDL_SemPost(system.wake);
+          }
+     }
+
+     int SDLCALL jobWorkerMain(void *data)
+     {
+          JobWorker &self = *(JobWorker *)data;
+          JobSystem &system = *self.system;
+          currentWorker = &self;
+
+          Job job;
+          while (!SDL_AtomicGet(&system.quitting))
+          {
+               if (self.index >= SDL_AtomicGet(&system.activeWorkers))
+               {
+                    if (dequePop(self.deque, job))
+                    {
+                         runJob(job);
+                         continue;
+                    }
+                    // The wake that got this worker here may have been meant
+                    // for work, so pass it on
+                    wakeOne(system);
+                    SDL_AtomicIncRef(&system.parkedCount);
+                    if (self.index >= SDL_AtomicGet(&system.activeWorkers) && !SDL_AtomicGet(&system.quitting))
+                    {
+                         SDL_SemWait(system.parked);
+                    }
+                    SDL_AtomicAdd(&system.parkedCount, -1);
+                    continue;
+               }
+               if (findJob(system, self, job))
+               {
+                    runJob(job);
+                    continue;
+               }
+               SDL_AtomicIncRef(&system.sleepers);
+               if (findJob(system, self, job))
+               {
+                    SDL_AtomicAdd(&system.sleepers, -1);
+                    runJob(job);
+                    continue;
+               }
+               SDL_SemWait(system.wake);
+               SDL_AtomicAdd(&system.sleepers, -1);
+          }
+          currentWorker = nullptr;
+          return 0;
+     }
+
+     void enqueue(JobSystem &system, const Job &job, JobAffinity affinity)
+     {
+          if (job.counter != nullptr)
+          {
+               SDL_AtomicIncRef(&job.counter->pending);
+          }
+
+          if (affinity == JOB_MAIN_THREAD)
+          {
+               SDL_LockMutex(system.lock);
+               system.mainJobs.push_back(job);
+               SDL_UnlockMutex(system.lock);
+               return;
+          }
+
+          JobWorker *self = currentWorker;
+          if (self != nullptr && self->system == &system)
+          {
+               if (!dequePush(self->deque, job))
+               {
+                    runJob(job);
+                    return;
+               }
+          }
+          else
+          {
+               SDL_LockMutex(system.lock);
+               system.injected.push_back(job);
+               SDL_UnlockMutex(system.lock);
+               SDL_AtomicIncRef(&system.injectedCount);
+          }
+          wakeOne(system);
+     }
+
+     JobWorker *createWorker(JobSystem &system, int index)
+     {
+          JobWorker *worker = new JobWorker;
+          SDL_AtomicSet(&worker->deque.top, 0);
+          SDL_AtomicSet(&worker->deque.bottom, 0);
+          worker->system = &system;
+          worker->thread = nullptr;
+          worker->index = index;
+          worker->random = 2654435761u * (Uint32)(index + 1);
+          return worker;
+     }
+}
+
+bool jobSystemInit(JobSystem &system, int threadCount)
+{
+     system.mainThread = SDL_ThreadID();
+     system.lock = SDL_CreateMutex();
+     system.wake = SDL_CreateSemaphore(0);
+     system.parked = SDL_CreateSemaphore(0);
+     SDL_AtomicSet(&system.injectedCount, 0);
+     SDL_AtomicSet(&system.parkedCount, 0);
+     SDL_AtomicSet(&system.activeWorkers, 0x7FFFFFFF);
+     SDL_AtomicSet(&system.sleepers, 0);
+     SDL_AtomicSet(&system.quitting, 0);
+     system.threadCount = 0;
+     if (system.lock == nullptr || system.wake == nullptr || system.parked == nullptr)
+     {
+          return false;
+     }
+
+     if (threadCount <= 0)
+     {
+          // One per physical core, the main thread being worker 0; SMT
+          // siblings share a core's caches and add little to cache-bound jobs
+          threadCount = cpuTopologyWorkerCount(cpuTopology());
+     }
+     // Every worker exists before any thread starts stealing from the list
+     for (int i = 0; i <= threadCount; i++)
+     {
+          system.workers.push_back(createWorker(system, i));
+     }
+     currentWorker = system.workers[0];
+     system.threadCount = 1;
+     for (int i = 1; i <= threadCount; i++)
+     {
+          // A worker whose thread failed to start keeps an empty deque
+          JobWorker *worker = system.workers[i];
+          worker->thread = SDL_CreateThread(jobWorkerMain, "JobWorker", worker);
+          if (worker->thread != nullptr)
+          {
+               system.threadCount++;
+          }
+     }
+     return system.threadCount > 1;
+}
+
+int jobSystemThreadCount(const JobSystem &system)
+{
+     return system.threadCount;
+}
+
+void jobSystemSetActiveThreads(JobSystem &system, int count)
+{
+     // Workers are indexed from the main thread's 0, so the first `count` run
+     SDL_AtomicSet(&system.activeWorkers, count > 0 ? count : 0x7FFFFFFF);
+     // Every parked worker re-checks; the ones still above the count park again
+     for (int waiting = SDL_AtomicGet(&system.parkedCount); waiting > 0; waiting--)
+     {
+          SDL_SemPost(system.parked);
+     }
+}
+
+int jobSystemCurrentWorker(const JobSystem &system)
+{
+     return currentWorker != nullptr && currentWorker->system == &system ? currentWorker->index : -1;
+}
+
+void jobSystemSubmit(JobSystem &system, JobFunction function, void *data, JobCounter *counter, JobAffinity affinity)
+{
+     Job job = {function, data, 0, counter};
+     enqueue(system, job, affinity);
+}
+
+void jobSystemSubmitRange(JobSystem &system, JobFunction function, void *data, int count, JobCounter *counter)
+{
+     for (int i = 0; i < count; i++)
+     {
+          Job job = {function, data, i, counter};
+          enqueue(system, job, JOB_ANY_THREAD);
+     }
+}
+
+void jobSystemWait(JobSystem &system, JobCounter &counter)
+{
+     const bool onMainThread = SDL_ThreadID() == system.mainThread;
+     JobWorker *self = currentWorker != nullptr && currentWorker->system == &system ? currentWorker : nullptr;
+
+     helpDepth++;
+     Job job;
+     while (!jobCounterDone(counter))
+     {
+          bool found;
+          if (helpDepth > MAX_HELP_DEPTH)
+          {
+               // Children are pushed after this job started, so they sit at
+               // the bottom of the deque; put anything else back
+               found = self != nullptr && dequePop(self->deque, job);
+               if (found && job.counter != &counter)
+               {
+                    dequePush(self->deque, job);
+                    found = false;
+               }
+          }
+          else
+          {
+               found = (onMainThread && popQueue(system, system.mainJobs, job)) ||
+                       (self != nullptr ? findJob(system, *self, job) : popInjected(system, job));
+          }
+
+          if (found)
+          {
+               runJob(job);
+          }
+          else
+          {
+               // The remaining jobs are running elsewhere
+               SDL_Delay(0);
+          }
+     }
+     helpDepth--;
+}
+
+bool jobCounterDone(const JobCounter &counter)
+{
+     return SDL_AtomicGet(const_cast<SDL_atomic_t *>(&counter.pending)) == 0;
+}
+
+int jobSystemRunMainThreadJobs(JobSystem &system)
+{
+     // Only what is queued now, so a job that queues another can't spin here
+     SDL_LockMutex(system.lock);
+     std::deque<Job> jobs;
+     jobs.swap(system.mainJobs);
+     SDL_UnlockMutex(system.lock);
+
+     for (const Job &job : jobs)
+     {
+          runJob(job);
+     }
+     return (int)jobs.size();
+}
+
+void jobSystemDestroy(JobSystem &system)
+{
+     SDL_AtomicSet(&system.quitting, 1);
+     for (JobWorker *worker : system.workers)
+     {
+          if (worker->thread != nullptr)
+          {
+               SDL_SemPost(system.wake);
+               SDL_SemPost(system.parked);
+          }
+     }
+     // Join every thread before freeing any deque it may still be stealing from
+     for (JobWorker *worker : system.workers)
+     {
+          if (worker->thread != nullptr)
+          {
+               SDL_WaitThread(worker->thread, NULL);
+          }
+     }
+     for (JobWorker *worker : system.workers)
+     {
+          if (currentWorker == worker)
+          {
+               currentWorker = nullptr;
+          }
+          delete worker;
+     }
+     system.workers.clear();
+     system.injected.clear();
+     system.mainJobs.clear();
+
+     SDL_DestroySemaphore(system.wake);
+     SDL_DestroySemaphore(system.parked);
+     SDL_DestroyMutex(system.lock);
+     system.wake = nullptr;
+     system.parked = nullptr;
+     system.lock = nullptr;
+}
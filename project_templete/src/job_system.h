@@ -0,0 +1,133 @@
+// Description:
+// Work-stealing job scheduler built on SDL_thread.h and SDL_atomic.h. Each
+// worker owns a fixed-size Chase-Lev deque: it pushes and pops jobs at the
+// bottom without locking while idle workers steal from the top with one
+// SDL_AtomicCAS. The thread that calls jobSystemInit() is worker 0, so
+// jobs it submits land in its own deque and it helps run them while it
+// waits. Jobs submitted from threads outside the pool go through a locked
+// injection queue.
+//
+// Dependencies are expressed with counters: every job can carry a
+// JobCounter that is raised on submit and lowered when the job finishes,
+// and jobSystemWait() runs other jobs until the counter reaches zero, so
+// a job can wait on the jobs it spawned without blocking a worker.
+// Render-only jobs submitted with JOB_MAIN_THREAD run on the main thread,
+// from jobSystemRunMainThreadJobs() or while it waits.
+//
+// jobSystemSetActiveThreads() parks the workers above a count, for power
+// saving: a parked worker finishes the jobs in its own deque, then sleeps
+// on its own semaphore, so it neither takes new work nor is woken for it.
+//
+// One JobSystem per program: the calling thread's worker is tracked in a
+// thread_local.
+// =============================================================================
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <SDL2/SDL.h>
+#include <deque>
+#include <vector>
+
+// `index` is the position within jobSystemSubmitRange(), 0 otherwise
+typedef void (*JobFunction)(void *data, int index);
+
+enum JobAffinity
+{
+     JOB_ANY_THREAD,
+     JOB_MAIN_THREAD // Renderer calls and anything else bound to the main thread
+};
+
+// Zero-initialize before first use: JobCounter counter = {};
+struct JobCounter
+{
+     SDL_atomic_t pending;
+};
+
+struct Job
+{
+     JobFunction function;
+     void *data;
+     int index;
+     JobCounter *counter;
+};
+
+// Must be a power of two; a push to a full deque runs the job inline
+const int JOB_DEQUE_CAPACITY = 4096;
+
+struct JobDeque
+{
+     SDL_atomic_t top; // Next slot thieves take
+     char topPadding[64 - sizeof(SDL_atomic_t)];
+     SDL_atomic_t bottom; // Next slot the owner fills
+     char bottomPadding[64 - sizeof(SDL_atomic_t)];
+     Job slots[JOB_DEQUE_CAPACITY];
+};
+
+struct JobSystem;
+
+struct JobWorker
+{
+     JobDeque deque;
+     JobSystem *system;
+     SDL_Thread *thread; // nullptr for worker 0, the main thread
+     int index;
+     Uint32 random; // Victim selection state
+};
+
+struct JobSystem
+{
+     std::vector<JobWorker *> workers;
+     int threadCount; // Workers with a running thread, plus the main thread
+     SDL_threadID mainThread;
+
+     SDL_mutex *lock;
+     std::deque<Job> injected; // Guarded by lock; from threads outside the pool
+     std::deque<Job> mainJobs; // Guarded by lock; JOB_MAIN_THREAD jobs
+     SDL_atomic_t injectedCount;
+
+     SDL_sem *wake; // Posted when work arrives and someone sleeps
+     SDL_atomic_t sleepers;
+     SDL_atomic_t quitting;
+
+     SDL_sem *parked;           // Posted when parked workers may run again
+     SDL_atomic_t parkedCount;  // Workers waiting on parked
+     SDL_atomic_t activeWorkers; // Workers below this index run jobs; worker 0 always does
+};
+
+// Start `threadCount` worker threads next to the calling thread;
+// 0 sizes the pool to one thread per physical core
+bool jobSystemInit(JobSystem &system, int threadCount);
+
+// Total threads running jobs, including the main thread
+int jobSystemThreadCount(const JobSystem &system);
+
+// Run jobs on at most `count` threads including the main thread; 0 for
+// all of them. Takes effect as workers finish their current job.
+void jobSystemSetActiveThreads(JobSystem &system, int count);
+
+// Index of the calling thread's worker in system.workers, -1 for threads
+// outside the pool; lets jobs pick per-worker state without locking
+int jobSystemCurrentWorker(const JobSystem &system);
+
+// Queue function(data, 0); `counter` may be nullptr
+void jobSystemSubmit(JobSystem &system, JobFunction function, void *data, JobCounter *counter,
+                     JobAffinity affinity = JOB_ANY_THREAD);
+
+// Queue function(data, i) for every i in [0, count)
+void jobSystemSubmitRange(JobSystem &system, JobFunction function, void *data, int count, JobCounter *counter);
+
+// Run queued jobs until every job tracked by `counter` has finished
+void jobSystemWait(JobSystem &system, JobCounter &counter);
+
+bool jobCounterDone(const JobCounter &counter);
+
+// Run the JOB_MAIN_THREAD jobs queued so far; call once per frame from the
+// main thread. Returns how many ran.
+int jobSystemRunMainThreadJobs(JobSystem &system);
+
+// Stops the workers; jobs still queued are dropped, so wait on their
+// counters first
+void jobSystemDestroy(JobSystem &system);
+
+#endif // JOB_SYSTEM_H
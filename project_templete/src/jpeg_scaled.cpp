@@ -0,0 +1,208 @@
+#include "jpeg_scaled.h"
+
+#include <SDL2/SDL_image.h>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace
+{
+     // The parts of turbojpeg.h this uses; the ABI has been stable since
+     // libjpeg-turbo 1.4, apart from tjGetErrorStr2, which is 2.0+
+     typedef void *tjhandle;
+
+     struct tjscalingfactor
+     {
+          int num, denom;
+     };
+
+     const int TJPF_RGB = 0;
+     const Sint64 MAX_JPEG_BYTES = 256 * 1024 * 1024;
+
+     tjhandle (*tjInitDecompress)(void);
+     int (*tjDecompressHeader3)(tjhandle handle, const unsigned char *jpegBuf, unsigned long jpegSize, int *width,
+                                int *height, int *jpegSubsamp, int *jpegColorspace);
+     int (*tjDecompress2)(tjhandle handle, const unsigned char *jpegBuf, unsigned long jpegSize,
+                          unsigned char *dstBuf, int width, int pitch, int height, int pixelFormat, int flags);
+     int (*tjDestroy)(tjhandle handle);
+     char *(*tjGetErrorStr2)(tjhandle handle);
+     char *(*tjGetErrorStr)(void);
+     tjscalingfactor *(*tjGetScalingFactors)(int *numScalingFactors);
+
+     // turbojpeg.dll is what libjpeg-turbo's Visual C++ packages install,
+     // libturbojpeg.dll what its MinGW ones do
+     const char *const TURBO_FILES[] = {"turbojpeg.dll", "libturbojpeg.dll", "libturbojpeg.so.0",
+                                        "libturbojpeg.0.dylib", "libturbojpeg.dylib", nullptr};
+     const SymbolBinding TURBO_BINDINGS[] = {
+         {"tjInitDecompress", (void **)&tjInitDecompress, false},
+         {"tjDecompressHeader3", (void **)&tjDecompressHeader3, false},
+         {"tjDecompress2", (void **)&tjDecompress2, false},
+         {"tjDestroy", (void **)&tjDestroy, false},
+         {"tjGetErrorStr2", (void **)&tjGetErrorStr2, true},
+         {"tjGetErrorStr", (void **)&tjGetErrorStr, true},
+         {"tjGetScalingFactors", (void **)&tjGetScalingFactors, false},
+     };
+
+     SymbolLibrary turboLibrary;
+     SDL_SpinLock turboLock = 0;
+
+     // The handle's own message where the library has one (2.0+), else
+     // the last error of any handle
+     const char *turboError(tjhandle handle)
+     {
+          const char *error = tjGetErrorStr2 != nullptr ? tjGetErrorStr2(handle)
+                              : tjGetErrorStr != nullptr ? tjGetErrorStr()
+                                                         : nullptr;
+          return error != nullptr ? error : "unknown turbojpeg error";
+     }
+
+     int scaled(int size, const tjscalingfactor &factor)
+     {
+          return (int)(((Sint64)size * factor.num + factor.denom - 1) / factor.denom);
+     }
+
+     // The smallest factor that keeps both sides at their targets; 1/1
+     // when none does (or the table is empty)
+     tjscalingfactor pickScale(int width, int height, int targetWidth, int targetHeight)
+     {
+          tjscalingfactor best = {1, 1};
+          int count = 0;
+          const tjscalingfactor *factors = tjGetScalingFactors(&count);
+          for (int i = 0; factors != nullptr && i < count; i++)
+          {
+               const tjscalingfactor &factor = factors[i];
+               if (factor.num <= 0 || factor.denom <= 0 || factor.num > factor.denom)
+               {
+                    continue; // Upscaling never helps a thumbnail
+               }
+               if ((targetWidth > 0 && scaled(width, factor) < SDL_min(targetWidth, width)) ||
+                   (targetHeight > 0 && scaled(height, factor) < SDL_min(targetHeight, height)))
+               {
+                    continue;
+               }
+               if ((Sint64)factor.num * best.denom < (Sint64)best.num * factor.denom)
+               {
+                    best = factor;
+               }
+          }
+          return best;
+     }
+
+     SDL_Surface *decodeTurbo(const Uint8 *data, size_t size, int targetWidth, int targetHeight,
+                              JpegScaledInfo &info)
+     {
+          tjhandle handle = tjInitDecompress();
+          if (handle == nullptr)
+          {
+               SDL_SetError("tjInitDecompress failed");
+               return nullptr;
+          }
+          SDL_Surface *surface = nullptr;
+          int width = 0, height = 0, subsamp = 0, colorspace = 0;
+          if (tjDecompressHeader3(handle, data, (unsigned long)size, &width, &height, &subsamp, &colorspace) != 0)
+          {
+               SDL_SetError("Unable to read JPEG header: %s", turboError(handle));
+          }
+          else
+          {
+               const tjscalingfactor factor = pickScale(width, height, targetWidth, targetHeight);
+               info.width = width;
+               info.height = height;
+               info.scaleNum = factor.num;
+               info.scaleDenom = factor.denom;
+               surface = SDL_CreateRGBSurfaceWithFormat(0, scaled(width, factor), scaled(height, factor), 24,
+                                                        SDL_PIXELFORMAT_RGB24);
+               if (surface != nullptr &&
+                   tjDecompress2(handle, data, (unsigned long)size, (unsigned char *)surface->pixels, surface->w,
+                                 surface->pitch, surface->h, TJPF_RGB, 0) != 0)
+               {
+                    SDL_SetError("Unable to decode JPEG: %s", turboError(handle));
+                    SDL_FreeSurface(surface);
+                    surface = nullptr;
+               }
+          }
+          tjDestroy(handle);
+          return surface;
+     }
+}
+
+SymbolLibrary &jpegTurboLibrary()
+{
+     SDL_AtomicLock(&turboLock);
+     if (turboLibrary.files == nullptr)
+     {
+          symbolLibraryInit(turboLibrary, "turbojpeg", TURBO_FILES, TURBO_BINDINGS,
+                            (int)SDL_arraysize(TURBO_BINDINGS));
+     }
+     SDL_AtomicUnlock(&turboLock);
+     return turboLibrary;
+}
+
+bool jpegTurboAvailable(SymbolUsage *usage)
+{
+     SymbolLibrary &library = jpegTurboLibrary();
+     SDL_AtomicLock(&turboLock);
+     const bool loaded = library.handle != nullptr || symbolLibraryLoad(library);
+     SDL_AtomicUnlock(&turboLock);
+     if (loaded && usage != nullptr)
+     {
+          // Also when preloaded or loaded earlier, so the record keeps it
+          symbolUsageNote(*usage, library.tag);
+     }
+     return loaded;
+}
+
+SDL_Surface *jpegLoadScaled(SDL_RWops *src, int freesrc, int targetWidth, int targetHeight, JpegScaledInfo *info,
+                            SymbolUsage *usage)
+{
+     JpegScaledInfo local;
+     JpegScaledInfo &out = info != nullptr ? *info : local;
+     out = JpegScaledInfo{0, 0, 1, 1, false};
+     if (src == nullptr)
+     {
+          SDL_InvalidParamError("src");
+          return nullptr;
+     }
+
+     SDL_Surface *surface = nullptr;
+     const Sint64 start = SDL_RWtell(src);
+     if (jpegTurboAvailable(usage))
+     {
+          // Parse mapped and constant-memory streams in place
+          size_t size = 0;
+          const Uint8 *data = mappedRWData(src, &size);
+          std::vector<Uint8> copy;
+          if (data == nullptr)
+          {
+               const Sint64 end = SDL_RWsize(src);
+               if (start >= 0 && end > start && end - start <= MAX_JPEG_BYTES)
+               {
+                    copy.resize((size_t)(end - start));
+                    size = SDL_RWread(src, copy.data(), 1, copy.size());
+                    data = size == copy.size() ? copy.data() : nullptr;
+               }
+          }
+          if (data != nullptr)
+          {
+               surface = decodeTurbo(data, size, targetWidth, targetHeight, out);
+               out.turbo = surface != nullptr;
+          }
+     }
+
+     if (surface == nullptr && start >= 0 && SDL_RWseek(src, start, RW_SEEK_SET) == start)
+     {
+          // turbojpeg is missing or refused the file; SDL_image may cope
+          out = JpegScaledInfo{0, 0, 1, 1, false};
+          surface = IMG_LoadJPG_RW(src);
+          if (surface != nullptr)
+          {
+               out.width = surface->w;
+               out.height = surface->h;
+          }
+     }
+     if (freesrc)
+     {
+          SDL_RWclose(src);
+     }
+     return surface;
+}
@@ -0,0 +1,56 @@
+// Description:
+// JPEG decode at thumbnail size. IMG_LoadJPG_RW always decodes the whole
+// image, so a thumbnail of a camera-sized photo costs a full-resolution
+// decode, a full-resolution surface and an SDL_BlitScaled down from it.
+// JPEG can do better: the decoder can run its inverse DCT at 1/2, 1/4 or
+// 1/8 size (and the other eighths libjpeg-turbo offers), doing a fraction
+// of the work and producing only the smaller image.
+//
+// SDL_image exposes no way to ask for that, and the build it ships with
+// here uses its built-in decoder rather than libjpeg. jpegLoadScaled()
+// goes to libjpeg-turbo's TurboJPEG API instead, loaded at run time
+// through a SymbolLibrary (symbol_table.h) so the SIMD decoder is the one
+// used whenever turbojpeg is installed, and decodes at the smallest
+// scaling factor whose output still covers the target size. The result is
+// at least targetWidth x targetHeight (unless the image is smaller), to be
+// scaled the rest of the way by the caller. Without turbojpeg it falls
+// back to IMG_LoadJPG_RW at full size, so callers need no second path.
+//
+// turbojpeg is not shipped with the game: the SDL2 DLLs next to
+// mygame.exe do not include it, so a Windows build only takes the scaled
+// path once turbojpeg.dll (or MinGW's libturbojpeg.dll) from a
+// libjpeg-turbo release is copied beside them.
+// =============================================================================
+
+#ifndef JPEG_SCALED_H
+#define JPEG_SCALED_H
+
+#include <SDL2/SDL.h>
+
+#include "symbol_table.h"
+
+struct JpegScaledInfo
+{
+     int width, height; // Of the image in the file, 0 when unknown
+     int scaleNum, scaleDenom;
+     bool turbo; // Decoded by turbojpeg rather than SDL_image
+};
+
+// The turbojpeg library, for symbolPreload() tables
+SymbolLibrary &jpegTurboLibrary();
+
+// Load turbojpeg now rather than on the first decode; notes "turbojpeg" in
+// `usage` when given and it is loaded, preloaded or not. False when it is
+// not installed
+bool jpegTurboAvailable(SymbolUsage *usage = nullptr);
+
+// Decode a JPEG from `src` scaled down by the smallest DCT factor that
+// keeps it at least targetWidth x targetHeight; a target of 0 (either
+// side) puts no limit on that side. Surfaces from turbojpeg are RGB24.
+// Like IMG_Load_RW, closes `src` when freesrc is nonzero, and returns
+// nullptr with SDL's error set on failure. turbojpeg use is noted in
+// `usage` when given
+SDL_Surface *jpegLoadScaled(SDL_RWops *src, int freesrc, int targetWidth, int targetHeight,
+                            JpegScaledInfo *info = nullptr, SymbolUsage *usage = nullptr);
+
+#endif // JPEG_SCALED_H
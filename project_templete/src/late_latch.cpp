@@ -0,0 +1,121 @@
+#include "late_latch.h"
+
+namespace
+{
+     // Video drivers whose SDL_GetGlobalMouseState() asks the OS; the
+     // others hand back the pumped position in window units
+     bool latchHasGlobalPointer()
+     {
+          const char *driver = SDL_GetCurrentVideoDriver();
+          return driver != nullptr && (SDL_strcmp(driver, "windows") == 0 || SDL_strcmp(driver, "x11") == 0 ||
+                                       SDL_strcmp(driver, "cocoa") == 0);
+     }
+}
+
+void lateLatchInit(LateLatch &latch, SDL_Window *window, const LogicalView *view)
+{
+     latch.window = window;
+     latch.view = view;
+     latch.globalPointer = latchHasGlobalPointer();
+     latch.enabled = window != nullptr && view != nullptr;
+     latch.targets.clear();
+     latch.mark = 0;
+     latch.latched = 0;
+     latch.lastShift = 0.0f;
+}
+
+void lateLatchBegin(LateLatch &latch, const RenderQueue &queue)
+{
+     latch.mark = queue.items.size();
+}
+
+void lateLatchEnd(LateLatch &latch, const RenderQueue &queue, float offsetX, float offsetY,
+                  const SDL_FRect &bounds, Uint32 axes)
+{
+     if (!latch.enabled || queue.items.size() <= latch.mark)
+     {
+          return;
+     }
+     LateLatchTarget target;
+     target.first = latch.mark;
+     target.count = queue.items.size() - latch.mark;
+     target.offset = {offsetX, offsetY};
+     target.bounds = bounds;
+     target.axes = axes;
+     latch.targets.push_back(target);
+}
+
+bool lateLatchSample(const LateLatch &latch, SDL_FPoint &pointer)
+{
+     if (latch.window == nullptr || latch.view == nullptr || SDL_GetMouseFocus() != latch.window)
+     {
+          return false;
+     }
+     int x, y;
+     if (latch.globalPointer)
+     {
+          int windowX, windowY;
+          SDL_GetGlobalMouseState(&x, &y);
+          SDL_GetWindowPosition(latch.window, &windowX, &windowY);
+          x -= windowX;
+          y -= windowY;
+     }
+     else
+     {
+          SDL_GetMouseState(&x, &y);
+     }
+     int windowW, windowH;
+     SDL_GetWindowSize(latch.window, &windowW, &windowH);
+     if (x < 0 || y < 0 || x >= windowW || y >= windowH)
+     {
+          return false; // Left since the last event; the paddle stopped with it
+     }
+     pointer = logicalViewFromWindow(*latch.view, (float)x, (float)y);
+     return true;
+}
+
+void lateLatchApply(LateLatch &latch, RenderQueue &queue)
+{
+     SDL_FPoint pointer;
+     if (latch.targets.empty() || !latch.enabled || !lateLatchSample(latch, pointer))
+     {
+          latch.targets.clear();
+          return;
+     }
+     for (const LateLatchTarget &target : latch.targets)
+     {
+          if (target.first + target.count > queue.items.size())
+          {
+               continue; // The queue was cleared under us
+          }
+          const SDL_FRect &lead = queue.items[target.first].dst;
+          float dx = 0.0f, dy = 0.0f;
+          if (target.axes & LATE_LATCH_X)
+          {
+               const float x = SDL_clamp(pointer.x + target.offset.x, target.bounds.x,
+                                         target.bounds.x + target.bounds.w - lead.w);
+               dx = x - lead.x;
+          }
+          if (target.axes & LATE_LATCH_Y)
+          {
+               const float y = SDL_clamp(pointer.y + target.offset.y, target.bounds.y,
+                                         target.bounds.y + target.bounds.h - lead.h);
+               dy = y - lead.y;
+          }
+          for (size_t i = target.first; i < target.first + target.count; i++)
+          {
+               queue.items[i].dst.x += dx;
+               queue.items[i].dst.y += dy;
+               queue.items[i].pivot.x += dx; // Rotations turn about render coordinates
+               queue.items[i].pivot.y += dy;
+          }
+          latch.latched += (int)target.count;
+          latch.lastShift = SDL_sqrtf(dx * dx + dy * dy);
+     }
+     latch.targets.clear();
+}
+
+void lateLatchClear(LateLatch &latch)
+{
+     latch.targets.clear();
+}
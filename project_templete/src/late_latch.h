@@ -0,0 +1,90 @@
+// Description:
+// Late-latched pointer input for what follows the mouse. The game reads
+// mouse motion while handling events, simulates, queues the frame and only
+// then presents, and the paddle is also drawn interpolated between the
+// last two ticks: on screen it trails the pointer by the tick it is
+// interpolating through plus everything the frame did after the events
+// were read. A late latch records which queued items follow the pointer,
+// samples the pointer once more right before the queue is flushed to
+// the renderer, and moves those items to it. The simulation keeps
+// colliding against its own rect; only the picture is newer.
+//
+// Where the platform answers it (Windows, X11, Cocoa), the sample is
+// SDL_GetGlobalMouseState(), read from the OS at that moment rather than
+// from the events already pumped. Elsewhere (Wayland, the browser) SDL
+// only knows the pumped position, which still drops the interpolation's
+// tick. Nothing is moved while the pointer is outside the window, where
+// the simulation stops following it too.
+//
+// Replays and benchmarks must not latch: they draw what was recorded, not
+// wherever the mouse happens to be.
+//
+//     LateLatch latch;
+//     lateLatchInit(latch, window, &view);
+//     lateLatchBegin(latch, queue);
+//     renderQueueFillRect(queue, paddle, color);
+//     lateLatchEnd(latch, queue, -paddle.w / 2, 0.0f, bounds, LATE_LATCH_X);
+//     ...
+//     lateLatchApply(latch, queue);     // Right before renderQueueFlush()
+// =============================================================================
+
+#ifndef LATE_LATCH_H
+#define LATE_LATCH_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "logical_view.h"
+#include "render_queue.h"
+
+enum
+{
+     LATE_LATCH_X = 1,
+     LATE_LATCH_Y = 2
+};
+
+struct LateLatchTarget
+{
+     size_t first, count; // The queue's items that move together
+     SDL_FPoint offset;   // From the pointer to the first item's corner
+     SDL_FRect bounds;    // The first item is kept inside
+     Uint32 axes;         // LATE_LATCH_ flags
+};
+
+struct LateLatch
+{
+     SDL_Window *window;
+     const LogicalView *view;
+     bool globalPointer; // SDL_GetGlobalMouseState() reads the OS here
+     bool enabled;       // Cleared to draw where the simulation says
+     std::vector<LateLatchTarget> targets; // This frame's
+     size_t mark;                          // Queue length at lateLatchBegin()
+
+     int latched;     // Items moved, for the stats
+     float lastShift; // How far the newest sample moved the last item, logical units
+};
+
+void lateLatchInit(LateLatch &latch, SDL_Window *window, const LogicalView *view);
+
+// Start an element that follows the pointer
+void lateLatchBegin(LateLatch &latch, const RenderQueue &queue);
+
+// Latch the items queued since lateLatchBegin() to the pointer: at
+// lateLatchApply() the first one's position on `axes` becomes the pointer
+// plus the offset, kept inside `bounds`, and the rest move with it.
+// Nothing is latched when the latch is disabled or the queue clipped the
+// items away
+void lateLatchEnd(LateLatch &latch, const RenderQueue &queue, float offsetX, float offsetY,
+                  const SDL_FRect &bounds, Uint32 axes);
+
+// The pointer now, in logical units. False when it is outside the window
+bool lateLatchSample(const LateLatch &latch, SDL_FPoint &pointer);
+
+// Sample the pointer and move this frame's latched items to it, then
+// forget them. Call after the last item is queued and before the flush
+void lateLatchApply(LateLatch &latch, RenderQueue &queue);
+
+// Forget this frame's items without moving them, for a frame not drawn
+void lateLatchClear(LateLatch &latch);
+
+#endif // LATE_LATCH_H
@@ -0,0 +1,180 @@
+#include "line_batch.h"
+
+#include <cmath>
+
+#include "render_record.h"
+
+namespace
+{
+     // Longest mitre, in half widths; sharper joins are cut short there
+     const float MITER_LIMIT = 4.0f;
+
+     // Unit left normal of a -> b; false for a zero-length segment
+     bool segmentNormal(SDL_FPoint a, SDL_FPoint b, SDL_FPoint &normal)
+     {
+          const float dx = b.x - a.x, dy = b.y - a.y;
+          const float length2 = dx * dx + dy * dy;
+          if (length2 < 1e-12f)
+          {
+               return false;
+          }
+          const float inverse = 1.0f / std::sqrt(length2);
+          normal = {-dy * inverse, dx * inverse};
+          return true;
+     }
+
+     // Offset from a point to its core edge for unit half width: along the
+     // bisector of the two normals, long enough to keep the width across the
+     // join. For unit normals (n0 + n1) / (1 + n0.n1) is exactly that, with
+     // length 1 / cos(half the turn), so the common case needs no sqrt
+     SDL_FPoint joinOffset(SDL_FPoint incoming, SDL_FPoint outgoing)
+     {
+          const float sum = 1.0f + incoming.x * outgoing.x + incoming.y * outgoing.y;
+          if (sum < 1e-4f)
+          {
+               return outgoing; // The line doubles back on itself
+          }
+          float scale = 1.0f / sum;
+          if (sum * MITER_LIMIT * MITER_LIMIT < 2.0f)
+          {
+               scale *= MITER_LIMIT * std::sqrt(sum * 0.5f); // Length 2 / sum squared, cut to the limit
+          }
+          return {(incoming.x + outgoing.x) * scale, (incoming.y + outgoing.y) * scale};
+     }
+
+     template <typename T>
+     T *extend(std::vector<T> &array, int &used, int count)
+     {
+          if ((size_t)used + count > array.size())
+          {
+               array.resize(SDL_max((size_t)used + count, array.size() * 2));
+          }
+          T *added = array.data() + used;
+          used += count;
+          return added;
+     }
+
+     void addTriangleQuad(int *indices, int a0, int a1, int b0, int b1)
+     {
+          indices[0] = a0;
+          indices[1] = a1;
+          indices[2] = b1;
+          indices[3] = a0;
+          indices[4] = b1;
+          indices[5] = b0;
+     }
+}
+
+void lineBatchInit(LineBatch &batch, float feather, int reserveSegments)
+{
+     batch.feather = SDL_max(feather, 0.01f);
+     batch.vertices.assign((size_t)SDL_max(reserveSegments + 1, 0) * 4, SDL_Vertex());
+     batch.indices.assign((size_t)SDL_max(reserveSegments, 0) * 18, 0);
+     batch.vertexCount = 0;
+     batch.indexCount = 0;
+     batch.segments = 0;
+     batch.drawCalls = 0;
+}
+
+void lineBatchPolyline(LineBatch &batch, const SDL_FPoint *points, int count, float thickness, SDL_Color color,
+                       bool closed)
+{
+     if (points == nullptr || count < 2 || thickness <= 0.0f)
+     {
+          return;
+     }
+     closed = closed && count > 2;
+     const int segments = closed ? count : count - 1;
+
+     // A closed line's first point joins from its last segment; an open
+     // line's ends have one segment only. Either way, start from a real one
+     SDL_FPoint incoming = {0.0f, 0.0f};
+     bool found = false;
+     for (int s = 0; s < segments && !found; s++)
+     {
+          const int from = closed ? (segments - 1 - s + count) % count : s;
+          found = segmentNormal(points[from], points[(from + 1) % count], incoming);
+     }
+     if (!found)
+     {
+          return; // Every point is the same
+     }
+
+     const float core = SDL_max(thickness - batch.feather, 0.0f) * 0.5f;
+     const float outer = core + batch.feather;
+     SDL_Color solid = color;
+     if (thickness < batch.feather)
+     {
+          solid.a = (Uint8)(color.a * thickness / batch.feather + 0.5f);
+     }
+     SDL_Color faded = color;
+     faded.a = 0;
+     const SDL_FPoint uv = {0.0f, 0.0f};
+
+     const int base = batch.vertexCount;
+     SDL_Vertex *vertex = extend(batch.vertices, batch.vertexCount, count * 4);
+     for (int i = 0; i < count; i++)
+     {
+          SDL_FPoint outgoing = incoming;
+          if (i < segments)
+          {
+               const int next = i + 1 < count ? i + 1 : 0;
+               segmentNormal(points[i], points[next], outgoing); // Kept as incoming when zero length
+          }
+          if (!closed && i == 0)
+          {
+               incoming = outgoing;
+          }
+          const SDL_FPoint offset = joinOffset(incoming, outgoing);
+          const SDL_FPoint p = points[i];
+          vertex[0] = SDL_Vertex{{p.x + offset.x * outer, p.y + offset.y * outer}, faded, uv};
+          vertex[1] = SDL_Vertex{{p.x + offset.x * core, p.y + offset.y * core}, solid, uv};
+          vertex[2] = SDL_Vertex{{p.x - offset.x * core, p.y - offset.y * core}, solid, uv};
+          vertex[3] = SDL_Vertex{{p.x - offset.x * outer, p.y - offset.y * outer}, faded, uv};
+          vertex += 4;
+          incoming = outgoing;
+     }
+
+     int *index = extend(batch.indices, batch.indexCount, segments * 18);
+     for (int s = 0; s < segments; s++)
+     {
+          const int a = base + s * 4;
+          const int b = s + 1 < count ? a + 4 : base;
+          addTriangleQuad(index, a, a + 1, b, b + 1);              // Left fringe
+          addTriangleQuad(index + 6, a + 1, a + 2, b + 1, b + 2);  // Core
+          addTriangleQuad(index + 12, a + 2, a + 3, b + 2, b + 3); // Right fringe
+          index += 18;
+     }
+     batch.segments += segments;
+}
+
+void lineBatchLine(LineBatch &batch, SDL_FPoint from, SDL_FPoint to, float thickness, SDL_Color color)
+{
+     const SDL_FPoint points[2] = {from, to};
+     lineBatchPolyline(batch, points, 2, thickness, color);
+}
+
+void lineBatchFlush(LineBatch &batch, SDL_Renderer *renderer)
+{
+     batch.drawCalls = 0;
+     if (batch.indexCount > 0)
+     {
+          // Untextured geometry blends with the draw blend mode, and the
+          // fringe needs blending to fade out
+          SDL_BlendMode blendMode;
+          SDL_GetRenderDrawBlendMode(renderer, &blendMode);
+          renderRecordSetDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+          renderRecordGeometry(renderer, nullptr, batch.vertices.data(), batch.vertexCount, batch.indices.data(),
+                               batch.indexCount);
+          renderRecordSetDrawBlendMode(renderer, blendMode);
+          batch.drawCalls = 1;
+     }
+     lineBatchClear(batch);
+}
+
+void lineBatchClear(LineBatch &batch)
+{
+     batch.vertexCount = 0;
+     batch.indexCount = 0;
+     batch.segments = 0;
+}
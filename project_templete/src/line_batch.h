@@ -0,0 +1,58 @@
+// Description:
+// Thick, anti-aliased lines and polylines drawn in one SDL_RenderGeometry
+// call. SDL_RenderDrawLine draws one aliased, one pixel wide line per
+// call; debug overlays and graphs with thousands of segments pay for each
+// of them. Here every polyline is tessellated into a strip with a solid
+// core and a one-feather-wide fringe on each side that fades to alpha 0,
+// so the blend does the anti-aliasing without multisampling, and all of
+// them go out together at the flush.
+//
+// Each polyline point becomes four vertices (fringe, core, core, fringe)
+// and each segment six triangles. Joins are mitred, with the mitre length
+// clamped so a near reversal cannot spike far past the point; lines
+// thinner than the feather keep a fringe only and fade their alpha to
+// match their width.
+//
+//     LineBatch lines;
+//     lineBatchInit(lines);
+//     lineBatchPolyline(lines, graph, count, 1.5f, green);
+//     lineBatchLine(lines, {0, 100}, {640, 100}, 1.0f, grey);
+//     lineBatchFlush(lines, renderer);
+// =============================================================================
+
+#ifndef LINE_BATCH_H
+#define LINE_BATCH_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct LineBatch
+{
+     // Only ever grown, so a new frame writes over last frame's arrays
+     // instead of filling them with zeros first
+     std::vector<SDL_Vertex> vertices;
+     std::vector<int> indices;
+     int vertexCount, indexCount; // In use
+     float feather;               // Fringe width in pixels
+     int segments;                // Queued since the last flush
+     int drawCalls;               // SDL_RenderGeometry calls made by the last flush
+};
+
+// `reserveSegments` sizes the arrays up front so a graph of known length
+// never reallocates while it is queued
+void lineBatchInit(LineBatch &batch, float feather = 1.0f, int reserveSegments = 0);
+
+// `count` points joined in order; `closed` also joins the last to the first
+void lineBatchPolyline(LineBatch &batch, const SDL_FPoint *points, int count, float thickness, SDL_Color color,
+                       bool closed = false);
+
+void lineBatchLine(LineBatch &batch, SDL_FPoint from, SDL_FPoint to, float thickness, SDL_Color color);
+
+// Draw everything queued, blended, in one call and empty the batch. The
+// renderer's draw blend mode is left as it was
+void lineBatchFlush(LineBatch &batch, SDL_Renderer *renderer);
+
+// Drop what is queued without drawing it
+void lineBatchClear(LineBatch &batch);
+
+#endif // LINE_BATCH_H
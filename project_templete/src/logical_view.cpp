@@ -0,0 +1,134 @@
+#include "logical_view.h"
+
+#include "event_watch.h"
+
+namespace
+{
+     const EventTypeRange WATCHED_VIEW_EVENTS[] = {{SDL_WINDOWEVENT, SDL_WINDOWEVENT},
+                                                   {SDL_MOUSEMOTION, SDL_MOUSEBUTTONUP},
+                                                   {SDL_RENDER_TARGETS_RESET, SDL_RENDER_DEVICE_RESET}};
+
+     void applyTransform(LogicalView &view)
+     {
+          int outputW = 0, outputH = 0, windowW = 0, windowH = 0;
+          if (SDL_GetRendererOutputSize(view.renderer, &outputW, &outputH) != 0 || outputW <= 0 || outputH <= 0)
+          {
+               return; // Minimized; keep the last transform
+          }
+          SDL_GetWindowSize(view.window, &windowW, &windowH);
+          view.pixelsPerUnit = windowW > 0 ? (float)outputW / windowW : 1.0f;
+          view.outputWidth = outputW;
+          view.outputHeight = outputH;
+
+          const float fit = SDL_min((float)outputW / view.width, (float)outputH / view.height);
+          view.scale = view.mode == LOGICAL_SCALE_INTEGER && fit >= 1.0f ? SDL_floorf(fit) : fit;
+          const int w = (int)(view.width * view.scale + 0.5f), h = (int)(view.height * view.scale + 0.5f);
+          view.area = {(outputW - w) / 2, (outputH - h) / 2, w, h};
+
+          // SDL takes the viewport in scaled units and multiplies it back out
+          SDL_RenderSetScale(view.renderer, view.scale, view.scale);
+          const SDL_Rect viewport = {(int)(view.area.x / view.scale), (int)(view.area.y / view.scale), view.width,
+                                     view.height};
+          SDL_RenderSetViewport(view.renderer, &viewport);
+          view.updates++;
+     }
+
+     // Window units of relative motion in logical units, the truncated
+     // fraction kept in `remainder` for the next event
+     int scaleMotion(const LogicalView &view, int rel, float &remainder)
+     {
+          const float exact = rel * view.pixelsPerUnit / view.scale + remainder;
+          const int whole = (int)exact;
+          remainder = exact - whole;
+          return whole;
+     }
+
+     int SDLCALL logicalViewWatch(void *userdata, SDL_Event *event)
+     {
+          LogicalView &view = *(LogicalView *)userdata;
+          switch (event->type)
+          {
+          case SDL_WINDOWEVENT:
+               // SDL's renderer watch, ahead of this one, has just reset the viewport
+               if (event->window.windowID == view.windowId && event->window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+               {
+                    applyTransform(view);
+               }
+               break;
+          case SDL_RENDER_TARGETS_RESET:
+          case SDL_RENDER_DEVICE_RESET:
+               applyTransform(view);
+               break;
+          case SDL_MOUSEMOTION:
+               if (event->motion.windowID == view.windowId)
+               {
+                    const SDL_FPoint p = logicalViewFromWindow(view, (float)event->motion.x, (float)event->motion.y);
+                    event->motion.x = (int)SDL_floorf(p.x);
+                    event->motion.y = (int)SDL_floorf(p.y);
+                    event->motion.xrel = scaleMotion(view, event->motion.xrel, view.motionRemainderX);
+                    event->motion.yrel = scaleMotion(view, event->motion.yrel, view.motionRemainderY);
+               }
+               break;
+          case SDL_MOUSEBUTTONDOWN:
+          case SDL_MOUSEBUTTONUP:
+               if (event->button.windowID == view.windowId)
+               {
+                    const SDL_FPoint p = logicalViewFromWindow(view, (float)event->button.x, (float)event->button.y);
+                    event->button.x = (int)SDL_floorf(p.x);
+                    event->button.y = (int)SDL_floorf(p.y);
+               }
+               break;
+          default:
+               break;
+          }
+          return 1;
+     }
+}
+
+bool logicalViewInit(LogicalView &view, SDL_Window *window, SDL_Renderer *renderer, int width, int height)
+{
+     view.window = window;
+     view.windowId = SDL_GetWindowID(window);
+     view.renderer = renderer;
+     view.width = SDL_max(width, 1);
+     view.height = SDL_max(height, 1);
+     view.outputWidth = view.width;
+     view.outputHeight = view.height;
+     view.scale = 1.0f;
+     view.area = {0, 0, view.width, view.height};
+     view.pixelsPerUnit = 1.0f;
+     view.motionRemainderX = 0.0f;
+     view.motionRemainderY = 0.0f;
+     view.updates = 0;
+
+     const char *hint = SDL_GetHint(LOGICAL_VIEW_HINT);
+     logicalViewSetMode(view, hint != nullptr && SDL_strcasecmp(hint, "integer") == 0 ? LOGICAL_SCALE_INTEGER
+                                                                                       : LOGICAL_SCALE_FIT);
+     view.watching = eventWatchAdd(logicalViewWatch, &view, "logical view", WATCHED_VIEW_EVENTS,
+                                   SDL_arraysize(WATCHED_VIEW_EVENTS));
+     return view.watching;
+}
+
+void logicalViewSetMode(LogicalView &view, LogicalScaleMode mode)
+{
+     view.mode = mode;
+     if (mode == LOGICAL_SCALE_INTEGER)
+     {
+          SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+     }
+     applyTransform(view);
+}
+
+SDL_FPoint logicalViewFromWindow(const LogicalView &view, float x, float y)
+{
+     return {(x * view.pixelsPerUnit - view.area.x) / view.scale, (y * view.pixelsPerUnit - view.area.y) / view.scale};
+}
+
+void logicalViewQuit(LogicalView &view)
+{
+     if (view.watching)
+     {
+          eventWatchDel(logicalViewWatch, &view);
+          view.watching = false;
+     }
+}
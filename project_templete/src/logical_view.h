@@ -0,0 +1,80 @@
+// Description:
+// Fixed logical resolution on a window of any size, applied as the
+// renderer's own viewport and scale. Drawing code keeps its logical units
+// and the renderer maps them straight to the window's pixels, with no
+// intermediate target to scale from and no extra full-screen copy. It
+// replaces SDL_RenderSetLogicalSize so that the fit can be chosen:
+// - LOGICAL_SCALE_FIT: the largest scale that fits, letterboxed, sampled
+//   as SDL_HINT_RENDER_SCALE_QUALITY says;
+// - LOGICAL_SCALE_INTEGER: the largest whole-number scale, for pixel art;
+//   every logical pixel becomes an exact n x n block, and textures created
+//   after logicalViewInit() sample nearest. A window smaller than the
+//   logical size falls back to the fitting fraction.
+//
+// Without a logical size SDL no longer moves mouse coordinates into
+// logical units, so the view does: an event watch converts the position
+// (and motion) of this window's mouse events before they are queued, where
+// SDL's own conversion happens, so input recording and replay see logical
+// units as before. Relative motion carries what rounding leaves of a unit
+// into the next event, as SDL does, so slow drags on a scaled-up window
+// still add up. The same watch re-applies the transform on every size
+// change before anything else sees the event, a live redraw during a drag
+// included (see window_resize.h). All of this runs on the main thread, as
+// the window and mouse events do, between frames, while the window is the
+// render target.
+//
+// The bars are whatever the back buffer holds outside the viewport, so a
+// frame must start with SDL_RenderClear (which ignores the viewport), as
+// dirty_regions does.
+// =============================================================================
+
+#ifndef LOGICAL_VIEW_H
+#define LOGICAL_VIEW_H
+
+#include <SDL2/SDL.h>
+
+// Set to "integer" (SDL_SetHint or the environment) for whole-number
+// scaling with nearest sampling
+#define LOGICAL_VIEW_HINT "CATCH_LOGICAL_SCALE"
+
+enum LogicalScaleMode
+{
+     LOGICAL_SCALE_FIT,
+     LOGICAL_SCALE_INTEGER
+};
+
+struct LogicalView
+{
+     SDL_Window *window;
+     Uint32 windowId;
+     SDL_Renderer *renderer;
+     int width, height; // Logical size
+     LogicalScaleMode mode;
+
+     int outputWidth, outputHeight; // Renderer output in pixels
+     float scale;                   // Output pixels per logical unit
+     SDL_Rect area;                 // Output pixels the logical frame covers
+     float pixelsPerUnit;           // Output pixels per window unit (high DPI)
+     bool watching;
+     float motionRemainderX, motionRemainderY; // Fractions of a unit of relative motion not yet reported
+
+     int updates; // Transforms applied
+};
+
+// Start drawing `renderer` in `width` x `height` units, in the mode
+// LOGICAL_VIEW_HINT names (fit by default). Call before creating textures,
+// so integer mode's nearest sampling covers them. The watch holds `view`
+// by address until logicalViewQuit(). False with SDL's error set when the
+// watch cannot be added; the transform is applied regardless
+bool logicalViewInit(LogicalView &view, SDL_Window *window, SDL_Renderer *renderer, int width, int height);
+
+// Switch modes at run time; nearest sampling applies to textures created
+// from now on
+void logicalViewSetMode(LogicalView &view, LogicalScaleMode mode);
+
+// A point in window units (SDL_GetMouseState) in logical units
+SDL_FPoint logicalViewFromWindow(const LogicalView &view, float x, float y);
+
+void logicalViewQuit(LogicalView &view);
+
+#endif // LOGICAL_VIEW_H
@@ -0,0 +1,188 @@
+#include "lz4_block.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+     const int MIN_MATCH = 4;
+     const int LAST_LITERALS = 5;  // The format ends every block with literals
+     const int MATCH_LIMIT = 12;   // No match may start closer to the end
+     const int HASH_BITS = 12;
+     const int MAX_OFFSET = 65535;
+
+     Uint32 read32(const Uint8 *p)
+     {
+          Uint32 value;
+          std::memcpy(&value, p, sizeof(value));
+          return value;
+     }
+
+     Uint32 hash4(Uint32 sequence)
+     {
+          return (sequence * 2654435761u) >> (32 - HASH_BITS);
+     }
+
+     // Lengths of 15 and over continue in 255-valued extension bytes
+     Uint8 *writeLength(Uint8 *out, int length)
+     {
+          for (; length >= 255; length -= 255)
+          {
+               *out++ = 255;
+          }
+          *out++ = (Uint8)length;
+          return out;
+     }
+}
+
+int lz4BlockBound(int size)
+{
+     return size + size / 255 + 16;
+}
+
+int lz4BlockCompress(const Uint8 *src, int srcSize, Uint8 *dst, int dstCapacity)
+{
+     if (dstCapacity < lz4BlockBound(srcSize))
+     {
+          return 0;
+     }
+
+     std::vector<int> table(1 << HASH_BITS, -1);
+     Uint8 *out = dst;
+     int anchor = 0; // Start of pending literals
+     int pos = 0;
+     int matchEnd = srcSize - MATCH_LIMIT;
+
+     while (pos < matchEnd)
+     {
+          Uint32 sequence = read32(src + pos);
+          Uint32 slot = hash4(sequence);
+          int candidate = table[slot];
+          table[slot] = pos;
+          if (candidate < 0 || pos - candidate > MAX_OFFSET || read32(src + candidate) != sequence)
+          {
+               pos++;
+               continue;
+          }
+
+          // Extend the match, stopping short of the mandatory trailing literals
+          int length = MIN_MATCH;
+          int limit = srcSize - LAST_LITERALS;
+          while (pos + length < limit && src[candidate + length] == src[pos + length])
+          {
+               length++;
+          }
+
+          int literals = pos - anchor;
+          int matchCode = length - MIN_MATCH;
+          Uint8 *token = out++;
+          *token = (Uint8)((SDL_min(literals, 15) << 4) | SDL_min(matchCode, 15));
+          if (literals >= 15)
+          {
+               out = writeLength(out, literals - 15);
+          }
+          std::memcpy(out, src + anchor, literals);
+          out += literals;
+          int offset = pos - candidate;
+          *out++ = (Uint8)(offset & 0xFF);
+          *out++ = (Uint8)(offset >> 8);
+          if (matchCode >= 15)
+          {
+               out = writeLength(out, matchCode - 15);
+          }
+
+          pos += length;
+          anchor = pos;
+     }
+
+     // Everything after the last match goes out as one literal run
+     int literals = srcSize - anchor;
+     *out++ = (Uint8)(SDL_min(literals, 15) << 4);
+     if (literals >= 15)
+     {
+          out = writeLength(out, literals - 15);
+     }
+     std::memcpy(out, src + anchor, literals);
+     out += literals;
+     return (int)(out - dst);
+}
+
+bool lz4BlockDecompress(const Uint8 *src, int srcSize, Uint8 *dst, int dstSize)
+{
+     const Uint8 *in = src;
+     const Uint8 *inEnd = src + srcSize;
+     Uint8 *out = dst;
+     Uint8 *outEnd = dst + dstSize;
+
+     while (in < inEnd)
+     {
+          Uint8 token = *in++;
+
+          int literals = token >> 4;
+          if (literals == 15)
+          {
+               Uint8 more;
+               do
+               {
+                    if (in >= inEnd)
+                    {
+                         return false;
+                    }
+                    more = *in++;
+                    literals += more;
+               } while (more == 255);
+          }
+          if (literals > inEnd - in || literals > outEnd - out)
+          {
+               return false;
+          }
+          std::memcpy(out, in, literals);
+          in += literals;
+          out += literals;
+
+          if (in == inEnd)
+          {
+               break; // The final sequence has no match
+          }
+
+          if (inEnd - in < 2)
+          {
+               return false;
+          }
+          int offset = in[0] | (in[1] << 8);
+          in += 2;
+          if (offset == 0 || offset > out - dst)
+          {
+               return false;
+          }
+
+          int length = token & 15;
+          if (length == 15)
+          {
+               Uint8 more;
+               do
+               {
+                    if (in >= inEnd)
+                    {
+                         return false;
+                    }
+                    more = *in++;
+                    length += more;
+               } while (more == 255);
+          }
+          length += MIN_MATCH;
+          if (length > outEnd - out)
+          {
+               return false;
+          }
+
+          // Byte by byte: matches may overlap their own output
+          const Uint8 *match = out - offset;
+          for (int i = 0; i < length; i++)
+          {
+               out[i] = match[i];
+          }
+          out += length;
+     }
+     return out == outEnd;
+}
@@ -0,0 +1,24 @@
+// Description:
+// Self-contained codec for the LZ4 block format (no frame headers), used by
+// the asset pack for compressed entries. LZ4 blocks decode at memory speed
+// with no allocations, which keeps compressed packs as fast to stream from
+// as uncompressed ones. The compressor is a greedy single-probe hash
+// matcher: fast enough for a packing tool, not tuned for ratio.
+// =============================================================================
+
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+#include <SDL2/SDL.h>
+
+// Worst-case compressed size for `size` input bytes
+int lz4BlockBound(int size);
+
+// Compress into `dst`; returns the compressed size, or 0 if it didn't fit
+int lz4BlockCompress(const Uint8 *src, int srcSize, Uint8 *dst, int dstCapacity);
+
+// Decompress a whole block that expands to exactly `dstSize` bytes; returns
+// false on malformed input
+bool lz4BlockDecompress(const Uint8 *src, int srcSize, Uint8 *dst, int dstSize);
+
+#endif // LZ4_BLOCK_H
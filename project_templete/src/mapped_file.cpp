@@ -0,0 +1,213 @@
+#include "mapped_file.h"
+
+#include <cstring>
+
+#include "buffered_rw.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <vector>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+     struct MappedStream
+     {
+          MappedFile map;
+          size_t position;
+     };
+
+     MappedStream *mappedStreamOf(SDL_RWops *context)
+     {
+          return (MappedStream *)context->hidden.unknown.data1;
+     }
+
+     Sint64 SDLCALL mappedSize(SDL_RWops *context)
+     {
+          return (Sint64)mappedStreamOf(context)->map.size;
+     }
+
+     Sint64 SDLCALL mappedSeek(SDL_RWops *context, Sint64 offset, int whence)
+     {
+          MappedStream &stream = *mappedStreamOf(context);
+          const Sint64 base = whence == RW_SEEK_SET ? 0 : whence == RW_SEEK_CUR ? (Sint64)stream.position
+                                                                                 : (Sint64)stream.map.size;
+          const Sint64 target = base + offset;
+          if (whence < RW_SEEK_SET || whence > RW_SEEK_END || target < 0)
+          {
+               return SDL_SetError("Invalid seek in mapped file");
+          }
+          // Past the end is allowed, as with files; reads there return nothing
+          stream.position = (size_t)target;
+          return target;
+     }
+
+     size_t SDLCALL mappedRead(SDL_RWops *context, void *ptr, size_t size, size_t maxnum)
+     {
+          MappedStream &stream = *mappedStreamOf(context);
+          if (size == 0 || stream.position >= stream.map.size)
+          {
+               return 0;
+          }
+          const size_t count = SDL_min(maxnum, (stream.map.size - stream.position) / size);
+          std::memcpy(ptr, stream.map.base + stream.position, count * size);
+          stream.position += count * size;
+          return count;
+     }
+
+     size_t SDLCALL mappedWrite(SDL_RWops *, const void *, size_t, size_t)
+     {
+          SDL_SetError("Mapped files are read-only");
+          return 0;
+     }
+
+     int SDLCALL mappedClose(SDL_RWops *context)
+     {
+          MappedStream *stream = mappedStreamOf(context);
+          mappedFileClose(stream->map);
+          delete stream;
+          SDL_FreeRW(context);
+          return 0;
+     }
+}
+
+bool mappedFileOpen(MappedFile &map, const char *path)
+{
+     map.base = nullptr;
+     map.size = 0;
+     map.file = nullptr;
+     map.mapping = nullptr;
+#ifdef _WIN32
+     const int length = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+     std::vector<wchar_t> widePath(SDL_max(length, 1));
+     MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath.data(), length);
+     HANDLE file = CreateFileW(widePath.data(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+     if (file == INVALID_HANDLE_VALUE)
+     {
+          SDL_SetError("Couldn't open %s (error %lu)", path, GetLastError());
+          return false;
+     }
+     LARGE_INTEGER size;
+     if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+     {
+          SDL_SetError("Couldn't map %s: empty or unreadable", path);
+          CloseHandle(file);
+          return false;
+     }
+     HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+     void *view = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+     if (view == NULL)
+     {
+          SDL_SetError("Couldn't map %s (error %lu)", path, GetLastError());
+          if (mapping != NULL)
+          {
+               CloseHandle(mapping);
+          }
+          CloseHandle(file);
+          return false;
+     }
+     map.file = file;
+     map.mapping = mapping;
+     map.base = (const Uint8 *)view;
+     map.size = (size_t)size.QuadPart;
+#else
+     int fd = open(path, O_RDONLY | O_CLOEXEC);
+     if (fd < 0)
+     {
+          SDL_SetError("Couldn't open %s: %s", path, strerror(errno));
+          return false;
+     }
+     struct stat info;
+     if (fstat(fd, &info) != 0 || info.st_size == 0)
+     {
+          SDL_SetError("Couldn't map %s: empty or unreadable", path);
+          close(fd);
+          return false;
+     }
+     void *view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+     close(fd); // The mapping keeps the file alive
+     if (view == MAP_FAILED)
+     {
+          SDL_SetError("Couldn't map %s: %s", path, strerror(errno));
+          return false;
+     }
+     map.base = (const Uint8 *)view;
+     map.size = (size_t)info.st_size;
+#endif
+     return true;
+}
+
+void mappedFileClose(MappedFile &map)
+{
+     if (map.base == nullptr)
+     {
+          return;
+     }
+#ifdef _WIN32
+     UnmapViewOfFile(map.base);
+     CloseHandle((HANDLE)map.mapping);
+     CloseHandle((HANDLE)map.file);
+#else
+     munmap((void *)map.base, map.size);
+#endif
+     map.base = nullptr;
+     map.size = 0;
+}
+
+SDL_RWops *mappedRWFromFile(const char *path)
+{
+     MappedFile map;
+     if (!mappedFileOpen(map, path))
+     {
+          return bufferedRWFromFile(path, "rb");
+     }
+     SDL_RWops *rw = SDL_AllocRW();
+     if (rw == nullptr)
+     {
+          mappedFileClose(map);
+          return nullptr;
+     }
+     MappedStream *stream = new MappedStream;
+     stream->map = map;
+     stream->position = 0;
+
+     rw->size = mappedSize;
+     rw->seek = mappedSeek;
+     rw->read = mappedRead;
+     rw->write = mappedWrite;
+     rw->close = mappedClose;
+     rw->type = SDL_RWOPS_UNKNOWN;
+     rw->hidden.unknown.data1 = stream;
+     return rw;
+}
+
+const Uint8 *mappedRWData(SDL_RWops *rw, size_t *remaining)
+{
+     const Uint8 *here = nullptr, *stop = nullptr;
+     if (rw != nullptr && rw->close == mappedClose)
+     {
+          const MappedStream &stream = *mappedStreamOf(rw);
+          const size_t position = SDL_min(stream.position, stream.map.size);
+          here = stream.map.base + position;
+          stop = stream.map.base + stream.map.size;
+     }
+     else if (rw != nullptr && rw->type == SDL_RWOPS_MEMORY_RO)
+     {
+          here = rw->hidden.mem.here;
+          stop = rw->hidden.mem.stop;
+     }
+     if (here == nullptr)
+     {
+          return nullptr;
+     }
+     *remaining = (size_t)(stop - here);
+     return here;
+}
@@ -0,0 +1,44 @@
+// Description:
+// Read-only memory-mapped files, as a mapping and as an SDL_RWops.
+// SDL_RWFromFile copies every read out of the page cache through stdio or
+// ReadFile; a mapped stream's read is a memcpy from the pages themselves
+// and opening costs one mapping call, which makes the many small reads of
+// font and music decoders cheap.
+//
+// mappedRWData() gives loaders that can parse in place the bytes behind a
+// stream, for mapped streams and for SDL_RWFromConstMem ones (asset_pack's
+// raw entries), so they can skip the copy entirely. Mapped pages are
+// loaded on first touch; a file truncated by another process while mapped
+// faults instead of reading short, so map only files the game owns.
+// =============================================================================
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <SDL2/SDL.h>
+
+struct MappedFile
+{
+     const Uint8 *base; // nullptr when closed
+     size_t size;
+
+     // Platform handles
+     void *file;
+     void *mapping;
+};
+
+// Map all of `path` read-only. Fails with SDL's error set, also for empty
+// files, which cannot be mapped
+bool mappedFileOpen(MappedFile &map, const char *path);
+void mappedFileClose(MappedFile &map);
+
+// Read-only stream over a mapping of `path`, closed with SDL_RWclose. Falls
+// back to a buffered stream (buffered_rw.h) when the file can't be mapped
+SDL_RWops *mappedRWFromFile(const char *path);
+
+// The bytes behind a mapped or constant-memory stream, from its current
+// position to the end, with their count in `remaining`; nullptr for other
+// streams. The stream's position is not moved
+const Uint8 *mappedRWData(SDL_RWops *rw, size_t *remaining);
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,428 @@
+#include "mapping_db.h"
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <vector>
+
+namespace
+{
+     const Uint32 DB_VERSION = 2; // 2: buckets keyed as guidKey() does
+     const size_t DB_HEADER_BYTES = 32;
+     const size_t DB_ENTRY_BYTES = 24;
+     const Uint16 PLATFORM_UNKNOWN = 0xffff; // Named a platform SDL does not have
+
+     // SDL_GetPlatform() names, tagged by index + 1
+     const char *const PLATFORMS[] = {"Windows", "Mac OS X", "Linux", "iOS", "Android"};
+
+     const Uint16 BUS_VIRTUAL = 0xff; // SDL_HARDWARE_BUS_VIRTUAL
+
+     struct CompiledEntry
+     {
+          Uint8 guid[16]; // A crc: field folded into bytes 2-3, as SDL stores it
+          Uint16 platform;
+          std::string line;
+          size_t lineNumber; // Of the last line for this GUID and platform
+     };
+
+     Uint32 entryLE32(const Uint8 *p)
+     {
+          Uint32 value;
+          std::memcpy(&value, p, sizeof(value));
+          return SDL_SwapLE32(value);
+     }
+
+     Uint16 entryLE16(const Uint8 *p)
+     {
+          Uint16 value;
+          std::memcpy(&value, p, sizeof(value));
+          return SDL_SwapLE16(value);
+     }
+
+     void appendLE32(std::vector<Uint8> &out, Uint32 value)
+     {
+          value = SDL_SwapLE32(value);
+          const Uint8 *bytes = (const Uint8 *)&value;
+          out.insert(out.end(), bytes, bytes + sizeof(value));
+     }
+
+     void appendLE16(std::vector<Uint8> &out, Uint16 value)
+     {
+          value = SDL_SwapLE16(value);
+          const Uint8 *bytes = (const Uint8 *)&value;
+          out.insert(out.end(), bytes, bytes + sizeof(value));
+     }
+
+     // How SDL reads a GUID (SDL_GetJoystickGUIDInfo): a bus below ' ' or
+     // the virtual bus puts a CRC of the name in bytes 2-3, and the
+     // standard form (zero words 3 and 5) a version in bytes 12-13, matched
+     // only when vendor and product are set (SDL_JoystickGUIDUsesVersion)
+     struct GuidForm
+     {
+          bool hasCrc;
+          bool hasVersion;
+          bool usesVersion;
+     };
+
+     GuidForm guidForm(const Uint8 *guid)
+     {
+          const Uint16 bus = entryLE16(guid);
+          GuidForm form;
+          form.hasCrc = bus < ' ' || bus == BUS_VIRTUAL;
+          form.hasVersion = form.hasCrc && entryLE16(guid + 6) == 0 && entryLE16(guid + 10) == 0;
+          form.usesVersion = form.hasVersion && entryLE16(guid + 4) != 0 && entryLE16(guid + 8) != 0;
+          return form;
+     }
+
+     Uint16 guidCrc(const Uint8 *guid)
+     {
+          return guidForm(guid).hasCrc ? entryLE16(guid + 2) : 0;
+     }
+
+     // The GUID with its CRC cleared, and its version too unless
+     // `withVersion`; SDL compares these
+     void guidKey(const Uint8 *guid, bool withVersion, Uint8 *key)
+     {
+          const GuidForm form = guidForm(guid);
+          std::memcpy(key, guid, 16);
+          if (form.hasCrc)
+          {
+               key[2] = key[3] = 0;
+          }
+          if (form.hasVersion && !withVersion)
+          {
+               key[12] = key[13] = 0;
+          }
+     }
+
+     void bucketKey(const Uint8 *guid, Uint8 *key)
+     {
+          guidKey(guid, false, key);
+     }
+
+     // FNV-1a over the bucket key
+     Uint32 bucketOf(const Uint8 *guid, Uint32 bucketCount)
+     {
+          Uint8 key[16];
+          bucketKey(guid, key);
+          Uint64 hash = 14695981039346656037ull;
+          for (const Uint8 byte : key)
+          {
+               hash = (hash ^ byte) * 1099511628211ull;
+          }
+          return (Uint32)hash & (bucketCount - 1);
+     }
+
+     Uint16 platformTag(const char *name, size_t length)
+     {
+          for (size_t i = 0; i < SDL_arraysize(PLATFORMS); i++)
+          {
+               if (SDL_strlen(PLATFORMS[i]) == length && std::memcmp(PLATFORMS[i], name, length) == 0)
+               {
+                    return (Uint16)(i + 1);
+               }
+          }
+          return PLATFORM_UNKNOWN;
+     }
+
+     // GUID and platform of one mapping line; false for lines SDL would
+     // not take from a file
+     bool parseLine(const std::string &line, CompiledEntry &entry)
+     {
+          const size_t comma = line.find(',');
+          if (comma != 32)
+          {
+               return false;
+          }
+          for (size_t i = 0; i < 32; i++)
+          {
+               if (!SDL_isxdigit((unsigned char)line[i]))
+               {
+                    return false;
+               }
+          }
+          const SDL_JoystickGUID guid = SDL_JoystickGetGUIDFromString(line.substr(0, 32).c_str());
+          std::memcpy(entry.guid, guid.data, sizeof(entry.guid));
+          // SDL keeps a GUID's CRC and a crc: field as one and the same
+          const size_t crc = line.find(",crc:", comma);
+          if (crc != std::string::npos && guidForm(entry.guid).hasCrc && guidCrc(entry.guid) == 0)
+          {
+               const Uint16 value = SDL_SwapLE16((Uint16)SDL_strtoul(line.c_str() + crc + SDL_strlen(",crc:"), nullptr, 16));
+               std::memcpy(entry.guid + 2, &value, sizeof(value));
+          }
+
+          entry.platform = 0;
+          const size_t platform = line.find(",platform:", comma);
+          if (platform != std::string::npos)
+          {
+               const size_t start = platform + SDL_strlen(",platform:");
+               size_t end = line.find(',', start);
+               end = end == std::string::npos ? line.size() : end;
+               entry.platform = platformTag(line.data() + start, end - start);
+          }
+          entry.line = line;
+          return true;
+     }
+}
+
+bool mappingDbOpen(MappingDb &db, const char *path)
+{
+     db.base = nullptr;
+     db.size = 0;
+     if (!mappedFileOpen(db.mapping, path))
+     {
+          std::cerr << "Unable to map controller mappings " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     db.base = db.mapping.base;
+     db.size = db.mapping.size;
+
+     const Uint8 *header = db.base;
+     const bool sized = db.size >= DB_HEADER_BYTES;
+     db.entryCount = sized ? entryLE32(header + 8) : 0;
+     db.bucketCount = sized ? entryLE32(header + 12) : 0;
+     const Uint64 bucketsOffset = sized ? entryLE32(header + 16) : 0;
+     const Uint64 entriesOffset = sized ? entryLE32(header + 20) : 0;
+     const Uint64 textOffset = sized ? entryLE32(header + 24) : 0;
+     db.textSize = sized ? entryLE32(header + 28) : 0;
+
+     // Only the tables' extents are checked here; entries are checked as
+     // lookups reach them, so opening costs the same for any size of file
+     const bool valid = sized && std::memcmp(header, "GCDB", 4) == 0 && entryLE32(header + 4) == DB_VERSION &&
+                        db.bucketCount != 0 && (db.bucketCount & (db.bucketCount - 1)) == 0 &&
+                        bucketsOffset + ((Uint64)db.bucketCount + 1) * 4 <= db.size &&
+                        entriesOffset + (Uint64)db.entryCount * DB_ENTRY_BYTES <= db.size &&
+                        textOffset + db.textSize <= db.size;
+     if (!valid)
+     {
+          std::cerr << path << " is not a valid controller mapping file" << std::endl;
+          mappingDbClose(db);
+          return false;
+     }
+     db.buckets = db.base + bucketsOffset;
+     db.entries = db.base + entriesOffset;
+     db.text = (const char *)db.base + textOffset;
+
+     const char *platform = SDL_GetPlatform();
+     db.platform = platformTag(platform, SDL_strlen(platform));
+     db.platform = db.platform == PLATFORM_UNKNOWN ? 0 : db.platform;
+     return true;
+}
+
+void mappingDbClose(MappingDb &db)
+{
+     mappedFileClose(db.mapping);
+     db.base = nullptr;
+     db.size = 0;
+     db.entryCount = 0;
+     db.bucketCount = 0;
+}
+
+bool mappingDbFind(const MappingDb &db, SDL_JoystickGUID guid, std::string &mapping)
+{
+     if (db.base == nullptr)
+     {
+          return false;
+     }
+     const Uint32 bucket = bucketOf(guid.data, db.bucketCount);
+     const Uint32 first = entryLE32(db.buckets + 4 * bucket);
+     const Uint32 last = SDL_min(entryLE32(db.buckets + 4 * (bucket + 1)), db.entryCount);
+
+     // As SDL_PrivateGetControllerMappingForGUID: the version must match,
+     // then (for GUIDs that carry one) it need not. Either way a mapping
+     // with the device's CRC wins over one without a CRC, and one with
+     // another CRC never matches. A line for this platform was written
+     // after any untagged line of its GUID (the compiler drops it
+     // otherwise), so it wins a tie as the later line would in SDL
+     const Uint16 crc = guidCrc(guid.data);
+     const int passes = guidForm(guid.data).usesVersion ? 2 : 1;
+     const Uint8 *found = nullptr;
+     for (int pass = 0; pass < passes && found == nullptr; pass++)
+     {
+          Uint8 key[16];
+          guidKey(guid.data, pass == 0, key);
+          const Uint8 *fallback = nullptr;
+          int foundRank = -1, fallbackRank = -1;
+          for (Uint32 i = first; i < last; i++)
+          {
+               const Uint8 *entry = db.entries + (size_t)i * DB_ENTRY_BYTES;
+               const Uint16 platform = entryLE16(entry + 22);
+               if (platform != 0 && (db.platform == 0 || platform != db.platform))
+               {
+                    continue;
+               }
+               Uint8 entryKey[16];
+               guidKey(entry, pass == 0, entryKey);
+               if (std::memcmp(key, entryKey, sizeof(key)) != 0)
+               {
+                    continue;
+               }
+               const Uint16 entryCrc = guidCrc(entry);
+               const int rank = platform != 0 ? 1 : 0;
+               if (entryCrc == crc && rank > foundRank)
+               {
+                    found = entry;
+                    foundRank = rank;
+               }
+               else if (entryCrc == 0 && rank > fallbackRank)
+               {
+                    fallback = entry;
+                    fallbackRank = rank;
+               }
+          }
+          found = found != nullptr ? found : fallback;
+     }
+     if (found == nullptr)
+     {
+          return false;
+     }
+
+     const Uint32 offset = entryLE32(found + 16);
+     const Uint16 length = entryLE16(found + 20);
+     if ((Uint64)offset + length > db.textSize)
+     {
+          return false;
+     }
+     mapping.assign(db.text + offset, length);
+     return true;
+}
+
+bool mappingDbApply(const MappingDb &db, SDL_JoystickGUID guid)
+{
+     // SDL's built-in mappings and any the app or SDL_GAMECONTROLLERCONFIG
+     // added come first; adding ours would replace them
+     char *existing = SDL_GameControllerMappingForGUID(guid);
+     if (existing != nullptr)
+     {
+          SDL_free(existing);
+          return true;
+     }
+     std::string mapping;
+     return mappingDbFind(db, guid, mapping) && SDL_GameControllerAddMapping(mapping.c_str()) >= 0;
+}
+
+bool mappingDbCompile(const char *text, size_t size, const char *outPath, int *entries)
+{
+     // Last line wins per GUID and platform, in the order first seen
+     std::vector<CompiledEntry> compiled;
+     std::map<std::string, size_t> seen;
+     size_t start = 0;
+     size_t lineNumber = 0;
+     while (start < size)
+     {
+          const char *newline = (const char *)std::memchr(text + start, '\n', size - start);
+          const size_t end = newline != nullptr ? (size_t)(newline - text) : size;
+          std::string line(text + start, end - start);
+          start = end + 1;
+          lineNumber++;
+          while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+          {
+               line.pop_back();
+          }
+          line.erase(0, line.find_first_not_of(" \t"));
+
+          CompiledEntry entry;
+          if (line.empty() || line[0] == '#' || line.size() > 0xffff || !parseLine(line, entry))
+          {
+               continue;
+          }
+          entry.lineNumber = lineNumber;
+          std::string key((const char *)entry.guid, sizeof(entry.guid));
+          key.append((const char *)&entry.platform, sizeof(entry.platform));
+          auto existing = seen.find(key);
+          if (existing != seen.end())
+          {
+               compiled[existing->second] = entry;
+          }
+          else
+          {
+               seen[key] = compiled.size();
+               compiled.push_back(entry);
+          }
+     }
+
+     // SDL adds a platform's lines and untagged ones to the same list, so
+     // an untagged line after a tagged one of the same GUID replaces it
+     std::vector<CompiledEntry> kept;
+     for (const CompiledEntry &entry : compiled)
+     {
+          if (entry.platform != 0)
+          {
+               std::string untagged((const char *)entry.guid, sizeof(entry.guid));
+               const Uint16 none = 0;
+               untagged.append((const char *)&none, sizeof(none));
+               auto later = seen.find(untagged);
+               if (later != seen.end() && compiled[later->second].lineNumber > entry.lineNumber)
+               {
+                    continue;
+               }
+          }
+          kept.push_back(entry);
+     }
+     compiled.swap(kept);
+
+     Uint32 bucketCount = 1;
+     while (bucketCount < compiled.size())
+     {
+          bucketCount *= 2;
+     }
+     std::vector<std::vector<size_t>> buckets(bucketCount);
+     for (size_t i = 0; i < compiled.size(); i++)
+     {
+          buckets[bucketOf(compiled[i].guid, bucketCount)].push_back(i);
+     }
+
+     const Uint32 bucketsOffset = (Uint32)DB_HEADER_BYTES;
+     const Uint32 entriesOffset = bucketsOffset + (bucketCount + 1) * 4;
+     const Uint32 textOffset = entriesOffset + (Uint32)(compiled.size() * DB_ENTRY_BYTES);
+     std::vector<Uint8> out;
+     std::string lines;
+     out.insert(out.end(), {'G', 'C', 'D', 'B'});
+     appendLE32(out, DB_VERSION);
+     appendLE32(out, (Uint32)compiled.size());
+     appendLE32(out, bucketCount);
+     appendLE32(out, bucketsOffset);
+     appendLE32(out, entriesOffset);
+     appendLE32(out, textOffset);
+     const size_t textSizeAt = out.size();
+     appendLE32(out, 0);
+
+     Uint32 next = 0;
+     for (const std::vector<size_t> &bucket : buckets)
+     {
+          appendLE32(out, next);
+          next += (Uint32)bucket.size();
+     }
+     appendLE32(out, next);
+     for (const std::vector<size_t> &bucket : buckets)
+     {
+          for (const size_t index : bucket)
+          {
+               const CompiledEntry &entry = compiled[index];
+               out.insert(out.end(), entry.guid, entry.guid + sizeof(entry.guid));
+               appendLE32(out, (Uint32)lines.size());
+               appendLE16(out, (Uint16)entry.line.size());
+               appendLE16(out, entry.platform);
+               lines += entry.line;
+          }
+     }
+     const Uint32 textSize = SDL_SwapLE32((Uint32)lines.size());
+     std::memcpy(&out[textSizeAt], &textSize, sizeof(textSize));
+     out.insert(out.end(), lines.begin(), lines.end());
+
+     SDL_RWops *rw = SDL_RWFromFile(outPath, "wb");
+     if (rw == nullptr)
+     {
+          return false;
+     }
+     const bool written = SDL_RWwrite(rw, out.data(), 1, out.size()) == out.size();
+     if (SDL_RWclose(rw) != 0 || !written)
+     {
+          return false;
+     }
+     if (entries != nullptr)
+     {
+          *entries = (int)compiled.size();
+     }
+     return true;
+}
@@ -0,0 +1,72 @@
+// Description:
+// Game controller mappings looked up by GUID instead of loaded up front.
+// SDL_GameControllerAddMappingsFromRW reads a gamecontrollerdb.txt of
+// thousands of lines at startup, string-matching each one and adding it
+// to a list that is then searched linearly on every connect, for the two
+// or three devices ever plugged in. A MappingDb is that file compiled by
+// mappingDbCompile() (see tools/mkmapdb.cpp) and memory-mapped: opening
+// it checks the header and nothing more, a lookup hashes the GUID into a
+// bucket table, and only the line found is handed to SDL, parsed once,
+// when its device connects.
+//
+// Layout (all integers little-endian):
+//     header  "GCDB", version, entryCount, bucketCount, bucketsOffset,
+//             entriesOffset, textOffset, textSize
+//     buckets (bucketCount + 1) x first entry; bucket b holds entries
+//             [buckets[b], buckets[b + 1])
+//     entries entryCount x {GUID (16 bytes), lineOffset, lineLength (16),
+//             platform (16)}
+//     text    the mapping lines, not terminated
+//
+// SDL matches a device to a mapping whose GUID differs in its version
+// when no exact one exists, and holds a mapping's CRC (in its GUID or a
+// crc: field) apart from the GUID: one with the device's CRC wins, one
+// with none is the fallback. So buckets are keyed on the GUID with those
+// fields zeroed, CRCs are folded into the stored GUID, and a lookup ranks
+// the bucket's entries the same way. Lines for other platforms are kept,
+// tagged, and passed over at lookup, so one file serves every build.
+// =============================================================================
+
+#ifndef MAPPING_DB_H
+#define MAPPING_DB_H
+
+#include <SDL2/SDL.h>
+#include <string>
+
+#include "mapped_file.h"
+
+struct MappingDb
+{
+     const Uint8 *base; // Start of the mapping, nullptr when closed
+     size_t size;
+     Uint32 entryCount;
+     Uint32 bucketCount; // A power of two
+     const Uint8 *buckets;
+     const Uint8 *entries;
+     const char *text;
+     Uint32 textSize;
+     Uint16 platform; // SDL_GetPlatform()'s tag in the file, 0 if it has none
+
+     MappedFile mapping; // base and size above are its own
+};
+
+bool mappingDbOpen(MappingDb &db, const char *path);
+void mappingDbClose(MappingDb &db);
+
+// The mapping line for `guid` on this platform, false if the file has none
+bool mappingDbFind(const MappingDb &db, SDL_JoystickGUID guid, std::string &mapping);
+
+// Give SDL the mapping for `guid` unless it has one already, built in or
+// added by the app, which is left alone; true when the device now has a
+// mapping. Call before SDL_IsGameController() on a newly
+// attached joystick, as SDL only considers what it has been given
+bool mappingDbApply(const MappingDb &db, SDL_JoystickGUID guid);
+
+// Compile gamecontrollerdb.txt-format `text` into `outPath`. Comments,
+// blank lines and lines without a GUID are skipped; where a GUID (and
+// CRC) repeats for a platform, or untagged after a platform's line, the
+// last line wins, as it would with SDL. Returns false
+// with SDL's error set if the file cannot be written
+bool mappingDbCompile(const char *text, size_t size, const char *outPath, int *entries = nullptr);
+
+#endif // MAPPING_DB_H
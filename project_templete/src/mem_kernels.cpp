@@ -0,0 +1,428 @@
+#include "mem_kernels.h"
+
+#include <cstring>
+
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define MEM_KERNELS_X86 1
+#include <emmintrin.h>
+#if defined(__GNUC__) && !defined(__EMSCRIPTEN__)
+#define MEM_KERNELS_AVX 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define MEM_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+     // --- libc ---
+
+     void memCopyLibc(void *dst, const void *src, size_t bytes)
+     {
+          std::memcpy(dst, src, bytes);
+     }
+
+     void memFill32Libc(void *dst, Uint32 value, size_t count)
+     {
+          Uint32 *out = (Uint32 *)dst;
+          for (size_t i = 0; i < count; i++)
+          {
+               out[i] = value;
+          }
+     }
+
+     size_t memLengthLibc(const char *text)
+     {
+          return std::strlen(text);
+     }
+
+     const MemKernelTable MEM_LIBC_TABLE = {memCopyLibc, memFill32Libc, memLengthLibc};
+
+#ifdef MEM_KERNELS_X86
+     // --- SSE2: 16 bytes per store, 64 per loop ---
+     // Copies store the first and last vector unaligned and everything in
+     // between aligned to the destination, overlapping the ends instead of
+     // looping over a byte tail.
+
+     void memCopySse2(void *dst, const void *src, size_t bytes)
+     {
+          if (bytes < 32)
+          {
+               std::memcpy(dst, src, bytes);
+               return;
+          }
+          Uint8 *out = (Uint8 *)dst;
+          const Uint8 *in = (const Uint8 *)src;
+          const __m128i head = _mm_loadu_si128((const __m128i *)in);
+          const __m128i tail = _mm_loadu_si128((const __m128i *)(in + bytes - 16));
+          Uint8 *const outEnd = out + bytes;
+          const size_t skew = 16 - ((uintptr_t)out & 15);
+          _mm_storeu_si128((__m128i *)out, head);
+          in += skew;
+          out += skew;
+          size_t left = bytes - skew;
+          if (bytes >= MEM_STREAMING_BYTES)
+          {
+               for (; left >= 64; left -= 64, in += 64, out += 64)
+               {
+                    const __m128i a = _mm_loadu_si128((const __m128i *)in);
+                    const __m128i b = _mm_loadu_si128((const __m128i *)(in + 16));
+                    const __m128i c = _mm_loadu_si128((const __m128i *)(in + 32));
+                    const __m128i d = _mm_loadu_si128((const __m128i *)(in + 48));
+                    _mm_stream_si128((__m128i *)out, a);
+                    _mm_stream_si128((__m128i *)(out + 16), b);
+                    _mm_stream_si128((__m128i *)(out + 32), c);
+                    _mm_stream_si128((__m128i *)(out + 48), d);
+               }
+               _mm_sfence();
+          }
+          for (; left >= 64; left -= 64, in += 64, out += 64)
+          {
+               const __m128i a = _mm_loadu_si128((const __m128i *)in);
+               const __m128i b = _mm_loadu_si128((const __m128i *)(in + 16));
+               const __m128i c = _mm_loadu_si128((const __m128i *)(in + 32));
+               const __m128i d = _mm_loadu_si128((const __m128i *)(in + 48));
+               _mm_store_si128((__m128i *)out, a);
+               _mm_store_si128((__m128i *)(out + 16), b);
+               _mm_store_si128((__m128i *)(out + 32), c);
+               _mm_store_si128((__m128i *)(out + 48), d);
+          }
+          for (; left >= 16; left -= 16, in += 16, out += 16)
+          {
+               _mm_store_si128((__m128i *)out, _mm_loadu_si128((const __m128i *)in));
+          }
+          _mm_storeu_si128((__m128i *)(outEnd - 16), tail);
+     }
+
+     void memFill32Sse2(void *dst, Uint32 value, size_t count)
+     {
+          Uint32 *out = (Uint32 *)dst;
+          // Aligning needs whole words; other alignments take the plain loop
+          if (count < 8 || ((uintptr_t)out & 3) != 0)
+          {
+               memFill32Libc(out, value, count);
+               return;
+          }
+          const __m128i v = _mm_set1_epi32((int)value);
+          Uint32 *const end = out + count;
+          _mm_storeu_si128((__m128i *)out, v);
+          out += (16 - ((uintptr_t)out & 15)) / 4;
+          size_t left = (size_t)(end - out);
+          if (count * 4 >= MEM_STREAMING_BYTES)
+          {
+               for (; left >= 16; left -= 16, out += 16)
+               {
+                    _mm_stream_si128((__m128i *)out, v);
+                    _mm_stream_si128((__m128i *)(out + 4), v);
+                    _mm_stream_si128((__m128i *)(out + 8), v);
+                    _mm_stream_si128((__m128i *)(out + 12), v);
+               }
+               _mm_sfence();
+          }
+          for (; left >= 4; left -= 4, out += 4)
+          {
+               _mm_store_si128((__m128i *)out, v);
+          }
+          _mm_storeu_si128((__m128i *)(end - 4), v);
+     }
+
+     size_t memLengthSse2(const char *text)
+     {
+          const uintptr_t offset = (uintptr_t)text & 15;
+          const __m128i *block = (const __m128i *)(text - offset);
+          const __m128i zero = _mm_setzero_si128();
+          unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(block), zero)) >> offset;
+          if (mask != 0)
+          {
+               return (size_t)__builtin_ctz(mask);
+          }
+          for (;;)
+          {
+               block++;
+               mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(block), zero));
+               if (mask != 0)
+               {
+                    return (size_t)((const char *)block - text) + __builtin_ctz(mask);
+               }
+          }
+     }
+
+     const MemKernelTable MEM_SSE2_TABLE = {memCopySse2, memFill32Sse2, memLengthSse2};
+#endif
+
+#ifdef MEM_KERNELS_AVX
+     // --- AVX2: 32 bytes per store, 128 per loop ---
+
+     __attribute__((target("avx2"))) void memCopyAvx2(void *dst, const void *src, size_t bytes)
+     {
+          if (bytes < 64)
+          {
+               memCopySse2(dst, src, bytes);
+               return;
+          }
+          Uint8 *out = (Uint8 *)dst;
+          const Uint8 *in = (const Uint8 *)src;
+          const __m256i head = _mm256_loadu_si256((const __m256i *)in);
+          const __m256i tail = _mm256_loadu_si256((const __m256i *)(in + bytes - 32));
+          Uint8 *const outEnd = out + bytes;
+          const size_t skew = 32 - ((uintptr_t)out & 31);
+          _mm256_storeu_si256((__m256i *)out, head);
+          in += skew;
+          out += skew;
+          size_t left = bytes - skew;
+          if (bytes >= MEM_STREAMING_BYTES)
+          {
+               for (; left >= 128; left -= 128, in += 128, out += 128)
+               {
+                    const __m256i a = _mm256_loadu_si256((const __m256i *)in);
+                    const __m256i b = _mm256_loadu_si256((const __m256i *)(in + 32));
+                    const __m256i c = _mm256_loadu_si256((const __m256i *)(in + 64));
+                    const __m256i d = _mm256_loadu_si256((const __m256i *)(in + 96));
+                    _mm256_stream_si256((__m256i *)out, a);
+                    _mm256_stream_si256((__m256i *)(out + 32), b);
+                    _mm256_stream_si256((__m256i *)(out + 64), c);
+                    _mm256_stream_si256((__m256i *)(out + 96), d);
+               }
+               _mm_sfence();
+          }
+          for (; left >= 128; left -= 128, in += 128, out += 128)
+          {
+               const __m256i a = _mm256_loadu_si256((const __m256i *)in);
+               const __m256i b = _mm256_loadu_si256((const __m256i *)(in + 32));
+               const __m256i c = _mm256_loadu_si256((const __m256i *)(in + 64));
+               const __m256i d = _mm256_loadu_si256((const __m256i *)(in + 96));
+               _mm256_store_si256((__m256i *)out, a);
+               _mm256_store_si256((__m256i *)(out + 32), b);
+               _mm256_store_si256((__m256i *)(out + 64), c);
+               _mm256_store_si256((__m256i *)(out + 96), d);
+          }
+          for (; left >= 32; left -= 32, in += 32, out += 32)
+          {
+               _mm256_store_si256((__m256i *)out, _mm256_loadu_si256((const __m256i *)in));
+          }
+          _mm256_storeu_si256((__m256i *)(outEnd - 32), tail);
+     }
+
+     __attribute__((target("avx2"))) void memFill32Avx2(void *dst, Uint32 value, size_t count)
+     {
+          Uint32 *out = (Uint32 *)dst;
+          if (count < 16 || ((uintptr_t)out & 3) != 0)
+          {
+               memFill32Sse2(out, value, count);
+               return;
+          }
+          const __m256i v = _mm256_set1_epi32((int)value);
+          Uint32 *const end = out + count;
+          _mm256_storeu_si256((__m256i *)out, v);
+          out += (32 - ((uintptr_t)out & 31)) / 4;
+          size_t left = (size_t)(end - out);
+          if (count * 4 >= MEM_STREAMING_BYTES)
+          {
+               for (; left >= 32; left -= 32, out += 32)
+               {
+                    _mm256_stream_si256((__m256i *)out, v);
+                    _mm256_stream_si256((__m256i *)(out + 8), v);
+                    _mm256_stream_si256((__m256i *)(out + 16), v);
+                    _mm256_stream_si256((__m256i *)(out + 24), v);
+               }
+               _mm_sfence();
+          }
+          for (; left >= 8; left -= 8, out += 8)
+          {
+               _mm256_store_si256((__m256i *)out, v);
+          }
+          _mm256_storeu_si256((__m256i *)(end - 8), v);
+     }
+
+     __attribute__((target("avx2"))) size_t memLengthAvx2(const char *text)
+     {
+          const uintptr_t offset = (uintptr_t)text & 31;
+          const __m256i *block = (const __m256i *)(text - offset);
+          const __m256i zero = _mm256_setzero_si256();
+          unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256(block), zero)) >> offset;
+          if (mask != 0)
+          {
+               return (size_t)__builtin_ctz(mask);
+          }
+          for (;;)
+          {
+               block++;
+               mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256(block), zero));
+               if (mask != 0)
+               {
+                    return (size_t)((const char *)block - text) + __builtin_ctz(mask);
+               }
+          }
+     }
+
+     const MemKernelTable MEM_AVX2_TABLE = {memCopyAvx2, memFill32Avx2, memLengthAvx2};
+#endif
+
+#ifdef MEM_KERNELS_NEON
+     // --- NEON: 64 bytes per loop; AArch64 has no streaming store intrinsic,
+     // and its memcpy already uses non-temporal pairs for large copies ---
+
+     void memCopyNeon(void *dst, const void *src, size_t bytes)
+     {
+          if (bytes >= MEM_STREAMING_BYTES || bytes < 64)
+          {
+               std::memcpy(dst, src, bytes);
+               return;
+          }
+          Uint8 *out = (Uint8 *)dst;
+          const Uint8 *in = (const Uint8 *)src;
+          const uint8x16_t tail = vld1q_u8(in + bytes - 16);
+          Uint8 *const outEnd = out + bytes;
+          size_t left = bytes;
+          for (; left >= 64; left -= 64, in += 64, out += 64)
+          {
+               vst1q_u8_x4(out, vld1q_u8_x4(in));
+          }
+          for (; left >= 16; left -= 16, in += 16, out += 16)
+          {
+               vst1q_u8(out, vld1q_u8(in));
+          }
+          vst1q_u8(outEnd - 16, tail);
+     }
+
+     void memFill32Neon(void *dst, Uint32 value, size_t count)
+     {
+          Uint32 *out = (Uint32 *)dst;
+          const uint32x4_t v = vdupq_n_u32(value);
+          size_t i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               vst1q_u32(out + i, v);
+          }
+          memFill32Libc(out + i, value, count - i);
+     }
+
+     size_t memLengthNeon(const char *text)
+     {
+          // Scalar up to the first 16-byte boundary, then whole blocks
+          const char *p = text;
+          for (; ((uintptr_t)p & 15) != 0; p++)
+          {
+               if (*p == '\0')
+               {
+                    return (size_t)(p - text);
+               }
+          }
+          for (;; p += 16)
+          {
+               if (vmaxvq_u8(vceqzq_u8(vld1q_u8((const Uint8 *)p))) != 0)
+               {
+                    break;
+               }
+          }
+          while (*p != '\0')
+          {
+               p++;
+          }
+          return (size_t)(p - text);
+     }
+
+     const MemKernelTable MEM_NEON_TABLE = {memCopyNeon, memFill32Neon, memLengthNeon};
+#endif
+
+     MemKernel activeMemKernel = MEM_KERNEL_AUTO;
+     const MemKernelTable *activeMemTable = &MEM_LIBC_TABLE;
+}
+
+bool memKernelSupported(MemKernel kernel)
+{
+     switch (kernel)
+     {
+     case MEM_KERNEL_AUTO:
+     case MEM_KERNEL_LIBC:
+          return true;
+#ifdef MEM_KERNELS_X86
+     case MEM_KERNEL_SSE2:
+          return cpuHasSse2();
+#endif
+#ifdef MEM_KERNELS_AVX
+     case MEM_KERNEL_AVX2:
+          return SDL_HasAVX2() == SDL_TRUE;
+#endif
+#ifdef MEM_KERNELS_NEON
+     case MEM_KERNEL_NEON:
+          return SDL_HasNEON() == SDL_TRUE;
+#endif
+     default:
+          return false;
+     }
+}
+
+const char *memKernelName(MemKernel kernel)
+{
+     switch (kernel)
+     {
+     case MEM_KERNEL_LIBC:
+          return "libc";
+     case MEM_KERNEL_SSE2:
+          return "sse2";
+     case MEM_KERNEL_AVX2:
+          return "avx2";
+     case MEM_KERNEL_NEON:
+          return "neon";
+     default:
+          return "auto";
+     }
+}
+
+MemKernel memSetKernel(MemKernel kernel)
+{
+     if (kernel == MEM_KERNEL_AUTO)
+     {
+          const MemKernel preferred[] = {MEM_KERNEL_AVX2, MEM_KERNEL_NEON, MEM_KERNEL_SSE2};
+          kernel = MEM_KERNEL_LIBC;
+          for (MemKernel candidate : preferred)
+          {
+               if (memKernelSupported(candidate))
+               {
+                    kernel = candidate;
+                    break;
+               }
+          }
+     }
+     else if (!memKernelSupported(kernel))
+     {
+          kernel = MEM_KERNEL_LIBC;
+     }
+
+     activeMemKernel = kernel;
+     activeMemTable = &MEM_LIBC_TABLE;
+#ifdef MEM_KERNELS_X86
+     if (kernel == MEM_KERNEL_SSE2)
+     {
+          activeMemTable = &MEM_SSE2_TABLE;
+     }
+#endif
+#ifdef MEM_KERNELS_AVX
+     if (kernel == MEM_KERNEL_AVX2)
+     {
+          activeMemTable = &MEM_AVX2_TABLE;
+     }
+#endif
+#ifdef MEM_KERNELS_NEON
+     if (kernel == MEM_KERNEL_NEON)
+     {
+          activeMemTable = &MEM_NEON_TABLE;
+     }
+#endif
+     return kernel;
+}
+
+const MemKernelTable &memKernels()
+{
+     if (activeMemKernel == MEM_KERNEL_AUTO)
+     {
+          memSetKernel(MEM_KERNEL_AUTO);
+     }
+     return *activeMemTable;
+}
@@ -0,0 +1,55 @@
+// Description:
+// Runtime-dispatched memory kernels: copy, 32-bit fill (SDL_memset4's
+// job) and string length. SDL_memcpy and SDL_memset4 forward to the C
+// library or an inline loop depending on how SDL was built, so their speed
+// on large buffers varies with the toolchain. These have libc, SSE2, AVX2
+// and NEON versions, picked like blit_kernels.h's: the fastest one this
+// CPU supports on first use, or memSetKernel() for benchmarks.
+//
+// Copies and fills of MEM_STREAMING_BYTES or more use non-temporal stores
+// on x86, writing around the cache: a 4 MB surface upload then no longer
+// evicts the data the next stage was about to read, and the stores skip
+// the read-for-ownership of each destination line. Smaller ones stay in
+// the cache, where the next reader wants them.
+//
+// Buffers may not overlap. The SIMD string lengths read whole aligned
+// blocks, which never cross a page, so they may read (but never use)
+// bytes just before and after the string; memory checkers flag that.
+// =============================================================================
+
+#ifndef MEM_KERNELS_H
+#define MEM_KERNELS_H
+
+#include <SDL2/SDL.h>
+
+enum MemKernel
+{
+     MEM_KERNEL_AUTO,
+     MEM_KERNEL_LIBC,
+     MEM_KERNEL_SSE2,
+     MEM_KERNEL_AVX2,
+     MEM_KERNEL_NEON
+};
+
+// Above this, copies and fills bypass the cache; about half a typical L2
+// plus L3 slice, so what fits in cache stays there
+const size_t MEM_STREAMING_BYTES = 1024 * 1024;
+
+struct MemKernelTable
+{
+     void (*copy)(void *dst, const void *src, size_t bytes);
+     void (*fill32)(void *dst, Uint32 value, size_t count); // `count` 32-bit words
+     size_t (*length)(const char *text);
+};
+
+bool memKernelSupported(MemKernel kernel);
+const char *memKernelName(MemKernel kernel);
+
+// Force a kernel; unsupported ones fall back to libc. Returns the kernel
+// now in use.
+MemKernel memSetKernel(MemKernel kernel);
+
+// The kernels in use
+const MemKernelTable &memKernels();
+
+#endif // MEM_KERNELS_H
@@ -0,0 +1,553 @@
+#include "memory_tags.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "atomic_ops.h"
+
+// Emscripten's SDL2 port has no SDL2_test, so the web build keeps site
+// tracking without the leak tracker
+#if !defined(__EMSCRIPTEN__)
+#define MEMORY_TAGS_LEAK_TRACKER 1
+#include <SDL2/SDL_test_memory.h>
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__GLIBC__)
+#include <execinfo.h>
+#endif
+
+namespace
+{
+     const Uint32 BLOCK_MAGIC = 0x4D544147; // "MTAG"
+     const size_t BLOCK_HEADER_BYTES = 16; // Keeps the caller's block 16-byte aligned
+
+     struct BlockHeader
+     {
+          size_t size;
+          Uint32 tag;
+          Uint32 magic;
+     };
+     static_assert(sizeof(BlockHeader) <= BLOCK_HEADER_BYTES, "Block header must fit its slot");
+
+     struct TagState
+     {
+          Atomic64 bytes;
+          Atomic64 peakBytes;
+          Atomic64 budget;
+          SDL_atomic_t allocations;
+          SDL_atomic_t failures;
+          MemoryTagAllocator allocator;
+          bool custom;
+     };
+
+     // Allocation sites: the callers' stack under SDL_malloc, hashed into
+     // a fixed table so recording never allocates. The hooks pass their own
+     // return address, which lies in SDL_malloc (or calloc/realloc), and the
+     // site starts at the frame after it, however many frames the hooks and
+     // SDL put in between.
+     const int SITE_SEARCH = 8; // Frames searched for the hook's return address
+     const int SITE_TABLE = 1024;
+
+     struct Site
+     {
+          Uint32 hash; // 0 for an empty slot
+          void *frames[MEMORY_SITE_DEPTH];
+          int depth;
+          Sint64 count;
+          Sint64 bytes;
+          Sint64 sizes[MEMORY_SIZE_BUCKETS];
+     };
+
+     TagState tags[MEMORY_TAG_COUNT];
+     thread_local MemoryTag currentTag = MEMORY_TAG_GENERAL;
+     bool installed = false;
+     bool tracking = false;
+
+     // Across every tag
+     Atomic64 totalBytes;
+     Atomic64 totalPeakBytes;
+     SDL_atomic_t frameAllocations;
+     Atomic64 frameBytes;
+     int framesEnded = 0;
+
+     bool trackingSites = false;
+     Uint64 sitesSince = 0;
+     SDL_SpinLock siteLock = 0;
+     Site sites[SITE_TABLE];
+     int sitesDropped = 0;
+
+     SDL_malloc_func originalMalloc;
+     SDL_calloc_func originalCalloc;
+     SDL_realloc_func originalRealloc;
+     SDL_free_func originalFree;
+
+     BlockHeader *headerOf(void *memory)
+     {
+          return (BlockHeader *)((Uint8 *)memory - BLOCK_HEADER_BYTES);
+     }
+
+     void updatePeak(Atomic64 &peakBytes, Sint64 bytes)
+     {
+          Sint64 peak = atomic64Load(&peakBytes, ATOMIC_ORDER_RELAXED);
+          while (bytes > peak && !atomic64CAS(&peakBytes, peak, bytes, ATOMIC_ORDER_RELAXED))
+          {
+          }
+     }
+
+     // Charge `size` bytes to the tag, refusing what the budget does not allow
+     bool reserve(TagState &state, size_t size)
+     {
+          const Sint64 delta = (Sint64)size;
+          const Sint64 bytes = atomic64FetchAdd(&state.bytes, delta) + delta;
+          const Sint64 budget = atomic64Load(&state.budget, ATOMIC_ORDER_RELAXED);
+          if ((budget > 0 && bytes > budget) || bytes < 0)
+          {
+               atomic64FetchAdd(&state.bytes, -delta);
+               SDL_AtomicIncRef(&state.failures);
+               return false;
+          }
+          updatePeak(state.peakBytes, bytes);
+          updatePeak(totalPeakBytes, atomic64FetchAdd(&totalBytes, delta) + delta);
+          SDL_AtomicIncRef(&frameAllocations);
+          atomic64FetchAdd(&frameBytes, delta, ATOMIC_ORDER_RELAXED);
+          return true;
+     }
+
+     void unreserve(TagState &state, size_t size)
+     {
+          atomic64FetchAdd(&state.bytes, -(Sint64)size);
+          atomic64FetchAdd(&totalBytes, -(Sint64)size);
+     }
+
+     int sizeBucket(size_t size)
+     {
+          int bucket = 0;
+          while (bucket < MEMORY_SIZE_BUCKETS - 1 && ((size_t)1 << bucket) < size)
+          {
+               bucket++;
+          }
+          return bucket;
+     }
+
+     int captureSite(void **frames, void *sdlFrame)
+     {
+#if defined(_WIN32) || defined(__GLIBC__)
+          void *stack[SITE_SEARCH + MEMORY_SITE_DEPTH];
+#if defined(_WIN32)
+          const int captured = (int)CaptureStackBackTrace(0, SITE_SEARCH + MEMORY_SITE_DEPTH, stack, NULL);
+#else
+          const int captured = backtrace(stack, SITE_SEARCH + MEMORY_SITE_DEPTH);
+#endif
+          int start = 0;
+          while (start < SDL_min(captured, SITE_SEARCH) && stack[start] != sdlFrame)
+          {
+               start++;
+          }
+          // Not found (the hook was tail-called): keep the whole capture
+          start = start < SDL_min(captured, SITE_SEARCH) ? start + 1 : 0;
+          const int depth = SDL_min(captured - start, MEMORY_SITE_DEPTH);
+          SDL_memcpy(frames, stack + start, depth * sizeof(void *));
+          return depth;
+#else
+          frames[0] = sdlFrame;
+          return 1;
+#endif
+     }
+
+     void recordSite(size_t size, void *sdlFrame)
+     {
+          void *frames[MEMORY_SITE_DEPTH];
+          const int depth = captureSite(frames, sdlFrame);
+          Uint32 hash = 2166136261u;
+          for (int i = 0; i < depth; i++)
+          {
+               hash = (hash ^ (Uint32)(uintptr_t)frames[i]) * 16777619u;
+          }
+          hash |= 1;
+
+          SDL_AtomicLock(&siteLock);
+          for (int probe = 0; probe < SITE_TABLE; probe++)
+          {
+               Site &site = sites[(hash + probe) & (SITE_TABLE - 1)];
+               if (site.hash == 0)
+               {
+                    site.hash = hash;
+                    site.depth = depth;
+                    SDL_memcpy(site.frames, frames, depth * sizeof(void *));
+               }
+               else if (site.hash != hash || site.depth != depth ||
+                        SDL_memcmp(site.frames, frames, depth * sizeof(void *)) != 0)
+               {
+                    continue;
+               }
+               site.count++;
+               site.bytes += size;
+               site.sizes[sizeBucket(size)]++;
+               SDL_AtomicUnlock(&siteLock);
+               return;
+          }
+          sitesDropped++;
+          SDL_AtomicUnlock(&siteLock);
+     }
+
+     void *allocateBlock(const TagState &state, size_t bytes)
+     {
+          return state.custom ? state.allocator.allocate(state.allocator.userdata, bytes) : originalMalloc(bytes);
+     }
+
+     void releaseBlock(const TagState &state, void *block, size_t bytes)
+     {
+          if (state.custom)
+          {
+               state.allocator.release(state.allocator.userdata, block, bytes);
+          }
+          else
+          {
+               originalFree(block);
+          }
+     }
+
+     void *allocateTagged(size_t size, void *sdlFrame)
+     {
+          const MemoryTag tag = currentTag;
+          TagState &state = tags[tag];
+          if (size > SDL_SIZE_MAX - BLOCK_HEADER_BYTES || !reserve(state, size))
+          {
+               return nullptr;
+          }
+          BlockHeader *header = (BlockHeader *)allocateBlock(state, size + BLOCK_HEADER_BYTES);
+          if (header == nullptr)
+          {
+               unreserve(state, size);
+               SDL_AtomicIncRef(&state.failures);
+               return nullptr;
+          }
+          header->size = size;
+          header->tag = (Uint32)tag;
+          header->magic = BLOCK_MAGIC;
+          SDL_AtomicIncRef(&state.allocations);
+          if (trackingSites)
+          {
+               recordSite(size, sdlFrame);
+          }
+          return (Uint8 *)header + BLOCK_HEADER_BYTES;
+     }
+
+     // The hooks are kept out of line so their return address is in SDL
+     __attribute__((noinline)) void *taggedMalloc(size_t size)
+     {
+          return allocateTagged(size, __builtin_return_address(0));
+     }
+
+     __attribute__((noinline)) void *taggedCalloc(size_t count, size_t size)
+     {
+          if (size != 0 && count > SDL_SIZE_MAX / size)
+          {
+               return nullptr;
+          }
+          void *memory = allocateTagged(count * size, __builtin_return_address(0));
+          if (memory != nullptr)
+          {
+               SDL_memset(memory, 0, count * size);
+          }
+          return memory;
+     }
+
+     void taggedFree(void *memory)
+     {
+          if (memory == nullptr)
+          {
+               return;
+          }
+          BlockHeader *header = headerOf(memory);
+          SDL_assert(header->magic == BLOCK_MAGIC);
+          TagState &state = tags[header->tag];
+          const size_t size = header->size;
+          header->magic = 0;
+          unreserve(state, size);
+          SDL_AtomicAdd(&state.allocations, -1);
+          releaseBlock(state, header, size + BLOCK_HEADER_BYTES);
+     }
+
+     __attribute__((noinline)) void *taggedRealloc(void *memory, size_t size)
+     {
+          if (memory == nullptr)
+          {
+               return allocateTagged(size, __builtin_return_address(0));
+          }
+          BlockHeader *header = headerOf(memory);
+          SDL_assert(header->magic == BLOCK_MAGIC);
+          // The block keeps the tag it was allocated under
+          TagState &state = tags[header->tag];
+          const size_t oldSize = header->size;
+          if (size > SDL_SIZE_MAX - BLOCK_HEADER_BYTES)
+          {
+               return nullptr;
+          }
+          if (size > oldSize && !reserve(state, size - oldSize))
+          {
+               return nullptr;
+          }
+          if (trackingSites)
+          {
+               recordSite(size, __builtin_return_address(0));
+          }
+
+          if (!state.custom)
+          {
+               BlockHeader *moved = (BlockHeader *)originalRealloc(header, size + BLOCK_HEADER_BYTES);
+               if (moved == nullptr)
+               {
+                    if (size > oldSize)
+                    {
+                         unreserve(state, size - oldSize);
+                    }
+                    SDL_AtomicIncRef(&state.failures);
+                    return nullptr;
+               }
+               if (size < oldSize)
+               {
+                    unreserve(state, oldSize - size);
+               }
+               moved->size = size;
+               return (Uint8 *)moved + BLOCK_HEADER_BYTES;
+          }
+
+          // Arenas and pools have no realloc: copy into a new block
+          BlockHeader *moved = (BlockHeader *)state.allocator.allocate(state.allocator.userdata, size + BLOCK_HEADER_BYTES);
+          if (moved == nullptr)
+          {
+               if (size > oldSize)
+               {
+                    unreserve(state, size - oldSize);
+               }
+               SDL_AtomicIncRef(&state.failures);
+               return nullptr;
+          }
+          SDL_memcpy(moved, header, BLOCK_HEADER_BYTES + SDL_min(size, oldSize));
+          moved->size = size;
+          header->magic = 0;
+          state.allocator.release(state.allocator.userdata, header, oldSize + BLOCK_HEADER_BYTES);
+          if (size < oldSize)
+          {
+               unreserve(state, oldSize - size);
+          }
+          return (Uint8 *)moved + BLOCK_HEADER_BYTES;
+     }
+}
+
+bool memoryTagsInstall()
+{
+     if (installed)
+     {
+          return true;
+     }
+     if (SDL_GetNumAllocations() > 0)
+     {
+          SDL_SetError("Memory tags must be installed before SDL allocates");
+          return false;
+     }
+     SDL_GetOriginalMemoryFunctions(&originalMalloc, &originalCalloc, &originalRealloc, &originalFree);
+     if (SDL_SetMemoryFunctions(taggedMalloc, taggedCalloc, taggedRealloc, taggedFree) != 0)
+     {
+          return false;
+     }
+     installed = true;
+
+     // SDL_test_memory wraps whatever functions are current, so it sits on
+     // top of the tags and sees every caller
+     if (SDL_GetHintBoolean(MEMORY_TRACK_HINT, SDL_FALSE))
+     {
+#ifdef MEMORY_TAGS_LEAK_TRACKER
+          tracking = SDLTest_TrackAllocations() == 0;
+#endif
+          memoryTagsTrackSites(true);
+     }
+     return true;
+}
+
+const char *memoryTagName(MemoryTag tag)
+{
+     switch (tag)
+     {
+     case MEMORY_TAG_GENERAL:
+          return "general";
+     case MEMORY_TAG_VIDEO:
+          return "video";
+     case MEMORY_TAG_AUDIO:
+          return "audio";
+     case MEMORY_TAG_RENDER:
+          return "render";
+     case MEMORY_TAG_IMAGE:
+          return "image";
+     case MEMORY_TAG_TTF:
+          return "ttf";
+     case MEMORY_TAG_MIXER:
+          return "mixer";
+     default:
+          return "unknown";
+     }
+}
+
+MemoryTag memoryTagCurrent()
+{
+     return currentTag;
+}
+
+MemoryTag memoryTagSet(MemoryTag tag)
+{
+     const MemoryTag previous = currentTag;
+     currentTag = tag >= 0 && tag < MEMORY_TAG_COUNT ? tag : MEMORY_TAG_GENERAL;
+     return previous;
+}
+
+bool memoryTagSetAllocator(MemoryTag tag, const MemoryTagAllocator *allocator)
+{
+     if (tag < 0 || tag >= MEMORY_TAG_COUNT || SDL_AtomicGet(&tags[tag].allocations) != 0)
+     {
+          SDL_SetError("Tag %s still has live allocations", memoryTagName(tag));
+          return false;
+     }
+     tags[tag].custom = allocator != nullptr;
+     if (allocator != nullptr)
+     {
+          tags[tag].allocator = *allocator;
+     }
+     return true;
+}
+
+void memoryTagSetBudget(MemoryTag tag, size_t bytes)
+{
+     if (tag >= 0 && tag < MEMORY_TAG_COUNT)
+     {
+          atomic64Store(&tags[tag].budget, (Sint64)SDL_min(bytes, (size_t)SDL_MAX_SINT64));
+     }
+}
+
+MemoryTagStats memoryTagGetStats(MemoryTag tag)
+{
+     MemoryTagStats stats = {0, 0, 0, 0, 0};
+     if (tag >= 0 && tag < MEMORY_TAG_COUNT)
+     {
+          TagState &state = tags[tag];
+          stats.bytes = (size_t)atomic64Load(&state.bytes);
+          stats.peakBytes = (size_t)atomic64Load(&state.peakBytes);
+          stats.budget = (size_t)atomic64Load(&state.budget);
+          stats.allocations = SDL_AtomicGet(&state.allocations);
+          stats.failures = SDL_AtomicGet(&state.failures);
+     }
+     return stats;
+}
+
+void memoryTagResetPeak(MemoryTag tag)
+{
+     if (tag >= 0 && tag < MEMORY_TAG_COUNT)
+     {
+          TagState &state = tags[tag];
+          atomic64Store(&state.peakBytes, atomic64Load(&state.bytes));
+     }
+}
+
+void memoryTagsReport()
+{
+     if (!installed)
+     {
+          return;
+     }
+     SDL_Log("%-8s %12s %12s %12s %8s %8s", "tag", "live KB", "peak KB", "budget KB", "blocks", "failed");
+     for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++)
+     {
+          const MemoryTagStats stats = memoryTagGetStats((MemoryTag)tag);
+          SDL_Log("%-8s %12.1f %12.1f %12.1f %8d %8d", memoryTagName((MemoryTag)tag), stats.bytes / 1024.0,
+                  stats.peakBytes / 1024.0, stats.budget / 1024.0, stats.allocations, stats.failures);
+     }
+     SDL_Log("all tags: live %.1f KB, peak %.1f KB", atomic64Load(&totalBytes) / 1024.0,
+             atomic64Load(&totalPeakBytes) / 1024.0);
+
+     std::vector<MemorySiteStats> top;
+     memoryTagsTopSites(top, 20);
+     const double seconds = trackingSites ? (double)(SDL_GetPerformanceCounter() - sitesSince) / SDL_GetPerformanceFrequency() : 0.0;
+     for (const MemorySiteStats &site : top)
+     {
+          // Sizes as a run of counts from the 1-byte bucket up; resolve the
+          // frames with addr2line
+          char sizes[MEMORY_SIZE_BUCKETS * 8] = "";
+          for (int bucket = 0; bucket < MEMORY_SIZE_BUCKETS; bucket++)
+          {
+               SDL_snprintf(sizes + SDL_strlen(sizes), sizeof(sizes) - SDL_strlen(sizes), " %" SDL_PRIs64, site.sizes[bucket]);
+          }
+          char frames[MEMORY_SITE_DEPTH * 20] = "";
+          for (int i = 0; i < site.depth; i++)
+          {
+               SDL_snprintf(frames + SDL_strlen(frames), sizeof(frames) - SDL_strlen(frames), " %p", site.frames[i]);
+          }
+          SDL_Log("site%s: %" SDL_PRIs64 " allocs (%.1f/s, %.2f/frame), %.1f KB, sizes 2^n:%s", frames, site.count,
+                  seconds > 0.0 ? site.count / seconds : 0.0, framesEnded > 0 ? (double)site.count / framesEnded : 0.0,
+                  site.bytes / 1024.0, sizes);
+     }
+     if (sitesDropped > 0)
+     {
+          SDL_Log("%d allocations from untracked sites (table full)", sitesDropped);
+     }
+#ifdef MEMORY_TAGS_LEAK_TRACKER
+     if (tracking)
+     {
+          SDLTest_LogAllocations();
+     }
+#endif
+}
+
+void memoryTagsTrackSites(bool enabled)
+{
+     SDL_AtomicLock(&siteLock);
+     if (enabled && !trackingSites)
+     {
+          SDL_memset(sites, 0, sizeof(sites));
+          sitesDropped = 0;
+          sitesSince = SDL_GetPerformanceCounter();
+     }
+     trackingSites = enabled;
+     SDL_AtomicUnlock(&siteLock);
+}
+
+void memoryTagsTopSites(std::vector<MemorySiteStats> &out, int maxSites)
+{
+     out.clear();
+     SDL_AtomicLock(&siteLock);
+     for (const Site &site : sites)
+     {
+          if (site.hash != 0)
+          {
+               MemorySiteStats stats;
+               SDL_memcpy(stats.frames, site.frames, sizeof(stats.frames));
+               stats.depth = site.depth;
+               stats.count = site.count;
+               stats.bytes = site.bytes;
+               SDL_memcpy(stats.sizes, site.sizes, sizeof(stats.sizes));
+               out.push_back(stats);
+          }
+     }
+     SDL_AtomicUnlock(&siteLock);
+     std::sort(out.begin(), out.end(), [](const MemorySiteStats &a, const MemorySiteStats &b) { return a.count > b.count; });
+     if ((int)out.size() > maxSites)
+     {
+          out.resize(maxSites);
+     }
+}
+
+MemoryFrameStats memoryTagsEndFrame()
+{
+     MemoryFrameStats frame;
+     frame.allocations = SDL_AtomicSet(&frameAllocations, 0);
+     frame.bytes = (size_t)atomic64Exchange(&frameBytes, 0);
+     framesEnded++;
+     return frame;
+}
+
+size_t memoryTagsPeakBytes()
+{
+     return (size_t)atomic64Load(&totalPeakBytes);
+}
@@ -0,0 +1,142 @@
+// Description:
+// Per-subsystem accounting for everything allocated through SDL_malloc.
+// SDL_SetMemoryFunctions swaps one global allocator; this installs hooks
+// that charge each allocation to the tag the calling thread is in (video,
+// audio, render, image, ttf, mixer), so usage can be tracked, budgeted
+// and routed per subsystem. SDL_image, SDL_ttf and SDL_mixer allocate
+// through SDL_malloc too, so their decoders are covered.
+//
+// Tags are entered with a scope around the calls that allocate:
+//     {
+//          MemoryTagScope tag(MEMORY_TAG_IMAGE);
+//          surface = IMG_Load_RW(rw, 1);
+//     }
+// Each block carries its tag and size in a 16-byte header, so it is
+// freed from (and charged to) the tag that allocated it, whatever tag
+// the freeing thread is in. A tag's allocations go to SDL's original
+// allocator unless memoryTagSetAllocator() routes them to an arena or
+// pool of the caller's. With a budget set, allocations that would take
+// a tag over it fail as out of memory.
+//
+// For hunting hot-path allocations, memoryTagsEndFrame() gives the
+// allocations made since the last frame (main feeds them to the
+// profiler), and site tracking charges each allocation to its call
+// stack, counted per size class, so the report shows which callers
+// allocate how often.
+//
+// memoryTagsInstall() must run before anything calls SDL_malloc (first
+// thing in main), since blocks from the old allocator have no header.
+// With MEMORY_TRACK_HINT set it also turns on site tracking and
+// SDL_test_memory's leak tracker on top of the hooks; memoryTagsReport()
+// then lists every block still allocated.
+// =============================================================================
+
+#ifndef MEMORY_TAGS_H
+#define MEMORY_TAGS_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#define MEMORY_TRACK_HINT "CATCH_TRACK_ALLOCATIONS"
+
+const int MEMORY_SITE_DEPTH = 5;    // Stack frames that identify a call site
+const int MEMORY_SIZE_BUCKETS = 16; // Allocation sizes by power of two, 1 B to 32 KB and up
+
+enum MemoryTag
+{
+     MEMORY_TAG_GENERAL, // Anything outside a tag scope
+     MEMORY_TAG_VIDEO,
+     MEMORY_TAG_AUDIO,
+     MEMORY_TAG_RENDER,
+     MEMORY_TAG_IMAGE,
+     MEMORY_TAG_TTF,
+     MEMORY_TAG_MIXER,
+     MEMORY_TAG_COUNT
+};
+
+// Where a tag's blocks come from. `release` gets the size given to
+// `allocate`. Both may be called from any thread.
+struct MemoryTagAllocator
+{
+     void *(*allocate)(void *userdata, size_t size);
+     void (*release)(void *userdata, void *memory, size_t size);
+     void *userdata;
+};
+
+struct MemoryTagStats
+{
+     size_t bytes;     // Live, as requested by callers
+     size_t peakBytes;
+     size_t budget;    // 0 for none
+     int allocations;  // Live blocks
+     int failures;     // Refused by the budget or the allocator
+};
+
+struct MemorySiteStats
+{
+     void *frames[MEMORY_SITE_DEPTH]; // Return addresses, innermost first
+     int depth;
+     Sint64 count;
+     Sint64 bytes;
+     Sint64 sizes[MEMORY_SIZE_BUCKETS]; // Allocations per size bucket
+};
+
+struct MemoryFrameStats
+{
+     int allocations; // Including reallocs that grew
+     size_t bytes;
+};
+
+// Replace SDL's memory functions. False if SDL has already allocated.
+bool memoryTagsInstall();
+
+const char *memoryTagName(MemoryTag tag);
+
+// The calling thread's tag; MemoryTagScope is the usual way to set it
+MemoryTag memoryTagCurrent();
+MemoryTag memoryTagSet(MemoryTag tag); // Returns the previous tag
+
+// Route `tag` to `allocator`, or back to SDL's original with nullptr.
+// Only while the tag has no live blocks; false otherwise.
+bool memoryTagSetAllocator(MemoryTag tag, const MemoryTagAllocator *allocator);
+
+// Cap live bytes for `tag`, 0 for no cap
+void memoryTagSetBudget(MemoryTag tag, size_t bytes);
+
+MemoryTagStats memoryTagGetStats(MemoryTag tag);
+
+// Restart `tag`'s peak from its live bytes, to find one call's high-water mark
+void memoryTagResetPeak(MemoryTag tag);
+
+// Peak live bytes across all tags
+size_t memoryTagsPeakBytes();
+
+// Allocations since the previous call; call once per frame
+MemoryFrameStats memoryTagsEndFrame();
+
+// Start (clearing earlier counts) or stop recording call sites. Costs a
+// stack walk per allocation while on.
+void memoryTagsTrackSites(bool enabled);
+
+// The `maxSites` sites with the most allocations, most first
+void memoryTagsTopSites(std::vector<MemorySiteStats> &out, int maxSites);
+
+// Log every tag's usage, the busiest call sites with their rate and
+// sizes, and the tracker's live blocks when it is on
+void memoryTagsReport();
+
+// Tags allocations on this thread for the enclosing block
+struct MemoryTagScope
+{
+     MemoryTag previous;
+
+     explicit MemoryTagScope(MemoryTag tag) : previous(memoryTagSet(tag))
+     {
+     }
+     ~MemoryTagScope()
+     {
+          memoryTagSet(previous);
+     }
+};
+
+#endif // MEMORY_TAGS_H
@@ -0,0 +1,451 @@
+#include "midi_library.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "thread_affinity.h"
+
+namespace
+{
+     const int MIDI_MAX_SOURCE_DEPTH = 8;
+     const size_t MIDI_PAGE_BYTES = 4096;
+
+     std::vector<std::string> midiSplit(const std::string &list, char separator)
+     {
+          std::vector<std::string> parts;
+          std::string part;
+          std::istringstream in(list);
+          while (std::getline(in, part, separator))
+          {
+               if (!part.empty())
+               {
+                    parts.push_back(part);
+               }
+          }
+          return parts;
+     }
+
+     std::string midiDirectoryOf(const std::string &path)
+     {
+          size_t slash = path.find_last_of("/\\");
+          return slash == std::string::npos ? std::string() : path.substr(0, slash);
+     }
+
+     std::string midiJoin(const std::string &dir, const std::string &name)
+     {
+          bool absolute = !name.empty() && (name[0] == '/' || name[0] == '\\' || (name.size() > 1 && name[1] == ':'));
+          if (dir.empty() || absolute)
+          {
+               return name;
+          }
+          return dir + "/" + name;
+     }
+
+     bool midiFileExists(const std::string &path)
+     {
+          std::ifstream file(path.c_str(), std::ios::binary);
+          return file.good();
+     }
+
+     // Find a file the way Timidity does: each `dir`, newest first, as named
+     // and with ".pat" appended
+     std::string midiResolve(const std::vector<std::string> &dirs, const std::string &name, bool patch)
+     {
+          for (size_t i = dirs.size(); i-- > 0;)
+          {
+               std::string path = midiJoin(dirs[i], name);
+               if (midiFileExists(path))
+               {
+                    return path;
+               }
+               if (patch && midiFileExists(path + ".pat"))
+               {
+                    return path + ".pat";
+               }
+          }
+          return std::string();
+     }
+
+     // The patch files a Timidity config names, following `source` lines. Only
+     // the lines that name files are read: `dir`, `source` and the program
+     // lines (a number and a patch) of every bank and drumset.
+     void midiCollectPatches(const std::string &cfgPath, std::vector<std::string> &dirs,
+                             std::vector<std::string> &patches, int depth)
+     {
+          std::ifstream cfg(cfgPath.c_str());
+          if (!cfg || depth > MIDI_MAX_SOURCE_DEPTH)
+          {
+               return;
+          }
+          std::string line;
+          while (std::getline(cfg, line))
+          {
+               line = line.substr(0, line.find('#'));
+               std::istringstream words(line);
+               std::string keyword, argument;
+               if (!(words >> keyword >> argument))
+               {
+                    continue;
+               }
+               if (keyword == "dir")
+               {
+                    dirs.push_back(argument);
+               }
+               else if (keyword == "source")
+               {
+                    std::string path = midiResolve(dirs, argument, false);
+                    midiCollectPatches(path.empty() ? argument : path, dirs, patches, depth + 1);
+               }
+               else if (std::isdigit((unsigned char)keyword[0]))
+               {
+                    std::string path = midiResolve(dirs, argument, true);
+                    if (!path.empty())
+                    {
+                         patches.push_back(path);
+                    }
+               }
+          }
+     }
+
+     // Map the instrument files and read a byte of every page, so they are in
+     // memory before a track's load asks for them. Stops early on quit.
+     void midiWarmInstruments(MidiLibrary &library)
+     {
+          Uint32 start = SDL_GetTicks();
+          std::vector<std::string> files = midiSplit(library.config.soundFonts, ';');
+          if (!library.config.timidityCfg.empty())
+          {
+               std::vector<std::string> dirs(1, midiDirectoryOf(library.config.timidityCfg));
+               midiCollectPatches(library.config.timidityCfg, dirs, files, 0);
+          }
+          std::sort(files.begin(), files.end());
+          files.erase(std::unique(files.begin(), files.end()), files.end());
+
+          for (size_t i = 0; i < files.size(); i++)
+          {
+               SDL_LockMutex(library.lock);
+               bool quitting = library.quitting;
+               SDL_UnlockMutex(library.lock);
+               if (quitting)
+               {
+                    break;
+               }
+
+               MappedFile map;
+               if (!mappedFileOpen(map, files[i].c_str()))
+               {
+                    continue; // SDL_mixer reports the missing instrument itself
+               }
+               volatile Uint8 sink = 0;
+               for (size_t offset = 0; offset < map.size; offset += MIDI_PAGE_BYTES)
+               {
+                    sink = sink + map.base[offset];
+               }
+               library.instruments.push_back(map);
+
+               SDL_LockMutex(library.lock);
+               library.stats.instrumentFiles++;
+               library.stats.instrumentBytes += map.size;
+               SDL_UnlockMutex(library.lock);
+          }
+
+          SDL_LockMutex(library.lock);
+          library.stats.warmMs = SDL_GetTicks() - start;
+          SDL_UnlockMutex(library.lock);
+          SDL_AtomicSet(&library.instrumentsReady, 1);
+     }
+
+     int SDLCALL midiThreadMain(void *data)
+     {
+          MidiLibrary *library = (MidiLibrary *)data;
+          midiWarmInstruments(*library);
+
+          SDL_LockMutex(library->lock);
+          for (;;)
+          {
+               while (library->pending.empty() && !library->quitting)
+               {
+                    SDL_CondWait(library->wake, library->lock);
+               }
+               if (library->quitting)
+               {
+                    break;
+               }
+               MidiTrack *track = library->pending.front();
+               library->pending.pop_front();
+
+               SDL_UnlockMutex(library->lock);
+               Mix_Music *music = Mix_LoadMUS_RW(assetOpen(library->config.pack, track->path), 1);
+               if (music == nullptr)
+               {
+                    std::cerr << "Unable to load MIDI track " << track->path << "! SDL_mixer Error: " << Mix_GetError() << std::endl;
+               }
+               SDL_LockMutex(library->lock);
+
+               track->music = music;
+               track->failed = music == nullptr;
+               library->stats.loads += music != nullptr ? 1 : 0;
+          }
+          SDL_UnlockMutex(library->lock);
+          return 0;
+     }
+
+     MidiTrack *midiFind(MidiLibrary &library, const std::string &name)
+     {
+          for (size_t i = 0; i < library.tracks.size(); i++)
+          {
+               if (library.tracks[i]->name == name)
+               {
+                    return library.tracks[i];
+               }
+          }
+          return nullptr;
+     }
+
+     void midiStart(MidiLibrary &library, MidiTrack *track, Mix_Music *music, int loops, int fadeMs)
+     {
+          int result = fadeMs > 0 ? Mix_FadeInMusic(music, loops, fadeMs) : Mix_PlayMusic(music, loops);
+          if (result != 0)
+          {
+               std::cerr << "Unable to play MIDI track " << track->name << "! SDL_mixer Error: " << Mix_GetError() << std::endl;
+               return;
+          }
+          track->lastUsed = SDL_GetTicks();
+          library.playing = track;
+     }
+}
+
+MidiLibraryConfig midiLibraryDefaultConfig()
+{
+     MidiLibraryConfig config;
+     config.openTracks = 3;
+     config.pack = nullptr;
+     return config;
+}
+
+bool midiLibraryInit(MidiLibrary &library, const MidiLibraryConfig &config)
+{
+     library.config = config;
+     library.config.openTracks = SDL_max(1, config.openTracks);
+     library.thread = nullptr;
+     library.quitting = false;
+     library.playing = nullptr;
+     library.queuedPlay = nullptr;
+     library.queuedLoops = 0;
+     library.queuedFadeMs = 0;
+     SDL_AtomicSet(&library.instrumentsReady, 0);
+     library.stats = MidiLibraryStats();
+
+     library.lock = SDL_CreateMutex();
+     library.wake = SDL_CreateCond();
+     if (library.lock == nullptr || library.wake == nullptr)
+     {
+          std::cerr << "Unable to create MIDI library lock! SDL Error: " << SDL_GetError() << std::endl;
+          midiLibraryDestroy(library);
+          return false;
+     }
+
+     // Both are read when the MIDI codec starts and when a song loads
+     if (!config.soundFonts.empty() && Mix_SetSoundFonts(config.soundFonts.c_str()) == 0)
+     {
+          std::cerr << "Unable to set sound fonts! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          midiLibraryDestroy(library);
+          return false;
+     }
+     if (!config.timidityCfg.empty() && Mix_SetTimidityCfg(config.timidityCfg.c_str()) == 0)
+     {
+          std::cerr << "Unable to set Timidity config! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          midiLibraryDestroy(library);
+          return false;
+     }
+     if ((Mix_Init(MIX_INIT_MID) & MIX_INIT_MID) == 0)
+     {
+          std::cerr << "Unable to initialize MIDI! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          midiLibraryDestroy(library);
+          return false;
+     }
+
+     ThreadOptions options = threadDefaultOptions();
+     options.task = THREAD_TASK_BACKGROUND;
+     library.thread = threadCreate(midiThreadMain, "MidiLibrary", &library, options);
+     if (library.thread == nullptr)
+     {
+          std::cerr << "Unable to start MIDI library thread! SDL Error: " << SDL_GetError() << std::endl;
+          midiLibraryDestroy(library);
+          return false;
+     }
+     return true;
+}
+
+void midiLibraryPrefetch(MidiLibrary &library, const std::string &name, const std::string &path)
+{
+     if (library.thread == nullptr || midiFind(library, name) != nullptr)
+     {
+          return;
+     }
+     MidiTrack *track = new MidiTrack{name, path, nullptr, false, SDL_GetTicks()};
+     library.tracks.push_back(track);
+
+     SDL_LockMutex(library.lock);
+     library.pending.push_back(track);
+     SDL_UnlockMutex(library.lock);
+     SDL_CondSignal(library.wake);
+}
+
+Mix_Music *midiLibraryGet(MidiLibrary &library, const std::string &name)
+{
+     MidiTrack *track = midiFind(library, name);
+     if (track == nullptr)
+     {
+          return nullptr;
+     }
+     SDL_LockMutex(library.lock);
+     Mix_Music *music = track->music;
+     SDL_UnlockMutex(library.lock);
+     if (music != nullptr)
+     {
+          track->lastUsed = SDL_GetTicks();
+     }
+     return music;
+}
+
+bool midiLibraryPlay(MidiLibrary &library, const std::string &name, int loops, int fadeMs)
+{
+     MidiTrack *track = midiFind(library, name);
+     if (track == nullptr)
+     {
+          return false;
+     }
+     SDL_LockMutex(library.lock);
+     Mix_Music *music = track->music;
+     bool failed = track->failed;
+     SDL_UnlockMutex(library.lock);
+     if (failed)
+     {
+          return false;
+     }
+
+     library.queuedPlay = nullptr;
+     if (music == nullptr)
+     {
+          library.queuedPlay = track;
+          library.queuedLoops = loops;
+          library.queuedFadeMs = fadeMs;
+          return true;
+     }
+     library.stats.reuses++;
+     midiStart(library, track, music, loops, fadeMs);
+     return true;
+}
+
+void midiLibraryUpdate(MidiLibrary &library)
+{
+     if (library.thread == nullptr)
+     {
+          return;
+     }
+     if (library.playing != nullptr && !Mix_PlayingMusic())
+     {
+          library.playing = nullptr;
+     }
+
+     SDL_LockMutex(library.lock);
+     MidiTrack *queued = library.queuedPlay;
+     Mix_Music *queuedMusic = queued != nullptr ? queued->music : nullptr;
+     bool queuedFailed = queued != nullptr && queued->failed;
+
+     // Close the least recently used open tracks, never one playing or waiting
+     // to play. Freed outside the lock: Mix_FreeMusic waits for the mixer.
+     std::vector<MidiTrack *> open;
+     for (size_t i = 0; i < library.tracks.size(); i++)
+     {
+          if (library.tracks[i]->music != nullptr)
+          {
+               open.push_back(library.tracks[i]);
+          }
+     }
+     SDL_UnlockMutex(library.lock);
+
+     if (queuedFailed)
+     {
+          library.queuedPlay = nullptr;
+     }
+     else if (queuedMusic != nullptr)
+     {
+          library.queuedPlay = nullptr;
+          midiStart(library, queued, queuedMusic, library.queuedLoops, library.queuedFadeMs);
+     }
+
+     std::sort(open.begin(), open.end(), [](const MidiTrack *a, const MidiTrack *b) {
+          return a->lastUsed < b->lastUsed;
+     });
+     int excess = (int)open.size() - library.config.openTracks;
+     for (size_t i = 0; i < open.size() && excess > 0; i++)
+     {
+          MidiTrack *track = open[i];
+          if (track == library.playing || track == library.queuedPlay)
+          {
+               continue;
+          }
+          Mix_FreeMusic(track->music);
+          library.tracks.erase(std::find(library.tracks.begin(), library.tracks.end(), track));
+          delete track;
+          excess--;
+     }
+}
+
+bool midiLibraryReady(const MidiLibrary &library)
+{
+     return SDL_AtomicGet(const_cast<SDL_atomic_t *>(&library.instrumentsReady)) != 0;
+}
+
+MidiLibraryStats midiLibraryGetStats(MidiLibrary &library)
+{
+     if (library.lock == nullptr)
+     {
+          return library.stats;
+     }
+     SDL_LockMutex(library.lock);
+     MidiLibraryStats stats = library.stats;
+     SDL_UnlockMutex(library.lock);
+     return stats;
+}
+
+void midiLibraryDestroy(MidiLibrary &library)
+{
+     if (library.thread != nullptr)
+     {
+          SDL_LockMutex(library.lock);
+          library.quitting = true;
+          SDL_UnlockMutex(library.lock);
+          SDL_CondSignal(library.wake);
+          SDL_WaitThread(library.thread, NULL);
+          library.thread = nullptr;
+     }
+     if (library.playing != nullptr)
+     {
+          Mix_HaltMusic();
+          library.playing = nullptr;
+     }
+     library.queuedPlay = nullptr;
+     for (size_t i = 0; i < library.tracks.size(); i++)
+     {
+          Mix_FreeMusic(library.tracks[i]->music);
+          delete library.tracks[i];
+     }
+     library.tracks.clear();
+     library.pending.clear();
+     for (size_t i = 0; i < library.instruments.size(); i++)
+     {
+          mappedFileClose(library.instruments[i]);
+     }
+     library.instruments.clear();
+
+     SDL_DestroyCond(library.wake);
+     SDL_DestroyMutex(library.lock);
+     library.wake = nullptr;
+     library.lock = nullptr;
+}
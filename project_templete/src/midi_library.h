@@ -0,0 +1,116 @@
+// Description:
+// MIDI music without the track-switch hitch. SDL_mixer gives every MIDI
+// Mix_Music its own instruments: a Timidity song loads each GUS patch it
+// uses and a FluidSynth one loads the whole sound font, and both are
+// freed with the song. Switching tracks on the main thread therefore
+// stalls for as long as the instruments take to read, which for a large
+// sound font on a cold disk is seconds.
+//
+// SDL_mixer keeps that per-song loading internal, so the library works
+// around it from outside. It sets the sound fonts or Timidity config once
+// and, on its own thread, maps every instrument file they name (the sound
+// fonts, or the patches the config lists) and touches their pages, so they
+// stay mapped for the library's lifetime and later loads read them from
+// memory, not from disk. Tracks are opened on the same thread ahead of time
+// with midiLibraryPrefetch(). The last few tracks stay open; going back to
+// one of those costs nothing, and the main thread never loads one itself.
+// midiLibraryPlay() on a track that is still loading starts it as soon
+// as it is ready.
+//
+// Call midiLibraryInit() before the first MIDI load: SDL_mixer reads the
+// Timidity config when the MIDI codec is initialized.
+// =============================================================================
+
+#ifndef MIDI_LIBRARY_H
+#define MIDI_LIBRARY_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+#include "mapped_file.h"
+
+struct MidiLibraryConfig
+{
+     std::string soundFonts;  // As Mix_SetSoundFonts: paths separated by ';', empty for none
+     std::string timidityCfg; // As Mix_SetTimidityCfg, empty for SDL_mixer's default
+     int openTracks;          // Tracks kept open once loaded, the playing one included
+     const AssetPack *pack;   // Tracks are looked up here before the filesystem
+};
+
+struct MidiTrack
+{
+     std::string name;
+     std::string path;
+     Mix_Music *music; // nullptr until loaded; guarded by lock until then
+     bool failed;
+     Uint32 lastUsed; // Ticks, for closing the least recently used
+};
+
+struct MidiLibraryStats
+{
+     int instrumentFiles;
+     size_t instrumentBytes; // Mapped and warmed
+     int loads;              // Tracks opened on the library thread
+     int reuses;             // Plays of a track that was still open
+     Uint32 warmMs;          // Time the instruments took to map and warm
+};
+
+struct MidiLibrary
+{
+     MidiLibraryConfig config;
+     std::vector<MappedFile> instruments; // Library thread until instrumentsReady
+
+     SDL_Thread *thread;
+     SDL_mutex *lock;
+     SDL_cond *wake;
+
+     // Guarded by lock
+     std::deque<MidiTrack *> pending;
+     bool quitting;
+
+     // Main thread; tracks are heap nodes so the thread can fill them in
+     std::vector<MidiTrack *> tracks;
+     MidiTrack *playing;
+     MidiTrack *queuedPlay; // Waiting for its load to finish
+     int queuedLoops, queuedFadeMs;
+
+     SDL_atomic_t instrumentsReady;
+     MidiLibraryStats stats; // Instrument and load fields written under lock
+};
+
+MidiLibraryConfig midiLibraryDefaultConfig();
+
+// Set the instruments and start warming them in the background. False
+// with a message on stderr if the thread can't start or SDL_mixer rejects
+// the sound fonts or config.
+bool midiLibraryInit(MidiLibrary &library, const MidiLibraryConfig &config);
+
+// Start opening a track in the background; does nothing if it is open or
+// queued already
+void midiLibraryPrefetch(MidiLibrary &library, const std::string &name, const std::string &path);
+
+// The open track, or nullptr while it loads or if it failed
+Mix_Music *midiLibraryGet(MidiLibrary &library, const std::string &name);
+
+// Like Mix_FadeInMusic for a prefetched track (`fadeMs` 0 plays it at
+// once); one that is still loading starts from midiLibraryUpdate() when
+// ready. False if the track was never prefetched or failed to load.
+bool midiLibraryPlay(MidiLibrary &library, const std::string &name, int loops, int fadeMs);
+
+// Start a play that was waiting and close tracks past config.openTracks;
+// call once per frame
+void midiLibraryUpdate(MidiLibrary &library);
+
+// Whether the instrument files have all been warmed
+bool midiLibraryReady(const MidiLibrary &library);
+
+MidiLibraryStats midiLibraryGetStats(MidiLibrary &library);
+
+// Stop the thread, halt the music and close every track and instrument
+void midiLibraryDestroy(MidiLibrary &library);
+
+#endif // MIDI_LIBRARY_H
@@ -0,0 +1,259 @@
+#include "mip_texture.h"
+
+#include <cmath>
+#include <iostream>
+
+#include "aligned_surface.h"
+#include "premultiply.h"
+#include "render_record.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define MIP_TEXTURE_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+     const Uint8 *mipRow(const SDL_Surface *surface, int y)
+     {
+          return (const Uint8 *)surface->pixels + (size_t)y * surface->pitch;
+     }
+
+     // --- Box ---
+
+     void boxRowScalar(const Uint8 *row0, const Uint8 *row1, Uint8 *out, int x0, int x1, int srcWidth)
+     {
+          for (int x = x0; x < x1; x++)
+          {
+               int left = 2 * x * 4;
+               int right = SDL_min(2 * x + 1, srcWidth - 1) * 4;
+               for (int c = 0; c < 4; c++)
+               {
+                    out[x * 4 + c] = (Uint8)((row0[left + c] + row0[right + c] + row1[left + c] + row1[right + c] + 2) >> 2);
+               }
+          }
+     }
+
+#ifdef MIP_TEXTURE_X86
+     // Two output pixels (four source columns) per step, same rounding as
+     // the scalar loop
+     int boxRowSse2(const Uint8 *row0, const Uint8 *row1, Uint8 *out, int dstWidth)
+     {
+          const __m128i zero = _mm_setzero_si128();
+          const __m128i two = _mm_set1_epi16(2);
+          int x = 0;
+          for (; x + 2 <= dstWidth; x += 2)
+          {
+               __m128i a = _mm_loadu_si128((const __m128i *)(row0 + x * 8));
+               __m128i b = _mm_loadu_si128((const __m128i *)(row1 + x * 8));
+               __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+               __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+               lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+               hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+               __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two), 2);
+               _mm_storel_epi64((__m128i *)(out + x * 4), _mm_packus_epi16(sum, zero));
+          }
+          return x;
+     }
+#endif
+
+     void boxDownsample(const SDL_Surface *src, SDL_Surface *dst)
+     {
+          for (int y = 0; y < dst->h; y++)
+          {
+               const Uint8 *row0 = mipRow(src, 2 * y);
+               const Uint8 *row1 = mipRow(src, SDL_min(2 * y + 1, src->h - 1));
+               Uint8 *out = (Uint8 *)dst->pixels + (size_t)y * dst->pitch;
+               int x = 0;
+#ifdef MIP_TEXTURE_X86
+               if (src->w >= 2)
+               {
+                    x = boxRowSse2(row0, row1, out, dst->w);
+               }
+#endif
+               boxRowScalar(row0, row1, out, x, dst->w, src->w);
+          }
+     }
+
+     // --- Lanczos-2 ---
+     // Halving puts every output pixel at the same place between source
+     // texels, so one 8-tap kernel serves the whole image: taps 2x-3 to
+     // 2x+4, at 3.5 to 0.5 texels from the output centre.
+
+     const int LANCZOS_TAPS = 8;
+
+     void lanczosWeights(float weights[LANCZOS_TAPS])
+     {
+          const double pi = 3.14159265358979323846;
+          double total = 0.0;
+          for (int i = 0; i < LANCZOS_TAPS; i++)
+          {
+               double t = std::fabs(i - 3.5) / 2.0; // In output texels
+               double w = std::sin(pi * t) * std::sin(pi * t / 2.0) / (pi * pi * t * t / 2.0);
+               weights[i] = (float)w;
+               total += w;
+          }
+          for (int i = 0; i < LANCZOS_TAPS; i++)
+          {
+               weights[i] = (float)(weights[i] / total);
+          }
+     }
+
+     void lanczosDownsample(const SDL_Surface *src, SDL_Surface *dst)
+     {
+          float weights[LANCZOS_TAPS];
+          lanczosWeights(weights);
+
+          // Horizontal pass into floats, full source height
+          std::vector<float> across((size_t)dst->w * src->h * 4);
+          for (int y = 0; y < src->h; y++)
+          {
+               const Uint8 *row = mipRow(src, y);
+               float *out = &across[(size_t)y * dst->w * 4];
+               for (int x = 0; x < dst->w; x++)
+               {
+                    float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                    for (int k = 0; k < LANCZOS_TAPS; k++)
+                    {
+                         const Uint8 *texel = row + SDL_clamp(2 * x - 3 + k, 0, src->w - 1) * 4;
+                         for (int c = 0; c < 4; c++)
+                         {
+                              sum[c] += weights[k] * texel[c];
+                         }
+                    }
+                    SDL_memcpy(out + x * 4, sum, sizeof(sum));
+               }
+          }
+
+          // Vertical pass; negative lobes can ring past the alpha, which
+          // premultiplied colour must never exceed
+          for (int y = 0; y < dst->h; y++)
+          {
+               Uint8 *out = (Uint8 *)dst->pixels + (size_t)y * dst->pitch;
+               for (int x = 0; x < dst->w; x++)
+               {
+                    float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                    for (int k = 0; k < LANCZOS_TAPS; k++)
+                    {
+                         const float *texel = &across[((size_t)SDL_clamp(2 * y - 3 + k, 0, src->h - 1) * dst->w + x) * 4];
+                         for (int c = 0; c < 4; c++)
+                         {
+                              sum[c] += weights[k] * texel[c];
+                         }
+                    }
+                    int alpha = SDL_clamp((int)(sum[3] + 0.5f), 0, 255); // ARGB8888 keeps alpha in the top byte
+                    for (int c = 0; c < 3; c++)
+                    {
+                         out[x * 4 + c] = (Uint8)SDL_clamp((int)(sum[c] + 0.5f), 0, alpha);
+                    }
+                    out[x * 4 + 3] = (Uint8)alpha;
+               }
+          }
+     }
+}
+
+void mipDownsample(const SDL_Surface *src, SDL_Surface *dst, MipFilter filter)
+{
+     if (filter == MIP_FILTER_LANCZOS)
+     {
+          lanczosDownsample(src, dst);
+     }
+     else
+     {
+          boxDownsample(src, dst);
+     }
+}
+
+bool mipTextureCreate(MipTexture &mip, SDL_Renderer *renderer, SDL_Surface *surface, MipFilter filter,
+                      MipSample sample, int maxLevels)
+{
+     mip.levels.clear();
+     mip.width = surface->w;
+     mip.height = surface->h;
+
+     SDL_Surface *level = alignedSurfaceConvert(surface, SDL_PIXELFORMAT_ARGB8888);
+     if (level == nullptr || !premultiplySurface(level))
+     {
+          std::cerr << "Unable to prepare mip chain! SDL Error: " << SDL_GetError() << std::endl;
+          SDL_FreeSurface(level);
+          return false;
+     }
+
+     const SDL_BlendMode blend = premultipliedBlendMode();
+     const SDL_ScaleMode scale = sample == MIP_SAMPLE_LINEAR ? SDL_ScaleModeLinear : SDL_ScaleModeNearest;
+     while (level != nullptr)
+     {
+          SDL_Texture *texture = renderRecordCreateTextureFromSurface(renderer, level);
+          if (texture == nullptr)
+          {
+               std::cerr << "Unable to create mip level texture! SDL Error: " << SDL_GetError() << std::endl;
+               SDL_FreeSurface(level);
+               mipTextureDestroy(mip);
+               return false;
+          }
+          renderRecordSetTextureBlendMode(texture, blend);
+          SDL_SetTextureScaleMode(texture, scale);
+          mip.levels.push_back(texture);
+
+          SDL_Surface *next = nullptr;
+          if ((level->w > 1 || level->h > 1) && (int)mip.levels.size() < maxLevels)
+          {
+               next = alignedSurfaceCreate(SDL_max(1, level->w / 2), SDL_max(1, level->h / 2), SDL_PIXELFORMAT_ARGB8888);
+               if (next != nullptr)
+               {
+                    mipDownsample(level, next, filter);
+               }
+          }
+          SDL_FreeSurface(level);
+          level = next;
+     }
+     return true;
+}
+
+int mipTextureLevel(const MipTexture &mip, const SDL_Rect *src, const SDL_Rect *dst)
+{
+     if (dst == nullptr || dst->w <= 0 || dst->h <= 0 || mip.levels.size() < 2)
+     {
+          return 0;
+     }
+     int srcW = src != nullptr ? src->w : mip.width;
+     int srcH = src != nullptr ? src->h : mip.height;
+
+     // Texels per pixel along the more minified axis, rounded to the
+     // nearest level
+     double rho = SDL_max((double)srcW / dst->w, (double)srcH / dst->h);
+     if (rho <= 1.0)
+     {
+          return 0;
+     }
+     int level = (int)std::floor(std::log2(rho) + 0.5);
+     return SDL_min(level, (int)mip.levels.size() - 1);
+}
+
+int mipTextureCopy(SDL_Renderer *renderer, const MipTexture &mip, const SDL_Rect *src, const SDL_Rect *dst)
+{
+     if (mip.levels.empty())
+     {
+          return SDL_SetError("Mip texture has no levels");
+     }
+     int level = mipTextureLevel(mip, src, dst);
+     if (level == 0 || src == nullptr)
+     {
+          return renderRecordCopy(renderer, mip.levels[level], src, dst);
+     }
+     SDL_Rect scaled;
+     scaled.x = src->x >> level;
+     scaled.y = src->y >> level;
+     scaled.w = SDL_max(1, ((src->x + src->w) >> level) - scaled.x);
+     scaled.h = SDL_max(1, ((src->y + src->h) >> level) - scaled.y);
+     return renderRecordCopy(renderer, mip.levels[level], &scaled, dst);
+}
+
+void mipTextureDestroy(MipTexture &mip)
+{
+     for (SDL_Texture *texture : mip.levels)
+     {
+          renderRecordDestroyTexture(texture);
+     }
+     mip.levels.clear();
+}
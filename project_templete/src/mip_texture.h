@@ -0,0 +1,60 @@
+// Description:
+// Mipmapped textures for the SDL renderer. SDL2 textures have a single
+// level, so drawing an image much smaller than it is samples scattered
+// texels: the result shimmers and every sample misses the texture cache.
+// A MipTexture keeps the whole chain as separate textures, each half the
+// size of the one before, and mipTextureCopy() draws from the level that
+// is closest to the on-screen size.
+//
+// The levels are built on the CPU, since the renderer offers no way to
+// have the backend generate them. Box filtering averages 2x2 blocks (with
+// an SSE2 kernel); Lanczos-2 is slower but keeps small detail sharper.
+// Levels are filtered with premultiplied alpha, so transparent texels do
+// not darken the edges, and are drawn with the matching blend mode.
+//
+// Sampling between two levels (trilinear) cannot be expressed with
+// SDL_RenderCopy; MIP_SAMPLE_LINEAR filters within the chosen level.
+// =============================================================================
+
+#ifndef MIP_TEXTURE_H
+#define MIP_TEXTURE_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+enum MipFilter
+{
+     MIP_FILTER_BOX,
+     MIP_FILTER_LANCZOS
+};
+
+enum MipSample
+{
+     MIP_SAMPLE_NEAREST, // Nearest texel of the chosen level
+     MIP_SAMPLE_LINEAR   // Bilinear within the chosen level
+};
+
+struct MipTexture
+{
+     std::vector<SDL_Texture *> levels; // Level 0 is full size
+     int width, height;                 // Size of level 0
+};
+
+// Upload `surface` (any format, left untouched) and its mip chain down to
+// `maxLevels` levels or 1x1, whichever comes first
+bool mipTextureCreate(MipTexture &mip, SDL_Renderer *renderer, SDL_Surface *surface, MipFilter filter,
+                      MipSample sample, int maxLevels = 16);
+
+// Halve an ARGB8888 image with premultiplied alpha into `dst`, which is
+// max(1, w / 2) x max(1, h / 2)
+void mipDownsample(const SDL_Surface *src, SDL_Surface *dst, MipFilter filter);
+
+// Level that suits drawing `src` (level 0 texels, nullptr for all) into `dst`
+int mipTextureLevel(const MipTexture &mip, const SDL_Rect *src, const SDL_Rect *dst);
+
+// SDL_RenderCopy from the best level; `src` is in level 0 texels
+int mipTextureCopy(SDL_Renderer *renderer, const MipTexture &mip, const SDL_Rect *src, const SDL_Rect *dst);
+
+void mipTextureDestroy(MipTexture &mip);
+
+#endif // MIP_TEXTURE_H
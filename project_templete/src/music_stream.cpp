@@ -0,0 +1,856 @@
+#include "music_stream.h"
+
+#include <SDL2/SDL_mixer.h>
+#include <cstring>
+#include <iostream>
+
+#include "audio_resample.h"
+
+namespace
+{
+     // --- Streaming WAV decoder ---
+
+     const int WAV_READ_BYTES = 16384;
+
+     struct WavState
+     {
+          SDL_RWops *file;
+          SDL_AudioStream *convert; // nullptr when the vector path below converts
+          Sint64 dataStart;
+          Uint32 dataBytes;
+          Uint32 dataLeft;
+          bool flushed;
+          int sourceRate;
+          int outputRate;
+          int sourceFrameBytes;
+          Uint8 raw[WAV_READ_BYTES];
+          int rawKept; // Bytes of a partial frame carried at the front of raw
+
+          // Vector path for 16-bit and float PCM into a 16-bit or float
+          // device with the same channel count
+          SDL_AudioFormat sourceFormat;
+          SDL_AudioFormat outputFormat;
+          int channels;
+          bool resample;
+          AudioResampler resampler;
+          std::vector<float> input;
+          std::vector<float> output;
+          std::vector<Uint8> ready; // Converted output not yet read
+          size_t readyPos;
+     };
+
+     bool vectorPathSupports(SDL_AudioFormat source, SDL_AudioFormat output, int channels, int outputChannels)
+     {
+          return (source == AUDIO_S16SYS || source == AUDIO_F32SYS) &&
+                 (output == AUDIO_S16SYS || output == AUDIO_F32SYS) && channels == outputChannels &&
+                 channels <= AUDIO_RESAMPLE_MAX_CHANNELS;
+     }
+
+     void appendReady(WavState *wav, const float *samples, int count)
+     {
+          if (wav->readyPos == wav->ready.size())
+          {
+               wav->ready.clear();
+               wav->readyPos = 0;
+          }
+          const size_t start = wav->ready.size();
+          const int sampleBytes = SDL_AUDIO_BITSIZE(wav->outputFormat) / 8;
+          wav->ready.resize(start + (size_t)count * sampleBytes);
+          if (wav->outputFormat == AUDIO_S16SYS)
+          {
+               audioConvertF32ToS16(samples, (Sint16 *)&wav->ready[start], count);
+          }
+          else
+          {
+               std::memcpy(&wav->ready[start], samples, (size_t)count * sampleBytes);
+          }
+     }
+
+     // Convert (and resample) the next raw block; false once the data ends
+     bool decodeVector(WavState *wav)
+     {
+          // A short read can end mid-frame; the partial frame is kept for
+          // the next block so the channels stay aligned
+          const int frameBytes = wav->sourceFrameBytes;
+          Uint32 want = SDL_min(wav->dataLeft, (Uint32)(WAV_READ_BYTES - wav->rawKept));
+          size_t got = want > 0 ? SDL_RWread(wav->file, wav->raw + wav->rawKept, 1, want) : 0;
+          wav->dataLeft -= (Uint32)got;
+          const size_t held = wav->rawKept + got;
+          const int frames = (int)(held / frameBytes);
+          const int samples = frames * wav->channels;
+          wav->rawKept = (int)(held - (size_t)frames * frameBytes);
+          if (frames == 0 && got > 0)
+          {
+               return true; // Less than a frame so far
+          }
+          if (frames == 0)
+          {
+               wav->rawKept = 0; // A truncated last frame is dropped
+               if (wav->resample)
+               {
+                    wav->output.resize((size_t)audioResamplerMaxOutput(wav->resampler, wav->resampler.taps) *
+                                       wav->channels);
+                    int out = audioResamplerFlush(wav->resampler, wav->output.data(),
+                                                  (int)wav->output.size() / wav->channels);
+                    appendReady(wav, wav->output.data(), out * wav->channels);
+               }
+               return false;
+          }
+
+          wav->input.resize(samples);
+          if (wav->sourceFormat == AUDIO_S16SYS)
+          {
+               audioConvertS16ToF32((const Sint16 *)wav->raw, wav->input.data(), samples);
+          }
+          else
+          {
+               std::memcpy(wav->input.data(), wav->raw, (size_t)samples * sizeof(float));
+          }
+          std::memmove(wav->raw, wav->raw + (size_t)frames * frameBytes, wav->rawKept);
+          if (!wav->resample)
+          {
+               appendReady(wav, wav->input.data(), samples);
+               return true;
+          }
+          wav->output.resize((size_t)audioResamplerMaxOutput(wav->resampler, frames) * wav->channels);
+          int out = audioResamplerProcess(wav->resampler, wav->input.data(), frames, wav->output.data(),
+                                          (int)wav->output.size() / wav->channels);
+          appendReady(wav, wav->output.data(), out * wav->channels);
+          return true;
+     }
+
+     int wavRead(void *state, Uint8 *buffer, int bytes)
+     {
+          WavState *wav = (WavState *)state;
+          if (wav->convert == nullptr)
+          {
+               while (wav->ready.size() - wav->readyPos < (size_t)bytes && !wav->flushed)
+               {
+                    wav->flushed = !decodeVector(wav);
+               }
+               const int copied = (int)SDL_min(wav->ready.size() - wav->readyPos, (size_t)bytes);
+               std::memcpy(buffer, wav->ready.data() + wav->readyPos, copied);
+               wav->readyPos += copied;
+               return copied;
+          }
+          while (SDL_AudioStreamAvailable(wav->convert) < bytes && !wav->flushed)
+          {
+               Uint32 want = SDL_min(wav->dataLeft, (Uint32)WAV_READ_BYTES);
+               size_t got = want > 0 ? SDL_RWread(wav->file, wav->raw, 1, want) : 0;
+               if (got == 0)
+               {
+                    // End of data (or a truncated file): drain the converter
+                    SDL_AudioStreamFlush(wav->convert);
+                    wav->flushed = true;
+                    break;
+               }
+               wav->dataLeft -= (Uint32)got;
+               if (SDL_AudioStreamPut(wav->convert, wav->raw, (int)got) < 0)
+               {
+                    return -1;
+               }
+          }
+          return SDL_AudioStreamGet(wav->convert, buffer, bytes);
+     }
+
+     bool wavSeek(void *state, Sint64 frame)
+     {
+          WavState *wav = (WavState *)state;
+          // Output frame back to the source frame it was resampled from
+          const Sint64 sourceFrame = frame * wav->sourceRate / wav->outputRate;
+          const Sint64 offset = SDL_min(sourceFrame * wav->sourceFrameBytes, (Sint64)wav->dataBytes);
+          if (SDL_RWseek(wav->file, wav->dataStart + offset, RW_SEEK_SET) < 0)
+          {
+               return false;
+          }
+          if (wav->convert != nullptr)
+          {
+               SDL_AudioStreamClear(wav->convert);
+          }
+          else
+          {
+               audioResamplerReset(wav->resampler);
+               wav->ready.clear();
+               wav->readyPos = 0;
+          }
+          wav->dataLeft = wav->dataBytes - (Uint32)offset;
+          wav->rawKept = 0;
+          wav->flushed = false;
+          return true;
+     }
+
+     bool wavRewind(void *state)
+     {
+          return wavSeek(state, 0);
+     }
+
+     void wavClose(void *state)
+     {
+          WavState *wav = (WavState *)state;
+          if (wav->convert != nullptr)
+          {
+               SDL_FreeAudioStream(wav->convert);
+          }
+          SDL_RWclose(wav->file);
+          delete wav;
+     }
+
+     // --- Ring buffer ---
+
+     int ringUsed(const MusicStream &stream)
+     {
+          // Unsigned so the positions may wrap around
+          return (int)((unsigned)SDL_AtomicGet((SDL_atomic_t *)&stream.writePos) -
+                       (unsigned)SDL_AtomicGet((SDL_atomic_t *)&stream.readPos));
+     }
+
+     // Audio callback: runs on the mixer thread and never blocks or decodes
+     void feed(void *userdata, Uint8 *out, int len)
+     {
+          MusicStream &stream = *(MusicStream *)userdata;
+          if (stream.budget != nullptr)
+          {
+               audioBudgetMusicBegin(*stream.budget);
+          }
+          int readPos = SDL_AtomicGet(&stream.readPos);
+          int available = ringUsed(stream);
+          SDL_MemoryBarrierAcquire();
+
+          int bytes = SDL_min(available, len);
+          bytes -= bytes % stream.frameBytes;
+          int volume = SDL_AtomicGet(&stream.volume);
+          int offset = readPos & stream.ringMask;
+          int first = SDL_min(bytes, (int)stream.ring.size() - offset);
+
+          // The mixer hands us silence, so mixing in is the same as copying
+          // with the music volume applied
+          SDL_MixAudioFormat(out, &stream.ring[offset], stream.spec.format, first, volume);
+          if (bytes > first)
+          {
+               SDL_MixAudioFormat(out + first, &stream.ring[0], stream.spec.format, bytes - first, volume);
+          }
+
+          SDL_MemoryBarrierRelease();
+          SDL_AtomicAdd(&stream.readPos, bytes);
+          SDL_SemPost(stream.wake);
+
+          if (bytes < len && SDL_AtomicGet(&stream.primed) && !SDL_AtomicGet(&stream.finished))
+          {
+               SDL_AtomicIncRef(&stream.underruns);
+               SDL_AtomicAdd(&stream.underrunBytes, len - bytes);
+          }
+          if (stream.budget != nullptr)
+          {
+               audioBudgetMusicEnd(*stream.budget);
+          }
+     }
+
+     int msToBytes(const MusicStream &stream, int ms)
+     {
+          return (int)((Sint64)stream.spec.freq * ms / 1000) * stream.frameBytes;
+     }
+
+     void closeTrack(MusicTrack &track)
+     {
+          if (track.decoder.state != nullptr)
+          {
+               track.decoder.close(track.decoder.state);
+               track.decoder.state = nullptr;
+          }
+     }
+
+     // Read up to `bytes` of `track`, wrapping at its loop end (or its end)
+     // when it loops. Returns the bytes read, 0 at the end of a track that
+     // does not loop and -1 on error.
+     int readTrack(const MusicStream &stream, MusicTrack &track, Uint8 *buffer, int bytes)
+     {
+          const MusicDecoder &decoder = track.decoder;
+          const bool region = track.loop && decoder.loopEnd >= 0 && decoder.seek != nullptr;
+          bool producedSinceWrap = true;
+          int total = 0;
+          while (total < bytes)
+          {
+               int want = bytes - total;
+               if (region)
+               {
+                    if (track.position >= decoder.loopEnd)
+                    {
+                         if (!decoder.seek(decoder.state, decoder.loopStart))
+                         {
+                              return -1;
+                         }
+                         track.position = decoder.loopStart;
+                    }
+                    want = (int)SDL_min((Sint64)want, (decoder.loopEnd - track.position) * stream.frameBytes);
+               }
+               const int got = decoder.read(decoder.state, buffer + total, want);
+               if (got < 0)
+               {
+                    return -1;
+               }
+               if (got == 0)
+               {
+                    // Stop if the stream is empty right after wrapping
+                    if (!track.loop || !producedSinceWrap)
+                    {
+                         break;
+                    }
+                    if (region ? !decoder.seek(decoder.state, decoder.loopStart) : !decoder.rewind(decoder.state))
+                    {
+                         return -1;
+                    }
+                    track.position = region ? decoder.loopStart : 0;
+                    producedSinceWrap = false;
+                    continue;
+               }
+               producedSinceWrap = true;
+               total += got;
+               track.position += got / stream.frameBytes;
+          }
+          return total;
+     }
+
+     // Output frame at which a queued track takes over, -1 if unknown
+     Sint64 transitionFrame(const MusicTrack &track)
+     {
+          if (track.loop && track.decoder.loopEnd >= 0 && track.decoder.seek != nullptr)
+          {
+               return track.decoder.loopEnd;
+          }
+          return track.decoder.length;
+     }
+
+     // Equal-power crossfade over `total` frames of which `done` are past.
+     // Formats other than 16-bit and float switch over at the midpoint.
+     void crossfade(const MusicStream &stream, Uint8 *from, const Uint8 *to, int frames, int done, int total)
+     {
+          const int channels = stream.spec.channels;
+          for (int f = 0; f < frames; f++)
+          {
+               const float t = (done + f + 0.5f) / total;
+               const float out = SDL_cosf(t * 1.5707963f);
+               const float in = SDL_sinf(t * 1.5707963f);
+               if (stream.spec.format == AUDIO_S16SYS)
+               {
+                    Sint16 *a = (Sint16 *)from + f * channels;
+                    const Sint16 *b = (const Sint16 *)to + f * channels;
+                    for (int c = 0; c < channels; c++)
+                    {
+                         const int mixed = (int)(a[c] * out + b[c] * in);
+                         a[c] = (Sint16)SDL_clamp(mixed, -32768, 32767);
+                    }
+               }
+               else if (stream.spec.format == AUDIO_F32SYS)
+               {
+                    float *a = (float *)from + f * channels;
+                    const float *b = (const float *)to + f * channels;
+                    for (int c = 0; c < channels; c++)
+                    {
+                         a[c] = a[c] * out + b[c] * in;
+                    }
+               }
+               else if (t >= 0.5f)
+               {
+                    std::memcpy(from + f * stream.frameBytes, to + f * stream.frameBytes, stream.frameBytes);
+               }
+          }
+     }
+
+     void writeRing(MusicStream &stream, const Uint8 *data, int bytes)
+     {
+          int writePos = SDL_AtomicGet(&stream.writePos);
+          int offset = writePos & stream.ringMask;
+          int first = SDL_min(bytes, (int)stream.ring.size() - offset);
+          std::memcpy(&stream.ring[offset], data, first);
+          std::memcpy(&stream.ring[0], data + first, bytes - first);
+          SDL_MemoryBarrierRelease();
+          SDL_AtomicSet(&stream.writePos, (int)((unsigned)writePos + (unsigned)bytes));
+     }
+
+     // The next track, taken over by the decoder thread with its opening
+     // decoded ahead so the transition itself does no I/O
+     struct PendingTrack
+     {
+          bool active;
+          MusicTrack track;
+          MusicTransition when;
+          int fadeFrames;
+          std::vector<Uint8> head; // fadeFrames of audio, or one chunk to splice
+     };
+
+     void takeQueued(MusicStream &stream, PendingTrack &pending, int chunkFrames)
+     {
+          SDL_AtomicLock(&stream.queueLock);
+          if (!stream.queued)
+          {
+               SDL_AtomicUnlock(&stream.queueLock);
+               return;
+          }
+          MusicTrack track = stream.queuedTrack;
+          MusicTransition when = stream.queuedWhen;
+          int fadeMs = stream.queuedFadeMs;
+          stream.queued = false;
+          SDL_AtomicUnlock(&stream.queueLock);
+
+          if (pending.active)
+          {
+               closeTrack(pending.track); // Replaced before it started
+          }
+          pending.active = true;
+          pending.track = track;
+          pending.when = when;
+          pending.fadeFrames = (int)((Sint64)stream.spec.freq * fadeMs / 1000);
+          const int headFrames = pending.fadeFrames > 0 ? pending.fadeFrames : chunkFrames;
+          pending.head.assign((size_t)headFrames * stream.frameBytes, stream.spec.silence);
+          const int got = readTrack(stream, pending.track, pending.head.data(), (int)pending.head.size());
+          if (pending.fadeFrames == 0)
+          {
+               pending.head.resize(SDL_max(got, 0));
+          }
+     }
+
+     int decodeThread(void *data)
+     {
+          MusicStream &stream = *(MusicStream *)data;
+          int chunkBytes = msToBytes(stream, stream.config.chunkMs);
+          chunkBytes = SDL_clamp(chunkBytes, stream.frameBytes, (int)stream.ring.size());
+          chunkBytes -= chunkBytes % stream.frameBytes;
+          const int chunkFrames = chunkBytes / stream.frameBytes;
+          int prefetchBytes = SDL_min(msToBytes(stream, stream.config.prefetchMs), (int)stream.ring.size() - chunkBytes);
+          std::vector<Uint8> chunk(chunkBytes);
+
+          PendingTrack pending;
+          pending.active = false;
+          int fadeDone = -1; // Frames of the running crossfade so far, -1 when none
+          // Audio of the new track still to write after a transition
+          std::vector<Uint8> carry;
+          size_t carryPos = 0;
+
+          while (!SDL_AtomicGet(&stream.quitting))
+          {
+               int space = (int)stream.ring.size() - ringUsed(stream);
+               if (space < chunkBytes)
+               {
+                    SDL_SemWaitTimeout(stream.wake, 20);
+                    continue;
+               }
+               if (carryPos < carry.size())
+               {
+                    const int bytes = (int)SDL_min(carry.size() - carryPos, (size_t)chunkBytes);
+                    writeRing(stream, &carry[carryPos], bytes);
+                    carryPos += bytes;
+                    continue;
+               }
+               if (fadeDone < 0)
+               {
+                    takeQueued(stream, pending, chunkFrames);
+               }
+
+               int frames = chunkFrames;
+               if (pending.active && fadeDone < 0)
+               {
+                    const Sint64 boundary = transitionFrame(stream.current);
+                    const Sint64 untilFade = boundary - stream.current.position - pending.fadeFrames;
+                    if (pending.when == MUSIC_TRANSITION_NOW || (boundary >= 0 && untilFade == 0))
+                    {
+                         fadeDone = 0;
+                    }
+                    else if (boundary >= 0 && untilFade < 0 && !stream.current.loop)
+                    {
+                         // Queued late: fade over what is left of the track
+                         pending.fadeFrames = (int)SDL_max(boundary - stream.current.position, (Sint64)0);
+                         fadeDone = 0;
+                    }
+                    else if (boundary >= 0 && untilFade > 0)
+                    {
+                         frames = (int)SDL_min((Sint64)frames, untilFade);
+                    }
+                    // Looping and queued too late for this pass: the next one
+               }
+
+               if (fadeDone >= 0)
+               {
+                    // Crossfade step, or the whole splice when there is no fade
+                    const int count = SDL_min(chunkFrames, pending.fadeFrames - fadeDone);
+                    if (count > 0)
+                    {
+                         const int bytes = count * stream.frameBytes;
+                         int got = readTrack(stream, stream.current, chunk.data(), bytes);
+                         std::memset(chunk.data() + SDL_max(got, 0), stream.spec.silence, bytes - SDL_max(got, 0));
+                         crossfade(stream, chunk.data(), &pending.head[(size_t)fadeDone * stream.frameBytes], count,
+                                   fadeDone, pending.fadeFrames);
+                         writeRing(stream, chunk.data(), bytes);
+                         fadeDone += count;
+                    }
+                    if (fadeDone == pending.fadeFrames)
+                    {
+                         closeTrack(stream.current);
+                         stream.current = pending.track;
+                         carry.assign(pending.head.begin() + (size_t)fadeDone * stream.frameBytes, pending.head.end());
+                         carryPos = 0;
+                         pending.active = false;
+                         fadeDone = -1;
+                         SDL_AtomicIncRef(&stream.transitions);
+                    }
+                    continue;
+               }
+
+               int got = readTrack(stream, stream.current, chunk.data(), frames * stream.frameBytes);
+               if (got < 0)
+               {
+                    std::cerr << "Music stream decode failed! SDL Error: " << SDL_GetError() << std::endl;
+               }
+               if (got <= 0)
+               {
+                    if (pending.active)
+                    {
+                         // Length unknown until now: splice at the end
+                         pending.fadeFrames = 0;
+                         fadeDone = 0;
+                         continue;
+                    }
+                    // Finish only with nothing queued, so a racing
+                    // musicStreamQueue() either lands here or restarts
+                    SDL_AtomicLock(&stream.queueLock);
+                    const bool queued = stream.queued;
+                    if (!queued)
+                    {
+                         SDL_AtomicSet(&stream.primed, 1);
+                         SDL_AtomicSet(&stream.finished, 1);
+                    }
+                    SDL_AtomicUnlock(&stream.queueLock);
+                    if (queued)
+                    {
+                         continue;
+                    }
+                    break;
+               }
+
+               writeRing(stream, chunk.data(), got);
+               if (ringUsed(stream) >= prefetchBytes)
+               {
+                    SDL_AtomicSet(&stream.primed, 1);
+               }
+          }
+          if (pending.active)
+          {
+               closeTrack(pending.track);
+          }
+          return 0;
+     }
+}
+
+bool musicDecoderOpenWav(MusicDecoder &decoder, const char *path, const SDL_AudioSpec &output)
+{
+     SDL_RWops *file = SDL_RWFromFile(path, "rb");
+     if (file == nullptr)
+     {
+          return false;
+     }
+     return musicDecoderOpenWavRW(decoder, file, path, output);
+}
+
+bool musicDecoderOpenWavRW(MusicDecoder &decoder, SDL_RWops *file, const char *name, const SDL_AudioSpec &output)
+{
+     // RIFF header, then walk every chunk for "fmt ", "data" and "smpl"
+     Uint8 header[12];
+     if (SDL_RWread(file, header, 1, 12) != 12 || std::memcmp(header, "RIFF", 4) != 0 ||
+         std::memcmp(header + 8, "WAVE", 4) != 0)
+     {
+          std::cerr << name << " is not a RIFF/WAVE file" << std::endl;
+          SDL_RWclose(file);
+          return false;
+     }
+
+     SDL_AudioFormat format = 0;
+     Uint16 channels = 0;
+     Uint32 rate = 0;
+     Sint64 dataStart = -1;
+     Uint32 dataBytes = 0;
+     Sint64 loopStart = -1, loopEnd = -1; // Source frames, end inclusive
+     for (;;)
+     {
+          Uint8 id[4];
+          if (SDL_RWread(file, id, 1, 4) != 4)
+          {
+               break;
+          }
+          Uint32 size = SDL_ReadLE32(file);
+          Sint64 next = SDL_RWtell(file) + size + (size & 1);
+          if (std::memcmp(id, "fmt ", 4) == 0 && size >= 16)
+          {
+               Uint16 tag = SDL_ReadLE16(file);
+               channels = SDL_ReadLE16(file);
+               rate = SDL_ReadLE32(file);
+               SDL_ReadLE32(file); // Byte rate
+               SDL_ReadLE16(file); // Block align
+               Uint16 bits = SDL_ReadLE16(file);
+               if (tag == 1 && bits == 8)
+               {
+                    format = AUDIO_U8;
+               }
+               else if (tag == 1 && bits == 16)
+               {
+                    format = AUDIO_S16LSB;
+               }
+               else if (tag == 3 && bits == 32)
+               {
+                    format = AUDIO_F32LSB;
+               }
+          }
+          else if (std::memcmp(id, "data", 4) == 0)
+          {
+               dataStart = SDL_RWtell(file);
+               dataBytes = size;
+          }
+          else if (std::memcmp(id, "smpl", 4) == 0 && size >= 36 + 24)
+          {
+               // First sample loop; the header before the list is 36 bytes
+               Uint8 smpl[36 + 24];
+               if (SDL_RWread(file, smpl, 1, sizeof(smpl)) == sizeof(smpl) && SDL_SwapLE32(*(Uint32 *)(smpl + 28)) > 0)
+               {
+                    loopStart = SDL_SwapLE32(*(Uint32 *)(smpl + 36 + 8));
+                    loopEnd = SDL_SwapLE32(*(Uint32 *)(smpl + 36 + 12));
+               }
+          }
+          if (SDL_RWseek(file, next, RW_SEEK_SET) < 0)
+          {
+               break;
+          }
+     }
+
+     if (format == 0 || channels == 0 || rate == 0 || dataStart < 0 || SDL_RWseek(file, dataStart, RW_SEEK_SET) < 0)
+     {
+          std::cerr << name << ": unsupported WAV encoding" << std::endl;
+          SDL_RWclose(file);
+          return false;
+     }
+
+     WavState *wav = new WavState;
+     wav->convert = nullptr;
+     if (vectorPathSupports(format, output.format, channels, output.channels))
+     {
+          wav->sourceFormat = format;
+          wav->outputFormat = output.format;
+          wav->channels = channels;
+          wav->resample = (int)rate != output.freq;
+          wav->readyPos = 0;
+          if (wav->resample && !audioResamplerInit(wav->resampler, channels, (int)rate, output.freq))
+          {
+               std::cerr << "Unable to create resampler! SDL Error: " << SDL_GetError() << std::endl;
+               delete wav;
+               SDL_RWclose(file);
+               return false;
+          }
+     }
+     else
+     {
+          wav->convert = SDL_NewAudioStream(format, (Uint8)channels, (int)rate, output.format, output.channels,
+                                            output.freq);
+          if (wav->convert == nullptr)
+          {
+               std::cerr << "Unable to create audio converter! SDL Error: " << SDL_GetError() << std::endl;
+               delete wav;
+               SDL_RWclose(file);
+               return false;
+          }
+     }
+     wav->file = file;
+     wav->dataStart = dataStart;
+     wav->dataBytes = dataBytes;
+     wav->dataLeft = dataBytes;
+     wav->rawKept = 0;
+     wav->flushed = false;
+     wav->sourceRate = (int)rate;
+     wav->outputRate = output.freq;
+     wav->sourceFrameBytes = SDL_AUDIO_BITSIZE(format) / 8 * channels;
+
+     decoder.state = wav;
+     decoder.read = wavRead;
+     decoder.rewind = wavRewind;
+     decoder.close = wavClose;
+     decoder.seek = wavSeek;
+     const Sint64 sourceFrames = dataBytes / wav->sourceFrameBytes;
+     decoder.length = sourceFrames * output.freq / rate;
+     decoder.loopStart = -1;
+     decoder.loopEnd = -1;
+     if (loopStart >= 0 && loopEnd > loopStart && loopEnd < sourceFrames)
+     {
+          decoder.loopStart = loopStart * output.freq / rate;
+          decoder.loopEnd = (loopEnd + 1) * output.freq / rate;
+     }
+     return true;
+}
+
+MusicStreamConfig musicStreamDefaultConfig()
+{
+     MusicStreamConfig config;
+     config.bufferMs = 2000;
+     config.prefetchMs = 500;
+     config.chunkMs = 50;
+     return config;
+}
+
+bool musicStreamInit(MusicStream &stream, const MusicStreamConfig &config)
+{
+     stream.playing = false;
+     stream.thread = nullptr;
+     stream.wake = nullptr;
+     stream.budget = nullptr;
+
+     int freq, channels;
+     Uint16 format;
+     if (Mix_QuerySpec(&freq, &format, &channels) == 0)
+     {
+          std::cerr << "Music stream needs an open mixer! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          return false;
+     }
+     SDL_zero(stream.spec);
+     stream.spec.freq = freq;
+     stream.spec.format = format;
+     stream.spec.channels = (Uint8)channels;
+     stream.spec.silence = format == AUDIO_U8 ? 0x80 : 0;
+     stream.frameBytes = SDL_AUDIO_BITSIZE(format) / 8 * channels;
+     stream.config = config;
+
+     // Round the ring up to a power of two so positions can be masked
+     int bytes = SDL_max(msToBytes(stream, config.bufferMs), 4096);
+     int size = 1;
+     while (size < bytes)
+     {
+          size <<= 1;
+     }
+     stream.ring.assign(size, 0);
+     stream.ringMask = size - 1;
+
+     stream.wake = SDL_CreateSemaphore(0);
+     stream.queueLock = 0;
+     stream.queued = false;
+     SDL_AtomicSet(&stream.transitions, 0);
+     SDL_AtomicSet(&stream.volume, MIX_MAX_VOLUME);
+     SDL_AtomicSet(&stream.underruns, 0);
+     SDL_AtomicSet(&stream.underrunBytes, 0);
+     return stream.wake != nullptr;
+}
+
+const SDL_AudioSpec &musicStreamSpec(const MusicStream &stream)
+{
+     return stream.spec;
+}
+
+bool musicStreamPlay(MusicStream &stream, const MusicDecoder &decoder, bool loop)
+{
+     musicStreamStop(stream);
+
+     stream.current.decoder = decoder;
+     stream.current.loop = loop;
+     stream.current.position = 0;
+     SDL_AtomicSet(&stream.readPos, 0);
+     SDL_AtomicSet(&stream.writePos, 0);
+     SDL_AtomicSet(&stream.quitting, 0);
+     SDL_AtomicSet(&stream.finished, 0);
+     SDL_AtomicSet(&stream.primed, 0);
+     while (SDL_SemTryWait(stream.wake) == 0)
+     {
+     }
+
+     stream.thread = SDL_CreateThread(decodeThread, "music decode", &stream);
+     if (stream.thread == nullptr)
+     {
+          std::cerr << "Unable to start music decoder! SDL Error: " << SDL_GetError() << std::endl;
+          closeTrack(stream.current);
+          return false;
+     }
+     Mix_HaltMusic();
+     Mix_HookMusic(feed, &stream);
+     stream.playing = true;
+     return true;
+}
+
+bool musicStreamQueue(MusicStream &stream, const MusicDecoder &decoder, bool loop, MusicTransition when,
+                      int crossfadeMs)
+{
+     MusicTrack replaced;
+     replaced.decoder.state = nullptr;
+     bool restart = false;
+     SDL_AtomicLock(&stream.queueLock);
+     if (!stream.playing || SDL_AtomicGet(&stream.finished))
+     {
+          restart = true;
+     }
+     else
+     {
+          if (stream.queued)
+          {
+               replaced = stream.queuedTrack;
+          }
+          stream.queuedTrack.decoder = decoder;
+          stream.queuedTrack.loop = loop;
+          stream.queuedTrack.position = 0;
+          stream.queuedWhen = when;
+          stream.queuedFadeMs = SDL_max(crossfadeMs, 0);
+          stream.queued = true;
+     }
+     SDL_AtomicUnlock(&stream.queueLock);
+
+     closeTrack(replaced);
+     if (restart)
+     {
+          return musicStreamPlay(stream, decoder, loop);
+     }
+     SDL_SemPost(stream.wake); // Start decoding its opening now
+     return true;
+}
+
+void musicStreamStop(MusicStream &stream)
+{
+     if (!stream.playing)
+     {
+          return;
+     }
+     // Unhooking takes the audio lock, so the callback is done afterwards
+     Mix_HookMusic(NULL, NULL);
+     SDL_AtomicSet(&stream.quitting, 1);
+     SDL_SemPost(stream.wake);
+     SDL_WaitThread(stream.thread, NULL);
+     stream.thread = nullptr;
+     closeTrack(stream.current);
+     if (stream.queued)
+     {
+          closeTrack(stream.queuedTrack);
+          stream.queued = false;
+     }
+     stream.playing = false;
+}
+
+void musicStreamSetVolume(MusicStream &stream, int volume)
+{
+     SDL_AtomicSet(&stream.volume, SDL_clamp(volume, 0, MIX_MAX_VOLUME));
+}
+
+bool musicStreamFinished(const MusicStream &stream)
+{
+     return SDL_AtomicGet((SDL_atomic_t *)&stream.finished) && ringUsed(stream) == 0;
+}
+
+void musicStreamDestroy(MusicStream &stream)
+{
+     musicStreamStop(stream);
+     if (stream.wake != nullptr)
+     {
+          SDL_DestroySemaphore(stream.wake);
+          stream.wake = nullptr;
+     }
+     stream.ring.clear();
+}
+
+MusicStreamStats musicStreamGetStats(const MusicStream &stream)
+{
+     MusicStreamStats stats;
+     stats.underruns = SDL_AtomicGet((SDL_atomic_t *)&stream.underruns);
+     stats.underrunBytes = SDL_AtomicGet((SDL_atomic_t *)&stream.underrunBytes);
+     stats.transitions = SDL_AtomicGet((SDL_atomic_t *)&stream.transitions);
+     int bytesPerSecond = stream.spec.freq * stream.frameBytes;
+     stats.bufferedMs = bytesPerSecond > 0 ? (int)((Sint64)ringUsed(stream) * 1000 / bytesPerSecond) : 0;
+     return stats;
+}
@@ -0,0 +1,159 @@
+// Description:
+// Streaming music playback decoupled from the audio callback. A decoder
+// thread decodes ahead into a single-producer/single-consumer ring buffer,
+// and the callback installed with Mix_HookMusic only copies out of it, so a
+// slow disk or an expensive codec can no longer stall the mixer.
+//
+// Decoders are small function tables that produce audio already converted
+// to the mixer's output format (see Mix_QuerySpec). A streaming WAV decoder
+// is built in; other codecs plug in through the same MusicDecoder interface.
+//
+// Tracks change without a gap: musicStreamQueue() hands the next decoder
+// to the decoder thread, which decodes its opening ahead of time and then
+// splices or crossfades into it at an exact output frame, either at the
+// current track's end (or its loop end) or straight away. The audio
+// callback never opens, seeks or decodes anything.
+//
+// Underruns (the callback finding less audio than it needs after the
+// initial prefetch) are counted and reported by musicStreamGetStats().
+// =============================================================================
+
+#ifndef MUSIC_STREAM_H
+#define MUSIC_STREAM_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "audio_budget.h"
+
+struct MusicDecoder
+{
+     void *state;
+
+     // Fill up to `bytes` of output-format audio; returns the byte count,
+     // 0 at the end of the stream and -1 on error
+     int (*read)(void *state, Uint8 *buffer, int bytes);
+     bool (*rewind)(void *state);
+     void (*close)(void *state);
+
+     // Continue from output frame `frame`; nullptr if the codec cannot seek
+     bool (*seek)(void *state, Sint64 frame);
+
+     // In output frames: the stream's length, and the region looped
+     // playback repeats after the first pass. -1 when unknown or absent;
+     // without loop points the whole stream loops.
+     Sint64 length;
+     Sint64 loopStart;
+     Sint64 loopEnd; // Exclusive
+};
+
+// Stream a PCM (8/16-bit integer or 32-bit float) WAV file from disk,
+// converting it to `output` on the fly. 16-bit and float files convert
+// and resample with the SIMD kernels of audio_resample when the channel
+// count matches; anything else goes through SDL_AudioStream. Loop points
+// come from the file's "smpl" chunk when it has one.
+bool musicDecoderOpenWav(MusicDecoder &decoder, const char *path, const SDL_AudioSpec &output);
+
+// Same from an open, seekable stream such as assetOpen() returns. The
+// decoder owns `file` on success; on failure it is closed. `name` is only
+// used in error messages.
+bool musicDecoderOpenWavRW(MusicDecoder &decoder, SDL_RWops *file, const char *name, const SDL_AudioSpec &output);
+
+struct MusicStreamConfig
+{
+     int bufferMs;   // Ring buffer depth
+     int prefetchMs; // Audio decoded before playback starts
+     int chunkMs;    // Granularity of each decode step
+};
+
+struct MusicStreamStats
+{
+     int underruns;     // Callbacks that ran short of audio
+     int underrunBytes; // Silence inserted because of them
+     int bufferedMs;    // Audio currently decoded ahead
+     int transitions;   // Queued tracks that have started
+};
+
+enum MusicTransition
+{
+     MUSIC_TRANSITION_AT_END, // When the current track ends, or reaches its loop end while looping
+     MUSIC_TRANSITION_NOW     // From the audio decoded next, bufferMs at most from now
+};
+
+// A decoder and where it has got to
+struct MusicTrack
+{
+     MusicDecoder decoder;
+     bool loop;
+     Sint64 position; // Output frames into the stream, decoder thread only
+};
+
+struct MusicStream
+{
+     MusicTrack current;
+     MusicStreamConfig config;
+     SDL_AudioSpec spec;
+     int frameBytes;
+
+     // Ring buffer: positions count bytes monotonically and are masked
+     std::vector<Uint8> ring;
+     int ringMask;
+     SDL_atomic_t readPos;
+     SDL_atomic_t writePos;
+
+     SDL_Thread *thread;
+     SDL_sem *wake; // Posted by the callback whenever space frees up
+     SDL_atomic_t quitting;
+     SDL_atomic_t finished; // Decoder reached the end and won't loop
+     SDL_atomic_t primed;   // Prefetch complete, shortfalls now count
+     SDL_atomic_t volume;   // 0..MIX_MAX_VOLUME
+     bool playing;
+
+     // Track waiting for the decoder thread to pick it up
+     SDL_SpinLock queueLock;
+     bool queued;
+     MusicTrack queuedTrack;
+     MusicTransition queuedWhen;
+     int queuedFadeMs;
+     SDL_atomic_t transitions; // Tracks spliced or crossfaded in
+
+     SDL_atomic_t underruns;
+     SDL_atomic_t underrunBytes;
+
+     AudioBudget *budget; // Told when the callback starts, nullptr for none
+};
+
+MusicStreamConfig musicStreamDefaultConfig();
+
+// Query the mixer's output format and size the ring buffer accordingly.
+// Leaves `budget` unset.
+bool musicStreamInit(MusicStream &stream, const MusicStreamConfig &config);
+
+// Output format decoders passed to musicStreamPlay() must produce
+const SDL_AudioSpec &musicStreamSpec(const MusicStream &stream);
+
+// Take ownership of `decoder` and start playback through Mix_HookMusic,
+// replacing any Mix_Music that is playing
+bool musicStreamPlay(MusicStream &stream, const MusicDecoder &decoder, bool loop);
+
+// Follow the current track with `decoder` (owned by the stream from here
+// on) at `when`, crossfading over `crossfadeMs` or splicing when it is 0.
+// A crossfade at the end of a track starts crossfadeMs before it, so both
+// tracks overlap at full length. Queuing again before the transition
+// replaces the waiting track; with nothing playing this just plays.
+bool musicStreamQueue(MusicStream &stream, const MusicDecoder &decoder, bool loop,
+                      MusicTransition when = MUSIC_TRANSITION_AT_END, int crossfadeMs = 0);
+
+// Unhook from the mixer, stop the decoder thread and close the decoders
+void musicStreamStop(MusicStream &stream);
+
+void musicStreamSetVolume(MusicStream &stream, int volume);
+
+bool musicStreamFinished(const MusicStream &stream);
+
+// Stop playback and release the stream's resources
+void musicStreamDestroy(MusicStream &stream);
+
+MusicStreamStats musicStreamGetStats(const MusicStream &stream);
+
+#endif // MUSIC_STREAM_H
@@ -0,0 +1,416 @@
+#include "native_sound.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+     // Long enough that the mixer rarely wraps the carrier mid-callback
+     const int NATIVE_CARRIER_FRAMES = 4096;
+     const int NATIVE_BLOCK_FRAMES = 512;
+
+     bool nativeQueryMixer(int &rate, Uint16 &format, int &channels)
+     {
+          if (Mix_QuerySpec(&rate, &format, &channels) == 0)
+          {
+               return false; // Mix_QuerySpec set the error
+          }
+          if (format != AUDIO_S16SYS && format != AUDIO_F32SYS)
+          {
+               SDL_SetError("Native sounds need a 16-bit or float mixer, not format %d", (int)format);
+               return false;
+          }
+          if (channels < 1 || channels > AUDIO_RESAMPLE_MAX_CHANNELS)
+          {
+               SDL_SetError("Native sounds support up to %d mixer channels", AUDIO_RESAMPLE_MAX_CHANNELS);
+               return false;
+          }
+          return true;
+     }
+
+     // Decode without closing `src`, so a failure can rewind it
+     bool nativeDecode(NativeSound &sound, SDL_RWops *src)
+     {
+          SDL_AudioSpec spec;
+          Uint8 *buffer = nullptr;
+          Uint32 length = 0;
+          if (SDL_LoadWAV_RW(src, 0, &spec, &buffer, &length) == nullptr)
+          {
+               return false;
+          }
+          if (spec.channels < 1 || spec.channels > AUDIO_RESAMPLE_MAX_CHANNELS)
+          {
+               SDL_FreeWAV(buffer);
+               SDL_SetError("Native sounds support up to %d channels", AUDIO_RESAMPLE_MAX_CHANNELS);
+               return false;
+          }
+
+          sound.rate = spec.freq;
+          sound.channels = spec.channels;
+          if (spec.format == AUDIO_S16SYS)
+          {
+               sound.samples.assign((const Sint16 *)buffer, (const Sint16 *)(buffer + (length & ~1u)));
+          }
+          else
+          {
+               // Only the sample format changes, so SDL_AudioCVT does no resampling
+               SDL_AudioCVT cvt;
+               if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, AUDIO_S16SYS, spec.channels, spec.freq) < 0)
+               {
+                    SDL_FreeWAV(buffer);
+                    return false;
+               }
+               std::vector<Uint8> converted((size_t)length * cvt.len_mult);
+               SDL_memcpy(converted.data(), buffer, length);
+               cvt.buf = converted.data();
+               cvt.len = (int)length;
+               if (SDL_ConvertAudio(&cvt) < 0)
+               {
+                    SDL_FreeWAV(buffer);
+                    return false;
+               }
+               sound.samples.assign((const Sint16 *)cvt.buf, (const Sint16 *)(cvt.buf + (cvt.len_cvt & ~1)));
+          }
+          SDL_FreeWAV(buffer);
+          sound.frames = (int)(sound.samples.size() / sound.channels);
+          sound.samples.resize((size_t)sound.frames * sound.channels);
+          return true;
+     }
+
+     // Int16 frames to float frames with `outChannels`: mono is copied to every
+     // channel, a downmix to mono averages the first two, otherwise channels
+     // the output lacks are dropped and ones it adds repeat the last input
+     void nativeMapChannels(const Sint16 *in, int inChannels, float *out, int outChannels, int frames)
+     {
+          if (inChannels == outChannels)
+          {
+               audioConvertS16ToF32(in, out, frames * inChannels);
+               return;
+          }
+          const float scale = 1.0f / 32768.0f;
+          for (int i = 0; i < frames; i++)
+          {
+               const Sint16 *frame = in + (size_t)i * inChannels;
+               float *dst = out + (size_t)i * outChannels;
+               if (outChannels == 1)
+               {
+                    dst[0] = (frame[0] + frame[1]) * (0.5f * scale);
+                    continue;
+               }
+               for (int c = 0; c < outChannels; c++)
+               {
+                    dst[c] = frame[SDL_min(c, inChannels - 1)] * scale;
+               }
+          }
+     }
+
+     void nativeWriteFrames(const NativeSoundMixer &mixer, const float *in, int frames, Uint8 *out)
+     {
+          if (mixer.format == AUDIO_S16SYS)
+          {
+               audioConvertF32ToS16(in, (Sint16 *)out, frames * mixer.deviceChannels);
+          }
+          else
+          {
+               SDL_memcpy(out, in, (size_t)frames * mixer.frameBytes);
+          }
+     }
+
+     void nativeEffect(int channel, void *stream, int len, void *udata)
+     {
+          (void)channel;
+          NativeChannel &state = *(NativeChannel *)udata;
+          NativeSoundMixer &mixer = *state.mixer;
+          const NativeSound &sound = *state.sound;
+          const bool resample = sound.rate != mixer.rate;
+          const int frames = len / mixer.frameBytes;
+          Uint8 *out = (Uint8 *)stream;
+          float *input = mixer.input.data();
+          float *output = mixer.output.data();
+
+          int done = 0;
+          while (done < frames)
+          {
+               const int wanted = SDL_min(frames - done, NATIVE_BLOCK_FRAMES);
+               int produced = 0;
+               if (state.position >= sound.frames && state.loopsLeft != 0)
+               {
+                    // Loops run on through the filter, so there is no seam
+                    state.loopsLeft -= state.loopsLeft > 0 ? 1 : 0;
+                    state.position = 0;
+               }
+               if (!resample)
+               {
+                    produced = SDL_min(wanted, sound.frames - state.position);
+                    if (produced <= 0)
+                    {
+                         break;
+                    }
+                    nativeMapChannels(&sound.samples[(size_t)state.position * sound.channels], sound.channels, output,
+                                      mixer.deviceChannels, produced);
+                    state.position += produced;
+               }
+               else
+               {
+                    // Drain what the filter holds before feeding it more
+                    produced = audioResamplerProcess(state.resampler, nullptr, 0, output, wanted);
+                    if (produced == 0 && state.position < sound.frames)
+                    {
+                         const int count = SDL_min(NATIVE_BLOCK_FRAMES, sound.frames - state.position);
+                         nativeMapChannels(&sound.samples[(size_t)state.position * sound.channels], sound.channels, input,
+                                           mixer.deviceChannels, count);
+                         state.position += count;
+                         produced = audioResamplerProcess(state.resampler, input, count, output, wanted);
+                    }
+                    else if (produced == 0 && !state.tailFed)
+                    {
+                         const int count = state.resampler.taps / 2;
+                         SDL_memset(input, 0, (size_t)count * mixer.deviceChannels * sizeof(float));
+                         state.tailFed = true;
+                         produced = audioResamplerProcess(state.resampler, input, count, output, wanted);
+                    }
+                    else if (produced == 0)
+                    {
+                         break;
+                    }
+               }
+               nativeWriteFrames(mixer, output, produced, out + (size_t)done * mixer.frameBytes);
+               done += produced;
+          }
+
+          if (done < frames)
+          {
+               // Both formats are silent at zero
+               SDL_memset(out + (size_t)done * mixer.frameBytes, 0, (size_t)(frames - done) * mixer.frameBytes);
+               SDL_AtomicSet(&state.finished, 1);
+          }
+     }
+
+     void nativeEffectDone(int channel, void *udata)
+     {
+          (void)channel;
+          SDL_AtomicSet(&((NativeChannel *)udata)->attached, 0);
+     }
+}
+
+bool nativeSoundLoad(NativeSound &sound, SDL_RWops *src, int freesrc)
+{
+     if (src == nullptr)
+     {
+          SDL_SetError("No stream to load a native sound from");
+          return false;
+     }
+     const bool loaded = nativeDecode(sound, src);
+     if (freesrc)
+     {
+          SDL_RWclose(src);
+     }
+     return loaded;
+}
+
+Mix_Chunk *nativeSoundToChunk(const NativeSound &sound, AudioResampleQuality quality)
+{
+     int rate, channels;
+     Uint16 format;
+     if (!nativeQueryMixer(rate, format, channels))
+     {
+          return nullptr;
+     }
+
+     std::vector<float> mapped((size_t)sound.frames * channels);
+     nativeMapChannels(sound.samples.data(), sound.channels, mapped.data(), channels, sound.frames);
+
+     std::vector<float> resampled;
+     const std::vector<float> *frames = &mapped;
+     int frameCount = sound.frames;
+     if (sound.rate != rate && sound.frames > 0)
+     {
+          AudioResampler resampler;
+          if (!audioResamplerInit(resampler, channels, sound.rate, rate, quality))
+          {
+               return nullptr;
+          }
+          // Trimmed to the input's length at the new rate once the filter's
+          // delay has been pushed out
+          const int wanted = (int)(((Sint64)sound.frames * rate + sound.rate - 1) / sound.rate);
+          const int capacity = audioResamplerMaxOutput(resampler, sound.frames + resampler.taps) + 1;
+          resampled.resize((size_t)capacity * channels);
+          int produced = audioResamplerProcess(resampler, mapped.data(), sound.frames, resampled.data(), capacity);
+          produced += audioResamplerFlush(resampler, &resampled[(size_t)produced * channels], capacity - produced);
+          frameCount = SDL_min(produced, wanted);
+          frames = &resampled;
+     }
+
+     const int sampleBytes = SDL_AUDIO_BITSIZE(format) / 8;
+     const size_t bytes = (size_t)frameCount * channels * sampleBytes;
+     Mix_Chunk *chunk = (Mix_Chunk *)SDL_malloc(sizeof(Mix_Chunk));
+     Uint8 *buffer = (Uint8 *)SDL_malloc(SDL_max(bytes, (size_t)1));
+     if (chunk == nullptr || buffer == nullptr)
+     {
+          SDL_free(chunk);
+          SDL_free(buffer);
+          SDL_OutOfMemory();
+          return nullptr;
+     }
+     if (format == AUDIO_S16SYS)
+     {
+          audioConvertF32ToS16(frames->data(), (Sint16 *)buffer, frameCount * channels);
+     }
+     else
+     {
+          SDL_memcpy(buffer, frames->data(), bytes);
+     }
+     // Owned, so Mix_FreeChunk frees the samples with SDL_free
+     chunk->allocated = 1;
+     chunk->abuf = buffer;
+     chunk->alen = (Uint32)bytes;
+     chunk->volume = MIX_MAX_VOLUME;
+     return chunk;
+}
+
+Mix_Chunk *nativeLoadChunk(SDL_RWops *src, int freesrc, AudioResampleQuality quality)
+{
+     if (src == nullptr)
+     {
+          return Mix_LoadWAV_RW(src, freesrc);
+     }
+     int rate, channels;
+     Uint16 format;
+     const Sint64 start = SDL_RWtell(src);
+     NativeSound sound;
+     if (!nativeQueryMixer(rate, format, channels) || !nativeDecode(sound, src))
+     {
+          // Not a WAV, or a mixer format this path doesn't write
+          SDL_RWseek(src, start, RW_SEEK_SET);
+          return Mix_LoadWAV_RW(src, freesrc);
+     }
+     if (freesrc)
+     {
+          SDL_RWclose(src);
+     }
+     return nativeSoundToChunk(sound, quality);
+}
+
+bool nativeMixerInit(NativeSoundMixer &mixer, AudioResampleQuality quality)
+{
+     int rate, channels;
+     Uint16 format;
+     if (!nativeQueryMixer(rate, format, channels))
+     {
+          std::cerr << "Unable to start native sound mixer! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     mixer.quality = quality;
+     mixer.rate = rate;
+     mixer.deviceChannels = channels;
+     mixer.format = format;
+     mixer.frameBytes = SDL_AUDIO_BITSIZE(format) / 8 * channels;
+
+     // Channels allocated after this can't play native sounds
+     mixer.channels = std::vector<NativeChannel>(Mix_AllocateChannels(-1));
+     for (size_t i = 0; i < mixer.channels.size(); i++)
+     {
+          NativeChannel &state = mixer.channels[i];
+          state.mixer = &mixer;
+          SDL_AtomicSet(&state.attached, 0);
+          SDL_AtomicSet(&state.finished, 0);
+          state.sound = nullptr;
+          state.resamplerRate = 0;
+     }
+     mixer.input.assign((size_t)NATIVE_BLOCK_FRAMES * channels, 0.0f);
+     mixer.output.assign((size_t)NATIVE_BLOCK_FRAMES * channels, 0.0f);
+
+     mixer.silence.assign((size_t)NATIVE_CARRIER_FRAMES * mixer.frameBytes, 0);
+     mixer.carrier.allocated = 0;
+     mixer.carrier.abuf = mixer.silence.data();
+     mixer.carrier.alen = (Uint32)mixer.silence.size();
+     mixer.carrier.volume = MIX_MAX_VOLUME;
+     return true;
+}
+
+int nativeSoundPlay(NativeSoundMixer &mixer, const NativeSound &sound, int channel, int loops)
+{
+     if (sound.frames <= 0 || mixer.channels.empty())
+     {
+          SDL_SetError("Nothing to play");
+          return -1;
+     }
+     // The carrier loops forever; nativeMixerUpdate() ends it. Playing it
+     // unregisters whatever effect the channel had, so its state is free.
+     const int played = Mix_PlayChannel(channel, &mixer.carrier, -1);
+     if (played < 0)
+     {
+          return -1;
+     }
+     if (played >= (int)mixer.channels.size())
+     {
+          Mix_HaltChannel(played);
+          SDL_SetError("Channel %d was allocated after nativeMixerInit", played);
+          return -1;
+     }
+
+     NativeChannel &state = mixer.channels[played];
+     if (sound.rate != mixer.rate)
+     {
+          if (state.resamplerRate == sound.rate)
+          {
+               audioResamplerReset(state.resampler);
+          }
+          else
+          {
+               if (!audioResamplerInit(state.resampler, mixer.deviceChannels, sound.rate, mixer.rate, mixer.quality))
+               {
+                    Mix_HaltChannel(played);
+                    return -1;
+               }
+               state.resamplerRate = sound.rate;
+               // History never holds more than a block and a filter, so the
+               // mixer thread doesn't allocate
+               for (int c = 0; c < mixer.deviceChannels; c++)
+               {
+                    state.resampler.history[c].reserve(NATIVE_BLOCK_FRAMES + 2 * state.resampler.taps);
+               }
+          }
+     }
+     state.sound = &sound;
+     state.position = 0;
+     state.loopsLeft = loops;
+     state.tailFed = false;
+     SDL_AtomicSet(&state.finished, 0);
+
+     if (Mix_RegisterEffect(played, nativeEffect, nativeEffectDone, &state) == 0)
+     {
+          std::cerr << "Unable to attach native sound! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          Mix_HaltChannel(played);
+          return -1;
+     }
+     SDL_AtomicSet(&state.attached, 1);
+     return played;
+}
+
+void nativeMixerUpdate(NativeSoundMixer &mixer)
+{
+     for (size_t i = 0; i < mixer.channels.size(); i++)
+     {
+          NativeChannel &state = mixer.channels[i];
+          if (SDL_AtomicGet(&state.attached) && SDL_AtomicGet(&state.finished))
+          {
+               Mix_HaltChannel((int)i);
+          }
+     }
+}
+
+void nativeMixerDestroy(NativeSoundMixer &mixer)
+{
+     for (size_t i = 0; i < mixer.channels.size(); i++)
+     {
+          if (SDL_AtomicGet(&mixer.channels[i].attached))
+          {
+               Mix_HaltChannel((int)i);
+          }
+     }
+     mixer.channels.clear();
+     mixer.input.clear();
+     mixer.output.clear();
+     mixer.silence.clear();
+}
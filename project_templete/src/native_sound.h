@@ -0,0 +1,103 @@
+// Description:
+// Sound effects decoded at their own sample rate, for two things
+// Mix_LoadWAV_RW does badly. It converts each sound to the device format
+// with SDL_AudioCVT at load time: a scalar, one-sample-at-a-time
+// resampler with a serial chain of filters per sound. It also stores
+// every sound at the device rate and channel count, so a 22 kHz mono
+// effect on a 48 kHz stereo device takes over four times the memory.
+//
+// nativeLoadChunk() is a drop-in replacement that decodes the WAV and
+// converts it with audio_resample's SIMD polyphase filter, so the asset
+// loader's workers convert sounds in parallel and as fast as they decode.
+// Files SDL can't read as WAV fall back to Mix_LoadWAV_RW.
+//
+// A NativeSound instead keeps int16 samples at the file's rate and channel
+// layout, and a NativeSoundMixer resamples them on the fly while they
+// play, on ordinary mixer channels. The channel plays a silent carrier
+// chunk and an effect writes the sound over it, as for streamed sounds.
+// Each mixer channel keeps its own resampler and rebuilds its filter only
+// when a sound with another rate plays on it, so replaying a 22 kHz sound
+// is as cheap as playing a chunk. Use it where memory matters more than the
+// CPU the filter takes, which is about 8 taps per output sample at FAST.
+// =============================================================================
+
+#ifndef NATIVE_SOUND_H
+#define NATIVE_SOUND_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <vector>
+
+#include "audio_resample.h"
+
+struct NativeSound
+{
+     std::vector<Sint16> samples; // Interleaved
+     int rate;
+     int channels;
+     int frames;
+};
+
+struct NativeSoundMixer;
+
+struct NativeChannel
+{
+     NativeSoundMixer *mixer;
+     SDL_atomic_t attached; // The effect is registered on the channel
+     SDL_atomic_t finished; // The sound ended; nativeMixerUpdate() halts it
+
+     // Mixer thread only while attached
+     const NativeSound *sound;
+     int position;  // Next frame of the sound to resample
+     int loopsLeft; // -1 forever
+     bool tailFed;  // The filter's delay has been pushed out after the end
+
+     // Kept between sounds; rebuilt when the rate changes
+     AudioResampler resampler;
+     int resamplerRate; // 0 before the first sound
+};
+
+struct NativeSoundMixer
+{
+     std::vector<NativeChannel> channels; // One per mixer channel
+     AudioResampleQuality quality;
+     int rate;
+     int deviceChannels;
+     Uint16 format; // AUDIO_S16SYS or AUDIO_F32SYS
+     int frameBytes;
+
+     std::vector<float> input, output; // One block, mixer thread only
+     std::vector<Uint8> silence;
+     Mix_Chunk carrier;
+};
+
+// Decode a WAV without converting it; false with SDL's error set. Samples
+// that are not int16 are converted to it, the rate and channels are kept.
+bool nativeSoundLoad(NativeSound &sound, SDL_RWops *src, int freesrc);
+
+// The sound at the open mixer's rate, channels and format, in a chunk that
+// Mix_FreeChunk frees. nullptr with SDL's error set if the mixer is closed
+// or not 16-bit or float.
+Mix_Chunk *nativeSoundToChunk(const NativeSound &sound, AudioResampleQuality quality = AUDIO_RESAMPLE_MEDIUM);
+
+// Mix_LoadWAV_RW through nativeSoundLoad() and nativeSoundToChunk(); falls
+// back to Mix_LoadWAV_RW for other formats. Safe on any thread once the
+// mixer is open.
+Mix_Chunk *nativeLoadChunk(SDL_RWops *src, int freesrc, AudioResampleQuality quality = AUDIO_RESAMPLE_MEDIUM);
+
+// A resampler per mixer channel (Mix_AllocateChannels(-1) of them) in the
+// open mixer's format; false with a message on stderr if the mixer is
+// closed or not 16-bit or float
+bool nativeMixerInit(NativeSoundMixer &mixer, AudioResampleQuality quality = AUDIO_RESAMPLE_FAST);
+
+// Like Mix_PlayChannel; `sound` must outlive its playback. Returns the
+// channel, -1 on error.
+int nativeSoundPlay(NativeSoundMixer &mixer, const NativeSound &sound, int channel, int loops);
+
+// Halt the channels whose sound ended; call once per frame
+void nativeMixerUpdate(NativeSoundMixer &mixer);
+
+// Halt every channel playing a native sound and free the mixer
+void nativeMixerDestroy(NativeSoundMixer &mixer);
+
+#endif // NATIVE_SOUND_H
@@ -0,0 +1,316 @@
+#include "parallel_pixels.h"
+
+#include <vector>
+
+#include "hint_cache.h"
+
+namespace
+{
+     // Below this many pixels a single SDL call beats waking the pool
+     const int MIN_PARALLEL_PIXELS = 256 * 1024;
+     const int BAND_ROWS = 64;
+
+     bool enabled(JobSystem *jobs, int width, int height)
+     {
+          static const HintId parallelHint = hintIntern(PARALLEL_PIXELS_HINT);
+          return jobs != nullptr && jobSystemThreadCount(*jobs) > 1 && width > 0 && height > 0 &&
+                 (Sint64)width * height >= MIN_PARALLEL_PIXELS && hintBoolean(parallelHint, false);
+     }
+
+     int bandCountFor(int rows)
+     {
+          return (rows + BAND_ROWS - 1) / BAND_ROWS;
+     }
+
+     void runBands(JobSystem &jobs, JobFunction band, void *userdata, int bandCount)
+     {
+          JobCounter counter = {};
+          jobSystemSubmitRange(jobs, band, userdata, bandCount, &counter);
+          jobSystemWait(jobs, counter);
+     }
+
+     struct ConvertJob
+     {
+          int width, height;
+          Uint32 srcFormat, dstFormat;
+          const Uint8 *src;
+          int srcPitch;
+          Uint8 *dst;
+          int dstPitch;
+          SDL_atomic_t failed;
+     };
+
+     void convertBand(void *userdata, int band)
+     {
+          ConvertJob &job = *(ConvertJob *)userdata;
+          int y = band * BAND_ROWS;
+          int rows = SDL_min(BAND_ROWS, job.height - y);
+          if (SDL_ConvertPixels(job.width, rows, job.srcFormat, job.src + (size_t)y * job.srcPitch, job.srcPitch,
+                                job.dstFormat, job.dst + (size_t)y * job.dstPitch, job.dstPitch) != 0)
+          {
+               SDL_AtomicSet(&job.failed, 1);
+          }
+     }
+
+     struct ScaleJob
+     {
+          const Uint8 *src;
+          int srcPitch;
+          Uint8 *dst;
+          int dstPitch;
+          SDL_Rect from;    // Source rect
+          SDL_Rect to;      // Destination rect before clipping
+          SDL_Rect clipped; // Destination pixels actually written
+          int bpp;
+     };
+
+     // Nearest source coordinate for the centre of destination pixel `i`;
+     // exact integer math keeps every band independent of the others
+     inline int sourceIndex(int i, int fromStart, int fromSize, int toSize)
+     {
+          return fromStart + (int)(((Sint64)2 * i + 1) * fromSize / ((Sint64)2 * toSize));
+     }
+
+     void scaleBand(void *userdata, int band)
+     {
+          ScaleJob &job = *(ScaleJob *)userdata;
+          int yStart = job.clipped.y + band * BAND_ROWS;
+          int yEnd = SDL_min(yStart + BAND_ROWS, job.clipped.y + job.clipped.h);
+          for (int y = yStart; y < yEnd; y++)
+          {
+               int sy = sourceIndex(y - job.to.y, job.from.y, job.from.h, job.to.h);
+               const Uint8 *srcRow = job.src + (size_t)sy * job.srcPitch;
+               Uint8 *dstRow = job.dst + (size_t)y * job.dstPitch;
+               for (int x = job.clipped.x; x < job.clipped.x + job.clipped.w; x++)
+               {
+                    int sx = sourceIndex(x - job.to.x, job.from.x, job.from.w, job.to.w);
+                    if (job.bpp == 4)
+                    {
+                         ((Uint32 *)dstRow)[x] = ((const Uint32 *)srcRow)[sx];
+                    }
+                    else
+                    {
+                         SDL_memcpy(dstRow + x * job.bpp, srcRow + sx * job.bpp, job.bpp);
+                    }
+               }
+          }
+     }
+
+     struct BlitBand
+     {
+          SDL_Surface *src; // Views of this band's rows
+          SDL_Surface *dst;
+          SDL_Rect from;    // Within the views
+          SDL_Rect to;
+     };
+
+     struct BlitJob
+     {
+          std::vector<BlitBand> bands;
+          SDL_atomic_t failed;
+     };
+
+     void blitBand(void *userdata, int band)
+     {
+          BlitJob &job = *(BlitJob *)userdata;
+          BlitBand &part = job.bands[band];
+          if (SDL_BlitSurface(part.src, &part.from, part.dst, &part.to) != 0)
+          {
+               SDL_AtomicSet(&job.failed, 1);
+          }
+     }
+
+     // `rows` rows of `surface` from `y` as a surface of their own, sharing
+     // the pixels and palette
+     SDL_Surface *rowView(SDL_Surface *surface, int y, int rows)
+     {
+          SDL_Surface *view = SDL_CreateRGBSurfaceWithFormatFrom((Uint8 *)surface->pixels + (size_t)y * surface->pitch,
+                                                                 surface->w, rows, surface->format->BitsPerPixel,
+                                                                 surface->pitch, surface->format->format);
+          if (view != nullptr && surface->format->palette != nullptr)
+          {
+               SDL_SetSurfacePalette(view, surface->format->palette);
+          }
+          return view;
+     }
+
+     // Blend mode, modulation and colour key: everything SDL_BlitSurface
+     // reads from the source besides its pixels
+     bool copyBlitState(SDL_Surface *from, SDL_Surface *to)
+     {
+          SDL_BlendMode blend;
+          Uint8 r, g, b, a;
+          SDL_GetSurfaceBlendMode(from, &blend);
+          SDL_GetSurfaceColorMod(from, &r, &g, &b);
+          SDL_GetSurfaceAlphaMod(from, &a);
+          Uint32 key;
+          bool keyed = SDL_GetColorKey(from, &key) == 0;
+          return SDL_SetSurfaceBlendMode(to, blend) == 0 && SDL_SetSurfaceColorMod(to, r, g, b) == 0 &&
+                 SDL_SetSurfaceAlphaMod(to, a) == 0 && (!keyed || SDL_SetColorKey(to, SDL_TRUE, key) == 0);
+     }
+
+     void freeBands(BlitJob &job)
+     {
+          for (BlitBand &band : job.bands)
+          {
+               SDL_FreeSurface(band.src);
+               SDL_FreeSurface(band.dst);
+          }
+          job.bands.clear();
+     }
+
+     // The band scaler only copies pixels; anything SDL would blend, modulate
+     // or convert goes to SDL_BlitScaled
+     bool plainCopy(SDL_Surface *src, SDL_Surface *dst)
+     {
+          SDL_BlendMode blend;
+          Uint8 r, g, b, a;
+          SDL_GetSurfaceBlendMode(src, &blend);
+          SDL_GetSurfaceColorMod(src, &r, &g, &b);
+          SDL_GetSurfaceAlphaMod(src, &a);
+          return src->format->format == dst->format->format && src->format->BytesPerPixel >= 1 &&
+                 !SDL_ISPIXELFORMAT_INDEXED(src->format->format) && !SDL_HasColorKey(src) &&
+                 blend == SDL_BLENDMODE_NONE && (r & g & b & a) == 255 && !SDL_MUSTLOCK(src) && !SDL_MUSTLOCK(dst);
+     }
+}
+
+int parallelConvertPixels(JobSystem *jobs, int width, int height, Uint32 srcFormat, const void *src,
+                          int srcPitch, Uint32 dstFormat, void *dst, int dstPitch)
+{
+     // Planar YUV layouts cannot be cut into independent row bands
+     if (!enabled(jobs, width, height) || SDL_ISPIXELFORMAT_FOURCC(srcFormat) ||
+         SDL_ISPIXELFORMAT_FOURCC(dstFormat))
+     {
+          return SDL_ConvertPixels(width, height, srcFormat, src, srcPitch, dstFormat, dst, dstPitch);
+     }
+
+     ConvertJob job;
+     job.width = width;
+     job.height = height;
+     job.srcFormat = srcFormat;
+     job.dstFormat = dstFormat;
+     job.src = (const Uint8 *)src;
+     job.srcPitch = srcPitch;
+     job.dst = (Uint8 *)dst;
+     job.dstPitch = dstPitch;
+     SDL_AtomicSet(&job.failed, 0);
+     runBands(*jobs, convertBand, &job, bandCountFor(height));
+     return SDL_AtomicGet(&job.failed) ? -1 : 0;
+}
+
+int parallelBlitSurface(JobSystem *jobs, SDL_Surface *src, const SDL_Rect *srcrect, SDL_Surface *dst,
+                        SDL_Rect *dstrect)
+{
+     if (src == nullptr || dst == nullptr || (src->flags & SDL_RLEACCEL) || SDL_MUSTLOCK(src) || SDL_MUSTLOCK(dst))
+     {
+          return SDL_BlitSurface(src, srcrect, dst, dstrect);
+     }
+
+     // Clip the way SDL_UpperBlit does, so dstrect comes back the same
+     SDL_Rect from = srcrect != nullptr ? *srcrect : SDL_Rect{0, 0, src->w, src->h};
+     SDL_Rect to = {dstrect != nullptr ? dstrect->x : 0, dstrect != nullptr ? dstrect->y : 0, 0, 0};
+     if (from.x < 0)
+     {
+          from.w += from.x;
+          to.x -= from.x;
+          from.x = 0;
+     }
+     if (from.y < 0)
+     {
+          from.h += from.y;
+          to.y -= from.y;
+          from.y = 0;
+     }
+     from.w = SDL_min(from.w, src->w - from.x);
+     from.h = SDL_min(from.h, src->h - from.y);
+     const SDL_Rect &clip = dst->clip_rect;
+     if (clip.x > to.x)
+     {
+          from.w -= clip.x - to.x;
+          from.x += clip.x - to.x;
+          to.x = clip.x;
+     }
+     if (clip.y > to.y)
+     {
+          from.h -= clip.y - to.y;
+          from.y += clip.y - to.y;
+          to.y = clip.y;
+     }
+     from.w -= SDL_max(0, to.x + from.w - clip.x - clip.w);
+     from.h -= SDL_max(0, to.y + from.h - clip.y - clip.h);
+     if (from.w <= 0 || from.h <= 0 || !enabled(jobs, from.w, from.h))
+     {
+          return SDL_BlitSurface(src, srcrect, dst, dstrect);
+     }
+
+     BlitJob job;
+     SDL_AtomicSet(&job.failed, 0);
+     for (int y = 0; y < from.h; y += BAND_ROWS)
+     {
+          int rows = SDL_min(BAND_ROWS, from.h - y);
+          BlitBand band;
+          band.src = rowView(src, from.y + y, rows);
+          band.dst = rowView(dst, to.y + y, rows);
+          band.from = SDL_Rect{from.x, 0, from.w, rows};
+          band.to = SDL_Rect{to.x, 0, from.w, rows};
+          job.bands.push_back(band);
+          if (band.src == nullptr || band.dst == nullptr || !copyBlitState(src, band.src))
+          {
+               freeBands(job);
+               return SDL_BlitSurface(src, srcrect, dst, dstrect);
+          }
+     }
+     runBands(*jobs, blitBand, &job, (int)job.bands.size());
+     freeBands(job);
+
+     if (dstrect != nullptr)
+     {
+          *dstrect = SDL_Rect{to.x, to.y, from.w, from.h};
+     }
+     return SDL_AtomicGet(&job.failed) ? -1 : 0;
+}
+
+int parallelBlitScaled(JobSystem *jobs, SDL_Surface *src, const SDL_Rect *srcrect, SDL_Surface *dst,
+                       SDL_Rect *dstrect)
+{
+     if (src == nullptr || dst == nullptr)
+     {
+          return SDL_BlitScaled(src, srcrect, dst, dstrect);
+     }
+
+     SDL_Rect from = srcrect != nullptr ? *srcrect : SDL_Rect{0, 0, src->w, src->h};
+     SDL_Rect to = dstrect != nullptr ? *dstrect : SDL_Rect{0, 0, dst->w, dst->h};
+     SDL_Rect srcBounds = {0, 0, src->w, src->h};
+     SDL_Rect clipped;
+     bool sourceInside = SDL_IntersectRect(&from, &srcBounds, &clipped) && SDL_RectEquals(&from, &clipped);
+     if (!enabled(jobs, to.w, to.h) || !sourceInside || !plainCopy(src, dst))
+     {
+          return SDL_BlitScaled(src, srcrect, dst, dstrect);
+     }
+
+     if (!SDL_IntersectRect(&to, &dst->clip_rect, &clipped))
+     {
+          if (dstrect != nullptr)
+          {
+               dstrect->w = dstrect->h = 0;
+          }
+          return 0;
+     }
+
+     ScaleJob job;
+     job.src = (const Uint8 *)src->pixels;
+     job.srcPitch = src->pitch;
+     job.dst = (Uint8 *)dst->pixels;
+     job.dstPitch = dst->pitch;
+     job.from = from;
+     job.to = to;
+     job.clipped = clipped;
+     job.bpp = src->format->BytesPerPixel;
+     runBands(*jobs, scaleBand, &job, bandCountFor(clipped.h));
+
+     if (dstrect != nullptr)
+     {
+          *dstrect = clipped;
+     }
+     return 0;
+}
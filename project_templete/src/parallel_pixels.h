@@ -0,0 +1,44 @@
+// Description:
+// Row-band parallel versions of SDL_ConvertPixels and SDL_BlitScaled for
+// large images such as screenshots. The image is cut into horizontal bands
+// that run as jobs on the shared JobSystem, the calling thread included.
+// Every output pixel depends only on its own coordinates, so the result is
+// bit-identical for any thread count.
+//
+// parallelBlitSurface() covers blending too: each band is an ordinary
+// SDL_BlitSurface between row views of the two surfaces, carrying the
+// source's blend mode, modulation and colour key. SDL blits every row on
+// its own, so the bands add up to exactly what one call would produce;
+// each band pair has its own blit map, which makes them safe to run at
+// once.
+//
+// This is opt-in. Without the PARALLEL_PIXELS_HINT hint, or for small images
+// and cases the bands do not cover (planar YUV; scaled blits that blend,
+// modulate or convert; RLE-accelerated or lockable surfaces), the calls
+// fall through to SDL.
+// =============================================================================
+
+#ifndef PARALLEL_PIXELS_H
+#define PARALLEL_PIXELS_H
+
+#include <SDL2/SDL.h>
+
+#include "job_system.h"
+
+// Set to "1" (SDL_SetHint or the environment) to enable band parallelism
+#define PARALLEL_PIXELS_HINT "CATCH_PARALLEL_PIXELS"
+
+// Same contract as SDL_ConvertPixels; `jobs` may be nullptr
+int parallelConvertPixels(JobSystem *jobs, int width, int height, Uint32 srcFormat, const void *src,
+                          int srcPitch, Uint32 dstFormat, void *dst, int dstPitch);
+
+// Same contract as SDL_BlitSurface, for every blend mode, modulation and
+// colour key; `jobs` may be nullptr
+int parallelBlitSurface(JobSystem *jobs, SDL_Surface *src, const SDL_Rect *srcrect, SDL_Surface *dst,
+                        SDL_Rect *dstrect);
+
+// Same contract as SDL_BlitScaled (nearest sampling); `jobs` may be nullptr
+int parallelBlitScaled(JobSystem *jobs, SDL_Surface *src, const SDL_Rect *srcrect, SDL_Surface *dst,
+                       SDL_Rect *dstrect);
+
+#endif // PARALLEL_PIXELS_H
@@ -0,0 +1,348 @@
+#include "particle_system.h"
+
+#include "render_record.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define PARTICLE_SYSTEM_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PARTICLE_SYSTEM_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+     // Move, drag, pull and age [0, count); the arrays are padded, so the
+     // last step may run past count into entries nobody reads
+     void particleStep(ParticleEmitter &emitter, float seconds)
+     {
+          float *px = emitter.px.data(), *py = emitter.py.data();
+          float *vx = emitter.vx.data(), *vy = emitter.vy.data();
+          float *age = emitter.age.data();
+          const float *ageRate = emitter.ageRate.data();
+          const float keep = SDL_max(0.0f, 1.0f - emitter.desc.drag * seconds);
+          const float fall = emitter.desc.gravity * seconds;
+          const int count = emitter.count;
+          int i = 0;
+#if defined(PARTICLE_SYSTEM_SSE2)
+          const __m128 keep4 = _mm_set1_ps(keep), fall4 = _mm_set1_ps(fall), dt = _mm_set1_ps(seconds);
+          for (; i < count; i += 4)
+          {
+               const __m128 x = _mm_loadu_ps(vx + i);
+               const __m128 y = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(vy + i), keep4), fall4);
+               const __m128 newX = _mm_mul_ps(x, keep4);
+               _mm_storeu_ps(vx + i, newX);
+               _mm_storeu_ps(vy + i, y);
+               _mm_storeu_ps(px + i, _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(newX, dt)));
+               _mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(y, dt)));
+               _mm_storeu_ps(age + i, _mm_add_ps(_mm_loadu_ps(age + i), _mm_mul_ps(_mm_loadu_ps(ageRate + i), dt)));
+          }
+#elif defined(PARTICLE_SYSTEM_NEON)
+          const float32x4_t keep4 = vdupq_n_f32(keep), fall4 = vdupq_n_f32(fall), dt = vdupq_n_f32(seconds);
+          for (; i < count; i += 4)
+          {
+               const float32x4_t x = vmulq_f32(vld1q_f32(vx + i), keep4);
+               const float32x4_t y = vmlaq_f32(fall4, vld1q_f32(vy + i), keep4);
+               vst1q_f32(vx + i, x);
+               vst1q_f32(vy + i, y);
+               vst1q_f32(px + i, vmlaq_f32(vld1q_f32(px + i), x, dt));
+               vst1q_f32(py + i, vmlaq_f32(vld1q_f32(py + i), y, dt));
+               vst1q_f32(age + i, vmlaq_f32(vld1q_f32(age + i), vld1q_f32(ageRate + i), dt));
+          }
+#endif
+          for (; i < count; i++)
+          {
+               vx[i] *= keep;
+               vy[i] = vy[i] * keep + fall;
+               px[i] += vx[i] * seconds;
+               py[i] += vy[i] * seconds;
+               age[i] += ageRate[i] * seconds;
+          }
+     }
+
+     // Keep the live particles packed at the front
+     void particleCompact(ParticleEmitter &emitter)
+     {
+          int i = 0;
+          while (i < emitter.count)
+          {
+               if (emitter.age[i] < 1.0f)
+               {
+                    i++;
+                    continue;
+               }
+               const int last = --emitter.count;
+               emitter.px[i] = emitter.px[last];
+               emitter.py[i] = emitter.py[last];
+               emitter.vx[i] = emitter.vx[last];
+               emitter.vy[i] = emitter.vy[last];
+               emitter.age[i] = emitter.age[last];
+               emitter.ageRate[i] = emitter.ageRate[last];
+          }
+     }
+
+     // Corners 0--1 / 3--2 of every particle's square, eight floats each
+     void particleSquares(const ParticleEmitter &emitter, float *xy)
+     {
+          const float *px = emitter.px.data(), *py = emitter.py.data(), *age = emitter.age.data();
+          const float half = emitter.desc.sizeStart * 0.5f;
+          const float grow = (emitter.desc.sizeEnd - emitter.desc.sizeStart) * 0.5f;
+          const int count = emitter.count;
+          int i = 0;
+#if defined(PARTICLE_SYSTEM_SSE2)
+          const __m128 half4 = _mm_set1_ps(half), grow4 = _mm_set1_ps(grow);
+          for (; i + 4 <= count; i += 4, xy += 32)
+          {
+               const __m128 h = _mm_add_ps(half4, _mm_mul_ps(grow4, _mm_loadu_ps(age + i)));
+               const __m128 x = _mm_loadu_ps(px + i), y = _mm_loadu_ps(py + i);
+               const __m128 left = _mm_sub_ps(x, h), right = _mm_add_ps(x, h);
+               const __m128 top = _mm_sub_ps(y, h), bottom = _mm_add_ps(y, h);
+               // Corner pairs of particles 0 and 1 in the low halves, 2 and 3 in the high
+               __m128 c0 = _mm_unpacklo_ps(left, top), c1 = _mm_unpacklo_ps(right, top);
+               __m128 c2 = _mm_unpacklo_ps(right, bottom), c3 = _mm_unpacklo_ps(left, bottom);
+               _mm_storeu_ps(xy + 0, _mm_movelh_ps(c0, c1));
+               _mm_storeu_ps(xy + 4, _mm_movelh_ps(c2, c3));
+               _mm_storeu_ps(xy + 8, _mm_movehl_ps(c1, c0));
+               _mm_storeu_ps(xy + 12, _mm_movehl_ps(c3, c2));
+               c0 = _mm_unpackhi_ps(left, top), c1 = _mm_unpackhi_ps(right, top);
+               c2 = _mm_unpackhi_ps(right, bottom), c3 = _mm_unpackhi_ps(left, bottom);
+               _mm_storeu_ps(xy + 16, _mm_movelh_ps(c0, c1));
+               _mm_storeu_ps(xy + 20, _mm_movelh_ps(c2, c3));
+               _mm_storeu_ps(xy + 24, _mm_movehl_ps(c1, c0));
+               _mm_storeu_ps(xy + 28, _mm_movehl_ps(c3, c2));
+          }
+#elif defined(PARTICLE_SYSTEM_NEON)
+          const float32x4_t half4 = vdupq_n_f32(half), grow4 = vdupq_n_f32(grow);
+          for (; i + 4 <= count; i += 4, xy += 32)
+          {
+               const float32x4_t h = vmlaq_f32(half4, grow4, vld1q_f32(age + i));
+               const float32x4_t x = vld1q_f32(px + i), y = vld1q_f32(py + i);
+               const float32x4_t left = vsubq_f32(x, h), right = vaddq_f32(x, h);
+               const float32x4_t top = vsubq_f32(y, h), bottom = vaddq_f32(y, h);
+               const float32x4x2_t c0 = vzipq_f32(left, top), c1 = vzipq_f32(right, top);
+               const float32x4x2_t c2 = vzipq_f32(right, bottom), c3 = vzipq_f32(left, bottom);
+               for (int k = 0; k < 2; k++)
+               {
+                    float *out = xy + k * 16;
+                    vst1q_f32(out + 0, vcombine_f32(vget_low_f32(c0.val[k]), vget_low_f32(c1.val[k])));
+                    vst1q_f32(out + 4, vcombine_f32(vget_low_f32(c2.val[k]), vget_low_f32(c3.val[k])));
+                    vst1q_f32(out + 8, vcombine_f32(vget_high_f32(c0.val[k]), vget_high_f32(c1.val[k])));
+                    vst1q_f32(out + 12, vcombine_f32(vget_high_f32(c2.val[k]), vget_high_f32(c3.val[k])));
+               }
+          }
+#endif
+          for (; i < count; i++, xy += 8)
+          {
+               const float h = half + grow * age[i];
+               const float left = px[i] - h, right = px[i] + h, top = py[i] - h, bottom = py[i] + h;
+               xy[0] = left, xy[1] = top;
+               xy[2] = right, xy[3] = top;
+               xy[4] = right, xy[5] = bottom;
+               xy[6] = left, xy[7] = bottom;
+          }
+     }
+
+     // The ramp entry for every particle's age, on all four of its corners
+     void particleColors(const ParticleEmitter &emitter, SDL_Color *colors)
+     {
+          const float *age = emitter.age.data();
+          const float scale = (float)(PARTICLE_RAMP_SIZE - 1);
+          const int count = emitter.count;
+          int i = 0;
+#if defined(PARTICLE_SYSTEM_SSE2) || defined(PARTICLE_SYSTEM_NEON)
+          // Colours as whole words, so a corner quadruple is one store
+          Uint32 ramp[PARTICLE_RAMP_SIZE];
+          SDL_memcpy(ramp, emitter.ramp, sizeof(ramp));
+          int entries[4];
+#endif
+#if defined(PARTICLE_SYSTEM_SSE2)
+          const __m128 scale4 = _mm_set1_ps(scale), zero = _mm_setzero_ps();
+          for (; i + 4 <= count; i += 4, colors += 16)
+          {
+               const __m128 at = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(age + i), scale4), zero), scale4);
+               _mm_storeu_si128((__m128i *)entries, _mm_cvttps_epi32(at));
+               _mm_storeu_si128((__m128i *)(colors + 0), _mm_set1_epi32((int)ramp[entries[0]]));
+               _mm_storeu_si128((__m128i *)(colors + 4), _mm_set1_epi32((int)ramp[entries[1]]));
+               _mm_storeu_si128((__m128i *)(colors + 8), _mm_set1_epi32((int)ramp[entries[2]]));
+               _mm_storeu_si128((__m128i *)(colors + 12), _mm_set1_epi32((int)ramp[entries[3]]));
+          }
+#elif defined(PARTICLE_SYSTEM_NEON)
+          const float32x4_t scale4 = vdupq_n_f32(scale), zero = vdupq_n_f32(0.0f);
+          for (; i + 4 <= count; i += 4, colors += 16)
+          {
+               const float32x4_t at = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(age + i), scale4), zero), scale4);
+               vst1q_s32(entries, vcvtq_s32_f32(at));
+               for (int k = 0; k < 4; k++)
+               {
+                    vst1q_u32((Uint32 *)(colors + k * 4), vdupq_n_u32(ramp[entries[k]]));
+               }
+          }
+#endif
+          for (; i < count; i++, colors += 4)
+          {
+               const int index = SDL_clamp((int)(age[i] * scale), 0, PARTICLE_RAMP_SIZE - 1);
+               colors[0] = colors[1] = colors[2] = colors[3] = emitter.ramp[index];
+          }
+     }
+}
+
+ParticleEmitterDesc particleEmitterDefaults()
+{
+     ParticleEmitterDesc desc;
+     desc.rate = 0.0f;
+     desc.lifeMin = 0.4f;
+     desc.lifeMax = 0.9f;
+     desc.speedMin = 80.0f;
+     desc.speedMax = 260.0f;
+     desc.angle = (float)(-M_PI / 2);
+     desc.spread = (float)(M_PI * 0.8);
+     desc.gravity = 600.0f;
+     desc.drag = 1.5f;
+     desc.sizeStart = 5.0f;
+     desc.sizeEnd = 1.0f;
+     desc.colors[0] = SDL_Color{255, 255, 255, 255};
+     desc.colors[1] = SDL_Color{255, 220, 120, 220};
+     desc.colors[2] = SDL_Color{255, 120, 40, 0};
+     desc.colors[3] = desc.colors[2];
+     desc.colorCount = 3;
+     desc.texture = nullptr;
+     desc.blendMode = SDL_BLENDMODE_BLEND;
+     return desc;
+}
+
+void particleEmitterInit(ParticleEmitter &emitter, const ParticleEmitterDesc &desc, int capacity)
+{
+     emitter.desc = desc;
+     emitter.x = 0.0f;
+     emitter.y = 0.0f;
+     emitter.capacity = SDL_max(capacity, 0);
+     emitter.count = 0;
+     const size_t padded = ((size_t)emitter.capacity + 3) & ~(size_t)3;
+     emitter.px.assign(padded, 0.0f);
+     emitter.py.assign(padded, 0.0f);
+     emitter.vx.assign(padded, 0.0f);
+     emitter.vy.assign(padded, 0.0f);
+     emitter.age.assign(padded, 0.0f);
+     emitter.ageRate.assign(padded, 0.0f);
+     emitter.spawnDebt = 0.0f;
+     randomStreamInit(emitter.random, 0x9E3779B9u);
+
+     static const float CORNERS[8] = {0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f};
+     emitter.uv.resize((size_t)emitter.capacity * 8);
+     emitter.indices.resize((size_t)emitter.capacity * 6);
+     for (int i = 0; i < emitter.capacity; i++)
+     {
+          SDL_memcpy(&emitter.uv[(size_t)i * 8], CORNERS, sizeof(CORNERS));
+          const int quad[6] = {0, 1, 2, 0, 2, 3};
+          for (int k = 0; k < 6; k++)
+          {
+               emitter.indices[(size_t)i * 6 + k] = i * 4 + quad[k];
+          }
+     }
+     emitter.xy.clear();
+     emitter.vertexColors.clear();
+     particleEmitterSetRamp(emitter);
+}
+
+void particleEmitterSetRamp(ParticleEmitter &emitter)
+{
+     const SDL_Color *keys = emitter.desc.colors;
+     const int keyCount = SDL_clamp(emitter.desc.colorCount, 1, PARTICLE_RAMP_KEYS);
+     for (int i = 0; i < PARTICLE_RAMP_SIZE; i++)
+     {
+          const float t = (float)i / (PARTICLE_RAMP_SIZE - 1) * (keyCount - 1);
+          const int key = SDL_min((int)t, keyCount - 1);
+          const int next = SDL_min(key + 1, keyCount - 1);
+          const float f = t - key;
+          const SDL_Color &a = keys[key], &b = keys[next];
+          emitter.ramp[i] = SDL_Color{(Uint8)(a.r + (b.r - a.r) * f + 0.5f), (Uint8)(a.g + (b.g - a.g) * f + 0.5f),
+                                      (Uint8)(a.b + (b.b - a.b) * f + 0.5f), (Uint8)(a.a + (b.a - a.a) * f + 0.5f)};
+     }
+}
+
+int particleEmitterBurst(ParticleEmitter &emitter, float x, float y, int count)
+{
+     const int spawned = SDL_max(0, SDL_min(count, emitter.capacity - emitter.count));
+     const ParticleEmitterDesc &desc = emitter.desc;
+     const int first = emitter.count;
+     float *vx = emitter.vx.data() + first, *vy = emitter.vy.data() + first;
+     float *ageRate = emitter.ageRate.data() + first;
+
+     // Angles, speeds and lifetimes are drawn four at a time into the arrays
+     // they end up in, then turned into velocities and ageing rates
+     const float halfSpread = desc.spread * 0.5f;
+     randomStreamFloats(emitter.random, vx, spawned, desc.angle - halfSpread, desc.angle + halfSpread);
+     randomStreamFloats(emitter.random, vy, spawned, desc.speedMin, desc.speedMax);
+     randomStreamFloats(emitter.random, ageRate, spawned, desc.lifeMin, desc.lifeMax);
+     for (int i = 0; i < spawned; i++)
+     {
+          const float angle = vx[i], speed = vy[i];
+          emitter.px[first + i] = x;
+          emitter.py[first + i] = y;
+          vx[i] = SDL_cosf(angle) * speed;
+          vy[i] = SDL_sinf(angle) * speed;
+          emitter.age[first + i] = 0.0f;
+          ageRate[i] = 1.0f / SDL_max(ageRate[i], 0.001f);
+     }
+     emitter.count += spawned;
+     return spawned;
+}
+
+void particleEmitterUpdate(ParticleEmitter &emitter, float seconds)
+{
+     if (emitter.desc.rate > 0.0f)
+     {
+          emitter.spawnDebt += emitter.desc.rate * seconds;
+          const int owed = (int)emitter.spawnDebt;
+          emitter.spawnDebt -= owed;
+          particleEmitterBurst(emitter, emitter.x, emitter.y, owed);
+     }
+     if (emitter.count > 0)
+     {
+          particleStep(emitter, seconds);
+          particleCompact(emitter);
+     }
+}
+
+void particleEmitterClear(ParticleEmitter &emitter)
+{
+     emitter.count = 0;
+     emitter.spawnDebt = 0.0f;
+}
+
+int particleEmitterDraw(ParticleEmitter &emitter, SDL_Renderer *renderer, FrameArena *arena)
+{
+     const int count = emitter.count;
+     if (count == 0)
+     {
+          return 0;
+     }
+     float *xy = arena != nullptr ? frameArenaAllocArray<float>(*arena, (size_t)count * 8) : nullptr;
+     SDL_Color *colors = arena != nullptr ? frameArenaAllocArray<SDL_Color>(*arena, (size_t)count * 4) : nullptr;
+     if (xy == nullptr || colors == nullptr)
+     {
+          emitter.xy.resize((size_t)emitter.capacity * 8);
+          emitter.vertexColors.resize((size_t)emitter.capacity * 4);
+          xy = emitter.xy.data();
+          colors = emitter.vertexColors.data();
+     }
+     particleSquares(emitter, xy);
+     particleColors(emitter, colors);
+
+     SDL_Texture *texture = emitter.desc.texture;
+     SDL_BlendMode blendMode = SDL_BLENDMODE_NONE;
+     if (texture == nullptr)
+     {
+          // Untextured geometry blends with the draw blend mode
+          SDL_GetRenderDrawBlendMode(renderer, &blendMode);
+          renderRecordSetDrawBlendMode(renderer, emitter.desc.blendMode);
+     }
+     const int result = renderRecordGeometryRaw(renderer, texture, xy, 2 * sizeof(float), colors, sizeof(SDL_Color),
+                                                texture != nullptr ? emitter.uv.data() : nullptr, 2 * sizeof(float),
+                                                count * 4, emitter.indices.data(), count * 6, sizeof(int));
+     if (texture == nullptr)
+     {
+          renderRecordSetDrawBlendMode(renderer, blendMode);
+     }
+     return result;
+}
@@ -0,0 +1,104 @@
+// Description:
+// Particle emitters simulated in struct-of-arrays layout. Every live
+// particle is a position, a velocity, an age and an ageing rate in six
+// float arrays; one update moves, drags, pulls down and ages four of them
+// per step with SSE2 or NEON, then drops the ones that lived out their
+// life by moving the last particle into the hole.
+//
+// Drawing writes each particle as a square of four vertices straight into
+// the frame arena, position stream and colour stream only, and hands both
+// to one SDL_RenderGeometryRaw call per emitter. Colour and alpha over the
+// particle's life come from a ramp table looked up by age, four particles
+// at a time with the same instructions as the update; size is a lerp
+// from sizeStart to sizeEnd. The index buffer and the texture coordinates
+// never change, so they are built once for the emitter's capacity.
+//
+//     ParticleEmitterDesc sparks = particleEmitterDefaults();
+//     ParticleEmitter emitter;
+//     particleEmitterInit(emitter, sparks, 4096);
+//     particleEmitterBurst(emitter, x, y, 32);
+//     ...each tick
+//     particleEmitterUpdate(emitter, TICK_SECONDS);
+//     ...each frame
+//     particleEmitterDraw(emitter, renderer, &frameArena);
+// =============================================================================
+
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "frame_arena.h"
+#include "random_stream.h"
+
+const int PARTICLE_RAMP_SIZE = 64;   // Colours a particle passes through over its life
+const int PARTICLE_RAMP_KEYS = 4;
+
+struct ParticleEmitterDesc
+{
+     float rate;               // Particles per second emitted from (x, y); 0 for bursts only
+     float lifeMin, lifeMax;   // Seconds
+     float speedMin, speedMax; // Pixels per second
+     float angle, spread;      // Direction of emission and the width of the cone, radians
+     float gravity;            // Pixels per second squared, downwards
+     float drag;               // Fraction of the velocity lost per second
+     float sizeStart, sizeEnd; // Side of the square in pixels over its life
+
+     // Keys spread evenly over the particle's life, interpolated between
+     SDL_Color colors[PARTICLE_RAMP_KEYS];
+     int colorCount;
+
+     SDL_Texture *texture;    // nullptr draws solid squares
+     SDL_BlendMode blendMode; // For solid squares; textures use their own
+};
+
+struct ParticleEmitter
+{
+     ParticleEmitterDesc desc;
+     float x, y; // Where rate-driven particles start
+
+     int capacity;
+     int count; // Live particles, always the first `count` entries
+
+     // Per-particle data, padded to a multiple of four entries
+     std::vector<float> px, py;
+     std::vector<float> vx, vy;
+     std::vector<float> age;     // 0 at birth, dead at 1
+     std::vector<float> ageRate; // 1 / lifetime in seconds
+
+     SDL_Color ramp[PARTICLE_RAMP_SIZE];
+     float spawnDebt; // Fraction of a particle owed to `rate`
+     RandomStream random;
+
+     std::vector<float> uv;    // Four corners per particle, fixed
+     std::vector<int> indices; // Two triangles per particle, fixed
+     std::vector<float> xy;               // Scratch when drawing without an arena
+     std::vector<SDL_Color> vertexColors; // Scratch when drawing without an arena
+};
+
+// White sparks that spray upwards and fade out
+ParticleEmitterDesc particleEmitterDefaults();
+
+// Allocate room for `capacity` particles
+void particleEmitterInit(ParticleEmitter &emitter, const ParticleEmitterDesc &desc, int capacity);
+
+// Rebuild the colour ramp after changing emitter.desc.colors
+void particleEmitterSetRamp(ParticleEmitter &emitter);
+
+// Spawn up to `count` particles at (x, y); returns how many fit
+int particleEmitterBurst(ParticleEmitter &emitter, float x, float y, int count);
+
+// Emit from (emitter.x, emitter.y) at the desc's rate and advance every
+// particle by `seconds`
+void particleEmitterUpdate(ParticleEmitter &emitter, float seconds);
+
+// Drop every particle
+void particleEmitterClear(ParticleEmitter &emitter);
+
+// Submit the live particles in one SDL_RenderGeometryRaw call, with the
+// vertices in `arena` (nullptr uses the emitter's own scratch). Returns
+// 0 or SDL's error code.
+int particleEmitterDraw(ParticleEmitter &emitter, SDL_Renderer *renderer, FrameArena *arena);
+
+#endif // PARTICLE_SYSTEM_H
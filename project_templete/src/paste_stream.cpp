@@ -0,0 +1,412 @@
+#include "paste_stream.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+namespace
+{
+     bool quitting(PasteStream &stream)
+     {
+          SDL_LockMutex(stream.lock);
+          const bool quit = stream.quitting;
+          SDL_UnlockMutex(stream.lock);
+          return quit;
+     }
+
+     // Hands the chunk to the event queue, waiting while the queue is full
+     // (a paste of many chunks outruns a slow frame); false when it was
+     // dropped, filtered out or the stream is stopping
+     bool pushChunk(PasteStream &stream, PasteEvent code, PasteChunk *chunk)
+     {
+          SDL_Event event;
+          SDL_zero(event);
+          event.type = pasteStreamEventType();
+          event.user.code = code;
+          event.user.data1 = chunk;
+          event.user.data2 = &stream;
+          for (;;)
+          {
+               const int pushed = SDL_PushEvent(&event);
+               if (pushed > 0)
+               {
+                    return true;
+               }
+               if (pushed == 0 || quitting(stream))
+               {
+                    delete chunk;
+                    return false;
+               }
+               SDL_Delay(1);
+          }
+     }
+
+     PasteChunk *newChunk(const PasteJob &job)
+     {
+          PasteChunk *chunk = new PasteChunk;
+          chunk->request = job.request;
+          chunk->kind = job.kind;
+          chunk->offset = 0;
+          chunk->total = 0;
+          return chunk;
+     }
+
+     void fail(PasteStream &stream, const PasteJob &job, const char *error)
+     {
+          PasteChunk *chunk = newChunk(job);
+          chunk->error = error;
+          pushChunk(stream, PASTE_FAILED, chunk);
+     }
+
+     // Post `size` bytes as chunks; the last one is PASTE_DONE
+     void streamBytes(PasteStream &stream, const PasteJob &job, const Uint8 *bytes, size_t size)
+     {
+          size_t offset = 0;
+          do
+          {
+               const size_t length = SDL_min(size - offset, (size_t)PASTE_CHUNK_BYTES);
+               PasteChunk *chunk = newChunk(job);
+               chunk->offset = offset;
+               chunk->total = size;
+               chunk->bytes.assign(bytes + offset, bytes + offset + length);
+               offset += length;
+               if (!pushChunk(stream, offset < size ? PASTE_CHUNK : PASTE_DONE, chunk))
+               {
+                    return;
+               }
+          } while (offset < size);
+     }
+
+#if defined(_WIN32)
+     // Another program may hold the clipboard for a moment; wait a little
+     bool openClipboard()
+     {
+          for (int attempt = 0; attempt < 20; attempt++)
+          {
+               if (OpenClipboard(NULL))
+               {
+                    return true;
+               }
+               SDL_Delay(5);
+          }
+          return false;
+     }
+
+     // Copy the clipboard data of `format` out and close the clipboard at once
+     bool copyClipboard(UINT format, std::vector<Uint8> &data, const char *&error)
+     {
+          if (!IsClipboardFormatAvailable(format))
+          {
+               error = format == CF_DIB ? "No image on the clipboard" : "No text on the clipboard";
+               return false;
+          }
+          if (!openClipboard())
+          {
+               error = "The clipboard is busy";
+               return false;
+          }
+          bool copied = false;
+          HANDLE handle = GetClipboardData(format);
+          const void *memory = handle != NULL ? GlobalLock(handle) : nullptr;
+          if (memory != nullptr)
+          {
+               const Uint8 *bytes = (const Uint8 *)memory;
+               data.assign(bytes, bytes + GlobalSize(handle));
+               GlobalUnlock(handle);
+               copied = true;
+          }
+          CloseClipboard();
+          if (!copied)
+          {
+               error = "Unable to read the clipboard";
+          }
+          return copied;
+     }
+
+     void pasteText(PasteStream &stream, const PasteJob &job)
+     {
+          std::vector<Uint8> data;
+          const char *error = nullptr;
+          if (!copyClipboard(CF_UNICODETEXT, data, error))
+          {
+               fail(stream, job, error);
+               return;
+          }
+          const WCHAR *text = (const WCHAR *)data.data();
+          size_t length = 0;
+          const size_t limit = data.size() / sizeof(WCHAR);
+          while (length < limit && text[length] != 0)
+          {
+               length++;
+          }
+
+          // Convert a chunk's worth of UTF-16 at a time, never splitting a pair
+          const size_t unitsPerChunk = PASTE_CHUNK_BYTES / 3;
+          size_t at = 0;
+          Uint64 offset = 0;
+          do
+          {
+               size_t units = SDL_min(length - at, unitsPerChunk);
+               if (units > 0 && at + units < length && text[at + units - 1] >= 0xD800 && text[at + units - 1] < 0xDC00)
+               {
+                    units--;
+               }
+               PasteChunk *chunk = newChunk(job);
+               chunk->offset = offset;
+               if (units > 0)
+               {
+                    const int bytes = WideCharToMultiByte(CP_UTF8, 0, text + at, (int)units, NULL, 0, NULL, NULL);
+                    chunk->bytes.resize(bytes);
+                    WideCharToMultiByte(CP_UTF8, 0, text + at, (int)units, (char *)chunk->bytes.data(), bytes, NULL, NULL);
+               }
+               at += units;
+               offset += chunk->bytes.size();
+               chunk->total = at < length ? 0 : offset;
+               if (!pushChunk(stream, at < length ? PASTE_CHUNK : PASTE_DONE, chunk))
+               {
+                    return;
+               }
+          } while (at < length);
+     }
+
+     void pasteImage(PasteStream &stream, const PasteJob &job)
+     {
+          std::vector<Uint8> dib;
+          const char *error = nullptr;
+          if (!copyClipboard(CF_DIB, dib, error))
+          {
+               fail(stream, job, error);
+               return;
+          }
+          if (dib.size() < sizeof(BITMAPINFOHEADER))
+          {
+               fail(stream, job, "The clipboard image is truncated");
+               return;
+          }
+
+          // A packed DIB is a .bmp file without its 14-byte file header
+          const BITMAPINFOHEADER &info = *(const BITMAPINFOHEADER *)dib.data();
+          DWORD colors = info.biClrUsed;
+          if (colors == 0 && info.biBitCount <= 8)
+          {
+               colors = 1u << info.biBitCount;
+          }
+          DWORD masks = info.biSize == sizeof(BITMAPINFOHEADER) && info.biCompression == BI_BITFIELDS ? 12 : 0;
+          std::vector<Uint8> file(sizeof(BITMAPFILEHEADER) + dib.size());
+          BITMAPFILEHEADER header;
+          header.bfType = 0x4D42; // "BM"
+          header.bfSize = (DWORD)file.size();
+          header.bfReserved1 = 0;
+          header.bfReserved2 = 0;
+          header.bfOffBits = (DWORD)(sizeof(BITMAPFILEHEADER) + info.biSize + masks + colors * 4);
+          SDL_memcpy(file.data(), &header, sizeof(header));
+          SDL_memcpy(file.data() + sizeof(header), dib.data(), dib.size());
+          dib.clear();
+          dib.shrink_to_fit();
+          streamBytes(stream, job, file.data(), file.size());
+     }
+#else
+     void pasteText(PasteStream &stream, const PasteJob &job)
+     {
+          streamBytes(stream, job, (const Uint8 *)job.text.data(), job.text.size());
+     }
+
+     void pasteImage(PasteStream &stream, const PasteJob &job)
+     {
+          fail(stream, job, "Clipboard images are only available on Windows");
+     }
+#endif
+
+     void enumerate(PasteStream &stream, const PasteJob &job)
+     {
+          std::vector<DirEntry> entries;
+          if (!dirList(job.path.c_str(), entries, job.recursive))
+          {
+               // Not a directory: a dropped file is one entry
+               SDL_RWops *file = SDL_RWFromFile(job.path.c_str(), "rb");
+               if (file == nullptr)
+               {
+                    fail(stream, job, SDL_GetError());
+                    return;
+               }
+               DirEntry entry;
+               entry.directory = false;
+               entry.size = (Uint64)SDL_max(SDL_RWsize(file), (Sint64)0);
+               entry.modified = 0;
+               SDL_RWclose(file);
+               entries.push_back(entry);
+          }
+
+          size_t at = 0;
+          do
+          {
+               const size_t count = SDL_min(entries.size() - at, (size_t)PASTE_DROP_BATCH);
+               PasteChunk *chunk = newChunk(job);
+               chunk->root = job.path;
+               chunk->offset = at;
+               chunk->entries.assign(std::make_move_iterator(entries.begin() + at),
+                                     std::make_move_iterator(entries.begin() + at + count));
+               at += count;
+               if (!pushChunk(stream, at < entries.size() ? PASTE_CHUNK : PASTE_DONE, chunk))
+               {
+                    return;
+               }
+          } while (at < entries.size());
+     }
+
+     int SDLCALL pasteWorkerMain(void *data)
+     {
+          PasteStream &stream = *(PasteStream *)data;
+          SDL_LockMutex(stream.lock);
+          for (;;)
+          {
+               while (!stream.quitting && stream.jobs.empty())
+               {
+                    SDL_CondWait(stream.wake, stream.lock);
+               }
+               if (stream.quitting)
+               {
+                    break;
+               }
+               PasteJob job = std::move(stream.jobs.front());
+               stream.jobs.pop_front();
+               SDL_UnlockMutex(stream.lock);
+
+               switch (job.kind)
+               {
+               case PASTE_TEXT:
+                    pasteText(stream, job);
+                    break;
+               case PASTE_IMAGE_BMP:
+                    pasteImage(stream, job);
+                    break;
+               case PASTE_ENTRIES:
+                    enumerate(stream, job);
+                    break;
+               }
+               SDL_LockMutex(stream.lock);
+          }
+          SDL_UnlockMutex(stream.lock);
+          return 0;
+     }
+
+     Uint32 queueJob(PasteStream &stream, PasteJob &job)
+     {
+          if (stream.worker == nullptr)
+          {
+               return 0;
+          }
+          SDL_LockMutex(stream.lock);
+          job.request = ++stream.nextRequest;
+          const Uint32 request = job.request;
+          stream.jobs.push_back(std::move(job));
+          SDL_CondSignal(stream.wake);
+          SDL_UnlockMutex(stream.lock);
+          return request;
+     }
+}
+
+Uint32 pasteStreamEventType()
+{
+     static const Uint32 type = SDL_RegisterEvents(1);
+     return type;
+}
+
+bool pasteStreamStart(PasteStream &stream)
+{
+     stream.worker = nullptr;
+     stream.quitting = false;
+     stream.nextRequest = 0;
+     stream.jobs.clear();
+     if (pasteStreamEventType() == (Uint32)-1)
+     {
+          SDL_SetError("No SDL event types left for paste streaming");
+          stream.lock = nullptr;
+          stream.wake = nullptr;
+          return false;
+     }
+     stream.lock = SDL_CreateMutex();
+     stream.wake = SDL_CreateCond();
+     if (stream.lock != nullptr && stream.wake != nullptr)
+     {
+          stream.worker = SDL_CreateThread(pasteWorkerMain, "PasteStream", &stream);
+     }
+     if (stream.worker == nullptr)
+     {
+          pasteStreamStop(stream);
+          return false;
+     }
+     return true;
+}
+
+Uint32 pasteStreamRequestText(PasteStream &stream)
+{
+     PasteJob job;
+     job.kind = PASTE_TEXT;
+     job.recursive = false;
+#if !defined(_WIN32)
+     if (stream.worker != nullptr)
+     {
+          char *text = SDL_GetClipboardText();
+          if (text != nullptr)
+          {
+               job.text = text;
+               SDL_free(text);
+          }
+     }
+#endif
+     return queueJob(stream, job);
+}
+
+Uint32 pasteStreamRequestImage(PasteStream &stream)
+{
+     PasteJob job;
+     job.kind = PASTE_IMAGE_BMP;
+     job.recursive = false;
+     return queueJob(stream, job);
+}
+
+Uint32 pasteStreamEnumerate(PasteStream &stream, const char *path, bool recursive)
+{
+     PasteJob job;
+     job.kind = PASTE_ENTRIES;
+     job.path = path != nullptr ? path : "";
+     job.recursive = recursive;
+     return queueJob(stream, job);
+}
+
+void pasteStreamEventFree(SDL_Event &event)
+{
+     if (event.type == pasteStreamEventType() && event.type != (Uint32)-1)
+     {
+          delete (PasteChunk *)event.user.data1;
+          event.user.data1 = nullptr;
+     }
+}
+
+void pasteStreamStop(PasteStream &stream)
+{
+     if (stream.worker != nullptr)
+     {
+          SDL_LockMutex(stream.lock);
+          stream.quitting = true;
+          stream.jobs.clear();
+          SDL_CondSignal(stream.wake);
+          SDL_UnlockMutex(stream.lock);
+          SDL_WaitThread(stream.worker, nullptr);
+          stream.worker = nullptr;
+     }
+     if (stream.wake != nullptr)
+     {
+          SDL_DestroyCond(stream.wake);
+          stream.wake = nullptr;
+     }
+     if (stream.lock != nullptr)
+     {
+          SDL_DestroyMutex(stream.lock);
+          stream.lock = nullptr;
+     }
+}
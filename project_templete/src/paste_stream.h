@@ -0,0 +1,109 @@
+// Description:
+// Pasting and dropping without stalling the UI thread. SDL_GetClipboardText
+// converts the whole clipboard before it returns, and a directory dropped
+// as SDL_DROPFILE leaves the caller to walk it, both on the event thread,
+// so pasting a 50 MB image or dropping a large asset tree freezes an editor
+// for as long as that takes. A PasteStream does the work on a thread of its
+// own and hands the result back in chunks, as SDL events of the type
+// pasteStreamEventType():
+// - pasteStreamRequestText(): the clipboard's text as UTF-8, in chunks of
+//   PASTE_CHUNK_BYTES;
+// - pasteStreamRequestImage(): the clipboard's image as a BMP file (load it
+//   with SDL_LoadBMP_RW once it is complete), in the same chunks;
+// - pasteStreamEnumerate(): the entries below a dropped path, in batches
+//   of PASTE_DROP_BATCH, listed with dirList().
+//
+// On Windows the worker opens the clipboard itself, copies the data out and
+// closes it again at once, so other programs are never kept waiting while
+// the chunks are converted and delivered. Elsewhere the clipboard belongs
+// to the video thread: text is read with SDL_GetClipboardText when it is
+// requested (the conversion to chunks still happens on the worker), and
+// images are not available.
+//
+// The event is an SDL_UserEvent: `code` is the PasteEvent, `data1` a
+// PasteChunk and `data2` the PasteStream. Chunks of one request arrive in
+// order, ending with PASTE_DONE or PASTE_FAILED; release each with
+// pasteStreamEventFree() once handled.
+// =============================================================================
+
+#ifndef PASTE_STREAM_H
+#define PASTE_STREAM_H
+
+#include <SDL2/SDL.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "file_watch.h"
+
+#define PASTE_CHUNK_BYTES (256 * 1024)
+#define PASTE_DROP_BATCH 256
+
+enum PasteKind
+{
+     PASTE_TEXT,      // UTF-8, no terminator
+     PASTE_IMAGE_BMP, // A whole .bmp file once the chunks are joined
+     PASTE_ENTRIES    // Entries of a dropped path
+};
+
+enum PasteEvent
+{
+     PASTE_CHUNK,  // More data; more chunks follow
+     PASTE_DONE,   // The last data (possibly none)
+     PASTE_FAILED  // `error` says why; nothing follows
+};
+
+struct PasteChunk
+{
+     Uint32 request; // As returned by the request call
+     PasteKind kind;
+     Uint64 offset;                 // Of `bytes` in the payload, or of `entries` in the listing
+     Uint64 total;                  // Payload bytes once known (on PASTE_DONE for text), else 0
+     std::vector<Uint8> bytes;      // Text and images
+     std::string root;              // Entries: the dropped path
+     std::vector<DirEntry> entries; // Relative to `root`; a dropped file is one entry named ""
+     std::string error;
+};
+
+struct PasteJob
+{
+     Uint32 request;
+     PasteKind kind;
+     std::string path; // Entries: what to list
+     bool recursive;
+     std::string text; // Text read on the requesting thread, where the worker cannot
+};
+
+struct PasteStream
+{
+     SDL_Thread *worker;
+     SDL_mutex *lock;
+     SDL_cond *wake;
+     std::deque<PasteJob> jobs; // Guarded by lock
+     bool quitting;             // Guarded by lock
+     Uint32 nextRequest;
+};
+
+// Registers the event type on first use; (Uint32)-1 when SDL has none left
+Uint32 pasteStreamEventType();
+
+// Start the worker. The PasteStream must stay at its address until
+// pasteStreamStop(), as events point at it. False with SDL's error set
+bool pasteStreamStart(PasteStream &stream);
+
+// Queue a request; returns its id, 0 when the stream is not running
+Uint32 pasteStreamRequestText(PasteStream &stream);
+Uint32 pasteStreamRequestImage(PasteStream &stream);
+
+// List `path` (an SDL_DROPFILE's file) and, with `recursive`, everything below it
+Uint32 pasteStreamEnumerate(PasteStream &stream, const char *path, bool recursive = true);
+
+// Release the chunk of a paste-stream event; other events are left alone
+void pasteStreamEventFree(SDL_Event &event);
+
+// Stops the worker; requests not started are dropped. Events already
+// queued stay queued, so drain them first
+void pasteStreamStop(PasteStream &stream);
+
+#endif // PASTE_STREAM_H
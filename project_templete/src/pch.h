@@ -0,0 +1,15 @@
+// Description:
+// Precompiled header for the incremental build: the SDL2 library headers
+// every module pulls in, parsed once. Add only headers that rarely change;
+// the build force-includes it into each translation unit.
+// =============================================================================
+
+#ifndef PCH_H
+#define PCH_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_mixer.h>
+#include <SDL2/SDL_ttf.h>
+
+#endif // PCH_H
@@ -0,0 +1,301 @@
+// Description:
+// Pixel formats known at compile time. SDL_MapRGBA, SDL_GetRGBA and
+// SDL_ConvertPixels take an SDL_PixelFormat or enum at run time and look
+// up masks, shifts and losses on every call, and the generic conversion
+// paths do it per pixel; a tool's own pixel loop built on them cannot be
+// inlined or vectorized. PixelFormat<F> derives the same layout from the
+// SDL_PIXELFORMAT_* value itself, as constants, so pack, unpack and
+// convert compile down to the few shifts and masks the pair needs.
+//
+// Any packed format (8-, 16- and 32-bit, SDL_PIXELTYPE_PACKED*) works, as
+// do RGB24 and BGR24; a format SDL does not describe with masks (indexed,
+// FOURCC/YUV) fails to compile. The arithmetic is SDL's: a channel widens
+// to 8 bits by bit replication and narrows by truncation, a format
+// without alpha reads as opaque and its X bits are written as zero.
+// Where both formats give a channel the same width it is moved without
+// going through 8 bits, so 10-bit channels survive ARGB2101010 to
+// ABGR2101010 intact.
+//
+//     Uint32 px = PixelFormat<SDL_PIXELFORMAT_RGB565>::pack(r, g, b);
+//     pixelConvertRect<SDL_PIXELFORMAT_ABGR8888, SDL_PIXELFORMAT_RGB565>(
+//         w, h, src, srcPitch, dst, dstPitch);
+//
+// Packed pixels are in native byte order, as SDL stores them; RGB24 and
+// BGR24 name the byte order in memory.
+// =============================================================================
+
+#ifndef PIXEL_FORMAT_H
+#define PIXEL_FORMAT_H
+
+#include <SDL2/SDL.h>
+#include <cstring>
+
+struct PixelChannel
+{
+     int shift;
+     int bits; // 0 when the format lacks the channel
+};
+
+struct PixelColor
+{
+     Uint8 r, g, b, a;
+};
+
+namespace pixel_format_detail
+{
+     // Bits per slot, most significant first, as SDL_PixelFormatEnumToMasks
+     // lays them out
+     constexpr int slotBits(Uint32 layout, int slot)
+     {
+          switch (layout)
+          {
+          case SDL_PACKEDLAYOUT_332:
+               return slot == 0 ? 0 : slot == 3 ? 2 : 3;
+          case SDL_PACKEDLAYOUT_4444:
+               return 4;
+          case SDL_PACKEDLAYOUT_1555:
+               return slot == 0 ? 1 : 5;
+          case SDL_PACKEDLAYOUT_5551:
+               return slot == 3 ? 1 : 5;
+          case SDL_PACKEDLAYOUT_565:
+               return slot == 0 ? 0 : slot == 2 ? 6 : 5;
+          case SDL_PACKEDLAYOUT_8888:
+               return 8;
+          case SDL_PACKEDLAYOUT_2101010:
+               return slot == 0 ? 2 : 10;
+          case SDL_PACKEDLAYOUT_1010102:
+               return slot == 3 ? 2 : 10;
+          default:
+               return 0;
+          }
+     }
+
+     constexpr PixelChannel slotChannel(Uint32 layout, int slot)
+     {
+          int shift = 0;
+          for (int later = slot + 1; later < 4; later++)
+          {
+               shift += slotBits(layout, later);
+          }
+          return {shift, slotBits(layout, slot)};
+     }
+
+     // Which slot holds channel 'r', 'g', 'b' or 'a' for a packed order;
+     // -1 when it has none (X is not a channel)
+     constexpr int packedSlot(Uint32 order, char channel)
+     {
+          const char *names = order == SDL_PACKEDORDER_XRGB   ? "xrgb"
+                              : order == SDL_PACKEDORDER_RGBX ? "rgbx"
+                              : order == SDL_PACKEDORDER_ARGB ? "argb"
+                              : order == SDL_PACKEDORDER_RGBA ? "rgba"
+                              : order == SDL_PACKEDORDER_XBGR ? "xbgr"
+                              : order == SDL_PACKEDORDER_BGRX ? "bgrx"
+                              : order == SDL_PACKEDORDER_ABGR ? "abgr"
+                              : order == SDL_PACKEDORDER_BGRA ? "bgra"
+                                                              : "xxxx";
+          for (int slot = 0; slot < 4; slot++)
+          {
+               if (names[slot] == channel)
+               {
+                    return slot;
+               }
+          }
+          return -1;
+     }
+
+     constexpr bool isPacked(Uint32 format)
+     {
+          return !SDL_ISPIXELFORMAT_FOURCC(format) &&
+                 (SDL_PIXELTYPE(format) == SDL_PIXELTYPE_PACKED8 || SDL_PIXELTYPE(format) == SDL_PIXELTYPE_PACKED16 ||
+                  SDL_PIXELTYPE(format) == SDL_PIXELTYPE_PACKED32);
+     }
+
+     constexpr PixelChannel channelOf(Uint32 format, char channel)
+     {
+          if (format == SDL_PIXELFORMAT_RGB24 || format == SDL_PIXELFORMAT_BGR24)
+          {
+               // Loaded as byte0 | byte1 << 8 | byte2 << 16
+               const char *names = format == SDL_PIXELFORMAT_RGB24 ? "rgb" : "bgr";
+               for (int i = 0; i < 3; i++)
+               {
+                    if (names[i] == channel)
+                    {
+                         return {8 * i, 8};
+                    }
+               }
+               return {0, 0};
+          }
+          const int slot = packedSlot(SDL_PIXELORDER(format), channel);
+          return slot < 0 ? PixelChannel{0, 0} : slotChannel(SDL_PIXELLAYOUT(format), slot);
+     }
+
+     constexpr Uint32 maskOf(PixelChannel channel)
+     {
+          return channel.bits == 0 ? 0 : ((1u << channel.bits) - 1u) << channel.shift;
+     }
+
+     // Repeat a `from`-bit value's bits until it is `to` bits wide, then
+     // keep the top `to`: widening by replication, narrowing by truncation
+     constexpr Uint32 rescale(Uint32 value, int from, int to)
+     {
+          if (from >= to)
+          {
+               return value >> (from - to);
+          }
+          Uint32 wide = 0;
+          int filled = 0;
+          while (filled < to)
+          {
+               wide = (wide << from) | value;
+               filled += from;
+          }
+          return wide >> (filled - to);
+     }
+
+     // `from` of `pixel` as `to`; a channel the source lacks reads as
+     // `missing`. Both are constants wherever this is used, so it folds away
+     constexpr Uint32 moveChannel(Uint32 pixel, PixelChannel from, PixelChannel to, Uint32 missing)
+     {
+          if (to.bits == 0)
+          {
+               return 0;
+          }
+          const Uint32 value = from.bits == 0 ? rescale(missing, 8, to.bits)
+                                              : rescale((pixel & maskOf(from)) >> from.shift, from.bits, to.bits);
+          return value << to.shift;
+     }
+}
+
+template <Uint32 Format>
+struct PixelFormat
+{
+     static_assert(pixel_format_detail::isPacked(Format) || Format == SDL_PIXELFORMAT_RGB24 ||
+                       Format == SDL_PIXELFORMAT_BGR24,
+                   "PixelFormat needs a packed or 24-bit RGB format");
+
+     static constexpr Uint32 format = Format;
+     static constexpr int bytesPerPixel = SDL_BYTESPERPIXEL(Format);
+     static constexpr PixelChannel red = pixel_format_detail::channelOf(Format, 'r');
+     static constexpr PixelChannel green = pixel_format_detail::channelOf(Format, 'g');
+     static constexpr PixelChannel blue = pixel_format_detail::channelOf(Format, 'b');
+     static constexpr PixelChannel alpha = pixel_format_detail::channelOf(Format, 'a');
+     static constexpr bool hasAlpha = alpha.bits != 0;
+
+     // SDL_MapRGBA
+     static constexpr Uint32 pack(Uint8 r, Uint8 g, Uint8 b, Uint8 a = 255)
+     {
+          using namespace pixel_format_detail;
+          return (red.bits ? rescale(r, 8, red.bits) << red.shift : 0) |
+                 (green.bits ? rescale(g, 8, green.bits) << green.shift : 0) |
+                 (blue.bits ? rescale(b, 8, blue.bits) << blue.shift : 0) |
+                 (alpha.bits ? rescale(a, 8, alpha.bits) << alpha.shift : 0);
+     }
+
+     // SDL_GetRGBA
+     static constexpr PixelColor unpack(Uint32 pixel)
+     {
+          using namespace pixel_format_detail;
+          return {(Uint8)rescale((pixel & maskOf(red)) >> red.shift, red.bits, 8),
+                  (Uint8)rescale((pixel & maskOf(green)) >> green.shift, green.bits, 8),
+                  (Uint8)rescale((pixel & maskOf(blue)) >> blue.shift, blue.bits, 8),
+                  (Uint8)(alpha.bits ? rescale((pixel & maskOf(alpha)) >> alpha.shift, alpha.bits, 8) : 255)};
+     }
+
+     static Uint32 load(const void *at)
+     {
+          const Uint8 *p = (const Uint8 *)at;
+          if (bytesPerPixel == 4)
+          {
+               Uint32 pixel;
+               std::memcpy(&pixel, p, 4);
+               return pixel;
+          }
+          if (bytesPerPixel == 2)
+          {
+               Uint16 pixel;
+               std::memcpy(&pixel, p, 2);
+               return pixel;
+          }
+          if (bytesPerPixel == 3)
+          {
+               return (Uint32)p[0] | ((Uint32)p[1] << 8) | ((Uint32)p[2] << 16);
+          }
+          return p[0];
+     }
+
+     static void store(void *at, Uint32 pixel)
+     {
+          Uint8 *p = (Uint8 *)at;
+          if (bytesPerPixel == 4)
+          {
+               std::memcpy(p, &pixel, 4);
+          }
+          else if (bytesPerPixel == 2)
+          {
+               const Uint16 narrow = (Uint16)pixel;
+               std::memcpy(p, &narrow, 2);
+          }
+          else if (bytesPerPixel == 3)
+          {
+               p[0] = (Uint8)pixel;
+               p[1] = (Uint8)(pixel >> 8);
+               p[2] = (Uint8)(pixel >> 16);
+          }
+          else
+          {
+               p[0] = (Uint8)pixel;
+          }
+     }
+};
+
+// One pixel of `From` as `To`
+template <Uint32 From, Uint32 To>
+constexpr Uint32 pixelConvert(Uint32 pixel)
+{
+     using namespace pixel_format_detail;
+     typedef PixelFormat<From> S;
+     typedef PixelFormat<To> D;
+     if (From == To)
+     {
+          return pixel;
+     }
+     return moveChannel(pixel, S::red, D::red, 0) | moveChannel(pixel, S::green, D::green, 0) |
+            moveChannel(pixel, S::blue, D::blue, 0) | moveChannel(pixel, S::alpha, D::alpha, 255);
+}
+
+// `count` pixels; the rows may not overlap unless the formats match
+template <Uint32 From, Uint32 To>
+void pixelConvertRow(const void *src, void *dst, int count)
+{
+     typedef PixelFormat<From> S;
+     typedef PixelFormat<To> D;
+     if (From == To)
+     {
+          std::memmove(dst, src, (size_t)count * S::bytesPerPixel);
+          return;
+     }
+     const Uint8 *in = (const Uint8 *)src;
+     Uint8 *out = (Uint8 *)dst;
+     for (int i = 0; i < count; i++)
+     {
+          D::store(out + i * D::bytesPerPixel, pixelConvert<From, To>(S::load(in + i * S::bytesPerPixel)));
+     }
+}
+
+// Same contract as SDL_ConvertPixels for these two formats
+template <Uint32 From, Uint32 To>
+int pixelConvertRect(int width, int height, const void *src, int srcPitch, void *dst, int dstPitch)
+{
+     if (src == nullptr || dst == nullptr || width < 0 || height < 0)
+     {
+          return SDL_InvalidParamError(src == nullptr ? "src" : dst == nullptr ? "dst" : "size");
+     }
+     for (int y = 0; y < height; y++)
+     {
+          pixelConvertRow<From, To>((const Uint8 *)src + (ptrdiff_t)y * srcPitch, (Uint8 *)dst + (ptrdiff_t)y * dstPitch,
+                                    width);
+     }
+     return 0;
+}
+
+#endif // PIXEL_FORMAT_H
@@ -0,0 +1,773 @@
+#include "png_encode.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "checksum.h"
+
+namespace
+{
+     const int MAX_CODE_BITS = 15;
+     const int MAX_CODE_LENGTH_BITS = 7;
+     const int WINDOW_SIZE = 32768;
+     const int DEFLATE_MIN_MATCH = 3;
+     const int MAX_MATCH = 258;
+     const int DEFLATE_HASH_BITS = 15;
+     const size_t BLOCK_SYMBOLS = 1 << 15; // Symbols per dynamic Huffman block
+     const size_t STORED_BLOCK_BYTES = 65535;
+     const size_t MIN_STRIP_BYTES = 256 * 1024; // Filtered bytes; smaller strips lose too much ratio
+
+     // Hash chain length and "good enough" match length per level
+     const int CHAIN_LENGTH[10] = {0, 4, 8, 16, 32, 64, 128, 256, 1024, 4096};
+     const int NICE_LENGTH[10] = {0, 8, 16, 32, 64, 128, 128, 258, 258, 258};
+
+     const Uint16 LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10,  11,  13,  15,  17,  19,  23, 27,
+                                     31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+     const Uint8 LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+     const Uint16 DIST_BASE[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                   193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+     const Uint8 DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+     const Uint8 CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+     struct Tables
+     {
+          Uint8 lengthCode[MAX_MATCH + 1];
+          Uint8 distCode[512]; // zlib's layout: dist - 1 below 256, else 256 + ((dist - 1) >> 7)
+
+          Tables()
+          {
+               for (int code = 0; code < 28; code++)
+               {
+                    for (int length = LENGTH_BASE[code]; length < LENGTH_BASE[code] + (1 << LENGTH_EXTRA[code]) && length < MAX_MATCH;
+                         length++)
+                    {
+                         lengthCode[length] = (Uint8)code;
+                    }
+               }
+               lengthCode[MAX_MATCH] = 28;
+               for (int code = 0; code < 30; code++)
+               {
+                    for (int dist = DIST_BASE[code]; dist < DIST_BASE[code] + (1 << DIST_EXTRA[code]); dist++)
+                    {
+                         const int d = dist - 1;
+                         distCode[d < 256 ? d : 256 + (d >> 7)] = (Uint8)code;
+                    }
+               }
+          }
+     };
+
+     const Tables &tables()
+     {
+          static const Tables instance;
+          return instance;
+     }
+
+     int distCodeOf(int dist)
+     {
+          const int d = dist - 1;
+          return tables().distCode[d < 256 ? d : 256 + (d >> 7)];
+     }
+
+     const Uint32 ADLER_BASE = 65521;
+
+     Uint32 adler32(const Uint8 *data, size_t size)
+     {
+          Uint32 a = 1, b = 0;
+          while (size > 0)
+          {
+               // The largest run before b can overflow 32 bits
+               size_t run = SDL_min(size, (size_t)5552);
+               size -= run;
+               while (run-- > 0)
+               {
+                    a += *data++;
+                    b += a;
+               }
+               a %= ADLER_BASE;
+               b %= ADLER_BASE;
+          }
+          return b << 16 | a;
+     }
+
+     // zlib's adler32_combine: the sum of A followed by B, from both sums
+     Uint32 adler32Combine(Uint32 first, Uint32 second, size_t secondSize)
+     {
+          const Uint32 rem = (Uint32)(secondSize % ADLER_BASE);
+          Uint32 a = first & 0xFFFF;
+          Uint32 b = (Uint32)(((Uint64)rem * a) % ADLER_BASE);
+          a += (second & 0xFFFF) + ADLER_BASE - 1;
+          b += (first >> 16) + (second >> 16) + ADLER_BASE - rem;
+          if (a >= ADLER_BASE)
+          {
+               a -= ADLER_BASE;
+          }
+          if (a >= ADLER_BASE)
+          {
+               a -= ADLER_BASE;
+          }
+          if (b >= 2 * ADLER_BASE)
+          {
+               b -= 2 * ADLER_BASE;
+          }
+          if (b >= ADLER_BASE)
+          {
+               b -= ADLER_BASE;
+          }
+          return b << 16 | a;
+     }
+
+     // Deflate's LSB-first bit packing
+     struct BitWriter
+     {
+          std::vector<Uint8> *out;
+          Uint64 bits;
+          int count;
+     };
+
+     void putBits(BitWriter &writer, Uint32 value, int count)
+     {
+          writer.bits |= (Uint64)value << writer.count;
+          writer.count += count;
+          while (writer.count >= 8)
+          {
+               writer.out->push_back((Uint8)writer.bits);
+               writer.bits >>= 8;
+               writer.count -= 8;
+          }
+     }
+
+     void alignToByte(BitWriter &writer)
+     {
+          if (writer.count > 0)
+          {
+               writer.out->push_back((Uint8)writer.bits);
+          }
+          writer.bits = 0;
+          writer.count = 0;
+     }
+
+     // Huffman code lengths of at most maxBits for the used symbols (zero for
+     // the rest); overlong codes are folded back as in miniz
+     void buildLengths(const Uint32 *freq, int count, int maxBits, Uint8 *lengths)
+     {
+          std::vector<int> symbols;
+          for (int i = 0; i < count; i++)
+          {
+               lengths[i] = 0;
+               if (freq[i] != 0)
+               {
+                    symbols.push_back(i);
+               }
+          }
+          if (symbols.size() < 2)
+          {
+               if (!symbols.empty())
+               {
+                    lengths[symbols[0]] = 1;
+               }
+               return;
+          }
+          std::sort(symbols.begin(), symbols.end(),
+                    [&](int a, int b) { return freq[a] != freq[b] ? freq[a] < freq[b] : a < b; });
+
+          // Two-queue Huffman: leaves in order, internal nodes are created in
+          // non-decreasing weight order, so both queues stay sorted
+          const int n = (int)symbols.size();
+          std::vector<Uint64> weight(2 * n - 1);
+          std::vector<int> parent(2 * n - 1, -1);
+          for (int i = 0; i < n; i++)
+          {
+               weight[i] = freq[symbols[i]];
+          }
+          int leaf = 0, node = n;
+          for (int next = n; next < 2 * n - 1; next++)
+          {
+               int pair[2];
+               for (int &chosen : pair)
+               {
+                    chosen = leaf < n && (node >= next || weight[leaf] <= weight[node]) ? leaf++ : node++;
+               }
+               weight[next] = weight[pair[0]] + weight[pair[1]];
+               parent[pair[0]] = parent[pair[1]] = next;
+          }
+
+          // Parents always come after their children, so depths fill top down
+          std::vector<int> depth(2 * n - 1, 0);
+          int lengthCounts[MAX_CODE_BITS + 1] = {0};
+          for (int i = 2 * n - 3; i >= 0; i--)
+          {
+               depth[i] = depth[parent[i]] + 1;
+          }
+          for (int i = 0; i < n; i++)
+          {
+               lengthCounts[SDL_min(depth[i], maxBits)]++;
+          }
+
+          Uint32 total = 0;
+          for (int bits = 1; bits <= maxBits; bits++)
+          {
+               total += (Uint32)lengthCounts[bits] << (maxBits - bits);
+          }
+          while (total != 1u << maxBits)
+          {
+               lengthCounts[maxBits]--;
+               for (int bits = maxBits - 1; bits > 0; bits--)
+               {
+                    if (lengthCounts[bits] != 0)
+                    {
+                         lengthCounts[bits]--;
+                         lengthCounts[bits + 1] += 2;
+                         break;
+                    }
+               }
+               total--;
+          }
+
+          // Rarest symbols get the longest codes
+          int k = 0;
+          for (int bits = maxBits; bits >= 1; bits--)
+          {
+               for (int c = lengthCounts[bits]; c > 0; c--)
+               {
+                    lengths[symbols[k++]] = (Uint8)bits;
+               }
+          }
+     }
+
+     // Canonical codes, bit-reversed for putBits
+     void buildCodes(const Uint8 *lengths, int count, Uint16 *codes)
+     {
+          int lengthCounts[MAX_CODE_BITS + 1] = {0};
+          for (int i = 0; i < count; i++)
+          {
+               lengthCounts[lengths[i]]++;
+          }
+          lengthCounts[0] = 0;
+          int nextCode[MAX_CODE_BITS + 1];
+          int code = 0;
+          for (int bits = 1; bits <= MAX_CODE_BITS; bits++)
+          {
+               code = (code + lengthCounts[bits - 1]) << 1;
+               nextCode[bits] = code;
+          }
+          for (int i = 0; i < count; i++)
+          {
+               codes[i] = 0;
+               if (lengths[i] != 0)
+               {
+                    int value = nextCode[lengths[i]]++;
+                    Uint16 reversed = 0;
+                    for (int b = 0; b < lengths[i]; b++)
+                    {
+                         reversed = (Uint16)(reversed << 1 | ((value >> b) & 1));
+                    }
+                    codes[i] = reversed;
+               }
+          }
+     }
+
+     // A literal (dist 0, litlen the byte) or a match (litlen its length)
+     struct Symbol
+     {
+          Uint16 litlen;
+          Uint16 dist;
+     };
+
+     void writeDynamicBlock(BitWriter &writer, const std::vector<Symbol> &symbols, bool final)
+     {
+          const Tables &t = tables();
+          Uint32 litFreq[286] = {0};
+          Uint32 distFreq[30] = {0};
+          for (const Symbol &s : symbols)
+          {
+               if (s.dist == 0)
+               {
+                    litFreq[s.litlen]++;
+               }
+               else
+               {
+                    litFreq[257 + t.lengthCode[s.litlen]]++;
+                    distFreq[distCodeOf(s.dist)]++;
+               }
+          }
+          litFreq[256] = 1; // End of block
+
+          Uint8 lengths[286 + 30];
+          Uint8 *litLengths = lengths;
+          Uint8 distLengths[30];
+          buildLengths(litFreq, 286, MAX_CODE_BITS, litLengths);
+          buildLengths(distFreq, 30, MAX_CODE_BITS, distLengths);
+          if (std::all_of(distLengths, distLengths + 30, [](Uint8 l) { return l == 0; }))
+          {
+               distLengths[0] = 1; // Literals only; decoders still expect one distance code
+          }
+          Uint16 litCodes[286], distCodes[30];
+          buildCodes(litLengths, 286, litCodes);
+          buildCodes(distLengths, 30, distCodes);
+
+          int litCount = 286;
+          while (litCount > 257 && litLengths[litCount - 1] == 0)
+          {
+               litCount--;
+          }
+          int distCount = 30;
+          while (distCount > 1 && distLengths[distCount - 1] == 0)
+          {
+               distCount--;
+          }
+          std::memmove(lengths + litCount, distLengths, distCount);
+          const int total = litCount + distCount;
+
+          // Run-length code the code lengths with symbols 16 (repeat), 17 and 18 (zeros)
+          std::vector<Uint8> rle;
+          std::vector<Uint8> rleExtra;
+          auto emit = [&](int symbol, int extra) {
+               rle.push_back((Uint8)symbol);
+               rleExtra.push_back((Uint8)extra);
+          };
+          for (int i = 0; i < total;)
+          {
+               const Uint8 length = lengths[i];
+               int run = 1;
+               while (i + run < total && lengths[i + run] == length)
+               {
+                    run++;
+               }
+               i += run;
+               if (length == 0)
+               {
+                    while (run >= 11)
+                    {
+                         int n = SDL_min(run, 138);
+                         emit(18, n - 11);
+                         run -= n;
+                    }
+                    if (run >= 3)
+                    {
+                         emit(17, run - 3);
+                         run = 0;
+                    }
+               }
+               else
+               {
+                    emit(length, 0);
+                    run--;
+                    while (run >= 3)
+                    {
+                         int n = SDL_min(run, 6);
+                         emit(16, n - 3);
+                         run -= n;
+                    }
+               }
+               while (run-- > 0)
+               {
+                    emit(length, 0);
+               }
+          }
+
+          Uint32 clFreq[19] = {0};
+          for (Uint8 symbol : rle)
+          {
+               clFreq[symbol]++;
+          }
+          Uint8 clLengths[19];
+          Uint16 clCodes[19];
+          buildLengths(clFreq, 19, MAX_CODE_LENGTH_BITS, clLengths);
+          buildCodes(clLengths, 19, clCodes);
+          int clCount = 19;
+          while (clCount > 4 && clLengths[CODE_LENGTH_ORDER[clCount - 1]] == 0)
+          {
+               clCount--;
+          }
+
+          putBits(writer, final ? 1 : 0, 1);
+          putBits(writer, 2, 2); // Dynamic Huffman
+          putBits(writer, litCount - 257, 5);
+          putBits(writer, distCount - 1, 5);
+          putBits(writer, clCount - 4, 4);
+          for (int i = 0; i < clCount; i++)
+          {
+               putBits(writer, clLengths[CODE_LENGTH_ORDER[i]], 3);
+          }
+          static const int RLE_EXTRA_BITS[3] = {2, 3, 7};
+          for (size_t i = 0; i < rle.size(); i++)
+          {
+               putBits(writer, clCodes[rle[i]], clLengths[rle[i]]);
+               if (rle[i] >= 16)
+               {
+                    putBits(writer, rleExtra[i], RLE_EXTRA_BITS[rle[i] - 16]);
+               }
+          }
+
+          for (const Symbol &s : symbols)
+          {
+               if (s.dist == 0)
+               {
+                    putBits(writer, litCodes[s.litlen], litLengths[s.litlen]);
+                    continue;
+               }
+               const int lengthCode = t.lengthCode[s.litlen];
+               putBits(writer, litCodes[257 + lengthCode], litLengths[257 + lengthCode]);
+               putBits(writer, s.litlen - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+               const int distCode = distCodeOf(s.dist);
+               putBits(writer, distCodes[distCode], distLengths[distCode]);
+               putBits(writer, s.dist - DIST_BASE[distCode], DIST_EXTRA[distCode]);
+          }
+          putBits(writer, litCodes[256], litLengths[256]);
+     }
+
+     void writeStoredBlocks(BitWriter &writer, const Uint8 *data, size_t size, bool final)
+     {
+          do
+          {
+               const size_t run = SDL_min(size, STORED_BLOCK_BYTES);
+               size -= run;
+               putBits(writer, final && size == 0 ? 1 : 0, 1);
+               putBits(writer, 0, 2);
+               alignToByte(writer);
+               const Uint8 header[4] = {(Uint8)run, (Uint8)(run >> 8), (Uint8)~run, (Uint8)(~run >> 8)};
+               writer.out->insert(writer.out->end(), header, header + 4);
+               writer.out->insert(writer.out->end(), data, data + run);
+               data += run;
+          } while (size > 0);
+     }
+
+     Uint32 hash3(const Uint8 *p)
+     {
+          return ((Uint32)p[0] | (Uint32)p[1] << 8 | (Uint32)p[2] << 16) * 2654435761u >> (32 - DEFLATE_HASH_BITS);
+     }
+
+     // Greedy LZ77 over hash chains, then dynamic Huffman blocks. A strip
+     // that is not last ends with an empty stored block so it stops on a
+     // byte boundary and the next strip's output can follow directly.
+     void deflateStrip(const Uint8 *data, size_t size, int level, bool last, std::vector<Uint8> &out)
+     {
+          BitWriter writer = {&out, 0, 0};
+          if (level == 0)
+          {
+               writeStoredBlocks(writer, data, size, last);
+          }
+          else
+          {
+               const int maxChain = CHAIN_LENGTH[level];
+               const int niceLength = NICE_LENGTH[level];
+               const bool insertAll = level >= 4; // Hash every position inside matches too
+               std::vector<int> head(1 << DEFLATE_HASH_BITS, -1);
+               std::vector<int> prev(WINDOW_SIZE);
+               std::vector<Symbol> symbols;
+               symbols.reserve(BLOCK_SYMBOLS);
+               auto insert = [&](size_t p) {
+                    const Uint32 h = hash3(data + p);
+                    prev[p & (WINDOW_SIZE - 1)] = head[h];
+                    head[h] = (int)p;
+               };
+
+               size_t pos = 0;
+               while (pos < size)
+               {
+                    int bestLength = 0, bestDist = 0;
+                    if (pos + DEFLATE_MIN_MATCH <= size)
+                    {
+                         const int maxLength = (int)SDL_min(size - pos, (size_t)MAX_MATCH);
+                         const Uint8 *current = data + pos;
+                         int candidate = head[hash3(current)];
+                         for (int chain = maxChain; candidate >= 0 && (int)pos - candidate <= WINDOW_SIZE && chain > 0;
+                              chain--)
+                         {
+                              const Uint8 *earlier = data + candidate;
+                              if (earlier[bestLength] == current[bestLength])
+                              {
+                                   int length = 0;
+                                   while (length < maxLength && earlier[length] == current[length])
+                                   {
+                                        length++;
+                                   }
+                                   if (length > bestLength)
+                                   {
+                                        bestLength = length;
+                                        bestDist = (int)pos - candidate;
+                                        if (length >= niceLength || length == maxLength)
+                                        {
+                                             break;
+                                        }
+                                   }
+                              }
+                              candidate = prev[candidate & (WINDOW_SIZE - 1)];
+                         }
+                    }
+
+                    if (bestLength >= DEFLATE_MIN_MATCH)
+                    {
+                         symbols.push_back(Symbol{(Uint16)bestLength, (Uint16)bestDist});
+                         insert(pos);
+                         if (insertAll)
+                         {
+                              for (size_t p = pos + 1; p < pos + bestLength && p + DEFLATE_MIN_MATCH <= size; p++)
+                              {
+                                   insert(p);
+                              }
+                         }
+                         pos += bestLength;
+                    }
+                    else
+                    {
+                         if (pos + DEFLATE_MIN_MATCH <= size)
+                         {
+                              insert(pos);
+                         }
+                         symbols.push_back(Symbol{data[pos], 0});
+                         pos++;
+                    }
+                    if (symbols.size() >= BLOCK_SYMBOLS)
+                    {
+                         writeDynamicBlock(writer, symbols, false);
+                         symbols.clear();
+                    }
+               }
+               if (!symbols.empty() || last)
+               {
+                    writeDynamicBlock(writer, symbols, last);
+               }
+          }
+
+          if (!last)
+          {
+               putBits(writer, 0, 3); // Not final, stored
+               alignToByte(writer);
+               const Uint8 syncFlush[4] = {0x00, 0x00, 0xFF, 0xFF};
+               out.insert(out.end(), syncFlush, syncFlush + 4);
+          }
+          alignToByte(writer);
+     }
+
+     Uint8 paeth(int a, int b, int c)
+     {
+          const int p = a + b - c;
+          const int pa = SDL_abs(p - a), pb = SDL_abs(p - b), pc = SDL_abs(p - c);
+          return (Uint8)(pa <= pb && pa <= pc ? a : (pb <= pc ? b : c));
+     }
+
+     // Apply PNG filter `type` to one row; `above` is the unfiltered row above
+     void filterRow(int type, const Uint8 *row, const Uint8 *above, int bytes, int bpp, Uint8 *out)
+     {
+          for (int i = 0; i < bytes; i++)
+          {
+               const int a = i >= bpp ? row[i - bpp] : 0;
+               const int b = above != nullptr ? above[i] : 0;
+               const int c = above != nullptr && i >= bpp ? above[i - bpp] : 0;
+               int predicted = 0;
+               switch (type)
+               {
+               case 1:
+                    predicted = a;
+                    break;
+               case 2:
+                    predicted = b;
+                    break;
+               case 3:
+                    predicted = (a + b) >> 1;
+                    break;
+               case 4:
+                    predicted = paeth(a, b, c);
+                    break;
+               }
+               out[i] = (Uint8)(row[i] - predicted);
+          }
+     }
+
+     struct StripJob
+     {
+          const Uint8 *pixels;
+          int pitch;
+          int width, channels, level;
+          int firstRow, rows;
+          bool last;
+          std::vector<Uint8> deflated;
+          Uint32 adler;
+          size_t filteredSize;
+     };
+
+     void encodeStrip(void *data, int index)
+     {
+          StripJob &job = ((StripJob *)data)[index];
+          const int rowBytes = job.width * job.channels;
+          std::vector<Uint8> filtered((size_t)(rowBytes + 1) * job.rows);
+          std::vector<Uint8> candidate(rowBytes);
+          for (int y = 0; y < job.rows; y++)
+          {
+               const int imageRow = job.firstRow + y;
+               const Uint8 *row = job.pixels + (size_t)imageRow * job.pitch;
+               const Uint8 *above = imageRow > 0 ? row - job.pitch : nullptr;
+               Uint8 *out = &filtered[(size_t)y * (rowBytes + 1)];
+               if (job.level <= 1)
+               {
+                    // Stored data stays raw; the fastest level takes Sub unseen
+                    out[0] = job.level == 0 ? 0 : 1;
+                    filterRow(out[0], row, above, rowBytes, job.channels, out + 1);
+                    continue;
+               }
+
+               // The usual heuristic: the filter with the smallest sum of
+               // residuals taken as signed bytes
+               Uint64 bestCost = ~(Uint64)0;
+               for (int type = 0; type < 5; type++)
+               {
+                    filterRow(type, row, above, rowBytes, job.channels, candidate.data());
+                    Uint64 cost = 0;
+                    for (int i = 0; i < rowBytes; i++)
+                    {
+                         cost += (Uint64)SDL_abs((int)(Sint8)candidate[i]);
+                    }
+                    if (cost < bestCost)
+                    {
+                         bestCost = cost;
+                         out[0] = (Uint8)type;
+                         std::memcpy(out + 1, candidate.data(), rowBytes);
+                    }
+               }
+          }
+          job.filteredSize = filtered.size();
+          job.adler = adler32(filtered.data(), filtered.size());
+          deflateStrip(filtered.data(), filtered.size(), job.level, job.last, job.deflated);
+     }
+
+     void appendBigEndian(std::vector<Uint8> &out, Uint32 value)
+     {
+          const Uint8 bytes[4] = {(Uint8)(value >> 24), (Uint8)(value >> 16), (Uint8)(value >> 8), (Uint8)value};
+          out.insert(out.end(), bytes, bytes + 4);
+     }
+
+     void appendChunk(std::vector<Uint8> &out, const char *type, const Uint8 *data, size_t size)
+     {
+          appendBigEndian(out, (Uint32)size);
+          const size_t start = out.size();
+          out.insert(out.end(), type, type + 4);
+          out.insert(out.end(), data, data + size);
+          appendBigEndian(out, crc32Update(0, &out[start], size + 4));
+     }
+}
+
+bool pngEncode(const void *pixels, int pitch, int width, int height, int channels, int level, JobSystem *jobs,
+               std::vector<Uint8> &out)
+{
+     if (pixels == nullptr || width <= 0 || height <= 0 || (channels != 3 && channels != 4))
+     {
+          SDL_SetError("Unsupported image for PNG encoding");
+          return false;
+     }
+     level = SDL_clamp(level, 0, 9);
+
+     // Enough strips to keep every thread busy, none too small to compress well
+     const size_t filteredBytes = (size_t)(width * channels + 1) * height;
+     int strips = 1;
+     if (jobs != nullptr)
+     {
+          strips = (int)SDL_min((size_t)jobSystemThreadCount(*jobs) * 2, filteredBytes / MIN_STRIP_BYTES);
+          strips = SDL_clamp(strips, 1, height);
+     }
+     const int rowsPerStrip = (height + strips - 1) / strips;
+     strips = (height + rowsPerStrip - 1) / rowsPerStrip;
+
+     std::vector<StripJob> work(strips);
+     for (int i = 0; i < strips; i++)
+     {
+          StripJob &job = work[i];
+          job.pixels = (const Uint8 *)pixels;
+          job.pitch = pitch;
+          job.width = width;
+          job.channels = channels;
+          job.level = level;
+          job.firstRow = i * rowsPerStrip;
+          job.rows = SDL_min(rowsPerStrip, height - job.firstRow);
+          job.last = i == strips - 1;
+     }
+     if (jobs != nullptr && strips > 1)
+     {
+          JobCounter counter = {};
+          jobSystemSubmitRange(*jobs, encodeStrip, work.data(), strips, &counter);
+          jobSystemWait(*jobs, counter);
+     }
+     else
+     {
+          encodeStrip(work.data(), 0);
+     }
+
+     // zlib stream: header, the strips back to back, combined Adler-32
+     std::vector<Uint8> zlib;
+     size_t deflatedBytes = 0;
+     for (const StripJob &job : work)
+     {
+          deflatedBytes += job.deflated.size();
+     }
+     zlib.reserve(deflatedBytes + 6);
+     const Uint8 levelFlag = level <= 1 ? 0 : (level <= 5 ? 1 : (level == 6 ? 2 : 3));
+     const Uint8 cmf = 0x78; // Deflate, 32K window
+     Uint8 flg = (Uint8)(levelFlag << 6);
+     flg = (Uint8)(flg + (31 - (cmf * 256 + flg) % 31));
+     zlib.push_back(cmf);
+     zlib.push_back(flg);
+     Uint32 adler = work[0].adler;
+     for (size_t i = 0; i < work.size(); i++)
+     {
+          zlib.insert(zlib.end(), work[i].deflated.begin(), work[i].deflated.end());
+          if (i > 0)
+          {
+               adler = adler32Combine(adler, work[i].adler, work[i].filteredSize);
+          }
+     }
+     appendBigEndian(zlib, adler);
+
+     static const Uint8 SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+     Uint8 header[13];
+     const Uint32 dims[2] = {(Uint32)width, (Uint32)height};
+     for (int i = 0; i < 2; i++)
+     {
+          header[4 * i] = (Uint8)(dims[i] >> 24);
+          header[4 * i + 1] = (Uint8)(dims[i] >> 16);
+          header[4 * i + 2] = (Uint8)(dims[i] >> 8);
+          header[4 * i + 3] = (Uint8)dims[i];
+     }
+     header[8] = 8;                     // Bit depth
+     header[9] = channels == 4 ? 6 : 2; // Truecolor with or without alpha
+     header[10] = header[11] = header[12] = 0;
+
+     out.clear();
+     out.reserve(zlib.size() + 64);
+     out.insert(out.end(), SIGNATURE, SIGNATURE + 8);
+     appendChunk(out, "IHDR", header, sizeof(header));
+     appendChunk(out, "IDAT", zlib.data(), zlib.size());
+     appendChunk(out, "IEND", nullptr, 0);
+     return true;
+}
+
+bool pngEncodeSurface(SDL_Surface *surface, int level, JobSystem *jobs, std::vector<Uint8> &out)
+{
+     if (surface == nullptr)
+     {
+          SDL_InvalidParamError("surface");
+          return false;
+     }
+     const bool alpha = surface->format->Amask != 0 || SDL_ISPIXELFORMAT_ALPHA(surface->format->format);
+     const Uint32 format = alpha ? SDL_PIXELFORMAT_RGBA32 : SDL_PIXELFORMAT_RGB24;
+     SDL_Surface *converted = surface;
+     if (surface->format->format != format)
+     {
+          converted = SDL_ConvertSurfaceFormat(surface, format, 0);
+          if (converted == nullptr)
+          {
+               return false;
+          }
+     }
+     bool encoded = false;
+     if (SDL_LockSurface(converted) == 0)
+     {
+          encoded = pngEncode(converted->pixels, converted->pitch, converted->w, converted->h, alpha ? 4 : 3, level,
+                              jobs, out);
+          SDL_UnlockSurface(converted);
+     }
+     if (converted != surface)
+     {
+          SDL_FreeSurface(converted);
+     }
+     return encoded;
+}
@@ -0,0 +1,33 @@
+// Description:
+// PNG encoder with its own deflate, for saving screenshots and captures
+// without SDL_image's single-threaded IMG_SavePNG. The image is split into
+// horizontal strips that are filtered and compressed independently, in
+// parallel on the job system when one is given; each strip ends on a byte
+// boundary (an empty stored block), so the outputs simply concatenate into
+// one valid zlib stream and the Adler-32 sums are combined.
+//
+// Levels: 0 stores the data uncompressed, 1 is fastest, 9 searches longest
+// (longer hash chains, per-row adaptive filters from level 2 up). Strips do
+// not share a dictionary, which costs a little ratio on very large images
+// in exchange for scaling with cores.
+// =============================================================================
+
+#ifndef PNG_ENCODE_H
+#define PNG_ENCODE_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "job_system.h"
+
+const int PNG_DEFAULT_LEVEL = 6;
+
+// Encode 8-bit RGB (channels 3) or RGBA (channels 4) rows, bytes in that
+// order, into a complete PNG file in `out`. `jobs` may be nullptr.
+bool pngEncode(const void *pixels, int pitch, int width, int height, int channels, int level, JobSystem *jobs,
+               std::vector<Uint8> &out);
+
+// Convert any surface to RGB24/RGBA32 as needed and encode it
+bool pngEncodeSurface(SDL_Surface *surface, int level, JobSystem *jobs, std::vector<Uint8> &out);
+
+#endif // PNG_ENCODE_H
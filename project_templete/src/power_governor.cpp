@@ -0,0 +1,234 @@
+#include "power_governor.h"
+
+#include <cstdio>
+
+namespace
+{
+     const int POWER_PROBE_ROUNDS = 3;
+     const int POWER_PROBE_STEPS = 1 << 18; // About 0.3 ms at 3 GHz
+     const Uint64 POWER_WARMUP_US = 1000;
+     const int POWER_THERMAL_ZONES = 64;
+
+     Uint64 powerSteps(int steps)
+     {
+          volatile Uint64 seed = 0x9E3779B97F4A7C15ull;
+          Uint64 x = seed;
+          for (int i = 0; i < steps; i++)
+          {
+               x = x * 6364136223846793005ull + 1442695040888963407ull;
+          }
+          seed = x;
+          return x;
+     }
+
+     // Each multiply waits on the last, so the time is the core clock's and
+     // not the memory system's. The spin first lets the clock come up from
+     // idle; the best of a few rounds drops preemption.
+     Uint64 powerProbe()
+     {
+          const Uint64 frequency = SDL_GetPerformanceFrequency();
+          const Uint64 warmup = SDL_GetPerformanceCounter();
+          while ((SDL_GetPerformanceCounter() - warmup) * 1000000 / frequency < POWER_WARMUP_US)
+          {
+               powerSteps(POWER_PROBE_STEPS / 64);
+          }
+          Uint64 best = ~(Uint64)0;
+          for (int round = 0; round < POWER_PROBE_ROUNDS; round++)
+          {
+               const Uint64 start = SDL_GetPerformanceCounter();
+               powerSteps(POWER_PROBE_STEPS);
+               best = SDL_min(best, SDL_GetPerformanceCounter() - start);
+          }
+          return SDL_max(best, (Uint64)1);
+     }
+
+     // Hottest zone in whole degrees, -1 where there is nothing to read
+     int powerThermalCelsius()
+     {
+          int hottest = -1;
+#if defined(__linux__)
+          for (int zone = 0; zone < POWER_THERMAL_ZONES; zone++)
+          {
+               char path[64];
+               SDL_snprintf(path, sizeof(path), "/sys/class/thermal/thermal_zone%d/temp", zone);
+               std::FILE *file = std::fopen(path, "r");
+               if (file == nullptr)
+               {
+                    break;
+               }
+               int millidegrees = 0;
+               // Some zones report 0 or sentinel values when asleep
+               if (std::fscanf(file, "%d", &millidegrees) == 1 && millidegrees > 0 && millidegrees < 150000)
+               {
+                    hottest = SDL_max(hottest, millidegrees / 1000);
+               }
+               std::fclose(file);
+          }
+#endif
+          return hottest;
+     }
+
+     void powerSample(PowerGovernor &governor)
+     {
+          const PowerGovernorConfig &config = governor.config;
+          governor.state = SDL_GetPowerInfo(&governor.batterySeconds, &governor.batteryPercent);
+
+          governor.celsius = powerThermalCelsius();
+          if (governor.celsius < 0 || governor.celsius < config.coolCelsius)
+          {
+               governor.hot = false;
+          }
+          else if (governor.celsius >= config.hotCelsius)
+          {
+               governor.hot = true;
+          }
+
+          // Against the fastest of the recent polls, this one included
+          const Uint64 probe = powerProbe();
+          governor.probes[governor.probeCount++ % POWER_BASELINE_POLLS] = probe;
+          Uint64 baseline = probe;
+          for (int i = 0; i < SDL_min(governor.probeCount, POWER_BASELINE_POLLS); i++)
+          {
+               baseline = SDL_min(baseline, governor.probes[i]);
+          }
+          governor.clockRatio = (double)probe / (double)baseline;
+          governor.slowPolls = governor.clockRatio >= config.throttleRatio ? governor.slowPolls + 1 : 0;
+     }
+
+     // Which profile the last sample calls for, and why
+     PowerProfile powerWanted(const PowerGovernor &governor, PowerReason &reason)
+     {
+          if (governor.pinned >= 0)
+          {
+               reason = POWER_REASON_PINNED;
+               return (PowerProfile)governor.pinned;
+          }
+          if (governor.state == SDL_POWERSTATE_ON_BATTERY)
+          {
+               reason = POWER_REASON_BATTERY;
+               return POWER_PROFILE_SAVE;
+          }
+          if (governor.hot)
+          {
+               reason = POWER_REASON_HOT;
+               return POWER_PROFILE_SAVE;
+          }
+          if (governor.slowPolls >= 2)
+          {
+               reason = POWER_REASON_THROTTLED;
+               return POWER_PROFILE_SAVE;
+          }
+          reason = POWER_REASON_MAINS;
+          return POWER_PROFILE_FULL;
+     }
+}
+
+PowerGovernorConfig powerGovernorDefaultConfig()
+{
+     PowerGovernorConfig config;
+     config.full.frameCapHz = 0;
+     config.full.particleScale = 1.0f;
+     config.full.voices = 0;
+     config.full.threads = 0;
+     config.save.frameCapHz = 30;
+     config.save.particleScale = 0.35f;
+     config.save.voices = 8;
+     config.save.threads = 2;
+     config.pollMs = 2000;
+     config.settleMs = 15000;
+     config.hotCelsius = 90;
+     config.coolCelsius = 80;
+     config.throttleRatio = 1.5f;
+     return config;
+}
+
+void powerGovernorInit(PowerGovernor &governor, const PowerGovernorConfig &config)
+{
+     governor.config = config;
+     governor.pinned = -1;
+     const char *pin = SDL_GetHint(POWER_PROFILE_HINT);
+     if (pin != nullptr && SDL_strcasecmp(pin, "full") == 0)
+     {
+          governor.pinned = POWER_PROFILE_FULL;
+     }
+     else if (pin != nullptr && SDL_strcasecmp(pin, "save") == 0)
+     {
+          governor.pinned = POWER_PROFILE_SAVE;
+     }
+
+     governor.state = SDL_POWERSTATE_UNKNOWN;
+     governor.batteryPercent = -1;
+     governor.batterySeconds = -1;
+     governor.celsius = -1;
+     governor.hot = false;
+     governor.clockRatio = 1.0;
+     governor.probeCount = 0;
+     governor.slowPolls = 0;
+     governor.switches = 0;
+
+     const Uint32 now = SDL_GetTicks();
+     powerSample(governor);
+     governor.lastPoll = now;
+     governor.clearSince = now;
+     governor.profile = powerWanted(governor, governor.reason);
+}
+
+bool powerGovernorUpdate(PowerGovernor &governor, Uint32 now)
+{
+     if (now - governor.lastPoll < governor.config.pollMs)
+     {
+          return false;
+     }
+     governor.lastPoll = now;
+     powerSample(governor);
+
+     PowerReason reason;
+     const PowerProfile wanted = powerWanted(governor, reason);
+     if (wanted == POWER_PROFILE_SAVE)
+     {
+          governor.clearSince = now;
+     }
+     if (wanted == governor.profile)
+     {
+          governor.reason = reason;
+          return false;
+     }
+     // Back to full only once nothing has asked for save for a while
+     if (wanted == POWER_PROFILE_FULL && reason != POWER_REASON_PINNED &&
+         now - governor.clearSince < governor.config.settleMs)
+     {
+          return false;
+     }
+     governor.profile = wanted;
+     governor.reason = reason;
+     governor.switches++;
+     return true;
+}
+
+const PowerSettings &powerGovernorSettings(const PowerGovernor &governor)
+{
+     return governor.profile == POWER_PROFILE_SAVE ? governor.config.save : governor.config.full;
+}
+
+const char *powerProfileName(PowerProfile profile)
+{
+     return profile == POWER_PROFILE_SAVE ? "save" : "full";
+}
+
+const char *powerReasonName(PowerReason reason)
+{
+     switch (reason)
+     {
+     case POWER_REASON_MAINS:
+          return "mains power";
+     case POWER_REASON_BATTERY:
+          return "on battery";
+     case POWER_REASON_HOT:
+          return "hot";
+     case POWER_REASON_THROTTLED:
+          return "CPU throttled";
+     case POWER_REASON_PINNED:
+          return "pinned";
+     }
+     return "unknown";
+}
@@ -0,0 +1,119 @@
+// Description:
+// Picks between a full-rate and a power-save profile from the power state,
+// so laptop and handheld sessions last longer without anyone touching the
+// settings. A profile is a frame cap, a particle level of detail, a voice
+// limit and a job thread count. The caller applies them to the frame
+// pacer, the emitters, the voice manager and the job system whenever
+// powerGovernorUpdate() reports a switch.
+//
+// The save profile is chosen for any of these:
+// - SDL_GetPowerInfo() reports SDL_POWERSTATE_ON_BATTERY.
+// - The hottest thermal zone is at or over hotCelsius (Linux sysfs; other
+//   platforms have no thermal reading without WMI or vendor APIs).
+// - The CPU runs throttled: a fixed dependent-multiply loop takes
+//   throttleRatio times as long as the sustained baseline, two polls in a
+//   row. That catches thermal and power-limit throttling on every
+//   platform, whatever the OS reports. The loop runs after a millisecond
+//   of spinning, so a core still at its idle clock after the frame
+//   pacer's wait has ramped up, and is timed over about a millisecond.
+//   The baseline is the fastest probe of the last POWER_BASELINE_POLLS
+//   polls, not of the session: a turbo clock decaying to the all-core
+//   clock under sustained load ages out of it, and so do the slow probes
+//   taken while the 30 FPS cap lets the clock drop, so save cannot keep
+//   itself going.
+//
+// SDL_GetPowerInfo can be a system call or an IPC round trip, so all of
+// this is sampled every pollMs rather than every frame. The switch to
+// save is immediate. The switch back waits until every condition has been
+// clear for settleMs, so a machine thermally cycling near its limit doesn't
+// flip profiles every poll.
+//
+// POWER_PROFILE_HINT set to "full" or "save" pins the profile.
+// =============================================================================
+
+#ifndef POWER_GOVERNOR_H
+#define POWER_GOVERNOR_H
+
+#include <SDL2/SDL.h>
+
+// "full", "save", or unset to follow the power state
+#define POWER_PROFILE_HINT "CATCH_POWER_PROFILE"
+
+// Polls the throttle baseline is taken over, a minute at the default pollMs
+const int POWER_BASELINE_POLLS = 30;
+
+enum PowerProfile
+{
+     POWER_PROFILE_FULL,
+     POWER_PROFILE_SAVE
+};
+
+// Why the current profile was picked
+enum PowerReason
+{
+     POWER_REASON_MAINS, // Plugged in, charged, or no battery
+     POWER_REASON_BATTERY,
+     POWER_REASON_HOT,
+     POWER_REASON_THROTTLED,
+     POWER_REASON_PINNED // POWER_PROFILE_HINT
+};
+
+struct PowerSettings
+{
+     int frameCapHz;      // 0 for the display's rate
+     float particleScale; // Multiplies particles per burst
+     int voices;          // Mixer voices, 0 for all
+     int threads;         // Job threads including the main one, 0 for all
+};
+
+struct PowerGovernorConfig
+{
+     PowerSettings full;
+     PowerSettings save;
+     Uint32 pollMs;
+     Uint32 settleMs;     // Everything clear this long before returning to full
+     int hotCelsius;      // Save at or above
+     int coolCelsius;     // No longer hot below
+     float throttleRatio; // Probe time over the baseline that counts as throttled
+};
+
+struct PowerGovernor
+{
+     PowerGovernorConfig config;
+     PowerProfile profile;
+     PowerReason reason;
+     int pinned; // PowerProfile from POWER_PROFILE_HINT, -1 if unset
+
+     // Last sample
+     SDL_PowerState state;
+     int batteryPercent; // -1 if unknown
+     int batterySeconds; // -1 if unknown
+     int celsius;        // Hottest thermal zone, -1 if unknown
+     bool hot;           // Between hotCelsius and coolCelsius
+     double clockRatio;  // Last probe over the baseline; 1 is full speed
+     Uint64 probes[POWER_BASELINE_POLLS]; // The last polls' probe times, a ring
+     int probeCount;
+     int slowPolls; // In a row over throttleRatio
+
+     Uint32 lastPoll;
+     Uint32 clearSince; // When every save condition last turned clear
+     int switches;
+};
+
+// Full rate with no limits; save at 30 FPS, 35% of the particles, 8
+// voices and 2 threads, polled every 2 s and settled for 15 s
+PowerGovernorConfig powerGovernorDefaultConfig();
+
+// Samples the power state once, so the profile is valid right away
+void powerGovernorInit(PowerGovernor &governor, const PowerGovernorConfig &config);
+
+// Sample when pollMs has passed; true when the profile changed
+bool powerGovernorUpdate(PowerGovernor &governor, Uint32 now);
+
+// What the current profile asks for
+const PowerSettings &powerGovernorSettings(const PowerGovernor &governor);
+
+const char *powerProfileName(PowerProfile profile);
+const char *powerReasonName(PowerReason reason);
+
+#endif // POWER_GOVERNOR_H
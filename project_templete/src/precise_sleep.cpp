@@ -0,0 +1,107 @@
+#include "precise_sleep.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace
+{
+     // How early the sleep ends, covering its wake-up error; the waitable
+     // timer is good to a few hundred microseconds, SDL_Delay to a scheduler
+     // quantum
+     const double TIMER_SPIN_SECONDS = 0.0005;
+     const double DELAY_SPIN_SECONDS = 0.002;
+
+#ifdef _WIN32
+     struct SleepTimer
+     {
+          HANDLE handle;
+          bool tried;
+
+          ~SleepTimer()
+          {
+               if (handle != NULL)
+               {
+                    CloseHandle(handle);
+               }
+          }
+     };
+
+     thread_local SleepTimer sleepTimer = {NULL, false};
+
+     HANDLE threadTimer()
+     {
+          if (!sleepTimer.tried)
+          {
+               sleepTimer.tried = true;
+               sleepTimer.handle = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                                          TIMER_ALL_ACCESS);
+          }
+          return sleepTimer.handle;
+     }
+
+     bool timerSleep(double seconds)
+     {
+          HANDLE timer = threadTimer();
+          if (timer == NULL)
+          {
+               return false;
+          }
+          // Negative due times are relative, in 100 ns units
+          LARGE_INTEGER due;
+          due.QuadPart = -(LONGLONG)(seconds * 1e7);
+          if (!SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE))
+          {
+               return false;
+          }
+          WaitForSingleObject(timer, INFINITE);
+          return true;
+     }
+#else
+     bool timerSleep(double)
+     {
+          return false;
+     }
+#endif
+}
+
+void preciseSleepUntil(Uint64 deadline)
+{
+     const double frequency = (double)SDL_GetPerformanceFrequency();
+     const Uint64 now = SDL_GetPerformanceCounter();
+     if (now >= deadline)
+     {
+          return;
+     }
+     const double remaining = (double)(deadline - now) / frequency;
+     if (!(remaining > TIMER_SPIN_SECONDS && timerSleep(remaining - TIMER_SPIN_SECONDS)) &&
+         remaining - DELAY_SPIN_SECONDS >= 0.001)
+     {
+          SDL_Delay((Uint32)((remaining - DELAY_SPIN_SECONDS) * 1000.0));
+     }
+     while (SDL_GetPerformanceCounter() < deadline)
+     {
+     }
+}
+
+void preciseSleep(double seconds)
+{
+     if (seconds > 0.0)
+     {
+          preciseSleepUntil(SDL_GetPerformanceCounter() + (Uint64)(seconds * (double)SDL_GetPerformanceFrequency()));
+     }
+}
+
+bool preciseSleepHighResolution()
+{
+#ifdef _WIN32
+     return threadTimer() != NULL;
+#else
+     return false;
+#endif
+}
@@ -0,0 +1,31 @@
+// Description:
+// Sleeps that wake on time. SDL_Delay on Windows rounds up to the system
+// timer's tick, 15.6 ms unless something has called timeBeginPeriod, and
+// raising that frequency with timeBeginPeriod(1) speeds up timers for the
+// whole system and costs power for as long as the game runs. Windows 10
+// 1803 and later offer CREATE_WAITABLE_TIMER_HIGH_RESOLUTION instead: a
+// waitable timer with sub-millisecond resolution that affects only its own
+// waits.
+//
+// preciseSleepUntil() waits on such a timer (one per calling thread) until
+// shortly before the deadline, then spins on the performance counter for
+// the rest. Where the timer cannot be created (older Windows) or does not
+// exist (other platforms, where SDL_Delay already sleeps with nanosleep),
+// it sleeps with SDL_Delay and leaves a longer spin tail.
+// =============================================================================
+
+#ifndef PRECISE_SLEEP_H
+#define PRECISE_SLEEP_H
+
+#include <SDL2/SDL.h>
+
+// Wait until SDL_GetPerformanceCounter() reaches `deadline`
+void preciseSleepUntil(Uint64 deadline);
+
+// Wait for `seconds` from now
+void preciseSleep(double seconds);
+
+// Whether this thread sleeps on a high-resolution waitable timer
+bool preciseSleepHighResolution();
+
+#endif // PRECISE_SLEEP_H
@@ -0,0 +1,239 @@
+#include "premultiply.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define PREMULTIPLY_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+     // x * a / 255, rounded to nearest, without a division
+     inline Uint8 mulDiv255(int x, int a)
+     {
+          int t = x * a + 128;
+          return (Uint8)((t + (t >> 8)) >> 8);
+     }
+
+     // Byte of each pixel that holds alpha, in memory order
+     int alphaByte(const SDL_PixelFormat *format)
+     {
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+          return format->Ashift / 8;
+#else
+          return 3 - format->Ashift / 8;
+#endif
+     }
+
+     bool hasAlpha32(const SDL_Surface *surface)
+     {
+          return surface != nullptr && surface->format->BytesPerPixel == 4 && surface->format->Amask != 0;
+     }
+
+#ifdef PREMULTIPLY_X86
+     inline __m128i mulDiv255Sse2(__m128i x, __m128i a)
+     {
+          __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(128));
+          return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+     }
+
+     // Copy lane A of each pixel to all four of its 16-bit lanes
+     template <int A>
+     inline __m128i broadcastAlpha(__m128i pixels)
+     {
+          return _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(A, A, A, A)), _MM_SHUFFLE(A, A, A, A));
+     }
+
+     template <int A>
+     int premultiplyRowSse2(Uint8 *row, int count)
+     {
+          const __m128i zero = _mm_setzero_si128();
+          const __m128i alphaMask = _mm_set1_epi32((int)(0xFFu << (A * 8)));
+          int x = 0;
+          for (; x + 4 <= count; x += 4)
+          {
+               __m128i pixels = _mm_loadu_si128((const __m128i *)(row + x * 4));
+               __m128i lo = _mm_unpacklo_epi8(pixels, zero);
+               __m128i hi = _mm_unpackhi_epi8(pixels, zero);
+               lo = mulDiv255Sse2(lo, broadcastAlpha<A>(lo));
+               hi = mulDiv255Sse2(hi, broadcastAlpha<A>(hi));
+               __m128i result = _mm_packus_epi16(lo, hi);
+               result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, pixels));
+               _mm_storeu_si128((__m128i *)(row + x * 4), result);
+          }
+          return x;
+     }
+
+     // Source-over for four pixels; fully opaque groups are copied and
+     // all-zero groups skipped
+     template <int A>
+     int blitRowSse2(const Uint8 *src, Uint8 *dst, int count)
+     {
+          const __m128i zero = _mm_setzero_si128();
+          const __m128i ones = _mm_set1_epi8((char)0xFF);
+          const __m128i alphaMask = _mm_set1_epi32((int)(0xFFu << (A * 8)));
+          int x = 0;
+          for (; x + 4 <= count; x += 4)
+          {
+               __m128i s = _mm_loadu_si128((const __m128i *)(src + x * 4));
+               if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(s, alphaMask), alphaMask)) == 0xFFFF)
+               {
+                    _mm_storeu_si128((__m128i *)(dst + x * 4), s);
+                    continue;
+               }
+               if (_mm_movemask_epi8(_mm_cmpeq_epi8(s, zero)) == 0xFFFF)
+               {
+                    continue;
+               }
+               __m128i d = _mm_loadu_si128((const __m128i *)(dst + x * 4));
+               __m128i inverse = _mm_xor_si128(s, ones); // 255 - x in every byte
+               __m128i lo = mulDiv255Sse2(_mm_unpacklo_epi8(d, zero), broadcastAlpha<A>(_mm_unpacklo_epi8(inverse, zero)));
+               __m128i hi = mulDiv255Sse2(_mm_unpackhi_epi8(d, zero), broadcastAlpha<A>(_mm_unpackhi_epi8(inverse, zero)));
+               _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+          }
+          return x;
+     }
+
+     int premultiplyRow(Uint8 *row, int count, int alpha)
+     {
+          switch (alpha)
+          {
+          case 0:
+               return premultiplyRowSse2<0>(row, count);
+          case 3:
+               return premultiplyRowSse2<3>(row, count);
+          default:
+               return 0;
+          }
+     }
+
+     int blitRow(const Uint8 *src, Uint8 *dst, int count, int alpha)
+     {
+          switch (alpha)
+          {
+          case 0:
+               return blitRowSse2<0>(src, dst, count);
+          case 3:
+               return blitRowSse2<3>(src, dst, count);
+          default:
+               return 0;
+          }
+     }
+#else
+     int premultiplyRow(Uint8 *, int, int)
+     {
+          return 0;
+     }
+
+     int blitRow(const Uint8 *, Uint8 *, int, int)
+     {
+          return 0;
+     }
+#endif
+}
+
+SDL_BlendMode premultipliedBlendMode()
+{
+     return SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+                                       SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+}
+
+bool premultiplySurface(SDL_Surface *surface)
+{
+     if (!hasAlpha32(surface))
+     {
+          SDL_SetError("Premultiplying needs a 32-bit surface with alpha");
+          return false;
+     }
+     if (SDL_LockSurface(surface) < 0)
+     {
+          return false;
+     }
+     const int alpha = alphaByte(surface->format);
+     for (int y = 0; y < surface->h; y++)
+     {
+          Uint8 *row = (Uint8 *)surface->pixels + (size_t)y * surface->pitch;
+          for (int x = premultiplyRow(row, surface->w, alpha); x < surface->w; x++)
+          {
+               Uint8 *pixel = row + x * 4;
+               const int a = pixel[alpha];
+               for (int c = 0; c < 4; c++)
+               {
+                    if (c != alpha)
+                    {
+                         pixel[c] = mulDiv255(pixel[c], a);
+                    }
+               }
+          }
+     }
+     SDL_UnlockSurface(surface);
+     return true;
+}
+
+int premultipliedBlit(SDL_Surface *src, const SDL_Rect *srcrect, SDL_Surface *dst, SDL_Rect *dstrect)
+{
+     if (!hasAlpha32(src) || !hasAlpha32(dst) || src->format->format != dst->format->format)
+     {
+          return SDL_SetError("Premultiplied blits need matching 32-bit alpha formats");
+     }
+
+     // Clip the source to its surface and the destination to its clip rect,
+     // moving the other side by the same amount
+     SDL_Rect wanted = srcrect != nullptr ? *srcrect : SDL_Rect{0, 0, src->w, src->h};
+     const SDL_Rect srcBounds = {0, 0, src->w, src->h};
+     SDL_Rect from;
+     SDL_Rect drawn = {0, 0, 0, 0};
+     int dx = dstrect != nullptr ? dstrect->x : 0;
+     int dy = dstrect != nullptr ? dstrect->y : 0;
+     if (SDL_IntersectRect(&wanted, &srcBounds, &from))
+     {
+          SDL_Rect target = {dx + from.x - wanted.x, dy + from.y - wanted.y, from.w, from.h};
+          if (!SDL_IntersectRect(&target, &dst->clip_rect, &drawn))
+          {
+               drawn = SDL_Rect{0, 0, 0, 0};
+          }
+          from.x += drawn.x - target.x;
+          from.y += drawn.y - target.y;
+     }
+     if (dstrect != nullptr)
+     {
+          *dstrect = drawn;
+     }
+     if (drawn.w <= 0 || drawn.h <= 0)
+     {
+          return 0;
+     }
+
+     if (SDL_LockSurface(src) < 0)
+     {
+          return -1;
+     }
+     if (SDL_LockSurface(dst) < 0)
+     {
+          SDL_UnlockSurface(src);
+          return -1;
+     }
+     const int alpha = alphaByte(src->format);
+     for (int y = 0; y < drawn.h; y++)
+     {
+          const Uint8 *in = (const Uint8 *)src->pixels + (size_t)(from.y + y) * src->pitch + from.x * 4;
+          Uint8 *out = (Uint8 *)dst->pixels + (size_t)(drawn.y + y) * dst->pitch + drawn.x * 4;
+          for (int x = blitRow(in, out, drawn.w, alpha); x < drawn.w; x++)
+          {
+               const Uint8 *s = in + x * 4;
+               Uint8 *d = out + x * 4;
+               const int inverse = 255 - s[alpha];
+               if (inverse == 0)
+               {
+                    SDL_memcpy(d, s, 4);
+                    continue;
+               }
+               for (int c = 0; c < 4; c++)
+               {
+                    d[c] = (Uint8)SDL_min(255, s[c] + mulDiv255(d[c], inverse));
+               }
+          }
+     }
+     SDL_UnlockSurface(dst);
+     SDL_UnlockSurface(src);
+     return 0;
+}
@@ -0,0 +1,232 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+     const char *PHASE_NAMES[PROFILE_PHASE_COUNT] = {"input", "update", "render", "present"};
+     const char *COUNTER_NAMES[PROFILE_COUNTER_COUNT] = {"draw_calls", "vertices", "texture_binds", "state_changes",
+                                                         "upload_bytes", "gpu_us", "allocations", "allocated_bytes",
+                                                         "audio_underruns", "hint_lookups", "input_age_us"};
+
+     // Copy out the published frames, oldest first. The writer may overwrite
+     // the oldest slots while we read, so skip anything it could have lapped.
+     int snapshot(const Profiler &profiler, int maxFrames, std::vector<FrameSample> &out, int &firstFrame)
+     {
+          int written = SDL_AtomicGet(const_cast<SDL_atomic_t *>(&profiler.framesWritten));
+          SDL_CompilerBarrier();
+          int count = SDL_min(written, SDL_min(maxFrames, PROFILER_HISTORY - 1));
+          firstFrame = written - count;
+          out.resize(count);
+          for (int i = 0; i < count; i++)
+          {
+               out[i] = profiler.history[(firstFrame + i) & (PROFILER_HISTORY - 1)];
+          }
+          return count;
+     }
+}
+
+void profilerInit(Profiler &profiler)
+{
+     SDL_zero(profiler.current);
+     SDL_zero(profiler.history);
+     profiler.frequency = SDL_GetPerformanceFrequency();
+     profiler.epoch = SDL_GetPerformanceCounter();
+     SDL_AtomicSet(&profiler.framesWritten, 0);
+}
+
+void profilerBeginFrame(Profiler &profiler)
+{
+     SDL_zero(profiler.current);
+     profiler.current.frameStart = SDL_GetPerformanceCounter();
+}
+
+void profilerEndFrame(Profiler &profiler)
+{
+     profiler.current.frameTicks = SDL_GetPerformanceCounter() - profiler.current.frameStart;
+
+     // Fill the slot first, then publish it by bumping the index
+     int index = SDL_AtomicGet(&profiler.framesWritten);
+     profiler.history[index & (PROFILER_HISTORY - 1)] = profiler.current;
+     SDL_MemoryBarrierRelease();
+     SDL_AtomicSet(&profiler.framesWritten, index + 1);
+}
+
+void profilerBeginPhase(Profiler &profiler, ProfilePhase phase)
+{
+     profiler.current.phaseStart[phase] = SDL_GetPerformanceCounter();
+}
+
+void profilerEndPhase(Profiler &profiler, ProfilePhase phase)
+{
+     profiler.current.phaseTicks[phase] += SDL_GetPerformanceCounter() - profiler.current.phaseStart[phase];
+}
+
+void profilerSetCounter(Profiler &profiler, ProfileCounter counter, Sint64 value)
+{
+     profiler.current.counters[counter] = value;
+}
+
+const char *profilerPhaseName(ProfilePhase phase)
+{
+     return PHASE_NAMES[phase];
+}
+
+const char *profilerCounterName(ProfileCounter counter)
+{
+     return COUNTER_NAMES[counter];
+}
+
+double profilerTicksToMs(const Profiler &profiler, Uint64 ticks)
+{
+     return ticks * 1000.0 / profiler.frequency;
+}
+
+void profilerComputeStats(const Profiler &profiler, int maxFrames, ProfileStats &stats)
+{
+     SDL_zero(stats);
+
+     std::vector<FrameSample> frames;
+     int firstFrame;
+     int count = snapshot(profiler, maxFrames, frames, firstFrame);
+     stats.frames = count;
+     if (count == 0)
+     {
+          return;
+     }
+
+     std::vector<double> totals(count);
+     for (int i = 0; i < count; i++)
+     {
+          totals[i] = profilerTicksToMs(profiler, frames[i].frameTicks);
+          for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+          {
+               stats.phaseAverage[p] += profilerTicksToMs(profiler, frames[i].phaseTicks[p]);
+          }
+          for (int c = 0; c < PROFILE_COUNTER_COUNT; c++)
+          {
+               stats.counterAverage[c] += (double)frames[i].counters[c];
+          }
+     }
+     for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+     {
+          stats.phaseAverage[p] /= count;
+     }
+     for (int c = 0; c < PROFILE_COUNTER_COUNT; c++)
+     {
+          stats.counterAverage[c] /= count;
+     }
+
+     std::sort(totals.begin(), totals.end());
+     stats.p50 = totals[(count - 1) / 2];
+     stats.p99 = totals[(size_t)((count - 1) * 0.99)];
+     stats.max = totals[count - 1];
+}
+
+bool profilerWriteCsv(const Profiler &profiler, const std::string &path)
+{
+     SDL_RWops *rw = SDL_RWFromFile(path.c_str(), "w");
+     if (rw == nullptr)
+     {
+          std::cerr << "Unable to write " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+
+     std::vector<FrameSample> frames;
+     int firstFrame;
+     int count = snapshot(profiler, PROFILER_HISTORY, frames, firstFrame);
+
+     std::string text = "frame";
+     for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+     {
+          text += std::string(",") + PHASE_NAMES[p] + "_ms";
+     }
+     text += ",total_ms";
+     for (int c = 0; c < PROFILE_COUNTER_COUNT; c++)
+     {
+          text += std::string(",") + COUNTER_NAMES[c];
+     }
+     text += "\n";
+
+     char field[64];
+     for (int i = 0; i < count; i++)
+     {
+          SDL_snprintf(field, sizeof(field), "%d", firstFrame + i);
+          text += field;
+          for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+          {
+               SDL_snprintf(field, sizeof(field), ",%.4f", profilerTicksToMs(profiler, frames[i].phaseTicks[p]));
+               text += field;
+          }
+          SDL_snprintf(field, sizeof(field), ",%.4f", profilerTicksToMs(profiler, frames[i].frameTicks));
+          text += field;
+          for (int c = 0; c < PROFILE_COUNTER_COUNT; c++)
+          {
+               SDL_snprintf(field, sizeof(field), ",%" SDL_PRIs64, frames[i].counters[c]);
+               text += field;
+          }
+          text += "\n";
+     }
+
+     bool ok = SDL_RWwrite(rw, text.data(), 1, text.size()) == text.size();
+     SDL_RWclose(rw);
+     return ok;
+}
+
+bool profilerWriteChromeTrace(const Profiler &profiler, const std::string &path)
+{
+     SDL_RWops *rw = SDL_RWFromFile(path.c_str(), "w");
+     if (rw == nullptr)
+     {
+          std::cerr << "Unable to write " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+
+     std::vector<FrameSample> frames;
+     int firstFrame;
+     int count = snapshot(profiler, PROFILER_HISTORY, frames, firstFrame);
+
+     // Complete ("X") events in microseconds; phases nest inside their frame
+     const double toUs = 1000000.0 / profiler.frequency;
+     std::string text = "{\"traceEvents\":[\n";
+     char event[256];
+     bool first = true;
+     for (int i = 0; i < count; i++)
+     {
+          const FrameSample &frame = frames[i];
+          SDL_snprintf(event, sizeof(event),
+                       "%s{\"name\":\"frame %d\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                       first ? "" : ",\n", firstFrame + i,
+                       (frame.frameStart - profiler.epoch) * toUs, frame.frameTicks * toUs);
+          text += event;
+          first = false;
+
+          for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+          {
+               if (frame.phaseTicks[p] == 0)
+               {
+                    continue;
+               }
+               SDL_snprintf(event, sizeof(event),
+                            ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                            PHASE_NAMES[p], (frame.phaseStart[p] - profiler.epoch) * toUs, frame.phaseTicks[p] * toUs);
+               text += event;
+          }
+
+          // Counter ("C") events draw each count as a track under the frames
+          for (int c = 0; c < PROFILE_COUNTER_COUNT; c++)
+          {
+               SDL_snprintf(event, sizeof(event),
+                            ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%" SDL_PRIs64 "}}",
+                            COUNTER_NAMES[c], (frame.frameStart - profiler.epoch) * toUs, frame.counters[c]);
+               text += event;
+          }
+     }
+     text += "\n]}\n";
+
+     bool ok = SDL_RWwrite(rw, text.data(), 1, text.size()) == text.size();
+     SDL_RWclose(rw);
+     return ok;
+}
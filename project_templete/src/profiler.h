@@ -0,0 +1,121 @@
+// Description:
+// Lightweight frame profiler. Each frame is split into phases timed with
+// SDL_GetPerformanceCounter; completed frames are published into a
+// fixed-size ring buffer with an atomic write index, so another thread can
+// read history (for export or telemetry) without taking a lock while the
+// game thread keeps recording.
+//
+//     profilerBeginFrame(profiler);
+//     {
+//          ProfileScope scope(profiler, PROFILE_UPDATE);
+//          ...
+//     }
+//     profilerEndFrame(profiler);
+// =============================================================================
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <SDL2/SDL.h>
+#include <string>
+
+enum ProfilePhase
+{
+     PROFILE_INPUT,
+     PROFILE_UPDATE,
+     PROFILE_RENDER,
+     PROFILE_PRESENT,
+     PROFILE_PHASE_COUNT
+};
+
+// Per-frame work counts reported alongside the timings
+enum ProfileCounter
+{
+     PROFILE_DRAW_CALLS,
+     PROFILE_VERTICES,
+     PROFILE_TEXTURE_BINDS,
+     PROFILE_STATE_CHANGES,
+     PROFILE_UPLOAD_BYTES,
+     PROFILE_GPU_MICROSECONDS, // Render region on the GPU, 0 where it cannot be measured
+     PROFILE_ALLOCATIONS,      // SDL_malloc calls on every thread, from memory_tags
+     PROFILE_ALLOCATED_BYTES,
+     PROFILE_AUDIO_UNDERRUNS,  // Late mix callbacks, from audio_device
+     PROFILE_HINT_LOOKUPS,     // Hints looked up by name, from hint_cache
+     PROFILE_INPUT_AGE_US,     // Oldest input's age when simulated, from input_thread; 0 without it
+     PROFILE_COUNTER_COUNT
+};
+
+const int PROFILER_HISTORY = 1024; // Frames kept, must be a power of two
+
+struct FrameSample
+{
+     Uint64 frameStart;                       // Counter value at frame start
+     Uint64 frameTicks;                       // Whole frame duration
+     Uint64 phaseStart[PROFILE_PHASE_COUNT];  // Counter value at phase start
+     Uint64 phaseTicks[PROFILE_PHASE_COUNT];  // Time spent in each phase
+     Sint64 counters[PROFILE_COUNTER_COUNT];
+};
+
+struct Profiler
+{
+     Uint64 frequency;  // Counter ticks per second
+     Uint64 epoch;      // Counter value at profilerInit, trace time zero
+     FrameSample current;
+     FrameSample history[PROFILER_HISTORY];
+     SDL_atomic_t framesWritten; // Total frames published, slot = count % HISTORY
+};
+
+// Frame time summary in milliseconds over the most recent frames
+struct ProfileStats
+{
+     int frames;
+     double p50;
+     double p99;
+     double max;
+     double phaseAverage[PROFILE_PHASE_COUNT];
+     double counterAverage[PROFILE_COUNTER_COUNT];
+};
+
+void profilerInit(Profiler &profiler);
+
+void profilerBeginFrame(Profiler &profiler);
+void profilerEndFrame(Profiler &profiler);
+
+void profilerBeginPhase(Profiler &profiler, ProfilePhase phase);
+void profilerEndPhase(Profiler &profiler, ProfilePhase phase);
+
+// Record a count for the current frame
+void profilerSetCounter(Profiler &profiler, ProfileCounter counter, Sint64 value);
+
+// Times the enclosing block as one phase
+struct ProfileScope
+{
+     Profiler &profiler;
+     ProfilePhase phase;
+
+     ProfileScope(Profiler &profiler, ProfilePhase phase) : profiler(profiler), phase(phase)
+     {
+          profilerBeginPhase(profiler, phase);
+     }
+     ~ProfileScope()
+     {
+          profilerEndPhase(profiler, phase);
+     }
+};
+
+const char *profilerPhaseName(ProfilePhase phase);
+const char *profilerCounterName(ProfileCounter counter);
+
+double profilerTicksToMs(const Profiler &profiler, Uint64 ticks);
+
+// Summarize up to `maxFrames` of the newest published frames
+void profilerComputeStats(const Profiler &profiler, int maxFrames, ProfileStats &stats);
+
+// One row per frame: frame,input_ms,update_ms,render_ms,present_ms,total_ms
+// followed by one column per counter
+bool profilerWriteCsv(const Profiler &profiler, const std::string &path);
+
+// Chrome trace event JSON, viewable in chrome://tracing or Perfetto
+bool profilerWriteChromeTrace(const Profiler &profiler, const std::string &path);
+
+#endif // PROFILER_H
@@ -0,0 +1,101 @@
+#include "profiler_overlay.h"
+
+#include "utf_convert.h"
+
+namespace
+{
+     const double REFRESH_SECONDS = 0.25;
+     const int STATS_FRAMES = 240;
+     const float GRAPH_HEIGHT = 64.0f;
+     const double GRAPH_MAX_MS = 40.0; // Top of the graph; slower frames are clipped to it
+
+     // Newest published frames, oldest on the left, as points in the graph
+     // box. Reads the ring like profilerComputeStats, a slot the writer may
+     // be lapping aside
+     int graphPoints(ProfilerOverlay &overlay, const Profiler &profiler, float x, float bottom)
+     {
+          const int written = SDL_AtomicGet(const_cast<SDL_atomic_t *>(&profiler.framesWritten));
+          SDL_CompilerBarrier();
+          const int count = SDL_min(written, PROFILER_GRAPH_FRAMES);
+          const int first = written - count;
+          for (int i = 0; i < count; i++)
+          {
+               const FrameSample &sample = profiler.history[(first + i) & (PROFILER_HISTORY - 1)];
+               const double ms = SDL_min(profilerTicksToMs(profiler, sample.frameTicks), GRAPH_MAX_MS);
+               overlay.graph[i] = {x + (PROFILER_GRAPH_FRAMES - count + i), bottom - (float)(ms / GRAPH_MAX_MS * GRAPH_HEIGHT)};
+          }
+          return count;
+     }
+}
+
+void profilerOverlayInit(ProfilerOverlay &overlay, GlyphCache *glyphs, int fontId)
+{
+     overlay.glyphs = glyphs;
+     overlay.fontId = fontId;
+     overlay.text[0] = '\0';
+     overlay.lastRefresh = 0;
+     overlay.visible = false;
+}
+
+void profilerOverlayDraw(ProfilerOverlay &overlay, const Profiler &profiler, RenderQueue &queue, float x, float y,
+                         LineBatch *lines)
+{
+     if (!overlay.visible || overlay.glyphs == nullptr || overlay.fontId < 0)
+     {
+          return;
+     }
+
+     Uint64 now = SDL_GetPerformanceCounter();
+     if (overlay.text[0] == '\0' || (now - overlay.lastRefresh) >= REFRESH_SECONDS * profiler.frequency)
+     {
+          overlay.lastRefresh = now;
+
+          ProfileStats stats;
+          profilerComputeStats(profiler, STATS_FRAMES, stats);
+          SDL_snprintf(overlay.text, sizeof(overlay.text),
+                       "frame p50 %.2f ms  p99 %.2f ms  max %.2f ms\n"
+                       "input %.2f  update %.2f  render %.2f  present %.2f  gpu %.2f\n"
+                       "draws %.0f  vertices %.0f  binds %.0f  state %.0f  upload %.1f KB  hints %.1f\n"
+                       "allocs %.1f  %.1f KB  audio underruns %.0f  input age %.2f ms",
+                       stats.p50, stats.p99, stats.max,
+                       stats.phaseAverage[PROFILE_INPUT], stats.phaseAverage[PROFILE_UPDATE],
+                       stats.phaseAverage[PROFILE_RENDER], stats.phaseAverage[PROFILE_PRESENT],
+                       stats.counterAverage[PROFILE_GPU_MICROSECONDS] / 1000.0,
+                       stats.counterAverage[PROFILE_DRAW_CALLS], stats.counterAverage[PROFILE_VERTICES],
+                       stats.counterAverage[PROFILE_TEXTURE_BINDS], stats.counterAverage[PROFILE_STATE_CHANGES],
+                       stats.counterAverage[PROFILE_UPLOAD_BYTES] / 1024.0, stats.counterAverage[PROFILE_HINT_LOOKUPS],
+                       stats.counterAverage[PROFILE_ALLOCATIONS], stats.counterAverage[PROFILE_ALLOCATED_BYTES] / 1024.0,
+                       stats.counterAverage[PROFILE_AUDIO_UNDERRUNS] * stats.frames,
+                       stats.counterAverage[PROFILE_INPUT_AGE_US] / 1000.0);
+          utfDecode(overlay.text, overlay.codepoints);
+     }
+
+     int w, h;
+     glyphCacheMeasureCodepoints(*overlay.glyphs, overlay.fontId, overlay.codepoints.data(), overlay.codepoints.size(), &w,
+                                 &h);
+
+     const SDL_Color shade = {0, 0, 0, 160};
+     const SDL_Color white = {255, 255, 255, 255};
+     SDL_FRect background = {x - 4.0f, y - 2.0f, w + 8.0f, h + 4.0f};
+     renderQueueFillRect(queue, background, shade);
+     glyphCacheDrawCodepoints(*overlay.glyphs, queue, overlay.fontId, overlay.codepoints.data(), overlay.codepoints.size(), x,
+                              y, white);
+     if (lines == nullptr)
+     {
+          return;
+     }
+
+     // 16.7 and 33.3 ms marks under the frame times
+     const float top = y + h + 6.0f, bottom = top + GRAPH_HEIGHT;
+     SDL_FRect graphBackground = {x - 4.0f, top - 2.0f, PROFILER_GRAPH_FRAMES + 8.0f, GRAPH_HEIGHT + 4.0f};
+     renderQueueFillRect(queue, graphBackground, shade);
+     const SDL_Color mark = {255, 255, 255, 64};
+     const double marks[2] = {1000.0 / 60.0, 1000.0 / 30.0};
+     for (double ms : marks)
+     {
+          const float markY = bottom - (float)(ms / GRAPH_MAX_MS * GRAPH_HEIGHT);
+          lineBatchLine(*lines, {x, markY}, {x + PROFILER_GRAPH_FRAMES, markY}, 1.0f, mark);
+     }
+     const SDL_Color trace = {120, 230, 120, 255};
+     lineBatchPolyline(*lines, overlay.graph, graphPoints(overlay, profiler, x, bottom), 1.5f, trace);
+}
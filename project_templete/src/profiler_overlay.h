@@ -0,0 +1,40 @@
+// Description:
+// On-screen frame-time readout for the profiler. The summary string is
+// refreshed a few times per second and drawn every frame from the glyph
+// cache, so the overlay adds no texture uploads of its own. Given a line
+// batch, a graph of the newest frame times goes under the text.
+// =============================================================================
+
+#ifndef PROFILER_OVERLAY_H
+#define PROFILER_OVERLAY_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "glyph_cache.h"
+#include "line_batch.h"
+#include "profiler.h"
+#include "render_queue.h"
+
+const int PROFILER_GRAPH_FRAMES = 240; // One pixel each
+
+struct ProfilerOverlay
+{
+     GlyphCache *glyphs;
+     int fontId;
+     char text[320];
+     std::vector<Uint32> codepoints; // `text` decoded at each refresh, for each draw
+     Uint64 lastRefresh; // Counter value of the last text update
+     bool visible;
+     SDL_FPoint graph[PROFILER_GRAPH_FRAMES];
+};
+
+void profilerOverlayInit(ProfilerOverlay &overlay, GlyphCache *glyphs, int fontId);
+
+// Refresh the text if it is stale and queue it at (x, y). With `lines`,
+// also queue the frame-time graph below it; its background goes in `queue`,
+// so flush `lines` after the queue
+void profilerOverlayDraw(ProfilerOverlay &overlay, const Profiler &profiler, RenderQueue &queue, float x, float y,
+                         LineBatch *lines = nullptr);
+
+#endif // PROFILER_OVERLAY_H
@@ -0,0 +1,148 @@
+#include "program_cache.h"
+
+#include <filesystem>
+#include <iostream>
+
+#include "checksum.h"
+#include "file_commit.h"
+
+namespace
+{
+     const Uint32 PROGRAM_MAGIC = 0x47525043; // "CPRG" read in native byte order
+     const Uint32 PROGRAM_VERSION = 1;
+     const Uint32 MAX_PROGRAM_BYTES = 64 * 1024 * 1024;
+
+     struct ProgramHeader
+     {
+          Uint32 magic;
+          Uint32 version;
+          Uint32 format; // The driver's binary format, for glProgramBinary
+          Uint32 size;
+          Uint32 crc;    // CRC-32C of the binary
+          Uint32 reserved;
+          Uint64 stamp;
+     };
+
+     // FNV-1a, continued from `hash`
+     Uint64 stampAppend(Uint64 hash, const void *data, size_t size)
+     {
+          const Uint8 *bytes = (const Uint8 *)data;
+          for (size_t i = 0; i < size; i++)
+          {
+               hash = (hash ^ bytes[i]) * 1099511628211ull;
+          }
+          return hash;
+     }
+
+     std::string programPath(const ProgramCache &cache, const char *name)
+     {
+          return cache.directory + name + ".prog";
+     }
+}
+
+bool programCacheOpen(ProgramCache &cache, const char *org, const char *app)
+{
+     cache.directory.clear();
+     cache.hits = 0;
+     cache.misses = 0;
+     if (!SDL_GetHintBoolean(PROGRAM_CACHE_HINT, SDL_TRUE))
+     {
+          return false;
+     }
+
+     char *pref = SDL_GetPrefPath(org, app);
+     if (pref == nullptr)
+     {
+          std::cerr << "Program cache disabled, no preference path! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     std::string base = pref;
+     SDL_free(pref);
+     const char separator = base.empty() ? '/' : base.back(); // SDL_GetPrefPath ends in the platform's separator
+     std::string directory = base + "programs" + separator;
+
+     std::error_code error;
+     std::filesystem::create_directories(std::filesystem::u8path(directory), error);
+     if (error)
+     {
+          std::cerr << "Program cache disabled, unable to create " << directory << ": " << error.message() << std::endl;
+          return false;
+     }
+     cache.directory = directory;
+     return true;
+}
+
+Uint64 programCacheStamp(const char *const *parts, int count)
+{
+     Uint64 hash = 14695981039346656037ull;
+     hash = stampAppend(hash, &PROGRAM_VERSION, sizeof(PROGRAM_VERSION));
+     for (int i = 0; i < count; i++)
+     {
+          const char *part = parts[i] != nullptr ? parts[i] : "";
+          hash = stampAppend(hash, part, SDL_strlen(part) + 1); // The terminator keeps "ab"+"c" apart from "a"+"bc"
+     }
+     return hash;
+}
+
+bool programCacheLoad(ProgramCache &cache, const char *name, Uint64 stamp, Uint32 &format, std::vector<Uint8> &binary)
+{
+     if (cache.directory.empty())
+     {
+          cache.misses++;
+          return false;
+     }
+     SDL_RWops *rw = SDL_RWFromFile(programPath(cache, name).c_str(), "rb");
+     if (rw == nullptr)
+     {
+          cache.misses++;
+          return false;
+     }
+     ProgramHeader header;
+     bool ok = SDL_RWread(rw, &header, sizeof(header), 1) == 1 && header.magic == PROGRAM_MAGIC &&
+               header.version == PROGRAM_VERSION && header.stamp == stamp && header.size > 0 &&
+               header.size <= MAX_PROGRAM_BYTES;
+     if (ok)
+     {
+          binary.resize(header.size);
+          ok = SDL_RWread(rw, binary.data(), 1, header.size) == header.size &&
+               crc32cUpdate(0, binary.data(), header.size) == header.crc;
+     }
+     SDL_RWclose(rw);
+     if (!ok)
+     {
+          binary.clear();
+          cache.misses++;
+          return false;
+     }
+     format = header.format;
+     cache.hits++;
+     return true;
+}
+
+bool programCacheStore(ProgramCache &cache, const char *name, Uint64 stamp, Uint32 format, const void *binary,
+                       size_t size)
+{
+     if (cache.directory.empty() || binary == nullptr || size == 0 || size > MAX_PROGRAM_BYTES)
+     {
+          return false;
+     }
+     ProgramHeader header = {};
+     header.magic = PROGRAM_MAGIC;
+     header.version = PROGRAM_VERSION;
+     header.format = format;
+     header.size = (Uint32)size;
+     header.crc = crc32cUpdate(0, binary, size);
+     header.stamp = stamp;
+
+     // Committed whole, so a crash mid-write leaves the old file (or none)
+     const std::string path = programPath(cache, name);
+     const std::string written = path + ".tmp";
+     SDL_RWops *rw = SDL_RWFromFile(written.c_str(), "wb");
+     if (rw == nullptr)
+     {
+          return false;
+     }
+     bool complete = SDL_RWwrite(rw, &header, sizeof(header), 1) == 1 && SDL_RWwrite(rw, binary, 1, size) == size;
+     complete = SDL_RWclose(rw) == 0 && complete;
+     return fileCommit(written, path, complete);
+}
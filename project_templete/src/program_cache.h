@@ -0,0 +1,49 @@
+// Description:
+// Linked GPU programs kept on disk under SDL_GetPrefPath, so a launch
+// after the first skips compiling and linking shaders, which some drivers
+// take tens to hundreds of milliseconds over. This module only stores and
+// finds the bytes; the renderer gets them from glGetProgramBinary and hands
+// them back to glProgramBinary (gl_sprites does both).
+//
+// Each program has one file, named after it, holding the driver's binary
+// format, a CRC-32C of the bytes, and a stamp. Make the stamp from
+// everything the binary depends on: the shader sources and the driver's
+// vendor, renderer and version strings. A driver update or an edited
+// shader changes the stamp, the old file stops matching and the next store
+// overwrites it, so nothing stale is loaded and nothing piles up.
+//
+// Setting PROGRAM_CACHE_HINT to "0" turns the cache off.
+// =============================================================================
+
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#define PROGRAM_CACHE_HINT "CATCH_PROGRAM_CACHE"
+
+struct ProgramCache
+{
+     std::string directory; // Ends in a separator, empty when disabled
+     int hits;
+     int misses;
+};
+
+// Use <pref path>/programs/ for `org` and `app`; returns false (and leaves
+// the cache disabled, every lookup a miss) if it cannot be created
+bool programCacheOpen(ProgramCache &cache, const char *org, const char *app);
+
+// Stamp from `count` strings, in order; null entries count as empty
+Uint64 programCacheStamp(const char *const *parts, int count);
+
+// The binary stored for `name`, if its stamp is `stamp` and it reads back
+// intact; false on a miss
+bool programCacheLoad(ProgramCache &cache, const char *name, Uint64 stamp, Uint32 &format, std::vector<Uint8> &binary);
+
+// Store (or replace) the binary for `name`
+bool programCacheStore(ProgramCache &cache, const char *name, Uint64 stamp, Uint32 format, const void *binary,
+                       size_t size);
+
+#endif // PROGRAM_CACHE_H
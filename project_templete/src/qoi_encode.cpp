@@ -0,0 +1,147 @@
+#include "qoi_encode.h"
+
+namespace
+{
+     const Uint8 QOI_OP_INDEX = 0x00;
+     const Uint8 QOI_OP_DIFF = 0x40;
+     const Uint8 QOI_OP_LUMA = 0x80;
+     const Uint8 QOI_OP_RUN = 0xC0;
+     const Uint8 QOI_OP_RGB = 0xFE;
+     const Uint8 QOI_OP_RGBA = 0xFF;
+     const int MAX_RUN = 62;
+
+     struct Pixel
+     {
+          Uint8 r, g, b, a;
+     };
+
+     bool samePixel(const Pixel &x, const Pixel &y)
+     {
+          return x.r == y.r && x.g == y.g && x.b == y.b && x.a == y.a;
+     }
+
+     void appendUint32BE(std::vector<Uint8> &out, Uint32 value)
+     {
+          const Uint8 bytes[4] = {(Uint8)(value >> 24), (Uint8)(value >> 16), (Uint8)(value >> 8), (Uint8)value};
+          out.insert(out.end(), bytes, bytes + 4);
+     }
+}
+
+bool qoiEncode(const void *pixels, int pitch, int width, int height, int channels, std::vector<Uint8> &out)
+{
+     if (pixels == nullptr || width <= 0 || height <= 0 || (channels != 3 && channels != 4))
+     {
+          SDL_SetError("Unsupported image for QOI encoding");
+          return false;
+     }
+
+     out.clear();
+     out.reserve((size_t)width * height * 2 + 22); // Typical sprites and screenshots fit, worse ones grow
+     const Uint8 magic[4] = {'q', 'o', 'i', 'f'};
+     out.insert(out.end(), magic, magic + 4);
+     appendUint32BE(out, (Uint32)width);
+     appendUint32BE(out, (Uint32)height);
+     out.push_back((Uint8)channels);
+     out.push_back(0); // sRGB with linear alpha
+
+     Pixel index[64] = {};
+     Pixel previous = {0, 0, 0, 255};
+     int run = 0;
+     for (int y = 0; y < height; y++)
+     {
+          const Uint8 *row = (const Uint8 *)pixels + (size_t)y * pitch;
+          for (int x = 0; x < width; x++, row += channels)
+          {
+               const Pixel pixel = {row[0], row[1], row[2], channels == 4 ? row[3] : (Uint8)255};
+               if (samePixel(pixel, previous))
+               {
+                    if (++run == MAX_RUN)
+                    {
+                         out.push_back((Uint8)(QOI_OP_RUN | (run - 1)));
+                         run = 0;
+                    }
+                    continue;
+               }
+               if (run > 0)
+               {
+                    out.push_back((Uint8)(QOI_OP_RUN | (run - 1)));
+                    run = 0;
+               }
+
+               const int slot = (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64;
+               if (samePixel(index[slot], pixel))
+               {
+                    out.push_back((Uint8)(QOI_OP_INDEX | slot));
+               }
+               else if (pixel.a != previous.a)
+               {
+                    index[slot] = pixel;
+                    const Uint8 rgba[5] = {QOI_OP_RGBA, pixel.r, pixel.g, pixel.b, pixel.a};
+                    out.insert(out.end(), rgba, rgba + 5);
+               }
+               else
+               {
+                    index[slot] = pixel;
+                    const int dr = (Sint8)(pixel.r - previous.r);
+                    const int dg = (Sint8)(pixel.g - previous.g);
+                    const int db = (Sint8)(pixel.b - previous.b);
+                    const int drg = dr - dg;
+                    const int dbg = db - dg;
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                    {
+                         out.push_back((Uint8)(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                    }
+                    else if (drg >= -8 && drg <= 7 && dg >= -32 && dg <= 31 && dbg >= -8 && dbg <= 7)
+                    {
+                         out.push_back((Uint8)(QOI_OP_LUMA | (dg + 32)));
+                         out.push_back((Uint8)((drg + 8) << 4 | (dbg + 8)));
+                    }
+                    else
+                    {
+                         const Uint8 rgb[4] = {QOI_OP_RGB, pixel.r, pixel.g, pixel.b};
+                         out.insert(out.end(), rgb, rgb + 4);
+                    }
+               }
+               previous = pixel;
+          }
+     }
+     if (run > 0)
+     {
+          out.push_back((Uint8)(QOI_OP_RUN | (run - 1)));
+     }
+
+     const Uint8 end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+     out.insert(out.end(), end, end + 8);
+     return true;
+}
+
+bool qoiEncodeSurface(SDL_Surface *surface, std::vector<Uint8> &out)
+{
+     if (surface == nullptr)
+     {
+          SDL_InvalidParamError("surface");
+          return false;
+     }
+     const bool alpha = surface->format->Amask != 0 || SDL_ISPIXELFORMAT_ALPHA(surface->format->format);
+     const Uint32 format = alpha ? SDL_PIXELFORMAT_RGBA32 : SDL_PIXELFORMAT_RGB24;
+     SDL_Surface *converted = surface;
+     if (surface->format->format != format)
+     {
+          converted = SDL_ConvertSurfaceFormat(surface, format, 0);
+          if (converted == nullptr)
+          {
+               return false;
+          }
+     }
+     bool encoded = false;
+     if (SDL_LockSurface(converted) == 0)
+     {
+          encoded = qoiEncode(converted->pixels, converted->pitch, converted->w, converted->h, alpha ? 4 : 3, out);
+          SDL_UnlockSurface(converted);
+     }
+     if (converted != surface)
+     {
+          SDL_FreeSurface(converted);
+     }
+     return encoded;
+}
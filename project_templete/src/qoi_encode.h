@@ -0,0 +1,21 @@
+// Description:
+// QOI encoder, the write side of SDL_image's IMG_LoadQOI_RW. QOI compresses
+// worse than PNG but encodes and decodes in one linear pass with no entropy
+// coder, several times faster than deflate, which suits screenshots taken
+// during play and intermediate captures.
+// =============================================================================
+
+#ifndef QOI_ENCODE_H
+#define QOI_ENCODE_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+// Encode 8-bit RGB (channels 3) or RGBA (channels 4) rows, bytes in that
+// order, into a complete QOI file (sRGB) in `out`
+bool qoiEncode(const void *pixels, int pitch, int width, int height, int channels, std::vector<Uint8> &out);
+
+// Convert any surface to RGB24/RGBA32 as needed and encode it
+bool qoiEncodeSurface(SDL_Surface *surface, std::vector<Uint8> &out);
+
+#endif // QOI_ENCODE_H
@@ -0,0 +1,135 @@
+#include "quad_batch.h"
+
+#include "render_record.h"
+
+namespace
+{
+     // Quads per SDL_RenderGeometryRaw call: the three scratch streams stay
+     // around 160 KB, so they are still in cache when SDL copies them
+     const int CHUNK_QUADS = 2048;
+
+     // sin over one turn, indexed by the top bits of QuadInstance::angle
+     const int SINE_BITS = 10;
+     const int SINE_SIZE = 1 << SINE_BITS;
+     float sineTable[SINE_SIZE];
+     bool sineTableReady = false;
+
+     void buildSineTable()
+     {
+          if (sineTableReady)
+          {
+               return;
+          }
+          for (int i = 0; i < SINE_SIZE; i++)
+          {
+               sineTable[i] = SDL_sinf((float)(2.0 * M_PI) * i / SINE_SIZE);
+          }
+          sineTableReady = true;
+     }
+
+     void expandChunk(QuadBatch &batch, const QuadInstance *instances, int count)
+     {
+          const SDL_FRect *frames = batch.frames.data();
+          const size_t frameCount = batch.frames.size();
+          float *xy = batch.xy.data();
+          float *uv = batch.uv.data();
+          SDL_Color *colors = batch.colors.data();
+
+          for (int i = 0; i < count; i++)
+          {
+               const QuadInstance &q = instances[i];
+               const float hw = q.width * 0.5f;
+               const float hh = q.height * 0.5f;
+
+               // Half-extent axes of the rotated quad
+               float ux = hw, uy = 0.0f, vx = 0.0f, vy = hh;
+               if (q.angle != 0)
+               {
+                    const int index = q.angle >> (16 - SINE_BITS);
+                    const float s = sineTable[index];
+                    const float c = sineTable[(index + SINE_SIZE / 4) & (SINE_SIZE - 1)];
+                    ux = c * hw, uy = s * hw;
+                    vx = -s * hh, vy = c * hh;
+               }
+
+               // 0--1
+               // | /|
+               // |/ |
+               // 3--2
+               xy[0] = q.x - ux - vx, xy[1] = q.y - uy - vy;
+               xy[2] = q.x + ux - vx, xy[3] = q.y + uy - vy;
+               xy[4] = q.x + ux + vx, xy[5] = q.y + uy + vy;
+               xy[6] = q.x - ux + vx, xy[7] = q.y - uy + vy;
+               xy += 8;
+
+               const SDL_FRect &f = frames[q.frame < frameCount ? q.frame : 0];
+               uv[0] = f.x, uv[1] = f.y;
+               uv[2] = f.x + f.w, uv[3] = f.y;
+               uv[4] = f.x + f.w, uv[5] = f.y + f.h;
+               uv[6] = f.x, uv[7] = f.y + f.h;
+               uv += 8;
+
+               colors[0] = colors[1] = colors[2] = colors[3] = q.color;
+               colors += 4;
+          }
+     }
+}
+
+void quadBatchInit(QuadBatch &batch)
+{
+     buildSineTable();
+     batch.texture = nullptr;
+     batch.frames.assign(1, SDL_FRect{0.0f, 0.0f, 1.0f, 1.0f});
+     batch.xy.resize(CHUNK_QUADS * 8);
+     batch.uv.resize(CHUNK_QUADS * 8);
+     batch.colors.resize(CHUNK_QUADS * 4);
+     batch.indices.resize(CHUNK_QUADS * 6);
+     for (int i = 0; i < CHUNK_QUADS; i++)
+     {
+          const int quad[6] = {0, 1, 2, 0, 2, 3};
+          for (int k = 0; k < 6; k++)
+          {
+               batch.indices[i * 6 + k] = i * 4 + quad[k];
+          }
+     }
+     batch.drawCalls = 0;
+}
+
+bool quadBatchSetFrames(QuadBatch &batch, SDL_Texture *texture, const SDL_Rect *rects, int count)
+{
+     batch.texture = texture;
+     batch.frames.assign(1, SDL_FRect{0.0f, 0.0f, 1.0f, 1.0f});
+     if (texture == nullptr || rects == nullptr || count <= 0)
+     {
+          return true;
+     }
+
+     int w = 0, h = 0;
+     if (SDL_QueryTexture(texture, NULL, NULL, &w, &h) < 0 || w == 0 || h == 0)
+     {
+          return false;
+     }
+     batch.frames.resize(count);
+     for (int i = 0; i < count; i++)
+     {
+          const SDL_Rect &r = rects[i];
+          batch.frames[i] = {(float)r.x / w, (float)r.y / h, (float)r.w / w, (float)r.h / h};
+     }
+     return true;
+}
+
+void quadBatchDraw(QuadBatch &batch, SDL_Renderer *renderer, const QuadInstance *instances, int count)
+{
+     batch.drawCalls = 0;
+     for (int first = 0; first < count; first += CHUNK_QUADS)
+     {
+          const int quads = SDL_min(CHUNK_QUADS, count - first);
+          expandChunk(batch, instances + first, quads);
+          renderRecordGeometryRaw(renderer, batch.texture,
+                                batch.xy.data(), 2 * sizeof(float),
+                                batch.colors.data(), sizeof(SDL_Color),
+                                batch.uv.data(), 2 * sizeof(float),
+                                quads * 4, batch.indices.data(), quads * 6, sizeof(int));
+          batch.drawCalls++;
+     }
+}
@@ -0,0 +1,55 @@
+// Description:
+// Compact quad instances for particle systems. Each particle is one 20-byte
+// QuadInstance (center, size, rotation, tint, frame) instead of the four
+// 20-byte vertices plus six indices SDL_RenderGeometry needs, and
+// quadBatchDraw() expands them into SDL_RenderGeometryRaw's separate
+// position / color / uv streams in cache-sized chunks.
+//
+// SDL2's renderer has no instanced draw, so expansion always happens on the
+// CPU; what the compact form saves is the bandwidth of storing, simulating
+// and sorting particles, and the index buffer is built once and shared by
+// every chunk. Texture sub-rects are looked up by frame index, so sprite
+// sheet animation is a counter increment.
+// =============================================================================
+
+#ifndef QUAD_BATCH_H
+#define QUAD_BATCH_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct QuadInstance
+{
+     float x, y;           // Center in render coordinates
+     Uint16 width, height; // Size in pixels
+     Uint16 angle;         // Clockwise rotation in 1/65536 turns
+     Uint16 frame;         // Index into QuadBatch::frames
+     SDL_Color color;      // Tint, multiplied with the texture
+};
+
+struct QuadBatch
+{
+     SDL_Texture *texture;          // nullptr draws solid quads
+     std::vector<SDL_FRect> frames; // Normalized uv rects (x, y, w, h)
+
+     // Per-chunk scratch streams, reused every draw
+     std::vector<float> xy;
+     std::vector<float> uv;
+     std::vector<SDL_Color> colors;
+     std::vector<int> indices; // Shared by every chunk, built once
+
+     int drawCalls; // SDL_RenderGeometryRaw calls made by the last draw
+};
+
+void quadBatchInit(QuadBatch &batch);
+
+// Select the texture and its frames; `rects` are texel rects, and with
+// count 0 (or a null texture) frame 0 covers the whole texture.
+// Returns false if the texture cannot be queried.
+bool quadBatchSetFrames(QuadBatch &batch, SDL_Texture *texture, const SDL_Rect *rects, int count);
+
+// Expand and submit `count` instances. Frame indices past the end of the
+// frame table draw frame 0.
+void quadBatchDraw(QuadBatch &batch, SDL_Renderer *renderer, const QuadInstance *instances, int count);
+
+#endif // QUAD_BATCH_H
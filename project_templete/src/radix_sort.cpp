@@ -0,0 +1,136 @@
+#include "radix_sort.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+     // Below this a comparison sort wins over the histogram setup
+     const size_t MIN_RADIX_COUNT = 256;
+
+     template <typename Key> void countBytes(const Key *keys, size_t count, Uint32 (*histogram)[256])
+     {
+          std::memset(histogram, 0, sizeof(Uint32) * 256 * sizeof(Key));
+          for (size_t i = 0; i < count; i++)
+          {
+               Key key = keys[i];
+               for (size_t digit = 0; digit < sizeof(Key); digit++)
+               {
+                    histogram[digit][key & 0xFF]++;
+                    key >>= 8;
+               }
+          }
+     }
+
+     // Turn one digit's counts into starting offsets; false when every key
+     // has the same byte there and the pass can be skipped
+     bool prefixSum(Uint32 *counts, size_t count)
+     {
+          Uint32 offset = 0;
+          for (int bucket = 0; bucket < 256; bucket++)
+          {
+               if (counts[bucket] == count)
+               {
+                    return false;
+               }
+               const Uint32 n = counts[bucket];
+               counts[bucket] = offset;
+               offset += n;
+          }
+          return true;
+     }
+
+     template <typename Key> void sortKeys(Key *keys, size_t count, Key *scratch)
+     {
+          if (count < MIN_RADIX_COUNT)
+          {
+               std::sort(keys, keys + count);
+               return;
+          }
+          Uint32 histogram[sizeof(Key)][256];
+          countBytes(keys, count, histogram);
+          Key *from = keys, *to = scratch;
+          for (size_t digit = 0; digit < sizeof(Key); digit++)
+          {
+               Uint32 *offsets = histogram[digit];
+               if (!prefixSum(offsets, count))
+               {
+                    continue;
+               }
+               const int shift = (int)digit * 8;
+               for (size_t i = 0; i < count; i++)
+               {
+                    to[offsets[(from[i] >> shift) & 0xFF]++] = from[i];
+               }
+               std::swap(from, to);
+          }
+          if (from != keys)
+          {
+               std::memcpy(keys, from, count * sizeof(Key));
+          }
+     }
+
+     // Stable, so equal keys keep the input order like the radix passes
+     void insertionSortPairs(Uint64 *keys, Uint32 *values, size_t count)
+     {
+          for (size_t i = 1; i < count; i++)
+          {
+               const Uint64 key = keys[i];
+               const Uint32 value = values[i];
+               size_t j = i;
+               while (j > 0 && keys[j - 1] > key)
+               {
+                    keys[j] = keys[j - 1];
+                    values[j] = values[j - 1];
+                    j--;
+               }
+               keys[j] = key;
+               values[j] = value;
+          }
+     }
+}
+
+void radixSortU32(Uint32 *keys, size_t count, Uint32 *scratch)
+{
+     sortKeys(keys, count, scratch);
+}
+
+void radixSortU64(Uint64 *keys, size_t count, Uint64 *scratch)
+{
+     sortKeys(keys, count, scratch);
+}
+
+void radixSortPairsU64(Uint64 *keys, Uint32 *values, size_t count, Uint64 *keyScratch, Uint32 *valueScratch)
+{
+     if (count < MIN_RADIX_COUNT / 8)
+     {
+          insertionSortPairs(keys, values, count);
+          return;
+     }
+     Uint32 histogram[8][256];
+     countBytes(keys, count, histogram);
+     Uint64 *keysFrom = keys, *keysTo = keyScratch;
+     Uint32 *valuesFrom = values, *valuesTo = valueScratch;
+     for (int digit = 0; digit < 8; digit++)
+     {
+          Uint32 *offsets = histogram[digit];
+          if (!prefixSum(offsets, count))
+          {
+               continue;
+          }
+          const int shift = digit * 8;
+          for (size_t i = 0; i < count; i++)
+          {
+               const Uint32 slot = offsets[(keysFrom[i] >> shift) & 0xFF]++;
+               keysTo[slot] = keysFrom[i];
+               valuesTo[slot] = valuesFrom[i];
+          }
+          std::swap(keysFrom, keysTo);
+          std::swap(valuesFrom, valuesTo);
+     }
+     if (keysFrom != keys)
+     {
+          std::memcpy(keys, keysFrom, count * sizeof(Uint64));
+          std::memcpy(values, valuesFrom, count * sizeof(Uint32));
+     }
+}
@@ -0,0 +1,28 @@
+// Description:
+// LSD radix sorts for integer keys, for arrays large enough that
+// comparison sorting dominates a frame (render queues of 100k+ items).
+// std::sort is already an introsort, O(n log n) in the worst case; radix
+// sorting is O(n) per byte of key, and a single counting pass up front
+// builds every byte's histogram and skips bytes that are the same in all
+// keys, so keys whose high bytes are zero (small ids, packed sort keys)
+// cost only the passes they need.
+//
+// Each pass scatters into `scratch` and the two arrays swap roles; the
+// result always ends up back in the caller's array. The sorts are stable,
+// which the pair variant relies on to keep equal keys in input order.
+// =============================================================================
+
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <SDL2/SDL.h>
+
+// Ascending; `scratch` must hold `count` keys
+void radixSortU32(Uint32 *keys, size_t count, Uint32 *scratch);
+void radixSortU64(Uint64 *keys, size_t count, Uint64 *scratch);
+
+// Stable sort of `values` by `keys`, permuting both; equal keys keep their
+// input order. Scratch arrays hold `count` entries each
+void radixSortPairsU64(Uint64 *keys, Uint32 *values, size_t count, Uint64 *keyScratch, Uint32 *valueScratch);
+
+#endif // RADIX_SORT_H
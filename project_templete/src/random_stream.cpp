@@ -0,0 +1,294 @@
+#include "random_stream.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define RANDOM_STREAM_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RANDOM_STREAM_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+     // Jump polynomials from the xoshiro128** reference code: 2^64 and
+     // 2^96 draws ahead
+     const Uint32 RANDOM_JUMP[4] = {0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b};
+     const Uint32 RANDOM_LONG_JUMP[4] = {0xb523952e, 0x0b6f099f, 0xccf5a0ef, 0x1c580662};
+     const float RANDOM_UNIT = 1.0f / 16777216.0f;
+
+     Uint32 randomRotl(Uint32 x, int k)
+     {
+          return (x << k) | (x >> (32 - k));
+     }
+
+     Uint64 randomSplitMix(Uint64 &x)
+     {
+          Uint64 z = (x += 0x9E3779B97F4A7C15ull);
+          z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+          z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+          return z ^ (z >> 31);
+     }
+
+     Uint32 randomStepLane(RandomStream &stream, int lane)
+     {
+          Uint32(&s)[4][4] = stream.state;
+          const Uint32 result = randomRotl(s[1][lane] * 5, 7) * 9;
+          const Uint32 t = s[1][lane] << 9;
+          s[2][lane] ^= s[0][lane];
+          s[3][lane] ^= s[1][lane];
+          s[1][lane] ^= s[2][lane];
+          s[0][lane] ^= s[3][lane];
+          s[2][lane] ^= t;
+          s[3][lane] = randomRotl(s[3][lane], 11);
+          return result;
+     }
+
+     void randomJumpLane(RandomStream &stream, int lane, const Uint32 (&polynomial)[4])
+     {
+          Uint32 jumped[4] = {0, 0, 0, 0};
+          for (int i = 0; i < 4; i++)
+          {
+               for (int bit = 0; bit < 32; bit++)
+               {
+                    if (polynomial[i] & (1u << bit))
+                    {
+                         for (int w = 0; w < 4; w++)
+                         {
+                              jumped[w] ^= stream.state[w][lane];
+                         }
+                    }
+                    randomStepLane(stream, lane);
+               }
+          }
+          for (int w = 0; w < 4; w++)
+          {
+               stream.state[w][lane] = jumped[w];
+          }
+     }
+
+#if defined(RANDOM_STREAM_SSE2)
+     // One draw in every lane. SSE2 has no 32-bit multiply, but * 5 and * 9
+     // are a shift and an add
+     __m128i randomStep4(__m128i &s0, __m128i &s1, __m128i &s2, __m128i &s3)
+     {
+          const __m128i times5 = _mm_add_epi32(s1, _mm_slli_epi32(s1, 2));
+          const __m128i rotated = _mm_or_si128(_mm_slli_epi32(times5, 7), _mm_srli_epi32(times5, 25));
+          const __m128i result = _mm_add_epi32(rotated, _mm_slli_epi32(rotated, 3));
+          const __m128i t = _mm_slli_epi32(s1, 9);
+          s2 = _mm_xor_si128(s2, s0);
+          s3 = _mm_xor_si128(s3, s1);
+          s1 = _mm_xor_si128(s1, s2);
+          s0 = _mm_xor_si128(s0, s3);
+          s2 = _mm_xor_si128(s2, t);
+          s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+          return result;
+     }
+#elif defined(RANDOM_STREAM_NEON)
+     uint32x4_t randomStep4(uint32x4_t &s0, uint32x4_t &s1, uint32x4_t &s2, uint32x4_t &s3)
+     {
+          const uint32x4_t times5 = vmulq_n_u32(s1, 5);
+          const uint32x4_t rotated = vsriq_n_u32(vshlq_n_u32(times5, 7), times5, 25);
+          const uint32x4_t result = vmulq_n_u32(rotated, 9);
+          const uint32x4_t t = vshlq_n_u32(s1, 9);
+          s2 = veorq_u32(s2, s0);
+          s3 = veorq_u32(s3, s1);
+          s1 = veorq_u32(s1, s2);
+          s0 = veorq_u32(s0, s3);
+          s2 = veorq_u32(s2, t);
+          s3 = vsriq_n_u32(vshlq_n_u32(s3, 11), s3, 21);
+          return result;
+     }
+#endif
+}
+
+void randomStreamInit(RandomStream &stream, Uint64 seed, int index)
+{
+     Uint64 mix = seed;
+     const Uint64 a = randomSplitMix(mix);
+     const Uint64 b = randomSplitMix(mix);
+     stream.state[0][0] = (Uint32)a;
+     stream.state[1][0] = (Uint32)(a >> 32);
+     stream.state[2][0] = (Uint32)b;
+     stream.state[3][0] = (Uint32)(b >> 32);
+     for (int i = 0; i < index; i++)
+     {
+          randomJumpLane(stream, 0, RANDOM_LONG_JUMP);
+     }
+     for (int lane = 1; lane < 4; lane++)
+     {
+          for (int w = 0; w < 4; w++)
+          {
+               stream.state[w][lane] = stream.state[w][lane - 1];
+          }
+          randomJumpLane(stream, lane, RANDOM_JUMP);
+     }
+}
+
+void randomStreamJump(RandomStream &stream)
+{
+     for (int lane = 0; lane < 4; lane++)
+     {
+          randomJumpLane(stream, lane, RANDOM_LONG_JUMP);
+     }
+}
+
+Uint32 randomStreamNext(RandomStream &stream)
+{
+     return randomStepLane(stream, 0);
+}
+
+float randomStreamFloat(RandomStream &stream)
+{
+     return (float)(randomStepLane(stream, 0) >> 8) * RANDOM_UNIT;
+}
+
+int randomStreamRange(RandomStream &stream, int range)
+{
+     if (range <= 0)
+     {
+          return 0;
+     }
+     return (int)(((Uint64)randomStepLane(stream, 0) * (Uint32)range) >> 32);
+}
+
+void randomStreamFloats(RandomStream &stream, float *out, size_t count, float low, float high)
+{
+     const float span = high - low;
+     size_t i = 0;
+#if defined(RANDOM_STREAM_SSE2)
+     __m128i s0 = _mm_load_si128((const __m128i *)stream.state[0]);
+     __m128i s1 = _mm_load_si128((const __m128i *)stream.state[1]);
+     __m128i s2 = _mm_load_si128((const __m128i *)stream.state[2]);
+     __m128i s3 = _mm_load_si128((const __m128i *)stream.state[3]);
+     const __m128 unit = _mm_set1_ps(RANDOM_UNIT), low4 = _mm_set1_ps(low), span4 = _mm_set1_ps(span);
+     for (; i < count; i += 4)
+     {
+          const __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(randomStep4(s0, s1, s2, s3), 8)), unit);
+          const __m128 value = _mm_add_ps(low4, _mm_mul_ps(span4, f));
+          if (count - i >= 4)
+          {
+               _mm_storeu_ps(out + i, value);
+          }
+          else
+          {
+               float tail[4];
+               _mm_storeu_ps(tail, value);
+               SDL_memcpy(out + i, tail, (count - i) * sizeof(float));
+          }
+     }
+     _mm_store_si128((__m128i *)stream.state[0], s0);
+     _mm_store_si128((__m128i *)stream.state[1], s1);
+     _mm_store_si128((__m128i *)stream.state[2], s2);
+     _mm_store_si128((__m128i *)stream.state[3], s3);
+#elif defined(RANDOM_STREAM_NEON)
+     uint32x4_t s0 = vld1q_u32(stream.state[0]), s1 = vld1q_u32(stream.state[1]);
+     uint32x4_t s2 = vld1q_u32(stream.state[2]), s3 = vld1q_u32(stream.state[3]);
+     const float32x4_t low4 = vdupq_n_f32(low), span4 = vdupq_n_f32(span);
+     for (; i < count; i += 4)
+     {
+          const uint32x4_t bits = vshrq_n_u32(randomStep4(s0, s1, s2, s3), 8);
+          const float32x4_t f = vmulq_n_f32(vcvtq_f32_u32(bits), RANDOM_UNIT);
+          const float32x4_t value = vaddq_f32(low4, vmulq_f32(span4, f));
+          if (count - i >= 4)
+          {
+               vst1q_f32(out + i, value);
+          }
+          else
+          {
+               float tail[4];
+               vst1q_f32(tail, value);
+               SDL_memcpy(out + i, tail, (count - i) * sizeof(float));
+          }
+     }
+     vst1q_u32(stream.state[0], s0);
+     vst1q_u32(stream.state[1], s1);
+     vst1q_u32(stream.state[2], s2);
+     vst1q_u32(stream.state[3], s3);
+#else
+     // Lane by lane, so the numbers match the SIMD builds'
+     for (; i < count; i += 4)
+     {
+          for (int lane = 0; lane < 4; lane++)
+          {
+               const float f = (float)(randomStepLane(stream, lane) >> 8) * RANDOM_UNIT;
+               if (i + lane < count)
+               {
+                    out[i + lane] = low + span * f;
+               }
+          }
+     }
+#endif
+}
+
+void randomStreamInts(RandomStream &stream, int *out, size_t count, int range)
+{
+     const Uint32 bound = range > 0 ? (Uint32)range : 0;
+     size_t i = 0;
+#if defined(RANDOM_STREAM_SSE2)
+     __m128i s0 = _mm_load_si128((const __m128i *)stream.state[0]);
+     __m128i s1 = _mm_load_si128((const __m128i *)stream.state[1]);
+     __m128i s2 = _mm_load_si128((const __m128i *)stream.state[2]);
+     __m128i s3 = _mm_load_si128((const __m128i *)stream.state[3]);
+     const __m128i bound4 = _mm_set1_epi32((int)bound);
+     const __m128i highHalves = _mm_set_epi32(-1, 0, -1, 0);
+     for (; i < count; i += 4)
+     {
+          // The high half of x * bound: lanes 0 and 2, then 1 and 3
+          const __m128i x = randomStep4(s0, s1, s2, s3);
+          const __m128i even = _mm_srli_epi64(_mm_mul_epu32(x, bound4), 32);
+          const __m128i odd = _mm_and_si128(_mm_mul_epu32(_mm_srli_epi64(x, 32), bound4), highHalves);
+          const __m128i value = _mm_or_si128(even, odd);
+          if (count - i >= 4)
+          {
+               _mm_storeu_si128((__m128i *)(out + i), value);
+          }
+          else
+          {
+               int tail[4];
+               _mm_storeu_si128((__m128i *)tail, value);
+               SDL_memcpy(out + i, tail, (count - i) * sizeof(int));
+          }
+     }
+     _mm_store_si128((__m128i *)stream.state[0], s0);
+     _mm_store_si128((__m128i *)stream.state[1], s1);
+     _mm_store_si128((__m128i *)stream.state[2], s2);
+     _mm_store_si128((__m128i *)stream.state[3], s3);
+#elif defined(RANDOM_STREAM_NEON)
+     uint32x4_t s0 = vld1q_u32(stream.state[0]), s1 = vld1q_u32(stream.state[1]);
+     uint32x4_t s2 = vld1q_u32(stream.state[2]), s3 = vld1q_u32(stream.state[3]);
+     const uint32x2_t bound2 = vdup_n_u32(bound);
+     for (; i < count; i += 4)
+     {
+          const uint32x4_t x = randomStep4(s0, s1, s2, s3);
+          const uint32x2_t lowHalf = vshrn_n_u64(vmull_u32(vget_low_u32(x), bound2), 32);
+          const uint32x2_t highHalf = vshrn_n_u64(vmull_u32(vget_high_u32(x), bound2), 32);
+          const int32x4_t value = vreinterpretq_s32_u32(vcombine_u32(lowHalf, highHalf));
+          if (count - i >= 4)
+          {
+               vst1q_s32(out + i, value);
+          }
+          else
+          {
+               int tail[4];
+               vst1q_s32(tail, value);
+               SDL_memcpy(out + i, tail, (count - i) * sizeof(int));
+          }
+     }
+     vst1q_u32(stream.state[0], s0);
+     vst1q_u32(stream.state[1], s1);
+     vst1q_u32(stream.state[2], s2);
+     vst1q_u32(stream.state[3], s3);
+#else
+     for (; i < count; i += 4)
+     {
+          for (int lane = 0; lane < 4; lane++)
+          {
+               const Uint32 x = randomStepLane(stream, lane);
+               if (i + lane < count)
+               {
+                    out[i + lane] = (int)(((Uint64)x * bound) >> 32);
+               }
+          }
+     }
+#endif
+}
@@ -0,0 +1,57 @@
+// Description:
+// Seeded random number streams for simulation, spawning and effects, in
+// place of rand(). rand() shares one hidden state between every caller:
+// draws from different threads race, an effect drawing once more changes
+// which blocks the game spawns, and the state can be neither saved nor
+// restored. A RandomStream is a plain value: the same seed and index give
+// the same numbers on every run, each thread or system owns its own, and
+// snapshotting the simulation snapshots its RNG too.
+//
+// A stream is four xoshiro128** generators side by side, one per SIMD
+// lane, each 2^64 draws ahead of the last, so randomStreamFloats() and
+// randomStreamInts() produce four numbers per step with SSE2 or NEON. The
+// single draws use lane 0 only. randomStreamInit() places stream `index`
+// 2^96 draws past stream 0, and randomStreamJump() moves a stream there,
+// so streams handed out to threads by index never overlap.
+//
+// Ranges use the high half of a 32 x 32 bit multiply instead of a modulo:
+// no division, and a bias under range / 2^32, far below anything a game
+// could notice.
+//
+//     RandomStream spawns;
+//     randomStreamInit(spawns, seed, 0);
+//     int x = randomStreamRange(spawns, SCREEN_WIDTH);
+//     randomStreamFloats(spawns, speeds.data(), speeds.size(), 50.0f, 200.0f);
+// =============================================================================
+
+#ifndef RANDOM_STREAM_H
+#define RANDOM_STREAM_H
+
+#include <SDL2/SDL.h>
+
+struct alignas(16) RandomStream
+{
+     Uint32 state[4][4]; // [state word][lane]
+};
+
+// Seed the stream from `seed` and put it `index` streams along
+void randomStreamInit(RandomStream &stream, Uint64 seed, int index = 0);
+
+// Advance to where the stream of the next index starts
+void randomStreamJump(RandomStream &stream);
+
+Uint32 randomStreamNext(RandomStream &stream);
+
+// In [0, 1), 24 bits of precision
+float randomStreamFloat(RandomStream &stream);
+
+// In [0, range); 0 for a range of 0 or less
+int randomStreamRange(RandomStream &stream, int range);
+
+// `count` floats in [low, high), four per step
+void randomStreamFloats(RandomStream &stream, float *out, size_t count, float low, float high);
+
+// `count` ints in [0, range), four per step
+void randomStreamInts(RandomStream &stream, int *out, size_t count, int range);
+
+#endif // RANDOM_STREAM_H
@@ -0,0 +1,348 @@
+#include "rect_batch.h"
+
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define RECT_BATCH_X86 1
+#include <emmintrin.h>
+#if defined(__GNUC__) && !defined(__EMSCRIPTEN__)
+#define RECT_BATCH_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RECT_BATCH_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+     // Far edges wrap like the int additions in SDL_rect.c do
+     int farEdge(int position, int size)
+     {
+          return (int)((unsigned)position + (unsigned)size);
+     }
+
+     // Kernels handle elements [begin, count); bit numbers stay absolute
+     typedef void (*IntersectsKernel)(const SDL_Rect &rect, const SDL_Rect *rects, int begin, int count, Uint32 *mask);
+     typedef void (*PointsKernel)(const SDL_Rect &rect, const SDL_Point *points, int begin, int count, Uint32 *mask);
+
+     // --- Scalar kernels ---
+     // SDL_HasIntersection: the overlap's far edge lies past its near edge,
+     // min(ar, br) > max(al, bl), spelled out as four comparisons per axis
+
+     bool intersects(const SDL_Rect &a, int ar, int ab, const SDL_Rect &b)
+     {
+          if (b.w <= 0 || b.h <= 0)
+          {
+               return false;
+          }
+          const int br = farEdge(b.x, b.w);
+          const int bb = farEdge(b.y, b.h);
+          return ar > b.x && br > a.x && br > b.x && ab > b.y && bb > a.y && bb > b.y;
+     }
+
+     // `first` is a multiple of the lane count, so the bits fit one word
+     void setBits(Uint32 *mask, int first, unsigned bits)
+     {
+          mask[first >> 5] |= (Uint32)bits << (first & 31);
+     }
+
+     void intersectsScalar(const SDL_Rect &rect, const SDL_Rect *rects, int begin, int count, Uint32 *mask)
+     {
+          const int ar = farEdge(rect.x, rect.w);
+          const int ab = farEdge(rect.y, rect.h);
+          for (int i = begin; i < count; i++)
+          {
+               if (intersects(rect, ar, ab, rects[i]))
+               {
+                    mask[i >> 5] |= 1u << (i & 31);
+               }
+          }
+     }
+
+     void pointsScalar(const SDL_Rect &rect, const SDL_Point *points, int begin, int count, Uint32 *mask)
+     {
+          const int right = farEdge(rect.x, rect.w);
+          const int bottom = farEdge(rect.y, rect.h);
+          for (int i = begin; i < count; i++)
+          {
+               const SDL_Point &p = points[i];
+               if (p.x >= rect.x && p.x < right && p.y >= rect.y && p.y < bottom)
+               {
+                    mask[i >> 5] |= 1u << (i & 31);
+               }
+          }
+     }
+
+#ifdef RECT_BATCH_X86
+     // --- SSE2: 4 per step ---
+
+     void intersectsSse2(const SDL_Rect &rect, const SDL_Rect *rects, int begin, int count, Uint32 *mask)
+     {
+          const __m128i ax = _mm_set1_epi32(rect.x), ay = _mm_set1_epi32(rect.y);
+          const __m128i ar = _mm_set1_epi32(farEdge(rect.x, rect.w));
+          const __m128i ab = _mm_set1_epi32(farEdge(rect.y, rect.h));
+          const __m128i zero = _mm_setzero_si128();
+          int i = begin;
+          for (; i + 4 <= count; i += 4)
+          {
+               // Four {x, y, w, h} rows to x, y, w, h columns
+               const __m128i r0 = _mm_loadu_si128((const __m128i *)(rects + i));
+               const __m128i r1 = _mm_loadu_si128((const __m128i *)(rects + i + 1));
+               const __m128i r2 = _mm_loadu_si128((const __m128i *)(rects + i + 2));
+               const __m128i r3 = _mm_loadu_si128((const __m128i *)(rects + i + 3));
+               const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+               const __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+               const __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+               const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+               const __m128i bx = _mm_unpacklo_epi64(t0, t1);
+               const __m128i by = _mm_unpackhi_epi64(t0, t1);
+               const __m128i bw = _mm_unpacklo_epi64(t2, t3);
+               const __m128i bh = _mm_unpackhi_epi64(t2, t3);
+               const __m128i br = _mm_add_epi32(bx, bw);
+               const __m128i bb = _mm_add_epi32(by, bh);
+
+               __m128i hit = _mm_and_si128(_mm_cmpgt_epi32(bw, zero), _mm_cmpgt_epi32(bh, zero));
+               hit = _mm_and_si128(hit, _mm_and_si128(_mm_cmpgt_epi32(ar, bx), _mm_cmpgt_epi32(br, ax)));
+               hit = _mm_and_si128(hit, _mm_and_si128(_mm_cmpgt_epi32(ab, by), _mm_cmpgt_epi32(bb, ay)));
+               hit = _mm_and_si128(hit, _mm_and_si128(_mm_cmpgt_epi32(br, bx), _mm_cmpgt_epi32(bb, by)));
+               setBits(mask, i, (unsigned)_mm_movemask_ps(_mm_castsi128_ps(hit)));
+          }
+          intersectsScalar(rect, rects, i, count, mask);
+     }
+
+     void pointsSse2(const SDL_Rect &rect, const SDL_Point *points, int begin, int count, Uint32 *mask)
+     {
+          const __m128i left = _mm_set1_epi32(rect.x), top = _mm_set1_epi32(rect.y);
+          const __m128i right = _mm_set1_epi32(farEdge(rect.x, rect.w));
+          const __m128i bottom = _mm_set1_epi32(farEdge(rect.y, rect.h));
+          int i = begin;
+          for (; i + 4 <= count; i += 4)
+          {
+               // {x0, y0, x1, y1} {x2, y2, x3, y3} to x and y columns
+               const __m128i p0 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(points + i)), _MM_SHUFFLE(3, 1, 2, 0));
+               const __m128i p1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(points + i + 2)), _MM_SHUFFLE(3, 1, 2, 0));
+               const __m128i px = _mm_unpacklo_epi64(p0, p1);
+               const __m128i py = _mm_unpackhi_epi64(p0, p1);
+
+               // p >= left is !(left > p)
+               __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(left, px), _mm_cmpgt_epi32(top, py));
+               __m128i inside = _mm_and_si128(_mm_cmpgt_epi32(right, px), _mm_cmpgt_epi32(bottom, py));
+               setBits(mask, i, (unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(outside, inside))));
+          }
+          pointsScalar(rect, points, i, count, mask);
+     }
+#endif
+
+#ifdef RECT_BATCH_AVX2
+     // --- AVX2: 8 per step, compiled for AVX2 regardless of -m flags ---
+
+     __attribute__((target("avx2"))) void intersectsAvx2(const SDL_Rect &rect, const SDL_Rect *rects, int begin,
+                                                         int count, Uint32 *mask)
+     {
+          const __m256i ax = _mm256_set1_epi32(rect.x), ay = _mm256_set1_epi32(rect.y);
+          const __m256i ar = _mm256_set1_epi32(farEdge(rect.x, rect.w));
+          const __m256i ab = _mm256_set1_epi32(farEdge(rect.y, rect.h));
+          const __m256i zero = _mm256_setzero_si256();
+          // Field offsets of eight consecutive rects, in ints
+          const __m256i stride = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+          int i = begin;
+          for (; i + 8 <= count; i += 8)
+          {
+               const int *base = (const int *)(rects + i);
+               const __m256i bx = _mm256_i32gather_epi32(base, stride, 4);
+               const __m256i by = _mm256_i32gather_epi32(base + 1, stride, 4);
+               const __m256i bw = _mm256_i32gather_epi32(base + 2, stride, 4);
+               const __m256i bh = _mm256_i32gather_epi32(base + 3, stride, 4);
+               const __m256i br = _mm256_add_epi32(bx, bw);
+               const __m256i bb = _mm256_add_epi32(by, bh);
+
+               __m256i hit = _mm256_and_si256(_mm256_cmpgt_epi32(bw, zero), _mm256_cmpgt_epi32(bh, zero));
+               hit = _mm256_and_si256(hit, _mm256_and_si256(_mm256_cmpgt_epi32(ar, bx), _mm256_cmpgt_epi32(br, ax)));
+               hit = _mm256_and_si256(hit, _mm256_and_si256(_mm256_cmpgt_epi32(ab, by), _mm256_cmpgt_epi32(bb, ay)));
+               hit = _mm256_and_si256(hit, _mm256_and_si256(_mm256_cmpgt_epi32(br, bx), _mm256_cmpgt_epi32(bb, by)));
+               setBits(mask, i, (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(hit)));
+          }
+          intersectsSse2(rect, rects, i, count, mask);
+     }
+#endif
+
+#ifdef RECT_BATCH_NEON
+     // --- NEON: 4 per step, vld4/vld2 deinterleave the fields ---
+
+     unsigned laneBits(uint32x4_t lanes)
+     {
+          return (vgetq_lane_u32(lanes, 0) & 1) | (vgetq_lane_u32(lanes, 1) & 2) | (vgetq_lane_u32(lanes, 2) & 4) |
+                 (vgetq_lane_u32(lanes, 3) & 8);
+     }
+
+     void intersectsNeon(const SDL_Rect &rect, const SDL_Rect *rects, int begin, int count, Uint32 *mask)
+     {
+          const int32x4_t ax = vdupq_n_s32(rect.x), ay = vdupq_n_s32(rect.y);
+          const int32x4_t ar = vdupq_n_s32(farEdge(rect.x, rect.w));
+          const int32x4_t ab = vdupq_n_s32(farEdge(rect.y, rect.h));
+          const int32x4_t zero = vdupq_n_s32(0);
+          int i = begin;
+          for (; i + 4 <= count; i += 4)
+          {
+               const int32x4x4_t b = vld4q_s32((const int32_t *)(rects + i));
+               const int32x4_t br = vaddq_s32(b.val[0], b.val[2]);
+               const int32x4_t bb = vaddq_s32(b.val[1], b.val[3]);
+
+               uint32x4_t hit = vandq_u32(vcgtq_s32(b.val[2], zero), vcgtq_s32(b.val[3], zero));
+               hit = vandq_u32(hit, vandq_u32(vcgtq_s32(ar, b.val[0]), vcgtq_s32(br, ax)));
+               hit = vandq_u32(hit, vandq_u32(vcgtq_s32(ab, b.val[1]), vcgtq_s32(bb, ay)));
+               hit = vandq_u32(hit, vandq_u32(vcgtq_s32(br, b.val[0]), vcgtq_s32(bb, b.val[1])));
+               setBits(mask, i, laneBits(hit));
+          }
+          intersectsScalar(rect, rects, i, count, mask);
+     }
+
+     void pointsNeon(const SDL_Rect &rect, const SDL_Point *points, int begin, int count, Uint32 *mask)
+     {
+          const int32x4_t left = vdupq_n_s32(rect.x), top = vdupq_n_s32(rect.y);
+          const int32x4_t right = vdupq_n_s32(farEdge(rect.x, rect.w));
+          const int32x4_t bottom = vdupq_n_s32(farEdge(rect.y, rect.h));
+          int i = begin;
+          for (; i + 4 <= count; i += 4)
+          {
+               const int32x4x2_t p = vld2q_s32((const int32_t *)(points + i));
+               uint32x4_t inside = vandq_u32(vcgeq_s32(p.val[0], left), vcgtq_s32(right, p.val[0]));
+               inside = vandq_u32(inside, vandq_u32(vcgeq_s32(p.val[1], top), vcgtq_s32(bottom, p.val[1])));
+               setBits(mask, i, laneBits(inside));
+          }
+          pointsScalar(rect, points, i, count, mask);
+     }
+#endif
+
+     RectBatchKernel activeRectKernel = RECT_KERNEL_AUTO;
+     IntersectsKernel intersectsKernel = intersectsScalar;
+     PointsKernel pointsKernel = pointsScalar;
+
+     void clearMask(Uint32 *mask, int count)
+     {
+          SDL_memset(mask, 0, ((size_t)count + 31) / 32 * sizeof(Uint32));
+     }
+}
+
+bool rectBatchKernelSupported(RectBatchKernel kernel)
+{
+     switch (kernel)
+     {
+     case RECT_KERNEL_AUTO:
+     case RECT_KERNEL_SCALAR:
+          return true;
+#ifdef RECT_BATCH_X86
+     case RECT_KERNEL_SSE2:
+          return cpuHasSse2();
+#endif
+#ifdef RECT_BATCH_AVX2
+     case RECT_KERNEL_AVX2:
+          return SDL_HasAVX2() == SDL_TRUE;
+#endif
+#ifdef RECT_BATCH_NEON
+     case RECT_KERNEL_NEON:
+          return SDL_HasNEON() == SDL_TRUE;
+#endif
+     default:
+          return false;
+     }
+}
+
+const char *rectBatchKernelName(RectBatchKernel kernel)
+{
+     switch (kernel)
+     {
+     case RECT_KERNEL_SCALAR:
+          return "scalar";
+     case RECT_KERNEL_SSE2:
+          return "sse2";
+     case RECT_KERNEL_AVX2:
+          return "avx2";
+     case RECT_KERNEL_NEON:
+          return "neon";
+     default:
+          return "auto";
+     }
+}
+
+RectBatchKernel rectBatchSetKernel(RectBatchKernel kernel)
+{
+     if (kernel == RECT_KERNEL_AUTO)
+     {
+          const RectBatchKernel preferred[] = {RECT_KERNEL_AVX2, RECT_KERNEL_NEON, RECT_KERNEL_SSE2};
+          kernel = RECT_KERNEL_SCALAR;
+          for (RectBatchKernel candidate : preferred)
+          {
+               if (rectBatchKernelSupported(candidate))
+               {
+                    kernel = candidate;
+                    break;
+               }
+          }
+     }
+     else if (!rectBatchKernelSupported(kernel))
+     {
+          kernel = RECT_KERNEL_SCALAR;
+     }
+
+     activeRectKernel = kernel;
+     intersectsKernel = intersectsScalar;
+     pointsKernel = pointsScalar;
+#ifdef RECT_BATCH_X86
+     if (kernel == RECT_KERNEL_SSE2 || kernel == RECT_KERNEL_AVX2)
+     {
+          intersectsKernel = intersectsSse2;
+          pointsKernel = pointsSse2;
+     }
+#endif
+#ifdef RECT_BATCH_AVX2
+     if (kernel == RECT_KERNEL_AVX2)
+     {
+          // Points load as two interleaved ints; SSE2 already keeps up there
+          intersectsKernel = intersectsAvx2;
+     }
+#endif
+#ifdef RECT_BATCH_NEON
+     if (kernel == RECT_KERNEL_NEON)
+     {
+          intersectsKernel = intersectsNeon;
+          pointsKernel = pointsNeon;
+     }
+#endif
+     return kernel;
+}
+
+void rectBatchIntersects(const SDL_Rect &rect, const SDL_Rect *rects, int count, Uint32 *mask)
+{
+     if (count <= 0)
+     {
+          return;
+     }
+     clearMask(mask, count);
+     if (rect.w <= 0 || rect.h <= 0)
+     {
+          return;
+     }
+     if (activeRectKernel == RECT_KERNEL_AUTO)
+     {
+          rectBatchSetKernel(RECT_KERNEL_AUTO);
+     }
+     intersectsKernel(rect, rects, 0, count, mask);
+}
+
+void rectBatchContainsPoints(const SDL_Rect &rect, const SDL_Point *points, int count, Uint32 *mask)
+{
+     if (count <= 0)
+     {
+          return;
+     }
+     clearMask(mask, count);
+     if (activeRectKernel == RECT_KERNEL_AUTO)
+     {
+          rectBatchSetKernel(RECT_KERNEL_AUTO);
+     }
+     pointsKernel(rect, points, 0, count, mask);
+}
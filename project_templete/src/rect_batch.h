@@ -0,0 +1,41 @@
+// Description:
+// Batch versions of the SDL_rect.h tests for collision, picking and
+// renderQueueFlush's cull against the dirty rect: one rect against an
+// array of rects (SDL_HasIntersection) or of points (SDL_PointInRect),
+// with the answers written as a bitmask instead of one call per pair. Bit i of mask[i / 32] (bit i % 32) is set when element i
+// passes; the caller provides (count + 31) / 32 words, every one of which
+// is written.
+//
+// Results match the scalar SDL functions exactly, empty rects and shared
+// edges included. Kernels: SSE2 (4 per step), AVX2 (8, chosen at runtime),
+// NEON (4) and scalar; the fastest supported one is picked on first use.
+// =============================================================================
+
+#ifndef RECT_BATCH_H
+#define RECT_BATCH_H
+
+#include <SDL2/SDL.h>
+
+enum RectBatchKernel
+{
+     RECT_KERNEL_AUTO,
+     RECT_KERNEL_SCALAR,
+     RECT_KERNEL_SSE2,
+     RECT_KERNEL_AVX2,
+     RECT_KERNEL_NEON
+};
+
+bool rectBatchKernelSupported(RectBatchKernel kernel);
+const char *rectBatchKernelName(RectBatchKernel kernel);
+
+// Force a kernel (for benchmarks); unsupported ones fall back to scalar.
+// Returns the kernel now in use.
+RectBatchKernel rectBatchSetKernel(RectBatchKernel kernel);
+
+// mask bit i = SDL_HasIntersection(&rect, &rects[i])
+void rectBatchIntersects(const SDL_Rect &rect, const SDL_Rect *rects, int count, Uint32 *mask);
+
+// mask bit i = SDL_PointInRect(&points[i], &rect)
+void rectBatchContainsPoints(const SDL_Rect &rect, const SDL_Point *points, int count, Uint32 *mask);
+
+#endif // RECT_BATCH_H
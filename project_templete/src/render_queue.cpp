@@ -0,0 +1,769 @@
+#include "render_queue.h"
+
+#include <algorithm>
+
+#include "radix_sort.h"
+#include "rect_batch.h"
+#include "render_record.h"
+
+namespace
+{
+     // Fewer elements than this per chunk cost more to schedule than to record
+     const int MIN_CHUNK_ELEMENTS = 512;
+
+     // From here on radix sorting the keys beats std::sort
+     const size_t RADIX_SORT_ITEMS = 2048;
+
+     // Culling bounds are clamped to this many pixels either side of the origin
+     const float CULL_LIMIT = (float)(1 << 29);
+
+     // sin over one turn in ROTATION_STEPS steps, for renderQueueCopyEx
+     float rotationSine[ROTATION_STEPS];
+     bool rotationTableReady = false;
+
+     void buildRotationTable()
+     {
+          if (rotationTableReady)
+          {
+               return;
+          }
+          for (int i = 0; i < ROTATION_STEPS; i++)
+          {
+               rotationSine[i] = (float)SDL_sin(2.0 * M_PI * i / ROTATION_STEPS);
+          }
+          // Quarter turns exactly, so a 90 degree copy is not skewed by rounding
+          const float quarters[4] = {0.0f, 1.0f, 0.0f, -1.0f};
+          for (int q = 0; q < 4; q++)
+          {
+               rotationSine[q * ROTATION_STEPS / 4] = quarters[q];
+          }
+          rotationTableReady = true;
+     }
+
+     bool isRotated(const RenderItem &item)
+     {
+          return item.sinAngle != 0.0f || item.cosAngle != 1.0f;
+     }
+
+     // Top-left, top-right, bottom-left, bottom-right, turned about the pivot
+     void itemCorners(const RenderItem &item, SDL_FPoint corners[4])
+     {
+          const SDL_FRect &d = item.dst;
+          corners[0] = {d.x, d.y};
+          corners[1] = {d.x + d.w, d.y};
+          corners[2] = {d.x, d.y + d.h};
+          corners[3] = {d.x + d.w, d.y + d.h};
+          if (!isRotated(item))
+          {
+               return;
+          }
+          for (int i = 0; i < 4; i++)
+          {
+               const float x = corners[i].x - item.pivot.x, y = corners[i].y - item.pivot.y;
+               corners[i] = {item.pivot.x + x * item.cosAngle - y * item.sinAngle,
+                             item.pivot.y + x * item.sinAngle + y * item.cosAngle};
+          }
+     }
+
+     // What the item covers on screen
+     SDL_FRect itemBounds(const RenderItem &item)
+     {
+          if (!isRotated(item))
+          {
+               return item.dst;
+          }
+          SDL_FPoint corners[4];
+          itemCorners(item, corners);
+          float x0 = corners[0].x, x1 = corners[0].x, y0 = corners[0].y, y1 = corners[0].y;
+          for (int i = 1; i < 4; i++)
+          {
+               x0 = SDL_min(x0, corners[i].x);
+               x1 = SDL_max(x1, corners[i].x);
+               y0 = SDL_min(y0, corners[i].y);
+               y1 = SDL_max(y1, corners[i].y);
+          }
+          return {x0, y0, x1 - x0, y1 - y0};
+     }
+
+     // Normalized coordinates of `src` in `texture`, the whole texture for
+     // nullptr; false when the texture cannot be queried
+     bool textureCoords(SDL_Texture *texture, const SDL_Rect *src, SDL_FPoint &uvMin, SDL_FPoint &uvMax)
+     {
+          if (src == nullptr)
+          {
+               uvMin = {0.0f, 0.0f};
+               uvMax = {1.0f, 1.0f};
+               return true;
+          }
+          int w = 0, h = 0;
+          if (SDL_QueryTexture(texture, NULL, NULL, &w, &h) < 0 || w == 0 || h == 0)
+          {
+               return false;
+          }
+          uvMin = {(float)src->x / w, (float)src->y / h};
+          uvMax = {(float)(src->x + src->w) / w, (float)(src->y + src->h) / h};
+          return true;
+     }
+
+     struct RecordJob
+     {
+          RenderRecordFunction record;
+          void *data;
+          RenderQueue *parts;
+          int elementCount;
+          int chunkSize;
+     };
+
+     void recordChunk(void *userdata, int chunk)
+     {
+          RecordJob &job = *(RecordJob *)userdata;
+          int begin = chunk * job.chunkSize;
+          int end = SDL_min(begin + job.chunkSize, job.elementCount);
+          job.record(job.data, job.parts[chunk], begin, end);
+     }
+
+     Uint32 packColor(SDL_Color c)
+     {
+          return ((Uint32)c.r << 24) | ((Uint32)c.g << 16) | ((Uint32)c.b << 8) | c.a;
+     }
+
+     bool sameColor(SDL_Color a, SDL_Color b)
+     {
+          return packColor(a) == packColor(b);
+     }
+
+     // Opaque first, then the blended modes; eight values fit the key's three bits
+     Uint8 blendBits(SDL_Texture *texture)
+     {
+          SDL_BlendMode mode = SDL_BLENDMODE_NONE;
+          SDL_GetTextureBlendMode(texture, &mode);
+          switch (mode)
+          {
+          case SDL_BLENDMODE_NONE:
+               return 0;
+          case SDL_BLENDMODE_BLEND:
+               return 1;
+          case SDL_BLENDMODE_ADD:
+               return 2;
+          case SDL_BLENDMODE_MOD:
+               return 3;
+          case SDL_BLENDMODE_MUL:
+               return 4;
+          default:
+               return 5; // Custom modes
+          }
+     }
+
+     // Rebuild the texture table at `size` slots from the ranked textures
+     void resizeTextureTable(RenderQueue &queue, size_t size)
+     {
+          queue.textureSlots.assign(size, nullptr);
+          queue.textureRanks.resize(size);
+          for (size_t rank = 0; rank < queue.rankedTextures.size(); rank++)
+          {
+               size_t slot = ((uintptr_t)queue.rankedTextures[rank] >> 4) * 0x9E3779B97F4A7C15ull & (size - 1);
+               while (queue.textureSlots[slot] != nullptr)
+               {
+                    slot = (slot + 1) & (size - 1);
+               }
+               queue.textureSlots[slot] = queue.rankedTextures[rank];
+               queue.textureRanks[slot] = (Uint32)rank + 1;
+          }
+     }
+
+     // 0 for untextured items, so they sort first; then 1, 2, ... by first use
+     Uint32 textureRank(RenderQueue &queue, SDL_Texture *texture)
+     {
+          if (texture == nullptr)
+          {
+               return 0;
+          }
+          const size_t mask = queue.textureSlots.size() - 1;
+          size_t slot = ((uintptr_t)texture >> 4) * 0x9E3779B97F4A7C15ull & mask;
+          while (queue.textureSlots[slot] != nullptr)
+          {
+               if (queue.textureSlots[slot] == texture)
+               {
+                    return queue.textureRanks[slot];
+               }
+               slot = (slot + 1) & mask;
+          }
+          queue.rankedTextures.push_back(texture);
+          queue.rankedBlends.push_back(blendBits(texture));
+          if (queue.rankedTextures.size() * 2 > queue.textureSlots.size())
+          {
+               resizeTextureTable(queue, queue.textureSlots.size() * 2);
+          }
+          else
+          {
+               queue.textureSlots[slot] = texture;
+               queue.textureRanks[slot] = (Uint32)queue.rankedTextures.size();
+          }
+          return (Uint32)queue.rankedTextures.size();
+     }
+
+     // Key bits, high to low: layer and depth (24), blend mode (3), then 37
+     // for the batch: a solid fill's color, or 1 << 32 plus the texture's
+     // rank. Fills of one layer come first grouped by color, textures by
+     // blend mode then first use; textured items need no color grouping,
+     // their color is per vertex
+     Uint64 itemKey(RenderQueue &queue, const RenderItem &item)
+     {
+          if (item.texture == nullptr)
+          {
+               return ((Uint64)item.layer << 40) | packColor(item.color);
+          }
+          const Uint32 rank = textureRank(queue, item.texture);
+          return ((Uint64)item.layer << 40) | ((Uint64)queue.rankedBlends[rank - 1] << 37) | (1ull << 32) | rank;
+     }
+
+     // Order the items by key; equal keys stay in submission order
+     void sortItems(RenderQueue &queue)
+     {
+          const size_t count = queue.items.size();
+          queue.rankedTextures.clear();
+          queue.rankedBlends.clear();
+          resizeTextureTable(queue, SDL_max(queue.textureSlots.size(), (size_t)256));
+
+          // Scratch from the frame arena when there is one, the queue's
+          // vectors when there isn't or it is out of room
+          Uint64 *keys = nullptr, *keyScratch = nullptr;
+          Uint32 *indices = nullptr, *indexScratch = nullptr;
+          RenderItem *sorted = nullptr;
+          if (queue.arena != nullptr)
+          {
+               keys = frameArenaAllocArray<Uint64>(*queue.arena, count);
+               keyScratch = frameArenaAllocArray<Uint64>(*queue.arena, count);
+               indices = frameArenaAllocArray<Uint32>(*queue.arena, count);
+               indexScratch = frameArenaAllocArray<Uint32>(*queue.arena, count);
+               sorted = frameArenaAllocArray<RenderItem>(*queue.arena, count);
+          }
+          const bool fromArena = keys != nullptr && keyScratch != nullptr && indices != nullptr &&
+                                 indexScratch != nullptr && sorted != nullptr;
+          if (!fromArena)
+          {
+               queue.sortKeys.resize(count);
+               queue.sortKeyScratch.resize(count);
+               queue.sortIndices.resize(count);
+               queue.sortIndexScratch.resize(count);
+               queue.sortedItems.resize(count);
+               keys = queue.sortKeys.data();
+               keyScratch = queue.sortKeyScratch.data();
+               indices = queue.sortIndices.data();
+               indexScratch = queue.sortIndexScratch.data();
+               sorted = queue.sortedItems.data();
+          }
+
+          for (size_t i = 0; i < count; i++)
+          {
+               keys[i] = itemKey(queue, queue.items[i]);
+               indices[i] = (Uint32)i;
+          }
+          if (count >= RADIX_SORT_ITEMS)
+          {
+               radixSortPairsU64(keys, indices, count, keyScratch, indexScratch);
+          }
+          else
+          {
+               std::sort(indices, indices + count, [keys](Uint32 a, Uint32 b)
+                         { return keys[a] != keys[b] ? keys[a] < keys[b] : a < b; });
+          }
+          for (size_t i = 0; i < count; i++)
+          {
+               sorted[i] = queue.items[indices[i]];
+          }
+          if (fromArena)
+          {
+               std::copy(sorted, sorted + count, queue.items.begin());
+          }
+          else
+          {
+               queue.items.swap(queue.sortedItems);
+          }
+     }
+
+     // Cut `item` to the clip in effect, texture coordinates in proportion;
+     // false when nothing of it is left
+     bool clipItem(const RenderQueue &queue, RenderItem &item)
+     {
+          item.cut = {0.0f, 0.0f, -1.0f, -1.0f};
+          if (queue.clips.empty())
+          {
+               return true;
+          }
+          const SDL_FRect &clip = queue.clips.back();
+          if (isRotated(item))
+          {
+               // Cut when flushed, and only if it crosses an edge of the clip
+               const SDL_FRect bounds = itemBounds(item);
+               if (SDL_HasIntersectionF(&bounds, &clip) != SDL_TRUE)
+               {
+                    return false;
+               }
+               if (bounds.x < clip.x || bounds.y < clip.y || bounds.x + bounds.w > clip.x + clip.w ||
+                   bounds.y + bounds.h > clip.y + clip.h)
+               {
+                    item.cut = clip;
+               }
+               return true;
+          }
+          const SDL_FRect &d = item.dst;
+          const float x0 = SDL_max(d.x, clip.x), x1 = SDL_min(d.x + d.w, clip.x + clip.w);
+          const float y0 = SDL_max(d.y, clip.y), y1 = SDL_min(d.y + d.h, clip.y + clip.h);
+          if (x1 <= x0 || y1 <= y0)
+          {
+               return false;
+          }
+          if (item.texture != nullptr && (x0 != d.x || x1 != d.x + d.w || y0 != d.y || y1 != d.y + d.h))
+          {
+               const float du = (item.uvMax.x - item.uvMin.x) / d.w, dv = (item.uvMax.y - item.uvMin.y) / d.h;
+               const SDL_FPoint origin = item.uvMin;
+               item.uvMin = {origin.x + (x0 - d.x) * du, origin.y + (y0 - d.y) * dv};
+               item.uvMax = {origin.x + (x1 - d.x) * du, origin.y + (y1 - d.y) * dv};
+          }
+          item.dst = {x0, y0, x1 - x0, y1 - y0};
+          return true;
+     }
+
+     // Where one flush builds its vertex, index and rect arrays: the
+     // queue's frame arena when it has one, else its own vectors
+     struct FlushScratch
+     {
+          SDL_Vertex *vertices;
+          int *indices;
+          SDL_FRect *rects;
+          int vertexCount;
+          int indexCount;
+          int rectCount;
+     };
+
+     // A quad takes 4 vertices and 6 indices; a cut one up to 8 and 18
+     FlushScratch scratchFor(RenderQueue &queue, size_t count, size_t cutCount)
+     {
+          const size_t vertexCount = count * 4 + cutCount * 4, indexCount = count * 6 + cutCount * 12;
+          FlushScratch scratch = {nullptr, nullptr, nullptr, 0, 0, 0};
+          if (queue.arena != nullptr)
+          {
+               scratch.vertices = frameArenaAllocArray<SDL_Vertex>(*queue.arena, vertexCount);
+               scratch.indices = frameArenaAllocArray<int>(*queue.arena, indexCount);
+               scratch.rects = frameArenaAllocArray<SDL_FRect>(*queue.arena, count);
+          }
+          if (scratch.vertices == nullptr || scratch.indices == nullptr || scratch.rects == nullptr)
+          {
+               queue.vertices.resize(vertexCount);
+               queue.indices.resize(indexCount);
+               queue.rects.resize(count);
+               scratch.vertices = queue.vertices.data();
+               scratch.indices = queue.indices.data();
+               scratch.rects = queue.rects.data();
+          }
+          return scratch;
+     }
+
+     // Keep the part of `polygon` on the inside of one clip edge: where
+     // side(v) >= 0. Crossing points take position and texture coordinates
+     // in proportion
+     template <typename Side>
+     int clipPolygon(const SDL_Vertex *polygon, int count, SDL_Vertex *out, Side side)
+     {
+          int kept = 0;
+          for (int i = 0; i < count; i++)
+          {
+               const SDL_Vertex &a = polygon[i], &b = polygon[(i + 1) % count];
+               const float da = side(a.position), db = side(b.position);
+               if (da >= 0.0f)
+               {
+                    out[kept++] = a;
+               }
+               if ((da >= 0.0f) != (db >= 0.0f))
+               {
+                    const float t = da / (da - db);
+                    SDL_Vertex &v = out[kept++];
+                    v.position = {a.position.x + (b.position.x - a.position.x) * t,
+                                  a.position.y + (b.position.y - a.position.y) * t};
+                    v.tex_coord = {a.tex_coord.x + (b.tex_coord.x - a.tex_coord.x) * t,
+                                   a.tex_coord.y + (b.tex_coord.y - a.tex_coord.y) * t};
+                    v.color = a.color;
+               }
+          }
+          return kept;
+     }
+
+     // A rotated quad cut to `item.cut` by its four edges in turn, drawn
+     // as a fan: at most eight corners, six triangles
+     void pushCutQuad(FlushScratch &scratch, const RenderItem &item, const SDL_Vertex quad[4])
+     {
+          const SDL_FRect &c = item.cut;
+          SDL_Vertex polygon[8], clipped[8];
+          // Around the edge, not in quad order
+          polygon[0] = quad[0];
+          polygon[1] = quad[1];
+          polygon[2] = quad[3];
+          polygon[3] = quad[2];
+          int count = clipPolygon(polygon, 4, clipped, [&](SDL_FPoint p) { return p.x - c.x; });
+          count = clipPolygon(clipped, count, polygon, [&](SDL_FPoint p) { return c.x + c.w - p.x; });
+          count = clipPolygon(polygon, count, clipped, [&](SDL_FPoint p) { return p.y - c.y; });
+          count = clipPolygon(clipped, count, polygon, [&](SDL_FPoint p) { return c.y + c.h - p.y; });
+          if (count < 3)
+          {
+               return;
+          }
+          const int base = scratch.vertexCount;
+          std::copy(polygon, polygon + count, scratch.vertices + base);
+          scratch.vertexCount += count;
+          for (int i = 1; i + 1 < count; i++)
+          {
+               scratch.indices[scratch.indexCount++] = base;
+               scratch.indices[scratch.indexCount++] = base + i;
+               scratch.indices[scratch.indexCount++] = base + i + 1;
+          }
+     }
+
+     void pushQuad(FlushScratch &scratch, const RenderItem &item)
+     {
+          const int base = scratch.vertexCount;
+          SDL_Vertex *v = scratch.vertices + base;
+
+          SDL_FPoint corners[4];
+          itemCorners(item, corners);
+          v[0].position = corners[0];
+          v[0].tex_coord = {item.uvMin.x, item.uvMin.y};
+          v[1].position = corners[1];
+          v[1].tex_coord = {item.uvMax.x, item.uvMin.y};
+          v[2].position = corners[2];
+          v[2].tex_coord = {item.uvMin.x, item.uvMax.y};
+          v[3].position = corners[3];
+          v[3].tex_coord = {item.uvMax.x, item.uvMax.y};
+          for (int i = 0; i < 4; i++)
+          {
+               v[i].color = item.color;
+          }
+          if (item.cut.w >= 0.0f)
+          {
+               const SDL_Vertex quad[4] = {v[0], v[1], v[2], v[3]};
+               pushCutQuad(scratch, item, quad);
+               return;
+          }
+          scratch.vertexCount += 4;
+
+          const int quad[6] = {0, 1, 2, 2, 1, 3};
+          for (int i = 0; i < 6; i++)
+          {
+               scratch.indices[scratch.indexCount++] = base + quad[i];
+          }
+     }
+
+     // Each submission takes the next part of the scratch arrays, so what
+     // one call handed to the renderer is never overwritten by the next
+     void submitGeometry(RenderQueue &queue, FlushScratch &scratch, SDL_Renderer *renderer, SDL_Texture *texture)
+     {
+          if (scratch.indexCount == 0)
+          {
+               return;
+          }
+          renderRecordGeometry(renderer, texture,
+                             scratch.vertices, scratch.vertexCount,
+                             scratch.indices, scratch.indexCount);
+          queue.drawCalls++;
+          scratch.vertices += scratch.vertexCount;
+          scratch.indices += scratch.indexCount;
+          scratch.vertexCount = 0;
+          scratch.indexCount = 0;
+     }
+
+     void submitFillRects(RenderQueue &queue, FlushScratch &scratch, SDL_Renderer *renderer, SDL_Color color)
+     {
+          if (scratch.rectCount == 0)
+          {
+               return;
+          }
+          renderRecordSetDrawColor(renderer, color.r, color.g, color.b, color.a);
+          renderRecordFillRectsF(renderer, scratch.rects, scratch.rectCount);
+          queue.drawCalls++;
+          scratch.rects += scratch.rectCount;
+          scratch.rectCount = 0;
+     }
+
+     // SDL_DestroyTexture() flushes SDL's own command batch first when it
+     // still holds the texture, so this is safe right after submitting
+     void releaseRetired(RenderQueue &queue)
+     {
+          for (SDL_Texture *texture : queue.retired)
+          {
+               renderRecordDestroyTexture(texture);
+          }
+          queue.retired.clear();
+     }
+}
+
+void renderQueueInit(RenderQueue &queue, RenderBatchMode mode, int expectedItems)
+{
+     buildRotationTable();
+     queue.mode = mode;
+     queue.arena = nullptr;
+     queue.layer = 0;
+     queue.items.clear();
+     queue.items.reserve(expectedItems);
+     queue.vertices.reserve(expectedItems * 4);
+     queue.indices.reserve(expectedItems * 6);
+     queue.rects.reserve(expectedItems);
+     queue.clips.clear();
+     queue.retired.clear();
+     queue.drawCalls = 0;
+}
+
+void renderQueueFillRect(RenderQueue &queue, const SDL_FRect &dst, SDL_Color color)
+{
+     RenderItem item;
+     item.texture = nullptr;
+     item.dst = dst;
+     item.uvMin = {0.0f, 0.0f};
+     item.uvMax = {0.0f, 0.0f};
+     item.color = color;
+     item.layer = queue.layer;
+     item.cosAngle = 1.0f;
+     item.sinAngle = 0.0f;
+     item.pivot = {0.0f, 0.0f};
+     if (clipItem(queue, item))
+     {
+          queue.items.push_back(item);
+     }
+}
+
+void renderQueueCopy(RenderQueue &queue, SDL_Texture *texture, const SDL_Rect *src, const SDL_FRect &dst)
+{
+     SDL_Color white = {255, 255, 255, 255};
+     renderQueueCopyTinted(queue, texture, src, dst, white);
+}
+
+void renderQueueCopyTinted(RenderQueue &queue, SDL_Texture *texture, const SDL_Rect *src, const SDL_FRect &dst, SDL_Color tint)
+{
+     if (texture == nullptr)
+     {
+          return;
+     }
+
+     RenderItem item;
+     item.texture = texture;
+     item.dst = dst;
+     item.color = tint;
+     item.layer = queue.layer;
+     item.cosAngle = 1.0f;
+     item.sinAngle = 0.0f;
+     item.pivot = {0.0f, 0.0f};
+     if (textureCoords(texture, src, item.uvMin, item.uvMax) && clipItem(queue, item))
+     {
+          queue.items.push_back(item);
+     }
+}
+
+void renderQueueCopyEx(RenderQueue &queue, SDL_Texture *texture, const SDL_Rect *src, const SDL_FRect &dst, double angle,
+                       const SDL_FPoint *center, SDL_RendererFlip flip, SDL_Color tint)
+{
+     if (texture == nullptr)
+     {
+          return;
+     }
+
+     RenderItem item;
+     item.texture = texture;
+     item.dst = dst;
+     item.color = tint;
+     item.layer = queue.layer;
+     if (!textureCoords(texture, src, item.uvMin, item.uvMax))
+     {
+          return;
+     }
+     if (flip & SDL_FLIP_HORIZONTAL)
+     {
+          std::swap(item.uvMin.x, item.uvMax.x);
+     }
+     if (flip & SDL_FLIP_VERTICAL)
+     {
+          std::swap(item.uvMin.y, item.uvMax.y);
+     }
+
+     // Nearest table step; the mask wraps negative and multi-turn angles
+     const Sint64 step = (Sint64)SDL_floor(angle * (ROTATION_STEPS / 360.0) + 0.5);
+     const int index = (int)(step & (ROTATION_STEPS - 1));
+     item.sinAngle = rotationSine[index];
+     item.cosAngle = rotationSine[(index + ROTATION_STEPS / 4) & (ROTATION_STEPS - 1)];
+     item.pivot = center != nullptr ? SDL_FPoint{dst.x + center->x, dst.y + center->y}
+                                    : SDL_FPoint{dst.x + dst.w * 0.5f, dst.y + dst.h * 0.5f};
+     if (clipItem(queue, item))
+     {
+          queue.items.push_back(item);
+     }
+}
+
+void renderQueueSetLayer(RenderQueue &queue, Uint8 layer, Uint16 depth)
+{
+     queue.layer = ((Uint32)layer << 16) | depth;
+}
+
+void renderQueuePushClip(RenderQueue &queue, const SDL_FRect &clip)
+{
+     SDL_FRect inner = clip;
+     if (!queue.clips.empty() && !SDL_IntersectFRect(&queue.clips.back(), &clip, &inner))
+     {
+          inner = {clip.x, clip.y, 0.0f, 0.0f}; // Nothing shows through
+     }
+     queue.clips.push_back(inner);
+}
+
+void renderQueuePopClip(RenderQueue &queue)
+{
+     if (!queue.clips.empty())
+     {
+          queue.clips.pop_back();
+     }
+}
+
+void renderQueueFlush(RenderQueue &queue, SDL_Renderer *renderer)
+{
+     queue.drawCalls = 0;
+
+     // Partial redraws clip to the dirty area; skip what cannot touch it.
+     // Bounds are rounded out to whole pixels and tested in one batch, so
+     // an item is only dropped when no pixel of it could be drawn.
+     if (SDL_RenderIsClipEnabled(renderer) && !queue.items.empty())
+     {
+          SDL_Rect clip;
+          SDL_RenderGetClipRect(renderer, &clip);
+          const int n = (int)queue.items.size();
+          queue.cullRects.resize(n);
+          queue.cullMask.resize(((size_t)n + 31) / 32);
+          for (int i = 0; i < n; i++)
+          {
+               // Clamped so far off-screen items still convert to int
+               const SDL_FRect bounds = itemBounds(queue.items[i]);
+               const float x0 = SDL_clamp(SDL_floorf(bounds.x), -CULL_LIMIT, CULL_LIMIT);
+               const float y0 = SDL_clamp(SDL_floorf(bounds.y), -CULL_LIMIT, CULL_LIMIT);
+               const float x1 = SDL_clamp(SDL_ceilf(bounds.x + bounds.w), -CULL_LIMIT, CULL_LIMIT);
+               const float y1 = SDL_clamp(SDL_ceilf(bounds.y + bounds.h), -CULL_LIMIT, CULL_LIMIT);
+               queue.cullRects[i] = {(int)x0, (int)y0, (int)(x1 - x0), (int)(y1 - y0)};
+          }
+          rectBatchIntersects(clip, queue.cullRects.data(), n, queue.cullMask.data());
+          int kept = 0;
+          for (int i = 0; i < n; i++)
+          {
+               if (queue.cullMask[i / 32] & (1u << (i % 32)))
+               {
+                    queue.items[kept++] = queue.items[i];
+               }
+          }
+          queue.items.resize(kept);
+     }
+
+     sortItems(queue);
+
+     size_t i = 0;
+     const size_t count = queue.items.size();
+     size_t cutCount = 0;
+     for (const RenderItem &item : queue.items)
+     {
+          cutCount += item.cut.w >= 0.0f ? 1 : 0;
+     }
+     FlushScratch scratch = scratchFor(queue, count, cutCount);
+
+     // One call per run of a texture, or of solid fills (one per color for
+     // RENDER_BATCH_FILL_RECTS); layers keep their runs apart
+     while (i < count)
+     {
+          SDL_Texture *texture = queue.items[i].texture;
+          if (texture == nullptr && queue.mode == RENDER_BATCH_FILL_RECTS)
+          {
+               const SDL_Color color = queue.items[i].color;
+               while (i < count && queue.items[i].texture == nullptr && sameColor(queue.items[i].color, color))
+               {
+                    scratch.rects[scratch.rectCount++] = queue.items[i].dst;
+                    i++;
+               }
+               submitFillRects(queue, scratch, renderer, color);
+               continue;
+          }
+          while (i < count && queue.items[i].texture == texture)
+          {
+               pushQuad(scratch, queue.items[i]);
+               i++;
+          }
+          submitGeometry(queue, scratch, renderer, texture);
+     }
+
+     queue.items.clear();
+     releaseRetired(queue);
+}
+
+void renderQueueClear(RenderQueue &queue)
+{
+     queue.items.clear();
+     releaseRetired(queue);
+}
+
+void renderQueueDestroyTexture(RenderQueue &queue, SDL_Texture *texture)
+{
+     if (texture == nullptr)
+     {
+          return;
+     }
+     if (queue.items.empty())
+     {
+          renderRecordDestroyTexture(texture);
+          return;
+     }
+     queue.retired.push_back(texture);
+}
+
+void renderQueueMerge(RenderQueue &queue, RenderQueue *parts, int count)
+{
+     size_t total = queue.items.size();
+     for (int i = 0; i < count; i++)
+     {
+          total += parts[i].items.size();
+     }
+     queue.items.reserve(total);
+
+     for (int i = 0; i < count; i++)
+     {
+          queue.items.insert(queue.items.end(), parts[i].items.begin(), parts[i].items.end());
+          parts[i].items.clear();
+          queue.retired.insert(queue.retired.end(), parts[i].retired.begin(), parts[i].retired.end());
+          parts[i].retired.clear();
+     }
+}
+
+void renderQueueRecordParallel(RenderQueue &queue, JobSystem *jobs, std::vector<RenderQueue> &parts,
+                               int elementCount, RenderRecordFunction record, void *data)
+{
+     int threads = jobs != nullptr ? jobSystemThreadCount(*jobs) : 1;
+     if (threads < 2 || elementCount < 2 * MIN_CHUNK_ELEMENTS)
+     {
+          record(data, queue, 0, elementCount);
+          return;
+     }
+
+     // A few chunks per thread so stealing can even out uneven chunks
+     int chunkCount = SDL_min(threads * 4, elementCount / MIN_CHUNK_ELEMENTS);
+     int chunkSize = (elementCount + chunkCount - 1) / chunkCount;
+     chunkCount = (elementCount + chunkSize - 1) / chunkSize;
+     if ((int)parts.size() < chunkCount)
+     {
+          parts.resize(chunkCount);
+          for (RenderQueue &part : parts)
+          {
+               part.mode = queue.mode;
+          }
+     }
+     // Each chunk starts on the caller's layer, under the clip it has pushed
+     for (int i = 0; i < chunkCount; i++)
+     {
+          parts[i].clips = queue.clips;
+          parts[i].layer = queue.layer;
+     }
+
+     RecordJob job = {record, data, parts.data(), elementCount, chunkSize};
+     JobCounter counter = {};
+     jobSystemSubmitRange(*jobs, recordChunk, &job, chunkCount, &counter);
+     jobSystemWait(*jobs, counter);
+     renderQueueMerge(queue, parts.data(), chunkCount);
+}
@@ -0,0 +1,175 @@
+// Description:
+// Per-frame render queue. Drawing code pushes filled and textured rects in
+// any order; renderQueueFlush() sorts them by texture and color and submits
+// each run with a single call, so the number of draw calls depends on how
+// many distinct textures/colors are used, not on how many objects exist.
+//
+// Painter's order is kept between layers: renderQueueSetLayer() picks the
+// layer (and depth within it) for everything queued after it, and a flush
+// draws lower layers and depths first. Only items at the same layer and
+// depth are regrouped for batching, so a HUD can't sink under the world
+// however its textures sort; a queue that never sets a layer batches as
+// one. Each item is sorted on a packed 64-bit key (layer, depth, blend
+// mode, texture rank by first use, and color for solid fills); large
+// queues radix-sort the keys, and bytes of the key no item uses, such as
+// the layer bytes of an unlayered queue, cost no pass.
+//
+// Two submission modes are supported:
+// - RENDER_BATCH_GEOMETRY: one SDL_RenderGeometry call per texture, with
+//   per-vertex colors (all untextured rects share one call)
+// - RENDER_BATCH_FILL_RECTS: one SDL_RenderFillRectsF call per color for
+//   untextured rects, textured rects still go through SDL_RenderGeometry
+//
+// Rotated and flipped copies (renderQueueCopyEx) are expanded into the same
+// vertex arrays, so thousands of spinning sprites share their texture's one
+// call instead of making one SDL_RenderCopyEx draw each. A flip swaps the
+// texture coordinates; the rotation turns the four corners about the pivot
+// with sin and cos from a table of ROTATION_STEPS steps per turn, exact at
+// multiples of 90 degrees and within a twentieth of a degree elsewhere.
+//
+// Clipping is part of queuing rather than renderer state: between
+// renderQueuePushClip() and renderQueuePopClip(), rects are cut to the clip
+// as they are queued, texture coordinates with them. Axis-aligned quads are
+// cut when queued; a rotated copy that straddles the clip keeps it and is
+// cut at flush, its turned quad becoming a polygon of up to eight corners
+// (one fan in the same vertex arrays), so it still batches. Scroll
+// views and panels with their own clips still sort and merge into the same
+// few calls, where an SDL_RenderSetClipRect per panel would split the batch
+// at every change. (SDL 2 has no per-draw scissor for the batch to carry.)
+//
+// Queuing never calls the renderer, so a queue can be filled on any thread.
+// renderQueueRecordParallel() uses that to split scene traversal across the
+// job system: each job fills its own part queue, and the parts are merged
+// in chunk order on the calling thread, so the result (and the draw order
+// of equal items) is the same as a serial loop no matter which job ran
+// first. Only the renderer's thread may flush.
+//
+// A cache that drops a texture while queued items may still draw it hands
+// it to renderQueueDestroyTexture(), which keeps it until the queue has
+// drawn or dropped those items.
+// =============================================================================
+
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "frame_arena.h"
+#include "job_system.h"
+
+enum RenderBatchMode
+{
+     RENDER_BATCH_GEOMETRY,
+     RENDER_BATCH_FILL_RECTS
+};
+
+const int ROTATION_STEPS = 4096; // Angles renderQueueCopyEx() tells apart per turn
+
+// A single queued quad
+struct RenderItem
+{
+     SDL_Texture *texture;     // nullptr for a solid fill
+     SDL_FRect dst;            // Destination in render coordinates, before rotation
+     SDL_FPoint uvMin;         // Normalized texture coordinates; min > max when flipped
+     SDL_FPoint uvMax;
+     SDL_Color color;          // Fill color, or texture tint
+     Uint32 layer;             // Layer << 16 | depth, drawn in ascending order
+     float cosAngle, sinAngle; // Clockwise rotation about `pivot`; 1 and 0 for none
+     SDL_FPoint pivot;         // In render coordinates
+     SDL_FRect cut;            // Clip a rotated copy is cut to at flush; w < 0 for none
+};
+
+struct RenderQueue
+{
+     RenderBatchMode mode;
+     std::vector<RenderItem> items;
+
+     // Flush scratch comes from the frame arena when set, so the arrays
+     // last until the renderer has consumed them; the vectors are the
+     // fallback and are reused every frame
+     FrameArena *arena;
+     std::vector<SDL_Vertex> vertices;
+     std::vector<int> indices;
+     std::vector<SDL_FRect> rects;
+
+     // Radix sort scratch for large flushes, reused every frame
+     std::vector<Uint64> sortKeys, sortKeyScratch;
+     std::vector<Uint32> sortIndices, sortIndexScratch;
+     std::vector<RenderItem> sortedItems;
+     std::vector<SDL_Texture *> textureSlots; // Open-addressed texture -> rank table
+     std::vector<Uint32> textureRanks;
+     std::vector<SDL_Texture *> rankedTextures; // Distinct textures in first-use order
+     std::vector<Uint8> rankedBlends;           // Their blend modes, as sort key bits
+
+     Uint32 layer; // Given to items as they are queued, see renderQueueSetLayer()
+
+     std::vector<SDL_FRect> clips; // Clip stack; the back is in effect, already intersected
+
+     // Culling against the renderer's clip, reused every frame
+     std::vector<SDL_Rect> cullRects;
+     std::vector<Uint32> cullMask;
+
+     std::vector<SDL_Texture *> retired; // Destroyed after the next flush or clear
+
+     int drawCalls; // Number of SDL_Render* submissions made by the last flush
+};
+
+// Reserve room for `expectedItems` quads so steady-state frames don't
+// allocate. Leaves `arena` unset. With `arena` set, flushes also take
+// their sort scratch from it.
+void renderQueueInit(RenderQueue &queue, RenderBatchMode mode, int expectedItems);
+
+// Queue a solid rectangle
+void renderQueueFillRect(RenderQueue &queue, const SDL_FRect &dst, SDL_Color color);
+
+// Queue a textured rectangle; `src` is in texels, nullptr for the whole texture
+void renderQueueCopy(RenderQueue &queue, SDL_Texture *texture, const SDL_Rect *src, const SDL_FRect &dst);
+
+// Same as renderQueueCopy() with a color modulation applied per vertex
+void renderQueueCopyTinted(RenderQueue &queue, SDL_Texture *texture, const SDL_Rect *src, const SDL_FRect &dst, SDL_Color tint);
+
+// SDL_RenderCopyExF into the batch: `angle` in degrees clockwise about
+// `center` (relative to dst, nullptr for its middle), flipped before it is
+// turned
+void renderQueueCopyEx(RenderQueue &queue, SDL_Texture *texture, const SDL_Rect *src, const SDL_FRect &dst, double angle,
+                       const SDL_FPoint *center, SDL_RendererFlip flip, SDL_Color tint = {255, 255, 255, 255});
+
+// Queue what follows on `layer` at `depth` within it; both draw lowest
+// first. Stays in effect across flushes until set again
+void renderQueueSetLayer(RenderQueue &queue, Uint8 layer, Uint16 depth = 0);
+
+// Clip what is queued from now on to `clip`, within any clip already
+// pushed; pushes nest and each needs a renderQueuePopClip()
+void renderQueuePushClip(RenderQueue &queue, const SDL_FRect &clip);
+void renderQueuePopClip(RenderQueue &queue);
+
+// Sort, submit and empty the queue. With a clip rect set, items outside it
+// are dropped before sorting.
+void renderQueueFlush(RenderQueue &queue, SDL_Renderer *renderer);
+
+// Empty the queue without drawing, for frames that are not presented
+void renderQueueClear(RenderQueue &queue);
+
+// Destroy `texture` once nothing queued can draw it: at once when the
+// queue is empty, otherwise after the next renderQueueFlush() or
+// renderQueueClear()
+void renderQueueDestroyTexture(RenderQueue &queue, SDL_Texture *texture);
+
+// Append the items of parts[0..count) in that order and empty the parts;
+// they keep the layers they were queued on, and the queue takes over
+// their retired textures
+void renderQueueMerge(RenderQueue &queue, RenderQueue *parts, int count);
+
+// Queues the items for scene elements [begin, end) into `part`
+typedef void (*RenderRecordFunction)(void *data, RenderQueue &part, int begin, int end);
+
+// Run `record` over [0, elementCount) in chunks on the job system and merge
+// the chunks into `queue` in order. `parts` holds one queue per chunk and is
+// kept by the caller so its storage is reused every frame. Chunks start on
+// the queue's layer and clip. Small counts, or a null `jobs`, record
+// straight into `queue` on the calling thread.
+void renderQueueRecordParallel(RenderQueue &queue, JobSystem *jobs, std::vector<RenderQueue> &parts,
+                               int elementCount, RenderRecordFunction record, void *data);
+
+#endif // RENDER_QUEUE_H
@@ -0,0 +1,595 @@
+#include "render_record.h"
+
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+     struct Recorder
+     {
+          SDL_RWops *out = nullptr;
+          std::vector<Uint8> buffer; // Commands since the last present
+          std::unordered_map<SDL_Texture *, Uint32> ids;
+          Uint32 nextId = 1;
+          Uint64 lastPresent = 0;
+
+          // One texture is locked at a time, as with SDL's own renderers
+          SDL_Texture *locked = nullptr;
+          void *lockedPixels = nullptr;
+          int lockedPitch = 0;
+          SDL_Rect lockedRect = {0, 0, 0, 0};
+
+          std::vector<SDL_Vertex> vertices; // Scratch for renderRecordGeometryRaw()
+          std::vector<Uint16> shortIndices;
+     };
+     Recorder recorder;
+
+     // Last state set through the wrappers, so unchanged sets can be dropped
+     // before they reach SDL (and the recording)
+     struct StateCache
+     {
+          SDL_Renderer *renderer = nullptr; // State below belongs to this one
+          Uint8 color[4] = {0, 0, 0, 0};
+          SDL_BlendMode drawBlend = SDL_BLENDMODE_NONE;
+          SDL_Texture *target = nullptr;
+          bool clipKnown = false; // Targets keep their own clip rect
+          bool clipEnabled = false;
+          SDL_Rect clip = {0, 0, 0, 0};
+          SDL_Texture *drawTexture = nullptr; // Texture of the last textured draw
+     };
+     StateCache cache;
+
+     RenderStats frameStats = {};
+     RenderStats lastFrameStats = {};
+
+     void syncState(SDL_Renderer *renderer)
+     {
+          if (cache.renderer == renderer)
+          {
+               return;
+          }
+          cache.renderer = renderer;
+          SDL_GetRenderDrawColor(renderer, &cache.color[0], &cache.color[1], &cache.color[2], &cache.color[3]);
+          SDL_GetRenderDrawBlendMode(renderer, &cache.drawBlend);
+          cache.target = SDL_GetRenderTarget(renderer);
+          cache.clipKnown = false;
+     }
+
+     // Count a state call; true if it changes nothing and can be dropped
+     bool redundant(bool unchanged)
+     {
+          frameStats.stateCalls++;
+          if (unchanged)
+          {
+               frameStats.stateEliminated++;
+          }
+          return unchanged;
+     }
+
+     void countDraw(SDL_Texture *texture, int vertices)
+     {
+          frameStats.drawCalls++;
+          frameStats.vertices += vertices;
+          if (texture != nullptr && texture != cache.drawTexture)
+          {
+               frameStats.textureBinds++;
+               cache.drawTexture = texture;
+          }
+     }
+
+     void countUpload(SDL_Texture *texture, const SDL_Rect *rect)
+     {
+          Uint32 format = 0;
+          int w = 0, h = 0;
+          SDL_QueryTexture(texture, &format, NULL, &w, &h);
+          if (rect != nullptr)
+          {
+               w = rect->w;
+               h = rect->h;
+          }
+          frameStats.uploads++;
+          // Planar YUV is about 1.5 bytes per pixel; count the luma plane
+          frameStats.uploadBytes += (Sint64)w * h * SDL_max(SDL_BYTESPERPIXEL(format), 1);
+     }
+
+     void append(const void *data, size_t size)
+     {
+          const Uint8 *bytes = (const Uint8 *)data;
+          recorder.buffer.insert(recorder.buffer.end(), bytes, bytes + size);
+     }
+
+     void appendU32(Uint32 value)
+     {
+          append(&value, sizeof(value));
+     }
+
+     void beginCommand(RenderCommand command, size_t payloadSize)
+     {
+          Uint8 type = (Uint8)command;
+          append(&type, 1);
+          appendU32((Uint32)payloadSize);
+     }
+
+     void flush()
+     {
+          if (!recorder.buffer.empty() &&
+              SDL_RWwrite(recorder.out, recorder.buffer.data(), 1, recorder.buffer.size()) != recorder.buffer.size())
+          {
+               std::cerr << "Unable to write render recording! SDL Error: " << SDL_GetError() << std::endl;
+          }
+          recorder.buffer.clear();
+     }
+
+     // Describe the texture the first time it shows up in the stream
+     Uint32 textureId(SDL_Texture *texture)
+     {
+          if (texture == nullptr)
+          {
+               return 0;
+          }
+          auto found = recorder.ids.find(texture);
+          if (found != recorder.ids.end())
+          {
+               return found->second;
+          }
+
+          Uint32 format = 0;
+          int access = 0, w = 0, h = 0;
+          SDL_QueryTexture(texture, &format, &access, &w, &h);
+          Uint32 id = recorder.nextId++;
+          recorder.ids[texture] = id;
+
+          beginCommand(RENDER_CMD_TEXTURE, 5 * sizeof(Uint32));
+          appendU32(id);
+          appendU32(format);
+          appendU32((Uint32)access);
+          appendU32((Uint32)w);
+          appendU32((Uint32)h);
+          return id;
+     }
+
+     RenderTextureState textureState(SDL_Texture *texture)
+     {
+          RenderTextureState state = {textureId(texture), SDL_BLENDMODE_NONE, 255, 255, 255, 255};
+          if (texture != nullptr)
+          {
+               SDL_BlendMode blendMode = SDL_BLENDMODE_NONE;
+               SDL_GetTextureBlendMode(texture, &blendMode);
+               state.blendMode = (Uint32)blendMode;
+               SDL_GetTextureColorMod(texture, &state.r, &state.g, &state.b);
+               SDL_GetTextureAlphaMod(texture, &state.a);
+          }
+          return state;
+     }
+
+     // Rows are stored tightly packed in the texture's own format
+     void recordPixels(SDL_Texture *texture, const SDL_Rect *rect, const void *pixels, int pitch)
+     {
+          Uint32 format = 0;
+          int w = 0, h = 0;
+          SDL_QueryTexture(texture, &format, NULL, &w, &h);
+          if (SDL_ISPIXELFORMAT_FOURCC(format))
+          {
+               return;
+          }
+          SDL_Rect area = rect != nullptr ? *rect : SDL_Rect{0, 0, w, h};
+          const int rowBytes = area.w * SDL_BYTESPERPIXEL(format);
+
+          Uint32 id = textureId(texture);
+          beginCommand(RENDER_CMD_TEXTURE_PIXELS, sizeof(Uint32) + sizeof(SDL_Rect) + sizeof(Sint32) +
+                                                      (size_t)rowBytes * area.h);
+          appendU32(id);
+          append(&area, sizeof(area));
+          appendU32((Uint32)rowBytes);
+          for (int y = 0; y < area.h; y++)
+          {
+               append((const Uint8 *)pixels + (size_t)y * pitch, rowBytes);
+          }
+     }
+
+     void recordGeometry(SDL_Texture *texture, const SDL_Vertex *vertices, int numVertices, const void *indices,
+                         int numIndices, int indexSize)
+     {
+          RenderTextureState state = textureState(texture);
+          if (indices == nullptr)
+          {
+               numIndices = 0;
+               indexSize = 0;
+          }
+          beginCommand(RENDER_CMD_GEOMETRY, sizeof(state) + 3 * sizeof(Uint32) +
+                                                (size_t)numVertices * sizeof(SDL_Vertex) +
+                                                (size_t)numIndices * indexSize);
+          append(&state, sizeof(state));
+          appendU32((Uint32)numVertices);
+          appendU32((Uint32)numIndices);
+          appendU32((Uint32)indexSize);
+          append(vertices, (size_t)numVertices * sizeof(SDL_Vertex));
+          append(indices, (size_t)numIndices * indexSize);
+     }
+}
+
+bool renderRecordStart(SDL_Renderer *renderer, const char *path)
+{
+     renderRecordStop();
+     recorder.out = SDL_RWFromFile(path, "wb");
+     if (recorder.out == nullptr)
+     {
+          std::cerr << "Unable to open " << path << " for recording! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+
+     RenderStreamHeader header = {RENDER_STREAM_MAGIC, RENDER_STREAM_VERSION, 0, 0};
+     // Commands are in logical units when a logical size is set, or a
+     // scale and viewport (logical_view.h) do the same; the viewport then
+     // has the logical size
+     SDL_RenderGetLogicalSize(renderer, &header.width, &header.height);
+     if (header.width == 0 || header.height == 0)
+     {
+          SDL_Rect viewport;
+          SDL_RenderGetViewport(renderer, &viewport);
+          header.width = viewport.w;
+          header.height = viewport.h;
+     }
+     if (header.width == 0 || header.height == 0)
+     {
+          SDL_GetRendererOutputSize(renderer, &header.width, &header.height);
+     }
+     append(&header, sizeof(header));
+
+     // The replay starts from the same renderer state
+     Uint8 r = 0, g = 0, b = 0, a = 0;
+     SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+     beginCommand(RENDER_CMD_DRAW_COLOR, 4);
+     Uint8 color[4] = {r, g, b, a};
+     append(color, sizeof(color));
+
+     SDL_BlendMode blendMode = SDL_BLENDMODE_NONE;
+     SDL_GetRenderDrawBlendMode(renderer, &blendMode);
+     beginCommand(RENDER_CMD_DRAW_BLEND, sizeof(Uint32));
+     appendU32((Uint32)blendMode);
+
+     SDL_Rect clip = {0, 0, 0, 0};
+     SDL_RenderGetClipRect(renderer, &clip);
+     beginCommand(RENDER_CMD_CLIP, sizeof(Uint32) + sizeof(SDL_Rect));
+     appendU32(SDL_RenderIsClipEnabled(renderer) ? 1 : 0);
+     append(&clip, sizeof(clip));
+
+     SDL_Texture *target = SDL_GetRenderTarget(renderer);
+     Uint32 targetId = textureId(target);
+     beginCommand(RENDER_CMD_TARGET, sizeof(Uint32));
+     appendU32(targetId);
+
+     recorder.lastPresent = SDL_GetPerformanceCounter();
+     return true;
+}
+
+void renderRecordStop()
+{
+     if (recorder.out == nullptr)
+     {
+          return;
+     }
+     flush();
+     SDL_RWclose(recorder.out);
+     recorder.out = nullptr;
+     recorder.ids.clear();
+     recorder.nextId = 1;
+     recorder.locked = nullptr;
+}
+
+bool renderRecordActive()
+{
+     return recorder.out != nullptr;
+}
+
+int renderRecordSetTarget(SDL_Renderer *renderer, SDL_Texture *texture)
+{
+     syncState(renderer);
+     if (redundant(texture == cache.target))
+     {
+          return 0;
+     }
+     cache.target = texture;
+     cache.clipKnown = false;
+     if (recorder.out != nullptr)
+     {
+          Uint32 id = textureId(texture);
+          beginCommand(RENDER_CMD_TARGET, sizeof(Uint32));
+          appendU32(id);
+     }
+     return SDL_SetRenderTarget(renderer, texture);
+}
+
+int renderRecordSetDrawColor(SDL_Renderer *renderer, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+{
+     syncState(renderer);
+     if (redundant(cache.color[0] == r && cache.color[1] == g && cache.color[2] == b && cache.color[3] == a))
+     {
+          return 0;
+     }
+     cache.color[0] = r;
+     cache.color[1] = g;
+     cache.color[2] = b;
+     cache.color[3] = a;
+     if (recorder.out != nullptr)
+     {
+          const Uint8 color[4] = {r, g, b, a};
+          beginCommand(RENDER_CMD_DRAW_COLOR, sizeof(color));
+          append(color, sizeof(color));
+     }
+     return SDL_SetRenderDrawColor(renderer, r, g, b, a);
+}
+
+int renderRecordSetDrawBlendMode(SDL_Renderer *renderer, SDL_BlendMode blendMode)
+{
+     syncState(renderer);
+     if (redundant(blendMode == cache.drawBlend))
+     {
+          return 0;
+     }
+     cache.drawBlend = blendMode;
+     if (recorder.out != nullptr)
+     {
+          beginCommand(RENDER_CMD_DRAW_BLEND, sizeof(Uint32));
+          appendU32((Uint32)blendMode);
+     }
+     return SDL_SetRenderDrawBlendMode(renderer, blendMode);
+}
+
+int renderRecordSetClipRect(SDL_Renderer *renderer, const SDL_Rect *rect)
+{
+     syncState(renderer);
+     bool enable = rect != nullptr;
+     if (redundant(cache.clipKnown && enable == cache.clipEnabled &&
+                   (!enable || SDL_RectEquals(rect, &cache.clip))))
+     {
+          return 0;
+     }
+     cache.clipKnown = true;
+     cache.clipEnabled = enable;
+     cache.clip = enable ? *rect : SDL_Rect{0, 0, 0, 0};
+     if (recorder.out != nullptr)
+     {
+          SDL_Rect clip = rect != nullptr ? *rect : SDL_Rect{0, 0, 0, 0};
+          beginCommand(RENDER_CMD_CLIP, sizeof(Uint32) + sizeof(SDL_Rect));
+          appendU32(rect != nullptr ? 1 : 0);
+          append(&clip, sizeof(clip));
+     }
+     return SDL_RenderSetClipRect(renderer, rect);
+}
+
+int renderRecordClear(SDL_Renderer *renderer)
+{
+     if (recorder.out != nullptr)
+     {
+          beginCommand(RENDER_CMD_CLEAR, 0);
+     }
+     return SDL_RenderClear(renderer);
+}
+
+int renderRecordFillRect(SDL_Renderer *renderer, const SDL_Rect *rect)
+{
+     countDraw(nullptr, 4);
+     if (recorder.out != nullptr)
+     {
+          // A null rect fills the whole viewport
+          SDL_Rect viewport;
+          SDL_RenderGetViewport(renderer, &viewport);
+          SDL_FRect area = rect != nullptr ? SDL_FRect{(float)rect->x, (float)rect->y, (float)rect->w, (float)rect->h}
+                                           : SDL_FRect{0.0f, 0.0f, (float)viewport.w, (float)viewport.h};
+          beginCommand(RENDER_CMD_FILL_RECTS, sizeof(Uint32) + sizeof(SDL_FRect));
+          appendU32(1);
+          append(&area, sizeof(area));
+     }
+     return SDL_RenderFillRect(renderer, rect);
+}
+
+int renderRecordFillRectsF(SDL_Renderer *renderer, const SDL_FRect *rects, int count)
+{
+     countDraw(nullptr, 4 * count);
+     if (recorder.out != nullptr && count > 0)
+     {
+          beginCommand(RENDER_CMD_FILL_RECTS, sizeof(Uint32) + (size_t)count * sizeof(SDL_FRect));
+          appendU32((Uint32)count);
+          append(rects, (size_t)count * sizeof(SDL_FRect));
+     }
+     return SDL_RenderFillRectsF(renderer, rects, count);
+}
+
+int renderRecordGeometry(SDL_Renderer *renderer, SDL_Texture *texture, const SDL_Vertex *vertices, int numVertices,
+                         const int *indices, int numIndices)
+{
+     countDraw(texture, numVertices);
+     if (recorder.out != nullptr)
+     {
+          if (indices != nullptr && numVertices <= 65536)
+          {
+               // Batched quads rarely need more than 16-bit indices
+               recorder.shortIndices.resize(numIndices);
+               for (int i = 0; i < numIndices; i++)
+               {
+                    recorder.shortIndices[i] = (Uint16)indices[i];
+               }
+               recordGeometry(texture, vertices, numVertices, recorder.shortIndices.data(), numIndices, 2);
+          }
+          else
+          {
+               recordGeometry(texture, vertices, numVertices, indices, numIndices, sizeof(int));
+          }
+     }
+     return SDL_RenderGeometry(renderer, texture, vertices, numVertices, indices, numIndices);
+}
+
+int renderRecordGeometryRaw(SDL_Renderer *renderer, SDL_Texture *texture, const float *xy, int xyStride,
+                            const SDL_Color *color, int colorStride, const float *uv, int uvStride,
+                            int numVertices, const void *indices, int numIndices, int indexSize)
+{
+     countDraw(texture, numVertices);
+     if (recorder.out != nullptr)
+     {
+          recorder.vertices.resize(numVertices);
+          for (int i = 0; i < numVertices; i++)
+          {
+               const float *position = (const float *)((const Uint8 *)xy + (size_t)i * xyStride);
+               SDL_Vertex &vertex = recorder.vertices[i];
+               vertex.position = {position[0], position[1]};
+               vertex.color = *(const SDL_Color *)((const Uint8 *)color + (size_t)i * colorStride);
+               if (uv != nullptr)
+               {
+                    const float *coord = (const float *)((const Uint8 *)uv + (size_t)i * uvStride);
+                    vertex.tex_coord = {coord[0], coord[1]};
+               }
+               else
+               {
+                    vertex.tex_coord = {0.0f, 0.0f};
+               }
+          }
+          recordGeometry(texture, recorder.vertices.data(), numVertices, indices, numIndices, indexSize);
+     }
+     return SDL_RenderGeometryRaw(renderer, texture, xy, xyStride, color, colorStride, uv, uvStride, numVertices,
+                                  indices, numIndices, indexSize);
+}
+
+int renderRecordCopy(SDL_Renderer *renderer, SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst)
+{
+     countDraw(texture, 4);
+     if (recorder.out != nullptr)
+     {
+          RenderTextureState state = textureState(texture);
+          SDL_Rect srcRect = src != nullptr ? *src : SDL_Rect{0, 0, 0, 0};
+          SDL_FRect dstRect = dst != nullptr ? SDL_FRect{(float)dst->x, (float)dst->y, (float)dst->w, (float)dst->h}
+                                             : SDL_FRect{0.0f, 0.0f, 0.0f, 0.0f};
+          beginCommand(RENDER_CMD_COPY, sizeof(state) + 2 * sizeof(Uint32) + sizeof(SDL_Rect) + sizeof(SDL_FRect));
+          append(&state, sizeof(state));
+          appendU32(src != nullptr ? 1 : 0);
+          append(&srcRect, sizeof(srcRect));
+          appendU32(dst != nullptr ? 1 : 0);
+          append(&dstRect, sizeof(dstRect));
+     }
+     return SDL_RenderCopy(renderer, texture, src, dst);
+}
+
+void renderRecordPresent(SDL_Renderer *renderer)
+{
+     lastFrameStats = frameStats;
+     frameStats = RenderStats{};
+     if (recorder.out != nullptr)
+     {
+          Uint64 now = SDL_GetPerformanceCounter();
+          Uint64 micros = (now - recorder.lastPresent) * 1000000 / SDL_GetPerformanceFrequency();
+          recorder.lastPresent = now;
+          beginCommand(RENDER_CMD_PRESENT, sizeof(Uint32));
+          appendU32((Uint32)SDL_min(micros, (Uint64)0xFFFFFFFF));
+          flush();
+     }
+     SDL_RenderPresent(renderer);
+}
+
+int renderRecordSetTextureBlendMode(SDL_Texture *texture, SDL_BlendMode blendMode)
+{
+     // SDL keeps the mode on the texture itself, so that is the cache
+     SDL_BlendMode current = SDL_BLENDMODE_INVALID;
+     if (redundant(SDL_GetTextureBlendMode(texture, &current) == 0 && current == blendMode))
+     {
+          return 0;
+     }
+     return SDL_SetTextureBlendMode(texture, blendMode);
+}
+
+RenderStats renderRecordStats()
+{
+     return lastFrameStats;
+}
+
+void renderRecordInvalidateState()
+{
+     cache.renderer = nullptr;
+}
+
+SDL_Texture *renderRecordCreateTextureFromSurface(SDL_Renderer *renderer, SDL_Surface *surface)
+{
+     SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
+     if (texture != nullptr)
+     {
+          countUpload(texture, nullptr);
+     }
+     if (recorder.out == nullptr || texture == nullptr)
+     {
+          return texture;
+     }
+
+     // SDL picks the texture format; record the pixels as uploaded
+     Uint32 format = 0;
+     SDL_QueryTexture(texture, &format, NULL, NULL, NULL);
+     recorder.ids.erase(texture);
+     SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface, format, 0);
+     if (converted != nullptr)
+     {
+          SDL_LockSurface(converted);
+          recordPixels(texture, nullptr, converted->pixels, converted->pitch);
+          SDL_UnlockSurface(converted);
+          SDL_FreeSurface(converted);
+     }
+     return texture;
+}
+
+int renderRecordUpdateTexture(SDL_Texture *texture, const SDL_Rect *rect, const void *pixels, int pitch)
+{
+     countUpload(texture, rect);
+     if (recorder.out != nullptr)
+     {
+          recordPixels(texture, rect, pixels, pitch);
+     }
+     return SDL_UpdateTexture(texture, rect, pixels, pitch);
+}
+
+int renderRecordLockTexture(SDL_Texture *texture, const SDL_Rect *rect, void **pixels, int *pitch)
+{
+     int result = SDL_LockTexture(texture, rect, pixels, pitch);
+     if (result == 0)
+     {
+          int w = 0, h = 0;
+          SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+          recorder.locked = texture;
+          recorder.lockedPixels = *pixels;
+          recorder.lockedPitch = *pitch;
+          recorder.lockedRect = rect != nullptr ? *rect : SDL_Rect{0, 0, w, h};
+     }
+     return result;
+}
+
+void renderRecordUnlockTexture(SDL_Texture *texture)
+{
+     if (recorder.locked == texture)
+     {
+          countUpload(texture, &recorder.lockedRect);
+          if (recorder.out != nullptr)
+          {
+               // The locked buffer now holds everything that will be uploaded
+               recordPixels(texture, &recorder.lockedRect, recorder.lockedPixels, recorder.lockedPitch);
+          }
+          recorder.locked = nullptr;
+     }
+     SDL_UnlockTexture(texture);
+}
+
+void renderRecordDestroyTexture(SDL_Texture *texture)
+{
+     if (texture == cache.target)
+     {
+          // SDL falls back to the window; a new texture may reuse the address
+          cache.renderer = nullptr;
+     }
+     if (recorder.out != nullptr)
+     {
+          auto found = recorder.ids.find(texture);
+          if (found != recorder.ids.end())
+          {
+               beginCommand(RENDER_CMD_DESTROY_TEXTURE, sizeof(Uint32));
+               appendU32(found->second);
+               recorder.ids.erase(found);
+          }
+     }
+     SDL_DestroyTexture(texture);
+}
@@ -0,0 +1,121 @@
+// Description:
+// Render command recording. Drawing code calls the renderRecord* wrappers
+// instead of the SDL_Render* functions they stand for; each wrapper does
+// the SDL call and, while a recording is running, appends the command with
+// its data (vertices, rects, texture uploads, state changes) to a compact
+// binary stream. render_replay.h plays such a stream back against any
+// render driver, so drivers and SDL versions can be compared on the exact
+// same command sequence without running the game.
+//
+// Textures are identified by small ids. A texture is described the first
+// time a command references it; its pixels are captured only when they are
+// uploaded through a wrapper during the recording, otherwise the replay
+// draws it with undefined contents (same size and format, so the cost is
+// the same). Renderer calls are main-thread only, and so is the recorder.
+//
+// The state wrappers (draw color and blend mode, target, clip, texture
+// blend mode) also drop calls that would not change anything, so neither
+// SDL nor the recording sees them.
+//
+// Every wrapper also counts the work it submits; renderRecordStats()
+// returns the totals of the last presented frame (draw calls, vertices,
+// texture switches, state calls, upload bytes).
+//
+// Stream layout (native little-endian): a RenderStreamHeader, then
+// commands of one RenderCommand byte, a Uint32 payload size and the
+// payload, as documented on each command.
+// =============================================================================
+
+#ifndef RENDER_RECORD_H
+#define RENDER_RECORD_H
+
+#include <SDL2/SDL.h>
+
+// Set to a file path (SDL_SetHint or the environment) to record the session
+#define RENDER_RECORD_HINT "CATCH_RECORD_RENDER"
+
+const Uint32 RENDER_STREAM_MAGIC = 0x444E5243; // "CRND"
+const Uint32 RENDER_STREAM_VERSION = 1;
+
+struct RenderStreamHeader
+{
+     Uint32 magic;
+     Uint32 version;
+     Sint32 width, height; // Output size of the recorded renderer
+};
+
+enum RenderCommand
+{
+     RENDER_CMD_TEXTURE = 1,     // Uint32 id, format, access; Sint32 w, h
+     RENDER_CMD_TEXTURE_PIXELS,  // Uint32 id; SDL_Rect; Sint32 pitch; pitch * h bytes
+     RENDER_CMD_DESTROY_TEXTURE, // Uint32 id
+     RENDER_CMD_TARGET,          // Uint32 id, 0 for the window
+     RENDER_CMD_DRAW_COLOR,      // Uint8 r, g, b, a
+     RENDER_CMD_DRAW_BLEND,      // Uint32 SDL_BlendMode
+     RENDER_CMD_CLIP,            // Uint32 enabled; SDL_Rect
+     RENDER_CMD_CLEAR,           // Nothing
+     RENDER_CMD_FILL_RECTS,      // Uint32 count; SDL_FRect[count]
+     RENDER_CMD_GEOMETRY,        // RenderTextureState; Uint32 vertices, indices, index size;
+                                 // SDL_Vertex[vertices]; Uint16 or int [indices]
+     RENDER_CMD_COPY,            // RenderTextureState; Uint32 has src; SDL_Rect; Uint32 has dst; SDL_FRect
+     RENDER_CMD_PRESENT          // Uint32 microseconds since the previous present
+};
+
+// Texture and the state that affects how it is drawn
+struct RenderTextureState
+{
+     Uint32 id; // 0 for untextured geometry
+     Uint32 blendMode;
+     Uint8 r, g, b, a; // Color and alpha modulation
+};
+
+// Work submitted through the wrappers during one presented frame
+struct RenderStats
+{
+     int drawCalls;       // Fill, geometry and copy submissions
+     int vertices;        // Geometry vertices, four per rect or copy
+     int textureBinds;    // Textured draws using a different texture than the previous one
+     int stateCalls;      // Draw color/blend, target, clip and texture blend sets
+     int stateEliminated; // ... that set the value already in effect and were dropped
+     int uploads;         // UpdateTexture, unlock and from-surface uploads
+     Sint64 uploadBytes;
+};
+
+// Start writing every wrapped call to `path`
+bool renderRecordStart(SDL_Renderer *renderer, const char *path);
+
+// Flush and close the stream; safe to call when not recording
+void renderRecordStop();
+
+bool renderRecordActive();
+
+// Wrappers with the same contract as the SDL function they are named after
+int renderRecordSetTarget(SDL_Renderer *renderer, SDL_Texture *texture);
+int renderRecordSetDrawColor(SDL_Renderer *renderer, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+int renderRecordSetDrawBlendMode(SDL_Renderer *renderer, SDL_BlendMode blendMode);
+int renderRecordSetClipRect(SDL_Renderer *renderer, const SDL_Rect *rect);
+int renderRecordClear(SDL_Renderer *renderer);
+int renderRecordFillRect(SDL_Renderer *renderer, const SDL_Rect *rect);
+int renderRecordFillRectsF(SDL_Renderer *renderer, const SDL_FRect *rects, int count);
+int renderRecordGeometry(SDL_Renderer *renderer, SDL_Texture *texture, const SDL_Vertex *vertices, int numVertices,
+                         const int *indices, int numIndices);
+int renderRecordGeometryRaw(SDL_Renderer *renderer, SDL_Texture *texture, const float *xy, int xyStride,
+                            const SDL_Color *color, int colorStride, const float *uv, int uvStride,
+                            int numVertices, const void *indices, int numIndices, int indexSize);
+int renderRecordCopy(SDL_Renderer *renderer, SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst);
+void renderRecordPresent(SDL_Renderer *renderer);
+
+SDL_Texture *renderRecordCreateTextureFromSurface(SDL_Renderer *renderer, SDL_Surface *surface);
+int renderRecordUpdateTexture(SDL_Texture *texture, const SDL_Rect *rect, const void *pixels, int pitch);
+int renderRecordLockTexture(SDL_Texture *texture, const SDL_Rect *rect, void **pixels, int *pitch);
+void renderRecordUnlockTexture(SDL_Texture *texture);
+void renderRecordDestroyTexture(SDL_Texture *texture);
+int renderRecordSetTextureBlendMode(SDL_Texture *texture, SDL_BlendMode blendMode);
+
+RenderStats renderRecordStats();
+
+// Forget the cached state after changing it with SDL calls directly, or
+// after a render device or target reset
+void renderRecordInvalidateState();
+
+#endif // RENDER_RECORD_H
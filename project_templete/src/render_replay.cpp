@@ -0,0 +1,370 @@
+#include "render_replay.h"
+#include "render_record.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+     // Sequential reader over one command's payload
+     struct Reader
+     {
+          const Uint8 *at;
+          const Uint8 *end;
+
+          bool read(void *out, size_t size)
+          {
+               if ((size_t)(end - at) < size)
+               {
+                    return false;
+               }
+               SDL_memcpy(out, at, size);
+               at += size;
+               return true;
+          }
+
+          Uint32 u32()
+          {
+               Uint32 value = 0;
+               read(&value, sizeof(value));
+               return value;
+          }
+
+          const Uint8 *take(size_t size)
+          {
+               if ((size_t)(end - at) < size)
+               {
+                    return nullptr;
+               }
+               const Uint8 *data = at;
+               at += size;
+               return data;
+          }
+     };
+
+     SDL_Texture *lookup(const std::vector<SDL_Texture *> &textures, Uint32 id)
+     {
+          return id < textures.size() ? textures[id] : nullptr;
+     }
+
+     SDL_Texture *applyState(const std::vector<SDL_Texture *> &textures, const RenderTextureState &state)
+     {
+          SDL_Texture *texture = lookup(textures, state.id);
+          if (texture != nullptr)
+          {
+               SDL_SetTextureBlendMode(texture, (SDL_BlendMode)state.blendMode);
+               SDL_SetTextureColorMod(texture, state.r, state.g, state.b);
+               SDL_SetTextureAlphaMod(texture, state.a);
+          }
+          return texture;
+     }
+
+     double percentile(const std::vector<double> &sorted, double fraction)
+     {
+          if (sorted.empty())
+          {
+               return 0.0;
+          }
+          size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+          return sorted[SDL_min(index, sorted.size() - 1)];
+     }
+}
+
+bool renderReplayLoad(RenderReplay &replay, const char *path)
+{
+     size_t size = 0;
+     void *file = SDL_LoadFile(path, &size);
+     if (file == nullptr)
+     {
+          std::cerr << "Unable to load render recording " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     replay.data.assign((const Uint8 *)file, (const Uint8 *)file + size);
+     SDL_free(file);
+
+     RenderStreamHeader header;
+     if (size < sizeof(header))
+     {
+          std::cerr << path << " is not a render recording" << std::endl;
+          return false;
+     }
+     SDL_memcpy(&header, replay.data.data(), sizeof(header));
+     if (header.magic != RENDER_STREAM_MAGIC || header.version != RENDER_STREAM_VERSION)
+     {
+          std::cerr << path << " is not a version " << RENDER_STREAM_VERSION << " render recording" << std::endl;
+          return false;
+     }
+     replay.width = header.width;
+     replay.height = header.height;
+
+     // Count frames so the stats can be preallocated
+     replay.frames = 0;
+     size_t at = sizeof(header);
+     while (at + 5 <= size)
+     {
+          Uint32 payload = 0;
+          SDL_memcpy(&payload, &replay.data[at + 1], sizeof(payload));
+          if (replay.data[at] == RENDER_CMD_PRESENT)
+          {
+               replay.frames++;
+          }
+          at += 5 + (size_t)payload;
+     }
+     return true;
+}
+
+bool renderReplayRun(const RenderReplay &replay, SDL_Renderer *renderer, RenderReplayStats &stats)
+{
+     stats = RenderReplayStats{};
+     std::vector<SDL_Texture *> textures(1, nullptr);
+     std::vector<double> frameMs;
+     frameMs.reserve(replay.frames);
+     double recordedMs = 0.0;
+
+     // Payloads follow 5-byte command headers, so nothing in them is aligned;
+     // copies go through scratch buffers that stop growing after a frame
+     std::vector<SDL_FRect> rects;
+     std::vector<SDL_Vertex> vertices;
+     std::vector<Uint8> indices;
+
+     const double frequency = (double)SDL_GetPerformanceFrequency();
+     const Uint8 *at = replay.data.data() + sizeof(RenderStreamHeader);
+     const Uint8 *end = replay.data.data() + replay.data.size();
+     Uint64 frameStart = SDL_GetPerformanceCounter();
+     bool intact = true;
+
+     while (end - at >= 5)
+     {
+          Uint8 type = at[0];
+          Uint32 size = 0;
+          SDL_memcpy(&size, at + 1, sizeof(size));
+          at += 5;
+          if ((size_t)(end - at) < size)
+          {
+               intact = false;
+               break;
+          }
+          Reader payload = {at, at + size};
+          at += size;
+
+          int result = 0;
+          switch (type)
+          {
+          case RENDER_CMD_TEXTURE:
+          {
+               Uint32 id = payload.u32();
+               Uint32 format = payload.u32();
+               int access = (int)payload.u32();
+               int w = (int)payload.u32();
+               int h = (int)payload.u32();
+               if (id >= textures.size())
+               {
+                    textures.resize(id + 1, nullptr);
+               }
+               textures[id] = SDL_CreateTexture(renderer, format, access, w, h);
+               result = textures[id] != nullptr ? 0 : -1;
+               break;
+          }
+          case RENDER_CMD_TEXTURE_PIXELS:
+          {
+               Uint32 id = payload.u32();
+               SDL_Rect rect;
+               payload.read(&rect, sizeof(rect));
+               int pitch = (int)payload.u32();
+               const Uint8 *pixels = payload.take((size_t)pitch * rect.h);
+               SDL_Texture *texture = lookup(textures, id);
+               if (texture != nullptr && pixels != nullptr)
+               {
+                    result = SDL_UpdateTexture(texture, &rect, pixels, pitch);
+               }
+               break;
+          }
+          case RENDER_CMD_DESTROY_TEXTURE:
+          {
+               Uint32 id = payload.u32();
+               SDL_Texture *texture = lookup(textures, id);
+               if (texture != nullptr)
+               {
+                    SDL_DestroyTexture(texture);
+                    textures[id] = nullptr;
+               }
+               break;
+          }
+          case RENDER_CMD_TARGET:
+               result = SDL_SetRenderTarget(renderer, lookup(textures, payload.u32()));
+               break;
+          case RENDER_CMD_DRAW_COLOR:
+          {
+               Uint8 color[4] = {0, 0, 0, 0};
+               payload.read(color, sizeof(color));
+               result = SDL_SetRenderDrawColor(renderer, color[0], color[1], color[2], color[3]);
+               break;
+          }
+          case RENDER_CMD_DRAW_BLEND:
+               result = SDL_SetRenderDrawBlendMode(renderer, (SDL_BlendMode)payload.u32());
+               break;
+          case RENDER_CMD_CLIP:
+          {
+               Uint32 enabled = payload.u32();
+               SDL_Rect rect;
+               payload.read(&rect, sizeof(rect));
+               result = SDL_RenderSetClipRect(renderer, enabled ? &rect : nullptr);
+               break;
+          }
+          case RENDER_CMD_CLEAR:
+               result = SDL_RenderClear(renderer);
+               break;
+          case RENDER_CMD_FILL_RECTS:
+          {
+               Uint32 count = payload.u32();
+               const Uint8 *rectData = payload.take((size_t)count * sizeof(SDL_FRect));
+               if (rectData != nullptr)
+               {
+                    rects.resize(count);
+                    SDL_memcpy(rects.data(), rectData, count * sizeof(SDL_FRect));
+                    result = SDL_RenderFillRectsF(renderer, rects.data(), (int)count);
+               }
+               break;
+          }
+          case RENDER_CMD_GEOMETRY:
+          {
+               RenderTextureState state;
+               payload.read(&state, sizeof(state));
+               Uint32 numVertices = payload.u32();
+               Uint32 numIndices = payload.u32();
+               Uint32 indexSize = payload.u32();
+               const Uint8 *vertexData = payload.take((size_t)numVertices * sizeof(SDL_Vertex));
+               const Uint8 *indexData = payload.take((size_t)numIndices * indexSize);
+               if (vertexData == nullptr || indexData == nullptr)
+               {
+                    result = -1;
+                    break;
+               }
+               vertices.resize(numVertices);
+               SDL_memcpy(vertices.data(), vertexData, numVertices * sizeof(SDL_Vertex));
+               indices.assign(indexData, indexData + (size_t)numIndices * indexSize);
+               const SDL_Vertex *v = vertices.data();
+               result = SDL_RenderGeometryRaw(renderer, applyState(textures, state),
+                                              &v->position.x, sizeof(SDL_Vertex),
+                                              &v->color, sizeof(SDL_Vertex),
+                                              &v->tex_coord.x, sizeof(SDL_Vertex),
+                                              (int)numVertices, numIndices > 0 ? indices.data() : nullptr,
+                                              (int)numIndices, (int)indexSize);
+               break;
+          }
+          case RENDER_CMD_COPY:
+          {
+               RenderTextureState state;
+               payload.read(&state, sizeof(state));
+               Uint32 hasSrc = payload.u32();
+               SDL_Rect src;
+               payload.read(&src, sizeof(src));
+               Uint32 hasDst = payload.u32();
+               SDL_FRect dst;
+               payload.read(&dst, sizeof(dst));
+               result = SDL_RenderCopyF(renderer, applyState(textures, state), hasSrc ? &src : nullptr,
+                                        hasDst ? &dst : nullptr);
+               break;
+          }
+          case RENDER_CMD_PRESENT:
+          {
+               recordedMs += payload.u32() / 1000.0;
+               SDL_RenderPresent(renderer);
+               Uint64 now = SDL_GetPerformanceCounter();
+               frameMs.push_back((now - frameStart) * 1000.0 / frequency);
+               frameStart = now;
+               break;
+          }
+          default:
+               // Unknown command from a newer recorder: skip its payload
+               break;
+          }
+          if (result != 0)
+          {
+               stats.failedCommands++;
+          }
+     }
+
+     for (SDL_Texture *texture : textures)
+     {
+          if (texture != nullptr)
+          {
+               SDL_DestroyTexture(texture);
+          }
+     }
+
+     stats.frames = (int)frameMs.size();
+     for (double ms : frameMs)
+     {
+          stats.totalMs += ms;
+     }
+     if (stats.frames > 0)
+     {
+          stats.averageMs = stats.totalMs / stats.frames;
+          stats.recordedAverageMs = recordedMs / stats.frames;
+          std::sort(frameMs.begin(), frameMs.end());
+          stats.medianMs = percentile(frameMs, 0.5);
+          stats.p95Ms = percentile(frameMs, 0.95);
+          stats.worstMs = frameMs.back();
+     }
+     if (!intact)
+     {
+          std::cerr << "Render recording is truncated; replayed " << stats.frames << " frames" << std::endl;
+     }
+     return intact;
+}
+
+bool renderReplayBenchmark(const char *path)
+{
+     RenderReplay replay;
+     if (!renderReplayLoad(replay, path))
+     {
+          return false;
+     }
+
+     // A renderer picked by index gets batching off unless asked for, so
+     // without this every backend would replay a draw call at a time while
+     // the game (index -1) batches. An explicit SDL_RENDER_BATCHING wins
+     SDL_SetHintWithPriority(SDL_HINT_RENDER_BATCHING, "1", SDL_HINT_DEFAULT);
+
+     std::cout << "[" << std::endl;
+     bool first = true;
+     for (int driver = 0; driver < SDL_GetNumRenderDrivers(); driver++)
+     {
+          SDL_RendererInfo info;
+          if (SDL_GetRenderDriverInfo(driver, &info) != 0)
+          {
+               continue;
+          }
+          SDL_Window *window = SDL_CreateWindow("Render replay", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                                replay.width, replay.height, SDL_WINDOW_SHOWN);
+          // No vsync, so the frame time is the renderer's own cost
+          SDL_Renderer *renderer = window != nullptr ? SDL_CreateRenderer(window, driver, 0) : nullptr;
+          if (renderer == nullptr)
+          {
+               std::cerr << "Skipping render driver " << info.name << "! SDL_Error: " << SDL_GetError() << std::endl;
+               if (window != nullptr)
+               {
+                    SDL_DestroyWindow(window);
+               }
+               continue;
+          }
+
+          RenderReplayStats stats;
+          renderReplayRun(replay, renderer, stats);
+          SDL_DestroyRenderer(renderer);
+          SDL_DestroyWindow(window);
+
+          char line[512];
+          SDL_snprintf(line, sizeof(line),
+                       "  {\"renderer\": \"%s\", \"frames\": %d, \"total_ms\": %.3f, \"avg_ms\": %.4f, "
+                       "\"median_ms\": %.4f, \"p95_ms\": %.4f, \"worst_ms\": %.4f, \"recorded_avg_ms\": %.4f, "
+                       "\"failed_commands\": %d}",
+                       info.name, stats.frames, stats.totalMs, stats.averageMs, stats.medianMs, stats.p95Ms,
+                       stats.worstMs, stats.recordedAverageMs, stats.failedCommands);
+          std::cout << (first ? "" : ",\n") << line;
+          first = false;
+     }
+     std::cout << (first ? "" : "\n") << "]" << std::endl;
+     return true;
+}
@@ -0,0 +1,43 @@
+// Description:
+// Plays back a stream written by render_record.h. The whole file is loaded
+// up front and every command is re-issued against the given renderer, so a
+// replay measures only the renderer: no game logic, no asset decoding, no
+// input. renderReplayBenchmark() runs a recording once per available render
+// driver, without vsync, and prints per-driver frame timings as JSON for
+// side-by-side comparison.
+// =============================================================================
+
+#ifndef RENDER_REPLAY_H
+#define RENDER_REPLAY_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct RenderReplay
+{
+     std::vector<Uint8> data;
+     int width, height; // Output size at recording time
+     int frames;        // Presents in the stream
+};
+
+struct RenderReplayStats
+{
+     int frames;
+     double totalMs;
+     double averageMs;
+     double medianMs;
+     double p95Ms;
+     double worstMs;
+     double recordedAverageMs; // Frame time of the original session
+     int failedCommands;      // SDL calls that returned an error
+};
+
+bool renderReplayLoad(RenderReplay &replay, const char *path);
+
+// Re-issue every command; frame times cover submission and SDL_RenderPresent
+bool renderReplayRun(const RenderReplay &replay, SDL_Renderer *renderer, RenderReplayStats &stats);
+
+// Replay `path` on every render driver and print the results to stdout
+bool renderReplayBenchmark(const char *path);
+
+#endif // RENDER_REPLAY_H
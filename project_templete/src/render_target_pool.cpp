@@ -0,0 +1,128 @@
+#include "render_target_pool.h"
+
+#include <iostream>
+
+#include "render_record.h"
+
+namespace
+{
+     int find(const TargetPool &pool, SDL_Texture *texture)
+     {
+          for (size_t i = 0; i < pool.targets.size(); i++)
+          {
+               if (pool.targets[i].texture == texture)
+               {
+                    return (int)i;
+               }
+          }
+          return -1;
+     }
+
+     void removeAt(TargetPool &pool, size_t index)
+     {
+          renderRecordDestroyTexture(pool.targets[index].texture);
+          pool.targets[index] = pool.targets.back();
+          pool.targets.pop_back();
+     }
+}
+
+bool targetPoolInit(TargetPool &pool, SDL_Renderer *renderer, int maxIdleFrames)
+{
+     pool.renderer = renderer;
+     pool.targets.clear();
+     pool.frame = 0;
+     pool.maxIdleFrames = maxIdleFrames;
+     pool.created = 0;
+     pool.reused = 0;
+
+     SDL_RendererInfo info;
+     return SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_TARGETTEXTURE);
+}
+
+SDL_Texture *targetPoolAcquire(TargetPool &pool, Uint32 format, int width, int height, int access)
+{
+     for (PooledTarget &target : pool.targets)
+     {
+          if (!target.inUse && target.format == format && target.access == access && target.width == width &&
+              target.height == height)
+          {
+               // Undo whatever the previous user set, as a new texture would be
+               renderRecordSetTextureBlendMode(target.texture, SDL_BLENDMODE_NONE);
+               SDL_SetTextureColorMod(target.texture, 255, 255, 255);
+               SDL_SetTextureAlphaMod(target.texture, 255);
+               target.inUse = true;
+               pool.reused++;
+               return target.texture;
+          }
+     }
+
+     SDL_Texture *texture = SDL_CreateTexture(pool.renderer, format, access, width, height);
+     if (texture == nullptr)
+     {
+          std::cerr << "Unable to create " << width << "x" << height << " render target! SDL Error: " << SDL_GetError()
+                    << std::endl;
+          return nullptr;
+     }
+     pool.targets.push_back({texture, format, access, width, height, true, false, pool.frame});
+     pool.created++;
+     return texture;
+}
+
+void targetPoolRelease(TargetPool &pool, SDL_Texture *texture)
+{
+     int index = find(pool, texture);
+     if (index < 0)
+     {
+          return;
+     }
+     PooledTarget &target = pool.targets[index];
+     if (target.lost)
+     {
+          removeAt(pool, index);
+          return;
+     }
+     target.inUse = false;
+     target.lastUse = pool.frame;
+}
+
+void targetPoolFrameEnd(TargetPool &pool)
+{
+     pool.frame++;
+     for (size_t i = pool.targets.size(); i-- > 0;)
+     {
+          const PooledTarget &target = pool.targets[i];
+          if (!target.inUse && pool.frame - target.lastUse > (Uint64)pool.maxIdleFrames)
+          {
+               removeAt(pool, i);
+          }
+     }
+}
+
+void targetPoolHandleEvent(TargetPool &pool, const SDL_Event &event)
+{
+     if (event.type != SDL_RENDER_DEVICE_RESET)
+     {
+          return;
+     }
+     // Every texture is gone; free ones go now, acquired ones on release
+     for (size_t i = pool.targets.size(); i-- > 0;)
+     {
+          if (pool.targets[i].inUse)
+          {
+               pool.targets[i].lost = true;
+          }
+          else
+          {
+               removeAt(pool, i);
+          }
+     }
+}
+
+void targetPoolDestroy(TargetPool &pool)
+{
+     for (const PooledTarget &target : pool.targets)
+     {
+          renderRecordDestroyTexture(target.texture);
+     }
+     pool.targets.clear();
+}
@@ -0,0 +1,63 @@
+// Description:
+// A pool of render target textures for transient passes (blur, bloom, UI
+// composition). Creating a target texture per pass per frame costs a driver
+// allocation every time and fragments video memory; the pool hands out a
+// free texture with the same format, size and access instead and creates
+// one only when none is free. Textures released back to the pool are
+// destroyed after `maxIdleFrames` presented frames without use, so a size
+// that is no longer asked for (an old window size, a finished effect) does
+// not hold on to memory.
+//
+// Acquired textures come back with SDL_CreateTexture's defaults (no blend,
+// no color or alpha modulation) but undefined contents: clear them before
+// use. A texture may be released and acquired again within the same frame;
+// the renderer orders the draws.
+// =============================================================================
+
+#ifndef RENDER_TARGET_POOL_H
+#define RENDER_TARGET_POOL_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct PooledTarget
+{
+     SDL_Texture *texture;
+     Uint32 format;
+     int access;
+     int width, height;
+     bool inUse;
+     bool lost;      // The render device was reset while acquired; destroyed on release
+     Uint64 lastUse; // Frame of the last release
+};
+
+struct TargetPool
+{
+     SDL_Renderer *renderer;
+     std::vector<PooledTarget> targets;
+     Uint64 frame; // Frames presented so far
+     int maxIdleFrames;
+     int created; // Textures created since init
+     int reused;  // Acquires served from the pool
+};
+
+// False when the renderer cannot render to textures
+bool targetPoolInit(TargetPool &pool, SDL_Renderer *renderer, int maxIdleFrames = 120);
+
+// A free target matching the request, or a new one; nullptr on failure
+SDL_Texture *targetPoolAcquire(TargetPool &pool, Uint32 format, int width, int height,
+                               int access = SDL_TEXTUREACCESS_TARGET);
+
+// Hand a texture from targetPoolAcquire() back to the pool
+void targetPoolRelease(TargetPool &pool, SDL_Texture *texture);
+
+// Call once per SDL_RenderPresent; destroys targets idle for too long
+void targetPoolFrameEnd(TargetPool &pool);
+
+// Drops every free target on SDL_RENDER_DEVICE_RESET
+void targetPoolHandleEvent(TargetPool &pool, const SDL_Event &event);
+
+// Destroys all targets, acquired or not
+void targetPoolDestroy(TargetPool &pool);
+
+#endif // RENDER_TARGET_POOL_H
@@ -0,0 +1,260 @@
+#include "sdf_text.h"
+
+#include <cmath>
+#include <iostream>
+
+#include "memory_tags.h"
+
+namespace
+{
+     const int SDF_ATLAS_SIZE = 1024;
+     const int SDF_PADDING = 1;
+
+     // FreeType's SDF renderer maps +-spread pixels around the outline onto
+     // 0..255 with the outline at 128; its default spread is 8 pixels
+     const float SDF_EDGE = 128.0f;
+     const float SDF_UNITS_PER_PIXEL = 128.0f / 8.0f;
+
+     int nextFaceId = 0;
+
+     bool allocate(SdfFace &face, int w, int h, SDL_Point &at)
+     {
+          if (face.shelfX + w + SDF_PADDING > face.atlasSize)
+          {
+               face.shelfX = 0;
+               face.shelfY += face.shelfHeight + SDF_PADDING;
+               face.shelfHeight = 0;
+          }
+          if (face.shelfY + h + SDF_PADDING > face.atlasSize)
+          {
+               return false;
+          }
+          at.x = face.shelfX;
+          at.y = face.shelfY;
+          face.shelfX += w + SDF_PADDING;
+          face.shelfHeight = SDL_max(face.shelfHeight, h);
+          return true;
+     }
+
+     const SdfGlyph &loadGlyph(SdfFace &face, Uint32 codepoint)
+     {
+          auto it = face.glyphs.find(codepoint);
+          if (it != face.glyphs.end())
+          {
+               return it->second;
+          }
+
+          SdfGlyph glyph;
+          glyph.rect = {0, 0, 0, 0};
+          glyph.advance = 0;
+
+          int minx, maxx, miny, maxy;
+          TTF_GlyphMetrics32(face.font, codepoint, &minx, &maxx, &miny, &maxy, &glyph.advance);
+
+          const SDL_Color white = {255, 255, 255, 255};
+          SDL_Surface *surface;
+          {
+               MemoryTagScope tag(MEMORY_TAG_TTF);
+               surface = TTF_RenderGlyph32_Blended(face.font, codepoint, white);
+          }
+          if (surface != nullptr)
+          {
+               SDL_Surface *argb = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+               SDL_FreeSurface(surface);
+               SDL_Point at;
+               if (argb != nullptr && argb->w > 0 && allocate(face, argb->w, argb->h, at))
+               {
+                    // The distance field is carried in the alpha channel
+                    glyph.rect = {at.x, at.y, argb->w, argb->h};
+                    for (int y = 0; y < argb->h; y++)
+                    {
+                         const Uint32 *row = (const Uint32 *)((const Uint8 *)argb->pixels + y * argb->pitch);
+                         Uint8 *out = &face.atlas[(at.y + y) * face.atlasSize + at.x];
+                         for (int x = 0; x < argb->w; x++)
+                         {
+                              out[x] = (Uint8)(row[x] >> 24);
+                         }
+                    }
+               }
+               SDL_FreeSurface(argb);
+          }
+          return face.glyphs[codepoint] = glyph;
+     }
+
+     // Bilinear sample of the distance field, clamped to the glyph rect
+     float sampleField(const SdfFace &face, const SDL_Rect &rect, float u, float v)
+     {
+          u = SDL_clamp(u, 0.0f, (float)(rect.w - 1));
+          v = SDL_clamp(v, 0.0f, (float)(rect.h - 1));
+          int x0 = (int)u, y0 = (int)v;
+          int x1 = SDL_min(x0 + 1, rect.w - 1), y1 = SDL_min(y0 + 1, rect.h - 1);
+          float fx = u - x0, fy = v - y0;
+          const Uint8 *base = &face.atlas[rect.y * face.atlasSize + rect.x];
+          float a = base[y0 * face.atlasSize + x0], b = base[y0 * face.atlasSize + x1];
+          float c = base[y1 * face.atlasSize + x0], d = base[y1 * face.atlasSize + x1];
+          return (a + (b - a) * fx) + ((c + (d - c) * fx) - (a + (b - a) * fx)) * fy;
+     }
+
+     // Coverage glyph for one size, resolved from the distance field
+     const CachedGlyph *resolveGlyph(SdfFace &face, Uint32 codepoint, int pixelSize)
+     {
+          Uint64 key = GLYPH_KEY_EXTERNAL | ((Uint64)face.faceId << 48) | ((Uint64)(pixelSize & 0xFFFF) << 32) | codepoint;
+          const CachedGlyph *cached = glyphCacheFind(*face.resolved, key);
+          if (cached != nullptr)
+          {
+               return cached;
+          }
+
+          const SdfGlyph &source = loadGlyph(face, codepoint);
+          float scale = (float)pixelSize / face.baseSize;
+          int advance = (int)std::lround(source.advance * scale);
+          int w = (int)std::ceil(source.rect.w * scale);
+          int h = (int)std::ceil(source.rect.h * scale);
+
+          if (source.rect.w == 0 || w == 0 || h == 0)
+          {
+               SDL_Surface empty;
+               SDL_zero(empty);
+               return glyphCacheInsert(*face.resolved, key, &empty, advance);
+          }
+
+          // One destination pixel spans 1/scale source pixels, so that many
+          // distance units make a one-pixel antialiased edge
+          float edgeWidth = SDF_UNITS_PER_PIXEL / scale;
+          face.scratch.resize(w * h);
+          for (int y = 0; y < h; y++)
+          {
+               float v = (y + 0.5f) / scale - 0.5f;
+               for (int x = 0; x < w; x++)
+               {
+                    float u = (x + 0.5f) / scale - 0.5f;
+                    float coverage = (sampleField(face, source.rect, u, v) - SDF_EDGE) / edgeWidth + 0.5f;
+                    Uint32 alpha = (Uint32)(SDL_clamp(coverage, 0.0f, 1.0f) * 255.0f + 0.5f);
+                    face.scratch[y * w + x] = (alpha << 24) | 0x00FFFFFF;
+               }
+          }
+
+          SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormatFrom(face.scratch.data(), w, h, 32, w * 4,
+                                                                    SDL_PIXELFORMAT_ARGB8888);
+          if (surface == nullptr)
+          {
+               return nullptr;
+          }
+          const CachedGlyph *glyph = glyphCacheInsert(*face.resolved, key, surface, advance);
+          SDL_FreeSurface(surface);
+          return glyph;
+     }
+
+     float kerning(SdfFace &face, Uint32 previous, Uint32 codepoint, float scale)
+     {
+          if (previous == 0)
+          {
+               return 0.0f;
+          }
+          return TTF_GetFontKerningSizeGlyphs32(face.font, previous, codepoint) * scale;
+     }
+}
+
+bool sdfFaceOpen(SdfFace &face, const char *path, int baseSize, GlyphCache *resolved)
+{
+     face.font = TTF_OpenFont(path, baseSize);
+     if (face.font == nullptr)
+     {
+          std::cerr << "Unable to open font " << path << "! SDL_ttf Error: " << TTF_GetError() << std::endl;
+          return false;
+     }
+     if (TTF_SetFontSDF(face.font, SDL_TRUE) < 0)
+     {
+          std::cerr << "SDF rendering unavailable for " << path << "! SDL_ttf Error: " << TTF_GetError() << std::endl;
+          TTF_CloseFont(face.font);
+          face.font = nullptr;
+          return false;
+     }
+     face.baseSize = baseSize;
+     face.lineSkip = TTF_FontLineSkip(face.font);
+     face.faceId = nextFaceId++ & 0x7FFF;
+     face.atlasSize = SDF_ATLAS_SIZE;
+     face.atlas.assign(SDF_ATLAS_SIZE * SDF_ATLAS_SIZE, 0);
+     face.shelfX = 0;
+     face.shelfY = 0;
+     face.shelfHeight = 0;
+     face.glyphs.clear();
+     face.resolved = resolved;
+     return true;
+}
+
+void sdfFaceMeasure(SdfFace &face, const char *text, int pixelSize, int *w, int *h)
+{
+     float scale = (float)pixelSize / face.baseSize;
+     float width = 0.0f, lineWidth = 0.0f;
+     int lines = 1;
+     Uint32 previous = 0;
+
+     while (*text)
+     {
+          Uint32 codepoint = glyphCacheDecodeUtf8(text);
+          if (codepoint == '\n')
+          {
+               width = SDL_max(width, lineWidth);
+               lineWidth = 0.0f;
+               previous = 0;
+               lines++;
+               continue;
+          }
+          lineWidth += kerning(face, previous, codepoint, scale) + loadGlyph(face, codepoint).advance * scale;
+          previous = codepoint;
+     }
+     if (w)
+     {
+          *w = (int)std::ceil(SDL_max(width, lineWidth));
+     }
+     if (h)
+     {
+          *h = (int)std::ceil(lines * face.lineSkip * scale);
+     }
+}
+
+void sdfFaceDrawText(SdfFace &face, RenderQueue &queue, const char *text, float x, float y,
+                     int pixelSize, SDL_Color color)
+{
+     if (pixelSize <= 0)
+     {
+          return;
+     }
+     float scale = (float)pixelSize / face.baseSize;
+     float penX = x, penY = y;
+     Uint32 previous = 0;
+
+     while (*text)
+     {
+          Uint32 codepoint = glyphCacheDecodeUtf8(text);
+          if (codepoint == '\n')
+          {
+               penX = x;
+               penY += face.lineSkip * scale;
+               previous = 0;
+               continue;
+          }
+          penX += kerning(face, previous, codepoint, scale);
+          const CachedGlyph *glyph = resolveGlyph(face, codepoint, pixelSize);
+          if (glyph != nullptr && glyph->page >= 0)
+          {
+               SDL_FRect dst = {std::floor(penX), std::floor(penY), (float)glyph->src.w, (float)glyph->src.h};
+               renderQueueCopyTinted(queue, face.resolved->pages[glyph->page], &glyph->src, dst, color);
+          }
+          // Advance by the unrounded width so long strings don't drift
+          penX += loadGlyph(face, codepoint).advance * scale;
+          previous = codepoint;
+     }
+}
+
+void sdfFaceClose(SdfFace &face)
+{
+     if (face.font != nullptr)
+     {
+          TTF_CloseFont(face.font);
+          face.font = nullptr;
+     }
+     face.atlas.clear();
+     face.glyphs.clear();
+}
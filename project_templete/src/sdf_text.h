@@ -0,0 +1,59 @@
+// Description:
+// Scalable text from a single signed distance field atlas per font face.
+// Glyphs are rasterized once by FreeType at a base size with TTF_SetFontSDF
+// enabled and the distance fields kept in a CPU-side atlas. SDL_Renderer
+// has no programmable shaders, so instead of thresholding on the GPU each
+// glyph is resolved on the CPU: the SDF is resampled to the requested pixel
+// size and turned into one-pixel antialiased coverage. Resolved glyphs live
+// in the regular glyph cache keyed by (face, size, codepoint).
+//
+// Changing size or zoom therefore never calls into FreeType again; it costs
+// one cheap resample per glyph and size the first time that size is drawn.
+// =============================================================================
+
+#ifndef SDF_TEXT_H
+#define SDF_TEXT_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <unordered_map>
+#include <vector>
+
+#include "glyph_cache.h"
+#include "render_queue.h"
+
+struct SdfGlyph
+{
+     SDL_Rect rect; // Distance field rect in the face atlas, w == 0 if empty
+     int advance;   // Pen advance at the base size
+};
+
+struct SdfFace
+{
+     TTF_Font *font;       // Opened at baseSize with SDF rendering enabled
+     int baseSize;
+     int lineSkip;         // At the base size
+     int faceId;           // Distinguishes faces sharing a glyph cache
+
+     // 8-bit distance field atlas, 128 on the outline
+     int atlasSize;
+     std::vector<Uint8> atlas;
+     int shelfX, shelfY, shelfHeight;
+     std::unordered_map<Uint32, SdfGlyph> glyphs;
+
+     GlyphCache *resolved; // Per-size coverage glyphs ready to draw
+     std::vector<Uint32> scratch;
+};
+
+bool sdfFaceOpen(SdfFace &face, const char *path, int baseSize, GlyphCache *resolved);
+
+// Size of UTF-8 text drawn at `pixelSize`
+void sdfFaceMeasure(SdfFace &face, const char *text, int pixelSize, int *w, int *h);
+
+// Queue UTF-8 text at `pixelSize` with its top-left corner at (x, y)
+void sdfFaceDrawText(SdfFace &face, RenderQueue &queue, const char *text, float x, float y,
+                     int pixelSize, SDL_Color color);
+
+void sdfFaceClose(SdfFace &face);
+
+#endif // SDF_TEXT_H
@@ -0,0 +1,21 @@
+// Description:
+// vulkan_sprites fragment shader. Every texture is in one descriptor
+// array and the sprite picks its own, so sprites with different textures
+// share a draw; the index varies within the draw, hence nonuniformEXT.
+// =============================================================================
+
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform sampler2D textures[256]; // VULKAN_SPRITES_MAX_TEXTURES
+
+layout(location = 0) in vec2 inUv;
+layout(location = 1) in vec4 inColor;
+layout(location = 2) flat in uint inTexture;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+     outColor = texture(textures[nonuniformEXT(inTexture)], inUv) * inColor;
+}
@@ -0,0 +1,31 @@
+// Description:
+// vulkan_sprites vertex shader. One instance per sprite, four strip
+// vertices per instance; the corner comes from gl_VertexIndex, so there is
+// no vertex or index buffer, only the instance stream.
+// =============================================================================
+
+#version 450
+
+layout(location = 0) in vec4 inRect;  // x, y, width, height in pixels
+layout(location = 1) in vec4 inUv;    // u0, v0, u1, v1
+layout(location = 2) in vec4 inColor; // Tint
+layout(location = 3) in uint inTexture;
+
+layout(push_constant) uniform Push
+{
+     vec2 scale; // 2 / drawable size
+} push;
+
+layout(location = 0) out vec2 outUv;
+layout(location = 1) out vec4 outColor;
+layout(location = 2) flat out uint outTexture;
+
+void main()
+{
+     vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+     vec2 position = inRect.xy + corner * inRect.zw;
+     gl_Position = vec4(position * push.scale - 1.0, 0.0, 1.0);
+     outUv = mix(inUv.xy, inUv.zw, corner);
+     outColor = inColor;
+     outTexture = inTexture;
+}
@@ -0,0 +1,268 @@
+#include "shaped_text.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "memory_tags.h"
+#include "render_record.h"
+
+namespace
+{
+     // External glyph keys with this bit are shaped runs; sdf_text's never set it
+     const Uint64 SHAPED_KEY_BIT = (Uint64)1 << 62;
+
+     Uint32 scriptTag(const char *script)
+     {
+          Uint32 tag = 0;
+          for (int i = 0; i < 4 && script != nullptr && script[i]; i++)
+          {
+               tag |= (Uint32)(Uint8)script[i] << (8 * i);
+          }
+          return tag;
+     }
+
+     Uint64 runKey(int fontId, int style, TTF_Direction direction, Uint32 script, const char *text)
+     {
+          Uint64 hash = 14695981039346656037ull;
+          const Uint32 fields[4] = {(Uint32)fontId, (Uint32)style, (Uint32)direction, script};
+          const Uint8 *bytes = (const Uint8 *)fields;
+          for (size_t i = 0; i < sizeof(fields); i++)
+          {
+               hash = (hash ^ bytes[i]) * 1099511628211ull;
+          }
+          for (const char *c = text; *c; c++)
+          {
+               hash = (hash ^ (Uint8)*c) * 1099511628211ull;
+          }
+          return GLYPH_KEY_EXTERNAL | SHAPED_KEY_BIT | (hash & (SHAPED_KEY_BIT - 1));
+     }
+
+     // The texture may still be queued for this frame, so it goes through
+     // the glyph cache's queue
+     void releaseRun(ShapedTextCache &cache, ShapedRun &run)
+     {
+          if (run.oversized != nullptr)
+          {
+               glyphCacheRetireTexture(*cache.glyphs, run.oversized);
+               run.oversized = nullptr;
+          }
+     }
+
+     // Drop the least recently used quarter in one pass, so a full cache
+     // does not scan on every miss
+     void evictOldest(ShapedTextCache &cache)
+     {
+          std::vector<Uint64> ages;
+          ages.reserve(cache.runs.size());
+          for (const auto &entry : cache.runs)
+          {
+               ages.push_back(entry.second.lastUsed);
+          }
+          const size_t count = SDL_max((size_t)1, ages.size() / 4);
+          std::nth_element(ages.begin(), ages.begin() + (count - 1), ages.end());
+          const Uint64 cutoff = ages[count - 1];
+          for (auto it = cache.runs.begin(); it != cache.runs.end();)
+          {
+               if (it->second.lastUsed <= cutoff)
+               {
+                    releaseRun(cache, it->second);
+                    it = cache.runs.erase(it);
+               }
+               else
+               {
+                    ++it;
+               }
+          }
+     }
+
+     ShapedRun &lookupRun(ShapedTextCache &cache, Uint64 key, int fontId, int style, TTF_Direction direction,
+                          Uint32 script, const char *text)
+     {
+          auto it = cache.runs.find(key);
+          if (it != cache.runs.end() && it->second.fontId == fontId && it->second.style == style &&
+              it->second.direction == direction && it->second.script == script && it->second.text == text)
+          {
+               cache.stats.hits++;
+               it->second.lastUsed = ++cache.useCounter;
+               return it->second;
+          }
+          if (it == cache.runs.end() && (int)cache.runs.size() >= cache.maxRuns)
+          {
+               evictOldest(cache);
+          }
+
+          // New run, or a hash collision that replaces the old one
+          ShapedRun &run = cache.runs[key];
+          releaseRun(cache, run);
+          run.text = text;
+          run.fontId = fontId;
+          run.style = style;
+          run.direction = direction;
+          run.script = script;
+          run.w = -1;
+          run.h = -1;
+          run.rendered = false;
+          run.oversized = nullptr;
+          run.lastUsed = ++cache.useCounter;
+          return run;
+     }
+
+     // Direction and script are font state in SDL_ttf, so set them before every shape
+     TTF_Font *prepareFont(ShapedTextCache &cache, int fontId, TTF_Direction direction, const char *script)
+     {
+          TTF_Font *font = cache.glyphs->fonts[fontId].font;
+          TTF_SetFontDirection(font, direction);
+          TTF_SetFontScriptName(font, script != nullptr ? script : "Zzzz"); // Unknown: HarfBuzz guesses
+          return font;
+     }
+
+     // Shape and rasterize the run into the atlas, or into a texture of its own
+     const CachedGlyph *renderRun(ShapedTextCache &cache, ShapedRun &run, Uint64 key, const char *script)
+     {
+          TTF_Font *font = prepareFont(cache, run.fontId, run.direction, script);
+          const SDL_Color white = {255, 255, 255, 255};
+          SDL_Surface *surface;
+          {
+               MemoryTagScope tag(MEMORY_TAG_TTF);
+               surface = TTF_RenderUTF8_Blended(font, run.text.c_str(), white);
+          }
+          cache.stats.renders++;
+          run.rendered = true;
+          if (surface == nullptr)
+          {
+               return nullptr;
+          }
+          if (surface->format->format != SDL_PIXELFORMAT_ARGB8888)
+          {
+               SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+               SDL_FreeSurface(surface);
+               surface = converted;
+               if (surface == nullptr)
+               {
+                    return nullptr;
+               }
+          }
+          if (run.w < 0)
+          {
+               run.w = surface->w;
+               run.h = surface->h;
+          }
+
+          const CachedGlyph *glyph = nullptr;
+          const int pageSize = cache.glyphs->pageSize;
+          if (surface->w < pageSize && surface->h < pageSize)
+          {
+               glyph = glyphCacheInsert(*cache.glyphs, key, surface, surface->w);
+          }
+          else
+          {
+               run.oversized = SDL_CreateTexture(cache.glyphs->renderer, SDL_PIXELFORMAT_ARGB8888,
+                                                 SDL_TEXTUREACCESS_STATIC, surface->w, surface->h);
+               if (run.oversized == nullptr)
+               {
+                    std::cerr << "Unable to create shaped text texture! SDL Error: " << SDL_GetError() << std::endl;
+               }
+               else
+               {
+                    renderRecordSetTextureBlendMode(run.oversized, SDL_BLENDMODE_BLEND);
+                    renderRecordUpdateTexture(run.oversized, NULL, surface->pixels, surface->pitch);
+               }
+          }
+          SDL_FreeSurface(surface);
+          return glyph;
+     }
+}
+
+void shapedTextInit(ShapedTextCache &cache, GlyphCache *glyphs, int maxRuns)
+{
+     cache.glyphs = glyphs;
+     cache.maxRuns = SDL_max(1, maxRuns);
+     cache.runs.clear();
+     cache.useCounter = 0;
+     cache.stats = ShapedTextStats{};
+}
+
+void shapedTextMeasure(ShapedTextCache &cache, int fontId, const char *text, TTF_Direction direction,
+                       const char *script, int *w, int *h)
+{
+     const Uint32 tag = scriptTag(script);
+     const int style = TTF_GetFontStyle(cache.glyphs->fonts[fontId].font);
+     ShapedRun &run = lookupRun(cache, runKey(fontId, style, direction, tag, text), fontId, style, direction, tag, text);
+     if (run.w < 0)
+     {
+          TTF_Font *font = prepareFont(cache, fontId, direction, script);
+          if (TTF_SizeUTF8(font, text, &run.w, &run.h) < 0)
+          {
+               run.w = 0;
+               run.h = 0;
+          }
+          cache.stats.shapes++;
+     }
+     if (w)
+     {
+          *w = run.w;
+     }
+     if (h)
+     {
+          *h = run.h;
+     }
+}
+
+void shapedTextDraw(ShapedTextCache &cache, RenderQueue &queue, int fontId, const char *text,
+                    TTF_Direction direction, const char *script, float x, float y, SDL_Color color)
+{
+     if (*text == '\0')
+     {
+          return;
+     }
+     const Uint32 tag = scriptTag(script);
+     const int style = TTF_GetFontStyle(cache.glyphs->fonts[fontId].font);
+     const Uint64 key = runKey(fontId, style, direction, tag, text);
+     ShapedRun &run = lookupRun(cache, key, fontId, style, direction, tag, text);
+
+     const CachedGlyph *glyph = nullptr;
+     if (run.oversized == nullptr)
+     {
+          // The glyph cache may have cleared its pages since the run was drawn
+          glyph = run.rendered ? glyphCacheFind(*cache.glyphs, key) : nullptr;
+          if (glyph == nullptr)
+          {
+               glyph = renderRun(cache, run, key, script);
+          }
+     }
+
+     if (run.oversized != nullptr)
+     {
+          SDL_Rect src = {0, 0, run.w, run.h};
+          SDL_FRect dst = {x, y, (float)run.w, (float)run.h};
+          renderQueueCopyTinted(queue, run.oversized, &src, dst, color);
+     }
+     else if (glyph != nullptr && glyph->page >= 0)
+     {
+          SDL_FRect dst = {x, y, (float)glyph->src.w, (float)glyph->src.h};
+          renderQueueCopyTinted(queue, cache.glyphs->pages[glyph->page], &glyph->src, dst, color);
+     }
+}
+
+ShapedTextStats shapedTextGetStats(const ShapedTextCache &cache)
+{
+     ShapedTextStats stats = cache.stats;
+     stats.runs = (int)cache.runs.size();
+     return stats;
+}
+
+void shapedTextClear(ShapedTextCache &cache)
+{
+     for (auto &entry : cache.runs)
+     {
+          releaseRun(cache, entry.second);
+     }
+     cache.runs.clear();
+}
+
+void shapedTextDestroy(ShapedTextCache &cache)
+{
+     shapedTextClear(cache);
+     cache.glyphs = nullptr;
+}
@@ -0,0 +1,83 @@
+// Description:
+// Cache of shaped text runs for scripts that need HarfBuzz: Arabic, Indic
+// and anything else set up with TTF_SetFontDirection() and
+// TTF_SetFontScriptName(). Those scripts cannot go through the glyph
+// cache's per-codepoint layout, and SDL_ttf reshapes the whole string on
+// every TTF_SizeUTF8 or TTF_Render call, which made shaping the biggest
+// CPU cost in the menus.
+//
+// A run is keyed by (font, style, direction, script, string). SDL_ttf does
+// not expose the glyph ids and advances HarfBuzz produces, so what is kept
+// is the result of shaping: the run's size, taken from TTF_SizeUTF8 the
+// first time it is measured, and the run itself, rendered white once and
+// stored in the glyph cache's atlas under an external key, so that it is
+// tinted and batched like any other glyph. Measure and draw calls share
+// the entry, and a string is shaped at most once per use.
+//
+// Runs are single lines. The oldest runs are forgotten once maxRuns are
+// cached; runs the glyph cache drops when its pages fill up (see
+// glyphCacheClear) are rendered again on their next draw.
+// =============================================================================
+
+#ifndef SHAPED_TEXT_H
+#define SHAPED_TEXT_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <string>
+#include <unordered_map>
+
+#include "glyph_cache.h"
+#include "render_queue.h"
+
+struct ShapedRun
+{
+     std::string text; // Guards against hash collisions
+     int fontId;
+     int style;
+     TTF_Direction direction;
+     Uint32 script;
+     int w, h;         // Size as shaped, -1 until measured
+     bool rendered;    // Pixels are in the glyph cache under the run's key
+     SDL_Texture *oversized; // Runs too large for an atlas page, else nullptr
+     Uint64 lastUsed;
+};
+
+struct ShapedTextStats
+{
+     int hits;
+     int shapes;  // TTF_SizeUTF8 calls on a miss
+     int renders; // TTF_RenderUTF8_Blended calls on a miss
+     int runs;    // Currently cached
+};
+
+struct ShapedTextCache
+{
+     GlyphCache *glyphs;
+     int maxRuns;
+     std::unordered_map<Uint64, ShapedRun> runs;
+     Uint64 useCounter;
+     ShapedTextStats stats;
+};
+
+// Runs are drawn through `glyphs`, whose fonts are addressed by the same ids
+void shapedTextInit(ShapedTextCache &cache, GlyphCache *glyphs, int maxRuns = 256);
+
+// Size of the shaped single-line UTF-8 run. `script` is an ISO 15924 tag
+// such as "Arab", or nullptr to let HarfBuzz guess it. Shaping leaves the
+// direction and script set on the font.
+void shapedTextMeasure(ShapedTextCache &cache, int fontId, const char *text, TTF_Direction direction,
+                       const char *script, int *w, int *h);
+
+// Queue the shaped run with its top-left corner at (x, y)
+void shapedTextDraw(ShapedTextCache &cache, RenderQueue &queue, int fontId, const char *text,
+                    TTF_Direction direction, const char *script, float x, float y, SDL_Color color);
+
+ShapedTextStats shapedTextGetStats(const ShapedTextCache &cache);
+
+// Forget every run; their atlas space is reclaimed with the glyph cache's
+void shapedTextClear(ShapedTextCache &cache);
+
+void shapedTextDestroy(ShapedTextCache &cache);
+
+#endif // SHAPED_TEXT_H
@@ -0,0 +1,164 @@
+#include "snapshot_ring.h"
+
+namespace
+{
+     const size_t SNAPSHOT_BLOCK_WORDS = 8;   // 64 bytes, a cache line
+     const size_t SNAPSHOT_SKIM_BYTES = 1024; // Skimmed with memcmp before blocks are compared
+
+     size_t snapshotBlocksOf(size_t bytes)
+     {
+          return (bytes + SNAPSHOT_BLOCK_WORDS * 8 - 1) / (SNAPSHOT_BLOCK_WORDS * 8);
+     }
+
+     // Copy the span into its place in `head`, appending the XOR of every
+     // word that changed to `delta`
+     void snapshotEncodeSpan(const SnapshotSpan &span, Uint64 *head, std::vector<Uint64> &delta, size_t &runHeader,
+                             size_t &runEnd)
+     {
+          const Uint8 *live = (const Uint8 *)span.data;
+          const Uint8 *copy = (const Uint8 *)(head + span.offset);
+          for (size_t pos = 0; pos < span.size; pos += SNAPSHOT_BLOCK_WORDS * 8)
+          {
+               // Most of the state is unchanged; the C library's memcmp runs
+               // through it far faster than the block loop would
+               if (pos % SNAPSHOT_SKIM_BYTES == 0 && span.size - pos >= SNAPSHOT_SKIM_BYTES &&
+                   SDL_memcmp(live + pos, copy + pos, SNAPSHOT_SKIM_BYTES) == 0)
+               {
+                    pos += SNAPSHOT_SKIM_BYTES - SNAPSHOT_BLOCK_WORDS * 8;
+                    continue;
+               }
+               // memcpy keeps unaligned spans and a short last block legal;
+               // the compiler turns the whole block into plain loads
+               Uint64 block[SNAPSHOT_BLOCK_WORDS] = {0};
+               SDL_memcpy(block, live + pos, SDL_min(span.size - pos, SNAPSHOT_BLOCK_WORDS * 8));
+               Uint64 *old = head + span.offset + pos / 8;
+               Uint64 changed = 0;
+               for (size_t w = 0; w < SNAPSHOT_BLOCK_WORDS; w++)
+               {
+                    changed |= block[w] ^ old[w];
+               }
+               if (changed == 0)
+               {
+                    continue;
+               }
+               for (size_t w = 0; w < SNAPSHOT_BLOCK_WORDS; w++)
+               {
+                    const Uint64 difference = block[w] ^ old[w];
+                    if (difference == 0)
+                    {
+                         continue;
+                    }
+                    const size_t word = span.offset + pos / 8 + w;
+                    if (runHeader < delta.size() && word == runEnd)
+                    {
+                         delta[runHeader]++;
+                    }
+                    else
+                    {
+                         runHeader = delta.size();
+                         delta.push_back((Uint64)word << 32 | 1);
+                    }
+                    delta.push_back(difference);
+                    runEnd = word + 1;
+                    old[w] = block[w];
+               }
+          }
+     }
+
+     void snapshotApplyDelta(std::vector<Uint64> &head, const std::vector<Uint64> &delta)
+     {
+          const Uint64 *cursor = delta.data();
+          const Uint64 *end = cursor + delta.size();
+          while (cursor < end)
+          {
+               Uint64 *out = head.data() + (size_t)(*cursor >> 32);
+               const size_t count = (size_t)(*cursor & 0xFFFFFFFFu);
+               cursor++;
+               for (size_t i = 0; i < count; i++)
+               {
+                    out[i] ^= cursor[i];
+               }
+               cursor += count;
+          }
+     }
+}
+
+void snapshotRingInit(SnapshotRing &ring, int capacity)
+{
+     ring.spans.clear();
+     ring.stateWords = 0;
+     ring.head.clear();
+     ring.capacity = SDL_max(capacity, 2);
+     ring.deltas.assign(ring.capacity, std::vector<Uint64>());
+     ring.lastDeltaBytes = 0;
+     snapshotRingReset(ring);
+}
+
+void snapshotRingAdd(SnapshotRing &ring, void *data, size_t size)
+{
+     SnapshotSpan span = {data, size, ring.stateWords};
+     ring.spans.push_back(span);
+     ring.stateWords += snapshotBlocksOf(size) * SNAPSHOT_BLOCK_WORDS;
+     ring.head.assign(ring.stateWords, 0);
+     snapshotRingReset(ring);
+}
+
+void snapshotRingReset(SnapshotRing &ring)
+{
+     ring.headFrame = 0;
+     ring.frames = 0;
+}
+
+void snapshotRingSave(SnapshotRing &ring, Uint32 frame)
+{
+     if (ring.frames == 0 || frame != ring.headFrame + 1)
+     {
+          // Padding past each span's end stays zero from the assign
+          for (const SnapshotSpan &span : ring.spans)
+          {
+               SDL_memcpy(ring.head.data() + span.offset, span.data, span.size);
+          }
+          ring.headFrame = frame;
+          ring.frames = 1;
+          ring.lastDeltaBytes = 0;
+          return;
+     }
+
+     // The slot is either unused or the delta of the frame that is about to
+     // fall off the end of the history
+     std::vector<Uint64> &delta = ring.deltas[frame % ring.capacity];
+     delta.clear();
+     size_t runHeader = ~(size_t)0, runEnd = 0;
+     for (const SnapshotSpan &span : ring.spans)
+     {
+          snapshotEncodeSpan(span, ring.head.data(), delta, runHeader, runEnd);
+     }
+     ring.headFrame = frame;
+     ring.frames = SDL_min(ring.frames + 1, ring.capacity);
+     ring.lastDeltaBytes = delta.size() * sizeof(Uint64);
+}
+
+bool snapshotRingHas(const SnapshotRing &ring, Uint32 frame)
+{
+     // Wraps to a huge age for frames after the head
+     return ring.frames > 0 && ring.headFrame - frame < (Uint32)ring.frames;
+}
+
+bool snapshotRingRestore(SnapshotRing &ring, Uint32 frame)
+{
+     if (!snapshotRingHas(ring, frame))
+     {
+          return false;
+     }
+     for (Uint32 newer = ring.headFrame; newer != frame; newer--)
+     {
+          snapshotApplyDelta(ring.head, ring.deltas[newer % ring.capacity]);
+     }
+     ring.frames -= (int)(ring.headFrame - frame);
+     ring.headFrame = frame;
+     for (const SnapshotSpan &span : ring.spans)
+     {
+          SDL_memcpy(span.data, ring.head.data() + span.offset, span.size);
+     }
+     return true;
+}
@@ -0,0 +1,98 @@
+// Description:
+// Snapshots of the simulation for rollback netplay, where a late remote
+// input means restoring the state of a few frames back and simulating
+// forward again, possibly many times a frame. The state is described once
+// as a list of fixed memory spans (the pools' arrays and a struct of game
+// variables), so saving it is a pass over a few contiguous blocks and
+// never walks objects or allocates once the ring is warm.
+//
+// The ring keeps the newest snapshot whole and, for each older frame, a
+// delta back to it: the XOR of the words that changed, grouped into runs.
+// A tick changes a few kilobytes of a state of a few hundred, so a delta
+// is small and ten frames of history cost little more than one snapshot.
+// snapshotRingSave() skims the spans against the newest snapshot with
+// memcmp a kilobyte at a time, compares what differs 64 bytes at a time,
+// and records the changed words as it copies them. snapshotRingRestore()
+// undoes deltas down to the wanted frame and copies that state back into
+// the spans, then forgets the newer frames: they are about to be
+// simulated again.
+//
+//     SnapshotRing ring;
+//     snapshotRingInit(ring, 16);
+//     snapshotRingAddValue(ring, sim);
+//     snapshotRingAddVector(ring, blocks.x);
+//     ...
+//     snapshotRingSave(ring, frame);           // After every tick
+//     snapshotRingRestore(ring, frame - 8);    // A correction arrived
+//
+// Spans must stay where they are and keep their size while registered:
+// vectors are sized once at startup and never resized. Padding inside
+// structs is copied like any other byte; zero-initialize them for a
+// checksum of the state to be repeatable.
+// =============================================================================
+
+#ifndef SNAPSHOT_RING_H
+#define SNAPSHOT_RING_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct SnapshotSpan
+{
+     void *data;
+     size_t size;   // Bytes
+     size_t offset; // Of its copy in `head`, in words; 64-byte aligned
+};
+
+struct SnapshotRing
+{
+     std::vector<SnapshotSpan> spans;
+     size_t stateWords; // Length of `head`
+
+     std::vector<Uint64> head; // The newest snapshot, whole
+     Uint32 headFrame;
+     int frames;   // Snapshots held, the head included; 0 when empty
+     int capacity;
+
+     // deltas[frame % capacity] turns frame's state into the one before it.
+     // Runs of a header word (first word << 32 | length) and the XORs
+     std::vector<std::vector<Uint64>> deltas;
+
+     size_t lastDeltaBytes; // Of the latest save, for tuning and the bench
+};
+
+// Room for `capacity` frames, so rollbacks of up to capacity - 1
+void snapshotRingInit(SnapshotRing &ring, int capacity);
+
+// Register `size` bytes at `data` as part of the state. Forgets every
+// snapshot taken so far, since they were taken without it
+void snapshotRingAdd(SnapshotRing &ring, void *data, size_t size);
+
+template <typename T>
+void snapshotRingAddValue(SnapshotRing &ring, T &value)
+{
+     snapshotRingAdd(ring, &value, sizeof(T));
+}
+
+// The vector's elements, not the vector: it must not be resized afterwards
+template <typename T>
+void snapshotRingAddVector(SnapshotRing &ring, std::vector<T> &values)
+{
+     snapshotRingAdd(ring, values.data(), values.size() * sizeof(T));
+}
+
+// Forget every snapshot; the spans stay registered
+void snapshotRingReset(SnapshotRing &ring);
+
+// Snapshot the spans as `frame`. Frames follow one another; any other
+// frame than the one after the newest starts the history over from it
+void snapshotRingSave(SnapshotRing &ring, Uint32 frame);
+
+// True if `frame` is still held
+bool snapshotRingHas(const SnapshotRing &ring, Uint32 frame);
+
+// Put the state of `frame` back into the spans and make it the newest
+// snapshot. False, with the spans untouched, if it is no longer held
+bool snapshotRingRestore(SnapshotRing &ring, Uint32 frame);
+
+#endif // SNAPSHOT_RING_H
@@ -0,0 +1,611 @@
+#include "soft_raster.h"
+
+#include <cmath>
+#include <utility>
+
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define SOFT_RASTER_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+     const int SUBPIXEL_BITS = 4;
+     const int SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+     const float MAX_COORDINATE = 1 << 24; // Further out than any target, and keeps the fixed-point products in range
+
+     Sint64 floorDiv(Sint64 value, Sint64 divisor)
+     {
+          return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+     }
+
+     // Shifts of the three colour channels and alpha of a 32-bit surface
+     struct Channels
+     {
+          int shift[4]; // r, g, b, a
+          bool alpha;
+     };
+
+     Channels channelsOf(const SDL_Surface *surface)
+     {
+          const SDL_PixelFormat *format = surface->format;
+          return Channels{{format->Rshift, format->Gshift, format->Bshift, format->Ashift}, format->Amask != 0};
+     }
+
+     bool surfaceSupported(const SDL_Surface *surface)
+     {
+          const SDL_PixelFormat *format = surface->format;
+          return format->BytesPerPixel == 4 && format->Rloss == 0 && format->Gloss == 0 && format->Bloss == 0 &&
+                 (format->Amask == 0 || format->Aloss == 0);
+     }
+
+     // Everything a tile needs while shading one triangle
+     struct ShadeContext
+     {
+          const SoftTriangle *triangle;
+          Channels target;
+          Channels texture;
+          int maxU, maxV; // Largest texel coordinate
+     };
+
+     ShadeContext contextFor(const SoftRaster &raster, const SoftTriangle &triangle)
+     {
+          ShadeContext context;
+          context.triangle = &triangle;
+          context.target = channelsOf(raster.target);
+          context.texture = triangle.texture != nullptr ? channelsOf(triangle.texture) : Channels{{0, 0, 0, 0}, false};
+          context.maxU = triangle.texture != nullptr ? triangle.texture->w - 1 : 0;
+          context.maxV = triangle.texture != nullptr ? triangle.texture->h - 1 : 0;
+          return context;
+     }
+
+     Uint32 fetchTexel(const SDL_Surface *texture, int u, int v)
+     {
+          return *(const Uint32 *)((const Uint8 *)texture->pixels + (size_t)v * texture->pitch + (size_t)u * 4);
+     }
+
+     float channel(Uint32 pixel, int shift)
+     {
+          return (float)((pixel >> shift) & 0xFF);
+     }
+
+     // --- Scalar ---
+     // The reference for the SSE2 kernel, with every operation in the same
+     // order so both produce the same pixels
+
+     void shadePixelScalar(const ShadeContext &context, Uint32 *pixel, Sint64 w0, Sint64 w1, Sint64 w2)
+     {
+          const SoftTriangle &t = *context.triangle;
+          const float b0 = (float)w0 * t.invArea;
+          const float b1 = (float)w1 * t.invArea;
+          const float b2 = (float)w2 * t.invArea;
+          float s[4];
+          for (int c = 0; c < 4; c++)
+          {
+               s[c] = b0 * t.color[0][c] + b1 * t.color[1][c] + b2 * t.color[2][c];
+          }
+          if (t.texture != nullptr)
+          {
+               float u = b0 * t.uv[0][0] + b1 * t.uv[1][0] + b2 * t.uv[2][0];
+               float v = b0 * t.uv[0][1] + b1 * t.uv[1][1] + b2 * t.uv[2][1];
+               u = SDL_min(SDL_max(u, 0.0f), (float)context.maxU);
+               v = SDL_min(SDL_max(v, 0.0f), (float)context.maxV);
+               Uint32 texel = fetchTexel(t.texture, (int)u, (int)v);
+               for (int c = 0; c < 3; c++)
+               {
+                    s[c] = s[c] * channel(texel, context.texture.shift[c]) * (1.0f / 255.0f);
+               }
+               s[3] = s[3] * (context.texture.alpha ? channel(texel, context.texture.shift[3]) : 255.0f) * (1.0f / 255.0f);
+          }
+
+          const Uint32 old = *pixel;
+          float d[4];
+          for (int c = 0; c < 4; c++)
+          {
+               d[c] = channel(old, context.target.shift[c]);
+          }
+          if (!context.target.alpha)
+          {
+               d[3] = 255.0f;
+          }
+          float out[4];
+          const float alpha = s[3] * (1.0f / 255.0f);
+          switch (t.blend)
+          {
+          case SDL_BLENDMODE_NONE:
+               for (int c = 0; c < 4; c++)
+               {
+                    out[c] = s[c];
+               }
+               break;
+          case SDL_BLENDMODE_ADD:
+               for (int c = 0; c < 3; c++)
+               {
+                    out[c] = d[c] + s[c] * alpha;
+               }
+               out[3] = d[3];
+               break;
+          case SDL_BLENDMODE_MOD:
+               for (int c = 0; c < 3; c++)
+               {
+                    out[c] = s[c] * d[c] * (1.0f / 255.0f);
+               }
+               out[3] = d[3];
+               break;
+          default:
+               for (int c = 0; c < 3; c++)
+               {
+                    out[c] = s[c] * alpha + d[c] * (1.0f - alpha);
+               }
+               out[3] = s[3] + d[3] * (1.0f - alpha);
+               break;
+          }
+
+          Uint32 result = 0;
+          for (int c = 0; c < (context.target.alpha ? 4 : 3); c++)
+          {
+               result |= (Uint32)(SDL_min(SDL_max(out[c], 0.0f), 255.0f) + 0.5f) << context.target.shift[c];
+          }
+          *pixel = result;
+     }
+
+     // Shade pixels [x0, x1] of row y, one at a time
+     void shadeSpanScalar(const ShadeContext &context, Uint32 *row, int y, int x0, int x1)
+     {
+          const SoftTriangle &t = *context.triangle;
+          const Sint64 py = (Sint64)y * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+          for (int x = x0; x <= x1; x++)
+          {
+               const Sint64 px = (Sint64)x * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+               Sint64 w0 = t.a[0] * px + t.b[0] * py + t.c[0];
+               Sint64 w1 = t.a[1] * px + t.b[1] * py + t.c[1];
+               Sint64 w2 = t.a[2] * px + t.b[2] * py + t.c[2];
+               if ((w0 | w1 | w2) >= 0)
+               {
+                    shadePixelScalar(context, row + x, w0, w1, w2);
+               }
+          }
+     }
+
+#ifdef SOFT_RASTER_X86
+     // --- SSE2: four pixels per step ---
+
+     inline __m128 channelSse2(__m128i pixels, int shift)
+     {
+          return _mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(pixels, _mm_cvtsi32_si128(shift)), _mm_set1_epi32(0xFF)));
+     }
+
+     inline __m128 clampSse2(__m128 value, __m128 high)
+     {
+          return _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), high);
+     }
+
+     inline __m128i packChannelSse2(__m128 value, int shift)
+     {
+          __m128i byte = _mm_cvttps_epi32(_mm_add_ps(clampSse2(value, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+          return _mm_sll_epi32(byte, _mm_cvtsi32_si128(shift));
+     }
+
+     void shadeGroupSse2(const ShadeContext &context, Uint32 *pixels, __m128i mask, __m128i w0, __m128i w1, __m128i w2)
+     {
+          const SoftTriangle &t = *context.triangle;
+          const __m128 invArea = _mm_set1_ps(t.invArea);
+          const __m128 b0 = _mm_mul_ps(_mm_cvtepi32_ps(w0), invArea);
+          const __m128 b1 = _mm_mul_ps(_mm_cvtepi32_ps(w1), invArea);
+          const __m128 b2 = _mm_mul_ps(_mm_cvtepi32_ps(w2), invArea);
+          const __m128 inv255 = _mm_set1_ps(1.0f / 255.0f);
+          const __m128 one = _mm_set1_ps(1.0f);
+
+          __m128 s[4];
+          for (int c = 0; c < 4; c++)
+          {
+               s[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b0, _mm_set1_ps(t.color[0][c])), _mm_mul_ps(b1, _mm_set1_ps(t.color[1][c]))),
+                                 _mm_mul_ps(b2, _mm_set1_ps(t.color[2][c])));
+          }
+          if (t.texture != nullptr)
+          {
+               __m128 u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b0, _mm_set1_ps(t.uv[0][0])), _mm_mul_ps(b1, _mm_set1_ps(t.uv[1][0]))),
+                                     _mm_mul_ps(b2, _mm_set1_ps(t.uv[2][0])));
+               __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b0, _mm_set1_ps(t.uv[0][1])), _mm_mul_ps(b1, _mm_set1_ps(t.uv[1][1]))),
+                                     _mm_mul_ps(b2, _mm_set1_ps(t.uv[2][1])));
+               alignas(16) int us[4];
+               alignas(16) int vs[4];
+               _mm_store_si128((__m128i *)us, _mm_cvttps_epi32(clampSse2(u, _mm_set1_ps((float)context.maxU))));
+               _mm_store_si128((__m128i *)vs, _mm_cvttps_epi32(clampSse2(v, _mm_set1_ps((float)context.maxV))));
+
+               // No gather in SSE2; uncovered lanes fetch too, always in bounds
+               __m128i texels = _mm_set_epi32((int)fetchTexel(t.texture, us[3], vs[3]), (int)fetchTexel(t.texture, us[2], vs[2]),
+                                              (int)fetchTexel(t.texture, us[1], vs[1]), (int)fetchTexel(t.texture, us[0], vs[0]));
+               for (int c = 0; c < 3; c++)
+               {
+                    s[c] = _mm_mul_ps(_mm_mul_ps(s[c], channelSse2(texels, context.texture.shift[c])), inv255);
+               }
+               __m128 texelAlpha = context.texture.alpha ? channelSse2(texels, context.texture.shift[3]) : _mm_set1_ps(255.0f);
+               s[3] = _mm_mul_ps(_mm_mul_ps(s[3], texelAlpha), inv255);
+          }
+
+          const __m128i old = _mm_loadu_si128((const __m128i *)pixels);
+          __m128 d[4];
+          for (int c = 0; c < 3; c++)
+          {
+               d[c] = channelSse2(old, context.target.shift[c]);
+          }
+          d[3] = context.target.alpha ? channelSse2(old, context.target.shift[3]) : _mm_set1_ps(255.0f);
+
+          __m128 out[4];
+          const __m128 alpha = _mm_mul_ps(s[3], inv255);
+          switch (t.blend)
+          {
+          case SDL_BLENDMODE_NONE:
+               for (int c = 0; c < 4; c++)
+               {
+                    out[c] = s[c];
+               }
+               break;
+          case SDL_BLENDMODE_ADD:
+               for (int c = 0; c < 3; c++)
+               {
+                    out[c] = _mm_add_ps(d[c], _mm_mul_ps(s[c], alpha));
+               }
+               out[3] = d[3];
+               break;
+          case SDL_BLENDMODE_MOD:
+               for (int c = 0; c < 3; c++)
+               {
+                    out[c] = _mm_mul_ps(_mm_mul_ps(s[c], d[c]), inv255);
+               }
+               out[3] = d[3];
+               break;
+          default:
+               for (int c = 0; c < 3; c++)
+               {
+                    out[c] = _mm_add_ps(_mm_mul_ps(s[c], alpha), _mm_mul_ps(d[c], _mm_sub_ps(one, alpha)));
+               }
+               out[3] = _mm_add_ps(s[3], _mm_mul_ps(d[3], _mm_sub_ps(one, alpha)));
+               break;
+          }
+
+          __m128i result = _mm_setzero_si128();
+          for (int c = 0; c < (context.target.alpha ? 4 : 3); c++)
+          {
+               result = _mm_or_si128(result, packChannelSse2(out[c], context.target.shift[c]));
+          }
+          result = _mm_or_si128(_mm_and_si128(mask, result), _mm_andnot_si128(mask, old));
+          _mm_storeu_si128((__m128i *)pixels, result);
+     }
+
+     // Shade pixels [x0, x1] of row y; only for triangles whose edge values
+     // fit in 32 bits
+     void shadeSpanSse2(const ShadeContext &context, Uint32 *row, int y, int x0, int x1)
+     {
+          const SoftTriangle &t = *context.triangle;
+          const Sint64 py = (Sint64)y * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+          const Sint64 px = (Sint64)x0 * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+          __m128i w[3];
+          __m128i step[3];
+          for (int e = 0; e < 3; e++)
+          {
+               const int start = (int)(t.a[e] * px + t.b[e] * py + t.c[e]);
+               const int dx = (int)(t.a[e] * SUBPIXEL_ONE);
+               w[e] = _mm_set_epi32(start + 3 * dx, start + 2 * dx, start + dx, start);
+               step[e] = _mm_set1_epi32(4 * dx);
+          }
+
+          int x = x0;
+          const __m128i minusOne = _mm_set1_epi32(-1);
+          for (; x + 3 <= x1; x += 4)
+          {
+               // A lane is inside when no edge value is negative
+               __m128i mask = _mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(w[0], w[1]), w[2]), minusOne);
+               if (_mm_movemask_epi8(mask) != 0)
+               {
+                    shadeGroupSse2(context, row + x, mask, w[0], w[1], w[2]);
+               }
+               for (int e = 0; e < 3; e++)
+               {
+                    w[e] = _mm_add_epi32(w[e], step[e]);
+               }
+          }
+          if (x <= x1)
+          {
+               shadeSpanScalar(context, row, y, x, x1);
+          }
+     }
+#endif
+
+     void shadeTriangle(const SoftRaster &raster, const SoftTriangle &triangle, const SDL_Rect &tile)
+     {
+          const int x0 = SDL_max(triangle.minX, tile.x);
+          const int x1 = SDL_min(triangle.maxX, tile.x + tile.w - 1);
+          const int y0 = SDL_max(triangle.minY, tile.y);
+          const int y1 = SDL_min(triangle.maxY, tile.y + tile.h - 1);
+          const ShadeContext context = contextFor(raster, triangle);
+          for (int y = y0; y <= y1; y++)
+          {
+               Uint32 *row = (Uint32 *)((Uint8 *)raster.target->pixels + (size_t)y * raster.target->pitch);
+#ifdef SOFT_RASTER_X86
+               if (raster.kernel == SOFT_RASTER_SSE2 && triangle.fits32)
+               {
+                    shadeSpanSse2(context, row, y, x0, x1);
+                    continue;
+               }
+#endif
+               shadeSpanScalar(context, row, y, x0, x1);
+          }
+     }
+
+     void shadeTileJob(void *data, int index)
+     {
+          const SoftRaster &raster = *(const SoftRaster *)data;
+          const int tile = raster.busyTiles[index];
+          const int tx = tile % raster.tilesWide;
+          const int ty = tile / raster.tilesWide;
+          const SDL_Rect bounds = {tx * raster.tileSize, ty * raster.tileSize, raster.tileSize, raster.tileSize};
+          for (int triangle : raster.bins[tile])
+          {
+               shadeTriangle(raster, raster.triangles[triangle], bounds);
+          }
+     }
+
+     // Triangle setup; false for triangles that cover no pixel centre
+     bool setupTriangle(const SoftRaster &raster, SDL_Surface *texture, SDL_BlendMode blend, const SDL_Vertex *v0,
+                        const SDL_Vertex *v1, const SDL_Vertex *v2, SoftTriangle &t)
+     {
+          const SDL_Vertex *v[3] = {v0, v1, v2};
+          Sint64 x[3], y[3];
+          for (int i = 0; i < 3; i++)
+          {
+               const SDL_FPoint &p = v[i]->position;
+               if (!(std::fabs(p.x) < MAX_COORDINATE && std::fabs(p.y) < MAX_COORDINATE))
+               {
+                    return false; // Also rejects NaN
+               }
+               x[i] = (Sint64)std::floor(p.x * SUBPIXEL_ONE + 0.5f);
+               y[i] = (Sint64)std::floor(p.y * SUBPIXEL_ONE + 0.5f);
+          }
+          Sint64 area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+          if (area == 0)
+          {
+               return false;
+          }
+          if (area < 0)
+          {
+               // Either winding draws; flip to the one the edge tests expect
+               std::swap(v[1], v[2]);
+               std::swap(x[1], x[2]);
+               std::swap(y[1], y[2]);
+               area = -area;
+          }
+
+          t.minX = (int)SDL_max((Sint64)raster.clip.x, floorDiv(SDL_min(x[0], SDL_min(x[1], x[2])), SUBPIXEL_ONE));
+          t.minY = (int)SDL_max((Sint64)raster.clip.y, floorDiv(SDL_min(y[0], SDL_min(y[1], y[2])), SUBPIXEL_ONE));
+          t.maxX = (int)SDL_min((Sint64)raster.clip.x + raster.clip.w - 1, floorDiv(SDL_max(x[0], SDL_max(x[1], x[2])), SUBPIXEL_ONE));
+          t.maxY = (int)SDL_min((Sint64)raster.clip.y + raster.clip.h - 1, floorDiv(SDL_max(y[0], SDL_max(y[1], y[2])), SUBPIXEL_ONE));
+          if (t.minX > t.maxX || t.minY > t.maxY)
+          {
+               return false;
+          }
+
+          t.fits32 = true;
+          const Sint64 limit = SDL_MAX_SINT32;
+          for (int e = 0; e < 3; e++)
+          {
+               // Edge from the next vertex to the one after, positive inside
+               const int from = (e + 1) % 3;
+               const int to = (e + 2) % 3;
+               t.a[e] = -(y[to] - y[from]);
+               t.b[e] = x[to] - x[from];
+               t.c[e] = -t.a[e] * x[from] - t.b[e] * y[from];
+
+               // Top-left rule: pixel centres exactly on an edge belong to the
+               // triangle to its right, or below it when it is horizontal
+               if (!(t.a[e] > 0 || (t.a[e] == 0 && t.b[e] > 0)))
+               {
+                    t.c[e] -= 1;
+               }
+
+               // w is linear, so its extremes over the bounds are at the
+               // corners; the SSE2 loop also steps four pixels at once
+               const Sint64 margin = 8 * SUBPIXEL_ONE * (t.a[e] < 0 ? -t.a[e] : t.a[e]);
+               for (int corner = 0; corner < 4; corner++)
+               {
+                    Sint64 px = (Sint64)((corner & 1) ? t.maxX : t.minX) * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+                    Sint64 py = (Sint64)((corner & 2) ? t.maxY : t.minY) * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+                    Sint64 w = t.a[e] * px + t.b[e] * py + t.c[e];
+                    t.fits32 = t.fits32 && w < limit - margin && w > -limit + margin;
+               }
+          }
+
+          t.invArea = 1.0f / (float)area;
+          for (int i = 0; i < 3; i++)
+          {
+               const SDL_Color &color = v[i]->color;
+               t.color[i][0] = color.r;
+               t.color[i][1] = color.g;
+               t.color[i][2] = color.b;
+               t.color[i][3] = color.a;
+               t.uv[i][0] = texture != nullptr ? v[i]->tex_coord.x * texture->w : 0.0f;
+               t.uv[i][1] = texture != nullptr ? v[i]->tex_coord.y * texture->h : 0.0f;
+          }
+          t.texture = texture;
+          t.blend = blend;
+          return true;
+     }
+}
+
+bool softRasterKernelSupported(SoftRasterKernel kernel)
+{
+     switch (kernel)
+     {
+     case SOFT_RASTER_AUTO:
+     case SOFT_RASTER_SCALAR:
+          return true;
+     case SOFT_RASTER_SSE2:
+#ifdef SOFT_RASTER_X86
+          return cpuHasSse2();
+#else
+          return false;
+#endif
+     }
+     return false;
+}
+
+const char *softRasterKernelName(SoftRasterKernel kernel)
+{
+     switch (kernel)
+     {
+     case SOFT_RASTER_SCALAR:
+          return "scalar";
+     case SOFT_RASTER_SSE2:
+          return "sse2";
+     default:
+          return "auto";
+     }
+}
+
+void softRasterInit(SoftRaster &raster, JobSystem *jobs, SoftRasterKernel kernel, int tileSize)
+{
+     if (kernel == SOFT_RASTER_AUTO || !softRasterKernelSupported(kernel))
+     {
+          kernel = softRasterKernelSupported(SOFT_RASTER_SSE2) ? SOFT_RASTER_SSE2 : SOFT_RASTER_SCALAR;
+     }
+     raster.jobs = jobs;
+     raster.kernel = kernel;
+     raster.tileSize = SDL_max(4, tileSize / 4 * 4);
+     raster.target = nullptr;
+     raster.clip = SDL_Rect{0, 0, 0, 0};
+     raster.tilesWide = 0;
+     raster.tilesHigh = 0;
+     raster.triangles.clear();
+     raster.bins.clear();
+     raster.busyTiles.clear();
+     raster.trianglesDrawn = 0;
+     raster.tilesShaded = 0;
+}
+
+bool softRasterBegin(SoftRaster &raster, SDL_Surface *target)
+{
+     if (target == nullptr || !surfaceSupported(target))
+     {
+          SDL_SetError("Software raster targets must be 32-bit with 8-bit channels");
+          raster.target = nullptr;
+          return false;
+     }
+     raster.target = target;
+     raster.clip = SDL_Rect{0, 0, target->w, target->h};
+     raster.tilesWide = (target->w + raster.tileSize - 1) / raster.tileSize;
+     raster.tilesHigh = (target->h + raster.tileSize - 1) / raster.tileSize;
+     raster.triangles.clear();
+     raster.bins.resize((size_t)raster.tilesWide * raster.tilesHigh);
+     for (std::vector<int> &bin : raster.bins)
+     {
+          bin.clear();
+     }
+     raster.busyTiles.clear();
+     raster.trianglesDrawn = 0;
+     raster.tilesShaded = 0;
+     return true;
+}
+
+void softRasterSetClipRect(SoftRaster &raster, const SDL_Rect *rect)
+{
+     if (raster.target == nullptr)
+     {
+          return;
+     }
+     const SDL_Rect bounds = {0, 0, raster.target->w, raster.target->h};
+     if (rect == nullptr || !SDL_IntersectRect(rect, &bounds, &raster.clip))
+     {
+          raster.clip = rect == nullptr ? bounds : SDL_Rect{0, 0, 0, 0};
+     }
+}
+
+int softRasterGeometry(SoftRaster &raster, SDL_Surface *texture, const SDL_Vertex *vertices, int numVertices,
+                       const int *indices, int numIndices, SDL_BlendMode blend)
+{
+     if (raster.target == nullptr)
+     {
+          return SDL_SetError("softRasterBegin() has not been called");
+     }
+     if (texture != nullptr && (!surfaceSupported(texture) || texture->w <= 0 || texture->h <= 0))
+     {
+          return SDL_SetError("Software raster textures must be 32-bit with 8-bit channels");
+     }
+     const int count = indices != nullptr ? numIndices : numVertices;
+     if (vertices == nullptr || count % 3 != 0)
+     {
+          return SDL_SetError("Geometry needs a multiple of 3 vertices or indices");
+     }
+
+     for (int i = 0; i < count; i += 3)
+     {
+          int corner[3] = {i, i + 1, i + 2};
+          if (indices != nullptr)
+          {
+               for (int k = 0; k < 3; k++)
+               {
+                    corner[k] = indices[i + k];
+                    if (corner[k] < 0 || corner[k] >= numVertices)
+                    {
+                         return SDL_SetError("Geometry index %d out of range", corner[k]);
+                    }
+               }
+          }
+          SoftTriangle triangle;
+          if (!setupTriangle(raster, texture, blend, &vertices[corner[0]], &vertices[corner[1]], &vertices[corner[2]], triangle))
+          {
+               continue;
+          }
+
+          // Bin by bounds; tiles the triangle only grazes find no pixels
+          const int index = (int)raster.triangles.size();
+          raster.triangles.push_back(triangle);
+          for (int ty = triangle.minY / raster.tileSize; ty <= triangle.maxY / raster.tileSize; ty++)
+          {
+               for (int tx = triangle.minX / raster.tileSize; tx <= triangle.maxX / raster.tileSize; tx++)
+               {
+                    const int tile = ty * raster.tilesWide + tx;
+                    if (raster.bins[tile].empty())
+                    {
+                         raster.busyTiles.push_back(tile);
+                    }
+                    raster.bins[tile].push_back(index);
+               }
+          }
+     }
+     return 0;
+}
+
+void softRasterFlush(SoftRaster &raster)
+{
+     if (raster.target == nullptr || raster.busyTiles.empty())
+     {
+          raster.triangles.clear();
+          return;
+     }
+     const int tileCount = (int)raster.busyTiles.size();
+     if (raster.jobs != nullptr && tileCount > 1)
+     {
+          JobCounter counter = {};
+          jobSystemSubmitRange(*raster.jobs, shadeTileJob, &raster, tileCount, &counter);
+          jobSystemWait(*raster.jobs, counter);
+     }
+     else
+     {
+          for (int i = 0; i < tileCount; i++)
+          {
+               shadeTileJob(&raster, i);
+          }
+     }
+
+     raster.trianglesDrawn += (int)raster.triangles.size();
+     raster.tilesShaded += tileCount;
+     for (int tile : raster.busyTiles)
+     {
+          raster.bins[tile].clear();
+     }
+     raster.busyTiles.clear();
+     raster.triangles.clear();
+}
@@ -0,0 +1,87 @@
+// Description:
+// Tiled software rasterizer for SDL_RenderGeometry-style triangle lists,
+// for machines with no GPU (VMs, remote desktops, kiosks) where SDL's
+// software renderer walks every triangle one pixel at a time.
+//
+// Drawing happens in two phases. softRasterGeometry() only sets triangles
+// up and bins them into the screen tiles their bounds touch. Then
+// softRasterFlush() shades the tiles in parallel on the JobSystem. Each
+// tile draws its own triangles in submission order, and tiles never
+// share pixels, so the output is the same for any thread count. Inside a
+// tile the SSE2 kernel tests and shades four pixels per step: integer
+// edge functions with 4 bits of subpixel precision and a top-left fill
+// rule, so triangles that share an edge never drop or double a pixel.
+//
+// The target and textures are 32-bit surfaces with 8-bit channels (the
+// window surface from SDL_GetWindowSurface, ARGB8888 textures). Textures
+// use nearest sampling with clamped coordinates, modulated by the vertex
+// colour, and the blend modes are NONE, BLEND, ADD and MOD, as in SDL.
+// =============================================================================
+
+#ifndef SOFT_RASTER_H
+#define SOFT_RASTER_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "job_system.h"
+
+enum SoftRasterKernel
+{
+     SOFT_RASTER_AUTO,
+     SOFT_RASTER_SCALAR,
+     SOFT_RASTER_SSE2
+};
+
+// A set-up triangle: edge functions as w = A * px + B * py + C over
+// pixel centres in 1/16 pixel units, with the fill rule folded into C
+struct SoftTriangle
+{
+     int minX, minY, maxX, maxY; // Inclusive pixel bounds, clipped
+     Sint64 a[3], b[3], c[3];    // One edge per vertex, opposite it
+     bool fits32;                // Every w inside the bounds fits an int32
+     float invArea;
+     float color[3][4];          // r, g, b, a per vertex, 0-255
+     float uv[3][2];             // Texel coordinates per vertex
+     SDL_Surface *texture;       // nullptr for solid colour
+     SDL_BlendMode blend;
+};
+
+struct SoftRaster
+{
+     JobSystem *jobs; // nullptr shades on the calling thread
+     SoftRasterKernel kernel;
+     int tileSize;    // Edge of a tile in pixels, a multiple of 4
+
+     SDL_Surface *target;
+     SDL_Rect clip;
+     int tilesWide, tilesHigh;
+     std::vector<SoftTriangle> triangles;
+     std::vector<std::vector<int>> bins; // Triangle indices per tile
+     std::vector<int> busyTiles;         // Tiles with a non-empty bin
+
+     int trianglesDrawn; // Since softRasterBegin()
+     int tilesShaded;
+};
+
+bool softRasterKernelSupported(SoftRasterKernel kernel);
+const char *softRasterKernelName(SoftRasterKernel kernel);
+
+void softRasterInit(SoftRaster &raster, JobSystem *jobs, SoftRasterKernel kernel = SOFT_RASTER_AUTO, int tileSize = 64);
+
+// Start a frame into `target` (locked by the caller if SDL_MUSTLOCK)
+bool softRasterBegin(SoftRaster &raster, SDL_Surface *target);
+
+// Limit drawing to `rect`, nullptr for the whole target; applies to
+// triangles submitted afterwards
+void softRasterSetClipRect(SoftRaster &raster, const SDL_Rect *rect);
+
+// Same contract as SDL_RenderGeometry, with `texture` a surface (or
+// nullptr) that must stay valid until softRasterFlush()
+int softRasterGeometry(SoftRaster &raster, SDL_Surface *texture, const SDL_Vertex *vertices, int numVertices,
+                       const int *indices, int numIndices, SDL_BlendMode blend = SDL_BLENDMODE_BLEND);
+
+// Shade every binned triangle into the target and empty the bins
+void softRasterFlush(SoftRaster &raster);
+
+#endif // SOFT_RASTER_H
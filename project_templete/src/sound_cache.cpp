@@ -0,0 +1,274 @@
+#include "sound_cache.h"
+
+#include <iostream>
+
+#include "memory_tags.h"
+#include "native_sound.h"
+
+namespace
+{
+     // FNV-1a over the file bytes
+     Uint64 hashBytes(const Uint8 *data, size_t size)
+     {
+          Uint64 hash = 14695981039346656037ull;
+          for (size_t i = 0; i < size; i++)
+          {
+               hash = (hash ^ data[i]) * 1099511628211ull;
+          }
+          return hash;
+     }
+
+     void addRef(SoundCache &cache, int id)
+     {
+          SoundEntry &entry = cache.entries[id];
+          if (entry.refs == 0 && !entry.pinned)
+          {
+               cache.lru.erase(entry.lruPosition);
+          }
+          entry.refs++;
+     }
+
+     void makeEvictable(SoundCache &cache, int id)
+     {
+          SoundEntry &entry = cache.entries[id];
+          entry.lruPosition = cache.lru.insert(cache.lru.end(), id);
+     }
+
+     void freeEntry(SoundCache &cache, int id)
+     {
+          SoundEntry &entry = cache.entries[id];
+          for (const std::string &path : entry.paths)
+          {
+               cache.byPath.erase(path);
+          }
+          cache.byContent.erase(entry.contentHash);
+          cache.byChunk.erase(entry.chunk);
+          Mix_FreeChunk(entry.chunk);
+          cache.usedBytes -= entry.bytes;
+
+          entry.chunk = nullptr;
+          entry.paths.clear();
+          entry.refs = 0;
+          entry.pinned = false;
+          cache.freeSlots.push_back(id);
+     }
+
+     // Evict unreferenced sounds until the budget holds again; referenced ones
+     // may keep the cache over budget
+     void trim(SoundCache &cache)
+     {
+          while (cache.usedBytes > cache.budgetBytes && !cache.lru.empty())
+          {
+               int id = cache.lru.front();
+               cache.lru.pop_front();
+               freeEntry(cache, id);
+               cache.stats.evictions++;
+          }
+     }
+
+     // Find or decode the entry for `path` without taking a reference
+     int lookup(SoundCache &cache, const std::string &path)
+     {
+          auto byPath = cache.byPath.find(path);
+          if (byPath != cache.byPath.end())
+          {
+               cache.stats.pathHits++;
+               return byPath->second;
+          }
+
+          size_t size = 0;
+          Uint8 *data = (Uint8 *)SDL_LoadFile(path.c_str(), &size);
+          if (data == nullptr)
+          {
+               std::cerr << "Unable to read sound " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+               return -1;
+          }
+
+          Uint64 hash = hashBytes(data, size);
+          auto byContent = cache.byContent.find(hash);
+          if (byContent != cache.byContent.end())
+          {
+               SDL_free(data);
+               cache.stats.dedupHits++;
+               cache.entries[byContent->second].paths.push_back(path);
+               cache.byPath[path] = byContent->second;
+               return byContent->second;
+          }
+
+          Mix_Chunk *chunk;
+          {
+               MemoryTagScope tag(MEMORY_TAG_MIXER);
+               chunk = nativeLoadChunk(SDL_RWFromConstMem(data, (int)size), 1);
+          }
+          SDL_free(data);
+          if (chunk == nullptr)
+          {
+               std::cerr << "Unable to decode sound " << path << "! SDL_mixer Error: " << Mix_GetError() << std::endl;
+               return -1;
+          }
+          cache.stats.decodes++;
+
+          int id;
+          if (!cache.freeSlots.empty())
+          {
+               id = cache.freeSlots.back();
+               cache.freeSlots.pop_back();
+          }
+          else
+          {
+               id = (int)cache.entries.size();
+               cache.entries.emplace_back();
+          }
+          SoundEntry &entry = cache.entries[id];
+          entry.chunk = chunk;
+          entry.contentHash = hash;
+          entry.bytes = sizeof(Mix_Chunk) + chunk->alen;
+          entry.refs = 0;
+          entry.pinned = false;
+          entry.paths.assign(1, path);
+          cache.byPath[path] = id;
+          cache.byContent[hash] = id;
+          cache.byChunk[chunk] = id;
+          cache.usedBytes += entry.bytes;
+
+          // New entries start out evictable; the caller references them next
+          makeEvictable(cache, id);
+          return id;
+     }
+}
+
+void soundCacheInit(SoundCache &cache, size_t budgetBytes)
+{
+     cache.budgetBytes = budgetBytes;
+     cache.usedBytes = 0;
+     cache.entries.clear();
+     cache.freeSlots.clear();
+     cache.byPath.clear();
+     cache.byContent.clear();
+     cache.byChunk.clear();
+     cache.lru.clear();
+     SDL_zero(cache.stats);
+}
+
+Mix_Chunk *soundCacheAcquire(SoundCache &cache, const std::string &path)
+{
+     int id = lookup(cache, path);
+     if (id < 0)
+     {
+          return nullptr;
+     }
+     addRef(cache, id);
+     Mix_Chunk *chunk = cache.entries[id].chunk;
+     trim(cache);
+     return chunk;
+}
+
+void soundCacheRelease(SoundCache &cache, const Mix_Chunk *chunk)
+{
+     auto it = cache.byChunk.find(chunk);
+     if (it == cache.byChunk.end() || cache.entries[it->second].refs == 0)
+     {
+          return;
+     }
+     SoundEntry &entry = cache.entries[it->second];
+     entry.refs--;
+     if (entry.refs == 0 && !entry.pinned)
+     {
+          makeEvictable(cache, it->second);
+          trim(cache);
+     }
+}
+
+int soundCachePreload(SoundCache &cache, const std::string &manifestPath)
+{
+     size_t size = 0;
+     char *text = (char *)SDL_LoadFile(manifestPath.c_str(), &size);
+     if (text == nullptr)
+     {
+          std::cerr << "Unable to read sound manifest " << manifestPath << "! SDL Error: " << SDL_GetError()
+                    << std::endl;
+          return -1;
+     }
+
+     int failed = 0;
+     std::string manifest(text, size);
+     SDL_free(text);
+     size_t start = 0;
+     while (start < manifest.size())
+     {
+          size_t end = manifest.find('\n', start);
+          if (end == std::string::npos)
+          {
+               end = manifest.size();
+          }
+          std::string line = manifest.substr(start, end - start);
+          start = end + 1;
+
+          size_t comment = line.find('#');
+          if (comment != std::string::npos)
+          {
+               line.erase(comment);
+          }
+          size_t first = line.find_first_not_of(" \t\r");
+          size_t last = line.find_last_not_of(" \t\r");
+          if (first == std::string::npos)
+          {
+               continue;
+          }
+          line = line.substr(first, last - first + 1);
+
+          int id = lookup(cache, line);
+          if (id < 0)
+          {
+               failed++;
+               continue;
+          }
+          SoundEntry &entry = cache.entries[id];
+          if (!entry.pinned)
+          {
+               if (entry.refs == 0)
+               {
+                    cache.lru.erase(entry.lruPosition);
+               }
+               entry.pinned = true;
+          }
+     }
+     trim(cache);
+     return failed;
+}
+
+Mix_Chunk *soundCacheFindPinned(const SoundCache &cache, const std::string &path)
+{
+     auto it = cache.byPath.find(path);
+     if (it == cache.byPath.end() || !cache.entries[it->second].pinned)
+     {
+          return nullptr;
+     }
+     return cache.entries[it->second].chunk;
+}
+
+void soundCacheUnpinAll(SoundCache &cache)
+{
+     for (int id = 0; id < (int)cache.entries.size(); id++)
+     {
+          SoundEntry &entry = cache.entries[id];
+          if (entry.chunk != nullptr && entry.pinned)
+          {
+               entry.pinned = false;
+               if (entry.refs == 0)
+               {
+                    makeEvictable(cache, id);
+               }
+          }
+     }
+     trim(cache);
+}
+
+void soundCacheDestroy(SoundCache &cache)
+{
+     for (SoundEntry &entry : cache.entries)
+     {
+          Mix_FreeChunk(entry.chunk);
+     }
+     soundCacheInit(cache, cache.budgetBytes);
+}
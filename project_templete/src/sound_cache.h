@@ -0,0 +1,79 @@
+// Description:
+// Shared cache of decoded sound effects. Mix_LoadWAV decodes and allocates
+// a new Mix_Chunk on every call; the cache decodes each sound once and
+// hands out the same chunk, reference counted, to every caller.
+//
+// Entries are found by path first and, on a path miss, by a hash of the
+// file contents, so the same sound shipped under several names is decoded
+// and stored once. Unreferenced chunks stay resident until the memory budget
+// is exceeded and are then evicted least recently used first. Sounds listed
+// in a preload manifest are decoded up front and pinned, so the hot set is
+// never decoded on the gameplay path.
+//
+// A released chunk may be freed at the next acquire, so release only once
+// the sound has stopped playing on every channel.
+// =============================================================================
+
+#ifndef SOUND_CACHE_H
+#define SOUND_CACHE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct SoundEntry
+{
+     Mix_Chunk *chunk; // nullptr for a free slot
+     Uint64 contentHash;
+     size_t bytes;
+     int refs;
+     bool pinned;
+     std::vector<std::string> paths; // Every path that resolved to this sound
+     std::list<int>::iterator lruPosition; // Valid while refs == 0 and unpinned
+};
+
+struct SoundCacheStats
+{
+     int pathHits;   // Acquired by path without touching the disk
+     int dedupHits;  // Read from disk but matched already decoded contents
+     int decodes;
+     int evictions;
+};
+
+struct SoundCache
+{
+     size_t budgetBytes;
+     size_t usedBytes;
+     std::vector<SoundEntry> entries;
+     std::vector<int> freeSlots;
+     std::unordered_map<std::string, int> byPath;
+     std::unordered_map<Uint64, int> byContent;
+     std::unordered_map<const Mix_Chunk *, int> byChunk;
+     std::list<int> lru; // Evictable entries, least recently used first
+     SoundCacheStats stats;
+};
+
+void soundCacheInit(SoundCache &cache, size_t budgetBytes);
+
+// Get the decoded sound for `path`, loading it on a miss; nullptr on error.
+// Each successful acquire must be paired with a release.
+Mix_Chunk *soundCacheAcquire(SoundCache &cache, const std::string &path);
+void soundCacheRelease(SoundCache &cache, const Mix_Chunk *chunk);
+
+// Decode and pin every sound listed in a manifest (one path per line, '#'
+// starts a comment). Returns how many sounds failed to load.
+int soundCachePreload(SoundCache &cache, const std::string &manifestPath);
+
+// Pinned sound for `path`, or nullptr if it was not preloaded
+Mix_Chunk *soundCacheFindPinned(const SoundCache &cache, const std::string &path);
+
+// Make pinned sounds evictable again once no longer referenced
+void soundCacheUnpinAll(SoundCache &cache);
+
+// Free every chunk; outstanding references become invalid
+void soundCacheDestroy(SoundCache &cache);
+
+#endif // SOUND_CACHE_H
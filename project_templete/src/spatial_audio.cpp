@@ -0,0 +1,770 @@
+#include "spatial_audio.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <iostream>
+
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define SPATIAL_AUDIO_X86 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SPATIAL_AUDIO_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+     const int B = SPATIAL_BLOCK_FRAMES;
+     const int N = SPATIAL_FFT_SIZE;
+     const double SPATIAL_PI = 3.14159265358979323846;
+
+     // Spherical head: radius in meters, speed of sound in m/s
+     const double HEAD_RADIUS = 0.0875;
+     const double SPEED_OF_SOUND = 343.0;
+     const int SPHERICAL_IR_LENGTH = 2 * B;
+
+     // --- Scalar kernels ---
+
+     void macScalar(float *sumRe, float *sumIm, const float *xRe, const float *xIm, const float *gRe, const float *gIm,
+                    int count)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               sumRe[i] += xRe[i] * gRe[i] - xIm[i] * gIm[i];
+               sumIm[i] += xRe[i] * gIm[i] + xIm[i] * gRe[i];
+          }
+     }
+
+     void butterfliesScalar(float *aRe, float *aIm, float *bRe, float *bIm, const float *wRe, const float *wIm,
+                            int count)
+     {
+          for (int i = 0; i < count; i++)
+          {
+               const float tRe = bRe[i] * wRe[i] - bIm[i] * wIm[i];
+               const float tIm = bRe[i] * wIm[i] + bIm[i] * wRe[i];
+               bRe[i] = aRe[i] - tRe;
+               bIm[i] = aIm[i] - tIm;
+               aRe[i] += tRe;
+               aIm[i] += tIm;
+          }
+     }
+
+#ifdef SPATIAL_AUDIO_X86
+     // --- SSE2: 4 bins per step ---
+
+     void macSse2(float *sumRe, float *sumIm, const float *xRe, const float *xIm, const float *gRe, const float *gIm,
+                  int count)
+     {
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               const __m128 xr = _mm_loadu_ps(xRe + i), xi = _mm_loadu_ps(xIm + i);
+               const __m128 gr = _mm_loadu_ps(gRe + i), gi = _mm_loadu_ps(gIm + i);
+               __m128 re = _mm_sub_ps(_mm_mul_ps(xr, gr), _mm_mul_ps(xi, gi));
+               __m128 im = _mm_add_ps(_mm_mul_ps(xr, gi), _mm_mul_ps(xi, gr));
+               _mm_storeu_ps(sumRe + i, _mm_add_ps(_mm_loadu_ps(sumRe + i), re));
+               _mm_storeu_ps(sumIm + i, _mm_add_ps(_mm_loadu_ps(sumIm + i), im));
+          }
+          macScalar(sumRe + i, sumIm + i, xRe + i, xIm + i, gRe + i, gIm + i, count - i);
+     }
+
+     void butterfliesSse2(float *aRe, float *aIm, float *bRe, float *bIm, const float *wRe, const float *wIm,
+                          int count)
+     {
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               const __m128 br = _mm_loadu_ps(bRe + i), bi = _mm_loadu_ps(bIm + i);
+               const __m128 wr = _mm_loadu_ps(wRe + i), wi = _mm_loadu_ps(wIm + i);
+               const __m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+               const __m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+               const __m128 ar = _mm_loadu_ps(aRe + i), ai = _mm_loadu_ps(aIm + i);
+               _mm_storeu_ps(bRe + i, _mm_sub_ps(ar, tr));
+               _mm_storeu_ps(bIm + i, _mm_sub_ps(ai, ti));
+               _mm_storeu_ps(aRe + i, _mm_add_ps(ar, tr));
+               _mm_storeu_ps(aIm + i, _mm_add_ps(ai, ti));
+          }
+          butterfliesScalar(aRe + i, aIm + i, bRe + i, bIm + i, wRe + i, wIm + i, count - i);
+     }
+#endif
+
+#ifdef SPATIAL_AUDIO_NEON
+     // --- NEON: 4 bins per step ---
+
+     void macNeon(float *sumRe, float *sumIm, const float *xRe, const float *xIm, const float *gRe, const float *gIm,
+                  int count)
+     {
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               const float32x4_t xr = vld1q_f32(xRe + i), xi = vld1q_f32(xIm + i);
+               const float32x4_t gr = vld1q_f32(gRe + i), gi = vld1q_f32(gIm + i);
+               float32x4_t re = vmlsq_f32(vmlaq_f32(vld1q_f32(sumRe + i), xr, gr), xi, gi);
+               float32x4_t im = vmlaq_f32(vmlaq_f32(vld1q_f32(sumIm + i), xr, gi), xi, gr);
+               vst1q_f32(sumRe + i, re);
+               vst1q_f32(sumIm + i, im);
+          }
+          macScalar(sumRe + i, sumIm + i, xRe + i, xIm + i, gRe + i, gIm + i, count - i);
+     }
+
+     void butterfliesNeon(float *aRe, float *aIm, float *bRe, float *bIm, const float *wRe, const float *wIm,
+                          int count)
+     {
+          int i = 0;
+          for (; i + 4 <= count; i += 4)
+          {
+               const float32x4_t br = vld1q_f32(bRe + i), bi = vld1q_f32(bIm + i);
+               const float32x4_t wr = vld1q_f32(wRe + i), wi = vld1q_f32(wIm + i);
+               const float32x4_t tr = vmlsq_f32(vmulq_f32(br, wr), bi, wi);
+               const float32x4_t ti = vmlaq_f32(vmulq_f32(br, wi), bi, wr);
+               const float32x4_t ar = vld1q_f32(aRe + i), ai = vld1q_f32(aIm + i);
+               vst1q_f32(bRe + i, vsubq_f32(ar, tr));
+               vst1q_f32(bIm + i, vsubq_f32(ai, ti));
+               vst1q_f32(aRe + i, vaddq_f32(ar, tr));
+               vst1q_f32(aIm + i, vaddq_f32(ai, ti));
+          }
+          butterfliesScalar(aRe + i, aIm + i, bRe + i, bIm + i, wRe + i, wIm + i, count - i);
+     }
+#endif
+
+     // --- FFT ---
+
+     // Forward transform of N points in place; the inverse conjugates
+     // around it and leaves the 1/N to the caller
+     void transform(const SpatialAudio &engine, float *re, float *im, bool inverse)
+     {
+          for (int i = 0; i < N; i++)
+          {
+               const int j = engine.bitReverse[i];
+               if (j > i)
+               {
+                    std::swap(re[i], re[j]);
+                    std::swap(im[i], im[j]);
+               }
+          }
+          if (inverse)
+          {
+               for (int i = 0; i < N; i++)
+               {
+                    im[i] = -im[i];
+               }
+          }
+          for (int half = 1; half < N; half *= 2)
+          {
+               // A stage's twiddles start at half - 1; short stages stay scalar
+               const float *wRe = &engine.twiddleRe[half - 1];
+               const float *wIm = &engine.twiddleIm[half - 1];
+               SpatialButterflyFunc butterflies = half >= 4 ? engine.butterflies : butterfliesScalar;
+               for (int start = 0; start < N; start += 2 * half)
+               {
+                    butterflies(re + start, im + start, re + start + half, im + start + half, wRe, wIm, half);
+               }
+          }
+          if (inverse)
+          {
+               for (int i = 0; i < N; i++)
+               {
+                    im[i] = -im[i];
+               }
+          }
+     }
+
+     // Table building runs once, in double precision
+     void transformDouble(std::vector<std::complex<double>> &data, bool inverse)
+     {
+          const int size = (int)data.size();
+          for (int i = 1, j = 0; i < size; i++)
+          {
+               int bit = size >> 1;
+               for (; j & bit; bit >>= 1)
+               {
+                    j ^= bit;
+               }
+               j ^= bit;
+               if (i < j)
+               {
+                    std::swap(data[i], data[j]);
+               }
+          }
+          for (int len = 2; len <= size; len <<= 1)
+          {
+               const double angle = (inverse ? 2.0 : -2.0) * SPATIAL_PI / len;
+               const std::complex<double> step(std::cos(angle), std::sin(angle));
+               for (int start = 0; start < size; start += len)
+               {
+                    std::complex<double> w(1.0, 0.0);
+                    for (int k = 0; k < len / 2; k++)
+                    {
+                         const std::complex<double> t = data[start + k + len / 2] * w;
+                         data[start + k + len / 2] = data[start + k] - t;
+                         data[start + k] += t;
+                         w *= step;
+                    }
+               }
+          }
+          if (inverse)
+          {
+               for (std::complex<double> &value : data)
+               {
+                    value /= size;
+               }
+          }
+     }
+
+     // --- Spherical head model (Brown and Duda) ---
+
+     // Response of the ear at `incidence` radians from the source
+     void sphericalEar(double incidence, int rate, float *ir)
+     {
+          const int size = SPHERICAL_IR_LENGTH;
+          const double w0 = SPEED_OF_SOUND / HEAD_RADIUS;
+          // Head shadow: bright facing the ear, darker round the back
+          const double alpha = 1.05 + 0.95 * std::cos(incidence * 180.0 / 150.0);
+          // Extra path round the head, plus a causal offset
+          double delay = incidence < SPATIAL_PI / 2 ? -HEAD_RADIUS / SPEED_OF_SOUND * std::cos(incidence)
+                                                    : HEAD_RADIUS / SPEED_OF_SOUND * (incidence - SPATIAL_PI / 2);
+          delay += HEAD_RADIUS / SPEED_OF_SOUND + 4.0 / rate;
+
+          std::vector<std::complex<double>> spectrum(size);
+          for (int k = 0; k <= size / 2; k++)
+          {
+               const double w = 2.0 * SPATIAL_PI * k * rate / size;
+               const std::complex<double> shadow = std::complex<double>(1.0, alpha * w / (2.0 * w0)) /
+                                                   std::complex<double>(1.0, w / (2.0 * w0));
+               const std::complex<double> value = shadow * std::polar(1.0, -w * delay);
+               spectrum[k] = value;
+               if (k > 0 && k < size / 2)
+               {
+                    spectrum[size - k] = std::conj(value);
+               }
+          }
+          spectrum[size / 2] = std::complex<double>(spectrum[size / 2].real(), 0.0);
+          transformDouble(spectrum, true);
+          for (int i = 0; i < size; i++)
+          {
+               // Fade the last quarter so the circular response ends cleanly
+               const double fade = i < size * 3 / 4 ? 1.0 : 0.5 + 0.5 * std::cos(SPATIAL_PI * (i - size * 3 / 4) / (size / 4));
+               ir[i] = (float)(spectrum[i].real() * fade);
+          }
+     }
+
+     SpatialVec3 sub(SpatialVec3 a, SpatialVec3 b)
+     {
+          return {a.x - b.x, a.y - b.y, a.z - b.z};
+     }
+
+     float dot(SpatialVec3 a, SpatialVec3 b)
+     {
+          return a.x * b.x + a.y * b.y + a.z * b.z;
+     }
+
+     SpatialVec3 cross(SpatialVec3 a, SpatialVec3 b)
+     {
+          return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+     }
+
+     SpatialVec3 normalize(SpatialVec3 v)
+     {
+          const float length = SDL_sqrtf(dot(v, v));
+          return length > 0.0f ? SpatialVec3{v.x / length, v.y / length, v.z / length} : v;
+     }
+
+     int directionIndex(const HrtfSet &set, float azimuthDegrees, float elevationDegrees)
+     {
+          int azimuth = (int)SDL_floorf(azimuthDegrees / 360.0f * set.azimuths + 0.5f) % set.azimuths;
+          if (azimuth < 0)
+          {
+               azimuth += set.azimuths;
+          }
+          const int elevation = (int)SDL_floorf((elevationDegrees - set.elevationMin) / set.elevationStep + 0.5f);
+          return SDL_clamp(elevation, 0, set.elevations - 1) * set.azimuths + azimuth;
+     }
+
+     // Listener-relative parameters of `source`, in HRTF mode when asked
+     SpatialParams computeParams(SpatialAudio &engine, SpatialSource &source, bool hrtf)
+     {
+          const SpatialVec3 forward = normalize(engine.listenerForward);
+          const SpatialVec3 right = normalize(cross(forward, engine.listenerUp));
+          const SpatialVec3 up = cross(right, forward);
+          const SpatialVec3 offset = sub(source.position, engine.listenerPosition);
+          const float x = dot(offset, right), y = dot(offset, up), z = dot(offset, forward);
+          const float distance = SDL_sqrtf(x * x + y * y + z * z);
+          source.audibleGain = source.volume * engine.referenceDistance / SDL_max(distance, engine.referenceDistance);
+
+          const float azimuth = distance > 0.0f ? SDL_atan2f(x, z) : 0.0f;
+          const float elevation = distance > 0.0f ? SDL_atan2f(y, SDL_sqrtf(x * x + z * z)) : 0.0f;
+          SpatialParams params;
+          params.hrtf = hrtf && distance <= engine.lodDistance;
+          params.direction = directionIndex(*engine.hrtf, azimuth * (float)(180.0 / SPATIAL_PI), elevation * (float)(180.0 / SPATIAL_PI));
+          if (params.hrtf)
+          {
+               params.gainLeft = source.audibleGain;
+               params.gainRight = source.audibleGain;
+          }
+          else
+          {
+               // Equal-power pan on the left-right axis; behind folds to the front
+               const float pan = (SDL_sinf(azimuth) + 1.0f) * (float)(SPATIAL_PI / 4.0);
+               params.gainLeft = source.audibleGain * SDL_cosf(pan);
+               params.gainRight = source.audibleGain * SDL_sinf(pan);
+          }
+          return params;
+     }
+
+     void resetSource(SpatialSource &source)
+     {
+          source.started = false;
+          source.inCount = 0;
+          SDL_memset(source.input, 0, sizeof(source.input));
+          SDL_memset(source.output, 0, sizeof(source.output));
+          SDL_memset(source.window, 0, sizeof(source.window));
+          std::fill(source.historyRe.begin(), source.historyRe.end(), 0.0f);
+          std::fill(source.historyIm.begin(), source.historyIm.end(), 0.0f);
+          source.historyHead = 0;
+     }
+
+     // Ungained block for `params` into left/right
+     void renderBlock(SpatialAudio &engine, SpatialSource &source, const SpatialParams &params, float *left,
+                      float *right)
+     {
+          if (!params.hrtf)
+          {
+               std::memcpy(left, source.input, sizeof(source.input));
+               std::memcpy(right, source.input, sizeof(source.input));
+               return;
+          }
+          const HrtfSet &set = *engine.hrtf;
+          std::fill(engine.scratchRe, engine.scratchRe + N, 0.0f);
+          std::fill(engine.scratchIm, engine.scratchIm + N, 0.0f);
+          for (int p = 0; p < set.partitions; p++)
+          {
+               // Newest input against the first partition, older against later ones
+               const int slot = (source.historyHead - p + set.partitions) % set.partitions;
+               const size_t filter = ((size_t)params.direction * set.partitions + p) * N;
+               engine.mac(engine.scratchRe, engine.scratchIm, &source.historyRe[(size_t)slot * N],
+                          &source.historyIm[(size_t)slot * N], &set.spectraRe[filter], &set.spectraIm[filter], N);
+          }
+          transform(engine, engine.scratchRe, engine.scratchIm, true);
+          // Overlap-save: the second half is the valid output, left in the
+          // real part and right in the imaginary part
+          std::memcpy(left, engine.scratchRe + B, B * sizeof(float));
+          std::memcpy(right, engine.scratchIm + B, B * sizeof(float));
+     }
+
+     void processBlock(SpatialAudio &engine, SpatialSource &source)
+     {
+          SDL_AtomicLock(&engine.lock);
+          const SpatialParams target = source.target;
+          SDL_AtomicUnlock(&engine.lock);
+          if (!source.started)
+          {
+               source.current = target;
+               source.started = true;
+          }
+          const SpatialParams from = source.current;
+
+          std::memmove(source.window, source.window + B, B * sizeof(float));
+          std::memcpy(source.window + B, source.input, B * sizeof(float));
+          if (from.hrtf || target.hrtf)
+          {
+               const int partitions = engine.hrtf->partitions;
+               source.historyHead = (source.historyHead + 1) % partitions;
+               float *re = &source.historyRe[(size_t)source.historyHead * N];
+               float *im = &source.historyIm[(size_t)source.historyHead * N];
+               std::memcpy(re, source.window, N * sizeof(float));
+               std::fill(im, im + N, 0.0f);
+               transform(engine, re, im, false);
+          }
+
+          float *left = engine.blendLeft;
+          float *right = engine.blendRight;
+          const bool sameShape = from.hrtf == target.hrtf && (!from.hrtf || from.direction == target.direction);
+          if (sameShape)
+          {
+               // Only the gains moved: ramp them across the block
+               renderBlock(engine, source, target, left, right);
+               for (int i = 0; i < B; i++)
+               {
+                    const float t = (i + 1) * (1.0f / B);
+                    source.output[2 * i] = left[i] * (from.gainLeft + (target.gainLeft - from.gainLeft) * t);
+                    source.output[2 * i + 1] = right[i] * (from.gainRight + (target.gainRight - from.gainRight) * t);
+               }
+          }
+          else
+          {
+               // New direction or mode: crossfade the old rendering into the new
+               renderBlock(engine, source, from, left, right);
+               for (int i = 0; i < B; i++)
+               {
+                    const float fade = 1.0f - (i + 1) * (1.0f / B);
+                    source.output[2 * i] = left[i] * from.gainLeft * fade;
+                    source.output[2 * i + 1] = right[i] * from.gainRight * fade;
+               }
+               renderBlock(engine, source, target, left, right);
+               for (int i = 0; i < B; i++)
+               {
+                    const float fade = (i + 1) * (1.0f / B);
+                    source.output[2 * i] += left[i] * target.gainLeft * fade;
+                    source.output[2 * i + 1] += right[i] * target.gainRight * fade;
+               }
+          }
+          source.current = target;
+     }
+
+     void spatialEffect(int channel, void *stream, int len, void *udata)
+     {
+          SpatialAudio &engine = *(SpatialAudio *)udata;
+          spatialAudioProcess(engine, channel - engine.firstChannel, (Sint16 *)stream, len / 4);
+     }
+
+     void spatialEffectDone(int channel, void *udata)
+     {
+          SpatialAudio &engine = *(SpatialAudio *)udata;
+          SDL_AtomicSet(&engine.sources[channel - engine.firstChannel].playing, 0);
+     }
+}
+
+bool spatialKernelSupported(SpatialKernel kernel)
+{
+     switch (kernel)
+     {
+     case SPATIAL_KERNEL_AUTO:
+     case SPATIAL_KERNEL_SCALAR:
+          return true;
+#ifdef SPATIAL_AUDIO_X86
+     case SPATIAL_KERNEL_SSE2:
+          return cpuHasSse2();
+#endif
+#ifdef SPATIAL_AUDIO_NEON
+     case SPATIAL_KERNEL_NEON:
+          return SDL_HasNEON() == SDL_TRUE;
+#endif
+     default:
+          return false;
+     }
+}
+
+const char *spatialKernelName(SpatialKernel kernel)
+{
+     switch (kernel)
+     {
+     case SPATIAL_KERNEL_SCALAR:
+          return "scalar";
+     case SPATIAL_KERNEL_SSE2:
+          return "sse2";
+     case SPATIAL_KERNEL_NEON:
+          return "neon";
+     default:
+          return "auto";
+     }
+}
+
+bool hrtfSetLoad(HrtfSet &set, int rate, const float *irs, int irLength, int azimuths, int elevations,
+                 float elevationMin, float elevationStep)
+{
+     if (rate <= 0 || irLength <= 0 || azimuths <= 0 || elevations <= 0)
+     {
+          SDL_SetError("Empty HRTF set");
+          return false;
+     }
+     set.rate = rate;
+     set.partitions = (irLength + B - 1) / B;
+     set.azimuths = azimuths;
+     set.elevations = elevations;
+     set.elevationMin = elevationMin;
+     set.elevationStep = elevationStep;
+     const int directions = azimuths * elevations;
+     set.spectraRe.assign((size_t)directions * set.partitions * N, 0.0f);
+     set.spectraIm.assign((size_t)directions * set.partitions * N, 0.0f);
+
+     std::vector<std::complex<double>> left(N), right(N);
+     for (int d = 0; d < directions; d++)
+     {
+          const float *irLeft = irs + (size_t)d * 2 * irLength;
+          const float *irRight = irLeft + irLength;
+          for (int p = 0; p < set.partitions; p++)
+          {
+               // Each partition zero-padded to the FFT size
+               for (int i = 0; i < N; i++)
+               {
+                    const int tap = p * B + i;
+                    const bool inside = i < B && tap < irLength;
+                    left[i] = inside ? irLeft[tap] : 0.0;
+                    right[i] = inside ? irRight[tap] : 0.0;
+               }
+               transformDouble(left, false);
+               transformDouble(right, false);
+               // Left + j*right, so one inverse FFT yields both ears; the
+               // inverse transform's 1/N is folded in here
+               const size_t base = ((size_t)d * set.partitions + p) * N;
+               const std::complex<double> j(0.0, 1.0);
+               for (int k = 0; k < N; k++)
+               {
+                    const std::complex<double> packed = (left[k] + j * right[k]) / (double)N;
+                    set.spectraRe[base + k] = (float)packed.real();
+                    set.spectraIm[base + k] = (float)packed.imag();
+               }
+          }
+     }
+     return true;
+}
+
+bool hrtfSetBuildSpherical(HrtfSet &set, int rate)
+{
+     const int azimuths = 36, elevations = 7;
+     const float elevationMin = -40.0f, elevationStep = 20.0f;
+     std::vector<float> irs((size_t)azimuths * elevations * 2 * SPHERICAL_IR_LENGTH);
+     for (int e = 0; e < elevations; e++)
+     {
+          const double elevation = (elevationMin + e * elevationStep) * SPATIAL_PI / 180.0;
+          for (int a = 0; a < azimuths; a++)
+          {
+               const double azimuth = a * 2.0 * SPATIAL_PI / azimuths;
+               // Component towards the right ear; the ears sit on that axis
+               const double lateral = std::sin(azimuth) * std::cos(elevation);
+               float *ir = &irs[((size_t)e * azimuths + a) * 2 * SPHERICAL_IR_LENGTH];
+               sphericalEar(std::acos(-lateral), rate, ir);
+               sphericalEar(std::acos(lateral), rate, ir + SPHERICAL_IR_LENGTH);
+          }
+     }
+     return hrtfSetLoad(set, rate, irs.data(), SPHERICAL_IR_LENGTH, azimuths, elevations, elevationMin, elevationStep);
+}
+
+void spatialAudioInit(SpatialAudio &engine, const HrtfSet &hrtf, int firstChannel, int count, int maxHrtfSources,
+                      SpatialKernel kernel)
+{
+     engine.hrtf = &hrtf;
+     engine.firstChannel = firstChannel;
+     engine.channelCount = count;
+     engine.maxHrtfSources = maxHrtfSources;
+     engine.referenceDistance = 1.0f;
+     engine.lodDistance = 50.0f;
+     engine.sources = std::vector<SpatialSource>(count);
+     for (SpatialSource &source : engine.sources)
+     {
+          SDL_AtomicSet(&source.playing, 0);
+          source.position = {0.0f, 0.0f, 0.0f};
+          source.volume = 1.0f;
+          source.audibleGain = 0.0f;
+          source.target = SpatialParams{false, 0, 0.0f, 0.0f};
+          source.current = source.target;
+          source.historyRe.assign((size_t)hrtf.partitions * N, 0.0f);
+          source.historyIm.assign((size_t)hrtf.partitions * N, 0.0f);
+          resetSource(source);
+     }
+     engine.order.reserve(count);
+     engine.listenerPosition = {0.0f, 0.0f, 0.0f};
+     engine.listenerForward = {0.0f, 0.0f, -1.0f};
+     engine.listenerUp = {0.0f, 1.0f, 0.0f};
+     engine.lock = 0;
+     engine.hrtfSources = 0;
+     engine.attached = false;
+
+     int bits = 0;
+     while ((1 << bits) < N)
+     {
+          bits++;
+     }
+     for (int i = 0; i < N; i++)
+     {
+          int reversed = 0;
+          for (int b = 0; b < bits; b++)
+          {
+               reversed |= ((i >> b) & 1) << (bits - 1 - b);
+          }
+          engine.bitReverse[i] = reversed;
+     }
+     engine.twiddleRe.assign(N - 1, 0.0f);
+     engine.twiddleIm.assign(N - 1, 0.0f);
+     for (int half = 1; half < N; half *= 2)
+     {
+          for (int k = 0; k < half; k++)
+          {
+               engine.twiddleRe[half - 1 + k] = (float)std::cos(-SPATIAL_PI * k / half);
+               engine.twiddleIm[half - 1 + k] = (float)std::sin(-SPATIAL_PI * k / half);
+          }
+     }
+
+     if (kernel == SPATIAL_KERNEL_AUTO)
+     {
+          const SpatialKernel preferred[] = {SPATIAL_KERNEL_NEON, SPATIAL_KERNEL_SSE2};
+          kernel = SPATIAL_KERNEL_SCALAR;
+          for (SpatialKernel candidate : preferred)
+          {
+               if (spatialKernelSupported(candidate))
+               {
+                    kernel = candidate;
+                    break;
+               }
+          }
+     }
+     else if (!spatialKernelSupported(kernel))
+     {
+          kernel = SPATIAL_KERNEL_SCALAR;
+     }
+     engine.kernel = kernel;
+     engine.mac = macScalar;
+     engine.butterflies = butterfliesScalar;
+#ifdef SPATIAL_AUDIO_X86
+     if (kernel == SPATIAL_KERNEL_SSE2)
+     {
+          engine.mac = macSse2;
+          engine.butterflies = butterfliesSse2;
+     }
+#endif
+#ifdef SPATIAL_AUDIO_NEON
+     if (kernel == SPATIAL_KERNEL_NEON)
+     {
+          engine.mac = macNeon;
+          engine.butterflies = butterfliesNeon;
+     }
+#endif
+}
+
+bool spatialAudioAttach(SpatialAudio &engine)
+{
+     int freq, channels;
+     Uint16 format;
+     if (Mix_QuerySpec(&freq, &format, &channels) == 0)
+     {
+          std::cerr << "Spatial audio needs an open mixer! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          return false;
+     }
+     if (format != AUDIO_S16SYS || channels != 2)
+     {
+          std::cerr << "Spatial audio needs a 16-bit stereo device" << std::endl;
+          return false;
+     }
+     if (freq != engine.hrtf->rate)
+     {
+          std::cerr << "Spatial audio HRTF set is for " << engine.hrtf->rate << " Hz, the mixer runs at " << freq
+                    << std::endl;
+          return false;
+     }
+     if (Mix_AllocateChannels(-1) < engine.firstChannel + engine.channelCount)
+     {
+          Mix_AllocateChannels(engine.firstChannel + engine.channelCount);
+     }
+     engine.attached = true;
+     return true;
+}
+
+void spatialAudioSetListener(SpatialAudio &engine, SpatialVec3 position, SpatialVec3 forward, SpatialVec3 up)
+{
+     engine.listenerPosition = position;
+     engine.listenerForward = forward;
+     engine.listenerUp = up;
+}
+
+int spatialAudioPlay(SpatialAudio &engine, const Mix_Chunk *chunk, SpatialVec3 position, int loops, float volume)
+{
+     if (!engine.attached || chunk == nullptr)
+     {
+          return -1;
+     }
+     for (int i = 0; i < engine.channelCount; i++)
+     {
+          SpatialSource &source = engine.sources[i];
+          const int channel = engine.firstChannel + i;
+          if (SDL_AtomicGet(&source.playing) || Mix_Playing(channel))
+          {
+               continue;
+          }
+          // The channel is idle, so the audio thread does not touch the source
+          source.position = position;
+          source.volume = volume;
+          resetSource(source);
+          // Panned until the next update ranks it
+          const SpatialParams params = computeParams(engine, source, false);
+          SDL_AtomicLock(&engine.lock);
+          source.target = params;
+          SDL_AtomicUnlock(&engine.lock);
+          SDL_AtomicSet(&source.playing, 1);
+
+          // Registered before playing, so not one callback goes out dry
+          if (Mix_RegisterEffect(channel, spatialEffect, spatialEffectDone, &engine) == 0)
+          {
+               SDL_AtomicSet(&source.playing, 0);
+               return -1;
+          }
+          if (Mix_PlayChannel(channel, (Mix_Chunk *)chunk, loops) < 0)
+          {
+               Mix_UnregisterEffect(channel, spatialEffect);
+               return -1;
+          }
+          return channel;
+     }
+     return -1;
+}
+
+void spatialAudioSetPosition(SpatialAudio &engine, int channel, SpatialVec3 position)
+{
+     const int index = channel - engine.firstChannel;
+     if (index >= 0 && index < engine.channelCount)
+     {
+          engine.sources[index].position = position;
+     }
+}
+
+void spatialAudioUpdate(SpatialAudio &engine)
+{
+     engine.order.clear();
+     for (int i = 0; i < engine.channelCount; i++)
+     {
+          SpatialSource &source = engine.sources[i];
+          if (SDL_AtomicGet(&source.playing))
+          {
+               computeParams(engine, source, false); // Refreshes audibleGain
+               engine.order.push_back(i);
+          }
+     }
+     // Loudest first; they get the HRTF budget
+     std::sort(engine.order.begin(), engine.order.end(),
+               [&engine](int a, int b) { return engine.sources[a].audibleGain > engine.sources[b].audibleGain; });
+
+     engine.hrtfSources = 0;
+     SDL_AtomicLock(&engine.lock);
+     for (int rank = 0; rank < (int)engine.order.size(); rank++)
+     {
+          SpatialSource &source = engine.sources[engine.order[rank]];
+          source.target = computeParams(engine, source, rank < engine.maxHrtfSources);
+          engine.hrtfSources += source.target.hrtf ? 1 : 0;
+     }
+     SDL_AtomicUnlock(&engine.lock);
+}
+
+void spatialAudioProcess(SpatialAudio &engine, int index, Sint16 *stream, int frames)
+{
+     SpatialSource &source = engine.sources[index];
+     for (int i = 0; i < frames; i++)
+     {
+          const float mono = (stream[2 * i] + stream[2 * i + 1]) * 0.5f;
+          const float left = source.output[2 * source.inCount];
+          const float right = source.output[2 * source.inCount + 1];
+          stream[2 * i] = (Sint16)SDL_clamp((int)left, -32768, 32767);
+          stream[2 * i + 1] = (Sint16)SDL_clamp((int)right, -32768, 32767);
+          source.input[source.inCount++] = mono;
+          if (source.inCount == B)
+          {
+               processBlock(engine, source);
+               source.inCount = 0;
+          }
+     }
+}
+
+void spatialAudioHaltAll(SpatialAudio &engine)
+{
+     for (int i = 0; i < engine.channelCount; i++)
+     {
+          if (SDL_AtomicGet(&engine.sources[i].playing))
+          {
+               Mix_HaltChannel(engine.firstChannel + i);
+          }
+     }
+}
@@ -0,0 +1,178 @@
+// Description:
+// 3D sound for SDL_mixer channels. Mix_SetPosition only pans by angle and
+// attenuates by distance; here each source is convolved with a head-
+// related impulse response (HRTF) for its direction, so sounds carry the
+// interaural time and level cues of a real head.
+//
+// Convolution is uniformly partitioned and runs in the frequency domain:
+// the impulse response is cut into 128-frame partitions, each transformed
+// once, and every 128 input frames cost one forward FFT, one complex
+// multiply-accumulate per partition and one inverse FFT. Both ears share
+// that inverse FFT by packing the right ear into the imaginary part. The
+// butterflies and the multiply-accumulate run in SSE2 or NEON.
+//
+// Cost is bounded per source and for the whole scene: spatialAudioUpdate()
+// ranks playing sources by audible gain each frame, gives HRTF processing
+// to at most `maxHrtfSources` of them and pans the rest (equal-power
+// panning plus distance gain, a few multiplies per frame), as it does for
+// anything beyond `lodDistance`. Mode and direction changes crossfade over
+// one block, so sources can move between the two freely.
+//
+// Sources play on a range of mixer channels owned by the engine, each with
+// a Mix_RegisterEffect node that replaces the channel's stereo signal with
+// its spatialized mono downmix, 128 frames (2.7 ms at 48 kHz) late. The
+// HRTF set is a spherical-head model built at load time, or any measured
+// set given as impulse responses.
+// =============================================================================
+
+#ifndef SPATIAL_AUDIO_H
+#define SPATIAL_AUDIO_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <vector>
+
+const int SPATIAL_BLOCK_FRAMES = 128;
+const int SPATIAL_FFT_SIZE = 2 * SPATIAL_BLOCK_FRAMES;
+
+enum SpatialKernel
+{
+     SPATIAL_KERNEL_AUTO,
+     SPATIAL_KERNEL_SCALAR,
+     SPATIAL_KERNEL_SSE2,
+     SPATIAL_KERNEL_NEON
+};
+
+struct SpatialVec3
+{
+     float x, y, z;
+};
+
+// Impulse responses per direction as partitioned spectra. Directions form
+// a grid: `azimuths` steps round the listener (0 ahead, increasing to the
+// right) for each of `elevations` rows starting `elevationMin` degrees.
+struct HrtfSet
+{
+     int rate;
+     int partitions;
+     int azimuths;
+     int elevations;
+     float elevationMin;
+     float elevationStep;
+
+     // Per direction and partition, SPATIAL_FFT_SIZE bins of left + j*right
+     std::vector<float> spectraRe;
+     std::vector<float> spectraIm;
+};
+
+// `irs` holds left then right responses of `irLength` samples for each
+// direction, elevation rows outermost
+bool hrtfSetLoad(HrtfSet &set, int rate, const float *irs, int irLength, int azimuths, int elevations,
+                 float elevationMin, float elevationStep);
+
+// Spherical-head model (head shadow and interaural delay) on a 10 degree
+// azimuth by 20 degree elevation grid
+bool hrtfSetBuildSpherical(HrtfSet &set, int rate);
+
+// What the audio thread renders a source with
+struct SpatialParams
+{
+     bool hrtf;
+     int direction; // Into the HRTF set
+     float gainLeft;
+     float gainRight;
+};
+
+struct SpatialSource
+{
+     SDL_atomic_t playing; // Set on play, cleared by the effect's done callback
+     SpatialVec3 position; // Game thread
+     float volume;         // Game thread, 0..1
+     float audibleGain;    // Game thread, volume after distance, the LOD rank
+     SpatialParams target; // Published by spatialAudioUpdate under the engine lock
+
+     // Audio thread
+     SpatialParams current;
+     bool started;
+     int inCount;
+     float input[SPATIAL_BLOCK_FRAMES];
+     float output[2 * SPATIAL_BLOCK_FRAMES]; // Interleaved, one block behind the input
+     float window[SPATIAL_FFT_SIZE];         // Previous and current input block
+     std::vector<float> historyRe;           // Input spectra, one per partition
+     std::vector<float> historyIm;
+     int historyHead;
+};
+
+// Accumulate sum += x * g over `count` complex bins in split re/im arrays
+typedef void (*SpatialMacFunc)(float *sumRe, float *sumIm, const float *xRe, const float *xIm, const float *gRe,
+                               const float *gIm, int count);
+
+// One radix-2 stage's butterflies over `count` pairs
+typedef void (*SpatialButterflyFunc)(float *aRe, float *aIm, float *bRe, float *bIm, const float *wRe,
+                                     const float *wIm, int count);
+
+struct SpatialAudio
+{
+     const HrtfSet *hrtf;
+     int firstChannel;
+     int channelCount;
+     int maxHrtfSources;
+     float referenceDistance; // Full volume inside this distance
+     float lodDistance;       // Always panned beyond this distance
+
+     std::vector<SpatialSource> sources; // One per owned channel
+     std::vector<int> order;             // spatialAudioUpdate's ranking scratch
+     SpatialVec3 listenerPosition;
+     SpatialVec3 listenerForward;
+     SpatialVec3 listenerUp;
+     SDL_SpinLock lock; // Guards every source's target
+     int hrtfSources;   // Given HRTF by the last update
+
+     // FFT tables and audio thread scratch
+     int bitReverse[SPATIAL_FFT_SIZE];
+     std::vector<float> twiddleRe; // Per stage, contiguous
+     std::vector<float> twiddleIm;
+     float scratchRe[SPATIAL_FFT_SIZE];
+     float scratchIm[SPATIAL_FFT_SIZE];
+     float blendLeft[SPATIAL_BLOCK_FRAMES];
+     float blendRight[SPATIAL_BLOCK_FRAMES];
+
+     SpatialKernel kernel;
+     SpatialMacFunc mac;
+     SpatialButterflyFunc butterflies;
+     bool attached;
+};
+
+// Whether this build and the running CPU can use `kernel`
+bool spatialKernelSupported(SpatialKernel kernel);
+const char *spatialKernelName(SpatialKernel kernel);
+
+// Own channels [firstChannel, firstChannel + count). `hrtf` must outlive
+// the engine and match the mixer's rate.
+void spatialAudioInit(SpatialAudio &engine, const HrtfSet &hrtf, int firstChannel, int count, int maxHrtfSources,
+                      SpatialKernel kernel = SPATIAL_KERNEL_AUTO);
+
+// Allocate the channels; requires a 16-bit stereo mixer
+bool spatialAudioAttach(SpatialAudio &engine);
+
+// Listener at `position` looking along `forward`; both vectors need not
+// be normalized
+void spatialAudioSetListener(SpatialAudio &engine, SpatialVec3 position, SpatialVec3 forward, SpatialVec3 up);
+
+// Play `chunk` at `position` on a free owned channel. Returns the channel,
+// -1 when all of them are busy.
+int spatialAudioPlay(SpatialAudio &engine, const Mix_Chunk *chunk, SpatialVec3 position, int loops = 0,
+                     float volume = 1.0f);
+void spatialAudioSetPosition(SpatialAudio &engine, int channel, SpatialVec3 position);
+
+// Rank sources, choose HRTF or panning for each and publish their
+// parameters; once per frame after moving sources or the listener
+void spatialAudioUpdate(SpatialAudio &engine);
+
+// Spatialize `frames` interleaved stereo S16 frames of one source in
+// place, as the effect does; exposed for benchmarking without a device
+void spatialAudioProcess(SpatialAudio &engine, int source, Sint16 *stream, int frames);
+
+void spatialAudioHaltAll(SpatialAudio &engine);
+
+#endif // SPATIAL_AUDIO_H
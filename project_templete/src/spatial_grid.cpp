@@ -0,0 +1,147 @@
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+     int clampInt(int value, int low, int high)
+     {
+          return value < low ? low : (value > high ? high : value);
+     }
+
+     int columnOf(const SpatialGrid &grid, float x)
+     {
+          return clampInt((int)std::floor((x - grid.originX) / grid.cellSize), 0, grid.columns - 1);
+     }
+
+     int rowOf(const SpatialGrid &grid, float y)
+     {
+          return clampInt((int)std::floor((y - grid.originY) / grid.cellSize), 0, grid.rows - 1);
+     }
+
+     void link(SpatialGrid &grid, int id, int cell)
+     {
+          int head = grid.cellHead[cell];
+          grid.prev[id] = -1;
+          grid.next[id] = head;
+          if (head >= 0)
+          {
+               grid.prev[head] = id;
+          }
+          grid.cellHead[cell] = id;
+          grid.cellOf[id] = cell;
+     }
+
+     void unlink(SpatialGrid &grid, int id)
+     {
+          int cell = grid.cellOf[id];
+          if (grid.prev[id] >= 0)
+          {
+               grid.next[grid.prev[id]] = grid.next[id];
+          }
+          else
+          {
+               grid.cellHead[cell] = grid.next[id];
+          }
+          if (grid.next[id] >= 0)
+          {
+               grid.prev[grid.next[id]] = grid.prev[id];
+          }
+          grid.cellOf[id] = -1;
+     }
+}
+
+void spatialGridInit(SpatialGrid &grid, const SDL_FRect &area, float cellSize, int capacity)
+{
+     grid.originX = area.x;
+     grid.originY = area.y;
+     grid.cellSize = cellSize;
+     grid.maxExtent = 0.0f;
+     grid.columns = SDL_max(1, (int)std::ceil(area.w / cellSize));
+     grid.rows = SDL_max(1, (int)std::ceil(area.h / cellSize));
+
+     grid.cellHead.assign(grid.columns * grid.rows, -1);
+     grid.bounds.assign(capacity, SDL_FRect{0.0f, 0.0f, 0.0f, 0.0f});
+     grid.cellOf.assign(capacity, -1);
+     grid.next.assign(capacity, -1);
+     grid.prev.assign(capacity, -1);
+}
+
+void spatialGridClear(SpatialGrid &grid)
+{
+     std::fill(grid.cellHead.begin(), grid.cellHead.end(), -1);
+     std::fill(grid.cellOf.begin(), grid.cellOf.end(), -1);
+     grid.maxExtent = 0.0f;
+}
+
+void spatialGridUpdate(SpatialGrid &grid, int id, const SDL_FRect &bounds)
+{
+     grid.bounds[id] = bounds;
+     grid.maxExtent = SDL_max(grid.maxExtent, SDL_max(bounds.w, bounds.h));
+
+     int cell = rowOf(grid, bounds.y) * grid.columns + columnOf(grid, bounds.x);
+     if (grid.cellOf[id] == cell)
+     {
+          return;
+     }
+     if (grid.cellOf[id] >= 0)
+     {
+          unlink(grid, id);
+     }
+     link(grid, id, cell);
+}
+
+void spatialGridRemove(SpatialGrid &grid, int id)
+{
+     if (grid.cellOf[id] >= 0)
+     {
+          unlink(grid, id);
+     }
+}
+
+void spatialGridQueryRect(const SpatialGrid &grid, const SDL_FRect &rect, std::vector<int> &results)
+{
+     // Objects are filed by their top-left corner, so anything that reaches
+     // into `rect` starts at most maxExtent to its left or above it
+     int minColumn = columnOf(grid, rect.x - grid.maxExtent);
+     int maxColumn = columnOf(grid, rect.x + rect.w);
+     int minRow = rowOf(grid, rect.y - grid.maxExtent);
+     int maxRow = rowOf(grid, rect.y + rect.h);
+
+     for (int row = minRow; row <= maxRow; row++)
+     {
+          for (int column = minColumn; column <= maxColumn; column++)
+          {
+               for (int id = grid.cellHead[row * grid.columns + column]; id >= 0; id = grid.next[id])
+               {
+                    if (SDL_HasIntersectionF(&rect, &grid.bounds[id]))
+                    {
+                         results.push_back(id);
+                    }
+               }
+          }
+     }
+}
+
+void spatialGridQueryPoint(const SpatialGrid &grid, SDL_FPoint point, std::vector<int> &results)
+{
+     int minColumn = columnOf(grid, point.x - grid.maxExtent);
+     int maxColumn = columnOf(grid, point.x);
+     int minRow = rowOf(grid, point.y - grid.maxExtent);
+     int maxRow = rowOf(grid, point.y);
+
+     for (int row = minRow; row <= maxRow; row++)
+     {
+          for (int column = minColumn; column <= maxColumn; column++)
+          {
+               for (int id = grid.cellHead[row * grid.columns + column]; id >= 0; id = grid.next[id])
+               {
+                    if (SDL_PointInFRect(&point, &grid.bounds[id]))
+                    {
+                         results.push_back(id);
+                    }
+               }
+          }
+     }
+}
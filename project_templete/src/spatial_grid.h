@@ -0,0 +1,53 @@
+// Description:
+// Uniform-grid spatial hash for broadphase collision over a fixed playfield.
+// Each object is filed under the cell containing its top-left corner, in an
+// intrusive doubly-linked list per cell, so moving an object that stays in
+// its cell is a bounds update and crossing a cell boundary is two O(1) list
+// operations. Queries visit only the cells overlapping the query area
+// (widened by the largest object extent) and test bounds exactly.
+//
+// Positions outside the playfield are clamped into the border cells, so
+// objects that leave the screen can still be found.
+// =============================================================================
+
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct SpatialGrid
+{
+     float originX, originY;
+     float cellSize;
+     float maxExtent; // Largest object width/height ever inserted
+     int columns, rows;
+
+     std::vector<int> cellHead; // First object in each cell, -1 if empty
+
+     // Per-object data, indexed by caller-chosen id in [0, capacity)
+     std::vector<SDL_FRect> bounds;
+     std::vector<int> cellOf; // Cell index, -1 when not in the grid
+     std::vector<int> next;
+     std::vector<int> prev;
+};
+
+// Cover `area` with square cells of `cellSize` and room for `capacity` ids
+void spatialGridInit(SpatialGrid &grid, const SDL_FRect &area, float cellSize, int capacity);
+
+// Remove every object
+void spatialGridClear(SpatialGrid &grid);
+
+// Insert the object or move it to its new bounds
+void spatialGridUpdate(SpatialGrid &grid, int id, const SDL_FRect &bounds);
+
+// Remove the object; does nothing if it isn't in the grid
+void spatialGridRemove(SpatialGrid &grid, int id);
+
+// Append the ids of every object intersecting `rect` to `results`
+void spatialGridQueryRect(const SpatialGrid &grid, const SDL_FRect &rect, std::vector<int> &results);
+
+// Append the ids of every object containing `point` to `results`
+void spatialGridQueryPoint(const SpatialGrid &grid, SDL_FPoint point, std::vector<int> &results);
+
+#endif // SPATIAL_GRID_H
@@ -0,0 +1,190 @@
+#include "sprite_animation.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "checksum.h"
+
+namespace
+{
+     std::string frameName(const std::string &clip, int frame)
+     {
+          return clip + "#" + std::to_string(frame);
+     }
+
+     bool samePixels(SDL_Surface *a, SDL_Surface *b)
+     {
+          if (a->w != b->w || a->h != b->h || a->format->format != b->format->format)
+          {
+               return false;
+          }
+          const size_t row = (size_t)a->w * a->format->BytesPerPixel;
+          for (int y = 0; y < a->h; y++)
+          {
+               if (std::memcmp((const Uint8 *)a->pixels + y * a->pitch, (const Uint8 *)b->pixels + y * b->pitch, row) != 0)
+               {
+                    return false;
+               }
+          }
+          return true;
+     }
+}
+
+bool spriteAnimationAddFile(SpriteAnimationSet &set, AtlasBuilder &builder, const std::string &name,
+                            const std::string &path)
+{
+     // Stills come back as a one-frame animation
+     IMG_Animation *animation = IMG_LoadAnimation(path.c_str());
+     if (animation == nullptr)
+     {
+          std::cerr << "Unable to load animation " << path << "! SDL_image Error: " << IMG_GetError() << std::endl;
+          return false;
+     }
+     return spriteAnimationAdd(set, builder, name, animation);
+}
+
+bool spriteAnimationAdd(SpriteAnimationSet &set, AtlasBuilder &builder, const std::string &name,
+                        IMG_Animation *animation)
+{
+     if (animation == nullptr || animation->count <= 0 || set.clipIndex.count(name) != 0)
+     {
+          if (animation != nullptr)
+          {
+               IMG_FreeAnimation(animation);
+          }
+          std::cerr << "Animation " << name << " is empty or already added" << std::endl;
+          return false;
+     }
+
+     SpriteClip clip = {name, (int)set.frames.size(), animation->count, 0};
+     // Identical frames (a GIF holding still, a ping-pong loop) share one
+     // atlas rect; `source` is the first frame with these pixels. Matched
+     // before any frame goes to the builder, which may free it
+     std::vector<Uint32> checksums(animation->count);
+     std::vector<int> sources(animation->count);
+     for (int i = 0; i < animation->count; i++)
+     {
+          SDL_Surface *frame = animation->frames[i];
+          checksums[i] = checksumSurface(frame);
+          sources[i] = i;
+          for (int earlier = 0; earlier < i; earlier++)
+          {
+               if (sources[earlier] == earlier && checksums[earlier] == checksums[i] &&
+                   samePixels(animation->frames[earlier], frame))
+               {
+                    sources[i] = earlier;
+                    break;
+               }
+          }
+     }
+
+     bool queued = true;
+     for (int i = 0; i < animation->count; i++)
+     {
+          if (sources[i] == i)
+          {
+               // The builder owns (and frees) it from here, even on failure
+               queued = atlasBuilderAddSurface(builder, frameName(name, i), animation->frames[i]) && queued;
+               animation->frames[i] = nullptr;
+          }
+
+          const int delay = animation->delays[i] < 20 ? 100 : animation->delays[i];
+          clip.durationMs += (Uint32)delay;
+          SpriteFrame spriteFrame = {{nullptr, {0, 0, 0, 0}}, sources[i], clip.durationMs};
+          set.frames.push_back(spriteFrame);
+     }
+     IMG_FreeAnimation(animation);
+     if (!queued)
+     {
+          set.frames.resize(clip.firstFrame);
+          return false;
+     }
+     set.clipIndex[name] = (int)set.clips.size();
+     set.clips.push_back(clip);
+     return true;
+}
+
+bool spriteAnimationResolve(SpriteAnimationSet &set, const TextureAtlas &atlas)
+{
+     bool complete = true;
+     for (const SpriteClip &clip : set.clips)
+     {
+          for (int i = 0; i < clip.frameCount; i++)
+          {
+               SpriteFrame &frame = set.frames[clip.firstFrame + i];
+               const AtlasSprite *sprite = atlasFind(atlas, frameName(clip.name, frame.source));
+               if (sprite == nullptr)
+               {
+                    std::cerr << "Animation " << clip.name << " frame " << i << " is not in the atlas" << std::endl;
+                    complete = false;
+                    continue;
+               }
+               frame.sprite = *sprite;
+          }
+     }
+     return complete;
+}
+
+int spriteAnimationFind(const SpriteAnimationSet &set, const std::string &name)
+{
+     auto found = set.clipIndex.find(name);
+     return found == set.clipIndex.end() ? -1 : found->second;
+}
+
+SpriteAnimator spriteAnimatorStart(const SpriteAnimationSet &set, int clip, bool loop)
+{
+     const bool valid = clip >= 0 && clip < (int)set.clips.size();
+     return SpriteAnimator{valid ? clip : -1, 0, 0, loop, false};
+}
+
+void spriteAnimatorsAdvance(const SpriteAnimationSet &set, SpriteAnimator *animators, int count, Uint32 deltaMs)
+{
+     for (int i = 0; i < count; i++)
+     {
+          SpriteAnimator &animator = animators[i];
+          if (animator.clip < 0 || animator.finished)
+          {
+               continue;
+          }
+          const SpriteClip &clip = set.clips[animator.clip];
+          const SpriteFrame *frames = &set.frames[clip.firstFrame];
+          animator.timeMs += deltaMs;
+          if (animator.timeMs >= clip.durationMs)
+          {
+               if (!animator.loop)
+               {
+                    animator.timeMs = clip.durationMs;
+                    animator.frame = clip.frameCount - 1;
+                    animator.finished = true;
+                    continue;
+               }
+               animator.timeMs %= clip.durationMs;
+               animator.frame = 0;
+          }
+          // Frames only move forward between wraps, usually by one or none
+          while (animator.frame < clip.frameCount - 1 && animator.timeMs >= frames[animator.frame].endMs)
+          {
+               animator.frame++;
+          }
+     }
+}
+
+const AtlasSprite *spriteAnimatorSprite(const SpriteAnimationSet &set, const SpriteAnimator &animator)
+{
+     if (animator.clip < 0)
+     {
+          return nullptr;
+     }
+     const AtlasSprite &sprite = set.frames[set.clips[animator.clip].firstFrame + animator.frame].sprite;
+     return sprite.texture != nullptr ? &sprite : nullptr;
+}
+
+void spriteAnimationQueue(const SpriteAnimationSet &set, RenderQueue &queue, const SpriteAnimator &animator,
+                          const SDL_FRect &dst, SDL_Color tint)
+{
+     const AtlasSprite *sprite = spriteAnimatorSprite(set, animator);
+     if (sprite != nullptr)
+     {
+          renderQueueCopyTinted(queue, sprite->texture, &sprite->src, dst, tint);
+     }
+}
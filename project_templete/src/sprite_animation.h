@@ -0,0 +1,98 @@
+// Description:
+// Sprite animations packed into the texture atlas. IMG_LoadAnimation
+// hands back every frame as a separate surface; uploading each as its own
+// texture means a texture switch, and so a draw call, between any two
+// animated sprites on different frames. Here the frames of every
+// animation go into the atlas builder with the rest of the images, a
+// SpriteAnimator is two numbers per sprite, and drawing one is a lookup
+// of the atlas rect for its current frame queued into a RenderQueue, so
+// thousands of animated sprites flush in one call per atlas page.
+//
+//     SpriteAnimationSet set;
+//     spriteAnimationAddFile(set, builder, "coin", "coin.gif");
+//     atlasBuild(builder, renderer, atlas, nullptr);
+//     spriteAnimationResolve(set, atlas);
+//     SpriteAnimator coin = spriteAnimatorStart(set, spriteAnimationFind(set, "coin"));
+//     ...each frame
+//     spriteAnimatorsAdvance(set, &coin, 1, deltaMs);
+//     spriteAnimationQueue(set, queue, coin, dst);
+//
+// Frames are queued as "<name>#<frame>" and found again by that name
+// after the build. Near-zero frame delays play at 10 fps, as browsers do.
+// =============================================================================
+
+#ifndef SPRITE_ANIMATION_H
+#define SPRITE_ANIMATION_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "render_queue.h"
+#include "texture_atlas.h"
+
+struct SpriteFrame
+{
+     AtlasSprite sprite; // Set by spriteAnimationResolve()
+     int source;         // The frame of the clip with the same pixels, packed once
+     Uint32 endMs;       // When the frame ends, from the start of the clip
+};
+
+struct SpriteClip
+{
+     std::string name;
+     int firstFrame; // Into SpriteAnimationSet::frames
+     int frameCount;
+     Uint32 durationMs;
+};
+
+struct SpriteAnimationSet
+{
+     std::vector<SpriteClip> clips;
+     std::vector<SpriteFrame> frames;
+     std::unordered_map<std::string, int> clipIndex; // Name to index in clips
+};
+
+// One playing sprite
+struct SpriteAnimator
+{
+     int clip;      // -1 draws nothing
+     int frame;     // Within the clip
+     Uint32 timeMs; // Into the clip
+     bool loop;
+     bool finished; // A clip that does not loop has shown its last frame
+};
+
+// Decode every frame of an animated image (or the one frame of a still)
+// and queue the distinct frames into `builder`; false if the file can't
+// be decoded
+bool spriteAnimationAddFile(SpriteAnimationSet &set, AtlasBuilder &builder, const std::string &name,
+                            const std::string &path);
+
+// The same for an animation already decoded; takes its frames, frees the
+// rest and leaves `animation` invalid
+bool spriteAnimationAdd(SpriteAnimationSet &set, AtlasBuilder &builder, const std::string &name,
+                        IMG_Animation *animation);
+
+// Look every frame up in the built atlas (again after a rebuild); false if
+// any is missing, which means the atlas was built from a different builder
+bool spriteAnimationResolve(SpriteAnimationSet &set, const TextureAtlas &atlas);
+
+// -1 if no clip has that name
+int spriteAnimationFind(const SpriteAnimationSet &set, const std::string &name);
+
+SpriteAnimator spriteAnimatorStart(const SpriteAnimationSet &set, int clip, bool loop = true);
+
+// Move `count` animators on by `deltaMs`
+void spriteAnimatorsAdvance(const SpriteAnimationSet &set, SpriteAnimator *animators, int count, Uint32 deltaMs);
+
+// The atlas rect the animator shows now; nullptr when it has no clip
+const AtlasSprite *spriteAnimatorSprite(const SpriteAnimationSet &set, const SpriteAnimator &animator);
+
+// Queue the animator's current frame at `dst`
+void spriteAnimationQueue(const SpriteAnimationSet &set, RenderQueue &queue, const SpriteAnimator &animator,
+                          const SDL_FRect &dst, SDL_Color tint = {255, 255, 255, 255});
+
+#endif // SPRITE_ANIMATION_H
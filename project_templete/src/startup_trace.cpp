@@ -0,0 +1,253 @@
+#include "startup_trace.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+     struct Subsystem
+     {
+          Uint32 flag;
+          const char *name;
+     };
+
+     // SDL_InitSubSystem's order, so dependencies land in the first step that needs them
+     const Subsystem SUBSYSTEMS[] = {{SDL_INIT_TIMER, "SDL timer"},
+                                     {SDL_INIT_EVENTS, "SDL events"},
+                                     {SDL_INIT_VIDEO, "SDL video"},
+                                     {SDL_INIT_AUDIO, "SDL audio"},
+                                     {SDL_INIT_JOYSTICK, "SDL joystick"},
+                                     {SDL_INIT_HAPTIC, "SDL haptic"},
+                                     {SDL_INIT_GAMECONTROLLER, "SDL game controller"},
+                                     {SDL_INIT_SENSOR, "SDL sensor"}};
+
+     // The backend a subsystem came up on, where SDL says
+     std::string backendOf(Uint32 flag)
+     {
+          const char *driver = nullptr;
+          if (flag == SDL_INIT_VIDEO)
+          {
+               driver = SDL_GetCurrentVideoDriver();
+          }
+          else if (flag == SDL_INIT_AUDIO)
+          {
+               driver = SDL_GetCurrentAudioDriver();
+          }
+          else if (flag == SDL_INIT_JOYSTICK)
+          {
+               return std::to_string(SDL_NumJoysticks()) + " joysticks";
+          }
+          else if (flag == SDL_INIT_HAPTIC)
+          {
+               return std::to_string(SDL_NumHaptics()) + " haptic devices";
+          }
+          else if (flag == SDL_INIT_SENSOR)
+          {
+               return std::to_string(SDL_NumSensors()) + " sensors";
+          }
+          return driver != nullptr ? driver : "";
+     }
+
+     int SDLCALL taskThreadMain(void *data)
+     {
+          StartupTask &task = *(StartupTask *)data;
+          const Uint64 start = SDL_GetPerformanceCounter();
+          task.succeeded = task.run(task.data);
+          startupTraceStep(*task.trace, task.name, task.succeeded ? "" : "failed", start);
+          return 0;
+     }
+
+     std::string jsonEscaped(const std::string &text)
+     {
+          std::string escaped;
+          for (const char c : text)
+          {
+               if (c == '"' || c == '\\')
+               {
+                    escaped += '\\';
+               }
+               escaped += (unsigned char)c < 0x20 ? ' ' : c;
+          }
+          return escaped;
+     }
+
+     bool writeChromeTrace(const StartupTrace &trace, const std::vector<StartupStep> &steps, const char *path)
+     {
+          SDL_RWops *rw = SDL_RWFromFile(path, "w");
+          if (rw == nullptr)
+          {
+               std::cerr << "Unable to write " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+               return false;
+          }
+
+          // Complete ("X") events for steps, instant ("i") ones for marks,
+          // in microseconds; each thread gets its own track
+          const double toUs = 1000000.0 / trace.frequency;
+          std::vector<SDL_threadID> threads;
+          std::string text = "{\"traceEvents\":[\n";
+          char event[512];
+          for (size_t i = 0; i < steps.size(); i++)
+          {
+               const StartupStep &step = steps[i];
+               size_t track = std::find(threads.begin(), threads.end(), step.thread) - threads.begin();
+               if (track == threads.size())
+               {
+                    threads.push_back(step.thread);
+               }
+               const std::string name = jsonEscaped(step.name), backend = jsonEscaped(step.backend);
+               if (step.ticks == 0)
+               {
+                    SDL_snprintf(event, sizeof(event),
+                                 "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"p\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+                                 i == 0 ? "" : ",\n", name.c_str(), (int)track + 1, (step.start - trace.epoch) * toUs);
+               }
+               else
+               {
+                    SDL_snprintf(event, sizeof(event),
+                                 "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                                 "\"args\":{\"backend\":\"%s\"}}",
+                                 i == 0 ? "" : ",\n", name.c_str(), (int)track + 1, (step.start - trace.epoch) * toUs,
+                                 step.ticks * toUs, backend.c_str());
+               }
+               text += event;
+          }
+          text += "\n]}\n";
+
+          bool ok = SDL_RWwrite(rw, text.data(), 1, text.size()) == text.size();
+          SDL_RWclose(rw);
+          return ok;
+     }
+}
+
+void startupTraceInit(StartupTrace &trace, Uint64 epoch)
+{
+     trace.epoch = epoch;
+     trace.frequency = SDL_GetPerformanceFrequency();
+     trace.lock = SDL_CreateMutex();
+     trace.steps.clear();
+}
+
+void startupTraceStep(StartupTrace &trace, const char *name, const char *backend, Uint64 start)
+{
+     StartupStep step;
+     step.name = name;
+     step.backend = backend != nullptr ? backend : "";
+     step.start = start;
+     step.ticks = SDL_max(SDL_GetPerformanceCounter() - start, (Uint64)1);
+     step.thread = SDL_ThreadID();
+     SDL_LockMutex(trace.lock);
+     trace.steps.push_back(step);
+     SDL_UnlockMutex(trace.lock);
+}
+
+void startupTraceMark(StartupTrace &trace, const char *name)
+{
+     StartupStep step;
+     step.name = name;
+     step.start = SDL_GetPerformanceCounter();
+     step.ticks = 0;
+     step.thread = SDL_ThreadID();
+     SDL_LockMutex(trace.lock);
+     trace.steps.push_back(step);
+     SDL_UnlockMutex(trace.lock);
+}
+
+int startupInit(StartupTrace &trace, Uint32 flags)
+{
+     Uint32 started = 0;
+     for (const Subsystem &subsystem : SUBSYSTEMS)
+     {
+          if ((flags & subsystem.flag) == 0)
+          {
+               continue;
+          }
+          const Uint64 start = SDL_GetPerformanceCounter();
+          if (SDL_InitSubSystem(subsystem.flag) < 0)
+          {
+               startupTraceStep(trace, subsystem.name, "failed", start);
+               if (started != 0)
+               {
+                    // Quitting may overwrite the error the caller reports
+                    const std::string error = SDL_GetError();
+                    SDL_QuitSubSystem(started);
+                    SDL_SetError("%s", error.c_str());
+               }
+               return -1;
+          }
+          startupTraceStep(trace, subsystem.name, backendOf(subsystem.flag).c_str(), start);
+          started |= subsystem.flag;
+     }
+     return 0;
+}
+
+void startupTaskStart(StartupTrace &trace, StartupTask &task, const char *name, StartupTaskFunction run, void *data)
+{
+     task.trace = &trace;
+     task.name = name;
+     task.run = run;
+     task.data = data;
+     task.succeeded = false;
+     task.thread = SDL_CreateThread(taskThreadMain, "StartupTask", &task);
+     if (task.thread == nullptr)
+     {
+          taskThreadMain(&task);
+     }
+}
+
+bool startupTaskFinish(StartupTask &task)
+{
+     if (task.thread != nullptr)
+     {
+          SDL_WaitThread(task.thread, nullptr);
+          task.thread = nullptr;
+     }
+     return task.succeeded;
+}
+
+void startupTraceReport(StartupTrace &trace)
+{
+     const char *hint = SDL_GetHint(STARTUP_TRACE_HINT);
+     if (hint == nullptr || hint[0] == '\0' || SDL_strcmp(hint, "0") == 0)
+     {
+          return;
+     }
+     SDL_LockMutex(trace.lock);
+     std::vector<StartupStep> steps = trace.steps;
+     SDL_UnlockMutex(trace.lock);
+     std::stable_sort(steps.begin(), steps.end(),
+                      [](const StartupStep &a, const StartupStep &b) { return a.start < b.start; });
+
+     const SDL_threadID mainThread = steps.empty() ? 0 : steps.front().thread;
+     const double toMs = 1000.0 / trace.frequency;
+     char line[256];
+     std::cout << "Startup trace:" << std::endl;
+     for (const StartupStep &step : steps)
+     {
+          if (step.ticks == 0)
+          {
+               SDL_snprintf(line, sizeof(line), "  %9.2f ms  %-28s", (step.start - trace.epoch) * toMs,
+                            step.name.c_str());
+          }
+          else
+          {
+               SDL_snprintf(line, sizeof(line), "  %9.2f ms  %-28s %8.2f ms%s%s%s", (step.start - trace.epoch) * toMs,
+                            step.name.c_str(), step.ticks * toMs, step.thread == mainThread ? "" : " (parallel)",
+                            step.backend.empty() ? "" : "  ", step.backend.c_str());
+          }
+          std::cout << line << std::endl;
+     }
+     if (SDL_strcmp(hint, "1") != 0)
+     {
+          writeChromeTrace(trace, steps, hint);
+     }
+}
+
+void startupTraceDestroy(StartupTrace &trace)
+{
+     if (trace.lock != nullptr)
+     {
+          SDL_DestroyMutex(trace.lock);
+          trace.lock = nullptr;
+     }
+     trace.steps.clear();
+}
@@ -0,0 +1,87 @@
+// Description:
+// Where the time before the first frame goes. SDL_Init(SDL_INIT_VIDEO |
+// SDL_INIT_AUDIO) reports nothing but success, yet one subsystem or its
+// backend (HID enumeration under the joystick subsystem, audio driver and
+// device probing) can take hundreds of milliseconds of it. A StartupTrace
+// times each step of startup by name, with the backend it ended up on:
+//
+// - startupInit() is SDL_Init one subsystem at a time, each step named
+//   after its subsystem and tagged with the driver SDL picked;
+// - startupTaskStart() runs a step on a thread of its own, for work that
+//   does not depend on what the main thread is doing next (opening the
+//   audio device while the window and renderer are created), and
+//   startupTaskFinish() joins it where its result is first needed;
+// - startupTraceMark() notes a moment, such as the first frame presented.
+//
+// With STARTUP_TRACE_HINT set, startupTraceReport() prints the steps in
+// the order they began; any value other than "1" also names a file to
+// write them to as Chrome trace event JSON, one track per thread, so
+// overlapping steps show side by side in chrome://tracing or Perfetto.
+// =============================================================================
+
+#ifndef STARTUP_TRACE_H
+#define STARTUP_TRACE_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#define STARTUP_TRACE_HINT "CATCH_TRACE_STARTUP"
+
+struct StartupStep
+{
+     std::string name;
+     std::string backend; // Driver or device chosen, may be empty
+     Uint64 start;        // Counter value
+     Uint64 ticks;        // 0 for marks
+     SDL_threadID thread;
+};
+
+struct StartupTrace
+{
+     Uint64 epoch; // Counter value at launch, trace time zero
+     Uint64 frequency;
+     SDL_mutex *lock;
+     std::vector<StartupStep> steps; // Guarded by lock
+};
+
+// A step run by startupTaskStart(); false from `run` fails the task
+typedef bool (*StartupTaskFunction)(void *data);
+
+struct StartupTask
+{
+     StartupTrace *trace;
+     const char *name;
+     StartupTaskFunction run;
+     void *data;
+     SDL_Thread *thread; // nullptr once finished, or when it ran inline
+     bool succeeded;
+};
+
+// Start a trace whose time zero is `epoch`, a counter taken at launch
+void startupTraceInit(StartupTrace &trace, Uint64 epoch);
+
+// Record a finished step begun at counter `start`
+void startupTraceStep(StartupTrace &trace, const char *name, const char *backend, Uint64 start);
+
+void startupTraceMark(StartupTrace &trace, const char *name);
+
+// SDL_Init(flags), one subsystem after another, each a step. SDL's own
+// dependencies (events for video and audio, joystick for the game
+// controller) are timed inside the step that pulls them in. On failure the
+// subsystems it started are quit again and SDL's error is left set
+int startupInit(StartupTrace &trace, Uint32 flags);
+
+// Run `run(data)` on a new thread as step `name`, or right here if no
+// thread can be created
+void startupTaskStart(StartupTrace &trace, StartupTask &task, const char *name, StartupTaskFunction run, void *data);
+
+// Wait for the task; returns what `run` did
+bool startupTaskFinish(StartupTask &task);
+
+// Print and write the trace as STARTUP_TRACE_HINT asks; nothing without it
+void startupTraceReport(StartupTrace &trace);
+
+void startupTraceDestroy(StartupTrace &trace);
+
+#endif // STARTUP_TRACE_H
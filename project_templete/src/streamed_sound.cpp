@@ -0,0 +1,350 @@
+#include "streamed_sound.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+     // Long enough that the mixer rarely wraps the carrier mid-callback
+     const int CARRIER_FRAMES = 4096;
+
+     int soundMsToBytes(const StreamedSound &sound, int ms)
+     {
+          return (int)((Sint64)sound.spec.freq * ms / 1000) * sound.frameBytes;
+     }
+
+     int soundRingUsed(const StreamedSound &sound)
+     {
+          // Unsigned so the positions may wrap around
+          return (int)((unsigned)SDL_AtomicGet((SDL_atomic_t *)&sound.writePos) -
+                       (unsigned)SDL_AtomicGet((SDL_atomic_t *)&sound.readPos));
+     }
+
+     // Decode one step into the ring. Returns the bytes added, 0 when the
+     // ring is too full, -1 when the last loop has ended.
+     int soundDecodeStep(StreamedSound &sound, std::vector<Uint8> &chunk, bool &producedSinceRewind)
+     {
+          const int chunkBytes = (int)chunk.size();
+          if ((int)sound.ring.size() - soundRingUsed(sound) < chunkBytes)
+          {
+               return 0;
+          }
+          int got = sound.decoder.read(sound.decoder.state, chunk.data(), chunkBytes);
+          while (got == 0 && sound.loopsLeft != 0 && producedSinceRewind && sound.decoder.rewind(sound.decoder.state))
+          {
+               producedSinceRewind = false;
+               if (sound.loopsLeft > 0)
+               {
+                    sound.loopsLeft--;
+               }
+               got = sound.decoder.read(sound.decoder.state, chunk.data(), chunkBytes);
+          }
+          if (got <= 0)
+          {
+               if (got < 0)
+               {
+                    std::cerr << "Streamed sound decode failed! SDL Error: " << SDL_GetError() << std::endl;
+               }
+               SDL_AtomicSet(&sound.finished, 1);
+               return -1;
+          }
+
+          producedSinceRewind = true;
+          const int writePos = SDL_AtomicGet(&sound.writePos);
+          const int offset = writePos & sound.ringMask;
+          const int first = SDL_min(got, (int)sound.ring.size() - offset);
+          std::memcpy(&sound.ring[offset], chunk.data(), first);
+          std::memcpy(&sound.ring[0], chunk.data() + first, got - first);
+          SDL_MemoryBarrierRelease();
+          SDL_AtomicSet(&sound.writePos, (int)((unsigned)writePos + (unsigned)got));
+          return got;
+     }
+
+     std::vector<Uint8> soundChunkBuffer(const StreamedSound &sound)
+     {
+          int chunkBytes = soundMsToBytes(sound, sound.config.chunkMs);
+          chunkBytes = SDL_clamp(chunkBytes, sound.frameBytes, (int)sound.ring.size());
+          return std::vector<Uint8>(chunkBytes - chunkBytes % sound.frameBytes);
+     }
+
+     int soundDecodeThread(void *data)
+     {
+          StreamedSound &sound = *(StreamedSound *)data;
+          std::vector<Uint8> chunk = soundChunkBuffer(sound);
+          // Play() prefetched, so the stream has produced unless it is empty
+          bool producedSinceRewind = soundRingUsed(sound) > 0;
+          while (!SDL_AtomicGet(&sound.quitting))
+          {
+               const int got = soundDecodeStep(sound, chunk, producedSinceRewind);
+               if (got < 0)
+               {
+                    break;
+               }
+               if (got == 0)
+               {
+                    SDL_SemWaitTimeout(sound.wake, 20);
+               }
+          }
+          return 0;
+     }
+
+     // Mixer thread: the channel's chunk is silence, so this writes the
+     // stream's audio over it and the mixer applies volume and fades after
+     void soundEffect(int channel, void *stream, int len, void *udata)
+     {
+          (void)channel;
+          StreamedSound &sound = *(StreamedSound *)udata;
+          const int readPos = SDL_AtomicGet(&sound.readPos);
+          const int available = soundRingUsed(sound);
+          SDL_MemoryBarrierAcquire();
+
+          int bytes = SDL_min(available, len);
+          bytes -= bytes % sound.frameBytes;
+          const int offset = readPos & sound.ringMask;
+          const int first = SDL_min(bytes, (int)sound.ring.size() - offset);
+          Uint8 *out = (Uint8 *)stream;
+          std::memcpy(out, &sound.ring[offset], first);
+          std::memcpy(out + first, &sound.ring[0], bytes - first);
+          std::memset(out + bytes, sound.spec.silence, len - bytes);
+
+          SDL_MemoryBarrierRelease();
+          SDL_AtomicAdd(&sound.readPos, bytes);
+          SDL_SemPost(sound.wake);
+
+          if (bytes < len && !SDL_AtomicGet(&sound.finished))
+          {
+               SDL_AtomicIncRef(&sound.underruns);
+          }
+     }
+
+     // Runs when the channel halts or is reused, from any thread
+     void soundEffectDone(int channel, void *udata)
+     {
+          (void)channel;
+          SDL_AtomicSet(&((StreamedSound *)udata)->attached, 0);
+     }
+
+     void stopSoundThread(StreamedSound &sound)
+     {
+          if (sound.thread == nullptr)
+          {
+               return;
+          }
+          SDL_AtomicSet(&sound.quitting, 1);
+          SDL_SemPost(sound.wake);
+          SDL_WaitThread(sound.thread, NULL);
+          sound.thread = nullptr;
+     }
+
+     int startSound(StreamedSound &sound, int channel, int loops, int fadeMs)
+     {
+          streamedSoundStop(sound);
+          if (sound.decoder.state == nullptr || !sound.decoder.rewind(sound.decoder.state))
+          {
+               std::cerr << "Unable to rewind streamed sound! SDL Error: " << SDL_GetError() << std::endl;
+               return -1;
+          }
+          SDL_AtomicSet(&sound.readPos, 0);
+          SDL_AtomicSet(&sound.writePos, 0);
+          SDL_AtomicSet(&sound.quitting, 0);
+          SDL_AtomicSet(&sound.finished, 0);
+          while (SDL_SemTryWait(sound.wake) == 0)
+          {
+          }
+          // Loops count repeats after the first pass, as for Mix_PlayChannel
+          sound.loopsLeft = loops;
+
+          // Decode the start here so the first callback already has audio
+          std::vector<Uint8> chunk = soundChunkBuffer(sound);
+          const int prefetchBytes = SDL_min(soundMsToBytes(sound, sound.config.prefetchMs), (int)sound.ring.size());
+          bool producedSinceRewind = false;
+          while (soundRingUsed(sound) < prefetchBytes && soundDecodeStep(sound, chunk, producedSinceRewind) > 0)
+          {
+          }
+          if (!SDL_AtomicGet(&sound.finished))
+          {
+               sound.thread = SDL_CreateThread(soundDecodeThread, "sound decode", &sound);
+               if (sound.thread == nullptr)
+               {
+                    std::cerr << "Unable to start sound decoder! SDL Error: " << SDL_GetError() << std::endl;
+                    return -1;
+               }
+          }
+
+          // The carrier loops forever; streamedSoundUpdate() ends it
+          const int played = fadeMs > 0 ? Mix_FadeInChannel(channel, &sound.carrier, -1, fadeMs)
+                                        : Mix_PlayChannel(channel, &sound.carrier, -1);
+          if (played < 0)
+          {
+               stopSoundThread(sound);
+               return -1;
+          }
+          // Registered after the channel is known; a callback in between
+          // only mixes the carrier's silence and consumes nothing
+          if (Mix_RegisterEffect(played, soundEffect, soundEffectDone, &sound) == 0)
+          {
+               std::cerr << "Unable to attach streamed sound! SDL_mixer Error: " << Mix_GetError() << std::endl;
+               Mix_HaltChannel(played);
+               stopSoundThread(sound);
+               return -1;
+          }
+          SDL_AtomicSet(&sound.attached, 1);
+          sound.channel = played;
+          return played;
+     }
+}
+
+StreamedSoundConfig streamedSoundDefaultConfig()
+{
+     StreamedSoundConfig config;
+     config.bufferMs = 500;
+     config.prefetchMs = 100;
+     config.chunkMs = 50;
+     return config;
+}
+
+bool streamedSoundOpenDecoder(StreamedSound &sound, const MusicDecoder &decoder, const StreamedSoundConfig &config)
+{
+     sound.decoder.state = nullptr;
+     sound.thread = nullptr;
+     sound.wake = nullptr;
+     sound.channel = -1;
+     SDL_AtomicSet(&sound.attached, 0);
+     SDL_AtomicSet(&sound.underruns, 0);
+
+     int freq, channels;
+     Uint16 format;
+     if (Mix_QuerySpec(&freq, &format, &channels) == 0)
+     {
+          std::cerr << "Streamed sound needs an open mixer! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          decoder.close(decoder.state);
+          return false;
+     }
+     SDL_zero(sound.spec);
+     sound.spec.freq = freq;
+     sound.spec.format = format;
+     sound.spec.channels = (Uint8)channels;
+     sound.spec.silence = format == AUDIO_U8 ? 0x80 : 0;
+     sound.frameBytes = SDL_AUDIO_BITSIZE(format) / 8 * channels;
+     sound.config = config;
+
+     sound.wake = SDL_CreateSemaphore(0);
+     if (sound.wake == nullptr)
+     {
+          std::cerr << "Unable to create semaphore! SDL Error: " << SDL_GetError() << std::endl;
+          decoder.close(decoder.state);
+          return false;
+     }
+
+     // Round the ring up to a power of two so positions can be masked
+     const int bytes = SDL_max(soundMsToBytes(sound, config.bufferMs), 4096);
+     int size = 1;
+     while (size < bytes)
+     {
+          size <<= 1;
+     }
+     sound.ring.assign(size, 0);
+     sound.ringMask = size - 1;
+
+     sound.silence.assign((size_t)CARRIER_FRAMES * sound.frameBytes, sound.spec.silence);
+     sound.carrier.allocated = 0;
+     sound.carrier.abuf = sound.silence.data();
+     sound.carrier.alen = (Uint32)sound.silence.size();
+     sound.carrier.volume = MIX_MAX_VOLUME;
+
+     sound.decoder = decoder;
+     return true;
+}
+
+bool streamedSoundOpen(StreamedSound &sound, const AssetPack *pack, const std::string &path,
+                       const StreamedSoundConfig &config)
+{
+     int freq, channels;
+     Uint16 format;
+     if (Mix_QuerySpec(&freq, &format, &channels) == 0)
+     {
+          std::cerr << "Streamed sound needs an open mixer! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          return false;
+     }
+     SDL_RWops *file = assetOpen(pack, path);
+     if (file == nullptr)
+     {
+          std::cerr << "Unable to open " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     SDL_AudioSpec output;
+     SDL_zero(output);
+     output.freq = freq;
+     output.format = format;
+     output.channels = (Uint8)channels;
+     MusicDecoder decoder;
+     if (!musicDecoderOpenWavRW(decoder, file, path.c_str(), output))
+     {
+          return false;
+     }
+     return streamedSoundOpenDecoder(sound, decoder, config);
+}
+
+int streamedSoundPlay(StreamedSound &sound, int channel, int loops)
+{
+     return startSound(sound, channel, loops, 0);
+}
+
+int streamedSoundFadeIn(StreamedSound &sound, int channel, int loops, int ms)
+{
+     return startSound(sound, channel, loops, ms);
+}
+
+void streamedSoundUpdate(StreamedSound &sound)
+{
+     if (SDL_AtomicGet(&sound.attached) && SDL_AtomicGet(&sound.finished) && soundRingUsed(sound) == 0)
+     {
+          Mix_HaltChannel(sound.channel);
+     }
+     // Halted here or by the game: nothing reads the ring any more
+     if (!SDL_AtomicGet(&sound.attached))
+     {
+          stopSoundThread(sound);
+     }
+}
+
+bool streamedSoundPlaying(const StreamedSound &sound)
+{
+     return SDL_AtomicGet((SDL_atomic_t *)&sound.attached) != 0;
+}
+
+void streamedSoundStop(StreamedSound &sound)
+{
+     // Halting takes the audio lock and removes the effect, so the
+     // callback is done with the ring afterwards
+     if (SDL_AtomicGet(&sound.attached))
+     {
+          Mix_HaltChannel(sound.channel);
+     }
+     stopSoundThread(sound);
+}
+
+void streamedSoundClose(StreamedSound &sound)
+{
+     streamedSoundStop(sound);
+     if (sound.decoder.state != nullptr)
+     {
+          sound.decoder.close(sound.decoder.state);
+          sound.decoder.state = nullptr;
+     }
+     if (sound.wake != nullptr)
+     {
+          SDL_DestroySemaphore(sound.wake);
+          sound.wake = nullptr;
+     }
+     sound.ring.clear();
+     sound.silence.clear();
+}
+
+StreamedSoundStats streamedSoundGetStats(const StreamedSound &sound)
+{
+     StreamedSoundStats stats;
+     stats.underruns = SDL_AtomicGet((SDL_atomic_t *)&sound.underruns);
+     stats.residentBytes = sound.ring.size() + sound.silence.size();
+     return stats;
+}
@@ -0,0 +1,108 @@
+// Description:
+// Sound effects played on ordinary mixer channels without decoding them
+// into memory first. Mix_LoadWAV turns a whole file into PCM, which for a
+// long ambience loop is tens of megabytes; a streamed sound keeps only a
+// short ring of decoded audio and a decoder thread refills it from the
+// file or the asset pack while it plays.
+//
+// The channel plays a short silent carrier chunk on a loop, and an effect
+// registered on it (Mix_RegisterEffect) replaces the silence with audio
+// from the ring before the mixer applies the channel's volume, panning and
+// fades. So Mix_Volume, Mix_SetPanning, Mix_FadeOutChannel, Mix_HaltChannel
+// and Mix_Playing work as for any chunk; play through streamedSoundPlay()
+// and streamedSoundFadeIn(), which take the same arguments as
+// Mix_PlayChannel and Mix_FadeInChannel.
+//
+// Decoders are music_stream's MusicDecoder, so anything that can stream
+// music can stream a sound effect; WAV is built in. A StreamedSound is one
+// playing instance: play it again and it restarts. Open the file twice to
+// layer it. Call streamedSoundUpdate() once per frame so a finished sound
+// frees its channel.
+// =============================================================================
+
+#ifndef STREAMED_SOUND_H
+#define STREAMED_SOUND_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+#include "music_stream.h"
+
+struct StreamedSoundConfig
+{
+     int bufferMs;   // Ring buffer depth
+     int prefetchMs; // Decoded on the calling thread before playback starts
+     int chunkMs;    // Granularity of each decode step
+};
+
+struct StreamedSoundStats
+{
+     int underruns;       // Callbacks that ran short of audio
+     size_t residentBytes; // Ring buffer and carrier chunk
+};
+
+struct StreamedSound
+{
+     MusicDecoder decoder;
+     StreamedSoundConfig config;
+     SDL_AudioSpec spec;
+     int frameBytes;
+
+     // Ring buffer: positions count bytes monotonically and are masked
+     std::vector<Uint8> ring;
+     int ringMask;
+     SDL_atomic_t readPos;
+     SDL_atomic_t writePos;
+
+     // What the channel actually plays: silence the effect overwrites
+     std::vector<Uint8> silence;
+     Mix_Chunk carrier;
+
+     SDL_Thread *thread;
+     SDL_sem *wake; // Posted by the effect whenever space frees up
+     SDL_atomic_t quitting;
+     SDL_atomic_t finished; // Decoder reached the end of its last loop
+     SDL_atomic_t attached; // The effect is registered on `channel`
+     int loopsLeft;         // Decoder thread only, -1 loops forever
+     int channel;           // Last channel played on, -1 if none
+
+     SDL_atomic_t underruns;
+};
+
+StreamedSoundConfig streamedSoundDefaultConfig();
+
+// Open `path` from `pack` (or disk, see assetOpen) for streaming in the
+// mixer's output format. WAV files only; false with a message on stderr
+// otherwise.
+bool streamedSoundOpen(StreamedSound &sound, const AssetPack *pack, const std::string &path,
+                       const StreamedSoundConfig &config = streamedSoundDefaultConfig());
+
+// Same with a decoder already producing the mixer's output format; the
+// sound takes ownership of it on success
+bool streamedSoundOpenDecoder(StreamedSound &sound, const MusicDecoder &decoder,
+                              const StreamedSoundConfig &config = streamedSoundDefaultConfig());
+
+// Like Mix_PlayChannel: `channel` -1 picks a free one, `loops` -1 loops
+// forever. Returns the channel, -1 on error.
+int streamedSoundPlay(StreamedSound &sound, int channel, int loops);
+
+// Like Mix_FadeInChannel
+int streamedSoundFadeIn(StreamedSound &sound, int channel, int loops, int ms);
+
+// Halt the channel once the last loop has drained; call once per frame
+void streamedSoundUpdate(StreamedSound &sound);
+
+bool streamedSoundPlaying(const StreamedSound &sound);
+
+// Halt the channel and stop decoding; the sound can be played again
+void streamedSoundStop(StreamedSound &sound);
+
+// Stop and close the decoder
+void streamedSoundClose(StreamedSound &sound);
+
+StreamedSoundStats streamedSoundGetStats(const StreamedSound &sound);
+
+#endif // STREAMED_SOUND_H
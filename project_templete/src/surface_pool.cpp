@@ -0,0 +1,245 @@
+#include "surface_pool.h"
+#include "aligned_surface.h"
+#include "mem_kernels.h"
+
+namespace
+{
+     const size_t SMALLEST_CLASS = 4096;
+
+     // Four classes per power of two: 4K, 5K, 6K, 7K, 8K, 10K, 12K, ...
+     size_t classBytes(int sizeClass)
+     {
+          const size_t base = SMALLEST_CLASS << (sizeClass / 4);
+          return base + base / 4 * (sizeClass % 4);
+     }
+
+     int classOf(size_t bytes)
+     {
+          int sizeClass = 0;
+          while (classBytes(sizeClass) < bytes)
+          {
+               sizeClass++;
+          }
+          return sizeClass;
+     }
+
+     void freeEntry(SurfacePoolEntry &entry)
+     {
+          if (entry.surface != nullptr)
+          {
+               SDL_FreeSurface(entry.surface);
+          }
+          else
+          {
+               SDL_SIMDFree(entry.pixels);
+          }
+     }
+
+     void takeEntry(SurfacePool &pool, size_t index)
+     {
+          pool.idleBytes -= classBytes(pool.idle[index].sizeClass);
+          pool.idle[index] = pool.idle.back();
+          pool.idle.pop_back();
+     }
+
+     void trimLocked(SurfacePool &pool, size_t maxIdleBytes)
+     {
+          while (pool.idleBytes > maxIdleBytes && !pool.idle.empty())
+          {
+               size_t oldest = 0;
+               for (size_t i = 1; i < pool.idle.size(); i++)
+               {
+                    if (pool.idle[i].released < pool.idle[oldest].released)
+                    {
+                         oldest = i;
+                    }
+               }
+               SurfacePoolEntry entry = pool.idle[oldest];
+               takeEntry(pool, oldest);
+               freeEntry(entry);
+               pool.evicted++;
+          }
+     }
+
+     // Put a recycled surface back to how SDL_CreateRGBSurfaceWithFormat
+     // leaves a new one
+     void resetSurface(SDL_Surface *surface)
+     {
+          SDL_SetClipRect(surface, NULL);
+          SDL_SetColorKey(surface, SDL_FALSE, 0);
+          SDL_SetSurfaceColorMod(surface, 255, 255, 255);
+          SDL_SetSurfaceAlphaMod(surface, 255);
+          SDL_SetSurfaceBlendMode(surface, SDL_ISPIXELFORMAT_ALPHA(surface->format->format) ? SDL_BLENDMODE_BLEND
+                                                                                            : SDL_BLENDMODE_NONE);
+     }
+
+     SDL_Surface *wrapBuffer(SurfacePool &pool, void *pixels, int width, int height, int pitch, Uint32 format)
+     {
+          SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormatFrom(pixels, width, height, SDL_BITSPERPIXEL(format), pitch,
+                                                                    format);
+          if (surface == nullptr)
+          {
+               return nullptr;
+          }
+          // As in alignedSurfaceCreate: SDL_FreeSurface may release the buffer
+          surface->flags &= ~SDL_PREALLOC;
+          surface->flags |= SDL_SIMD_ALIGNED;
+          surface->userdata = &pool;
+          return surface;
+     }
+}
+
+bool surfacePoolInit(SurfacePool &pool, size_t maxIdleBytes)
+{
+     pool.maxIdleBytes = maxIdleBytes;
+     pool.idle.clear();
+     pool.idleBytes = 0;
+     pool.releaseCount = 0;
+     pool.reused = 0;
+     pool.rewrapped = 0;
+     pool.allocated = 0;
+     pool.evicted = 0;
+     pool.lock = SDL_CreateMutex();
+     return pool.lock != nullptr;
+}
+
+SDL_Surface *surfacePoolAcquire(SurfacePool &pool, int width, int height, Uint32 format, bool clear)
+{
+     if (pool.lock == nullptr || width <= 0 || height <= 0 || SDL_ISPIXELFORMAT_FOURCC(format) ||
+         SDL_BITSPERPIXEL(format) < 8)
+     {
+          SDL_SetError("Unsupported pool surface");
+          return nullptr;
+     }
+     const int pitch = alignedSurfacePitch(width, format);
+     const size_t bytes = (size_t)pitch * height;
+     const int sizeClass = classOf(bytes);
+
+     SDL_LockMutex(pool.lock);
+     // Newest idle surface of the same shape, else a buffer of the same
+     // class (bare buffers first, so whole surfaces stay for their shape)
+     int exact = -1, sameClass = -1;
+     for (size_t i = 0; i < pool.idle.size(); i++)
+     {
+          const SurfacePoolEntry &entry = pool.idle[i];
+          if (entry.sizeClass != sizeClass)
+          {
+               continue;
+          }
+          // Palettes are not reset, so indexed surfaces always get a new header
+          if (entry.surface != nullptr && entry.surface->w == width && entry.surface->h == height &&
+              entry.surface->format->format == format && !SDL_ISPIXELFORMAT_INDEXED(format) &&
+              (exact < 0 || entry.released > pool.idle[exact].released))
+          {
+               exact = (int)i;
+          }
+          if (sameClass < 0 || (entry.surface == nullptr && pool.idle[sameClass].surface != nullptr))
+          {
+               sameClass = (int)i;
+          }
+     }
+     SurfacePoolEntry entry = {nullptr, nullptr, sizeClass, 0};
+     if (exact >= 0 || sameClass >= 0)
+     {
+          const int index = exact >= 0 ? exact : sameClass;
+          entry = pool.idle[index];
+          takeEntry(pool, index);
+          if (exact >= 0)
+          {
+               pool.reused++;
+          }
+          else
+          {
+               pool.rewrapped++;
+          }
+     }
+     else
+     {
+          pool.allocated++;
+     }
+     SDL_UnlockMutex(pool.lock);
+
+     SDL_Surface *surface = nullptr;
+     if (exact >= 0)
+     {
+          surface = entry.surface;
+          resetSurface(surface);
+     }
+     else
+     {
+          if (entry.surface != nullptr)
+          {
+               // Keep the buffer, free only the header
+               entry.surface->flags |= SDL_PREALLOC;
+               SDL_FreeSurface(entry.surface);
+          }
+          if (entry.pixels == nullptr)
+          {
+               entry.pixels = SDL_SIMDAlloc(classBytes(sizeClass));
+               if (entry.pixels == nullptr)
+               {
+                    SDL_OutOfMemory();
+                    return nullptr;
+               }
+               clear = true;
+          }
+          surface = wrapBuffer(pool, entry.pixels, width, height, pitch, format);
+          if (surface == nullptr)
+          {
+               SDL_SIMDFree(entry.pixels);
+               return nullptr;
+          }
+     }
+     if (clear)
+     {
+          // Streams past the cache for big surfaces, which the caller is
+          // about to overwrite anyway
+          memKernels().fill32(surface->pixels, 0, bytes / 4);
+     }
+     return surface;
+}
+
+void surfacePoolRelease(SurfacePool &pool, SDL_Surface *surface)
+{
+     if (surface == nullptr)
+     {
+          return;
+     }
+     if (pool.lock == nullptr || surface->userdata != &pool || surface->refcount > 1 || (surface->flags & SDL_PREALLOC) ||
+         (surface->flags & SDL_RLEACCEL) || surface->locked > 0)
+     {
+          SDL_FreeSurface(surface);
+          return;
+     }
+     SurfacePoolEntry entry = {surface, surface->pixels, classOf((size_t)surface->pitch * surface->h), 0};
+     SDL_LockMutex(pool.lock);
+     entry.released = ++pool.releaseCount;
+     pool.idle.push_back(entry);
+     pool.idleBytes += classBytes(entry.sizeClass);
+     trimLocked(pool, pool.maxIdleBytes);
+     SDL_UnlockMutex(pool.lock);
+}
+
+void surfacePoolTrim(SurfacePool &pool, size_t maxIdleBytes)
+{
+     if (pool.lock == nullptr)
+     {
+          return;
+     }
+     SDL_LockMutex(pool.lock);
+     trimLocked(pool, maxIdleBytes);
+     SDL_UnlockMutex(pool.lock);
+}
+
+void surfacePoolDestroy(SurfacePool &pool)
+{
+     if (pool.lock == nullptr)
+     {
+          return;
+     }
+     SDL_LockMutex(pool.lock);
+     trimLocked(pool, 0);
+     SDL_UnlockMutex(pool.lock);
+     SDL_DestroyMutex(pool.lock);
+     pool.lock = nullptr;
+}
@@ -0,0 +1,71 @@
+// Description:
+// Recycles transient SDL_Surfaces (screenshots, decode and conversion
+// scratch, text) so pixel buffers are reused instead of going back to
+// the heap after every frame. Long sessions that create and free
+// megabyte-sized surfaces at slightly different sizes otherwise fragment
+// the heap until the process holds far more memory than it uses.
+//
+// Released surfaces stay whole and are handed out again for the same
+// (w, h, format). When no idle surface matches, a buffer of the same size
+// class is reused under a new surface header, the oldest idle surface's
+// if need be. Size classes are four per power of two, so a buffer serves
+// any size up to 25% smaller than its capacity. Rows are SIMD aligned as
+// in aligned_surface. Idle memory is capped; the least recently released
+// buffers are freed to stay under it.
+//
+// Pool surfaces are ordinary SDL_Surfaces: SDL_FreeSurface on one is safe
+// and only loses the buffer to the pool. The pool marks its surfaces
+// through `userdata`, so callers must leave that alone. Every function is
+// thread-safe, so a surface may be released from a worker thread.
+// =============================================================================
+
+#ifndef SURFACE_POOL_H
+#define SURFACE_POOL_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct SurfacePoolEntry
+{
+     SDL_Surface *surface; // An idle pool surface, or nullptr for a bare buffer
+     void *pixels;
+     int sizeClass;
+     Uint64 released;      // Release order, for eviction
+};
+
+struct SurfacePool
+{
+     SDL_mutex *lock;
+     size_t maxIdleBytes;
+
+     // Guarded by lock
+     std::vector<SurfacePoolEntry> idle;
+     size_t idleBytes;
+     Uint64 releaseCount;
+
+     int reused;    // Acquires served by an idle surface of the same shape
+     int rewrapped; // Acquires served by an idle buffer of the same class
+     int allocated; // Acquires that allocated a new buffer
+     int evicted;   // Buffers freed to stay under maxIdleBytes
+};
+
+bool surfacePoolInit(SurfacePool &pool, size_t maxIdleBytes = 64 * 1024 * 1024);
+
+// A surface of `width` x `height` in `format`, zeroed when `clear` is set
+// (new SDL surfaces are always zeroed). nullptr with SDL_GetError() on
+// failure.
+SDL_Surface *surfacePoolAcquire(SurfacePool &pool, int width, int height, Uint32 format, bool clear = true);
+
+// Return a surface for reuse. Surfaces that did not come from this pool,
+// or that are still referenced elsewhere, are passed to SDL_FreeSurface.
+void surfacePoolRelease(SurfacePool &pool, SDL_Surface *surface);
+
+// Free idle buffers, least recently released first, until at most
+// `maxIdleBytes` stay idle
+void surfacePoolTrim(SurfacePool &pool, size_t maxIdleBytes);
+
+// Frees every idle buffer. Surfaces still acquired stay valid and are
+// released with SDL_FreeSurface.
+void surfacePoolDestroy(SurfacePool &pool);
+
+#endif // SURFACE_POOL_H
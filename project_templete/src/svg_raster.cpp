@@ -0,0 +1,245 @@
+#include "svg_raster.h"
+
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <filesystem>
+
+#include "file_commit.h"
+#include "texture_cache.h"
+
+namespace
+{
+     const Sint64 MAX_SVG_BYTES = 16 * 1024 * 1024;
+
+     // FNV-1a, continued from `hash`
+     Uint64 svgHashAppend(Uint64 hash, const void *data, size_t size)
+     {
+          const Uint8 *bytes = (const Uint8 *)data;
+          for (size_t i = 0; i < size; i++)
+          {
+               hash = (hash ^ bytes[i]) * 1099511628211ull;
+          }
+          return hash;
+     }
+
+     Uint64 rasterKey(const SvgRasterCache &cache, const SvgDocument &document, int width, int height)
+     {
+          // The pipeline version keeps rasters from an older SDL_image or
+          // cache layout apart once the caller bumps it
+          const Uint32 version = cache.disk != nullptr ? cache.disk->pipelineVersion : 0;
+          Uint64 hash = svgHashAppend(14695981039346656037ull, "svg", 4);
+          hash = svgHashAppend(hash, &version, sizeof(version));
+          hash = svgHashAppend(hash, &document.hash, sizeof(document.hash));
+          hash = svgHashAppend(hash, &width, sizeof(width));
+          return svgHashAppend(hash, &height, sizeof(height));
+     }
+
+     std::string rasterPath(const SvgRasterCache &cache, Uint64 key)
+     {
+          char name[64];
+          SDL_snprintf(name, sizeof(name), "%016llx.svg.tex", (unsigned long long)key);
+          return cache.disk->directory + name;
+     }
+
+     // Written under a name of the thread's own and committed, so neither
+     // a crash nor two workers making the same raster leave a truncated
+     // file under a real key
+     void storeRaster(const SvgRasterCache &cache, Uint64 key, SDL_Surface *surface)
+     {
+          const std::string path = rasterPath(cache, key);
+          char suffix[32];
+          SDL_snprintf(suffix, sizeof(suffix), ".%lu.tmp", SDL_ThreadID());
+          const std::string written = path + suffix;
+          fileCommit(written, path, textureCacheSave(written.c_str(), surface, 0, key));
+     }
+
+     SDL_Surface *loadRaster(const SvgRasterCache &cache, Uint64 key)
+     {
+          const std::string path = rasterPath(cache, key);
+          SDL_Surface *surface = textureCacheLoadSurface(path.c_str(), key, nullptr);
+          if (surface != nullptr)
+          {
+               // Recently used, for assetCacheTrim()
+               std::error_code error;
+               std::filesystem::last_write_time(std::filesystem::u8path(path),
+                                                std::filesystem::file_time_type::clock::now(), error);
+          }
+          return surface;
+     }
+
+     struct SvgBatch
+     {
+          SvgRasterCache *cache;
+          std::vector<SvgRasterRequest *> misses;
+     };
+
+     void rasterizeJob(void *data, int index)
+     {
+          SvgBatch &batch = *(SvgBatch *)data;
+          SvgRasterRequest &request = *batch.misses[index];
+          request.surface = svgRasterize(*batch.cache, *request.document, request.width, request.height);
+     }
+}
+
+bool svgDocumentLoad(SvgDocument &document, const AssetPack *pack, const std::string &path)
+{
+     document.name = path;
+     document.text.clear();
+     document.hash = 0;
+     SDL_RWops *rw = assetOpen(pack, path);
+     if (rw == nullptr)
+     {
+          return false;
+     }
+     const Sint64 size = SDL_RWsize(rw);
+     bool complete = size > 0 && size <= MAX_SVG_BYTES;
+     if (complete)
+     {
+          document.text.resize((size_t)size);
+          complete = SDL_RWread(rw, document.text.data(), 1, document.text.size()) == document.text.size();
+     }
+     SDL_RWclose(rw);
+     if (!complete)
+     {
+          document.text.clear();
+          SDL_SetError("Unable to read SVG %s", path.c_str());
+          return false;
+     }
+     document.hash = svgHashAppend(14695981039346656037ull, document.text.data(), document.text.size());
+     return true;
+}
+
+void svgDocumentFromMemory(SvgDocument &document, const char *name, const void *text, size_t size)
+{
+     document.name = name != nullptr ? name : "";
+     document.text.assign((const Uint8 *)text, (const Uint8 *)text + size);
+     document.hash = svgHashAppend(14695981039346656037ull, document.text.data(), document.text.size());
+}
+
+bool svgRasterCacheInit(SvgRasterCache &cache, AssetCache *disk)
+{
+     cache.disk = disk != nullptr && !disk->directory.empty() ? disk : nullptr;
+     cache.rasters.clear();
+     cache.memoryHits = 0;
+     cache.diskHits = 0;
+     cache.rasterized = 0;
+     cache.lock = SDL_CreateMutex();
+     return cache.lock != nullptr;
+}
+
+SDL_Surface *svgRasterize(SvgRasterCache &cache, const SvgDocument &document, int width, int height)
+{
+     if (document.text.empty() || width < 0 || height < 0 || (width == 0 && height == 0))
+     {
+          SDL_InvalidParamError(document.text.empty() ? "document" : "size");
+          return nullptr;
+     }
+     const Uint64 key = rasterKey(cache, document, width, height);
+     SDL_LockMutex(cache.lock);
+     auto found = cache.rasters.find(key);
+     if (found != cache.rasters.end())
+     {
+          cache.memoryHits++;
+          SDL_UnlockMutex(cache.lock);
+          return found->second;
+     }
+     SDL_UnlockMutex(cache.lock);
+
+     // Outside the lock: other threads keep hitting while this one works
+     bool fromDisk = false;
+     SDL_Surface *surface = cache.disk != nullptr ? loadRaster(cache, key) : nullptr;
+     if (surface != nullptr)
+     {
+          fromDisk = true;
+     }
+     else
+     {
+          SDL_RWops *rw = SDL_RWFromConstMem(document.text.data(), (int)document.text.size());
+          surface = rw != nullptr ? IMG_LoadSizedSVG_RW(rw, width, height) : nullptr;
+          if (rw != nullptr)
+          {
+               SDL_RWclose(rw); // IMG_LoadSizedSVG_RW leaves the stream open
+          }
+          if (surface == nullptr)
+          {
+               return nullptr;
+          }
+          if (cache.disk != nullptr)
+          {
+               storeRaster(cache, key, surface);
+          }
+     }
+
+     SDL_LockMutex(cache.lock);
+     auto inserted = cache.rasters.emplace(key, surface);
+     if (!inserted.second)
+     {
+          // Another thread made the same raster meanwhile; keep the first
+          SDL_FreeSurface(surface);
+          surface = inserted.first->second;
+     }
+     (fromDisk ? cache.diskHits : cache.rasterized)++;
+     SDL_UnlockMutex(cache.lock);
+     return surface;
+}
+
+void svgRasterizeBatch(SvgRasterCache &cache, JobSystem &jobs, SvgRasterRequest *requests, int count)
+{
+     // Hits are answered here; only the first request for each missing
+     // raster goes to a worker, the rest wait for it
+     SvgBatch batch = {&cache, {}};
+     std::vector<Uint64> pending;
+     std::vector<SvgRasterRequest *> repeats;
+     SDL_LockMutex(cache.lock);
+     for (int i = 0; i < count; i++)
+     {
+          SvgRasterRequest &request = requests[i];
+          request.surface = nullptr;
+          if (request.document == nullptr || request.document->text.empty())
+          {
+               continue;
+          }
+          const Uint64 key = rasterKey(cache, *request.document, request.width, request.height);
+          auto found = cache.rasters.find(key);
+          if (found != cache.rasters.end())
+          {
+               request.surface = found->second;
+               cache.memoryHits++;
+          }
+          else if (std::find(pending.begin(), pending.end(), key) != pending.end())
+          {
+               repeats.push_back(&request);
+          }
+          else
+          {
+               pending.push_back(key);
+               batch.misses.push_back(&request);
+          }
+     }
+     SDL_UnlockMutex(cache.lock);
+
+     if (!batch.misses.empty())
+     {
+          JobCounter counter = {};
+          jobSystemSubmitRange(jobs, rasterizeJob, &batch, (int)batch.misses.size(), &counter);
+          jobSystemWait(jobs, counter);
+     }
+     for (SvgRasterRequest *request : repeats)
+     {
+          request->surface = svgRasterize(cache, *request->document, request->width, request->height);
+     }
+}
+
+void svgRasterCacheDestroy(SvgRasterCache &cache)
+{
+     for (auto &raster : cache.rasters)
+     {
+          SDL_FreeSurface(raster.second);
+     }
+     cache.rasters.clear();
+     if (cache.lock != nullptr)
+     {
+          SDL_DestroyMutex(cache.lock);
+          cache.lock = nullptr;
+     }
+}
@@ -0,0 +1,84 @@
+// Description:
+// Cached SVG rasters for icons used at many sizes and DPI scales. Each
+// IMG_LoadSizedSVG_RW call reads the file, parses the document and
+// rasterizes it, so a UI asking for the same icons at 16, 24 and 32
+// points on displays at 100% and 150% pays for all three steps every time
+// and again on every launch.
+//
+// An SvgDocument reads the file once and keeps its text and a hash of it.
+// An SvgRasterCache keeps every raster made from a document by (hash,
+// width, height) in memory, and, given an AssetCache, as texture_cache
+// files in its directory under the same key (trimmed with the rest by
+// assetCacheTrim), so a warm start loads rows instead of rasterizing.
+// svgRasterizeBatch() makes the missing rasters of a whole set on the
+// job system's workers; SDL_image's SVG loader keeps no shared state, so
+// the rasterizations run side by side.
+//
+// SDL_image does not expose its parsed document, so a miss still parses
+// the text (from memory); the cache is what makes repeats free. Sizes are
+// in pixels: multiply the logical size by the display scale first. A
+// width or height of 0 keeps the document's aspect, as in SDL_image.
+// =============================================================================
+
+#ifndef SVG_RASTER_H
+#define SVG_RASTER_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "asset_cache.h"
+#include "asset_pack.h"
+#include "job_system.h"
+
+struct SvgDocument
+{
+     std::string name;
+     std::vector<Uint8> text;
+     Uint64 hash; // Of the text, the part of every raster's key that names the document
+};
+
+struct SvgRasterRequest
+{
+     const SvgDocument *document;
+     int width, height;    // Pixels; 0 keeps the aspect
+     SDL_Surface *surface; // Set by svgRasterizeBatch(), owned by the cache; nullptr on failure
+};
+
+struct SvgRasterCache
+{
+     AssetCache *disk; // nullptr keeps rasters in memory only
+     SDL_mutex *lock;
+     std::unordered_map<Uint64, SDL_Surface *> rasters; // By key, guarded by lock
+
+     // Guarded by lock
+     int memoryHits;
+     int diskHits;
+     int rasterized;
+};
+
+// Read `path` through `pack` (or the filesystem when it has no such file);
+// false if it can't be read
+bool svgDocumentLoad(SvgDocument &document, const AssetPack *pack, const std::string &path);
+
+// A document over a copy of `size` bytes of SVG text
+void svgDocumentFromMemory(SvgDocument &document, const char *name, const void *text, size_t size);
+
+// `disk` (may be nullptr) must stay open while the cache is in use
+bool svgRasterCacheInit(SvgRasterCache &cache, AssetCache *disk);
+
+// The raster of `document` at width x height, from memory, the disk cache
+// or SDL_image, in that order. The cache owns the surface, which stays
+// valid until svgRasterCacheDestroy(). nullptr with SDL's error set when
+// the document does not rasterize. Safe from any thread
+SDL_Surface *svgRasterize(SvgRasterCache &cache, const SvgDocument &document, int width, int height);
+
+// svgRasterize() every request, the misses in parallel on `jobs`; returns
+// when all are done
+void svgRasterizeBatch(SvgRasterCache &cache, JobSystem &jobs, SvgRasterRequest *requests, int count);
+
+// Free every raster
+void svgRasterCacheDestroy(SvgRasterCache &cache);
+
+#endif // SVG_RASTER_H
@@ -0,0 +1,133 @@
+#include "swept_collision.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define SWEPT_COLLISION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+     // Where on one axis the entity, relative to the target, is inside it:
+     // the open interval (enter, exit) of the tick's time, empty when it
+     // never is. `rel` is the entity's position minus the target's at the
+     // start of the tick, `d` how far that moves over it, and the overlap
+     // is strict in (lo, hi)
+     void sweepAxis(float rel, float d, float lo, float hi, float &enter, float &exit)
+     {
+          if (d == 0.0f)
+          {
+               const bool inside = rel > lo && rel < hi;
+               enter = inside ? -INFINITY : INFINITY;
+               exit = inside ? INFINITY : -INFINITY;
+               return;
+          }
+          const float a = (lo - rel) / d, b = (hi - rel) / d;
+          enter = SDL_min(a, b);
+          exit = SDL_max(a, b);
+     }
+
+     int sweepOne(const float *x0, const float *y0, const float *x1, const float *y1, int i, float width,
+                  float height, const SDL_FRect &from, const SDL_FRect &to, float &time)
+     {
+          float enterX, exitX, enterY, exitY;
+          const float relX = x0[i] - from.x, relY = y0[i] - from.y;
+          sweepAxis(relX, (x1[i] - to.x) - relX, -width, to.w, enterX, exitX);
+          sweepAxis(relY, (y1[i] - to.y) - relY, -height, to.h, enterY, exitY);
+          const float enter = SDL_max(enterX, enterY), exit = SDL_min(exitX, exitY);
+          time = SDL_max(enter, 0.0f);
+          return enter < exit && enter < 1.0f && exit > 0.0f;
+     }
+
+#if defined(SWEPT_COLLISION_SSE2)
+     inline __m128 sweepSelect(__m128 mask, __m128 a, __m128 b)
+     {
+          return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+     }
+
+     // sweepAxis() on four lanes, with the same arithmetic
+     void sweepAxis4(__m128 rel, __m128 d, __m128 lo, __m128 hi, __m128 &enter, __m128 &exit)
+     {
+          const __m128 inf = _mm_set1_ps(INFINITY), negInf = _mm_set1_ps(-INFINITY);
+          const __m128 still = _mm_cmpeq_ps(d, _mm_setzero_ps());
+          const __m128 safe = sweepSelect(still, _mm_set1_ps(1.0f), d);
+          const __m128 a = _mm_div_ps(_mm_sub_ps(lo, rel), safe), b = _mm_div_ps(_mm_sub_ps(hi, rel), safe);
+          const __m128 inside = _mm_and_ps(_mm_cmpgt_ps(rel, lo), _mm_cmplt_ps(rel, hi));
+          enter = sweepSelect(still, sweepSelect(inside, negInf, inf), _mm_min_ps(a, b));
+          exit = sweepSelect(still, sweepSelect(inside, inf, negInf), _mm_max_ps(a, b));
+     }
+#endif
+
+     unsigned sweepAliveMask(const Uint8 *alive, int i)
+     {
+          if (alive == nullptr)
+          {
+               return 0xF;
+          }
+          return (alive[i] != 0) | (alive[i + 1] != 0) << 1 | (alive[i + 2] != 0) << 2 | (alive[i + 3] != 0) << 3;
+     }
+}
+
+int sweepRects(const float *x0, const float *y0, const float *x1, const float *y1, const Uint8 *alive, int count,
+               float width, float height, const SDL_FRect &from, const SDL_FRect &to, int *hits, float *times)
+{
+     if (count <= 0 || width <= 0.0f || height <= 0.0f || SDL_FRectEmpty(&to))
+     {
+          return 0;
+     }
+
+     int n = 0;
+     int i = 0;
+#if defined(SWEPT_COLLISION_SSE2)
+     const __m128 fromX = _mm_set1_ps(from.x), fromY = _mm_set1_ps(from.y);
+     const __m128 toX = _mm_set1_ps(to.x), toY = _mm_set1_ps(to.y);
+     const __m128 loX = _mm_set1_ps(-width), hiX = _mm_set1_ps(to.w);
+     const __m128 loY = _mm_set1_ps(-height), hiY = _mm_set1_ps(to.h);
+     const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+     float laneTimes[4];
+     for (; i + 4 <= count; i += 4)
+     {
+          const __m128 relX = _mm_sub_ps(_mm_loadu_ps(x0 + i), fromX);
+          const __m128 relY = _mm_sub_ps(_mm_loadu_ps(y0 + i), fromY);
+          const __m128 dX = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(x1 + i), toX), relX);
+          const __m128 dY = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(y1 + i), toY), relY);
+          __m128 enterX, exitX, enterY, exitY;
+          sweepAxis4(relX, dX, loX, hiX, enterX, exitX);
+          sweepAxis4(relY, dY, loY, hiY, enterY, exitY);
+          const __m128 enter = _mm_max_ps(enterX, enterY), exit = _mm_min_ps(exitX, exitY);
+          const __m128 hit = _mm_and_ps(_mm_cmplt_ps(enter, exit),
+                                        _mm_and_ps(_mm_cmplt_ps(enter, one), _mm_cmpgt_ps(exit, zero)));
+          const unsigned mask = (unsigned)_mm_movemask_ps(hit) & sweepAliveMask(alive, i);
+          if (mask == 0)
+          {
+               continue; // The usual case: nothing near the target
+          }
+          _mm_storeu_ps(laneTimes, _mm_max_ps(enter, zero));
+          for (int lane = 0; lane < 4; lane++)
+          {
+               if (mask & (1u << lane))
+               {
+                    if (times != nullptr)
+                    {
+                         times[n] = laneTimes[lane];
+                    }
+                    hits[n++] = i + lane;
+               }
+          }
+     }
+#endif
+     for (; i < count; i++)
+     {
+          float time;
+          if ((alive == nullptr || alive[i]) && sweepOne(x0, y0, x1, y1, i, width, height, from, to, time))
+          {
+               if (times != nullptr)
+               {
+                    times[n] = time;
+               }
+               hits[n++] = i;
+          }
+     }
+     return n;
+}
@@ -0,0 +1,242 @@
+#include "symbol_table.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "file_commit.h"
+
+namespace
+{
+     const char *const USAGE_FILE = "startup_libraries.txt";
+     const Sint64 MAX_USAGE_BYTES = 64 * 1024;
+
+     bool contains(const std::vector<std::string> &tags, const char *tag)
+     {
+          return std::find(tags.begin(), tags.end(), tag) != tags.end();
+     }
+
+     void clearSlots(SymbolLibrary &library)
+     {
+          for (int i = 0; i < library.bindingCount; i++)
+          {
+               *library.bindings[i].slot = nullptr;
+          }
+          library.resolved = 0;
+     }
+
+     // One tag per line; blank lines and anything unreadable are ignored
+     void readUsage(SymbolUsage &usage)
+     {
+          SDL_RWops *rw = SDL_RWFromFile(usage.path.c_str(), "rb");
+          if (rw == nullptr)
+          {
+               return; // First launch
+          }
+          const Sint64 size = SDL_RWsize(rw);
+          std::string text;
+          if (size > 0 && size <= MAX_USAGE_BYTES)
+          {
+               text.resize((size_t)size);
+               text.resize(SDL_RWread(rw, &text[0], 1, text.size()));
+          }
+          SDL_RWclose(rw);
+          usage.hasRecord = true;
+
+          size_t start = 0;
+          while (start < text.size())
+          {
+               size_t end = text.find('\n', start);
+               end = end == std::string::npos ? text.size() : end;
+               std::string tag = text.substr(start, end - start);
+               if (!tag.empty() && tag.back() == '\r')
+               {
+                    tag.pop_back();
+               }
+               if (!tag.empty() && !contains(usage.previous, tag.c_str()))
+               {
+                    usage.previous.push_back(tag);
+               }
+               start = end + 1;
+          }
+     }
+}
+
+void symbolLibraryInit(SymbolLibrary &library, const char *tag, const char *const *files,
+                       const SymbolBinding *bindings, int bindingCount)
+{
+     library.tag = tag;
+     library.files = files;
+     library.bindings = bindings;
+     library.bindingCount = bindingCount;
+     library.handle = nullptr;
+     library.attempted = false;
+     library.resolved = 0;
+     library.error.clear();
+     clearSlots(library);
+}
+
+bool symbolLibraryLoad(SymbolLibrary &library, SymbolUsage *usage)
+{
+     if (library.attempted)
+     {
+          if (library.handle == nullptr)
+          {
+               SDL_SetError("%s", library.error.c_str());
+               return false;
+          }
+          return true;
+     }
+     library.attempted = true;
+     library.error.clear();
+
+     for (const char *const *file = library.files; *file != nullptr && library.handle == nullptr; file++)
+     {
+          library.handle = SDL_LoadObject(*file);
+     }
+     if (library.handle == nullptr)
+     {
+          library.error = std::string("Unable to load ") + library.tag + ": " + SDL_GetError();
+          SDL_SetError("%s", library.error.c_str());
+          return false;
+     }
+
+     // SDL_LoadFunction sets the error on every miss; collect the misses
+     // and report them once
+     std::string missing;
+     for (int i = 0; i < library.bindingCount; i++)
+     {
+          const SymbolBinding &binding = library.bindings[i];
+          *binding.slot = SDL_LoadFunction(library.handle, binding.name);
+          if (*binding.slot != nullptr)
+          {
+               library.resolved++;
+          }
+          else if (!binding.optional)
+          {
+               missing += missing.empty() ? " " : ", ";
+               missing += binding.name;
+          }
+     }
+     if (!missing.empty())
+     {
+          library.error = std::string(library.tag) + " lacks" + missing;
+          SDL_UnloadObject(library.handle);
+          library.handle = nullptr;
+          clearSlots(library);
+          SDL_SetError("%s", library.error.c_str());
+          return false;
+     }
+
+     if (usage != nullptr)
+     {
+          symbolUsageNote(*usage, library.tag);
+     }
+     return true;
+}
+
+void symbolLibraryUnload(SymbolLibrary &library)
+{
+     clearSlots(library);
+     if (library.handle != nullptr)
+     {
+          SDL_UnloadObject(library.handle);
+          library.handle = nullptr;
+     }
+     library.attempted = false;
+     library.error.clear();
+}
+
+bool symbolUsageOpen(SymbolUsage &usage, const char *org, const char *app)
+{
+     usage.path.clear();
+     usage.hasRecord = false;
+     usage.previous.clear();
+     usage.current.clear();
+     usage.recording = true;
+     usage.lock = SDL_CreateMutex();
+     if (!SDL_GetHintBoolean(SYMBOL_USAGE_HINT, SDL_TRUE))
+     {
+          return false;
+     }
+
+     char *pref = SDL_GetPrefPath(org, app);
+     if (pref == nullptr)
+     {
+          std::cerr << "Startup library record disabled, no preference path! SDL Error: " << SDL_GetError()
+                    << std::endl;
+          return false;
+     }
+     usage.path = std::string(pref) + USAGE_FILE;
+     SDL_free(pref);
+     readUsage(usage);
+     return true;
+}
+
+bool symbolUsageNeeded(const SymbolUsage &usage, const char *tag)
+{
+     return contains(usage.previous, tag);
+}
+
+void symbolUsageNote(SymbolUsage &usage, const char *tag)
+{
+     SDL_LockMutex(usage.lock);
+     if (usage.recording && !contains(usage.current, tag))
+     {
+          usage.current.push_back(tag);
+     }
+     SDL_UnlockMutex(usage.lock);
+}
+
+int symbolPreload(SymbolLibrary *const *libraries, int count, SymbolUsage &usage)
+{
+     int loaded = 0;
+     for (int i = 0; i < count; i++)
+     {
+          if (symbolUsageNeeded(usage, libraries[i]->tag) && symbolLibraryLoad(*libraries[i], &usage))
+          {
+               loaded++;
+          }
+     }
+     return loaded;
+}
+
+bool symbolUsageSave(SymbolUsage &usage)
+{
+     SDL_LockMutex(usage.lock);
+     usage.recording = false;
+     std::vector<std::string> tags = usage.current;
+     SDL_UnlockMutex(usage.lock);
+     if (usage.path.empty())
+     {
+          return false;
+     }
+
+     std::sort(tags.begin(), tags.end());
+     std::vector<std::string> previous = usage.previous;
+     std::sort(previous.begin(), previous.end());
+     if (usage.hasRecord && tags == previous)
+     {
+          return true; // Unchanged; skip the write
+     }
+
+     std::string text;
+     for (const std::string &tag : tags)
+     {
+          text += tag;
+          text += '\n';
+     }
+     // Replaced whole, so a crash mid-write leaves the previous record
+     // rather than half of one
+     return fileReplace(usage.path, text.data(), text.size());
+}
+
+void symbolUsageClose(SymbolUsage &usage)
+{
+     if (usage.lock != nullptr)
+     {
+          SDL_DestroyMutex(usage.lock);
+          usage.lock = nullptr;
+     }
+     usage.previous.clear();
+     usage.current.clear();
+}
@@ -0,0 +1,95 @@
+// Description:
+// Optional libraries loaded with SDL_LoadObject, resolved a whole table at
+// a time. Code that binds a library one SDL_LoadFunction call at a time
+// ends up with half a table when a symbol is missing, every miss
+// overwriting SDL's error, and no record of which libraries were needed.
+// A SymbolLibrary names the candidate files and every symbol with the slot
+// it fills. symbolLibraryLoad() opens the first file that loads, resolves
+// the table in one pass and either fills every required slot or clears
+// them all and unloads, with one error naming everything missing.
+//
+// A SymbolUsage remembers which libraries startup needed, kept under
+// SDL_GetPrefPath. Loads (and codec inits, see asset_loader.h) note their
+// tag in it, and symbolUsageSave() writes the record once startup is
+// over. On the next launch symbolPreload() loads just those, ahead of
+// first use, and everything else is left to load on demand, so libraries
+// (and codecs) that were never used are never loaded.
+//
+// Setting SYMBOL_USAGE_HINT to "0" turns the record off; nothing is then
+// preloaded.
+// =============================================================================
+
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#define SYMBOL_USAGE_HINT "CATCH_SYMBOL_USAGE"
+
+struct SymbolBinding
+{
+     const char *name;
+     void **slot;   // Set to the symbol, nullptr when missing
+     bool optional; // A missing optional symbol does not fail the load
+};
+
+struct SymbolLibrary
+{
+     const char *tag;          // Its name in the usage record, e.g. "avrt"
+     const char *const *files; // Candidates, tried in order; ends with nullptr
+     const SymbolBinding *bindings;
+     int bindingCount;
+
+     void *handle;    // From SDL_LoadObject, nullptr when not loaded
+     bool attempted;  // A load was tried; not retried until unloaded
+     int resolved;    // Bindings found, optional ones included
+     std::string error;
+};
+
+struct SymbolUsage
+{
+     std::string path;                  // Empty when disabled
+     bool hasRecord;                    // An earlier launch left a record
+     std::vector<std::string> previous; // Tags the last launch recorded
+     std::vector<std::string> current;  // Tags noted this launch, guarded by lock
+     bool recording;                    // Until symbolUsageSave(), guarded by lock
+     SDL_mutex *lock;
+};
+
+// An unloaded library over `files` (nullptr-terminated) and `bindings`
+void symbolLibraryInit(SymbolLibrary &library, const char *tag, const char *const *files,
+                       const SymbolBinding *bindings, int bindingCount);
+
+// Load and resolve the whole table unless a load was tried already; notes
+// the tag in `usage` (if given) on success. False with SDL's error set,
+// and library.error, when no file loads or a required symbol is missing
+bool symbolLibraryLoad(SymbolLibrary &library, SymbolUsage *usage = nullptr);
+
+// Clear the slots and unload; a later symbolLibraryLoad() tries again
+void symbolLibraryUnload(SymbolLibrary &library);
+
+// Read the record in <pref path> for `org` and `app`; false (and the
+// record disabled, nothing preloaded) if there is no preference path
+bool symbolUsageOpen(SymbolUsage &usage, const char *org, const char *app);
+
+// The last launch needed `tag` during startup
+bool symbolUsageNeeded(const SymbolUsage &usage, const char *tag);
+
+// Record that this launch needed `tag`; safe from any thread
+void symbolUsageNote(SymbolUsage &usage, const char *tag);
+
+// Load the libraries the last launch needed; the others stay unloaded.
+// Returns how many loaded
+int symbolPreload(SymbolLibrary *const *libraries, int count, SymbolUsage &usage);
+
+// Write what this launch has noted so far as the record for the next one,
+// unless it is unchanged. Call when startup is over; later notes are kept
+// out of the record. The file is replaced whole, through a temporary
+// file and a rename
+bool symbolUsageSave(SymbolUsage &usage);
+
+void symbolUsageClose(SymbolUsage &usage);
+
+#endif // SYMBOL_TABLE_H
@@ -0,0 +1,438 @@
+#include "synth_voice.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+     // Long enough that the mixer rarely wraps the carrier mid-callback
+     const int SYNTH_CARRIER_FRAMES = 4096;
+     const int SYNTH_SCRATCH_FRAMES = 1024;
+     // Pitch glide and vibrato are evaluated this often, in frames
+     const int SYNTH_CONTROL_FRAMES = 32;
+
+     int synthFloatBits(float value)
+     {
+          int bits;
+          std::memcpy(&bits, &value, sizeof(bits));
+          return bits;
+     }
+
+     float synthBitsFloat(int bits)
+     {
+          float value;
+          std::memcpy(&value, &bits, sizeof(value));
+          return value;
+     }
+
+     // Band-limited step correction for the saw and square edges
+     float synthBlep(float t, float dt)
+     {
+          if (t < dt)
+          {
+               t /= dt;
+               return t + t - t * t - 1.0f;
+          }
+          if (t > 1.0f - dt)
+          {
+               t = (t - 1.0f) / dt;
+               return t * t + t + t + 1.0f;
+          }
+          return 0.0f;
+     }
+
+     // Envelope level at voice.time, and whether the voice has ended
+     float synthEnvelope(SynthVoice &voice, bool &ended)
+     {
+          const SynthPatch &patch = voice.patch;
+          const float t = voice.time;
+          ended = false;
+          if (voice.releaseTime < 0.0f && (SDL_AtomicGet(&voice.released) || (patch.hold >= 0.0f && t >= patch.hold)))
+          {
+               voice.releaseTime = t;
+               voice.releaseLevel = voice.level;
+          }
+          if (voice.releaseTime >= 0.0f)
+          {
+               const float into = t - voice.releaseTime;
+               if (into >= patch.release)
+               {
+                    ended = true;
+                    return 0.0f;
+               }
+               return voice.releaseLevel * (1.0f - into / patch.release);
+          }
+          if (t < patch.attack)
+          {
+               return t / patch.attack;
+          }
+          if (t < patch.attack + patch.decay)
+          {
+               return 1.0f - (1.0f - patch.sustain) * (t - patch.attack) / patch.decay;
+          }
+          ended = patch.sustain <= 0.0f; // Nothing left to hold
+          return patch.sustain;
+     }
+
+     void synthOscillate(SynthVoice &voice, float *out, int frames, int rate)
+     {
+          const SynthPatch &patch = voice.patch;
+          for (int first = 0; first < frames; first += SYNTH_CONTROL_FRAMES)
+          {
+               const int count = SDL_min(SYNTH_CONTROL_FRAMES, frames - first);
+               const float control = voice.time + (float)first / rate;
+               float hz = voice.frequency * SDL_powf(2.0f, patch.glide * control);
+               if (patch.vibratoHz > 0.0f)
+               {
+                    const float lfo = SDL_sinf((float)(2.0 * M_PI * voice.lfoPhase));
+                    hz *= SDL_powf(2.0f, patch.vibratoDepth * lfo / 12.0f);
+                    voice.lfoPhase += (double)patch.vibratoHz * count / rate;
+                    voice.lfoPhase -= SDL_floor(voice.lfoPhase);
+               }
+               const float dt = SDL_min(hz / rate, 0.5f);
+               const float modDt = dt * patch.fmRatio;
+               for (int i = first; i < first + count; i++)
+               {
+                    float t = (float)voice.phase;
+                    if (patch.fmIndex > 0.0f)
+                    {
+                         t += patch.fmIndex * SDL_sinf((float)(2.0 * M_PI * voice.modPhase));
+                         t -= SDL_floorf(t);
+                         voice.modPhase += modDt;
+                         voice.modPhase -= SDL_floor(voice.modPhase);
+                    }
+                    float sample;
+                    switch (patch.waveform)
+                    {
+                    case SYNTH_SQUARE:
+                    {
+                         const float half = t + 0.5f >= 1.0f ? t - 0.5f : t + 0.5f;
+                         sample = (t < 0.5f ? 1.0f : -1.0f) + synthBlep(t, dt) - synthBlep(half, dt);
+                         break;
+                    }
+                    case SYNTH_SAW:
+                         sample = 2.0f * t - 1.0f - synthBlep(t, dt);
+                         break;
+                    case SYNTH_TRIANGLE:
+                         sample = 4.0f * SDL_fabsf(t - 0.5f) - 1.0f;
+                         break;
+                    case SYNTH_NOISE:
+                         sample = voice.noiseValue;
+                         break;
+                    default:
+                         sample = SDL_sinf((float)(2.0 * M_PI) * t);
+                         break;
+                    }
+                    out[i] = sample;
+
+                    voice.phase += dt;
+                    if (voice.phase >= 1.0)
+                    {
+                         voice.phase -= 1.0;
+                         // xorshift32, a new level every period
+                         Uint32 &x = voice.noiseState;
+                         x ^= x << 13;
+                         x ^= x >> 17;
+                         x ^= x << 5;
+                         voice.noiseValue = (float)(x >> 8) * (2.0f / 16777216.0f) - 1.0f;
+                    }
+               }
+          }
+     }
+
+     // Oscillator or generator through the envelope, filter and gain into
+     // `out`; true once the voice has ended
+     bool synthRender(SynthVoice &voice, float *out, int frames, int rate)
+     {
+          const SynthPatch &patch = voice.patch;
+          const float targetHz = synthBitsFloat(SDL_AtomicGet(&voice.frequencyBits));
+          const float targetGain = synthBitsFloat(SDL_AtomicGet(&voice.gainBits)) * patch.gain;
+          // Changes ramp over the block rather than stepping
+          voice.frequency += ((targetHz > 0.0f ? targetHz : patch.frequency) - voice.frequency) * 0.5f;
+
+          if (patch.generator != nullptr)
+          {
+               patch.generator(patch.userdata, out, frames, rate);
+          }
+          else
+          {
+               synthOscillate(voice, out, frames, rate);
+          }
+
+          const float alpha = patch.cutoff > 0.0f ? 1.0f - SDL_expf(-2.0f * (float)M_PI * patch.cutoff / rate) : 1.0f;
+          const float gainStep = (targetGain - voice.gain) / frames;
+          const float secondsPerFrame = 1.0f / rate;
+          bool ended = false;
+          for (int i = 0; i < frames; i++)
+          {
+               voice.level = ended ? 0.0f : synthEnvelope(voice, ended);
+               voice.lowpass += (out[i] - voice.lowpass) * alpha;
+               voice.gain += gainStep;
+               out[i] = voice.lowpass * voice.level * voice.gain;
+               voice.time += secondsPerFrame;
+          }
+          return ended;
+     }
+
+     // Mixer thread: the channel's chunk is silence, so this writes the
+     // voice over it and the mixer applies volume and fades after
+     void synthEffect(int channel, void *stream, int len, void *udata)
+     {
+          (void)channel;
+          SynthVoice &voice = *(SynthVoice *)udata;
+          SynthBank &bank = *voice.bank;
+          const int frames = len / bank.frameBytes;
+          float *scratch = bank.scratch.data();
+          Uint8 *out = (Uint8 *)stream;
+          for (int first = 0; first < frames; first += SYNTH_SCRATCH_FRAMES)
+          {
+               const int count = SDL_min(SYNTH_SCRATCH_FRAMES, frames - first);
+               if (SDL_AtomicGet(&voice.finished))
+               {
+                    std::memset(scratch, 0, count * sizeof(float));
+               }
+               else if (synthRender(voice, scratch, count, bank.rate))
+               {
+                    SDL_AtomicSet(&voice.finished, 1);
+               }
+
+               if (bank.format == AUDIO_F32SYS)
+               {
+                    float *samples = (float *)out;
+                    for (int i = 0; i < count; i++)
+                    {
+                         for (int c = 0; c < bank.channels; c++)
+                         {
+                              *samples++ = scratch[i];
+                         }
+                    }
+               }
+               else
+               {
+                    Sint16 *samples = (Sint16 *)out;
+                    for (int i = 0; i < count; i++)
+                    {
+                         const float clamped = SDL_clamp(scratch[i], -1.0f, 1.0f);
+                         const Sint16 value = (Sint16)(clamped * 32767.0f);
+                         for (int c = 0; c < bank.channels; c++)
+                         {
+                              *samples++ = value;
+                         }
+                    }
+               }
+               out += count * bank.frameBytes;
+          }
+     }
+
+     // Runs when the channel halts or is reused, from any thread
+     void synthEffectDone(int channel, void *udata)
+     {
+          (void)channel;
+          SDL_AtomicSet(&((SynthVoice *)udata)->attached, 0);
+     }
+
+     int synthFreeVoice(SynthBank &bank)
+     {
+          for (size_t i = 0; i < bank.voices.size(); i++)
+          {
+               if (!SDL_AtomicGet(&bank.voices[i].attached))
+               {
+                    return (int)i;
+               }
+          }
+          return -1;
+     }
+
+     // The voice is detached, so nothing else reads it while it is reset
+     bool synthStart(SynthBank &bank, int index, const SynthPatch &patch, int channel)
+     {
+          SynthVoice &voice = bank.voices[index];
+          voice.patch = patch;
+          voice.patch.attack = SDL_max(patch.attack, 0.0f);
+          voice.patch.decay = SDL_max(patch.decay, 0.0f);
+          voice.patch.release = SDL_max(patch.release, 0.001f);
+          voice.patch.sustain = SDL_clamp(patch.sustain, 0.0f, 1.0f);
+          voice.time = 0.0f;
+          voice.level = 0.0f;
+          voice.releaseLevel = 0.0f;
+          voice.releaseTime = -1.0f;
+          voice.phase = voice.modPhase = voice.lfoPhase = 0.0;
+          voice.noiseValue = 0.0f;
+          voice.lowpass = 0.0f;
+          voice.gain = patch.gain;
+          voice.frequency = patch.frequency;
+          SDL_AtomicSet(&voice.finished, 0);
+          SDL_AtomicSet(&voice.released, 0);
+          SDL_AtomicSet(&voice.frequencyBits, 0);
+          SDL_AtomicSet(&voice.gainBits, synthFloatBits(1.0f));
+
+          // Marked first: a halt right after registering clears it again
+          SDL_AtomicSet(&voice.attached, 1);
+          if (Mix_RegisterEffect(channel, synthEffect, synthEffectDone, &voice) == 0)
+          {
+               SDL_AtomicSet(&voice.attached, 0);
+               std::cerr << "Unable to attach synth voice! SDL_mixer Error: " << Mix_GetError() << std::endl;
+               return false;
+          }
+          voice.channel = channel;
+          return true;
+     }
+
+     SynthVoice *synthVoice(SynthBank &bank, int voice)
+     {
+          return voice >= 0 && voice < (int)bank.voices.size() ? &bank.voices[voice] : nullptr;
+     }
+}
+
+SynthPatch synthPatchDefaults()
+{
+     SynthPatch patch;
+     patch.waveform = SYNTH_SINE;
+     patch.frequency = 880.0f;
+     patch.glide = 0.0f;
+     patch.vibratoHz = 0.0f;
+     patch.vibratoDepth = 0.0f;
+     patch.fmRatio = 1.0f;
+     patch.fmIndex = 0.0f;
+     patch.cutoff = 0.0f;
+     patch.attack = 0.002f;
+     patch.decay = 0.08f;
+     patch.sustain = 0.0f;
+     patch.release = 0.02f;
+     patch.hold = -1.0f;
+     patch.gain = 0.35f;
+     patch.generator = nullptr;
+     patch.userdata = nullptr;
+     return patch;
+}
+
+bool synthBankInit(SynthBank &bank, int voiceCount)
+{
+     bank.voices.clear();
+     int freq, channels;
+     Uint16 format;
+     if (Mix_QuerySpec(&freq, &format, &channels) == 0)
+     {
+          std::cerr << "Synth voices need an open mixer! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          return false;
+     }
+     if (format != AUDIO_S16SYS && format != AUDIO_F32SYS)
+     {
+          std::cerr << "Synth voices need a 16-bit or float mixer, not format " << format << std::endl;
+          return false;
+     }
+     bank.rate = freq;
+     bank.channels = channels;
+     bank.format = format;
+     bank.frameBytes = SDL_AUDIO_BITSIZE(format) / 8 * channels;
+     bank.scratch.assign(SYNTH_SCRATCH_FRAMES, 0.0f);
+
+     bank.silence.assign((size_t)SYNTH_CARRIER_FRAMES * bank.frameBytes, 0);
+     bank.carrier.allocated = 0;
+     bank.carrier.abuf = bank.silence.data();
+     bank.carrier.alen = (Uint32)bank.silence.size();
+     bank.carrier.volume = MIX_MAX_VOLUME;
+
+     bank.voices.resize(SDL_max(voiceCount, 1));
+     for (size_t i = 0; i < bank.voices.size(); i++)
+     {
+          SynthVoice &voice = bank.voices[i];
+          voice.bank = &bank;
+          voice.channel = -1;
+          voice.noiseState = 0x9E3779B9u + (Uint32)i * 0x85EBCA6Bu;
+          SDL_AtomicSet(&voice.attached, 0);
+          SDL_AtomicSet(&voice.finished, 0);
+          SDL_AtomicSet(&voice.released, 0);
+     }
+     return true;
+}
+
+int synthPlay(SynthBank &bank, const SynthPatch &patch, int channel)
+{
+     const int index = synthFreeVoice(bank);
+     if (index < 0)
+     {
+          return -1;
+     }
+     // The carrier loops forever; synthBankUpdate() ends it
+     const int played = Mix_PlayChannel(channel, &bank.carrier, -1);
+     if (played < 0)
+     {
+          return -1;
+     }
+     if (!synthStart(bank, index, patch, played))
+     {
+          Mix_HaltChannel(played);
+          return -1;
+     }
+     return index;
+}
+
+int synthAttach(SynthBank &bank, const SynthPatch &patch, int channel)
+{
+     if (channel < 0 || !Mix_Playing(channel) || Mix_GetChunk(channel) != &bank.carrier)
+     {
+          std::cerr << "Synth voices need a channel playing the bank's carrier, not " << channel << std::endl;
+          return -1;
+     }
+     const int index = synthFreeVoice(bank);
+     return index >= 0 && synthStart(bank, index, patch, channel) ? index : -1;
+}
+
+void synthRelease(SynthBank &bank, int voice)
+{
+     if (SynthVoice *v = synthVoice(bank, voice))
+     {
+          SDL_AtomicSet(&v->released, 1);
+     }
+}
+
+void synthSetFrequency(SynthBank &bank, int voice, float hz)
+{
+     if (SynthVoice *v = synthVoice(bank, voice))
+     {
+          SDL_AtomicSet(&v->frequencyBits, synthFloatBits(SDL_max(hz, 0.0f)));
+     }
+}
+
+void synthSetGain(SynthBank &bank, int voice, float gain)
+{
+     if (SynthVoice *v = synthVoice(bank, voice))
+     {
+          SDL_AtomicSet(&v->gainBits, synthFloatBits(SDL_max(gain, 0.0f)));
+     }
+}
+
+bool synthPlaying(const SynthBank &bank, int voice)
+{
+     return voice >= 0 && voice < (int)bank.voices.size() &&
+            SDL_AtomicGet((SDL_atomic_t *)&bank.voices[voice].attached) != 0;
+}
+
+void synthBankUpdate(SynthBank &bank)
+{
+     for (SynthVoice &voice : bank.voices)
+     {
+          if (SDL_AtomicGet(&voice.attached) && SDL_AtomicGet(&voice.finished))
+          {
+               Mix_HaltChannel(voice.channel);
+          }
+     }
+}
+
+void synthBankDestroy(SynthBank &bank)
+{
+     // Halting takes the audio lock and removes the effects, so the
+     // callback is done with the voices afterwards
+     for (SynthVoice &voice : bank.voices)
+     {
+          if (SDL_AtomicGet(&voice.attached))
+          {
+               Mix_HaltChannel(voice.channel);
+          }
+     }
+     bank.voices.clear();
+     bank.scratch.clear();
+     bank.silence.clear();
+}
@@ -0,0 +1,136 @@
+// Description:
+// Procedural sounds generated in the mixer instead of rendered up front.
+// A blip built with makeTone() and played from a borrowed Mix_Chunk is a
+// buffer per sound, fixed at the pitch and length it was rendered with. A
+// synth voice computes its samples in the mixer callback from a small
+// patch instead: one oscillator (sine, square, saw, triangle or pitched
+// noise) with a pitch glide, vibrato and optional FM modulator, an ADSR
+// envelope and a one-pole low-pass, or a callback that writes the samples
+// itself. Pitch and gain can be changed while it plays, which is what an
+// engine sound needs.
+//
+// As with streamed sounds, the channel plays a silent carrier chunk on a
+// loop and an effect registered on it (Mix_RegisterEffect) writes the
+// voice's audio over the silence before the mixer applies the channel's
+// volume, panning and fades. So every Mix_* channel call works, and the
+// channel can come from anywhere: synthPlay() takes one like
+// Mix_PlayChannel, and synthAttach() takes over a channel that already plays
+// the bank's carrier, e.g. one the voice manager picked. The bank's voices
+// and scratch are allocated by synthBankInit(); triggering a sound copies
+// its patch into a free voice and allocates nothing. Call synthBankUpdate()
+// once per frame so voices that finished free their channels.
+// =============================================================================
+
+#ifndef SYNTH_VOICE_H
+#define SYNTH_VOICE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <vector>
+
+enum SynthWaveform
+{
+     SYNTH_SINE,
+     SYNTH_SQUARE,
+     SYNTH_SAW,
+     SYNTH_TRIANGLE,
+     SYNTH_NOISE // New random value every period, so it has a pitch
+};
+
+// Write `frames` mono samples in [-1, 1] to `out` at `rate` Hz. Mixer
+// thread; must not block or allocate.
+typedef void (*SynthGenerator)(void *userdata, float *out, int frames, int rate);
+
+struct SynthPatch
+{
+     SynthWaveform waveform;
+     float frequency;    // Hz at the start
+     float glide;        // Octaves per second the pitch moves by, negative falls
+     float vibratoHz;    // Pitch LFO rate, 0 for none
+     float vibratoDepth; // Semitones either way
+     float fmRatio;      // Modulator frequency over the carrier's
+     float fmIndex;      // Phase modulation depth in periods, 0 for none
+     float cutoff;       // Low-pass in Hz, 0 for none
+
+     float attack, decay; // Seconds
+     float sustain;       // Level 0..1 held after the decay
+     float release;       // Seconds
+     float hold;          // Seconds before the release starts, -1 until synthRelease()
+     float gain;          // Peak level 0..1
+
+     // When set, replaces the oscillator; the envelope and filter still apply
+     SynthGenerator generator;
+     void *userdata;
+};
+
+struct SynthBank;
+
+struct SynthVoice
+{
+     SynthBank *bank;
+     int channel; // Last channel played on, -1 if none
+
+     SDL_atomic_t attached; // The effect is registered on `channel`
+     SDL_atomic_t finished; // The envelope has ended; synthBankUpdate() halts it
+     SDL_atomic_t released; // synthRelease() was called
+     SDL_atomic_t frequencyBits; // Float bits: the pitch to glide to, 0 for the patch's own
+     SDL_atomic_t gainBits;      // Float bits: scales the patch's gain
+
+     // Mixer thread only while attached
+     SynthPatch patch;
+     float time;  // Seconds since the trigger
+     float level; // Envelope output
+     float releaseLevel, releaseTime;
+     double phase, modPhase, lfoPhase;
+     float noiseValue;
+     Uint32 noiseState;
+     float lowpass;
+     float gain;      // Smoothed towards gainBits
+     float frequency; // Smoothed towards frequencyBits, before glide and vibrato
+};
+
+struct SynthBank
+{
+     std::vector<SynthVoice> voices;
+     int rate;
+     int channels;
+     Uint16 format; // AUDIO_S16SYS or AUDIO_F32SYS
+     int frameBytes;
+
+     std::vector<float> scratch; // One mono block, mixer thread only
+     std::vector<Uint8> silence;
+     Mix_Chunk carrier; // Play it with loops -1 before synthAttach()
+};
+
+// A short sine blip with no sustain
+SynthPatch synthPatchDefaults();
+
+// Room for `voiceCount` sounds at once, in the open mixer's format; false
+// with a message on stderr if the mixer is closed or not 16-bit or float
+bool synthBankInit(SynthBank &bank, int voiceCount);
+
+// Like Mix_PlayChannel with the patch as the chunk: `channel` -1 picks a
+// free one. Returns the voice, -1 if no voice or channel is free.
+int synthPlay(SynthBank &bank, const SynthPatch &patch, int channel);
+
+// Start the patch on `channel`, which must be playing bank.carrier with
+// loops -1. Returns the voice, -1 on error.
+int synthAttach(SynthBank &bank, const SynthPatch &patch, int channel);
+
+// Start the release of a held voice
+void synthRelease(SynthBank &bank, int voice);
+
+// Glide the voice to `hz` over a few mixer blocks (0 returns to the patch's
+// own pitch) and scale its gain; safe while it plays
+void synthSetFrequency(SynthBank &bank, int voice, float hz);
+void synthSetGain(SynthBank &bank, int voice, float gain);
+
+bool synthPlaying(const SynthBank &bank, int voice);
+
+// Halt the channels of voices that finished; call once per frame
+void synthBankUpdate(SynthBank &bank);
+
+// Halt every voice and free the bank
+void synthBankDestroy(SynthBank &bank);
+
+#endif // SYNTH_VOICE_H
@@ -0,0 +1,319 @@
+#include "table_file.h"
+
+#include <cstring>
+#include <string>
+
+#include "checksum.h"
+#include "file_commit.h"
+
+namespace
+{
+     const Uint32 TABLE_BYTE_ORDER = 0x01020304;
+     const Uint16 TABLE_FORMAT_VERSION = 1;
+
+     struct TableHeader
+     {
+          char magic[4]; // "CTBL"
+          Uint32 byteOrder;
+          Uint16 formatVersion;
+          Uint16 headerSize;
+          Uint32 kind;
+          Uint32 schemaVersion;
+          Uint32 tableCount;
+          Uint64 fileSize;
+          Uint32 crc; // CRC-32C of every byte after the header
+          Uint32 reserved;
+     };
+     static_assert(sizeof(TableHeader) == 40, "The header is part of the file format");
+     static_assert(sizeof(TableFileEntry) == 24, "Directory entries are part of the file format");
+     static_assert(sizeof(TableHeader) % alignof(TableFileEntry) == 0, "The directory follows the header");
+
+     size_t tableAlign(size_t offset)
+     {
+          return (offset + TABLE_FILE_ALIGNMENT - 1) & ~(size_t)(TABLE_FILE_ALIGNMENT - 1);
+     }
+
+     // Checks everything tableFileData() and tableFileString() rely on, so
+     // lookups need no checks of their own
+     bool tableValidate(TableFile &file, Uint32 kind, Uint32 schemaVersion, Uint32 flags)
+     {
+          TableHeader header;
+          if (file.size < sizeof(header))
+          {
+               SDL_SetError("Not a table file: too short");
+               return false;
+          }
+          std::memcpy(&header, file.base, sizeof(header));
+          if (std::memcmp(header.magic, "CTBL", 4) != 0)
+          {
+               SDL_SetError("Not a table file");
+               return false;
+          }
+          if (header.byteOrder != TABLE_BYTE_ORDER || header.formatVersion != TABLE_FORMAT_VERSION ||
+              header.headerSize != sizeof(header))
+          {
+               SDL_SetError("Table file from another byte order or format version %u", header.formatVersion);
+               return false;
+          }
+          if (header.kind != kind || header.schemaVersion != schemaVersion)
+          {
+               SDL_SetError("Table file holds kind %08x version %u, expected %08x version %u", header.kind,
+                            header.schemaVersion, kind, schemaVersion);
+               return false;
+          }
+          if (header.fileSize != file.size)
+          {
+               SDL_SetError("Table file is %llu bytes, its header says %llu", (unsigned long long)file.size,
+                            (unsigned long long)header.fileSize);
+               return false;
+          }
+
+          const Uint64 tablesStart = sizeof(header) + (Uint64)header.tableCount * sizeof(TableFileEntry);
+          if (tablesStart > file.size)
+          {
+               SDL_SetError("Table file directory runs past the end");
+               return false;
+          }
+          file.tables = (const TableFileEntry *)(file.base + sizeof(header));
+          for (Uint32 i = 0; i < header.tableCount; i++)
+          {
+               const TableFileEntry &table = file.tables[i];
+               const bool placed = table.offset % TABLE_FILE_ALIGNMENT == 0 && table.offset >= tablesStart &&
+                                   table.offset <= file.size;
+               // Divided rather than multiplied, so a huge count can't wrap
+               const bool fits = table.count == 0 || (table.recordSize > 0 && placed &&
+                                                      table.count <= (file.size - table.offset) / table.recordSize);
+               if (!placed || !fits || table.count > 0xFFFFFFFFu)
+               {
+                    SDL_SetError("Table %u of the table file is out of bounds", i);
+                    return false;
+               }
+               if (table.id == TABLE_FILE_STRINGS &&
+                   (table.recordSize != 1 || table.count == 0 || file.base[table.offset + table.count - 1] != '\0'))
+               {
+                    SDL_SetError("Table file strings are not terminated");
+                    return false;
+               }
+          }
+
+          if ((flags & TABLE_FILE_VERIFY) != 0 &&
+              crc32cUpdate(0, file.base + sizeof(header), file.size - sizeof(header)) != header.crc)
+          {
+               SDL_SetError("Table file is damaged: checksum mismatch");
+               return false;
+          }
+          file.kind = header.kind;
+          file.schemaVersion = header.schemaVersion;
+          file.tableCount = header.tableCount;
+          return true;
+     }
+
+     void tableReset(TableFile &file)
+     {
+          file.base = nullptr;
+          file.size = 0;
+          file.kind = 0;
+          file.schemaVersion = 0;
+          file.tables = nullptr;
+          file.tableCount = 0;
+          file.mapping.base = nullptr;
+          file.copy = nullptr;
+     }
+}
+
+bool tableFileOpen(TableFile &file, const char *path, Uint32 kind, Uint32 schemaVersion, Uint32 flags)
+{
+     tableReset(file);
+     if (!mappedFileOpen(file.mapping, path))
+     {
+          return false;
+     }
+     file.base = file.mapping.base;
+     file.size = file.mapping.size;
+     if (!tableValidate(file, kind, schemaVersion, flags))
+     {
+          tableFileClose(file);
+          return false;
+     }
+     return true;
+}
+
+bool tableFileOpenRW(TableFile &file, SDL_RWops *rw, Uint32 kind, Uint32 schemaVersion, Uint32 flags)
+{
+     tableReset(file);
+     if (rw == nullptr)
+     {
+          SDL_SetError("Table file stream is NULL");
+          return false;
+     }
+     size_t remaining = 0;
+     const Uint8 *data = mappedRWData(rw, &remaining);
+     if (data != nullptr && ((uintptr_t)data & (TABLE_FILE_ALIGNMENT - 1)) == 0)
+     {
+          file.base = data;
+          file.size = remaining;
+     }
+     else
+     {
+          // Read from the current position to the end, as a mapped stream would give
+          const Sint64 position = SDL_RWtell(rw);
+          const Sint64 end = SDL_RWsize(rw);
+          if (position < 0 || end < position)
+          {
+               SDL_SetError("Table file stream has no size");
+               return false;
+          }
+          file.size = (size_t)(end - position);
+          file.copy = SDL_SIMDAlloc(SDL_max(file.size, (size_t)1));
+          if (file.copy == nullptr)
+          {
+               tableFileClose(file);
+               SDL_OutOfMemory();
+               return false;
+          }
+          if (SDL_RWread(rw, file.copy, 1, file.size) != file.size)
+          {
+               tableFileClose(file);
+               SDL_SetError("Table file stream ended early");
+               return false;
+          }
+          file.base = (const Uint8 *)file.copy;
+     }
+     if (!tableValidate(file, kind, schemaVersion, flags))
+     {
+          tableFileClose(file);
+          return false;
+     }
+     return true;
+}
+
+void tableFileClose(TableFile &file)
+{
+     if (file.mapping.base != nullptr)
+     {
+          mappedFileClose(file.mapping);
+     }
+     SDL_SIMDFree(file.copy);
+     tableReset(file);
+}
+
+const TableFileEntry *tableFileFind(const TableFile &file, Uint32 id)
+{
+     for (Uint32 i = 0; i < file.tableCount; i++)
+     {
+          if (file.tables[i].id == id)
+          {
+               return &file.tables[i];
+          }
+     }
+     return nullptr;
+}
+
+const void *tableFileData(const TableFile &file, Uint32 id, Uint32 recordSize, Uint32 &count)
+{
+     const TableFileEntry *table = tableFileFind(file, id);
+     if (table == nullptr || table->recordSize != recordSize)
+     {
+          count = 0;
+          return nullptr;
+     }
+     count = (Uint32)table->count;
+     return file.base + table->offset;
+}
+
+const char *tableFileString(const TableFile &file, Uint32 offset)
+{
+     // Validation made sure the table ends in a NUL
+     const TableFileEntry *strings = tableFileFind(file, TABLE_FILE_STRINGS);
+     if (strings == nullptr || offset >= strings->count)
+     {
+          return "";
+     }
+     return (const char *)file.base + strings->offset + offset;
+}
+
+void tableFileWriterInit(TableFileWriter &writer, Uint32 kind, Uint32 schemaVersion)
+{
+     writer.kind = kind;
+     writer.schemaVersion = schemaVersion;
+     writer.tables.clear();
+     writer.data.clear();
+     writer.strings.assign(1, '\0');
+}
+
+void tableFileWriterAddData(TableFileWriter &writer, Uint32 id, const void *records, Uint32 recordSize, size_t count)
+{
+     TableFileEntry table;
+     table.id = id;
+     table.recordSize = recordSize;
+     table.count = count;
+     table.offset = tableAlign(writer.data.size());
+     const size_t bytes = (size_t)recordSize * count;
+     writer.data.resize((size_t)table.offset + bytes, 0);
+     if (bytes > 0)
+     {
+          std::memcpy(writer.data.data() + table.offset, records, bytes);
+     }
+     writer.tables.push_back(table);
+}
+
+Uint32 tableFileWriterString(TableFileWriter &writer, const char *text)
+{
+     const Uint32 offset = (Uint32)writer.strings.size();
+     writer.strings.insert(writer.strings.end(), text, text + SDL_strlen(text) + 1);
+     return offset;
+}
+
+void tableFileWriterBuild(TableFileWriter &writer, std::vector<Uint8> &out)
+{
+     std::vector<TableFileEntry> tables = writer.tables;
+     size_t dataSize = writer.data.size();
+     size_t stringsOffset = 0;
+     const bool hasStrings = writer.strings.size() > 1; // Offset 0 is valid when there is no data
+     if (hasStrings)
+     {
+          stringsOffset = tableAlign(dataSize);
+          TableFileEntry strings = {TABLE_FILE_STRINGS, 1, writer.strings.size(), stringsOffset};
+          tables.push_back(strings);
+          dataSize = stringsOffset + writer.strings.size();
+     }
+
+     const size_t dataStart = tableAlign(sizeof(TableHeader) + tables.size() * sizeof(TableFileEntry));
+     for (TableFileEntry &table : tables)
+     {
+          table.offset += dataStart;
+     }
+     out.assign(dataStart + dataSize, 0);
+     std::memcpy(out.data() + sizeof(TableHeader), tables.data(), tables.size() * sizeof(TableFileEntry));
+     if (!writer.data.empty())
+     {
+          std::memcpy(out.data() + dataStart, writer.data.data(), writer.data.size());
+     }
+     if (hasStrings)
+     {
+          std::memcpy(out.data() + dataStart + stringsOffset, writer.strings.data(), writer.strings.size());
+     }
+
+     TableHeader header;
+     SDL_zero(header);
+     std::memcpy(header.magic, "CTBL", 4);
+     header.byteOrder = TABLE_BYTE_ORDER;
+     header.formatVersion = TABLE_FORMAT_VERSION;
+     header.headerSize = (Uint16)sizeof(header);
+     header.kind = writer.kind;
+     header.schemaVersion = writer.schemaVersion;
+     header.tableCount = (Uint32)tables.size();
+     header.fileSize = out.size();
+     header.crc = crc32cUpdate(0, out.data() + sizeof(header), out.size() - sizeof(header));
+     std::memcpy(out.data(), &header, sizeof(header));
+}
+
+bool tableFileWriterSave(TableFileWriter &writer, const char *path)
+{
+     std::vector<Uint8> bytes;
+     tableFileWriterBuild(writer, bytes);
+
+     // Replaced whole, so a crash mid-write leaves the previous file
+     // rather than a torn one
+     return fileReplace(path, bytes.data(), bytes.size());
+}
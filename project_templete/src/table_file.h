@@ -0,0 +1,149 @@
+// Description:
+// Versioned binary files of fixed-size record tables, used where they lie:
+// levels, save states, score tables and entity snapshots. Text or JSON
+// data is tokenized, converted and copied into game structures on every
+// load, so a load costs time in proportion to the data. A table file is
+// already in the structures' own layout. tableFileOpen() maps it,
+// checks the header and the directory, and hands out pointers into the
+// mapping, so opening a level of a million entities costs about what
+// opening one of ten does. Pages are read in as the game touches them.
+//
+// Layout (native byte order, which every supported target shares; a file
+// from the other order is rejected by its byte order mark):
+//     header     "CTBL", byte order mark, format version, header size,
+//                kind, schema version, table count, file size, CRC-32C
+//     directory  table count x {id, record size, record count, offset}
+//     tables     each starting on a 16-byte boundary, so SSE loads and
+//                any struct up to that alignment can point straight in
+//
+// Records refer to each other by index, and to text by offset into the
+// TABLE_FILE_STRINGS table, never by pointer, so a mapping works at any
+// address. The `kind`, a TABLE_FOURCC, tells level files from save files.
+// The `schemaVersion` is the caller's: bump it whenever a record struct
+// changes, and tableFileOpen() refuses files of any other version instead
+// of misreading them. tableFileGet() also checks each table's record size
+// against sizeof(T), which catches a schema change nobody versioned.
+//
+// The CRC covers everything after the header. It is checked with
+// TABLE_FILE_VERIFY, for files the game wrote itself and a crash may have
+// torn. Shipped levels skip it and cost nothing in proportion to their
+// size. Saves are written beside the target and renamed into place, so a
+// crash mid-save leaves the previous file intact.
+//
+//     TableFileWriter writer;
+//     tableFileWriterInit(writer, LEVEL_KIND, LEVEL_SCHEMA);
+//     tableFileWriterAdd(writer, LEVEL_BLOCKS, blocks.data(), blocks.size());
+//     tableFileWriterSave(writer, "level1.ctbl");
+//
+//     TableFile level;
+//     tableFileOpen(level, "level1.ctbl", LEVEL_KIND, LEVEL_SCHEMA);
+//     Uint32 count;
+//     const LevelBlock *blocks = tableFileGet<LevelBlock>(level, LEVEL_BLOCKS, count);
+// =============================================================================
+
+#ifndef TABLE_FILE_H
+#define TABLE_FILE_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "mapped_file.h"
+
+#define TABLE_FOURCC(a, b, c, d)                                                                     \
+     ((Uint32)(Uint8)(a) | ((Uint32)(Uint8)(b) << 8) | ((Uint32)(Uint8)(c) << 16) | ((Uint32)(Uint8)(d) << 24))
+
+// Id of the table tableFileWriterString() fills
+const Uint32 TABLE_FILE_STRINGS = TABLE_FOURCC('S', 'T', 'R', 'S');
+
+// Every table starts on a multiple of this
+const int TABLE_FILE_ALIGNMENT = 16;
+
+// tableFileOpen() flags
+const Uint32 TABLE_FILE_VERIFY = 1; // Check the CRC-32C of the whole file
+
+struct TableFileEntry
+{
+     Uint32 id;
+     Uint32 recordSize;
+     Uint64 count;
+     Uint64 offset; // From the start of the file
+};
+
+struct TableFile
+{
+     const Uint8 *base; // nullptr when closed
+     size_t size;
+     Uint32 kind;
+     Uint32 schemaVersion;
+     const TableFileEntry *tables;
+     Uint32 tableCount;
+
+     // Where the bytes live: a mapping, or a copy when the source was not
+     // mapped or not aligned
+     MappedFile mapping;
+     void *copy; // SDL_SIMDAlloc
+};
+
+// Map `path` and check it is a table file of `kind` and `schemaVersion`.
+// False with SDL's error set when it isn't
+bool tableFileOpen(TableFile &file, const char *path, Uint32 kind, Uint32 schemaVersion, Uint32 flags = 0);
+
+// The same from a stream, for asset_pack entries. A mapped or memory
+// stream whose data is aligned is used in place and must stay open as long
+// as `file`; any other stream is read into a copy. The stream is not closed
+bool tableFileOpenRW(TableFile &file, SDL_RWops *rw, Uint32 kind, Uint32 schemaVersion, Uint32 flags = 0);
+
+void tableFileClose(TableFile &file);
+
+// The directory entry for `id`, nullptr if the file has no such table
+const TableFileEntry *tableFileFind(const TableFile &file, Uint32 id);
+
+// Records of table `id` in place, with their number in `count`. nullptr
+// and a count of 0 when the table is missing or its record size is not
+// `recordSize`
+const void *tableFileData(const TableFile &file, Uint32 id, Uint32 recordSize, Uint32 &count);
+
+template <typename T>
+const T *tableFileGet(const TableFile &file, Uint32 id, Uint32 &count)
+{
+     return (const T *)tableFileData(file, id, (Uint32)sizeof(T), count);
+}
+
+// The NUL-terminated string at `offset` in TABLE_FILE_STRINGS; "" for an
+// offset outside the table or a string that runs off its end
+const char *tableFileString(const TableFile &file, Uint32 offset);
+
+struct TableFileWriter
+{
+     Uint32 kind;
+     Uint32 schemaVersion;
+     std::vector<TableFileEntry> tables; // Offsets relative to `data` until saved
+     std::vector<Uint8> data;            // Tables, each padded to TABLE_FILE_ALIGNMENT
+     std::vector<char> strings;
+};
+
+void tableFileWriterInit(TableFileWriter &writer, Uint32 kind, Uint32 schemaVersion);
+
+// Copy `count` records of `recordSize` bytes as table `id`. Ids are unique
+// within a file; a repeated one is never found
+void tableFileWriterAddData(TableFileWriter &writer, Uint32 id, const void *records, Uint32 recordSize, size_t count);
+
+template <typename T>
+void tableFileWriterAdd(TableFileWriter &writer, Uint32 id, const T *records, size_t count)
+{
+     tableFileWriterAddData(writer, id, records, (Uint32)sizeof(T), count);
+}
+
+// Add `text` to the string table; returns its offset for a record to keep
+// and tableFileString() to look up. Offset 0 is always "". Equal strings
+// are not merged
+Uint32 tableFileWriterString(TableFileWriter &writer, const char *text);
+
+// Write the file to `path` through a temporary name, false with SDL's
+// error set on failure
+bool tableFileWriterSave(TableFileWriter &writer, const char *path);
+
+// The file as it would be saved, for asset packs or the network
+void tableFileWriterBuild(TableFileWriter &writer, std::vector<Uint8> &out);
+
+#endif // TABLE_FILE_H
@@ -0,0 +1,276 @@
+#include "text_layout.h"
+
+#include "utf_convert.h"
+
+namespace
+{
+     bool isBreakable(Uint32 codepoint)
+     {
+          return codepoint == ' ' || codepoint == '\t';
+     }
+
+     void layoutParagraph(TextLayout &layout, LayoutParagraph &paragraph)
+     {
+          TTF_Font *font = layout.cache->fonts[layout.fontId].font;
+          paragraph.glyphs.clear();
+          paragraph.lines.clear();
+
+          // Shape the paragraph as one unbroken line first
+          utfDecode(paragraph.text.c_str(), layout.decoded);
+          std::vector<float> advances;
+          advances.reserve(layout.decoded.size());
+          paragraph.glyphs.reserve(layout.decoded.size());
+          float penX = 0.0f;
+          Uint32 previous = 0;
+          for (const Uint32 codepoint : layout.decoded)
+          {
+               const CachedGlyph *glyph = glyphCacheGet(*layout.cache, layout.fontId, codepoint);
+               if (previous != 0)
+               {
+                    penX += TTF_GetFontKerningSizeGlyphs32(font, previous, codepoint);
+               }
+               paragraph.glyphs.push_back({codepoint, penX});
+               advances.push_back((float)glyph->advance);
+               penX += glyph->advance;
+               previous = codepoint;
+          }
+          paragraph.naturalWidth = (int)penX;
+
+          // Then break it greedily at the last space that still fits,
+          // splitting inside a word only when the word alone is too wide
+          int count = (int)paragraph.glyphs.size();
+          int start = 0;
+          do
+          {
+               float origin = start < count ? paragraph.glyphs[start].x : 0.0f;
+               int end = count;
+               int lastBreak = -1;
+               if (layout.wrapWidth > 0)
+               {
+                    for (int i = start; i < count; i++)
+                    {
+                         if (isBreakable(paragraph.glyphs[i].codepoint))
+                         {
+                              lastBreak = i;
+                         }
+                         else if (paragraph.glyphs[i].x + advances[i] - origin > layout.wrapWidth && i > start)
+                         {
+                              end = lastBreak > start ? lastBreak : i;
+                              break;
+                         }
+                    }
+               }
+
+               // Trailing spaces don't count toward the width
+               int visibleEnd = end;
+               while (visibleEnd > start && isBreakable(paragraph.glyphs[visibleEnd - 1].codepoint))
+               {
+                    visibleEnd--;
+               }
+               LayoutLine line;
+               line.first = start;
+               line.count = visibleEnd - start;
+               line.width = line.count > 0
+                                ? (int)(paragraph.glyphs[visibleEnd - 1].x + advances[visibleEnd - 1] - origin)
+                                : 0;
+               for (int i = start; i < visibleEnd; i++)
+               {
+                    paragraph.glyphs[i].x -= origin;
+               }
+               paragraph.lines.push_back(line);
+
+               // The next line starts after the spaces at the break
+               start = end;
+               while (start < count && isBreakable(paragraph.glyphs[start].codepoint))
+               {
+                    start++;
+               }
+          } while (start < count);
+
+          layout.relayoutCount++;
+     }
+
+     void updateExtents(TextLayout &layout)
+     {
+          layout.width = 0;
+          layout.lineCount = 0;
+          for (const LayoutParagraph &paragraph : layout.paragraphs)
+          {
+               for (const LayoutLine &line : paragraph.lines)
+               {
+                    layout.width = SDL_max(layout.width, line.width);
+               }
+               layout.lineCount += (int)paragraph.lines.size();
+          }
+     }
+
+     void relayoutAll(TextLayout &layout)
+     {
+          for (LayoutParagraph &paragraph : layout.paragraphs)
+          {
+               layoutParagraph(layout, paragraph);
+          }
+          updateExtents(layout);
+     }
+}
+
+void textLayoutInit(TextLayout &layout, GlyphCache *cache, int fontId, int wrapWidth)
+{
+     layout.cache = cache;
+     layout.fontId = fontId;
+     layout.wrapWidth = wrapWidth;
+     layout.paragraphs.clear();
+     layout.width = 0;
+     layout.lineCount = 0;
+     layout.relayoutCount = 0;
+}
+
+void textLayoutSetText(TextLayout &layout, const char *text)
+{
+     std::vector<std::string> incoming;
+     const char *start = text;
+     for (const char *p = text;; p++)
+     {
+          if (*p == '\n' || *p == '\0')
+          {
+               incoming.emplace_back(start, p - start);
+               if (*p == '\0')
+               {
+                    break;
+               }
+               start = p + 1;
+          }
+     }
+
+     // Keep the longest common run of paragraphs at each end
+     std::vector<LayoutParagraph> &old = layout.paragraphs;
+     size_t prefix = 0;
+     while (prefix < old.size() && prefix < incoming.size() && old[prefix].text == incoming[prefix])
+     {
+          prefix++;
+     }
+     size_t suffix = 0;
+     while (suffix < old.size() - prefix && suffix < incoming.size() - prefix &&
+            old[old.size() - 1 - suffix].text == incoming[incoming.size() - 1 - suffix])
+     {
+          suffix++;
+     }
+
+     std::vector<LayoutParagraph> merged;
+     merged.reserve(incoming.size());
+     for (size_t i = 0; i < prefix; i++)
+     {
+          merged.push_back(std::move(old[i]));
+     }
+     for (size_t i = prefix; i < incoming.size() - suffix; i++)
+     {
+          LayoutParagraph paragraph;
+          paragraph.text = std::move(incoming[i]);
+          layoutParagraph(layout, paragraph);
+          merged.push_back(std::move(paragraph));
+     }
+     for (size_t i = old.size() - suffix; i < old.size(); i++)
+     {
+          merged.push_back(std::move(old[i]));
+     }
+     layout.paragraphs = std::move(merged);
+     updateExtents(layout);
+}
+
+void textLayoutAppend(TextLayout &layout, const char *paragraph)
+{
+     LayoutParagraph added;
+     added.text = paragraph;
+     layoutParagraph(layout, added);
+     for (const LayoutLine &line : added.lines)
+     {
+          layout.width = SDL_max(layout.width, line.width);
+     }
+     layout.lineCount += (int)added.lines.size();
+     layout.paragraphs.push_back(std::move(added));
+}
+
+void textLayoutRemoveFront(TextLayout &layout, int count)
+{
+     count = SDL_min(count, (int)layout.paragraphs.size());
+     if (count <= 0)
+     {
+          return;
+     }
+     layout.paragraphs.erase(layout.paragraphs.begin(), layout.paragraphs.begin() + count);
+     updateExtents(layout);
+}
+
+void textLayoutSetWrapWidth(TextLayout &layout, int wrapWidth)
+{
+     if (wrapWidth == layout.wrapWidth)
+     {
+          return;
+     }
+     layout.wrapWidth = wrapWidth;
+
+     // A paragraph that was never wrapped and still fits is unaffected
+     for (LayoutParagraph &paragraph : layout.paragraphs)
+     {
+          bool fits = wrapWidth <= 0 || paragraph.naturalWidth <= wrapWidth;
+          if (!(paragraph.lines.size() == 1 && fits))
+          {
+               layoutParagraph(layout, paragraph);
+          }
+     }
+     updateExtents(layout);
+}
+
+void textLayoutSetFont(TextLayout &layout, int fontId)
+{
+     if (fontId == layout.fontId)
+     {
+          return;
+     }
+     layout.fontId = fontId;
+     relayoutAll(layout);
+}
+
+int textLayoutHeight(const TextLayout &layout)
+{
+     return layout.lineCount * layout.cache->fonts[layout.fontId].lineSkip;
+}
+
+void textLayoutDraw(TextLayout &layout, RenderQueue &queue, float x, float y, SDL_Color color,
+                    const SDL_FRect *clip)
+{
+     GlyphCache &cache = *layout.cache;
+     int lineSkip = cache.fonts[layout.fontId].lineSkip;
+     float penY = y;
+
+     for (const LayoutParagraph &paragraph : layout.paragraphs)
+     {
+          // Whole paragraphs above or below the clip are skipped in one step
+          float paragraphHeight = (float)(paragraph.lines.size() * lineSkip);
+          if (clip != nullptr && (penY + paragraphHeight <= clip->y || penY >= clip->y + clip->h))
+          {
+               penY += paragraphHeight;
+               continue;
+          }
+
+          for (const LayoutLine &line : paragraph.lines)
+          {
+               if (clip == nullptr || (penY + lineSkip > clip->y && penY < clip->y + clip->h))
+               {
+                    for (int i = line.first; i < line.first + line.count; i++)
+                    {
+                         const LayoutGlyph &placed = paragraph.glyphs[i];
+                         float drawX;
+                         const CachedGlyph *glyph = glyphCacheGetAt(cache, layout.fontId, placed.codepoint,
+                                                                    x + placed.x, &drawX);
+                         if (glyph->page >= 0)
+                         {
+                              SDL_FRect dst = {drawX, penY, (float)glyph->src.w, (float)glyph->src.h};
+                              renderQueueCopyTinted(queue, cache.pages[glyph->page], &glyph->src, dst, color);
+                         }
+                    }
+               }
+               penY += lineSkip;
+          }
+     }
+}
@@ -0,0 +1,81 @@
+// Description:
+// Persistent layout for wrapped, multi-line text drawn through the glyph
+// cache. TTF_RenderUTF8_Blended_Wrapped measures and wraps its string again
+// on every call; a TextLayout keeps the line breaks, glyph positions and
+// extents and only redoes the work that a change actually invalidates.
+//
+// Text is stored as paragraphs (separated by '\n'). Setting new text keeps
+// every paragraph in the unchanged prefix and suffix of the old text, so
+// appending to a log, dropping its oldest lines or editing one chat message
+// relays out just those paragraphs. Drawing replays the stored positions.
+// =============================================================================
+
+#ifndef TEXT_LAYOUT_H
+#define TEXT_LAYOUT_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#include "glyph_cache.h"
+#include "render_queue.h"
+
+struct LayoutGlyph
+{
+     Uint32 codepoint;
+     float x; // Pen position relative to the start of the line
+};
+
+struct LayoutLine
+{
+     int first, count; // Range in LayoutParagraph::glyphs
+     int width;
+};
+
+struct LayoutParagraph
+{
+     std::string text;
+     std::vector<LayoutGlyph> glyphs;
+     std::vector<LayoutLine> lines;
+     int naturalWidth; // Width without wrapping
+};
+
+struct TextLayout
+{
+     GlyphCache *cache;
+     int fontId;
+     int wrapWidth; // 0 disables wrapping
+     std::vector<LayoutParagraph> paragraphs;
+
+     // Extents of the whole text, kept current by every setter
+     int width;
+     int lineCount;
+
+     int relayoutCount; // Paragraphs laid out since init, for profiling
+
+     std::vector<Uint32> decoded; // Scratch: the paragraph being laid out
+};
+
+void textLayoutInit(TextLayout &layout, GlyphCache *cache, int fontId, int wrapWidth);
+
+// Replace the text; paragraphs shared with the previous text are reused
+void textLayoutSetText(TextLayout &layout, const char *text);
+
+// Add one paragraph at the end, e.g. a new log line
+void textLayoutAppend(TextLayout &layout, const char *paragraph);
+
+// Drop the oldest `count` paragraphs
+void textLayoutRemoveFront(TextLayout &layout, int count);
+
+void textLayoutSetWrapWidth(TextLayout &layout, int wrapWidth);
+void textLayoutSetFont(TextLayout &layout, int fontId);
+
+int textLayoutHeight(const TextLayout &layout);
+
+// Queue the text with its top-left corner at (x, y). Lines entirely outside
+// `clip` (if given) are skipped, so long scrolled panels cost only what
+// is visible.
+void textLayoutDraw(TextLayout &layout, RenderQueue &queue, float x, float y, SDL_Color color,
+                    const SDL_FRect *clip);
+
+#endif // TEXT_LAYOUT_H
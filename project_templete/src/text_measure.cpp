@@ -0,0 +1,261 @@
+#include "text_measure.h"
+
+#include "utf_convert.h"
+
+namespace
+{
+     const int KERN_FIRST = 0x20;
+     const int KERN_SPAN = 0x80 - KERN_FIRST;
+
+     MeasuredGlyph loadMetrics(TextMeasure &measure, Uint32 codepoint)
+     {
+          MeasuredGlyph glyph = {0, 0, 0};
+          int minx, maxx, miny, maxy, advance;
+          if (TTF_GlyphMetrics32(measure.font, codepoint, &minx, &maxx, &miny, &maxy, &advance) == 0)
+          {
+               glyph.advance = (Sint16)advance;
+               glyph.left = (Sint16)minx;
+               glyph.right = (Sint16)maxx;
+          }
+          measure.glyphLoads++;
+          return glyph;
+     }
+
+     const MeasuredGlyph &lookupMetrics(TextMeasure &measure, Uint32 codepoint)
+     {
+          if (codepoint < 0x80)
+          {
+               return measure.ascii[codepoint];
+          }
+          auto it = measure.glyphs.find(codepoint);
+          if (it == measure.glyphs.end())
+          {
+               it = measure.glyphs.emplace(codepoint, loadMetrics(measure, codepoint)).first;
+          }
+          return it->second;
+     }
+
+     int kerningBetween(const TextMeasure &measure, Uint32 previous, Uint32 codepoint)
+     {
+          if (previous >= (Uint32)KERN_FIRST && previous < 0x80 && codepoint >= (Uint32)KERN_FIRST && codepoint < 0x80)
+          {
+               return measure.asciiKerning[(previous - KERN_FIRST) * KERN_SPAN + (codepoint - KERN_FIRST)];
+          }
+          return TTF_GetFontKerningSizeGlyphs32(measure.font, previous, codepoint);
+     }
+
+     // Printable ASCII bytes from the start of `s`, stopping at anything else
+     int asciiRun(const Uint8 *s)
+     {
+          const Uint8 *p = s;
+          while (*p >= 0x20 && *p < 0x7F)
+          {
+               p++;
+          }
+          return (int)(p - s);
+     }
+
+     // The same for codepoints
+     size_t asciiRun(const Uint32 *codepoints, size_t count)
+     {
+          size_t i = 0;
+          while (i < count && codepoints[i] >= 0x20 && codepoints[i] < 0x7F)
+          {
+               i++;
+          }
+          return i;
+     }
+
+     // Walk the line as TTF_Size_Internal does. With maxWidth >= 0 stop at
+     // the first codepoint that no longer fits; returns the width measured.
+     int walkLine(TextMeasure &measure, const Uint32 *codepoints, size_t length, int maxWidth, int *count)
+     {
+          int x = 0, minx = 0, maxx = 0;
+          int fitted = 0, fittedWidth = 0;
+          Uint32 previous = 0;
+          for (size_t i = 0; i < length; i++)
+          {
+               const Uint32 codepoint = codepoints[i];
+               const MeasuredGlyph &glyph = lookupMetrics(measure, codepoint);
+               if (measure.kerning && previous != 0)
+               {
+                    x += kerningBetween(measure, previous, codepoint);
+               }
+               minx = SDL_min(minx, x + glyph.left);
+               maxx = SDL_max(maxx, x + glyph.right);
+               x += glyph.advance;
+               previous = codepoint;
+
+               if (maxWidth >= 0)
+               {
+                    const int width = SDL_max(maxx, x) - minx;
+                    if (width <= maxWidth)
+                    {
+                         fittedWidth = width;
+                         fitted++;
+                    }
+                    if (width >= maxWidth)
+                    {
+                         break;
+                    }
+               }
+          }
+          if (count)
+          {
+               *count = fitted;
+          }
+          return maxWidth >= 0 ? fittedWidth : SDL_max(maxx, x) - minx;
+     }
+
+     int walkText(TextMeasure &measure, const char *text, int maxWidth, int *count)
+     {
+          utfDecode(text, measure.decoded);
+          return walkLine(measure, measure.decoded.data(), measure.decoded.size(), maxWidth, count);
+     }
+
+     void storeSize(const TextMeasure &measure, int width, int *w, int *h)
+     {
+          if (w)
+          {
+               *w = width;
+          }
+          if (h)
+          {
+               *h = measure.height;
+          }
+     }
+
+     void storeFit(int width, int fitted, int *extent, int *count)
+     {
+          if (extent)
+          {
+               *extent = width;
+          }
+          if (count)
+          {
+               *count = fitted;
+          }
+     }
+}
+
+void textMeasureInit(TextMeasure &measure, TTF_Font *font)
+{
+     measure.font = font;
+     measure.height = TTF_FontHeight(font);
+     measure.glyphs.clear();
+     measure.glyphLoads = 0;
+     for (Uint32 c = 0; c < 0x80; c++)
+     {
+          measure.ascii[c] = loadMetrics(measure, c);
+     }
+
+     measure.asciiKerning.assign(KERN_SPAN * KERN_SPAN, 0);
+     measure.kerning = false;
+     if (TTF_GetFontKerning(font))
+     {
+          for (int a = 0; a < KERN_SPAN; a++)
+          {
+               for (int b = 0; b < KERN_SPAN; b++)
+               {
+                    const int kern = TTF_GetFontKerningSizeGlyphs32(font, KERN_FIRST + a, KERN_FIRST + b);
+                    measure.asciiKerning[a * KERN_SPAN + b] = (Sint8)SDL_clamp(kern, -128, 127);
+                    measure.kerning = measure.kerning || kern != 0;
+               }
+          }
+     }
+
+     // The multiply is only exact when every cell matches and keeps its ink inside
+     measure.fixedAdvance = 0;
+     if (TTF_FontFaceIsFixedWidth(font) && !measure.kerning)
+     {
+          const int advance = measure.ascii[' '].advance;
+          bool uniform = advance > 0;
+          for (int c = 0x20; c < 0x7F && uniform; c++)
+          {
+               const MeasuredGlyph &glyph = measure.ascii[c];
+               uniform = glyph.advance == advance && glyph.left >= 0 && glyph.right <= advance;
+          }
+          measure.fixedAdvance = uniform ? advance : 0;
+     }
+}
+
+void textMeasureSize(TextMeasure &measure, const char *text, int *w, int *h)
+{
+     int width;
+     if (measure.fixedAdvance > 0)
+     {
+          const int run = asciiRun((const Uint8 *)text);
+          width = text[run] == '\0' ? run * measure.fixedAdvance : walkText(measure, text, -1, nullptr);
+     }
+     else
+     {
+          width = walkText(measure, text, -1, nullptr);
+     }
+     storeSize(measure, width, w, h);
+}
+
+void textMeasureFit(TextMeasure &measure, const char *text, int maxWidth, int *extent, int *count)
+{
+     int fitted;
+     int width;
+     maxWidth = SDL_max(0, maxWidth);
+     const int run = measure.fixedAdvance > 0 ? asciiRun((const Uint8 *)text) : 0;
+     if (run > 0)
+     {
+          // Every cell is the same width, so the answer is a division
+          fitted = SDL_min(run, maxWidth / measure.fixedAdvance);
+          if (fitted == run && text[run] != '\0')
+          {
+               width = walkText(measure, text, maxWidth, &fitted);
+          }
+          else
+          {
+               width = fitted * measure.fixedAdvance;
+          }
+     }
+     else
+     {
+          width = walkText(measure, text, maxWidth, &fitted);
+     }
+     storeFit(width, fitted, extent, count);
+}
+
+void textMeasureSizeCodepoints(TextMeasure &measure, const Uint32 *codepoints, size_t length, int *w, int *h)
+{
+     int width;
+     if (measure.fixedAdvance > 0 && asciiRun(codepoints, length) == length)
+     {
+          width = (int)length * measure.fixedAdvance;
+     }
+     else
+     {
+          width = walkLine(measure, codepoints, length, -1, nullptr);
+     }
+     storeSize(measure, width, w, h);
+}
+
+void textMeasureFitCodepoints(TextMeasure &measure, const Uint32 *codepoints, size_t length, int maxWidth,
+                              int *extent, int *count)
+{
+     int fitted;
+     int width;
+     maxWidth = SDL_max(0, maxWidth);
+     const int run = measure.fixedAdvance > 0 ? (int)asciiRun(codepoints, length) : 0;
+     if (run > 0)
+     {
+          fitted = SDL_min(run, maxWidth / measure.fixedAdvance);
+          if (fitted == run && (size_t)run < length)
+          {
+               width = walkLine(measure, codepoints, length, maxWidth, &fitted);
+          }
+          else
+          {
+               width = fitted * measure.fixedAdvance;
+          }
+     }
+     else
+     {
+          width = walkLine(measure, codepoints, length, maxWidth, &fitted);
+     }
+     storeFit(width, fitted, extent, count);
+}
@@ -0,0 +1,76 @@
+// Description:
+// Fast replacements for TTF_SizeUTF8 and TTF_MeasureUTF8 on one line of
+// text, for views that measure tens of thousands of lines a second (log
+// viewers, consoles, tables). SDL_ttf loads and shapes every glyph of the
+// string on every call; a TextMeasure loads each glyph's metrics once and
+// afterwards only adds up table entries:
+//
+// - Printable ASCII has dense advance, bounds and kerning tables built up
+//   front, so an ASCII line costs one lookup per byte.
+// - For TTF_FontFaceIsFixedWidth fonts whose ASCII cells all have the same
+//   advance, stay within the cell and do not kern, an ASCII line is a
+//   single multiply.
+// - Other codepoints fill a per-codepoint table the first time they are
+//   seen.
+//
+// Widths follow TTF_SizeUTF8's rule: the span from the leftmost inked
+// pixel (or the origin) to the rightmost inked pixel or the final pen
+// position, whichever is further. With hinting on (the default), advances
+// are whole pixels and the result is identical for fonts that kern with a
+// 'kern' table or not at all. SDL_ttf's HarfBuzz shaping can also apply
+// GPOS kerning and ligatures, which this does not see; measurebench
+// compares both paths on a given font and reports any difference.
+//
+// A TextMeasure reads the font's state when it is built; rebuild it after
+// TTF_SetFontStyle, TTF_SetFontSize, TTF_SetFontHinting or
+// TTF_SetFontKerning. Outlined fonts are not supported.
+// =============================================================================
+
+#ifndef TEXT_MEASURE_H
+#define TEXT_MEASURE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <unordered_map>
+#include <vector>
+
+struct MeasuredGlyph
+{
+     Sint16 advance;
+     Sint16 left;  // Inked extent relative to the pen, as TTF_GlyphMetrics32's minx
+     Sint16 right; // ... and maxx
+};
+
+struct TextMeasure
+{
+     TTF_Font *font;
+     int height;
+     bool kerning;      // TTF_GetFontKerning and at least one ASCII pair kerns
+     int fixedAdvance;  // Advance of every printable ASCII cell, 0 if they differ
+
+     MeasuredGlyph ascii[128];
+     std::vector<Sint8> asciiKerning; // 96 x 96, indexed from U+0020
+     std::unordered_map<Uint32, MeasuredGlyph> glyphs; // Everything else, filled on first use
+
+     int glyphLoads; // TTF_GlyphMetrics32 calls so far
+
+     std::vector<Uint32> decoded; // Scratch for the UTF-8 entry points
+};
+
+// Load the ASCII tables for `font`, which must outlive the TextMeasure
+void textMeasureInit(TextMeasure &measure, TTF_Font *font);
+
+// TTF_SizeUTF8 for one line of UTF-8 text
+void textMeasureSize(TextMeasure &measure, const char *text, int *w, int *h);
+
+// TTF_MeasureUTF8: how many codepoints from the start fit in `maxWidth`
+// (`count`) and how wide they are (`extent`); either may be nullptr
+void textMeasureFit(TextMeasure &measure, const char *text, int maxWidth, int *extent, int *count);
+
+// The same for a line already decoded (see utfDecode), for callers that
+// measure one string many times, e.g. fitting it at several widths
+void textMeasureSizeCodepoints(TextMeasure &measure, const Uint32 *codepoints, size_t length, int *w, int *h);
+void textMeasureFitCodepoints(TextMeasure &measure, const Uint32 *codepoints, size_t length, int maxWidth,
+                              int *extent, int *count);
+
+#endif // TEXT_MEASURE_H
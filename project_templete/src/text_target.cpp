@@ -0,0 +1,192 @@
+#include "text_target.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "glyph_cache.h"
+#include "memory_tags.h"
+#include "render_record.h"
+
+namespace
+{
+     // Keep the alpha channel of a white glyph surface as coverage
+     void copyCoverage(SDL_Surface *surface, RasterGlyph &glyph)
+     {
+          glyph.w = surface->w;
+          glyph.h = surface->h;
+          glyph.coverage.resize((size_t)glyph.w * glyph.h);
+          for (int y = 0; y < glyph.h; y++)
+          {
+               const Uint32 *row = (const Uint32 *)((const Uint8 *)surface->pixels + y * surface->pitch);
+               Uint8 *out = &glyph.coverage[(size_t)y * glyph.w];
+               for (int x = 0; x < glyph.w; x++)
+               {
+                    out[x] = (Uint8)(row[x] >> 24);
+               }
+          }
+     }
+
+     const RasterGlyph &rasterGlyph(TextRaster &raster, Uint32 codepoint)
+     {
+          const Uint64 key = ((Uint64)(TTF_GetFontStyle(raster.font) & 0xFF) << 32) | codepoint;
+          auto it = raster.glyphs.find(key);
+          if (it != raster.glyphs.end())
+          {
+               return it->second;
+          }
+
+          RasterGlyph &glyph = raster.glyphs[key];
+          glyph.w = 0;
+          glyph.h = 0;
+          glyph.advance = 0;
+          int minx, maxx, miny, maxy;
+          if (TTF_GlyphMetrics32(raster.font, codepoint, &minx, &maxx, &miny, &maxy, &glyph.advance) < 0)
+          {
+               return glyph;
+          }
+          const SDL_Color white = {255, 255, 255, 255};
+          SDL_Surface *surface;
+          {
+               MemoryTagScope tag(MEMORY_TAG_TTF);
+               surface = TTF_RenderGlyph32_Blended(raster.font, codepoint, white);
+          }
+          if (surface != nullptr && surface->format->format != SDL_PIXELFORMAT_ARGB8888)
+          {
+               SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+               SDL_FreeSurface(surface);
+               surface = converted;
+          }
+          if (surface != nullptr)
+          {
+               copyCoverage(surface, glyph);
+               SDL_FreeSurface(surface);
+          }
+          raster.rasterizedCount++;
+          return glyph;
+     }
+
+     // Glyph ink can overlap where kerning pulls glyphs together; the
+     // larger coverage wins, as in a blended TTF render
+     void compositeGlyph(const RasterGlyph &glyph, Uint8 *pixels, int pitch, int width, int height, int atX, int atY,
+                         SDL_Color color)
+     {
+          const int x0 = SDL_max(0, atX), x1 = SDL_min(width, atX + glyph.w);
+          const int y0 = SDL_max(0, atY), y1 = SDL_min(height, atY + glyph.h);
+          const Uint32 rgb = ((Uint32)color.r << 16) | ((Uint32)color.g << 8) | color.b;
+          for (int y = y0; y < y1; y++)
+          {
+               const Uint8 *src = glyph.coverage.data() + (size_t)(y - atY) * glyph.w;
+               Uint32 *dst = (Uint32 *)(pixels + y * pitch);
+               for (int x = x0; x < x1; x++)
+               {
+                    const Uint32 alpha = (src[x - atX] * color.a + 127) / 255;
+                    if (alpha > (dst[x] >> 24))
+                    {
+                         dst[x] = (alpha << 24) | rgb;
+                    }
+               }
+          }
+     }
+
+     // Lay out the text, writing into `pixels` when it is not nullptr
+     void layoutText(TextRaster &raster, Uint8 *pixels, int pitch, int width, int height, const char *text,
+                     SDL_Color color, int *w, int *h)
+     {
+          int penX = 0, penY = 0, widest = 0, lines = 1;
+          Uint32 previous = 0;
+          while (*text)
+          {
+               const Uint32 codepoint = glyphCacheDecodeUtf8(text);
+               if (codepoint == '\n')
+               {
+                    widest = SDL_max(widest, penX);
+                    penX = 0;
+                    penY += raster.lineSkip;
+                    previous = 0;
+                    lines++;
+                    continue;
+               }
+               if (previous != 0)
+               {
+                    penX += TTF_GetFontKerningSizeGlyphs32(raster.font, previous, codepoint);
+               }
+               const RasterGlyph &glyph = rasterGlyph(raster, codepoint);
+               if (pixels != nullptr && glyph.w > 0 && penY < height)
+               {
+                    compositeGlyph(glyph, pixels, pitch, width, height, penX, penY, color);
+               }
+               penX += glyph.advance;
+               previous = codepoint;
+          }
+          if (w)
+          {
+               *w = SDL_max(widest, penX);
+          }
+          if (h)
+          {
+               *h = lines * raster.lineSkip;
+          }
+     }
+}
+
+void textRasterInit(TextRaster &raster, TTF_Font *font)
+{
+     raster.font = font;
+     raster.lineSkip = TTF_FontLineSkip(font);
+     raster.glyphs.clear();
+     raster.rasterizedCount = 0;
+}
+
+SDL_Texture *textRasterCreateTexture(SDL_Renderer *renderer, int w, int h)
+{
+     SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, w, h);
+     if (texture == nullptr)
+     {
+          std::cerr << "Unable to create text texture! SDL Error: " << SDL_GetError() << std::endl;
+          return nullptr;
+     }
+     renderRecordSetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+     return texture;
+}
+
+bool textRasterToTexture(TextRaster &raster, SDL_Texture *texture, const SDL_Rect *rect, const char *text,
+                         SDL_Color color, int *w, int *h)
+{
+     Uint32 format;
+     int access, textureW, textureH;
+     if (SDL_QueryTexture(texture, &format, &access, &textureW, &textureH) != 0 ||
+         format != SDL_PIXELFORMAT_ARGB8888 || access != SDL_TEXTUREACCESS_STREAMING)
+     {
+          SDL_SetError("Text needs a streaming ARGB8888 texture");
+          return false;
+     }
+     const SDL_Rect area = rect != nullptr ? *rect : SDL_Rect{0, 0, textureW, textureH};
+     void *pixels;
+     int pitch;
+     if (renderRecordLockTexture(texture, &area, &pixels, &pitch) != 0)
+     {
+          std::cerr << "Unable to lock text texture! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     textRasterToPixels(raster, pixels, pitch, area.w, area.h, text, color, w, h);
+     renderRecordUnlockTexture(texture);
+     return true;
+}
+
+void textRasterToPixels(TextRaster &raster, void *pixels, int pitch, int width, int height, const char *text,
+                        SDL_Color color, int *w, int *h)
+{
+     // Locked texture memory holds garbage, so every row is cleared first
+     Uint8 *rows = (Uint8 *)pixels;
+     for (int y = 0; y < height; y++)
+     {
+          std::memset(rows + y * pitch, 0, (size_t)width * 4);
+     }
+     layoutText(raster, rows, pitch, width, height, text, color, w, h);
+}
+
+void textRasterDestroy(TextRaster &raster)
+{
+     raster.glyphs.clear();
+     raster.font = nullptr;
+}
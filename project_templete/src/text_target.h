@@ -0,0 +1,58 @@
+// Description:
+// Text rendered straight into a streaming texture. The usual route to the
+// GPU, TTF_RenderUTF8_Blended into a new surface, SDL_CreateTextureFromSurface
+// and SDL_FreeSurface, costs two allocations and an extra copy every time a
+// label changes. A TextRaster instead keeps each glyph's 8-bit coverage on
+// the CPU, rasterized once, and composites strings directly into the
+// memory SDL_LockTexture hands out, whether that is a whole label texture
+// or one sub-rect of a streaming atlas. Updating a dynamic label then
+// allocates nothing and copies nothing beyond the locked rect.
+//
+// Output is straight-alpha ARGB8888 in one colour, for SDL_BLENDMODE_BLEND.
+// Layout matches the glyph cache: TTF_GlyphMetrics32 advances,
+// TTF_GetFontKerningSizeGlyphs32 kerning and '\n' for new lines; it does
+// no HarfBuzz shaping (see shaped_text.h for scripts that need it).
+// =============================================================================
+
+#ifndef TEXT_TARGET_H
+#define TEXT_TARGET_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <unordered_map>
+#include <vector>
+
+struct RasterGlyph
+{
+     int w, h;                    // Coverage size; the top row is the line's top
+     int advance;
+     std::vector<Uint8> coverage; // w * h alpha values
+};
+
+struct TextRaster
+{
+     TTF_Font *font;
+     int lineSkip;
+     std::unordered_map<Uint64, RasterGlyph> glyphs; // By style and codepoint
+     int rasterizedCount; // Glyphs rasterized since creation, a cache-miss counter
+};
+
+// `font` is borrowed and must outlive the raster
+void textRasterInit(TextRaster &raster, TTF_Font *font);
+
+// A streaming ARGB8888 texture for textRasterToTexture(), blend mode set
+SDL_Texture *textRasterCreateTexture(SDL_Renderer *renderer, int w, int h);
+
+// Clear `rect` of a streaming ARGB8888 texture (the whole texture for
+// nullptr) to transparent and write UTF-8 text into it, clipped to the
+// rect. `w`/`h` receive the size the text needed, which may exceed it.
+bool textRasterToTexture(TextRaster &raster, SDL_Texture *texture, const SDL_Rect *rect, const char *text,
+                         SDL_Color color, int *w = nullptr, int *h = nullptr);
+
+// The same into caller memory of width x height ARGB8888 pixels
+void textRasterToPixels(TextRaster &raster, void *pixels, int pitch, int width, int height, const char *text,
+                        SDL_Color color, int *w = nullptr, int *h = nullptr);
+
+void textRasterDestroy(TextRaster &raster);
+
+#endif // TEXT_TARGET_H
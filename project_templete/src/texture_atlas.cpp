@@ -0,0 +1,362 @@
+#include "texture_atlas.h"
+
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <iostream>
+
+#include "aligned_surface.h"
+#include "dds_image.h"
+#include "render_record.h"
+
+namespace
+{
+     // --- Skyline Packer ---
+     // The skyline is the top contour of everything packed so far, stored as
+     // horizontal segments from left to right. A new rect goes wherever it
+     // rests lowest on the contour.
+
+     struct SkylineSegment
+     {
+          int x, y, width;
+     };
+
+     struct Skyline
+     {
+          int width, height;
+          std::vector<SkylineSegment> segments;
+     };
+
+     void skylineInit(Skyline &sky, int width, int height)
+     {
+          sky.width = width;
+          sky.height = height;
+          sky.segments.assign(1, SkylineSegment{0, 0, width});
+     }
+
+     // Height at which a w x h rect would sit if its left edge starts at
+     // segment `index`, or -1 if it doesn't fit there
+     int skylineFitY(const Skyline &sky, size_t index, int w, int h)
+     {
+          int x = sky.segments[index].x;
+          if (x + w > sky.width)
+          {
+               return -1;
+          }
+          int y = 0;
+          int remaining = w;
+          while (remaining > 0)
+          {
+               if (index >= sky.segments.size())
+               {
+                    return -1;
+               }
+               y = SDL_max(y, sky.segments[index].y);
+               if (y + h > sky.height)
+               {
+                    return -1;
+               }
+               remaining -= sky.segments[index].width;
+               index++;
+          }
+          return y;
+     }
+
+     bool skylinePack(Skyline &sky, int w, int h, SDL_Point &out)
+     {
+          int bestY = sky.height + 1;
+          int bestWidth = sky.width + 1;
+          size_t bestIndex = sky.segments.size();
+
+          // Lowest resting position wins, ties go to the narrower segment
+          for (size_t i = 0; i < sky.segments.size(); i++)
+          {
+               int y = skylineFitY(sky, i, w, h);
+               if (y >= 0 && (y < bestY || (y == bestY && sky.segments[i].width < bestWidth)))
+               {
+                    bestY = y;
+                    bestWidth = sky.segments[i].width;
+                    bestIndex = i;
+               }
+          }
+          if (bestIndex == sky.segments.size())
+          {
+               return false;
+          }
+
+          out.x = sky.segments[bestIndex].x;
+          out.y = bestY;
+
+          // Raise the contour under the new rect and trim what it covers
+          SkylineSegment placed = {out.x, bestY + h, w};
+          sky.segments.insert(sky.segments.begin() + bestIndex, placed);
+          size_t i = bestIndex + 1;
+          while (i < sky.segments.size())
+          {
+               SkylineSegment &seg = sky.segments[i];
+               int placedRight = placed.x + placed.width;
+               if (seg.x >= placedRight)
+               {
+                    break;
+               }
+               int shrink = placedRight - seg.x;
+               if (shrink >= seg.width)
+               {
+                    sky.segments.erase(sky.segments.begin() + i);
+                    continue;
+               }
+               seg.x += shrink;
+               seg.width -= shrink;
+               break;
+          }
+
+          // Merge neighbours at the same height
+          for (size_t j = 0; j + 1 < sky.segments.size();)
+          {
+               if (sky.segments[j].y == sky.segments[j + 1].y)
+               {
+                    sky.segments[j].width += sky.segments[j + 1].width;
+                    sky.segments.erase(sky.segments.begin() + j + 1);
+               }
+               else
+               {
+                    j++;
+               }
+          }
+          return true;
+     }
+
+     SDL_Texture *uploadPage(SDL_Renderer *renderer, SDL_Surface *page)
+     {
+          SDL_Texture *texture = renderRecordCreateTextureFromSurface(renderer, page);
+          if (texture == nullptr)
+          {
+               std::cerr << "Unable to create atlas page texture! SDL Error: " << SDL_GetError() << std::endl;
+               return nullptr;
+          }
+          renderRecordSetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+          return texture;
+     }
+
+     void addSprite(TextureAtlas &atlas, const std::string &name, SDL_Texture *texture, const SDL_Rect &src)
+     {
+          atlas.spriteIndex[name] = (int)atlas.sprites.size();
+          atlas.sprites.push_back(AtlasSprite{texture, src});
+     }
+}
+
+void atlasBuilderInit(AtlasBuilder &builder, int pageSize, int padding)
+{
+     builder.pageSize = pageSize;
+     builder.padding = padding;
+     builder.names.clear();
+     builder.surfaces.clear();
+}
+
+bool atlasBuilderAddFile(AtlasBuilder &builder, const std::string &name, const std::string &path)
+{
+     SDL_RWops *rw = SDL_RWFromFile(path.c_str(), "rb");
+     if (rw == nullptr)
+     {
+          std::cerr << "Unable to open image " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     SDL_Surface *surface = imageLoadSurface(rw, 1);
+     if (surface == nullptr)
+     {
+          std::cerr << "Unable to load image " << path << "! SDL_image Error: " << IMG_GetError() << std::endl;
+          return false;
+     }
+     return atlasBuilderAddSurface(builder, name, surface);
+}
+
+bool atlasBuilderAddSurface(AtlasBuilder &builder, const std::string &name, SDL_Surface *surface)
+{
+     int limit = builder.pageSize - 2 * builder.padding;
+     if (surface->w > limit || surface->h > limit)
+     {
+          std::cerr << "Image " << name << " (" << surface->w << "x" << surface->h
+                    << ") does not fit in a " << builder.pageSize << " atlas page" << std::endl;
+          SDL_FreeSurface(surface);
+          return false;
+     }
+     builder.names.push_back(name);
+     builder.surfaces.push_back(surface);
+     return true;
+}
+
+bool atlasBuild(AtlasBuilder &builder, SDL_Renderer *renderer, TextureAtlas &atlas, std::vector<SDL_Surface *> *keepPages)
+{
+     // Tallest first packs noticeably tighter with a skyline
+     std::vector<size_t> order(builder.surfaces.size());
+     for (size_t i = 0; i < order.size(); i++)
+     {
+          order[i] = i;
+     }
+     std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                      { return builder.surfaces[a]->h > builder.surfaces[b]->h; });
+
+     bool ok = true;
+     size_t next = 0;
+     while (next < order.size() && ok)
+     {
+          SDL_Surface *page = alignedSurfaceCreate(builder.pageSize, builder.pageSize, SDL_PIXELFORMAT_ARGB8888);
+          if (page == nullptr)
+          {
+               std::cerr << "Unable to create atlas page! SDL Error: " << SDL_GetError() << std::endl;
+               ok = false;
+               break;
+          }
+          SDL_FillRect(page, NULL, 0);
+
+          Skyline sky;
+          skylineInit(sky, builder.pageSize, builder.pageSize);
+
+          // Fill this page with whatever still fits, in order
+          std::vector<std::pair<size_t, SDL_Rect>> placed;
+          std::vector<size_t> leftover;
+          for (; next < order.size(); next++)
+          {
+               size_t i = order[next];
+               SDL_Surface *surface = builder.surfaces[i];
+               SDL_Point at;
+               if (!skylinePack(sky, surface->w + 2 * builder.padding, surface->h + 2 * builder.padding, at))
+               {
+                    leftover.push_back(i);
+                    continue;
+               }
+               SDL_Rect dst = {at.x + builder.padding, at.y + builder.padding, surface->w, surface->h};
+               SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+               SDL_BlitSurface(surface, NULL, page, &dst);
+               placed.push_back(std::make_pair(i, dst));
+          }
+
+          SDL_Texture *texture = uploadPage(renderer, page);
+          if (texture == nullptr)
+          {
+               SDL_FreeSurface(page);
+               ok = false;
+               break;
+          }
+          atlas.pages.push_back(texture);
+          if (keepPages != nullptr)
+          {
+               keepPages->push_back(page);
+          }
+          else
+          {
+               SDL_FreeSurface(page);
+          }
+          for (const auto &entry : placed)
+          {
+               addSprite(atlas, builder.names[entry.first], texture, entry.second);
+          }
+
+          // Images that didn't fit start the next page
+          order = leftover;
+          next = 0;
+     }
+
+     atlasBuilderDestroy(builder);
+     return ok;
+}
+
+void atlasBuilderDestroy(AtlasBuilder &builder)
+{
+     for (SDL_Surface *surface : builder.surfaces)
+     {
+          SDL_FreeSurface(surface);
+     }
+     builder.surfaces.clear();
+     builder.names.clear();
+}
+
+bool atlasLoadSheet(TextureAtlas &atlas, SDL_Renderer *renderer, const std::string &imagePath, const std::string &sheetPath)
+{
+     SDL_RWops *rw = SDL_RWFromFile(sheetPath.c_str(), "rb");
+     if (rw == nullptr)
+     {
+          std::cerr << "Unable to open sprite sheet " << sheetPath << "! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     Sint64 size = SDL_RWsize(rw);
+     std::string text(size > 0 ? (size_t)size : 0, '\0');
+     if (size > 0 && SDL_RWread(rw, &text[0], 1, (size_t)size) != (size_t)size)
+     {
+          std::cerr << "Unable to read sprite sheet " << sheetPath << "! SDL Error: " << SDL_GetError() << std::endl;
+          SDL_RWclose(rw);
+          return false;
+     }
+     SDL_RWclose(rw);
+
+     SDL_Surface *image = imageLoadSurface(SDL_RWFromFile(imagePath.c_str(), "rb"), 1);
+     if (image == nullptr)
+     {
+          std::cerr << "Unable to load image " << imagePath << "! SDL_image Error: " << IMG_GetError() << std::endl;
+          return false;
+     }
+     SDL_Texture *texture = uploadPage(renderer, image);
+     SDL_FreeSurface(image);
+     if (texture == nullptr)
+     {
+          return false;
+     }
+     atlas.pages.push_back(texture);
+
+     // One sprite per line: name x y w h; '#' starts a comment
+     size_t lineStart = 0;
+     while (lineStart < text.size())
+     {
+          size_t lineEnd = text.find('\n', lineStart);
+          if (lineEnd == std::string::npos)
+          {
+               lineEnd = text.size();
+          }
+          std::string line = text.substr(lineStart, lineEnd - lineStart);
+          lineStart = lineEnd + 1;
+
+          char name[256];
+          SDL_Rect src;
+          if (line.empty() || line[0] == '#')
+          {
+               continue;
+          }
+          if (SDL_sscanf(line.c_str(), "%255s %d %d %d %d", name, &src.x, &src.y, &src.w, &src.h) == 5)
+          {
+               addSprite(atlas, name, texture, src);
+          }
+     }
+     return true;
+}
+
+const AtlasSprite *atlasFind(const TextureAtlas &atlas, const std::string &name)
+{
+     auto it = atlas.spriteIndex.find(name);
+     if (it == atlas.spriteIndex.end())
+     {
+          return nullptr;
+     }
+     return &atlas.sprites[it->second];
+}
+
+void atlasReplaceTexture(TextureAtlas &atlas, SDL_Texture *from, SDL_Texture *to)
+{
+     std::replace(atlas.pages.begin(), atlas.pages.end(), from, to);
+     for (AtlasSprite &sprite : atlas.sprites)
+     {
+          if (sprite.texture == from)
+          {
+               sprite.texture = to;
+          }
+     }
+}
+
+void atlasDestroy(TextureAtlas &atlas)
+{
+     for (SDL_Texture *page : atlas.pages)
+     {
+          renderRecordDestroyTexture(page);
+     }
+     atlas.pages.clear();
+     atlas.sprites.clear();
+     atlas.spriteIndex.clear();
+}
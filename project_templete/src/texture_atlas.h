@@ -0,0 +1,79 @@
+// Description:
+// Texture atlas built at load time. Images are decoded with IMG_Load_RW,
+// packed into one or a few large pages with a skyline bottom-left packer and
+// uploaded once, so sprites are drawn as sub-rects of a shared texture and a
+// whole frame can render from a single texture.
+//
+// Typical use:
+//     AtlasBuilder builder;
+//     atlasBuilderInit(builder, 2048, 1);
+//     atlasBuilderAddFile(builder, "play_button", "play_button.png");
+//     TextureAtlas atlas;
+//     atlasBuild(builder, renderer, atlas, nullptr);
+//     const AtlasSprite *button = atlasFind(atlas, "play_button");
+//
+// Pre-packed sheets (one PNG plus a text file of "name x y w h" lines) can be
+// loaded with atlasLoadSheet() without going through the packer.
+// =============================================================================
+
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A packed image: the page it lives on and its texel rect on that page
+struct AtlasSprite
+{
+     SDL_Texture *texture;
+     SDL_Rect src;
+};
+
+struct TextureAtlas
+{
+     std::vector<SDL_Texture *> pages;
+     std::vector<AtlasSprite> sprites;
+     std::unordered_map<std::string, int> spriteIndex; // Name to index in sprites
+};
+
+// Images waiting to be packed
+struct AtlasBuilder
+{
+     int pageSize; // Page width and height in pixels
+     int padding;  // Empty texels around each image, prevents filtering bleed
+     std::vector<std::string> names;
+     std::vector<SDL_Surface *> surfaces;
+};
+
+void atlasBuilderInit(AtlasBuilder &builder, int pageSize, int padding);
+
+// Decode an image file and queue it for packing
+bool atlasBuilderAddFile(AtlasBuilder &builder, const std::string &name, const std::string &path);
+
+// Queue an already decoded surface; the builder takes ownership
+bool atlasBuilderAddSurface(AtlasBuilder &builder, const std::string &name, SDL_Surface *surface);
+
+// Pack every queued image, upload the pages and release the surfaces.
+// When `keepPages` is given, the page surfaces are handed back in the
+// order of atlas.pages instead of being freed (e.g. for the asset cache);
+// the caller frees them.
+bool atlasBuild(AtlasBuilder &builder, SDL_Renderer *renderer, TextureAtlas &atlas, std::vector<SDL_Surface *> *keepPages);
+
+// Free any surfaces still queued
+void atlasBuilderDestroy(AtlasBuilder &builder);
+
+// Add a pre-packed sprite sheet to the atlas as an extra page
+bool atlasLoadSheet(TextureAtlas &atlas, SDL_Renderer *renderer, const std::string &imagePath, const std::string &sheetPath);
+
+// Returns nullptr if no sprite has that name
+const AtlasSprite *atlasFind(const TextureAtlas &atlas, const std::string &name);
+
+// Point the page and every sprite on it at `to` instead, e.g. after
+// texture_restore recreated the page; `from` is not destroyed
+void atlasReplaceTexture(TextureAtlas &atlas, SDL_Texture *from, SDL_Texture *to);
+
+void atlasDestroy(TextureAtlas &atlas);
+
+#endif // TEXTURE_ATLAS_H
@@ -0,0 +1,211 @@
+#include "texture_cache.h"
+
+#include <cstring>
+#include <vector>
+
+#include "premultiply.h"
+#include "render_record.h"
+
+namespace
+{
+     const Uint32 CACHE_MAGIC = 0x58455443; // "CTEX" read in native byte order, a swapped file fails
+     const Uint32 CACHE_VERSION = 1;
+
+     struct CacheHeader
+     {
+          Uint32 magic;
+          Uint32 version;
+          Uint32 format;
+          Uint32 flags;
+          Sint32 width;
+          Sint32 height;
+          Sint32 pitch;
+          Uint32 reserved;
+          Uint64 sourceStamp;
+     };
+
+     // Header checks shared by both loaders; on success the stream is at the first row
+     bool readCacheHeader(SDL_RWops *rw, Uint64 sourceStamp, CacheHeader &header)
+     {
+          if (SDL_RWread(rw, &header, sizeof(header), 1) != 1 || header.magic != CACHE_MAGIC ||
+              header.version != CACHE_VERSION || header.sourceStamp != sourceStamp)
+          {
+               return false;
+          }
+          const int bytesPerPixel = SDL_BYTESPERPIXEL(header.format);
+          return header.width > 0 && header.height > 0 && bytesPerPixel > 0 && !SDL_ISPIXELFORMAT_FOURCC(header.format) &&
+                 header.pitch == header.width * bytesPerPixel;
+     }
+
+     bool rendererHasFormat(SDL_Renderer *renderer, Uint32 format)
+     {
+          SDL_RendererInfo info;
+          if (SDL_GetRendererInfo(renderer, &info) != 0)
+          {
+               return false;
+          }
+          for (Uint32 i = 0; i < info.num_texture_formats; i++)
+          {
+               if (info.texture_formats[i] == format)
+               {
+                    return true;
+               }
+          }
+          return false;
+     }
+
+     void applyCacheBlend(SDL_Texture *texture, Uint32 format, Uint32 flags)
+     {
+          if (flags & TEXTURE_CACHE_PREMULTIPLIED)
+          {
+               renderRecordSetTextureBlendMode(texture, premultipliedBlendMode());
+          }
+          else
+          {
+               renderRecordSetTextureBlendMode(texture, SDL_ISPIXELFORMAT_ALPHA(format) ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+          }
+     }
+}
+
+bool textureCacheSave(const char *path, SDL_Surface *surface, Uint32 flags, Uint64 sourceStamp)
+{
+     if (surface == nullptr || SDL_ISPIXELFORMAT_INDEXED(surface->format->format))
+     {
+          SDL_SetError("Texture cache needs a non-palette surface");
+          return false;
+     }
+     CacheHeader header;
+     std::memset(&header, 0, sizeof(header));
+     header.magic = CACHE_MAGIC;
+     header.version = CACHE_VERSION;
+     header.format = surface->format->format;
+     header.flags = flags;
+     header.width = surface->w;
+     header.height = surface->h;
+     header.pitch = surface->w * surface->format->BytesPerPixel; // Rows are written tightly packed
+     header.sourceStamp = sourceStamp;
+
+     SDL_RWops *rw = SDL_RWFromFile(path, "wb");
+     if (rw == nullptr)
+     {
+          return false;
+     }
+     bool complete = SDL_RWwrite(rw, &header, sizeof(header), 1) == 1;
+     if (complete && SDL_LockSurface(surface) == 0)
+     {
+          const Uint8 *row = (const Uint8 *)surface->pixels;
+          if (surface->pitch == header.pitch)
+          {
+               complete = SDL_RWwrite(rw, row, header.pitch, header.height) == (size_t)header.height;
+          }
+          else
+          {
+               for (int y = 0; y < header.height && complete; y++, row += surface->pitch)
+               {
+                    complete = SDL_RWwrite(rw, row, header.pitch, 1) == 1;
+               }
+          }
+          SDL_UnlockSurface(surface);
+     }
+     else
+     {
+          complete = false;
+     }
+     return SDL_RWclose(rw) == 0 && complete;
+}
+
+SDL_Surface *textureCacheLoadSurface(const char *path, Uint64 sourceStamp, Uint32 *flags)
+{
+     SDL_RWops *rw = SDL_RWFromFile(path, "rb");
+     if (rw == nullptr)
+     {
+          return nullptr;
+     }
+     CacheHeader header;
+     SDL_Surface *surface = nullptr;
+     if (readCacheHeader(rw, sourceStamp, header))
+     {
+          surface = SDL_CreateRGBSurfaceWithFormat(0, header.width, header.height, SDL_BITSPERPIXEL(header.format), header.format);
+     }
+     if (surface != nullptr)
+     {
+          bool complete = true;
+          Uint8 *row = (Uint8 *)surface->pixels;
+          if (surface->pitch == header.pitch)
+          {
+               complete = SDL_RWread(rw, row, header.pitch, header.height) == (size_t)header.height;
+          }
+          else
+          {
+               for (int y = 0; y < header.height && complete; y++, row += surface->pitch)
+               {
+                    complete = SDL_RWread(rw, row, header.pitch, 1) == 1;
+               }
+          }
+          if (!complete)
+          {
+               SDL_FreeSurface(surface);
+               surface = nullptr;
+          }
+          else if (flags != nullptr)
+          {
+               *flags = header.flags;
+          }
+     }
+     SDL_RWclose(rw);
+     return surface;
+}
+
+SDL_Texture *textureCacheLoadTexture(SDL_Renderer *renderer, const char *path, Uint64 sourceStamp)
+{
+     SDL_RWops *rw = SDL_RWFromFile(path, "rb");
+     if (rw == nullptr)
+     {
+          return nullptr;
+     }
+     CacheHeader header;
+     if (!readCacheHeader(rw, sourceStamp, header))
+     {
+          SDL_RWclose(rw);
+          return nullptr;
+     }
+
+     SDL_Texture *texture = nullptr;
+     if (rendererHasFormat(renderer, header.format))
+     {
+          // The stored rows are already in a layout the renderer takes as-is
+          std::vector<Uint8> pixels((size_t)header.pitch * header.height);
+          if (SDL_RWread(rw, pixels.data(), 1, pixels.size()) == pixels.size())
+          {
+               texture = SDL_CreateTexture(renderer, header.format, SDL_TEXTUREACCESS_STATIC, header.width, header.height);
+               if (texture != nullptr)
+               {
+                    applyCacheBlend(texture, header.format, header.flags);
+                    renderRecordUpdateTexture(texture, NULL, pixels.data(), header.pitch);
+               }
+          }
+          SDL_RWclose(rw);
+          return texture;
+     }
+
+     // A cache written under a different renderer still loads, with a conversion
+     SDL_RWclose(rw);
+     Uint32 flags = 0;
+     SDL_Surface *surface = textureCacheLoadSurface(path, sourceStamp, &flags);
+     if (surface != nullptr)
+     {
+          texture = textureCacheCreateTexture(renderer, surface, flags);
+          SDL_FreeSurface(surface);
+     }
+     return texture;
+}
+
+SDL_Texture *textureCacheCreateTexture(SDL_Renderer *renderer, SDL_Surface *surface, Uint32 flags)
+{
+     SDL_Texture *texture = renderRecordCreateTextureFromSurface(renderer, surface);
+     if (texture != nullptr)
+     {
+          applyCacheBlend(texture, surface->format->format, flags);
+     }
+     return texture;
+}
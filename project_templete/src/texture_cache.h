@@ -0,0 +1,45 @@
+// Description:
+// Raw pixel cache for textures that are expensive to produce: premultiplied,
+// atlased or otherwise processed at load time. The first launch builds the
+// pixels and saves them with textureCacheSave(); later launches read the
+// file with one read and hand the rows straight to SDL_UpdateTexture, with
+// no decode or format conversion on the way.
+//
+// The file is a small header followed by the rows exactly as they were in
+// the surface, so it is only meant for the machine that wrote it. The
+// caller passes a stamp describing the source (a hash of the inputs, their
+// modification times, a build number); a cache with a different stamp,
+// version or a damaged header fails to load and should be rebuilt.
+//
+//     SDL_Texture *page = textureCacheLoadTexture(renderer, "cache/ui.tex", stamp);
+//     if (page == nullptr)
+//     {
+//          SDL_Surface *surface = buildUiPage(); // The slow path
+//          textureCacheSave("cache/ui.tex", surface, TEXTURE_CACHE_PREMULTIPLIED, stamp);
+//          page = textureCacheCreateTexture(renderer, surface, TEXTURE_CACHE_PREMULTIPLIED);
+//     }
+// =============================================================================
+
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <SDL2/SDL.h>
+
+// Flags stored with the pixels
+const Uint32 TEXTURE_CACHE_PREMULTIPLIED = 1 << 0; // Colour already multiplied by alpha
+
+// Write `surface` with its pixel format as-is
+bool textureCacheSave(const char *path, SDL_Surface *surface, Uint32 flags, Uint64 sourceStamp);
+
+// Read a cache back into a surface of the stored format; nullptr if missing,
+// damaged or stale. `flags` receives the stored flags and may be nullptr.
+SDL_Surface *textureCacheLoadSurface(const char *path, Uint64 sourceStamp, Uint32 *flags);
+
+// Read a cache straight into a new static texture, blend mode set from the
+// stored flags; nullptr if missing, damaged or stale
+SDL_Texture *textureCacheLoadTexture(SDL_Renderer *renderer, const char *path, Uint64 sourceStamp);
+
+// Upload a surface the same way a loaded cache would be, for the first launch
+SDL_Texture *textureCacheCreateTexture(SDL_Renderer *renderer, SDL_Surface *surface, Uint32 flags);
+
+#endif // TEXTURE_CACHE_H
@@ -0,0 +1,413 @@
+#include "texture_restore.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "lz4_block.h"
+#include "render_record.h"
+#include "texture_cache.h"
+
+namespace
+{
+     // The texture's format and look, from the texture itself; false for
+     // anything but a static texture in a packed format, whose contents
+     // the app redraws or streams on its own
+     bool describeEntry(TextureRestoreEntry &entry, SDL_Texture *texture)
+     {
+          int access = 0;
+          if (texture == nullptr ||
+              SDL_QueryTexture(texture, &entry.format, &access, &entry.width, &entry.height) != 0 ||
+              access != SDL_TEXTUREACCESS_STATIC || SDL_ISPIXELFORMAT_FOURCC(entry.format))
+          {
+               return false;
+          }
+          entry.texture = texture;
+          SDL_GetTextureBlendMode(texture, &entry.blendMode);
+          SDL_GetTextureScaleMode(texture, &entry.scaleMode);
+          SDL_GetTextureColorMod(texture, &entry.r, &entry.g, &entry.b);
+          SDL_GetTextureAlphaMod(texture, &entry.a);
+          entry.stamp = 0;
+          entry.remap = nullptr;
+          entry.remapData = nullptr;
+          entry.lastUsed = 0;
+          entry.decoded = nullptr;
+          entry.waiting = false;
+          return true;
+     }
+
+     SDL_Surface *unpackPixels(const TextureRestoreEntry &entry)
+     {
+          SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, entry.width, entry.height,
+                                                               SDL_BITSPERPIXEL(entry.format), entry.format);
+          if (surface == nullptr)
+          {
+               return nullptr;
+          }
+          const int rowBytes = entry.width * SDL_BYTESPERPIXEL(entry.format);
+          bool unpacked;
+          if (surface->pitch == rowBytes)
+          {
+               unpacked = lz4BlockDecompress(entry.packed.data(), (int)entry.packed.size(), (Uint8 *)surface->pixels,
+                                             rowBytes * entry.height);
+          }
+          else
+          {
+               std::vector<Uint8> rows((size_t)rowBytes * entry.height);
+               unpacked = lz4BlockDecompress(entry.packed.data(), (int)entry.packed.size(), rows.data(), (int)rows.size());
+               for (int y = 0; unpacked && y < entry.height; y++)
+               {
+                    SDL_memcpy((Uint8 *)surface->pixels + (size_t)y * surface->pitch, rows.data() + (size_t)y * rowBytes,
+                               rowBytes);
+               }
+          }
+          if (!unpacked)
+          {
+               SDL_FreeSurface(surface);
+               return nullptr;
+          }
+          return surface;
+     }
+
+     SDL_Surface *loadCacheFile(const TextureRestoreEntry &entry)
+     {
+          SDL_Surface *surface = textureCacheLoadSurface(entry.path.c_str(), entry.stamp, nullptr);
+          if (surface != nullptr && surface->format->format != entry.format)
+          {
+               SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface, entry.format, 0);
+               SDL_FreeSurface(surface);
+               surface = converted;
+          }
+          if (surface != nullptr && (surface->w != entry.width || surface->h != entry.height))
+          {
+               SDL_FreeSurface(surface);
+               surface = nullptr;
+          }
+          return surface;
+     }
+
+     // Worker side: only reads the source and writes `decoded`
+     void decodeJob(void *data, int)
+     {
+          TextureRestoreEntry &entry = *(TextureRestoreEntry *)data;
+          entry.decoded = entry.packed.empty() ? loadCacheFile(entry) : unpackPixels(entry);
+     }
+
+     void waitForDecodes(TextureRestore &restore)
+     {
+          if (restore.jobs != nullptr)
+          {
+               jobSystemWait(*restore.jobs, restore.visibleDecodes);
+               jobSystemWait(*restore.jobs, restore.otherDecodes);
+          }
+     }
+
+     // Drop whatever an earlier reset left unfilled
+     void abandonRestore(TextureRestore &restore)
+     {
+          waitForDecodes(restore);
+          for (TextureRestoreEntry *entry : restore.order)
+          {
+               SDL_FreeSurface(entry->decoded);
+               entry->decoded = nullptr;
+          }
+          restore.order.clear();
+          restore.visibleCount = 0;
+     }
+
+     void fillEntry(TextureRestoreEntry &entry)
+     {
+          if (entry.decoded != nullptr)
+          {
+               renderRecordUpdateTexture(entry.texture, nullptr, entry.decoded->pixels, entry.decoded->pitch);
+               SDL_SetTextureColorMod(entry.texture, entry.r, entry.g, entry.b);
+               SDL_SetTextureAlphaMod(entry.texture, entry.a);
+               SDL_FreeSurface(entry.decoded);
+               entry.decoded = nullptr;
+          }
+          else
+          {
+               std::cerr << "Unable to restore a " << entry.width << "x" << entry.height << " texture"
+                         << (entry.path.empty() ? "" : " from ") << entry.path << ", it stays hidden!" << std::endl;
+          }
+          entry.waiting = false;
+     }
+
+     void resetTextures(TextureRestore &restore)
+     {
+          abandonRestore(restore);
+
+          // Every replacement exists before any remap runs and before any old
+          // texture is destroyed, so an address is never reused in between
+          std::vector<SDL_Texture *> created(restore.entries.size(), nullptr);
+          for (size_t i = 0; i < restore.entries.size(); i++)
+          {
+               const TextureRestoreEntry &entry = *restore.entries[i];
+               created[i] = SDL_CreateTexture(restore.renderer, entry.format, SDL_TEXTUREACCESS_STATIC, entry.width,
+                                              entry.height);
+               if (created[i] == nullptr)
+               {
+                    std::cerr << "Unable to recreate a texture after the device reset! SDL Error: " << SDL_GetError()
+                              << std::endl;
+                    continue;
+               }
+               renderRecordSetTextureBlendMode(created[i], entry.blendMode);
+               SDL_SetTextureScaleMode(created[i], entry.scaleMode);
+               SDL_SetTextureColorMod(created[i], 0, 0, 0);
+               SDL_SetTextureAlphaMod(created[i], 0);
+          }
+          for (size_t i = 0; i < restore.entries.size(); i++)
+          {
+               TextureRestoreEntry &entry = *restore.entries[i];
+               if (created[i] != nullptr && entry.remap != nullptr)
+               {
+                    entry.remap(entry.remapData, entry.texture, created[i]);
+               }
+          }
+          for (size_t i = 0; i < restore.entries.size(); i++)
+          {
+               TextureRestoreEntry &entry = *restore.entries[i];
+               if (created[i] == nullptr)
+               {
+                    continue;
+               }
+               renderRecordDestroyTexture(entry.texture);
+               entry.texture = created[i];
+               entry.waiting = true;
+               restore.order.push_back(&entry);
+          }
+
+          // Drawn in the frame before the reset (or the one before that, if
+          // the reset came ahead of this frame's update) goes first
+          const Uint64 recent = restore.updates > 0 ? restore.updates - 1 : 0;
+          std::stable_sort(restore.order.begin(), restore.order.end(),
+                           [](const TextureRestoreEntry *a, const TextureRestoreEntry *b)
+                           { return a->lastUsed > b->lastUsed; });
+          restore.visibleCount = 0;
+          for (TextureRestoreEntry *entry : restore.order)
+          {
+               const bool visible = entry->lastUsed >= recent;
+               restore.visibleCount += visible ? 1 : 0;
+               if (restore.jobs != nullptr)
+               {
+                    jobSystemSubmit(*restore.jobs, decodeJob, entry,
+                                    visible ? &restore.visibleDecodes : &restore.otherDecodes);
+               }
+          }
+          restore.resets++;
+          restore.resetCounter = SDL_GetPerformanceCounter();
+     }
+
+     TextureRestoreEntry *findEntry(TextureRestore &restore, SDL_Texture *texture)
+     {
+          for (TextureRestoreEntry *entry : restore.entries)
+          {
+               if (entry->texture == texture)
+               {
+                    return entry;
+               }
+          }
+          return nullptr;
+     }
+}
+
+void textureRestoreInit(TextureRestore &restore, SDL_Renderer *renderer, JobSystem *jobs)
+{
+     restore.renderer = renderer;
+     restore.jobs = jobs;
+     restore.enabled = SDL_GetHintBoolean(TEXTURE_RESTORE_HINT, SDL_TRUE);
+     restore.entries.clear();
+     restore.updates = 0;
+     restore.visibleDecodes = {};
+     restore.otherDecodes = {};
+     restore.order.clear();
+     restore.visibleCount = 0;
+     restore.retainedBytes = 0;
+     restore.rawBytes = 0;
+     restore.resets = 0;
+     restore.resetCounter = 0;
+     restore.lastRestoreMs = 0.0;
+}
+
+bool textureRestoreRetainPixels(TextureRestore &restore, SDL_Texture *texture, SDL_Surface *surface,
+                                TextureRestoreRemap remap, void *remapData)
+{
+     TextureRestoreEntry described;
+     if (!restore.enabled || surface == nullptr || !describeEntry(described, texture) ||
+         surface->w != described.width || surface->h != described.height)
+     {
+          return false;
+     }
+     const Sint64 rowBytes = (Sint64)described.width * SDL_BYTESPERPIXEL(described.format);
+     if (rowBytes * described.height > SDL_MAX_SINT32 / 2)
+     {
+          return false;
+     }
+
+     // Retained in the texture's own format, so a restore never converts
+     SDL_Surface *converted = surface;
+     if (surface->format->format != described.format)
+     {
+          converted = SDL_ConvertSurfaceFormat(surface, described.format, 0);
+          if (converted == nullptr)
+          {
+               return false;
+          }
+     }
+     std::vector<Uint8> rows((size_t)(rowBytes * described.height));
+     const bool locked = SDL_MUSTLOCK(converted);
+     if (locked)
+     {
+          SDL_LockSurface(converted);
+     }
+     for (int y = 0; y < described.height; y++)
+     {
+          SDL_memcpy(rows.data() + (size_t)(y * rowBytes), (const Uint8 *)converted->pixels + (size_t)y * converted->pitch,
+                     (size_t)rowBytes);
+     }
+     if (locked)
+     {
+          SDL_UnlockSurface(converted);
+     }
+     if (converted != surface)
+     {
+          SDL_FreeSurface(converted);
+     }
+
+     described.packed.resize(lz4BlockBound((int)rows.size()));
+     const int packedSize = lz4BlockCompress(rows.data(), (int)rows.size(), described.packed.data(), (int)described.packed.size());
+     if (packedSize <= 0)
+     {
+          return false;
+     }
+     described.packed.resize(packedSize);
+     described.packed.shrink_to_fit();
+     described.remap = remap;
+     described.remapData = remapData;
+
+     textureRestoreForget(restore, texture);
+     restore.entries.push_back(new TextureRestoreEntry(std::move(described)));
+     restore.retainedBytes += packedSize;
+     restore.rawBytes += (Sint64)rows.size();
+     return true;
+}
+
+bool textureRestoreRetainFile(TextureRestore &restore, SDL_Texture *texture, const std::string &path, Uint64 stamp,
+                              TextureRestoreRemap remap, void *remapData)
+{
+     TextureRestoreEntry described;
+     if (!restore.enabled || path.empty() || !describeEntry(described, texture))
+     {
+          return false;
+     }
+     described.path = path;
+     described.stamp = stamp;
+     described.remap = remap;
+     described.remapData = remapData;
+
+     textureRestoreForget(restore, texture);
+     restore.entries.push_back(new TextureRestoreEntry(std::move(described)));
+     return true;
+}
+
+void textureRestoreForget(TextureRestore &restore, SDL_Texture *texture)
+{
+     TextureRestoreEntry *entry = findEntry(restore, texture);
+     if (entry == nullptr)
+     {
+          return;
+     }
+     if (entry->waiting)
+     {
+          waitForDecodes(restore); // A decode job may still hold it
+          SDL_FreeSurface(entry->decoded);
+          const auto waiting = std::find(restore.order.begin(), restore.order.end(), entry);
+          if (waiting - restore.order.begin() < restore.visibleCount)
+          {
+               restore.visibleCount--;
+          }
+          restore.order.erase(waiting);
+     }
+     if (!entry->packed.empty())
+     {
+          restore.retainedBytes -= (Sint64)entry->packed.size();
+          restore.rawBytes -= (Sint64)entry->width * entry->height * SDL_BYTESPERPIXEL(entry->format);
+     }
+     restore.entries.erase(std::find(restore.entries.begin(), restore.entries.end(), entry));
+     delete entry;
+}
+
+void textureRestoreTouch(TextureRestore &restore, SDL_Texture *texture)
+{
+     TextureRestoreEntry *entry = findEntry(restore, texture);
+     if (entry != nullptr)
+     {
+          entry->lastUsed = restore.updates;
+     }
+}
+
+void textureRestoreHandleEvent(TextureRestore &restore, const SDL_Event &event)
+{
+     if (event.type == SDL_RENDER_DEVICE_RESET && !restore.entries.empty())
+     {
+          resetTextures(restore);
+     }
+}
+
+int textureRestoreUpdate(TextureRestore &restore, double budgetMs)
+{
+     restore.updates++;
+     if (restore.order.empty())
+     {
+          return 0;
+     }
+     if (restore.jobs != nullptr)
+     {
+          jobSystemWait(*restore.jobs, restore.visibleDecodes);
+     }
+
+     const Uint64 start = SDL_GetPerformanceCounter();
+     const Uint64 budget = (Uint64)(budgetMs * SDL_GetPerformanceFrequency() / 1000.0);
+     int filled = 0;
+     for (TextureRestoreEntry *entry : restore.order)
+     {
+          if (filled >= restore.visibleCount)
+          {
+               if (SDL_GetPerformanceCounter() - start > budget ||
+                   (restore.jobs != nullptr && !jobCounterDone(restore.otherDecodes)))
+               {
+                    break;
+               }
+          }
+          if (restore.jobs == nullptr)
+          {
+               decodeJob(entry, 0);
+          }
+          fillEntry(*entry);
+          filled++;
+     }
+     restore.order.erase(restore.order.begin(), restore.order.begin() + filled);
+     restore.visibleCount = SDL_max(restore.visibleCount - filled, 0);
+     if (restore.order.empty())
+     {
+          restore.lastRestoreMs = (double)(SDL_GetPerformanceCounter() - restore.resetCounter) * 1000.0 /
+                                  SDL_GetPerformanceFrequency();
+     }
+     return filled;
+}
+
+bool textureRestorePending(const TextureRestore &restore)
+{
+     return !restore.order.empty();
+}
+
+void textureRestoreDestroy(TextureRestore &restore)
+{
+     abandonRestore(restore);
+     for (TextureRestoreEntry *entry : restore.entries)
+     {
+          delete entry;
+     }
+     restore.entries.clear();
+     restore.retainedBytes = 0;
+     restore.rawBytes = 0;
+}
@@ -0,0 +1,112 @@
+// Description:
+// Brings textures back after SDL_RENDER_DEVICE_RESET (a lost Direct3D
+// device, mostly) without going back to the original assets. SDL tells the
+// app that every texture is gone, and reloading them the way the game did
+// at startup means decoding and packing PNGs again, which takes seconds.
+//
+// Every texture worth saving is registered with a CPU-side source. That is
+// either a retained copy of its pixels, LZ4-compressed in the texture's own
+// format (textureRestoreRetainPixels), or a texture_cache file already on
+// disk, such as an asset cache atlas page (textureRestoreRetainFile).
+//
+// On the reset, textureRestoreHandleEvent() creates every replacement
+// texture at once, hidden with a zero colour and alpha modulation. It hands
+// each caller its (old, new) pair through the remap callback, and starts
+// decoding the sources on the job system. textureRestoreUpdate() then
+// fills and shows them from the main thread. Textures drawn in the last
+// frame (see textureRestoreTouch) come first, in full, on the next update;
+// the rest follow within a per-frame time budget. A texture whose file has
+// gone missing stays hidden.
+//
+// Setting TEXTURE_RESTORE_HINT to "0" turns retention off. Textures are
+// then lost on a reset, as before.
+// =============================================================================
+
+#ifndef TEXTURE_RESTORE_H
+#define TEXTURE_RESTORE_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#include "job_system.h"
+
+#define TEXTURE_RESTORE_HINT "CATCH_TEXTURE_RESTORE"
+
+// `from` has been replaced by `to`; swap every pointer to it. Both are
+// alive during the call, so no address is shared by two textures
+typedef void (*TextureRestoreRemap)(void *userdata, SDL_Texture *from, SDL_Texture *to);
+
+struct TextureRestoreEntry
+{
+     SDL_Texture *texture;
+     Uint32 format;
+     int width, height;
+     SDL_BlendMode blendMode;
+     SDL_ScaleMode scaleMode;
+     Uint8 r, g, b, a; // Colour and alpha modulation shown once filled
+
+     std::vector<Uint8> packed; // LZ4 rows, width * bytes per pixel apart; empty for a file
+     std::string path;          // texture_cache file, for an entry with no packed copy
+     Uint64 stamp;
+
+     TextureRestoreRemap remap;
+     void *remapData;
+     Uint64 lastUsed; // Update count at the last textureRestoreTouch()
+
+     SDL_Surface *decoded; // Set by the decode job
+     bool waiting;         // Created, not filled yet
+};
+
+struct TextureRestore
+{
+     SDL_Renderer *renderer;
+     JobSystem *jobs; // May be null: sources decode on the main thread
+     bool enabled;
+     std::vector<TextureRestoreEntry *> entries;
+     Uint64 updates;
+
+     JobCounter visibleDecodes; // Entries touched in the frame before the reset
+     JobCounter otherDecodes;
+     std::vector<TextureRestoreEntry *> order; // Waiting entries, most wanted first
+     int visibleCount;                         // Leading entries of order filled regardless of the budget
+
+     Sint64 retainedBytes; // Compressed copies held
+     Sint64 rawBytes;      // What they would take uncompressed
+     int resets;
+     Uint64 resetCounter; // Performance counter at the last reset
+     double lastRestoreMs; // Reset to everything shown, for the last reset
+};
+
+void textureRestoreInit(TextureRestore &restore, SDL_Renderer *renderer, JobSystem *jobs);
+
+// Keep a compressed copy of `surface`, the pixels `texture` was made from.
+// `remap` (which may be null) is told when the texture is replaced. False
+// when retention is off or the copy can't be made
+bool textureRestoreRetainPixels(TextureRestore &restore, SDL_Texture *texture, SDL_Surface *surface,
+                                TextureRestoreRemap remap, void *remapData);
+
+// Restore `texture` from the texture_cache file at `path`, saved with
+// `stamp`; nothing is read until a reset
+bool textureRestoreRetainFile(TextureRestore &restore, SDL_Texture *texture, const std::string &path, Uint64 stamp,
+                              TextureRestoreRemap remap, void *remapData);
+
+// Stop tracking `texture`, before destroying it
+void textureRestoreForget(TextureRestore &restore, SDL_Texture *texture);
+
+// Mark `texture` as drawn this frame, so it is shown first after a reset
+void textureRestoreTouch(TextureRestore &restore, SDL_Texture *texture);
+
+// Pass every event; acts on SDL_RENDER_DEVICE_RESET
+void textureRestoreHandleEvent(TextureRestore &restore, const SDL_Event &event);
+
+// Once per frame before drawing. Fills the textures recorded as visible in
+// full, then others for up to `budgetMs`. Returns how many were filled
+int textureRestoreUpdate(TextureRestore &restore, double budgetMs = 4.0);
+
+// True while some replaced texture is still hidden
+bool textureRestorePending(const TextureRestore &restore);
+
+void textureRestoreDestroy(TextureRestore &restore);
+
+#endif // TEXTURE_RESTORE_H
@@ -0,0 +1,104 @@
+#include "texture_ring.h"
+
+#include <iostream>
+
+#include "render_record.h"
+
+namespace
+{
+     // Never drawn, so immediately reusable
+     const Uint64 NEVER_SUBMITTED = ~(Uint64)0;
+
+     bool reusable(const TextureRing &ring, int slot)
+     {
+          Uint64 submitted = ring.submittedFrame[slot];
+          return submitted == NEVER_SUBMITTED || ring.frame >= submitted + ring.textures.size() - 1;
+     }
+}
+
+bool textureRingInit(TextureRing &ring, SDL_Renderer *renderer, Uint32 format, int width, int height, int count)
+{
+     ring.frame = 0;
+     ring.next = 0;
+     ring.locked = -1;
+     ring.current = -1;
+     ring.skippedLocks = 0;
+     for (int i = 0; i < SDL_max(count, 1); i++)
+     {
+          SDL_Texture *texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STREAMING, width, height);
+          if (texture == nullptr)
+          {
+               std::cerr << "Unable to create streaming texture! SDL Error: " << SDL_GetError() << std::endl;
+               textureRingDestroy(ring);
+               return false;
+          }
+          ring.textures.push_back(texture);
+          ring.submittedFrame.push_back(NEVER_SUBMITTED);
+     }
+     return true;
+}
+
+bool textureRingLock(TextureRing &ring, void **pixels, int *pitch)
+{
+     int count = (int)ring.textures.size();
+     for (int i = 0; i < count; i++)
+     {
+          int slot = (ring.next + i) % count;
+          // The current slot may still be drawn this frame; never write it
+          if (slot == ring.current || !reusable(ring, slot))
+          {
+               continue;
+          }
+          if (renderRecordLockTexture(ring.textures[slot], NULL, pixels, pitch) != 0)
+          {
+               return false;
+          }
+          ring.locked = slot;
+          return true;
+     }
+     ring.skippedLocks++;
+     return false;
+}
+
+void textureRingUnlock(TextureRing &ring)
+{
+     if (ring.locked < 0)
+     {
+          return;
+     }
+     renderRecordUnlockTexture(ring.textures[ring.locked]);
+     ring.current = ring.locked;
+     ring.next = (ring.locked + 1) % (int)ring.textures.size();
+     ring.locked = -1;
+}
+
+SDL_Texture *textureRingCurrent(TextureRing &ring)
+{
+     if (ring.current < 0)
+     {
+          return nullptr;
+     }
+     ring.submittedFrame[ring.current] = ring.frame;
+     return ring.textures[ring.current];
+}
+
+void textureRingFrameEnd(TextureRing &ring)
+{
+     ring.frame++;
+}
+
+void textureRingDestroy(TextureRing &ring)
+{
+     if (ring.locked >= 0)
+     {
+          renderRecordUnlockTexture(ring.textures[ring.locked]);
+          ring.locked = -1;
+     }
+     for (SDL_Texture *texture : ring.textures)
+     {
+          renderRecordDestroyTexture(texture);
+     }
+     ring.textures.clear();
+     ring.submittedFrame.clear();
+     ring.current = -1;
+}
@@ -0,0 +1,46 @@
+// Description:
+// A ring of streaming textures for per-frame uploads. Locking the texture
+// the GPU is still reading from makes the driver stall or copy, so writes
+// rotate through `count` textures. With three, the CPU fills frame N+2
+// while frames N and N+1 are still queued. SDL2 exposes no GPU fences, so
+// the reuse check counts presented frames instead: a slot is handed out
+// again only after count - 1 later frames have been presented, the same
+// guarantee a triple-buffered swap chain gives. When no slot qualifies,
+// textureRingLock() fails rather than blocking, and the caller keeps
+// showing the previous upload.
+// =============================================================================
+
+#ifndef TEXTURE_RING_H
+#define TEXTURE_RING_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct TextureRing
+{
+     std::vector<SDL_Texture *> textures;
+     std::vector<Uint64> submittedFrame; // Frame each slot was last drawn in
+     Uint64 frame;                       // Frames presented so far
+     int next;                           // Slot the next lock tries first
+     int locked;                         // Slot being written, or -1
+     int current;                        // Slot with the latest upload, or -1
+     int skippedLocks;                   // Locks refused by the reuse check
+};
+
+bool textureRingInit(TextureRing &ring, SDL_Renderer *renderer, Uint32 format, int width, int height, int count = 3);
+
+// Lock the next reusable slot for writing; false if none is free yet
+bool textureRingLock(TextureRing &ring, void **pixels, int *pitch);
+
+// Finish writing; the locked slot becomes the current texture
+void textureRingUnlock(TextureRing &ring);
+
+// Latest uploaded texture (marks it as used in this frame), or nullptr
+SDL_Texture *textureRingCurrent(TextureRing &ring);
+
+// Call once per SDL_RenderPresent
+void textureRingFrameEnd(TextureRing &ring);
+
+void textureRingDestroy(TextureRing &ring);
+
+#endif // TEXTURE_RING_H
@@ -0,0 +1,221 @@
+#include "thread_affinity.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#include <pthread/qos.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace
+{
+#if defined(_WIN32)
+     typedef HANDLE(WINAPI *AvSetFunction)(LPCWSTR, LPDWORD);
+     typedef BOOL(WINAPI *AvRevertFunction)(HANDLE);
+     typedef BOOL(WINAPI *SetThreadInformationFunction)(HANDLE, int, LPVOID, DWORD);
+
+     // Not in every SDK's headers; Windows 10 1709 and later
+     const int THREAD_INFORMATION_POWER_THROTTLING = 3;
+     struct ThreadPowerThrottling
+     {
+          ULONG version;
+          ULONG controlMask;
+          ULONG stateMask;
+     };
+
+     struct MmcssFunctions
+     {
+          AvSetFunction begin;
+          AvRevertFunction revert;
+     };
+
+     const MmcssFunctions &mmcss()
+     {
+          static const MmcssFunctions functions = []
+          {
+               MmcssFunctions found = {nullptr, nullptr};
+               HMODULE avrt = LoadLibraryW(L"avrt.dll");
+               if (avrt != NULL)
+               {
+                    found.begin = (AvSetFunction)(void *)GetProcAddress(avrt, "AvSetMmThreadCharacteristicsW");
+                    found.revert = (AvRevertFunction)(void *)GetProcAddress(avrt, "AvRevertMmThreadCharacteristics");
+               }
+               if (found.begin == nullptr || found.revert == nullptr)
+               {
+                    found = {nullptr, nullptr};
+               }
+               return found;
+          }();
+          return functions;
+     }
+
+     // EcoQoS: lower clocks and efficiency cores for a thread that can wait
+     bool setPowerThrottling(bool throttle)
+     {
+          static const SetThreadInformationFunction setInformation =
+               (SetThreadInformationFunction)(void *)GetProcAddress(GetModuleHandleW(L"kernel32.dll"),
+                                                                    "SetThreadInformation");
+          if (setInformation == nullptr)
+          {
+               return false;
+          }
+          ThreadPowerThrottling state = {1, 0x1, throttle ? 0x1u : 0u}; // Execution speed
+          return setInformation(GetCurrentThread(), THREAD_INFORMATION_POWER_THROTTLING, &state, sizeof(state)) != 0;
+     }
+#endif
+
+     struct ThreadStart
+     {
+          SDL_ThreadFunction fn;
+          void *data;
+          ThreadOptions options;
+     };
+
+     int SDLCALL threadStartMain(void *data)
+     {
+          ThreadStart start = *(ThreadStart *)data;
+          delete (ThreadStart *)data;
+
+          if (start.options.priority != SDL_THREAD_PRIORITY_NORMAL)
+          {
+               SDL_SetThreadPriority(start.options.priority);
+          }
+          if (start.options.affinity != 0)
+          {
+               threadSetAffinity(start.options.affinity);
+          }
+          if (start.options.coreType != CORE_TYPE_ANY)
+          {
+               threadSetCoreType(start.options.coreType);
+          }
+          void *task = threadBeginTask(start.options.task);
+          const int result = start.fn(start.data);
+          threadEndTask(task);
+          return result;
+     }
+}
+
+ThreadOptions threadDefaultOptions()
+{
+     ThreadOptions options;
+     options.stackSize = 0;
+     options.priority = SDL_THREAD_PRIORITY_NORMAL;
+     options.affinity = 0;
+     options.coreType = CORE_TYPE_ANY;
+     options.task = THREAD_TASK_NONE;
+     return options;
+}
+
+bool threadSetAffinity(Uint64 mask)
+{
+     const int cpus = cpuTopology().logicalCount;
+     mask &= cpus >= 64 ? ~(Uint64)0 : ((Uint64)1 << cpus) - 1;
+     if (mask == 0)
+     {
+          return false;
+     }
+#if defined(_WIN32)
+     return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)mask) != 0;
+#elif defined(__linux__)
+     cpu_set_t set;
+     CPU_ZERO(&set);
+     for (int cpu = 0; cpu < 64; cpu++)
+     {
+          if (mask & ((Uint64)1 << cpu))
+          {
+               CPU_SET(cpu, &set);
+          }
+     }
+     return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+     // macOS has affinity tags, not masks
+     return false;
+#endif
+}
+
+bool threadSetCoreType(CoreType type)
+{
+     const CpuTopology &topology = cpuTopology();
+     if (!topology.hybrid || type == CORE_TYPE_ANY)
+     {
+          return true;
+     }
+     return threadSetAffinity(type == CORE_TYPE_PERFORMANCE ? topology.performanceMask : topology.efficiencyMask);
+}
+
+void *threadBeginTask(ThreadTask task)
+{
+     if (task == THREAD_TASK_NONE)
+     {
+          return nullptr;
+     }
+#if defined(_WIN32)
+     if (task == THREAD_TASK_BACKGROUND)
+     {
+          setPowerThrottling(true);
+          SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+          return nullptr;
+     }
+     if (mmcss().begin != nullptr)
+     {
+          DWORD taskIndex = 0;
+          HANDLE handle = mmcss().begin(task == THREAD_TASK_PRO_AUDIO ? L"Pro Audio" : L"Games", &taskIndex);
+          if (handle != NULL)
+          {
+               return handle;
+          }
+     }
+     // Without MMCSS (the service is off, or Server Core), fall back on priority
+     SDL_SetThreadPriority(task == THREAD_TASK_PRO_AUDIO ? SDL_THREAD_PRIORITY_TIME_CRITICAL : SDL_THREAD_PRIORITY_HIGH);
+     return nullptr;
+#elif defined(__APPLE__)
+     const qos_class_t qos = task == THREAD_TASK_BACKGROUND ? QOS_CLASS_UTILITY : QOS_CLASS_USER_INTERACTIVE;
+     pthread_set_qos_class_self_np(qos, 0);
+     return nullptr;
+#else
+     SDL_SetThreadPriority(task == THREAD_TASK_BACKGROUND  ? SDL_THREAD_PRIORITY_LOW
+                           : task == THREAD_TASK_PRO_AUDIO ? SDL_THREAD_PRIORITY_TIME_CRITICAL
+                                                           : SDL_THREAD_PRIORITY_HIGH);
+     return nullptr;
+#endif
+}
+
+void threadEndTask(void *handle)
+{
+#if defined(_WIN32)
+     if (handle != nullptr && mmcss().revert != nullptr)
+     {
+          mmcss().revert((HANDLE)handle);
+     }
+#else
+     (void)handle;
+#endif
+}
+
+SDL_Thread *threadCreate(SDL_ThreadFunction fn, const char *name, void *data, const ThreadOptions &options)
+{
+     ThreadStart *start = new ThreadStart{fn, data, options};
+     SDL_Thread *thread = SDL_CreateThreadWithStackSize(threadStartMain, name, options.stackSize, start);
+     if (thread == nullptr)
+     {
+          delete start;
+     }
+     return thread;
+}
+
+const char *coreTypeName(CoreType type)
+{
+     switch (type)
+     {
+     case CORE_TYPE_ANY:
+          return "any";
+     case CORE_TYPE_PERFORMANCE:
+          return "performance";
+     case CORE_TYPE_EFFICIENCY:
+          return "efficiency";
+     }
+     return "unknown";
+}
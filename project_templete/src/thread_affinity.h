@@ -0,0 +1,76 @@
+// Description:
+// Placement and scheduling for game threads beyond what
+// SDL_SetThreadPriority offers. On hybrid CPUs (Intel's P-cores and
+// E-cores, ARM big.LITTLE) a thread that lands on an efficiency core can
+// run at half speed, which shows up as a late audio buffer or a stalled
+// render thread. This module adds:
+//
+// - Per-thread affinity masks, and pinning to the performance or the
+//   efficiency cores cpu_topology found; pinning does nothing on CPUs that
+//   are not hybrid, where it would only take choices away from the
+//   scheduler.
+// - ThreadTask, what the thread is for. On Windows "Pro Audio" and
+//   "Games" register the thread with MMCSS, the multimedia class
+//   scheduler, which guarantees it CPU time the way a priority cannot;
+//   background threads opt into EcoQoS so they prefer efficiency cores
+//   and lower clocks. macOS gets the matching QoS classes, elsewhere the
+//   task maps to an SDL thread priority.
+// - threadCreate(), SDL_CreateThreadWithStackSize with ThreadOptions,
+//   applied on the new thread before its function runs.
+//
+// Masks cover the first 64 logical CPUs (Windows processor group 0).
+// =============================================================================
+
+#ifndef THREAD_AFFINITY_H
+#define THREAD_AFFINITY_H
+
+#include <SDL2/SDL.h>
+
+#include "cpu_topology.h"
+
+enum CoreType
+{
+     CORE_TYPE_ANY,
+     CORE_TYPE_PERFORMANCE,
+     CORE_TYPE_EFFICIENCY
+};
+
+enum ThreadTask
+{
+     THREAD_TASK_NONE,
+     THREAD_TASK_GAMES,     // Latency-sensitive game work: input, render
+     THREAD_TASK_PRO_AUDIO, // Audio mixing on a deadline
+     THREAD_TASK_BACKGROUND // Loading, decoding, anything that can wait
+};
+
+struct ThreadOptions
+{
+     size_t stackSize;            // 0 for SDL's default
+     SDL_ThreadPriority priority; // Applied unless the task overrides it
+     Uint64 affinity;             // 0 for any CPU
+     CoreType coreType;           // Narrows `affinity` on hybrid CPUs
+     ThreadTask task;
+};
+
+// All defaults: any CPU, normal priority, no task
+ThreadOptions threadDefaultOptions();
+
+// The calling thread. `mask` bits past the CPU count are ignored; false
+// when nothing would be left or the platform cannot set affinity
+bool threadSetAffinity(Uint64 mask);
+
+// Pin the calling thread to one core type; true without doing anything
+// on CPUs that are not hybrid
+bool threadSetCoreType(CoreType type);
+
+// Register the calling thread for `task`. Returns a handle for
+// threadEndTask, nullptr when there is nothing to undo.
+void *threadBeginTask(ThreadTask task);
+void threadEndTask(void *handle);
+
+// SDL_CreateThreadWithStackSize plus `options`, applied on the new thread
+SDL_Thread *threadCreate(SDL_ThreadFunction fn, const char *name, void *data, const ThreadOptions &options);
+
+const char *coreTypeName(CoreType type);
+
+#endif // THREAD_AFFINITY_H
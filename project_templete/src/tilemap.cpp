@@ -0,0 +1,222 @@
+#include "tilemap.h"
+
+#include <cmath>
+#include <iostream>
+
+#include "render_record.h"
+
+namespace
+{
+     const int QUADS_PER_CHUNK = TILEMAP_CHUNK_TILES * TILEMAP_CHUNK_TILES; // 4096 vertices, fits Uint16 indices
+
+     int floorDiv(float value, int divisor)
+     {
+          return (int)std::floor(value / divisor);
+     }
+
+     void bakeChunk(Tilemap &map, TilemapChunk &chunk, int cx, int cy)
+     {
+          chunk.xy.clear();
+          chunk.uv.clear();
+          chunk.quads = 0;
+
+          const int x0 = cx * TILEMAP_CHUNK_TILES;
+          const int y0 = cy * TILEMAP_CHUNK_TILES;
+          const int x1 = SDL_min(x0 + TILEMAP_CHUNK_TILES, map.width);
+          const int y1 = SDL_min(y0 + TILEMAP_CHUNK_TILES, map.height);
+          for (int y = y0; y < y1; y++)
+          {
+               for (int x = x0; x < x1; x++)
+               {
+                    Uint16 tile = map.tiles[(size_t)y * map.width + x];
+                    if (tile == 0 || tile > map.frames.size())
+                    {
+                         continue;
+                    }
+                    // 0--1
+                    // | /|
+                    // |/ |
+                    // 3--2
+                    const float left = (float)(x * map.tileWidth);
+                    const float top = (float)(y * map.tileHeight);
+                    const float right = left + map.tileWidth;
+                    const float bottom = top + map.tileHeight;
+                    const float xy[8] = {left, top, right, top, right, bottom, left, bottom};
+                    chunk.xy.insert(chunk.xy.end(), xy, xy + 8);
+
+                    const SDL_FRect &f = map.frames[tile - 1];
+                    const float uv[8] = {f.x, f.y, f.x + f.w, f.y, f.x + f.w, f.y + f.h, f.x, f.y + f.h};
+                    chunk.uv.insert(chunk.uv.end(), uv, uv + 8);
+                    chunk.quads++;
+               }
+          }
+          chunk.screenXY.resize(chunk.xy.size());
+          // Force the translation on the next draw
+          chunk.drawnX = NAN;
+          chunk.dirty = false;
+          map.chunksRebuilt++;
+     }
+
+     void translateChunk(TilemapChunk &chunk, float cameraX, float cameraY)
+     {
+          if (chunk.drawnX == cameraX && chunk.drawnY == cameraY)
+          {
+               return;
+          }
+          const float *src = chunk.xy.data();
+          float *dst = chunk.screenXY.data();
+          for (size_t i = 0; i < chunk.xy.size(); i += 2)
+          {
+               dst[i] = src[i] - cameraX;
+               dst[i + 1] = src[i + 1] - cameraY;
+          }
+          chunk.drawnX = cameraX;
+          chunk.drawnY = cameraY;
+     }
+}
+
+void tilemapInit(Tilemap &map, int width, int height, int tileWidth, int tileHeight)
+{
+     map.width = SDL_max(width, 0);
+     map.height = SDL_max(height, 0);
+     map.tileWidth = tileWidth;
+     map.tileHeight = tileHeight;
+     map.tiles.assign((size_t)map.width * map.height, 0);
+     map.texture = nullptr;
+     map.frames.clear();
+     map.tint = {255, 255, 255, 255};
+
+     map.chunksX = (map.width + TILEMAP_CHUNK_TILES - 1) / TILEMAP_CHUNK_TILES;
+     map.chunksY = (map.height + TILEMAP_CHUNK_TILES - 1) / TILEMAP_CHUNK_TILES;
+     map.chunks.assign((size_t)map.chunksX * map.chunksY, TilemapChunk{});
+     for (TilemapChunk &chunk : map.chunks)
+     {
+          chunk.dirty = true;
+          chunk.quads = 0;
+     }
+
+     map.indices.resize(QUADS_PER_CHUNK * 6);
+     for (int i = 0; i < QUADS_PER_CHUNK; i++)
+     {
+          const int quad[6] = {0, 1, 2, 0, 2, 3};
+          for (int k = 0; k < 6; k++)
+          {
+               map.indices[i * 6 + k] = (Uint16)(i * 4 + quad[k]);
+          }
+     }
+     map.drawCalls = 0;
+     map.chunksRebuilt = 0;
+}
+
+bool tilemapSetTileset(Tilemap &map, const AtlasSprite *sprites, int count)
+{
+     SDL_Texture *texture = count > 0 ? sprites[0].texture : nullptr;
+     int w = 0, h = 0;
+     if (texture == nullptr || SDL_QueryTexture(texture, NULL, NULL, &w, &h) < 0 || w == 0 || h == 0)
+     {
+          std::cerr << "Tileset has no texture! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+
+     std::vector<SDL_FRect> frames(count);
+     for (int i = 0; i < count; i++)
+     {
+          if (sprites[i].texture != texture)
+          {
+               std::cerr << "Tileset sprites must share one atlas page" << std::endl;
+               return false;
+          }
+          const SDL_Rect &r = sprites[i].src;
+          frames[i] = {(float)r.x / w, (float)r.y / h, (float)r.w / w, (float)r.h / h};
+     }
+     map.texture = texture;
+     map.frames.swap(frames);
+     for (TilemapChunk &chunk : map.chunks)
+     {
+          chunk.dirty = true;
+     }
+     return true;
+}
+
+void tilemapSetTile(Tilemap &map, int x, int y, Uint16 tile)
+{
+     if (x < 0 || y < 0 || x >= map.width || y >= map.height)
+     {
+          return;
+     }
+     Uint16 &slot = map.tiles[(size_t)y * map.width + x];
+     if (slot != tile)
+     {
+          slot = tile;
+          map.chunks[(size_t)(y / TILEMAP_CHUNK_TILES) * map.chunksX + x / TILEMAP_CHUNK_TILES].dirty = true;
+     }
+}
+
+Uint16 tilemapGetTile(const Tilemap &map, int x, int y)
+{
+     if (x < 0 || y < 0 || x >= map.width || y >= map.height)
+     {
+          return 0;
+     }
+     return map.tiles[(size_t)y * map.width + x];
+}
+
+void tilemapDraw(Tilemap &map, SDL_Renderer *renderer, float cameraX, float cameraY)
+{
+     map.drawCalls = 0;
+     map.chunksRebuilt = 0;
+     if (map.texture == nullptr || map.chunks.empty())
+     {
+          return;
+     }
+
+     // Visible area in render coordinates: the viewport, narrowed by the clip
+     SDL_Rect viewport;
+     SDL_RenderGetViewport(renderer, &viewport);
+     SDL_Rect area = {0, 0, viewport.w, viewport.h};
+     if (SDL_RenderIsClipEnabled(renderer))
+     {
+          SDL_Rect clip, clipped;
+          SDL_RenderGetClipRect(renderer, &clip);
+          if (!SDL_IntersectRect(&area, &clip, &clipped))
+          {
+               return;
+          }
+          area = clipped;
+     }
+     if (area.w <= 0 || area.h <= 0)
+     {
+          return;
+     }
+
+     const int chunkWidth = TILEMAP_CHUNK_TILES * map.tileWidth;
+     const int chunkHeight = TILEMAP_CHUNK_TILES * map.tileHeight;
+     const int cx0 = SDL_max(floorDiv(cameraX + area.x, chunkWidth), 0);
+     const int cy0 = SDL_max(floorDiv(cameraY + area.y, chunkHeight), 0);
+     const int cx1 = SDL_min(floorDiv(cameraX + area.x + area.w - 1, chunkWidth), map.chunksX - 1);
+     const int cy1 = SDL_min(floorDiv(cameraY + area.y + area.h - 1, chunkHeight), map.chunksY - 1);
+
+     for (int cy = cy0; cy <= cy1; cy++)
+     {
+          for (int cx = cx0; cx <= cx1; cx++)
+          {
+               TilemapChunk &chunk = map.chunks[(size_t)cy * map.chunksX + cx];
+               if (chunk.dirty)
+               {
+                    bakeChunk(map, chunk, cx, cy);
+               }
+               if (chunk.quads == 0)
+               {
+                    continue;
+               }
+               translateChunk(chunk, cameraX, cameraY);
+               // One color for every vertex: a zero stride repeats it
+               renderRecordGeometryRaw(renderer, map.texture,
+                                       chunk.screenXY.data(), 2 * sizeof(float),
+                                       &map.tint, 0,
+                                       chunk.uv.data(), 2 * sizeof(float),
+                                       chunk.quads * 4, map.indices.data(), chunk.quads * 6, sizeof(Uint16));
+               map.drawCalls++;
+          }
+     }
+}
@@ -0,0 +1,70 @@
+// Description:
+// Tile grid renderer. Instead of one SDL_RenderCopy per visible tile, the
+// map is split into TILEMAP_CHUNK_TILES square chunks whose geometry (corner
+// positions and atlas uvs of every non-empty tile) is baked once and kept;
+// drawing a chunk is a single SDL_RenderGeometryRaw call, so a screen of
+// tiles costs a few draw calls. Chunks are culled whole against the render
+// viewport (and the clip rect, when one is set) by index arithmetic, so
+// the cost of a draw depends on what is visible, not on the map size.
+//
+// Editing a tile only marks its chunk; the chunk is rebuilt the next time
+// it is drawn. SDL2's renderer has no vertex buffers or transforms, so the
+// scroll offset is applied on the CPU: the baked positions are translated
+// into a per-chunk copy, redone only when the camera has moved. UVs,
+// indices and color are never touched after the bake.
+//
+// Every tile of a map draws from one texture (one atlas page).
+// =============================================================================
+
+#ifndef TILEMAP_H
+#define TILEMAP_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "texture_atlas.h"
+
+const int TILEMAP_CHUNK_TILES = 32; // Chunk width and height in tiles
+
+struct TilemapChunk
+{
+     bool dirty; // Tiles changed since the last bake
+     int quads;  // Non-empty tiles
+     std::vector<float> xy; // Baked positions, relative to the map origin
+     std::vector<float> uv;
+     std::vector<float> screenXY; // xy minus (drawnX, drawnY)
+     float drawnX, drawnY;        // Camera screenXY was translated for
+};
+
+struct Tilemap
+{
+     int width, height;        // In tiles
+     int tileWidth, tileHeight; // In pixels
+     std::vector<Uint16> tiles; // 0 is empty, n draws frame n - 1
+     SDL_Texture *texture;
+     std::vector<SDL_FRect> frames; // Normalized uv rect per tile id
+     SDL_Color tint;
+
+     int chunksX, chunksY;
+     std::vector<TilemapChunk> chunks;
+     std::vector<Uint16> indices; // Shared by every chunk, built once
+
+     int drawCalls;     // Chunks submitted by the last draw
+     int chunksRebuilt; // Chunks baked by the last draw
+};
+
+void tilemapInit(Tilemap &map, int width, int height, int tileWidth, int tileHeight);
+
+// Tile id n (1-based) draws sprites[n - 1]. All sprites must be on the same
+// atlas page; returns false otherwise.
+bool tilemapSetTileset(Tilemap &map, const AtlasSprite *sprites, int count);
+
+// Out-of-range coordinates are ignored; ids past the tileset are drawn empty
+void tilemapSetTile(Tilemap &map, int x, int y, Uint16 tile);
+Uint16 tilemapGetTile(const Tilemap &map, int x, int y);
+
+// Draw the part of the map under the viewport, with map pixel
+// (cameraX, cameraY) at the viewport's top-left corner
+void tilemapDraw(Tilemap &map, SDL_Renderer *renderer, float cameraX, float cameraY);
+
+#endif // TILEMAP_H
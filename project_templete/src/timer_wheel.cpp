@@ -0,0 +1,320 @@
+#include "timer_wheel.h"
+
+namespace
+{
+     const int ROOT_BITS = 8;
+     const int LEVEL_BITS = 6;
+     const int ROOT_SLOTS = 1 << ROOT_BITS;
+     const int LEVEL_SLOTS = 1 << LEVEL_BITS;
+     const Uint64 MAX_DELTA = ((Uint64)1 << (ROOT_BITS + 3 * LEVEL_BITS)) - 1;
+
+     const int INDEX_BITS = 20; // Ids are generation:12 | index + 1:20
+     const int MAX_TIMERS = (1 << INDEX_BITS) - 1;
+
+     const Uint8 TIMER_FREE = 0;
+     const Uint8 TIMER_ARMED = 1;
+     const Uint8 TIMER_FIRING = 2; // Collected, waiting for dispatch
+
+     TimerWheelId makeId(int index, Uint16 generation)
+     {
+          return ((TimerWheelId)(generation & 0xFFF) << INDEX_BITS) | (TimerWheelId)(index + 1);
+     }
+
+     // The node `id` names, or -1 when it was freed and perhaps reused
+     int lookup(const TimerWheel &wheel, TimerWheelId id)
+     {
+          const int index = (int)(id & ((1u << INDEX_BITS) - 1)) - 1;
+          if (index < 0 || index >= (int)wheel.nodes.size() || wheel.nodes[index].state == TIMER_FREE ||
+              makeId(index, wheel.nodes[index].generation) != id)
+          {
+               return -1;
+          }
+          return index;
+     }
+
+     int levelStart(int level)
+     {
+          return level == 0 ? 0 : ROOT_SLOTS + (level - 1) * LEVEL_SLOTS;
+     }
+
+     int slotFor(const TimerWheel &wheel, Uint64 expires)
+     {
+          // Overdue timers go in the slot processed next
+          if (expires < wheel.current)
+          {
+               return (int)(wheel.current & (ROOT_SLOTS - 1));
+          }
+          Uint64 delta = expires - wheel.current;
+          if (delta > MAX_DELTA)
+          {
+               delta = MAX_DELTA;
+               expires = wheel.current + delta;
+          }
+          if (delta < ROOT_SLOTS)
+          {
+               return (int)(expires & (ROOT_SLOTS - 1));
+          }
+          for (int level = 1;; level++)
+          {
+               const int shift = ROOT_BITS + level * LEVEL_BITS;
+               if (level == 3 || delta < ((Uint64)1 << shift))
+               {
+                    const int bit = shift - LEVEL_BITS;
+                    return levelStart(level) + (int)((expires >> bit) & (LEVEL_SLOTS - 1));
+               }
+          }
+     }
+
+     void link(TimerWheel &wheel, int index)
+     {
+          TimerNode &node = wheel.nodes[index];
+          const int slot = slotFor(wheel, node.expires);
+          node.prev = -1;
+          node.next = wheel.slots[slot];
+          node.slot = slot;
+          if (node.next >= 0)
+          {
+               wheel.nodes[node.next].prev = index;
+          }
+          wheel.slots[slot] = index;
+          node.state = TIMER_ARMED;
+     }
+
+     void unlink(TimerWheel &wheel, int index)
+     {
+          TimerNode &node = wheel.nodes[index];
+          if (node.prev >= 0)
+          {
+               wheel.nodes[node.prev].next = node.next;
+          }
+          else
+          {
+               wheel.slots[node.slot] = node.next;
+          }
+          if (node.next >= 0)
+          {
+               wheel.nodes[node.next].prev = node.prev;
+          }
+     }
+
+     void release(TimerWheel &wheel, int index)
+     {
+          TimerNode &node = wheel.nodes[index];
+          node.state = TIMER_FREE;
+          node.generation++;
+          node.next = wheel.freeHead;
+          wheel.freeHead = index;
+     }
+
+     // Take a slot's list, leaving it empty
+     int takeSlot(TimerWheel &wheel, int slot)
+     {
+          const int head = wheel.slots[slot];
+          wheel.slots[slot] = -1;
+          return head;
+     }
+
+     // Re-file everything in one slot of `level`; returns the slot index so
+     // the caller knows whether that level wrapped too
+     int cascade(TimerWheel &wheel, int level)
+     {
+          const int index = (int)((wheel.current >> (ROOT_BITS + (level - 1) * LEVEL_BITS)) & (LEVEL_SLOTS - 1));
+          int node = takeSlot(wheel, levelStart(level) + index);
+          while (node >= 0)
+          {
+               const int next = wheel.nodes[node].next;
+               link(wheel, node);
+               node = next;
+          }
+          return index;
+     }
+
+     void collectTick(TimerWheel &wheel)
+     {
+          const int index = (int)(wheel.current & (ROOT_SLOTS - 1));
+          if (index == 0 && cascade(wheel, 1) == 0 && cascade(wheel, 2) == 0)
+          {
+               cascade(wheel, 3);
+          }
+          int node = takeSlot(wheel, index);
+          while (node >= 0)
+          {
+               TimerNode &timer = wheel.nodes[node];
+               const int next = timer.next;
+               wheel.fired.push_back(makeId(node, timer.generation));
+               if (timer.period > 0)
+               {
+                    // Re-armed now so a short period fires again in this advance
+                    timer.expires += timer.period;
+                    link(wheel, node);
+               }
+               else
+               {
+                    timer.state = TIMER_FIRING;
+                    wheel.armedCount--;
+               }
+               node = next;
+          }
+          wheel.current++;
+     }
+}
+
+void timerWheelInit(TimerWheel &wheel, Uint64 now, int capacity)
+{
+     wheel.current = now;
+     wheel.nodes.clear();
+     wheel.nodes.reserve(SDL_min(capacity, MAX_TIMERS));
+     wheel.freeHead = -1;
+     for (int &slot : wheel.slots)
+     {
+          slot = -1;
+     }
+     wheel.armedCount = 0;
+     wheel.fired.clear();
+     wheel.batch.clear();
+}
+
+TimerWheelId timerWheelAdd(TimerWheel &wheel, Uint64 delay, TimerWheelCallback callback, void *userdata, void *param,
+                           Uint64 period)
+{
+     int index = wheel.freeHead;
+     if (index >= 0)
+     {
+          wheel.freeHead = wheel.nodes[index].next;
+     }
+     else
+     {
+          if ((int)wheel.nodes.size() >= MAX_TIMERS)
+          {
+               SDL_SetError("Timer wheel is full");
+               return 0;
+          }
+          index = (int)wheel.nodes.size();
+          wheel.nodes.push_back(TimerNode());
+          wheel.nodes[index].generation = 0;
+     }
+     TimerNode &node = wheel.nodes[index];
+     node.expires = wheel.current + delay;
+     node.period = period;
+     node.callback = callback;
+     node.userdata = userdata;
+     node.param = param;
+     link(wheel, index);
+     wheel.armedCount++;
+     return makeId(index, node.generation);
+}
+
+bool timerWheelCancel(TimerWheel &wheel, TimerWheelId id)
+{
+     const int index = lookup(wheel, id);
+     if (index < 0)
+     {
+          return false;
+     }
+     if (wheel.nodes[index].state == TIMER_ARMED)
+     {
+          unlink(wheel, index);
+          wheel.armedCount--;
+     }
+     release(wheel, index);
+     return true;
+}
+
+int timerWheelAdvance(TimerWheel &wheel, Uint64 now)
+{
+     wheel.fired.clear();
+     if (wheel.armedCount == 0)
+     {
+          // Nothing to cascade, so the empty ticks can be skipped
+          wheel.current = SDL_max(wheel.current, now + 1);
+          return 0;
+     }
+     while (wheel.current <= now)
+     {
+          collectTick(wheel);
+     }
+
+     // An earlier batch's callbacks may cancel timers that fired after it,
+     // so ids are checked as each batch is built
+     const int firedCount = (int)wheel.fired.size();
+     int i = 0;
+     while (i < firedCount)
+     {
+          const int first = lookup(wheel, wheel.fired[i]);
+          if (first < 0)
+          {
+               i++;
+               continue;
+          }
+          const TimerWheelCallback callback = wheel.nodes[first].callback;
+          void *userdata = wheel.nodes[first].userdata;
+          wheel.batch.clear();
+          for (; i < firedCount; i++)
+          {
+               const int index = lookup(wheel, wheel.fired[i]);
+               if (index < 0)
+               {
+                    continue;
+               }
+               if (wheel.nodes[index].callback != callback || wheel.nodes[index].userdata != userdata)
+               {
+                    break;
+               }
+               wheel.batch.push_back({wheel.fired[i], wheel.nodes[index].param});
+          }
+          callback(wheel.batch.data(), (int)wheel.batch.size(), userdata);
+     }
+
+     // One-shots stay allocated through dispatch so their ids stay valid
+     for (const TimerWheelId id : wheel.fired)
+     {
+          const int index = lookup(wheel, id);
+          if (index >= 0 && wheel.nodes[index].state == TIMER_FIRING)
+          {
+               release(wheel, index);
+          }
+     }
+     return firedCount;
+}
+
+Uint64 timerWheelNextDue(const TimerWheel &wheel, Uint64 limit)
+{
+     if (wheel.armedCount == 0)
+     {
+          return limit;
+     }
+     const Uint64 scan = SDL_min(limit, (Uint64)ROOT_SLOTS);
+     for (Uint64 ahead = 0; ahead < scan; ahead++)
+     {
+          if (wheel.slots[(wheel.current + ahead) & (ROOT_SLOTS - 1)] >= 0)
+          {
+               return ahead;
+          }
+          // Crossing a level 0 wrap cascades timers that may land earlier
+          if (((wheel.current + ahead + 1) & (ROOT_SLOTS - 1)) == 0)
+          {
+               return ahead + 1;
+          }
+     }
+     return scan;
+}
+
+void timerWheelClear(TimerWheel &wheel)
+{
+     for (int &slot : wheel.slots)
+     {
+          slot = -1;
+     }
+     wheel.freeHead = -1;
+     for (int index = (int)wheel.nodes.size() - 1; index >= 0; index--)
+     {
+          if (wheel.nodes[index].state != TIMER_FREE)
+          {
+               wheel.nodes[index].generation++;
+          }
+          wheel.nodes[index].state = TIMER_FREE;
+          wheel.nodes[index].next = wheel.freeHead;
+          wheel.freeHead = index;
+     }
+     wheel.armedCount = 0;
+}
@@ -0,0 +1,93 @@
+// Description:
+// Hierarchical timer wheel for gameplay timers (cooldowns, buffs, delayed
+// spawns) in the thousands. SDL_AddTimer keeps its timers in a sorted list
+// walked by one timer thread, so adding a timer is linear in the number
+// already scheduled, and every callback runs on that thread and needs a
+// lock or an event to reach game state. A TimerWheel lives on the game
+// thread instead and is advanced from the loop:
+//
+// - Level 0 has 256 one-tick slots; levels 1-3 have 64 slots each
+//   covering 256, 16384 and 1048576 ticks, reaching 2^26 ticks ahead
+//   (about 18 hours of milliseconds). Timers further out wait in the top
+//   level and are re-filed each time it turns.
+// - Adding a timer files it in one slot and cancelling unlinks it, both
+//   O(1). Timers cascade down a level each time the level below wraps, so
+//   every timer is touched at most four times before it fires.
+// - Timers live in one pool with an intrusive list per slot, reused
+//   through a free list; after warm-up nothing allocates.
+// - timerWheelAdvance() collects everything due, in expiry order, and
+//   hands consecutive timers that share a callback to it in one call, so
+//   a thousand buffs expiring on the same tick cost one call, not a
+//   thousand.
+//
+// Ticks are whatever unit the caller advances with, usually milliseconds
+// from SDL_GetTicks64() or simulation steps. Timer ids carry a generation,
+// so cancelling a timer that already fired is a harmless no-op.
+// =============================================================================
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+typedef Uint32 TimerWheelId; // 0 is never a valid id
+
+struct TimerFire
+{
+     TimerWheelId id;
+     void *param;
+};
+
+// Receives `count` timers that fired, in expiry order
+typedef void (*TimerWheelCallback)(const TimerFire *fires, int count, void *userdata);
+
+struct TimerNode
+{
+     Uint64 expires;
+     Uint64 period; // Re-armed by this many ticks after firing, 0 for one-shot
+     TimerWheelCallback callback;
+     void *userdata;
+     void *param;
+     int prev, next;   // Slot list links, or the free list through next
+     int slot;         // Filed in, for unlinking a list head
+     Uint16 generation;
+     Uint8 state;      // Free, armed or firing
+};
+
+struct TimerWheel
+{
+     Uint64 current; // Next tick to process
+     std::vector<TimerNode> nodes;
+     int freeHead;
+     int slots[256 + 64 * 3]; // List heads, -1 when empty
+     int armedCount;
+
+     std::vector<TimerWheelId> fired; // Collected by an advance, then dispatched
+     std::vector<TimerFire> batch;
+};
+
+// Start the wheel at tick `now` with room for `capacity` timers before the
+// pool grows
+void timerWheelInit(TimerWheel &wheel, Uint64 now, int capacity = 1024);
+
+// Fire `callback` `delay` ticks from the wheel's current tick, then every
+// `period` ticks if it is nonzero. Returns 0 when the pool is exhausted
+TimerWheelId timerWheelAdd(TimerWheel &wheel, Uint64 delay, TimerWheelCallback callback, void *userdata,
+                           void *param = nullptr, Uint64 period = 0);
+
+// Returns false when the timer already fired or was cancelled
+bool timerWheelCancel(TimerWheel &wheel, TimerWheelId id);
+
+// Process every tick up to and including `now`, then dispatch what fired.
+// Callbacks may add and cancel timers. Returns the number of timers fired
+int timerWheelAdvance(TimerWheel &wheel, Uint64 now);
+
+// Ticks the loop can sleep before the next timer is due, at most `limit`.
+// Exact within 256 ticks, a lower bound beyond
+Uint64 timerWheelNextDue(const TimerWheel &wheel, Uint64 limit);
+
+// Cancel every timer without releasing storage
+void timerWheelClear(TimerWheel &wheel);
+
+#endif // TIMER_WHEEL_H
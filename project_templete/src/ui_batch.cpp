@@ -0,0 +1,335 @@
+#include "ui_batch.h"
+
+#include <cmath>
+
+#include "render_record.h"
+
+namespace
+{
+     const float UI_PI = 3.14159265f;
+
+     bool sameRect(const SDL_Rect &a, const SDL_Rect &b)
+     {
+          return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+     }
+
+     // Field by field; the struct has padding, so no memcmp
+     bool sameDesc(const UiWidgetDesc &a, const UiWidgetDesc &b)
+     {
+          if (a.shape != b.shape || a.visible != b.visible || a.rect.x != b.rect.x || a.rect.y != b.rect.y ||
+              a.rect.w != b.rect.w || a.rect.h != b.rect.h || !sameRect(a.src, b.src) || !sameRect(a.insets, b.insets) ||
+              a.radius != b.radius || a.thickness != b.thickness || a.from.x != b.from.x || a.from.y != b.from.y ||
+              a.to.x != b.to.x || a.to.y != b.to.y)
+          {
+               return false;
+          }
+          for (int i = 0; i < 4; i++)
+          {
+               if (a.colors[i].r != b.colors[i].r || a.colors[i].g != b.colors[i].g || a.colors[i].b != b.colors[i].b ||
+                   a.colors[i].a != b.colors[i].a)
+               {
+                    return false;
+               }
+          }
+          return true;
+     }
+
+     UiWidgetDesc blankDesc(UiShape shape)
+     {
+          UiWidgetDesc desc;
+          SDL_zero(desc);
+          desc.shape = shape;
+          desc.visible = true;
+          return desc;
+     }
+
+     void addQuadIndices(std::vector<int> &indices, int topLeft, int topRight, int bottomLeft, int bottomRight)
+     {
+          const int quad[6] = {topLeft, topRight, bottomLeft, bottomLeft, topRight, bottomRight};
+          indices.insert(indices.end(), quad, quad + 6);
+     }
+
+     // Borders keep their texel size unless the rect is too small for two of
+     // them, then both shrink in proportion
+     void sliceEdges(float origin, float size, float before, float after, float edges[4])
+     {
+          const float borders = before + after;
+          const float scale = borders > size && borders > 0.0f ? size / borders : 1.0f;
+          edges[0] = origin;
+          edges[1] = origin + before * scale;
+          edges[2] = origin + size - after * scale;
+          edges[3] = origin + size;
+     }
+
+     void buildNineSlice(const UiBatch &batch, UiWidget &widget)
+     {
+          const UiWidgetDesc &d = widget.desc;
+          if (batch.texture == nullptr || batch.textureWidth == 0 || batch.textureHeight == 0)
+          {
+               return;
+          }
+          float xs[4], ys[4], us[4], vs[4];
+          sliceEdges(d.rect.x, d.rect.w, (float)d.insets.x, (float)d.insets.w, xs);
+          sliceEdges(d.rect.y, d.rect.h, (float)d.insets.y, (float)d.insets.h, ys);
+          const float texels[4][2] = {{(float)d.src.x, (float)d.src.y},
+                                      {(float)(d.src.x + d.insets.x), (float)(d.src.y + d.insets.y)},
+                                      {(float)(d.src.x + d.src.w - d.insets.w), (float)(d.src.y + d.src.h - d.insets.h)},
+                                      {(float)(d.src.x + d.src.w), (float)(d.src.y + d.src.h)}};
+          for (int i = 0; i < 4; i++)
+          {
+               us[i] = texels[i][0] / batch.textureWidth;
+               vs[i] = texels[i][1] / batch.textureHeight;
+          }
+          for (int row = 0; row < 4; row++)
+          {
+               for (int column = 0; column < 4; column++)
+               {
+                    widget.vertices.push_back(SDL_Vertex{{xs[column], ys[row]}, d.colors[0], {us[column], vs[row]}});
+               }
+          }
+          // The middle cells stretch; a zero-width border just makes empty triangles
+          for (int row = 0; row < 3; row++)
+          {
+               for (int column = 0; column < 3; column++)
+               {
+                    const int topLeft = row * 4 + column;
+                    addQuadIndices(widget.indices, topLeft, topLeft + 1, topLeft + 4, topLeft + 5);
+               }
+          }
+     }
+
+     // A fan from the centre through every corner's arc
+     void buildRoundedRect(const UiBatch &batch, UiWidget &widget)
+     {
+          const UiWidgetDesc &d = widget.desc;
+          const float radius = SDL_max(0.0f, SDL_min(d.radius, SDL_min(d.rect.w, d.rect.h) * 0.5f));
+          // About one segment per four pixels of arc keeps the edge smooth
+          const int segments = radius > 0.0f ? SDL_clamp((int)(radius * 0.4f), 2, 16) : 0;
+          const SDL_Color color = d.colors[0];
+          widget.vertices.push_back(
+              SDL_Vertex{{d.rect.x + d.rect.w * 0.5f, d.rect.y + d.rect.h * 0.5f}, color, batch.white});
+
+          // Corner centres clockwise from top-left, with the angle each arc starts at
+          const float left = d.rect.x + radius, right = d.rect.x + d.rect.w - radius;
+          const float top = d.rect.y + radius, bottom = d.rect.y + d.rect.h - radius;
+          const float centres[4][3] = {{left, top, UI_PI}, {right, top, 1.5f * UI_PI}, {right, bottom, 0.0f},
+                                       {left, bottom, 0.5f * UI_PI}};
+          for (const auto &corner : centres)
+          {
+               for (int s = 0; s <= segments; s++)
+               {
+                    const float angle = corner[2] + 0.5f * UI_PI * (segments > 0 ? (float)s / segments : 0.0f);
+                    widget.vertices.push_back(SDL_Vertex{
+                        {corner[0] + radius * std::cos(angle), corner[1] + radius * std::sin(angle)}, color, batch.white});
+               }
+          }
+          const int perimeter = (int)widget.vertices.size() - 1;
+          for (int i = 0; i < perimeter; i++)
+          {
+               const int next = (i + 1) % perimeter;
+               const int triangle[3] = {0, 1 + i, 1 + next};
+               widget.indices.insert(widget.indices.end(), triangle, triangle + 3);
+          }
+     }
+
+     void buildLine(const UiBatch &batch, UiWidget &widget)
+     {
+          const UiWidgetDesc &d = widget.desc;
+          const float dx = d.to.x - d.from.x, dy = d.to.y - d.from.y;
+          const float length = std::sqrt(dx * dx + dy * dy);
+          if (length <= 0.0f || d.thickness <= 0.0f)
+          {
+               return;
+          }
+          const float nx = -dy / length * d.thickness * 0.5f, ny = dx / length * d.thickness * 0.5f;
+          const SDL_Color color = d.colors[0];
+          widget.vertices.push_back(SDL_Vertex{{d.from.x + nx, d.from.y + ny}, color, batch.white});
+          widget.vertices.push_back(SDL_Vertex{{d.to.x + nx, d.to.y + ny}, color, batch.white});
+          widget.vertices.push_back(SDL_Vertex{{d.from.x - nx, d.from.y - ny}, color, batch.white});
+          widget.vertices.push_back(SDL_Vertex{{d.to.x - nx, d.to.y - ny}, color, batch.white});
+          addQuadIndices(widget.indices, 0, 1, 2, 3);
+     }
+
+     void buildGradient(const UiBatch &batch, UiWidget &widget)
+     {
+          const UiWidgetDesc &d = widget.desc;
+          const SDL_FRect &r = d.rect;
+          widget.vertices.push_back(SDL_Vertex{{r.x, r.y}, d.colors[0], batch.white});
+          widget.vertices.push_back(SDL_Vertex{{r.x + r.w, r.y}, d.colors[1], batch.white});
+          widget.vertices.push_back(SDL_Vertex{{r.x, r.y + r.h}, d.colors[2], batch.white});
+          widget.vertices.push_back(SDL_Vertex{{r.x + r.w, r.y + r.h}, d.colors[3], batch.white});
+          addQuadIndices(widget.indices, 0, 1, 2, 3);
+     }
+
+     void tessellate(const UiBatch &batch, UiWidget &widget)
+     {
+          widget.vertices.clear();
+          widget.indices.clear();
+          switch (widget.desc.shape)
+          {
+          case UI_NINE_SLICE:
+               buildNineSlice(batch, widget);
+               break;
+          case UI_ROUNDED_RECT:
+               buildRoundedRect(batch, widget);
+               break;
+          case UI_LINE:
+               buildLine(batch, widget);
+               break;
+          case UI_GRADIENT:
+               buildGradient(batch, widget);
+               break;
+          }
+          widget.dirty = false;
+     }
+}
+
+UiWidgetDesc uiNineSlice(const SDL_FRect &rect, const SDL_Rect &src, const SDL_Rect &insets, SDL_Color tint)
+{
+     UiWidgetDesc desc = blankDesc(UI_NINE_SLICE);
+     desc.rect = rect;
+     desc.src = src;
+     desc.insets = insets;
+     desc.colors[0] = tint;
+     return desc;
+}
+
+UiWidgetDesc uiRoundedRect(const SDL_FRect &rect, float radius, SDL_Color color)
+{
+     UiWidgetDesc desc = blankDesc(UI_ROUNDED_RECT);
+     desc.rect = rect;
+     desc.radius = radius;
+     desc.colors[0] = color;
+     return desc;
+}
+
+UiWidgetDesc uiLine(SDL_FPoint from, SDL_FPoint to, float thickness, SDL_Color color)
+{
+     UiWidgetDesc desc = blankDesc(UI_LINE);
+     desc.from = from;
+     desc.to = to;
+     desc.thickness = thickness;
+     desc.colors[0] = color;
+     return desc;
+}
+
+UiWidgetDesc uiGradient(const SDL_FRect &rect, SDL_Color top, SDL_Color bottom)
+{
+     UiWidgetDesc desc = blankDesc(UI_GRADIENT);
+     desc.rect = rect;
+     desc.colors[0] = desc.colors[1] = top;
+     desc.colors[2] = desc.colors[3] = bottom;
+     return desc;
+}
+
+bool uiBatchInit(UiBatch &batch, SDL_Texture *texture, const SDL_Rect *whiteTexel)
+{
+     batch.texture = texture;
+     batch.textureWidth = 0;
+     batch.textureHeight = 0;
+     batch.white = {0.0f, 0.0f};
+     batch.widgets.clear();
+     batch.vertices.clear();
+     batch.indices.clear();
+     batch.changed = true;
+     batch.rebuilt = 0;
+     batch.drawCalls = 0;
+     if (texture == nullptr)
+     {
+          return true;
+     }
+     if (SDL_QueryTexture(texture, nullptr, nullptr, &batch.textureWidth, &batch.textureHeight) != 0 ||
+         batch.textureWidth == 0 || batch.textureHeight == 0)
+     {
+          batch.texture = nullptr;
+          return false;
+     }
+     if (whiteTexel != nullptr)
+     {
+          // The texel's centre, so linear filtering never reaches a neighbour
+          batch.white = {(whiteTexel->x + whiteTexel->w * 0.5f) / batch.textureWidth,
+                         (whiteTexel->y + whiteTexel->h * 0.5f) / batch.textureHeight};
+     }
+     return true;
+}
+
+int uiBatchAdd(UiBatch &batch, const UiWidgetDesc &desc)
+{
+     UiWidget widget;
+     widget.desc = desc;
+     widget.dirty = true;
+     batch.widgets.push_back(std::move(widget));
+     batch.changed = true;
+     return (int)batch.widgets.size() - 1;
+}
+
+void uiBatchSet(UiBatch &batch, int id, const UiWidgetDesc &desc)
+{
+     if (id < 0 || id >= (int)batch.widgets.size() || sameDesc(batch.widgets[id].desc, desc))
+     {
+          return;
+     }
+     UiWidget &widget = batch.widgets[id];
+     // Showing or hiding keeps the triangles; only a new shape needs new ones
+     UiWidgetDesc shown = desc;
+     shown.visible = widget.desc.visible;
+     widget.dirty = widget.dirty || !sameDesc(widget.desc, shown);
+     widget.desc = desc;
+     batch.changed = true;
+}
+
+void uiBatchSetVisible(UiBatch &batch, int id, bool visible)
+{
+     if (id < 0 || id >= (int)batch.widgets.size())
+     {
+          return;
+     }
+     UiWidgetDesc desc = batch.widgets[id].desc;
+     desc.visible = visible;
+     uiBatchSet(batch, id, desc);
+}
+
+void uiBatchDraw(UiBatch &batch, SDL_Renderer *renderer)
+{
+     batch.rebuilt = 0;
+     batch.drawCalls = 0;
+     if (batch.changed)
+     {
+          batch.vertices.clear();
+          batch.indices.clear();
+          for (UiWidget &widget : batch.widgets)
+          {
+               if (!widget.desc.visible)
+               {
+                    continue;
+               }
+               if (widget.dirty)
+               {
+                    tessellate(batch, widget);
+                    batch.rebuilt++;
+               }
+               const int base = (int)batch.vertices.size();
+               batch.vertices.insert(batch.vertices.end(), widget.vertices.begin(), widget.vertices.end());
+               for (int index : widget.indices)
+               {
+                    batch.indices.push_back(base + index);
+               }
+          }
+          batch.changed = false;
+     }
+     if (batch.indices.empty())
+     {
+          return;
+     }
+     renderRecordGeometry(renderer, batch.texture, batch.vertices.data(), (int)batch.vertices.size(),
+                          batch.indices.data(), (int)batch.indices.size());
+     batch.drawCalls = 1;
+}
+
+void uiBatchClear(UiBatch &batch)
+{
+     batch.widgets.clear();
+     batch.vertices.clear();
+     batch.indices.clear();
+     batch.changed = true;
+}
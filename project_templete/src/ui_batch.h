@@ -0,0 +1,100 @@
+// Description:
+// Retained UI primitives drawn in one SDL_RenderGeometry call: nine-slice
+// panels, rounded rects, lines and gradients, all against one texture
+// (normally an atlas page). A panel built from nine SDL_RenderCopy calls
+// costs nine draws; here every widget's triangles go into the same vertex
+// and index arrays, and solid shapes sample one white texel of the same
+// texture so nothing forces a texture switch.
+//
+// Widgets are kept between frames. uiBatchSet() compares the new
+// description with the old one and only a widget that changed is
+// tessellated again (rounded corners are the costly part); when nothing
+// changed, uiBatchDraw() submits last frame's arrays untouched. Widgets
+// draw in the order they were added.
+//
+//     UiBatch ui;
+//     uiBatchInit(ui, atlasPage, &whiteTexel);
+//     int panel = uiBatchAdd(ui, uiNineSlice({40, 40, 300, 200}, frameSrc, {8, 8, 8, 8}, white));
+//     int bar = uiBatchAdd(ui, uiGradient({48, 48, 284, 24}, top, bottom));
+//     ...each frame
+//     uiBatchSet(ui, bar, uiGradient({48, 48, 284 * progress, 24}, top, bottom));
+//     uiBatchDraw(ui, renderer);
+// =============================================================================
+
+#ifndef UI_BATCH_H
+#define UI_BATCH_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+enum UiShape
+{
+     UI_NINE_SLICE,   // `src` scaled into `rect` with its `insets` borders kept at size
+     UI_ROUNDED_RECT, // `rect` with corners of `radius`, filled with colors[0]
+     UI_LINE,         // `from` to `to`, `thickness` wide, colors[0]
+     UI_GRADIENT      // `rect` with colors[0..3] at its top-left, top-right, bottom-left and bottom-right
+};
+
+// Everything a widget is drawn from; uiBatchSet() compares these fields
+struct UiWidgetDesc
+{
+     UiShape shape;
+     SDL_FRect rect;
+     SDL_Rect src;    // Nine-slice texel rect
+     SDL_Rect insets; // Nine-slice borders in texels: x left, y top, w right, h bottom
+     float radius;
+     float thickness;
+     SDL_FPoint from, to;
+     SDL_Color colors[4];
+     bool visible;
+};
+
+UiWidgetDesc uiNineSlice(const SDL_FRect &rect, const SDL_Rect &src, const SDL_Rect &insets, SDL_Color tint);
+UiWidgetDesc uiRoundedRect(const SDL_FRect &rect, float radius, SDL_Color color);
+UiWidgetDesc uiLine(SDL_FPoint from, SDL_FPoint to, float thickness, SDL_Color color);
+UiWidgetDesc uiGradient(const SDL_FRect &rect, SDL_Color top, SDL_Color bottom);
+
+struct UiWidget
+{
+     UiWidgetDesc desc;
+     std::vector<SDL_Vertex> vertices; // Tessellated, indices local to the widget
+     std::vector<int> indices;
+     bool dirty;
+};
+
+struct UiBatch
+{
+     SDL_Texture *texture; // nullptr: solid shapes only, nine-slices are skipped
+     int textureWidth, textureHeight;
+     SDL_FPoint white; // Texture coordinate of the white texel
+     std::vector<UiWidget> widgets;
+
+     // What uiBatchDraw() submits; rebuilt only when a widget changed
+     std::vector<SDL_Vertex> vertices;
+     std::vector<int> indices;
+     bool changed;
+
+     int rebuilt;   // Widgets tessellated by the last draw
+     int drawCalls; // SDL_RenderGeometry calls made by the last draw
+};
+
+// `whiteTexel` is a texel rect of opaque white in `texture`, sampled by the
+// solid shapes; it may be null when `texture` is. False if the texture
+// cannot be queried
+bool uiBatchInit(UiBatch &batch, SDL_Texture *texture, const SDL_Rect *whiteTexel);
+
+// Returns the widget's id, its index in draw order
+int uiBatchAdd(UiBatch &batch, const UiWidgetDesc &desc);
+
+// Replace a widget's description; a no-op when nothing in it differs
+void uiBatchSet(UiBatch &batch, int id, const UiWidgetDesc &desc);
+
+void uiBatchSetVisible(UiBatch &batch, int id, bool visible);
+
+// Tessellate what changed and draw every visible widget in one call, in
+// the renderer's current target and clip
+void uiBatchDraw(UiBatch &batch, SDL_Renderer *renderer);
+
+void uiBatchClear(UiBatch &batch);
+
+#endif // UI_BATCH_H
@@ -0,0 +1,573 @@
+#include "utf_convert.h"
+
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define UTF_CONVERT_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+     // Decode the multi-byte sequence at `s` (s[0] >= 0x80); returns its
+     // length, 0 when it is malformed
+     inline int decodeSequence(const Uint8 *s, size_t left, Uint32 &codepoint)
+     {
+          const Uint32 b0 = s[0];
+          if (b0 < 0xC2)
+          {
+               return 0; // Continuation byte, or an overlong two-byte lead
+          }
+          if (b0 < 0xE0)
+          {
+               if (left < 2 || (s[1] & 0xC0) != 0x80)
+               {
+                    return 0;
+               }
+               codepoint = (b0 & 0x1F) << 6 | (s[1] & 0x3F);
+               return 2;
+          }
+          if (b0 < 0xF0)
+          {
+               if (left < 3 || (s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80)
+               {
+                    return 0;
+               }
+               codepoint = (b0 & 0x0F) << 12 | (Uint32)(s[1] & 0x3F) << 6 | (s[2] & 0x3F);
+               return codepoint >= 0x800 && (codepoint < 0xD800 || codepoint > 0xDFFF) ? 3 : 0;
+          }
+          if (b0 < 0xF5)
+          {
+               if (left < 4 || (s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80 || (s[3] & 0xC0) != 0x80)
+               {
+                    return 0;
+               }
+               codepoint = (b0 & 0x07) << 18 | (Uint32)(s[1] & 0x3F) << 12 | (Uint32)(s[2] & 0x3F) << 6 | (s[3] & 0x3F);
+               return codepoint >= 0x10000 && codepoint <= 0x10FFFF ? 4 : 0;
+          }
+          return 0;
+     }
+
+     // Encode a valid code point past ASCII; returns bytes written
+     inline int encodeSequence(Uint32 codepoint, char *out)
+     {
+          if (codepoint < 0x800)
+          {
+               out[0] = (char)(0xC0 | codepoint >> 6);
+               out[1] = (char)(0x80 | (codepoint & 0x3F));
+               return 2;
+          }
+          if (codepoint < 0x10000)
+          {
+               out[0] = (char)(0xE0 | codepoint >> 12);
+               out[1] = (char)(0x80 | (codepoint >> 6 & 0x3F));
+               out[2] = (char)(0x80 | (codepoint & 0x3F));
+               return 3;
+          }
+          out[0] = (char)(0xF0 | codepoint >> 18);
+          out[1] = (char)(0x80 | (codepoint >> 12 & 0x3F));
+          out[2] = (char)(0x80 | (codepoint >> 6 & 0x3F));
+          out[3] = (char)(0x80 | (codepoint & 0x3F));
+          return 4;
+     }
+
+     // Each kernel is written once; SIMD adds the 16-byte ASCII lane ahead
+     // of the scalar step, which handles one character and returns to it
+
+     template <bool SIMD>
+     bool validateKernel(const char *text, size_t length)
+     {
+          const Uint8 *s = (const Uint8 *)text;
+          size_t i = 0;
+          while (i < length)
+          {
+#ifdef UTF_CONVERT_X86
+               if (SIMD)
+               {
+                    while (i + 16 <= length && _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(s + i))) == 0)
+                    {
+                         i += 16;
+                    }
+                    if (i == length)
+                    {
+                         break;
+                    }
+               }
+#endif
+               if (s[i] < 0x80)
+               {
+                    i++;
+                    continue;
+               }
+               Uint32 codepoint;
+               const int n = decodeSequence(s + i, length - i, codepoint);
+               if (n == 0)
+               {
+                    return false;
+               }
+               i += n;
+          }
+          return true;
+     }
+
+     template <bool SIMD>
+     size_t utf8ToUtf16Kernel(const char *src, size_t length, Uint16 *dst)
+     {
+          const Uint8 *s = (const Uint8 *)src;
+          size_t i = 0, o = 0;
+          while (i < length)
+          {
+#ifdef UTF_CONVERT_X86
+               if (SIMD)
+               {
+                    const __m128i zero = _mm_setzero_si128();
+                    while (i + 16 <= length)
+                    {
+                         const __m128i bytes = _mm_loadu_si128((const __m128i *)(s + i));
+                         if (_mm_movemask_epi8(bytes) != 0)
+                         {
+                              break;
+                         }
+                         _mm_storeu_si128((__m128i *)(dst + o), _mm_unpacklo_epi8(bytes, zero));
+                         _mm_storeu_si128((__m128i *)(dst + o + 8), _mm_unpackhi_epi8(bytes, zero));
+                         i += 16;
+                         o += 16;
+                    }
+                    if (i == length)
+                    {
+                         break;
+                    }
+               }
+#endif
+               if (s[i] < 0x80)
+               {
+                    dst[o++] = s[i++];
+                    continue;
+               }
+               Uint32 codepoint;
+               const int n = decodeSequence(s + i, length - i, codepoint);
+               if (n == 0)
+               {
+                    return UTF_INVALID;
+               }
+               i += n;
+               if (codepoint >= 0x10000)
+               {
+                    codepoint -= 0x10000;
+                    dst[o++] = (Uint16)(0xD800 | codepoint >> 10);
+                    dst[o++] = (Uint16)(0xDC00 | (codepoint & 0x3FF));
+               }
+               else
+               {
+                    dst[o++] = (Uint16)codepoint;
+               }
+          }
+          return o;
+     }
+
+     template <bool SIMD>
+     size_t utf16ToUtf8Kernel(const Uint16 *src, size_t count, char *dst)
+     {
+          size_t i = 0, o = 0;
+          while (i < count)
+          {
+#ifdef UTF_CONVERT_X86
+               if (SIMD)
+               {
+                    const __m128i high = _mm_set1_epi16((short)0xFF80);
+                    const __m128i zero = _mm_setzero_si128();
+                    while (i + 16 <= count)
+                    {
+                         const __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+                         const __m128i b = _mm_loadu_si128((const __m128i *)(src + i + 8));
+                         const __m128i any = _mm_and_si128(_mm_or_si128(a, b), high);
+                         if (_mm_movemask_epi8(_mm_cmpeq_epi16(any, zero)) != 0xFFFF)
+                         {
+                              break;
+                         }
+                         _mm_storeu_si128((__m128i *)(dst + o), _mm_packus_epi16(a, b));
+                         i += 16;
+                         o += 16;
+                    }
+                    if (i == count)
+                    {
+                         break;
+                    }
+               }
+#endif
+               Uint32 codepoint = src[i++];
+               if (codepoint < 0x80)
+               {
+                    dst[o++] = (char)codepoint;
+                    continue;
+               }
+               if (codepoint >= 0xD800 && codepoint <= 0xDFFF)
+               {
+                    if (codepoint >= 0xDC00 || i == count || src[i] < 0xDC00 || src[i] > 0xDFFF)
+                    {
+                         return UTF_INVALID; // Unpaired surrogate
+                    }
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (src[i++] - 0xDC00);
+               }
+               o += encodeSequence(codepoint, dst + o);
+          }
+          return o;
+     }
+
+     template <bool SIMD>
+     size_t utf8ToUtf32Kernel(const char *src, size_t length, Uint32 *dst)
+     {
+          const Uint8 *s = (const Uint8 *)src;
+          size_t i = 0, o = 0;
+          while (i < length)
+          {
+#ifdef UTF_CONVERT_X86
+               if (SIMD)
+               {
+                    const __m128i zero = _mm_setzero_si128();
+                    while (i + 16 <= length)
+                    {
+                         const __m128i bytes = _mm_loadu_si128((const __m128i *)(s + i));
+                         if (_mm_movemask_epi8(bytes) != 0)
+                         {
+                              break;
+                         }
+                         const __m128i low = _mm_unpacklo_epi8(bytes, zero), high = _mm_unpackhi_epi8(bytes, zero);
+                         _mm_storeu_si128((__m128i *)(dst + o), _mm_unpacklo_epi16(low, zero));
+                         _mm_storeu_si128((__m128i *)(dst + o + 4), _mm_unpackhi_epi16(low, zero));
+                         _mm_storeu_si128((__m128i *)(dst + o + 8), _mm_unpacklo_epi16(high, zero));
+                         _mm_storeu_si128((__m128i *)(dst + o + 12), _mm_unpackhi_epi16(high, zero));
+                         i += 16;
+                         o += 16;
+                    }
+                    if (i == length)
+                    {
+                         break;
+                    }
+               }
+#endif
+               if (s[i] < 0x80)
+               {
+                    dst[o++] = s[i++];
+                    continue;
+               }
+               Uint32 codepoint;
+               const int n = decodeSequence(s + i, length - i, codepoint);
+               if (n == 0)
+               {
+                    return UTF_INVALID;
+               }
+               i += n;
+               dst[o++] = codepoint;
+          }
+          return o;
+     }
+
+     template <bool SIMD>
+     size_t utf32ToUtf8Kernel(const Uint32 *src, size_t count, char *dst)
+     {
+          size_t i = 0, o = 0;
+          while (i < count)
+          {
+#ifdef UTF_CONVERT_X86
+               if (SIMD)
+               {
+                    const __m128i high = _mm_set1_epi32((int)0xFFFFFF80);
+                    const __m128i zero = _mm_setzero_si128();
+                    while (i + 16 <= count)
+                    {
+                         const __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+                         const __m128i b = _mm_loadu_si128((const __m128i *)(src + i + 4));
+                         const __m128i c = _mm_loadu_si128((const __m128i *)(src + i + 8));
+                         const __m128i d = _mm_loadu_si128((const __m128i *)(src + i + 12));
+                         const __m128i any = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), high);
+                         if (_mm_movemask_epi8(_mm_cmpeq_epi32(any, zero)) != 0xFFFF)
+                         {
+                              break;
+                         }
+                         // Every lane is below 0x80, so the signed packs cannot saturate
+                         const __m128i low = _mm_packs_epi32(a, b), top = _mm_packs_epi32(c, d);
+                         _mm_storeu_si128((__m128i *)(dst + o), _mm_packus_epi16(low, top));
+                         i += 16;
+                         o += 16;
+                    }
+                    if (i == count)
+                    {
+                         break;
+                    }
+               }
+#endif
+               const Uint32 codepoint = src[i++];
+               if (codepoint < 0x80)
+               {
+                    dst[o++] = (char)codepoint;
+                    continue;
+               }
+               if (codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+               {
+                    return UTF_INVALID;
+               }
+               o += encodeSequence(codepoint, dst + o);
+          }
+          return o;
+     }
+
+     // One sequence the way glyphCacheDecodeUtf8 reads it: lead bytes are
+     // only checked for their length, a bad byte becomes U+FFFD, and a
+     // truncated sequence consumes just its valid bytes
+     inline Uint32 decodeLenient(const Uint8 *s, size_t left, size_t &used)
+     {
+          Uint32 c = s[0];
+          size_t length;
+          if ((c & 0xE0) == 0xC0)
+          {
+               length = 2;
+               c &= 0x1F;
+          }
+          else if ((c & 0xF0) == 0xE0)
+          {
+               length = 3;
+               c &= 0x0F;
+          }
+          else if ((c & 0xF8) == 0xF0)
+          {
+               length = 4;
+               c &= 0x07;
+          }
+          else
+          {
+               used = 1;
+               return 0xFFFD;
+          }
+          for (size_t i = 1; i < length; i++)
+          {
+               if (i == left || (s[i] & 0xC0) != 0x80)
+               {
+                    used = i;
+                    return 0xFFFD;
+               }
+               c = (c << 6) | (s[i] & 0x3F);
+          }
+          used = length;
+          return c;
+     }
+
+     template <bool SIMD>
+     size_t decodeKernel(const char *text, size_t length, Uint32 *dst)
+     {
+          const Uint8 *s = (const Uint8 *)text;
+          size_t i = 0, o = 0;
+          while (i < length)
+          {
+#ifdef UTF_CONVERT_X86
+               if (SIMD)
+               {
+                    const __m128i zero = _mm_setzero_si128();
+                    while (i + 16 <= length)
+                    {
+                         const __m128i bytes = _mm_loadu_si128((const __m128i *)(s + i));
+                         if (_mm_movemask_epi8(bytes) != 0)
+                         {
+                              break;
+                         }
+                         const __m128i low = _mm_unpacklo_epi8(bytes, zero), high = _mm_unpackhi_epi8(bytes, zero);
+                         _mm_storeu_si128((__m128i *)(dst + o), _mm_unpacklo_epi16(low, zero));
+                         _mm_storeu_si128((__m128i *)(dst + o + 4), _mm_unpackhi_epi16(low, zero));
+                         _mm_storeu_si128((__m128i *)(dst + o + 8), _mm_unpacklo_epi16(high, zero));
+                         _mm_storeu_si128((__m128i *)(dst + o + 12), _mm_unpackhi_epi16(high, zero));
+                         i += 16;
+                         o += 16;
+                    }
+                    if (i == length)
+                    {
+                         break;
+                    }
+               }
+#endif
+               if (s[i] < 0x80)
+               {
+                    dst[o++] = s[i++];
+                    continue;
+               }
+               size_t used;
+               dst[o++] = decodeLenient(s + i, length - i, used);
+               i += used;
+          }
+          return o;
+     }
+
+     const UtfKernelTable UTF_SCALAR_TABLE = {validateKernel<false>, utf8ToUtf16Kernel<false>,
+                                              utf16ToUtf8Kernel<false>, utf8ToUtf32Kernel<false>,
+                                              utf32ToUtf8Kernel<false>, decodeKernel<false>};
+#ifdef UTF_CONVERT_X86
+     const UtfKernelTable UTF_SSE2_TABLE = {validateKernel<true>, utf8ToUtf16Kernel<true>, utf16ToUtf8Kernel<true>,
+                                            utf8ToUtf32Kernel<true>, utf32ToUtf8Kernel<true>, decodeKernel<true>};
+#endif
+
+     UtfKernel activeUtfKernel = UTF_KERNEL_AUTO;
+     const UtfKernelTable *activeUtfTable = &UTF_SCALAR_TABLE;
+
+     enum UtfEncoding
+     {
+          UTF_ENCODING_OTHER,
+          UTF_ENCODING_8,
+          UTF_ENCODING_16LE,
+          UTF_ENCODING_32LE
+     };
+
+     // The names SDL_iconv_open() knows for these, compared the same way
+     UtfEncoding parseEncoding(const char *code)
+     {
+          if (code == nullptr)
+          {
+               return UTF_ENCODING_OTHER;
+          }
+          if (SDL_strcasecmp(code, "UTF-8") == 0 || SDL_strcasecmp(code, "UTF8") == 0)
+          {
+               return UTF_ENCODING_8;
+          }
+          if (SDL_strcasecmp(code, "UTF-16LE") == 0 || SDL_strcasecmp(code, "UTF16LE") == 0)
+          {
+               return UTF_ENCODING_16LE;
+          }
+          if (SDL_strcasecmp(code, "UTF-32LE") == 0 || SDL_strcasecmp(code, "UTF32LE") == 0)
+          {
+               return UTF_ENCODING_32LE;
+          }
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+          if (SDL_strcasecmp(code, "UCS-4INTERNAL") == 0)
+          {
+               return UTF_ENCODING_32LE;
+          }
+#endif
+          return UTF_ENCODING_OTHER;
+     }
+
+     // The fast path, or nullptr when SDL should do it
+     char *convertFast(UtfEncoding to, UtfEncoding from, const char *in, size_t bytes)
+     {
+          const UtfKernelTable &kernels = utfKernels();
+          const size_t TERMINATOR = 4; // SDL_iconv_string ends its output with four zero bytes
+          const size_t unitSize = from == UTF_ENCODING_16LE ? 2 : from == UTF_ENCODING_32LE ? 4 : 1;
+          if (bytes % unitSize != 0 || ((uintptr_t)in & (unitSize - 1)) != 0)
+          {
+               return nullptr;
+          }
+
+          char *out = nullptr;
+          size_t written = UTF_INVALID, outSize = 0;
+          if (from == UTF_ENCODING_8 && to == UTF_ENCODING_16LE)
+          {
+               out = (char *)SDL_malloc(bytes * 2 + TERMINATOR);
+               written = out != nullptr ? kernels.utf8ToUtf16(in, bytes, (Uint16 *)out) : UTF_INVALID;
+               outSize = 2;
+          }
+          else if (from == UTF_ENCODING_8 && to == UTF_ENCODING_32LE)
+          {
+               out = (char *)SDL_malloc(bytes * 4 + TERMINATOR);
+               written = out != nullptr ? kernels.utf8ToUtf32(in, bytes, (Uint32 *)out) : UTF_INVALID;
+               outSize = 4;
+          }
+          else if (from == UTF_ENCODING_16LE && to == UTF_ENCODING_8)
+          {
+               out = (char *)SDL_malloc(bytes / 2 * 3 + TERMINATOR);
+               written = out != nullptr ? kernels.utf16ToUtf8((const Uint16 *)in, bytes / 2, out) : UTF_INVALID;
+               outSize = 1;
+          }
+          else if (from == UTF_ENCODING_32LE && to == UTF_ENCODING_8)
+          {
+               out = (char *)SDL_malloc(bytes + TERMINATOR);
+               written = out != nullptr ? kernels.utf32ToUtf8((const Uint32 *)in, bytes / 4, out) : UTF_INVALID;
+               outSize = 1;
+          }
+          if (written == UTF_INVALID)
+          {
+               SDL_free(out);
+               return nullptr;
+          }
+          SDL_memset(out + written * outSize, 0, TERMINATOR);
+          return out;
+     }
+}
+
+bool utfKernelSupported(UtfKernel kernel)
+{
+     switch (kernel)
+     {
+     case UTF_KERNEL_AUTO:
+     case UTF_KERNEL_SCALAR:
+          return true;
+#ifdef UTF_CONVERT_X86
+     case UTF_KERNEL_SSE2:
+          return cpuHasSse2();
+#endif
+     default:
+          return false;
+     }
+}
+
+const char *utfKernelName(UtfKernel kernel)
+{
+     switch (kernel)
+     {
+     case UTF_KERNEL_SCALAR:
+          return "scalar";
+     case UTF_KERNEL_SSE2:
+          return "sse2";
+     default:
+          return "auto";
+     }
+}
+
+UtfKernel utfSetKernel(UtfKernel kernel)
+{
+     if (kernel == UTF_KERNEL_AUTO)
+     {
+          kernel = utfKernelSupported(UTF_KERNEL_SSE2) ? UTF_KERNEL_SSE2 : UTF_KERNEL_SCALAR;
+     }
+     else if (!utfKernelSupported(kernel))
+     {
+          kernel = UTF_KERNEL_SCALAR;
+     }
+
+     activeUtfKernel = kernel;
+     activeUtfTable = &UTF_SCALAR_TABLE;
+#ifdef UTF_CONVERT_X86
+     if (kernel == UTF_KERNEL_SSE2)
+     {
+          activeUtfTable = &UTF_SSE2_TABLE;
+     }
+#endif
+     return kernel;
+}
+
+const UtfKernelTable &utfKernels()
+{
+     if (activeUtfKernel == UTF_KERNEL_AUTO)
+     {
+          utfSetKernel(UTF_KERNEL_AUTO);
+     }
+     return *activeUtfTable;
+}
+
+char *utfConvertString(const char *tocode, const char *fromcode, const char *inbuf, size_t inbytesleft)
+{
+     const UtfEncoding to = parseEncoding(tocode), from = parseEncoding(fromcode);
+     if (inbuf != nullptr && to != UTF_ENCODING_OTHER && from != UTF_ENCODING_OTHER &&
+         (to == UTF_ENCODING_8) != (from == UTF_ENCODING_8))
+     {
+          char *converted = convertFast(to, from, inbuf, inbytesleft);
+          if (converted != nullptr)
+          {
+               return converted;
+          }
+     }
+     return SDL_iconv_string(tocode, fromcode, inbuf, inbytesleft);
+}
+
+void utfDecode(const char *text, std::vector<Uint32> &codepoints)
+{
+     const size_t length = SDL_strlen(text);
+     codepoints.resize(length);
+     codepoints.resize(length > 0 ? utfKernels().decode(text, length, codepoints.data()) : 0);
+}
@@ -0,0 +1,77 @@
+// Description:
+// Fast UTF-8 validation and UTF-8 <-> UTF-16 / UTF-32 transcoding.
+// SDL_iconv_string goes through SDL_iconv's generic path: one code point
+// at a time, looked up by encoding on every character, with the output
+// buffer grown as it goes. That is fine for a window title and slow for
+// localization tables of many megabytes, which are almost all ASCII. These
+// kernels have a scalar and an SSE2 version, picked like mem_kernels.h's
+// (the fastest this CPU supports on first use, or utfSetKernel() for
+// benchmarks). The SSE2 lane takes 16 ASCII bytes per step, checked with
+// one movemask, and drops to a strict scalar decoder only at the first
+// byte that is not ASCII.
+//
+// The converters reject anything that is not well formed: overlong and
+// truncated sequences, surrogates encoded in UTF-8, unpaired surrogates in
+// UTF-16, and code points past U+10FFFF. utfConvertString() is a drop-in
+// SDL_iconv_string(): it takes the fast path between UTF-8 and
+// UTF-16LE/UTF-32LE and hands everything else to SDL, including malformed
+// input, so the replacement characters come out exactly as SDL makes them.
+//
+// Text rendering wants the opposite: never fail, and turn each bad byte
+// into U+FFFD the way glyphCacheDecodeUtf8() does. `decode` and
+// utfDecode() do that for a whole string at once, with the same ASCII lane,
+// so measure and draw calls walk a codepoint array decoded once.
+// =============================================================================
+
+#ifndef UTF_CONVERT_H
+#define UTF_CONVERT_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+enum UtfKernel
+{
+     UTF_KERNEL_AUTO,
+     UTF_KERNEL_SCALAR,
+     UTF_KERNEL_SSE2
+};
+
+// Returned by the converters for malformed input
+const size_t UTF_INVALID = (size_t)-1;
+
+// Output units are native-endian. Outputs must have room for the worst
+// case: UTF-16 and UTF-32 `length` units for `length` UTF-8 bytes, UTF-8
+// 3 bytes per UTF-16 unit and 4 per UTF-32 unit. Each returns the units
+// written, or UTF_INVALID
+struct UtfKernelTable
+{
+     bool (*validate)(const char *text, size_t length);
+     size_t (*utf8ToUtf16)(const char *src, size_t length, Uint16 *dst);
+     size_t (*utf16ToUtf8)(const Uint16 *src, size_t count, char *dst);
+     size_t (*utf8ToUtf32)(const char *src, size_t length, Uint32 *dst);
+     size_t (*utf32ToUtf8)(const Uint32 *src, size_t count, char *dst);
+
+     // Lenient UTF-8 to codepoints, as glyphCacheDecodeUtf8() over the
+     // whole string: never fails, `dst` needs `length` entries
+     size_t (*decode)(const char *text, size_t length, Uint32 *dst);
+};
+
+bool utfKernelSupported(UtfKernel kernel);
+const char *utfKernelName(UtfKernel kernel);
+
+// Force a kernel; unsupported ones fall back to scalar. Returns the kernel
+// now in use.
+UtfKernel utfSetKernel(UtfKernel kernel);
+
+// The kernels in use
+const UtfKernelTable &utfKernels();
+
+// SDL_iconv_string() with a fast path for UTF-8 to and from UTF-16LE and
+// UTF-32LE. Free the result with SDL_free
+char *utfConvertString(const char *tocode, const char *fromcode, const char *inbuf, size_t inbytesleft);
+
+// Replace `codepoints` with the codepoints of NUL-terminated `text`; the
+// vector's capacity is kept, so a reused one stops allocating
+void utfDecode(const char *text, std::vector<Uint32> &codepoints);
+
+#endif // UTF_CONVERT_H
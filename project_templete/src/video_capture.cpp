@@ -0,0 +1,384 @@
+#include "video_capture.h"
+
+#include <iostream>
+
+namespace
+{
+     struct CaptureJob
+     {
+          VideoCapture *capture;
+          VideoCaptureFrame *frame;
+     };
+
+     // RGB888 -> RGB24 -> YUV; the surface goes back to the pool. Runs on a
+     // worker, or on the capture thread without a job system
+     void convertCaptureFrame(VideoCapture &capture, VideoCaptureFrame &frame)
+     {
+          const int w = frame.width, h = frame.height;
+          frame.rgb24.resize((size_t)w * h * 3);
+          frame.yuv.resize(yuvImageSize(capture.format, w, h));
+          const bool ok =
+              SDL_ConvertPixels(w, h, frame.rgb->format->format, frame.rgb->pixels, frame.rgb->pitch,
+                                SDL_PIXELFORMAT_RGB24, frame.rgb24.data(), w * 3) == 0 &&
+              yuvFromRgb(capture.kernel, capture.format, frame.rgb24.data(), w * 3, frame.yuv.data(), w, h, capture.mode);
+          if (!ok)
+          {
+               frame.yuv.clear();
+          }
+          surfacePoolRelease(*capture.surfaces, frame.rgb);
+
+          SDL_LockMutex(capture.lock);
+          frame.rgb = nullptr;
+          frame.converted = true;
+          SDL_CondBroadcast(capture.wake);
+          SDL_UnlockMutex(capture.lock);
+     }
+
+     void convertCaptureJob(void *data, int)
+     {
+          CaptureJob *job = (CaptureJob *)data;
+          convertCaptureFrame(*job->capture, *job->frame);
+          delete job;
+     }
+
+     // frame_readback callback, on the main thread in request order
+     void captureReadBack(void *userdata, SDL_Surface *surface, int tag)
+     {
+          VideoCapture &capture = *(VideoCapture *)userdata;
+          SDL_LockMutex(capture.lock);
+          VideoCaptureFrame *frame = nullptr;
+          for (VideoCaptureFrame *queued : capture.queue)
+          {
+               if (queued->index == (Uint64)tag)
+               {
+                    frame = queued;
+                    break;
+               }
+               // Readbacks arrive in order, so an earlier frame still waiting
+               // for its pixels was lost in the readback; don't hold up the rest
+               if (queued->rgb == nullptr && !queued->converted)
+               {
+                    queued->yuv.clear();
+                    queued->converted = true;
+               }
+          }
+          if (frame != nullptr)
+          {
+               frame->width = surface->w;
+               frame->height = surface->h;
+               frame->rgb = surface;
+          }
+          SDL_CondBroadcast(capture.wake); // Without jobs the capture thread converts it
+          SDL_UnlockMutex(capture.lock);
+          if (frame == nullptr)
+          {
+               surfacePoolRelease(*capture.surfaces, surface);
+               return;
+          }
+          if (capture.jobs != nullptr)
+          {
+               jobSystemSubmit(*capture.jobs, convertCaptureJob, new CaptureJob{&capture, frame}, &capture.conversions);
+          }
+     }
+
+     void encodeCaptureFrame(VideoCapture &capture, const VideoCaptureFrame &frame)
+     {
+          if (frame.yuv.empty())
+          {
+               capture.failed++;
+               return;
+          }
+          VideoEncodeFrame out = {};
+          out.format = capture.format;
+          out.width = frame.width;
+          out.height = frame.height;
+          const int chromaW = (frame.width + 1) / 2, chromaH = (frame.height + 1) / 2;
+          out.planes[0] = frame.yuv.data();
+          out.pitches[0] = frame.width;
+          out.planes[1] = out.planes[0] + (size_t)frame.width * frame.height;
+          if (capture.format == SDL_PIXELFORMAT_NV12)
+          {
+               out.pitches[1] = chromaW * 2;
+          }
+          else
+          {
+               out.pitches[1] = chromaW;
+               out.planes[2] = out.planes[1] + (size_t)chromaW * chromaH;
+               out.pitches[2] = chromaW;
+          }
+          out.size = frame.yuv.size();
+          out.index = frame.index;
+          out.timeNs = frame.timeNs;
+          if (capture.encoder.encode(capture.encoder.userdata, out))
+          {
+               capture.encoded++;
+          }
+          else
+          {
+               capture.failed++;
+          }
+     }
+
+     int SDLCALL captureThreadMain(void *data)
+     {
+          VideoCapture &capture = *(VideoCapture *)data;
+          SDL_LockMutex(capture.lock);
+          for (;;)
+          {
+               VideoCaptureFrame *front = capture.queue.empty() ? nullptr : capture.queue.front();
+               if (front == nullptr && capture.stopping)
+               {
+                    break;
+               }
+               if (front != nullptr && !front->converted && front->rgb != nullptr && capture.jobs == nullptr)
+               {
+                    SDL_UnlockMutex(capture.lock);
+                    convertCaptureFrame(capture, *front);
+                    SDL_LockMutex(capture.lock);
+                    continue;
+               }
+               if (front == nullptr || !front->converted)
+               {
+                    SDL_CondWait(capture.wake, capture.lock);
+                    continue;
+               }
+
+               // Strictly in index order, whatever order conversions finished in
+               capture.queue.pop_front();
+               SDL_UnlockMutex(capture.lock);
+               encodeCaptureFrame(capture, *front);
+               SDL_LockMutex(capture.lock);
+               capture.spare.push_back(front);
+          }
+          SDL_UnlockMutex(capture.lock);
+          return 0;
+     }
+}
+
+bool videoCaptureStart(VideoCapture &capture, FrameReadback &readback, SurfacePool &surfaces, JobSystem *jobs,
+                       const VideoEncoder &encoder, Uint32 format, int maxQueued, SDL_YUV_CONVERSION_MODE mode)
+{
+     if (format != SDL_PIXELFORMAT_IYUV && format != SDL_PIXELFORMAT_NV12)
+     {
+          return SDL_SetError("Video capture takes IYUV or NV12, not %s", SDL_GetPixelFormatName(format)) == 0;
+     }
+     if (encoder.encode == nullptr)
+     {
+          return SDL_SetError("Video capture needs an encode callback") == 0;
+     }
+     capture.readback = &readback;
+     capture.jobs = jobs;
+     capture.surfaces = &surfaces;
+     capture.encoder = encoder;
+     capture.format = format;
+     capture.mode = mode;
+     capture.kernel = YUV_KERNEL_AUTO;
+     capture.maxQueued = SDL_max(maxQueued, 1);
+     capture.startCounter = SDL_GetPerformanceCounter();
+     capture.requested = 0;
+     capture.conversions = {};
+     capture.queue.clear();
+     capture.spare.clear();
+     capture.stopping = false;
+     capture.encoded = 0;
+     capture.dropped = 0;
+     capture.failed = 0;
+
+     capture.lock = SDL_CreateMutex();
+     capture.wake = SDL_CreateCond();
+     capture.thread = capture.lock != nullptr && capture.wake != nullptr
+                          ? SDL_CreateThread(captureThreadMain, "video_capture", &capture)
+                          : nullptr;
+     if (capture.thread == nullptr)
+     {
+          SDL_DestroyCond(capture.wake);
+          SDL_DestroyMutex(capture.lock);
+          capture.wake = nullptr;
+          capture.lock = nullptr;
+          return false;
+     }
+     return true;
+}
+
+bool videoCaptureFrame(VideoCapture &capture)
+{
+     const Uint64 index = capture.requested++;
+     SDL_LockMutex(capture.lock);
+     if ((int)capture.queue.size() >= capture.maxQueued)
+     {
+          capture.dropped++;
+          SDL_UnlockMutex(capture.lock);
+          return false;
+     }
+     VideoCaptureFrame *frame;
+     if (!capture.spare.empty())
+     {
+          frame = capture.spare.back();
+          capture.spare.pop_back();
+     }
+     else
+     {
+          frame = new VideoCaptureFrame();
+     }
+     frame->rgb = nullptr;
+     frame->width = 0;
+     frame->height = 0;
+     frame->index = index;
+     frame->timeNs = (SDL_GetPerformanceCounter() - capture.startCounter) * 1000000000ull / SDL_GetPerformanceFrequency();
+     frame->converted = false;
+     capture.queue.push_back(frame);
+     SDL_UnlockMutex(capture.lock);
+
+     // The tag finds the frame again; indices past INT_MAX are two years at 60 FPS
+     if (!frameReadbackRequest(*capture.readback, captureReadBack, &capture, (int)index))
+     {
+          SDL_LockMutex(capture.lock);
+          frame->yuv.clear();
+          frame->converted = true; // Encoded as a failure, so later frames are not held up
+          SDL_CondBroadcast(capture.wake);
+          SDL_UnlockMutex(capture.lock);
+          return false;
+     }
+     return true;
+}
+
+int videoCapturePending(VideoCapture &capture)
+{
+     SDL_LockMutex(capture.lock);
+     const int pending = (int)capture.queue.size();
+     SDL_UnlockMutex(capture.lock);
+     return pending;
+}
+
+void videoCaptureStop(VideoCapture &capture)
+{
+     if (capture.thread == nullptr)
+     {
+          return;
+     }
+     frameReadbackFinish(*capture.readback);
+     if (capture.jobs != nullptr)
+     {
+          jobSystemWait(*capture.jobs, capture.conversions);
+     }
+     SDL_LockMutex(capture.lock);
+     for (VideoCaptureFrame *frame : capture.queue)
+     {
+          if (frame->rgb == nullptr && !frame->converted)
+          {
+               frame->yuv.clear(); // Its readback failed
+               frame->converted = true;
+          }
+     }
+     capture.stopping = true;
+     SDL_CondBroadcast(capture.wake);
+     SDL_UnlockMutex(capture.lock);
+     SDL_WaitThread(capture.thread, nullptr);
+     capture.thread = nullptr;
+
+     if (capture.encoder.finish != nullptr)
+     {
+          capture.encoder.finish(capture.encoder.userdata);
+     }
+     for (VideoCaptureFrame *frame : capture.spare)
+     {
+          delete frame;
+     }
+     capture.spare.clear();
+     SDL_DestroyCond(capture.wake);
+     SDL_DestroyMutex(capture.lock);
+     capture.wake = nullptr;
+     capture.lock = nullptr;
+}
+
+namespace
+{
+     void scalePlane(const Uint8 *src, int srcW, int srcH, int srcPitch, Uint8 *dst, int dstW, int dstH)
+     {
+          for (int y = 0; y < dstH; y++)
+          {
+               const Uint8 *row = src + (size_t)((Sint64)y * srcH / dstH) * srcPitch;
+               for (int x = 0; x < dstW; x++)
+               {
+                    *dst++ = row[(Sint64)x * srcW / dstW];
+               }
+          }
+     }
+
+     // An IYUV frame of another size, resampled to the stream's
+     void scaleIyuv(const VideoEncodeFrame &frame, int width, int height, std::vector<Uint8> &out)
+     {
+          const int srcChromaW = (frame.width + 1) / 2, srcChromaH = (frame.height + 1) / 2;
+          const int chromaW = (width + 1) / 2, chromaH = (height + 1) / 2;
+          out.resize((size_t)width * height + (size_t)chromaW * chromaH * 2);
+          Uint8 *u = out.data() + (size_t)width * height;
+          Uint8 *v = u + (size_t)chromaW * chromaH;
+          scalePlane(frame.planes[0], frame.width, frame.height, frame.pitches[0], out.data(), width, height);
+          scalePlane(frame.planes[1], srcChromaW, srcChromaH, frame.pitches[1], u, chromaW, chromaH);
+          scalePlane(frame.planes[2], srcChromaW, srcChromaH, frame.pitches[2], v, chromaW, chromaH);
+     }
+
+     bool encodeY4m(void *userdata, const VideoEncodeFrame &frame)
+     {
+          VideoY4m &y4m = *(VideoY4m *)userdata;
+          if (frame.format != SDL_PIXELFORMAT_IYUV || y4m.file == nullptr || frame.width <= 0 || frame.height <= 0)
+          {
+               return false;
+          }
+          if (!y4m.headerWritten)
+          {
+               // 4:2:0 with the chroma centred between the four luma samples
+               // it averages, which is what yuv_convert computes
+               char header[96];
+               const int length = SDL_snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C420jpeg\n",
+                                               frame.width, frame.height, y4m.fpsNumerator, y4m.fpsDenominator);
+               if (SDL_RWwrite(y4m.file, header, 1, length) != (size_t)length)
+               {
+                    return false;
+               }
+               y4m.headerWritten = true;
+               y4m.width = frame.width;
+               y4m.height = frame.height;
+          }
+          const Uint8 *data = frame.planes[0];
+          size_t size = frame.size;
+          if (frame.width != y4m.width || frame.height != y4m.height)
+          {
+               scaleIyuv(frame, y4m.width, y4m.height, y4m.scaled);
+               data = y4m.scaled.data();
+               size = y4m.scaled.size();
+               y4m.rescaled++;
+          }
+          return SDL_RWwrite(y4m.file, "FRAME\n", 1, 6) == 6 && SDL_RWwrite(y4m.file, data, 1, size) == size;
+     }
+
+     void finishY4m(void *userdata)
+     {
+          VideoY4m &y4m = *(VideoY4m *)userdata;
+          if (y4m.file != nullptr && SDL_RWclose(y4m.file) != 0)
+          {
+               std::cerr << "Unable to finish the video capture! SDL Error: " << SDL_GetError() << std::endl;
+          }
+          y4m.file = nullptr;
+     }
+}
+
+bool videoY4mOpen(VideoY4m &y4m, const char *path, double fps)
+{
+     y4m.file = SDL_RWFromFile(path, "wb");
+     // 59.94 is written as 59940:1000; whole rates reduce to n:1
+     const int millihertz = (int)SDL_floor(SDL_clamp(fps, 1.0, 1000.0) * 1000.0 + 0.5);
+     y4m.fpsNumerator = millihertz % 1000 == 0 ? millihertz / 1000 : millihertz;
+     y4m.fpsDenominator = millihertz % 1000 == 0 ? 1 : 1000;
+     y4m.headerWritten = false;
+     y4m.width = 0;
+     y4m.height = 0;
+     y4m.scaled.clear();
+     y4m.rescaled = 0;
+     return y4m.file != nullptr;
+}
+
+VideoEncoder videoY4mEncoder(VideoY4m &y4m)
+{
+     return VideoEncoder{encodeY4m, finishY4m, &y4m};
+}
@@ -0,0 +1,128 @@
+// Description:
+// Gameplay recording without a hook tool: presented frames are read back
+// through frame_readback, converted to 4:2:0 YUV (IYUV or NV12) with the
+// yuv_convert kernels on the job system, and handed in order to an encoder
+// callback on the capture's own thread. The main thread only starts each
+// readback and queues the frame it gets back; conversion and encoding run
+// behind it.
+//
+// Frames are converted in parallel and can finish out of order, so the
+// encoder thread takes them strictly by index and waits for the next one.
+// At most `maxQueued` frames are between readback and encoder; a frame
+// that would exceed that is dropped and counted, the way image_writer
+// drops saves behind a slow disk, so a slow encoder costs frames, never
+// memory or frame rate.
+//
+// The encoder is pluggable. videoY4mOpen() writes a YUV4MPEG2 (.y4m)
+// stream that ffmpeg and most players read directly, and serves as the
+// example.
+// =============================================================================
+
+#ifndef VIDEO_CAPTURE_H
+#define VIDEO_CAPTURE_H
+
+#include <SDL2/SDL.h>
+#include <deque>
+#include <vector>
+
+#include "frame_readback.h"
+#include "job_system.h"
+#include "yuv_convert.h"
+
+// One converted frame, as the encoder sees it
+struct VideoEncodeFrame
+{
+     Uint32 format; // SDL_PIXELFORMAT_IYUV or SDL_PIXELFORMAT_NV12
+     int width, height;
+     const Uint8 *planes[3]; // Y, then U and V (IYUV) or interleaved UV (NV12, planes[2] null)
+     int pitches[3];
+     size_t size;   // All planes, contiguous from planes[0]
+     Uint64 index;  // 0, 1, 2... in capture order; gaps are dropped frames
+     Uint64 timeNs; // Since videoCaptureStart(), taken when the frame was requested
+};
+
+// Runs on the capture thread. `frame` is only valid during the call
+struct VideoEncoder
+{
+     bool (*encode)(void *userdata, const VideoEncodeFrame &frame);
+     void (*finish)(void *userdata); // After the last frame; may be null
+     void *userdata;
+};
+
+struct VideoCaptureFrame
+{
+     SDL_Surface *rgb; // Read back frame, until converted
+     std::vector<Uint8> rgb24;
+     std::vector<Uint8> yuv;
+     int width, height;
+     Uint64 index;
+     Uint64 timeNs;
+     bool converted; // Guarded by the capture's lock
+};
+
+struct VideoCapture
+{
+     FrameReadback *readback;
+     JobSystem *jobs; // May be null: the capture thread converts too
+     SurfacePool *surfaces;
+     VideoEncoder encoder;
+     Uint32 format;
+     SDL_YUV_CONVERSION_MODE mode;
+     YuvKernel kernel;
+     int maxQueued;
+     Uint64 startCounter;
+     Uint64 requested; // Frames asked for, the next index
+
+     SDL_Thread *thread;
+     SDL_mutex *lock;
+     SDL_cond *wake;
+     JobCounter conversions;
+
+     // Guarded by lock
+     std::deque<VideoCaptureFrame *> queue; // By index
+     std::vector<VideoCaptureFrame *> spare;
+     bool stopping;
+     int encoded;
+     int dropped;
+     int failed;
+};
+
+// Start a capture to `encoder` in `format` (IYUV or NV12). `readback`,
+// `surfaces` and `jobs` (which may be null) must outlive the capture.
+// False with SDL's error set
+bool videoCaptureStart(VideoCapture &capture, FrameReadback &readback, SurfacePool &surfaces, JobSystem *jobs,
+                       const VideoEncoder &encoder, Uint32 format = SDL_PIXELFORMAT_IYUV, int maxQueued = 8,
+                       SDL_YUV_CONVERSION_MODE mode = SDL_YUV_CONVERSION_BT709);
+
+// Capture the frame just drawn; after drawing and before SDL_RenderPresent,
+// like frameReadbackRequest(). False when the frame was dropped
+bool videoCaptureFrame(VideoCapture &capture);
+
+// Frames read back but not encoded yet
+int videoCapturePending(VideoCapture &capture);
+
+// Encode every frame already captured, call the encoder's finish and stop
+// the thread. Collects the readbacks still in flight first
+void videoCaptureStop(VideoCapture &capture);
+
+// A .y4m file of `fps` frames per second; frames must be IYUV. The size
+// is fixed by the first frame, as the format requires; later frames of
+// another size (the window was resized) are scaled to it, nearest sample
+struct VideoY4m
+{
+     SDL_RWops *file;
+     int fpsNumerator, fpsDenominator; // `fps` to a thousandth
+     bool headerWritten;
+     int width, height; // From the first frame
+     std::vector<Uint8> scaled;
+     int rescaled; // Frames scaled to fit
+};
+
+// `fps` is the rate frames are captured at, which is the present rate,
+// not the display's; measure it rather than assume 60 (framePacerGetStats)
+bool videoY4mOpen(VideoY4m &y4m, const char *path, double fps);
+
+// An encoder that writes to `y4m` and closes it in finish
+VideoEncoder videoY4mEncoder(VideoY4m &y4m);
+
+#endif // VIDEO_CAPTURE_H
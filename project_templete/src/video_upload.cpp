@@ -0,0 +1,126 @@
+#include "video_upload.h"
+
+#include <cstring>
+
+namespace
+{
+     // High byte of each 16-bit sample, rounded; P010 keeps its value in the top 10 bits
+     void narrowRow(const Uint8 *src, Uint8 *dst, int samples)
+     {
+          const Uint16 *in = (const Uint16 *)src;
+          for (int i = 0; i < samples; i++)
+          {
+               const Uint32 value = SDL_SwapLE16(in[i]) + 0x80u;
+               dst[i] = (Uint8)(value > 0xFFFFu ? 0xFF : value >> 8);
+          }
+     }
+
+     void copyPlane(const VideoFrame &frame, int plane, Uint8 *dst, int dstPitch, int rowSamples, int rows)
+     {
+          const Uint8 *src = frame.planes[plane];
+          for (int y = 0; y < rows; y++)
+          {
+               if (frame.format == VIDEO_FRAME_P010)
+               {
+                    narrowRow(src, dst, rowSamples);
+               }
+               else
+               {
+                    std::memcpy(dst, src, rowSamples);
+               }
+               src += frame.pitches[plane];
+               dst += dstPitch;
+          }
+     }
+}
+
+bool videoUploadNativeNV12(SDL_Renderer *renderer)
+{
+     SDL_RendererInfo info;
+     if (SDL_GetRendererInfo(renderer, &info) != 0)
+     {
+          return false;
+     }
+     for (Uint32 i = 0; i < info.num_texture_formats; i++)
+     {
+          if (info.texture_formats[i] == SDL_PIXELFORMAT_NV12)
+          {
+               return true;
+          }
+     }
+     return false;
+}
+
+bool videoUploadInit(VideoUpload &upload, SDL_Renderer *renderer, int width, int height, int slots)
+{
+     upload.width = width;
+     upload.height = height;
+     upload.nativeNV12 = videoUploadNativeNV12(renderer);
+     upload.framesUploaded = 0;
+     upload.framesDropped = 0;
+     upload.lockedY = nullptr;
+     return textureRingInit(upload.ring, renderer, SDL_PIXELFORMAT_NV12, width, height, slots);
+}
+
+bool videoUploadLock(VideoUpload &upload, Uint8 **yPlane, int *yPitch, Uint8 **uvPlane, int *uvPitch)
+{
+     void *pixels;
+     int pitch;
+     if (!textureRingLock(upload.ring, &pixels, &pitch))
+     {
+          upload.framesDropped++;
+          return false;
+     }
+     // SDL locks NV12 as one block: the Y plane, then the UV rows at the same pitch
+     upload.lockedY = (Uint8 *)pixels;
+     *yPlane = upload.lockedY;
+     *yPitch = pitch;
+     *uvPlane = upload.lockedY + (size_t)pitch * upload.height;
+     *uvPitch = pitch;
+     return true;
+}
+
+void videoUploadUnlock(VideoUpload &upload)
+{
+     if (upload.lockedY == nullptr)
+     {
+          return;
+     }
+     textureRingUnlock(upload.ring);
+     upload.lockedY = nullptr;
+     upload.framesUploaded++;
+}
+
+bool videoUploadFrame(VideoUpload &upload, const VideoFrame &frame)
+{
+     Uint8 *yPlane, *uvPlane;
+     int yPitch, uvPitch;
+     if (!videoUploadLock(upload, &yPlane, &yPitch, &uvPlane, &uvPitch))
+     {
+          return false;
+     }
+     const int chromaWidth = (upload.width + 1) / 2;
+     copyPlane(frame, 0, yPlane, yPitch, upload.width, upload.height);
+     copyPlane(frame, 1, uvPlane, uvPitch, chromaWidth * 2, (upload.height + 1) / 2);
+     videoUploadUnlock(upload);
+     return true;
+}
+
+SDL_Texture *videoUploadCurrent(VideoUpload &upload)
+{
+     return textureRingCurrent(upload.ring);
+}
+
+void videoUploadFrameEnd(VideoUpload &upload)
+{
+     textureRingFrameEnd(upload.ring);
+}
+
+void videoUploadDestroy(VideoUpload &upload)
+{
+     if (upload.lockedY != nullptr)
+     {
+          videoUploadUnlock(upload);
+     }
+     textureRingDestroy(upload.ring);
+}
@@ -0,0 +1,82 @@
+// Description:
+// Cutscene frame upload for decoders that produce NV12 (8-bit) or P010
+// (10-bit) frames. SDL_UpdateYUVTexture wants three planes, so an NV12
+// decoder first has to deinterleave its chroma into a scratch buffer, and
+// SDL then copies again into its own staging memory, two copies before the
+// driver's. A VideoUpload keeps NV12 streaming textures in a TextureRing,
+// which persist for the life of the video, and offers two paths:
+//
+// - videoUploadLock() hands out the locked texture's Y and UV planes, so a
+//   software decoder can write its output there directly: no copy at all
+//   on the CPU.
+// - videoUploadFrame() takes a decoder-owned NV12 or P010 frame and writes
+//   it into the locked texture in one pass. P010 is narrowed to 8 bits in
+//   that same pass; SDL 2 has no 10-bit YUV texture format.
+//
+// The ring's reuse rule means a lock never waits for the GPU to finish
+// with a texture; when every slot is still in flight the frame is dropped
+// and the previous one stays on screen. videoUploadFrameEnd() must be
+// called once per present.
+//
+// With renderers that do not list SDL_PIXELFORMAT_NV12 natively
+// (videoUploadNativeNV12), SDL converts to RGB on the CPU at unlock;
+// playback still works but the savings above are smaller.
+// =============================================================================
+
+#ifndef VIDEO_UPLOAD_H
+#define VIDEO_UPLOAD_H
+
+#include <SDL2/SDL.h>
+
+#include "texture_ring.h"
+
+enum VideoFrameFormat
+{
+     VIDEO_FRAME_NV12, // 8-bit Y plane, then interleaved 8-bit U/V at half resolution
+     VIDEO_FRAME_P010  // The same with 16-bit little-endian samples, value in the top 10 bits
+};
+
+// A decoded frame in decoder memory
+struct VideoFrame
+{
+     VideoFrameFormat format;
+     const Uint8 *planes[2]; // Y, then UV
+     int pitches[2];         // Bytes per row of each plane
+};
+
+struct VideoUpload
+{
+     TextureRing ring;
+     int width, height;
+     bool nativeNV12;     // The renderer samples NV12 textures directly
+     int framesUploaded;
+     int framesDropped;   // Every ring slot was still in flight
+     Uint8 *lockedY;      // While a videoUploadLock() is open
+};
+
+// Whether `renderer` lists NV12 among its texture formats
+bool videoUploadNativeNV12(SDL_Renderer *renderer);
+
+// A ring of `slots` width x height NV12 streaming textures; both even, as
+// 4:2:0 decoders output them
+bool videoUploadInit(VideoUpload &upload, SDL_Renderer *renderer, int width, int height, int slots = 3);
+
+// Lock the next free texture for a decoder to write into; false (and a
+// dropped frame) when none is free yet. Finish with videoUploadUnlock()
+bool videoUploadLock(VideoUpload &upload, Uint8 **yPlane, int *yPitch, Uint8 **uvPlane, int *uvPitch);
+
+void videoUploadUnlock(VideoUpload &upload);
+
+// Copy (and for P010 narrow) one decoder frame of the video's size into
+// the next free texture; false when it was dropped
+bool videoUploadFrame(VideoUpload &upload, const VideoFrame &frame);
+
+// The latest uploaded frame, or nullptr before the first
+SDL_Texture *videoUploadCurrent(VideoUpload &upload);
+
+// Call once per SDL_RenderPresent
+void videoUploadFrameEnd(VideoUpload &upload);
+
+void videoUploadDestroy(VideoUpload &upload);
+
+#endif // VIDEO_UPLOAD_H
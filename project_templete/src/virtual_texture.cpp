@@ -0,0 +1,282 @@
+#include "virtual_texture.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "render_record.h"
+
+namespace
+{
+     const Uint32 FREE_SLOT = ~0u;
+
+     Uint32 tileKey(int tileX, int tileY)
+     {
+          return (Uint32)tileY << 16 | (Uint32)tileX;
+     }
+
+     SDL_Rect tileBounds(const VirtualTexture &vt, Uint32 key)
+     {
+          const int x = (int)(key & 0xFFFF) * vt.tileSize;
+          const int y = (int)(key >> 16) * vt.tileSize;
+          return SDL_Rect{x, y, SDL_min(vt.tileSize, vt.width - x), SDL_min(vt.tileSize, vt.height - y)};
+     }
+
+     int SDLCALL decodeThreadMain(void *data)
+     {
+          VirtualTexture *vt = (VirtualTexture *)data;
+
+          SDL_LockMutex(vt->lock);
+          for (;;)
+          {
+               while (vt->pending.empty() && !vt->quitting)
+               {
+                    SDL_CondWait(vt->wake, vt->lock);
+               }
+               if (vt->quitting)
+               {
+                    break;
+               }
+               // Sorted by priority, highest last
+               VirtualTileRequest request = vt->pending.back();
+               vt->pending.pop_back();
+
+               // Decode without holding the lock so the main thread never waits on it
+               SDL_UnlockMutex(vt->lock);
+               DecodedTile tile;
+               tile.key = request.key;
+               const SDL_Rect bounds = tileBounds(*vt, request.key);
+               tile.width = bounds.w;
+               tile.height = bounds.h;
+               tile.pixels.resize((size_t)bounds.w * bounds.h);
+               bool decoded = ddsRegionDecode(vt->reader, bounds, tile.pixels.data(), bounds.w * 4,
+                                              SDL_PIXELFORMAT_ARGB8888);
+               SDL_LockMutex(vt->lock);
+
+               if (decoded)
+               {
+                    vt->finished.push_back(std::move(tile));
+               }
+               else
+               {
+                    vt->inFlight.erase(request.key);
+               }
+          }
+          SDL_UnlockMutex(vt->lock);
+          return 0;
+     }
+
+     // A free slot, else the least recently drawn one not drawn last frame
+     int claimSlot(VirtualTexture &vt)
+     {
+          int oldest = -1;
+          for (int i = 0; i < (int)vt.slots.size(); i++)
+          {
+               const VirtualTile &slot = vt.slots[i];
+               if (slot.key == FREE_SLOT)
+               {
+                    return i;
+               }
+               if (slot.lastUsed + 1 < vt.frame && (oldest < 0 || slot.lastUsed < vt.slots[oldest].lastUsed))
+               {
+                    oldest = i;
+               }
+          }
+          if (oldest >= 0)
+          {
+               vt.pageTable.erase(vt.slots[oldest].key);
+               vt.slots[oldest].key = FREE_SLOT;
+          }
+          return oldest;
+     }
+
+     SDL_Rect slotRect(const VirtualTexture &vt, int slot, int width, int height)
+     {
+          return SDL_Rect{(slot % vt.slotsPerSide) * vt.tileSize, (slot / vt.slotsPerSide) * vt.tileSize, width, height};
+     }
+}
+
+bool virtualTextureOpen(VirtualTexture &vt, SDL_Renderer *renderer, const char *path, int tileSize, int slotsPerSide)
+{
+     vt.renderer = renderer;
+     vt.physical = nullptr;
+     vt.worker = nullptr;
+     vt.lock = nullptr;
+     vt.wake = nullptr;
+     vt.quitting = false;
+     vt.frame = 2; // Eviction compares against the previous frame
+     vt.maxUploadsPerFrame = 4;
+     vt.tileSize = tileSize;
+     vt.slotsPerSide = slotsPerSide;
+     vt.reader.rw = nullptr;
+
+     if (!ddsRegionOpen(vt.reader, SDL_RWFromFile(path, "rb"), 1))
+     {
+          std::cerr << "Unable to open virtual texture " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     vt.width = vt.reader.width;
+     vt.height = vt.reader.height;
+     vt.tilesWide = (vt.width + tileSize - 1) / tileSize;
+     vt.tilesHigh = (vt.height + tileSize - 1) / tileSize;
+
+     vt.physical = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+                                     tileSize * slotsPerSide, tileSize * slotsPerSide);
+     if (vt.physical == nullptr)
+     {
+          std::cerr << "Unable to create virtual texture cache! SDL Error: " << SDL_GetError() << std::endl;
+          virtualTextureClose(vt);
+          return false;
+     }
+     renderRecordSetTextureBlendMode(vt.physical, SDL_BLENDMODE_BLEND);
+     SDL_SetTextureScaleMode(vt.physical, SDL_ScaleModeNearest);
+     vt.slots.assign((size_t)slotsPerSide * slotsPerSide, VirtualTile{FREE_SLOT, 0});
+
+     vt.lock = SDL_CreateMutex();
+     vt.wake = SDL_CreateCond();
+     if (vt.lock != nullptr && vt.wake != nullptr)
+     {
+          vt.worker = SDL_CreateThread(decodeThreadMain, "VirtualTexture", &vt);
+     }
+     if (vt.worker == nullptr)
+     {
+          std::cerr << "Unable to start virtual texture thread! SDL Error: " << SDL_GetError() << std::endl;
+          virtualTextureClose(vt);
+          return false;
+     }
+     return true;
+}
+
+void virtualTextureUpdate(VirtualTexture &vt)
+{
+     // Drop last frame's unstarted requests in favour of this frame's
+     std::sort(vt.wanted.begin(), vt.wanted.end(),
+               [](const VirtualTileRequest &a, const VirtualTileRequest &b) { return a.priority < b.priority; });
+     SDL_LockMutex(vt.lock);
+     for (DecodedTile &tile : vt.finished)
+     {
+          vt.ready.push_back(std::move(tile));
+     }
+     vt.finished.clear();
+     for (const VirtualTileRequest &request : vt.pending)
+     {
+          vt.inFlight.erase(request.key);
+     }
+     vt.pending.clear();
+     for (const VirtualTileRequest &request : vt.wanted)
+     {
+          if (vt.inFlight.insert(request.key).second)
+          {
+               vt.pending.push_back(request);
+          }
+     }
+     if (!vt.pending.empty())
+     {
+          SDL_CondSignal(vt.wake);
+     }
+     SDL_UnlockMutex(vt.lock);
+     vt.wanted.clear();
+
+     // Uploads are capped so a burst of arrivals cannot stall one frame
+     int uploads = 0;
+     size_t next = 0;
+     for (; next < vt.ready.size() && uploads < vt.maxUploadsPerFrame; next++)
+     {
+          DecodedTile &tile = vt.ready[next];
+          int slot = claimSlot(vt);
+          if (slot >= 0)
+          {
+               SDL_Rect dst = slotRect(vt, slot, tile.width, tile.height);
+               renderRecordUpdateTexture(vt.physical, &dst, tile.pixels.data(), tile.width * 4);
+               vt.slots[slot].key = tile.key;
+               vt.slots[slot].lastUsed = vt.frame;
+               vt.pageTable[tile.key] = slot;
+               uploads++;
+          }
+          // With every slot in use on screen the tile is dropped; it is requested again
+          SDL_LockMutex(vt.lock);
+          vt.inFlight.erase(tile.key);
+          SDL_UnlockMutex(vt.lock);
+     }
+     vt.ready.erase(vt.ready.begin(), vt.ready.begin() + next);
+     vt.frame++;
+}
+
+void virtualTextureDraw(VirtualTexture &vt, const SDL_Rect &view, const SDL_Rect &screen)
+{
+     const SDL_Rect image = {0, 0, vt.width, vt.height};
+     SDL_Rect visible;
+     if (vt.physical == nullptr || view.w <= 0 || view.h <= 0 || !SDL_IntersectRect(&view, &image, &visible))
+     {
+          return;
+     }
+     const float scaleX = (float)screen.w / view.w;
+     const float scaleY = (float)screen.h / view.h;
+
+     const int firstX = visible.x / vt.tileSize, lastX = (visible.x + visible.w - 1) / vt.tileSize;
+     const int firstY = visible.y / vt.tileSize, lastY = (visible.y + visible.h - 1) / vt.tileSize;
+     for (int ty = firstY; ty <= lastY; ty++)
+     {
+          for (int tx = firstX; tx <= lastX; tx++)
+          {
+               const Uint32 key = tileKey(tx, ty);
+               const SDL_Rect bounds = tileBounds(vt, key);
+               SDL_Rect part;
+               SDL_IntersectRect(&bounds, &visible, &part);
+
+               // Round both edges so neighbouring tiles meet without gaps
+               const int left = screen.x + (int)SDL_roundf((part.x - view.x) * scaleX);
+               const int top = screen.y + (int)SDL_roundf((part.y - view.y) * scaleY);
+               const int right = screen.x + (int)SDL_roundf((part.x + part.w - view.x) * scaleX);
+               const int bottom = screen.y + (int)SDL_roundf((part.y + part.h - view.y) * scaleY);
+               const SDL_Rect dst = {left, top, right - left, bottom - top};
+
+               auto found = vt.pageTable.find(key);
+               if (found == vt.pageTable.end())
+               {
+                    vt.wanted.push_back(VirtualTileRequest{key, (float)dst.w * dst.h});
+                    continue;
+               }
+               VirtualTile &slot = vt.slots[found->second];
+               slot.lastUsed = vt.frame;
+               SDL_Rect src = slotRect(vt, found->second, part.w, part.h);
+               src.x += part.x - bounds.x;
+               src.y += part.y - bounds.y;
+               renderRecordCopy(vt.renderer, vt.physical, &src, &dst);
+          }
+     }
+}
+
+int virtualTextureResidentCount(const VirtualTexture &vt)
+{
+     return (int)vt.pageTable.size();
+}
+
+void virtualTextureClose(VirtualTexture &vt)
+{
+     if (vt.worker != nullptr)
+     {
+          SDL_LockMutex(vt.lock);
+          vt.quitting = true;
+          SDL_CondBroadcast(vt.wake);
+          SDL_UnlockMutex(vt.lock);
+          SDL_WaitThread(vt.worker, NULL);
+          vt.worker = nullptr;
+     }
+     SDL_DestroyCond(vt.wake);
+     SDL_DestroyMutex(vt.lock);
+     vt.wake = nullptr;
+     vt.lock = nullptr;
+     ddsRegionClose(vt.reader);
+     if (vt.physical != nullptr)
+     {
+          renderRecordDestroyTexture(vt.physical);
+          vt.physical = nullptr;
+     }
+     vt.slots.clear();
+     vt.pageTable.clear();
+     vt.wanted.clear();
+     vt.ready.clear();
+     vt.pending.clear();
+     vt.finished.clear();
+     vt.inFlight.clear();
+}
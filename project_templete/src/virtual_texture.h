@@ -0,0 +1,94 @@
+// Description:
+// Sparse virtual texturing on SDL_Renderer. A huge DDS image (up to
+// 16384x16384) is split into square tiles; only the tiles the camera needs
+// are decoded, with ddsRegionDecode() on a background thread, and kept in
+// one fixed-size physical texture of tile slots. A page table maps tile ->
+// slot, and when every slot is taken the least recently drawn tile is
+// evicted, so VRAM and decode memory stay at the physical texture's size
+// however big the image is.
+//
+// Per frame:
+//     virtualTextureUpdate(vt);              // upload decoded tiles
+//     virtualTextureDraw(vt, view, screen);  // draw + request missing tiles
+//
+// Missing tiles are requested with their on-screen area as priority and
+// the request list is replaced every update, so tiles that scrolled away
+// before being decoded are dropped. Until a tile arrives its area is left
+// undrawn (there are no mip levels to fall back to). The physical texture
+// samples with nearest filtering since the tiles have no border texels.
+// =============================================================================
+
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include <SDL2/SDL.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "dds_image.h"
+
+struct VirtualTile
+{
+     Uint32 key;      // tileY << 16 | tileX, ~0u when the slot is free
+     Uint32 lastUsed; // Frame the tile was last drawn
+};
+
+struct VirtualTileRequest
+{
+     Uint32 key;
+     float priority; // On-screen area in pixels
+};
+
+struct DecodedTile
+{
+     Uint32 key;
+     std::vector<Uint32> pixels; // ARGB8888, tileSize x tileSize, cropped at the image edge
+     int width, height;
+};
+
+struct VirtualTexture
+{
+     SDL_Renderer *renderer;
+     int width, height; // Of the whole image
+     int tileSize;
+     int tilesWide, tilesHigh;
+
+     SDL_Texture *physical;
+     int slotsPerSide;
+     std::vector<VirtualTile> slots;
+     std::unordered_map<Uint32, int> pageTable; // Tile key -> slot
+     Uint32 frame;
+     int maxUploadsPerFrame;
+
+     std::vector<VirtualTileRequest> wanted; // Missing tiles drawn this frame
+     std::vector<DecodedTile> ready;         // Decoded, waiting for an upload slot
+
+     // Shared with the decode thread, guarded by lock
+     SDL_Thread *worker;
+     SDL_mutex *lock;
+     SDL_cond *wake;
+     bool quitting;
+     std::vector<VirtualTileRequest> pending;
+     std::vector<DecodedTile> finished;
+     std::unordered_set<Uint32> inFlight; // Pending, decoding or finished
+     DdsRegionReader reader;              // Decode thread only
+};
+
+// Open `path` with a physical texture of slotsPerSide^2 tiles. Fails for
+// anything ddsRegionOpen() cannot read.
+bool virtualTextureOpen(VirtualTexture &vt, SDL_Renderer *renderer, const char *path, int tileSize, int slotsPerSide);
+
+// Upload up to maxUploadsPerFrame decoded tiles, evicting the least recently
+// drawn ones, and hand the tiles drawn last frame to the decode thread
+void virtualTextureUpdate(VirtualTexture &vt);
+
+// Draw the `view` rect of the image (in image pixels) into `screen`
+void virtualTextureDraw(VirtualTexture &vt, const SDL_Rect &view, const SDL_Rect &screen);
+
+// Tiles currently resident in the physical texture
+int virtualTextureResidentCount(const VirtualTexture &vt);
+
+void virtualTextureClose(VirtualTexture &vt);
+
+#endif // VIRTUAL_TEXTURE_H
@@ -0,0 +1,232 @@
+#include "voice_capture.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+     int ringUsed(const VoiceCapture &capture)
+     {
+          // Unsigned so the positions may wrap around
+          return (int)((unsigned)SDL_AtomicGet((SDL_atomic_t *)&capture.writePos) -
+                       (unsigned)SDL_AtomicGet((SDL_atomic_t *)&capture.readPos));
+     }
+
+     // Audio callback: runs on the capture thread and only copies
+     void captured(void *userdata, Uint8 *in, int len)
+     {
+          VoiceCapture &capture = *(VoiceCapture *)userdata;
+          int writePos = SDL_AtomicGet(&capture.writePos);
+          int space = (int)capture.ring.size() - ringUsed(capture);
+          SDL_MemoryBarrierAcquire();
+
+          int bytes = SDL_min(space, len);
+          bytes -= bytes % capture.frameBytes;
+          int offset = writePos & capture.ringMask;
+          int first = SDL_min(bytes, (int)capture.ring.size() - offset);
+          std::memcpy(&capture.ring[offset], in, first);
+          std::memcpy(&capture.ring[0], in + first, bytes - first);
+
+          SDL_MemoryBarrierRelease();
+          SDL_AtomicSet(&capture.writePos, (int)((unsigned)writePos + (unsigned)bytes));
+          SDL_AtomicSet(&capture.lastWriteTicks, (int)(Uint32)SDL_GetPerformanceCounter());
+          SDL_SemPost(capture.wake);
+
+          if (bytes < len)
+          {
+               SDL_AtomicIncRef(&capture.overruns);
+               SDL_AtomicAdd(&capture.droppedFrames, (len - bytes) / capture.frameBytes);
+          }
+     }
+
+     // Hand the oldest whole packet to the sink; false when there is none
+     bool consumePacket(VoiceCapture &capture)
+     {
+          const int packetBytes = capture.packetFrames * capture.frameBytes;
+          if (ringUsed(capture) < packetBytes)
+          {
+               return false;
+          }
+          SDL_MemoryBarrierAcquire();
+          const int readPos = SDL_AtomicGet(&capture.readPos);
+          const int offset = readPos & capture.ringMask;
+          const int first = SDL_min(packetBytes, (int)capture.ring.size() - offset);
+          Uint8 *packet = (Uint8 *)capture.packet.data();
+          std::memcpy(packet, &capture.ring[offset], first);
+          std::memcpy(packet + first, &capture.ring[0], packetBytes - first);
+
+          // The packet's last sample was captured as long ago as the audio
+          // written after it lasts, plus the time since that write
+          const Uint64 frequency = SDL_GetPerformanceFrequency();
+          const Uint32 sinceWrite = (Uint32)SDL_GetPerformanceCounter() - (Uint32)SDL_AtomicGet(&capture.lastWriteTicks);
+          const int newerFrames = (ringUsed(capture) - packetBytes) / capture.frameBytes;
+          const Uint64 queueTicks = sinceWrite + frequency * newerFrames / capture.spec.freq;
+
+          SDL_MemoryBarrierRelease();
+          SDL_AtomicSet(&capture.readPos, (int)((unsigned)readPos + (unsigned)packetBytes));
+
+          const Uint64 start = SDL_GetPerformanceCounter();
+          const bool sent = capture.sink(capture.userdata, capture.packet.data(), capture.packetFrames,
+                                         capture.spec.channels);
+          const Uint64 sinkTicks = SDL_GetPerformanceCounter() - start;
+
+          SDL_AtomicLock(&capture.statsLock);
+          capture.packets++;
+          capture.queueTotalTicks += queueTicks;
+          capture.queueMaxTicks = SDL_max(capture.queueMaxTicks, queueTicks);
+          capture.sinkTotalTicks += sinkTicks;
+          capture.sinkMaxTicks = SDL_max(capture.sinkMaxTicks, sinkTicks);
+          if (sinkTicks * capture.spec.freq > frequency * capture.packetFrames)
+          {
+               capture.latePackets++;
+          }
+          if (!sent)
+          {
+               capture.sinkFailures++;
+          }
+          SDL_AtomicUnlock(&capture.statsLock);
+          return true;
+     }
+
+     int consumeThread(void *data)
+     {
+          VoiceCapture &capture = *(VoiceCapture *)data;
+          while (!SDL_AtomicGet(&capture.quitting))
+          {
+               SDL_SemWaitTimeout(capture.wake, 100);
+               while (consumePacket(capture))
+               {
+               }
+          }
+          // The device is closed by now; send what it delivered
+          while (consumePacket(capture))
+          {
+          }
+          return 0;
+     }
+
+     double ticksToMs(Uint64 ticks)
+     {
+          return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+     }
+}
+
+VoiceCaptureConfig voiceCaptureDefaultConfig()
+{
+     VoiceCaptureConfig config;
+     config.device = nullptr;
+     config.frequency = 48000;
+     config.channels = 1;
+     config.packetMs = 20;
+     config.bufferMs = 500;
+     return config;
+}
+
+bool voiceCaptureStart(VoiceCapture &capture, const VoiceCaptureConfig &config, VoiceCaptureSink sink, void *userdata)
+{
+     capture.device = 0;
+     capture.thread = nullptr;
+     capture.wake = nullptr;
+     capture.sink = sink;
+     capture.userdata = userdata;
+     SDL_AtomicSet(&capture.readPos, 0);
+     SDL_AtomicSet(&capture.writePos, 0);
+     SDL_AtomicSet(&capture.lastWriteTicks, 0);
+     SDL_AtomicSet(&capture.quitting, 0);
+     SDL_AtomicSet(&capture.droppedFrames, 0);
+     SDL_AtomicSet(&capture.overruns, 0);
+     capture.statsLock = 0;
+     capture.queueTotalTicks = 0;
+     capture.queueMaxTicks = 0;
+     capture.sinkTotalTicks = 0;
+     capture.sinkMaxTicks = 0;
+     capture.packets = 0;
+     capture.latePackets = 0;
+     capture.sinkFailures = 0;
+
+     // Small device buffers, so audio reaches the ring soon after it is spoken
+     SDL_AudioSpec desired;
+     SDL_zero(desired);
+     desired.freq = config.frequency;
+     desired.format = AUDIO_S16SYS;
+     desired.channels = (Uint8)config.channels;
+     desired.samples = 256;
+     desired.callback = captured;
+     desired.userdata = &capture;
+     capture.device = SDL_OpenAudioDevice(config.device, 1, &desired, &capture.spec, 0);
+     if (capture.device == 0)
+     {
+          std::cerr << "Unable to open capture device! SDL Error: " << SDL_GetError() << std::endl;
+          return false;
+     }
+     capture.frameBytes = (int)sizeof(Sint16) * capture.spec.channels;
+     capture.packetFrames = SDL_max(capture.spec.freq * config.packetMs / 1000, 1);
+     capture.packet.assign((size_t)capture.packetFrames * capture.spec.channels, 0);
+
+     // Round the ring up to a power of two so positions can be masked
+     int bytes = SDL_max(capture.spec.freq * config.bufferMs / 1000 * capture.frameBytes,
+                         2 * capture.packetFrames * capture.frameBytes);
+     int size = 1;
+     while (size < bytes)
+     {
+          size <<= 1;
+     }
+     capture.ring.assign(size, 0);
+     capture.ringMask = size - 1;
+
+     capture.wake = SDL_CreateSemaphore(0);
+     if (capture.wake != nullptr)
+     {
+          capture.thread = SDL_CreateThread(consumeThread, "voice capture", &capture);
+     }
+     if (capture.thread == nullptr)
+     {
+          std::cerr << "Unable to start voice capture thread! SDL Error: " << SDL_GetError() << std::endl;
+          SDL_CloseAudioDevice(capture.device);
+          capture.device = 0;
+          if (capture.wake != nullptr)
+          {
+               SDL_DestroySemaphore(capture.wake);
+               capture.wake = nullptr;
+          }
+          return false;
+     }
+     SDL_PauseAudioDevice(capture.device, 0);
+     return true;
+}
+
+void voiceCaptureStop(VoiceCapture &capture)
+{
+     if (capture.device == 0)
+     {
+          return;
+     }
+     // Closing waits for the callback, so nothing writes the ring afterwards
+     SDL_CloseAudioDevice(capture.device);
+     capture.device = 0;
+     SDL_AtomicSet(&capture.quitting, 1);
+     SDL_SemPost(capture.wake);
+     SDL_WaitThread(capture.thread, NULL);
+     capture.thread = nullptr;
+     SDL_DestroySemaphore(capture.wake);
+     capture.wake = nullptr;
+}
+
+VoiceCaptureStats voiceCaptureGetStats(const VoiceCapture &capture)
+{
+     VoiceCaptureStats stats;
+     stats.deviceMs = capture.spec.freq > 0 ? capture.spec.samples * 1000.0 / capture.spec.freq : 0.0;
+     stats.droppedFrames = SDL_AtomicGet((SDL_atomic_t *)&capture.droppedFrames);
+     stats.overruns = SDL_AtomicGet((SDL_atomic_t *)&capture.overruns);
+
+     SDL_AtomicLock((SDL_SpinLock *)&capture.statsLock);
+     stats.packets = capture.packets;
+     stats.latePackets = capture.latePackets;
+     stats.sinkFailures = capture.sinkFailures;
+     stats.queueAverageMs = capture.packets > 0 ? ticksToMs(capture.queueTotalTicks) / capture.packets : 0.0;
+     stats.queueMaxMs = ticksToMs(capture.queueMaxTicks);
+     stats.sinkAverageMs = capture.packets > 0 ? ticksToMs(capture.sinkTotalTicks) / capture.packets : 0.0;
+     stats.sinkMaxMs = ticksToMs(capture.sinkMaxTicks);
+     SDL_AtomicUnlock((SDL_SpinLock *)&capture.statsLock);
+     return stats;
+}
@@ -0,0 +1,99 @@
+// Description:
+// Streaming microphone capture for voice chat. The capture callback of an
+// SDL_OpenAudioDevice(iscapture) device only copies into a lock-free
+// single-producer/single-consumer ring; a consumer thread cuts the ring
+// into fixed-size packets (20 ms by default, an Opus frame) and hands each
+// to a sink that encodes and sends it. Nothing on the audio thread blocks,
+// allocates or waits on the network.
+//
+// Each stage is measured: the device's own buffering, the time a packet
+// waits in the ring before the consumer takes it, and the time the sink
+// spends on it. Dropouts are counted where they happen: capture audio
+// lost because the ring was full, packets the sink took longer than real
+// time to handle, and packets the sink rejected.
+// =============================================================================
+
+#ifndef VOICE_CAPTURE_H
+#define VOICE_CAPTURE_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#define VOICE_CAPTURE_HINT "CATCH_VOICE_CAPTURE"
+
+// Encode and send one packet of interleaved S16 audio, on the consumer
+// thread. False counts the packet as a sink failure.
+typedef bool (*VoiceCaptureSink)(void *userdata, const Sint16 *samples, int frames, int channels);
+
+struct VoiceCaptureConfig
+{
+     const char *device; // nullptr for the default microphone
+     int frequency;
+     int channels;
+     int packetMs; // Audio per sink call
+     int bufferMs; // Ring depth; capture drops audio beyond it
+};
+
+struct VoiceCaptureStats
+{
+     double deviceMs;       // Buffering in the capture device
+     double queueAverageMs; // Packet end to consumer pickup
+     double queueMaxMs;
+     double sinkAverageMs;  // Encode and send, per packet
+     double sinkMaxMs;
+     int packets;
+     int droppedFrames; // Captured while the ring was full
+     int overruns;      // Callbacks that had to drop audio
+     int latePackets;   // Sink took longer than the packet lasts
+     int sinkFailures;
+};
+
+struct VoiceCapture
+{
+     SDL_AudioDeviceID device;
+     SDL_AudioSpec spec;
+     int frameBytes;
+     int packetFrames;
+
+     // Ring buffer: positions count bytes monotonically and are masked
+     std::vector<Uint8> ring;
+     int ringMask;
+     SDL_atomic_t readPos;
+     SDL_atomic_t writePos;
+     SDL_atomic_t lastWriteTicks; // Low 32 bits of the counter at the last callback
+
+     VoiceCaptureSink sink;
+     void *userdata;
+     SDL_Thread *thread;
+     SDL_sem *wake; // Posted by the callback after every write
+     SDL_atomic_t quitting;
+
+     // Consumer thread stage timings, in counter ticks
+     std::vector<Sint16> packet;
+     SDL_SpinLock statsLock;
+     Uint64 queueTotalTicks;
+     Uint64 queueMaxTicks;
+     Uint64 sinkTotalTicks;
+     Uint64 sinkMaxTicks;
+     int packets;
+     int latePackets;
+     int sinkFailures;
+
+     // Written by the audio callback only
+     SDL_atomic_t droppedFrames;
+     SDL_atomic_t overruns;
+};
+
+VoiceCaptureConfig voiceCaptureDefaultConfig();
+
+// Open the capture device and start the consumer thread
+bool voiceCaptureStart(VoiceCapture &capture, const VoiceCaptureConfig &config, VoiceCaptureSink sink, void *userdata);
+
+// Close the device, then drain the packets already captured and stop the
+// consumer thread
+void voiceCaptureStop(VoiceCapture &capture);
+
+// Safe to call from any thread while capturing
+VoiceCaptureStats voiceCaptureGetStats(const VoiceCapture &capture);
+
+#endif // VOICE_CAPTURE_H
@@ -0,0 +1,191 @@
+#include "voice_manager.h"
+
+#include <iostream>
+
+namespace
+{
+     // Channels tagged with this are idle or not yet used by the manager
+     const int IDLE_TAG = -1;
+
+     int groupTag(const VoiceManager &manager, int priority)
+     {
+          // Offset the tags so they cannot collide with groups the game
+          // sets up for its own unmanaged channels
+          return 0x5600 + manager.firstChannel * VOICE_PRIORITY_LEVELS + priority;
+     }
+
+     int audibleVolume(int volume, Uint8 distance)
+     {
+          // Mix_SetDistance attenuates linearly to silence at 255
+          return volume * (255 - distance) / 255;
+     }
+
+     int findFree(const VoiceManager &manager)
+     {
+          for (int i = 0; i < manager.activeCount; i++)
+          {
+               if (!Mix_Playing(manager.firstChannel + i))
+               {
+                    return manager.firstChannel + i;
+               }
+          }
+          return -1;
+     }
+
+     // Pick a channel to take over from the lowest priority that is at or
+     // below `priority`, following `policy`
+     int findVictim(const VoiceManager &manager, int priority, VoiceStealPolicy policy)
+     {
+          for (int level = 0; level <= priority; level++)
+          {
+               int tag = groupTag(manager, level);
+               int victim = -1;
+               switch (policy)
+               {
+               case VOICE_STEAL_OLDEST:
+                    victim = Mix_GroupOldest(tag);
+                    break;
+               case VOICE_STEAL_NEWEST:
+                    victim = Mix_GroupNewer(tag);
+                    break;
+               case VOICE_STEAL_QUIETEST:
+               {
+                    int quietestVolume = MIX_MAX_VOLUME + 1;
+                    for (int i = 0; i < manager.activeCount; i++)
+                    {
+                         const ManagedChannel &channel = manager.channels[i];
+                         int id = manager.firstChannel + i;
+                         if (channel.priority == level && Mix_Playing(id) && channel.audibleVolume < quietestVolume)
+                         {
+                              victim = id;
+                              quietestVolume = channel.audibleVolume;
+                         }
+                    }
+                    break;
+               }
+               default:
+                    return -1;
+               }
+               // Both group queries only consider channels still playing
+               if (victim >= 0)
+               {
+                    return victim;
+               }
+          }
+          return -1;
+     }
+}
+
+void voiceManagerInit(VoiceManager &manager, int firstChannel, int count, int cullVolume)
+{
+     if (Mix_AllocateChannels(-1) < firstChannel + count)
+     {
+          Mix_AllocateChannels(firstChannel + count);
+     }
+     manager.firstChannel = firstChannel;
+     manager.channelCount = count;
+     manager.activeCount = count;
+     manager.cullVolume = cullVolume;
+     manager.channels.assign(count, ManagedChannel{0, 0});
+     SDL_zero(manager.stats);
+     for (int i = 0; i < count; i++)
+     {
+          Mix_GroupChannel(firstChannel + i, IDLE_TAG);
+     }
+}
+
+SoundRequest soundRequestDefaults(const Mix_Chunk *chunk)
+{
+     SoundRequest request;
+     request.chunk = chunk;
+     request.priority = 0;
+     request.volume = MIX_MAX_VOLUME;
+     request.distance = 0;
+     request.loops = 0;
+     request.policy = VOICE_STEAL_OLDEST;
+     return request;
+}
+
+int voiceManagerPlay(VoiceManager &manager, const SoundRequest &request)
+{
+     int priority = SDL_clamp(request.priority, 0, VOICE_PRIORITY_LEVELS - 1);
+     int audible = audibleVolume(request.volume, request.distance);
+     if (audible < manager.cullVolume)
+     {
+          manager.stats.culled++;
+          return -1;
+     }
+
+     int channel = findFree(manager);
+     bool stolen = false;
+     if (channel < 0)
+     {
+          channel = findVictim(manager, priority, request.policy);
+          stolen = channel >= 0;
+     }
+     if (channel < 0)
+     {
+          manager.stats.dropped++;
+          return -1;
+     }
+
+     if (stolen)
+     {
+          Mix_HaltChannel(channel);
+     }
+     Mix_Volume(channel, request.volume);
+     Mix_SetDistance(channel, request.distance);
+     if (Mix_PlayChannel(channel, (Mix_Chunk *)request.chunk, request.loops) < 0)
+     {
+          std::cerr << "Unable to play sound! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          Mix_GroupChannel(channel, IDLE_TAG);
+          manager.stats.dropped++;
+          return -1;
+     }
+
+     Mix_GroupChannel(channel, groupTag(manager, priority));
+     ManagedChannel &managed = manager.channels[channel - manager.firstChannel];
+     managed.priority = priority;
+     managed.audibleVolume = audible;
+     manager.stats.played++;
+     if (stolen)
+     {
+          manager.stats.stolen++;
+     }
+     return channel;
+}
+
+void voiceManagerSetDistance(VoiceManager &manager, int channel, Uint8 distance)
+{
+     int index = channel - manager.firstChannel;
+     if (index < 0 || index >= manager.channelCount)
+     {
+          return;
+     }
+     Mix_SetDistance(channel, distance);
+     manager.channels[index].audibleVolume = audibleVolume(Mix_Volume(channel, -1), distance);
+}
+
+void voiceManagerSetLimit(VoiceManager &manager, int count, int fadeMs)
+{
+     manager.activeCount = count > 0 ? SDL_min(count, manager.channelCount) : manager.channelCount;
+     for (int i = manager.activeCount; i < manager.channelCount; i++)
+     {
+          // Out of the priority groups, so the steal queries never pick it
+          const int channel = manager.firstChannel + i;
+          Mix_GroupChannel(channel, IDLE_TAG);
+          if (Mix_Playing(channel) && Mix_FadingChannel(channel) != MIX_FADING_OUT)
+          {
+               Mix_FadeOutChannel(channel, fadeMs);
+          }
+     }
+}
+
+void voiceManagerHaltAll(VoiceManager &manager)
+{
+     for (int i = 0; i < manager.channelCount; i++)
+     {
+          Mix_HaltChannel(manager.firstChannel + i);
+          Mix_GroupChannel(manager.firstChannel + i, IDLE_TAG);
+     }
+}
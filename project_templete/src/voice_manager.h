@@ -0,0 +1,90 @@
+// Description:
+// Priority scheduling for SDL_mixer channels. Mix_PlayChannel simply fails
+// once every channel is busy; the voice manager instead culls sounds too
+// quiet to hear before they take a channel and, when all channels are in
+// use, steals one from a sound of equal or lower priority.
+//
+// Each playing channel is grouped (Mix_GroupChannel) under its sound's
+// priority, so the steal-oldest and steal-newest policies are direct
+// Mix_GroupOldest / Mix_GroupNewer queries on the lowest priority group.
+// Steal-quietest compares each candidate's volume after Mix_SetDistance
+// attenuation.
+//
+// voiceManagerSetLimit() plays new sounds on only the first channels of
+// the range, so fewer voices are mixed at once (the power governor's
+// save profile); sounds on the channels above fade out.
+// =============================================================================
+
+#ifndef VOICE_MANAGER_H
+#define VOICE_MANAGER_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <vector>
+
+const int VOICE_PRIORITY_LEVELS = 8; // Priorities 0 (ambient) .. 7 (critical)
+
+enum VoiceStealPolicy
+{
+     VOICE_STEAL_NONE,     // Drop the new sound when no channel is free
+     VOICE_STEAL_OLDEST,   // Replace the longest-playing candidate
+     VOICE_STEAL_NEWEST,   // Replace the most recently started candidate
+     VOICE_STEAL_QUIETEST  // Replace the candidate with the lowest audible volume
+};
+
+struct SoundRequest
+{
+     const Mix_Chunk *chunk;
+     int priority;     // 0..VOICE_PRIORITY_LEVELS-1
+     int volume;       // 0..MIX_MAX_VOLUME
+     Uint8 distance;   // As Mix_SetDistance: 0 is near, 255 is far
+     int loops;        // As Mix_PlayChannel
+     VoiceStealPolicy policy;
+};
+
+struct ManagedChannel
+{
+     int priority;
+     int audibleVolume; // Volume scaled by distance, the steal-quietest key
+};
+
+struct VoiceManagerStats
+{
+     int played;
+     int stolen;  // Started by taking over a busy channel
+     int culled;  // Too quiet to be worth a channel
+     int dropped; // No free channel and nothing to steal
+};
+
+struct VoiceManager
+{
+     int firstChannel;
+     int channelCount;
+     int activeCount; // Channels new sounds may use, from voiceManagerSetLimit
+     int cullVolume; // Audible volume below which requests are culled
+     std::vector<ManagedChannel> channels;
+     VoiceManagerStats stats;
+};
+
+// Manage mixer channels [firstChannel, firstChannel + count), allocating
+// them if needed. Untouched channels outside the range keep working as usual.
+void voiceManagerInit(VoiceManager &manager, int firstChannel, int count, int cullVolume);
+
+SoundRequest soundRequestDefaults(const Mix_Chunk *chunk);
+
+// Returns the mixer channel the sound plays on, or -1 if it was culled or
+// dropped
+int voiceManagerPlay(VoiceManager &manager, const SoundRequest &request);
+
+// Move a playing sound (e.g. an emitter that moved); leaves the channel
+// playing even if it becomes inaudible
+void voiceManagerSetDistance(VoiceManager &manager, int channel, Uint8 distance);
+
+// Use at most `count` of the managed channels, all of them when `count`
+// is 0 or larger than the range. Sounds above the limit fade out over
+// `fadeMs`.
+void voiceManagerSetLimit(VoiceManager &manager, int count, int fadeMs = 250);
+
+void voiceManagerHaltAll(VoiceManager &manager);
+
+#endif // VOICE_MANAGER_H
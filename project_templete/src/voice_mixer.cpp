@@ -0,0 +1,443 @@
+#include "voice_mixer.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define VOICE_MIXER_X86 1
+#include <emmintrin.h>
+#if defined(__GNUC__) && !defined(__EMSCRIPTEN__)
+#define VOICE_MIXER_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VOICE_MIXER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+     // Frames mixed per accumulator pass; larger callbacks take several
+     const int ACCUM_FRAMES = 4096;
+
+     enum VoiceState
+     {
+          VOICE_FREE,     // Game thread may fill in pending fields
+          VOICE_STARTING, // Pending fields published, audio thread picks up
+          VOICE_PLAYING,
+          VOICE_HALTING   // Game thread asked to stop
+     };
+
+     // --- Scalar kernels ---
+
+     void mixScalar(float *accum, const Sint16 *source, int frames, float left, float right)
+     {
+          for (int i = 0; i < frames; i++)
+          {
+               accum[2 * i] += source[2 * i] * left;
+               accum[2 * i + 1] += source[2 * i + 1] * right;
+          }
+     }
+
+     void resolveScalar(Sint16 *out, const float *accum, int samples)
+     {
+          for (int i = 0; i < samples; i++)
+          {
+               int value = out[i] + (int)accum[i];
+               out[i] = (Sint16)SDL_clamp(value, -32768, 32767);
+          }
+     }
+
+#ifdef VOICE_MIXER_X86
+     // --- SSE2: 4 frames per step ---
+
+     void mixSse2(float *accum, const Sint16 *source, int frames, float left, float right)
+     {
+          const __m128 gain = _mm_setr_ps(left, right, left, right);
+          int i = 0;
+          for (; i + 4 <= frames; i += 4)
+          {
+               __m128i pcm = _mm_loadu_si128((const __m128i *)(source + 2 * i));
+               // Sign-extend by unpacking into the high half and shifting down
+               __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(pcm, pcm), 16));
+               __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(pcm, pcm), 16));
+               float *dst = accum + 2 * i;
+               _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_mul_ps(lo, gain)));
+               _mm_storeu_ps(dst + 4, _mm_add_ps(_mm_loadu_ps(dst + 4), _mm_mul_ps(hi, gain)));
+          }
+          mixScalar(accum + 2 * i, source + 2 * i, frames - i, left, right);
+     }
+
+     void resolveSse2(Sint16 *out, const float *accum, int samples)
+     {
+          int i = 0;
+          for (; i + 8 <= samples; i += 8)
+          {
+               __m128i pcm = _mm_loadu_si128((const __m128i *)(out + i));
+               __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(pcm, pcm), 16);
+               __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(pcm, pcm), 16);
+               lo = _mm_add_epi32(lo, _mm_cvttps_epi32(_mm_loadu_ps(accum + i)));
+               hi = _mm_add_epi32(hi, _mm_cvttps_epi32(_mm_loadu_ps(accum + i + 4)));
+               _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(lo, hi));
+          }
+          resolveScalar(out + i, accum + i, samples - i);
+     }
+#endif
+
+#ifdef VOICE_MIXER_AVX2
+     // --- AVX2: 8 frames per step, compiled for AVX2 regardless of -m flags ---
+
+     __attribute__((target("avx2"))) void mixAvx2(float *accum, const Sint16 *source, int frames, float left,
+                                                  float right)
+     {
+          const __m256 gain = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+          int i = 0;
+          for (; i + 8 <= frames; i += 8)
+          {
+               __m128i a = _mm_loadu_si128((const __m128i *)(source + 2 * i));
+               __m128i b = _mm_loadu_si128((const __m128i *)(source + 2 * i + 8));
+               float *dst = accum + 2 * i;
+               __m256 fa = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a));
+               __m256 fb = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b));
+               _mm256_storeu_ps(dst, _mm256_add_ps(_mm256_loadu_ps(dst), _mm256_mul_ps(fa, gain)));
+               _mm256_storeu_ps(dst + 8, _mm256_add_ps(_mm256_loadu_ps(dst + 8), _mm256_mul_ps(fb, gain)));
+          }
+          mixScalar(accum + 2 * i, source + 2 * i, frames - i, left, right);
+     }
+#endif
+
+#ifdef VOICE_MIXER_NEON
+     // --- NEON: 4 frames per step ---
+
+     void mixNeon(float *accum, const Sint16 *source, int frames, float left, float right)
+     {
+          const float gains[4] = {left, right, left, right};
+          const float32x4_t gain = vld1q_f32(gains);
+          int i = 0;
+          for (; i + 4 <= frames; i += 4)
+          {
+               int16x8_t pcm = vld1q_s16(source + 2 * i);
+               float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(pcm)));
+               float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(pcm)));
+               float *dst = accum + 2 * i;
+               vst1q_f32(dst, vmlaq_f32(vld1q_f32(dst), lo, gain));
+               vst1q_f32(dst + 4, vmlaq_f32(vld1q_f32(dst + 4), hi, gain));
+          }
+          mixScalar(accum + 2 * i, source + 2 * i, frames - i, left, right);
+     }
+
+     void resolveNeon(Sint16 *out, const float *accum, int samples)
+     {
+          int i = 0;
+          for (; i + 8 <= samples; i += 8)
+          {
+               int16x8_t pcm = vld1q_s16(out + i);
+               int32x4_t lo = vaddq_s32(vmovl_s16(vget_low_s16(pcm)), vcvtq_s32_f32(vld1q_f32(accum + i)));
+               int32x4_t hi = vaddq_s32(vmovl_s16(vget_high_s16(pcm)), vcvtq_s32_f32(vld1q_f32(accum + i + 4)));
+               vst1q_s16(out + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+          }
+          resolveScalar(out + i, accum + i, samples - i);
+     }
+#endif
+
+     void postMix(void *userdata, Uint8 *stream, int len)
+     {
+          voiceMixerRender(*(VoiceMixer *)userdata, (Sint16 *)stream, len / 4);
+     }
+
+     // Hand a voice's pending chunk to the audio thread's fields. Returns
+     // false when the voice has nothing (left) to play.
+     bool claimVoice(Voice &voice)
+     {
+          int state = SDL_AtomicGet(&voice.state);
+          if (state == VOICE_STARTING)
+          {
+               SDL_MemoryBarrierAcquire();
+               voice.chunk = voice.pendingChunk;
+               voice.loops = voice.pendingLoops;
+               voice.position = 0;
+               if (SDL_AtomicCAS(&voice.state, VOICE_STARTING, VOICE_PLAYING))
+               {
+                    return true;
+               }
+               state = SDL_AtomicGet(&voice.state);
+          }
+          if (state == VOICE_HALTING)
+          {
+               SDL_AtomicSet(&voice.state, VOICE_FREE);
+               return false;
+          }
+          return state == VOICE_PLAYING;
+     }
+}
+
+bool voiceMixerKernelSupported(VoiceMixerKernel kernel)
+{
+     switch (kernel)
+     {
+     case VOICE_KERNEL_AUTO:
+     case VOICE_KERNEL_SCALAR:
+          return true;
+#ifdef VOICE_MIXER_X86
+     case VOICE_KERNEL_SSE2:
+          return cpuHasSse2();
+#endif
+#ifdef VOICE_MIXER_AVX2
+     case VOICE_KERNEL_AVX2:
+          return SDL_HasAVX2() == SDL_TRUE;
+#endif
+#ifdef VOICE_MIXER_NEON
+     case VOICE_KERNEL_NEON:
+          return SDL_HasNEON() == SDL_TRUE;
+#endif
+     default:
+          return false;
+     }
+}
+
+const char *voiceMixerKernelName(VoiceMixerKernel kernel)
+{
+     switch (kernel)
+     {
+     case VOICE_KERNEL_SCALAR:
+          return "scalar";
+     case VOICE_KERNEL_SSE2:
+          return "sse2";
+     case VOICE_KERNEL_AVX2:
+          return "avx2";
+     case VOICE_KERNEL_NEON:
+          return "neon";
+     default:
+          return "auto";
+     }
+}
+
+void voiceMixerInit(VoiceMixer &mixer, int voiceCount, VoiceMixerKernel kernel)
+{
+     mixer.voices = std::vector<Voice>(voiceCount);
+     for (Voice &voice : mixer.voices)
+     {
+          SDL_AtomicSet(&voice.state, VOICE_FREE);
+          voice.pendingChunk = nullptr;
+          voice.pendingLoops = 0;
+          voice.chunk = nullptr;
+          voice.position = 0;
+          voice.loops = 0;
+          SDL_AtomicSet(&voice.volume, MIX_MAX_VOLUME);
+          SDL_AtomicSet(&voice.panning, 255 << 8 | 255);
+     }
+     mixer.accum.assign(ACCUM_FRAMES * 2, 0.0f);
+     SDL_AtomicSet(&mixer.masterVolume, MIX_MAX_VOLUME);
+     mixer.attached = false;
+
+     if (kernel == VOICE_KERNEL_AUTO)
+     {
+          const VoiceMixerKernel preferred[] = {VOICE_KERNEL_AVX2, VOICE_KERNEL_NEON, VOICE_KERNEL_SSE2};
+          kernel = VOICE_KERNEL_SCALAR;
+          for (VoiceMixerKernel candidate : preferred)
+          {
+               if (voiceMixerKernelSupported(candidate))
+               {
+                    kernel = candidate;
+                    break;
+               }
+          }
+     }
+     else if (!voiceMixerKernelSupported(kernel))
+     {
+          kernel = VOICE_KERNEL_SCALAR;
+     }
+
+     mixer.kernel = kernel;
+     mixer.mix = mixScalar;
+     mixer.resolve = resolveScalar;
+#ifdef VOICE_MIXER_X86
+     if (kernel == VOICE_KERNEL_SSE2 || kernel == VOICE_KERNEL_AVX2)
+     {
+          mixer.mix = mixSse2;
+          mixer.resolve = resolveSse2;
+     }
+#endif
+#ifdef VOICE_MIXER_AVX2
+     if (kernel == VOICE_KERNEL_AVX2)
+     {
+          // Resolving runs once per callback, so SSE2 is plenty there
+          mixer.mix = mixAvx2;
+     }
+#endif
+#ifdef VOICE_MIXER_NEON
+     if (kernel == VOICE_KERNEL_NEON)
+     {
+          mixer.mix = mixNeon;
+          mixer.resolve = resolveNeon;
+     }
+#endif
+}
+
+bool voiceMixerAttach(VoiceMixer &mixer)
+{
+     int freq, channels;
+     Uint16 format;
+     if (Mix_QuerySpec(&freq, &format, &channels) == 0)
+     {
+          std::cerr << "Voice mixer needs an open mixer! SDL_mixer Error: " << Mix_GetError() << std::endl;
+          return false;
+     }
+     if (format != AUDIO_S16SYS || channels != 2)
+     {
+          std::cerr << "Voice mixer needs a 16-bit stereo device" << std::endl;
+          return false;
+     }
+     Mix_SetPostMix(postMix, &mixer);
+     mixer.attached = true;
+     return true;
+}
+
+void voiceMixerDetach(VoiceMixer &mixer)
+{
+     if (mixer.attached)
+     {
+          // Returns once the audio thread has left the callback
+          Mix_SetPostMix(NULL, NULL);
+          mixer.attached = false;
+     }
+}
+
+int voiceMixerPlay(VoiceMixer &mixer, const Mix_Chunk *chunk, int loops, Uint8 left, Uint8 right)
+{
+     if (chunk == nullptr || chunk->alen < 4)
+     {
+          return -1;
+     }
+     for (int i = 0; i < (int)mixer.voices.size(); i++)
+     {
+          Voice &voice = mixer.voices[i];
+          if (SDL_AtomicGet(&voice.state) == VOICE_FREE)
+          {
+               voice.pendingChunk = chunk;
+               voice.pendingLoops = loops;
+               SDL_AtomicSet(&voice.panning, left << 8 | right);
+               SDL_MemoryBarrierRelease();
+               SDL_AtomicSet(&voice.state, VOICE_STARTING);
+               return i;
+          }
+     }
+     return -1;
+}
+
+void voiceMixerHalt(VoiceMixer &mixer, int voice)
+{
+     int first = voice < 0 ? 0 : voice;
+     int last = voice < 0 ? (int)mixer.voices.size() - 1 : voice;
+     for (int i = first; i <= last; i++)
+     {
+          SDL_atomic_t &state = mixer.voices[i].state;
+          if (!SDL_AtomicCAS(&state, VOICE_PLAYING, VOICE_HALTING))
+          {
+               SDL_AtomicCAS(&state, VOICE_STARTING, VOICE_HALTING);
+          }
+     }
+}
+
+int voiceMixerVolume(VoiceMixer &mixer, int voice, int volume)
+{
+     if (voice < 0)
+     {
+          int total = 0;
+          for (Voice &each : mixer.voices)
+          {
+               total += SDL_AtomicGet(&each.volume);
+               if (volume >= 0)
+               {
+                    SDL_AtomicSet(&each.volume, SDL_min(volume, MIX_MAX_VOLUME));
+               }
+          }
+          return mixer.voices.empty() ? 0 : total / (int)mixer.voices.size();
+     }
+     int previous = SDL_AtomicGet(&mixer.voices[voice].volume);
+     if (volume >= 0)
+     {
+          SDL_AtomicSet(&mixer.voices[voice].volume, SDL_min(volume, MIX_MAX_VOLUME));
+     }
+     return previous;
+}
+
+void voiceMixerSetPanning(VoiceMixer &mixer, int voice, Uint8 left, Uint8 right)
+{
+     int first = voice < 0 ? 0 : voice;
+     int last = voice < 0 ? (int)mixer.voices.size() - 1 : voice;
+     for (int i = first; i <= last; i++)
+     {
+          SDL_AtomicSet(&mixer.voices[i].panning, left << 8 | right);
+     }
+}
+
+int voiceMixerPlayingCount(const VoiceMixer &mixer)
+{
+     int count = 0;
+     for (const Voice &voice : mixer.voices)
+     {
+          if (SDL_AtomicGet((SDL_atomic_t *)&voice.state) != VOICE_FREE)
+          {
+               count++;
+          }
+     }
+     return count;
+}
+
+void voiceMixerRender(VoiceMixer &mixer, Sint16 *out, int frames)
+{
+     const float master = SDL_AtomicGet(&mixer.masterVolume) / (float)MIX_MAX_VOLUME;
+
+     for (int done = 0; done < frames;)
+     {
+          int block = SDL_min(frames - done, ACCUM_FRAMES);
+          float *accum = mixer.accum.data();
+          std::fill(accum, accum + block * 2, 0.0f);
+
+          for (Voice &voice : mixer.voices)
+          {
+               if (!claimVoice(voice))
+               {
+                    continue;
+               }
+
+               int panning = SDL_AtomicGet(&voice.panning);
+               float gain = master * SDL_AtomicGet(&voice.volume) / (float)MIX_MAX_VOLUME;
+               float left = gain * ((panning >> 8) & 0xFF) / 255.0f;
+               float right = gain * (panning & 0xFF) / 255.0f;
+
+               const Sint16 *samples = (const Sint16 *)voice.chunk->abuf;
+               int length = (int)(voice.chunk->alen / 4);
+               int filled = 0;
+               while (filled < block)
+               {
+                    int run = SDL_min(block - filled, length - voice.position);
+                    mixer.mix(accum + filled * 2, samples + voice.position * 2, run, left, right);
+                    filled += run;
+                    voice.position += run;
+                    if (voice.position < length)
+                    {
+                         continue;
+                    }
+                    if (voice.loops == 0)
+                    {
+                         SDL_AtomicCAS(&voice.state, VOICE_PLAYING, VOICE_FREE);
+                         break;
+                    }
+                    if (voice.loops > 0)
+                    {
+                         voice.loops--;
+                    }
+                    voice.position = 0;
+               }
+          }
+
+          mixer.resolve(out + done * 2, accum, block * 2);
+          done += block;
+     }
+}
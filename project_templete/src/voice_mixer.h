@@ -0,0 +1,94 @@
+// Description:
+// Vectorized mixer for dense sound effects. Hundreds of voices are mixed
+// into a float accumulator by SSE2, AVX2 or NEON kernels (picked at startup
+// with SDL_HasSSE2/SDL_HasAVX2/SDL_HasNEON, scalar fallback otherwise) and
+// added to SDL_mixer's output from a Mix_SetPostMix callback.
+//
+// Voices follow SDL_mixer's channel semantics: Mix_Chunk data already in
+// the device format, volume 0..MIX_MAX_VOLUME as with Mix_Volume, and
+// left/right gains 0..255 as with Mix_SetPanning. The API is called from
+// the game thread; voice state is handed to the audio thread through
+// atomics, so nothing ever takes the audio lock.
+// =============================================================================
+
+#ifndef VOICE_MIXER_H
+#define VOICE_MIXER_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <vector>
+
+enum VoiceMixerKernel
+{
+     VOICE_KERNEL_AUTO,
+     VOICE_KERNEL_SCALAR,
+     VOICE_KERNEL_SSE2,
+     VOICE_KERNEL_AVX2,
+     VOICE_KERNEL_NEON
+};
+
+// Accumulate `frames` interleaved stereo S16 frames scaled by the gains
+typedef void (*VoiceMixFunc)(float *accum, const Sint16 *source, int frames, float left, float right);
+
+// Add the accumulator to `out` with saturation
+typedef void (*VoiceResolveFunc)(Sint16 *out, const float *accum, int samples);
+
+struct Voice
+{
+     // Owned by the game thread while FREE, by the audio thread otherwise
+     SDL_atomic_t state;
+     const Mix_Chunk *pendingChunk;
+     int pendingLoops;
+
+     // Audio thread only
+     const Mix_Chunk *chunk;
+     int position; // In frames
+     int loops;    // Remaining repeats, -1 forever
+
+     SDL_atomic_t volume;  // 0..MIX_MAX_VOLUME
+     SDL_atomic_t panning; // left << 8 | right
+};
+
+struct VoiceMixer
+{
+     std::vector<Voice> voices;
+     std::vector<float> accum;
+     SDL_atomic_t masterVolume;
+     VoiceMixerKernel kernel;
+     VoiceMixFunc mix;
+     VoiceResolveFunc resolve;
+     bool attached;
+};
+
+// Whether this build and the running CPU can use `kernel`
+bool voiceMixerKernelSupported(VoiceMixerKernel kernel);
+const char *voiceMixerKernelName(VoiceMixerKernel kernel);
+
+void voiceMixerInit(VoiceMixer &mixer, int voiceCount, VoiceMixerKernel kernel = VOICE_KERNEL_AUTO);
+
+// Hook into SDL_mixer's output; requires a 16-bit stereo device
+bool voiceMixerAttach(VoiceMixer &mixer);
+void voiceMixerDetach(VoiceMixer &mixer);
+
+// Start a chunk on a free voice, like Mix_PlayChannel(-1, ...), panned as
+// voiceMixerSetPanning() would. The panning is in place before the mixer
+// thread can see the voice, so the first block is not mixed centred.
+// Returns the voice or -1 when all voices are busy.
+int voiceMixerPlay(VoiceMixer &mixer, const Mix_Chunk *chunk, int loops, Uint8 left = 255, Uint8 right = 255);
+void voiceMixerHalt(VoiceMixer &mixer, int voice);
+
+// Mix_Volume semantics: voice -1 sets every voice, a negative volume only
+// queries. Returns the previous volume (the average for -1).
+int voiceMixerVolume(VoiceMixer &mixer, int voice, int volume);
+
+// Mix_SetPanning semantics: 255 is full volume on that side; voice -1 sets
+// every voice
+void voiceMixerSetPanning(VoiceMixer &mixer, int voice, Uint8 left, Uint8 right);
+
+int voiceMixerPlayingCount(const VoiceMixer &mixer);
+
+// Mix every active voice into `out` (interleaved stereo S16). Called from
+// the post-mix callback; exposed for benchmarking without an audio device.
+void voiceMixerRender(VoiceMixer &mixer, Sint16 *out, int frames);
+
+#endif // VOICE_MIXER_H
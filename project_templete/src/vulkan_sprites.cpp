@@ -0,0 +1,1274 @@
+#include "vulkan_sprites.h"
+
+#ifdef CATCH_VULKAN
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan.h>
+#include <SDL2/SDL_vulkan.h>
+#include <cstddef>
+#include <vector>
+
+// Entry points, loaded through the vkGetInstanceProcAddr of the loader SDL
+// opened; device-level ones through vkGetDeviceProcAddr, which skips the
+// loader's dispatch
+#define VULKAN_GLOBAL_FUNCTIONS(X) \
+     X(vkCreateInstance)
+
+#define VULKAN_INSTANCE_FUNCTIONS(X)              \
+     X(vkDestroyInstance)                         \
+     X(vkEnumeratePhysicalDevices)                \
+     X(vkEnumerateDeviceExtensionProperties)      \
+     X(vkGetPhysicalDeviceProperties)             \
+     X(vkGetPhysicalDeviceFeatures2)              \
+     X(vkGetPhysicalDeviceMemoryProperties)       \
+     X(vkGetPhysicalDeviceQueueFamilyProperties)  \
+     X(vkGetPhysicalDeviceSurfaceSupportKHR)      \
+     X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+     X(vkGetPhysicalDeviceSurfaceFormatsKHR)      \
+     X(vkGetPhysicalDeviceSurfacePresentModesKHR) \
+     X(vkDestroySurfaceKHR)                       \
+     X(vkCreateDevice)                            \
+     X(vkGetDeviceProcAddr)
+
+#define VULKAN_DEVICE_FUNCTIONS(X)   \
+     X(vkDestroyDevice)              \
+     X(vkGetDeviceQueue)             \
+     X(vkDeviceWaitIdle)             \
+     X(vkCreateSwapchainKHR)         \
+     X(vkDestroySwapchainKHR)        \
+     X(vkGetSwapchainImagesKHR)      \
+     X(vkAcquireNextImageKHR)        \
+     X(vkQueuePresentKHR)            \
+     X(vkQueueSubmit)                \
+     X(vkQueueWaitIdle)              \
+     X(vkCreateImageView)            \
+     X(vkDestroyImageView)           \
+     X(vkCreateRenderPass)           \
+     X(vkDestroyRenderPass)          \
+     X(vkCreateFramebuffer)          \
+     X(vkDestroyFramebuffer)         \
+     X(vkCreateShaderModule)         \
+     X(vkDestroyShaderModule)        \
+     X(vkCreateDescriptorSetLayout)  \
+     X(vkDestroyDescriptorSetLayout) \
+     X(vkCreateDescriptorPool)       \
+     X(vkDestroyDescriptorPool)      \
+     X(vkAllocateDescriptorSets)     \
+     X(vkUpdateDescriptorSets)       \
+     X(vkCreatePipelineLayout)       \
+     X(vkDestroyPipelineLayout)      \
+     X(vkCreateGraphicsPipelines)    \
+     X(vkDestroyPipeline)            \
+     X(vkCreateSampler)              \
+     X(vkDestroySampler)             \
+     X(vkCreateBuffer)               \
+     X(vkDestroyBuffer)              \
+     X(vkGetBufferMemoryRequirements) \
+     X(vkCreateImage)                \
+     X(vkDestroyImage)               \
+     X(vkGetImageMemoryRequirements) \
+     X(vkAllocateMemory)             \
+     X(vkFreeMemory)                 \
+     X(vkBindBufferMemory)           \
+     X(vkBindImageMemory)            \
+     X(vkMapMemory)                  \
+     X(vkCreateCommandPool)          \
+     X(vkDestroyCommandPool)         \
+     X(vkAllocateCommandBuffers)     \
+     X(vkFreeCommandBuffers)         \
+     X(vkBeginCommandBuffer)         \
+     X(vkEndCommandBuffer)           \
+     X(vkResetCommandBuffer)         \
+     X(vkCmdBeginRenderPass)         \
+     X(vkCmdEndRenderPass)           \
+     X(vkCmdBindPipeline)            \
+     X(vkCmdBindDescriptorSets)      \
+     X(vkCmdBindVertexBuffers)       \
+     X(vkCmdPushConstants)           \
+     X(vkCmdSetViewport)             \
+     X(vkCmdSetScissor)              \
+     X(vkCmdDraw)                    \
+     X(vkCmdPipelineBarrier)         \
+     X(vkCmdCopyBufferToImage)       \
+     X(vkCreateFence)                \
+     X(vkDestroyFence)               \
+     X(vkWaitForFences)              \
+     X(vkResetFences)                \
+     X(vkCreateSemaphore)            \
+     X(vkDestroySemaphore)
+
+struct VulkanSpriteFrame
+{
+     VkCommandBuffer commands;
+     VkFence done; // Signaled when the GPU has finished with this frame
+     VkSemaphore imageReady;
+     VkBuffer instances;
+     VkDeviceMemory instanceMemory;
+     VulkanSprite *mapped; // Mapped once, for the buffer's lifetime
+};
+
+struct VulkanSpriteTexture
+{
+     VkImage image;
+     VkDeviceMemory memory;
+     VkImageView view;
+};
+
+struct VulkanSpritesState
+{
+     SDL_Window *window;
+     bool vsync;
+     VkInstance instance;
+     VkSurfaceKHR surface;
+     VkPhysicalDevice physical;
+     VkPhysicalDeviceMemoryProperties memory;
+     Uint32 queueFamily;
+     VkDevice device;
+     bool deviceLoaded; // Every device function was found, so all may be called
+     VkQueue queue;
+
+     VkSurfaceFormatKHR format;
+     VkSwapchainKHR swapchain;
+     VkExtent2D extent;
+     std::vector<VkImage> images;
+     std::vector<VkImageView> views;
+     std::vector<VkFramebuffer> framebuffers;
+     std::vector<VkSemaphore> renderDone; // Per swapchain image, waited on by present
+     bool swapchainStale;
+
+     VkRenderPass renderPass;
+     VkDescriptorSetLayout setLayout;
+     VkDescriptorPool descriptorPool;
+     VkDescriptorSet descriptors;
+     VkPipelineLayout pipelineLayout;
+     VkPipeline pipeline;
+     VkSampler linear, nearest;
+     VkCommandPool commandPool;
+
+     VulkanSpriteFrame frames[VULKAN_SPRITES_FRAMES_IN_FLIGHT];
+     int frame;
+     std::vector<VulkanSpriteTexture> textures;
+};
+
+namespace
+{
+     const Uint32 VULKAN_SPRITE_VERTEX_SPIRV[] = {
+#include "vulkan_sprite.vert.inc"
+     };
+     const Uint32 VULKAN_SPRITE_FRAGMENT_SPIRV[] = {
+#include "vulkan_sprite.frag.inc"
+     };
+
+#define VULKAN_DECLARE(name) PFN_##name name = nullptr;
+     VULKAN_GLOBAL_FUNCTIONS(VULKAN_DECLARE)
+     VULKAN_INSTANCE_FUNCTIONS(VULKAN_DECLARE)
+     VULKAN_DEVICE_FUNCTIONS(VULKAN_DECLARE)
+#undef VULKAN_DECLARE
+
+     bool vulkanFailed(VkResult result, const char *what)
+     {
+          if (result == VK_SUCCESS)
+          {
+               return false;
+          }
+          SDL_SetError("%s failed (VkResult %d)", what, (int)result);
+          return true;
+     }
+
+     bool loadInstanceFunctions(VkInstance instance)
+     {
+          PFN_vkGetInstanceProcAddr getProc = (PFN_vkGetInstanceProcAddr)SDL_Vulkan_GetVkGetInstanceProcAddr();
+          if (getProc == nullptr)
+          {
+               return false;
+          }
+          bool loaded = true;
+#define VULKAN_LOAD(name)                                          \
+     name = (PFN_##name)getProc(instance, #name);                  \
+     loaded = loaded && name != nullptr;
+          if (instance == VK_NULL_HANDLE)
+          {
+               VULKAN_GLOBAL_FUNCTIONS(VULKAN_LOAD)
+          }
+          else
+          {
+               VULKAN_INSTANCE_FUNCTIONS(VULKAN_LOAD)
+          }
+#undef VULKAN_LOAD
+          if (!loaded)
+          {
+               SDL_SetError("The Vulkan loader lacks an entry point this renderer needs");
+          }
+          return loaded;
+     }
+
+     bool loadDeviceFunctions(VkDevice device)
+     {
+          bool loaded = true;
+#define VULKAN_LOAD(name)                                          \
+     name = (PFN_##name)vkGetDeviceProcAddr(device, #name);        \
+     loaded = loaded && name != nullptr;
+          VULKAN_DEVICE_FUNCTIONS(VULKAN_LOAD)
+#undef VULKAN_LOAD
+          if (!loaded)
+          {
+               SDL_SetError("The Vulkan device lacks an entry point this renderer needs");
+          }
+          return loaded;
+     }
+
+     // A memory type allowed by `bits` with all of `flags`, or -1
+     int findMemoryType(const VulkanSpritesState &state, Uint32 bits, VkMemoryPropertyFlags flags)
+     {
+          for (Uint32 i = 0; i < state.memory.memoryTypeCount; i++)
+          {
+               if ((bits & (1u << i)) != 0 && (state.memory.memoryTypes[i].propertyFlags & flags) == flags)
+               {
+                    return (int)i;
+               }
+          }
+          return -1;
+     }
+
+     bool allocateMemory(VulkanSpritesState &state, const VkMemoryRequirements &requirements,
+                         VkMemoryPropertyFlags preferred, VkMemoryPropertyFlags required, VkDeviceMemory &memory)
+     {
+          int type = findMemoryType(state, requirements.memoryTypeBits, preferred);
+          if (type < 0)
+          {
+               type = findMemoryType(state, requirements.memoryTypeBits, required);
+          }
+          if (type < 0)
+          {
+               SDL_SetError("No Vulkan memory type fits");
+               return false;
+          }
+          VkMemoryAllocateInfo allocate = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+          allocate.allocationSize = requirements.size;
+          allocate.memoryTypeIndex = (Uint32)type;
+          return !vulkanFailed(vkAllocateMemory(state.device, &allocate, nullptr, &memory), "vkAllocateMemory");
+     }
+
+     // Host-visible buffer, mapped for its lifetime. Device-local as well
+     // when the GPU exposes such memory (resizable BAR), so the GPU reads
+     // the sprites without crossing the bus
+     bool createMappedBuffer(VulkanSpritesState &state, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buffer,
+                             VkDeviceMemory &memory, void **mapped)
+     {
+          VkBufferCreateInfo create = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+          create.size = size;
+          create.usage = usage;
+          create.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+          if (vulkanFailed(vkCreateBuffer(state.device, &create, nullptr, &buffer), "vkCreateBuffer"))
+          {
+               return false;
+          }
+          VkMemoryRequirements requirements;
+          vkGetBufferMemoryRequirements(state.device, buffer, &requirements);
+          const VkMemoryPropertyFlags host = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+          if (!allocateMemory(state, requirements, host | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, host, memory))
+          {
+               return false;
+          }
+          return !vulkanFailed(vkBindBufferMemory(state.device, buffer, memory, 0), "vkBindBufferMemory") &&
+                 !vulkanFailed(vkMapMemory(state.device, memory, 0, size, 0, mapped), "vkMapMemory");
+     }
+
+     bool createInstance(VulkanSpritesState &state)
+     {
+          unsigned int count = 0;
+          if (!SDL_Vulkan_GetInstanceExtensions(state.window, &count, nullptr))
+          {
+               return false;
+          }
+          std::vector<const char *> extensions(count);
+          if (!SDL_Vulkan_GetInstanceExtensions(state.window, &count, extensions.data()))
+          {
+               return false;
+          }
+
+          VkApplicationInfo application = {VK_STRUCTURE_TYPE_APPLICATION_INFO};
+          application.pApplicationName = "vulkan_sprites";
+          application.apiVersion = VK_API_VERSION_1_2;
+          VkInstanceCreateInfo create = {VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+          create.pApplicationInfo = &application;
+          create.enabledExtensionCount = count;
+          create.ppEnabledExtensionNames = extensions.data();
+          if (vulkanFailed(vkCreateInstance(&create, nullptr, &state.instance), "vkCreateInstance") ||
+              !loadInstanceFunctions(state.instance))
+          {
+               return false;
+          }
+          return SDL_Vulkan_CreateSurface(state.window, state.instance, &state.surface) == SDL_TRUE;
+     }
+
+     // The queue family that draws and presents to the surface, or -1
+     int presentingFamily(VulkanSpritesState &state, VkPhysicalDevice physical)
+     {
+          Uint32 count = 0;
+          vkGetPhysicalDeviceQueueFamilyProperties(physical, &count, nullptr);
+          std::vector<VkQueueFamilyProperties> families(count);
+          vkGetPhysicalDeviceQueueFamilyProperties(physical, &count, families.data());
+          for (Uint32 i = 0; i < count; i++)
+          {
+               VkBool32 presents = VK_FALSE;
+               vkGetPhysicalDeviceSurfaceSupportKHR(physical, i, state.surface, &presents);
+               if ((families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0 && presents)
+               {
+                    return (int)i;
+               }
+          }
+          return -1;
+     }
+
+     bool hasSwapchain(VkPhysicalDevice physical)
+     {
+          Uint32 count = 0;
+          vkEnumerateDeviceExtensionProperties(physical, nullptr, &count, nullptr);
+          std::vector<VkExtensionProperties> extensions(count);
+          vkEnumerateDeviceExtensionProperties(physical, nullptr, &count, extensions.data());
+          for (const VkExtensionProperties &extension : extensions)
+          {
+               if (SDL_strcmp(extension.extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0)
+               {
+                    return true;
+               }
+          }
+          return false;
+     }
+
+     // The first discrete GPU that can run the shaders, else any that can
+     bool pickDevice(VulkanSpritesState &state)
+     {
+          Uint32 count = 0;
+          vkEnumeratePhysicalDevices(state.instance, &count, nullptr);
+          std::vector<VkPhysicalDevice> devices(count);
+          vkEnumeratePhysicalDevices(state.instance, &count, devices.data());
+          int bestScore = 0;
+          for (VkPhysicalDevice physical : devices)
+          {
+               VkPhysicalDeviceProperties properties;
+               vkGetPhysicalDeviceProperties(physical, &properties);
+               if (properties.apiVersion < VK_API_VERSION_1_2 || !hasSwapchain(physical) ||
+                   properties.limits.maxPerStageDescriptorSamplers < VULKAN_SPRITES_MAX_TEXTURES ||
+                   properties.limits.maxPerStageDescriptorSampledImages < VULKAN_SPRITES_MAX_TEXTURES)
+               {
+                    continue;
+               }
+               VkPhysicalDeviceVulkan12Features features12 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+               VkPhysicalDeviceFeatures2 features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+               features.pNext = &features12;
+               vkGetPhysicalDeviceFeatures2(physical, &features);
+               const int family = presentingFamily(state, physical);
+               if (!features12.shaderSampledImageArrayNonUniformIndexing || family < 0)
+               {
+                    continue;
+               }
+               const int score = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ? 2 : 1;
+               if (score > bestScore)
+               {
+                    bestScore = score;
+                    state.physical = physical;
+                    state.queueFamily = (Uint32)family;
+               }
+          }
+          if (bestScore == 0)
+          {
+               SDL_SetError("No Vulkan 1.2 GPU with non-uniform texture array indexing presents to this window");
+               return false;
+          }
+          vkGetPhysicalDeviceMemoryProperties(state.physical, &state.memory);
+          return true;
+     }
+
+     bool createDevice(VulkanSpritesState &state)
+     {
+          const float priority = 1.0f;
+          VkDeviceQueueCreateInfo queue = {VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+          queue.queueFamilyIndex = state.queueFamily;
+          queue.queueCount = 1;
+          queue.pQueuePriorities = &priority;
+
+          VkPhysicalDeviceVulkan12Features features12 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+          features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+          const char *extensions[] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+          VkDeviceCreateInfo create = {VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+          create.pNext = &features12;
+          create.queueCreateInfoCount = 1;
+          create.pQueueCreateInfos = &queue;
+          create.enabledExtensionCount = 1;
+          create.ppEnabledExtensionNames = extensions;
+          if (vulkanFailed(vkCreateDevice(state.physical, &create, nullptr, &state.device), "vkCreateDevice") ||
+              !loadDeviceFunctions(state.device))
+          {
+               return false;
+          }
+          state.deviceLoaded = true;
+          vkGetDeviceQueue(state.device, state.queueFamily, 0, &state.queue);
+
+          Uint32 count = 0;
+          vkGetPhysicalDeviceSurfaceFormatsKHR(state.physical, state.surface, &count, nullptr);
+          std::vector<VkSurfaceFormatKHR> formats(count);
+          vkGetPhysicalDeviceSurfaceFormatsKHR(state.physical, state.surface, &count, formats.data());
+          if (count == 0)
+          {
+               SDL_SetError("The Vulkan surface offers no formats");
+               return false;
+          }
+          // UNORM, so blending and tints behave as they do in SDL_Renderer
+          state.format = formats[0];
+          for (const VkSurfaceFormatKHR &format : formats)
+          {
+               if (format.format == VK_FORMAT_B8G8R8A8_UNORM || format.format == VK_FORMAT_R8G8B8A8_UNORM)
+               {
+                    state.format = format;
+                    break;
+               }
+          }
+          return true;
+     }
+
+     VkPresentModeKHR choosePresentMode(VulkanSpritesState &state)
+     {
+          if (state.vsync)
+          {
+               return VK_PRESENT_MODE_FIFO_KHR; // Always available
+          }
+          Uint32 count = 0;
+          vkGetPhysicalDeviceSurfacePresentModesKHR(state.physical, state.surface, &count, nullptr);
+          std::vector<VkPresentModeKHR> modes(count);
+          vkGetPhysicalDeviceSurfacePresentModesKHR(state.physical, state.surface, &count, modes.data());
+          VkPresentModeKHR chosen = VK_PRESENT_MODE_FIFO_KHR;
+          for (VkPresentModeKHR mode : modes)
+          {
+               if (mode == VK_PRESENT_MODE_MAILBOX_KHR)
+               {
+                    return mode;
+               }
+               if (mode == VK_PRESENT_MODE_IMMEDIATE_KHR)
+               {
+                    chosen = mode;
+               }
+          }
+          return chosen;
+     }
+
+     void destroySwapchainViews(VulkanSpritesState &state)
+     {
+          for (VkFramebuffer framebuffer : state.framebuffers)
+          {
+               vkDestroyFramebuffer(state.device, framebuffer, nullptr);
+          }
+          for (VkImageView view : state.views)
+          {
+               vkDestroyImageView(state.device, view, nullptr);
+          }
+          for (VkSemaphore semaphore : state.renderDone)
+          {
+               vkDestroySemaphore(state.device, semaphore, nullptr);
+          }
+          state.framebuffers.clear();
+          state.views.clear();
+          state.renderDone.clear();
+          state.images.clear();
+     }
+
+     // (Re)build the swapchain at the drawable's current size. A minimized
+     // window has no size; the swapchain stays stale until it has one
+     bool createSwapchain(VulkanSpritesState &state)
+     {
+          vkDeviceWaitIdle(state.device);
+          destroySwapchainViews(state);
+
+          VkSurfaceCapabilitiesKHR capabilities;
+          if (vulkanFailed(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(state.physical, state.surface, &capabilities),
+                           "vkGetPhysicalDeviceSurfaceCapabilitiesKHR"))
+          {
+               return false;
+          }
+          VkExtent2D extent = capabilities.currentExtent;
+          if (extent.width == 0xFFFFFFFFu)
+          {
+               int w, h;
+               SDL_Vulkan_GetDrawableSize(state.window, &w, &h);
+               extent.width = SDL_clamp((Uint32)w, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+               extent.height =
+                   SDL_clamp((Uint32)h, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+          }
+          state.extent = extent;
+          state.swapchainStale = extent.width == 0 || extent.height == 0;
+          if (state.swapchainStale)
+          {
+               return true;
+          }
+
+          Uint32 imageCount = capabilities.minImageCount + 1;
+          if (capabilities.maxImageCount > 0)
+          {
+               imageCount = SDL_min(imageCount, capabilities.maxImageCount);
+          }
+          VkSwapchainCreateInfoKHR create = {VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR};
+          create.surface = state.surface;
+          create.minImageCount = imageCount;
+          create.imageFormat = state.format.format;
+          create.imageColorSpace = state.format.colorSpace;
+          create.imageExtent = extent;
+          create.imageArrayLayers = 1;
+          create.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+          create.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+          create.preTransform = capabilities.currentTransform;
+          create.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+          create.presentMode = choosePresentMode(state);
+          create.clipped = VK_TRUE;
+          create.oldSwapchain = state.swapchain;
+          VkSwapchainKHR swapchain;
+          const VkResult result = vkCreateSwapchainKHR(state.device, &create, nullptr, &swapchain);
+          if (state.swapchain != VK_NULL_HANDLE)
+          {
+               vkDestroySwapchainKHR(state.device, state.swapchain, nullptr);
+               state.swapchain = VK_NULL_HANDLE;
+          }
+          if (vulkanFailed(result, "vkCreateSwapchainKHR"))
+          {
+               return false;
+          }
+          state.swapchain = swapchain;
+
+          Uint32 count = 0;
+          vkGetSwapchainImagesKHR(state.device, state.swapchain, &count, nullptr);
+          state.images.resize(count);
+          vkGetSwapchainImagesKHR(state.device, state.swapchain, &count, state.images.data());
+          for (VkImage image : state.images)
+          {
+               VkImageViewCreateInfo view = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+               view.image = image;
+               view.viewType = VK_IMAGE_VIEW_TYPE_2D;
+               view.format = state.format.format;
+               view.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+               view.subresourceRange.levelCount = 1;
+               view.subresourceRange.layerCount = 1;
+               state.views.push_back(VK_NULL_HANDLE);
+               if (vulkanFailed(vkCreateImageView(state.device, &view, nullptr, &state.views.back()),
+                                "vkCreateImageView"))
+               {
+                    return false;
+               }
+
+               VkFramebufferCreateInfo framebuffer = {VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+               framebuffer.renderPass = state.renderPass;
+               framebuffer.attachmentCount = 1;
+               framebuffer.pAttachments = &state.views.back();
+               framebuffer.width = extent.width;
+               framebuffer.height = extent.height;
+               framebuffer.layers = 1;
+               state.framebuffers.push_back(VK_NULL_HANDLE);
+               if (vulkanFailed(vkCreateFramebuffer(state.device, &framebuffer, nullptr, &state.framebuffers.back()),
+                                "vkCreateFramebuffer"))
+               {
+                    return false;
+               }
+
+               VkSemaphoreCreateInfo semaphore = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+               state.renderDone.push_back(VK_NULL_HANDLE);
+               if (vulkanFailed(vkCreateSemaphore(state.device, &semaphore, nullptr, &state.renderDone.back()),
+                                "vkCreateSemaphore"))
+               {
+                    return false;
+               }
+          }
+          return true;
+     }
+
+     bool createRenderPass(VulkanSpritesState &state)
+     {
+          VkAttachmentDescription color = {};
+          color.format = state.format.format;
+          color.samples = VK_SAMPLE_COUNT_1_BIT;
+          color.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+          color.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+          color.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+          color.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+          color.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+          color.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+          VkAttachmentReference reference = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+          VkSubpassDescription subpass = {};
+          subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+          subpass.colorAttachmentCount = 1;
+          subpass.pColorAttachments = &reference;
+
+          // The layout change waits for the acquire semaphore, which is
+          // waited on at this same stage
+          VkSubpassDependency dependency = {};
+          dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+          dependency.dstSubpass = 0;
+          dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+          dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+          dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+          VkRenderPassCreateInfo create = {VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+          create.attachmentCount = 1;
+          create.pAttachments = &color;
+          create.subpassCount = 1;
+          create.pSubpasses = &subpass;
+          create.dependencyCount = 1;
+          create.pDependencies = &dependency;
+          return !vulkanFailed(vkCreateRenderPass(state.device, &create, nullptr, &state.renderPass),
+                               "vkCreateRenderPass");
+     }
+
+     VkShaderModule createShader(VulkanSpritesState &state, const Uint32 *code, size_t bytes)
+     {
+          VkShaderModuleCreateInfo create = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+          create.codeSize = bytes;
+          create.pCode = code;
+          VkShaderModule module = VK_NULL_HANDLE;
+          vulkanFailed(vkCreateShaderModule(state.device, &create, nullptr, &module), "vkCreateShaderModule");
+          return module;
+     }
+
+     bool createPipeline(VulkanSpritesState &state)
+     {
+          VkDescriptorSetLayoutBinding binding = {};
+          binding.binding = 0;
+          binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+          binding.descriptorCount = VULKAN_SPRITES_MAX_TEXTURES;
+          binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+          VkDescriptorSetLayoutCreateInfo setLayout = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+          setLayout.bindingCount = 1;
+          setLayout.pBindings = &binding;
+          if (vulkanFailed(vkCreateDescriptorSetLayout(state.device, &setLayout, nullptr, &state.setLayout),
+                           "vkCreateDescriptorSetLayout"))
+          {
+               return false;
+          }
+
+          VkDescriptorPoolSize poolSize = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VULKAN_SPRITES_MAX_TEXTURES};
+          VkDescriptorPoolCreateInfo pool = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+          pool.maxSets = 1;
+          pool.poolSizeCount = 1;
+          pool.pPoolSizes = &poolSize;
+          if (vulkanFailed(vkCreateDescriptorPool(state.device, &pool, nullptr, &state.descriptorPool),
+                           "vkCreateDescriptorPool"))
+          {
+               return false;
+          }
+          VkDescriptorSetAllocateInfo allocate = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+          allocate.descriptorPool = state.descriptorPool;
+          allocate.descriptorSetCount = 1;
+          allocate.pSetLayouts = &state.setLayout;
+          if (vulkanFailed(vkAllocateDescriptorSets(state.device, &allocate, &state.descriptors),
+                           "vkAllocateDescriptorSets"))
+          {
+               return false;
+          }
+
+          VkPushConstantRange push = {VK_SHADER_STAGE_VERTEX_BIT, 0, 2 * sizeof(float)};
+          VkPipelineLayoutCreateInfo layout = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+          layout.setLayoutCount = 1;
+          layout.pSetLayouts = &state.setLayout;
+          layout.pushConstantRangeCount = 1;
+          layout.pPushConstantRanges = &push;
+          if (vulkanFailed(vkCreatePipelineLayout(state.device, &layout, nullptr, &state.pipelineLayout),
+                           "vkCreatePipelineLayout"))
+          {
+               return false;
+          }
+
+          VkShaderModule vertex =
+              createShader(state, VULKAN_SPRITE_VERTEX_SPIRV, sizeof(VULKAN_SPRITE_VERTEX_SPIRV));
+          VkShaderModule fragment =
+              createShader(state, VULKAN_SPRITE_FRAGMENT_SPIRV, sizeof(VULKAN_SPRITE_FRAGMENT_SPIRV));
+          VkPipelineShaderStageCreateInfo stages[2] = {{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
+                                                       {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO}};
+          stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+          stages[0].module = vertex;
+          stages[0].pName = "main";
+          stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+          stages[1].module = fragment;
+          stages[1].pName = "main";
+
+          // One instance per sprite, nothing per vertex
+          VkVertexInputBindingDescription instance = {0, sizeof(VulkanSprite), VK_VERTEX_INPUT_RATE_INSTANCE};
+          VkVertexInputAttributeDescription attributes[] = {
+              {0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, (Uint32)offsetof(VulkanSprite, x)},
+              {1, 0, VK_FORMAT_R16G16B16A16_UNORM, (Uint32)offsetof(VulkanSprite, u0)},
+              {2, 0, VK_FORMAT_R8G8B8A8_UNORM, (Uint32)offsetof(VulkanSprite, color)},
+              {3, 0, VK_FORMAT_R32_UINT, (Uint32)offsetof(VulkanSprite, texture)},
+          };
+          VkPipelineVertexInputStateCreateInfo input = {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+          input.vertexBindingDescriptionCount = 1;
+          input.pVertexBindingDescriptions = &instance;
+          input.vertexAttributeDescriptionCount = 4;
+          input.pVertexAttributeDescriptions = attributes;
+          VkPipelineInputAssemblyStateCreateInfo assembly = {
+              VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+          assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+
+          VkPipelineViewportStateCreateInfo viewport = {VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+          viewport.viewportCount = 1;
+          viewport.scissorCount = 1;
+          VkPipelineRasterizationStateCreateInfo raster = {
+              VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+          raster.polygonMode = VK_POLYGON_MODE_FILL;
+          raster.cullMode = VK_CULL_MODE_NONE;
+          raster.lineWidth = 1.0f;
+          VkPipelineMultisampleStateCreateInfo multisample = {
+              VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+          multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+          // SDL_BLENDMODE_BLEND
+          VkPipelineColorBlendAttachmentState blend = {};
+          blend.blendEnable = VK_TRUE;
+          blend.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+          blend.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+          blend.colorBlendOp = VK_BLEND_OP_ADD;
+          blend.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+          blend.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+          blend.alphaBlendOp = VK_BLEND_OP_ADD;
+          blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+                                 VK_COLOR_COMPONENT_A_BIT;
+          VkPipelineColorBlendStateCreateInfo blending = {VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+          blending.attachmentCount = 1;
+          blending.pAttachments = &blend;
+
+          // Viewport and scissor follow the swapchain, which a resize rebuilds
+          const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+          VkPipelineDynamicStateCreateInfo dynamic = {VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+          dynamic.dynamicStateCount = 2;
+          dynamic.pDynamicStates = dynamicStates;
+
+          VkGraphicsPipelineCreateInfo create = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+          create.stageCount = 2;
+          create.pStages = stages;
+          create.pVertexInputState = &input;
+          create.pInputAssemblyState = &assembly;
+          create.pViewportState = &viewport;
+          create.pRasterizationState = &raster;
+          create.pMultisampleState = &multisample;
+          create.pColorBlendState = &blending;
+          create.pDynamicState = &dynamic;
+          create.layout = state.pipelineLayout;
+          create.renderPass = state.renderPass;
+          create.subpass = 0;
+          VkResult result = VK_ERROR_INITIALIZATION_FAILED;
+          if (vertex != VK_NULL_HANDLE && fragment != VK_NULL_HANDLE)
+          {
+               result = vkCreateGraphicsPipelines(state.device, VK_NULL_HANDLE, 1, &create, nullptr, &state.pipeline);
+          }
+          vkDestroyShaderModule(state.device, vertex, nullptr);
+          vkDestroyShaderModule(state.device, fragment, nullptr);
+          return !vulkanFailed(result, "vkCreateGraphicsPipelines");
+     }
+
+     bool createSamplers(VulkanSpritesState &state)
+     {
+          VkSamplerCreateInfo create = {VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+          create.magFilter = VK_FILTER_LINEAR;
+          create.minFilter = VK_FILTER_LINEAR;
+          create.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+          create.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+          create.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+          create.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+          if (vulkanFailed(vkCreateSampler(state.device, &create, nullptr, &state.linear), "vkCreateSampler"))
+          {
+               return false;
+          }
+          create.magFilter = VK_FILTER_NEAREST;
+          create.minFilter = VK_FILTER_NEAREST;
+          return !vulkanFailed(vkCreateSampler(state.device, &create, nullptr, &state.nearest), "vkCreateSampler");
+     }
+
+     bool createFrames(VulkanSpritesState &state, int maxSprites)
+     {
+          VkCommandPoolCreateInfo pool = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+          pool.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+          pool.queueFamilyIndex = state.queueFamily;
+          if (vulkanFailed(vkCreateCommandPool(state.device, &pool, nullptr, &state.commandPool),
+                           "vkCreateCommandPool"))
+          {
+               return false;
+          }
+          for (VulkanSpriteFrame &frame : state.frames)
+          {
+               VkCommandBufferAllocateInfo allocate = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+               allocate.commandPool = state.commandPool;
+               allocate.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+               allocate.commandBufferCount = 1;
+               VkFenceCreateInfo fence = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+               fence.flags = VK_FENCE_CREATE_SIGNALED_BIT; // The first wait returns at once
+               VkSemaphoreCreateInfo semaphore = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+               void *mapped = nullptr;
+               if (vulkanFailed(vkAllocateCommandBuffers(state.device, &allocate, &frame.commands),
+                                "vkAllocateCommandBuffers") ||
+                   vulkanFailed(vkCreateFence(state.device, &fence, nullptr, &frame.done), "vkCreateFence") ||
+                   vulkanFailed(vkCreateSemaphore(state.device, &semaphore, nullptr, &frame.imageReady),
+                                "vkCreateSemaphore") ||
+                   !createMappedBuffer(state, (VkDeviceSize)maxSprites * sizeof(VulkanSprite),
+                                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, frame.instances, frame.instanceMemory,
+                                       &mapped))
+               {
+                    return false;
+               }
+               frame.mapped = (VulkanSprite *)mapped;
+          }
+          return true;
+     }
+
+     // Record, submit and wait for a one-off transfer
+     bool submitNow(VulkanSpritesState &state, VkCommandBuffer commands)
+     {
+          VkSubmitInfo submit = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+          submit.commandBufferCount = 1;
+          submit.pCommandBuffers = &commands;
+          return !vulkanFailed(vkQueueSubmit(state.queue, 1, &submit, VK_NULL_HANDLE), "vkQueueSubmit") &&
+                 !vulkanFailed(vkQueueWaitIdle(state.queue), "vkQueueWaitIdle");
+     }
+
+     void imageBarrier(VkCommandBuffer commands, VkImage image, VkImageLayout from, VkImageLayout to,
+                       VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage,
+                       VkPipelineStageFlags dstStage)
+     {
+          VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+          barrier.srcAccessMask = srcAccess;
+          barrier.dstAccessMask = dstAccess;
+          barrier.oldLayout = from;
+          barrier.newLayout = to;
+          barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+          barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+          barrier.image = image;
+          barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+          barrier.subresourceRange.levelCount = 1;
+          barrier.subresourceRange.layerCount = 1;
+          vkCmdPipelineBarrier(commands, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+     }
+
+     // Device-local RGBA8 image filled from `pixels` through a staging buffer
+     bool createTexture(VulkanSpritesState &state, const Uint8 *pixels, int width, int height, int pitch,
+                        VulkanSpriteTexture &texture)
+     {
+          texture = {};
+          const VkDeviceSize bytes = (VkDeviceSize)width * height * 4;
+          VkBuffer staging = VK_NULL_HANDLE;
+          VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+          void *mapped = nullptr;
+          VkCommandBuffer commands = VK_NULL_HANDLE;
+          bool ok = createMappedBuffer(state, bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, staging, stagingMemory, &mapped);
+          if (ok)
+          {
+               for (int y = 0; y < height; y++)
+               {
+                    SDL_memcpy((Uint8 *)mapped + (size_t)y * width * 4, pixels + (size_t)y * pitch, (size_t)width * 4);
+               }
+
+               VkImageCreateInfo image = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+               image.imageType = VK_IMAGE_TYPE_2D;
+               image.format = VK_FORMAT_R8G8B8A8_UNORM;
+               image.extent = {(Uint32)width, (Uint32)height, 1};
+               image.mipLevels = 1;
+               image.arrayLayers = 1;
+               image.samples = VK_SAMPLE_COUNT_1_BIT;
+               image.tiling = VK_IMAGE_TILING_OPTIMAL;
+               image.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+               image.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+               image.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+               ok = !vulkanFailed(vkCreateImage(state.device, &image, nullptr, &texture.image), "vkCreateImage");
+          }
+          if (ok)
+          {
+               VkMemoryRequirements requirements;
+               vkGetImageMemoryRequirements(state.device, texture.image, &requirements);
+               ok = allocateMemory(state, requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, texture.memory) &&
+                    !vulkanFailed(vkBindImageMemory(state.device, texture.image, texture.memory, 0),
+                                  "vkBindImageMemory");
+          }
+          if (ok)
+          {
+               VkCommandBufferAllocateInfo allocate = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+               allocate.commandPool = state.commandPool;
+               allocate.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+               allocate.commandBufferCount = 1;
+               ok = !vulkanFailed(vkAllocateCommandBuffers(state.device, &allocate, &commands),
+                                  "vkAllocateCommandBuffers");
+          }
+          if (ok)
+          {
+               VkCommandBufferBeginInfo begin = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+               begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+               vkBeginCommandBuffer(commands, &begin);
+               imageBarrier(commands, texture.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
+                            VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                            VK_PIPELINE_STAGE_TRANSFER_BIT);
+               VkBufferImageCopy copy = {};
+               copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+               copy.imageSubresource.layerCount = 1;
+               copy.imageExtent = {(Uint32)width, (Uint32)height, 1};
+               vkCmdCopyBufferToImage(commands, staging, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+               imageBarrier(commands, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                            VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+               ok = !vulkanFailed(vkEndCommandBuffer(commands), "vkEndCommandBuffer") && submitNow(state, commands);
+          }
+          if (ok)
+          {
+               VkImageViewCreateInfo view = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+               view.image = texture.image;
+               view.viewType = VK_IMAGE_VIEW_TYPE_2D;
+               view.format = VK_FORMAT_R8G8B8A8_UNORM;
+               view.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+               view.subresourceRange.levelCount = 1;
+               view.subresourceRange.layerCount = 1;
+               ok = !vulkanFailed(vkCreateImageView(state.device, &view, nullptr, &texture.view), "vkCreateImageView");
+          }
+
+          if (commands != VK_NULL_HANDLE)
+          {
+               vkFreeCommandBuffers(state.device, state.commandPool, 1, &commands);
+          }
+          vkDestroyBuffer(state.device, staging, nullptr);
+          vkFreeMemory(state.device, stagingMemory, nullptr);
+          if (!ok)
+          {
+               vkDestroyImage(state.device, texture.image, nullptr);
+               vkFreeMemory(state.device, texture.memory, nullptr);
+               texture = {};
+          }
+          return ok;
+     }
+
+     // Point descriptor slots [first, first + count) at `texture`
+     void bindTexture(VulkanSpritesState &state, int first, int count, const VulkanSpriteTexture &texture,
+                      VkSampler sampler)
+     {
+          std::vector<VkDescriptorImageInfo> images(count);
+          for (VkDescriptorImageInfo &image : images)
+          {
+               image.sampler = sampler;
+               image.imageView = texture.view;
+               image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+          }
+          VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+          write.dstSet = state.descriptors;
+          write.dstBinding = 0;
+          write.dstArrayElement = (Uint32)first;
+          write.descriptorCount = (Uint32)count;
+          write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+          write.pImageInfo = images.data();
+          vkUpdateDescriptorSets(state.device, 1, &write, 0, nullptr);
+     }
+
+     // Also after a failed create: only what was created is destroyed, and
+     // only through entry points the loader returned
+     void destroyState(VulkanSpritesState *state)
+     {
+          if (state->device != VK_NULL_HANDLE && !state->deviceLoaded)
+          {
+               // Nothing was made on a device whose functions did not all load
+               if (vkDestroyDevice != nullptr)
+               {
+                    vkDestroyDevice(state->device, nullptr);
+               }
+          }
+          else if (state->device != VK_NULL_HANDLE)
+          {
+               vkDeviceWaitIdle(state->device);
+               for (VulkanSpriteTexture &texture : state->textures)
+               {
+                    vkDestroyImageView(state->device, texture.view, nullptr);
+                    vkDestroyImage(state->device, texture.image, nullptr);
+                    vkFreeMemory(state->device, texture.memory, nullptr);
+               }
+               for (VulkanSpriteFrame &frame : state->frames)
+               {
+                    vkDestroyBuffer(state->device, frame.instances, nullptr);
+                    vkFreeMemory(state->device, frame.instanceMemory, nullptr); // Unmaps it
+                    vkDestroySemaphore(state->device, frame.imageReady, nullptr);
+                    vkDestroyFence(state->device, frame.done, nullptr);
+               }
+               vkDestroyCommandPool(state->device, state->commandPool, nullptr); // Frees the command buffers
+               vkDestroySampler(state->device, state->linear, nullptr);
+               vkDestroySampler(state->device, state->nearest, nullptr);
+               vkDestroyPipeline(state->device, state->pipeline, nullptr);
+               vkDestroyPipelineLayout(state->device, state->pipelineLayout, nullptr);
+               vkDestroyDescriptorPool(state->device, state->descriptorPool, nullptr);
+               vkDestroyDescriptorSetLayout(state->device, state->setLayout, nullptr);
+               destroySwapchainViews(*state);
+               vkDestroySwapchainKHR(state->device, state->swapchain, nullptr);
+               vkDestroyRenderPass(state->device, state->renderPass, nullptr);
+               vkDestroyDevice(state->device, nullptr);
+          }
+          if (state->instance != VK_NULL_HANDLE)
+          {
+               if (state->surface != VK_NULL_HANDLE && vkDestroySurfaceKHR != nullptr)
+               {
+                    vkDestroySurfaceKHR(state->instance, state->surface, nullptr);
+               }
+               if (vkDestroyInstance != nullptr)
+               {
+                    vkDestroyInstance(state->instance, nullptr);
+               }
+          }
+          delete state;
+     }
+}
+
+bool vulkanSpritesCreate(VulkanSprites &sprites, SDL_Window *window, int maxSprites, bool vsync)
+{
+     sprites = {};
+     if ((SDL_GetWindowFlags(window) & SDL_WINDOW_VULKAN) == 0)
+     {
+          SDL_SetError("vulkan_sprites needs a window created with SDL_WINDOW_VULKAN");
+          return false;
+     }
+     if (!loadInstanceFunctions(VK_NULL_HANDLE))
+     {
+          return false;
+     }
+
+     VulkanSpritesState *state = new VulkanSpritesState();
+     state->window = window;
+     state->vsync = vsync;
+     maxSprites = SDL_max(maxSprites, 1);
+     bool ok = createInstance(*state) && pickDevice(*state) && createDevice(*state) && createRenderPass(*state) &&
+               createSwapchain(*state) && createPipeline(*state) && createSamplers(*state) &&
+               createFrames(*state, maxSprites);
+
+     // Texture 0 is solid white, and every slot starts out pointing at it,
+     // so an index never added samples white instead of garbage
+     const Uint32 white = 0xFFFFFFFFu;
+     state->textures.push_back({});
+     ok = ok && createTexture(*state, (const Uint8 *)&white, 1, 1, 4, state->textures[0]);
+     if (!ok)
+     {
+          destroyState(state);
+          return false;
+     }
+     bindTexture(*state, 0, VULKAN_SPRITES_MAX_TEXTURES, state->textures[0], state->nearest);
+
+     sprites.state = state;
+     sprites.width = (int)state->extent.width;
+     sprites.height = (int)state->extent.height;
+     sprites.maxSprites = maxSprites;
+     sprites.textureCount = 1;
+     return true;
+}
+
+void vulkanSpritesDestroy(VulkanSprites &sprites)
+{
+     if (sprites.state != nullptr)
+     {
+          destroyState(sprites.state);
+     }
+     sprites = {};
+}
+
+int vulkanSpritesAddTexture(VulkanSprites &sprites, SDL_Surface *surface, bool linearFilter)
+{
+     VulkanSpritesState *state = sprites.state;
+     if (state == nullptr || surface == nullptr)
+     {
+          SDL_SetError("vulkanSpritesAddTexture needs a renderer and a surface");
+          return -1;
+     }
+     if (sprites.textureCount >= VULKAN_SPRITES_MAX_TEXTURES)
+     {
+          SDL_SetError("All %d Vulkan sprite textures are in use", VULKAN_SPRITES_MAX_TEXTURES);
+          return -1;
+     }
+     // R8G8B8A8 in memory order, whatever the host's byte order
+     SDL_Surface *rgba = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+     if (rgba == nullptr)
+     {
+          return -1;
+     }
+     VulkanSpriteTexture texture;
+     SDL_LockSurface(rgba);
+     const bool ok = createTexture(*state, (const Uint8 *)rgba->pixels, rgba->w, rgba->h, rgba->pitch, texture);
+     SDL_UnlockSurface(rgba);
+     SDL_FreeSurface(rgba);
+     if (!ok)
+     {
+          return -1;
+     }
+
+     // The descriptor set is bound by frames that may still be in flight
+     vkDeviceWaitIdle(state->device);
+     const int index = sprites.textureCount++;
+     state->textures.push_back(texture);
+     bindTexture(*state, index, 1, texture, linearFilter ? state->linear : state->nearest);
+     return index;
+}
+
+VulkanSprite *vulkanSpritesBegin(VulkanSprites &sprites)
+{
+     VulkanSpritesState *state = sprites.state;
+     if (state == nullptr)
+     {
+          SDL_SetError("vulkanSpritesBegin without a renderer");
+          return nullptr;
+     }
+     VulkanSpriteFrame &frame = state->frames[state->frame];
+     if (frame.done == VK_NULL_HANDLE)
+     {
+          SDL_SetError("vulkan_sprites lost a frame fence after a failed submit");
+          return nullptr;
+     }
+     if (vulkanFailed(vkWaitForFences(state->device, 1, &frame.done, VK_TRUE, UINT64_MAX), "vkWaitForFences"))
+     {
+          return nullptr;
+     }
+     return frame.mapped;
+}
+
+bool vulkanSpritesEnd(VulkanSprites &sprites, int count, SDL_Color clear)
+{
+     VulkanSpritesState *state = sprites.state;
+     if (state == nullptr)
+     {
+          SDL_SetError("vulkanSpritesEnd without a renderer");
+          return false;
+     }
+     if (state->swapchainStale)
+     {
+          if (!createSwapchain(*state))
+          {
+               return false;
+          }
+          sprites.width = (int)state->extent.width;
+          sprites.height = (int)state->extent.height;
+          if (state->swapchainStale)
+          {
+               return true; // Minimized
+          }
+     }
+
+     VulkanSpriteFrame &frame = state->frames[state->frame];
+     Uint32 image = 0;
+     VkResult result =
+         vkAcquireNextImageKHR(state->device, state->swapchain, UINT64_MAX, frame.imageReady, VK_NULL_HANDLE, &image);
+     if (result == VK_ERROR_OUT_OF_DATE_KHR)
+     {
+          state->swapchainStale = true;
+          return true;
+     }
+     if (result != VK_SUBOPTIMAL_KHR && vulkanFailed(result, "vkAcquireNextImageKHR"))
+     {
+          return false;
+     }
+     VkCommandBuffer commands = frame.commands;
+     vkResetCommandBuffer(commands, 0);
+     VkCommandBufferBeginInfo begin = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+     begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+     vkBeginCommandBuffer(commands, &begin);
+
+     VkClearValue clearValue;
+     clearValue.color.float32[0] = clear.r / 255.0f;
+     clearValue.color.float32[1] = clear.g / 255.0f;
+     clearValue.color.float32[2] = clear.b / 255.0f;
+     clearValue.color.float32[3] = clear.a / 255.0f;
+     VkRenderPassBeginInfo pass = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+     pass.renderPass = state->renderPass;
+     pass.framebuffer = state->framebuffers[image];
+     pass.renderArea.extent = state->extent;
+     pass.clearValueCount = 1;
+     pass.pClearValues = &clearValue;
+     vkCmdBeginRenderPass(commands, &pass, VK_SUBPASS_CONTENTS_INLINE);
+
+     count = SDL_clamp(count, 0, sprites.maxSprites);
+     if (count > 0)
+     {
+          const VkViewport viewport = {0.0f, 0.0f, (float)state->extent.width, (float)state->extent.height, 0.0f, 1.0f};
+          const VkRect2D scissor = {{0, 0}, state->extent};
+          const float scale[2] = {2.0f / state->extent.width, 2.0f / state->extent.height};
+          const VkDeviceSize offset = 0;
+          vkCmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, state->pipeline);
+          vkCmdSetViewport(commands, 0, 1, &viewport);
+          vkCmdSetScissor(commands, 0, 1, &scissor);
+          vkCmdPushConstants(commands, state->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(scale), scale);
+          vkCmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, state->pipelineLayout, 0, 1,
+                                  &state->descriptors, 0, nullptr);
+          vkCmdBindVertexBuffers(commands, 0, 1, &frame.instances, &offset);
+          vkCmdDraw(commands, 4, (Uint32)count, 0, 0);
+     }
+     vkCmdEndRenderPass(commands);
+     if (vulkanFailed(vkEndCommandBuffer(commands), "vkEndCommandBuffer"))
+     {
+          return false;
+     }
+
+     const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+     VkSubmitInfo submit = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+     submit.waitSemaphoreCount = 1;
+     submit.pWaitSemaphores = &frame.imageReady;
+     submit.pWaitDstStageMask = &waitStage;
+     submit.commandBufferCount = 1;
+     submit.pCommandBuffers = &commands;
+     submit.signalSemaphoreCount = 1;
+     submit.pSignalSemaphores = &state->renderDone[image];
+     // Reset right before the submit that signals it again. A failed
+     // submit leaves it unsignaled, and the next vulkanSpritesBegin() on
+     // this frame would wait forever, so it is replaced by a signaled one
+     vkResetFences(state->device, 1, &frame.done);
+     if (vulkanFailed(vkQueueSubmit(state->queue, 1, &submit, frame.done), "vkQueueSubmit"))
+     {
+          vkDestroyFence(state->device, frame.done, nullptr);
+          VkFenceCreateInfo fence = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+          fence.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+          if (vkCreateFence(state->device, &fence, nullptr, &frame.done) != VK_SUCCESS)
+          {
+               frame.done = VK_NULL_HANDLE;
+          }
+          return false;
+     }
+
+     VkPresentInfoKHR present = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
+     present.waitSemaphoreCount = 1;
+     present.pWaitSemaphores = &state->renderDone[image];
+     present.swapchainCount = 1;
+     present.pSwapchains = &state->swapchain;
+     present.pImageIndices = &image;
+     result = vkQueuePresentKHR(state->queue, &present);
+     state->frame = (state->frame + 1) % VULKAN_SPRITES_FRAMES_IN_FLIGHT;
+     sprites.framesPresented++;
+     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+     {
+          state->swapchainStale = true;
+          return true;
+     }
+     return !vulkanFailed(result, "vkQueuePresentKHR");
+}
+
+#else
+
+bool vulkanSpritesCreate(VulkanSprites &sprites, SDL_Window *, int, bool)
+{
+     sprites = {};
+     SDL_SetError("Built without Vulkan sprites (define CATCH_VULKAN, see make vulkanbench)");
+     return false;
+}
+
+void vulkanSpritesDestroy(VulkanSprites &sprites)
+{
+     sprites = {};
+}
+
+int vulkanSpritesAddTexture(VulkanSprites &, SDL_Surface *, bool)
+{
+     SDL_SetError("Built without Vulkan sprites");
+     return -1;
+}
+
+VulkanSprite *vulkanSpritesBegin(VulkanSprites &)
+{
+     SDL_SetError("Built without Vulkan sprites");
+     return nullptr;
+}
+
+bool vulkanSpritesEnd(VulkanSprites &, int, SDL_Color)
+{
+     SDL_SetError("Built without Vulkan sprites");
+     return false;
+}
+
+#endif
@@ -0,0 +1,76 @@
+// Description:
+// Sprite renderer on Vulkan, for scenes with more sprites than
+// SDL_Renderer's per-vertex CPU work can keep up with (100k and up). Each
+// sprite is one 32-byte instance written straight into a persistently
+// mapped buffer; the vertex shader expands it into a quad, so there is no
+// per-frame vertex build, no index buffer and one draw call per frame.
+// All textures sit in one descriptor array and every sprite names its own
+// by index, so switching textures does not split the draw.
+//
+// VULKAN_SPRITES_FRAMES_IN_FLIGHT frames are recorded ahead of the GPU,
+// each with its own instance buffer, command buffer and fence, so the CPU
+// fills frame N+1 while the GPU draws frame N; vulkanSpritesBegin() only
+// waits when it gets that far ahead.
+//
+// Build with CATCH_VULKAN defined and the Vulkan SDK's headers (make
+// vulkanbench); the shaders in src/shaders/ are compiled to SPIR-V and built
+// in. The Vulkan loader itself is the one SDL loads for a window created
+// with SDL_WINDOW_VULKAN, so nothing extra is linked. Without CATCH_VULKAN
+// every call fails with SDL's error set. One renderer at a time.
+//
+// Needs Vulkan 1.2 with shaderSampledImageArrayNonUniformIndexing, which
+// desktop GPUs from the last several years have.
+// =============================================================================
+
+#ifndef VULKAN_SPRITES_H
+#define VULKAN_SPRITES_H
+
+#include <SDL2/SDL.h>
+
+#define VULKAN_SPRITES_FRAMES_IN_FLIGHT 2
+#define VULKAN_SPRITES_MAX_TEXTURES 256 // Matches the array in src/shaders/vulkan_sprite.frag
+
+// One sprite as the GPU reads it
+struct VulkanSprite
+{
+     float x, y; // Top-left corner in drawable pixels
+     float width, height;
+     Uint16 u0, v0, u1, v1; // Texture rect, 0..65535 across the texture
+     SDL_Color color;       // Tint, multiplied with the texture
+     Uint32 texture;        // From vulkanSpritesAddTexture(); 0 is solid white
+};
+
+struct VulkanSpritesState;
+
+struct VulkanSprites
+{
+     VulkanSpritesState *state;
+     int width, height; // Drawable size of the current swapchain
+     int maxSprites;
+     int textureCount; // Including the white texture 0
+     Uint64 framesPresented;
+};
+
+// Set up Vulkan on `window`, which must have been created with
+// SDL_WINDOW_VULKAN, with room for `maxSprites` per frame. Without `vsync`
+// it presents through mailbox (or immediate) when the driver offers one
+bool vulkanSpritesCreate(VulkanSprites &sprites, SDL_Window *window, int maxSprites, bool vsync = true);
+
+void vulkanSpritesDestroy(VulkanSprites &sprites);
+
+// Upload `surface` and give it the next texture index; -1 with SDL's error
+// set when it fails or all VULKAN_SPRITES_MAX_TEXTURES are taken. Waits for
+// the GPU to go idle, so add textures while loading, not per frame
+int vulkanSpritesAddTexture(VulkanSprites &sprites, SDL_Surface *surface, bool linearFilter = true);
+
+// The instance buffer for the next frame, room for maxSprites. Waits only
+// if the GPU is still drawing from it, VULKAN_SPRITES_FRAMES_IN_FLIGHT
+// frames back. nullptr on error
+VulkanSprite *vulkanSpritesBegin(VulkanSprites &sprites);
+
+// Draw the first `count` sprites written since vulkanSpritesBegin(), in
+// order, over `clear`, and present. A swapchain gone out of date (resize,
+// minimize) is rebuilt and the frame skipped
+bool vulkanSpritesEnd(VulkanSprites &sprites, int count, SDL_Color clear);
+
+#endif // VULKAN_SPRITES_H
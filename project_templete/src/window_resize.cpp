@@ -0,0 +1,137 @@
+#include "window_resize.h"
+
+#include "event_watch.h"
+
+namespace
+{
+     void readSizes(const WindowResize &resize, int &windowW, int &windowH, int &drawableW, int &drawableH)
+     {
+          SDL_GetWindowSize(resize.window, &windowW, &windowH);
+          if (resize.renderer == nullptr || SDL_GetRendererOutputSize(resize.renderer, &drawableW, &drawableH) != 0)
+          {
+               SDL_GetWindowSizeInPixels(resize.window, &drawableW, &drawableH);
+          }
+     }
+
+     // Runs as the events are pushed, which for these is the main thread,
+     // inside SDL_PumpEvents; on Windows also inside the modal sizing loop
+     int resizeWatch(void *userdata, SDL_Event *event)
+     {
+          WindowResize &resize = *(WindowResize *)userdata;
+          if (event->type == SDL_RENDER_TARGETS_RESET)
+          {
+               resize.pending |= WINDOW_RESIZE_TARGETS;
+               return 0;
+          }
+          if (event->type == SDL_RENDER_DEVICE_RESET)
+          {
+               resize.pending |= WINDOW_RESIZE_TARGETS | WINDOW_RESIZE_TEXTURES;
+               return 0;
+          }
+          if (event->type != SDL_WINDOWEVENT || event->window.windowID != SDL_GetWindowID(resize.window))
+          {
+               return 0;
+          }
+          switch (event->window.event)
+          {
+          case SDL_WINDOWEVENT_SIZE_CHANGED:
+               // Provisional until windowResizeUpdate() compares the sizes
+               resize.pending |= WINDOW_RESIZE_DRAWABLE;
+               resize.live = true;
+               resize.sizeEvents++;
+               break;
+          case SDL_WINDOWEVENT_DISPLAY_CHANGED:
+               resize.pending |= WINDOW_RESIZE_DENSITY;
+               break;
+          case SDL_WINDOWEVENT_EXPOSED:
+               // SDL's own renderer watch has seen the SIZE_CHANGED before
+               // this, so the viewport already matches the new size,
+               // and lost targets are not worth showing again
+               if (resize.live && resize.redraw != nullptr &&
+                   (resize.pending & (WINDOW_RESIZE_TARGETS | WINDOW_RESIZE_TEXTURES)) == 0)
+               {
+                    resize.redraw(resize.redrawData);
+                    resize.liveRedraws++;
+               }
+               break;
+          default:
+               break;
+          }
+          return 0;
+     }
+}
+
+Uint32 windowResizeEventType()
+{
+     static const Uint32 type = SDL_RegisterEvents(1);
+     return type;
+}
+
+bool windowResizeInit(WindowResize &resize, SDL_Window *window, SDL_Renderer *renderer, WindowResizeRedraw redraw,
+                      void *redrawData)
+{
+     resize.window = window;
+     resize.renderer = renderer;
+     readSizes(resize, resize.windowWidth, resize.windowHeight, resize.drawableWidth, resize.drawableHeight);
+     resize.pixelDensity = resize.windowWidth > 0 ? (float)resize.drawableWidth / resize.windowWidth : 1.0f;
+     resize.displayIndex = SDL_GetWindowDisplayIndex(window);
+     resize.pending = 0;
+     resize.live = false;
+     resize.redraw = redraw;
+     resize.redrawData = redrawData;
+     resize.updates = 0;
+     resize.sizeEvents = 0;
+     resize.liveRedraws = 0;
+
+     const EventTypeRange ranges[] = {{SDL_WINDOWEVENT, SDL_WINDOWEVENT},
+                                      {SDL_RENDER_TARGETS_RESET, SDL_RENDER_DEVICE_RESET}};
+     return eventWatchAdd(resizeWatch, &resize, "window_resize", ranges, SDL_arraysize(ranges));
+}
+
+void windowResizeQuit(WindowResize &resize)
+{
+     eventWatchDel(resizeWatch, &resize);
+}
+
+Uint32 windowResizeUpdate(WindowResize &resize)
+{
+     resize.live = false;
+     if (resize.pending == 0)
+     {
+          return 0;
+     }
+
+     Uint32 flags = resize.pending & (WINDOW_RESIZE_TARGETS | WINDOW_RESIZE_TEXTURES);
+     resize.pending = 0;
+     int windowW, windowH, drawableW, drawableH;
+     readSizes(resize, windowW, windowH, drawableW, drawableH);
+     if (drawableW != resize.drawableWidth || drawableH != resize.drawableHeight)
+     {
+          flags |= WINDOW_RESIZE_DRAWABLE;
+     }
+     // A minimized window reports no size; keep the density it had
+     const float density = windowW > 0 && drawableW > 0 ? (float)drawableW / windowW : resize.pixelDensity;
+     if (density != resize.pixelDensity)
+     {
+          flags |= WINDOW_RESIZE_DENSITY;
+     }
+     resize.windowWidth = windowW;
+     resize.windowHeight = windowH;
+     resize.drawableWidth = drawableW;
+     resize.drawableHeight = drawableH;
+     resize.pixelDensity = density;
+     resize.displayIndex = SDL_GetWindowDisplayIndex(resize.window);
+
+     if (flags != 0 && windowResizeEventType() != (Uint32)-1)
+     {
+          SDL_Event event;
+          SDL_zero(event);
+          event.type = windowResizeEventType();
+          event.user.windowID = SDL_GetWindowID(resize.window);
+          event.user.code = (Sint32)flags;
+          event.user.data1 = &resize;
+          SDL_PushEvent(&event);
+          resize.updates++;
+     }
+     return flags;
+}
@@ -0,0 +1,77 @@
+// Description:
+// One place that notices the window's drawable size or pixel density
+// changing and tells the rest of the app once, instead of every module
+// reacting to each of the SDL_WINDOWEVENT_SIZE_CHANGED events a drag
+// produces (one per mouse move) by dropping and recreating its targets.
+// Changes gathered since the last frame are applied by windowResizeUpdate()
+// at the top of the next one: it reads the sizes once, works out what was
+// invalidated and pushes a single windowResizeEventType() event with those
+// WINDOW_RESIZE_* flags in user.code and the WindowResize in user.data1.
+// Modules then reallocate lazily, on their next use, only what the flags
+// name; dirty_regions redraws the whole canvas on any of them and
+// recreates it when textures are lost.
+//
+// SDL_Renderer resizes its swapchain in place when the window does, so a
+// resize by itself loses no textures; only SDL_RENDER_TARGETS_RESET and
+// SDL_RENDER_DEVICE_RESET do, and they are folded into the same event.
+//
+// On Windows the main loop does not run while the user drags the window
+// border: SDL is inside the system's modal sizing loop until the mouse is
+// released, and the window shows stretched or black. The window events
+// still reach event watches, on the main thread, so with a `redraw`
+// callback the retained last frame is presented again at the new size on
+// each SDL_WINDOWEVENT_EXPOSED of a resize (dirtyRegionsPresentRetained()
+// fits), and the drag stays live. The callback may only use the renderer;
+// it runs in the middle of SDL_PumpEvents.
+// =============================================================================
+
+#ifndef WINDOW_RESIZE_H
+#define WINDOW_RESIZE_H
+
+#include <SDL2/SDL.h>
+
+#define WINDOW_RESIZE_DRAWABLE 0x1u // Drawable size changed: output-sized targets are the wrong size
+#define WINDOW_RESIZE_DENSITY 0x2u  // Pixels per window unit changed: text rasterized for the old density
+#define WINDOW_RESIZE_TARGETS 0x4u  // Render target contents are lost (the textures remain)
+#define WINDOW_RESIZE_TEXTURES 0x8u // Every texture is lost and must be created again
+
+typedef void (*WindowResizeRedraw)(void *userdata);
+
+struct WindowResize
+{
+     SDL_Window *window;
+     SDL_Renderer *renderer;
+     int windowWidth, windowHeight;     // In window units
+     int drawableWidth, drawableHeight; // In pixels
+     float pixelDensity;                // drawableWidth / windowWidth
+     int displayIndex;
+
+     Uint32 pending; // WINDOW_RESIZE_* gathered since the last update
+     bool live;      // A resize is under way and the loop has not drawn since
+     WindowResizeRedraw redraw;
+     void *redrawData;
+
+     int updates;     // Updates that pushed an event
+     int sizeEvents;  // SDL_WINDOWEVENT_SIZE_CHANGED seen, to compare with updates
+     int liveRedraws; // Calls to `redraw`
+};
+
+// The event type pushed by windowResizeUpdate(); (Uint32)-1 if SDL has no
+// user event types left
+Uint32 windowResizeEventType();
+
+// Start tracking `window`, drawn by `renderer`; `redraw` may be null. The
+// watch holds `resize` by address, so it must stay put until
+// windowResizeQuit(). False with SDL's error set when the watch can't be
+// added
+bool windowResizeInit(WindowResize &resize, SDL_Window *window, SDL_Renderer *renderer,
+                      WindowResizeRedraw redraw = nullptr, void *redrawData = nullptr);
+
+void windowResizeQuit(WindowResize &resize);
+
+// Once per frame before drawing. Applies what changed since the last call,
+// pushes one event if anything did, and returns the WINDOW_RESIZE_* flags
+// (0 for none), for a caller that would rather act at once
+Uint32 windowResizeUpdate(WindowResize &resize);
+
+#endif // WINDOW_RESIZE_H
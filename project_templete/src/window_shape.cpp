@@ -0,0 +1,341 @@
+#include "window_shape.h"
+
+#include <SDL2/SDL_shape.h>
+#include <algorithm>
+#include <climits>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <SDL2/SDL_syswm.h>
+#endif
+
+namespace
+{
+#if defined(_WIN32)
+     // GDI is loaded at run time: the dynamic build does not link gdi32
+     typedef HRGN(WINAPI *CreateRectRgnFunction)(int, int, int, int);
+     typedef HRGN(WINAPI *ExtCreateRegionFunction)(const XFORM *, DWORD, const RGNDATA *);
+     typedef int(WINAPI *CombineRgnFunction)(HRGN, HRGN, HRGN, int);
+     typedef BOOL(WINAPI *DeleteObjectFunction)(HGDIOBJ);
+
+     struct GdiFunctions
+     {
+          CreateRectRgnFunction createRect;
+          ExtCreateRegionFunction createRegion;
+          CombineRgnFunction combine;
+          DeleteObjectFunction destroy;
+     };
+
+     const GdiFunctions &gdi()
+     {
+          static const GdiFunctions functions = []
+          {
+               GdiFunctions found = {nullptr, nullptr, nullptr, nullptr};
+               HMODULE module = LoadLibraryW(L"gdi32.dll");
+               if (module != NULL)
+               {
+                    found.createRect = (CreateRectRgnFunction)(void *)GetProcAddress(module, "CreateRectRgn");
+                    found.createRegion = (ExtCreateRegionFunction)(void *)GetProcAddress(module, "ExtCreateRegion");
+                    found.combine = (CombineRgnFunction)(void *)GetProcAddress(module, "CombineRgn");
+                    found.destroy = (DeleteObjectFunction)(void *)GetProcAddress(module, "DeleteObject");
+               }
+               if (found.createRect == nullptr || found.createRegion == nullptr || found.combine == nullptr ||
+                   found.destroy == nullptr)
+               {
+                    found = {nullptr, nullptr, nullptr, nullptr};
+               }
+               return found;
+          }();
+          return functions;
+     }
+
+     HWND windowHandle(SDL_Window *window)
+     {
+          SDL_SysWMinfo info;
+          SDL_VERSION(&info.version);
+          if (!SDL_GetWindowWMInfo(window, &info) || info.subsystem != SDL_SYSWM_WINDOWS)
+          {
+               return NULL;
+          }
+          return info.info.win.window;
+     }
+
+     // XOR the changed spans into the kept region and hand the window a copy
+     // (SetWindowRgn takes ownership of what it is given)
+     bool applyDeltas(WindowShape &shape)
+     {
+          const GdiFunctions &g = gdi();
+          const HWND hwnd = windowHandle(shape.window);
+          if (hwnd == NULL)
+          {
+               SDL_SetError("window_shape: no window handle");
+               return false;
+          }
+          const DWORD count = (DWORD)(shape.deltas.size() / 3);
+          std::vector<Uint8> buffer(sizeof(RGNDATAHEADER) + count * sizeof(RECT));
+          RGNDATA *data = (RGNDATA *)buffer.data();
+          data->rdh.dwSize = sizeof(RGNDATAHEADER);
+          data->rdh.iType = RDH_RECTANGLES;
+          data->rdh.nCount = count;
+          data->rdh.nRgnSize = count * sizeof(RECT);
+          data->rdh.rcBound = {0, 0, shape.width, shape.height};
+          RECT *rects = (RECT *)data->Buffer;
+          for (DWORD i = 0; i < count; i++)
+          {
+               const int *d = &shape.deltas[i * 3];
+               rects[i] = {d[0], d[2], d[1], d[2] + 1};
+          }
+
+          const HRGN delta = g.createRegion(nullptr, (DWORD)buffer.size(), data);
+          const HRGN copy = g.createRect(0, 0, 0, 0);
+          if (delta == NULL || copy == NULL)
+          {
+               if (delta != NULL)
+               {
+                    g.destroy(delta);
+               }
+               if (copy != NULL)
+               {
+                    g.destroy(copy);
+               }
+               SDL_SetError("window_shape: unable to create a region");
+               return false;
+          }
+          g.combine((HRGN)shape.region, (HRGN)shape.region, delta, RGN_XOR);
+          g.destroy(delta);
+          g.combine(copy, (HRGN)shape.region, NULL, RGN_COPY);
+          if (SetWindowRgn(hwnd, copy, TRUE) == 0)
+          {
+               g.destroy(copy);
+               SDL_SetError("window_shape: SetWindowRgn failed");
+               return false;
+          }
+          return true;
+     }
+#endif
+
+     void scanRow(const Uint8 *alpha, int width, Uint8 threshold, std::vector<WindowShapeSpan> &spans)
+     {
+          spans.clear();
+          int x = 0;
+          while (x < width)
+          {
+               while (x < width && alpha[x * 4] < threshold)
+               {
+                    x++;
+               }
+               const int start = x;
+               while (x < width && alpha[x * 4] >= threshold)
+               {
+                    x++;
+               }
+               if (x > start)
+               {
+                    spans.push_back({(Uint16)start, (Uint16)x});
+               }
+          }
+     }
+
+     bool sameSpans(const std::vector<WindowShapeSpan> &a, const std::vector<WindowShapeSpan> &b)
+     {
+          return a.size() == b.size() &&
+                 std::equal(a.begin(), a.end(), b.begin(), [](const WindowShapeSpan &l, const WindowShapeSpan &r)
+                            { return l.x0 == r.x0 && l.x1 == r.x1; });
+     }
+
+     // Both lists are sorted and disjoint, so coverage flips at each of
+     // their edges; an edge in both flips twice and drops out. Whatever is
+     // left pairs up into the spans covered by exactly one of them
+     int appendDifference(const std::vector<WindowShapeSpan> &a, const std::vector<WindowShapeSpan> &b, int y,
+                          std::vector<int> &deltas)
+     {
+          const size_t edgesA = a.size() * 2, edgesB = b.size() * 2;
+          size_t i = 0, j = 0;
+          int open = -1, spans = 0;
+          while (i < edgesA || j < edgesB)
+          {
+               const int ea = i < edgesA ? (i % 2 == 0 ? a[i / 2].x0 : a[i / 2].x1) : INT_MAX;
+               const int eb = j < edgesB ? (j % 2 == 0 ? b[j / 2].x0 : b[j / 2].x1) : INT_MAX;
+               int edge;
+               if (ea == eb)
+               {
+                    i++;
+                    j++;
+                    continue;
+               }
+               if (ea < eb)
+               {
+                    edge = ea;
+                    i++;
+               }
+               else
+               {
+                    edge = eb;
+                    j++;
+               }
+               if (open < 0)
+               {
+                    open = edge;
+               }
+               else
+               {
+                    if (edge > open)
+                    {
+                         deltas.insert(deltas.end(), {open, edge, y});
+                         spans++;
+                    }
+                    open = -1;
+               }
+          }
+          return spans;
+     }
+}
+
+bool windowShapeInit(WindowShape &shape, SDL_Window *window, Uint8 threshold)
+{
+     shape.window = window;
+     shape.threshold = SDL_max(threshold, (Uint8)1);
+     shape.width = 0;
+     shape.height = 0;
+     shape.rows.clear();
+     shape.region = nullptr;
+     shape.rowsChanged = 0;
+     shape.spansChanged = 0;
+     shape.updates = 0;
+     shape.skipped = 0;
+
+#if defined(_WIN32)
+     if (gdi().createRect != nullptr && windowHandle(window) != NULL)
+     {
+          shape.region = gdi().createRect(0, 0, 0, 0);
+     }
+     if (shape.region != nullptr)
+     {
+          return true;
+     }
+#endif
+     if (!SDL_IsShapedWindow(window))
+     {
+          SDL_SetError("window_shape: the window was not created by SDL_CreateShapedWindow");
+          return false;
+     }
+     return true;
+}
+
+int windowShapeUpdate(WindowShape &shape, SDL_Surface *mask)
+{
+     if (mask == nullptr || mask->format->Amask == 0)
+     {
+          SDL_SetError("window_shape: the mask has no alpha channel");
+          return -1;
+     }
+
+     // Read the alpha byte in place from 32-bit masks; convert anything else
+     SDL_Surface *pixels = mask;
+     if (mask->format->BytesPerPixel != 4)
+     {
+          pixels = SDL_ConvertSurfaceFormat(mask, SDL_PIXELFORMAT_ARGB8888, 0);
+          if (pixels == nullptr)
+          {
+               return -1;
+          }
+     }
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+     const int alphaByte = pixels->format->Ashift / 8;
+#else
+     const int alphaByte = 3 - pixels->format->Ashift / 8;
+#endif
+
+     if (pixels->w != shape.width || pixels->h != shape.height)
+     {
+          // Empty rows against the new mask: every opaque span is a change
+          shape.width = pixels->w;
+          shape.height = pixels->h;
+          shape.rows.assign(pixels->h, std::vector<WindowShapeSpan>());
+#if defined(_WIN32)
+          if (shape.region != nullptr)
+          {
+               gdi().combine((HRGN)shape.region, (HRGN)shape.region, (HRGN)shape.region, RGN_XOR);
+          }
+#endif
+     }
+
+     const bool locked = SDL_MUSTLOCK(pixels) && SDL_LockSurface(pixels) == 0;
+     shape.deltas.clear();
+     shape.rowsChanged = 0;
+     shape.spansChanged = 0;
+     for (int y = 0; y < shape.height; y++)
+     {
+          const Uint8 *row = (const Uint8 *)pixels->pixels + y * pixels->pitch + alphaByte;
+          scanRow(row, shape.width, shape.threshold, shape.scratch);
+          if (sameSpans(shape.scratch, shape.rows[y]))
+          {
+               continue;
+          }
+          if (shape.region != nullptr)
+          {
+               shape.spansChanged += appendDifference(shape.rows[y], shape.scratch, y, shape.deltas);
+          }
+          shape.rows[y].swap(shape.scratch);
+          shape.rowsChanged++;
+     }
+     if (locked)
+     {
+          SDL_UnlockSurface(pixels);
+     }
+
+     int result = shape.rowsChanged;
+     if (shape.rowsChanged == 0)
+     {
+          shape.skipped++;
+     }
+     else
+     {
+          bool applied = false;
+#if defined(_WIN32)
+          if (shape.region != nullptr)
+          {
+               applied = applyDeltas(shape);
+          }
+          else
+#endif
+          {
+               SDL_WindowShapeMode mode;
+               mode.mode = ShapeModeBinarizeAlpha;
+               mode.parameters.binarizationCutoff = shape.threshold;
+               applied = SDL_SetWindowShape(shape.window, mask, &mode) == 0;
+          }
+          if (applied)
+          {
+               shape.updates++;
+          }
+          else
+          {
+               // Nothing is known about what the window holds now; rebuild next time
+               shape.width = 0;
+               shape.height = 0;
+               result = -1;
+          }
+     }
+
+     if (pixels != mask)
+     {
+          SDL_FreeSurface(pixels);
+     }
+     return result;
+}
+
+void windowShapeDestroy(WindowShape &shape)
+{
+#if defined(_WIN32)
+     if (shape.region != nullptr)
+     {
+          gdi().destroy((HRGN)shape.region);
+     }
+#endif
+     shape.region = nullptr;
+     shape.rows.clear();
+     shape.width = 0;
+     shape.height = 0;
+}
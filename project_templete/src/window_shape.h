@@ -0,0 +1,58 @@
+// Description:
+// Animated window shapes from an alpha mask, updated by what changed.
+// SDL_SetWindowShape rebuilds the whole OS region from the mask on every
+// call (a quadtree, then one region union per leaf), which limits an
+// animated desktop overlay to a few frames per second. Here each mask row
+// is reduced to its opaque spans and kept; a new mask is compared row by
+// row, and only rows whose spans differ are applied.
+//
+// On Windows the region is kept as a GDI region. The spans that changed
+// (old XOR new, per row) become one delta region, which is XORed into it,
+// and a copy goes to SetWindowRgn, so a frame costs in proportion to the
+// rows that moved, not the window's area. Use a borderless window: the
+// region is in window coordinates, frame included. Elsewhere the mask
+// goes to SDL_SetWindowShape when any row changed and not at all when none
+// did; that needs a window from SDL_CreateShapedWindow.
+//
+// Main thread only, like the window itself.
+// =============================================================================
+
+#ifndef WINDOW_SHAPE_H
+#define WINDOW_SHAPE_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct WindowShapeSpan
+{
+     Uint16 x0, x1; // Opaque from x0 up to, not including, x1
+};
+
+struct WindowShape
+{
+     SDL_Window *window;
+     Uint8 threshold; // Alpha at or above this is inside the window
+     int width, height;
+     std::vector<std::vector<WindowShapeSpan>> rows; // As last applied
+     std::vector<WindowShapeSpan> scratch;
+     std::vector<int> deltas; // Changed [x0, x1) pairs by row, for the region
+     void *region;            // HRGN on Windows, else null
+
+     int rowsChanged;  // By the last update
+     int spansChanged; // Delta spans applied by the last update
+     int updates;      // Updates that changed the shape
+     int skipped;      // Updates that found nothing to apply
+};
+
+// Shape `window` from masks whose alpha reaches `threshold`. False with
+// SDL's error set when this platform has no path for `window`
+bool windowShapeInit(WindowShape &shape, SDL_Window *window, Uint8 threshold = 128);
+
+// Apply `mask` (any format with an alpha channel, window-sized). Returns
+// the rows that changed, 0 when the shape stayed as it was, -1 with SDL's
+// error set on failure. A mask of another size replaces the whole shape
+int windowShapeUpdate(WindowShape &shape, SDL_Surface *mask);
+
+void windowShapeDestroy(WindowShape &shape);
+
+#endif // WINDOW_SHAPE_H
@@ -0,0 +1,852 @@
+#include "yuv_convert.h"
+
+#include <cstring>
+#include <vector>
+
+// The float kernels must round exactly like the reference's separate
+// multiplies and adds
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)) && defined(__GNUC__) && !defined(__EMSCRIPTEN__)
+#define YUV_CONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define YUV_CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+     // RGB -> YUV constants, in the form testyuv_cvt.c computes them
+     struct Forward
+     {
+          bool jpeg;
+          float kr, kb, kg;
+          float uScale, vScale; // (1 - Kb) * 255 and (1 - Kr) * 255
+     };
+
+     // YUV -> RGB in 14-bit fixed point
+     struct Inverse
+     {
+          int yOffset;
+          int cy;
+          int rv, gu, gv, bu;
+     };
+
+     const int INVERSE_SHIFT = 14;
+
+     // Per-pixel stages: RGB24 to full-resolution Y, U and V rows, and back
+     typedef void (*FromRgbFn)(const Uint8 *rgb, int count, Uint8 *y, Uint8 *u, Uint8 *v, const Forward &f);
+     typedef void (*ToRgbFn)(const Uint8 *y, const Uint8 *u, const Uint8 *v, int count, Uint8 *rgb,
+                             const Inverse &c);
+
+     SDL_YUV_CONVERSION_MODE resolveMode(SDL_YUV_CONVERSION_MODE mode, int width, int height)
+     {
+          return mode == SDL_YUV_CONVERSION_AUTOMATIC ? SDL_GetYUVConversionModeForResolution(width, height) : mode;
+     }
+
+     Forward forwardFor(SDL_YUV_CONVERSION_MODE mode)
+     {
+          Forward f;
+          f.jpeg = mode == SDL_YUV_CONVERSION_JPEG;
+          f.kr = mode == SDL_YUV_CONVERSION_BT709 ? 0.2126f : 0.299f;
+          f.kb = mode == SDL_YUV_CONVERSION_BT709 ? 0.0722f : 0.114f;
+          f.kg = 1.0f - f.kr - f.kb;
+          f.uScale = (1.0f - f.kb) * 255.0f;
+          f.vScale = (1.0f - f.kr) * 255.0f;
+          return f;
+     }
+
+     Inverse inverseFor(SDL_YUV_CONVERSION_MODE mode)
+     {
+          double yScale, rv, bu, gu, gv;
+          int yOffset;
+          if (mode == SDL_YUV_CONVERSION_JPEG)
+          {
+               // Undo U = (B - Y) * 0.565 + 128 and V = (R - Y) * 0.713 + 128
+               yOffset = 0;
+               yScale = 1.0;
+               rv = 1.0 / 0.713;
+               bu = 1.0 / 0.565;
+               gu = -0.114 * bu / 0.587;
+               gv = -0.299 * rv / 0.587;
+          }
+          else
+          {
+               double kr = mode == SDL_YUV_CONVERSION_BT709 ? 0.2126 : 0.299;
+               double kb = mode == SDL_YUV_CONVERSION_BT709 ? 0.0722 : 0.114;
+               double kg = 1.0 - kr - kb;
+               yOffset = 16;
+               yScale = 255.0 / 219.0;
+               rv = (1.0 - kr) * 255.0 / 112.0;
+               bu = (1.0 - kb) * 255.0 / 112.0;
+               gu = -kb * bu / kg;
+               gv = -kr * rv / kg;
+          }
+          const double one = 1 << INVERSE_SHIFT;
+          Inverse c;
+          c.yOffset = yOffset;
+          c.cy = (int)SDL_lround(yScale * one);
+          c.rv = (int)SDL_lround(rv * one);
+          c.gu = (int)SDL_lround(gu * one);
+          c.gv = (int)SDL_lround(gv * one);
+          c.bu = (int)SDL_lround(bu * one);
+          return c;
+     }
+
+     // --- Scalar kernels, the reference arithmetic ---
+
+     void fromRgbScalar(const Uint8 *rgb, int count, Uint8 *y, Uint8 *u, Uint8 *v, const Forward &f)
+     {
+          for (int i = 0; i < count; i++, rgb += 3)
+          {
+               if (f.jpeg)
+               {
+                    int luma = (int)(0.299 * rgb[0] + 0.587 * rgb[1] + 0.114 * rgb[2]);
+                    y[i] = (Uint8)luma;
+                    u[i] = (Uint8)(int)((rgb[2] - luma) * 0.565 + 128);
+                    v[i] = (Uint8)(int)((rgb[0] - luma) * 0.713 + 128);
+               }
+               else
+               {
+                    float r = rgb[0], g = rgb[1], b = rgb[2];
+                    float l = f.kr * r + f.kb * b + f.kg * g;
+                    y[i] = (Uint8)SDL_floorf(219.0f * l / 255.0f + 16.0f + 0.5f);
+                    float cb = SDL_floorf(112.0f * (b - l) / f.uScale + 128.0f + 0.5f);
+                    float cr = SDL_floorf(112.0f * (r - l) / f.vScale + 128.0f + 0.5f);
+                    u[i] = (Uint8)SDL_clamp(cb, 0.0f, 255.0f);
+                    v[i] = (Uint8)SDL_clamp(cr, 0.0f, 255.0f);
+               }
+          }
+     }
+
+     void toRgbScalar(const Uint8 *y, const Uint8 *u, const Uint8 *v, int count, Uint8 *rgb, const Inverse &c)
+     {
+          const int round = 1 << (INVERSE_SHIFT - 1);
+          for (int i = 0; i < count; i++, rgb += 3)
+          {
+               int luma = c.cy * (y[i] - c.yOffset) + round;
+               int cb = u[i] - 128, cr = v[i] - 128;
+               int r = (luma + c.rv * cr) >> INVERSE_SHIFT;
+               int g = (luma + c.gu * cb + c.gv * cr) >> INVERSE_SHIFT;
+               int b = (luma + c.bu * cb) >> INVERSE_SHIFT;
+               rgb[0] = (Uint8)SDL_clamp(r, 0, 255);
+               rgb[1] = (Uint8)SDL_clamp(g, 0, 255);
+               rgb[2] = (Uint8)SDL_clamp(b, 0, 255);
+          }
+     }
+
+#ifdef YUV_CONVERT_X86
+     // --- SSE4.1: 4 pixels per step ---
+
+     __attribute__((target("sse4.1"))) inline void forwardFloatSse41(__m128i r, __m128i g, __m128i b,
+                                                                      const Forward &f, __m128i &y, __m128i &u,
+                                                                      __m128i &v)
+     {
+          const __m128 half = _mm_set1_ps(0.5f);
+          const __m128 max = _mm_set1_ps(255.0f);
+          const __m128 zero = _mm_setzero_ps();
+          __m128 rf = _mm_cvtepi32_ps(r), gf = _mm_cvtepi32_ps(g), bf = _mm_cvtepi32_ps(b);
+          __m128 l = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(f.kr), rf), _mm_mul_ps(_mm_set1_ps(f.kb), bf)),
+                                _mm_mul_ps(_mm_set1_ps(f.kg), gf));
+          __m128 yf = _mm_div_ps(_mm_mul_ps(_mm_set1_ps(219.0f), l), max);
+          yf = _mm_floor_ps(_mm_add_ps(_mm_add_ps(yf, _mm_set1_ps(16.0f)), half));
+          __m128 uf = _mm_div_ps(_mm_mul_ps(_mm_set1_ps(112.0f), _mm_sub_ps(bf, l)), _mm_set1_ps(f.uScale));
+          uf = _mm_floor_ps(_mm_add_ps(_mm_add_ps(uf, _mm_set1_ps(128.0f)), half));
+          __m128 vf = _mm_div_ps(_mm_mul_ps(_mm_set1_ps(112.0f), _mm_sub_ps(rf, l)), _mm_set1_ps(f.vScale));
+          vf = _mm_floor_ps(_mm_add_ps(_mm_add_ps(vf, _mm_set1_ps(128.0f)), half));
+          y = _mm_cvttps_epi32(yf);
+          u = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(uf, zero), max));
+          v = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(vf, zero), max));
+     }
+
+     // (int)(x[0..1] * scale + offset) for the low two lanes of `x`
+     __attribute__((target("sse4.1"))) inline __m128i scaleTruncSse41(__m128i x, double scale, double offset)
+     {
+          __m128d d = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(x), _mm_set1_pd(scale)), _mm_set1_pd(offset));
+          return _mm_cvttpd_epi32(d);
+     }
+
+     __attribute__((target("sse4.1"))) inline __m128i lumaJpegSse41(__m128i r, __m128i g, __m128i b)
+     {
+          __m128d l = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_set1_pd(0.299), _mm_cvtepi32_pd(r)),
+                                            _mm_mul_pd(_mm_set1_pd(0.587), _mm_cvtepi32_pd(g))),
+                                 _mm_mul_pd(_mm_set1_pd(0.114), _mm_cvtepi32_pd(b)));
+          return _mm_cvttpd_epi32(l);
+     }
+
+     __attribute__((target("sse4.1"))) inline void forwardJpegSse41(__m128i r, __m128i g, __m128i b,
+                                                                     __m128i &y, __m128i &u, __m128i &v)
+     {
+          __m128i yLo = lumaJpegSse41(r, g, b);
+          __m128i yHi = lumaJpegSse41(_mm_srli_si128(r, 8), _mm_srli_si128(g, 8), _mm_srli_si128(b, 8));
+          y = _mm_unpacklo_epi64(yLo, yHi);
+          __m128i bd = _mm_sub_epi32(b, y), rd = _mm_sub_epi32(r, y);
+          u = _mm_unpacklo_epi64(scaleTruncSse41(bd, 0.565, 128.0),
+                                 scaleTruncSse41(_mm_srli_si128(bd, 8), 0.565, 128.0));
+          v = _mm_unpacklo_epi64(scaleTruncSse41(rd, 0.713, 128.0),
+                                 scaleTruncSse41(_mm_srli_si128(rd, 8), 0.713, 128.0));
+     }
+
+     __attribute__((target("sse4.1"))) inline void store4Sse41(Uint8 *out, __m128i values)
+     {
+          __m128i bytes = _mm_packus_epi16(_mm_packus_epi32(values, values), values);
+          int packed = _mm_cvtsi128_si32(bytes);
+          std::memcpy(out, &packed, 4);
+     }
+
+     __attribute__((target("sse4.1"))) void fromRgbSse41(const Uint8 *rgb, int count, Uint8 *y, Uint8 *u,
+                                                         Uint8 *v, const Forward &f)
+     {
+          const __m128i pickR = _mm_setr_epi8(0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1);
+          const __m128i pickG = _mm_setr_epi8(1, -1, -1, -1, 4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1);
+          const __m128i pickB = _mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1);
+          int i = 0;
+          // The 16-byte load covers 4 pixels and must stay inside the row
+          for (; i + 6 <= count; i += 4)
+          {
+               __m128i px = _mm_loadu_si128((const __m128i *)(rgb + 3 * i));
+               __m128i r = _mm_shuffle_epi8(px, pickR);
+               __m128i g = _mm_shuffle_epi8(px, pickG);
+               __m128i b = _mm_shuffle_epi8(px, pickB);
+               __m128i yi, ui, vi;
+               if (f.jpeg)
+               {
+                    forwardJpegSse41(r, g, b, yi, ui, vi);
+               }
+               else
+               {
+                    forwardFloatSse41(r, g, b, f, yi, ui, vi);
+               }
+               store4Sse41(y + i, yi);
+               store4Sse41(u + i, ui);
+               store4Sse41(v + i, vi);
+          }
+          fromRgbScalar(rgb + 3 * i, count - i, y + i, u + i, v + i, f);
+     }
+
+     __attribute__((target("sse4.1"))) inline __m128i load4Sse41(const Uint8 *in)
+     {
+          int packed;
+          std::memcpy(&packed, in, 4);
+          return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+     }
+
+     // Saturate and interleave 4 pixels into 12 bytes of RGB24. Writes 16
+     // bytes; the caller leaves room.
+     __attribute__((target("sse4.1"))) inline void storeRgb4Sse41(Uint8 *out, __m128i r, __m128i g, __m128i b)
+     {
+          const __m128i interleave = _mm_setr_epi8(0, 4, 8, 1, 5, 9, 2, 6, 10, 3, 7, 11, -1, -1, -1, -1);
+          __m128i planes = _mm_packus_epi16(_mm_packus_epi32(r, g), _mm_packus_epi32(b, _mm_setzero_si128()));
+          _mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(planes, interleave));
+     }
+
+     __attribute__((target("sse4.1"))) void toRgbSse41(const Uint8 *y, const Uint8 *u, const Uint8 *v, int count,
+                                                       Uint8 *rgb, const Inverse &c)
+     {
+          const __m128i yOffset = _mm_set1_epi32(c.yOffset), chromaOffset = _mm_set1_epi32(128);
+          const __m128i round = _mm_set1_epi32(1 << (INVERSE_SHIFT - 1));
+          const __m128i cy = _mm_set1_epi32(c.cy), rv = _mm_set1_epi32(c.rv), gu = _mm_set1_epi32(c.gu);
+          const __m128i gv = _mm_set1_epi32(c.gv), bu = _mm_set1_epi32(c.bu);
+          int i = 0;
+          for (; i + 6 <= count; i += 4)
+          {
+               __m128i luma = _mm_add_epi32(_mm_mullo_epi32(cy, _mm_sub_epi32(load4Sse41(y + i), yOffset)), round);
+               __m128i cb = _mm_sub_epi32(load4Sse41(u + i), chromaOffset);
+               __m128i cr = _mm_sub_epi32(load4Sse41(v + i), chromaOffset);
+               __m128i r = _mm_srai_epi32(_mm_add_epi32(luma, _mm_mullo_epi32(rv, cr)), INVERSE_SHIFT);
+               __m128i g = _mm_srai_epi32(
+                   _mm_add_epi32(_mm_add_epi32(luma, _mm_mullo_epi32(gu, cb)), _mm_mullo_epi32(gv, cr)),
+                   INVERSE_SHIFT);
+               __m128i b = _mm_srai_epi32(_mm_add_epi32(luma, _mm_mullo_epi32(bu, cb)), INVERSE_SHIFT);
+               storeRgb4Sse41(rgb + 3 * i, r, g, b);
+          }
+          toRgbScalar(y + i, u + i, v + i, count - i, rgb + 3 * i, c);
+     }
+
+     // --- AVX2: 8 pixels per step, compiled for AVX2 regardless of -m flags ---
+
+     __attribute__((target("avx2"))) inline void forwardFloatAvx2(__m256i r, __m256i g, __m256i b, const Forward &f,
+                                                                  __m256i &y, __m256i &u, __m256i &v)
+     {
+          const __m256 half = _mm256_set1_ps(0.5f);
+          const __m256 max = _mm256_set1_ps(255.0f);
+          const __m256 zero = _mm256_setzero_ps();
+          __m256 rf = _mm256_cvtepi32_ps(r), gf = _mm256_cvtepi32_ps(g), bf = _mm256_cvtepi32_ps(b);
+          __m256 l = _mm256_add_ps(
+              _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f.kr), rf), _mm256_mul_ps(_mm256_set1_ps(f.kb), bf)),
+              _mm256_mul_ps(_mm256_set1_ps(f.kg), gf));
+          __m256 yf = _mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(219.0f), l), max);
+          yf = _mm256_floor_ps(_mm256_add_ps(_mm256_add_ps(yf, _mm256_set1_ps(16.0f)), half));
+          __m256 uf = _mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(112.0f), _mm256_sub_ps(bf, l)),
+                                    _mm256_set1_ps(f.uScale));
+          uf = _mm256_floor_ps(_mm256_add_ps(_mm256_add_ps(uf, _mm256_set1_ps(128.0f)), half));
+          __m256 vf = _mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(112.0f), _mm256_sub_ps(rf, l)),
+                                    _mm256_set1_ps(f.vScale));
+          vf = _mm256_floor_ps(_mm256_add_ps(_mm256_add_ps(vf, _mm256_set1_ps(128.0f)), half));
+          y = _mm256_cvttps_epi32(yf);
+          u = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(uf, zero), max));
+          v = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(vf, zero), max));
+     }
+
+     // (int)(x * scale + offset) per lane, in double precision
+     __attribute__((target("avx2"))) inline __m256i scaleTruncAvx2(__m256i x, double scale, double offset)
+     {
+          const __m256d s = _mm256_set1_pd(scale), o = _mm256_set1_pd(offset);
+          __m128i lo = _mm256_cvttpd_epi32(
+              _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(x)), s), o));
+          __m128i hi = _mm256_cvttpd_epi32(
+              _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1)), s), o));
+          return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+     }
+
+     __attribute__((target("avx2"))) inline __m128i lumaJpegAvx2(__m128i r, __m128i g, __m128i b)
+     {
+          __m256d l = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(0.299), _mm256_cvtepi32_pd(r)),
+                                                  _mm256_mul_pd(_mm256_set1_pd(0.587), _mm256_cvtepi32_pd(g))),
+                                    _mm256_mul_pd(_mm256_set1_pd(0.114), _mm256_cvtepi32_pd(b)));
+          return _mm256_cvttpd_epi32(l);
+     }
+
+     __attribute__((target("avx2"))) inline void forwardJpegAvx2(__m256i r, __m256i g, __m256i b, __m256i &y,
+                                                                 __m256i &u, __m256i &v)
+     {
+          __m128i yLo = lumaJpegAvx2(_mm256_castsi256_si128(r), _mm256_castsi256_si128(g), _mm256_castsi256_si128(b));
+          __m128i yHi = lumaJpegAvx2(_mm256_extracti128_si256(r, 1), _mm256_extracti128_si256(g, 1),
+                                     _mm256_extracti128_si256(b, 1));
+          y = _mm256_inserti128_si256(_mm256_castsi128_si256(yLo), yHi, 1);
+          u = scaleTruncAvx2(_mm256_sub_epi32(b, y), 0.565, 128.0);
+          v = scaleTruncAvx2(_mm256_sub_epi32(r, y), 0.713, 128.0);
+     }
+
+     __attribute__((target("avx2"))) inline void store8Avx2(Uint8 *out, __m256i values)
+     {
+          __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+          _mm_storel_epi64((__m128i *)out, _mm_packus_epi16(words, words));
+     }
+
+     __attribute__((target("avx2"))) void fromRgbAvx2(const Uint8 *rgb, int count, Uint8 *y, Uint8 *u, Uint8 *v,
+                                                      const Forward &f)
+     {
+          const __m256i pickR = _mm256_setr_epi8(0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1, 0, -1, -1,
+                                                 -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1);
+          const __m256i one = _mm256_set1_epi8(1);
+          // Shift the byte picks to G and B, keeping the -1 (zeroing) entries
+          const __m256i unused = _mm256_cmpgt_epi8(_mm256_setzero_si256(), pickR);
+          const __m256i pickG = _mm256_or_si256(_mm256_add_epi8(pickR, one), unused);
+          const __m256i pickB = _mm256_or_si256(_mm256_add_epi8(pickG, one), unused);
+          int i = 0;
+          // Two 16-byte loads 12 bytes apart cover 8 pixels
+          for (; i + 10 <= count; i += 8)
+          {
+               __m128i lo = _mm_loadu_si128((const __m128i *)(rgb + 3 * i));
+               __m128i hi = _mm_loadu_si128((const __m128i *)(rgb + 3 * i + 12));
+               __m256i px = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+               __m256i r = _mm256_shuffle_epi8(px, pickR);
+               __m256i g = _mm256_shuffle_epi8(px, pickG);
+               __m256i b = _mm256_shuffle_epi8(px, pickB);
+               __m256i yi, ui, vi;
+               if (f.jpeg)
+               {
+                    forwardJpegAvx2(r, g, b, yi, ui, vi);
+               }
+               else
+               {
+                    forwardFloatAvx2(r, g, b, f, yi, ui, vi);
+               }
+               store8Avx2(y + i, yi);
+               store8Avx2(u + i, ui);
+               store8Avx2(v + i, vi);
+          }
+          fromRgbSse41(rgb + 3 * i, count - i, y + i, u + i, v + i, f);
+     }
+
+     __attribute__((target("avx2"))) void toRgbAvx2(const Uint8 *y, const Uint8 *u, const Uint8 *v, int count,
+                                                    Uint8 *rgb, const Inverse &c)
+     {
+          const __m256i yOffset = _mm256_set1_epi32(c.yOffset), chromaOffset = _mm256_set1_epi32(128);
+          const __m256i round = _mm256_set1_epi32(1 << (INVERSE_SHIFT - 1));
+          const __m256i cy = _mm256_set1_epi32(c.cy), rv = _mm256_set1_epi32(c.rv), gu = _mm256_set1_epi32(c.gu);
+          const __m256i gv = _mm256_set1_epi32(c.gv), bu = _mm256_set1_epi32(c.bu);
+          const __m128i interleave = _mm_setr_epi8(0, 4, 8, 1, 5, 9, 2, 6, 10, 3, 7, 11, -1, -1, -1, -1);
+          int i = 0;
+          for (; i + 10 <= count; i += 8)
+          {
+               __m256i yi = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(y + i)));
+               __m256i cb = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(u + i))),
+                                             chromaOffset);
+               __m256i cr = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(v + i))),
+                                             chromaOffset);
+               __m256i luma = _mm256_add_epi32(_mm256_mullo_epi32(cy, _mm256_sub_epi32(yi, yOffset)), round);
+               __m256i r = _mm256_srai_epi32(_mm256_add_epi32(luma, _mm256_mullo_epi32(rv, cr)), INVERSE_SHIFT);
+               __m256i g = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(luma, _mm256_mullo_epi32(gu, cb)),
+                                                              _mm256_mullo_epi32(gv, cr)),
+                                             INVERSE_SHIFT);
+               __m256i b = _mm256_srai_epi32(_mm256_add_epi32(luma, _mm256_mullo_epi32(bu, cb)), INVERSE_SHIFT);
+
+               // packus works within 128-bit lanes: pixels 0-3 and 4-7
+               __m256i rg = _mm256_packus_epi32(r, g);
+               __m256i bz = _mm256_packus_epi32(b, _mm256_setzero_si256());
+               __m256i planes = _mm256_packus_epi16(rg, bz);
+               _mm_storeu_si128((__m128i *)(rgb + 3 * i), _mm_shuffle_epi8(_mm256_castsi256_si128(planes), interleave));
+               _mm_storeu_si128((__m128i *)(rgb + 3 * i + 12),
+                                _mm_shuffle_epi8(_mm256_extracti128_si256(planes, 1), interleave));
+          }
+          toRgbSse41(y + i, u + i, v + i, count - i, rgb + 3 * i, c);
+     }
+#endif
+
+#ifdef YUV_CONVERT_NEON
+     // --- NEON (AArch64): 8 pixels per step ---
+
+     inline void forwardFloatNeon(uint32x4_t r, uint32x4_t g, uint32x4_t b, const Forward &f, int32x4_t &y,
+                                  int32x4_t &u, int32x4_t &v)
+     {
+          const float32x4_t half = vdupq_n_f32(0.5f), max = vdupq_n_f32(255.0f), zero = vdupq_n_f32(0.0f);
+          float32x4_t rf = vcvtq_f32_u32(r), gf = vcvtq_f32_u32(g), bf = vcvtq_f32_u32(b);
+          float32x4_t l = vaddq_f32(vaddq_f32(vmulq_f32(vdupq_n_f32(f.kr), rf), vmulq_f32(vdupq_n_f32(f.kb), bf)),
+                                    vmulq_f32(vdupq_n_f32(f.kg), gf));
+          float32x4_t yf = vdivq_f32(vmulq_f32(vdupq_n_f32(219.0f), l), max);
+          yf = vrndmq_f32(vaddq_f32(vaddq_f32(yf, vdupq_n_f32(16.0f)), half));
+          float32x4_t uf = vdivq_f32(vmulq_f32(vdupq_n_f32(112.0f), vsubq_f32(bf, l)), vdupq_n_f32(f.uScale));
+          uf = vrndmq_f32(vaddq_f32(vaddq_f32(uf, vdupq_n_f32(128.0f)), half));
+          float32x4_t vf = vdivq_f32(vmulq_f32(vdupq_n_f32(112.0f), vsubq_f32(rf, l)), vdupq_n_f32(f.vScale));
+          vf = vrndmq_f32(vaddq_f32(vaddq_f32(vf, vdupq_n_f32(128.0f)), half));
+          y = vcvtq_s32_f32(yf);
+          u = vcvtq_s32_f32(vminq_f32(vmaxq_f32(uf, zero), max));
+          v = vcvtq_s32_f32(vminq_f32(vmaxq_f32(vf, zero), max));
+     }
+
+     // (int)(x * scale + offset) per lane, in double precision
+     inline int32x4_t scaleTruncNeon(int32x4_t x, double scale, double offset)
+     {
+          const float64x2_t s = vdupq_n_f64(scale), o = vdupq_n_f64(offset);
+          float64x2_t lo = vaddq_f64(vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(x))), s), o);
+          float64x2_t hi = vaddq_f64(vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(x))), s), o);
+          return vcombine_s32(vmovn_s64(vcvtq_s64_f64(lo)), vmovn_s64(vcvtq_s64_f64(hi)));
+     }
+
+     inline float64x2_t widenLow(uint32x4_t x)
+     {
+          return vcvtq_f64_u64(vmovl_u32(vget_low_u32(x)));
+     }
+
+     inline float64x2_t widenHigh(uint32x4_t x)
+     {
+          return vcvtq_f64_u64(vmovl_u32(vget_high_u32(x)));
+     }
+
+     inline void forwardJpegNeon(uint32x4_t r, uint32x4_t g, uint32x4_t b, int32x4_t &y, int32x4_t &u,
+                                 int32x4_t &v)
+     {
+          const float64x2_t kr = vdupq_n_f64(0.299), kg = vdupq_n_f64(0.587), kb = vdupq_n_f64(0.114);
+          float64x2_t lo = vaddq_f64(vaddq_f64(vmulq_f64(kr, widenLow(r)), vmulq_f64(kg, widenLow(g))),
+                                     vmulq_f64(kb, widenLow(b)));
+          float64x2_t hi = vaddq_f64(vaddq_f64(vmulq_f64(kr, widenHigh(r)), vmulq_f64(kg, widenHigh(g))),
+                                     vmulq_f64(kb, widenHigh(b)));
+          y = vcombine_s32(vmovn_s64(vcvtq_s64_f64(lo)), vmovn_s64(vcvtq_s64_f64(hi)));
+          u = scaleTruncNeon(vsubq_s32(vreinterpretq_s32_u32(b), y), 0.565, 128.0);
+          v = scaleTruncNeon(vsubq_s32(vreinterpretq_s32_u32(r), y), 0.713, 128.0);
+     }
+
+     inline uint8x8_t narrowNeon(int32x4_t lo, int32x4_t hi)
+     {
+          return vqmovn_u16(vcombine_u16(vqmovun_s32(lo), vqmovun_s32(hi)));
+     }
+
+     void fromRgbNeon(const Uint8 *rgb, int count, Uint8 *y, Uint8 *u, Uint8 *v, const Forward &f)
+     {
+          int i = 0;
+          for (; i + 8 <= count; i += 8)
+          {
+               uint8x8x3_t px = vld3_u8(rgb + 3 * i);
+               uint16x8_t r16 = vmovl_u8(px.val[0]), g16 = vmovl_u8(px.val[1]), b16 = vmovl_u8(px.val[2]);
+               int32x4_t y0, u0, v0, y1, u1, v1;
+               uint32x4_t r0 = vmovl_u16(vget_low_u16(r16)), r1 = vmovl_u16(vget_high_u16(r16));
+               uint32x4_t g0 = vmovl_u16(vget_low_u16(g16)), g1 = vmovl_u16(vget_high_u16(g16));
+               uint32x4_t b0 = vmovl_u16(vget_low_u16(b16)), b1 = vmovl_u16(vget_high_u16(b16));
+               if (f.jpeg)
+               {
+                    forwardJpegNeon(r0, g0, b0, y0, u0, v0);
+                    forwardJpegNeon(r1, g1, b1, y1, u1, v1);
+               }
+               else
+               {
+                    forwardFloatNeon(r0, g0, b0, f, y0, u0, v0);
+                    forwardFloatNeon(r1, g1, b1, f, y1, u1, v1);
+               }
+               vst1_u8(y + i, narrowNeon(y0, y1));
+               vst1_u8(u + i, narrowNeon(u0, u1));
+               vst1_u8(v + i, narrowNeon(v0, v1));
+          }
+          fromRgbScalar(rgb + 3 * i, count - i, y + i, u + i, v + i, f);
+     }
+
+     inline void inverseNeon(int16x4_t yi, int16x4_t cb, int16x4_t cr, const Inverse &c, int32x4_t &r,
+                             int32x4_t &g, int32x4_t &b)
+     {
+          int32x4_t luma = vaddq_s32(vmulq_n_s32(vsubq_s32(vmovl_s16(yi), vdupq_n_s32(c.yOffset)), c.cy),
+                                     vdupq_n_s32(1 << (INVERSE_SHIFT - 1)));
+          int32x4_t cb32 = vmovl_s16(cb), cr32 = vmovl_s16(cr);
+          r = vshrq_n_s32(vmlaq_n_s32(luma, cr32, c.rv), INVERSE_SHIFT);
+          g = vshrq_n_s32(vmlaq_n_s32(vmlaq_n_s32(luma, cb32, c.gu), cr32, c.gv), INVERSE_SHIFT);
+          b = vshrq_n_s32(vmlaq_n_s32(luma, cb32, c.bu), INVERSE_SHIFT);
+     }
+
+     void toRgbNeon(const Uint8 *y, const Uint8 *u, const Uint8 *v, int count, Uint8 *rgb, const Inverse &c)
+     {
+          const int16x8_t chromaOffset = vdupq_n_s16(128);
+          int i = 0;
+          for (; i + 8 <= count; i += 8)
+          {
+               int16x8_t yi = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + i)));
+               int16x8_t cb = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + i))), chromaOffset);
+               int16x8_t cr = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + i))), chromaOffset);
+               int32x4_t r0, g0, b0, r1, g1, b1;
+               inverseNeon(vget_low_s16(yi), vget_low_s16(cb), vget_low_s16(cr), c, r0, g0, b0);
+               inverseNeon(vget_high_s16(yi), vget_high_s16(cb), vget_high_s16(cr), c, r1, g1, b1);
+               uint8x8x3_t px;
+               px.val[0] = narrowNeon(r0, r1);
+               px.val[1] = narrowNeon(g0, g1);
+               px.val[2] = narrowNeon(b0, b1);
+               vst3_u8(rgb + 3 * i, px);
+          }
+          toRgbScalar(y + i, u + i, v + i, count - i, rgb + 3 * i, c);
+     }
+#endif
+
+     // --- Layouts ---
+
+     struct PlanarLayout
+     {
+          Uint8 *u, *v;
+          int step;  // 1 for separate planes, 2 for interleaved NV chroma
+          int pitch; // Bytes between chroma rows
+     };
+
+     bool planarLayout(Uint32 format, Uint8 *yuv, int width, int height, PlanarLayout &layout)
+     {
+          Uint8 *chroma = yuv + (size_t)width * height;
+          size_t planeSize = (size_t)((width + 1) / 2) * ((height + 1) / 2);
+          layout.step = 1;
+          switch (format)
+          {
+          case SDL_PIXELFORMAT_YV12:
+               layout.v = chroma;
+               layout.u = chroma + planeSize;
+               break;
+          case SDL_PIXELFORMAT_IYUV:
+               layout.u = chroma;
+               layout.v = chroma + planeSize;
+               break;
+          case SDL_PIXELFORMAT_NV12:
+               layout.u = chroma;
+               layout.v = chroma + 1;
+               layout.step = 2;
+               break;
+          case SDL_PIXELFORMAT_NV21:
+               layout.v = chroma;
+               layout.u = chroma + 1;
+               layout.step = 2;
+               break;
+          default:
+               return false;
+          }
+          layout.pitch = (width + 1) / 2 * layout.step;
+          return true;
+     }
+
+     // Byte offsets of the first Y, second Y, U and V in a packed 4-byte pair
+     bool packedLayout(Uint32 format, int offsets[4])
+     {
+          switch (format)
+          {
+          case SDL_PIXELFORMAT_YUY2:
+               offsets[0] = 0, offsets[1] = 2, offsets[2] = 1, offsets[3] = 3;
+               return true;
+          case SDL_PIXELFORMAT_UYVY:
+               offsets[0] = 1, offsets[1] = 3, offsets[2] = 0, offsets[3] = 2;
+               return true;
+          case SDL_PIXELFORMAT_YVYU:
+               offsets[0] = 0, offsets[1] = 2, offsets[2] = 3, offsets[3] = 1;
+               return true;
+          default:
+               return false;
+          }
+     }
+
+     // Chroma averaging matches testyuv_cvt.c: floor(sum / n + 0.5)
+     void planarFromRgb(FromRgbFn convert, const Uint8 *rgb, int rgbPitch, Uint8 *yuv, int width, int height,
+                        const PlanarLayout &layout, const Forward &f)
+     {
+          std::vector<Uint8> rows((size_t)width * 4);
+          Uint8 *u0 = rows.data(), *v0 = u0 + width, *u1 = v0 + width, *v1 = u1 + width;
+          for (int y = 0; y < height; y += 2)
+          {
+               bool pair = y + 1 < height;
+               convert(rgb + (size_t)y * rgbPitch, width, yuv + (size_t)y * width, u0, v0, f);
+               if (pair)
+               {
+                    convert(rgb + (size_t)(y + 1) * rgbPitch, width, yuv + (size_t)(y + 1) * width, u1, v1, f);
+               }
+               Uint8 *uOut = layout.u + (size_t)(y / 2) * layout.pitch;
+               Uint8 *vOut = layout.v + (size_t)(y / 2) * layout.pitch;
+               for (int x = 0; x < width; x += 2, uOut += layout.step, vOut += layout.step)
+               {
+                    if (x + 1 < width && pair)
+                    {
+                         *uOut = (Uint8)((u0[x] + u0[x + 1] + u1[x] + u1[x + 1] + 2) >> 2);
+                         *vOut = (Uint8)((v0[x] + v0[x + 1] + v1[x] + v1[x + 1] + 2) >> 2);
+                    }
+                    else if (x + 1 < width)
+                    {
+                         *uOut = (Uint8)((u0[x] + u0[x + 1] + 1) >> 1);
+                         *vOut = (Uint8)((v0[x] + v0[x + 1] + 1) >> 1);
+                    }
+                    else if (pair)
+                    {
+                         *uOut = (Uint8)((u0[x] + u1[x] + 1) >> 1);
+                         *vOut = (Uint8)((v0[x] + v1[x] + 1) >> 1);
+                    }
+                    else
+                    {
+                         *uOut = u0[x];
+                         *vOut = v0[x];
+                    }
+               }
+          }
+     }
+
+     void packedFromRgb(FromRgbFn convert, const Uint8 *rgb, int rgbPitch, Uint8 *yuv, int width, int height,
+                        const int offsets[4], const Forward &f)
+     {
+          std::vector<Uint8> rows((size_t)width * 3);
+          Uint8 *ys = rows.data(), *us = ys + width, *vs = us + width;
+          int pitch = yuvPitch(SDL_PIXELFORMAT_YUY2, width);
+          for (int y = 0; y < height; y++)
+          {
+               convert(rgb + (size_t)y * rgbPitch, width, ys, us, vs, f);
+               Uint8 *out = yuv + (size_t)y * pitch;
+               for (int x = 0; x < width; x += 2, out += 4)
+               {
+                    if (x + 1 < width)
+                    {
+                         out[offsets[0]] = ys[x];
+                         out[offsets[1]] = ys[x + 1];
+                         out[offsets[2]] = (Uint8)((us[x] + us[x + 1] + 1) >> 1);
+                         out[offsets[3]] = (Uint8)((vs[x] + vs[x + 1] + 1) >> 1);
+                    }
+                    else
+                    {
+                         out[offsets[0]] = out[offsets[1]] = ys[x];
+                         out[offsets[2]] = us[x];
+                         out[offsets[3]] = vs[x];
+                    }
+               }
+          }
+     }
+
+     // Each chroma sample covers its 2x2 (planar) or 2x1 (packed) pixels
+     void planarToRgb(ToRgbFn convert, const Uint8 *yuv, int width, int height, const PlanarLayout &layout,
+                      Uint8 *rgb, int rgbPitch, const Inverse &c)
+     {
+          std::vector<Uint8> rows((size_t)width * 2);
+          Uint8 *us = rows.data(), *vs = us + width;
+          for (int y = 0; y < height; y++)
+          {
+               const Uint8 *uIn = layout.u + (size_t)(y / 2) * layout.pitch;
+               const Uint8 *vIn = layout.v + (size_t)(y / 2) * layout.pitch;
+               for (int x = 0; x < width; x++)
+               {
+                    us[x] = uIn[(x / 2) * layout.step];
+                    vs[x] = vIn[(x / 2) * layout.step];
+               }
+               convert(yuv + (size_t)y * width, us, vs, width, rgb + (size_t)y * rgbPitch, c);
+          }
+     }
+
+     void packedToRgb(ToRgbFn convert, const Uint8 *yuv, int width, int height, const int offsets[4], Uint8 *rgb,
+                      int rgbPitch, const Inverse &c)
+     {
+          std::vector<Uint8> rows((size_t)width * 3);
+          Uint8 *ys = rows.data(), *us = ys + width, *vs = us + width;
+          int pitch = yuvPitch(SDL_PIXELFORMAT_YUY2, width);
+          for (int y = 0; y < height; y++)
+          {
+               const Uint8 *in = yuv + (size_t)y * pitch;
+               for (int x = 0; x < width; x++)
+               {
+                    const Uint8 *pair = in + (x / 2) * 4;
+                    ys[x] = pair[offsets[x & 1]];
+                    us[x] = pair[offsets[2]];
+                    vs[x] = pair[offsets[3]];
+               }
+               convert(ys, us, vs, width, rgb + (size_t)y * rgbPitch, c);
+          }
+     }
+
+     YuvKernel resolveKernel(YuvKernel kernel)
+     {
+          if (kernel == YUV_KERNEL_AUTO)
+          {
+               const YuvKernel preferred[] = {YUV_KERNEL_AVX2, YUV_KERNEL_NEON, YUV_KERNEL_SSE41};
+               for (YuvKernel candidate : preferred)
+               {
+                    if (yuvKernelSupported(candidate))
+                    {
+                         return candidate;
+                    }
+               }
+               return YUV_KERNEL_SCALAR;
+          }
+          return yuvKernelSupported(kernel) ? kernel : YUV_KERNEL_SCALAR;
+     }
+
+     void kernelFunctions(YuvKernel kernel, FromRgbFn &from, ToRgbFn &to)
+     {
+          from = fromRgbScalar;
+          to = toRgbScalar;
+          switch (resolveKernel(kernel))
+          {
+#ifdef YUV_CONVERT_X86
+          case YUV_KERNEL_SSE41:
+               from = fromRgbSse41;
+               to = toRgbSse41;
+               break;
+          case YUV_KERNEL_AVX2:
+               from = fromRgbAvx2;
+               to = toRgbAvx2;
+               break;
+#endif
+#ifdef YUV_CONVERT_NEON
+          case YUV_KERNEL_NEON:
+               from = fromRgbNeon;
+               to = toRgbNeon;
+               break;
+#endif
+          default:
+               break;
+          }
+     }
+}
+
+bool yuvKernelSupported(YuvKernel kernel)
+{
+     switch (kernel)
+     {
+     case YUV_KERNEL_AUTO:
+     case YUV_KERNEL_SCALAR:
+          return true;
+#ifdef YUV_CONVERT_X86
+     case YUV_KERNEL_SSE41:
+          return SDL_HasSSE41() == SDL_TRUE;
+     case YUV_KERNEL_AVX2:
+          return SDL_HasAVX2() == SDL_TRUE;
+#endif
+#ifdef YUV_CONVERT_NEON
+     case YUV_KERNEL_NEON:
+          return SDL_HasNEON() == SDL_TRUE;
+#endif
+     default:
+          return false;
+     }
+}
+
+const char *yuvKernelName(YuvKernel kernel)
+{
+     switch (kernel)
+     {
+     case YUV_KERNEL_SCALAR:
+          return "scalar";
+     case YUV_KERNEL_SSE41:
+          return "sse4.1";
+     case YUV_KERNEL_AVX2:
+          return "avx2";
+     case YUV_KERNEL_NEON:
+          return "neon";
+     default:
+          return "auto";
+     }
+}
+
+int yuvPitch(Uint32 format, int width)
+{
+     switch (format)
+     {
+     case SDL_PIXELFORMAT_YV12:
+     case SDL_PIXELFORMAT_IYUV:
+     case SDL_PIXELFORMAT_NV12:
+     case SDL_PIXELFORMAT_NV21:
+          return width;
+     case SDL_PIXELFORMAT_YUY2:
+     case SDL_PIXELFORMAT_UYVY:
+     case SDL_PIXELFORMAT_YVYU:
+          return 4 * ((width + 1) / 2);
+     default:
+          return 0;
+     }
+}
+
+size_t yuvImageSize(Uint32 format, int width, int height)
+{
+     int offsets[4];
+     if (packedLayout(format, offsets))
+     {
+          return (size_t)yuvPitch(format, width) * height;
+     }
+     return (size_t)width * height + 2 * (size_t)((width + 1) / 2) * ((height + 1) / 2);
+}
+
+bool yuvFromRgb(YuvKernel kernel, Uint32 format, const Uint8 *rgb, int rgbPitch, Uint8 *yuv, int width, int height,
+                SDL_YUV_CONVERSION_MODE mode)
+{
+     FromRgbFn convert;
+     ToRgbFn unused;
+     kernelFunctions(kernel, convert, unused);
+     Forward f = forwardFor(resolveMode(mode, width, height));
+
+     PlanarLayout layout;
+     int offsets[4];
+     if (planarLayout(format, yuv, width, height, layout))
+     {
+          planarFromRgb(convert, rgb, rgbPitch, yuv, width, height, layout, f);
+          return true;
+     }
+     if (packedLayout(format, offsets))
+     {
+          packedFromRgb(convert, rgb, rgbPitch, yuv, width, height, offsets, f);
+          return true;
+     }
+     SDL_SetError("Unsupported YUV format %s", SDL_GetPixelFormatName(format));
+     return false;
+}
+
+bool yuvToRgb(YuvKernel kernel, Uint32 format, const Uint8 *yuv, int width, int height, Uint8 *rgb, int rgbPitch,
+              SDL_YUV_CONVERSION_MODE mode)
+{
+     FromRgbFn unused;
+     ToRgbFn convert;
+     kernelFunctions(kernel, unused, convert);
+     Inverse c = inverseFor(resolveMode(mode, width, height));
+
+     PlanarLayout layout;
+     int offsets[4];
+     if (planarLayout(format, (Uint8 *)yuv, width, height, layout))
+     {
+          planarToRgb(convert, yuv, width, height, layout, rgb, rgbPitch, c);
+          return true;
+     }
+     if (packedLayout(format, offsets))
+     {
+          packedToRgb(convert, yuv, width, height, offsets, rgb, rgbPitch, c);
+          return true;
+     }
+     SDL_SetError("Unsupported YUV format %s", SDL_GetPixelFormatName(format));
+     return false;
+}
@@ -0,0 +1,50 @@
+// Description:
+// RGB24 <-> YUV conversion for the planar (YV12, IYUV, NV12, NV21) and
+// packed (YUY2, UYVY, YVYU) formats, with SSE4.1, AVX2 and NEON kernels.
+// Buffers use the layouts of SDL's test/testyuv_cvt.c: the Y plane has a
+// pitch of `width`, chroma planes follow it directly, and packed rows are
+// yuvPitch() bytes.
+//
+// RGB -> YUV is bit-exact with testyuv_cvt.c's ConvertRGBtoYUV (monochrome
+// off, luminance 100) for every conversion mode. That reference computes in
+// float (BT.601/BT.709) and double (JPEG) and then truncates, so the
+// kernels vectorize those same operations in the same order rather than
+// approximating them with fixed-point integers. Bit-exactness assumes the
+// build does not contract multiplies and adds into FMA: do not combine
+// -ffp-contract=fast with -mfma or -march=native.
+//
+// YUV -> RGB has no float reference to match and uses a 14-bit fixed-point
+// integer pipeline; every kernel produces exactly the scalar result.
+// =============================================================================
+
+#ifndef YUV_CONVERT_H
+#define YUV_CONVERT_H
+
+#include <SDL2/SDL.h>
+
+enum YuvKernel
+{
+     YUV_KERNEL_AUTO,
+     YUV_KERNEL_SCALAR,
+     YUV_KERNEL_SSE41,
+     YUV_KERNEL_AVX2,
+     YUV_KERNEL_NEON // AArch64 only: needs vector divide and double lanes
+};
+
+bool yuvKernelSupported(YuvKernel kernel);
+const char *yuvKernelName(YuvKernel kernel);
+
+// Bytes per row of the Y plane or packed image; 0 for unsupported formats
+int yuvPitch(Uint32 format, int width);
+
+// Total bytes of a width x height image in `format`
+size_t yuvImageSize(Uint32 format, int width, int height);
+
+// SDL_YUV_CONVERSION_AUTOMATIC resolves by resolution like SDL does.
+// Both return false for unsupported formats.
+bool yuvFromRgb(YuvKernel kernel, Uint32 format, const Uint8 *rgb, int rgbPitch, Uint8 *yuv, int width, int height,
+                SDL_YUV_CONVERSION_MODE mode);
+bool yuvToRgb(YuvKernel kernel, Uint32 format, const Uint8 *yuv, int width, int height, Uint8 *rgb, int rgbPitch,
+              SDL_YUV_CONVERSION_MODE mode);
+
+#endif // YUV_CONVERT_H
@@ -0,0 +1,88 @@
+// Description:
+// Compiles a gamecontrollerdb.txt into the indexed mapping file that
+// mapping_db.h looks controllers up in:
+//
+//     mkmapdb gamecontrollerdb.txt controllers.gcdb
+//
+// Every mapping is looked up again in the result, so a layout mistake
+// fails the build rather than a controller. Build with:  make mkmapdb
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "mapping_db.h"
+
+int main(int argc, char *argv[])
+{
+     if (argc != 3)
+     {
+          std::fprintf(stderr, "usage: %s gamecontrollerdb.txt out.gcdb\n", argv[0]);
+          return 1;
+     }
+     size_t size = 0;
+     char *text = (char *)SDL_LoadFile(argv[1], &size);
+     if (text == nullptr)
+     {
+          std::fprintf(stderr, "Unable to read %s: %s\n", argv[1], SDL_GetError());
+          return 1;
+     }
+     int entries = 0;
+     if (!mappingDbCompile(text, size, argv[2], &entries))
+     {
+          std::fprintf(stderr, "Unable to write %s: %s\n", argv[2], SDL_GetError());
+          SDL_free(text);
+          return 1;
+     }
+
+     // Lines for this platform (or none) must come back as written; where a
+     // GUID repeats, the last one
+     MappingDb db;
+     if (!mappingDbOpen(db, argv[2]))
+     {
+          SDL_free(text);
+          return 1;
+     }
+     int checked = 0;
+     int missing = 0;
+     const std::string platform = std::string("platform:") + SDL_GetPlatform();
+     std::string mapping;
+     size_t start = 0;
+     while (start < size)
+     {
+          const char *newline = (const char *)std::memchr(text + start, '\n', size - start);
+          const size_t end = newline != nullptr ? (size_t)(newline - text) : size;
+          std::string line(text + start, end - start);
+          start = end + 1;
+          if (!line.empty() && line.back() == '\r')
+          {
+               line.pop_back();
+          }
+          if (line.size() < 33 || line[32] != ',' || line[0] == '#' ||
+              (line.find("platform:") != std::string::npos && line.find(platform) == std::string::npos))
+          {
+               continue;
+          }
+          checked++;
+          SDL_JoystickGUID guid = SDL_JoystickGetGUIDFromString(line.substr(0, 32).c_str());
+          // A device matching a crc: line reports that CRC in its GUID
+          const size_t crc = line.find(",crc:");
+          if (crc != std::string::npos && guid.data[2] == 0 && guid.data[3] == 0)
+          {
+               const Uint16 value = SDL_SwapLE16((Uint16)SDL_strtoul(line.c_str() + crc + 5, nullptr, 16));
+               SDL_memcpy(guid.data + 2, &value, sizeof(value));
+          }
+          if (!mappingDbFind(db, guid, mapping) || mapping.compare(0, 33, line, 0, 33) != 0)
+          {
+               std::fprintf(stderr, "%s missing from %s\n", line.substr(0, 32).c_str(), argv[2]);
+               missing++;
+          }
+     }
+     std::printf("%s: %d mappings in %u buckets, %zu bytes; %d checked for %s\n", argv[2], entries, db.bucketCount,
+                 db.size, checked, SDL_GetPlatform());
+     mappingDbClose(db);
+     SDL_free(text);
+     return missing == 0 ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+// Description:
+// Builds an asset pack for asset_pack.h from a list of files:
+//
+//     mkpack [-z] assets.pak play_button.png game_over.png sans.ttf ...
+//
+// -z stores entries that compress well as LZ4 blocks.
+// Files are stored under the paths given, so run it from the directory the
+// game loads assets relative to. Build with:  make mkpack
+// =============================================================================
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+
+int main(int argc, char *argv[])
+{
+     int first = 1;
+     bool compress = argc > 1 && std::string(argv[1]) == "-z";
+     if (compress)
+     {
+          first++;
+     }
+     if (argc - first < 2)
+     {
+          std::fprintf(stderr, "usage: %s [-z] out.pak file...\n", argv[0]);
+          return 1;
+     }
+     const char *outPath = argv[first];
+     std::vector<std::string> files(argv + first + 1, argv + argc);
+     if (!assetPackWrite(outPath, files, compress))
+     {
+          return 1;
+     }
+
+     // Read the result back to catch layout mistakes at build time
+     AssetPack pack;
+     if (!assetPackOpen(pack, outPath))
+     {
+          return 1;
+     }
+     int missing = 0;
+     for (const std::string &file : files)
+     {
+          if (!assetPackContains(pack, file))
+          {
+               std::fprintf(stderr, "%s missing from pack\n", file.c_str());
+               missing++;
+          }
+     }
+     int compressed = 0;
+     for (const AssetPackEntry &entry : pack.entries)
+     {
+          compressed += entry.compression != ASSET_PACK_RAW;
+     }
+     std::printf("%s: %d files (%d compressed), %zu bytes\n", outPath, (int)pack.entries.size(), compressed,
+                 pack.size);
+     assetPackClose(pack);
+     return missing == 0 ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+// Description:
+// --pre-js for `make web`: main()'s arguments come from the page's query
+// string, one "--name value" pair per parameter, so
+//
+//     mygame.html?bench=600
+//
+// runs "mygame --bench 600" in the browser. A parameter without a value is
+// passed as a lone flag.
+// =============================================================================
+
+var Module = typeof Module !== 'undefined' ? Module : {};
+if (typeof location !== 'undefined' && typeof URLSearchParams !== 'undefined' && !Module['arguments'])
+{
+     Module['arguments'] = [];
+     new URLSearchParams(location.search).forEach(function(value, name)
+     {
+          Module['arguments'].push('--' + name);
+          if (value !== '')
+          {
+               Module['arguments'].push(value);
+          }
+     });
+}